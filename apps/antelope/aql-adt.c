@@ -87,6 +87,9 @@ aql_clear(aql_adt_t *adt)
   adt->attribute_count = 0;
   adt->value_count = 0;
   adt->flags = 0;
+#if DB_FEATURE_PREPARED
+  adt->parameter_count = 0;
+#endif /* DB_FEATURE_PREPARED */
   memset(adt->aggregators, 0, sizeof(adt->aggregators));
 }
 
@@ -147,3 +150,35 @@ aql_add_value(aql_adt_t *adt, domain_t domain, void *value_ptr)
 
   return DB_OK;
 }
+
+#if DB_FEATURE_PREPARED
+db_result_t
+aql_add_parameter(aql_adt_t *adt, uint8_t type)
+{
+  aql_parameter_t *parameter;
+
+  if(adt->parameter_count == AQL_PARAMETER_LIMIT) {
+    return DB_LIMIT_ERROR;
+  }
+
+  parameter = &adt->parameters[adt->parameter_count];
+  parameter->type = type;
+
+  if(type == AQL_PARAMETER_VALUE) {
+    /* Reserve a value slot, which is filled in when binding. */
+    if(adt->value_count == AQL_ATTRIBUTE_LIMIT) {
+      return DB_LIMIT_ERROR;
+    }
+    parameter->index = adt->value_count;
+    adt->values[adt->value_count++].domain = DOMAIN_UNSPECIFIED;
+  } else {
+    /* The LVM operand carries the parameter number until the
+       statement resolves it to a code offset. */
+    parameter->index = adt->parameter_count;
+  }
+
+  adt->parameter_count++;
+
+  return DB_OK;
+}
+#endif /* DB_FEATURE_PREPARED */
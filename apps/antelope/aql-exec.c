@@ -48,9 +48,37 @@
 #include "relation.h"
 #include "result.h"
 #include "aql.h"
+#include "lvm.h"
 
 static aql_adt_t adt;
 
+#if DB_FEATURE_PREPARED
+/* A prepared statement keeps the parsed form of a query, together with
+   its own copy of the LVM bytecode of the condition, so that executing
+   it again requires neither lexing nor parsing. */
+struct db_statement {
+  char query[AQL_MAX_QUERY_LENGTH];
+  aql_adt_t adt;
+  lvm_instance_t lvm;
+  unsigned char vmcode[DB_VM_BYTECODE_SIZE];
+  unsigned char strings[DB_MAX_CHAR_SIZE_PER_ROW];
+  lvm_ip_t offsets[AQL_PARAMETER_LIMIT];
+  uint8_t variables[AQL_ATTRIBUTE_LIMIT];
+  uint8_t variable_count;
+  uint8_t bound;
+  uint8_t references;
+  uint8_t valid;
+  uint16_t last_use;
+};
+
+#if AQL_PARAMETER_LIMIT > 8
+#error "AQL_PARAMETER_LIMIT must not exceed the width of the bound bitmap"
+#endif
+
+static db_statement_t statements[DB_STATEMENT_POOL_SIZE];
+static uint16_t use_counter;
+#endif /* DB_FEATURE_PREPARED */
+
 static void
 clear_handle(db_handle_t *handle)
 {
@@ -205,11 +233,246 @@ db_query(db_handle_t *handle, const char *format, ...)
     return DB_PARSING_ERROR;
   }
 
+#if DB_FEATURE_PREPARED
+  if(adt.parameter_count > 0) {
+    /* Parameters can only be given values through db_execute(). */
+    return DB_ARGUMENT_ERROR;
+  }
+#endif /* DB_FEATURE_PREPARED */
+
   /*aql_optimize(&adt);*/
 
   return aql_execute(handle, &adt);
 }
 
+#if DB_FEATURE_PREPARED
+static db_result_t
+compile_statement(db_statement_t *statement)
+{
+  aql_adt_t *sadt;
+  attribute_value_t *value;
+  unsigned char *string;
+  size_t length;
+  size_t offset;
+  const char *name;
+  int i;
+
+  sadt = &statement->adt;
+  if(AQL_ERROR(aql_parse(sadt, statement->query))) {
+    return DB_PARSING_ERROR;
+  }
+
+  /* String constants are kept in a buffer that the next query
+     overwrites, so the statement needs its own copies. */
+  offset = 0;
+  for(i = 0; i < sadt->value_count; i++) {
+    value = &sadt->values[i];
+    if(value->domain == DOMAIN_STRING) {
+      string = VALUE_STRING(value);
+      length = strlen((char *)string) + 1;
+      if(offset + length > sizeof(statement->strings)) {
+        return DB_LIMIT_ERROR;
+      }
+      memcpy(statement->strings + offset, string, length);
+      VALUE_STRING(value) = statement->strings + offset;
+      offset += length;
+    }
+  }
+
+  statement->variable_count = 0;
+  if(sadt->lvm_instance != NULL) {
+    lvm_clone(&statement->lvm, sadt->lvm_instance);
+    memcpy(statement->vmcode, statement->lvm.code, statement->lvm.end);
+    statement->lvm.code = statement->vmcode;
+    statement->lvm.size = sizeof(statement->vmcode);
+    AQL_SET_CONDITION(sadt, &statement->lvm);
+
+    if(LVM_ERROR(lvm_resolve_parameters(&statement->lvm, statement->offsets,
+                                        sadt->parameter_count))) {
+      return DB_PARSING_ERROR;
+    }
+
+    /* The LVM variable table is shared by all queries, so remember
+       which attribute each variable ID refers to. */
+    for(name = lvm_get_variable_name(0);
+        name != NULL;
+        name = lvm_get_variable_name(statement->variable_count)) {
+      for(i = 0; i < AQL_ATTRIBUTE_COUNT(sadt); i++) {
+        if(strcmp(sadt->attributes[i].name, name) == 0) {
+          break;
+        }
+      }
+      if(i == AQL_ATTRIBUTE_COUNT(sadt) ||
+         statement->variable_count == AQL_ATTRIBUTE_LIMIT) {
+        return DB_LIMIT_ERROR;
+      }
+      statement->variables[statement->variable_count++] = i;
+    }
+  }
+
+  return DB_OK;
+}
+
+db_statement_t *
+db_prepare(const char *query)
+{
+  db_statement_t *statement;
+  db_statement_t *victim;
+  int i;
+
+  if(strlen(query) >= AQL_MAX_QUERY_LENGTH) {
+    return NULL;
+  }
+
+  victim = NULL;
+  for(i = 0; i < DB_STATEMENT_POOL_SIZE; i++) {
+    statement = &statements[i];
+    if(!statement->valid) {
+      if(victim == NULL || victim->valid) {
+        victim = statement;
+      }
+      continue;
+    }
+
+    if(strcmp(statement->query, query) == 0) {
+      PRINTF("DB: Reusing the prepared statement \"%s\"\n", query);
+      statement->references++;
+      statement->last_use = ++use_counter;
+      return statement;
+    }
+
+    /* Replace the least recently used statement that is not in use. */
+    if(statement->references == 0 &&
+       (victim == NULL ||
+        (victim->valid &&
+         (uint16_t)(use_counter - statement->last_use) >
+         (uint16_t)(use_counter - victim->last_use)))) {
+      victim = statement;
+    }
+  }
+
+  if(victim == NULL) {
+    PRINTF("DB: No free prepared statement for \"%s\"\n", query);
+    return NULL;
+  }
+
+  statement = victim;
+  memset(statement, 0, sizeof(*statement));
+  strcpy(statement->query, query);
+
+  if(DB_ERROR(compile_statement(statement))) {
+    statement->valid = 0;
+    return NULL;
+  }
+
+  statement->valid = 1;
+  statement->references = 1;
+  statement->last_use = ++use_counter;
+
+  return statement;
+}
+
+static aql_parameter_t *
+get_parameter(db_statement_t *statement, unsigned index)
+{
+  if(statement == NULL || index >= statement->adt.parameter_count) {
+    return NULL;
+  }
+  return &statement->adt.parameters[index];
+}
+
+db_result_t
+db_bind_int(db_statement_t *statement, unsigned index, long value)
+{
+  aql_parameter_t *parameter;
+  attribute_value_t *attr_value;
+
+  parameter = get_parameter(statement, index);
+  if(parameter == NULL) {
+    return DB_ARGUMENT_ERROR;
+  }
+
+  if(parameter->type == AQL_PARAMETER_VALUE) {
+    attr_value = &statement->adt.values[parameter->index];
+    attr_value->domain = DOMAIN_INT;
+    VALUE_LONG(attr_value) = value;
+  } else {
+    lvm_set_long_at(&statement->lvm, statement->offsets[parameter->index],
+                    value);
+  }
+
+  statement->bound |= 1 << index;
+
+  return DB_OK;
+}
+
+db_result_t
+db_bind_string(db_statement_t *statement, unsigned index, const char *value)
+{
+  aql_parameter_t *parameter;
+  attribute_value_t *attr_value;
+
+  parameter = get_parameter(statement, index);
+  if(parameter == NULL) {
+    return DB_ARGUMENT_ERROR;
+  }
+
+  /* The LVM only compares numbers, so strings can only be inserted. */
+  if(parameter->type != AQL_PARAMETER_VALUE) {
+    return DB_TYPE_ERROR;
+  }
+
+  attr_value = &statement->adt.values[parameter->index];
+  attr_value->domain = DOMAIN_STRING;
+  VALUE_STRING(attr_value) = (unsigned char *)value;
+
+  statement->bound |= 1 << index;
+
+  return DB_OK;
+}
+
+db_result_t
+db_execute(db_handle_t *handle, db_statement_t *statement)
+{
+  int i;
+
+  if(statement == NULL || !statement->valid) {
+    return DB_ARGUMENT_ERROR;
+  }
+
+  if(statement->bound != (1 << statement->adt.parameter_count) - 1) {
+    PRINTF("DB: Not all parameters of the statement have been bound\n");
+    return DB_ARGUMENT_ERROR;
+  }
+
+  if(handle != NULL) {
+    clear_handle(handle);
+  }
+
+  if(statement->adt.lvm_instance != NULL) {
+    /* Restore the variable IDs that the bytecode was compiled with. */
+    lvm_clear_variables();
+    for(i = 0; i < statement->variable_count; i++) {
+      lvm_register_variable(statement->adt.attributes[statement->variables[i]].name,
+                            LVM_LONG);
+    }
+  }
+
+  /* The execution may modify the ADT, so work on a copy of it. */
+  memcpy(&adt, &statement->adt, sizeof(adt));
+
+  return aql_execute(handle, &adt);
+}
+
+void
+db_finalize(db_statement_t *statement)
+{
+  if(statement != NULL && statement->references > 0) {
+    statement->references--;
+  }
+}
+#endif /* DB_FEATURE_PREPARED */
+
 db_result_t
 db_process(db_handle_t *handle)
 {
@@ -250,6 +250,13 @@ PARSER(values)
   case INTEGER_VALUE:
     AQL_ADD_VALUE(adt, DOMAIN_INT, VALUE);
     break;
+#if DB_FEATURE_PREPARED
+  case PARAMETER:
+    if(DB_ERROR(AQL_ADD_PARAMETER(adt, AQL_PARAMETER_VALUE))) {
+      RETURN(SYNTAX_ERROR);
+    }
+    break;
+#endif /* DB_FEATURE_PREPARED */
   default:
     RETURN(SYNTAX_ERROR);
   }
@@ -280,6 +287,14 @@ PARSER(operand)
   case INTEGER_VALUE:
     lvm_set_long(&p, *(long *)lexer->value);
     break;
+#if DB_FEATURE_PREPARED
+  case PARAMETER:
+    lvm_set_parameter(&p, adt->parameter_count);
+    if(DB_ERROR(AQL_ADD_PARAMETER(adt, AQL_PARAMETER_OPERAND))) {
+      RETURN(SYNTAX_ERROR);
+    }
+    break;
+#endif /* DB_FEATURE_PREPARED */
   default:
     RETURN(SYNTAX_ERROR);
   }
@@ -479,6 +494,39 @@ PARSER(join)
   RETURN(OK);
 }
 
+PARSER(group)
+{
+  int i;
+
+  /* The GROUP BY clause is optional. */
+  NEXT;
+  if(TOKEN != GROUP) {
+    REWIND;
+    RETURN(OK);
+  }
+
+  CONSUME(BY);
+  CONSUME(IDENTIFIER);
+
+  /* The grouping attribute must be one of the plain projected attributes. */
+  for(i = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
+    if(adt->aggregators[i] == AQL_NONE &&
+       !(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE) &&
+       strcmp(adt->attributes[i].name, VALUE) == 0) {
+      break;
+    }
+  }
+
+  if(i == AQL_ATTRIBUTE_COUNT(adt)) {
+    RETURN(SYNTAX_ERROR);
+  }
+
+  PRINTF("group by: %s\n", VALUE);
+  AQL_SET_GROUP(adt, i);
+
+  RETURN(OK);
+}
+
 PARSER(select)
 {
   AQL_SET_TYPE(adt, AQL_TYPE_SELECT);
@@ -504,9 +552,16 @@ PARSER(select)
     AQL_SET_CONDITION(adt, &p);
   } else {
     REWIND;
+    if(!PARSE(group)) {
+      RETURN(SYNTAX_ERROR);
+    }
     RETURN(OK);
   }
 
+  if(!PARSE(group)) {
+    RETURN(SYNTAX_ERROR);
+  }
+
   CONSUME(END);
 
   return OK;
@@ -645,6 +700,9 @@ PARSER_TOKEN(index_type)
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
+  case BTREE:
+    type = INDEX_BTREE;
+    break;
   default:
     return NONE;
   };
@@ -104,6 +104,10 @@ enum token {
   MEMHASH = 46,
   RELATION = 47,
   ATTRIBUTE = 48,
+  BTREE = 49,
+  GROUP = 50,
+  BY = 51,
+  PARAMETER = 52,
 
   INTEGER_VALUE = 251,
   FLOAT_VALUE = 252,
@@ -145,6 +149,19 @@ struct aql_attribute {
 };
 typedef struct aql_attribute aql_attribute_t;
 
+#if DB_FEATURE_PREPARED
+/* A '?' placeholder is either an INSERT value or a constant operand in
+   the LVM code of a condition. */
+#define AQL_PARAMETER_VALUE		0
+#define AQL_PARAMETER_OPERAND		1
+
+struct aql_parameter {
+  uint8_t type;
+  uint8_t index;
+};
+typedef struct aql_parameter aql_parameter_t;
+#endif /* DB_FEATURE_PREPARED */
+
 struct aql_adt {
   char relations[AQL_RELATION_LIMIT][RELATION_NAME_LENGTH + 1];
   aql_attribute_t attributes[AQL_ATTRIBUTE_LIMIT];
@@ -156,6 +173,11 @@ struct aql_adt {
   uint8_t value_count;
   uint8_t optype;
   uint8_t flags;
+  uint8_t group_attribute;
+#if DB_FEATURE_PREPARED
+  uint8_t parameter_count;
+  aql_parameter_t parameters[AQL_PARAMETER_LIMIT];
+#endif /* DB_FEATURE_PREPARED */
   void *lvm_instance;
 };
 typedef struct aql_adt aql_adt_t;
@@ -179,6 +201,7 @@ typedef struct aql_adt aql_adt_t;
 #define AQL_FLAG_AGGREGATE		1
 #define AQL_FLAG_ASSIGN			2
 #define AQL_FLAG_INVERSE_LOGIC		4
+#define AQL_FLAG_GROUP			8
 
 #define AQL_CLEAR(adt)			aql_clear(adt)
 #define AQL_SET_TYPE(adt, type)	(((adt))->optype = (type))
@@ -200,10 +223,17 @@ typedef struct aql_adt aql_adt_t;
     (adt)->aggregators[(adt)->attribute_count] = (function);		\
     aql_add_attribute((adt), (attr), DOMAIN_UNSPECIFIED, 0, 0);	\
   } while(0)  
+#define AQL_SET_GROUP(adt, attr_id)					\
+  do {									\
+    (adt)->group_attribute = (attr_id);				\
+    AQL_SET_FLAG((adt), AQL_FLAG_GROUP);				\
+  } while(0)
 #define AQL_ATTRIBUTE_COUNT(adt)	((adt)->attribute_count)
 #define AQL_SET_CONDITION(adt, cond)	((adt)->lvm_instance = (cond))
 #define AQL_ADD_VALUE(adt, domain, value)				\
     aql_add_value((adt), (domain), (value))
+#define AQL_ADD_PARAMETER(adt, type)					\
+    aql_add_parameter((adt), (type))
 
 int lexer_start(lexer_t *, char *, token_t *, value_t *);
 int lexer_next(lexer_t *);
@@ -218,4 +248,17 @@ db_result_t aql_add_value(aql_adt_t *adt, domain_t domain, void *value);
 db_result_t db_query(db_handle_t *handle, const char *format, ...);
 db_result_t db_process(db_handle_t *handle);
 
+#if DB_FEATURE_PREPARED
+typedef struct db_statement db_statement_t;
+
+db_result_t aql_add_parameter(aql_adt_t *adt, uint8_t type);
+db_statement_t *db_prepare(const char *query);
+db_result_t db_bind_int(db_statement_t *statement, unsigned index,
+                        long value);
+db_result_t db_bind_string(db_statement_t *statement, unsigned index,
+                           const char *value);
+db_result_t db_execute(db_handle_t *handle, db_statement_t *statement);
+void db_finalize(db_statement_t *statement);
+#endif /* DB_FEATURE_PREPARED */
+
 #endif /* !AQL_H */
@@ -69,6 +69,12 @@
 #define DB_FEATURE_INTEGRITY		0
 #endif /* DB_FEATURE_INTEGRITY */
 
+/* Support prepared statements with '?' parameters, which are parsed
+   once and kept in a cache for repeated execution. */
+#ifndef DB_FEATURE_PREPARED
+#define DB_FEATURE_PREPARED		0
+#endif /* DB_FEATURE_PREPARED */
+
 /*----------------------------------------------------------------------------*/
 
 /* Configuration parameters that may be trimmed to save space. */
@@ -93,6 +99,15 @@
 #define DB_ATTRIBUTE_POOL_SIZE		16
 #endif /* DB_ATTRIBUTE_POOL_SIZE */
 
+/* The maximum number of bytes of relation and attribute metadata to
+   keep cached for relations that are not in use. Relations are evicted
+   in least recently used order when the pools above run out, or when
+   the cache exceeds this budget. Zero means that only the pool sizes
+   limit the cache. */
+#ifndef DB_RELATION_CACHE_BUDGET
+#define DB_RELATION_CACHE_BUDGET	0
+#endif /* DB_RELATION_CACHE_BUDGET */
+
 /* The maximum number of attributes in a relation. */
 #ifndef DB_MAX_ATTRIBUTES_PER_RELATION
 #define DB_MAX_ATTRIBUTES_PER_RELATION	6
@@ -103,6 +118,12 @@
 #define DB_MAX_ELEMENT_SIZE		16
 #endif /* DB_MAX_ELEMENT_SIZE */
 
+/* The size of the buffers used for reading and writing blocks of rows.
+   Rows that do not fit are accessed directly in the storage. */
+#ifndef DB_ROW_BUFFER_SIZE
+#define DB_ROW_BUFFER_SIZE		128
+#endif /* DB_ROW_BUFFER_SIZE */
+
 
 /* The maximum size of the LVM bytecode compiled from a
    single database query. */
@@ -110,6 +131,12 @@
 #define DB_VM_BYTECODE_SIZE		128
 #endif /* DB_VM_BYTECODE_SIZE */
 
+/* The maximum number of prepared statements kept in memory. Each one
+   holds the query text, its parsed form, and its LVM bytecode. */
+#ifndef DB_STATEMENT_POOL_SIZE
+#define DB_STATEMENT_POOL_SIZE		2
+#endif /* DB_STATEMENT_POOL_SIZE */
+
 /*----------------------------------------------------------------------------*/
 
 /* Language options. */
@@ -133,6 +160,17 @@
 #define AQL_ATTRIBUTE_LIMIT    		5
 #endif /* AQL_ATTRIBUTE_LIMIT */
 
+/* The maximum number of parameters in a prepared statement. */
+#ifndef AQL_PARAMETER_LIMIT
+#define AQL_PARAMETER_LIMIT    		4
+#endif /* AQL_PARAMETER_LIMIT */
+
+/* The maximum number of groups in an aggregating query. The aggregation
+   state of each group is kept in RAM while scanning the relation. */
+#ifndef AQL_GROUP_LIMIT
+#define AQL_GROUP_LIMIT    		8
+#endif /* AQL_GROUP_LIMIT */
+
 /*----------------------------------------------------------------------------*/
 
 /*
@@ -206,6 +244,21 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BTREE_INDEX_LIMIT
+#define DB_BTREE_INDEX_LIMIT		1
+#endif /* DB_BTREE_INDEX_LIMIT */
+
+/* The number of nodes reserved in the file of a B+-tree index. */
+#ifndef DB_BTREE_NODE_LIMIT
+#define DB_BTREE_NODE_LIMIT		1024
+#endif /* DB_BTREE_NODE_LIMIT */
+
+/* The maximum number of nodes cached in the B+-tree index. */
+#ifndef DB_BTREE_CACHE_LIMIT
+#define DB_BTREE_CACHE_LIMIT		2
+#endif /* DB_BTREE_CACHE_LIMIT */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
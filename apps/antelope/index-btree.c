@@ -0,0 +1,689 @@
+/*
+ * Copyright (c) 2010, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/**
+ * \file
+ *     A B+-tree index for flash memory.
+ *
+ *     The nodes of the tree are stored in a single file, and each entry
+ *     of a node is written only once. New entries are appended to the
+ *     free slots of a node, so the entries are unsorted within a node.
+ *     When a node fills up, its entries are copied into two new nodes,
+ *     and the parent is given entries that point to the new nodes. An
+ *     entry that is appended to a parent overrides any older entry with
+ *     the same separator, so the old node becomes unreachable.
+ *
+ *     Since the leaves are sorted in relation to each other, a range
+ *     query descends to the leaf of the smallest key in the range, and
+ *     continues with the next leaf until the largest key is found.
+ *     Duplicate keys are handled by ordering the leaf entries by the
+ *     tuple ID after the key.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#define NODE_ENTRIES	16
+#define ROOT_LOG_SIZE	64
+#define MAX_HEIGHT	8
+
+#define NODE_OFFSET(id) (sizeof(struct root_record) * ROOT_LOG_SIZE + \
+                         (unsigned long)((id) - 1) * sizeof(btree_node_t))
+#define ENTRY_OFFSET(id, slot) (NODE_OFFSET(id) + \
+                                (unsigned long)(slot) * sizeof(btree_entry_t))
+
+/* Leaf entries have a non-zero value, and internal entries a child. */
+#define EMPTY_ENTRY(entry)	((entry)->value == 0 && (entry)->child == 0)
+
+/*
+ * The key of an entry is compared first, and then its value, which is
+ * the tuple ID plus one. In an internal node, the key and value of an
+ * entry are the smallest ones that may be found in its child.
+ */
+struct btree_entry {
+  int32_t key;
+  uint32_t value;
+  uint16_t child;
+};
+typedef struct btree_entry btree_entry_t;
+
+struct btree_node {
+  btree_entry_t entries[NODE_ENTRIES];
+};
+typedef struct btree_node btree_node_t;
+
+/* The root of the tree is found in the last record of the root log. */
+struct root_record {
+  uint16_t node;
+  uint8_t height;
+  uint8_t valid;
+};
+
+struct btree {
+  db_storage_id_t storage;
+  uint16_t root;
+  uint16_t next_node;
+  uint8_t height;
+  uint8_t root_records;
+};
+typedef struct btree btree_t;
+
+struct node_cache {
+  btree_t *tree;
+  uint16_t node_id;
+  uint8_t count;
+  btree_node_t node;
+};
+
+/* The position of a node in the path from the root to a leaf. */
+struct path_step {
+  uint16_t node_id;
+  btree_entry_t low;
+};
+
+static struct node_cache node_cache[DB_BTREE_CACHE_LIMIT];
+static uint8_t next_cache;
+MEMB(btrees, btree_t, DB_BTREE_INDEX_LIMIT);
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+index_api_t index_btree = {
+  INDEX_BTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+static int
+compare_entries(const btree_entry_t *a, const btree_entry_t *b)
+{
+  if(a->key != b->key) {
+    return a->key < b->key ? -1 : 1;
+  }
+  if(a->value != b->value) {
+    return a->value < b->value ? -1 : 1;
+  }
+  return 0;
+}
+
+static int
+sort_compare(const void *a, const void *b)
+{
+  return compare_entries(a, b);
+}
+
+static void
+invalidate_cache(btree_t *tree)
+{
+  int i;
+
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree) {
+      node_cache[i].tree = NULL;
+    }
+  }
+}
+
+static struct node_cache *
+node_load(btree_t *tree, uint16_t node_id)
+{
+  struct node_cache *cache;
+  int i;
+
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree && node_cache[i].node_id == node_id) {
+      return &node_cache[i];
+    }
+  }
+
+  cache = &node_cache[next_cache];
+  next_cache = (next_cache + 1) % DB_BTREE_CACHE_LIMIT;
+  cache->tree = NULL;
+
+  if(DB_ERROR(storage_read(tree->storage, &cache->node,
+                           NODE_OFFSET(node_id), sizeof(cache->node)))) {
+    PRINTF("DB: Failed to read B+-tree node %u\n", (unsigned)node_id);
+    return NULL;
+  }
+
+  for(i = 0; i < NODE_ENTRIES; i++) {
+    if(EMPTY_ENTRY(&cache->node.entries[i])) {
+      break;
+    }
+  }
+
+  cache->tree = tree;
+  cache->node_id = node_id;
+  cache->count = i;
+
+  return cache;
+}
+
+static int
+node_append(btree_t *tree, uint16_t node_id, btree_entry_t *entry)
+{
+  struct node_cache *cache;
+
+  cache = node_load(tree, node_id);
+  if(cache == NULL || cache->count >= NODE_ENTRIES) {
+    return 0;
+  }
+
+  if(DB_ERROR(storage_write(tree->storage, entry,
+                            ENTRY_OFFSET(node_id, cache->count),
+                            sizeof(*entry)))) {
+    return 0;
+  }
+
+  cache->node.entries[cache->count++] = *entry;
+  return 1;
+}
+
+/* Writes a sorted array of entries into a newly allocated node. */
+static int
+node_create(btree_t *tree, btree_entry_t *entries, int count)
+{
+  uint16_t node_id;
+
+  if(tree->next_node > DB_BTREE_NODE_LIMIT) {
+    PRINTF("DB: No more B+-tree nodes available\n");
+    return 0;
+  }
+  node_id = tree->next_node;
+
+  if(DB_ERROR(storage_write(tree->storage, entries, NODE_OFFSET(node_id),
+                            count * sizeof(btree_entry_t)))) {
+    return 0;
+  }
+
+  tree->next_node++;
+  return node_id;
+}
+
+static int
+set_root(btree_t *tree, uint16_t node_id, uint8_t height)
+{
+  struct root_record record;
+
+  if(tree->root_records >= ROOT_LOG_SIZE) {
+    PRINTF("DB: The B+-tree root log is full\n");
+    return 0;
+  }
+
+  record.node = node_id;
+  record.height = height;
+  record.valid = 1;
+  if(DB_ERROR(storage_write(tree->storage, &record,
+                            (unsigned long)tree->root_records * sizeof(record),
+                            sizeof(record)))) {
+    return 0;
+  }
+
+  tree->root_records++;
+  tree->root = node_id;
+  tree->height = height;
+  return 1;
+}
+
+/*
+ * Selects the child to follow in an internal node. The newest entry
+ * wins if several entries have the same separator. The high bound is
+ * lowered to the next separator, if there is one.
+ */
+static btree_entry_t *
+find_child(struct node_cache *cache, btree_entry_t *target,
+           btree_entry_t *high, uint8_t *has_high)
+{
+  btree_entry_t *entry;
+  btree_entry_t *chosen;
+  int i;
+
+  chosen = NULL;
+  for(i = 0; i < cache->count; i++) {
+    entry = &cache->node.entries[i];
+    if(compare_entries(entry, target) <= 0) {
+      if(chosen == NULL || compare_entries(entry, chosen) >= 0) {
+        chosen = entry;
+      }
+    } else if(!*has_high || compare_entries(entry, high) < 0) {
+      *high = *entry;
+      *has_high = 1;
+    }
+  }
+
+  return chosen;
+}
+
+/* Descends to the leaf that may contain the target entry. */
+static int
+descend(btree_t *tree, btree_entry_t *target, struct path_step *path,
+        btree_entry_t *high, uint8_t *has_high)
+{
+  struct node_cache *cache;
+  btree_entry_t *entry;
+  uint16_t node_id;
+  int level;
+
+  node_id = tree->root;
+  path[0].node_id = node_id;
+  path[0].low.key = INT32_MIN;
+  path[0].low.value = 0;
+  *has_high = 0;
+
+  for(level = 0; level + 1 < tree->height; level++) {
+    cache = node_load(tree, node_id);
+    if(cache == NULL) {
+      return 0;
+    }
+    entry = find_child(cache, target, high, has_high);
+    if(entry == NULL) {
+      PRINTF("DB: No B+-tree child found in node %u\n", (unsigned)node_id);
+      return 0;
+    }
+    node_id = entry->child;
+    path[level + 1].node_id = node_id;
+    path[level + 1].low = *entry;
+  }
+
+  return 1;
+}
+
+/*
+ * Collects the entries of a node that are still in use. Older entries
+ * of an internal node are dropped if a newer one has the same separator.
+ */
+static int
+collect_entries(struct node_cache *cache, btree_entry_t *entries)
+{
+  int i, j, count;
+
+  for(i = count = 0; i < cache->count; i++) {
+    for(j = i + 1; j < cache->count; j++) {
+      if(compare_entries(&cache->node.entries[i],
+                         &cache->node.entries[j]) == 0) {
+        break;
+      }
+    }
+    if(j == cache->count) {
+      entries[count++] = cache->node.entries[i];
+    }
+  }
+
+  return count;
+}
+
+/*
+ * Adds the given entries to the node at the given level of the path.
+ * If they do not fit, the node is replaced by one or two new nodes,
+ * and the parent is updated in turn.
+ */
+static int
+update_node(btree_t *tree, struct path_step *path, int level,
+            btree_entry_t *new_entries, int new_count)
+{
+  static btree_entry_t entries[NODE_ENTRIES + 2];
+  struct node_cache *cache;
+  btree_entry_t parent_entries[2];
+  int count, parent_count;
+  int split;
+  int first;
+  int i, j;
+  uint16_t node_id;
+
+  cache = node_load(tree, path[level].node_id);
+  if(cache == NULL) {
+    return 0;
+  }
+
+  if(cache->count + new_count <= NODE_ENTRIES) {
+    for(i = 0; i < new_count; i++) {
+      if(node_append(tree, path[level].node_id, &new_entries[i]) == 0) {
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  count = collect_entries(cache, entries);
+  for(i = 0; i < new_count; i++) {
+    for(j = 0; j < count; j++) {
+      if(compare_entries(&entries[j], &new_entries[i]) == 0) {
+        break;
+      }
+    }
+    entries[j] = new_entries[i];
+    if(j == count) {
+      count++;
+    }
+  }
+  qsort(entries, count, sizeof(entries[0]), sort_compare);
+
+  /* Leave room for the two entries that a split child adds. */
+  split = count + 2 > NODE_ENTRIES;
+  first = split ? count / 2 : count;
+
+  node_id = node_create(tree, entries, first);
+  if(node_id == 0) {
+    return 0;
+  }
+  parent_entries[0] = path[level].low;
+  parent_entries[0].child = node_id;
+  parent_count = 1;
+
+  if(split) {
+    node_id = node_create(tree, entries + first, count - first);
+    if(node_id == 0) {
+      return 0;
+    }
+    parent_entries[1] = entries[first];
+    parent_entries[1].child = node_id;
+    parent_count = 2;
+  }
+
+  PRINTF("DB: Replaced B+-tree node %u with %d node(s)\n",
+         (unsigned)path[level].node_id, parent_count);
+
+  if(level > 0) {
+    return update_node(tree, path, level - 1, parent_entries, parent_count);
+  }
+
+  /* The root was replaced. */
+  if(parent_count == 1) {
+    return set_root(tree, parent_entries[0].child, tree->height);
+  }
+
+  parent_entries[0].key = INT32_MIN;
+  parent_entries[0].value = 0;
+  node_id = node_create(tree, parent_entries, 2);
+  if(node_id == 0) {
+    return 0;
+  }
+  return set_root(tree, node_id, tree->height + 1);
+}
+
+static db_result_t
+create(index_t *index)
+{
+  char *filename;
+  btree_t *tree;
+
+  filename = storage_generate_file("btree",
+                                   NODE_OFFSET(DB_BTREE_NODE_LIMIT + 1));
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  index->opaque_data = tree = memb_alloc(&btrees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  tree->root_records = 0;
+  tree->next_node = 2;
+
+  /* The tree starts with an empty leaf as the root. */
+  if(tree->storage < 0 || set_root(tree, 1, 1) == 0) {
+    storage_close(tree->storage);
+    memb_free(&btrees, tree);
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Created a B+-tree index in \"%s\"\n", index->descriptor_file);
+
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  /* The index has already been released at this point. */
+  cfs_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  struct root_record record;
+  btree_entry_t entry;
+  btree_t *tree;
+  uint16_t low, high, middle;
+
+  index->opaque_data = tree = memb_alloc(&btrees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0) {
+    memb_free(&btrees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  /* The current root is found in the last record of the root log. */
+  for(tree->root_records = 0;
+      tree->root_records < ROOT_LOG_SIZE;
+      tree->root_records++) {
+    if(DB_ERROR(storage_read(tree->storage, &record,
+                             (unsigned long)tree->root_records * sizeof(record),
+                             sizeof(record))) || !record.valid) {
+      break;
+    }
+    tree->root = record.node;
+    tree->height = record.height;
+  }
+
+  if(tree->root_records == 0) {
+    storage_close(tree->storage);
+    memb_free(&btrees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  /*
+   * Nodes are allocated in order, and all nodes except an empty root
+   * leaf have a first entry. Hence, the first free node can be found
+   * by using binary search.
+   */
+  low = tree->root + 1;
+  high = DB_BTREE_NODE_LIMIT + 1;
+  while(low < high) {
+    middle = low + (high - low) / 2;
+    if(DB_ERROR(storage_read(tree->storage, &entry, NODE_OFFSET(middle),
+                             sizeof(entry))) || EMPTY_ENTRY(&entry)) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  tree->next_node = low;
+
+  PRINTF("DB: Loaded a B+-tree index from file %s; the root is node %u\n",
+         index->descriptor_file, (unsigned)tree->root);
+
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  btree_t *tree;
+
+  tree = index->opaque_data;
+
+  invalidate_cache(tree);
+  storage_close(tree->storage);
+  memb_free(&btrees, tree);
+  return DB_OK;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *key, tuple_id_t value)
+{
+  struct path_step path[MAX_HEIGHT];
+  btree_entry_t entry;
+  btree_entry_t high;
+  uint8_t has_high;
+  btree_t *tree;
+
+  tree = (btree_t *)index->opaque_data;
+
+  if(tree->height >= MAX_HEIGHT) {
+    PRINTF("DB: The B+-tree is too high\n");
+    return DB_INDEX_ERROR;
+  }
+
+  entry.key = (int32_t)db_value_to_long(key);
+  entry.value = value + 1;
+  entry.child = 0;
+
+  if(descend(tree, &entry, path, &high, &has_high) == 0 ||
+     update_node(tree, path, tree->height - 1, &entry, 1) == 0) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n",
+           (long)entry.key);
+    return DB_INDEX_ERROR;
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  return DB_INDEX_ERROR;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  struct iteration_cache {
+    index_iterator_t *index_iterator;
+    btree_entry_t target;
+    btree_entry_t high;
+    uint16_t leaf;
+    uint8_t has_high;
+  };
+  static struct iteration_cache cache;
+  struct path_step path[MAX_HEIGHT];
+  struct node_cache *leaf;
+  btree_entry_t *entry;
+  btree_entry_t *found;
+  btree_t *tree;
+  int32_t max;
+  int i;
+
+  tree = (btree_t *)iterator->index->opaque_data;
+  max = (int32_t)db_value_to_long(&iterator->max_value);
+
+  if(cache.index_iterator != iterator || iterator->next_item_no == 0) {
+    /* Initialize the cache for a new search. */
+    cache.index_iterator = iterator;
+    cache.target.key = (int32_t)db_value_to_long(&iterator->min_value);
+    cache.target.value = 0;
+    cache.leaf = 0;
+  }
+
+  for(;;) {
+    if(cache.leaf == 0) {
+      if(descend(tree, &cache.target, path, &cache.high,
+                 &cache.has_high) == 0) {
+        return INVALID_TUPLE;
+      }
+      cache.leaf = path[tree->height - 1].node_id;
+    }
+
+    leaf = node_load(tree, cache.leaf);
+    if(leaf == NULL) {
+      return INVALID_TUPLE;
+    }
+
+    /* Find the smallest entry that has not been returned yet. */
+    found = NULL;
+    for(i = 0; i < leaf->count; i++) {
+      entry = &leaf->node.entries[i];
+      if(compare_entries(entry, &cache.target) >= 0 &&
+         (found == NULL || compare_entries(entry, found) < 0)) {
+        found = entry;
+      }
+    }
+
+    if(found != NULL) {
+      if(found->key > max) {
+        return INVALID_TUPLE;
+      }
+      cache.target = *found;
+      cache.target.value++;
+      iterator->next_item_no++;
+      PRINTF("DB: Found key %ld with value %lu\n", (long)found->key,
+             (unsigned long)found->value - 1);
+      return (tuple_id_t)found->value - 1;
+    }
+
+    /* Continue with the next leaf. */
+    if(!cache.has_high || cache.high.key > max) {
+      return INVALID_TUPLE;
+    }
+    cache.target = cache.high;
+    cache.leaf = 0;
+  }
+}
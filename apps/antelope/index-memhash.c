@@ -40,6 +40,7 @@
 
 #include "db-options.h"
 #include "index.h"
+#include "result.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -54,7 +55,7 @@ static tuple_id_t get_next(index_iterator_t *);
 
 index_api_t index_memhash = {
   INDEX_MEMHASH,
-  INDEX_API_INTERNAL,
+  INDEX_API_INTERNAL | INDEX_API_RANGE_QUERIES,
   create,
   destroy,
   load,
@@ -64,9 +65,13 @@ index_api_t index_memhash = {
   get_next
 };
 
+/* Free slots end a probe sequence, whereas deleted slots do not. */
+#define SLOT_FREE	INVALID_TUPLE
+#define SLOT_DELETED	(INVALID_TUPLE - 1)
+
 struct hash_item {
   tuple_id_t tuple_id;
-  attribute_value_t value;
+  long key;
 };
 typedef struct hash_item hash_item_t;
 
@@ -74,28 +79,22 @@ typedef hash_item_t hash_map_t[DB_MEMHASH_TABLE_SIZE];
 
 MEMB(hash_map_memb, hash_map_t, DB_MEMHASH_INDEX_LIMIT);
 
+static struct {
+  index_iterator_t *index_iterator;
+  unsigned probes;
+} cache;
+
 static unsigned
-calculate_hash(attribute_value_t *value)
+calculate_hash(long key)
 {
-  unsigned char *cp, *end;
-  unsigned hash_value;
-
-  cp = (unsigned char *)value;
-  end = cp + sizeof(*value);
-  hash_value = 0;
-
-  while(cp < end) {
-    hash_value = hash_value * 33 + *cp++;
-  }
-
-  return hash_value % DB_MEMHASH_TABLE_SIZE;
+  return (unsigned long)key % DB_MEMHASH_TABLE_SIZE;
 }
 
 static db_result_t
 create(index_t *index)
 {
   int i;
-  hash_map_t *hash_map;
+  hash_item_t *hash_map;
 
   PRINTF("Creating a memory-resident hash map index\n");
 
@@ -105,7 +104,7 @@ create(index_t *index)
   }
 
   for(i = 0; i < DB_MEMHASH_TABLE_SIZE; i++) {
-    hash_map[i]->tuple_id = INVALID_TUPLE;
+    hash_map[i].tuple_id = SLOT_FREE;
   }
 
   index->opaque_data = hash_map;
@@ -136,59 +135,96 @@ release(index_t *index)
 static db_result_t
 insert(index_t *index, attribute_value_t *value, tuple_id_t tuple_id)
 {
-  hash_map_t *hash_map;
-  uint16_t hash_value;
+  hash_item_t *hash_map;
+  hash_item_t *item;
+  unsigned hash_value;
+  unsigned i;
+  long key;
 
   hash_map = index->opaque_data;
+  key = db_value_to_long(value);
+  hash_value = calculate_hash(key);
 
-  hash_value = calculate_hash(value);
-  hash_map[hash_value]->tuple_id = tuple_id;
-  hash_map[hash_value]->value = *value;
-
-  PRINTF("DB: Inserted value %ld into the hash table\n", VALUE_LONG(value));
+  /* Resolve collisions by linear probing. */
+  for(i = 0; i < DB_MEMHASH_TABLE_SIZE; i++) {
+    item = &hash_map[(hash_value + i) % DB_MEMHASH_TABLE_SIZE];
+    if(item->tuple_id == SLOT_FREE || item->tuple_id == SLOT_DELETED) {
+      item->tuple_id = tuple_id;
+      item->key = key;
+      PRINTF("DB: Inserted value %ld into the hash table\n", key);
+      return DB_OK;
+    }
+  }
 
-  return DB_OK;
+  PRINTF("DB: The hash table is full\n");
+  return DB_LIMIT_ERROR;
 }
 
 static db_result_t
 delete(index_t *index, attribute_value_t *value)
 {
-  hash_map_t *hash_map;
-  uint16_t hash_value;
+  hash_item_t *hash_map;
+  hash_item_t *item;
+  unsigned hash_value;
+  unsigned i;
+  long key;
 
   hash_map = index->opaque_data;
+  key = db_value_to_long(value);
+  hash_value = calculate_hash(key);
 
-  hash_value = calculate_hash(value);
-  if(memcmp(&hash_map[hash_value]->value, value, sizeof(*value)) != 0) {
-    return DB_INDEX_ERROR;
+  for(i = 0; i < DB_MEMHASH_TABLE_SIZE; i++) {
+    item = &hash_map[(hash_value + i) % DB_MEMHASH_TABLE_SIZE];
+    if(item->tuple_id == SLOT_FREE) {
+      break;
+    }
+    if(item->tuple_id != SLOT_DELETED && item->key == key) {
+      item->tuple_id = SLOT_DELETED;
+      return DB_OK;
+    }
   }
 
-  hash_map[hash_value]->tuple_id = INVALID_TUPLE;
-  return DB_OK;
+  return DB_INDEX_ERROR;
 }
 
 static tuple_id_t
 get_next(index_iterator_t *iterator)
 {
-  hash_map_t *hash_map;
-  uint16_t hash_value;
-
-  if(iterator->next_item_no == 1) {
-    /* The memhash supports only unique values at the moment. */
-    return INVALID_TUPLE;
-  }
+  hash_item_t *hash_map;
+  hash_item_t *item;
+  unsigned hash_value;
+  long min;
+  long max;
 
   hash_map = iterator->index->opaque_data;
+  min = db_value_to_long(&iterator->min_value);
+  max = db_value_to_long(&iterator->max_value);
 
-  hash_value = calculate_hash(&iterator->min_value);
-  if(memcmp(&hash_map[hash_value]->value, &iterator->min_value, sizeof(iterator->min_value)) != 0) {
-    return INVALID_TUPLE;
+  if(cache.index_iterator != iterator || iterator->next_item_no == 0) {
+    cache.index_iterator = iterator;
+    cache.probes = 0;
   }
 
-  iterator->next_item_no++;
-
-  PRINTF("DB: Found value %ld in the hash table\n", 
-	VALUE_LONG(&iterator->min_value));
+  /*
+   * An equality search follows the probe sequence of the key, whereas
+   * a range search inspects every slot of the table.
+   */
+  hash_value = min == max ? calculate_hash(min) : 0;
+
+  while(cache.probes < DB_MEMHASH_TABLE_SIZE) {
+    item = &hash_map[(hash_value + cache.probes++) % DB_MEMHASH_TABLE_SIZE];
+    if(item->tuple_id == SLOT_FREE) {
+      if(min == max) {
+        break;
+      }
+    } else if(item->tuple_id != SLOT_DELETED &&
+              item->key >= min && item->key <= max) {
+      iterator->next_item_no++;
+      PRINTF("DB: Found value %ld in the hash table\n", item->key);
+      return item->tuple_id;
+    }
+  }
 
-  return hash_map[hash_value]->tuple_id;
+  cache.probes = DB_MEMHASH_TABLE_SIZE;
+  return INVALID_TUPLE;
 }
@@ -64,6 +64,14 @@
 #define LVM_USE_FLOATS			0
 #endif
 
+#ifndef LVM_MAX_PROGRAM_LENGTH
+#define LVM_MAX_PROGRAM_LENGTH		32
+#endif
+
+#ifndef LVM_MAX_STACK_DEPTH
+#define LVM_MAX_STACK_DEPTH		8
+#endif
+
 #define IS_CONNECTIVE(op) ((op) & LVM_CONNECTIVE)
 
 struct variable {
@@ -80,12 +88,47 @@ struct derivation {
 };
 typedef struct derivation derivation_t;
 
+/*
+ * The instructions of a prepared predicate, which operate on a stack
+ * of long values in postfix order. Comparisons between a variable and
+ * a constant, which are the most common in queries, take a single
+ * instruction.
+ */
+enum opcode {
+  OP_PUSH_CONSTANT,
+  OP_PUSH_VARIABLE,
+  OP_ARITH,
+  OP_CMP,
+  OP_CMP_VARIABLE_CONSTANT,
+  OP_AND,
+  OP_OR,
+  OP_NOT
+};
+
+struct instruction {
+  uint8_t opcode;
+  uint8_t op;
+  variable_id_t id;
+  long value;
+};
+
+struct program {
+  lvm_instance_t *instance;
+  uint8_t length;
+  uint8_t depth;
+  uint8_t max_depth;
+  struct instruction code[LVM_MAX_PROGRAM_LENGTH];
+};
+
 /* Registered variables for a LVM expression. Their values may be 
    changed between executions of the expression. */
-static variable_t variables[LVM_MAX_VARIABLE_ID - 1];
+static variable_t variables[LVM_MAX_VARIABLE_ID];
 
 /* Range derivations of variables that are used for index searches. */
-static derivation_t derivations[LVM_MAX_VARIABLE_ID - 1];
+static derivation_t derivations[LVM_MAX_VARIABLE_ID];
+
+/* The prepared form of the code of a single LVM instance. */
+static struct program program;
 
 #if DEBUG
 static void
@@ -107,7 +150,7 @@ lookup(char *name)
 {
   variable_t *var;
 
-  for(var = variables; var <= &variables[LVM_MAX_VARIABLE_ID - 1] && var->name[0] != '\0'; var++) {
+  for(var = variables; var < &variables[LVM_MAX_VARIABLE_ID] && var->name[0] != '\0'; var++) {
     if(strcmp(var->name, name) == 0) {
       break;
     }
@@ -297,6 +340,311 @@ eval_logic(lvm_instance_t *p, operator_t *op)
   return EXECUTION_ERROR;
 }
 
+static lvm_status_t
+emit(uint8_t opcode, uint8_t op, variable_id_t id, long value, int effect)
+{
+  struct instruction *instruction;
+
+  if(program.length == LVM_MAX_PROGRAM_LENGTH ||
+     program.depth + effect > LVM_MAX_STACK_DEPTH) {
+    return STACK_OVERFLOW;
+  }
+
+  instruction = &program.code[program.length++];
+  instruction->opcode = opcode;
+  instruction->op = op;
+  instruction->id = id;
+  instruction->value = value;
+
+  program.depth += effect;
+  if(program.depth > program.max_depth) {
+    program.max_depth = program.depth;
+  }
+
+  return TRUE;
+}
+
+static lvm_status_t
+compile_operand(operand_t *operand)
+{
+  if(operand->type == LVM_VARIABLE) {
+    if(operand->value.id >= LVM_MAX_VARIABLE_ID) {
+      return INVALID_IDENTIFIER;
+    }
+    return emit(OP_PUSH_VARIABLE, 0, operand->value.id, 0, 1);
+  }
+  return emit(OP_PUSH_CONSTANT, 0, 0, operand_to_long(operand), 1);
+}
+
+static lvm_status_t compile_expr(lvm_instance_t *p, operator_t op);
+
+/* Compiles an argument of an arithmetic or relational operator. */
+static lvm_status_t
+compile_argument(lvm_instance_t *p, operand_t *operand, int *is_operand)
+{
+  operator_t *operator;
+
+  *is_operand = 0;
+  switch(get_type(p)) {
+  case LVM_ARITH_OP:
+    operator = get_operator(p);
+    return compile_expr(p, *operator);
+  case LVM_OPERAND:
+    get_operand(p, operand);
+    *is_operand = 1;
+    return TRUE;
+  default:
+    return SEMANTIC_ERROR;
+  }
+}
+
+static lvm_status_t
+compile_expr(lvm_instance_t *p, operator_t op)
+{
+  operand_t operand;
+  lvm_status_t r;
+  int is_operand;
+  int i;
+
+  if(op < LVM_ADD || op > LVM_DIV) {
+    return EXECUTION_ERROR;
+  }
+
+  for(i = 0; i < 2; i++) {
+    r = compile_argument(p, &operand, &is_operand);
+    if(r == TRUE && is_operand) {
+      r = compile_operand(&operand);
+    }
+    if(LVM_ERROR(r)) {
+      return r;
+    }
+  }
+
+  return emit(OP_ARITH, op, 0, 0, -1);
+}
+
+static operator_t
+mirror_relation(operator_t op)
+{
+  switch(op) {
+  case LVM_GE:
+    return LVM_LE;
+  case LVM_GEQ:
+    return LVM_LEQ;
+  case LVM_LE:
+    return LVM_GE;
+  case LVM_LEQ:
+    return LVM_GEQ;
+  default:
+    return op;
+  }
+}
+
+static lvm_status_t
+compile_logic(lvm_instance_t *p, operator_t op)
+{
+  operand_t operand[2];
+  int is_operand[2];
+  lvm_status_t r;
+  operator_t *operator;
+  unsigned arguments;
+  int i;
+
+  if(IS_CONNECTIVE(op)) {
+    arguments = op == LVM_NOT ? 1 : 2;
+    for(i = 0; i < arguments; i++) {
+      if(get_type(p) != LVM_CMP_OP) {
+        return SEMANTIC_ERROR;
+      }
+      operator = get_operator(p);
+      r = compile_logic(p, *operator);
+      if(LVM_ERROR(r)) {
+        return r;
+      }
+    }
+
+    switch(op) {
+    case LVM_NOT:
+      return emit(OP_NOT, 0, 0, 0, 0);
+    case LVM_AND:
+      return emit(OP_AND, 0, 0, 0, -1);
+    default:
+      return emit(OP_OR, 0, 0, 0, -1);
+    }
+  }
+
+  if(op < LVM_EQ || op > LVM_LEQ) {
+    return EXECUTION_ERROR;
+  }
+
+  /*
+   * The first argument must be compiled before the second one is
+   * decoded, unless both of them turn out to be operands.
+   */
+  r = compile_argument(p, &operand[0], &is_operand[0]);
+  if(LVM_ERROR(r)) {
+    return r;
+  }
+  if(!is_operand[0]) {
+    r = compile_argument(p, &operand[1], &is_operand[1]);
+    if(r == TRUE && is_operand[1]) {
+      r = compile_operand(&operand[1]);
+    }
+    if(LVM_ERROR(r)) {
+      return r;
+    }
+    return emit(OP_CMP, op, 0, 0, -1);
+  }
+
+  r = compile_argument(p, &operand[1], &is_operand[1]);
+  if(LVM_ERROR(r)) {
+    return r;
+  }
+
+  if(is_operand[1]) {
+    if(operand[0].type == LVM_VARIABLE && operand[1].type != LVM_VARIABLE &&
+       operand[0].value.id < LVM_MAX_VARIABLE_ID) {
+      return emit(OP_CMP_VARIABLE_CONSTANT, op, operand[0].value.id,
+                  operand_to_long(&operand[1]), 1);
+    }
+    if(operand[1].type == LVM_VARIABLE && operand[0].type != LVM_VARIABLE &&
+       operand[1].value.id < LVM_MAX_VARIABLE_ID) {
+      return emit(OP_CMP_VARIABLE_CONSTANT, mirror_relation(op),
+                  operand[1].value.id, operand_to_long(&operand[0]), 1);
+    }
+    r = compile_operand(&operand[0]);
+    if(r == TRUE) {
+      r = compile_operand(&operand[1]);
+    }
+    if(LVM_ERROR(r)) {
+      return r;
+    }
+    return emit(OP_CMP, op, 0, 0, -1);
+  }
+
+  /*
+   * The second argument has already been compiled into the program,
+   * so the first one is pushed afterwards and the relation is mirrored.
+   */
+  r = compile_operand(&operand[0]);
+  if(LVM_ERROR(r)) {
+    return r;
+  }
+  return emit(OP_CMP, mirror_relation(op), 0, 0, -1);
+}
+
+static int
+compare(uint8_t op, long l1, long l2)
+{
+  switch(op) {
+  case LVM_EQ:
+    return l1 == l2;
+  case LVM_NEQ:
+    return l1 != l2;
+  case LVM_GE:
+    return l1 > l2;
+  case LVM_GEQ:
+    return l1 >= l2;
+  case LVM_LE:
+    return l1 < l2;
+  default:
+    return l1 <= l2;
+  }
+}
+
+static lvm_status_t
+run_program(void)
+{
+  long stack[LVM_MAX_STACK_DEPTH];
+  struct instruction *instruction;
+  struct instruction *end;
+  long *top;
+  long value;
+
+  top = stack - 1;
+  end = &program.code[program.length];
+  for(instruction = program.code; instruction < end; instruction++) {
+    switch(instruction->opcode) {
+    case OP_PUSH_CONSTANT:
+      *++top = instruction->value;
+      break;
+    case OP_PUSH_VARIABLE:
+      *++top = variables[instruction->id].value.l;
+      break;
+    case OP_CMP_VARIABLE_CONSTANT:
+      *++top = compare(instruction->op, variables[instruction->id].value.l,
+                       instruction->value);
+      break;
+    case OP_CMP:
+      value = *top--;
+      *top = compare(instruction->op, *top, value);
+      break;
+    case OP_ARITH:
+      value = *top--;
+      switch(instruction->op) {
+      case LVM_ADD:
+        *top += value;
+        break;
+      case LVM_SUB:
+        *top -= value;
+        break;
+      case LVM_MUL:
+        *top *= value;
+        break;
+      default:
+        if(value == 0) {
+          return MATH_ERROR;
+        }
+        *top /= value;
+        break;
+      }
+      break;
+    case OP_AND:
+      value = *top--;
+      *top = *top && value;
+      break;
+    case OP_OR:
+      value = *top--;
+      *top = *top || value;
+      break;
+    case OP_NOT:
+      *top = !*top;
+      break;
+    }
+  }
+
+  return *top ? TRUE : FALSE;
+}
+
+lvm_status_t
+lvm_prepare(lvm_instance_t *p)
+{
+  operator_t *operator;
+  lvm_status_t status;
+
+  program.instance = NULL;
+  program.length = 0;
+  program.depth = 0;
+  program.max_depth = 0;
+
+  p->ip = 0;
+  if(get_type(p) != LVM_CMP_OP) {
+    return SEMANTIC_ERROR;
+  }
+  operator = get_operator(p);
+  status = compile_logic(p, *operator);
+  if(LVM_ERROR(status)) {
+    /* Leave the code to the interpreter, which reports the error. */
+    PRINTF("Failed to prepare the code: %d\n", (int)status);
+    return status;
+  }
+
+  PRINTF("Prepared %u instructions using a stack depth of %u\n",
+         program.length, program.max_depth);
+  program.instance = p;
+  return TRUE;
+}
+
 void
 lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
 {
@@ -307,8 +655,7 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
   p->ip = 0;
   p->error = 0;
 
-  memset(variables, 0, sizeof(variables));
-  memset(derivations, 0, sizeof(derivations));
+  lvm_clear_variables();
 }
 
 lvm_ip_t
@@ -383,6 +730,10 @@ lvm_execute(lvm_instance_t *p)
   operator_t *operator;
   lvm_status_t status;
 
+  if(program.instance == p) {
+    return run_program();
+  }
+
   p->ip = 0;
   status = EXECUTION_ERROR;
   type = get_type(p);
@@ -472,6 +823,24 @@ lvm_set_variable_value(char *name, operand_value_t value)
   return TRUE;
 }
 
+variable_id_t
+lvm_get_variable_id(char *name)
+{
+  variable_id_t id;
+
+  id = lookup(name);
+  if(id == LVM_MAX_VARIABLE_ID || variables[id].name[0] == '\0') {
+    return LVM_INVALID_VARIABLE;
+  }
+  return id;
+}
+
+void
+lvm_set_variable_value_by_id(variable_id_t id, operand_value_t value)
+{
+  variables[id].value = value;
+}
+
 void
 lvm_set_variable(lvm_instance_t *p, char *name)
 {
@@ -487,6 +856,80 @@ lvm_set_variable(lvm_instance_t *p, char *name)
   }
 }
 
+void
+lvm_set_parameter(lvm_instance_t *p, unsigned index)
+{
+  operand_t op;
+
+  op.type = LVM_PARAMETER;
+  op.value.l = index;
+
+  lvm_set_operand(p, &op);
+}
+
+lvm_status_t
+lvm_resolve_parameters(lvm_instance_t *p, lvm_ip_t *offsets, unsigned count)
+{
+  lvm_ip_t ip;
+  operand_t op;
+
+  /* Turn each parameter placeholder into a long constant, and record
+     where it is so that its value can be changed in place later. */
+  for(ip = 0; ip < p->end;) {
+    switch(*(node_type_t *)(p->code + ip)) {
+    case LVM_CMP_OP:
+    case LVM_ARITH_OP:
+      ip += sizeof(node_type_t) + sizeof(operator_t);
+      break;
+    case LVM_OPERAND:
+      ip += sizeof(node_type_t);
+      memcpy(&op, &p->code[ip], sizeof(op));
+      if(op.type == LVM_PARAMETER) {
+        if(op.value.l < 0 || (unsigned long)op.value.l >= count) {
+          return SEMANTIC_ERROR;
+        }
+        offsets[op.value.l] = ip;
+        op.type = LVM_LONG;
+        op.value.l = 0;
+        memcpy(&p->code[ip], &op, sizeof(op));
+      }
+      ip += sizeof(op);
+      break;
+    default:
+      return SEMANTIC_ERROR;
+    }
+  }
+
+  return TRUE;
+}
+
+void
+lvm_set_long_at(lvm_instance_t *p, lvm_ip_t offset, long l)
+{
+  operand_t op;
+
+  op.type = LVM_LONG;
+  op.value.l = l;
+  memcpy(&p->code[offset], &op, sizeof(op));
+}
+
+void
+lvm_clear_variables(void)
+{
+  memset(variables, 0, sizeof(variables));
+  memset(derivations, 0, sizeof(derivations));
+  program.instance = NULL;
+}
+
+const char *
+lvm_get_variable_name(variable_id_t id)
+{
+  if(id >= LVM_MAX_VARIABLE_ID || variables[id].name[0] == '\0') {
+    return NULL;
+  }
+  return variables[id].name;
+}
+
 void
 lvm_clone(lvm_instance_t *dst, lvm_instance_t *src)
 {
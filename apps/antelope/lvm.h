@@ -100,12 +100,15 @@ typedef enum operator operator_t;
 enum operand_type {
   LVM_VARIABLE,
   LVM_FLOAT,
-  LVM_LONG
+  LVM_LONG,
+  LVM_PARAMETER
 };
 typedef enum operand_type operand_type_t;
 
 typedef unsigned char variable_id_t;
 
+#define LVM_INVALID_VARIABLE	((variable_id_t)-1)
+
 typedef union {
   long l;
 #if LVM_USE_FLOATS
@@ -127,9 +130,12 @@ lvm_status_t lvm_get_derived_range(lvm_instance_t *p, char *name,
                                    operand_value_t *min,
                                    operand_value_t *max);
 void lvm_print_derivations(lvm_instance_t *p);
+lvm_status_t lvm_prepare(lvm_instance_t *p);
 lvm_status_t lvm_execute(lvm_instance_t *p);
 lvm_status_t lvm_register_variable(char *name, operand_type_t type);
 lvm_status_t lvm_set_variable_value(char *name, operand_value_t value);
+variable_id_t lvm_get_variable_id(char *name);
+void lvm_set_variable_value_by_id(variable_id_t id, operand_value_t value);
 void lvm_print_code(lvm_instance_t *p);
 lvm_ip_t lvm_jump_to_operand(lvm_instance_t *p);
 lvm_ip_t lvm_shift_for_operator(lvm_instance_t *p, lvm_ip_t end);
@@ -140,5 +146,11 @@ void lvm_set_relation(lvm_instance_t *p, operator_t op);
 void lvm_set_operand(lvm_instance_t *p, operand_t *op);
 void lvm_set_long(lvm_instance_t *p, long l);
 void lvm_set_variable(lvm_instance_t *p, char *name);
+void lvm_set_parameter(lvm_instance_t *p, unsigned index);
+lvm_status_t lvm_resolve_parameters(lvm_instance_t *p, lvm_ip_t *offsets,
+                                    unsigned count);
+void lvm_set_long_at(lvm_instance_t *p, lvm_ip_t offset, long l);
+void lvm_clear_variables(void);
+const char *lvm_get_variable_name(variable_id_t id);
 
 #endif /* LVM_H */
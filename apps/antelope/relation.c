@@ -64,10 +64,27 @@ struct source_dest_map {
   attribute_t *to_attr;
   unsigned from_offset;
   unsigned to_offset;
+  variable_id_t variable;
 };
 
 static struct source_dest_map attr_map[AQL_ATTRIBUTE_LIMIT];
 
+/*
+ * The aggregation_group structure holds the running state of the
+ * aggregators for one value of the grouping attribute. Queries without
+ * a GROUP BY clause use a single group. The aggregates are computed
+ * while scanning the relation, so no intermediate relation is needed.
+ */
+struct aggregation_group {
+  long key;
+  long count;
+  long values[AQL_ATTRIBUTE_LIMIT];
+};
+
+static struct aggregation_group groups[AQL_GROUP_LIMIT];
+static uint8_t group_count;
+static uint8_t next_group;
+
 #if DB_FEATURE_JOIN
 /*
  * The source_map structure is used for mapping attributes to
@@ -92,11 +109,16 @@ LIST(relations);
 MEMB(relations_memb, relation_t, DB_RELATION_POOL_SIZE);
 MEMB(attributes_memb, attribute_t, DB_ATTRIBUTE_POOL_SIZE);
 
+/* Advances each time a relation is used, so that the metadata of
+   the least recently used relation can be evicted first. */
+static uint16_t use_counter;
+
 static relation_t *relation_find(char *);
 static attribute_t *attribute_find(relation_t *, char *);
 static int get_attribute_value_offset(relation_t *, attribute_t *);
 static void attribute_free(relation_t *, attribute_t *);
-static void purge_relations(void);
+static int evict_relation(relation_t *);
+static void trim_relation_cache(void);
 static void relation_clear(relation_t *);
 static relation_t *relation_allocate(void);
 static void relation_free(relation_t *);
@@ -156,19 +178,54 @@ attribute_free(relation_t *rel, attribute_t *attr)
   rel->attribute_count--;
 }
 
-static void
-purge_relations(void)
+static int
+evict_relation(relation_t *keep)
 {
   relation_t *rel;
-  relation_t *next;
+  relation_t *victim;
 
-  for(rel = list_head(relations); rel != NULL;) {
-    next = rel->next;
-    if(rel->references == 0) {
-      relation_free(rel);
+  /* Relations that are not referenced stay loaded so that they can
+     be opened again without reading the catalog from the storage.
+     When memory is needed, evict the least recently used one. */
+  victim = NULL;
+  for(rel = list_head(relations); rel != NULL; rel = rel->next) {
+    if(rel->references == 0 && rel != keep &&
+       (victim == NULL ||
+        (uint16_t)(use_counter - rel->last_use) >
+        (uint16_t)(use_counter - victim->last_use))) {
+      victim = rel;
+    }
+  }
+
+  if(victim == NULL) {
+    return 0;
+  }
+
+  PRINTF("DB: Evicting the cached relation %s\n", victim->name);
+  relation_free(victim);
+  return 1;
+}
+
+static void
+trim_relation_cache(void)
+{
+#if DB_RELATION_CACHE_BUDGET
+  relation_t *rel;
+  size_t size;
+
+  for(;;) {
+    size = 0;
+    for(rel = list_head(relations); rel != NULL; rel = rel->next) {
+      if(rel->references == 0) {
+        size += sizeof(relation_t) +
+                rel->attribute_count * sizeof(attribute_t);
+      }
+    }
+    if(size <= DB_RELATION_CACHE_BUDGET || !evict_relation(NULL)) {
+      break;
     }
-    rel = next;
   }
+#endif /* DB_RELATION_CACHE_BUDGET */
 }
 
 static void
@@ -186,11 +243,8 @@ relation_allocate(void)
 {
   relation_t *rel;
 
-  rel = memb_alloc(&relations_memb);
-  if(rel == NULL) {
-    purge_relations();
-    rel = memb_alloc(&relations_memb);
-    if(rel == NULL) {
+  while((rel = memb_alloc(&relations_memb)) == NULL) {
+    if(!evict_relation(NULL)) {
       PRINTF("DB: Failed to allocate a relation\n");
       return NULL;
     }
@@ -231,6 +285,7 @@ relation_load(char *name)
   rel = relation_find(name);
   if(rel != NULL) {
     rel->references++;
+    rel->last_use = ++use_counter;
     goto end;
   }
 
@@ -239,15 +294,19 @@ relation_load(char *name)
     return NULL;
   }
 
+  /* Add the relation before reading the catalog, so that the attributes
+     that have been read are freed along with it upon failure. */
+  list_add(relations, rel);
+  rel->references = 1;
+  rel->last_use = ++use_counter;
+
   if(DB_ERROR(storage_get_relation(rel, name))) {
-    memb_free(&relations_memb, rel);
+    relation_free(rel);
     return NULL;
   }
 
   memcpy(rel->name, name, sizeof(rel->name));
   rel->name[sizeof(rel->name) - 1] = '\0';
-  rel->references = 1;
-  list_add(relations, rel);
 
 end:
   if(rel->dir == DB_STORAGE && DB_ERROR(storage_load(rel))) {
@@ -267,6 +326,7 @@ relation_release(relation_t *rel)
 
   if(rel->references == 0) {
     storage_unload(rel);
+    trim_relation_cache();
   }
 
   return DB_OK;
@@ -277,11 +337,23 @@ relation_create(char *name, db_direction_t dir)
 {
   relation_t old_rel;
   relation_t *rel;
+  attribute_t *attr;
+  int exists;
 
   if(*name != '\0') {
-    relation_clear(&old_rel);
+    /* Memory-resident relations are never written to the storage,
+       so there is no need to look for them there. A cached relation
+       exists in the storage as well. */
+    exists = relation_find(name) != NULL;
+    if(!exists && dir == DB_STORAGE) {
+      relation_clear(&old_rel);
+      exists = storage_get_relation(&old_rel, name) == DB_OK;
+      while((attr = list_pop(old_rel.attributes)) != NULL) {
+        attribute_free(&old_rel, attr);
+      }
+    }
 
-    if(storage_get_relation(&old_rel, name) == DB_OK) {
+    if(exists) {
       /* Reject a creation request if the relation already exists. */
       PRINTF("DB: Attempted to create a relation that already exists (%s)\n",
              name);
@@ -294,6 +366,7 @@ relation_create(char *name, db_direction_t dir)
     }
 
     rel->cardinality = 0;
+    rel->last_use = ++use_counter;
 
     strncpy(rel->name, name, sizeof(rel->name) - 1);
     rel->name[sizeof(rel->name) - 1] = '\0';
@@ -320,11 +393,19 @@ relation_create(char *name, db_direction_t dir)
 db_result_t
 relation_rename(char *old_name, char *new_name)
 {
+  relation_t *rel;
+
   if(DB_ERROR(relation_remove(new_name, 0)) ||
      DB_ERROR(storage_rename_relation(old_name, new_name))) {
     return DB_STORAGE_ERROR;
   }
 
+  /* The cached metadata still carries the old name. */
+  rel = relation_find(old_name);
+  if(rel != NULL && rel->references == 0) {
+    relation_free(rel);
+  }
+
   return DB_OK;
 }
 #endif /* DB_FEATURE_REMOVE */
@@ -347,10 +428,11 @@ relation_attribute_add(relation_t *rel, db_direction_t dir, char *name,
     return NULL;
   }
 
-  attribute = memb_alloc(&attributes_memb);
-  if(attribute == NULL) {
-    PRINTF("DB: Failed to allocate attribute \"%s\"!\n", name);
-    return NULL;
+  while((attribute = memb_alloc(&attributes_memb)) == NULL) {
+    if(!evict_relation(rel)) {
+      PRINTF("DB: Failed to allocate attribute \"%s\"!\n", name);
+      return NULL;
+    }
   }
 
   strncpy(attribute->name, name, sizeof(attribute->name) - 1);
@@ -373,7 +455,8 @@ relation_attribute_add(relation_t *rel, db_direction_t dir, char *name,
        return NULL;
     }
   } else {
-    index_load(rel, attribute);
+    while(index_load(rel, attribute) == DB_ALLOCATION_ERROR &&
+          evict_relation(rel));
   }
 
   return attribute;
@@ -483,6 +566,16 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 
   value = values;
 
+  if(rel->cardinality == INVALID_TUPLE) {
+    /* Continue the tuple numbering of a relation loaded from storage,
+       so that the indexes refer to the correct rows. */
+    rel->next_row = relation_cardinality(rel);
+    if(rel->next_row == INVALID_TUPLE) {
+      rel->next_row = 0;
+      return DB_STORAGE_ERROR;
+    }
+  }
+
   PRINTF("DB: Relation %s has a record size of %u bytes\n",
 	 rel->name, (unsigned)rel->row_length);
   ptr = record;
@@ -547,45 +640,173 @@ relation_insert(relation_t *rel, attribute_value_t *values)
   return storage_put_row(rel, record);
 }
 
-static void
-aggregate(attribute_t *attr, attribute_value_t *value)
+static db_result_t
+get_long_value(attribute_t *attr, unsigned char *ptr, long *long_value)
 {
-  long long_value;
+  attribute_value_t value;
+
+  if(DB_ERROR(db_phy_to_value(&value, attr, ptr))) {
+    return DB_TYPE_ERROR;
+  }
 
-  switch(value->domain) {
+  switch(value.domain) {
   case DOMAIN_INT:
-    long_value = VALUE_INT(value);
+    *long_value = VALUE_INT(&value);
     break;
   case DOMAIN_LONG:
-    long_value = VALUE_LONG(value);
+    *long_value = VALUE_LONG(&value);
     break;
   default:
-    return;
+    return DB_TYPE_ERROR;
   }
 
-  switch(attr->aggregator) {
-  case AQL_COUNT:
-    attr->aggregation_value++;
-    break;
-  case AQL_SUM:
-    attr->aggregation_value += long_value;
-    break;
-  case AQL_MEAN:
-    break;
-  case AQL_MEDIAN:
-    break;
-  case AQL_MAX:
-    if(long_value > attr->aggregation_value) {
-      attr->aggregation_value = long_value;
+  return DB_OK;
+}
+
+static void
+put_long_value(unsigned char *ptr, unsigned size, long long_value)
+{
+  while(size-- > 0) {
+    ptr[size] = long_value & 0xff;
+    long_value >>= 8;
+  }
+}
+
+static struct aggregation_group *
+get_group(long key, unsigned attribute_count)
+{
+  struct aggregation_group *group;
+  unsigned i;
+
+  for(i = 0; i < group_count; i++) {
+    if(groups[i].key == key) {
+      return &groups[i];
     }
-    break;
-  case AQL_MIN:
-    if(long_value < attr->aggregation_value) {
-      attr->aggregation_value = long_value;
+  }
+
+  if(group_count == AQL_GROUP_LIMIT) {
+    return NULL;
+  }
+
+  group = &groups[group_count++];
+  group->key = key;
+  group->count = 0;
+
+  for(i = 0; i < attribute_count; i++) {
+    switch(attr_map[i].to_attr->aggregator) {
+    case AQL_MAX:
+      group->values[i] = LONG_MIN;
+      break;
+    case AQL_MIN:
+      group->values[i] = LONG_MAX;
+      break;
+    default:
+      group->values[i] = 0;
+      break;
     }
-    break;
-  default:
-    break;
+  }
+
+  return group;
+}
+
+static db_result_t
+aggregate(aql_adt_t *adt, unsigned attribute_count)
+{
+  struct source_dest_map *attr_map_ptr;
+  struct aggregation_group *group;
+  long long_value;
+  long *state;
+  unsigned i;
+
+  long_value = 0;
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+    attr_map_ptr = &attr_map[adt->group_attribute];
+    if(DB_ERROR(get_long_value(attr_map_ptr->from_attr,
+                               row + attr_map_ptr->from_offset,
+                               &long_value))) {
+      return DB_TYPE_ERROR;
+    }
+  }
+
+  group = get_group(long_value, attribute_count);
+  if(group == NULL) {
+    PRINTF("DB: The aggregation exceeds %d groups\n", AQL_GROUP_LIMIT);
+    return DB_LIMIT_ERROR;
+  }
+
+  group->count++;
+
+  for(i = 0; i < attribute_count; i++) {
+    attr_map_ptr = &attr_map[i];
+    state = &group->values[i];
+
+    if(attr_map_ptr->to_attr->aggregator == AQL_NONE) {
+      continue;
+    } else if(attr_map_ptr->to_attr->aggregator == AQL_COUNT) {
+      /* Counting does not depend on the domain of the attribute. */
+      (*state)++;
+      continue;
+    } else if(DB_ERROR(get_long_value(attr_map_ptr->from_attr,
+                                      row + attr_map_ptr->from_offset,
+                                      &long_value))) {
+      continue;
+    }
+
+    switch(attr_map_ptr->to_attr->aggregator) {
+    case AQL_SUM:
+    case AQL_MEAN:
+      *state += long_value;
+      break;
+    case AQL_MEDIAN:
+      break;
+    case AQL_MAX:
+      if(long_value > *state) {
+        *state = long_value;
+      }
+      break;
+    case AQL_MIN:
+      if(long_value < *state) {
+        *state = long_value;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  return DB_OK;
+}
+
+static void
+generate_group_row(struct aggregation_group *group, unsigned attribute_count)
+{
+  attribute_t *result_attr;
+  unsigned char *to_ptr;
+  long long_value;
+  unsigned i;
+
+  for(i = 0; i < attribute_count; i++) {
+    result_attr = attr_map[i].to_attr;
+    to_ptr = result_row + attr_map[i].to_offset;
+
+    if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+      continue;
+    }
+
+    switch(result_attr->aggregator) {
+    case AQL_NONE:
+      /* The grouping attribute. */
+      long_value = group->key;
+      break;
+    case AQL_MEAN:
+      long_value = group->count > 0 ? group->values[i] / group->count : 0;
+      break;
+    default:
+      long_value = group->values[i];
+      break;
+    }
+
+    put_long_value(to_ptr, result_attr->element_size, long_value);
   }
 }
 
@@ -619,6 +840,7 @@ generate_attribute_map(struct source_dest_map *attr_map, unsigned attribute_coun
     }
     attr_map_ptr->from_offset = offset;
     attr_map_ptr->to_offset = size_sum;
+    attr_map_ptr->variable = lvm_get_variable_id(to_attr->name);
 
     size_sum += to_attr->element_size;
     attr_map_ptr++;
@@ -654,6 +876,7 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
              attr->name, range + 1);
 
       if(range <= min_range) {
+        min_range = range;
         index = attr->index;
         av_min.domain = av_max.domain = DOMAIN_INT;
         VALUE_LONG(&av_min) = min.l;
@@ -696,11 +919,22 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     return DB_IMPLEMENTATION_ERROR;
   }
 
+  group_count = next_group = 0;
+  if((AQL_GET_FLAGS(adt) & (AQL_FLAG_AGGREGATE | AQL_FLAG_GROUP)) ==
+     AQL_FLAG_AGGREGATE) {
+    /* An aggregation over the whole relation yields a tuple even if
+       no tuple fulfills the condition. */
+    get_group(0, attribute_count);
+  }
+
   if(adt->lvm_instance != NULL) {
     /* Try to establish acceptable ranges for the attribute values. */
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
       select_index(handle, adt->lvm_instance);
     }
+
+    /* Translate the predicate once instead of decoding it per tuple. */
+    lvm_prepare(adt->lvm_instance);
   }
 
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
@@ -724,6 +958,9 @@ relation_process_remove(void *handle_ptr)
     PRINTF("DB: Finished removing tuples. Overwriting relation %s with the result\n", 
 	adt->relations[1]);
     relation_release(handle->rel);
+    if(DB_ERROR(storage_flush_rows(handle->result_rel))) {
+      return DB_STORAGE_ERROR;
+    }
     relation_rename(adt->relations[0], adt->relations[1]);
   }
 
@@ -741,10 +978,7 @@ relation_process_select(void *handle_ptr)
   struct source_dest_map *attr_map_ptr, *attr_map_end;
   attribute_t *result_attr;
   unsigned char *from_ptr;
-  unsigned char *to_ptr;
   operand_value_t operand_value;
-  uint8_t intbuf[2];
-  attribute_value_t value;
   lvm_status_t wanted_result;
 
   handle = (db_handle_t *)handle_ptr;
@@ -753,6 +987,10 @@ relation_process_select(void *handle_ptr)
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
 
+  if(handle->flags & DB_HANDLE_FLAG_AGGREGATED) {
+    goto end_aggregation;
+  }
+
   if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
@@ -789,15 +1027,17 @@ relation_process_select(void *handle_ptr)
     result_attr = attr_map_ptr->to_attr;
 
     /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
+    if(attr_map_ptr->variable == LVM_INVALID_VARIABLE) {
+      /* The attribute is not used in the predicate. */
+    } else if(attr_map_ptr->from_attr->domain == DOMAIN_INT) {
       operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
+      lvm_set_variable_value_by_id(attr_map_ptr->variable, operand_value);
+    } else if(attr_map_ptr->from_attr->domain == DOMAIN_LONG) {
       operand_value.l = (uint32_t)from_ptr[0] << 24 |
                         (uint32_t)from_ptr[1] << 16 |
                         (uint32_t)from_ptr[2] << 8 |
                         from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
+      lvm_set_variable_value_by_id(attr_map_ptr->variable, operand_value);
     }
 
     if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
@@ -822,13 +1062,9 @@ relation_process_select(void *handle_ptr)
   if(adt->lvm_instance == NULL ||
      lvm_execute(adt->lvm_instance) == wanted_result) {
     if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
-      for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-        from_ptr = row + attr_map_ptr->from_offset;
-        result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
-        if(DB_ERROR(result)) {
-	  return result;
-        }
-        aggregate(attr_map_ptr->to_attr, &value);
+      result = aggregate(adt, attribute_count);
+      if(DB_ERROR(result)) {
+        return result;
       }
     } else {
       if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
@@ -845,17 +1081,14 @@ relation_process_select(void *handle_ptr)
   return DB_OK;
 
 end_aggregation:
-  /* Generate aggregated result if requested. */
-  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-    result_attr = attr_map_ptr->to_attr;
-    to_ptr = result_row + attr_map_ptr->to_offset;
-
-    intbuf[0] = result_attr->aggregation_value >> 8;
-    intbuf[1] = result_attr->aggregation_value & 0xff;
-    from_ptr = intbuf;
-    memcpy(to_ptr, from_ptr, result_attr->element_size);
+  /* The scan has finished. Generate one result tuple for each group. */
+  handle->flags |= DB_HANDLE_FLAG_AGGREGATED;
+  if(next_group == group_count) {
+    return DB_FINISHED;
   }
 
+  generate_group_row(&groups[next_group++], attribute_count);
+
   if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
     if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
       PRINTF("DB: Failed to store a row in the result relation!\n");
@@ -863,18 +1096,51 @@ end_aggregation:
     }
   }
 
-  handle->current_row = 1;
-  AQL_GET_FLAGS(adt) &= ~AQL_FLAG_AGGREGATE; /* Stop the aggregation. */
+  handle->current_row++;
 
   return DB_GOT_ROW;
 }
 
+static db_result_t
+create_result_relation(db_handle_t *handle, aql_adt_t *adt,
+                       db_direction_t *dir)
+{
+  char *name;
+  relation_t *rel;
+
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
+    name = adt->relations[0];
+    *dir = DB_STORAGE;
+    relation_remove(name, 1);
+  } else {
+    /* Recycle the result relation of the previous query without
+       involving the storage layer. */
+    name = RESULT_RELATION;
+    *dir = DB_MEMORY;
+    rel = relation_find(name);
+    if(rel != NULL) {
+      if(rel->references > 0) {
+        return DB_BUSY_ERROR;
+      }
+      relation_free(rel);
+    }
+  }
+
+  relation_create(name, *dir);
+  handle->result_rel = relation_load(name);
+  if(handle->result_rel == NULL) {
+    return DB_ALLOCATION_ERROR;
+  }
+
+  return DB_OK;
+}
+
 db_result_t
 relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 {
   aql_adt_t *adt;
   db_handle_t *handle;
-  char *name;
+  db_result_t result;
   db_direction_t dir;
   char *attribute_name;
   attribute_t *attr;
@@ -887,20 +1153,10 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
   handle->rel = rel;
   handle->adt = adt;
 
-  if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
-    name = adt->relations[0];
-    dir = DB_STORAGE;
-  } else {
-    name = RESULT_RELATION;
-    dir = DB_MEMORY;
-  }
-  relation_remove(name, 1);
-  relation_create(name, dir);
-  handle->result_rel = relation_load(name);
-
-  if(handle->result_rel == NULL) {
+  result = create_result_relation(handle, adt, &dir);
+  if(DB_ERROR(result)) {
     PRINTF("DB: Failed to load a relation for the query result\n");
-    return DB_ALLOCATION_ERROR;
+    return result;
   }
 
   for(i = normal_attributes = 0; i < AQL_ATTRIBUTE_COUNT(adt); i++) {
@@ -916,10 +1172,15 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     PRINTF("DB: Found attribute %s in relation %s\n",
 	attribute_name, rel->name);
 
-    attr = relation_attribute_add(handle->result_rel, dir,
-				  attribute_name, 
-				  adt->aggregators[i] ? DOMAIN_INT : attr->domain,
-				  attr->element_size);
+    /* Aggregates are stored as long values regardless of the domain
+       of the aggregated attribute. */
+    if(adt->aggregators[i] == AQL_NONE) {
+      attr = relation_attribute_add(handle->result_rel, dir, attribute_name,
+                                    attr->domain, attr->element_size);
+    } else {
+      attr = relation_attribute_add(handle->result_rel, dir, attribute_name,
+                                    DOMAIN_LONG, sizeof(int32_t));
+    }
     if(attr == NULL) {
       PRINTF("DB: Failed to add a result attribute\n");
       relation_release(handle->result_rel);
@@ -927,30 +1188,22 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     }
 
     attr->aggregator = adt->aggregators[i];
-    switch(attr->aggregator) {
-    case AQL_NONE:
-      if(!(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE)) {
-        /* Only count attributes projected into the result set. */
-        normal_attributes++;
-      }
-      break;
-    case AQL_MAX:
-      attr->aggregation_value = LONG_MIN;
-      break;
-    case AQL_MIN:
-      attr->aggregation_value = LONG_MAX;
-      break;
-    default:
-      attr->aggregation_value = 0;
-      break;
+    if(attr->aggregator == AQL_NONE &&
+       !(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE)) {
+      /* Only count attributes projected into the result set. */
+      normal_attributes++;
     }
 
     attr->flags = adt->attributes[i].flags;
   }
 
   /* Preclude mixes of normal attributes and aggregated ones in 
-     selection results. */
-  if(normal_attributes > 0 &&
+     selection results. The only exception is the grouping attribute. */
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) {
+    if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) || normal_attributes != 1) {
+      return DB_RELATIONAL_ERROR;
+    }
+  } else if(normal_attributes > 0 &&
      handle->result_rel->attribute_count > normal_attributes) {
      return DB_RELATIONAL_ERROR;
   }
@@ -1112,10 +1365,10 @@ relation_join(void *query_result, void *adt_ptr)
 {
   aql_adt_t *adt;
   db_handle_t *handle;
+  db_result_t result;
   relation_t *left_rel;
   relation_t *right_rel;
   relation_t *join_rel;
-  char *name;
   db_direction_t dir;
   int i;
   char *attribute_name;
@@ -1129,24 +1382,13 @@ relation_join(void *query_result, void *adt_ptr)
   handle->adt = adt;
   handle->flags = DB_HANDLE_FLAG_INDEX_STEP;
 
-  if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
-    name = adt->relations[0];
-    dir = DB_STORAGE;
-  } else {
-    name = RESULT_RELATION;
-    dir = DB_MEMORY;
-  }
-  relation_remove(name, 1);
-  relation_create(name, dir);
-  join_rel = relation_load(name);
-  handle->result_rel = join_rel;
-
-  if(join_rel == NULL) {
+  result = create_result_relation(handle, adt, &dir);
+  if(DB_ERROR(result)) {
     PRINTF("DB: Failed to create a join relation!\n");
-    return DB_ALLOCATION_ERROR;
+    return result;
   }
 
-  handle->join_rel = handle->result_rel = join_rel;
+  join_rel = handle->join_rel = handle->result_rel;
   left_rel = handle->left_rel;
   right_rel = handle->right_rel;
 
@@ -1158,9 +1400,24 @@ relation_join(void *query_result, void *adt_ptr)
     return DB_RELATIONAL_ERROR;
   }
 
+  /*
+   * The inner relation is probed through the index of the join attribute,
+   * so we swap the relations if only the left one has such an index.
+   */
   if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
+    if(!index_exists(handle->left_join_attr)) {
+      PRINTF("DB: The attribute to join on is not indexed\n");
+      return DB_INDEX_ERROR;
+    }
+
+    handle->left_rel = right_rel;
+    handle->right_rel = left_rel;
+    left_rel = handle->left_rel;
+    right_rel = handle->right_rel;
+
+    attr = handle->left_join_attr;
+    handle->left_join_attr = handle->right_join_attr;
+    handle->right_join_attr = attr;
   }
 
   /*
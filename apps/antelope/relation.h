@@ -71,6 +71,7 @@ struct relation {
   db_storage_id_t tuple_storage;
   db_direction_t dir;
   uint8_t references;
+  uint16_t last_use;
   char name[RELATION_NAME_LENGTH + 1];
   char tuple_filename[RELATION_NAME_LENGTH + 1];
 };
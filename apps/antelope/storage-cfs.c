@@ -68,6 +68,23 @@ struct index_record {
 
 #define ROW_XOR 0xf6U
 
+/*
+ * A block of consecutive rows of a relation. The read buffer holds rows
+ * that were read ahead during a scan, and the write buffer holds rows
+ * that have not yet been appended to the tuple file.
+ */
+struct row_buffer {
+  relation_t *rel;
+  tuple_id_t first_row;
+  unsigned row_count;
+  unsigned char data[DB_ROW_BUFFER_SIZE];
+};
+
+static struct row_buffer read_buffer;
+static struct row_buffer write_buffer;
+
+#define ROWS_PER_BUFFER(rel)	(DB_ROW_BUFFER_SIZE / (rel)->row_length)
+
 static void
 merge_strings(char *dest, char *prefix, char *suffix)
 {
@@ -100,9 +117,90 @@ storage_generate_file(char *prefix, unsigned long size)
 #endif /* DB_FEATURE_COFFEE */
 }
 
+static void
+invalidate_buffers(relation_t *rel)
+{
+  if(read_buffer.rel == rel) {
+    read_buffer.rel = NULL;
+  }
+}
+
+static db_result_t
+write_rows(relation_t *rel, unsigned char *data, unsigned length)
+{
+  int r;
+#if DB_FEATURE_INTEGRITY
+  cfs_offset_t end;
+  int missing_bytes;
+  char buf[rel->row_length];
+
+  end = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
+  if(end == (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+
+  missing_bytes = end % rel->row_length;
+  if(missing_bytes > 0) {
+    memset(buf, 0xff, sizeof(buf));
+    r = cfs_write(rel->tuple_storage, buf, sizeof(buf));
+    if(r != missing_bytes) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+#else
+  if(cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END) == (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+#endif
+
+  do {
+    r = cfs_write(rel->tuple_storage, data, length);
+    if(r < 0) {
+      PRINTF("DB: Failed to store %u bytes\n", length);
+      return DB_STORAGE_ERROR;
+    }
+    data += r;
+    length -= r;
+  } while(length > 0);
+
+  return DB_OK;
+}
+
+static db_result_t
+flush_rows(relation_t *rel)
+{
+  db_result_t result;
+
+  if(write_buffer.rel != rel || write_buffer.row_count == 0) {
+    return DB_OK;
+  }
+
+  PRINTF("DB: Flushing %u rows to relation %s\n",
+         write_buffer.row_count, rel->name);
+
+  result = write_rows(rel, write_buffer.data,
+                      write_buffer.row_count * rel->row_length);
+  write_buffer.row_count = 0;
+  write_buffer.rel = NULL;
+  return result;
+}
+
+db_result_t
+storage_flush_rows(relation_t *rel)
+{
+  return flush_rows(rel);
+}
+
 db_result_t
 storage_load(relation_t *rel)
 {
+  if(RELATION_HAS_TUPLES(rel)) {
+    /* The relation has been loaded already. */
+    flush_rows(rel);
+    cfs_close(rel->tuple_storage);
+  }
+  invalidate_buffers(rel);
+
   PRINTF("DB: Opening the tuple file %s\n", rel->tuple_filename);
   rel->tuple_storage = cfs_open(rel->tuple_filename,
                                 CFS_READ | CFS_WRITE | CFS_APPEND);
@@ -120,6 +218,8 @@ storage_unload(relation_t *rel)
   if(RELATION_HAS_TUPLES(rel)) {
     PRINTF("DB: Unload tuple file %s\n", rel->tuple_filename);
 
+    flush_rows(rel);
+    invalidate_buffers(rel);
     cfs_close(rel->tuple_storage);
     rel->tuple_storage = -1;
   }
@@ -279,6 +379,12 @@ storage_put_attribute(relation_t *rel, attribute_t *attr)
 db_result_t
 storage_drop_relation(relation_t *rel, int remove_tuples)
 {
+  if(write_buffer.rel == rel) {
+    write_buffer.rel = NULL;
+    write_buffer.row_count = 0;
+  }
+  invalidate_buffers(rel);
+
   if(remove_tuples && RELATION_HAS_TUPLES(rel)) {
     cfs_remove(rel->tuple_filename);
   }
@@ -400,11 +506,38 @@ storage_put_index(index_t *index)
   return result;
 }
 
+static db_result_t
+read_rows(relation_t *rel, tuple_id_t tuple_id, unsigned char *data,
+          unsigned length)
+{
+  int r;
+
+  if(cfs_seek(rel->tuple_storage, tuple_id * rel->row_length, CFS_SEEK_SET) ==
+              (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+
+  while(length > 0) {
+    r = cfs_read(rel->tuple_storage, data, length);
+    if(r < 0) {
+      PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
+      return DB_STORAGE_ERROR;
+    } else if(r == 0) {
+      PRINTF("DB: Incomplete record: %u bytes missing\n", length);
+      return DB_STORAGE_ERROR;
+    }
+    data += r;
+    length -= r;
+  }
+
+  return DB_OK;
+}
+
 db_result_t
 storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
 {
-  int r;
   tuple_id_t nrows;
+  unsigned row_count;
 
   if(DB_ERROR(storage_get_row_amount(rel, &nrows))) {
     return DB_STORAGE_ERROR;
@@ -414,20 +547,32 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
     return DB_FINISHED;
   }
 
-  if(cfs_seek(rel->tuple_storage, *tuple_id * rel->row_length, CFS_SEEK_SET) ==
-              (cfs_offset_t)-1) {
-    return DB_STORAGE_ERROR;
-  }
+  if(ROWS_PER_BUFFER(rel) == 0) {
+    if(DB_ERROR(read_rows(rel, *tuple_id, row, rel->row_length))) {
+      return DB_STORAGE_ERROR;
+    }
+  } else {
+    if(read_buffer.rel != rel || *tuple_id < read_buffer.first_row ||
+       *tuple_id >= read_buffer.first_row + read_buffer.row_count) {
+      /* Read ahead as many of the following rows as the buffer holds. */
+      row_count = ROWS_PER_BUFFER(rel);
+      if(row_count > nrows - *tuple_id) {
+        row_count = nrows - *tuple_id;
+      }
+
+      read_buffer.rel = NULL;
+      if(DB_ERROR(read_rows(rel, *tuple_id, read_buffer.data,
+                            row_count * rel->row_length))) {
+        return DB_STORAGE_ERROR;
+      }
+      read_buffer.rel = rel;
+      read_buffer.first_row = *tuple_id;
+      read_buffer.row_count = row_count;
+    }
 
-  r = cfs_read(rel->tuple_storage, row, rel->row_length);
-  if(r < 0) {
-    PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
-    return DB_STORAGE_ERROR;
-  } else if(r == 0) {
-    return DB_FINISHED;
-  } else if(r < rel->row_length) {
-    PRINTF("DB: Incomplete record: %d < %d\n", r, rel->row_length);
-    return DB_STORAGE_ERROR;
+    memcpy(row, read_buffer.data +
+           (*tuple_id - read_buffer.first_row) * rel->row_length,
+           rel->row_length);
   }
 
   row[rel->row_length - 1] ^= ROW_XOR;
@@ -440,53 +585,41 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
 db_result_t
 storage_put_row(relation_t *rel, storage_row_t row)
 {
-  cfs_offset_t end;
-  unsigned remaining;
-  int r;
   unsigned char *last_byte;
-#if DB_FEATURE_INTEGRITY
-  int missing_bytes;
-  char buf[rel->row_length];
-#endif
+  db_result_t result;
 
-  end = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
-  if(end == (cfs_offset_t)-1) {
+  if(write_buffer.rel != rel &&
+     DB_ERROR(flush_rows(write_buffer.rel))) {
     return DB_STORAGE_ERROR;
   }
 
-#if DB_FEATURE_INTEGRITY
-  missing_bytes = end % rel->row_length;
-  if(missing_bytes > 0) {
-    memset(buf, 0xff, sizeof(buf));
-    r = cfs_write(rel->tuple_storage, buf, sizeof(buf));
-    if(r != missing_bytes) {
-      return DB_STORAGE_ERROR;
-    }
-  }
-#endif
-
   /* Ensure that last written byte is separated from 0, to make file
      lengths correct in Coffee. */
   last_byte = row + rel->row_length - 1;
   *last_byte ^= ROW_XOR;
 
-  remaining = rel->row_length;
-  do {
-    r = cfs_write(rel->tuple_storage, row, remaining);
-    if(r < 0) {
-      PRINTF("DB: Failed to store %u bytes\n", remaining);
-      *last_byte ^= ROW_XOR;
-      return DB_STORAGE_ERROR;
+  if(ROWS_PER_BUFFER(rel) == 0) {
+    result = write_rows(rel, row, rel->row_length);
+  } else {
+    /* Collect rows in the buffer, and append them in a single write. */
+    memcpy(write_buffer.data + write_buffer.row_count * rel->row_length,
+           row, rel->row_length);
+    write_buffer.rel = rel;
+    write_buffer.row_count++;
+
+    result = DB_OK;
+    if(write_buffer.row_count == ROWS_PER_BUFFER(rel)) {
+      result = flush_rows(rel);
     }
-    row += r;
-    remaining -= r;
-  } while(remaining > 0);
-
-  PRINTF("DB: Stored a of %d bytes\n", rel->row_length);
+  }
 
   *last_byte ^= ROW_XOR;
 
-  return DB_OK;
+  if(DB_SUCCESS(result)) {
+    PRINTF("DB: Stored a of %d bytes\n", rel->row_length);
+  }
+
+  return result;
 }
 
 db_result_t
@@ -494,6 +627,10 @@ storage_get_row_amount(relation_t *rel, tuple_id_t *amount)
 {
   cfs_offset_t offset;
 
+  if(DB_ERROR(flush_rows(rel))) {
+    return DB_STORAGE_ERROR;
+  }
+
   if(rel->row_length == 0) {
     *amount = 0;
   } else {
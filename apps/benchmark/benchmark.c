@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	A tool for benchmarking Contiki software.
+ */
+
+#include <stdio.h>
+
+#include "benchmark.h"
+
+#if CONTIKI_TARGET_NATIVE && !defined(BENCHMARK_CONF_TICKS)
+#include <time.h>
+#endif
+
+#if (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)) && \
+    !CONTIKI_TARGET_NATIVE && !defined(BENCHMARK_CONF_TICKS)
+#define WITH_DWT 1
+/* The architectural addresses of the debug registers, so that no
+   vendor header is needed. */
+#define DEMCR       (*(volatile uint32_t *)0xE000EDFC)
+#define DEMCR_TRCENA (1UL << 24)
+#define DWT_CTRL    (*(volatile uint32_t *)0xE0001000)
+#define DWT_CTRL_CYCCNTENA 1UL
+#define DWT_CYCCNT  (*(volatile uint32_t *)0xE0001004)
+#else
+#define WITH_DWT 0
+#endif
+
+/*---------------------------------------------------------------------------*/
+void
+benchmark_init(void)
+{
+#if WITH_DWT
+  DEMCR |= DEMCR_TRCENA;
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif /* WITH_DWT */
+}
+/*---------------------------------------------------------------------------*/
+#if CONTIKI_TARGET_NATIVE && !defined(BENCHMARK_CONF_TICKS)
+benchmark_ticks_t
+benchmark_arch_ticks(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (benchmark_ticks_t)((uint64_t)ts.tv_sec * 1000000000UL + ts.tv_nsec);
+}
+#elif WITH_DWT
+benchmark_ticks_t
+benchmark_arch_ticks(void)
+{
+  return DWT_CYCCNT;
+}
+#endif
+/*---------------------------------------------------------------------------*/
+benchmark_ticks_t
+benchmark_elapsed(benchmark_ticks_t start, benchmark_ticks_t end)
+{
+#if BENCHMARK_TICKS_ARE_RTIMER
+  /* The rtimer may be narrower than the tick type */
+  return (rtimer_clock_t)((rtimer_clock_t)end - (rtimer_clock_t)start);
+#else /* BENCHMARK_TICKS_ARE_RTIMER */
+  return end - start;
+#endif /* BENCHMARK_TICKS_ARE_RTIMER */
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_per_op(const benchmark_t *bp, const char *unit, uint64_t total)
+{
+  uint64_t hundredths;
+
+  hundredths = total * 100 / (bp->iterations ? bp->iterations : 1);
+  printf("  %lu.%02u %s/op\n", (unsigned long)(hundredths / 100),
+         (unsigned)(hundredths % 100), unit);
+  printf("METRIC benchmark-%s-%s-per-op %lu.%02u lower\n", bp->name, unit,
+         (unsigned long)(hundredths / 100), (unsigned)(hundredths % 100));
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Print the results of a benchmark.
+ *
+ * \param bp The benchmark descriptor.
+ */
+void
+benchmark_print_report(const benchmark_t *bp)
+{
+  /* Not tested with the preprocessor, as RTIMER_SECOND may hold casts */
+  const uint32_t ticks_per_second = BENCHMARK_TICKS_PER_SECOND;
+  uint64_t ns;
+
+  printf("\nBenchmark: %s\n", bp->descr);
+  printf("  %lu ops in %lu ticks\n", (unsigned long)bp->iterations,
+         (unsigned long)bp->ticks);
+  if(BENCHMARK_TICKS_ARE_CYCLES) {
+    print_per_op(bp, "cycles", bp->ticks);
+  }
+  if(ticks_per_second > 0) {
+    ns = (uint64_t)bp->ticks * 1000000000UL / ticks_per_second;
+    if(ns > 0) {
+      printf("  %lu ops/s\n", (unsigned long)
+             ((uint64_t)bp->iterations * 1000000000UL / ns));
+    }
+    print_per_op(bp, "ns", ns);
+  } else if(!BENCHMARK_TICKS_ARE_CYCLES) {
+    print_per_op(bp, "ticks", bp->ticks);
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	A tool for benchmarking Contiki software.
+ *
+ *	A benchmark times a loop of a given number of operations with
+ *	the best counter available: a nanosecond clock on the native
+ *	platform, the DWT cycle counter on ARMv7-M and the rtimer
+ *	elsewhere. A platform or project can plug in its own counter
+ *	through BENCHMARK_CONF_TICKS() and
+ *	BENCHMARK_CONF_TICKS_PER_SECOND.
+ *
+ *	Results are printed in a human readable form followed by
+ *	"METRIC <name> <value> lower" lines, which the regression tests
+ *	collect and compare with a baseline.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "contiki.h"
+#include "sys/rtimer.h"
+
+typedef uint32_t benchmark_ticks_t;
+
+#ifdef BENCHMARK_CONF_TICKS
+#define BENCHMARK_TICKS()            BENCHMARK_CONF_TICKS()
+#define BENCHMARK_TICKS_PER_SECOND   BENCHMARK_CONF_TICKS_PER_SECOND
+#ifdef BENCHMARK_CONF_TICKS_ARE_CYCLES
+#define BENCHMARK_TICKS_ARE_CYCLES   BENCHMARK_CONF_TICKS_ARE_CYCLES
+#endif /* BENCHMARK_CONF_TICKS_ARE_CYCLES */
+#elif CONTIKI_TARGET_NATIVE
+#define BENCHMARK_TICKS()            benchmark_arch_ticks()
+#define BENCHMARK_TICKS_PER_SECOND   1000000000UL
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+/* The DWT cycle counter. The core clock is only needed to convert
+   cycles into time and must be given by the platform or project. */
+#define BENCHMARK_TICKS()            benchmark_arch_ticks()
+#ifdef BENCHMARK_CONF_CPU_HZ
+#define BENCHMARK_TICKS_PER_SECOND   BENCHMARK_CONF_CPU_HZ
+#else /* BENCHMARK_CONF_CPU_HZ */
+#define BENCHMARK_TICKS_PER_SECOND   0
+#endif /* BENCHMARK_CONF_CPU_HZ */
+#define BENCHMARK_TICKS_ARE_CYCLES   1
+#else
+/* Loops timed with the rtimer must be shorter than its wrap-around
+   time, which is two seconds for a 16-bit rtimer at 32 kHz. */
+#define BENCHMARK_TICKS()            ((benchmark_ticks_t)RTIMER_NOW())
+#define BENCHMARK_TICKS_PER_SECOND   RTIMER_SECOND
+#define BENCHMARK_TICKS_ARE_RTIMER   1
+#endif
+
+#ifndef BENCHMARK_TICKS_ARE_CYCLES
+#define BENCHMARK_TICKS_ARE_CYCLES   0
+#endif /* BENCHMARK_TICKS_ARE_CYCLES */
+
+#ifndef BENCHMARK_TICKS_ARE_RTIMER
+#define BENCHMARK_TICKS_ARE_RTIMER   0
+#endif /* BENCHMARK_TICKS_ARE_RTIMER */
+
+/**
+ * The structure that holds the state of a benchmark.
+ */
+typedef struct benchmark {
+  const char * const name;
+  const char * const descr;
+  const uint32_t iterations;
+  benchmark_ticks_t start;
+  benchmark_ticks_t ticks;
+} benchmark_t;
+
+/**
+ * Register a benchmark that runs a given number of operations.
+ * The name is also used for the metrics it reports, so it should
+ * be stable across releases.
+ */
+#define BENCHMARK_REGISTER(name, descr, iterations) \
+  static benchmark_t benchmark_##name = {#name, descr, iterations, 0, 0}
+
+/**
+ * Define a benchmark function. The number of operations to run is
+ * available as BENCHMARK_ITERATIONS.
+ */
+#define BENCHMARK(name) static void benchmark_function_##name(benchmark_t *bp)
+
+/**
+ * The number of operations the running benchmark should perform.
+ */
+#define BENCHMARK_ITERATIONS (bp->iterations)
+
+/**
+ * Start the timing. Anything done before is setup that is not
+ * measured.
+ */
+#define BENCHMARK_START() do {                                               \
+                            bp->start = BENCHMARK_TICKS();                   \
+                          } while(0)
+
+/**
+ * Stop the timing. Anything done after is teardown that is not
+ * measured.
+ */
+#define BENCHMARK_STOP() do {                                                \
+                           bp->ticks = benchmark_elapsed(bp->start,          \
+                                                         BENCHMARK_TICKS()); \
+                         } while(0)
+
+#ifndef BENCHMARK_PRINT_FUNCTION
+#define BENCHMARK_PRINT_FUNCTION benchmark_print_report
+#endif /* !BENCHMARK_PRINT_FUNCTION */
+
+/**
+ * Run a benchmark and print its results.
+ */
+#define BENCHMARK_RUN(name) do {                                             \
+                              benchmark_function_##name(&benchmark_##name);  \
+                              BENCHMARK_PRINT_FUNCTION(&benchmark_##name);   \
+                            } while(0)
+
+/**
+ * Prepare the tick counter. Call once before running benchmarks.
+ */
+void benchmark_init(void);
+
+/**
+ * The number of ticks between two readings of the tick counter,
+ * taking its width into account.
+ */
+benchmark_ticks_t benchmark_elapsed(benchmark_ticks_t start,
+                                    benchmark_ticks_t end);
+
+/* Reads the native or DWT tick counter. */
+benchmark_ticks_t benchmark_arch_ticks(void);
+
+/* The default print function. */
+void benchmark_print_report(const benchmark_t *bp);
+
+#endif /* !BENCHMARK_H */
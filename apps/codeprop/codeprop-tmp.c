@@ -47,6 +47,7 @@
  *    Point-to-point download over TCP
  *    Point-to-multipoint delivery over UDP broadcasts
  *    Versioning of code modules
+ *    Binary patches against the previously loaded module
  *
  * Procedure:
  *
@@ -72,10 +73,30 @@
 #include "loader/elfloader.h"
 #include <string.h>
 
+/* With CODEPROP_CONF_DELTA, the TCP download may carry a patch made
+   with tools/codeprop-diff instead of a whole module. The patch is
+   applied against a copy of the module that was loaded last, which
+   is kept in a separate file since loading relocates the image in
+   place. The delta-patch app must be added to APPS. */
+#ifdef CODEPROP_CONF_DELTA
+#define CODEPROP_DELTA CODEPROP_CONF_DELTA
+#else
+#define CODEPROP_DELTA 0
+#endif
+
+#if CODEPROP_DELTA
+#include "delta-patch.h"
+#endif
+
+#define CODEPROP_IMAGE "codeprop-image"
+#define CODEPROP_BASE  "codeprop-base"
+
+#define ERR_PATCH_FAILED 8
+
 static const char *err_msgs[] =
   {"OK\r\n", "Bad ELF header\r\n", "No symtab\r\n", "No strtab\r\n",
    "No text\r\n", "Symbol not found\r\n", "Segment not found\r\n",
-   "No startpoint\r\n" };
+   "No startpoint\r\n", "Patch failed\r\n" };
 
 #define CODEPROP_DATA_PORT 6510
 
@@ -112,6 +133,8 @@ struct codeprop_udphdr {
 struct codeprop_tcphdr {
   uint16_t len;
   uint16_t pad;
+#define TCPHDR_IMAGE 0x0000
+#define TCPHDR_PATCH 0x0001
 };
 
 static void uipcall(void *state);
@@ -135,9 +158,16 @@ struct codeprop_state {
   struct pt tcpthread_pt;
   struct pt udpthread_pt;
   struct pt recv_udpthread_pt;
+#if CODEPROP_DELTA
+  uint8_t is_patch;
+  struct delta_patch patch;
+#endif
 };
 
 static int fd;
+#if CODEPROP_DELTA
+static int basefd = -1;
+#endif
 
 static struct uip_udp_conn *udp_conn;
 
@@ -178,7 +208,7 @@ PROCESS_THREAD(codeprop_process, ev, data)
   s.addr = 0;
   s.len = 0;
 
-  fd = cfs_open("codeprop-image", CFS_READ | CFS_WRITE);
+  fd = cfs_open(CODEPROP_IMAGE, CFS_READ | CFS_WRITE);
 
   while(1) {
 
@@ -360,6 +390,59 @@ PT_THREAD(recv_udpthread(struct pt *pt))
   PT_END(pt);
 }
 /*---------------------------------------------------------------------*/
+#if CODEPROP_DELTA
+static void
+start_patch(void)
+{
+  /* The new image is written from scratch, so that no part of the
+     old one is left behind it. */
+  cfs_close(fd);
+  cfs_remove(CODEPROP_IMAGE);
+  fd = cfs_open(CODEPROP_IMAGE, CFS_READ | CFS_WRITE);
+  basefd = cfs_open(CODEPROP_BASE, CFS_READ);
+  delta_patch_init(&s.patch, basefd, fd);
+}
+/*---------------------------------------------------------------------*/
+static int
+finish_patch(void)
+{
+  int err;
+
+  err = delta_patch_finish(&s.patch);
+  cfs_close(basefd);
+  basefd = -1;
+  if(err != DELTA_PATCH_OK) {
+    PRINTF(("codeprop: patch failed with error %d\n", err));
+  }
+  return err;
+}
+/*---------------------------------------------------------------------*/
+static void
+save_base(void)
+{
+  static uint8_t buf[UDPDATASIZE];
+  uint16_t addr;
+  int base, n;
+
+  cfs_remove(CODEPROP_BASE);
+  base = cfs_open(CODEPROP_BASE, CFS_WRITE);
+  if(base < 0) {
+    return;
+  }
+  cfs_seek(fd, 0, CFS_SEEK_SET);
+  for(addr = 0; addr < s.len; addr += n) {
+    n = s.len - addr > sizeof(buf) ? sizeof(buf) : s.len - addr;
+    if(cfs_read(fd, buf, n) != n || cfs_write(base, buf, n) != n) {
+      /* A partial base would only make later patches fail. */
+      cfs_close(base);
+      cfs_remove(CODEPROP_BASE);
+      return;
+    }
+  }
+  cfs_close(base);
+}
+#endif /* CODEPROP_DELTA */
+/*---------------------------------------------------------------------*/
 static
 PT_THREAD(recv_tcpthread(struct pt *pt))
 {
@@ -392,6 +475,12 @@ PT_THREAD(recv_tcpthread(struct pt *pt))
     th = (struct codeprop_tcphdr *)uip_appdata;
     s.len = uip_htons(th->len);
     s.addr = 0;
+#if CODEPROP_DELTA
+    s.is_patch = uip_htons(th->pad) == TCPHDR_PATCH;
+    if(s.is_patch) {
+      start_patch();
+    }
+#endif
     uip_appdata += sizeof(struct codeprop_tcphdr);
     datalen -= sizeof(struct codeprop_tcphdr);
     
@@ -402,8 +491,15 @@ PT_THREAD(recv_tcpthread(struct pt *pt))
 	/*	eeprom_write(EEPROMFS_ADDR_CODEPROP + s.addr,
 		uip_appdata,
 		uip_datalen());*/
-	cfs_seek(fd, s.addr, CFS_SEEK_SET);
-	cfs_write(fd, uip_appdata, uip_datalen());
+#if CODEPROP_DELTA
+	if(s.is_patch) {
+	  delta_patch_input(&s.patch, uip_appdata, datalen);
+	} else
+#endif
+	{
+	  cfs_seek(fd, s.addr, CFS_SEEK_SET);
+	  cfs_write(fd, uip_appdata, datalen);
+	}
 	s.addr += datalen;
       }
       if(s.addr < s.len) {
@@ -415,7 +511,18 @@ PT_THREAD(recv_tcpthread(struct pt *pt))
     
     {
       static int err;
-      
+
+#if CODEPROP_DELTA
+      if(s.is_patch) {
+	if(finish_patch() == DELTA_PATCH_OK) {
+	  /* From here on the new image is handled like a full one. */
+	  s.len = s.patch.new_len;
+	  err = codeprop_start_program();
+	} else {
+	  err = ERR_PATCH_FAILED;
+	}
+      } else
+#endif
       err = codeprop_start_program();
       
       /* Print out the "OK"/error message. */
@@ -464,6 +571,9 @@ codeprop_start_program(void)
 
   codeprop_exit_program();
 
+#if CODEPROP_DELTA
+  save_base();
+#endif
   err = elfloader_load(fd);
   if(err == ELFLOADER_OK) {
     PRINTF(("codeprop: starting %s\n",
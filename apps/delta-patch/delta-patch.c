@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Streaming binary patch applier.
+ *
+ *      The patch is parsed one byte at a time by a small state machine,
+ *      so that it can be fed straight from incoming packets. Operation
+ *      arguments are collected in the header buffer. COPY operations
+ *      are carried out as soon as their arguments are complete, and ADD
+ *      data is written to the new image as it arrives.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "lib/crc16.h"
+#include "delta-patch.h"
+
+#include <string.h>
+
+#define STATE_HEADER     0
+#define STATE_OP         1
+#define STATE_COPY_ARGS  2
+#define STATE_ADD_ARGS   3
+#define STATE_ADD_DATA   4
+
+#define COPY_ARGS_SIZE   6
+#define ADD_ARGS_SIZE    2
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+    ((uint32_t)p[2] << 8) | p[3];
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get16(const uint8_t *p)
+{
+  return ((uint16_t)p[0] << 8) | p[1];
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_new(struct delta_patch *p, const uint8_t *data, uint16_t len)
+{
+  if(cfs_write(p->newfd, data, len) != len) {
+    return DELTA_PATCH_IO_ERROR;
+  }
+  p->crc = crc16_data(data, len, p->crc);
+  p->written += len;
+  return DELTA_PATCH_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_header(struct delta_patch *p)
+{
+  uint8_t buf[DELTA_PATCH_BUFSIZE];
+  uint32_t left;
+  uint16_t crc;
+  int n;
+
+  if(p->hdr[0] != 'D' || p->hdr[1] != 'P' ||
+     p->hdr[2] != DELTA_PATCH_VERSION) {
+    return DELTA_PATCH_BAD_HEADER;
+  }
+  p->old_len = get32(&p->hdr[4]);
+  p->new_len = get32(&p->hdr[10]);
+  p->new_crc = get16(&p->hdr[14]);
+
+  /* The old image may be followed by stale data, so only its first
+     old_len bytes are checked. */
+  if(cfs_seek(p->oldfd, 0, CFS_SEEK_SET) != 0) {
+    return DELTA_PATCH_IO_ERROR;
+  }
+  crc = 0;
+  for(left = p->old_len; left > 0; left -= n) {
+    n = left < sizeof(buf) ? left : sizeof(buf);
+    if(cfs_read(p->oldfd, buf, n) != n) {
+      return DELTA_PATCH_WRONG_BASE;
+    }
+    crc = crc16_data(buf, n, crc);
+  }
+  if(crc != get16(&p->hdr[8])) {
+    return DELTA_PATCH_WRONG_BASE;
+  }
+  PRINTF("delta-patch: %lu -> %lu bytes\n",
+         (unsigned long)p->old_len, (unsigned long)p->new_len);
+  return DELTA_PATCH_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+copy(struct delta_patch *p)
+{
+  uint8_t buf[DELTA_PATCH_BUFSIZE];
+  int n, err;
+
+  if(p->offset > p->old_len || p->count > p->old_len - p->offset ||
+     p->count > p->new_len - p->written) {
+    return DELTA_PATCH_BAD_OP;
+  }
+  if(cfs_seek(p->oldfd, p->offset, CFS_SEEK_SET) != p->offset) {
+    return DELTA_PATCH_IO_ERROR;
+  }
+  for(; p->count > 0; p->count -= n) {
+    n = p->count < sizeof(buf) ? p->count : sizeof(buf);
+    if(cfs_read(p->oldfd, buf, n) != n) {
+      return DELTA_PATCH_IO_ERROR;
+    }
+    err = write_new(p, buf, n);
+    if(err != DELTA_PATCH_OK) {
+      return err;
+    }
+  }
+  return DELTA_PATCH_OK;
+}
+/*---------------------------------------------------------------------------*/
+/* Collect header or argument bytes; returns the number of bytes used. */
+static uint16_t
+collect(struct delta_patch *p, const uint8_t *data, uint16_t len, uint8_t size)
+{
+  uint16_t n;
+
+  n = size - p->hdrlen;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(&p->hdr[p->hdrlen], data, n);
+  p->hdrlen += n;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+void
+delta_patch_init(struct delta_patch *p, int oldfd, int newfd)
+{
+  memset(p, 0, sizeof(*p));
+  p->oldfd = oldfd;
+  p->newfd = newfd;
+  p->state = STATE_HEADER;
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_patch_input(struct delta_patch *p, const uint8_t *data, uint16_t len)
+{
+  uint16_t n;
+
+  while(len > 0 && p->error == DELTA_PATCH_OK) {
+    switch(p->state) {
+    case STATE_HEADER:
+      n = collect(p, data, len, DELTA_PATCH_HEADER_SIZE);
+      if(p->hdrlen == DELTA_PATCH_HEADER_SIZE) {
+        p->error = check_header(p);
+        p->state = STATE_OP;
+      }
+      break;
+
+    case STATE_OP:
+      n = 1;
+      p->hdrlen = 0;
+      if(*data == DELTA_PATCH_OP_COPY) {
+        p->state = STATE_COPY_ARGS;
+      } else if(*data == DELTA_PATCH_OP_ADD) {
+        p->state = STATE_ADD_ARGS;
+      } else {
+        p->error = DELTA_PATCH_BAD_OP;
+      }
+      break;
+
+    case STATE_COPY_ARGS:
+      n = collect(p, data, len, COPY_ARGS_SIZE);
+      if(p->hdrlen == COPY_ARGS_SIZE) {
+        p->offset = get32(&p->hdr[0]);
+        p->count = get16(&p->hdr[4]);
+        p->error = copy(p);
+        p->state = STATE_OP;
+      }
+      break;
+
+    case STATE_ADD_ARGS:
+      n = collect(p, data, len, ADD_ARGS_SIZE);
+      if(p->hdrlen == ADD_ARGS_SIZE) {
+        p->count = get16(&p->hdr[0]);
+        if(p->count > p->new_len - p->written) {
+          p->error = DELTA_PATCH_BAD_OP;
+        }
+        p->state = p->count > 0 ? STATE_ADD_DATA : STATE_OP;
+      }
+      break;
+
+    default: /* STATE_ADD_DATA */
+      n = len < p->count ? len : p->count;
+      p->error = write_new(p, data, n);
+      p->count -= n;
+      if(p->count == 0) {
+        p->state = STATE_OP;
+      }
+      break;
+    }
+    data += n;
+    len -= n;
+  }
+  return p->error;
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_patch_finish(struct delta_patch *p)
+{
+  if(p->error != DELTA_PATCH_OK) {
+    return p->error;
+  }
+  if(p->state == STATE_HEADER) {
+    return DELTA_PATCH_BAD_HEADER;
+  }
+  if(p->state != STATE_OP || p->written != p->new_len ||
+     p->crc != p->new_crc) {
+    return DELTA_PATCH_BAD_RESULT;
+  }
+  return DELTA_PATCH_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+delta_patch_file(int patchfd, int oldfd, int newfd)
+{
+  struct delta_patch p;
+  uint8_t buf[DELTA_PATCH_BUFSIZE];
+  int n;
+
+  delta_patch_init(&p, oldfd, newfd);
+  while((n = cfs_read(patchfd, buf, sizeof(buf))) > 0) {
+    if(delta_patch_input(&p, buf, n) != DELTA_PATCH_OK) {
+      break;
+    }
+  }
+  return delta_patch_finish(&p);
+}
+/*---------------------------------------------------------------------------*/
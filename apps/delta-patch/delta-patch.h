@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Apply binary patches to files in CFS.
+ *
+ *      A patch describes a new image as a sequence of COPY operations,
+ *      which take a range of bytes from the old image, and ADD
+ *      operations, which carry literal bytes. The patch is consumed as
+ *      a stream: the old image is read and the new one is written
+ *      through a small buffer, so neither image has to fit in RAM.
+ *      Patches are produced on the host with tools/codeprop-diff.
+ *
+ *      All fields are big-endian. The header is
+ *
+ *        "DP" version(1) 0 old_len(4) old_crc(2) new_len(4) new_crc(2)
+ *
+ *      where the CRCs are computed with crc16_data() over the whole
+ *      image, followed by the operations
+ *
+ *        0x01 offset(4) len(2)    copy len bytes from the old image
+ *        0x02 len(2) data(len)    append len literal bytes
+ */
+
+#ifndef DELTA_PATCH_H_
+#define DELTA_PATCH_H_
+
+#include "contiki.h"
+
+#ifdef DELTA_PATCH_CONF_BUFSIZE
+#define DELTA_PATCH_BUFSIZE DELTA_PATCH_CONF_BUFSIZE
+#else /* DELTA_PATCH_CONF_BUFSIZE */
+#define DELTA_PATCH_BUFSIZE 64
+#endif /* DELTA_PATCH_CONF_BUFSIZE */
+
+#define DELTA_PATCH_VERSION     1
+#define DELTA_PATCH_HEADER_SIZE 16
+
+#define DELTA_PATCH_OP_COPY     0x01
+#define DELTA_PATCH_OP_ADD      0x02
+
+#define DELTA_PATCH_OK          0
+#define DELTA_PATCH_BAD_HEADER  1  /* not a patch or unknown version */
+#define DELTA_PATCH_WRONG_BASE  2  /* old image does not match the patch */
+#define DELTA_PATCH_BAD_OP      3  /* corrupt or out of range operation */
+#define DELTA_PATCH_IO_ERROR    4  /* CFS read or write failed */
+#define DELTA_PATCH_BAD_RESULT  5  /* new image has wrong length or CRC */
+
+struct delta_patch {
+  int oldfd, newfd;
+  uint32_t old_len, new_len;
+  uint32_t written;
+  uint32_t offset;
+  uint16_t count;
+  uint16_t new_crc, crc;
+  uint8_t state;
+  uint8_t error;
+  uint8_t hdrlen;
+  uint8_t hdr[DELTA_PATCH_HEADER_SIZE];
+};
+
+/**
+ * \brief      Prepare to apply a patch
+ * \param p    The patch state
+ * \param oldfd A file descriptor of the old image, opened for reading
+ * \param newfd A file descriptor of the new image, opened for writing
+ *
+ *             The new image is written sequentially from the current
+ *             position of newfd, which normally is an empty file.
+ */
+void delta_patch_init(struct delta_patch *p, int oldfd, int newfd);
+
+/**
+ * \brief      Feed the next part of a patch
+ * \param p    The patch state
+ * \param data The patch data
+ * \param len  The length of the data
+ * \return     DELTA_PATCH_OK, or an error code
+ *
+ *             The patch may be split at any byte boundary. The old
+ *             image is checked against the patch header as soon as
+ *             the header is complete. Once an error has been
+ *             returned, the same error is returned for all remaining
+ *             input.
+ */
+int delta_patch_input(struct delta_patch *p, const uint8_t *data,
+                      uint16_t len);
+
+/**
+ * \brief      Check that the whole new image has been written
+ * \param p    The patch state
+ * \return     DELTA_PATCH_OK if the new image has the length and CRC
+ *             given in the patch header, otherwise an error code
+ */
+int delta_patch_finish(struct delta_patch *p);
+
+/**
+ * \brief      Apply a patch stored in a file
+ * \param patchfd A file descriptor of the patch, opened for reading
+ * \param oldfd A file descriptor of the old image, opened for reading
+ * \param newfd A file descriptor of the new image, opened for writing
+ * \return     DELTA_PATCH_OK, or an error code
+ *
+ *             This is used after a patch has been received as an
+ *             ordinary file, for instance with rudolph0, rudolph1 or
+ *             rudolph2.
+ */
+int delta_patch_file(int patchfd, int oldfd, int newfd);
+
+#endif /* DELTA_PATCH_H_ */
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Server-side cache of CoAP GET responses.
+ */
+
+#include <string.h>
+#include "sys/clock.h"
+#include "er-coap-cache.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#if COAP_RESPONSE_CACHE_SIZE
+
+#define FLAG_USED           0x01
+#define FLAG_CONTENT_FORMAT 0x02
+#define FLAG_ACCEPT         0x04
+
+struct coap_cache_entry {
+  unsigned long expires;        /* clock_seconds() at which Max-Age runs out */
+  uint16_t content_format;
+  uint16_t accept;
+  uint16_t payload_len;
+  uint8_t flags;
+  uint8_t path_len;
+  uint8_t query_len;
+  uint8_t etag_len;
+  uint8_t etag[COAP_ETAG_LEN];
+  char url[COAP_RESPONSE_CACHE_URL_LEN];        /* path followed by query */
+  uint8_t payload[COAP_RESPONSE_CACHE_PAYLOAD_LEN];
+};
+
+static struct coap_cache_entry cache[COAP_RESPONSE_CACHE_SIZE];
+
+/*---------------------------------------------------------------------------*/
+static int
+is_cacheable_request(coap_packet_t *request)
+{
+  return request->code == COAP_GET
+         && !IS_OPTION(request, COAP_OPTION_OBSERVE)
+         && !IS_OPTION(request, COAP_OPTION_BLOCK1)
+         && !IS_OPTION(request, COAP_OPTION_BLOCK2)
+         && request->uri_path_len <= COAP_RESPONSE_CACHE_URL_LEN
+         && request->uri_query_len <=
+         COAP_RESPONSE_CACHE_URL_LEN - request->uri_path_len;
+}
+/*---------------------------------------------------------------------------*/
+static struct coap_cache_entry *
+lookup(coap_packet_t *request)
+{
+  struct coap_cache_entry *e;
+  uint8_t accept_flag;
+
+  accept_flag = IS_OPTION(request, COAP_OPTION_ACCEPT) ? FLAG_ACCEPT : 0;
+  for(e = cache; e < &cache[COAP_RESPONSE_CACHE_SIZE]; e++) {
+    if((e->flags & FLAG_USED)
+       && e->path_len == request->uri_path_len
+       && e->query_len == request->uri_query_len
+       && (e->flags & FLAG_ACCEPT) == accept_flag
+       && (!accept_flag || e->accept == request->accept)
+       && memcmp(e->url, request->uri_path, e->path_len) == 0
+       && memcmp(e->url + e->path_len, request->uri_query,
+                 e->query_len) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_expired(struct coap_cache_entry *e, unsigned long now)
+{
+  return (long)(e->expires - now) <= 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_cache_get(coap_packet_t *request, coap_packet_t *response)
+{
+  struct coap_cache_entry *e;
+  unsigned long now;
+
+  if(!is_cacheable_request(request) || (e = lookup(request)) == NULL) {
+    return 0;
+  }
+
+  now = clock_seconds();
+  if(is_expired(e, now)) {
+    e->flags = 0;
+    return 0;
+  }
+
+  coap_set_header_max_age(response, e->expires - now);
+  if(e->etag_len) {
+    coap_set_header_etag(response, e->etag, e->etag_len);
+  }
+
+  if(e->etag_len
+     && IS_OPTION(request, COAP_OPTION_ETAG)
+     && request->etag_len == e->etag_len
+     && memcmp(request->etag, e->etag, e->etag_len) == 0) {
+    PRINTF("CoAP cache: valid %.*s\n", e->path_len, e->url);
+    coap_set_status_code(response, VALID_2_03);
+    return 1;
+  }
+
+  PRINTF("CoAP cache: hit %.*s\n", e->path_len, e->url);
+  coap_set_status_code(response, CONTENT_2_05);
+  if(e->flags & FLAG_CONTENT_FORMAT) {
+    coap_set_header_content_format(response, e->content_format);
+  }
+  coap_set_payload(response, e->payload, e->payload_len);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_cache_put(coap_packet_t *request, coap_packet_t *response)
+{
+  struct coap_cache_entry *e;
+  struct coap_cache_entry *victim;
+  unsigned long now;
+
+  /* Only plain 2.05 responses with an explicit freshness lifetime and no
+     options that the cache would not reproduce */
+  if(!is_cacheable_request(request)
+     || response->code != CONTENT_2_05
+     || !IS_OPTION(response, COAP_OPTION_MAX_AGE)
+     || response->max_age == 0
+     || IS_OPTION(response, COAP_OPTION_OBSERVE)
+     || IS_OPTION(response, COAP_OPTION_BLOCK1)
+     || IS_OPTION(response, COAP_OPTION_BLOCK2)
+     || IS_OPTION(response, COAP_OPTION_SIZE2)
+     || IS_OPTION(response, COAP_OPTION_LOCATION_PATH)
+     || IS_OPTION(response, COAP_OPTION_LOCATION_QUERY)
+     || response->payload_len > COAP_RESPONSE_CACHE_PAYLOAD_LEN) {
+    return;
+  }
+
+  now = clock_seconds();
+  victim = lookup(request);
+  if(victim == NULL) {
+    /* Take a free or expired slot, else the one closest to expiry */
+    victim = &cache[0];
+    for(e = cache; e < &cache[COAP_RESPONSE_CACHE_SIZE]; e++) {
+      if(!(e->flags & FLAG_USED) || is_expired(e, now)) {
+        victim = e;
+        break;
+      }
+      if((long)(e->expires - victim->expires) < 0) {
+        victim = e;
+      }
+    }
+  }
+
+  PRINTF("CoAP cache: store %.*s for %lus\n", (int)request->uri_path_len,
+         request->uri_path, (unsigned long)response->max_age);
+
+  victim->flags = FLAG_USED;
+  victim->expires = now + response->max_age;
+  if(IS_OPTION(response, COAP_OPTION_CONTENT_FORMAT)) {
+    victim->flags |= FLAG_CONTENT_FORMAT;
+    victim->content_format = response->content_format;
+  }
+  if(IS_OPTION(request, COAP_OPTION_ACCEPT)) {
+    victim->flags |= FLAG_ACCEPT;
+    victim->accept = request->accept;
+  }
+  victim->etag_len = 0;
+  if(IS_OPTION(response, COAP_OPTION_ETAG)) {
+    victim->etag_len = response->etag_len;
+    memcpy(victim->etag, response->etag, response->etag_len);
+  }
+  victim->path_len = request->uri_path_len;
+  victim->query_len = request->uri_query_len;
+  memcpy(victim->url, request->uri_path, victim->path_len);
+  memcpy(victim->url + victim->path_len, request->uri_query,
+         victim->query_len);
+  victim->payload_len = response->payload_len;
+  memcpy(victim->payload, response->payload, response->payload_len);
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_cache_invalidate(const char *url, size_t url_len)
+{
+  struct coap_cache_entry *e;
+
+  for(e = cache; e < &cache[COAP_RESPONSE_CACHE_SIZE]; e++) {
+    if((e->flags & FLAG_USED) && e->path_len >= url_len
+       && memcmp(e->url, url, url_len) == 0) {
+      e->flags = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* COAP_RESPONSE_CACHE_SIZE */
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      CoAP resources backed by CFS files.
+ */
+
+#include <string.h>
+#include "cfs/cfs.h"
+#include "er-coap.h"
+#include "er-coap-cfs.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* The file currently being transferred. pos is the offset of the next
+   byte to hand out, which is the read-ahead byte if there is one. */
+static struct {
+  const char *name;
+  int fd;
+  int flags;
+  cfs_offset_t pos;
+  uint8_t lookahead;
+  uint8_t has_lookahead;
+} file = { NULL, -1, 0, 0, 0, 0 };
+
+/*---------------------------------------------------------------------------*/
+static void
+close_file(void)
+{
+  if(file.fd >= 0) {
+    cfs_close(file.fd);
+    file.fd = -1;
+  }
+  file.name = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_open(const char *name, int flags)
+{
+  return file.fd >= 0 && file.flags == flags
+         && (file.name == name || strcmp(file.name, name) == 0);
+}
+/*---------------------------------------------------------------------------*/
+static int
+open_file(const char *name, int flags)
+{
+  close_file();
+  file.fd = cfs_open(name, flags);
+  if(file.fd < 0) {
+    return 0;
+  }
+  file.name = name;
+  file.flags = flags;
+  file.pos = 0;
+  file.has_lookahead = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_error(void *response, unsigned int code, const char *msg)
+{
+  coap_set_status_code(response, code);
+  coap_set_payload(response, msg, strlen(msg));
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_cfs_get_handler(void *request, void *response, const char *name,
+                     uint8_t *buffer, uint16_t preferred_size,
+                     int32_t *offset)
+{
+  int len = 0;
+  int n;
+
+  if(!is_open(name, CFS_READ) && !open_file(name, CFS_READ)) {
+    set_error(response, NOT_FOUND_4_04, "NoFile");
+    return;
+  }
+
+  if(file.pos != *offset) {
+    PRINTF("CoAP CFS: seek %s to %ld\n", name, (long)*offset);
+    file.has_lookahead = 0;
+    file.pos = cfs_seek(file.fd, *offset, CFS_SEEK_SET);
+    if(file.pos != *offset) {
+      close_file();
+      set_error(response, BAD_OPTION_4_02, "BlockOutOfScope");
+      return;
+    }
+  }
+
+  if(file.has_lookahead) {
+    buffer[0] = file.lookahead;
+    len = 1;
+  }
+  /* one byte more than requested tells whether another block follows */
+  n = cfs_read(file.fd, buffer + len, preferred_size + 1 - len);
+  if(n > 0) {
+    len += n;
+  }
+
+  if(len > preferred_size) {
+    file.lookahead = buffer[preferred_size];
+    file.has_lookahead = 1;
+    len = preferred_size;
+    file.pos += len;
+    *offset += len;
+  } else {
+    if(len == 0 && *offset > 0) {
+      close_file();
+      set_error(response, BAD_OPTION_4_02, "BlockOutOfScope");
+      return;
+    }
+    /* end of file, the transfer is complete */
+    close_file();
+    *offset = -1;
+  }
+
+  coap_set_payload(response, buffer, len);
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_cfs_put_handler(void *request, void *response, const char *name)
+{
+  coap_packet_t *const packet = (coap_packet_t *)request;
+  const uint8_t *payload = NULL;
+  uint32_t offset = 0;
+  uint8_t more = 0;
+  int len;
+
+  len = coap_get_payload(request, &payload);
+  if(IS_OPTION(packet, COAP_OPTION_BLOCK1)) {
+    offset = packet->block1_offset;
+    more = packet->block1_more;
+  }
+
+  if(offset == 0) {
+    /* a new upload replaces the file */
+    close_file();
+    cfs_remove(name);
+    if(!open_file(name, CFS_WRITE)) {
+      set_error(response, INTERNAL_SERVER_ERROR_5_00, "NoFile");
+      return -1;
+    }
+  } else if(!is_open(name, CFS_WRITE | CFS_APPEND)) {
+    if(!open_file(name, CFS_WRITE | CFS_APPEND)) {
+      set_error(response, INTERNAL_SERVER_ERROR_5_00, "NoFile");
+      return -1;
+    }
+    file.pos = cfs_seek(file.fd, 0, CFS_SEEK_END);
+  }
+
+  if(offset > file.pos) {
+    /* a block is missing */
+    set_error(response, REQUEST_ENTITY_INCOMPLETE_4_08, "MissingBlock");
+    return -1;
+  }
+
+  if(offset + len > file.pos) {
+    int skip = file.pos - offset;       /* already written by a retransmission */
+
+    if(cfs_write(file.fd, payload + skip, len - skip) != len - skip) {
+      close_file();
+      set_error(response, INTERNAL_SERVER_ERROR_5_00, "WriteFailed");
+      return -1;
+    }
+    file.pos += len - skip;
+  }
+
+  if(IS_OPTION(packet, COAP_OPTION_BLOCK1)) {
+    coap_set_header_block1(response, packet->block1_num, more,
+                           packet->block1_size);
+  }
+  if(more) {
+    coap_set_status_code(response, CONTINUE_2_31);
+    return 1;
+  }
+
+  PRINTF("CoAP CFS: wrote %s (%ld bytes)\n", name, (long)file.pos);
+  close_file();
+  coap_set_status_code(response, CHANGED_2_04);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      CoAP resources backed by CFS files.
+ *
+ *      GET streams the file with Block2, reading each block straight into
+ *      the response buffer. The file is kept open between blocks and one
+ *      byte is read ahead, so a sequential transfer needs neither a seek
+ *      per block nor an extra empty block at the end. PUT writes the file
+ *      from Block1 requests, which must arrive in order; retransmitted
+ *      blocks are acknowledged without being written again.
+ */
+
+#ifndef ER_COAP_CFS_H_
+#define ER_COAP_CFS_H_
+
+#include "rest-engine.h"
+
+/*
+ * GET handler body for a CFS file. buffer must hold preferred_size + 1
+ * bytes, as the buffer the engine passes to resource handlers does.
+ */
+void coap_cfs_get_handler(void *request, void *response, const char *name,
+                          uint8_t *buffer, uint16_t preferred_size,
+                          int32_t *offset);
+
+/*
+ * PUT/POST handler body for a CFS file. Returns 1 while more blocks are
+ * expected, 0 when the file is complete and -1 on error.
+ */
+int coap_cfs_put_handler(void *request, void *response, const char *name);
+
+/*
+ * Macro to define a resource serving the CFS file filename, which is
+ * readable with GET and replaced with PUT.
+ */
+#define CFS_RESOURCE(name, attributes, filename) \
+  static void \
+  name##_get_handler(void *request, void *response, uint8_t *buffer, \
+                     uint16_t preferred_size, int32_t *offset) \
+  { \
+    coap_cfs_get_handler(request, response, filename, buffer, \
+                         preferred_size, offset); \
+  } \
+  static void \
+  name##_put_handler(void *request, void *response, uint8_t *buffer, \
+                     uint16_t preferred_size, int32_t *offset) \
+  { \
+    coap_cfs_put_handler(request, response, filename); \
+  } \
+  RESOURCE(name, attributes, name##_get_handler, NULL, name##_put_handler, \
+           NULL)
+
+#endif /* ER_COAP_CFS_H_ */
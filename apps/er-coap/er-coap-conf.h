@@ -53,6 +53,12 @@
 #define COAP_MAX_OPEN_TRANSACTIONS     4
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
+/* Take transactions from the shared slab allocator (lib/slab.h) instead of a
+   reserved memb, with COAP_MAX_OPEN_TRANSACTIONS as a quota. */
+#ifndef COAP_WITH_SLAB
+#define COAP_WITH_SLAB                 0
+#endif /* COAP_WITH_SLAB */
+
 /* Maximum number of failed request attempts before action */
 #ifndef COAP_MAX_ATTEMPTS
 #define COAP_MAX_ATTEMPTS              4
@@ -68,6 +74,21 @@
 #define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS - 1
 #endif /* COAP_MAX_OBSERVERS */
 
+/* Number of GET responses kept in the server-side response cache, 0 to
+   disable. Only responses for which the resource sets a Max-Age are cached. */
+#ifndef COAP_RESPONSE_CACHE_SIZE
+#define COAP_RESPONSE_CACHE_SIZE       0
+#endif /* COAP_RESPONSE_CACHE_SIZE */
+
+/* Longest URI path plus query and payload a cache entry can hold */
+#ifndef COAP_RESPONSE_CACHE_URL_LEN
+#define COAP_RESPONSE_CACHE_URL_LEN    32
+#endif /* COAP_RESPONSE_CACHE_URL_LEN */
+
+#ifndef COAP_RESPONSE_CACHE_PAYLOAD_LEN
+#define COAP_RESPONSE_CACHE_PAYLOAD_LEN 64
+#endif /* COAP_RESPONSE_CACHE_PAYLOAD_LEN */
+
 /* Interval in notifies in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVE_REFRESH_INTERVAL  20
 
@@ -54,6 +54,11 @@
 #define PRINTLLADDR(addr)
 #endif
 
+/* A payload still pointing into the request cannot be serialized in place */
+#define PAYLOAD_IN_UIP_BUF(pkt) ((pkt)->payload_len > 0 \
+                                 && (pkt)->payload >= uip_buf \
+                                 && (pkt)->payload < uip_buf + UIP_BUFSIZE)
+
 PROCESS(coap_engine, "CoAP Engine");
 
 /*---------------------------------------------------------------------------*/
@@ -130,9 +135,21 @@ coap_receive(void)
             new_offset = block_offset;
           }
 
+#if COAP_RESPONSE_CACHE_SIZE
+          /* the resource may change, so its cached representation is stale */
+          if(message->code != COAP_GET) {
+            coap_cache_invalidate(message->uri_path, message->uri_path_len);
+          }
+#endif /* COAP_RESPONSE_CACHE_SIZE */
+
           /* invoke resource handler */
           if(service_cbk) {
 
+#if COAP_RESPONSE_CACHE_SIZE
+            if(coap_cache_get(message, response)) {
+              PRINTF("Served from response cache\n");
+            } else
+#endif /* COAP_RESPONSE_CACHE_SIZE */
             /* call REST framework and check if found and allowed */
             if(service_cbk
                  (message, response, transaction->packet + COAP_MAX_HEADER_SIZE,
@@ -203,15 +220,33 @@ coap_receive(void)
                                    MIN(response->payload_len,
                                        COAP_MAX_BLOCK_SIZE));
                 } /* blockwise transfer handling */
+#if COAP_RESPONSE_CACHE_SIZE
+                coap_cache_put(message, response);
+#endif /* COAP_RESPONSE_CACHE_SIZE */
               } /* no errors/hooks */
                 /* successful service callback */
                 /* serialize response */
             }
             if(erbium_status_code == NO_ERROR) {
-              if((transaction->packet_len = coap_serialize_message(response,
-                                                                   transaction->
-                                                                   packet)) ==
-                 0) {
+              if(response->type != COAP_TYPE_CON
+                 && !PAYLOAD_IN_UIP_BUF(response)) {
+                /* ACKs and NONs are never retransmitted, so serialize
+                   straight into the IPBUF and skip the copy out of the
+                   transaction buffer. This only overwrites request parts
+                   that are already parsed into the message struct. */
+                uint16_t len = coap_serialize_message(response, uip_appdata);
+
+                if(len == 0) {
+                  erbium_status_code = PACKET_SERIALIZATION_ERROR;
+                } else {
+                  coap_send_message(&UIP_IP_BUF->srcipaddr,
+                                    UIP_UDP_BUF->srcport, uip_appdata, len);
+                  coap_clear_transaction(transaction);
+                  transaction = NULL;
+                }
+              } else if((transaction->packet_len =
+                           coap_serialize_message(response,
+                                                  transaction->packet)) == 0) {
                 erbium_status_code = PACKET_SERIALIZATION_ERROR;
               }
             }
@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "er-coap-observe.h"
+#include "er-coap-cache.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -180,6 +181,32 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 /*---------------------------------------------------------------------------*/
 /*- Notification ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+/* Adds the per-observer header fields to a notification and sends it */
+static void
+send_notification(coap_packet_t *notification, coap_observer_t *obs,
+                  coap_transaction_t *transaction)
+{
+  if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
+    PRINTF("           Force Confirmable for %u\n", transaction->mid);
+    notification->type = COAP_TYPE_CON;
+  } else {
+    notification->type = COAP_TYPE_NON;
+  }
+  notification->mid = transaction->mid;
+
+  if(notification->code < BAD_REQUEST_4_00) {
+    coap_set_header_observe(notification, (obs->obs_counter)++);
+    /* mask out to keep the CoAP observe option length <= 3 bytes */
+    obs->obs_counter &= 0xffffff;
+  }
+  coap_set_token(notification, obs->token, obs->token_len);
+
+  transaction->packet_len =
+    coap_serialize_message(notification, transaction->packet);
+
+  coap_send_transaction(transaction);
+}
+/*---------------------------------------------------------------------------*/
 void
 coap_notify_observers(resource_t *resource)
 {
@@ -192,6 +219,8 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   coap_packet_t notification[1]; /* this way the packet can be treated as pointer as usual */
   coap_packet_t request[1]; /* this way the packet can be treated as pointer as usual */
   coap_observer_t *obs = NULL;
+  coap_observer_t *payload_obs = NULL;
+  coap_transaction_t *payload_transaction = NULL;
   int url_len, obs_url_len;
   char url[COAP_OBSERVER_URL_LEN];
 
@@ -205,6 +234,11 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
   /* url now contains the notify URL that needs to match the observer */
   PRINTF("Observe: Notification from %s\n", url);
 
+#if COAP_RESPONSE_CACHE_SIZE
+  /* the resource changed state, so cached representations are stale */
+  coap_cache_invalidate(url, strlen(url));
+#endif /* COAP_RESPONSE_CACHE_SIZE */
+
   coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
   /* create a "fake" request for the URI */
   coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
@@ -228,11 +262,6 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
       /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
 
       if((transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port))) {
-        if(obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0) {
-          PRINTF("           Force Confirmable for\n");
-          notification->type = COAP_TYPE_CON;
-        }
-
         PRINTF("           Observer ");
         PRINT6ADDR(&obs->addr);
         PRINTF(":%u\n", obs->port);
@@ -240,27 +269,25 @@ coap_notify_observers_sub(resource_t *resource, const char *subpath)
         /* update last MID for RST matching */
         obs->last_mid = transaction->mid;
 
-        /* prepare response */
-        notification->mid = transaction->mid;
-
-        resource->get_handler(request, notification,
-                              transaction->packet + COAP_MAX_HEADER_SIZE,
-                              REST_MAX_CHUNK_SIZE, NULL);
-
-        if(notification->code < BAD_REQUEST_4_00) {
-          coap_set_header_observe(notification, (obs->obs_counter)++);
-          /* mask out to keep the CoAP observe option length <= 3 bytes */
-          obs->obs_counter &= 0xffffff;
+        if(payload_transaction == NULL) {
+          /* the representation is the same for all observers, so the
+             handler runs once and its payload stays in this transaction's
+             buffer until the other observers have been served */
+          resource->get_handler(request, notification,
+                                transaction->packet + COAP_MAX_HEADER_SIZE,
+                                REST_MAX_CHUNK_SIZE, NULL);
+          payload_transaction = transaction;
+          payload_obs = obs;
+        } else {
+          send_notification(notification, obs, transaction);
         }
-        coap_set_token(notification, obs->token, obs->token_len);
-
-        transaction->packet_len =
-          coap_serialize_message(notification, transaction->packet);
-
-        coap_send_transaction(transaction);
       }
     }
   }
+
+  if(payload_transaction != NULL) {
+    send_notification(notification, payload_obs, payload_transaction);
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -41,6 +41,17 @@
 #include "er-coap-transactions.h"
 #include "er-coap-observe.h"
 
+#if COAP_WITH_SLAB
+#include "lib/slab.h"
+#define TRANSACTIONS_MEMB SLAB_OWNER
+#define transactions_memb_alloc slab_alloc
+#define transactions_memb_free slab_free
+#else /* COAP_WITH_SLAB */
+#define TRANSACTIONS_MEMB MEMB
+#define transactions_memb_alloc memb_alloc
+#define transactions_memb_free memb_free
+#endif /* COAP_WITH_SLAB */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -54,11 +65,115 @@
 #endif
 
 /*---------------------------------------------------------------------------*/
-MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
+TRANSACTIONS_MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
 LIST(transactions_list);
 
 static struct process *transaction_handler_process = NULL;
 
+/* Transactions awaiting retransmission, kept as a binary min-heap on their
+ * deadline, and the single etimer that fires at the earliest one */
+static coap_transaction_t *retrans_queue[COAP_MAX_OPEN_TRANSACTIONS];
+static uint8_t retrans_queue_len;
+static struct etimer retrans_timer;
+
+#define NOT_QUEUED 0xff
+/* Is clock time a before b? */
+#define TIME_BEFORE(a, b) ((clock_time_t)((a) - (b)) > ((clock_time_t)~0 >> 1))
+
+/*---------------------------------------------------------------------------*/
+static void
+queue_swap(uint8_t i, uint8_t j)
+{
+  coap_transaction_t *t = retrans_queue[i];
+
+  retrans_queue[i] = retrans_queue[j];
+  retrans_queue[j] = t;
+  retrans_queue[i]->queue_index = i;
+  retrans_queue[j]->queue_index = j;
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_sift_up(uint8_t i)
+{
+  while(i > 0 && TIME_BEFORE(retrans_queue[i]->retrans_deadline,
+                             retrans_queue[(i - 1) / 2]->retrans_deadline)) {
+    queue_swap(i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_sift_down(uint8_t i)
+{
+  uint8_t child;
+
+  while((child = 2 * i + 1) < retrans_queue_len) {
+    if(child + 1 < retrans_queue_len
+       && TIME_BEFORE(retrans_queue[child + 1]->retrans_deadline,
+                      retrans_queue[child]->retrans_deadline)) {
+      child++;
+    }
+    if(!TIME_BEFORE(retrans_queue[child]->retrans_deadline,
+                    retrans_queue[i]->retrans_deadline)) {
+      break;
+    }
+    queue_swap(i, child);
+    i = child;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* (Re)arms the etimer for the earliest deadline in the queue */
+static void
+queue_arm_timer(void)
+{
+  clock_time_t now;
+  clock_time_t deadline;
+
+  if(retrans_queue_len == 0) {
+    etimer_stop(&retrans_timer);
+    return;
+  }
+
+  now = clock_time();
+  deadline = retrans_queue[0]->retrans_deadline;
+  PROCESS_CONTEXT_BEGIN(transaction_handler_process);
+  etimer_set(&retrans_timer, TIME_BEFORE(now, deadline) ? deadline - now : 0);
+  PROCESS_CONTEXT_END(transaction_handler_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_insert(coap_transaction_t *t)
+{
+  t->queue_index = retrans_queue_len;
+  retrans_queue[retrans_queue_len++] = t;
+  queue_sift_up(t->queue_index);
+  if(t->queue_index == 0) {
+    queue_arm_timer();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_remove(coap_transaction_t *t)
+{
+  uint8_t i = t->queue_index;
+
+  if(i == NOT_QUEUED) {
+    return;
+  }
+  t->queue_index = NOT_QUEUED;
+
+  if(--retrans_queue_len != i) {
+    coap_transaction_t *moved = retrans_queue[retrans_queue_len];
+
+    retrans_queue[i] = moved;
+    moved->queue_index = i;
+    queue_sift_up(i);
+    queue_sift_down(moved->queue_index);
+  }
+  if(i == 0) {
+    queue_arm_timer();
+  }
+}
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -70,11 +185,12 @@ coap_register_as_transaction_handler()
 coap_transaction_t *
 coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
 {
-  coap_transaction_t *t = memb_alloc(&transactions_memb);
+  coap_transaction_t *t = transactions_memb_alloc(&transactions_memb);
 
   if(t) {
     t->mid = mid;
     t->retrans_counter = 0;
+    t->queue_index = NOT_QUEUED;
 
     /* save client address */
     uip_ipaddr_copy(&t->addr, addr);
@@ -100,22 +216,22 @@ coap_send_transaction(coap_transaction_t *t)
       PRINTF("Keeping transaction %u\n", t->mid);
 
       if(t->retrans_counter == 0) {
-        t->retrans_timer.timer.interval =
+        t->retrans_interval =
           COAP_RESPONSE_TIMEOUT_TICKS + (random_rand()
                                          %
                                          (clock_time_t)
                                          COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
         PRINTF("Initial interval %f\n",
-               (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
+               (float)t->retrans_interval / CLOCK_SECOND);
       } else {
-        t->retrans_timer.timer.interval <<= 1;  /* double */
+        t->retrans_interval <<= 1;  /* double */
         PRINTF("Doubled (%u) interval %f\n", t->retrans_counter,
-               (float)t->retrans_timer.timer.interval / CLOCK_SECOND);
+               (float)t->retrans_interval / CLOCK_SECOND);
       }
 
-      PROCESS_CONTEXT_BEGIN(transaction_handler_process);
-      etimer_restart(&t->retrans_timer);        /* interval updated above */
-      PROCESS_CONTEXT_END(transaction_handler_process);
+      queue_remove(t);
+      t->retrans_deadline = clock_time() + t->retrans_interval;
+      queue_insert(t);
 
       t = NULL;
     } else {
@@ -144,9 +260,9 @@ coap_clear_transaction(coap_transaction_t *t)
   if(t) {
     PRINTF("Freeing transaction %u: %p\n", t->mid, t);
 
-    etimer_stop(&t->retrans_timer);
+    queue_remove(t);
     list_remove(transactions_list, t);
-    memb_free(&transactions_memb, t);
+    transactions_memb_free(&transactions_memb, t);
   }
 }
 coap_transaction_t *
@@ -167,13 +283,16 @@ void
 coap_check_transactions()
 {
   coap_transaction_t *t = NULL;
+  clock_time_t now = clock_time();
 
-  for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
-    if(etimer_expired(&t->retrans_timer)) {
-      ++(t->retrans_counter);
-      PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
-      coap_send_transaction(t);
-    }
+  /* Retransmitted transactions are queued again with a later deadline */
+  while(retrans_queue_len > 0
+        && !TIME_BEFORE(now, retrans_queue[0]->retrans_deadline)) {
+    t = retrans_queue[0];
+    queue_remove(t);
+    ++(t->retrans_counter);
+    PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
+    coap_send_transaction(t);
   }
 }
 /*---------------------------------------------------------------------------*/
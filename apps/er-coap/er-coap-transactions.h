@@ -53,8 +53,10 @@ typedef struct coap_transaction {
   struct coap_transaction *next;        /* for LIST */
 
   uint16_t mid;
-  struct etimer retrans_timer;
+  clock_time_t retrans_interval;        /* current retransmission timeout */
+  clock_time_t retrans_deadline;        /* time of the next retransmission */
   uint8_t retrans_counter;
+  uint8_t queue_index;                  /* position in the retransmission queue */
 
   uip_ipaddr_t addr;
   uint16_t port;
@@ -129,7 +129,7 @@ handle_periodic_timer(void *ptr)
   /* Only notify when the value has changed since last */
   if(read_temp(&v) && v != last_value) {
     last_value = v;
-    lwm2m_object_notify_observers(&temperature, "/0/5700");
+    lwm2m_object_notify_observers_value(&temperature, "/0/5700", v);
   }
   ctimer_reset(&periodic_timer);
 }
@@ -72,7 +72,9 @@ enum {
   JSON_ERROR_UNEXPECTED_END_OF_ARRAY,
   JSON_ERROR_UNEXPECTED_OBJECT,
   JSON_ERROR_UNEXPECTED_END_OF_OBJECT,
-  JSON_ERROR_UNEXPECTED_STRING
+  JSON_ERROR_UNEXPECTED_STRING,
+  JSON_ERROR_INCOMPLETE,        /* streaming: more input is needed */
+  JSON_ERROR_VALUE_TOO_LONG     /* streaming: a value does not fit the buffer */
 };
 
 #define JSON_CONTENT_TYPE "application/json"
@@ -134,6 +134,48 @@ skip_ws(struct jsonparse_state *state)
   }
 }
 /*--------------------------------------------------------------------*/
+/* when streaming, checks that the token at the current position is
+   complete within the input received so far */
+static int
+is_token_complete(struct jsonparse_state *state)
+{
+  const char *json = state->json;
+  int pos = state->pos;
+  char c;
+
+  if(state->size == 0 || state->final) {
+    return 1;
+  }
+  if(pos >= state->len) {
+    return 0;
+  }
+
+  c = json[pos++];
+  if(c == '"') {
+    for(; pos < state->len; pos++) {
+      if(json[pos] == '\\') {
+        pos++;
+      } else if(json[pos] == '"') {
+        return 1;
+      }
+    }
+    return 0;
+  } else if(c == '-' || (c >= '0' && c <= '9')) {
+    while(pos < state->len &&
+          ((json[pos] >= '0' && json[pos] <= '9') || json[pos] == '.')) {
+      pos++;
+    }
+    return pos < state->len;
+  } else if(c == 'n' || c == 't' || c == 'f') {
+    while(pos < state->len && (c = json[pos]) != ' ' &&
+          c != ',' && c != ']' && c != '}') {
+      pos++;
+    }
+    return pos < state->len;
+  }
+  return 1;
+}
+/*--------------------------------------------------------------------*/
 static int
 is_atomic(struct jsonparse_state *state)
 {
@@ -155,6 +197,47 @@ jsonparse_setup(struct jsonparse_state *state, const char *json, int len)
   state->error = 0;
   state->vtype = 0;
   state->stack[0] = 0;
+  state->size = 0;
+  state->final = 1;
+}
+/*--------------------------------------------------------------------*/
+void
+jsonparse_setup_stream(struct jsonparse_state *state, char *buf, int size)
+{
+  buf[0] = 0;
+  jsonparse_setup(state, buf, 0);
+  state->size = size;
+  state->final = 0;
+}
+/*--------------------------------------------------------------------*/
+int
+jsonparse_feed(struct jsonparse_state *state, const char *data, int len)
+{
+  char *buf = (char *)state->json;
+
+  if(data == NULL) {
+    state->final = 1;
+    len = 0;
+  } else {
+    /* drop what has been parsed to make room */
+    if(state->pos > 0) {
+      memmove(buf, buf + state->pos, state->len - state->pos);
+      state->len -= state->pos;
+      state->vstart -= state->pos;
+      state->pos = 0;
+    }
+    if(len > state->size - 1 - state->len) {
+      len = state->size - 1 - state->len;
+    }
+    memcpy(buf + state->len, data, len);
+    state->len += len;
+    buf[state->len] = 0;
+  }
+
+  if(state->error == JSON_ERROR_INCOMPLETE) {
+    state->error = JSON_ERROR_OK;
+  }
+  return len;
 }
 /*--------------------------------------------------------------------*/
 int
@@ -165,6 +248,14 @@ jsonparse_next(struct jsonparse_state *state)
   char v;
 
   skip_ws(state);
+  if(!is_token_complete(state)) {
+    if(state->pos == 0 && state->len == state->size - 1) {
+      state->error = JSON_ERROR_VALUE_TOO_LONG;
+    } else {
+      state->error = JSON_ERROR_INCOMPLETE;
+    }
+    return JSON_TYPE_ERROR;
+  }
   c = state->json[state->pos];
   s = jsonparse_get_type(state);
   v = state->vtype;
@@ -52,6 +52,9 @@ struct jsonparse_state {
   char vtype;
   char error;
   char stack[JSONPARSE_MAX_DEPTH];
+  /* for parsing input that arrives in chunks */
+  int size;
+  char final;
 };
 
 /**
@@ -66,6 +69,34 @@ struct jsonparse_state {
 void jsonparse_setup(struct jsonparse_state *state, const char *json,
                      int len);
 
+/**
+ * \brief      Initialize a JSON parser state for input arriving in chunks.
+ * \param state A pointer to a JSON parser state
+ * \param buf  A buffer the parser assembles the input in
+ * \param size The size of the buffer, which bounds the longest single value
+ *
+ *             Input is then passed with jsonparse_feed(). When
+ *             jsonparse_next() runs out of input in the middle of a
+ *             token it returns 0 with the error JSON_ERROR_INCOMPLETE and
+ *             leaves the state untouched, so parsing resumes with the
+ *             next call after more input has been fed.
+ */
+void jsonparse_setup_stream(struct jsonparse_state *state, char *buf,
+                            int size);
+
+/**
+ * \brief      Pass the next chunk of input to a streaming parser.
+ * \param state A pointer to a JSON parser state
+ * \param data The input, or NULL when the input has ended
+ * \param len  The length of the input
+ * \return     The number of bytes taken, which is less than len when the
+ *             buffer is full. Feed the rest after calling jsonparse_next().
+ *
+ *             Already parsed input is discarded to make room, so values
+ *             must be copied out before feeding more.
+ */
+int jsonparse_feed(struct jsonparse_state *state, const char *data, int len);
+
 /* move to next JSON element */
 int jsonparse_next(struct jsonparse_state *state);
 
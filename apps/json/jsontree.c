@@ -40,6 +40,7 @@
 #include "contiki.h"
 #include "jsontree.h"
 #include "jsonparse.h"
+#include "lib/numfmt.h"
 #include <string.h>
 
 #define DEBUG 0
@@ -50,60 +51,81 @@
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static void
+write_bytes(const struct jsontree_context *js_ctx, const char *data, int len)
+{
+  struct jsontree_buffer *buf = js_ctx->buffer;
+
+  if(js_ctx->putchar != NULL) {
+    while(len-- > 0) {
+      js_ctx->putchar(*data++);
+    }
+  } else if(!buf->full) {
+    if(len > buf->size - buf->len) {
+      buf->full = 1;
+    } else {
+      memcpy(buf->data + buf->len, data, len);
+      buf->len += len;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_char(const struct jsontree_context *js_ctx, char c)
+{
+  if(js_ctx->putchar != NULL) {
+    js_ctx->putchar(c);
+  } else {
+    write_bytes(js_ctx, &c, 1);
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
 {
   if(text == NULL) {
-    js_ctx->putchar('0');
+    write_char(js_ctx, '0');
   } else {
-    while(*text != '\0') {
-      js_ctx->putchar(*text++);
-    }
+    write_bytes(js_ctx, text, strlen(text));
   }
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_string(const struct jsontree_context *js_ctx, const char *text)
 {
-  js_ctx->putchar('"');
+  int len;
+
+  write_char(js_ctx, '"');
   if(text != NULL) {
     while(*text != '\0') {
+      /* write runs without quotes at once */
+      len = strcspn(text, "\"");
+      write_bytes(js_ctx, text, len);
+      text += len;
       if(*text == '"') {
-        js_ctx->putchar('\\');
+        write_bytes(js_ctx, "\\\"", 2);
+        text++;
       }
-      js_ctx->putchar(*text++);
     }
   }
-  js_ctx->putchar('"');
+  write_char(js_ctx, '"');
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_uint(const struct jsontree_context *js_ctx, unsigned int value)
 {
   char buf[10];
-  int l;
 
-  l = sizeof(buf) - 1;
-  do {
-    buf[l--] = '0' + (value % 10);
-    value /= 10;
-  } while(value > 0 && l >= 0);
-
-  while(++l < sizeof(buf)) {
-    js_ctx->putchar(buf[l]);
-  }
+  write_bytes(js_ctx, buf, numfmt_utoa(buf, sizeof(buf), value));
 }
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_int(const struct jsontree_context *js_ctx, int value)
 {
-  if(value < 0) {
-    js_ctx->putchar('-');
-    value = -value;
-  }
+  char buf[11];
 
-  jsontree_write_uint(js_ctx, value);
+  write_bytes(js_ctx, buf, numfmt_itoa(buf, sizeof(buf), value));
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -117,6 +139,24 @@ jsontree_setup(struct jsontree_context *js_ctx, struct jsontree_value *root,
 }
 /*---------------------------------------------------------------------------*/
 void
+jsontree_setup_buffer(struct jsontree_context *js_ctx,
+                      struct jsontree_value *root,
+                      struct jsontree_buffer *buf)
+{
+  jsontree_setup(js_ctx, root, NULL);
+  js_ctx->buffer = buf;
+}
+/*---------------------------------------------------------------------------*/
+void
+jsontree_buffer_init(struct jsontree_buffer *buf, char *data, uint16_t size)
+{
+  buf->data = data;
+  buf->size = size;
+  buf->len = 0;
+  buf->full = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
 jsontree_reset(struct jsontree_context *js_ctx)
 {
   js_ctx->depth = 0;
@@ -133,8 +173,8 @@ jsontree_path_name(const struct jsontree_context *js_ctx, int depth)
   return "";
 }
 /*---------------------------------------------------------------------------*/
-int
-jsontree_print_next(struct jsontree_context *js_ctx)
+static int
+print_next(struct jsontree_context *js_ctx)
 {
   struct jsontree_value *v;
   int index;
@@ -153,46 +193,46 @@ jsontree_print_next(struct jsontree_context *js_ctx)
 
     index = js_ctx->index[js_ctx->depth];
     if(index == 0) {
-      js_ctx->putchar(v->type);
+      write_char(js_ctx, v->type);
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
+      write_char(js_ctx, '\n');
 #endif
     }
     if(index >= o->count) {
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
+      write_char(js_ctx, '\n');
       indent = js_ctx->depth;
       while (indent--) {
-        js_ctx->putchar(' ');
-        js_ctx->putchar(' ');
+        write_char(js_ctx, ' ');
+        write_char(js_ctx, ' ');
       }
 #endif
-      js_ctx->putchar(v->type + 2);
+      write_char(js_ctx, v->type + 2);
       /* Default operation: back up one level! */
       break;
     }
 
     if(index > 0) {
-      js_ctx->putchar(',');
+      write_char(js_ctx, ',');
 #if JSONTREE_PRETTY
-      js_ctx->putchar('\n');
+      write_char(js_ctx, '\n');
 #endif
     }
 
 #if JSONTREE_PRETTY
     indent = js_ctx->depth + 1;
     while (indent--) {
-      js_ctx->putchar(' ');
-      js_ctx->putchar(' ');
+      write_char(js_ctx, ' ');
+      write_char(js_ctx, ' ');
     }
 #endif
 
     if(v->type == JSON_TYPE_OBJECT) {
       jsontree_write_string(js_ctx,
                             ((struct jsontree_object *)o)->pairs[index].name);
-      js_ctx->putchar(':');
+      write_char(js_ctx, ':');
 #if JSONTREE_PRETTY
-      js_ctx->putchar(' ');
+      write_char(js_ctx, ' ');
 #endif
       ov = ((struct jsontree_object *)o)->pairs[index].value;
     } else {
@@ -272,6 +312,51 @@ jsontree_print_next(struct jsontree_context *js_ctx)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+int
+jsontree_print_next(struct jsontree_context *js_ctx)
+{
+  struct jsontree_buffer *buf;
+  struct jsontree_value *next_value;
+  uint16_t index, prev_index, next_index, len;
+  uint8_t depth;
+  int callback_state;
+  int r;
+
+  if(js_ctx->putchar != NULL) {
+    return print_next(js_ctx);
+  }
+
+  /* Remember what a step can change, to undo it if it does not fit */
+  buf = js_ctx->buffer;
+  len = buf->len;
+  depth = js_ctx->depth;
+  index = js_ctx->index[depth];
+  prev_index = depth > 0 ? js_ctx->index[depth - 1] : 0;
+  next_index = depth + 1 < JSONTREE_MAX_DEPTH ? js_ctx->index[depth + 1] : 0;
+  next_value = depth + 1 < JSONTREE_MAX_DEPTH ? js_ctx->values[depth + 1] : NULL;
+  callback_state = js_ctx->callback_state;
+
+  r = print_next(js_ctx);
+  if(!buf->full) {
+    return r;
+  }
+
+  js_ctx->depth = depth;
+  js_ctx->index[depth] = index;
+  if(depth > 0) {
+    js_ctx->index[depth - 1] = prev_index;
+  }
+  if(depth + 1 < JSONTREE_MAX_DEPTH) {
+    js_ctx->index[depth + 1] = next_index;
+    js_ctx->values[depth + 1] = next_value;
+  }
+  js_ctx->callback_state = callback_state;
+  buf->len = len;
+
+  /* Nothing can be done if the step does not fit even an empty buffer */
+  return len > 0;
+}
+/*---------------------------------------------------------------------------*/
 static struct jsontree_value *
 find_next(struct jsontree_context *js_ctx)
 {
@@ -55,10 +55,19 @@
 #define JSONTREE_PRETTY 0
 #endif /* JSONTREE_CONF_PRETTY */
 
+/* Caller-provided output buffer for jsontree_setup_buffer() */
+struct jsontree_buffer {
+  char *data;
+  uint16_t size;
+  uint16_t len;
+  uint8_t full;
+};
+
 struct jsontree_context {
   struct jsontree_value *values[JSONTREE_MAX_DEPTH];
   uint16_t index[JSONTREE_MAX_DEPTH];
   int (* putchar)(int);
+  struct jsontree_buffer *buffer; /* used when putchar is NULL */
   uint8_t depth;
   uint8_t path;
   int callback_state;
@@ -143,6 +152,22 @@ void jsontree_setup(struct jsontree_context *js_ctx,
                     struct jsontree_value *root, int (* putchar)(int));
 void jsontree_reset(struct jsontree_context *js_ctx);
 
+/*
+ * Sets up js_ctx to write into buf with memcpy instead of calling a putchar
+ * function per byte. jsontree_print_next() only writes steps that fit
+ * entirely. When one does not, the step is undone, buf->full is set and
+ * jsontree_print_next() returns 1. The caller then sends the buf->len bytes,
+ * empties the buffer with jsontree_buffer_init() and continues. A step
+ * that does not fit even in an empty buffer makes jsontree_print_next()
+ * return 0 with buf->full set. Steps may be run again, so callbacks must
+ * depend only on js_ctx->callback_state.
+ */
+void jsontree_setup_buffer(struct jsontree_context *js_ctx,
+                           struct jsontree_value *root,
+                           struct jsontree_buffer *buf);
+void jsontree_buffer_init(struct jsontree_buffer *buf, char *data,
+                          uint16_t size);
+
 const char *jsontree_path_name(const struct jsontree_context *js_ctx,
                                int depth);
 
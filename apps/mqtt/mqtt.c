@@ -192,6 +192,9 @@ static void tcp_event(struct tcp_socket *s, void *ptr,
 
 static void reset_packet(struct mqtt_in_packet *packet);
 /*---------------------------------------------------------------------------*/
+#if MQTT_MAX_INFLIGHT > 1
+static void inflight_check(void *ptr);
+#endif
 LIST(mqtt_conn_list);
 /*---------------------------------------------------------------------------*/
 PROCESS(mqtt_process, "MQTT process");
@@ -225,6 +228,12 @@ abort_connection(struct mqtt_connection *conn)
   /* Reset outgoing packet */
   memset(&conn->out_packet, 0, sizeof(conn->out_packet));
 
+#if MQTT_MAX_INFLIGHT > 1
+  /* Unacknowledged messages are lost with the session */
+  memset(conn->inflight, 0, sizeof(conn->inflight));
+  ctimer_stop(&conn->inflight_timer);
+#endif
+
   tcp_socket_close(&conn->socket);
   tcp_socket_unregister(&conn->socket);
 
@@ -332,6 +341,25 @@ write_bytes(struct mqtt_connection *conn, uint8_t *data, uint16_t len)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Lets the producer of a streamed payload fill the rest of the out buffer */
+static uint16_t
+write_produced(struct mqtt_connection *conn)
+{
+  uint16_t len;
+
+  len = MIN(&conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] - conn->out_buffer_ptr,
+            conn->out_packet.payload_size - conn->out_write_pos);
+  len = conn->out_packet.producer(conn, conn->out_buffer_ptr, len,
+                                  conn->out_write_pos);
+
+  DBG("MQTT - (write_produced) offset: %lu produced: %u\n",
+      conn->out_write_pos, len);
+
+  conn->out_write_pos += len;
+  conn->out_buffer_ptr += len;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
 static void
 encode_remaining_length(uint8_t *remaining_length,
                         uint8_t *remaining_length_bytes,
@@ -380,6 +408,99 @@ reset_packet(struct mqtt_in_packet *packet)
   packet->remaining_multiplier = 1;
 }
 /*---------------------------------------------------------------------------*/
+#if MQTT_MAX_INFLIGHT > 1
+static struct mqtt_inflight *
+inflight_free_slot(struct mqtt_connection *conn)
+{
+  uint8_t i;
+
+  for(i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    if(!conn->inflight[i].in_use) {
+      return &conn->inflight[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Records the QoS 1 PUBLISH just sent as awaiting its PUBACK */
+static void
+inflight_add(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *e;
+
+  if(conn->out_packet.inflight != NULL) {
+    /* A retransmission, the entry is already up to date */
+    return;
+  }
+
+  e = inflight_free_slot(conn);
+  if(e == NULL) {
+    DBG("MQTT - No in-flight slot for MID %u\n", conn->out_packet.mid);
+    return;
+  }
+
+  e->in_use = 1;
+  e->mid = conn->out_packet.mid;
+  e->retries = 0;
+  e->sent = clock_time();
+  e->topic = conn->out_packet.topic;
+  e->payload = conn->out_packet.payload;
+  e->payload_size = conn->out_packet.payload_size;
+  e->producer = conn->out_packet.producer;
+  e->retain = conn->out_packet.retain;
+
+  if(ctimer_expired(&conn->inflight_timer)) {
+    ctimer_set(&conn->inflight_timer, CLOCK_SECOND, inflight_check, conn);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Sends again, or gives up on, messages whose PUBACK is overdue */
+static void
+inflight_check(void *ptr)
+{
+  struct mqtt_connection *conn = ptr;
+  struct mqtt_inflight *e;
+  uint8_t pending = 0;
+  uint8_t i;
+
+  for(i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    e = &conn->inflight[i];
+    if(!e->in_use) {
+      continue;
+    }
+    if(clock_time() - e->sent >= RESPONSE_WAIT_TIMEOUT) {
+      if(e->retries >= MQTT_PUBLISH_RETRIES) {
+        DBG("MQTT - Timeout waiting for PUBACK of MID %u\n", e->mid);
+        e->in_use = 0;
+        continue;
+      }
+      if(!conn->out_queue_full &&
+         conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+        conn->out_queue_full = 1;
+        conn->out_packet.mid = e->mid;
+        conn->out_packet.retain = e->retain;
+        conn->out_packet.topic = e->topic;
+        conn->out_packet.topic_length = strlen(e->topic);
+        conn->out_packet.payload = e->payload;
+        conn->out_packet.payload_size = e->payload_size;
+        conn->out_packet.producer = e->producer;
+        conn->out_packet.qos = MQTT_QOS_LEVEL_1;
+        conn->out_packet.qos_state = MQTT_QOS_STATE_NO_ACK;
+        conn->out_packet.inflight = e;
+        e->retries++;
+        e->sent = clock_time();
+        process_post(&mqtt_process, mqtt_do_publish_event, conn);
+      }
+    }
+    pending = 1;
+  }
+
+  if(pending) {
+    ctimer_reset(&conn->inflight_timer);
+  }
+}
+#endif /* MQTT_MAX_INFLIGHT > 1 */
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(connect_pt(struct pt *pt, struct mqtt_connection *conn))
 {
@@ -645,6 +766,9 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
   if(conn->out_packet.retain == MQTT_RETAIN_ON) {
     conn->out_packet.fhdr |= MQTT_FHDR_RETAIN_FLAG;
   }
+  if(conn->out_packet.inflight != NULL) {
+    conn->out_packet.fhdr |= MQTT_FHDR_DUP_FLAG;
+  }
   conn->out_packet.remaining_length = MQTT_STRING_LEN_SIZE +
     conn->out_packet.topic_length +
     conn->out_packet.payload_size;
@@ -660,51 +784,87 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
     PT_EXIT(pt);
   }
 
-  /* Write Fixed Header */
-  PT_MQTT_WRITE_BYTE(conn, conn->out_packet.fhdr);
-  PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
-                      conn->out_packet.remaining_length_enc_bytes);
-  /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length & 0x00FF));
-  PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.topic,
-                      conn->out_packet.topic_length);
-  if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
-    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
-    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
-  }
-  /* Write Payload */
-  PT_MQTT_WRITE_BYTES(conn,
-                      conn->out_packet.payload,
-                      conn->out_packet.payload_size);
-
-  send_out_buffer(conn);
-  timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
+  conn->out_packet.retries = 0;
 
-  /*
-   * If QoS is zero then wait until the message has been sent, since there is
-   * no ACK to wait for.
-   *
-   * Also notify the app will not be notified via PUBACK or PUBCOMP
-   */
-  if(conn->out_packet.qos == 0) {
-    process_post(conn->app_process, mqtt_update_event, NULL);
-  } else if(conn->out_packet.qos == 1) {
-    /* Wait for PUBACK */
-    reset_packet(&conn->in_packet);
-    PT_WAIT_UNTIL(pt, conn->out_packet.qos_state == MQTT_QOS_STATE_GOT_ACK ||
-                  timer_expired(&conn->t));
-    if(timer_expired(&conn->t)) {
-      DBG("Timeout waiting for PUBACK\n");
+  do {
+    /* Write Fixed Header */
+    PT_MQTT_WRITE_BYTE(conn, conn->out_packet.fhdr);
+    PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
+                        conn->out_packet.remaining_length_enc_bytes);
+    /* Write Variable Header */
+    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
+    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length & 0x00FF));
+    PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.topic,
+                        conn->out_packet.topic_length);
+    if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
+      PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid << 8));
+      PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
     }
-    if(conn->in_packet.mid != conn->out_packet.mid) {
-      DBG("MQTT - Warning, got PUBACK with none matching MID. Currently there "
-          "is no support for several concurrent PUBLISH messages.\n");
+    /* Write Payload */
+    if(conn->out_packet.producer != NULL) {
+      /* Let the application fill the out buffer directly */
+      conn->out_write_pos = 0;
+      while(conn->out_write_pos < conn->out_packet.payload_size) {
+        if(&conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] ==
+           conn->out_buffer_ptr) {
+          send_out_buffer(conn);
+          PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+          continue;
+        }
+        if(write_produced(conn) == 0) {
+          /* Not ready yet, ask again later */
+          PT_YIELD(pt);
+        }
+      }
+      conn->out_write_pos = 0;
+    } else {
+      PT_MQTT_WRITE_BYTES(conn,
+                          conn->out_packet.payload,
+                          conn->out_packet.payload_size);
     }
-  } else if(conn->out_packet.qos == 2) {
-    DBG("MQTT - QoS not implemented yet.\n");
-    /* Should wait for PUBREC, send PUBREL and then wait for PUBCOMP */
-  }
+
+    send_out_buffer(conn);
+    timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
+
+    /*
+     * If QoS is zero then wait until the message has been sent, since there is
+     * no ACK to wait for.
+     *
+     * Also notify the app will not be notified via PUBACK or PUBCOMP
+     */
+    if(conn->out_packet.qos == 0) {
+      process_post(conn->app_process, mqtt_update_event, NULL);
+    } else if(conn->out_packet.qos == 1) {
+#if MQTT_MAX_INFLIGHT > 1
+      /*
+       * Don't wait for the PUBACK, the in-flight table tracks it. Waiting
+       * for the TCP ACK keeps the out buffer intact until the data is sent.
+       */
+      inflight_add(conn);
+      PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+#else
+      /* Wait for PUBACK */
+      reset_packet(&conn->in_packet);
+      PT_WAIT_UNTIL(pt, conn->out_packet.qos_state == MQTT_QOS_STATE_GOT_ACK ||
+                    timer_expired(&conn->t));
+      if(timer_expired(&conn->t)) {
+        DBG("Timeout waiting for PUBACK\n");
+        /* Send it again so that the broker can recognize the duplicate */
+        conn->out_packet.fhdr |= MQTT_FHDR_DUP_FLAG;
+        PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+      }
+      if(conn->in_packet.mid != conn->out_packet.mid) {
+        DBG("MQTT - Warning, got PUBACK with none matching MID. Currently there "
+            "is no support for several concurrent PUBLISH messages.\n");
+      }
+#endif /* MQTT_MAX_INFLIGHT > 1 */
+    } else if(conn->out_packet.qos == 2) {
+      DBG("MQTT - QoS not implemented yet.\n");
+      /* Should wait for PUBREC, send PUBREL and then wait for PUBCOMP */
+    }
+  } while(MQTT_MAX_INFLIGHT == 1 && conn->out_packet.qos == 1 &&
+          conn->out_packet.qos_state != MQTT_QOS_STATE_GOT_ACK &&
+          conn->out_packet.retries++ < MQTT_PUBLISH_RETRIES);
 
   reset_packet(&conn->in_packet);
 
@@ -831,6 +991,19 @@ handle_puback(struct mqtt_connection *conn)
   conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
     (conn->in_packet.payload[1]);
 
+#if MQTT_MAX_INFLIGHT > 1
+  {
+    uint8_t i;
+
+    for(i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+      if(conn->inflight[i].in_use &&
+         conn->inflight[i].mid == conn->in_packet.mid) {
+        conn->inflight[i].in_use = 0;
+      }
+    }
+  }
+#endif /* MQTT_MAX_INFLIGHT > 1 */
+
   call_event(conn, MQTT_EVENT_PUBACK, &conn->in_packet.mid);
 }
 /*---------------------------------------------------------------------------*/
@@ -1435,15 +1608,23 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
     DBG("MQTT - Not accepted!\n");
     return MQTT_STATUS_OUT_QUEUE_FULL;
   }
+#if MQTT_MAX_INFLIGHT > 1
+  if(qos_level == MQTT_QOS_LEVEL_1 && inflight_free_slot(conn) == NULL) {
+    DBG("MQTT - Not accepted, in-flight window full\n");
+    return MQTT_STATUS_OUT_QUEUE_FULL;
+  }
+#endif
   conn->out_queue_full = 1;
   DBG("MQTT - Accepted!\n");
 
   conn->out_packet.mid = INCREMENT_MID(conn);
+  conn->out_packet.inflight = NULL;
   conn->out_packet.retain = retain;
   conn->out_packet.topic = topic;
   conn->out_packet.topic_length = strlen(topic);
   conn->out_packet.payload = payload;
   conn->out_packet.payload_size = payload_size;
+  conn->out_packet.producer = NULL;
   conn->out_packet.qos = qos_level;
   conn->out_packet.qos_state = MQTT_QOS_STATE_NO_ACK;
 
@@ -1451,6 +1632,25 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
   return MQTT_STATUS_OK;
 }
 /*----------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_publish_stream(struct mqtt_connection *conn, uint16_t *mid, char *topic,
+                    uint32_t payload_size, mqtt_payload_producer_t producer,
+                    mqtt_qos_level_t qos_level, mqtt_retain_t retain)
+{
+  mqtt_status_t status;
+
+  if(producer == NULL) {
+    return MQTT_STATUS_INVALID_ARGS_ERROR;
+  }
+
+  status = mqtt_publish(conn, mid, topic, NULL, payload_size, qos_level,
+                        retain);
+  if(status == MQTT_STATUS_OK) {
+    conn->out_packet.producer = producer;
+  }
+  return status;
+}
+/*----------------------------------------------------------------------------*/
 void
 mqtt_set_username_password(struct mqtt_connection *conn, char *username,
                            char *password)
@@ -117,6 +117,29 @@
 #define MQTT_PROTOCOL_VERSION 3
 #define MQTT_PROTOCOL_NAME "MQIsdp"
 #define MQTT_TOPIC_MAX_LENGTH 128
+
+/*
+ * Number of times a QoS 1 PUBLISH is sent again, with the DUP flag set,
+ * when no PUBACK arrives in time
+ */
+#ifdef MQTT_CONF_PUBLISH_RETRIES
+#define MQTT_PUBLISH_RETRIES MQTT_CONF_PUBLISH_RETRIES
+#else
+#define MQTT_PUBLISH_RETRIES 0
+#endif
+
+/*
+ * Number of QoS 1 PUBLISH messages that may await their PUBACK at the same
+ * time. With more than one, a QoS 1 publish completes as soon as it is
+ * written and the next one can follow without waiting a round trip. The
+ * topic and payload of each message must then stay valid until its
+ * MQTT_EVENT_PUBACK.
+ */
+#ifdef MQTT_CONF_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT MQTT_CONF_MAX_INFLIGHT
+#else
+#define MQTT_MAX_INFLIGHT 1
+#endif
 /*---------------------------------------------------------------------------*/
 /*
  * Debug configuration, this is similar but not exactly like the Debugging
@@ -269,6 +292,29 @@ struct mqtt_in_packet {
 };
 
 /* This struct represents a packet sent to the MQTT server. */
+/*
+ * Fills buf with up to len bytes of a streamed PUBLISH payload, starting at
+ * offset, and returns the number of bytes written. Returning 0 means no data
+ * is ready yet and the producer will be asked again later. A QoS 1 message
+ * that is sent again asks for the payload from offset 0 once more.
+ */
+typedef uint16_t (*mqtt_payload_producer_t)(struct mqtt_connection *m,
+                                            uint8_t *buf, uint16_t len,
+                                            uint32_t offset);
+
+/* A QoS 1 PUBLISH that has been sent and awaits its PUBACK */
+struct mqtt_inflight {
+  uint16_t mid;
+  uint8_t in_use;
+  uint8_t retries;
+  clock_time_t sent;
+  char *topic;
+  uint8_t *payload;
+  uint32_t payload_size;
+  mqtt_payload_producer_t producer;
+  mqtt_retain_t retain;
+};
+
 struct mqtt_out_packet {
   uint8_t fhdr;
   uint32_t remaining_length;
@@ -279,9 +325,12 @@ struct mqtt_out_packet {
   uint16_t topic_length;
   uint8_t *payload;
   uint32_t payload_size;
+  mqtt_payload_producer_t producer;
   mqtt_qos_level_t qos;
   mqtt_qos_state_t qos_state;
   mqtt_retain_t retain;
+  uint8_t retries;
+  struct mqtt_inflight *inflight; /* set when this is a retransmission */
 };
 /*---------------------------------------------------------------------------*/
 /**
@@ -347,6 +396,10 @@ struct mqtt_connection {
   struct pt out_proto_thread;
   uint32_t out_write_pos;
   uint16_t max_segment_size;
+#if MQTT_MAX_INFLIGHT > 1
+  struct mqtt_inflight inflight[MQTT_MAX_INFLIGHT];
+  struct ctimer inflight_timer;
+#endif
 
   /* Incoming data related */
   uint8_t in_buffer[MQTT_TCP_INPUT_BUFF_SIZE];
@@ -459,6 +512,30 @@ mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            mqtt_qos_level_t qos_level,
                            mqtt_retain_t retain);
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief Publish a message whose payload is produced while it is sent.
+ * \param conn A pointer to the MQTT connection.
+ * \param mid A pointer to message ID.
+ * \param topic A pointer to the topic to publish to.
+ * \param payload_size Total payload size, which must be known up front.
+ * \param producer Called to write the payload straight into the outgoing
+ *        TCP buffer, one buffer-full at a time.
+ * \param qos_level Quality Of Service level to use. Currently supports 0, 1.
+ * \param retain The RETAIN flag, as for mqtt_publish().
+ * \return MQTT_STATUS_OK or some error status
+ *
+ * Unlike mqtt_publish(), the payload never has to be held in RAM as a whole.
+ * The application can, for example, serialize a batch of readings into a
+ * single PUBLISH as the buffer space becomes available.
+ */
+mqtt_status_t mqtt_publish_stream(struct mqtt_connection *conn,
+                                  uint16_t *mid,
+                                  char *topic,
+                                  uint32_t payload_size,
+                                  mqtt_payload_producer_t producer,
+                                  mqtt_qos_level_t qos_level,
+                                  mqtt_retain_t retain);
+/*---------------------------------------------------------------------------*/
 /**
  * \brief Set the user name and password for a MQTT client.
  * \param conn A pointer to the MQTT connection.
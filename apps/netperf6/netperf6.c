@@ -0,0 +1,617 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Throughput, latency and energy benchmark for the IPv6 stack.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/ip/simple-udp.h"
+#include "net/ip/tcp-socket.h"
+#include "sys/energest.h"
+#include "lib/random.h"
+#include "netperf6.h"
+
+#if NETPERF6_COAP
+#include "er-coap.h"
+#include "er-coap-transactions.h"
+#include "rest-engine.h"
+#endif /* NETPERF6_COAP */
+
+#include <stdio.h>
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Message types */
+#define MSG_DATA       1
+#define MSG_REQUEST    2
+#define MSG_RESPONSE   3
+#define MSG_REPORT_REQ 4
+#define MSG_REPORT     5
+
+struct msg_hdr {
+  uint8_t type;
+  uint8_t session;
+  uint16_t seqno;
+  uint32_t timestamp;
+};
+
+/* The answer to MSG_REPORT_REQ, after the header */
+struct msg_report {
+  uint16_t received;
+  uint16_t reserved;
+  uint32_t bytes;
+  uint32_t duration;
+};
+
+/* The number of times the client asks for a report */
+#define REPORT_TRIES 3
+
+/*
+ * Latency histogram: four bins per power of two milliseconds, so that a
+ * percentile is within 25% of the measured value
+ */
+#define LATENCY_BINS 64
+
+#define TCP_BUFSIZE 128
+
+#define TEST_RUNNING 0x01
+#define TEST_ANSWERED 0x02
+#define TEST_FAILED 0x04
+#define TEST_DONE 0x08
+
+process_event_t netperf6_event_done;
+
+static struct simple_udp_connection udp_conn;
+static uint8_t payload[NETPERF6_MAX_SIZE];
+
+/* Server state of the UDP stream */
+static uint8_t server_session;
+static struct msg_report server_report;
+static clock_time_t server_first;
+
+/* Client state */
+static struct process *requester;
+static uip_ipaddr_t peer;
+static uint8_t mode;
+static uint16_t count;
+static uint16_t size;
+static clock_time_t interval;
+static uint8_t session;
+static volatile uint8_t flags;
+static uint16_t seqno;
+static clock_time_t sent_at;
+static uint16_t latency_hist[LATENCY_BINS];
+static unsigned long energest_start[4];
+static struct netperf6_result result;
+
+#if UIP_TCP
+static struct tcp_socket tcp_server;
+static uint8_t tcp_server_inbuf[TCP_BUFSIZE];
+static uint8_t tcp_server_outbuf[1];
+static struct tcp_socket tcp_client;
+static uint8_t tcp_client_inbuf[1];
+static uint8_t tcp_client_outbuf[TCP_BUFSIZE];
+static uint32_t tcp_received;
+static uint32_t tcp_remaining;
+#endif /* UIP_TCP */
+
+#if NETPERF6_COAP
+static coap_packet_t coap_request[1];
+#endif /* NETPERF6_COAP */
+
+static const uint8_t energest_types[4] = {
+  ENERGEST_TYPE_CPU, ENERGEST_TYPE_LPM,
+  ENERGEST_TYPE_TRANSMIT, ENERGEST_TYPE_LISTEN
+};
+static const uint16_t energest_currents[4] = {
+  NETPERF6_CURRENT_CPU, NETPERF6_CURRENT_LPM,
+  NETPERF6_CURRENT_TX, NETPERF6_CURRENT_RX
+};
+
+static const char *const mode_names[] = {
+  "udp-stream", "udp-rr", "coap-rr", "tcp-bulk"
+};
+
+PROCESS(netperf6_process, "netperf6");
+/*---------------------------------------------------------------------------*/
+static int
+latency_bin(uint32_t ms)
+{
+  int e;
+
+  if(ms < 4) {
+    return ms;
+  }
+  for(e = 2; (ms >> (e + 1)) != 0; e++);
+  if(4 * (e - 1) + 3 >= LATENCY_BINS) {
+    return LATENCY_BINS - 1;
+  }
+  return 4 * (e - 1) + ((ms >> (e - 2)) & 3);
+}
+/*---------------------------------------------------------------------------*/
+/* The largest value that falls into a bin */
+static uint32_t
+latency_bin_max(int bin)
+{
+  if(bin < 3) {
+    return bin;
+  }
+  bin++;
+  return ((uint32_t)(4 + (bin & 3)) << (bin / 4 - 1)) - 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+latency_add(clock_time_t ticks)
+{
+  latency_hist[latency_bin((uint32_t)ticks * 1000 / CLOCK_SECOND)]++;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+latency_percentile(uint16_t total, int percent)
+{
+  uint32_t sum;
+  int i;
+
+  sum = 0;
+  for(i = 0; i < LATENCY_BINS; i++) {
+    sum += latency_hist[i];
+    if(sum * 100 >= (uint32_t)total * percent) {
+      return latency_bin_max(i);
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+energest_read(unsigned long *times)
+{
+  int i;
+
+  energest_flush();
+  for(i = 0; i < 4; i++) {
+    times[i] = energest_type_time(energest_types[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_msg(const uip_ipaddr_t *addr, uint8_t type, uint8_t s, uint16_t seq,
+         uint32_t timestamp, const void *data, uint16_t len)
+{
+  struct msg_hdr hdr;
+
+  hdr.type = type;
+  hdr.session = s;
+  hdr.seqno = uip_htons(seq);
+  hdr.timestamp = timestamp;
+  memcpy(payload, &hdr, sizeof(hdr));
+  if(data != NULL) {
+    memcpy(payload + sizeof(hdr), data, len);
+  }
+  if(len < sizeof(hdr)) {
+    len = sizeof(hdr);
+  }
+  simple_udp_sendto(&udp_conn, payload, len, addr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+udp_input(struct simple_udp_connection *c,
+          const uip_ipaddr_t *sender_addr, uint16_t sender_port,
+          const uip_ipaddr_t *receiver_addr, uint16_t receiver_port,
+          const uint8_t *data, uint16_t datalen)
+{
+  struct msg_hdr hdr;
+  struct msg_report report;
+
+  if(datalen < sizeof(hdr)) {
+    return;
+  }
+  memcpy(&hdr, data, sizeof(hdr));
+
+  switch(hdr.type) {
+  case MSG_DATA:
+    if(hdr.session != server_session || server_report.received == 0) {
+      server_session = hdr.session;
+      memset(&server_report, 0, sizeof(server_report));
+      server_first = clock_time();
+    }
+    server_report.received++;
+    server_report.bytes += datalen;
+    server_report.duration = clock_time() - server_first;
+    break;
+  case MSG_REQUEST:
+    /* Echo the request */
+    send_msg(sender_addr, MSG_RESPONSE, hdr.session, uip_ntohs(hdr.seqno),
+             hdr.timestamp, NULL, datalen);
+    break;
+  case MSG_REPORT_REQ:
+    if(hdr.session == server_session) {
+      report = server_report;
+    } else {
+      memset(&report, 0, sizeof(report));
+    }
+    report.received = uip_htons(report.received);
+    report.bytes = uip_htonl(report.bytes);
+    report.duration = uip_htonl(report.duration * 1000 / CLOCK_SECOND);
+    send_msg(sender_addr, MSG_REPORT, hdr.session, 0, 0,
+             &report, sizeof(hdr) + sizeof(report));
+    break;
+  case MSG_RESPONSE:
+    if((flags & TEST_RUNNING) && hdr.session == session &&
+       uip_ntohs(hdr.seqno) == seqno && !(flags & TEST_ANSWERED)) {
+      latency_add(clock_time() - sent_at);
+      result.delivered++;
+      result.bytes += 2 * datalen;
+      flags |= TEST_ANSWERED;
+      process_poll(&netperf6_process);
+    }
+    break;
+  case MSG_REPORT:
+    if((flags & TEST_RUNNING) && hdr.session == session &&
+       datalen >= sizeof(hdr) + sizeof(report) && !(flags & TEST_ANSWERED)) {
+      memcpy(&report, data + sizeof(hdr), sizeof(report));
+      result.delivered = uip_ntohs(report.received);
+      result.bytes = uip_ntohl(report.bytes);
+      result.duration = uip_ntohl(report.duration) * CLOCK_SECOND / 1000;
+      flags |= TEST_ANSWERED;
+      process_poll(&netperf6_process);
+    }
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP
+static int
+tcp_server_input(struct tcp_socket *s, void *ptr,
+                 const uint8_t *input_data_ptr, int input_data_len)
+{
+  tcp_received += input_data_len;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_server_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
+{
+  if(event == TCP_SOCKET_CONNECTED) {
+    tcp_received = 0;
+  } else if(event != TCP_SOCKET_DATA_SENT) {
+    printf("netperf6: tcp server received %lu bytes\n",
+           (unsigned long)tcp_received);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_fill(struct tcp_socket *s)
+{
+  int len;
+
+  while(tcp_remaining > 0) {
+    len = tcp_remaining < sizeof(payload) ? tcp_remaining : sizeof(payload);
+    len = tcp_socket_send(s, payload, len);
+    if(len <= 0) {
+      break;
+    }
+    tcp_remaining -= len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_client_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
+{
+  if(!(flags & TEST_RUNNING) || (flags & TEST_DONE)) {
+    return;
+  }
+
+  switch(event) {
+  case TCP_SOCKET_CONNECTED:
+  case TCP_SOCKET_DATA_SENT:
+    tcp_fill(s);
+    if(tcp_remaining == 0 && tcp_socket_queuelen(s) == 0) {
+      flags |= TEST_DONE;
+      tcp_socket_close(s);
+      process_poll(&netperf6_process);
+    }
+    break;
+  default:
+    flags |= TEST_DONE | TEST_FAILED;
+    process_poll(&netperf6_process);
+    break;
+  }
+}
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+#if NETPERF6_COAP
+static void
+coap_post_handler(void *request, void *response, uint8_t *buffer,
+                  uint16_t preferred_size, int32_t *offset)
+{
+  const uint8_t *data;
+  int len;
+
+  /* Echo the request */
+  len = REST.get_request_payload(request, &data);
+  if(len > preferred_size) {
+    len = preferred_size;
+  }
+  memcpy(buffer, data, len);
+  REST.set_response_payload(response, buffer, len);
+}
+RESOURCE(res_netperf6, "title=\"netperf6\"", NULL, coap_post_handler,
+         NULL, NULL);
+/*---------------------------------------------------------------------------*/
+static void
+coap_response(void *data, void *response)
+{
+  if(!(flags & TEST_RUNNING)) {
+    return;
+  }
+  if(response != NULL) {
+    latency_add(clock_time() - sent_at);
+    result.delivered++;
+    result.bytes += 2 * size;
+  }
+  flags |= TEST_ANSWERED;
+  process_poll(&netperf6_process);
+}
+/*---------------------------------------------------------------------------*/
+static int
+coap_send_request(void)
+{
+  coap_transaction_t *t;
+
+  coap_init_message(coap_request, COAP_TYPE_CON, COAP_POST, coap_get_mid());
+  coap_set_header_uri_path(coap_request, "netperf6");
+  coap_set_payload(coap_request, payload, size);
+
+  t = coap_new_transaction(coap_request->mid, &peer,
+                           UIP_HTONS(COAP_DEFAULT_PORT));
+  if(t == NULL) {
+    return -1;
+  }
+  t->callback = coap_response;
+  t->packet_len = coap_serialize_message(coap_request, t->packet);
+  coap_send_transaction(t);
+  return 0;
+}
+#endif /* NETPERF6_COAP */
+/*---------------------------------------------------------------------------*/
+static void
+finish(void)
+{
+  unsigned long energest_end[4];
+  uint64_t energy;
+  int i;
+
+  energest_read(energest_end);
+  energy = 0;
+  for(i = 0; i < 4; i++) {
+    /* Ticks times microamperes times millivolts is nanojoules times
+       RTIMER_SECOND */
+    energy += (uint64_t)(energest_end[i] - energest_start[i]) *
+      energest_currents[i] * NETPERF6_VOLTAGE / RTIMER_SECOND;
+  }
+  result.energy = energy / 1000;
+  if(result.bytes > 0) {
+    result.energy_per_bit = energy / (8 * (uint64_t)result.bytes);
+  }
+
+  if(result.duration > 0) {
+    result.throughput = (uint64_t)result.bytes * 8 * CLOCK_SECOND /
+      result.duration;
+  }
+  if(result.sent > 0) {
+    result.pdr = (uint32_t)result.delivered * 1000 / result.sent;
+  }
+  if(mode == NETPERF6_UDP_RR || mode == NETPERF6_COAP_RR) {
+    result.latency[0] = latency_percentile(result.delivered, 50);
+    result.latency[1] = latency_percentile(result.delivered, 90);
+    result.latency[2] = latency_percentile(result.delivered, 99);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(netperf6_process, ev, data)
+{
+  static struct etimer et;
+  static struct etimer timeout;
+  static clock_time_t start;
+  static uint8_t tries;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
+
+    start = clock_time();
+    energest_read(energest_start);
+
+    if(mode == NETPERF6_UDP_STREAM) {
+      for(seqno = 0; seqno < count; seqno++) {
+        send_msg(&peer, MSG_DATA, session, seqno, clock_time(), NULL, size);
+        result.sent++;
+        etimer_set(&et, interval);
+        PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+      }
+      /* Ask the server what it received */
+      for(tries = 0; tries < REPORT_TRIES && !(flags & TEST_ANSWERED); tries++) {
+        send_msg(&peer, MSG_REPORT_REQ, session, 0, 0, NULL, 0);
+        etimer_set(&et, NETPERF6_TIMEOUT);
+        PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et) || (flags & TEST_ANSWERED));
+      }
+
+    } else if(mode == NETPERF6_UDP_RR || mode == NETPERF6_COAP_RR) {
+      for(seqno = 0; seqno < count; seqno++) {
+        flags &= ~TEST_ANSWERED;
+        sent_at = clock_time();
+        etimer_set(&et, interval);
+        etimer_set(&timeout, NETPERF6_TIMEOUT);
+#if NETPERF6_COAP
+        if(mode == NETPERF6_COAP_RR) {
+          if(coap_send_request() < 0) {
+            flags |= TEST_FAILED;
+            break;
+          }
+        } else
+#endif /* NETPERF6_COAP */
+        send_msg(&peer, MSG_REQUEST, session, seqno, sent_at, NULL, size);
+        result.sent++;
+
+        /* CoAP retransmits a request until its own timeout */
+        PROCESS_WAIT_EVENT_UNTIL((flags & TEST_ANSWERED) ||
+                                 (mode != NETPERF6_COAP_RR &&
+                                  etimer_expired(&timeout)));
+        etimer_stop(&timeout);
+
+        /* Wait for the rest of the interval */
+        if(!etimer_expired(&et)) {
+          PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+        }
+      }
+      result.duration = clock_time() - start;
+
+#if UIP_TCP
+    } else if(mode == NETPERF6_TCP_BULK) {
+      tcp_remaining = (uint32_t)count * size;
+      if(tcp_socket_connect(&tcp_client, &peer, NETPERF6_TCP_PORT) < 0) {
+        flags |= TEST_FAILED | TEST_DONE;
+      }
+      PROCESS_WAIT_EVENT_UNTIL(flags & TEST_DONE);
+      result.sent = count;
+      result.duration = clock_time() - start;
+      if(!(flags & TEST_FAILED)) {
+        result.delivered = count;
+        result.bytes = (uint32_t)count * size;
+      }
+#endif /* UIP_TCP */
+    }
+
+    finish();
+    flags = 0;
+    process_post(requester, netperf6_event_done, &result);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+netperf6_init(void)
+{
+  netperf6_event_done = process_alloc_event();
+  simple_udp_register(&udp_conn, NETPERF6_UDP_PORT, NULL, NETPERF6_UDP_PORT,
+                      udp_input);
+  session = random_rand();
+
+#if UIP_TCP
+  tcp_socket_register(&tcp_server, NULL,
+                      tcp_server_inbuf, sizeof(tcp_server_inbuf),
+                      tcp_server_outbuf, sizeof(tcp_server_outbuf),
+                      tcp_server_input, tcp_server_event);
+  tcp_socket_listen(&tcp_server, NETPERF6_TCP_PORT);
+  tcp_socket_register(&tcp_client, NULL,
+                      tcp_client_inbuf, sizeof(tcp_client_inbuf),
+                      tcp_client_outbuf, sizeof(tcp_client_outbuf),
+                      NULL, tcp_client_event);
+#endif /* UIP_TCP */
+
+#if NETPERF6_COAP
+  rest_init_engine();
+  rest_activate_resource(&res_netperf6, "netperf6");
+#endif /* NETPERF6_COAP */
+
+  process_start(&netperf6_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+int
+netperf6_start(enum netperf6_mode m, const uip_ipaddr_t *addr,
+               uint16_t c, uint16_t s, clock_time_t i)
+{
+  if(flags & TEST_RUNNING) {
+    return -1;
+  }
+  if(s > NETPERF6_MAX_SIZE || (m != NETPERF6_TCP_BULK &&
+                               s < sizeof(struct msg_hdr))) {
+    return -1;
+  }
+#if !UIP_TCP
+  if(m == NETPERF6_TCP_BULK) {
+    return -1;
+  }
+#endif /* !UIP_TCP */
+#if !NETPERF6_COAP
+  if(m == NETPERF6_COAP_RR) {
+    return -1;
+  }
+#endif /* !NETPERF6_COAP */
+
+  requester = PROCESS_CURRENT();
+  uip_ipaddr_copy(&peer, addr);
+  mode = m;
+  count = c;
+  size = s;
+  interval = i;
+  session++;
+
+  memset(&result, 0, sizeof(result));
+  result.mode = m;
+  memset(latency_hist, 0, sizeof(latency_hist));
+  flags = TEST_RUNNING;
+
+  process_post(&netperf6_process, PROCESS_EVENT_CONTINUE, NULL);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct netperf6_result *
+netperf6_result(void)
+{
+  return &result;
+}
+/*---------------------------------------------------------------------------*/
+void
+netperf6_print_result(void)
+{
+  printf("netperf6: %s sent %u delivered %u pdr %u bytes %lu time %lu ms"
+         " tput %lu bps lat %lu %lu %lu ms energy %lu uJ %lu nJ/bit\n",
+         mode_names[result.mode], result.sent, result.delivered, result.pdr,
+         (unsigned long)result.bytes,
+         (unsigned long)result.duration * 1000 / CLOCK_SECOND,
+         (unsigned long)result.throughput,
+         (unsigned long)result.latency[0], (unsigned long)result.latency[1],
+         (unsigned long)result.latency[2],
+         (unsigned long)result.energy, (unsigned long)result.energy_per_bit);
+}
+/*---------------------------------------------------------------------------*/
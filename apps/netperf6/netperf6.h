@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Throughput, latency and energy benchmark for the IPv6 stack.
+ *
+ *      Every node runs a server. A client runs one test at a time against
+ *      a server and reports the results:
+ *      - UDP stream: the client sends a number of datagrams at a fixed
+ *        interval and then asks the server how many it received.
+ *      - UDP and CoAP request-response: the client sends one request at
+ *        a time and measures the round-trip time of the responses.
+ *      - TCP bulk: the client sends a number of bytes over a TCP
+ *        connection.
+ *
+ *      The energy is estimated from energest, which must be enabled with
+ *      ENERGEST_CONF_ON, and the NETPERF6_CONF_CURRENT_* values.
+ */
+
+#ifndef NETPERF6_H_
+#define NETPERF6_H_
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+
+#ifdef NETPERF6_CONF_UDP_PORT
+#define NETPERF6_UDP_PORT NETPERF6_CONF_UDP_PORT
+#else /* NETPERF6_CONF_UDP_PORT */
+#define NETPERF6_UDP_PORT 5001
+#endif /* NETPERF6_CONF_UDP_PORT */
+
+#ifdef NETPERF6_CONF_TCP_PORT
+#define NETPERF6_TCP_PORT NETPERF6_CONF_TCP_PORT
+#else /* NETPERF6_CONF_TCP_PORT */
+#define NETPERF6_TCP_PORT 5001
+#endif /* NETPERF6_CONF_TCP_PORT */
+
+/* Set to use the CoAP request-response test; needs er-coap and rest-engine */
+#ifdef NETPERF6_CONF_COAP
+#define NETPERF6_COAP NETPERF6_CONF_COAP
+#else /* NETPERF6_CONF_COAP */
+#define NETPERF6_COAP 0
+#endif /* NETPERF6_CONF_COAP */
+
+/* The largest payload of a UDP datagram or CoAP message */
+#ifdef NETPERF6_CONF_MAX_SIZE
+#define NETPERF6_MAX_SIZE NETPERF6_CONF_MAX_SIZE
+#else /* NETPERF6_CONF_MAX_SIZE */
+#define NETPERF6_MAX_SIZE 64
+#endif /* NETPERF6_CONF_MAX_SIZE */
+
+/* How long a request-response client waits for a response */
+#ifdef NETPERF6_CONF_TIMEOUT
+#define NETPERF6_TIMEOUT NETPERF6_CONF_TIMEOUT
+#else /* NETPERF6_CONF_TIMEOUT */
+#define NETPERF6_TIMEOUT (4 * CLOCK_SECOND)
+#endif /* NETPERF6_CONF_TIMEOUT */
+
+/*
+ * Current draw in microamperes and supply voltage in millivolts, used
+ * for the energy estimate. The defaults are those of a Tmote Sky.
+ */
+#ifdef NETPERF6_CONF_CURRENT_CPU
+#define NETPERF6_CURRENT_CPU NETPERF6_CONF_CURRENT_CPU
+#else /* NETPERF6_CONF_CURRENT_CPU */
+#define NETPERF6_CURRENT_CPU 1800
+#endif /* NETPERF6_CONF_CURRENT_CPU */
+
+#ifdef NETPERF6_CONF_CURRENT_LPM
+#define NETPERF6_CURRENT_LPM NETPERF6_CONF_CURRENT_LPM
+#else /* NETPERF6_CONF_CURRENT_LPM */
+#define NETPERF6_CURRENT_LPM 55
+#endif /* NETPERF6_CONF_CURRENT_LPM */
+
+#ifdef NETPERF6_CONF_CURRENT_TX
+#define NETPERF6_CURRENT_TX NETPERF6_CONF_CURRENT_TX
+#else /* NETPERF6_CONF_CURRENT_TX */
+#define NETPERF6_CURRENT_TX 17700
+#endif /* NETPERF6_CONF_CURRENT_TX */
+
+#ifdef NETPERF6_CONF_CURRENT_RX
+#define NETPERF6_CURRENT_RX NETPERF6_CONF_CURRENT_RX
+#else /* NETPERF6_CONF_CURRENT_RX */
+#define NETPERF6_CURRENT_RX 20000
+#endif /* NETPERF6_CONF_CURRENT_RX */
+
+#ifdef NETPERF6_CONF_VOLTAGE
+#define NETPERF6_VOLTAGE NETPERF6_CONF_VOLTAGE
+#else /* NETPERF6_CONF_VOLTAGE */
+#define NETPERF6_VOLTAGE 3000
+#endif /* NETPERF6_CONF_VOLTAGE */
+
+enum netperf6_mode {
+  NETPERF6_UDP_STREAM,
+  NETPERF6_UDP_RR,
+  NETPERF6_COAP_RR,
+  NETPERF6_TCP_BULK
+};
+
+struct netperf6_result {
+  uint8_t mode;
+  uint16_t sent;          /* datagrams, requests or TCP segments' worth */
+  uint16_t delivered;     /* received by the server, or responses */
+  uint32_t bytes;         /* payload bytes delivered */
+  clock_time_t duration;
+  uint32_t throughput;    /* bits per second */
+  uint16_t pdr;           /* packet delivery ratio, per mille */
+  uint32_t latency[3];    /* 50th, 90th and 99th percentile, milliseconds */
+  uint32_t energy;        /* consumed by the client, microjoules */
+  uint32_t energy_per_bit; /* nanojoules per delivered bit */
+};
+
+/* Posted to the process that started a test when it has finished */
+extern process_event_t netperf6_event_done;
+
+/* Starts the server, and lets this node run tests as a client */
+void netperf6_init(void);
+
+/*
+ * Starts a test against the server at addr. count datagrams, requests
+ * or blocks of size bytes are sent, a datagram or request at most every
+ * interval. Returns 0 if the test was started, and -1 if one is already
+ * running or the parameters are invalid.
+ */
+int netperf6_start(enum netperf6_mode mode, const uip_ipaddr_t *addr,
+                   uint16_t count, uint16_t size, clock_time_t interval);
+
+/* The results of the last test */
+const struct netperf6_result *netperf6_result(void);
+
+/* Prints the results of the last test on one line */
+void netperf6_print_result(void);
+
+#endif /* NETPERF6_H_ */
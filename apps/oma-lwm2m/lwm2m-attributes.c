@@ -0,0 +1,583 @@
+/*
+ * Copyright (c) 2015, Yanzi Networks AB.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup oma-lwm2m
+ * @{
+ */
+
+/**
+ * \file
+ *         Implementation of the LWM2M notification attributes. A
+ *         notification is sent no sooner than pmin seconds and no later
+ *         than pmax seconds after the previous one, and only when the
+ *         value crosses gt or lt or has changed by at least st.
+ */
+
+#include "lwm2m-object.h"
+#include "lwm2m-engine.h"
+#include "lwm2m-attributes.h"
+#include "lwm2m-plain-text.h"
+#include "er-coap-observe.h"
+#if COAP_RESPONSE_CACHE_SIZE
+#include "er-coap-cache.h"
+#endif /* COAP_RESPONSE_CACHE_SIZE */
+#include <stdio.h>
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#if LWM2M_ATTRIBUTES_MAX
+
+/* Matches any instance or resource id in an attribute entry */
+#define ANY_ID 0xffff
+
+#define ATTR_PMIN 0x01
+#define ATTR_PMAX 0x02
+#define ATTR_GT   0x04
+#define ATTR_LT   0x08
+#define ATTR_ST   0x10
+
+typedef struct {
+  uint16_t object_id;
+  uint16_t instance_id;
+  uint16_t resource_id;
+  uint8_t set;
+  uint16_t pmin;
+  uint16_t pmax;
+  int32_t gt;
+  int32_t lt;
+  int32_t st;
+} attributes_t;
+
+#define STATE_USED      0x01
+#define STATE_NOTIFIED  0x02
+#define STATE_HAS_VALUE 0x04
+#define STATE_PENDING   0x08
+
+/* The notification state of a resource that has attributes */
+typedef struct {
+  const lwm2m_object_t *object;
+  uint16_t instance_id;
+  uint16_t resource_id;
+  uint8_t flags;
+  int32_t notified_value;
+  int32_t value;
+  clock_time_t notified_time;
+  struct ctimer timer;
+} notify_state_t;
+
+static attributes_t attributes[LWM2M_ATTRIBUTES_MAX];
+static notify_state_t states[LWM2M_ATTRIBUTES_MAX];
+
+static void schedule(notify_state_t *state);
+/*---------------------------------------------------------------------------*/
+static void
+merge(attributes_t *result, const attributes_t *entry)
+{
+  result->set |= entry->set;
+  if(entry->set & ATTR_PMIN) {
+    result->pmin = entry->pmin;
+  }
+  if(entry->set & ATTR_PMAX) {
+    result->pmax = entry->pmax;
+  }
+  if(entry->set & ATTR_GT) {
+    result->gt = entry->gt;
+  }
+  if(entry->set & ATTR_LT) {
+    result->lt = entry->lt;
+  }
+  if(entry->set & ATTR_ST) {
+    result->st = entry->st;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Resource attributes override instance attributes, which in turn
+   override object attributes. */
+static void
+get_effective(attributes_t *result, uint16_t object_id,
+              uint16_t instance_id, uint16_t resource_id)
+{
+  const attributes_t *entry;
+  int level, i;
+
+  memset(result, 0, sizeof(*result));
+  for(level = 0; level < 3; level++) {
+    for(i = 0; i < LWM2M_ATTRIBUTES_MAX; i++) {
+      entry = &attributes[i];
+      if(entry->set == 0 || entry->object_id != object_id) {
+        continue;
+      }
+      if((level == 0 && entry->instance_id == ANY_ID) ||
+         (level == 1 && entry->instance_id == instance_id &&
+          entry->resource_id == ANY_ID) ||
+         (level == 2 && entry->instance_id == instance_id &&
+          entry->resource_id == resource_id)) {
+        merge(result, entry);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static notify_state_t *
+find_state(const lwm2m_object_t *object, uint16_t instance_id,
+           uint16_t resource_id)
+{
+  int i;
+  for(i = 0; i < LWM2M_ATTRIBUTES_MAX; i++) {
+    if((states[i].flags & STATE_USED) && states[i].object == object &&
+       states[i].instance_id == instance_id &&
+       states[i].resource_id == resource_id) {
+      return &states[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static notify_state_t *
+allocate_state(const lwm2m_object_t *object, uint16_t instance_id,
+               uint16_t resource_id)
+{
+  notify_state_t *state;
+  int i;
+
+  state = find_state(object, instance_id, resource_id);
+  if(state != NULL) {
+    return state;
+  }
+  for(i = 0; i < LWM2M_ATTRIBUTES_MAX; i++) {
+    if((states[i].flags & STATE_USED) == 0) {
+      state = &states[i];
+      memset(state, 0, sizeof(*state));
+      state->object = object;
+      state->instance_id = instance_id;
+      state->resource_id = resource_id;
+      state->flags = STATE_USED;
+      state->notified_time = clock_time();
+      return state;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_state(notify_state_t *state)
+{
+  ctimer_stop(&state->timer);
+  state->flags = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_notification(notify_state_t *state)
+{
+  char path[16];
+
+  snprintf(path, sizeof(path), "/%u/%u",
+           state->instance_id, state->resource_id);
+  PRINTF("lwm2m-attr: notify %u%s\n", state->object->id, path);
+
+  state->flags &= ~STATE_PENDING;
+  state->flags |= STATE_NOTIFIED;
+  state->notified_time = clock_time();
+  if(state->flags & STATE_HAS_VALUE) {
+    state->notified_value = state->value;
+  }
+  coap_notify_observers_sub(lwm2m_object_get_coap_resource(state->object),
+                            path);
+  schedule(state);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_timer(void *ptr)
+{
+  send_notification((notify_state_t *)ptr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_timer(notify_state_t *state, uint16_t period)
+{
+  clock_time_t elapsed;
+  clock_time_t wait;
+
+  elapsed = clock_time() - state->notified_time;
+  wait = (clock_time_t)period * CLOCK_SECOND;
+  ctimer_set(&state->timer, wait > elapsed ? wait - elapsed : 0,
+             handle_timer, state);
+}
+/*---------------------------------------------------------------------------*/
+/* Arm the timer of a resource for the next pending or periodic
+   notification, or release the state if there are no attributes left */
+static void
+schedule(notify_state_t *state)
+{
+  attributes_t attr;
+
+  get_effective(&attr, state->object->id, state->instance_id,
+                state->resource_id);
+  if(attr.set == 0) {
+    if(state->flags & STATE_PENDING) {
+      send_notification(state);
+    }
+    free_state(state);
+  } else if(state->flags & STATE_PENDING) {
+    set_timer(state, (attr.set & ATTR_PMIN) ? attr.pmin : 0);
+  } else if((attr.set & ATTR_PMAX) && attr.pmax > 0) {
+    set_timer(state, attr.pmax);
+  } else {
+    ctimer_stop(&state->timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+has_changed_enough(const attributes_t *attr, const notify_state_t *state)
+{
+  int32_t last;
+  int32_t value;
+  int32_t diff;
+
+  if((attr->set & (ATTR_GT | ATTR_LT | ATTR_ST)) == 0 ||
+     (state->flags & (STATE_NOTIFIED | STATE_HAS_VALUE)) !=
+     (STATE_NOTIFIED | STATE_HAS_VALUE)) {
+    return 1;
+  }
+
+  last = state->notified_value;
+  value = state->value;
+  if((attr->set & ATTR_GT) && ((last > attr->gt) != (value > attr->gt))) {
+    return 1;
+  }
+  if((attr->set & ATTR_LT) && ((last < attr->lt) != (value < attr->lt))) {
+    return 1;
+  }
+  if(attr->set & ATTR_ST) {
+    diff = value > last ? value - last : last - value;
+    if(diff >= attr->st) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_value(const lwm2m_object_t *object, uint16_t instance_id,
+           uint16_t resource_id, int32_t *value)
+{
+  const lwm2m_instance_t *instance;
+  const lwm2m_resource_t *resource;
+  lwm2m_context_t context;
+  int i;
+
+  memset(&context, 0, sizeof(context));
+  for(i = 0; i < object->count; i++) {
+    instance = &object->instances[i];
+    if(instance->id == instance_id &&
+       (instance->flag & LWM2M_INSTANCE_FLAG_USED)) {
+      context.object_instance_index = i;
+      break;
+    }
+  }
+  if(i == object->count) {
+    return 0;
+  }
+
+  for(i = 0; i < instance->count; i++) {
+    resource = &instance->resources[i];
+    if(resource->id != resource_id) {
+      continue;
+    }
+    context.resource_index = i;
+    if(lwm2m_object_is_resource_floatfix(resource)) {
+      return lwm2m_object_get_resource_floatfix(resource, &context, value);
+    }
+    if(lwm2m_object_is_resource_int(resource) &&
+       lwm2m_object_get_resource_int(resource, &context, value)) {
+      *value *= LWM2M_FLOAT32_FRAC;
+      return 1;
+    }
+    break;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse_id(const char **path, uint16_t *id)
+{
+  const char *p;
+
+  p = *path;
+  if(*p != '/') {
+    return 0;
+  }
+  p++;
+  *id = 0;
+  if(*p < '0' || *p > '9') {
+    return 0;
+  }
+  while(*p >= '0' && *p <= '9') {
+    *id = *id * 10 + (*p - '0');
+    p++;
+  }
+  *path = p;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+lwm2m_attributes_notify(const lwm2m_object_t *object, const char *path,
+                        const int32_t *value)
+{
+  attributes_t attr;
+  notify_state_t *state;
+  const char *p;
+  uint16_t instance_id;
+  uint16_t resource_id;
+  int32_t current;
+#if COAP_RESPONSE_CACHE_SIZE
+  char url[COAP_OBSERVER_URL_LEN];
+#endif /* COAP_RESPONSE_CACHE_SIZE */
+
+  p = path;
+  if(path == NULL || !parse_id(&p, &instance_id) ||
+     !parse_id(&p, &resource_id) || *p != '\0') {
+    /* Only resources can have throttled notifications */
+    coap_notify_observers_sub(lwm2m_object_get_coap_resource(object), path);
+    return;
+  }
+
+  get_effective(&attr, object->id, instance_id, resource_id);
+  state = NULL;
+  if(attr.set != 0) {
+    state = allocate_state(object, instance_id, resource_id);
+  }
+  if(state == NULL) {
+    coap_notify_observers_sub(lwm2m_object_get_coap_resource(object), path);
+    return;
+  }
+
+  if(value != NULL) {
+    state->value = *value;
+    state->flags |= STATE_HAS_VALUE;
+  } else if(read_value(object, instance_id, resource_id, &current)) {
+    state->value = current;
+    state->flags |= STATE_HAS_VALUE;
+  } else {
+    state->flags &= ~STATE_HAS_VALUE;
+  }
+
+#if COAP_RESPONSE_CACHE_SIZE
+  /* A suppressed notification still means that the value changed */
+  snprintf(url, sizeof(url), "%s%s",
+           lwm2m_object_get_coap_resource(object)->url, path);
+  coap_cache_invalidate(url, strlen(url));
+#endif /* COAP_RESPONSE_CACHE_SIZE */
+
+  if(!has_changed_enough(&attr, state)) {
+    PRINTF("lwm2m-attr: %u%s below thresholds\n", object->id, path);
+    return;
+  }
+
+  if((attr.set & ATTR_PMIN) && (state->flags & STATE_NOTIFIED) &&
+     clock_time() - state->notified_time <
+     (clock_time_t)attr.pmin * CLOCK_SECOND) {
+    PRINTF("lwm2m-attr: %u%s deferred by pmin\n", object->id, path);
+    if(!(state->flags & STATE_PENDING)) {
+      state->flags |= STATE_PENDING;
+      schedule(state);
+    }
+    return;
+  }
+
+  send_notification(state);
+}
+/*---------------------------------------------------------------------------*/
+static attributes_t *
+get_entry(uint16_t object_id, uint16_t instance_id, uint16_t resource_id)
+{
+  attributes_t *free_entry;
+  int i;
+
+  free_entry = NULL;
+  for(i = 0; i < LWM2M_ATTRIBUTES_MAX; i++) {
+    if(attributes[i].set == 0) {
+      if(free_entry == NULL) {
+        free_entry = &attributes[i];
+      }
+    } else if(attributes[i].object_id == object_id &&
+              attributes[i].instance_id == instance_id &&
+              attributes[i].resource_id == resource_id) {
+      return &attributes[i];
+    }
+  }
+  if(free_entry != NULL) {
+    memset(free_entry, 0, sizeof(*free_entry));
+    free_entry->object_id = object_id;
+    free_entry->instance_id = instance_id;
+    free_entry->resource_id = resource_id;
+  }
+  return free_entry;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse_attribute(attributes_t *entry, const char *name, int name_len,
+                const char *value, int value_len)
+{
+  uint8_t flag;
+  int32_t number;
+
+  if(name_len == 4 && strncmp(name, "pmin", 4) == 0) {
+    flag = ATTR_PMIN;
+  } else if(name_len == 4 && strncmp(name, "pmax", 4) == 0) {
+    flag = ATTR_PMAX;
+  } else if(name_len == 2 && strncmp(name, "gt", 2) == 0) {
+    flag = ATTR_GT;
+  } else if(name_len == 2 && strncmp(name, "lt", 2) == 0) {
+    flag = ATTR_LT;
+  } else if(name_len == 2 && strncmp(name, "st", 2) == 0) {
+    flag = ATTR_ST;
+  } else {
+    /* Unknown attributes are ignored */
+    return 1;
+  }
+
+  if(value == NULL) {
+    entry->set &= ~flag;
+    return 1;
+  }
+
+  if(flag == ATTR_PMIN || flag == ATTR_PMAX) {
+    if((int)lwm2m_plain_text_read_int((const uint8_t *)value, value_len,
+                                      &number) != value_len ||
+       number < 0 || number > 0xffff) {
+      return 0;
+    }
+    if(flag == ATTR_PMIN) {
+      entry->pmin = number;
+    } else {
+      entry->pmax = number;
+    }
+  } else {
+    if((int)lwm2m_plain_text_read_float32fix((const uint8_t *)value,
+                                             value_len, &number,
+                                             LWM2M_FLOAT32_BITS) !=
+       value_len) {
+      return 0;
+    }
+    if(flag == ATTR_GT) {
+      entry->gt = number;
+    } else if(flag == ATTR_LT) {
+      entry->lt = number;
+    } else if(number < 0) {
+      return 0;
+    } else {
+      entry->st = number;
+    }
+  }
+  entry->set |= flag;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+lwm2m_attributes_write(const lwm2m_context_t *context, int depth,
+                       const char *query, int query_len)
+{
+  const lwm2m_object_t *object;
+  attributes_t *entry;
+  attributes_t update;
+  const char *end;
+  const char *sep;
+  const char *eq;
+  int i;
+
+  if(depth < 1 || depth > 3) {
+    return 0;
+  }
+
+  entry = get_entry(context->object_id,
+                    depth > 1 ? context->object_instance_id : ANY_ID,
+                    depth > 2 ? context->resource_id : ANY_ID);
+  if(entry == NULL) {
+    PRINTF("lwm2m-attr: no room for attributes\n");
+    return 0;
+  }
+
+  /* Apply the query to a copy so that an invalid request has no effect */
+  update = *entry;
+  end = query + query_len;
+  while(query < end) {
+    sep = memchr(query, '&', end - query);
+    if(sep == NULL) {
+      sep = end;
+    }
+    eq = memchr(query, '=', sep - query);
+    if(!parse_attribute(&update, query,
+                        (eq != NULL ? eq : sep) - query,
+                        eq != NULL ? eq + 1 : NULL,
+                        eq != NULL ? sep - eq - 1 : 0)) {
+      return 0;
+    }
+    query = sep + 1;
+  }
+
+  if((update.set & (ATTR_PMIN | ATTR_PMAX)) == (ATTR_PMIN | ATTR_PMAX) &&
+     update.pmax > 0 && update.pmin > update.pmax) {
+    return 0;
+  }
+  if((update.set & (ATTR_GT | ATTR_LT)) == (ATTR_GT | ATTR_LT) &&
+     update.lt >= update.gt) {
+    return 0;
+  }
+
+  *entry = update;
+  PRINTF("lwm2m-attr: /%u/%u/%u set 0x%02x pmin %u pmax %u\n",
+         entry->object_id, entry->instance_id, entry->resource_id,
+         entry->set, entry->pmin, entry->pmax);
+
+  /* Start the periodic notifications of a resource right away */
+  object = lwm2m_engine_get_object(context->object_id);
+  if(depth == 3 && (entry->set & ATTR_PMAX) && object != NULL) {
+    allocate_state(object, context->object_instance_id,
+                   context->resource_id);
+  }
+
+  for(i = 0; i < LWM2M_ATTRIBUTES_MAX; i++) {
+    if(states[i].flags & STATE_USED) {
+      schedule(&states[i]);
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* LWM2M_ATTRIBUTES_MAX */
+/** @} */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015, Yanzi Networks AB.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup oma-lwm2m
+ * @{
+ */
+
+/**
+ * \file
+ *         Header file for the LWM2M notification attributes (pmin, pmax,
+ *         gt, lt and st) that throttle the notifications to observers.
+ */
+
+#ifndef LWM2M_ATTRIBUTES_H_
+#define LWM2M_ATTRIBUTES_H_
+
+#include "contiki.h"
+
+/*
+ * The number of Write-Attributes entries, which is also the number of
+ * resources whose notifications can be throttled at the same time.
+ * Zero disables the support for notification attributes.
+ */
+#ifdef LWM2M_ATTRIBUTES_CONF_MAX
+#define LWM2M_ATTRIBUTES_MAX LWM2M_ATTRIBUTES_CONF_MAX
+#else /* LWM2M_ATTRIBUTES_CONF_MAX */
+#define LWM2M_ATTRIBUTES_MAX 0
+#endif /* LWM2M_ATTRIBUTES_CONF_MAX */
+
+struct lwm2m_object;
+struct lwm2m_context;
+
+/*
+ * Store the attributes given in the query string of a Write-Attributes
+ * request for the object, object instance, or resource in the context,
+ * depending on the depth of the request path. An attribute without a
+ * value is removed. Returns 1 on success and 0 if the query is invalid
+ * or there is no room for the attributes.
+ */
+int lwm2m_attributes_write(const struct lwm2m_context *context, int depth,
+                           const char *query, int query_len);
+
+/*
+ * Notify the observers of a resource, given as a path relative to the
+ * object such as "/0/5700", subject to its notification attributes.
+ * The value is the current value of the resource as a fix point float
+ * with LWM2M_FLOAT32_BITS fraction bits, or NULL when the value should
+ * be read from the resource.
+ */
+void lwm2m_attributes_notify(const struct lwm2m_object *object,
+                             const char *path, const int32_t *value);
+
+#endif /* LWM2M_ATTRIBUTES_H_ */
+/** @} */
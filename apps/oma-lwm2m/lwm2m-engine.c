@@ -53,6 +53,7 @@
 #include "oma-tlv.h"
 #include "oma-tlv-reader.h"
 #include "oma-tlv-writer.h"
+#include "lib/numfmt.h"
 #include "net/ipv6/uip-ds6.h"
 #include <stdio.h>
 #include <string.h>
@@ -82,9 +83,12 @@
 #define REMOTE_PORT        UIP_HTONS(COAP_DEFAULT_PORT)
 #define BS_REMOTE_PORT     UIP_HTONS(5685)
 
+/* registered objects, sorted by object id */
 static const lwm2m_object_t *objects[MAX_OBJECTS];
+static uint8_t object_count = 0;
 static char endpoint[32];
 static char rd_data[128]; /* allocate some data for the RD */
+static int rd_data_len = -1; /* length of cached RD data or -1 if stale */
 
 PROCESS(lwm2m_rd_client, "LWM2M Engine");
 
@@ -245,6 +249,78 @@ update_bootstrap_server(void)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Write a CoRE Link-format path such as "<3/0/1>" preceded by the given
+ * opening string. Returns the length without the terminating zero or 0
+ * if the link does not fit in the buffer.
+ */
+static size_t
+write_link(char *buffer, size_t size, const char *open,
+           const uint16_t *ids, int count)
+{
+  size_t len, n;
+  int i;
+
+  len = strlen(open);
+  if(len >= size) {
+    return 0;
+  }
+  memcpy(buffer, open, len);
+  for(i = 0; i < count; i++) {
+    if(i > 0) {
+      if(len >= size) {
+        return 0;
+      }
+      buffer[len++] = '/';
+    }
+    n = numfmt_utoa(&buffer[len], size - len, ids[i]);
+    if(n == 0) {
+      return 0;
+    }
+    len += n;
+  }
+  if(len + 1 >= size) {
+    return 0;
+  }
+  buffer[len++] = '>';
+  buffer[len] = '\0';
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_rd_data(void)
+{
+  uint16_t ids[2];
+  int pos;
+  int len, i, j;
+
+  /* reuse the cached RD data until objects or instances change */
+  if(rd_data_len >= 0) {
+    return rd_data_len;
+  }
+
+  pos = 0;
+  for(i = 0; i < object_count; i++) {
+    for(j = 0; j < objects[i]->count; j++) {
+      if(objects[i]->instances[j].flag & LWM2M_INSTANCE_FLAG_USED) {
+        ids[0] = objects[i]->id;
+        ids[1] = objects[i]->instances[j].id;
+        len = write_link(&rd_data[pos], sizeof(rd_data) - pos,
+                         pos > 0 ? ",<" : "<", ids, 2);
+        pos += len;
+      }
+    }
+  }
+  rd_data_len = pos;
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+void
+lwm2m_engine_invalidate_registration(void)
+{
+  rd_data_len = -1;
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(lwm2m_rd_client, ev, data)
 {
   static coap_packet_t request[1];      /* This way the packet can be treated as pointer as usual. */
@@ -346,7 +422,6 @@ PROCESS_THREAD(lwm2m_rd_client, ev, data)
       } else if(use_registration && !registered &&
                 update_registration_server()) {
         int pos;
-        int len, i, j;
         registered = 1;
 
         /* prepare request, TID is set by COAP_BLOCKING_REQUEST() */
@@ -355,21 +430,7 @@ PROCESS_THREAD(lwm2m_rd_client, ev, data)
         coap_set_header_uri_query(request, endpoint);
 
         /* generate the rd data */
-        pos = 0;
-        for(i = 0; i < MAX_OBJECTS; i++) {
-          if(objects[i] != NULL) {
-            for(j = 0; j < objects[i]->count; j++) {
-              if(objects[i]->instances[j].flag & LWM2M_INSTANCE_FLAG_USED) {
-                len = snprintf(&rd_data[pos], sizeof(rd_data) - pos,
-                               "%s<%d/%d>", pos > 0 ? "," : "",
-                               objects[i]->id, objects[i]->instances[j].id);
-                if(len > 0 && len < sizeof(rd_data) - pos) {
-                  pos += len;
-                }
-              }
-            }
-          }
-        }
+        pos = write_rd_data();
 
         coap_set_payload(request, (uint8_t *)rd_data, pos);
 
@@ -499,10 +560,20 @@ lwm2m_engine_parse_context(const lwm2m_object_t *object,
 const lwm2m_object_t *
 lwm2m_engine_get_object(uint16_t id)
 {
-  int i;
-  for(i = 0; i < MAX_OBJECTS; i++) {
-    if(objects[i] != NULL && objects[i]->id == id) {
-      return objects[i];
+  int low, high, mid;
+
+  /* binary search in the sorted object list */
+  low = 0;
+  high = object_count - 1;
+  while(low <= high) {
+    mid = (low + high) / 2;
+    if(objects[mid]->id == id) {
+      return objects[mid];
+    }
+    if(objects[mid]->id < id) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
     }
   }
   return NULL;
@@ -513,12 +584,15 @@ lwm2m_engine_register_object(const lwm2m_object_t *object)
 {
   int i;
   int found = 0;
-  for(i = 0; i < MAX_OBJECTS; i++) {
-    if(objects[i] == NULL) {
-      objects[i] = object;
-      found = 1;
-      break;
+  if(object_count < MAX_OBJECTS) {
+    /* insert the object keeping the list sorted by object id */
+    for(i = object_count; i > 0 && objects[i - 1]->id > object->id; i--) {
+      objects[i] = objects[i - 1];
     }
+    objects[i] = object;
+    object_count++;
+    found = 1;
+    lwm2m_engine_invalidate_registration();
   }
   rest_activate_resource(lwm2m_object_get_coap_resource(object),
                          (char *)object->path);
@@ -557,6 +631,13 @@ get_instance(const lwm2m_object_t *object, lwm2m_context_t *context, int depth)
   int i;
   if(depth > 1) {
     PRINTF("lwm2m: searching for instance %u\n", context->object_instance_id);
+    /* instance ids are usually the same as their index */
+    i = context->object_instance_id;
+    if(i < object->count && object->instances[i].id == i &&
+       object->instances[i].flag & LWM2M_INSTANCE_FLAG_USED) {
+      context->object_instance_index = i;
+      return &object->instances[i];
+    }
     for(i = 0; i < object->count; i++) {
       PRINTF("  Instance %d -> %u (used: %d)\n", i, object->instances[i].id,
              (object->instances[i].flag & LWM2M_INSTANCE_FLAG_USED) != 0);
@@ -573,9 +654,25 @@ get_instance(const lwm2m_object_t *object, lwm2m_context_t *context, int depth)
 static const lwm2m_resource_t *
 get_resource(const lwm2m_instance_t *instance, lwm2m_context_t *context)
 {
-  int i;
+  int low, high, i;
   if(instance != NULL) {
     PRINTF("lwm2m: searching for resource %u\n", context->resource_id);
+    /* resources are normally listed by id - try a binary search first */
+    low = 0;
+    high = instance->count - 1;
+    while(low <= high) {
+      i = (low + high) / 2;
+      if(instance->resources[i].id == context->resource_id) {
+        context->resource_index = i;
+        return &instance->resources[i];
+      }
+      if(instance->resources[i].id < context->resource_id) {
+        low = i + 1;
+      } else {
+        high = i - 1;
+      }
+    }
+    /* not found - the resources might not be sorted */
     for(i = 0; i < instance->count; i++) {
       PRINTF("  Resource %d -> %u\n", i, instance->resources[i].id);
       if(instance->resources[i].id == context->resource_id) {
@@ -595,12 +692,13 @@ write_object_instances_link(const lwm2m_object_t *object,
                             char *buffer, size_t size)
 {
   const lwm2m_instance_t *instance;
+  uint16_t ids[2];
   int len, rdlen, i;
 
   PRINTF("</%d>", object->id);
-  rdlen = snprintf(buffer, size, "</%d>",
-                   object->id);
-  if(rdlen < 0 || rdlen >= size) {
+  ids[0] = object->id;
+  rdlen = write_link(buffer, size, "</", ids, 1);
+  if(rdlen == 0) {
     return -1;
   }
 
@@ -611,12 +709,12 @@ write_object_instances_link(const lwm2m_object_t *object,
     instance = &object->instances[i];
     PRINTF(",</%d/%d>", object->id, instance->id);
 
-    len = snprintf(&buffer[rdlen], size - rdlen,
-                   ",<%d/%d>", object->id, instance->id);
-    rdlen += len;
-    if(len < 0 || rdlen >= size) {
+    ids[1] = instance->id;
+    len = write_link(&buffer[rdlen], size - rdlen, ",<", ids, 2);
+    if(len == 0) {
       return -1;
     }
+    rdlen += len;
   }
   return rdlen;
 }
@@ -627,12 +725,14 @@ write_rd_link_data(const lwm2m_object_t *object,
                    char *buffer, size_t size)
 {
   const lwm2m_resource_t *resource;
+  uint16_t ids[3];
   int len, rdlen, i;
 
   PRINTF("<%d/%d>", object->id, instance->id);
-  rdlen = snprintf(buffer, size, "<%d/%d>",
-                   object->id, instance->id);
-  if(rdlen < 0 || rdlen >= size) {
+  ids[0] = object->id;
+  ids[1] = instance->id;
+  rdlen = write_link(buffer, size, "<", ids, 2);
+  if(rdlen == 0) {
     return -1;
   }
 
@@ -640,12 +740,12 @@ write_rd_link_data(const lwm2m_object_t *object,
     resource = &instance->resources[i];
     PRINTF(",<%d/%d/%d>", object->id, instance->id, resource->id);
 
-    len = snprintf(&buffer[rdlen], size - rdlen,
-                   ",<%d/%d/%d>", object->id, instance->id, resource->id);
-    rdlen += len;
-    if(len < 0 || rdlen >= size) {
+    ids[2] = resource->id;
+    len = write_link(&buffer[rdlen], size - rdlen, ",<", ids, 3);
+    if(len == 0) {
       return -1;
     }
+    rdlen += len;
   }
   return rdlen;
 }
@@ -743,6 +843,39 @@ write_rd_json_data(const lwm2m_context_t *context,
   return rdlen;
 }
 /*---------------------------------------------------------------------------*/
+/**
+ * @brief Write one block of the TLV encoding of an instance or an object
+ */
+static void
+write_tlv_block(lwm2m_context_t *context, const lwm2m_object_t *object,
+                const lwm2m_instance_t *instance, void *response,
+                uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  uint32_t start;
+  int len, more;
+
+  start = offset != NULL && *offset > 0 ? *offset : 0;
+  len = oma_tlv_writer_write_instances(context, object, instance,
+                                       buffer, preferred_size, start, &more);
+  if(len == 0 && start > 0) {
+    REST.set_response_status(response, BAD_OPTION_4_02);
+    return;
+  }
+  REST.set_header_content_type(response, LWM2M_TLV);
+  REST.set_response_payload(response, buffer, len);
+
+  if(offset == NULL) {
+    /* a notification - the client fetches the rest with Block2 */
+    if(more) {
+      coap_set_header_block2(response, 0, 1, preferred_size);
+    }
+  } else if(more) {
+    *offset = start + len;
+  } else if(start > 0) {
+    *offset = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
 /**
  * @brief  Set the writer pointer to the proper writer based on the Accept: header
  *
@@ -869,6 +1002,26 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
 
   instance = get_instance(object, &context, depth);
 
+#if LWM2M_ATTRIBUTES_MAX
+  if(method == METHOD_PUT) {
+    const char *query;
+    const uint8_t *data;
+    int qlen = REST.get_query(request, &query);
+    /* A PUT with a query and no payload is a Write-Attributes */
+    if(qlen > 0 && REST.get_request_payload(request, &data) == 0) {
+      if((depth > 1 && instance == NULL) ||
+         (depth == 3 && get_resource(instance, &context) == NULL)) {
+        REST.set_response_status(response, NOT_FOUND_4_04);
+      } else if(lwm2m_attributes_write(&context, depth, query, qlen)) {
+        REST.set_response_status(response, CHANGED_2_04);
+      } else {
+        REST.set_response_status(response, BAD_REQUEST_4_00);
+      }
+      return;
+    }
+  }
+#endif /* LWM2M_ATTRIBUTES_MAX */
+
   /* from POST */
   if(depth > 1 && instance == NULL) {
     if(method != METHOD_PUT && method != METHOD_POST) {
@@ -888,6 +1041,7 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
           object->instances[i].flag |= LWM2M_INSTANCE_FLAG_USED;
           object->instances[i].id = context.object_instance_id;
           context.object_instance_index = i;
+          lwm2m_engine_invalidate_registration();
           PRINTF("Created instance: %d\n", context.object_instance_id);
           REST.set_response_status(response, CREATED_2_01);
           instance = &object->instances[i];
@@ -1065,6 +1219,9 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
       REST.set_response_status(response, METHOD_NOT_ALLOWED_4_05);
     } else if(instance == NULL) {
       REST.set_response_status(response, NOT_FOUND_4_04);
+    } else if(accept == LWM2M_TLV) {
+      write_tlv_block(&context, object, instance, response,
+                      buffer, preferred_size, offset);
     } else {
       int rdlen;
       if(accept == APPLICATION_LINK_FORMAT) {
@@ -1090,6 +1247,10 @@ lwm2m_engine_handler(const lwm2m_object_t *object,
     /* produce a list of instances */
     if(method != METHOD_GET) {
       REST.set_response_status(response, METHOD_NOT_ALLOWED_4_05);
+    } else if(accept == LWM2M_TLV) {
+      PRINTF("Sending TLV of all instances of object %u\n", object->id);
+      write_tlv_block(&context, object, NULL, response,
+                      buffer, preferred_size, offset);
     } else {
       int rdlen;
       PRINTF("Sending instance list for object %u\n", object->id);
@@ -68,6 +68,10 @@ const lwm2m_object_t *lwm2m_engine_get_object(uint16_t id);
 
 int lwm2m_engine_register_object(const lwm2m_object_t *object);
 
+/* Must be called when the instances of an object are changed outside the
+   engine so that the registration data is generated again */
+void lwm2m_engine_invalidate_registration(void);
+
 void lwm2m_engine_handler(const lwm2m_object_t *object,
                           void *request, void *response,
                           uint8_t *buffer, uint16_t preferred_size,
@@ -42,11 +42,11 @@
 
 #include "lwm2m-object.h"
 #include "lwm2m-json.h"
-#include "lwm2m-plain-text.h"
+#include "lib/numfmt.h"
 #include <stdio.h>
 #include <stddef.h>
 #include <stdint.h>
-#include <inttypes.h>
+#include <string.h>
 
 #define DEBUG 0
 #if DEBUG
@@ -57,99 +57,141 @@
 
 /*---------------------------------------------------------------------------*/
 static size_t
-write_boolean(const lwm2m_context_t *ctx, uint8_t *outbuf, size_t outlen,
-              int value)
+append(uint8_t *outbuf, size_t outlen, size_t len, const char *str)
+{
+  size_t n = strlen(str);
+  if(len == 0 || n >= outlen - len) {
+    return 0;
+  }
+  memcpy(&outbuf[len], str, n);
+  return len + n;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Write the start of a single resource record up to and including the
+ * colon after the value name. Returns the length or 0 on overflow.
+ */
+static size_t
+write_head(const lwm2m_context_t *ctx, uint8_t *outbuf, size_t outlen,
+           const char *name)
 {
-  int len = snprintf((char *)outbuf, outlen, "{\"e\":[{\"n\":\"%u\",\"bv\":%s}]}\n", ctx->resource_id, value ? "true" : "false");
-  if((len < 0) || (len >= outlen)) {
+  static const char start[] = "{\"e\":[{\"n\":\"";
+  size_t len, n;
+
+  if(outlen < sizeof(start)) {
+    return 0;
+  }
+  len = sizeof(start) - 1;
+  memcpy(outbuf, start, len);
+  n = numfmt_utoa((char *)&outbuf[len], outlen - len, ctx->resource_id);
+  if(n == 0) {
     return 0;
   }
+  len = append(outbuf, outlen, len + n, "\",\"");
+  len = append(outbuf, outlen, len, name);
+  return append(outbuf, outlen, len, "\":");
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Write the end of a record and a terminating zero. Returns the length
+ * without the zero or 0 on overflow.
+ */
+static size_t
+write_tail(uint8_t *outbuf, size_t outlen, size_t len, const char *tail)
+{
+  len = append(outbuf, outlen, len, tail);
+  if(len > 0) {
+    outbuf[len] = '\0';
+  }
   return len;
 }
 /*---------------------------------------------------------------------------*/
 static size_t
+write_boolean(const lwm2m_context_t *ctx, uint8_t *outbuf, size_t outlen,
+              int value)
+{
+  size_t len;
+  len = write_head(ctx, outbuf, outlen, "bv");
+  len = append(outbuf, outlen, len, value ? "true" : "false");
+  return write_tail(outbuf, outlen, len, "}]}\n");
+}
+/*---------------------------------------------------------------------------*/
+static size_t
 write_int(const lwm2m_context_t *ctx, uint8_t *outbuf, size_t outlen,
           int32_t value)
 {
-  int len = snprintf((char *)outbuf, outlen, "{\"e\":[{\"n\":\"%u\",\"v\":%" PRId32 "}]}\n", ctx->resource_id, value);
-  if((len < 0) || (len >= outlen)) {
+  size_t len, n;
+  len = write_head(ctx, outbuf, outlen, "v");
+  if(len == 0) {
     return 0;
   }
-  return len;
+  n = numfmt_itoa((char *)&outbuf[len], outlen - len, value);
+  if(n == 0) {
+    return 0;
+  }
+  return write_tail(outbuf, outlen, len + n, "}]}\n");
 }
 /*---------------------------------------------------------------------------*/
 static size_t
 write_float32fix(const lwm2m_context_t *ctx, uint8_t *outbuf, size_t outlen,
                  int32_t value, int bits)
 {
-  size_t len = 0;
-  int res;
-  res = snprintf((char *)outbuf, outlen, "{\"e\":[{\"n\":\"%u\",\"v\":", ctx->resource_id);
-  if(res <= 0 || res >= outlen) {
-    return 0;
-  }
-  len += res;
-  outlen -= res;
-  res = lwm2m_plain_text_write_float32fix(&outbuf[len], outlen, value, bits);
-  if((res <= 0) || (res >= outlen)) {
+  size_t len, n;
+  len = write_head(ctx, outbuf, outlen, "v");
+  if(len == 0) {
     return 0;
   }
-  len += res;
-  outlen -= res;
-  res = snprintf((char *)&outbuf[len], outlen, "}]}\n");
-  if((res <= 0) || (res >= outlen)) {
+  n = numfmt_fixpoint((char *)&outbuf[len], outlen - len, value, bits, 2);
+  if(n == 0) {
     return 0;
   }
-  len += res;
-  return len;
+  return write_tail(outbuf, outlen, len + n, "}]}\n");
 }
 /*---------------------------------------------------------------------------*/
 static size_t
 write_string(const lwm2m_context_t *ctx, uint8_t *outbuf, size_t outlen,
              const char *value, size_t stringlen)
 {
-  size_t i;
-  size_t len = 0;
-  int res;
-  PRINTF("{\"e\":[{\"n\":\"%u\",\"sv\":\"", ctx->resource_id);
-  res = snprintf((char *)outbuf, outlen, "{\"e\":[{\"n\":\"%u\",\"sv\":\"", ctx->resource_id);
-  if(res < 0 || res >= outlen) {
+  size_t i, n;
+  size_t len;
+
+  len = write_head(ctx, outbuf, outlen, "sv");
+  len = append(outbuf, outlen, len, "\"");
+  if(len == 0) {
     return 0;
   }
-  len += res;
-  for (i = 0; i < stringlen && len < outlen; ++i) {
+  PRINTF("{\"e\":[{\"n\":\"%u\",\"sv\":\"", ctx->resource_id);
+  for(i = 0; i < stringlen; ++i) {
     /* Escape special characters */
     /* TODO: Handle UTF-8 strings */
     if(value[i] < '\x20') {
-      PRINTF("\\x%x", value[i]);
-      res = snprintf((char *)&outbuf[len], outlen - len, "\\x%x", value[i]);
-      if((res < 0) || (res >= (outlen - len))) {
+      PRINTF("\\x%x", (uint8_t)value[i]);
+      len = append(outbuf, outlen, len, "\\x");
+      if(len == 0) {
         return 0;
       }
-      len += res;
+      n = numfmt_hex((char *)&outbuf[len], outlen - len,
+                     (uint8_t)value[i], 0);
+      if(n == 0) {
+        return 0;
+      }
+      len += n;
       continue;
     } else if(value[i] == '"' || value[i] == '\\') {
       PRINTF("\\");
-      outbuf[len] = '\\';
-      ++len;
-      if(len >= outlen) {
+      if(len + 1 >= outlen) {
         return 0;
       }
+      outbuf[len++] = '\\';
     }
     PRINTF("%c", value[i]);
-    outbuf[len] = value[i];
-    ++len;
-    if(len >= outlen) {
+    if(len + 1 >= outlen) {
       return 0;
     }
+    outbuf[len++] = value[i];
   }
   PRINTF("\"}]}\n");
-  res = snprintf((char *)&outbuf[len], outlen - len, "\"}]}\n");
-  if((res < 0) || (res >= (outlen - len))) {
-    return 0;
-  }
-  len += res;
-  return len;
+  return write_tail(outbuf, outlen, len, "\"}]}\n");
 }
 /*---------------------------------------------------------------------------*/
 const lwm2m_writer_t lwm2m_json_writer = {
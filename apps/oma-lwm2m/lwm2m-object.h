@@ -53,6 +53,7 @@
 
 #include "rest-engine.h"
 #include "er-coap-observe.h"
+#include "lwm2m-attributes.h"
 
 #define LWM2M_OBJECT_SECURITY_ID                0
 #define LWM2M_OBJECT_SERVER_ID                  1
@@ -347,7 +348,24 @@ lwm2m_object_get_coap_resource(const lwm2m_object_t *object)
 static inline void
 lwm2m_object_notify_observers(const lwm2m_object_t *object, char *path)
 {
+#if LWM2M_ATTRIBUTES_MAX
+  lwm2m_attributes_notify(object, path, NULL);
+#else /* LWM2M_ATTRIBUTES_MAX */
   coap_notify_observers_sub(lwm2m_object_get_coap_resource(object), path);
+#endif /* LWM2M_ATTRIBUTES_MAX */
+}
+
+/* Notify with the new value of a resource that is computed by a callback,
+   as a fix point float, so that the gt, lt and st attributes apply */
+static inline void
+lwm2m_object_notify_observers_value(const lwm2m_object_t *object, char *path,
+                                    int32_t value)
+{
+#if LWM2M_ATTRIBUTES_MAX
+  lwm2m_attributes_notify(object, path, &value);
+#else /* LWM2M_ATTRIBUTES_MAX */
+  coap_notify_observers_sub(lwm2m_object_get_coap_resource(object), path);
+#endif /* LWM2M_ATTRIBUTES_MAX */
 }
 
 #include "lwm2m-engine.h"
@@ -43,6 +43,7 @@
 
 #include "lwm2m-object.h"
 #include "lwm2m-plain-text.h"
+#include "lib/numfmt.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -125,31 +126,18 @@ size_t
 lwm2m_plain_text_write_float32fix(uint8_t *outbuf, size_t outlen,
                                   int32_t value, int bits)
 {
-  int64_t v;
-  unsigned long integer_part;
-  unsigned long frac_part;
-  int n, o = 0;
+  size_t n;
 
+  /* Leave room for a terminating zero */
   if(outlen == 0) {
     return 0;
   }
-  if(value < 0) {
-    *outbuf++ = '-';
-    outlen--;
-    o = 1;
-    value = -value;
-  }
-
-  integer_part = (unsigned long)(value >> bits);
-  v = value - (integer_part << bits);
-  v = (v * 100) >> bits;
-  frac_part = (unsigned long)v;
-
-  n = snprintf((char *)outbuf, outlen, "%lu.%02lu", integer_part, frac_part);
-  if(n < 0 || n >= outlen) {
+  n = numfmt_fixpoint((char *)outbuf, outlen - 1, value, bits, 2);
+  if(n == 0) {
     return 0;
   }
-  return n + o;
+  outbuf[n] = '\0';
+  return n;
 }
 /*---------------------------------------------------------------------------*/
 static size_t
@@ -171,11 +159,7 @@ static size_t
 write_int(const lwm2m_context_t *ctx, uint8_t *outbuf, size_t outlen,
           int32_t value)
 {
-  int n = snprintf((char *)outbuf, outlen, "%ld", (long)value);
-  if(n < 0 || n >= outlen) {
-    return 0;
-  }
-  return n;
+  return numfmt_itoa((char *)outbuf, outlen, value);
 }
 /*---------------------------------------------------------------------------*/
 static size_t
@@ -189,11 +173,12 @@ static size_t
 write_string(const lwm2m_context_t *ctx, uint8_t *outbuf, size_t outlen,
              const char *value, size_t stringlen)
 {
-  int n = snprintf((char *)outbuf, outlen, "%.*s", (int) stringlen, value);
-  if(n < 0 || n >= outlen) {
+  if(stringlen >= outlen) {
     return 0;
   }
-  return n;
+  memcpy(outbuf, value, stringlen);
+  outbuf[stringlen] = '\0';
+  return stringlen;
 }
 /*---------------------------------------------------------------------------*/
 const lwm2m_writer_t lwm2m_plain_text_writer = {
@@ -44,6 +44,16 @@
 
 #include "lwm2m-object.h"
 #include "oma-tlv.h"
+#include "oma-tlv-writer.h"
+#include <string.h>
+
+/* The part of the TLV stream that goes into the output buffer */
+typedef struct {
+  uint8_t *buffer;
+  size_t size;
+  uint32_t offset;
+  uint32_t pos;
+} tlv_stream_t;
 /*---------------------------------------------------------------------------*/
 static size_t
 write_boolean_tlv(const lwm2m_context_t *ctx, uint8_t *outbuf, size_t outlen,
@@ -86,4 +96,125 @@ const lwm2m_writer_t oma_tlv_writer = {
   write_boolean_tlv
 };
 /*---------------------------------------------------------------------------*/
+static void
+stream_write(tlv_stream_t *s, const uint8_t *data, size_t len)
+{
+  uint32_t from, to;
+
+  /* only the bytes inside the window are copied, the rest is skipped */
+  if(s != NULL) {
+    if(s->pos + len > s->offset && s->pos < s->offset + s->size) {
+      from = s->pos < s->offset ? s->offset - s->pos : 0;
+      to = s->pos + len > s->offset + s->size ?
+        s->offset + s->size - s->pos : len;
+      memcpy(&s->buffer[s->pos + from - s->offset], &data[from], to - from);
+    }
+    s->pos += len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the size of the resource TLV and writes it to the stream (if any) */
+static size_t
+write_resource(tlv_stream_t *s, const lwm2m_context_t *ctx,
+               const lwm2m_resource_t *resource)
+{
+  uint8_t buf[8];
+  oma_tlv_t tlv;
+  size_t len;
+  int32_t value;
+  int bvalue;
+
+  len = 0;
+  if(lwm2m_object_is_resource_string(resource)) {
+    tlv.type = OMA_TLV_TYPE_RESOURCE;
+    tlv.id = resource->id;
+    tlv.value = lwm2m_object_get_resource_string(resource, ctx);
+    if(tlv.value == NULL) {
+      return 0;
+    }
+    tlv.length = lwm2m_object_get_resource_strlen(resource, ctx);
+    /* the string is written straight from the resource */
+    len = oma_tlv_write_header(&tlv, buf, sizeof(buf));
+    stream_write(s, buf, len);
+    stream_write(s, tlv.value, tlv.length);
+    return len + tlv.length;
+  } else if(lwm2m_object_is_resource_int(resource)) {
+    if(lwm2m_object_get_resource_int(resource, ctx, &value)) {
+      len = oma_tlv_write_int32(resource->id, value, buf, sizeof(buf));
+    }
+  } else if(lwm2m_object_is_resource_floatfix(resource)) {
+    if(lwm2m_object_get_resource_floatfix(resource, ctx, &value)) {
+      len = oma_tlv_write_float32(resource->id, value, LWM2M_FLOAT32_BITS,
+                                  buf, sizeof(buf));
+    }
+  } else if(lwm2m_object_is_resource_boolean(resource)) {
+    if(lwm2m_object_get_resource_boolean(resource, ctx, &bvalue)) {
+      len = oma_tlv_write_int32(resource->id, bvalue != 0 ? 1 : 0,
+                                buf, sizeof(buf));
+    }
+  }
+  stream_write(s, buf, len);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static size_t
+write_instance(tlv_stream_t *s, const lwm2m_context_t *ctx,
+               const lwm2m_instance_t *instance, int wrap)
+{
+  uint8_t buf[8];
+  oma_tlv_t tlv;
+  size_t len;
+  int i;
+
+  len = 0;
+  if(wrap) {
+    /* first pass: the size of the resources is needed in the header */
+    tlv.type = OMA_TLV_TYPE_OBJECT_INSTANCE;
+    tlv.id = instance->id;
+    tlv.length = write_instance(NULL, ctx, instance, 0);
+    len = oma_tlv_write_header(&tlv, buf, sizeof(buf));
+    stream_write(s, buf, len);
+  }
+  for(i = 0; i < instance->count; i++) {
+    len += write_resource(s, ctx, &instance->resources[i]);
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+oma_tlv_writer_write_instances(lwm2m_context_t *ctx,
+                               const lwm2m_object_t *object,
+                               const lwm2m_instance_t *instance,
+                               uint8_t *buffer, size_t size,
+                               uint32_t offset, int *more)
+{
+  tlv_stream_t s;
+  int i;
+
+  s.buffer = buffer;
+  s.size = size;
+  s.offset = offset;
+  s.pos = 0;
+
+  if(instance != NULL) {
+    write_instance(&s, ctx, instance, 0);
+  } else {
+    for(i = 0; i < object->count && s.pos <= offset + size; i++) {
+      if(object->instances[i].flag & LWM2M_INSTANCE_FLAG_USED) {
+        ctx->object_instance_id = object->instances[i].id;
+        ctx->object_instance_index = i;
+        write_instance(&s, ctx, &object->instances[i], 1);
+      }
+    }
+  }
+
+  if(more != NULL) {
+    *more = s.pos > offset + size;
+  }
+  if(s.pos <= offset) {
+    return 0;
+  }
+  return (s.pos > offset + size ? offset + size : s.pos) - offset;
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
@@ -46,5 +46,19 @@
 
 extern const lwm2m_writer_t oma_tlv_writer;
 
+/*
+ * Writes bytes offset to offset + size of the TLV encoding of an object
+ * instance, or of all instances of the object when instance is NULL, into
+ * buffer. The TLVs are emitted directly from the resources without staging
+ * the whole encoding, so objects larger than the buffer can be read with
+ * Block2. *more is set if the encoding continues after the buffer.
+ * Returns the number of bytes written.
+ */
+int oma_tlv_writer_write_instances(lwm2m_context_t *ctx,
+                                   const lwm2m_object_t *object,
+                                   const lwm2m_instance_t *instance,
+                                   uint8_t *buffer, size_t size,
+                                   uint32_t offset, int *more);
+
 #endif /* OMA_TLV_WRITER_H_ */
 /** @} */
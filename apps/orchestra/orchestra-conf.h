@@ -49,6 +49,8 @@
 #define ORCHESTRA_RULES { &eb_per_time_source, &unicast_per_neighbor_rpl_storing, &default_common }
 /* Example configuration for RPL non-storing mode: */
 /* #define ORCHESTRA_RULES { &eb_per_time_source, &unicast_per_neighbor_rpl_ns, &default_common } */
+/* Example configuration for RPL storing mode, with more cells to parents of large subtrees: */
+/* #define ORCHESTRA_RULES { &eb_per_time_source, &unicast_per_parent_load, &unicast_per_neighbor_rpl_storing, &default_common } */
 
 #endif /* ORCHESTRA_CONF_RULES */
 
@@ -72,6 +74,35 @@
 #define ORCHESTRA_UNICAST_PERIOD                  17
 #endif /* ORCHESTRA_CONF_UNICAST_PERIOD */
 
+/* Length of the per-parent load-adaptive unicast slotframe. Must be a prime
+ * number for the cells of a node to be distinct. */
+#ifdef ORCHESTRA_CONF_UNICAST_LOAD_PERIOD
+#define ORCHESTRA_UNICAST_LOAD_PERIOD             ORCHESTRA_CONF_UNICAST_LOAD_PERIOD
+#else /* ORCHESTRA_CONF_UNICAST_LOAD_PERIOD */
+#define ORCHESTRA_UNICAST_LOAD_PERIOD             23
+#endif /* ORCHESTRA_CONF_UNICAST_LOAD_PERIOD */
+
+/* Max number of cells a node listens at in the load-adaptive slotframe */
+#ifdef ORCHESTRA_CONF_UNICAST_LOAD_MAX_CELLS
+#define ORCHESTRA_UNICAST_LOAD_MAX_CELLS          ORCHESTRA_CONF_UNICAST_LOAD_MAX_CELLS
+#else /* ORCHESTRA_CONF_UNICAST_LOAD_MAX_CELLS */
+#define ORCHESTRA_UNICAST_LOAD_MAX_CELLS          4
+#endif /* ORCHESTRA_CONF_UNICAST_LOAD_MAX_CELLS */
+
+/* Number of descendants per additional cell in the load-adaptive slotframe */
+#ifdef ORCHESTRA_CONF_UNICAST_LOAD_DESCENDANTS_PER_CELL
+#define ORCHESTRA_UNICAST_LOAD_DESCENDANTS_PER_CELL ORCHESTRA_CONF_UNICAST_LOAD_DESCENDANTS_PER_CELL
+#else /* ORCHESTRA_CONF_UNICAST_LOAD_DESCENDANTS_PER_CELL */
+#define ORCHESTRA_UNICAST_LOAD_DESCENDANTS_PER_CELL 4
+#endif /* ORCHESTRA_CONF_UNICAST_LOAD_DESCENDANTS_PER_CELL */
+
+/* Interval at which the number of descendants is checked */
+#ifdef ORCHESTRA_CONF_UNICAST_LOAD_UPDATE_INTERVAL
+#define ORCHESTRA_UNICAST_LOAD_UPDATE_INTERVAL    ORCHESTRA_CONF_UNICAST_LOAD_UPDATE_INTERVAL
+#else /* ORCHESTRA_CONF_UNICAST_LOAD_UPDATE_INTERVAL */
+#define ORCHESTRA_UNICAST_LOAD_UPDATE_INTERVAL    (30 * CLOCK_SECOND)
+#endif /* ORCHESTRA_CONF_UNICAST_LOAD_UPDATE_INTERVAL */
+
 /* Is the per-neighbor unicast slotframe sender-based (if not, it is receiver-based).
  * Note: sender-based works only with RPL storing mode as it relies on DAO and
  * routing entries to keep track of children and parents. */
@@ -95,6 +126,31 @@
 #define ORCHESTRA_MAX_HASH                        0x7fff
 #endif /* ORCHESTRA_CONF_MAX_HASH */
 
+/* Number of entries of the per-child timeslot cache of the
+ * unicast_per_neighbor_rpl_storing rule (0 to disable). Must be a power
+ * of two. Children are cached by the last byte of their link-layer address;
+ * children that collide are still found through the routing table. */
+#ifdef ORCHESTRA_CONF_UNICAST_CHILD_CACHE_SIZE
+#define ORCHESTRA_UNICAST_CHILD_CACHE_SIZE        ORCHESTRA_CONF_UNICAST_CHILD_CACHE_SIZE
+#else /* ORCHESTRA_CONF_UNICAST_CHILD_CACHE_SIZE */
+#define ORCHESTRA_UNICAST_CHILD_CACHE_SIZE        0
+#endif /* ORCHESTRA_CONF_UNICAST_CHILD_CACHE_SIZE */
+
+/* Length of the slotframe of the multicast_common rule, and its number
+ * of shared cells. Routable IPv6 multicast is sent in these cells only,
+ * which requires TSCH_CONF_WITH_LINK_SELECTOR. */
+#ifdef ORCHESTRA_CONF_MULTICAST_PERIOD
+#define ORCHESTRA_MULTICAST_PERIOD                ORCHESTRA_CONF_MULTICAST_PERIOD
+#else /* ORCHESTRA_CONF_MULTICAST_PERIOD */
+#define ORCHESTRA_MULTICAST_PERIOD                19
+#endif /* ORCHESTRA_CONF_MULTICAST_PERIOD */
+
+#ifdef ORCHESTRA_CONF_MULTICAST_CELLS
+#define ORCHESTRA_MULTICAST_CELLS                 ORCHESTRA_CONF_MULTICAST_CELLS
+#else /* ORCHESTRA_CONF_MULTICAST_CELLS */
+#define ORCHESTRA_MULTICAST_CELLS                 1
+#endif /* ORCHESTRA_CONF_MULTICAST_CELLS */
+
 /* Is the "hash" function collision-free? (e.g. it maps to unique node-ids) */
 #ifdef ORCHESTRA_CONF_COLLISION_FREE_HASH
 #define ORCHESTRA_COLLISION_FREE_HASH             ORCHESTRA_CONF_COLLISION_FREE_HASH
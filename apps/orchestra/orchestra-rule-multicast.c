@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/**
+ * \file
+ *         Orchestra: a slotframe with shared links dedicated to routable
+ *         IPv6 multicast, as forwarded by the SMRF, ESMRF and ROLL-TM
+ *         engines. Multicast pushes then no longer compete with EBs and
+ *         RPL control traffic in the common shared cell.
+ */
+
+#include "contiki.h"
+#include "orchestra.h"
+#include "net/packetbuf.h"
+#include "net/ip/uip.h"
+#include "net/mac/frame802154.h"
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static uint16_t slotframe_handle = 0;
+static uint16_t channel_offset = 0;
+
+/*---------------------------------------------------------------------------*/
+clock_time_t
+orchestra_multicast_interval(void)
+{
+  clock_time_t interval;
+
+  interval = (clock_time_t)((uint32_t)ORCHESTRA_MULTICAST_PERIOD
+                            * TSCH_DEFAULT_TS_TIMESLOT_LENGTH
+                            * CLOCK_SECOND / ORCHESTRA_MULTICAST_CELLS
+                            / 1000000);
+  return interval > 0 ? interval : 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+select_packet(uint16_t *slotframe, uint16_t *timeslot)
+{
+  /* The packet is being sent from uip_buf, check its IPv6 destination */
+  if(uip_len > 0
+     && packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_DATAFRAME
+     && linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &linkaddr_null)
+     && uip_is_addr_mcast_routable(&UIP_IP_BUF->destipaddr)) {
+    if(slotframe != NULL) {
+      *slotframe = slotframe_handle;
+    }
+    if(timeslot != NULL) {
+      /* Any of our links */
+      *timeslot = 0xffff;
+    }
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(uint16_t sf_handle)
+{
+  struct tsch_slotframe *sf;
+  int i;
+
+  slotframe_handle = sf_handle;
+  channel_offset = slotframe_handle;
+  sf = tsch_schedule_add_slotframe(slotframe_handle, ORCHESTRA_MULTICAST_PERIOD);
+  /* Shared links, spread evenly over the slotframe */
+  for(i = 0; i < ORCHESTRA_MULTICAST_CELLS; i++) {
+    tsch_schedule_add_link(sf,
+        LINK_OPTION_RX | LINK_OPTION_TX | LINK_OPTION_SHARED,
+        LINK_TYPE_NORMAL, &tsch_broadcast_address,
+        i * ORCHESTRA_MULTICAST_PERIOD / ORCHESTRA_MULTICAST_CELLS,
+        channel_offset);
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct orchestra_rule multicast_common = {
+  init,
+  NULL,
+  select_packet,
+  NULL,
+  NULL,
+};
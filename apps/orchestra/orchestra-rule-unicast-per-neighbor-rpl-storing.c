@@ -64,6 +64,24 @@ static uint16_t slotframe_handle = 0;
 static uint16_t channel_offset = 0;
 static struct tsch_slotframe *sf_unicast;
 
+#if ORCHESTRA_UNICAST_CHILD_CACHE_SIZE
+/* Timeslots of the parent and of the children, computed once when they
+ * change rather than for every outgoing packet. A cache entry is free
+ * when its timeslot is 0xffff. */
+struct child_entry {
+  linkaddr_t addr;
+  uint16_t timeslot;
+};
+static struct child_entry child_cache[ORCHESTRA_UNICAST_CHILD_CACHE_SIZE];
+/* Number of children that did not get a cache entry */
+static uint8_t uncached_children;
+static uint16_t node_timeslot;
+static uint16_t parent_timeslot;
+
+#define CHILD_CACHE_ENTRY(addr) \
+  (&child_cache[(addr)->u8[LINKADDR_SIZE - 1] & (ORCHESTRA_UNICAST_CHILD_CACHE_SIZE - 1)])
+#endif /* ORCHESTRA_UNICAST_CHILD_CACHE_SIZE */
+
 /*---------------------------------------------------------------------------*/
 static uint16_t
 get_node_timeslot(const linkaddr_t *addr)
@@ -75,6 +93,7 @@ get_node_timeslot(const linkaddr_t *addr)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if !ORCHESTRA_UNICAST_CHILD_CACHE_SIZE
 static int
 neighbor_has_uc_link(const linkaddr_t *linkaddr)
 {
@@ -89,6 +108,7 @@ neighbor_has_uc_link(const linkaddr_t *linkaddr)
   }
   return 0;
 }
+#endif /* !ORCHESTRA_UNICAST_CHILD_CACHE_SIZE */
 /*---------------------------------------------------------------------------*/
 static void
 add_uc_link(const linkaddr_t *linkaddr)
@@ -152,15 +172,79 @@ remove_uc_link(const linkaddr_t *linkaddr)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if ORCHESTRA_UNICAST_CHILD_CACHE_SIZE
+static void
+child_cache_add(const linkaddr_t *linkaddr)
+{
+  struct child_entry *e = CHILD_CACHE_ENTRY(linkaddr);
+
+  if(e->timeslot == 0xffff) {
+    linkaddr_copy(&e->addr, linkaddr);
+    e->timeslot = get_node_timeslot(linkaddr);
+  } else {
+    uncached_children++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+child_cache_remove(const linkaddr_t *linkaddr)
+{
+  struct child_entry *e = CHILD_CACHE_ENTRY(linkaddr);
+
+  if(e->timeslot != 0xffff && linkaddr_cmp(&e->addr, linkaddr)) {
+    e->timeslot = 0xffff;
+  } else if(uncached_children > 0) {
+    uncached_children--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the timeslot used to send to dest, or 0xffff if we have no
+ * unicast link to it. Equivalent to neighbor_has_uc_link() followed by
+ * get_node_timeslot(), without a routing table lookup in the common case. */
+static uint16_t
+child_cache_lookup(const linkaddr_t *dest)
+{
+  struct child_entry *e;
+
+  if(dest == NULL || linkaddr_cmp(dest, &linkaddr_null)) {
+    return 0xffff;
+  }
+  if((orchestra_parent_knows_us || !ORCHESTRA_UNICAST_SENDER_BASED)
+     && linkaddr_cmp(&orchestra_parent_linkaddr, dest)) {
+    return ORCHESTRA_UNICAST_SENDER_BASED ? node_timeslot : parent_timeslot;
+  }
+  e = CHILD_CACHE_ENTRY(dest);
+  if(e->timeslot != 0xffff && linkaddr_cmp(&e->addr, dest)) {
+    return ORCHESTRA_UNICAST_SENDER_BASED ? node_timeslot : e->timeslot;
+  }
+  /* Only children that collided in the cache need the routing table */
+  if(uncached_children > 0
+     && nbr_table_get_from_lladdr(nbr_routes, (linkaddr_t *)dest) != NULL) {
+    return ORCHESTRA_UNICAST_SENDER_BASED ? node_timeslot : get_node_timeslot(dest);
+  }
+  return 0xffff;
+}
+#endif /* ORCHESTRA_UNICAST_CHILD_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
 static void
 child_added(const linkaddr_t *linkaddr)
 {
+#if ORCHESTRA_UNICAST_CHILD_CACHE_SIZE
+  if(linkaddr != NULL) {
+    child_cache_add(linkaddr);
+  }
+#endif /* ORCHESTRA_UNICAST_CHILD_CACHE_SIZE */
   add_uc_link(linkaddr);
 }
 /*---------------------------------------------------------------------------*/
 static void
 child_removed(const linkaddr_t *linkaddr)
 {
+#if ORCHESTRA_UNICAST_CHILD_CACHE_SIZE
+  if(linkaddr != NULL) {
+    child_cache_remove(linkaddr);
+  }
+#endif /* ORCHESTRA_UNICAST_CHILD_CACHE_SIZE */
   remove_uc_link(linkaddr);
 }
 /*---------------------------------------------------------------------------*/
@@ -169,6 +253,21 @@ select_packet(uint16_t *slotframe, uint16_t *timeslot)
 {
   /* Select data packets we have a unicast link to */
   const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+#if ORCHESTRA_UNICAST_CHILD_CACHE_SIZE
+  uint16_t ts;
+
+  if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_DATAFRAME
+     && (ts = child_cache_lookup(dest)) != 0xffff) {
+    if(slotframe != NULL) {
+      *slotframe = slotframe_handle;
+    }
+    if(timeslot != NULL) {
+      *timeslot = ts;
+    }
+    return 1;
+  }
+  return 0;
+#else /* ORCHESTRA_UNICAST_CHILD_CACHE_SIZE */
   if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_DATAFRAME
      && neighbor_has_uc_link(dest)) {
     if(slotframe != NULL) {
@@ -180,6 +279,7 @@ select_packet(uint16_t *slotframe, uint16_t *timeslot)
     return 1;
   }
   return 0;
+#endif /* ORCHESTRA_UNICAST_CHILD_CACHE_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -193,6 +293,9 @@ new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new
     } else {
       linkaddr_copy(&orchestra_parent_linkaddr, &linkaddr_null);
     }
+#if ORCHESTRA_UNICAST_CHILD_CACHE_SIZE
+    parent_timeslot = get_node_timeslot(new_addr);
+#endif /* ORCHESTRA_UNICAST_CHILD_CACHE_SIZE */
     remove_uc_link(old_addr);
     add_uc_link(new_addr);
   }
@@ -206,6 +309,15 @@ init(uint16_t sf_handle)
   /* Slotframe for unicast transmissions */
   sf_unicast = tsch_schedule_add_slotframe(slotframe_handle, ORCHESTRA_UNICAST_PERIOD);
   uint16_t timeslot = get_node_timeslot(&linkaddr_node_addr);
+#if ORCHESTRA_UNICAST_CHILD_CACHE_SIZE
+  uint8_t i;
+  for(i = 0; i < ORCHESTRA_UNICAST_CHILD_CACHE_SIZE; i++) {
+    child_cache[i].timeslot = 0xffff;
+  }
+  uncached_children = 0;
+  node_timeslot = timeslot;
+  parent_timeslot = 0xffff;
+#endif /* ORCHESTRA_UNICAST_CHILD_CACHE_SIZE */
   tsch_schedule_add_link(sf_unicast,
             ORCHESTRA_UNICAST_SENDER_BASED ? LINK_OPTION_TX | UNICAST_SLOT_SHARED_FLAG: LINK_OPTION_RX,
             LINK_TYPE_NORMAL, &tsch_broadcast_address,
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2016, Inria.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Orchestra: a slotframe dedicated to unicast transmissions to the RPL preferred
+ *         parent, with a number of cells growing with the number of descendants.
+ *         Designed for RPL storing mode, as the descendants are counted from the routing table.
+ *         Receiver-based, and as follows:
+ *           Nodes listen at timeslots hash(MAC, i) % ORCHESTRA_UNICAST_LOAD_PERIOD,
+ *                               for i < cells(number of descendants)
+ *           Nodes transmit at timeslots hash(parent.MAC, i) % ORCHESTRA_UNICAST_LOAD_PERIOD,
+ *                               for i < cells(number of descendants + 1)
+ *         As cells() is non-decreasing and a parent has at least all descendants of
+ *         its child plus the child itself, the child only uses cells its parent listens at.
+ *         Place this rule before a per-neighbor unicast rule, which carries the rest
+ *         of the unicast traffic.
+ *
+ */
+
+#include "contiki.h"
+#include "orchestra.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/packetbuf.h"
+
+static uint16_t slotframe_handle = 0;
+static uint16_t channel_offset = 0;
+static struct tsch_slotframe *sf_unicast;
+static struct ctimer update_timer;
+/* The parent we transmit to, and the current number of cells */
+static linkaddr_t parent_addr;
+static uint8_t num_rx_cells;
+static uint8_t num_tx_cells;
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_cell_timeslot(const linkaddr_t *addr, int i)
+{
+  uint32_t hash = ORCHESTRA_LINKADDR_HASH(addr);
+  /* The first cell is at the same place as with the other rules. The
+   * next ones follow at a node-specific stride: with a prime period
+   * all cells of a node are distinct, and two nodes with different
+   * hashes rarely share more than one cell. */
+  uint32_t stride = 1 + hash % (ORCHESTRA_UNICAST_LOAD_PERIOD - 1);
+  return (hash + i * stride) % ORCHESTRA_UNICAST_LOAD_PERIOD;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+get_num_cells(int descendants)
+{
+  return MIN(1 + descendants / ORCHESTRA_UNICAST_LOAD_DESCENDANTS_PER_CELL,
+             ORCHESTRA_UNICAST_LOAD_MAX_CELLS);
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_links(void)
+{
+  /* In storing mode, we have a route to each of our descendants */
+  int descendants = uip_ds6_route_num_routes();
+  uint8_t rx_cells = get_num_cells(descendants);
+  uint8_t tx_cells = linkaddr_cmp(&parent_addr, &linkaddr_null) ? 0 : get_num_cells(descendants + 1);
+  struct tsch_link *l;
+  uint16_t timeslot;
+  int i;
+
+  if(rx_cells == num_rx_cells && tx_cells == num_tx_cells) {
+    return;
+  }
+
+  /* Rebuild the slotframe */
+  while((l = list_head(sf_unicast->links_list)) != NULL) {
+    tsch_schedule_remove_link(sf_unicast, l);
+  }
+  for(i = 0; i < rx_cells; i++) {
+    tsch_schedule_add_link(sf_unicast, LINK_OPTION_RX, LINK_TYPE_NORMAL, &tsch_broadcast_address,
+          get_cell_timeslot(&linkaddr_node_addr, i), channel_offset);
+  }
+  for(i = 0; i < tx_cells; i++) {
+    /* Shared: siblings contend for the same cells */
+    uint8_t link_options = LINK_OPTION_TX | LINK_OPTION_SHARED;
+    timeslot = get_cell_timeslot(&parent_addr, i);
+    if((l = tsch_schedule_get_link_by_timeslot(sf_unicast, timeslot)) != NULL) {
+      /* This is also one of our own cells, keep listening */
+      link_options |= l->link_options;
+    }
+    tsch_schedule_add_link(sf_unicast, link_options, LINK_TYPE_NORMAL, &parent_addr,
+          timeslot, channel_offset);
+  }
+
+  num_rx_cells = rx_cells;
+  num_tx_cells = tx_cells;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_timer_callback(void *ptr)
+{
+  /* Descendants come and go without notification, poll the routing table */
+  update_links();
+  ctimer_reset(&update_timer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+child_added(const linkaddr_t *linkaddr)
+{
+  update_links();
+}
+/*---------------------------------------------------------------------------*/
+static void
+child_removed(const linkaddr_t *linkaddr)
+{
+  update_links();
+}
+/*---------------------------------------------------------------------------*/
+static int
+select_packet(uint16_t *slotframe, uint16_t *timeslot)
+{
+  /* Select data packets to our parent, any of our cells to it will do */
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_DATAFRAME
+     && num_tx_cells > 0 && linkaddr_cmp(dest, &parent_addr)) {
+    if(slotframe != NULL) {
+      *slotframe = slotframe_handle;
+    }
+    if(timeslot != NULL) {
+      *timeslot = 0xffff;
+    }
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new)
+{
+  if(new != old) {
+    if(new != NULL) {
+      linkaddr_copy(&parent_addr, &new->addr);
+    } else {
+      linkaddr_copy(&parent_addr, &linkaddr_null);
+    }
+    /* Force rebuilding the TX cells */
+    num_tx_cells = 0xff;
+    update_links();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(uint16_t sf_handle)
+{
+  slotframe_handle = sf_handle;
+  channel_offset = sf_handle;
+  linkaddr_copy(&parent_addr, &linkaddr_null);
+  /* Slotframe for unicast transmissions to the parent */
+  sf_unicast = tsch_schedule_add_slotframe(slotframe_handle, ORCHESTRA_UNICAST_LOAD_PERIOD);
+  update_links();
+  ctimer_set(&update_timer, ORCHESTRA_UNICAST_LOAD_UPDATE_INTERVAL, update_timer_callback, NULL);
+}
+/*---------------------------------------------------------------------------*/
+struct orchestra_rule unicast_per_parent_load = {
+  init,
+  new_time_source,
+  select_packet,
+  child_added,
+  child_removed,
+};
@@ -55,7 +55,9 @@ struct orchestra_rule {
 struct orchestra_rule eb_per_time_source;
 struct orchestra_rule unicast_per_neighbor_rpl_storing;
 struct orchestra_rule unicast_per_neighbor_rpl_ns;
+struct orchestra_rule unicast_per_parent_load;
 struct orchestra_rule default_common;
+struct orchestra_rule multicast_common;
 
 extern linkaddr_t orchestra_parent_linkaddr;
 extern int orchestra_parent_knows_us;
@@ -71,5 +73,9 @@ void orchestra_callback_new_time_source(const struct tsch_neighbor *old, const s
 void orchestra_callback_child_added(const linkaddr_t *addr);
 /* Set with #define NETSTACK_CONF_ROUTING_NEIGHBOR_REMOVED_CALLBACK orchestra_callback_child_removed */
 void orchestra_callback_child_removed(const linkaddr_t *addr);
+/* The time between two multicast cells of the multicast_common rule.
+ * Set with #define SMRF_CONF_FWD_DELAY orchestra_multicast_interval
+ * (or ESMRF_CONF_FWD_DELAY) so that forwarders spread over the cells */
+clock_time_t orchestra_multicast_interval(void);
 
 #endif /* __ORCHESTRA_H__ */
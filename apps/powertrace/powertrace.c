@@ -42,6 +42,7 @@
 #include "sys/compower.h"
 #include "powertrace.h"
 #include "net/rime/rime.h"
+#include "lib/crc16.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -191,6 +192,83 @@ powertrace_print(char *str)
   seqno++;
 }
 /*---------------------------------------------------------------------------*/
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+#if ENERGEST_CONF_CLASSES
+#define BINARY_COUNTERS (6 + 2 * ENERGEST_CLASS_MAX)
+#else /* ENERGEST_CONF_CLASSES */
+#define BINARY_COUNTERS 6
+#endif /* ENERGEST_CONF_CLASSES */
+
+#define BINARY_HEADER_LEN 13
+#define BINARY_RECORD_LEN (BINARY_HEADER_LEN + 4 * BINARY_COUNTERS + 2)
+
+static void
+put_u32(uint8_t *p, uint32_t v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+void
+powertrace_print_binary(void)
+{
+  static uint32_t seqno;
+  uint8_t record[BINARY_RECORD_LEN];
+  uint8_t *p;
+  unsigned short crc;
+  int i;
+
+  energest_flush();
+
+  record[0] = 'P';
+  record[1] = POWERTRACE_BINARY_VERSION;
+  record[2] = linkaddr_node_addr.u8[0];
+  record[3] = linkaddr_node_addr.u8[1];
+  put_u32(&record[4], seqno++);
+  put_u32(&record[8], clock_time());
+  record[12] = BINARY_COUNTERS;
+
+  p = &record[BINARY_HEADER_LEN];
+  put_u32(p, energest_type_time(ENERGEST_TYPE_CPU));
+  put_u32(p + 4, energest_type_time(ENERGEST_TYPE_LPM));
+  put_u32(p + 8, energest_type_time(ENERGEST_TYPE_TRANSMIT));
+  put_u32(p + 12, energest_type_time(ENERGEST_TYPE_LISTEN));
+  put_u32(p + 16, compower_idle_activity.transmit);
+  put_u32(p + 20, compower_idle_activity.listen);
+  p += 24;
+#if ENERGEST_CONF_CLASSES
+  for(i = 0; i < ENERGEST_CLASS_MAX; i++) {
+    put_u32(p, energest_class_time(i, ENERGEST_TYPE_TRANSMIT));
+    put_u32(p + 4, energest_class_time(i, ENERGEST_TYPE_LISTEN));
+    p += 8;
+  }
+#endif /* ENERGEST_CONF_CLASSES */
+
+  crc = crc16_data(record, p - record, 0);
+  p[0] = crc & 0xff;
+  p[1] = crc >> 8;
+
+  putchar(SLIP_END);
+  for(i = 0; i < BINARY_RECORD_LEN; i++) {
+    if(record[i] == SLIP_END) {
+      putchar(SLIP_ESC);
+      putchar(SLIP_ESC_END);
+    } else if(record[i] == SLIP_ESC) {
+      putchar(SLIP_ESC);
+      putchar(SLIP_ESC_ESC);
+    } else {
+      putchar(record[i]);
+    }
+  }
+  putchar(SLIP_END);
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(powertrace_process, ev, data)
 {
   static struct etimer periodic;
@@ -207,7 +285,11 @@ PROCESS_THREAD(powertrace_process, ev, data)
   while(1) {
     PROCESS_WAIT_UNTIL(etimer_expired(&periodic));
     etimer_reset(&periodic);
+#if POWERTRACE_BINARY
+    powertrace_print_binary();
+#else /* POWERTRACE_BINARY */
     powertrace_print("");
+#endif /* POWERTRACE_BINARY */
   }
 
   PROCESS_END();
@@ -54,4 +54,30 @@ void powertrace_sniff(powertrace_onoff_t onoff);
 
 void powertrace_print(char *str);
 
+/*
+ * With POWERTRACE_CONF_BINARY, the periodic output is a compact
+ * binary record instead of a line of text, see
+ * powertrace_print_binary(). tools/powertrace/parse-binary-power
+ * turns a log of such records into text.
+ */
+#ifdef POWERTRACE_CONF_BINARY
+#define POWERTRACE_BINARY POWERTRACE_CONF_BINARY
+#else /* POWERTRACE_CONF_BINARY */
+#define POWERTRACE_BINARY 0
+#endif /* POWERTRACE_CONF_BINARY */
+
+#define POWERTRACE_BINARY_VERSION 1
+
+/**
+ * Write the accumulated energest times as one SLIP-framed binary
+ * record: 'P', version, node address (2 bytes), seqno and
+ * clock_time() (4 bytes each), the number of counters N, then N
+ * 4-byte counters, then a CRC16 of everything before it. All values
+ * are little endian. The counters are CPU, LPM, transmit, listen,
+ * idle transmit and idle listen time, in rtimer ticks, followed by
+ * the transmit and listen time of each energest class when
+ * ENERGEST_CONF_CLASSES is enabled.
+ */
+void powertrace_print_binary(void);
+
 #endif /* POWERTRACE_H */
@@ -59,6 +59,109 @@ PROCESS(rest_engine_process, "REST Engine");
 LIST(restful_services);
 LIST(restful_periodic_services);
 /*---------------------------------------------------------------------------*/
+#if REST_ENGINE_INDEX_SIZE
+/* Open-addressing hash index over the URLs of the activated resources.
+ * Each slot also keeps the URL length and the activation order, as the
+ * first activated resource matching a request wins, like in the list. */
+static resource_t *index_resources[REST_ENGINE_INDEX_SIZE];
+static uint16_t index_url_len[REST_ENGINE_INDEX_SIZE];
+static uint16_t index_order[REST_ENGINE_INDEX_SIZE];
+static uint16_t num_indexed;
+/* Set when a resource did not fit, requests then use the list */
+static uint8_t index_overflow;
+/*---------------------------------------------------------------------------*/
+/* FNV-1a, fed one character at a time so that prefixes hash as they go */
+#define INDEX_HASH_INIT 2166136261UL
+#define INDEX_HASH_STEP(h, c) (((h) ^ (uint8_t)(c)) * 16777619UL)
+/*---------------------------------------------------------------------------*/
+static uint32_t
+index_hash(const char *url, int len)
+{
+  uint32_t h;
+  int i;
+
+  h = INDEX_HASH_INIT;
+  for(i = 0; i < len; i++) {
+    h = INDEX_HASH_STEP(h, url[i]);
+  }
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(resource_t *resource)
+{
+  unsigned slot;
+  int len;
+
+  len = strlen(resource->url);
+  /* Keep at least one slot free so that lookups terminate */
+  if(index_overflow || num_indexed >= REST_ENGINE_INDEX_SIZE - 1) {
+    index_overflow = 1;
+    return;
+  }
+
+  for(slot = index_hash(resource->url, len) & (REST_ENGINE_INDEX_SIZE - 1);
+      index_resources[slot] != NULL;
+      slot = (slot + 1) & (REST_ENGINE_INDEX_SIZE - 1));
+
+  index_resources[slot] = resource;
+  index_url_len[slot] = len;
+  index_order[slot] = num_indexed++;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the slot of the earliest activated resource with the given URL
+ * and, if parent_only, sub-resources, or -1 */
+static int
+index_lookup(const char *url, int len, uint32_t h, int parent_only)
+{
+  unsigned slot;
+  int best;
+  resource_t *r;
+
+  best = -1;
+  for(slot = h & (REST_ENGINE_INDEX_SIZE - 1);
+      (r = index_resources[slot]) != NULL;
+      slot = (slot + 1) & (REST_ENGINE_INDEX_SIZE - 1)) {
+    if(index_url_len[slot] == len && strncmp(r->url, url, len) == 0
+       && (!parent_only || (r->flags & HAS_SUB_RESOURCES))
+       && (best < 0 || index_order[slot] < index_order[best])) {
+      best = slot;
+    }
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+/* Finds the resource that a scan of the list would, that is the earliest
+ * activated one whose URL either equals the request URL or is a parent
+ * resource whose URL is followed by '/' in the request URL */
+static resource_t *
+index_find(const char *url, int url_len)
+{
+  uint32_t h;
+  int best;
+  int slot;
+  int i;
+
+  best = -1;
+  h = INDEX_HASH_INIT;
+  for(i = 0; i < url_len; i++) {
+    if(url[i] == '/') {
+      slot = index_lookup(url, i, h, 1);
+      if(slot >= 0 && (best < 0 || index_order[slot] < index_order[best])) {
+        best = slot;
+      }
+    }
+    h = INDEX_HASH_STEP(h, url[i]);
+  }
+  slot = index_lookup(url, url_len, h, 0);
+  if(slot >= 0 && (best < 0 || index_order[slot] < index_order[best])) {
+    best = slot;
+  }
+
+  return best >= 0 ? index_resources[best] : NULL;
+}
+#endif /* REST_ENGINE_INDEX_SIZE */
+/*---------------------------------------------------------------------------*/
 /*- REST Engine API ---------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 /**
@@ -104,6 +207,9 @@ rest_activate_resource(resource_t *resource, char *path)
 {
   resource->url = path;
   list_add(restful_services, resource);
+#if REST_ENGINE_INDEX_SIZE
+  index_add(resource);
+#endif /* REST_ENGINE_INDEX_SIZE */
 
   PRINTF("Activating: %s\n", resource->url);
 
@@ -132,18 +238,19 @@ rest_get_resources(void)
   return restful_services;
 }
 /*---------------------------------------------------------------------------*/
-int
-rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
-                            uint16_t buffer_size, int32_t *offset)
+/* Finds the first activated resource whose URL matches the request URL */
+static resource_t *
+find_resource(const char *url, int url_len)
 {
-  uint8_t found = 0;
-  uint8_t allowed = 1;
+  resource_t *resource;
+  int res_url_len;
 
-  resource_t *resource = NULL;
-  const char *url = NULL;
-  int url_len, res_url_len;
+#if REST_ENGINE_INDEX_SIZE
+  if(!index_overflow) {
+    return index_find(url, url_len);
+  }
+#endif /* REST_ENGINE_INDEX_SIZE */
 
-  url_len = REST.get_url(request, &url);
   for(resource = (resource_t *)list_head(restful_services);
       resource; resource = resource->next) {
 
@@ -154,31 +261,49 @@ rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
             && (resource->flags & HAS_SUB_RESOURCES)
             && url[res_url_len] == '/'))
        && strncmp(resource->url, url, res_url_len) == 0) {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
-
-      PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
-             (uint16_t)method, resource->flags);
-
-      if((method & METHOD_GET) && resource->get_handler != NULL) {
-        /* call handler function */
-        resource->get_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_POST) && resource->post_handler != NULL) {
-        /* call handler function */
-        resource->post_handler(request, response, buffer, buffer_size,
+      return resource;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+rest_invoke_restful_service(void *request, void *response, uint8_t *buffer,
+                            uint16_t buffer_size, int32_t *offset)
+{
+  uint8_t found = 0;
+  uint8_t allowed = 1;
+
+  resource_t *resource = NULL;
+  const char *url = NULL;
+  int url_len;
+
+  url_len = REST.get_url(request, &url);
+  resource = find_resource(url, url_len);
+  if(resource != NULL) {
+    found = 1;
+    rest_resource_flags_t method = REST.get_method_type(request);
+
+    PRINTF("/%s, method %u, resource->flags %u\n", resource->url,
+           (uint16_t)method, resource->flags);
+
+    if((method & METHOD_GET) && resource->get_handler != NULL) {
+      /* call handler function */
+      resource->get_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_POST) && resource->post_handler != NULL) {
+      /* call handler function */
+      resource->post_handler(request, response, buffer, buffer_size,
+                             offset);
+    } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
+      /* call handler function */
+      resource->put_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
+      /* call handler function */
+      resource->delete_handler(request, response, buffer, buffer_size,
                                offset);
-      } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
-        /* call handler function */
-        resource->put_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
-        /* call handler function */
-        resource->delete_handler(request, response, buffer, buffer_size,
-                                 offset);
-      } else {
-        allowed = 0;
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
-      }
-      break;
+    } else {
+      allowed = 0;
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
     }
   }
   if(!found) {
@@ -62,6 +62,22 @@
 #define REST_MAX_CHUNK_SIZE     64
 #endif
 
+/*
+ * Number of slots of the hash index over activated resource URLs, a power
+ * of two larger than the number of resources. Requests are then dispatched
+ * in time proportional to the URL length instead of the number of
+ * resources. 0 disables the index.
+ */
+#ifdef REST_ENGINE_CONF_INDEX_SIZE
+#define REST_ENGINE_INDEX_SIZE REST_ENGINE_CONF_INDEX_SIZE
+#else
+#define REST_ENGINE_INDEX_SIZE  0
+#endif
+
+#if REST_ENGINE_INDEX_SIZE & (REST_ENGINE_INDEX_SIZE - 1)
+#error "REST_ENGINE_CONF_INDEX_SIZE must be a power of two"
+#endif
+
 struct resource_s;
 struct periodic_resource_s;
 
@@ -43,21 +43,190 @@
 
 #include "contiki.h"
 #include "shell.h"
+#include "serial-shell.h"
 
 #include "dev/serial-line.h"
 #include "net/rime/rime.h"
+#include "lib/crc16.h"
 
 #include <stdio.h>
 #include <string.h>
 
+/* With SERIAL_SHELL_CONF_BUFSIZE, shell output is collected in a buffer
+   of that size and written by the serial shell process in pieces of
+   SERIAL_SHELL_CONF_CHUNK bytes, so that a command that prints a lot
+   does not hold up other processes until the UART has sent it all.
+   The buffer is written at once only when it is full. */
+#ifdef SERIAL_SHELL_CONF_BUFSIZE
+#define SERIAL_SHELL_BUFSIZE SERIAL_SHELL_CONF_BUFSIZE
+#else
+#define SERIAL_SHELL_BUFSIZE 0
+#endif
+
+#ifdef SERIAL_SHELL_CONF_CHUNK
+#define SERIAL_SHELL_CHUNK SERIAL_SHELL_CONF_CHUNK
+#else
+#define SERIAL_SHELL_CHUNK 64
+#endif
+
+/* Writes a piece of the buffer to the serial port. Platforms with a
+   block or DMA write can set it to that. */
+#ifdef SERIAL_SHELL_CONF_WRITE
+#define SERIAL_SHELL_WRITE(buf, len) SERIAL_SHELL_CONF_WRITE(buf, len)
+#else
+#define SERIAL_SHELL_WRITE(buf, len) write_bytes(buf, len)
+#endif
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+#define BINARY_MAGIC 'S'
+#define BINARY_VERSION 1
 
 /*---------------------------------------------------------------------------*/
 PROCESS(serial_shell_process, "Contiki serial shell");
+#if SERIAL_SHELL_BUFSIZE > 0
+PROCESS(shell_binmode_process, "binmode");
+SHELL_COMMAND(binmode_command,
+	      "binmode",
+	      "binmode [on|off]: frame shell output for tools",
+	      &shell_binmode_process);
+
+static unsigned char buf[SERIAL_SHELL_BUFSIZE];
+/* Bytes in the buffer, and bytes of them that have been written */
+static unsigned short buf_len, buf_sent;
+static uint8_t binary;
+/* State of the frame being written in binary mode */
+static uint8_t frame_seqno;
+static uint8_t in_frame;
+static unsigned short frame_crc;
+#endif /* SERIAL_SHELL_BUFSIZE > 0 */
+/*---------------------------------------------------------------------------*/
+#if SERIAL_SHELL_BUFSIZE > 0 && !defined(SERIAL_SHELL_CONF_WRITE)
+static void
+write_bytes(const unsigned char *data, int len)
+{
+  int i;
+
+  for(i = 0; i < len; i++) {
+    putchar(data[i]);
+  }
+}
+#endif /* SERIAL_SHELL_BUFSIZE > 0 && !defined(SERIAL_SHELL_CONF_WRITE) */
+/*---------------------------------------------------------------------------*/
+#if SERIAL_SHELL_BUFSIZE > 0
+/* Adds a byte to a piece of a binary frame, escaped and to the CRC */
+static int
+slip_put(unsigned char *out, int len, unsigned char c, int crc)
+{
+  if(crc) {
+    frame_crc = crc16_add(c, frame_crc);
+  }
+  if(c == SLIP_END) {
+    out[len++] = SLIP_ESC;
+    out[len++] = SLIP_ESC_END;
+  } else if(c == SLIP_ESC) {
+    out[len++] = SLIP_ESC;
+    out[len++] = SLIP_ESC_ESC;
+  } else {
+    out[len++] = c;
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* Writes at most max bytes of the buffer. In binary mode, the bytes
+   written since the buffer was last empty form one frame:
+   END 'S' version seqno text... crc-low crc-high END, with the lines
+   of the text ended by a newline, and the CRC over the bytes before it. */
+static void
+flush(unsigned short max)
+{
+  /* Escaped bytes take two, and the first piece has the header */
+  unsigned char out[2 * SERIAL_SHELL_CHUNK + 7];
+  unsigned short n;
+  unsigned short i;
+  unsigned short crc;
+  int len;
+
+  while(max > 0 && buf_sent < buf_len) {
+    n = buf_len - buf_sent;
+    if(n > max) {
+      n = max;
+    }
+    if(n > SERIAL_SHELL_CHUNK) {
+      n = SERIAL_SHELL_CHUNK;
+    }
+    if(!binary) {
+      SERIAL_SHELL_WRITE(&buf[buf_sent], n);
+    } else {
+      len = 0;
+      if(!in_frame) {
+        in_frame = 1;
+        frame_crc = 0;
+        out[len++] = SLIP_END;
+        len = slip_put(out, len, BINARY_MAGIC, 1);
+        len = slip_put(out, len, BINARY_VERSION, 1);
+        len = slip_put(out, len, frame_seqno++, 1);
+      }
+      for(i = 0; i < n; i++) {
+        len = slip_put(out, len, buf[buf_sent + i], 1);
+      }
+      SERIAL_SHELL_WRITE(out, len);
+    }
+    buf_sent += n;
+    max -= n;
+  }
+
+  if(buf_sent == buf_len) {
+    buf_len = buf_sent = 0;
+    if(in_frame) {
+      crc = frame_crc;
+      len = slip_put(out, 0, crc & 0xff, 0);
+      len = slip_put(out, len, crc >> 8, 0);
+      out[len++] = SLIP_END;
+      SERIAL_SHELL_WRITE(out, len);
+      in_frame = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+append(const char *text, int len)
+{
+  int n;
+
+  while(len > 0) {
+    if(buf_len == sizeof(buf)) {
+      flush(0xffff);
+    }
+    n = sizeof(buf) - buf_len;
+    if(n > len) {
+      n = len;
+    }
+    memcpy(&buf[buf_len], text, n);
+    buf_len += n;
+    text += n;
+    len -= n;
+  }
+  process_poll(&serial_shell_process);
+}
+/*---------------------------------------------------------------------------*/
+void
+serial_shell_set_binary(int on)
+{
+  flush(0xffff);
+  binary = on != 0;
+}
+#endif /* SERIAL_SHELL_BUFSIZE > 0 */
 /*---------------------------------------------------------------------------*/
 void
 shell_default_output(const char *text1, int len1, const char *text2, int len2)
 {
+#if SERIAL_SHELL_BUFSIZE == 0
   int i;
+#endif
   if(text1 == NULL) {
     text1 = "";
     len1 = 0;
@@ -67,6 +236,15 @@ shell_default_output(const char *text1, int len1, const char *text2, int len2)
     len2 = 0;
   }
 
+#if SERIAL_SHELL_BUFSIZE > 0
+  append(text1, len1);
+  append(text2, len2);
+  if(binary) {
+    append("\n", 1);
+  } else {
+    append("\r\n", 2);
+  }
+#else /* SERIAL_SHELL_BUFSIZE > 0 */
   /* Precision (printf("%.Ns", text1)) not supported on all platforms.
      putchar(c) not be supported on all platforms. */
   for(i = 0; i < len1; i++) {
@@ -76,13 +254,23 @@ shell_default_output(const char *text1, int len1, const char *text2, int len2)
     printf("%c", text2[i]);
   }
   printf("\r\n");
+#endif /* SERIAL_SHELL_BUFSIZE > 0 */
 }
 /*---------------------------------------------------------------------------*/
 void
 shell_prompt(char *str)
 {
+#if SERIAL_SHELL_BUFSIZE > 0
+  char addr[12];
+
+  /* Keep the prompt in order with the buffered output */
+  snprintf(addr, sizeof(addr), "%d.%d: ",
+           linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1]);
+  shell_default_output(addr, strlen(addr), str, strlen(str));
+#else /* SERIAL_SHELL_BUFSIZE > 0 */
   printf("%d.%d: %s\r\n", linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
 	 str);
+#endif /* SERIAL_SHELL_BUFSIZE > 0 */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -90,11 +278,48 @@ shell_exit(void)
 {
 }
 /*---------------------------------------------------------------------------*/
+#if SERIAL_SHELL_BUFSIZE > 0
+PROCESS_THREAD(shell_binmode_process, ev, data)
+{
+  const char *args = data;
+
+  PROCESS_BEGIN();
+
+  if(args == NULL || *args == '\0') {
+    shell_output_str(&binmode_command, binary ? "on" : "off", "");
+  } else if(strcmp(args, "on") == 0) {
+    serial_shell_set_binary(1);
+  } else if(strcmp(args, "off") == 0) {
+    serial_shell_set_binary(0);
+  } else {
+    shell_output_str(&binmode_command, "usage: ", binmode_command.description);
+  }
+
+  PROCESS_END();
+}
+#endif /* SERIAL_SHELL_BUFSIZE > 0 */
+/*---------------------------------------------------------------------------*/
+static void
+pollhandler(void)
+{
+#if SERIAL_SHELL_BUFSIZE > 0
+  flush(SERIAL_SHELL_CHUNK);
+  if(buf_len > 0) {
+    process_poll(&serial_shell_process);
+  }
+#endif /* SERIAL_SHELL_BUFSIZE > 0 */
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(serial_shell_process, ev, data)
 {
+  PROCESS_POLLHANDLER(pollhandler());
+
   PROCESS_BEGIN();
 
   shell_init();
+#if SERIAL_SHELL_BUFSIZE > 0
+  shell_register_command(&binmode_command);
+#endif /* SERIAL_SHELL_BUFSIZE > 0 */
 
   while(1) {
     PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message && data != NULL);
@@ -44,4 +44,12 @@
 
 void serial_shell_init(void);
 
+/**
+ * Switch the shell output between text and binary frames. Only
+ * available with SERIAL_SHELL_CONF_BUFSIZE. Binary frames are SLIP
+ * framed, with a CRC, and can be decoded with
+ * tools/serial-shell/parse-binary-shell.
+ */
+void serial_shell_set_binary(int on);
+
 #endif /* SERIAL_SHELL_H_ */
@@ -40,10 +40,22 @@
 
 #include "contiki.h"
 #include "shell-memdebug.h"
+#include "lib/memb.h"
+#include "lib/mmem.h"
+#include "sys/stack-check.h"
 
 #include <stdio.h>
 #include <string.h>
 
+/* Show the managed memory in "memstats". Off by default, as it links
+   in the managed memory, and its RAM, in firmware that does not use
+   it otherwise. */
+#ifdef SHELL_CONF_MEMSTATS_MMEM
+#define SHELL_MEMSTATS_MMEM SHELL_CONF_MEMSTATS_MMEM
+#else
+#define SHELL_MEMSTATS_MMEM 0
+#endif
+
 /*---------------------------------------------------------------------------*/
 PROCESS(shell_poke_process, "poke");
 SHELL_COMMAND(poke_command,
@@ -55,6 +67,11 @@ SHELL_COMMAND(peek_command,
 	      "peek",
 	      "peek <address>: read a byte from address <address>",
 	      &shell_peek_process);
+PROCESS(shell_memstats_process, "memstats");
+SHELL_COMMAND(memstats_command,
+	      "memstats",
+	      "memstats [reset]: show memory and stack high-water marks",
+	      &shell_memstats_process);
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_poke_process, ev, data)
 {
@@ -119,10 +136,62 @@ PROCESS_THREAD(shell_peek_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_memstats_process, ev, data)
+{
+  char buf[64];
+#if MEMB_STATS || SHELL_MEMSTATS_MMEM
+  int reset;
+#endif
+#if MEMB_STATS
+  struct memb *m;
+#endif
+#if SHELL_MEMSTATS_MMEM
+  struct mmem_stats mstats;
+#endif
+  struct stack_check *s;
+
+  PROCESS_BEGIN();
+
+#if MEMB_STATS || SHELL_MEMSTATS_MMEM
+  reset = data != NULL && strcmp(data, "reset") == 0;
+#endif
+
+#if MEMB_STATS
+  for(m = memb_stats_head(); m != NULL; m = memb_stats_next(m)) {
+    snprintf(buf, sizeof(buf), "memb %s %u/%u peak %u failed %u",
+             m->name, m->used, m->num, m->peak, m->failed);
+    shell_output_str(&memstats_command, buf, "");
+    if(reset) {
+      memb_reset_peak(m);
+    }
+  }
+#endif /* MEMB_STATS */
+
+#if SHELL_MEMSTATS_MMEM
+  mmem_get_stats(&mstats);
+  snprintf(buf, sizeof(buf), "mmem %u/%u peak %u failed %u",
+           mstats.size - mstats.avail, mstats.size,
+           mstats.peak, mstats.failed);
+  shell_output_str(&memstats_command, buf, "");
+  if(reset) {
+    mmem_reset_peak();
+  }
+#endif /* SHELL_MEMSTATS_MMEM */
+
+  for(s = stack_check_head(); s != NULL; s = stack_check_next(s)) {
+    snprintf(buf, sizeof(buf), "stack %s %u/%u",
+             s->name, stack_check_usage(s->bottom, s->size), s->size);
+    shell_output_str(&memstats_command, buf, "");
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
 void
 shell_memdebug_init(void)
 {
   shell_register_command(&poke_command);
   shell_register_command(&peek_command);
+  shell_register_command(&memstats_command);
 }
 /*---------------------------------------------------------------------------*/
@@ -45,22 +45,57 @@
 
 /*---------------------------------------------------------------------------*/
 PROCESS(shell_ps_process, "ps");
+#if PROCESS_CONF_PROFILE
+SHELL_COMMAND(ps_command,
+	      "ps",
+	      "ps [-r]: list all running processes and their CPU time, -r resets it",
+	      &shell_ps_process);
+#else /* PROCESS_CONF_PROFILE */
 SHELL_COMMAND(ps_command,
 	      "ps",
 	      "ps: list all running processes",
 	      &shell_ps_process);
+#endif /* PROCESS_CONF_PROFILE */
+/*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PROFILE
+static unsigned long
+ticks_to_us(uint32_t ticks)
+{
+  return (unsigned long)(((uint64_t)ticks * 1000000) / RTIMER_SECOND);
+}
+#endif /* PROCESS_CONF_PROFILE */
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_ps_process, ev, data)
 {
   struct process *p;
+#if PROCESS_CONF_PROFILE
+  char buf[40];
+#endif /* PROCESS_CONF_PROFILE */
   PROCESS_BEGIN();
 
+#if PROCESS_CONF_PROFILE
+  shell_output_str(&ps_command, "Processes: calls, total ms, max us", "");
+#else /* PROCESS_CONF_PROFILE */
   shell_output_str(&ps_command, "Processes:", "");
+#endif /* PROCESS_CONF_PROFILE */
   for(p = PROCESS_LIST(); p != NULL; p = p->next) {
     char namebuf[30];
     strncpy(namebuf, PROCESS_NAME_STRING(p), sizeof(namebuf));
+#if PROCESS_CONF_PROFILE
+    snprintf(buf, sizeof(buf), " %lu %lu %lu",
+             (unsigned long)p->calls, ticks_to_us(p->runtime) / 1000,
+             ticks_to_us(p->maxrun));
+    shell_output_str(&ps_command, namebuf, buf);
+#else /* PROCESS_CONF_PROFILE */
     shell_output_str(&ps_command, namebuf, "");
+#endif /* PROCESS_CONF_PROFILE */
+  }
+
+#if PROCESS_CONF_PROFILE
+  if(data != NULL && strncmp(data, "-r", 2) == 0) {
+    process_profile_reset();
   }
+#endif /* PROCESS_CONF_PROFILE */
 
   PROCESS_END();
 }
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Shell command for the TSCH slot operation profile
+ */
+
+#include "contiki.h"
+#include "shell-tsch.h"
+#include "net/mac/tsch/tsch-conf.h"
+
+#if TSCH_SLOT_PROFILE
+
+#include "net/mac/tsch/tsch-slot-operation.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_tsch_profile_process, "tsch-profile");
+SHELL_COMMAND(tsch_profile_command,
+	      "tsch-profile",
+	      "tsch-profile [reset]: print (or clear) the TSCH slot timing profile",
+	      &shell_tsch_profile_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_tsch_profile_process, ev, data)
+{
+  static struct tsch_slot_profile profile;
+  const struct tsch_slot_profile_hist *h;
+  const char *args;
+  char buf[100];
+  int len;
+  int last_bin;
+  int phase;
+  int i;
+
+  PROCESS_BEGIN();
+
+  args = data;
+  if(args != NULL && strncmp(args, "reset", 5) == 0) {
+    tsch_slot_profile_reset();
+    PROCESS_EXIT();
+  }
+
+  /* Take a snapshot, the profile is updated from interrupt */
+  memcpy(&profile, &tsch_slot_profile, sizeof(profile));
+
+  snprintf(buf, sizeof(buf), "dl-miss %lu rtimer-fail %lu",
+	   (unsigned long)profile.deadline_misses,
+	   (unsigned long)profile.rtimer_failures);
+  shell_output_str(&tsch_profile_command, buf, "");
+
+  for(phase = 0; phase < TSCH_SLOT_PROFILE_PHASES; phase++) {
+    h = &profile.phase[phase];
+    if(h->count == 0) {
+      continue;
+    }
+    snprintf(buf, sizeof(buf), "%s n %lu avg %lu max %lu us",
+	     tsch_slot_profile_phase_name(phase),
+	     (unsigned long)h->count,
+	     (unsigned long)RTIMERTICKS_TO_US(h->total / h->count),
+	     (unsigned long)RTIMERTICKS_TO_US(h->max));
+    shell_output_str(&tsch_profile_command, buf, "");
+
+    /* One line per histogram, without the empty bins at the end */
+    for(last_bin = TSCH_SLOT_PROFILE_BINS - 1;
+	last_bin > 0 && h->bins[last_bin] == 0; last_bin--);
+    len = snprintf(buf, sizeof(buf), " hist");
+    for(i = 0; i <= last_bin && len < (int)sizeof(buf); i++) {
+      len += snprintf(buf + len, sizeof(buf) - len, " %u", h->bins[i]);
+    }
+    shell_output_str(&tsch_profile_command, buf, "");
+  }
+
+  PROCESS_END();
+}
+#endif /* TSCH_SLOT_PROFILE */
+/*---------------------------------------------------------------------------*/
+void
+shell_tsch_init(void)
+{
+#if TSCH_SLOT_PROFILE
+  shell_register_command(&tsch_profile_command);
+#endif /* TSCH_SLOT_PROFILE */
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         6top protocol (6P) configuration
+ *
+ */
+
+#ifndef __SIXTOP_CONF_H__
+#define __SIXTOP_CONF_H__
+
+/* The scheduling function driving 6P */
+#ifdef SIXTOP_CONF_SF
+#define SIXTOP_SF                                 SIXTOP_CONF_SF
+#else /* SIXTOP_CONF_SF */
+#define SIXTOP_SF                                 sixtop_sf_load
+#endif /* SIXTOP_CONF_SF */
+
+/* Handle of the slotframe holding all cells allocated by 6P. Must
+ * not be used by the rest of the schedule (e.g. Orchestra uses
+ * handles 0 to number of rules - 1) */
+#ifdef SIXTOP_CONF_SLOTFRAME_HANDLE
+#define SIXTOP_SLOTFRAME_HANDLE                   SIXTOP_CONF_SLOTFRAME_HANDLE
+#else /* SIXTOP_CONF_SLOTFRAME_HANDLE */
+#define SIXTOP_SLOTFRAME_HANDLE                   2
+#endif /* SIXTOP_CONF_SLOTFRAME_HANDLE */
+
+/* Length of the 6P slotframe. Each allocated cell provides one
+ * transmission opportunity per slotframe. */
+#ifdef SIXTOP_CONF_SLOTFRAME_LENGTH
+#define SIXTOP_SLOTFRAME_LENGTH                   SIXTOP_CONF_SLOTFRAME_LENGTH
+#else /* SIXTOP_CONF_SLOTFRAME_LENGTH */
+#define SIXTOP_SLOTFRAME_LENGTH                   101
+#endif /* SIXTOP_CONF_SLOTFRAME_LENGTH */
+
+/* Max number of cells in a single request, also the number of
+ * candidate cells offered to the responder */
+#ifdef SIXTOP_CONF_MAX_CELLS
+#define SIXTOP_MAX_CELLS                          SIXTOP_CONF_MAX_CELLS
+#else /* SIXTOP_CONF_MAX_CELLS */
+#define SIXTOP_MAX_CELLS                          4
+#endif /* SIXTOP_CONF_MAX_CELLS */
+
+/* Time after which a transaction without response is aborted.
+ * The cells with the peer are then cleared, as both ends may disagree
+ * on the schedule. */
+#ifdef SIXTOP_CONF_TIMEOUT
+#define SIXTOP_TIMEOUT                            SIXTOP_CONF_TIMEOUT
+#else /* SIXTOP_CONF_TIMEOUT */
+#define SIXTOP_TIMEOUT                            (10 * CLOCK_SECOND)
+#endif /* SIXTOP_CONF_TIMEOUT */
+
+/* The load-based SF. SFID: from the experimental range */
+#ifdef SIXTOP_SF_LOAD_CONF_SFID
+#define SIXTOP_SF_LOAD_SFID                       SIXTOP_SF_LOAD_CONF_SFID
+#else /* SIXTOP_SF_LOAD_CONF_SFID */
+#define SIXTOP_SF_LOAD_SFID                       0xf0
+#endif /* SIXTOP_SF_LOAD_CONF_SFID */
+
+/* Period at which the queue towards the time source is sampled */
+#ifdef SIXTOP_SF_LOAD_CONF_PERIOD
+#define SIXTOP_SF_LOAD_PERIOD                     SIXTOP_SF_LOAD_CONF_PERIOD
+#else /* SIXTOP_SF_LOAD_CONF_PERIOD */
+#define SIXTOP_SF_LOAD_PERIOD                     (4 * CLOCK_SECOND)
+#endif /* SIXTOP_SF_LOAD_CONF_PERIOD */
+
+/* Add a cell when the average number of queued packets reaches this */
+#ifdef SIXTOP_SF_LOAD_CONF_HIGH_THRESHOLD
+#define SIXTOP_SF_LOAD_HIGH_THRESHOLD             SIXTOP_SF_LOAD_CONF_HIGH_THRESHOLD
+#else /* SIXTOP_SF_LOAD_CONF_HIGH_THRESHOLD */
+#define SIXTOP_SF_LOAD_HIGH_THRESHOLD             2
+#endif /* SIXTOP_SF_LOAD_CONF_HIGH_THRESHOLD */
+
+/* Delete a cell after this many consecutive periods with an empty queue */
+#ifdef SIXTOP_SF_LOAD_CONF_IDLE_PERIODS
+#define SIXTOP_SF_LOAD_IDLE_PERIODS               SIXTOP_SF_LOAD_CONF_IDLE_PERIODS
+#else /* SIXTOP_SF_LOAD_CONF_IDLE_PERIODS */
+#define SIXTOP_SF_LOAD_IDLE_PERIODS               8
+#endif /* SIXTOP_SF_LOAD_CONF_IDLE_PERIODS */
+
+/* Max number of cells allocated to the time source */
+#ifdef SIXTOP_SF_LOAD_CONF_MAX_CELLS
+#define SIXTOP_SF_LOAD_MAX_CELLS                  SIXTOP_SF_LOAD_CONF_MAX_CELLS
+#else /* SIXTOP_SF_LOAD_CONF_MAX_CELLS */
+#define SIXTOP_SF_LOAD_MAX_CELLS                  8
+#endif /* SIXTOP_SF_LOAD_CONF_MAX_CELLS */
+
+#endif /* __SIXTOP_CONF_H__ */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         A traffic-adaptive 6P scheduling function. Periodically samples
+ *         the number of packets queued towards the time source (our RPL
+ *         parent with tsch-rpl), and negotiates one more dedicated TX
+ *         cell when the average backlog builds up, or one less after the
+ *         queue has stayed empty for a while.
+ *
+ */
+
+#include "contiki.h"
+#include "sixtop.h"
+#include "net/mac/tsch/tsch-queue.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+PROCESS(sixtop_sf_load_process, "6P load-based SF");
+
+/* The peer the cells are negotiated with */
+static linkaddr_t parent_addr;
+/* Average queue length, in 1/8 of packets */
+static uint16_t avg_queue_len;
+/* Number of consecutive periods with an empty queue */
+static uint8_t idle_periods;
+
+/*---------------------------------------------------------------------------*/
+static void
+update_cells(void)
+{
+  struct tsch_neighbor *n = tsch_queue_get_time_source();
+  const linkaddr_t *new_addr = n != NULL ? &n->addr : &linkaddr_null;
+  int queue_len;
+  int num_cells;
+
+  if(!linkaddr_cmp(new_addr, &parent_addr)) {
+    /* New parent: release the cells with the old one */
+    if(!linkaddr_cmp(&parent_addr, &linkaddr_null)) {
+      sixtop_clear(&parent_addr, 1);
+    }
+    linkaddr_copy(&parent_addr, new_addr);
+    avg_queue_len = 0;
+    idle_periods = 0;
+  }
+  if(n == NULL) {
+    return;
+  }
+
+  /* Exponentially weighted moving average, alpha = 1/2 */
+  queue_len = tsch_queue_packet_count(&parent_addr);
+  avg_queue_len = (avg_queue_len + 8 * queue_len) / 2;
+  idle_periods = queue_len == 0 ? MIN(idle_periods + 1, 0xff) : 0;
+
+  if(sixtop_is_busy()) {
+    return;
+  }
+  num_cells = sixtop_num_tx_cells(&parent_addr);
+  if(avg_queue_len >= 8 * SIXTOP_SF_LOAD_HIGH_THRESHOLD
+     && num_cells < SIXTOP_SF_LOAD_MAX_CELLS) {
+    PRINTF("6P-SF: backlog %u/8, adding a cell\n", avg_queue_len);
+    sixtop_add_cells(&parent_addr, 1);
+  } else if(idle_periods >= SIXTOP_SF_LOAD_IDLE_PERIODS && num_cells > 0) {
+    PRINTF("6P-SF: idle, deleting a cell\n");
+    if(sixtop_delete_cells(&parent_addr, 1)) {
+      idle_periods = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sixtop_sf_load_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&et, SIXTOP_SF_LOAD_PERIOD);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+    update_cells();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  linkaddr_copy(&parent_addr, &linkaddr_null);
+  process_start(&sixtop_sf_load_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+transaction_done(const linkaddr_t *peer, uint8_t command, uint8_t rc, uint8_t num_cells)
+{
+  /* Let the next period decide: keep growing while the backlog is high */
+  PRINTF("6P-SF: command %u with %u done, rc %u, %u cells\n",
+         command, peer->u8[LINKADDR_SIZE - 1], rc, num_cells);
+}
+/*---------------------------------------------------------------------------*/
+const struct sixtop_sf sixtop_sf_load = {
+  SIXTOP_SF_LOAD_SFID,
+  init,
+  transaction_done,
+};
@@ -0,0 +1,567 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         6top protocol (6P), RFC 8480. 6P messages are carried in an IETF
+ *         payload IE (sub-ID 0xC9) of otherwise empty TSCH data frames.
+ *         Only two-step transactions are supported, with a single
+ *         transaction initiated by this node in progress at any time.
+ *         All cells are allocated in a dedicated slotframe.
+ *
+ */
+
+#include "contiki.h"
+#include "sixtop.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "net/mac/frame802154e-ie.h"
+#include "net/mac/tsch/tsch-private.h"
+#include "net/mac/tsch/tsch-log.h"
+#include "lib/random.h"
+#include <string.h>
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+/* Sub-ID of the 6top IE within the IETF IE */
+#define SIXTOP_SUBIE_ID         0xc9
+#define SIXTOP_VERSION          0
+/* 6P header: version and type, code, SFID, sequence number */
+#define SIXTOP_HDR_LEN          4
+/* Request body before the cell list: metadata, cell options, num cells */
+#define SIXTOP_REQ_BODY_LEN     4
+/* A cell: slot offset and channel offset, 2 bytes each */
+#define SIXTOP_CELL_LEN         4
+#define SIXTOP_MAX_BODY_LEN     (SIXTOP_REQ_BODY_LEN + SIXTOP_MAX_CELLS * SIXTOP_CELL_LEN)
+
+struct sixtop_cell {
+  uint16_t timeslot;
+  uint16_t channel_offset;
+};
+
+/* The transaction initiated by this node */
+static struct {
+  linkaddr_t peer;
+  uint8_t command;
+  uint8_t seqnum;
+  uint8_t num_cells;
+  struct sixtop_cell cells[SIXTOP_MAX_CELLS];
+  uint8_t active;
+  struct ctimer timer;
+} transaction;
+
+/* A response, to apply to the schedule once ACKed by the initiator */
+static struct {
+  linkaddr_t peer;
+  uint8_t command;
+  uint8_t link_options;
+  uint8_t num_cells;
+  struct sixtop_cell cells[SIXTOP_MAX_CELLS];
+  uint8_t active;
+} pending_response;
+
+static uint8_t seqnum;
+static struct tsch_slotframe *sf_6p;
+/* The scheduling function in use */
+extern const struct sixtop_sf SIXTOP_SF;
+
+/*---------------------------------------------------------------------------*/
+static uint8_t
+next_seqnum(void)
+{
+  /* 0 is only used by a node that just reset its 6P state */
+  if(++seqnum == 0) {
+    seqnum++;
+  }
+  return seqnum;
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_cells(uint8_t *buf, const struct sixtop_cell *cells, int num_cells)
+{
+  int i;
+  for(i = 0; i < num_cells; i++) {
+    buf[0] = cells[i].timeslot & 0xff;
+    buf[1] = cells[i].timeslot >> 8;
+    buf[2] = cells[i].channel_offset & 0xff;
+    buf[3] = cells[i].channel_offset >> 8;
+    buf += SIXTOP_CELL_LEN;
+  }
+  return num_cells * SIXTOP_CELL_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_cells(const uint8_t *buf, int len, struct sixtop_cell *cells)
+{
+  int i;
+  int num_cells = MIN(len / SIXTOP_CELL_LEN, SIXTOP_MAX_CELLS);
+  for(i = 0; i < num_cells; i++) {
+    cells[i].timeslot = buf[0] | (buf[1] << 8);
+    cells[i].channel_offset = buf[2] | (buf[3] << 8);
+    buf += SIXTOP_CELL_LEN;
+  }
+  return num_cells;
+}
+/*---------------------------------------------------------------------------*/
+/* Build a 6P message in the packetbuf and send it to dest */
+static int
+send_message(const linkaddr_t *dest, uint8_t type, uint8_t code, uint8_t seq,
+             const uint8_t *body, int body_len, mac_callback_t sent)
+{
+  struct ieee802154_ies ies;
+  uint8_t *buf;
+  int buf_size = PACKETBUF_SIZE;
+  int curr_len = 0;
+  int ret;
+
+  packetbuf_clear();
+  buf = packetbuf_dataptr();
+  memset(&ies, 0, sizeof(ies));
+
+  /* No header IE, payload IEs follow */
+  if((ret = frame80215e_create_ie_header_list_termination_1(buf, buf_size, &ies)) == -1) {
+    return 0;
+  }
+  curr_len += ret;
+  ies.ie_ietf_len = 1 + SIXTOP_HDR_LEN + body_len;
+  if((ret = frame80215e_create_ie_ietf(buf + curr_len, buf_size - curr_len, &ies)) == -1
+     || curr_len + ret + ies.ie_ietf_len > buf_size) {
+    return 0;
+  }
+  curr_len += ret;
+
+  buf[curr_len++] = SIXTOP_SUBIE_ID;
+  buf[curr_len++] = (SIXTOP_VERSION & 0x0f) | ((type & 0x03) << 4);
+  buf[curr_len++] = code;
+  buf[curr_len++] = SIXTOP_SF.sfid;
+  buf[curr_len++] = seq;
+  memcpy(buf + curr_len, body, body_len);
+  curr_len += body_len;
+
+  packetbuf_set_datalen(curr_len);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, dest);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_METADATA, 1);
+
+  PRINTF("6P: sending type %u code %u seqnum %u to %u\n",
+         type, code, seq, TSCH_LOG_ID_FROM_LINKADDR(dest));
+  NETSTACK_MAC.send(sent, NULL);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Is a timeslot of the 6P slotframe available for a new cell? */
+static int
+timeslot_is_free(uint16_t timeslot)
+{
+  int i;
+  if(tsch_schedule_get_link_by_timeslot(sf_6p, timeslot) != NULL) {
+    return 0;
+  }
+  /* Cells offered in our own pending ADD request are reserved */
+  if(transaction.active && transaction.command == SIXTOP_CMD_ADD) {
+    for(i = 0; i < transaction.num_cells; i++) {
+      if(transaction.cells[i].timeslot == timeslot) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Pick up to num_cells random free cells */
+static int
+select_free_cells(struct sixtop_cell *cells, int num_cells)
+{
+  int i;
+  int n = 0;
+  int tries;
+  uint16_t timeslot;
+
+  for(tries = 0; n < num_cells && tries < 4 * SIXTOP_SLOTFRAME_LENGTH; tries++) {
+    timeslot = random_rand() % SIXTOP_SLOTFRAME_LENGTH;
+    if(!timeslot_is_free(timeslot)) {
+      continue;
+    }
+    for(i = 0; i < n; i++) {
+      if(cells[i].timeslot == timeslot) {
+        break;
+      }
+    }
+    if(i == n) {
+      cells[n].timeslot = timeslot;
+      cells[n].channel_offset = random_rand() % tsch_hopping_sequence_length.val;
+      n++;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Look up a cell installed with peer, with the given link options */
+static struct tsch_link *
+get_cell(const linkaddr_t *peer, uint16_t timeslot, uint8_t link_options)
+{
+  struct tsch_link *l = tsch_schedule_get_link_by_timeslot(sf_6p, timeslot);
+  if(l != NULL && linkaddr_cmp(&l->addr, peer) && l->link_options == link_options) {
+    return l;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+apply_cells(const linkaddr_t *peer, uint8_t command, uint8_t link_options,
+            const struct sixtop_cell *cells, int num_cells)
+{
+  struct tsch_link *l;
+  int i;
+  int n = 0;
+
+  for(i = 0; i < num_cells; i++) {
+    if(command == SIXTOP_CMD_ADD) {
+      if(tsch_schedule_get_link_by_timeslot(sf_6p, cells[i].timeslot) == NULL
+         && tsch_schedule_add_link(sf_6p, link_options, LINK_TYPE_NORMAL, peer,
+                                   cells[i].timeslot, cells[i].channel_offset) != NULL) {
+        n++;
+      }
+    } else {
+      if((l = get_cell(peer, cells[i].timeslot, link_options)) != NULL
+         && tsch_schedule_remove_link(sf_6p, l)) {
+        n++;
+      }
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_sent(void *ptr, int status, int transmissions)
+{
+  /* The initiator applies the response when receiving it, do the same
+   * only once sure that it was received */
+  if(pending_response.active && status == MAC_TX_OK) {
+    apply_cells(&pending_response.peer, pending_response.command,
+                pending_response.link_options,
+                pending_response.cells, pending_response.num_cells);
+  }
+  pending_response.active = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_input(const linkaddr_t *peer, uint8_t version, uint8_t code,
+              uint8_t sfid, uint8_t seq, const uint8_t *body, int body_len)
+{
+  struct sixtop_cell candidates[SIXTOP_MAX_CELLS];
+  uint8_t resp[SIXTOP_MAX_CELLS * SIXTOP_CELL_LEN];
+  int resp_len = 0;
+  int num_candidates;
+  uint8_t num_cells;
+  uint8_t link_options;
+  uint8_t rc = SIXTOP_RC_SUCCESS;
+  int i;
+
+  if(version != SIXTOP_VERSION) {
+    rc = SIXTOP_RC_ERR_VERSION;
+  } else if(sfid != SIXTOP_SF.sfid) {
+    rc = SIXTOP_RC_ERR_SFID;
+  } else if(pending_response.active
+            || (transaction.active && linkaddr_cmp(&transaction.peer, peer))) {
+    rc = SIXTOP_RC_ERR_BUSY;
+  } else if(code == SIXTOP_CMD_ADD || code == SIXTOP_CMD_DELETE) {
+    if(body_len < SIXTOP_REQ_BODY_LEN) {
+      rc = SIXTOP_RC_ERR;
+    } else {
+      /* The cells are seen from the initiator: swap TX and RX */
+      link_options = body[2] & LINK_OPTION_SHARED;
+      link_options |= (body[2] & LINK_OPTION_TX) ? LINK_OPTION_RX : 0;
+      link_options |= (body[2] & LINK_OPTION_RX) ? LINK_OPTION_TX : 0;
+      num_cells = body[3];
+      num_candidates = read_cells(body + SIXTOP_REQ_BODY_LEN,
+                                  body_len - SIXTOP_REQ_BODY_LEN, candidates);
+      if(num_cells > num_candidates) {
+        rc = SIXTOP_RC_ERR_CELLLIST;
+      } else {
+        /* Select up to num_cells cells out of the candidates */
+        pending_response.num_cells = 0;
+        for(i = 0; i < num_candidates && pending_response.num_cells < num_cells; i++) {
+          if(code == SIXTOP_CMD_ADD
+             ? timeslot_is_free(candidates[i].timeslot)
+             : get_cell(peer, candidates[i].timeslot, link_options) != NULL) {
+            pending_response.cells[pending_response.num_cells++] = candidates[i];
+          }
+        }
+        linkaddr_copy(&pending_response.peer, peer);
+        pending_response.command = code;
+        pending_response.link_options = link_options;
+        pending_response.active = 1;
+        resp_len = write_cells(resp, pending_response.cells, pending_response.num_cells);
+      }
+    }
+  } else if(code == SIXTOP_CMD_CLEAR) {
+    sixtop_clear(peer, 0);
+  } else {
+    rc = SIXTOP_RC_ERR;
+  }
+
+  PRINTF("6P: request %u from %u, rc %u\n",
+         code, TSCH_LOG_ID_FROM_LINKADDR(peer), rc);
+  if(!send_message(peer, SIXTOP_TYPE_RESPONSE, rc, seq, resp, resp_len,
+                   pending_response.active ? response_sent : NULL)) {
+    pending_response.active = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_input(const linkaddr_t *peer, uint8_t rc, uint8_t seq,
+               const uint8_t *body, int body_len)
+{
+  struct sixtop_cell cells[SIXTOP_MAX_CELLS];
+  int num_cells;
+  int n = 0;
+  int i, j;
+
+  if(!transaction.active || !linkaddr_cmp(peer, &transaction.peer)
+     || seq != transaction.seqnum) {
+    /* E.g. response to a CLEAR, or to a timed out request */
+    return;
+  }
+  ctimer_stop(&transaction.timer);
+  /* End the transaction first, for the offered ADD cells to be free */
+  transaction.active = 0;
+
+  if(rc == SIXTOP_RC_SUCCESS) {
+    num_cells = read_cells(body, body_len, cells);
+    /* Only accept cells that we offered */
+    for(i = 0; i < num_cells; i++) {
+      for(j = 0; j < transaction.num_cells; j++) {
+        if(cells[i].timeslot == transaction.cells[j].timeslot
+           && cells[i].channel_offset == transaction.cells[j].channel_offset) {
+          break;
+        }
+      }
+      if(j < transaction.num_cells) {
+        cells[n++] = cells[i];
+      }
+    }
+    n = apply_cells(peer, transaction.command, LINK_OPTION_TX, cells, n);
+  }
+
+  PRINTF("6P: response from %u, command %u rc %u, %u cells\n",
+         TSCH_LOG_ID_FROM_LINKADDR(peer), transaction.command, rc, n);
+  if(SIXTOP_SF.transaction_done != NULL) {
+    SIXTOP_SF.transaction_done(peer, transaction.command, rc, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+transaction_timeout(void *ptr)
+{
+  linkaddr_t peer;
+
+  if(!transaction.active) {
+    return;
+  }
+  transaction.active = 0;
+  linkaddr_copy(&peer, &transaction.peer);
+  PRINTF("6P: transaction with %u timed out\n", TSCH_LOG_ID_FROM_LINKADDR(&peer));
+  /* We cannot know if the responder applied the request: start over */
+  sixtop_clear(&peer, 1);
+  if(SIXTOP_SF.transaction_done != NULL) {
+    SIXTOP_SF.transaction_done(&peer, transaction.command, SIXTOP_RC_TIMEOUT, 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+start_transaction(const linkaddr_t *peer, uint8_t command, uint8_t num_cells)
+{
+  uint8_t body[SIXTOP_MAX_BODY_LEN];
+  struct tsch_link *l;
+  int num_candidates = 0;
+
+  if(sf_6p == NULL || peer == NULL || !tsch_is_associated
+     || transaction.active || num_cells == 0) {
+    return 0;
+  }
+  num_cells = MIN(num_cells, SIXTOP_MAX_CELLS);
+
+  if(command == SIXTOP_CMD_ADD) {
+    /* Offer as many candidates as possible, leaving the responder a choice */
+    num_candidates = select_free_cells(transaction.cells, SIXTOP_MAX_CELLS);
+  } else {
+    /* Offer our own TX cells to peer */
+    for(l = list_head(sf_6p->links_list);
+        l != NULL && num_candidates < num_cells; l = list_item_next(l)) {
+      if(linkaddr_cmp(&l->addr, peer) && l->link_options == LINK_OPTION_TX) {
+        transaction.cells[num_candidates].timeslot = l->timeslot;
+        transaction.cells[num_candidates].channel_offset = l->channel_offset;
+        num_candidates++;
+      }
+    }
+  }
+  num_cells = MIN(num_cells, num_candidates);
+  if(num_cells == 0) {
+    return 0;
+  }
+
+  /* Metadata (unused), cell options, num cells, cell list */
+  body[0] = 0;
+  body[1] = 0;
+  body[2] = LINK_OPTION_TX;
+  body[3] = num_cells;
+
+  linkaddr_copy(&transaction.peer, peer);
+  transaction.command = command;
+  transaction.seqnum = next_seqnum();
+  transaction.num_cells = num_candidates;
+  transaction.active = 1;
+  if(!send_message(peer, SIXTOP_TYPE_REQUEST, command, transaction.seqnum, body,
+                   SIXTOP_REQ_BODY_LEN + write_cells(body + SIXTOP_REQ_BODY_LEN,
+                                                     transaction.cells, num_candidates),
+                   NULL)) {
+    transaction.active = 0;
+    return 0;
+  }
+  ctimer_set(&transaction.timer, SIXTOP_TIMEOUT, transaction_timeout, NULL);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+sixtop_add_cells(const linkaddr_t *peer, uint8_t num_cells)
+{
+  return start_transaction(peer, SIXTOP_CMD_ADD, num_cells);
+}
+/*---------------------------------------------------------------------------*/
+int
+sixtop_delete_cells(const linkaddr_t *peer, uint8_t num_cells)
+{
+  return start_transaction(peer, SIXTOP_CMD_DELETE, num_cells);
+}
+/*---------------------------------------------------------------------------*/
+void
+sixtop_clear(const linkaddr_t *peer, int send)
+{
+  uint8_t body[2] = { 0, 0 }; /* Metadata */
+  struct tsch_link *l;
+  struct tsch_link *next;
+
+  if(sf_6p == NULL || peer == NULL) {
+    return;
+  }
+  l = list_head(sf_6p->links_list);
+  while(l != NULL) {
+    next = list_item_next(l);
+    if(linkaddr_cmp(&l->addr, peer)) {
+      tsch_schedule_remove_link(sf_6p, l);
+    }
+    l = next;
+  }
+  if(transaction.active && linkaddr_cmp(&transaction.peer, peer)) {
+    ctimer_stop(&transaction.timer);
+    transaction.active = 0;
+  }
+  if(send && tsch_is_associated) {
+    /* No transaction: the response carries nothing we need */
+    send_message(peer, SIXTOP_TYPE_REQUEST, SIXTOP_CMD_CLEAR, next_seqnum(),
+                 body, sizeof(body), NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+sixtop_is_busy(void)
+{
+  return transaction.active;
+}
+/*---------------------------------------------------------------------------*/
+int
+sixtop_num_tx_cells(const linkaddr_t *peer)
+{
+  struct tsch_link *l;
+  int n = 0;
+
+  if(sf_6p == NULL) {
+    return 0;
+  }
+  for(l = list_head(sf_6p->links_list); l != NULL; l = list_item_next(l)) {
+    if(linkaddr_cmp(&l->addr, peer) && (l->link_options & LINK_OPTION_TX)) {
+      n++;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+void
+sixtop_callback_input(void)
+{
+  struct ieee802154_ies ies;
+  const uint8_t *buf;
+  uint8_t body[SIXTOP_MAX_BODY_LEN];
+  int body_len;
+  linkaddr_t peer;
+  uint8_t version, type, code, sfid, seq;
+
+  memset(&ies, 0, sizeof(ies));
+  if(sf_6p == NULL
+     || frame802154e_parse_information_elements(packetbuf_dataptr(),
+                                                packetbuf_datalen(), &ies) == -1
+     || ies.ie_ietf_len < 1 + SIXTOP_HDR_LEN) {
+    return;
+  }
+  buf = (const uint8_t *)packetbuf_dataptr() + ies.ie_ietf_offset;
+  if(buf[0] != SIXTOP_SUBIE_ID) {
+    return;
+  }
+
+  version = buf[1] & 0x0f;
+  type = (buf[1] >> 4) & 0x03;
+  code = buf[2];
+  sfid = buf[3];
+  seq = buf[4];
+  /* Copy what we need, the packetbuf is reused for the response */
+  body_len = MIN(ies.ie_ietf_len - 1 - SIXTOP_HDR_LEN, sizeof(body));
+  memcpy(body, buf + 1 + SIXTOP_HDR_LEN, body_len);
+  linkaddr_copy(&peer, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+
+  if(type == SIXTOP_TYPE_REQUEST) {
+    request_input(&peer, version, code, sfid, seq, body, body_len);
+  } else if(type == SIXTOP_TYPE_RESPONSE && version == SIXTOP_VERSION
+            && sfid == SIXTOP_SF.sfid) {
+    response_input(&peer, code, seq, body, body_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sixtop_init(void)
+{
+  sf_6p = tsch_schedule_get_slotframe_by_handle(SIXTOP_SLOTFRAME_HANDLE);
+  if(sf_6p == NULL) {
+    sf_6p = tsch_schedule_add_slotframe(SIXTOP_SLOTFRAME_HANDLE, SIXTOP_SLOTFRAME_LENGTH);
+  }
+  if(sf_6p != NULL && SIXTOP_SF.init != NULL) {
+    SIXTOP_SF.init();
+  }
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         6top protocol (6P), RFC 8480: two-step transactions used to
+ *         add and remove dedicated TSCH cells between neighbors, driven
+ *         by a scheduling function (SF).
+ *
+ */
+
+#ifndef __SIXTOP_H__
+#define __SIXTOP_H__
+
+#include "net/linkaddr.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/tsch-schedule.h"
+#include "sixtop-conf.h"
+
+/* 6P message types */
+#define SIXTOP_TYPE_REQUEST       0
+#define SIXTOP_TYPE_RESPONSE      1
+#define SIXTOP_TYPE_CONFIRMATION  2
+
+/* 6P command identifiers */
+#define SIXTOP_CMD_ADD            1
+#define SIXTOP_CMD_DELETE         2
+#define SIXTOP_CMD_RELOCATE       3
+#define SIXTOP_CMD_COUNT          4
+#define SIXTOP_CMD_LIST           5
+#define SIXTOP_CMD_SIGNAL         6
+#define SIXTOP_CMD_CLEAR          7
+
+/* 6P return codes */
+#define SIXTOP_RC_SUCCESS         0
+#define SIXTOP_RC_EOL             1
+#define SIXTOP_RC_ERR             2
+#define SIXTOP_RC_RESET           3
+#define SIXTOP_RC_ERR_VERSION     4
+#define SIXTOP_RC_ERR_SFID        5
+#define SIXTOP_RC_ERR_SEQNUM      6
+#define SIXTOP_RC_ERR_CELLLIST    7
+#define SIXTOP_RC_ERR_BUSY        8
+#define SIXTOP_RC_ERR_LOCKED      9
+/* Not a 6P return code: used locally when a transaction times out */
+#define SIXTOP_RC_TIMEOUT         0xff
+
+/* The structure of a 6P scheduling function */
+struct sixtop_sf {
+  /* The SFID carried in all 6P messages */
+  uint8_t sfid;
+  /* Called once from sixtop_init */
+  void (* init)(void);
+  /* Called at the end of every transaction initiated by this node.
+   * num_cells is the number of cells actually added or deleted */
+  void (* transaction_done)(const linkaddr_t *peer, uint8_t command,
+                            uint8_t rc, uint8_t num_cells);
+};
+
+/* Scheduling functions shipped with this app */
+extern const struct sixtop_sf sixtop_sf_load;
+
+/* Call from application to start 6P and its scheduling function.
+ * Requires TSCH to be initialized. */
+void sixtop_init(void);
+/* Start a transaction adding (resp. deleting) num_cells dedicated
+ * TX cells to peer. Returns 1 if the request was sent, 0 otherwise */
+int sixtop_add_cells(const linkaddr_t *peer, uint8_t num_cells);
+int sixtop_delete_cells(const linkaddr_t *peer, uint8_t num_cells);
+/* Remove all 6P cells with peer and ask it to do the same. With send
+ * set to 0, only the local cells are removed (e.g. peer is gone) */
+void sixtop_clear(const linkaddr_t *peer, int send);
+/* Is a transaction initiated by this node in progress? */
+int sixtop_is_busy(void);
+/* Number of 6P-allocated TX cells to peer */
+int sixtop_num_tx_cells(const linkaddr_t *peer);
+/* Callback requied for 6P to operate */
+/* Set with #define TSCH_CALLBACK_PAYLOAD_IE_INPUT sixtop_callback_input */
+void sixtop_callback_input(void);
+
+#endif /* __SIXTOP_H__ */
@@ -55,6 +55,15 @@ AUTOSTART_PROCESSES(&telnetd_process);
 #define TELNETD_CONF_NUMLINES 25
 #endif
 
+/* Size of the output ring. Only one segment is in flight at a time,
+   so anything beyond a few MSS-sized segments just holds shell output
+   that is waiting for the peer. */
+#ifdef TELNETD_CONF_BUFSIZE
+#define TELNETD_BUFSIZE TELNETD_CONF_BUFSIZE
+#else
+#define TELNETD_BUFSIZE (TELNETD_CONF_NUMLINES * TELNETD_CONF_LINELEN)
+#endif
+
 #ifdef TELNETD_CONF_REJECT
 extern char telnetd_reject_text[];
 #else
@@ -70,6 +79,7 @@ struct telnetd_state {
   char buf[TELNETD_CONF_LINELEN + 1];
   char bufptr;
   uint16_t numsent;
+  struct uip_conn *conn;
   uint8_t state;
 #define STATE_NORMAL 0
 #define STATE_IAC    1
@@ -98,10 +108,13 @@ static struct telnetd_state s;
 #define PRINTF(...)
 #endif
 
+/* Output is kept in a ring so that acked data can be dropped without
+   moving what follows it, and so that consecutive shell output lines
+   can be sent together as one MSS-sized segment. */
 struct telnetd_buf {
-  char bufmem[TELNETD_CONF_NUMLINES * TELNETD_CONF_LINELEN];
-  int ptr;
-  int size;
+  char bufmem[TELNETD_BUFSIZE];
+  int start;
+  int len;
 };
 
 static struct telnetd_buf buf;
@@ -112,20 +125,29 @@ static uint8_t connected;
 static void
 buf_init(struct telnetd_buf *buf)
 {
-  buf->ptr = 0;
-  buf->size = TELNETD_CONF_NUMLINES * TELNETD_CONF_LINELEN;
+  buf->start = 0;
+  buf->len = 0;
 }
 /*---------------------------------------------------------------------------*/
 static int
 buf_append(struct telnetd_buf *buf, const char *data, int len)
 {
-  int copylen;
+  int copylen, end, chunk;
 
-  PRINTF("buf_append len %d (%d) '%.*s'\n", len, buf->ptr, len, data);
-  copylen = MIN(len, buf->size - buf->ptr);
-  memcpy(&buf->bufmem[buf->ptr], data, copylen);
-  petsciiconv_toascii(&buf->bufmem[buf->ptr], copylen);
-  buf->ptr += copylen;
+  PRINTF("buf_append len %d (%d) '%.*s'\n", len, buf->len, len, data);
+  copylen = MIN(len, TELNETD_BUFSIZE - buf->len);
+  end = buf->start + buf->len;
+  if(end >= TELNETD_BUFSIZE) {
+    end -= TELNETD_BUFSIZE;
+  }
+  chunk = MIN(copylen, TELNETD_BUFSIZE - end);
+  memcpy(&buf->bufmem[end], data, chunk);
+  petsciiconv_toascii(&buf->bufmem[end], chunk);
+  if(copylen > chunk) {
+    memcpy(&buf->bufmem[0], data + chunk, copylen - chunk);
+    petsciiconv_toascii(&buf->bufmem[0], copylen - chunk);
+  }
+  buf->len += copylen;
 
   return copylen;
 }
@@ -133,7 +155,13 @@ buf_append(struct telnetd_buf *buf, const char *data, int len)
 static void
 buf_copyto(struct telnetd_buf *buf, char *to, int len)
 {
-  memcpy(to, &buf->bufmem[0], len);
+  int chunk;
+
+  chunk = MIN(len, TELNETD_BUFSIZE - buf->start);
+  memcpy(to, &buf->bufmem[buf->start], chunk);
+  if(len > chunk) {
+    memcpy(to + chunk, &buf->bufmem[0], len - chunk);
+  }
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -141,16 +169,36 @@ buf_pop(struct telnetd_buf *buf, int len)
 {
   int poplen;
 
-  PRINTF("buf_pop len %d (%d)\n", len, buf->ptr);
-  poplen = MIN(len, buf->ptr);
-  memcpy(&buf->bufmem[0], &buf->bufmem[poplen], buf->ptr - poplen);
-  buf->ptr -= poplen;
+  PRINTF("buf_pop len %d (%d)\n", len, buf->len);
+  poplen = MIN(len, buf->len);
+  buf->start += poplen;
+  if(buf->start >= TELNETD_BUFSIZE) {
+    buf->start -= TELNETD_BUFSIZE;
+  }
+  buf->len -= poplen;
+  if(buf->len == 0) {
+    buf->start = 0;
+  }
 }
 /*---------------------------------------------------------------------------*/
 static int
 buf_len(struct telnetd_buf *buf)
 {
-  return buf->ptr;
+  return buf->len;
+}
+/*---------------------------------------------------------------------------*/
+/* Nagle-style flushing: if nothing is in flight, ask uIP to poll the
+   connection. The poll is handled by the tcpip process only after the
+   producer of the output has returned, so all output generated in the
+   meantime goes out in the same segment. If a segment is in flight,
+   the output waits for its ack and is sent together with whatever
+   has piled up by then. */
+static void
+buf_flush(void)
+{
+  if(connected && s.numsent == 0 && s.conn != NULL) {
+    tcpip_poll_tcp(s.conn);
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -168,6 +216,7 @@ void
 shell_prompt(char *str)
 {
   buf_append(&buf, str, (int)strlen(str));
+  buf_flush();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -190,6 +239,7 @@ shell_default_output(const char *str1, int len1, const char *str2, int len2)
   buf_append(&buf, str1, len1);
   buf_append(&buf, str2, len2);
   buf_append(&buf, crnl, sizeof(crnl));
+  buf_flush();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -232,13 +282,23 @@ static void
 acked(void)
 {
   buf_pop(&buf, s.numsent);
+  s.numsent = 0;
 }
 /*---------------------------------------------------------------------------*/
 static void
 senddata(void)
 {
   int len;
-  len = MIN(buf_len(&buf), uip_mss());
+
+  /* A retransmission must carry the same data as the lost segment. */
+  if(uip_rexmit()) {
+    len = s.numsent;
+  } else if(s.numsent > 0) {
+    /* Wait for the segment in flight to be acked. */
+    return;
+  } else {
+    len = MIN(buf_len(&buf), uip_mss());
+  }
   PRINTF("senddata len %d\n", len);
   buf_copyto(&buf, uip_appdata, len);
   uip_send(uip_appdata, len);
@@ -362,6 +422,8 @@ telnetd_appcall(void *ts)
     if(!connected) {
       buf_init(&buf);
       s.bufptr = 0;
+      s.numsent = 0;
+      s.conn = uip_conn;
       s.state = STATE_NORMAL;
       connected = 1;
       shell_start();
@@ -387,6 +449,7 @@ telnetd_appcall(void *ts)
        uip_timedout()) {
       shell_stop();
       connected = 0;
+      s.conn = NULL;
     }
     if(uip_acked()) {
 #if TELNETD_CONF_MAX_IDLE_TIME
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Append-only storage of fixed-size time-stamped records.
+ *
+ *      A segment file starts with its sequence number, followed by the
+ *      records, and ends with the smallest and largest timestamp once
+ *      it is full. Everything is appended, so no micro logs are needed.
+ *      Each item ends with a non-zero marker byte since Coffee ignores
+ *      trailing zeroes when it computes the size of a file.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cfs/cfs-coffee.h"
+#include "timeseries.h"
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define MARKER         0xa5
+#define HEADER_SIZE    (sizeof(uint32_t) + 1)
+#define FOOTER_SIZE    (2 * sizeof(uint32_t) + 1)
+#define STORED_SIZE(ts) ((cfs_offset_t)(ts)->record_size + sizeof(uint32_t) + 1)
+#define FOOTER_OFFSET(ts) \
+  (HEADER_SIZE + (cfs_offset_t)(ts)->segment_records * STORED_SIZE(ts))
+/*---------------------------------------------------------------------------*/
+static void
+segment_name(const struct timeseries *ts, uint8_t segment, char *name)
+{
+  sprintf(name, "%s.%u", ts->name, segment);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_time(struct timeseries_segment *s, uint32_t timestamp)
+{
+  if(s->count == 0 || timestamp < s->min_time) {
+    s->min_time = timestamp;
+  }
+  if(s->count == 0 || timestamp > s->max_time) {
+    s->max_time = timestamp;
+  }
+  s->count++;
+}
+/*---------------------------------------------------------------------------*/
+/* Reads the summary of a segment, scanning its records if it is not full */
+static void
+load_segment(struct timeseries *ts, uint8_t segment)
+{
+  struct timeseries_segment *s;
+  char name[TIMESERIES_NAME_LENGTH + 5];
+  uint8_t buf[FOOTER_SIZE];
+  cfs_offset_t end;
+  uint16_t count, i;
+  uint32_t timestamp;
+  int fd;
+
+  s = &ts->segment[segment];
+  memset(s, 0, sizeof(*s));
+
+  segment_name(ts, segment, name);
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    return;
+  }
+
+  if(cfs_read(fd, buf, HEADER_SIZE) != HEADER_SIZE ||
+     buf[HEADER_SIZE - 1] != MARKER) {
+    cfs_close(fd);
+    return;
+  }
+  memcpy(&s->seq, buf, sizeof(s->seq));
+
+  end = cfs_seek(fd, 0, CFS_SEEK_END);
+  if(end >= FOOTER_OFFSET(ts) + FOOTER_SIZE &&
+     cfs_seek(fd, FOOTER_OFFSET(ts), CFS_SEEK_SET) == FOOTER_OFFSET(ts) &&
+     cfs_read(fd, buf, FOOTER_SIZE) == FOOTER_SIZE &&
+     buf[FOOTER_SIZE - 1] == MARKER) {
+    memcpy(&s->min_time, buf, sizeof(s->min_time));
+    memcpy(&s->max_time, buf + sizeof(s->min_time), sizeof(s->max_time));
+    s->count = ts->segment_records;
+  } else {
+    /* The segment is not full, so the summary has to be computed. */
+    count = end < HEADER_SIZE ? 0 : (end - HEADER_SIZE) / STORED_SIZE(ts);
+    if(count > ts->segment_records) {
+      count = ts->segment_records;
+    }
+    for(i = 0; i < count; i++) {
+      cfs_seek(fd, HEADER_SIZE + i * STORED_SIZE(ts), CFS_SEEK_SET);
+      if(cfs_read(fd, &timestamp, sizeof(timestamp)) != sizeof(timestamp)) {
+        break;
+      }
+      add_time(s, timestamp);
+    }
+  }
+  cfs_close(fd);
+
+  PRINTF("timeseries: segment %u seq %lu has %u records\n", segment,
+         (unsigned long)s->seq, s->count);
+}
+/*---------------------------------------------------------------------------*/
+static int
+open_head(struct timeseries *ts)
+{
+  char name[TIMESERIES_NAME_LENGTH + 5];
+  cfs_offset_t offset;
+
+  segment_name(ts, ts->head, name);
+  ts->fd = cfs_open(name, CFS_WRITE | CFS_APPEND);
+  if(ts->fd < 0) {
+    return -1;
+  }
+  offset = HEADER_SIZE + ts->segment[ts->head].count * STORED_SIZE(ts);
+  if(cfs_seek(ts->fd, 0, CFS_SEEK_END) != offset) {
+    /*
+     * A record was not completely written. Rewriting it would need
+     * micro logs, so the next append starts a new segment instead.
+     */
+    cfs_close(ts->fd);
+    ts->fd = -1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Replaces the oldest segment with an empty one that becomes the head */
+static int
+new_head(struct timeseries *ts)
+{
+  char name[TIMESERIES_NAME_LENGTH + 5];
+  uint8_t buf[HEADER_SIZE];
+  uint32_t seq;
+
+  seq = ts->segment[ts->head].seq + 1;
+  if(ts->fd >= 0) {
+    cfs_close(ts->fd);
+    ts->fd = -1;
+  }
+
+  if(ts->segment[ts->head].seq != 0) {
+    ts->head = (ts->head + 1) % ts->segments;
+  }
+  memset(&ts->segment[ts->head], 0, sizeof(struct timeseries_segment));
+
+  segment_name(ts, ts->head, name);
+  cfs_remove(name);
+  if(cfs_coffee_reserve(name, FOOTER_OFFSET(ts) + FOOTER_SIZE) < 0) {
+    return -1;
+  }
+  ts->fd = cfs_open(name, CFS_WRITE);
+  if(ts->fd < 0) {
+    return -1;
+  }
+
+  memcpy(buf, &seq, sizeof(seq));
+  buf[HEADER_SIZE - 1] = MARKER;
+  if(cfs_write(ts->fd, buf, HEADER_SIZE) != HEADER_SIZE) {
+    cfs_close(ts->fd);
+    ts->fd = -1;
+    return -1;
+  }
+  ts->segment[ts->head].seq = seq;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+timeseries_open(struct timeseries *ts, const char *name,
+                uint16_t record_size, uint16_t segment_records,
+                uint8_t segments)
+{
+  uint8_t i;
+
+  if(strlen(name) > TIMESERIES_NAME_LENGTH || segments == 0 ||
+     segments > TIMESERIES_MAX_SEGMENTS || segment_records == 0) {
+    return -1;
+  }
+
+  strcpy(ts->name, name);
+  ts->record_size = record_size;
+  ts->segment_records = segment_records;
+  ts->segments = segments;
+  ts->head = 0;
+  ts->fd = -1;
+
+  for(i = 0; i < segments; i++) {
+    load_segment(ts, i);
+    if(ts->segment[i].seq > ts->segment[ts->head].seq) {
+      ts->head = i;
+    }
+  }
+
+  if(ts->segment[ts->head].seq == 0) {
+    return new_head(ts);
+  }
+  if(ts->segment[ts->head].count < segment_records) {
+    return open_head(ts);
+  }
+  /* The head is full; the next append starts a new segment. */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+timeseries_close(struct timeseries *ts)
+{
+  if(ts->fd >= 0) {
+    cfs_close(ts->fd);
+    ts->fd = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+timeseries_append(struct timeseries *ts, uint32_t timestamp,
+                  const void *record)
+{
+  struct timeseries_segment *s;
+  uint8_t buf[FOOTER_SIZE];
+  uint8_t marker;
+
+  if(ts->segment[ts->head].count >= ts->segment_records || ts->fd < 0) {
+    if(new_head(ts) < 0) {
+      return -1;
+    }
+  }
+  s = &ts->segment[ts->head];
+
+  marker = MARKER;
+  if(cfs_write(ts->fd, &timestamp, sizeof(timestamp)) != sizeof(timestamp) ||
+     cfs_write(ts->fd, record, ts->record_size) != ts->record_size ||
+     cfs_write(ts->fd, &marker, 1) != 1) {
+    return -1;
+  }
+  add_time(s, timestamp);
+
+  if(s->count == ts->segment_records) {
+    /* Close the segment with its summary. */
+    memcpy(buf, &s->min_time, sizeof(s->min_time));
+    memcpy(buf + sizeof(s->min_time), &s->max_time, sizeof(s->max_time));
+    buf[FOOTER_SIZE - 1] = MARKER;
+    cfs_write(ts->fd, buf, FOOTER_SIZE);
+    cfs_close(ts->fd);
+    ts->fd = -1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+timeseries_query(struct timeseries *ts, uint32_t from, uint32_t to,
+                 timeseries_callback_t callback, void *ptr)
+{
+  char name[TIMESERIES_NAME_LENGTH + 5];
+  uint8_t buf[STORED_SIZE(ts)];
+  struct timeseries_segment *s;
+  uint32_t timestamp;
+  uint16_t i;
+  uint8_t n, segment;
+  int fd, found;
+
+  found = 0;
+  for(n = 1; n <= ts->segments; n++) {
+    /* Start with the segment after the head, which is the oldest one. */
+    segment = (ts->head + n) % ts->segments;
+    s = &ts->segment[segment];
+    if(s->count == 0 || s->max_time < from || s->min_time > to) {
+      continue;
+    }
+
+    segment_name(ts, segment, name);
+    fd = cfs_open(name, CFS_READ);
+    if(fd < 0) {
+      return -1;
+    }
+    cfs_seek(fd, HEADER_SIZE, CFS_SEEK_SET);
+    for(i = 0; i < s->count; i++) {
+      if(cfs_read(fd, buf, sizeof(buf)) != sizeof(buf)) {
+        break;
+      }
+      memcpy(&timestamp, buf, sizeof(timestamp));
+      if(timestamp >= from && timestamp <= to) {
+        found++;
+        if(!callback(ptr, timestamp, buf + sizeof(timestamp))) {
+          cfs_close(fd);
+          return found;
+        }
+      }
+    }
+    cfs_close(fd);
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+int
+timeseries_remove(struct timeseries *ts)
+{
+  char name[TIMESERIES_NAME_LENGTH + 5];
+  uint8_t i;
+
+  timeseries_close(ts);
+  for(i = 0; i < ts->segments; i++) {
+    segment_name(ts, i, name);
+    cfs_remove(name);
+    memset(&ts->segment[i], 0, sizeof(struct timeseries_segment));
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
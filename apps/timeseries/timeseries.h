@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Append-only storage of fixed-size time-stamped records.
+ *
+ *      The records are written to a ring of Coffee files called segments.
+ *      A full segment ends with the smallest and the largest timestamp
+ *      of its records, so that time-range queries can skip segments
+ *      without reading their records. When all segments are full, the
+ *      oldest one is removed to make room for new records.
+ */
+
+#ifndef TIMESERIES_H_
+#define TIMESERIES_H_
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+#ifdef TIMESERIES_CONF_MAX_SEGMENTS
+#define TIMESERIES_MAX_SEGMENTS TIMESERIES_CONF_MAX_SEGMENTS
+#else /* TIMESERIES_CONF_MAX_SEGMENTS */
+#define TIMESERIES_MAX_SEGMENTS 8
+#endif /* TIMESERIES_CONF_MAX_SEGMENTS */
+
+/* The segment files are called <name>.<segment> */
+#define TIMESERIES_NAME_LENGTH  8
+
+struct timeseries_segment {
+  uint32_t seq;      /* order of the segment, 0 if it is empty */
+  uint32_t min_time;
+  uint32_t max_time;
+  uint16_t count;
+};
+
+struct timeseries {
+  char name[TIMESERIES_NAME_LENGTH + 1];
+  uint16_t record_size;
+  uint16_t segment_records;
+  uint8_t segments;
+  uint8_t head;
+  int fd;
+  struct timeseries_segment segment[TIMESERIES_MAX_SEGMENTS];
+};
+
+/* Called for each record found by timeseries_query(); return 0 to stop */
+typedef int (*timeseries_callback_t)(void *ptr, uint32_t timestamp,
+                                     const void *record);
+
+/*
+ * Opens the time series called name, creating it if it does not exist.
+ * Each record holds record_size bytes, and each of the segments holds
+ * segment_records records. Returns 0 on success and -1 on failure.
+ */
+int timeseries_open(struct timeseries *ts, const char *name,
+                    uint16_t record_size, uint16_t segment_records,
+                    uint8_t segments);
+
+void timeseries_close(struct timeseries *ts);
+
+/* Appends a record; returns 0 on success and -1 on failure */
+int timeseries_append(struct timeseries *ts, uint32_t timestamp,
+                      const void *record);
+
+/*
+ * Calls callback for the records with from <= timestamp <= to, oldest
+ * segment first. Returns the number of records found, or -1 on failure.
+ */
+int timeseries_query(struct timeseries *ts, uint32_t from, uint32_t to,
+                     timeseries_callback_t callback, void *ptr);
+
+/* Removes all segments of the time series and closes it */
+int timeseries_remove(struct timeseries *ts);
+
+#endif /* TIMESERIES_H_ */
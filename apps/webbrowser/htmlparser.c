@@ -144,6 +144,7 @@ struct htmlparser_state {
   unsigned char minorstate;
   char tag[20];
   unsigned char tagptr;
+  unsigned char tagid;
   char tagattr[20];
   unsigned char tagattrptr;
   char tagattrparam[WWW_CONF_MAX_URLLEN + 1];
@@ -167,9 +168,12 @@ struct htmlparser_state {
 static struct htmlparser_state s;
 
 /*-----------------------------------------------------------------------------------*/
-static char last[1] = {(char)0xff};
-
-static const char *tags[] = {
+/* All names the parser needs to recognize: tags, tag attrs and input
+   types. They are looked up through a small hash table that is built
+   once in htmlparser_init(), so that a name costs one hash
+   computation and (usually) one string compare instead of a scan
+   through the table. */
+static const char *names[] = {
 #define TAG_FIRST       0
 #define TAG_SLASHA      0
   html_slasha,
@@ -218,18 +222,48 @@ static const char *tags[] = {
 #define TAG_TR         22
   html_tr,
 #define TAG_LAST       23
-  last,
+#define ATTR_ALT       23
+  html_alt,
+#define ATTR_HREF      24
+  html_href,
+#define ATTR_ACTION    25
+  html_action,
+#define ATTR_TYPE      26
+  html_type,
+#define ATTR_NAME      27
+  html_name,
+#define ATTR_VALUE     28
+  html_value,
+#define ATTR_SIZE      29
+  html_size,
+#define ATTR_LAST      30
+#define TYPE_SUBMIT    30
+  html_submit,
+#define TYPE_IMAGE     31
+  html_image,
+#define TYPE_TEXT      32
+  html_text,
+#define TYPE_HIDDEN    33
+  html_hidden,
+#define TYPE_LAST      34
 };
 
+/* Must be a power of two comfortably larger than the number of
+   names above. */
+#define NAMEHASH_SIZE 64
+#define NAMEHASH_NONE 0xff
+
+static unsigned char namehash[NAMEHASH_SIZE];
+static unsigned char namehash_ready;
+
 /*-----------------------------------------------------------------------------------*/
-static unsigned char
-iswhitespace(char c)
-{
-  return (c == ISO_space ||
-	  c == ISO_nl ||
-	  c == ISO_cr ||
-	  c == ISO_ht);
-}
+/* Most characters are above the space character, so check that
+   first to make the common case a single comparison. */
+#define iswhitespace(c) ((unsigned char)(c) <= ISO_space &&	\
+			 ((c) == ISO_space ||			\
+			  (c) == ISO_nl ||			\
+			  (c) == ISO_cr ||			\
+			  (c) == ISO_ht))
 /*-----------------------------------------------------------------------------------*/
 #if WWW_CONF_FORMS
 static void
@@ -244,9 +278,76 @@ init_input(void)
 }
 #endif /* WWW_CONF_FORMS */
 /*-----------------------------------------------------------------------------------*/
+/* hash_name():
+ *
+ * Hashes a name up to its terminating zero or, if stop is non-zero,
+ * up to the first stop character after the first position. This lets
+ * "<br/>" be recognized as "br" while "</a>" stays "/a".
+ */
+static unsigned char
+hash_name(const char *name, char stop)
+{
+  unsigned char h, i;
+
+  h = 0;
+  for(i = 0; name[i] != 0 && !(i > 0 && name[i] == stop); ++i) {
+    h = (unsigned char)((h << 1) ^ name[i]);
+  }
+  return h & (NAMEHASH_SIZE - 1);
+}
+/*-----------------------------------------------------------------------------------*/
+static void
+init_namehash(void)
+{
+  unsigned char i, h;
+
+  memset(namehash, NAMEHASH_NONE, sizeof(namehash));
+  for(i = 0; i < TYPE_LAST; ++i) {
+    h = hash_name(names[i], 0);
+    while(namehash[h] != NAMEHASH_NONE) {
+      h = (h + 1) & (NAMEHASH_SIZE - 1);
+    }
+    namehash[h] = i;
+  }
+}
+/*-----------------------------------------------------------------------------------*/
+/* find_name():
+ *
+ * Returns the index of the name in the range [first, last) of the
+ * names table that matches str, or last if there is none.
+ */
+static unsigned char
+find_name(const char *str, char stop, unsigned char first, unsigned char last)
+{
+  unsigned char h, n, i;
+  const char *name;
+
+  if(str[0] == 0) {
+    return last;
+  }
+
+  h = hash_name(str, stop);
+  while((n = namehash[h]) != NAMEHASH_NONE) {
+    if(n >= first && n < last) {
+      name = names[n];
+      for(i = 0; name[i] != 0 && name[i] == str[i]; ++i);
+      if(name[i] == 0 &&
+	 (str[i] == 0 || (i > 0 && str[i] == stop))) {
+	return n;
+      }
+    }
+    h = (h + 1) & (NAMEHASH_SIZE - 1);
+  }
+  return last;
+}
+/*-----------------------------------------------------------------------------------*/
 void
 htmlparser_init(void)
 {
+  if(!namehash_ready) {
+    init_namehash();
+    namehash_ready = 1;
+  }
   s.majorstate = s.lastmajorstate = MAJORSTATE_DISCARD;
   s.minorstate = MINORSTATE_TEXT;
   s.wordlen = 0;
@@ -320,53 +421,20 @@ newline(void)
   htmlparser_newline();
 }
 /*-----------------------------------------------------------------------------------*/
-static unsigned char
-find_tag(char *tag)
+static void
+tagnamefound(void)
 {
-  static unsigned char first, last, i, tabi;
-  static char tagc;
-  
-  first = TAG_FIRST;
-  last = TAG_LAST;
-  i = 0;
-
-  do {
-    tagc = tag[i];
-
-    if((tagc == 0 || tagc == ISO_slash) && tags[first][i] == 0) {
-      return first;
-    }
-
-    tabi = first;
-
-    /* First, find first matching tag from table. */
-    while(tagc > (tags[tabi])[i] && tabi < last) {
-      ++tabi;
-    }
-    first = tabi;
-
-    /* Second, find last matching tag from table. */
-    while(tagc == (tags[tabi])[i] && tabi < last) {
-      ++tabi;
-    }
-    last = tabi;
-
-    /* If first and last matching tags are equal, we have a non-match
-       and return. Else we continue with the next character. */
-    ++i;
-
-  } while(last != first);
-  return TAG_LAST;
+  s.tagid = find_name(s.tag, ISO_slash, TAG_FIRST, TAG_LAST);
 }
 /*-----------------------------------------------------------------------------------*/
 static void
 parse_tag(void)
 {
   static char *tagattrparam;
-  static unsigned char tag;
+  static unsigned char tag, attr;
   static unsigned char size;
 
-  tag = find_tag(s.tag);
+  tag = s.tagid;
   /* If we are inside a <script> we mustn't interpret any tags
      (inside JavaScript strings) but wait for the </script>. */
   if(s.majorstate == MAJORSTATE_SCRIPT && tag != TAG_SLASHSCRIPT) {
@@ -375,6 +443,8 @@ parse_tag(void)
 
   PRINTF(("Parsing tag '%s' '%s' '%s'\n", s.tag, s.tagattr, s.tagattrparam));
 
+  attr = find_name(s.tagattr, 0, TAG_LAST, ATTR_LAST);
+
   switch(tag) {
   case TAG_P:
   case TAG_H1:
@@ -414,7 +484,7 @@ parse_tag(void)
     s.majorstate = s.lastmajorstate = MAJORSTATE_BODY;
     break;
   case TAG_IMG:
-    if(strncmp(s.tagattr, html_alt, sizeof(html_alt)) == 0 && s.tagattrparam[0] != 0) {
+    if(attr == ATTR_ALT && s.tagattrparam[0] != 0) {
       add_char(ISO_lt);
       tagattrparam = &s.tagattrparam[0];
       while(*tagattrparam) {
@@ -427,7 +497,7 @@ parse_tag(void)
     break;
   case TAG_A:
     PRINTF(("A %s %s\n", s.tagattr, s.tagattrparam));
-    if(strncmp(s.tagattr, html_href, sizeof(html_href)) == 0 && s.tagattrparam[0] != 0) {
+    if(attr == ATTR_HREF && s.tagattrparam[0] != 0) {
       strcpy(s.linkurl, s.tagattrparam);
       do_word();
       switch_majorstate(MAJORSTATE_LINK);
@@ -451,7 +521,7 @@ parse_tag(void)
     } else {
       PRINTF(("Form tag\n"));
       switch_majorstate(MAJORSTATE_FORM);
-      if(strncmp(s.tagattr, html_action, sizeof(html_action)) == 0) {
+      if(attr == ATTR_ACTION) {
         PRINTF(("Form action '%s'\n", s.tagattrparam));
         strncpy(s.formaction, s.tagattrparam, WWW_CONF_MAX_FORMACTIONLEN - 1);
       }
@@ -481,26 +551,32 @@ parse_tag(void)
 	init_input();
       } else {
 	PRINTF(("Input '%s' '%s'\n", s.tagattr, s.tagattrparam));
-	if(strncmp(s.tagattr, html_type, sizeof(html_type)) == 0) {
-	  if(strncmp(s.tagattrparam, html_submit, sizeof(html_submit)) == 0) {
+	if(attr == ATTR_TYPE) {
+	  switch(find_name(s.tagattrparam, 0, ATTR_LAST, TYPE_LAST)) {
+	  case TYPE_SUBMIT:
 	    s.inputtype = HTMLPARSER_INPUTTYPE_SUBMIT;
-	  } else if(strncmp(s.tagattrparam, html_image, sizeof(html_image)) == 0) {
+	    break;
+	  case TYPE_IMAGE:
 	    s.inputtype = HTMLPARSER_INPUTTYPE_IMAGE;
-	  } else if(strncmp(s.tagattrparam, html_text, sizeof(html_text)) == 0) {
+	    break;
+	  case TYPE_TEXT:
 	    s.inputtype = HTMLPARSER_INPUTTYPE_TEXT;
-	  } else if(strncmp(s.tagattrparam, html_hidden, sizeof(html_hidden)) == 0) {
+	    break;
+	  case TYPE_HIDDEN:
 	    s.inputtype = HTMLPARSER_INPUTTYPE_HIDDEN;
-	  } else {
+	    break;
+	  default:
 	    s.inputtype = HTMLPARSER_INPUTTYPE_OTHER;
+	    break;
 	  }
-	} else if(strncmp(s.tagattr, html_name, sizeof(html_name)) == 0) {
+	} else if(attr == ATTR_NAME) {
 	  strncpy(s.inputname, s.tagattrparam, WWW_CONF_MAX_INPUTNAMELEN);
-	} else if(strncmp(s.tagattr, html_alt, sizeof(html_alt)) == 0 &&
+	} else if(attr == ATTR_ALT &&
 		  s.inputtype == HTMLPARSER_INPUTTYPE_IMAGE) {
 	  strncpy(s.inputvalue, s.tagattrparam, WWW_CONF_MAX_INPUTVALUELEN);
-	} else if(strncmp(s.tagattr, html_value, sizeof(html_value)) == 0) {
+	} else if(attr == ATTR_VALUE) {
 	  strncpy(s.inputvalue, s.tagattrparam, WWW_CONF_MAX_INPUTVALUELEN);
-	} else if(strncmp(s.tagattr, html_size, sizeof(html_size)) == 0) {
+	} else if(attr == ATTR_SIZE) {
 	  size = 0;
 	  if(s.tagattrparam[0] >= '0' &&
 	     s.tagattrparam[0] <= '9') {
@@ -540,6 +616,7 @@ parse_word(char *data, uint8_t dlen)
       } else if(c == ISO_lt) {
 	s.minorstate = MINORSTATE_TAG;
 	s.tagptr = 0;
+	s.tagid = TAG_LAST;
 	break;
       } else if(c == ISO_ampersand) {
 	s.minorstate = MINORSTATE_EXTCHAR;
@@ -585,6 +662,7 @@ parse_word(char *data, uint8_t dlen)
 	s.minorstate = MINORSTATE_TEXT;
 	s.tagattrptr = s.tagattrparamptr = 0;
 	endtagfound();
+	tagnamefound();
 	parse_tag();
 	break;
       } else if(iswhitespace(c)) {
@@ -593,6 +671,7 @@ parse_word(char *data, uint8_t dlen)
 	s.minorstate = MINORSTATE_TAGATTR;
 	s.tagattrptr = 0;
 	endtagfound();
+	tagnamefound();
 	break;
       } else {
 	/* Keep track of the name of the tag, but convert it to
@@ -180,6 +180,9 @@ static unsigned char x, y;
 static unsigned char loading;
 static unsigned short firsty, pagey;
 static unsigned char newlines;
+/* Set when the visible part of the page has changed since the
+   browser window was last redrawn. */
+static unsigned char pagedirty;
 
 static unsigned char count;
 static char receivingmsgs[4][23] = {
@@ -277,6 +280,7 @@ start_loading(void)
   x = y = 0;
   pagey = 0;
   newlines = 0;
+  pagedirty = 0;
   webpageptr = webpage;
 
   clear_page();
@@ -700,7 +704,13 @@ webclient_datahandler(char *data, uint16_t len)
       count = (count + 1) & 3;
       show_statustext(receivingmsgs[count]);
       htmlparser_parse(data, len);
-      redraw_window();
+      /* Data above the shown part of the page is only laid out to
+	 find where the page starts, so skip the redraw until the
+	 parser has actually put something on screen. */
+      if(pagedirty) {
+	pagedirty = 0;
+	redraw_window();
+      }
     } else {
       uip_abort();
 #if WWW_CONF_WITH_WGET || defined(WWW_CONF_WGET_EXEC)
@@ -769,6 +779,8 @@ add_pagewidget(char *text, unsigned char size, char *attrib, unsigned char type,
   if(firsty == pagey) {
     unsigned char attriblen = strlen(attrib);
 
+    pagedirty = 1;
+
     wptr = webpageptr;
     /* To save memory, we'll copy the widget text to the web page
        drawing area and reference it from there. */
@@ -866,6 +878,7 @@ htmlparser_newline(void)
   webpageptr += (WWW_CONF_WEBPAGE_WIDTH - x);
   ++y;
   x = 0;
+  pagedirty = 1;
 
 #ifdef WITH_PETSCII
   wptr = webpageptr - WWW_CONF_WEBPAGE_WIDTH;
@@ -894,6 +907,7 @@ htmlparser_word(char *word, unsigned char wordlen)
 	webpageptr += wordlen;
 	*webpageptr = ' ';
 	++webpageptr;
+	pagedirty = 1;
       }
       x += wordlen + 1;
       if(x == WWW_CONF_WEBPAGE_WIDTH) {
@@ -571,6 +571,7 @@ uint8_t i,j;
 uint16_t numprinted=0;
 struct httpd_state *s=p;
 uip_ds6_route_t *r;
+uip_ipaddr_t ipaddr;
   /* Span generator calls over tcp segments */
   /* Note retransmissions will execute thise code multiple times for a segment */
   i=s->starti;j=s->startj;
@@ -578,15 +579,16 @@ uip_ds6_route_t *r;
       r != NULL;
       r = uip_ds6_route_next(r)) {
       j++;
+      uip_ds6_route_copy_ipaddr(&ipaddr, r);
 
 #if WEBSERVER_CONF_ROUTE_LINKS
       numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_rtesl1);
-      numprinted += httpd_cgi_sprint_ip6(r->ipaddr, uip_appdata + numprinted);
+      numprinted += httpd_cgi_sprint_ip6(ipaddr, uip_appdata + numprinted);
       numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_rtesl2);
-      numprinted += httpd_cgi_sprint_ip6(r->ipaddr, uip_appdata + numprinted);
+      numprinted += httpd_cgi_sprint_ip6(ipaddr, uip_appdata + numprinted);
       numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_rtesl3);
 #else
-      numprinted += httpd_cgi_sprint_ip6(r->ipaddr, uip_appdata + numprinted);
+      numprinted += httpd_cgi_sprint_ip6(ipaddr, uip_appdata + numprinted);
 #endif
 
       numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_rtes1, r->length);
@@ -62,6 +62,11 @@
 #define STATE_OUTPUT  1
 /* Allocate memory for the tcp connections */
 MEMB(conns, struct httpd_state, WEBSERVER_CONF_CONNS);
+/* and for the input buffers they borrow while reading a request */
+struct inputbuf {
+  char buf[WEBSERVER_CONF_BUFSIZE];
+};
+MEMB(inputbufs, struct inputbuf, WEBSERVER_CONF_INPUTBUFS);
 
 #define ISO_tab     0x09
 #define ISO_nl      0x0a
@@ -392,6 +397,33 @@ char httpd_query[WEBSERVER_CONF_PASSQUERY];
 
 const char httpd_get[] HTTPD_STRING_ATTR = "GET ";
 const char httpd_ref[] HTTPD_STRING_ATTR = "Referer:";
+static int
+get_inputbuf(struct httpd_state *s)
+{
+  s->inputbuf = memb_alloc(&inputbufs);
+  if(s->inputbuf == NULL) {
+    return 0;
+  }
+  PSOCK_INIT(&s->sin, (uint8_t *)s->inputbuf, WEBSERVER_CONF_BUFSIZE - 1);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_inputbuf(struct httpd_state *s)
+{
+  if(s->inputbuf != NULL) {
+    memb_free(&inputbufs, s->inputbuf);
+    s->inputbuf = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_conn(struct httpd_state *s)
+{
+  put_inputbuf(s);
+  memb_free(&conns, s);
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_input(struct httpd_state *s))
 {
@@ -438,6 +470,10 @@ PT_THREAD(handle_input(struct httpd_state *s))
   s->state = STATE_OUTPUT;
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
+    if(PSOCK_DATALEN(&s->sin) <= 2) {
+      /* Empty line, end of the request header */
+      break;
+    }
 #if WEBSERVER_CONF_LOG && WEBSERVER_CONF_REFERER
     if(httpd_strncmp(s->inputbuf, httpd_ref, 8) == 0) {
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
@@ -446,6 +482,8 @@ PT_THREAD(handle_input(struct httpd_state *s))
     }
 #endif
   }
+  /* Let another connection use the buffer while this one sends */
+  put_inputbuf(s);
   PSOCK_END(&s->sin);
 }
 /*---------------------------------------------------------------------------*/
@@ -455,7 +493,9 @@ handle_connection(struct httpd_state *s)
 #if DEBUGLOGIC
   handle_output(s);
 #endif
-  handle_input(s);
+  if(s->inputbuf != NULL) {
+    handle_input(s);
+  }
   if(s->state == STATE_OUTPUT) {
     handle_output(s);
   }
@@ -472,7 +512,7 @@ httpd_appcall(void *state)
   struct httpd_state *s = (struct httpd_state *)state;
   if(uip_closed() || uip_aborted() || uip_timedout()) {
     if(s != NULL) {
-      memb_free(&conns, s);
+      free_conn(s);
     }
   } else if(uip_connected()) {
     s = (struct httpd_state *)memb_alloc(&conns);
@@ -482,14 +522,24 @@ httpd_appcall(void *state)
     }
 #endif
     tcp_markconn(uip_conn, s);
-    PSOCK_INIT(&s->sin, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
-    PSOCK_INIT(&s->sout, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
+    /* The output socket never reads, so it needs no buffer */
+    PSOCK_INIT(&s->sout, NULL, 0);
     PT_INIT(&s->outputpt);
     s->state = STATE_WAITING;
     s->timer = 0;
 #if WEBSERVER_CONF_AJAX
     s->ajax_timeout = WEBSERVER_CONF_TIMEOUT;
 #endif
+    if(!get_inputbuf(s)) {
+      if(uip_newdata()) {
+        /* Data that came with the handshake cannot be held back */
+        uip_abort();
+        free_conn(s);
+        return;
+      }
+      uip_stop();
+      return;
+    }
     handle_connection(s);
   } else if(s != NULL) {
     if(uip_poll()) {
@@ -500,11 +550,18 @@ httpd_appcall(void *state)
       if(s->timer >= WEBSERVER_CONF_TIMEOUT) {
 #endif
         uip_abort();
-        memb_free(&conns, s);
+        free_conn(s);
+        return;
       }
     } else {
       s->timer = 0;
     }
+    if(s->state == STATE_WAITING && s->inputbuf == NULL) {
+      if(!get_inputbuf(s)) {
+        return;
+      }
+      uip_restart();
+    }
     handle_connection(s);
   } else {
     uip_abort();
@@ -516,8 +573,9 @@ httpd_init(void)
 {
   tcp_listen(UIP_HTONS(80));
   memb_init(&conns);
+  memb_init(&inputbufs);
   PRINTD(" sizof(struct httpd_state) = %d\n",sizeof(struct httpd_state));
-  PRINTA(" %d bytes used for httpd state storage\n",conns.size * conns.num);
+  PRINTA(" %d bytes used for httpd state storage\n",conns.size * conns.num + inputbufs.size * inputbufs.num);
 #if WEBSERVER_CONF_CGI
   httpd_cgi_init();
 #endif
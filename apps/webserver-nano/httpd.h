@@ -221,6 +221,12 @@ extern char httpd_query[WEBSERVER_CONF_PASSQUERY];
 #error Specified WEBSERVER_CONF_NANO configuration not supported.
 #endif /* WEBSERVER_CONF_NANO */
 
+/* Input buffers are shared by the connections and held only while a
+   request is read. Connections that find none free wait for one. */
+#ifndef WEBSERVER_CONF_INPUTBUFS
+#define WEBSERVER_CONF_INPUTBUFS WEBSERVER_CONF_CONNS
+#endif
+
 /* Address printing used by cgi's and logging, but it can be turned off if desired */
 #if WEBSERVER_CONF_LOG || WEBSERVER_CONF_ADDRESSES || WEBSERVER_CONF_NEIGHBORS || WEBSERVER_CONF_ROUTES
 extern uip_ds6_netif_t uip_ds6_if;
@@ -276,7 +282,7 @@ struct httpd_state {
 #if WEBSERVER_CONF_INCLUDE || WEBSERVER_CONF_CGI
   struct pt scriptpt;
 #endif
-  char inputbuf[WEBSERVER_CONF_BUFSIZE];
+  char *inputbuf;
   char filename[WEBSERVER_CONF_NAMESIZE];
   char state;
   struct httpd_fs_file file;  
@@ -71,12 +71,46 @@ MEMB(conns, struct httpd_state, CONNS);
 #define ISO_period  0x2e
 #define ISO_slash   0x2f
 
+/*---------------------------------------------------------------------------*/
+#if HTTPD_CFS_STREAM
+/* Called by the protosocket to put the current segment in uip_appdata,
+   both for its first transmission and for every retransmission. */
+static unsigned short
+generate_file(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+
+  if(s->prefetched) {
+    /* send_file() has just read the segment into uip_appdata */
+    s->prefetched = 0;
+  } else if(cfs_seek(s->fd, s->offset, CFS_SEEK_SET) != s->offset ||
+            cfs_read(s->fd, uip_appdata, s->len) != s->len) {
+    return 0;
+  }
+  return s->len;
+}
+#endif /* HTTPD_CFS_STREAM */
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(send_file(struct httpd_state *s))
 {
   PSOCK_BEGIN(&s->sout);
-  
+
+#if HTTPD_CFS_STREAM
+  s->offset = 0;
+  while(1) {
+    /* Read the next segment straight into the uip buffer. A
+       retransmission leaves the file position at the segment's end, so
+       no seek is needed here. */
+    s->len = cfs_read(s->fd, uip_appdata, uip_mss());
+    if(s->len <= 0) {
+      break;
+    }
+    s->prefetched = 1;
+    PSOCK_GENERATOR_SEND(&s->sout, generate_file, s);
+    s->offset += s->len;
+  }
+#else /* HTTPD_CFS_STREAM */
   do {
     /* Read data from file system into buffer */
     s->len = cfs_read(s->fd, s->outputbuf, sizeof(s->outputbuf));
@@ -88,7 +122,8 @@ PT_THREAD(send_file(struct httpd_state *s))
       break;
     }
   } while(s->len > 0);
-      
+#endif /* HTTPD_CFS_STREAM */
+
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
@@ -35,6 +35,7 @@
 #define HTTPD_CFS_H_
 
 #include "contiki-net.h"
+#include "cfs/cfs.h"
 
 #ifndef WEBSERVER_CONF_CFS_PATHLEN
 #define HTTPD_PATHLEN 80
@@ -42,12 +43,26 @@
 #define HTTPD_PATHLEN WEBSERVER_CONF_CFS_PATHLEN
 #endif /* WEBSERVER_CONF_CFS_CONNS */
 
+/* If WEBSERVER_CONF_CFS_STREAM is set, files are read from CFS straight
+   into the TCP segment, and read again on retransmission, instead of
+   being kept in a per-connection output buffer. */
+#ifndef WEBSERVER_CONF_CFS_STREAM
+#define HTTPD_CFS_STREAM 0
+#else /* WEBSERVER_CONF_CFS_STREAM */
+#define HTTPD_CFS_STREAM WEBSERVER_CONF_CFS_STREAM
+#endif /* WEBSERVER_CONF_CFS_STREAM */
+
 struct httpd_state {
   struct timer timer;
   struct psock sin, sout;
   struct pt outputpt;
   char inputbuf[HTTPD_PATHLEN + 30];
+#if HTTPD_CFS_STREAM
+  cfs_offset_t offset;
+  char prefetched;
+#else /* HTTPD_CFS_STREAM */
   char outputbuf[UIP_TCP_MSS];
+#endif /* HTTPD_CFS_STREAM */
   char filename[HTTPD_PATHLEN];
   char state;
   int fd;
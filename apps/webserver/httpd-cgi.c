@@ -316,13 +316,15 @@ make_routes(void *p)
   uint8_t j=0;
   uint16_t numprinted;
   uip_ds6_route_t *r;
+  uip_ipaddr_t ipaddr;
 
   numprinted = httpd_snprintf((char *)uip_appdata, uip_mss(),httpd_cgi_addrh);
   for(r = uip_ds6_route_head();
       r != NULL;
       r = uip_ds6_route_next(r)) {
     j++;
-    numprinted += httpd_cgi_sprint_ip6(r->ipaddr, uip_appdata + numprinted);
+    uip_ds6_route_copy_ipaddr(&ipaddr, r);
+    numprinted += httpd_cgi_sprint_ip6(ipaddr, uip_appdata + numprinted);
     numprinted += httpd_snprintf((char *)uip_appdata+numprinted, uip_mss()-numprinted, httpd_cgi_rtes1, r->length);
     numprinted += httpd_cgi_sprint_ip6(*(uip_ds6_route_nexthop(r)), uip_appdata + numprinted);
     if(r->state.lifetime < 3600) {
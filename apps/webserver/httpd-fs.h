@@ -41,6 +41,7 @@
 struct httpd_fs_file {
   char *data;
   int len;
+  int hdrlen; /* Length of the precomputed response header in data, if any */
 };
 
 /* file must be allocated by caller and will be filled in
@@ -41,6 +41,9 @@ struct httpd_fsdata_file {
   const char *name;
   const char *data;
   const int len;
+  /* If non-zero, data starts with a complete HTTP response header of
+     this many bytes, generated by makefsdata -H, and len includes it */
+  const int hdrlen;
 #ifdef HTTPD_FS_STATISTICS
 #if HTTPD_FS_STATISTICS == 1
   uint16_t count;
@@ -53,6 +56,7 @@ struct httpd_fsdata_file_noconst {
   char *name;
   char *data;
   int len;
+  int hdrlen;
 #ifdef HTTPD_FS_STATISTICS
 #if HTTPD_FS_STATISTICS == 1
   uint16_t count;
@@ -51,20 +51,85 @@
 #define CONNS WEBSERVER_CONF_CGI_CONNS
 #endif /* WEBSERVER_CONF_CGI_CONNS */
 
+/* Input buffers are only held while a request is read, so fewer
+   buffers than connections are needed. A connection that finds none
+   free is stopped until one becomes available. */
+#ifdef WEBSERVER_CONF_INPUTBUFS
+#define INPUTBUFS WEBSERVER_CONF_INPUTBUFS
+#else /* WEBSERVER_CONF_INPUTBUFS */
+#define INPUTBUFS CONNS
+#endif /* WEBSERVER_CONF_INPUTBUFS */
+
+#define INPUTBUF_SIZE 50
+
 #define STATE_WAITING 0
 #define STATE_OUTPUT  1
 
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, (unsigned int)strlen(str))
 MEMB(conns, struct httpd_state, CONNS);
 
+struct inputbuf {
+  char buf[INPUTBUF_SIZE];
+};
+MEMB(inputbufs, struct inputbuf, INPUTBUFS);
+
 #define ISO_nl      0x0a
+#define ISO_cr      0x0d
 #define ISO_space   0x20
 #define ISO_bang    0x21
+#define ISO_quote   0x22
 #define ISO_percent 0x25
 #define ISO_period  0x2e
 #define ISO_slash   0x2f
 #define ISO_colon   0x3a
 
+/*---------------------------------------------------------------------------*/
+/* Parses the first quoted entity tag in the len bytes at str, in the
+   8 hex digit form written by makefsdata. Returns 0 if there is none. */
+static uint32_t
+parse_etag(const char *str, int len)
+{
+  uint32_t etag;
+  int i;
+  char c;
+
+  for(; len > 0 && *str != ISO_quote; str++, len--) {
+    if(*str == ISO_cr || *str == ISO_nl || *str == 0) {
+      return 0;
+    }
+  }
+  if(len < 10) {
+    return 0;
+  }
+  etag = 0;
+  for(i = 1; i <= 8; i++) {
+    c = str[i];
+    if(c >= '0' && c <= '9') {
+      c -= '0';
+    } else if(c >= 'a' && c <= 'f') {
+      c -= 'a' - 10;
+    } else {
+      return 0;
+    }
+    etag = (etag << 4) | c;
+  }
+  return str[9] == ISO_quote ? etag : 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the entity tag in the precomputed header of the file, or 0 */
+static uint32_t
+file_etag(struct httpd_fs_file *file)
+{
+  int i;
+
+  for(i = 0; i + sizeof(http_etag) - 1 < file->hdrlen; i++) {
+    if(strncmp(file->data + i, http_etag, sizeof(http_etag) - 1) == 0) {
+      i += sizeof(http_etag) - 1;
+      return parse_etag(file->data + i, file->hdrlen - i);
+    }
+  }
+  return 0;
+}
 /*---------------------------------------------------------------------------*/
 static unsigned short
 generate(void *state)
@@ -139,6 +204,9 @@ PT_THREAD(handle_script(struct httpd_state *s))
       s->scriptlen = s->file.len - 3;
       if(*(s->scriptptr - 1) == ISO_colon) {
 	httpd_fs_open(s->scriptptr + 1, &s->file);
+	/* Included files go without their own response header */
+	s->file.data += s->file.hdrlen;
+	s->file.len -= s->file.hdrlen;
 	PT_WAIT_THREAD(&s->scriptpt, send_file(s));
       } else {
 	PT_WAIT_THREAD(&s->scriptpt,
@@ -215,6 +283,16 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
 }
 /*---------------------------------------------------------------------------*/
 static
+PT_THREAD(send_string(struct httpd_state *s, const char *str))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  SEND_STRING(&s->sout, str);
+
+  PSOCK_END(&s->sout);
+}
+/*---------------------------------------------------------------------------*/
+static
 PT_THREAD(handle_output(struct httpd_state *s))
 {
   char *ptr;
@@ -224,11 +302,22 @@ PT_THREAD(handle_output(struct httpd_state *s))
   if(!httpd_fs_open(s->filename, &s->file)) {
     strcpy(s->filename, http_404_html);
     httpd_fs_open(s->filename, &s->file);
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_headers(s,
-		   http_header_404));
+    if(s->file.hdrlen == 0) {
+      PT_WAIT_THREAD(&s->outputpt,
+		     send_headers(s,
+		     http_header_404));
+    }
     PT_WAIT_THREAD(&s->outputpt,
 		   send_file(s));
+  } else if(s->file.hdrlen != 0) {
+    /* The header is stored with the file, so both go out together */
+    if(s->etag != 0 && s->etag == file_etag(&s->file)) {
+      PT_WAIT_THREAD(&s->outputpt,
+		     send_string(s, http_header_304));
+    } else {
+      PT_WAIT_THREAD(&s->outputpt,
+		     send_file(s));
+    }
   } else {
     PT_WAIT_THREAD(&s->outputpt,
 		   send_headers(s,
@@ -246,6 +335,33 @@ PT_THREAD(handle_output(struct httpd_state *s))
   PT_END(&s->outputpt);
 }
 /*---------------------------------------------------------------------------*/
+static int
+get_inputbuf(struct httpd_state *s)
+{
+  s->inputbuf = memb_alloc(&inputbufs);
+  if(s->inputbuf == NULL) {
+    return 0;
+  }
+  PSOCK_INIT(&s->sin, (uint8_t *)s->inputbuf, INPUTBUF_SIZE - 1);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_inputbuf(struct httpd_state *s)
+{
+  if(s->inputbuf != NULL) {
+    memb_free(&inputbufs, s->inputbuf);
+    s->inputbuf = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_conn(struct httpd_state *s)
+{
+  put_inputbuf(s);
+  memb_free(&conns, s);
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_input(struct httpd_state *s))
 {
@@ -277,20 +393,35 @@ PT_THREAD(handle_input(struct httpd_state *s))
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
 
+    if(PSOCK_DATALEN(&s->sin) <= 2) {
+      /* Empty line, end of the request header */
+      break;
+    }
     if(strncmp(s->inputbuf, http_referer, 8) == 0) {
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
       petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
       webserver_log(s->inputbuf);
+    } else if(strncmp(s->inputbuf, http_if_none_match,
+                      sizeof(http_if_none_match) - 1) == 0) {
+      s->etag = parse_etag(s->inputbuf + sizeof(http_if_none_match) - 1,
+                           PSOCK_DATALEN(&s->sin) -
+                           (sizeof(http_if_none_match) - 1));
     }
   }
-  
+
+  /* The rest of the request is ignored; let another connection
+     use the buffer while this one sends its response. */
+  put_inputbuf(s);
+
   PSOCK_END(&s->sin);
 }
 /*---------------------------------------------------------------------------*/
 static void
 handle_connection(struct httpd_state *s)
 {
-  handle_input(s);
+  if(s->inputbuf != NULL) {
+    handle_input(s);
+  }
   if(s->state == STATE_OUTPUT) {
     handle_output(s);
   }
@@ -303,7 +434,7 @@ httpd_appcall(void *state)
 
   if(uip_closed() || uip_aborted() || uip_timedout()) {
     if(s != NULL) {
-      memb_free(&conns, s);
+      free_conn(s);
     }
   } else if(uip_connected()) {
     s = (struct httpd_state *)memb_alloc(&conns);
@@ -312,23 +443,41 @@ httpd_appcall(void *state)
       return;
     }
     tcp_markconn(uip_conn, s);
-    PSOCK_INIT(&s->sin, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
-    PSOCK_INIT(&s->sout, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
+    /* The output socket never reads, so it needs no buffer */
+    PSOCK_INIT(&s->sout, NULL, 0);
     PT_INIT(&s->outputpt);
     s->state = STATE_WAITING;
+    s->etag = 0;
     /*    timer_set(&s->timer, CLOCK_SECOND * 100);*/
     s->timer = 0;
+    if(!get_inputbuf(s)) {
+      if(uip_newdata()) {
+        /* Data that came with the handshake cannot be held back */
+        uip_abort();
+        free_conn(s);
+        return;
+      }
+      uip_stop();
+      return;
+    }
     handle_connection(s);
   } else if(s != NULL) {
     if(uip_poll()) {
       ++s->timer;
       if(s->timer >= 20) {
 	uip_abort();
-	memb_free(&conns, s);
+	free_conn(s);
+	return;
       }
     } else {
       s->timer = 0;
     }
+    if(s->state == STATE_WAITING && s->inputbuf == NULL) {
+      if(!get_inputbuf(s)) {
+        return;
+      }
+      uip_restart();
+    }
     handle_connection(s);
   } else {
     uip_abort();
@@ -340,6 +489,7 @@ httpd_init(void)
 {
   tcp_listen(UIP_HTONS(80));
   memb_init(&conns);
+  memb_init(&inputbufs);
   httpd_cgi_init();
 }
 #if NETSTACK_CONF_WITH_IPV6
@@ -42,10 +42,11 @@ struct httpd_state {
   unsigned char timer;
   struct psock sin, sout;
   struct pt outputpt, scriptpt;
-  char inputbuf[50];
+  char *inputbuf;             /* Borrowed while reading the request */
   char filename[20];
   char state;
   struct httpd_fs_file file;  
+  uint32_t etag;              /* Entity tag from If-None-Match, or 0 */
   int len;
   char *scriptptr;
   int scriptlen;
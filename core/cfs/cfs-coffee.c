@@ -75,6 +75,23 @@
 #error "Cannot have COFFEE_APPEND_ONLY set when COFFEE_MICRO_LOGS is set."
 #endif
 
+/*
+ * The number of log records that are kept in RAM before they are
+ * written to the micro log of a file. Consecutive writes to the same
+ * record are merged in the cache. Cached records are written when the
+ * file is closed, read, or synchronized with cfs_coffee_sync(), and
+ * when the cache needs room for another record. Each entry uses
+ * COFFEE_PAGE_SIZE bytes of RAM. Set to 0 to write records directly.
+ */
+#ifndef COFFEE_LOG_CACHE_SIZE
+#define COFFEE_LOG_CACHE_SIZE  0
+#endif
+
+#if COFFEE_LOG_CACHE_SIZE && !COFFEE_MICRO_LOGS
+#undef COFFEE_LOG_CACHE_SIZE
+#define COFFEE_LOG_CACHE_SIZE  0
+#endif
+
 /*
  * Prevent sectors from being erased directly after file removal.
  * This will level the wear across sectors better, but may lead
@@ -84,6 +101,45 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * The number of files that the RAM index of file names can hold. The
+ * index lets find_file() skip the sequential scan of the flash memory.
+ * It is built during the first scan and is not used if the file system
+ * holds more files than this. Set to 0 to disable the index.
+ */
+#ifndef COFFEE_NAME_INDEX_SIZE
+#define COFFEE_NAME_INDEX_SIZE  0
+#endif
+
+/*
+ * Background garbage collection erases reclaimable sectors from a
+ * separate process, one sector at a time, so that reserve() rarely
+ * has to stall on a synchronous collection. The collector runs when
+ * at least COFFEE_BACKGROUND_GC_THRESHOLD pages have been made
+ * obsolete, and it erases at most COFFEE_BACKGROUND_GC_SECTORS sectors
+ * each COFFEE_BACKGROUND_GC_INTERVAL.
+ */
+#ifndef COFFEE_BACKGROUND_GC
+#define COFFEE_BACKGROUND_GC  0
+#endif
+
+#if COFFEE_BACKGROUND_GC
+#include "sys/process.h"
+#include "sys/etimer.h"
+
+#ifndef COFFEE_BACKGROUND_GC_THRESHOLD
+#define COFFEE_BACKGROUND_GC_THRESHOLD  (COFFEE_SECTOR_SIZE / COFFEE_PAGE_SIZE)
+#endif
+
+#ifndef COFFEE_BACKGROUND_GC_SECTORS
+#define COFFEE_BACKGROUND_GC_SECTORS  1
+#endif
+
+#ifndef COFFEE_BACKGROUND_GC_INTERVAL
+#define COFFEE_BACKGROUND_GC_INTERVAL  (10 * CLOCK_SECOND)
+#endif
+#endif /* COFFEE_BACKGROUND_GC */
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -111,6 +167,9 @@
 #define GC_GREEDY         0
 /* "Reluctant" garbage collection stops after erasing one sector. */
 #define GC_RELUCTANT      1
+/* "Incremental" garbage collection erases the first sector that has
+   obsolete pages but no active pages. */
+#define GC_INCREMENTAL    2
 
 /* File descriptor macros. */
 #define FD_VALID(fd)      ((fd) >= 0 && (fd) < COFFEE_FD_SET_SIZE && \
@@ -158,6 +217,8 @@ struct sector_status {
   coffee_page_t active;
   coffee_page_t obsolete;
   coffee_page_t free;
+  /* Obsolete pages of an extent that starts in a previous sector. */
+  coffee_page_t carried;
 };
 
 /* The structure of cached file objects. */
@@ -190,6 +251,28 @@ struct file_header {
   char name[COFFEE_NAME_LENGTH];
 };
 
+#if COFFEE_NAME_INDEX_SIZE
+/* An entry in the RAM index of file names. */
+struct name_index_entry {
+  coffee_page_t page;
+  uint8_t hash;
+};
+
+/* The states of the name index. */
+#define NAME_INDEX_UNKNOWN  0
+#define NAME_INDEX_VALID    1
+#define NAME_INDEX_OVERFLOW 2
+#endif /* COFFEE_NAME_INDEX_SIZE */
+
+#if COFFEE_LOG_CACHE_SIZE
+/* A log record that has not been written to the micro log yet. */
+struct log_cache_entry {
+  struct file *file;
+  uint16_t region;
+  char data[COFFEE_PAGE_SIZE];
+};
+#endif /* COFFEE_LOG_CACHE_SIZE */
+
 /* This is needed because of a buggy compiler. */
 struct log_param {
   cfs_offset_t offset;
@@ -205,6 +288,21 @@ static struct file coffee_files[COFFEE_MAX_OPEN_FILES];
 static struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
 static coffee_page_t next_free;
 static char gc_wait;
+#if COFFEE_NAME_INDEX_SIZE
+static struct name_index_entry name_index[COFFEE_NAME_INDEX_SIZE];
+static uint16_t name_index_count;
+static uint8_t name_index_state;
+#endif /* COFFEE_NAME_INDEX_SIZE */
+#if COFFEE_BACKGROUND_GC
+static coffee_page_t obsolete_pages;
+PROCESS(coffee_gc_process, "Coffee GC");
+#endif /* COFFEE_BACKGROUND_GC */
+#if COFFEE_LOG_CACHE_SIZE
+static struct log_cache_entry log_cache[COFFEE_LOG_CACHE_SIZE];
+static uint8_t log_cache_victim;
+
+static void log_cache_flush(coffee_page_t page);
+#endif /* COFFEE_LOG_CACHE_SIZE */
 
 /*---------------------------------------------------------------------------*/
 static void
@@ -268,6 +366,7 @@ get_sector_status(coffee_page_t sector, struct sector_status *stats)
     }
     active = skip_pages;
   } else {
+    stats->carried = skip_pages;
     if(skip_pages >= COFFEE_PAGES_PER_SECTOR) {
       stats->obsolete = COFFEE_PAGES_PER_SECTOR;
       skip_pages -= COFFEE_PAGES_PER_SECTOR;
@@ -348,15 +447,18 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
          (unsigned)skip_pages, (int)start / COFFEE_PAGES_PER_SECTOR);
 }
 /*---------------------------------------------------------------------------*/
-static void
+static int
 collect_garbage(int mode)
 {
   coffee_page_t sector;
   struct sector_status stats;
   coffee_page_t first_page, isolation_count;
+  int erased, last_erased;
 
   PRINTF("Coffee: Running the garbage collector in %s mode\n",
-         mode == GC_RELUCTANT ? "reluctant" : "greedy");
+         mode == GC_RELUCTANT ? "reluctant" :
+         mode == GC_INCREMENTAL ? "incremental" : "greedy");
+  erased = last_erased = 0;
   /*
    * The garbage collector erases as many sectors as possible. A sector is
    * erasable if there are only free or obsolete pages in it.
@@ -367,12 +469,28 @@ collect_garbage(int mode)
            (unsigned)sector, (unsigned)stats.active,
            (unsigned)stats.obsolete, (unsigned)stats.free);
 
-    if(stats.active > 0) {
+    /*
+     * An erased sector followed by a sector that is covered by the same
+     * extent without isolated pages has to be erased in the same run.
+     */
+    if(mode == GC_INCREMENTAL && erased > 0 &&
+       !(last_erased && stats.carried > 0)) {
+      break;
+    }
+
+    /*
+     * The header of an extent reaching into this sector from a sector
+     * that was not erased would still cover the pages after they have
+     * been erased and allocated again.
+     */
+    if(stats.active > 0 || (stats.carried > 0 && !last_erased)) {
+      last_erased = 0;
       continue;
     }
+    last_erased = 0;
 
     if((mode == GC_RELUCTANT && stats.free == 0) ||
-       (mode == GC_GREEDY && stats.obsolete > 0)) {
+       (mode != GC_RELUCTANT && stats.obsolete > 0)) {
       first_page = sector * COFFEE_PAGES_PER_SECTOR;
       if(first_page < next_free) {
         next_free = first_page;
@@ -384,13 +502,53 @@ collect_garbage(int mode)
 
       COFFEE_ERASE(sector);
       PRINTF("Coffee: Erased sector %d!\n", sector);
+      erased++;
+      last_erased = 1;
 
       if(mode == GC_RELUCTANT && isolation_count > 0) {
         break;
       }
     }
   }
+  return erased;
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_BACKGROUND_GC
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  static struct etimer et;
+  static int erased;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&et, COFFEE_BACKGROUND_GC_INTERVAL);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL || etimer_expired(&et));
+
+    if(obsolete_pages >= COFFEE_BACKGROUND_GC_THRESHOLD) {
+      /*
+       * The sector status is computed again before each erasure since
+       * the file system may have changed while other processes ran.
+       */
+      for(erased = 0; erased < COFFEE_BACKGROUND_GC_SECTORS; erased++) {
+        if(collect_garbage(GC_INCREMENTAL) == 0) {
+          /* The remaining obsolete pages share sectors with active files. */
+          obsolete_pages = 0;
+          break;
+        }
+        gc_wait = 0;
+        PROCESS_PAUSE();
+      }
+    }
+
+    if(etimer_expired(&et)) {
+      etimer_reset(&et);
+    }
+  }
+
+  PROCESS_END();
 }
+#endif /* COFFEE_BACKGROUND_GC */
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
 next_file(coffee_page_t page, struct file_header *hdr)
@@ -452,12 +610,86 @@ load_file(coffee_page_t start, struct file_header *hdr)
   return file;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_NAME_INDEX_SIZE
+static uint8_t
+name_hash(const char *name)
+{
+  uint8_t hash;
+  int i;
+
+  hash = 0;
+  for(i = 0; i < COFFEE_NAME_LENGTH && name[i] != '\0'; i++) {
+    hash = (hash << 3) + (hash >> 5) + name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_add(const char *name, coffee_page_t page)
+{
+  if(name_index_state == NAME_INDEX_OVERFLOW) {
+    return;
+  }
+  if(name_index_count == COFFEE_NAME_INDEX_SIZE) {
+    /* The index is incomplete and cannot be used anymore. */
+    name_index_state = NAME_INDEX_OVERFLOW;
+    PRINTF("Coffee: The file name index is full\n");
+    return;
+  }
+  name_index[name_index_count].page = page;
+  name_index[name_index_count].hash = name_hash(name);
+  name_index_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_remove(coffee_page_t page)
+{
+  int i;
+
+  for(i = 0; i < name_index_count; i++) {
+    if(name_index[i].page == page) {
+      name_index[i] = name_index[--name_index_count];
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_reset(void)
+{
+  name_index_count = 0;
+  name_index_state = NAME_INDEX_UNKNOWN;
+}
+/*---------------------------------------------------------------------------*/
+static struct file *
+name_index_find(const char *name)
+{
+  struct file_header hdr;
+  uint8_t hash;
+  int i;
+
+  hash = name_hash(name);
+  for(i = 0; i < name_index_count; i++) {
+    if(name_index[i].hash == hash) {
+      read_header(&hdr, name_index[i].page);
+      if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+        return load_file(name_index[i].page, &hdr);
+      }
+    }
+  }
+  return NULL;
+}
+#endif /* COFFEE_NAME_INDEX_SIZE */
+/*---------------------------------------------------------------------------*/
 static struct file *
 find_file(const char *name)
 {
   int i;
   struct file_header hdr;
   coffee_page_t page;
+#if COFFEE_NAME_INDEX_SIZE
+  struct file *file;
+#endif /* COFFEE_NAME_INDEX_SIZE */
 
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
@@ -471,6 +703,28 @@ find_file(const char *name)
     }
   }
 
+#if COFFEE_NAME_INDEX_SIZE
+  if(name_index_state == NAME_INDEX_VALID) {
+    return name_index_find(name);
+  }
+
+  if(name_index_state == NAME_INDEX_UNKNOWN) {
+    /* Build the index by scanning all of the flash memory once. */
+    file = NULL;
+    name_index_state = NAME_INDEX_VALID;
+    for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+      read_header(&hdr, page);
+      if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+        name_index_add(hdr.name, page);
+        if(file == NULL && strcmp(name, hdr.name) == 0) {
+          file = load_file(page, &hdr);
+        }
+      }
+    }
+    return file;
+  }
+#endif /* COFFEE_NAME_INDEX_SIZE */
+
   /* Scan the flash memory sequentially otherwise. */
   for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
     read_header(&hdr, page);
@@ -570,11 +824,36 @@ remove_by_page(coffee_page_t page, int remove_log,
     }
   }
 
+#if COFFEE_LOG_CACHE_SIZE
+  /* Cached records of the removed file are dropped. */
+  for(i = 0; i < COFFEE_LOG_CACHE_SIZE; i++) {
+    if(log_cache[i].file != NULL && log_cache[i].file->page == page) {
+      log_cache[i].file = NULL;
+    }
+  }
+#endif /* COFFEE_LOG_CACHE_SIZE */
+
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
 
   gc_wait = 0;
 
+#if COFFEE_NAME_INDEX_SIZE
+  name_index_remove(page);
+#endif /* COFFEE_NAME_INDEX_SIZE */
+
+#if COFFEE_BACKGROUND_GC
+  if(obsolete_pages < COFFEE_BACKGROUND_GC_THRESHOLD) {
+    obsolete_pages += hdr.max_pages;
+  }
+  if(obsolete_pages >= COFFEE_BACKGROUND_GC_THRESHOLD) {
+    if(!process_is_running(&coffee_gc_process)) {
+      process_start(&coffee_gc_process, NULL);
+    }
+    process_poll(&coffee_gc_process);
+  }
+#endif /* COFFEE_BACKGROUND_GC */
+
   /* Close all file descriptors that reference the removed file. */
   if(close_fds) {
     for(i = 0; i < COFFEE_FD_SET_SIZE; i++) {
@@ -637,6 +916,12 @@ reserve(const char *name, coffee_page_t pages,
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
 
+#if COFFEE_NAME_INDEX_SIZE
+  if(name_index_state != NAME_INDEX_UNKNOWN && !HDR_LOG(hdr)) {
+    name_index_add(hdr.name, page);
+  }
+#endif /* COFFEE_NAME_INDEX_SIZE */
+
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          (unsigned)pages, (unsigned)page, name);
 
@@ -787,6 +1072,10 @@ merge_log(coffee_page_t file_page, int extend)
   struct file *new_file;
   int i;
 
+#if COFFEE_LOG_CACHE_SIZE
+  log_cache_flush(file_page);
+#endif /* COFFEE_LOG_CACHE_SIZE */
+
   read_header(&hdr, file_page);
 
   fd = cfs_open(hdr.name, CFS_READ);
@@ -887,6 +1176,104 @@ find_next_record(struct file *file, coffee_page_t log_page,
 #endif /* COFFEE_MICRO_LOGS */
 /*---------------------------------------------------------------------------*/
 #if COFFEE_MICRO_LOGS
+static void
+write_log_record(struct file *file, coffee_page_t log_page,
+                 int16_t log_record, uint16_t log_records,
+                 uint16_t log_record_size, uint16_t region, const char *buf)
+{
+  cfs_offset_t offset;
+
+  /*
+   * Write the region number in the region index table.
+   * The region number is incremented to avoid values of zero.
+   */
+  offset = absolute_offset(log_page, 0);
+  ++region;
+  COFFEE_WRITE(&region, sizeof(region),
+               offset + log_record * sizeof(region));
+
+  offset += log_records * sizeof(region);
+  COFFEE_WRITE(buf, log_record_size,
+               offset + log_record * log_record_size);
+  file->record_count = log_record + 1;
+}
+#endif /* COFFEE_MICRO_LOGS */
+/*---------------------------------------------------------------------------*/
+#if COFFEE_LOG_CACHE_SIZE
+static void
+log_cache_write(struct log_cache_entry *entry)
+{
+  struct file_header hdr;
+  struct file *file;
+  uint16_t log_record_size, log_records;
+  int16_t log_record;
+
+  /*
+   * A record is cached only if the log has room for all cached records
+   * of the file, so this does not have to merge the log.
+   */
+  file = entry->file;
+  entry->file = NULL;
+  read_header(&hdr, file->page);
+  adjust_log_config(&hdr, &log_record_size, &log_records);
+  log_record = find_next_record(file, hdr.log_page, log_records);
+  write_log_record(file, hdr.log_page, log_record, log_records,
+                   log_record_size, entry->region, entry->data);
+}
+/*---------------------------------------------------------------------------*/
+static void
+log_cache_flush(coffee_page_t page)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_LOG_CACHE_SIZE; i++) {
+    if(log_cache[i].file != NULL &&
+       (page == INVALID_PAGE || log_cache[i].file->page == page)) {
+      log_cache_write(&log_cache[i]);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct log_cache_entry *
+log_cache_find(struct file *file, uint16_t region, int *count)
+{
+  struct log_cache_entry *entry;
+  int i;
+
+  entry = NULL;
+  *count = 0;
+  for(i = 0; i < COFFEE_LOG_CACHE_SIZE; i++) {
+    if(log_cache[i].file == file) {
+      (*count)++;
+      if(log_cache[i].region == region) {
+        entry = &log_cache[i];
+      }
+    }
+  }
+  return entry;
+}
+/*---------------------------------------------------------------------------*/
+static struct log_cache_entry *
+log_cache_alloc(void)
+{
+  struct log_cache_entry *entry;
+  int i;
+
+  for(i = 0; i < COFFEE_LOG_CACHE_SIZE; i++) {
+    if(log_cache[i].file == NULL) {
+      return &log_cache[i];
+    }
+  }
+
+  /* Make room by writing one of the cached records. */
+  entry = &log_cache[log_cache_victim];
+  log_cache_victim = (log_cache_victim + 1) % COFFEE_LOG_CACHE_SIZE;
+  log_cache_write(entry);
+  return entry;
+}
+#endif /* COFFEE_LOG_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
+#if COFFEE_MICRO_LOGS
 static int
 write_log_page(struct file *file, struct log_param *lp)
 {
@@ -898,6 +1285,10 @@ write_log_page(struct file *file, struct log_param *lp)
   uint16_t log_records;
   cfs_offset_t offset;
   struct log_param lp_out;
+#if COFFEE_LOG_CACHE_SIZE
+  struct log_cache_entry *entry;
+  int cached;
+#endif /* COFFEE_LOG_CACHE_SIZE */
 
   read_header(&hdr, file->page);
 
@@ -926,6 +1317,39 @@ write_log_page(struct file *file, struct log_param *lp)
     log_record = 0;
   }
 
+#if COFFEE_LOG_CACHE_SIZE
+  entry = log_cache_find(file, region, &cached);
+  if(entry == NULL && cached < log_records - log_record) {
+    entry = log_cache_alloc();
+    entry->file = file;
+    entry->region = region;
+
+    /* The record may have been written to make room in the cache. */
+    log_record = find_next_record(file, log_page, log_records);
+    lp_out.offset = region * log_record_size;
+    lp_out.buf = entry->data;
+    lp_out.size = log_record_size;
+    if((lp->offset > 0 || lp->size != log_record_size) &&
+       read_log_page(&hdr, log_record, &lp_out) < 0) {
+      COFFEE_READ(entry->data, log_record_size,
+                  absolute_offset(file->page, region * log_record_size));
+    }
+  }
+
+  if(entry != NULL) {
+    memcpy(&entry->data[lp->offset], lp->buf, lp->size);
+    return lp->size;
+  }
+
+  /* The log is too full to cache another record of this file. */
+  log_cache_flush(file->page);
+  log_record = find_next_record(file, log_page, log_records);
+  if(log_record >= log_records) {
+    PRINTF("Coffee: Merging the file %s with its log\n", hdr.name);
+    return merge_log(file->page, 0);
+  }
+#endif /* COFFEE_LOG_CACHE_SIZE */
+
   {
     char copy_buf[log_record_size];
 
@@ -941,19 +1365,8 @@ write_log_page(struct file *file, struct log_param *lp)
 
     memcpy(&copy_buf[lp->offset], lp->buf, lp->size);
 
-    /*
-     * Write the region number in the region index table.
-     * The region number is incremented to avoid values of zero.
-     */
-    offset = absolute_offset(log_page, 0);
-    ++region;
-    COFFEE_WRITE(&region, sizeof(region),
-                 offset + log_record * sizeof(region));
-
-    offset += log_records * sizeof(region);
-    COFFEE_WRITE(copy_buf, sizeof(copy_buf),
-                 offset + log_record * log_record_size);
-    file->record_count = log_record + 1;
+    write_log_record(file, log_page, log_record, log_records,
+                     log_record_size, region, copy_buf);
   }
 
   return lp->size;
@@ -1014,6 +1427,9 @@ void
 cfs_close(int fd)
 {
   if(FD_VALID(fd)) {
+#if COFFEE_LOG_CACHE_SIZE
+    log_cache_flush(coffee_fd_set[fd].file->page);
+#endif /* COFFEE_LOG_CACHE_SIZE */
     coffee_fd_set[fd].flags = COFFEE_FD_FREE;
     coffee_fd_set[fd].file->references--;
     coffee_fd_set[fd].file = NULL;
@@ -1086,6 +1502,9 @@ cfs_read(int fd, void *buf, unsigned size)
   struct log_param lp;
   unsigned bytes_left;
   int r;
+  char *extent_buf;
+  cfs_offset_t extent_offset;
+  unsigned extent_size;
 #endif
 
   if(!(FD_VALID(fd) && FD_READABLE(fd))) {
@@ -1094,6 +1513,10 @@ cfs_read(int fd, void *buf, unsigned size)
 
   fdp = &coffee_fd_set[fd];
   file = fdp->file;
+
+#if COFFEE_LOG_CACHE_SIZE
+  log_cache_flush(file->page);
+#endif /* COFFEE_LOG_CACHE_SIZE */
   
   if(fdp->io_flags & CFS_COFFEE_IO_ENSURE_READ_LENGTH) {
     while(fdp->offset + size > file->end) {
@@ -1116,22 +1539,38 @@ cfs_read(int fd, void *buf, unsigned size)
   /*
    * Copy the contents of the most recent log record. If there is
    * no log record for the file area to read from, we simply read
-   * from the original file extent.
+   * from the original file extent. Consecutive areas without log
+   * records are read from the extent with a single transfer.
    */
+  extent_buf = buf;
+  extent_offset = fdp->offset;
+  extent_size = 0;
   for(bytes_left = size; bytes_left > 0; bytes_left -= r) {
     lp.offset = fdp->offset;
     lp.buf = buf;
     lp.size = bytes_left;
     r = read_log_page(&hdr, file->record_count, &lp);
 
-    /* Read from the original file if we cannot find the data in the log. */
     if(r < 0) {
-      COFFEE_READ(buf, lp.size, absolute_offset(file->page, fdp->offset));
+      /* Read from the original file if we cannot find the data in the log. */
+      if(extent_size == 0) {
+        extent_buf = buf;
+        extent_offset = fdp->offset;
+      }
       r = lp.size;
+      extent_size += r;
+    } else if(extent_size > 0) {
+      COFFEE_READ(extent_buf, extent_size,
+                  absolute_offset(file->page, extent_offset));
+      extent_size = 0;
     }
     fdp->offset += r;
     buf = (char *)buf + r;
   }
+  if(extent_size > 0) {
+    COFFEE_READ(extent_buf, extent_size,
+                absolute_offset(file->page, extent_offset));
+  }
 #endif /* COFFEE_MICRO_LOGS */
 
   return size;
@@ -1322,6 +1761,20 @@ cfs_coffee_set_io_semantics(int fd, unsigned flags)
 }
 /*---------------------------------------------------------------------------*/
 int
+cfs_coffee_sync(int fd)
+{
+  if(!FD_VALID(fd)) {
+    return -1;
+  }
+
+#if COFFEE_LOG_CACHE_SIZE
+  log_cache_flush(coffee_fd_set[fd].file->page);
+#endif /* COFFEE_LOG_CACHE_SIZE */
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
 cfs_coffee_format(void)
 {
   coffee_page_t i;
@@ -1336,8 +1789,17 @@ cfs_coffee_format(void)
   /* Formatting invalidates the file information. */
   memset(&coffee_files, 0, sizeof(coffee_files));
   memset(&coffee_fd_set, 0, sizeof(coffee_fd_set));
+#if COFFEE_LOG_CACHE_SIZE
+  memset(&log_cache, 0, sizeof(log_cache));
+#endif /* COFFEE_LOG_CACHE_SIZE */
   next_free = 0;
   gc_wait = 1;
+#if COFFEE_NAME_INDEX_SIZE
+  name_index_reset();
+#endif /* COFFEE_NAME_INDEX_SIZE */
+#if COFFEE_BACKGROUND_GC
+  obsolete_pages = 0;
+#endif /* COFFEE_BACKGROUND_GC */
 
   PRINTF(" done!\n");
 
@@ -125,6 +125,17 @@ int cfs_coffee_configure_log(const char *file, unsigned log_size,
  */
 int cfs_coffee_set_io_semantics(int fd, unsigned flags);
 
+/**
+ * \brief Write the cached log records of a file to the storage.
+ * \param fd The file descriptor of the file.
+ * \return 0 on success, -1 on failure.
+ *
+ * When COFFEE_LOG_CACHE_SIZE is set, modifications of files with
+ * micro logs are kept in RAM until the file is closed or more room
+ * is needed. This function writes them to the storage immediately.
+ */
+int cfs_coffee_sync(int fd);
+
 /**
  * \brief Format the storage area assigned to Coffee.
  * \return 0 on success, -1 on failure.
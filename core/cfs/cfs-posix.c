@@ -43,11 +43,235 @@
 #define CFS_IMPL 1
 #include "cfs/cfs.h"
 
+/*
+ * With CFS_POSIX_CONF_BUFFERED, writes are collected in a buffer per file
+ * and reach the file system when the buffer is full, or before any other
+ * CFS call could observe them. Files opened for reading only are mapped
+ * into memory, so reads are copies rather than system calls.
+ * CFS_POSIX_CONF_SYNC selects when written data is forced to disk: never
+ * (0), when the file is closed (1) or every time a buffer is written out
+ * (2).
+ */
+#ifdef CFS_POSIX_CONF_BUFFERED
+#define CFS_POSIX_BUFFERED CFS_POSIX_CONF_BUFFERED
+#else
+#define CFS_POSIX_BUFFERED 0
+#endif
+
+#if CFS_POSIX_BUFFERED
+#include <string.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef CFS_POSIX_CONF_WRITE_BUFFER_SIZE
+#define CFS_POSIX_WRITE_BUFFER_SIZE CFS_POSIX_CONF_WRITE_BUFFER_SIZE
+#else
+#define CFS_POSIX_WRITE_BUFFER_SIZE 4096
+#endif
+
+/* Files beyond this number fall back to unbuffered access */
+#ifdef CFS_POSIX_CONF_MAX_FILES
+#define CFS_POSIX_MAX_FILES CFS_POSIX_CONF_MAX_FILES
+#else
+#define CFS_POSIX_MAX_FILES 16
+#endif
+
+#define CFS_POSIX_SYNC_NEVER 0
+#define CFS_POSIX_SYNC_CLOSE 1
+#define CFS_POSIX_SYNC_FLUSH 2
+
+#ifdef CFS_POSIX_CONF_SYNC
+#define CFS_POSIX_SYNC CFS_POSIX_CONF_SYNC
+#else
+#define CFS_POSIX_SYNC CFS_POSIX_SYNC_NEVER
+#endif
+
+struct file {
+  unsigned char used;
+  unsigned char written;
+  int fd;
+  /* Read-only files */
+  unsigned char *map;
+  size_t map_size;
+  off_t offset;
+  dev_t dev;
+  ino_t ino;
+  /* Writable files */
+  unsigned int pending;
+  unsigned char buf[CFS_POSIX_WRITE_BUFFER_SIZE];
+};
+
+static struct file files[CFS_POSIX_MAX_FILES];
+static unsigned char exit_flush_registered;
+#endif /* CFS_POSIX_BUFFERED */
+
+#if CFS_POSIX_BUFFERED
+/*---------------------------------------------------------------------------*/
+static struct file *
+find(int fd)
+{
+  int i;
+
+  for(i = 0; i < CFS_POSIX_MAX_FILES; i++) {
+    if(files[i].used && files[i].fd == fd) {
+      return &files[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+flush(struct file *file)
+{
+  unsigned int done;
+  int r;
+
+  for(done = 0; done < file->pending; done += r) {
+    r = write(file->fd, file->buf + done, file->pending - done);
+    if(r <= 0) {
+      /* Keep what could not be written, so that a later flush retries */
+      memmove(file->buf, file->buf + done, file->pending - done);
+      file->pending -= done;
+      return -1;
+    }
+  }
+  file->pending = 0;
+#if CFS_POSIX_SYNC == CFS_POSIX_SYNC_FLUSH
+  fsync(file->fd);
+#endif
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+flush_all(void)
+{
+  int i;
+
+  for(i = 0; i < CFS_POSIX_MAX_FILES; i++) {
+    if(files[i].used && files[i].pending > 0) {
+      flush(&files[i]);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct file *
+allocate(int fd)
+{
+  int i;
+
+  for(i = 0; i < CFS_POSIX_MAX_FILES; i++) {
+    if(!files[i].used) {
+      files[i].used = 1;
+      files[i].written = 0;
+      files[i].fd = fd;
+      files[i].map = NULL;
+      files[i].map_size = 0;
+      files[i].offset = 0;
+      files[i].pending = 0;
+      if(!exit_flush_registered) {
+        /* Files that are never closed still get their data */
+        atexit(flush_all);
+        exit_flush_registered = 1;
+      }
+      return &files[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+map(struct file *file)
+{
+  struct stat st;
+  void *m;
+
+  if(fstat(file->fd, &st) < 0 || st.st_size == 0) {
+    return -1;
+  }
+  m = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, file->fd, 0);
+  if(m == MAP_FAILED) {
+    return -1;
+  }
+  if(file->map != NULL) {
+    munmap(file->map, file->map_size);
+  }
+  file->map = m;
+  file->map_size = st.st_size;
+  file->dev = st.st_dev;
+  file->ino = st.st_ino;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+unmap(struct file *file)
+{
+  munmap(file->map, file->map_size);
+  file->map = NULL;
+  /* Plain reads continue where the mapped ones stopped */
+  lseek(file->fd, file->offset, SEEK_SET);
+}
+/*---------------------------------------------------------------------------*/
+static void
+unmap_truncated(const char *name)
+{
+  struct stat st;
+  int i;
+
+  /* Touching a mapping beyond the end of a truncated file is fatal, so
+     readers of the file go back to plain reads. */
+  if(stat(name, &st) < 0) {
+    return;
+  }
+  for(i = 0; i < CFS_POSIX_MAX_FILES; i++) {
+    if(files[i].used && files[i].map != NULL &&
+       files[i].dev == st.st_dev && files[i].ino == st.st_ino) {
+      unmap(&files[i]);
+    }
+  }
+}
+#endif /* CFS_POSIX_BUFFERED */
 /*---------------------------------------------------------------------------*/
 int
 cfs_open(const char *n, int f)
 {
   int s = 0;
+#if CFS_POSIX_BUFFERED
+  struct file *file;
+  int fd;
+
+  flush_all();
+  if(f == CFS_READ) {
+    fd = open(n, O_RDONLY);
+    if(fd >= 0) {
+      file = allocate(fd);
+      if(file != NULL) {
+        /* Files that are empty for now are read the plain way */
+        map(file);
+      }
+    }
+    return fd;
+  } else if(f & CFS_WRITE) {
+    s = O_CREAT;
+    if(f & CFS_READ) {
+      s |= O_RDWR;
+    } else {
+      s |= O_WRONLY;
+    }
+    if(f & CFS_APPEND) {
+      s |= O_APPEND;
+    } else {
+      s |= O_TRUNC;
+      unmap_truncated(n);
+    }
+    fd = open(n, s, 0600);
+    if(fd >= 0) {
+      allocate(fd);
+    }
+    return fd;
+  }
+  return -1;
+#else /* CFS_POSIX_BUFFERED */
   if(f == CFS_READ) {
     return open(n, O_RDONLY);
   } else if(f & CFS_WRITE) {
@@ -65,29 +289,113 @@ cfs_open(const char *n, int f)
     return open(n, s, 0600);
   }
   return -1;
+#endif /* CFS_POSIX_BUFFERED */
 }
 /*---------------------------------------------------------------------------*/
 void
 cfs_close(int f)
 {
+#if CFS_POSIX_BUFFERED
+  struct file *file;
+
+  file = find(f);
+  if(file != NULL) {
+    flush(file);
+#if CFS_POSIX_SYNC == CFS_POSIX_SYNC_CLOSE
+    if(file->written) {
+      fsync(f);
+    }
+#endif
+    if(file->map != NULL) {
+      munmap(file->map, file->map_size);
+    }
+    file->used = 0;
+  }
+#endif /* CFS_POSIX_BUFFERED */
   close(f);
 }
 /*---------------------------------------------------------------------------*/
 int
 cfs_read(int f, void *b, unsigned int l)
 {
+#if CFS_POSIX_BUFFERED
+  struct file *file;
+
+  /* The data may be waiting in the buffer of this or another file */
+  flush_all();
+
+  file = find(f);
+  if(file != NULL && file->map != NULL) {
+    if(file->offset + l > file->map_size) {
+      /* The file may have grown since it was mapped */
+      map(file);
+    }
+    if(file->offset >= file->map_size) {
+      return 0;
+    }
+    if(l > file->map_size - file->offset) {
+      l = file->map_size - file->offset;
+    }
+    memcpy(b, file->map + file->offset, l);
+    file->offset += l;
+    return l;
+  }
+#endif /* CFS_POSIX_BUFFERED */
   return read(f, b, l);
 }
 /*---------------------------------------------------------------------------*/
 int
 cfs_write(int f, const void *b, unsigned int l)
 {
+#if CFS_POSIX_BUFFERED
+  struct file *file;
+
+  file = find(f);
+  if(file != NULL && file->map == NULL) {
+    if(file->pending + l > CFS_POSIX_WRITE_BUFFER_SIZE &&
+       flush(file) < 0) {
+      return -1;
+    }
+    file->written = 1;
+    if(l < CFS_POSIX_WRITE_BUFFER_SIZE) {
+      memcpy(file->buf + file->pending, b, l);
+      file->pending += l;
+      return l;
+    }
+  }
+#endif /* CFS_POSIX_BUFFERED */
   return write(f, b, l);
 }
 /*---------------------------------------------------------------------------*/
 cfs_offset_t
 cfs_seek(int f, cfs_offset_t o, int w)
 {
+#if CFS_POSIX_BUFFERED
+  struct file *file;
+  struct stat st;
+  off_t offset;
+
+  flush_all();
+
+  file = find(f);
+  if(file != NULL && file->map != NULL) {
+    if(w == CFS_SEEK_SET) {
+      offset = o;
+    } else if(w == CFS_SEEK_CUR) {
+      offset = file->offset + o;
+    } else if(w == CFS_SEEK_END && fstat(f, &st) == 0) {
+      offset = st.st_size + o;
+    } else {
+      return (cfs_offset_t)-1;
+    }
+    if(offset < 0) {
+      return (cfs_offset_t)-1;
+    }
+    file->offset = offset;
+    return offset;
+  }
+#endif /* CFS_POSIX_BUFFERED */
+
   if(w == CFS_SEEK_SET) {
     w = SEEK_SET;
   } else if(w == CFS_SEEK_CUR) {
@@ -213,9 +213,12 @@
    we never receive any DIO from them. This may happen if the link from the
    neighbor to us is weak, if DIO transmissions are suppressed (Trickle
    timer) or if the neighbor chooses not to transmit DIOs because it is
-   a leaf node or for any reason. */
+   a leaf node or for any reason.
+   With UIP_CONF_ND6_ARO (RFC 6775 address registration) it is enabled with
+   RPL as well: registrations replace DAD and most of the NUD traffic. */
 #ifndef UIP_CONF_ND6_SEND_NS
-#define UIP_CONF_ND6_SEND_NS (NETSTACK_CONF_WITH_IPV6 && !UIP_CONF_IPV6_RPL)
+#define UIP_CONF_ND6_SEND_NS (NETSTACK_CONF_WITH_IPV6 && \
+                              (!UIP_CONF_IPV6_RPL || UIP_CONF_ND6_ARO))
 #endif /* UIP_CONF_ND6_SEND_NS */
 /* UIP_CONF_ND6_SEND_NA allows to still comply with NDP even if the host does
    not perform NUD or DAD processes. By default it is activated so the host
@@ -241,7 +244,12 @@
 /* SICSLOWPAN_CONF_MAC_MAX_PAYLOAD is the maximum available size for
    frame headers, link layer security-related overhead,  as well as
    6LoWPAN payload. By default, SICSLOWPAN_CONF_MAC_MAX_PAYLOAD is
-   127 bytes (MTU of 802.15.4) - 2 bytes (Footer of 802.15.4). */
+   127 bytes (MTU of 802.15.4) - 2 bytes (Footer of 802.15.4).
+   Radios with 802.15.4g frames can set it up to 2047 - FCS length, so
+   that an IPv6 packet of 1280 bytes is sent in one frame; the packetbuf
+   then grows along unless PACKETBUF_CONF_SIZE is set. With
+   SICSLOWPAN_CONF_NBR_MTU, frames above 127 bytes are only sent to
+   neighbors known to receive them. */
 #ifndef SICSLOWPAN_CONF_MAC_MAX_PAYLOAD
 #define SICSLOWPAN_CONF_MAC_MAX_PAYLOAD (127 - 2)
 #endif /* SICSLOWPAN_CONF_MAC_MAX_PAYLOAD */
@@ -84,11 +84,14 @@ static unsigned char maxnitems;
 #define REDRAW_WIDGETS      4
 #define REDRAW_MENUS        8
 #define REDRAW_MENUPART     16
+#define REDRAW_REGION       32
 
-#define MAX_REDRAWWIDGETS 4
+#define MAX_REDRAWWIDGETS CTK_CONF_MAX_REDRAWWIDGETS
 static unsigned char redraw;
 static struct ctk_widget *redraw_widgets[MAX_REDRAWWIDGETS];
 static unsigned char redraw_widgetptr;
+/* The screen rows to be redrawn with REDRAW_REGION */
+static unsigned char redraw_y1, redraw_y2;
 
 #if CTK_CONF_ICONS
 static unsigned char iconx, icony;
@@ -238,6 +241,53 @@ arrange_icons(void)
   }
 }
 #endif /* CTK_CONF_ICONS */
+#if CTK_CONF_WINDOWS || CTK_CONF_MENUS
+/*---------------------------------------------------------------------------*/
+/**
+ * \internal Adds screen rows to the region that should be redrawn.
+ *
+ * \param y1 The first row to be redrawn.
+ * \param y2 The row after the last row to be redrawn.
+ */
+/*---------------------------------------------------------------------------*/
+static void
+add_redrawrows(unsigned char y1, unsigned char y2)
+{
+  if(y2 > height) {
+    y2 = height;
+  }
+  if(!(redraw & REDRAW_REGION)) {
+    redraw |= REDRAW_REGION;
+    redraw_y1 = y1;
+    redraw_y2 = y2;
+  } else {
+    if(y1 < redraw_y1) {
+      redraw_y1 = y1;
+    }
+    if(y2 > redraw_y2) {
+      redraw_y2 = y2;
+    }
+  }
+}
+#endif /* CTK_CONF_WINDOWS || CTK_CONF_MENUS */
+#if CTK_CONF_WINDOWS
+/*---------------------------------------------------------------------------*/
+/**
+ * \internal Adds the screen rows covered by a window, including its
+ * title bar and border, to the region that should be redrawn.
+ *
+ * \param y The y position of the window.
+ * \param h The height of the window.
+ */
+/*---------------------------------------------------------------------------*/
+static void
+add_redrawwindow(unsigned char y, unsigned char h)
+{
+  add_redrawrows(y + CTK_CONF_MENUS,
+		 y + CTK_CONF_MENUS + ctk_draw_windowtitle_height + h +
+		 ctk_draw_windowborder_height);
+}
+#endif /* CTK_CONF_WINDOWS */
 /*---------------------------------------------------------------------------*/
 void
 ctk_restore(void)
@@ -332,8 +382,10 @@ ctk_dialog_open(struct ctk_window *d)
 void
 ctk_dialog_close(void)
 {
+  if(dialog != NULL) {
+    add_redrawwindow(dialog->y, dialog->h);
+  }
   dialog = NULL;
-  redraw |= REDRAW_ALL;
 }
 #endif /* CTK_CONF_WINDOWS */
 /*---------------------------------------------------------------------------*/
@@ -348,6 +400,12 @@ ctk_window_open(CC_REGISTER_ARG struct ctk_window *w)
 {
 #if CTK_CONF_WINDOWS
   struct ctk_window *w2;
+
+  /* The window that loses focus is drawn differently. */
+  if(windows != NULL) {
+    add_redrawwindow(windows->y, windows->h);
+  }
+  add_redrawwindow(w->y, w->h);
   
   /* Check if already open. */
   for(w2 = windows; w2 != w && w2 != NULL; w2 = w2->next);
@@ -378,14 +436,13 @@ ctk_window_open(CC_REGISTER_ARG struct ctk_window *w)
   }
 #else /* CTK_CONF_WINDOWS */
   window = w;
+  redraw |= REDRAW_ALL;
 #endif /* CTK_CONF_WINDOWS */
 
 #if CTK_CONF_MENUS
   /* Recreate the Desktop menu's window entries.*/
   make_desktopmenu();
 #endif /* CTK_CONF_MENUS */
-
-  redraw |= REDRAW_ALL;
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -436,7 +493,12 @@ ctk_window_close(struct ctk_window *w)
   /* Recreate the Desktop menu's window entries.*/
   make_desktopmenu();
 #endif /* CTK_CONF_MENUS */
-  redraw |= REDRAW_ALL;
+
+  /* Redraw what the window covered, and the window that gets focus. */
+  add_redrawwindow(w->y, w->h);
+  if(windows != NULL) {
+    add_redrawwindow(windows->y, windows->h);
+  }
 #endif /* CTK_CONF_WINDOWCLOSE */
 }
 #if CTK_CONF_WINDOWS
@@ -656,6 +718,21 @@ ctk_window_redraw(struct ctk_window *w)
   if(mode != CTK_MODE_NORMAL) {
     return;
   }
+
+  /* Requests from applications are batched until the CTK process
+     runs, so that a window is redrawn once however many times it
+     changed in between. */
+  if(PROCESS_CURRENT() != &ctk_process) {
+#if CTK_CONF_WINDOWS
+    if(w == dialog || (dialog == NULL && w == windows))
+#else /* CTK_CONF_WINDOWS */
+    if(w == window)
+#endif /* CTK_CONF_WINDOWS */
+    {
+      redraw |= REDRAW_FOCUS;
+    }
+    return;
+  }
   
 #if CTK_CONF_WINDOWS
   if(w == dialog) {
@@ -1136,13 +1213,14 @@ activate(CC_REGISTER_ARG struct ctk_widget *w)
     if(w == (struct ctk_widget *)&windows->closebutton) {
       process_post(w->window->owner, ctk_signal_window_close, windows);
       ctk_window_close(windows);
-      return REDRAW_ALL;
+      return REDRAW_REGION;
     } else
 #endif /* CTK_CONF_WINDOWCLOSE */
 #if CTK_CONF_WINDOWMOVE
     if(w == (struct ctk_widget *)&windows->titlebutton) {
       mode = CTK_MODE_WINDOWMOVE;
-      return REDRAW_ALL;
+      add_redrawwindow(windows->y, windows->h);
+      return REDRAW_REGION;
     } else
 #endif /* CTK_CONF_WINDOWMOVE */
     {
@@ -1283,7 +1361,7 @@ activate_menu(void)
       if(w->title == desktopmenu.items[desktopmenu.active].title) {
 	ctk_window_open(w);
 	menus.open = NULL;
-	return REDRAW_ALL;
+	return REDRAW_MENUPART | REDRAW_REGION;
       }
     }
   } else {
@@ -1366,6 +1444,9 @@ PROCESS_THREAD(ctk_process, ev, data)
 {
   static ctk_arch_key_t c;
   static unsigned char i;
+#if CTK_CONF_WINDOWMOVE
+  static unsigned char movex, movey;
+#endif /* CTK_CONF_WINDOWMOVE */
 #if CTK_CONF_WINDOWS
   register struct ctk_window *window;
 #endif /* CTK_CONF_WINDOWS */
@@ -1628,7 +1709,6 @@ PROCESS_THREAD(ctk_process, ev, data)
 		   mouse_clicked) {
 		  /* Bring window to front. */
 		  ctk_window_open(window);
-		  redraw |= REDRAW_ALL;
 		} else {
 
 		  /* Find out which widget currently is under the mouse
@@ -1811,6 +1891,8 @@ PROCESS_THREAD(ctk_process, ev, data)
 	redraw = 0;
 
 	window = windows;
+	movex = window->x;
+	movey = window->y;
 
 #if CTK_CONF_MOUSE_SUPPORT
 
@@ -1835,8 +1917,6 @@ PROCESS_THREAD(ctk_process, ev, data)
 	    --window->y;
 	  }
 #endif /* CTK_CONF_MENUS */
-
-	  redraw = REDRAW_ALL;
 	}
     
 	/* Check if the mouse has been clicked, and stop moving the window
@@ -1844,7 +1924,6 @@ PROCESS_THREAD(ctk_process, ev, data)
 	if(mouse_button_changed &&
 	   mouse_button == 0) {
 	  mode = CTK_MODE_NORMAL;
-	  redraw = REDRAW_ALL;
 	}
 #endif /* CTK_CONF_MOUSE_SUPPORT */
     
@@ -1862,45 +1941,58 @@ PROCESS_THREAD(ctk_process, ev, data)
 	    if(window->x + window->w + 1 >= width) {
 	      --window->x;
 	    }
-	    redraw = REDRAW_ALL;
 	    break;
 	  case CH_CURS_LEFT:
 	    if(window->x > 0) {
 	      --window->x;
 	    }
-	    redraw = REDRAW_ALL;
 	    break;
 	  case CH_CURS_DOWN:
 	    ++window->y;
 	    if(window->y + window->h + 1 + CTK_CONF_MENUS >= height) {
 	      --window->y;
 	    }
-	    redraw = REDRAW_ALL;
 	    break;
 	  case CH_CURS_UP:
 	    if(window->y > 0) {
 	      --window->y;
 	    }
-	    redraw = REDRAW_ALL;
 	    break;
 	  default:
 	    mode = CTK_MODE_NORMAL;
-	    redraw = REDRAW_ALL;
 	    break;
 	  }
 	}
+
+	/* Redraw the rows that the window left and those it moved to,
+	   or the window alone when it stops moving. */
+	if(window->x != movex || window->y != movey ||
+	   mode != CTK_MODE_WINDOWMOVE) {
+	  add_redrawwindow(movey, window->h);
+	  add_redrawwindow(window->y, window->h);
+	}
 #endif /* CTK_CONF_WINDOWMOVE */
       }
 
     if(redraw & REDRAW_ALL) {
       do_redraw_all(CTK_CONF_MENUS, height);
+      redraw = 0;
+    } else if(redraw & (REDRAW_REGION | REDRAW_MENUPART)) {
+#if CTK_CONF_MENUS
+      if(redraw & REDRAW_MENUPART) {
+	add_redrawrows(CTK_CONF_MENUS, maxnitems + 1);
+      }
+#endif /* CTK_CONF_MENUS */
+      do_redraw_all(redraw_y1, redraw_y2);
+      /* The foremost window may extend beyond the redrawn rows. */
+      redraw &= REDRAW_FOCUS | REDRAW_WIDGETS;
 #if CTK_CONF_MENUS
-    } else if(redraw & REDRAW_MENUPART) {
-      do_redraw_all(CTK_CONF_MENUS, maxnitems + 1);
     } else if(redraw & REDRAW_MENUS) {
       ctk_draw_menus(&menus);
 #endif /* CTK_CONF_MENUS */
-    } else if(redraw & REDRAW_FOCUS) {
+    }
+
+    if(redraw & REDRAW_FOCUS) {
 #if CTK_CONF_WINDOWS
       if(dialog != NULL) {
 	ctk_window_redraw(dialog);
@@ -165,11 +165,28 @@ enum {
    */
   RADIO_PARAM_64BIT_ADDR,
 
-  /* Last packet timestamp, of type rtimer_clock_t.
-   * Because this parameter value mat be larger than what fits in radio_value_t,
+  /* Last packet timestamp, of type rtimer_clock_t. This is the rtimer
+   * time at which the SFD of the last received packet was detected,
+   * captured in hardware where the radio allows it, so that it does not
+   * depend on interrupt latency.
+   * Because this parameter value may be larger than what fits in radio_value_t,
    * it needs to be used with radio.get_object()/set_object(). */
   RADIO_PARAM_LAST_PACKET_TIMESTAMP,
 
+  /*
+   * Source address match table, used by RADIO_RX_MODE_AUTOPEND. The
+   * address is either a short address (2 bytes), which is matched
+   * together with RADIO_PARAM_PAN_ID, or a long address (8 bytes), in
+   * the byte order of linkaddr_t. Setting RADIO_PARAM_SRC_MATCH_ADD
+   * returns RADIO_RESULT_ERROR when the table is full. Setting
+   * RADIO_PARAM_SRC_MATCH_REMOVE to a NULL address of size 0 clears the
+   * table.
+   *
+   * These parameters are used with radio.set_object().
+   */
+  RADIO_PARAM_SRC_MATCH_ADD,
+  RADIO_PARAM_SRC_MATCH_REMOVE,
+
   /* Constants (read only) */
 
   /* The lowest radio channel. */
@@ -180,7 +197,12 @@ enum {
   /* The minimum transmission power in dBm. */
   RADIO_CONST_TXPOWER_MIN,
   /* The maximum transmission power in dBm. */
-  RADIO_CONST_TXPOWER_MAX
+  RADIO_CONST_TXPOWER_MAX,
+
+  /* Non-zero if prepare() can load the next frame while the
+   * acknowledgement of the frame transmitted last is being received,
+   * without disturbing the reception. */
+  RADIO_CONST_TX_PRELOAD
 };
 
 /* Radio power modes */
@@ -195,6 +217,10 @@ enum {
  * are supported by the radio). A single parameter is used to allow
  * setting these features simultaneously as an atomic operation.
  *
+ * With RADIO_RX_MODE_AUTOPEND, the radio sets the frame pending bit in
+ * the automatic acknowledgements of frames whose source is in the
+ * source address match table (RADIO_PARAM_SRC_MATCH_ADD).
+ *
  * To enable both address filter and transmissions of automatic
  * acknowledgments:
  *
@@ -204,6 +230,7 @@ enum {
 #define RADIO_RX_MODE_ADDRESS_FILTER   (1 << 0)
 #define RADIO_RX_MODE_AUTOACK          (1 << 1)
 #define RADIO_RX_MODE_POLL_MODE        (1 << 2)
+#define RADIO_RX_MODE_AUTOPEND         (1 << 3)
 
 /**
  * The radio transmission mode controls whether transmissions should
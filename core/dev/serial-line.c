@@ -50,6 +50,7 @@
 
 static struct ringbuf rxbuf;
 static uint8_t rxbuf_data[BUFSIZE];
+static uint8_t overflow; /* Buffer overflow: ignore until END */
 
 PROCESS(serial_line_process, "Serial driver");
 
@@ -59,8 +60,6 @@ process_event_t serial_line_event_message;
 int
 serial_line_input_byte(unsigned char c)
 {
-  static uint8_t overflow = 0; /* Buffer overflow: ignore until END */
-  
   if(IGNORE_CHAR(c)) {
     return 0;
   }
@@ -84,6 +83,40 @@ serial_line_input_byte(unsigned char c)
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+int
+serial_line_input_bytes(const unsigned char *data, int len)
+{
+  int n, put, count;
+
+  count = 0;
+  while(len > 0) {
+    if(overflow || IGNORE_CHAR(*data)) {
+      count += serial_line_input_byte(*data);
+      data++;
+      len--;
+      continue;
+    }
+
+    /* Add the characters up to the next ignored one in one go. */
+    for(n = 1; n < len && !IGNORE_CHAR(data[n]); n++);
+    put = ringbuf_put_n(&rxbuf, data, n);
+    if(put < n) {
+      /* Buffer overflow: ignore the rest of the line */
+      overflow = 1;
+      put++;
+    }
+    count += put;
+    data += put;
+    len -= put;
+  }
+
+  if(count > 0) {
+    /* Wake up consumer process */
+    process_poll(&serial_line_process);
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(serial_line_process, ev, data)
 {
   static char buf[BUFSIZE];
@@ -96,19 +129,25 @@ PROCESS_THREAD(serial_line_process, ev, data)
 
   while(1) {
     /* Fill application buffer until newline or empty */
-    int c = ringbuf_get(&rxbuf);
-    
-    if(c == -1) {
+    uint8_t *p;
+    int len, n;
+
+    len = ringbuf_peek(&rxbuf, &p);
+    if(len == 0) {
       /* Buffer empty, wait for poll */
       PROCESS_YIELD();
     } else {
-      if(c != END) {
-        if(ptr < BUFSIZE-1) {
-          buf[ptr++] = (uint8_t)c;
-        } else {
-          /* Ignore character (wait for EOL) */
-        }
+      for(n = 0; n < len && p[n] != END; n++);
+
+      /* Copy what fits, ignoring the rest until EOL. */
+      memcpy(&buf[ptr], p, MIN(n, BUFSIZE - 1 - ptr));
+      ptr += MIN(n, BUFSIZE - 1 - ptr);
+
+      if(n == len) {
+        ringbuf_consume(&rxbuf, n);
       } else {
+        ringbuf_consume(&rxbuf, n + 1);
+
         /* Terminate */
         buf[ptr++] = (uint8_t)'\0';
 
@@ -457,3 +457,40 @@ slip_input_byte(unsigned char c)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+int
+slip_input_bytes(const unsigned char *data, int len)
+{
+  uint16_t n, room;
+  int ret;
+
+  ret = 0;
+  while(len > 0) {
+#ifndef SLIP_CONF_MICROSOFT_CHAT
+    if(state == STATE_OK) {
+      /* Copy the bytes up to the next END or ESC in one go, as far as
+         there is contiguous room in rxbuf. */
+      if(begin > next_free) {
+        room = begin - next_free - 1;
+      } else {
+        room = RX_BUFSIZE - next_free - (begin == 0);
+      }
+      for(n = 0; n < len && n < room &&
+            data[n] != SLIP_END && data[n] != SLIP_ESC; n++);
+      memcpy(&rxbuf[next_free], data, n);
+      next_free += n;
+      if(next_free == RX_BUFSIZE) {
+        next_free = 0;
+      }
+      data += n;
+      len -= n;
+      if(len == 0) {
+        break;
+      }
+    }
+#endif /* !SLIP_CONF_MICROSOFT_CHAT */
+    ret |= slip_input_byte(*data++);
+    len--;
+  }
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
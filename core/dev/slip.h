@@ -62,6 +62,18 @@ uint8_t slip_send(void);
  */
 int slip_input_byte(unsigned char c);
 
+/**
+ * Input a block of bytes to the SLIP driver, as with
+ * slip_input_byte() for each byte. The function can be called from an
+ * interrupt context.
+ *
+ * \param data The data that is to be passed to the SLIP driver
+ * \param len The number of bytes
+ *
+ * \return Non-zero if the CPU should be powered up, zero otherwise.
+ */
+int slip_input_bytes(const unsigned char *data, int len);
+
 uint8_t slip_write(const void *ptr, int len);
 
 /* Did we receive any bytes lately? */
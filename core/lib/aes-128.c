@@ -64,7 +64,17 @@ static const uint8_t sbox[256] =   {
 0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
 0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16 };
 
-static uint8_t round_keys[11][AES_128_KEY_LENGTH];
+#ifdef AES_128_CONF_KEY_CACHE
+#define KEY_CACHE AES_128_CONF_KEY_CACHE
+#else /* AES_128_CONF_KEY_CACHE */
+#define KEY_CACHE 1
+#endif /* AES_128_CONF_KEY_CACHE */
+
+/* Expanded key schedules of the KEY_CACHE most recently set keys */
+static uint8_t schedules[KEY_CACHE][11][AES_128_KEY_LENGTH];
+static uint8_t valid[KEY_CACHE];
+static uint8_t next;
+static uint8_t (*round_keys)[AES_128_KEY_LENGTH] = schedules[0];
 
 /*---------------------------------------------------------------------------*/
 /* multiplies by 2 in GF(2) */
@@ -81,7 +91,19 @@ set_key(const uint8_t *key)
   uint8_t i;
   uint8_t j;
   uint8_t rcon;
-  
+
+  /* the first round key is the key itself */
+  for(i = 0; i < KEY_CACHE; i++) {
+    if(valid[i] && !memcmp(schedules[i][0], key, AES_128_KEY_LENGTH)) {
+      round_keys = schedules[i];
+      return;
+    }
+  }
+
+  round_keys = schedules[next];
+  valid[next] = 1;
+  next = (next + 1) % KEY_CACHE;
+
   rcon = 0x01;
   memcpy(round_keys[0], key, AES_128_KEY_LENGTH);
   for(i = 1; i <= 10; i++) {
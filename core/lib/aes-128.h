@@ -72,6 +72,11 @@ struct aes_128_driver {
  */
 void aes_128_set_padded_key(uint8_t *key, uint8_t key_len);
 
+/** Byte-oriented software driver, the default */
+extern const struct aes_128_driver aes_128_driver;
+/** Faster software driver, with 32-bit T-tables */
+extern const struct aes_128_driver aes_128_ttable_driver;
+
 extern const struct aes_128_driver AES_128;
 
 #endif /* AES_128_H_ */
@@ -55,6 +55,20 @@
 #ifndef CRC16_H_
 #define CRC16_H_
 
+/**
+ * \name CRC16 implementations, selected with CRC16_CONF_IMPL
+ *
+ * The bitwise implementation needs no table and is the default. The
+ * nibble implementation uses a 32-byte table and the byte
+ * implementation a 512-byte table; both are considerably faster when
+ * checksumming large data blocks. All give identical results.
+ * @{
+ */
+#define CRC16_IMPL_BITWISE 0
+#define CRC16_IMPL_NIBBLE  1
+#define CRC16_IMPL_TABLE   2
+/** @} */
+
 /**
  * \brief      Update an accumulated CRC16 checksum with one byte.
  * \param b    The byte to be added to the checksum
@@ -82,14 +96,30 @@ unsigned short crc16_add(unsigned char b, unsigned short crc);
  *
  *             This function calculates the CRC16 checksum of a data area.
  *
- *             \note The algorithm used in this implementation is
- *             tailored for a running checksum and does not perform as
- *             well as a table-driven algorithm when checksumming an
- *             entire data block.
+ *             \note With the default bitwise implementation this does
+ *             not perform as well as a table-driven algorithm when
+ *             checksumming an entire data block. Set CRC16_CONF_IMPL
+ *             to CRC16_IMPL_TABLE or CRC16_IMPL_NIBBLE for faster
+ *             block checksums, or let a platform with a CRC engine
+ *             set CRC16_CONF_ARCH_DATA and provide crc16_arch_data().
  */
 unsigned short crc16_data(const unsigned char *data, int datalen,
 			  unsigned short acc);
 
+/**
+ * \brief      Platform-specific CRC16 over a data area
+ * \param data Pointer to the data
+ * \param datalen The length of the data
+ * \param acc  The accumulated CRC that is to be updated (or zero).
+ * \return     The CRC16 checksum.
+ *
+ *             Used by crc16_data() when CRC16_CONF_ARCH_DATA is
+ *             set. It must return the same value as crc16_add()
+ *             applied to each byte in turn.
+ */
+unsigned short crc16_arch_data(const unsigned char *data, int datalen,
+                               unsigned short acc);
+
 #endif /* CRC16_H_ */
 
 /** @} */
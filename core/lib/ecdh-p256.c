@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Software elliptic curve Diffie-Hellman on NIST P-256.
+ *
+ *         Field elements are kept in Montgomery form, with R = 2^256.
+ *         Points are multiplied in Jacobian coordinates, with one
+ *         doubling and one mixed addition per scalar bit, so that the
+ *         time taken does not depend on the bits below the most
+ *         significant one.
+ */
+
+#include "lib/ecdh-p256.h"
+#include <string.h>
+
+/* Number of scalar bits processed before yielding */
+#ifdef ECDH_P256_CONF_BITS_PER_YIELD
+#define BITS_PER_YIELD ECDH_P256_CONF_BITS_PER_YIELD
+#else /* ECDH_P256_CONF_BITS_PER_YIELD */
+#define BITS_PER_YIELD 8
+#endif /* ECDH_P256_CONF_BITS_PER_YIELD */
+
+#define WORDS ECDH_P256_WORDS
+
+typedef uint32_t fe_t[WORDS];
+
+static const fe_t p = {
+  0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+  0x00000000, 0x00000000, 0x00000001, 0xffffffff
+};
+/* n - 1, the largest scalar plus one */
+static const fe_t n_minus_1 = {
+  0xfc632550, 0xf3b9cac2, 0xa7179e84, 0xbce6faad,
+  0xffffffff, 0xffffffff, 0x00000000, 0xffffffff
+};
+static const fe_t b = {
+  0x27d2604b, 0x3bce3c3e, 0xcc53b0f6, 0x651d06b0,
+  0x769886bc, 0xb3ebbd55, 0xaa3a93e7, 0x5ac635d8
+};
+/* R^2 mod p, to convert into Montgomery form */
+static const fe_t r2 = {
+  0x00000003, 0x00000000, 0xffffffff, 0xfffffffb,
+  0xfffffffe, 0xffffffff, 0xfffffffd, 0x00000004
+};
+/* R mod p, i.e. 1 in Montgomery form */
+static const fe_t one = {
+  0x00000001, 0x00000000, 0x00000000, 0xffffffff,
+  0xffffffff, 0xffffffff, 0xfffffffe, 0x00000000
+};
+
+const uint32_t ecdh_p256_gx[WORDS] = {
+  0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81,
+  0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2
+};
+const uint32_t ecdh_p256_gy[WORDS] = {
+  0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357,
+  0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2
+};
+/*---------------------------------------------------------------------------*/
+/* Returns a < b for numbers of WORDS words */
+static int
+less_than(const uint32_t *a, const uint32_t *b)
+{
+  int i;
+
+  for(i = WORDS - 1; i >= 0; i--) {
+    if(a[i] != b[i]) {
+      return a[i] < b[i];
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* r = a - b, returns the borrow */
+static uint32_t
+sub(uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+  int64_t t = 0;
+  int i;
+
+  for(i = 0; i < WORDS; i++) {
+    t += (int64_t)a[i] - b[i];
+    r[i] = (uint32_t)t;
+    t >>= 32;
+  }
+  return (uint32_t)-t;
+}
+/*---------------------------------------------------------------------------*/
+/* r = a if mask is all ones, unchanged if it is zero */
+static void
+cond_copy(uint32_t *r, const uint32_t *a, uint32_t mask)
+{
+  int i;
+
+  for(i = 0; i < WORDS; i++) {
+    r[i] ^= (r[i] ^ a[i]) & mask;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+fe_add(fe_t r, const fe_t a, const fe_t b)
+{
+  fe_t t;
+  uint64_t c = 0;
+  uint32_t borrow;
+  int i;
+
+  for(i = 0; i < WORDS; i++) {
+    c += (uint64_t)a[i] + b[i];
+    r[i] = (uint32_t)c;
+    c >>= 32;
+  }
+  /* Subtract p if the sum did not fit, or is not below p */
+  borrow = sub(t, r, p);
+  cond_copy(r, t, -(uint32_t)(c | !borrow));
+}
+/*---------------------------------------------------------------------------*/
+static void
+fe_sub(fe_t r, const fe_t a, const fe_t b)
+{
+  fe_t t;
+  uint64_t c = 0;
+  uint32_t borrow;
+  int i;
+
+  borrow = sub(r, a, b);
+  for(i = 0; i < WORDS; i++) {
+    c += (uint64_t)r[i] + p[i];
+    t[i] = (uint32_t)c;
+    c >>= 32;
+  }
+  cond_copy(r, t, -borrow);
+}
+/*---------------------------------------------------------------------------*/
+/* Montgomery multiplication, r = a * b / R mod p. Since p = -1 mod 2^32,
+ * the Montgomery factor of each step is the lowest word itself. */
+static void
+fe_mul(fe_t r, const fe_t a, const fe_t b)
+{
+  uint32_t t[WORDS + 2];
+  fe_t s;
+  uint64_t c;
+  uint32_t m, borrow;
+  int i, j;
+
+  memset(t, 0, sizeof(t));
+  for(i = 0; i < WORDS; i++) {
+    c = 0;
+    for(j = 0; j < WORDS; j++) {
+      c += (uint64_t)a[j] * b[i] + t[j];
+      t[j] = (uint32_t)c;
+      c >>= 32;
+    }
+    c += t[WORDS];
+    t[WORDS] = (uint32_t)c;
+    t[WORDS + 1] = (uint32_t)(c >> 32);
+
+    m = t[0];
+    c = (uint64_t)m * p[0] + t[0];
+    c >>= 32;
+    for(j = 1; j < WORDS; j++) {
+      c += (uint64_t)m * p[j] + t[j];
+      t[j - 1] = (uint32_t)c;
+      c >>= 32;
+    }
+    c += t[WORDS];
+    t[WORDS - 1] = (uint32_t)c;
+    t[WORDS] = t[WORDS + 1] + (uint32_t)(c >> 32);
+  }
+  borrow = sub(s, t, p);
+  memcpy(r, t, sizeof(fe_t));
+  cond_copy(r, s, -(uint32_t)(t[WORDS] | !borrow));
+}
+/*---------------------------------------------------------------------------*/
+/* r = a^-1, as a^(p - 2) */
+static void
+fe_inv(fe_t r, const fe_t a)
+{
+  fe_t t;
+  int i;
+
+  /* The bits of p - 2, from the most significant one, are 32 ones,
+   * 31 zeros and a one, 96 zeros, 94 ones, a zero and a one. */
+  memcpy(t, a, sizeof(fe_t));
+  for(i = 254; i >= 0; i--) {
+    fe_mul(t, t, t);
+    if(i >= 224 || i == 192 || (i >= 2 && i < 96) || i == 0) {
+      fe_mul(t, t, a);
+    }
+  }
+  memcpy(r, t, sizeof(fe_t));
+}
+/*---------------------------------------------------------------------------*/
+static void
+fe_from_mont(fe_t r, const fe_t a)
+{
+  static const fe_t unit = { 1 };
+
+  fe_mul(r, a, unit);
+}
+/*---------------------------------------------------------------------------*/
+/* (X, Y, Z) = 2 * (X, Y, Z), for a = -3 */
+static void
+point_double(uint32_t (*q)[WORDS])
+{
+  fe_t delta, gamma, beta, alpha, t;
+
+  fe_mul(delta, q[2], q[2]);
+  fe_mul(gamma, q[1], q[1]);
+  fe_mul(beta, q[0], gamma);
+  fe_sub(t, q[0], delta);
+  fe_add(alpha, q[0], delta);
+  fe_mul(alpha, alpha, t);
+  fe_add(t, alpha, alpha);
+  fe_add(alpha, alpha, t);
+
+  /* Z3 = (Y1 + Z1)^2 - gamma - delta */
+  fe_add(q[2], q[1], q[2]);
+  fe_mul(q[2], q[2], q[2]);
+  fe_sub(q[2], q[2], gamma);
+  fe_sub(q[2], q[2], delta);
+
+  /* X3 = alpha^2 - 8 * beta */
+  fe_add(beta, beta, beta);
+  fe_add(beta, beta, beta);
+  fe_mul(q[0], alpha, alpha);
+  fe_sub(q[0], q[0], beta);
+  fe_sub(q[0], q[0], beta);
+
+  /* Y3 = alpha * (4 * beta - X3) - 8 * gamma^2 */
+  fe_sub(t, beta, q[0]);
+  fe_mul(t, alpha, t);
+  fe_mul(gamma, gamma, gamma);
+  fe_add(gamma, gamma, gamma);
+  fe_add(gamma, gamma, gamma);
+  fe_add(gamma, gamma, gamma);
+  fe_sub(q[1], t, gamma);
+}
+/*---------------------------------------------------------------------------*/
+/* r = q + (x, y), q being neither (x, y) nor its opposite */
+static void
+point_add_affine(uint32_t (*r)[WORDS], uint32_t (*q)[WORDS],
+                 const fe_t x, const fe_t y)
+{
+  fe_t z1z1, u2, s2, h, hh, i, j, v;
+
+  fe_mul(z1z1, q[2], q[2]);
+  fe_mul(u2, x, z1z1);
+  fe_mul(s2, y, q[2]);
+  fe_mul(s2, s2, z1z1);
+  fe_sub(h, u2, q[0]);
+  fe_mul(hh, h, h);
+  fe_add(i, hh, hh);
+  fe_add(i, i, i);
+  fe_mul(j, h, i);
+  /* s2 becomes r = 2 * (S2 - Y1) */
+  fe_sub(s2, s2, q[1]);
+  fe_add(s2, s2, s2);
+  fe_mul(v, q[0], i);
+
+  /* Z3 = (Z1 + H)^2 - Z1Z1 - HH */
+  fe_add(r[2], q[2], h);
+  fe_mul(r[2], r[2], r[2]);
+  fe_sub(r[2], r[2], z1z1);
+  fe_sub(r[2], r[2], hh);
+
+  /* X3 = r^2 - J - 2 * V */
+  fe_mul(r[0], s2, s2);
+  fe_sub(r[0], r[0], j);
+  fe_sub(r[0], r[0], v);
+  fe_sub(r[0], r[0], v);
+
+  /* Y3 = r * (V - X3) - 2 * Y1 * J */
+  fe_sub(v, v, r[0]);
+  fe_mul(v, s2, v);
+  fe_mul(j, q[1], j);
+  fe_add(j, j, j);
+  fe_sub(r[1], v, j);
+}
+/*---------------------------------------------------------------------------*/
+static int
+scalar_bit(const uint32_t *k, int bit)
+{
+  return (k[bit / 32] >> (bit % 32)) & 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+ecdh_p256_is_valid_scalar(const uint32_t *k)
+{
+  int i;
+
+  for(i = 0; i < WORDS; i++) {
+    if(k[i] != 0) {
+      return less_than(k, n_minus_1);
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+ecdh_p256_is_on_curve(const uint32_t *x, const uint32_t *y)
+{
+  fe_t mx, my, lhs, rhs, t;
+
+  if(!less_than(x, p) || !less_than(y, p)) {
+    return 0;
+  }
+  fe_mul(mx, x, r2);
+  fe_mul(my, y, r2);
+
+  /* y^2 = x^3 - 3x + b */
+  fe_mul(lhs, my, my);
+  fe_mul(rhs, mx, mx);
+  fe_mul(rhs, rhs, mx);
+  fe_add(t, mx, mx);
+  fe_add(t, t, mx);
+  fe_sub(rhs, rhs, t);
+  fe_mul(t, b, r2);
+  fe_add(rhs, rhs, t);
+  return memcmp(lhs, rhs, sizeof(fe_t)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(multiply(struct ecdh_p256_state *s))
+{
+  uint32_t t[3][WORDS];
+  fe_t zinv, zinv2;
+  int i;
+
+  PT_BEGIN(&s->pt);
+
+  if(!ecdh_p256_is_valid_scalar(s->scalar) ||
+     !ecdh_p256_is_on_curve(s->x, s->y)) {
+    s->result = ECDH_P256_ERROR;
+    PT_EXIT(&s->pt);
+  }
+
+  fe_mul(s->x, s->x, r2);
+  fe_mul(s->y, s->y, r2);
+  memcpy(s->work[0], s->x, sizeof(fe_t));
+  memcpy(s->work[1], s->y, sizeof(fe_t));
+  memcpy(s->work[2], one, sizeof(fe_t));
+
+  /* The scalar is not zero, start below its most significant bit */
+  for(s->bit = 255; !scalar_bit(s->scalar, s->bit); s->bit--);
+  s->bit--;
+
+  while(s->bit >= 0) {
+    for(i = 0; i < BITS_PER_YIELD && s->bit >= 0; i++, s->bit--) {
+      point_double(s->work);
+      point_add_affine(t, s->work, s->x, s->y);
+      cond_copy(s->work[0], t[0], -(uint32_t)scalar_bit(s->scalar, s->bit));
+      cond_copy(s->work[1], t[1], -(uint32_t)scalar_bit(s->scalar, s->bit));
+      cond_copy(s->work[2], t[2], -(uint32_t)scalar_bit(s->scalar, s->bit));
+    }
+    if(s->bit >= 0) {
+      process_poll(s->process);
+      PT_YIELD(&s->pt);
+    }
+  }
+
+  /* Back to affine coordinates */
+  fe_inv(zinv, s->work[2]);
+  fe_mul(zinv2, zinv, zinv);
+  fe_mul(s->x, s->work[0], zinv2);
+  fe_mul(zinv2, zinv2, zinv);
+  fe_mul(s->y, s->work[1], zinv2);
+  fe_from_mont(s->x, s->x);
+  fe_from_mont(s->y, s->y);
+  s->result = ECDH_P256_OK;
+
+  PT_END(&s->pt);
+}
+/*---------------------------------------------------------------------------*/
+const struct ecdh_p256_driver ecdh_p256_driver = {
+  multiply
+};
+/*---------------------------------------------------------------------------*/
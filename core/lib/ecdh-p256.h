@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Elliptic curve Diffie-Hellman on NIST P-256.
+ *
+ *         Point multiplication is a protothread, so that a driver can
+ *         let the calling process run other events while the
+ *         computation is in progress: hardware drivers while the
+ *         engine works, the software driver between a few scalar bits.
+ */
+#ifndef ECDH_P256_H_
+#define ECDH_P256_H_
+
+#include "contiki.h"
+
+#ifdef ECDH_P256_CONF
+#define ECDH_P256 ECDH_P256_CONF
+#else /* ECDH_P256_CONF */
+#define ECDH_P256 ecdh_p256_driver
+#endif /* ECDH_P256_CONF */
+
+/* Numbers are arrays of 32-bit words, least significant word first */
+#define ECDH_P256_WORDS 8
+
+#define ECDH_P256_OK    0
+#define ECDH_P256_ERROR 1
+
+/**
+ * State of a point multiplication.
+ */
+struct ecdh_p256_state {
+  struct pt pt;
+  /** Process polled whenever the multiplication can make progress */
+  struct process *process;
+  /** Scalar, as checked by ecdh_p256_is_valid_scalar() */
+  uint32_t scalar[ECDH_P256_WORDS];
+  /** Point on the curve, replaced with the result */
+  uint32_t x[ECDH_P256_WORDS];
+  uint32_t y[ECDH_P256_WORDS];
+  /** ECDH_P256_OK or ECDH_P256_ERROR, when the protothread has ended */
+  uint8_t result;
+  /* Working data of the software driver */
+  uint32_t work[3][ECDH_P256_WORDS];
+  int16_t bit;
+};
+
+/**
+ * Structure of P-256 drivers.
+ */
+struct ecdh_p256_driver {
+
+  /**
+   * \brief       Multiplies the point (x, y) of state by its scalar.
+   *
+   *              Spawn this from the process given in state, e.g. with
+   *              PROCESS_PT_SPAWN(). Only one multiplication can be in
+   *              progress at a time.
+   */
+  PT_THREAD((* multiply)(struct ecdh_p256_state *state));
+};
+
+/** The generator of P-256 */
+extern const uint32_t ecdh_p256_gx[ECDH_P256_WORDS];
+extern const uint32_t ecdh_p256_gy[ECDH_P256_WORDS];
+
+/**
+ * \brief  Tells whether (x, y) is a point on the curve. Check this for
+ *         any point received from another node before multiplying it.
+ */
+int ecdh_p256_is_on_curve(const uint32_t *x, const uint32_t *y);
+
+/**
+ * \brief  Tells whether k is a valid private key, i.e. 1 <= k <= n - 2,
+ *         n being the order of the curve.
+ */
+int ecdh_p256_is_valid_scalar(const uint32_t *k);
+
+extern const struct ecdh_p256_driver ECDH_P256;
+
+#endif /* ECDH_P256_H_ */
@@ -55,4 +55,17 @@
 */
 void ifft(int16_t xre[], int16_t xim[], uint16_t n);
 
+/* Largest n for fft(), which sets the size of its twiddle table */
+#define FFT_MAX_SIZE 1024
+
+/* fft(re[], im[], n) - fixpoint complex Fast Fourier Transform
+   Transforms the n complex samples in re[] and im[] in place, n being
+   a power of two up to FFT_MAX_SIZE. The twiddle factors come from a
+   Q15 table, and the result is scaled by 1/n, so it cannot overflow as
+   long as |re[k] + i * im[k]| < 32768 for the input; real 16 bit
+   samples always are. For real input, zero im[] and use the first
+   n / 2 bins.
+*/
+void fft(int16_t re[], int16_t im[], uint16_t n);
+
 #endif /* IFFT_H */
@@ -47,18 +47,113 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+#if MEMB_STATS
+static struct memb *memb_list;
+/*---------------------------------------------------------------------------*/
+static void
+stats_list(struct memb *m)
+{
+  if(!m->listed) {
+    m->next = memb_list;
+    memb_list = m;
+    m->listed = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+stats_alloc(struct memb *m, void *ptr)
+{
+  stats_list(m);
+  if(ptr == NULL) {
+    m->failed++;
+  } else if(++m->used > m->peak) {
+    m->peak = m->used;
+  }
+}
+#define STATS_ALLOC(m, ptr) stats_alloc(m, ptr)
+#define STATS_FREE(m) (m)->used--
+#else /* MEMB_STATS */
+#define STATS_ALLOC(m, ptr)
+#define STATS_FREE(m)
+#endif /* MEMB_STATS */
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+  if(m->free_list != NULL) {
+    m->free_list->head = NULL;
+    m->free_list->unused = 0;
+    m->free_list->used = 0;
+  }
+#if MEMB_STATS
+  stats_list(m);
+  m->used = 0;
+#endif /* MEMB_STATS */
+}
+/*---------------------------------------------------------------------------*/
+static void *
+free_list_alloc(struct memb *m)
+{
+  struct memb_free_list *fl = m->free_list;
+  char *block;
+
+  if(fl->head != NULL) {
+    /* Take the first free block; its first bytes hold the next one.
+       Blocks need not be aligned for a pointer, hence memcpy. */
+    block = fl->head;
+    memcpy(&fl->head, block, sizeof(fl->head));
+  } else if(fl->unused < m->num) {
+    /* Blocks that were never used are not on the list, so that the
+       memory block also works without memb_init(). */
+    block = (char *)m->mem + fl->unused * m->size;
+    fl->unused++;
+  } else {
+    return NULL;
+  }
+
+  m->count[(block - (char *)m->mem) / m->size] = 1;
+  fl->used++;
+  return block;
+}
+/*---------------------------------------------------------------------------*/
+static char
+free_list_free(struct memb *m, void *ptr)
+{
+  struct memb_free_list *fl = m->free_list;
+  unsigned int offset;
+  int i;
+
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    return -1;
+  }
+
+  i = offset / m->size;
+  if(m->count[i] > 0 && --(m->count[i]) == 0) {
+    memcpy(ptr, &fl->head, sizeof(fl->head));
+    fl->head = ptr;
+    fl->used--;
+    STATS_FREE(m);
+  }
+  return m->count[i];
 }
 /*---------------------------------------------------------------------------*/
 void *
 memb_alloc(struct memb *m)
 {
   int i;
+  void *ptr;
+
+  if(m->free_list != NULL) {
+    ptr = free_list_alloc(m);
+    STATS_ALLOC(m, ptr);
+    return ptr;
+  }
 
   for(i = 0; i < m->num; ++i) {
     if(m->count[i] == 0) {
@@ -66,12 +161,15 @@ memb_alloc(struct memb *m)
 	 indicate that it now is used and return a pointer to the
 	 memory block. */
       ++(m->count[i]);
-      return (void *)((char *)m->mem + (i * m->size));
+      ptr = (void *)((char *)m->mem + (i * m->size));
+      STATS_ALLOC(m, ptr);
+      return ptr;
     }
   }
 
   /* No free block was found, so we return NULL to indicate failure to
      allocate block. */
+  STATS_ALLOC(m, NULL);
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -81,6 +179,10 @@ memb_free(struct memb *m, void *ptr)
   int i;
   char *ptr2;
 
+  if(m->free_list != NULL) {
+    return free_list_free(m, ptr);
+  }
+
   /* Walk through the list of blocks and try to find the block to
      which the pointer "ptr" points to. */
   ptr2 = (char *)m->mem;
@@ -91,7 +193,9 @@ memb_free(struct memb *m, void *ptr)
 	 reference count and return the new value of it. */
       if(m->count[i] > 0) {
 	/* Make sure that we don't deallocate free memory. */
-	--(m->count[i]);
+	if(--(m->count[i]) == 0) {
+	  STATS_FREE(m);
+	}
       }
       return m->count[i];
     }
@@ -113,6 +217,10 @@ memb_numfree(struct memb *m)
   int i;
   int num_free = 0;
 
+  if(m->free_list != NULL) {
+    return m->num - m->free_list->used;
+  }
+
   for(i = 0; i < m->num; ++i) {
     if(m->count[i] == 0) {
       ++num_free;
@@ -121,4 +229,25 @@ memb_numfree(struct memb *m)
 
   return num_free;
 }
+/*---------------------------------------------------------------------------*/
+#if MEMB_STATS
+struct memb *
+memb_stats_head(void)
+{
+  return memb_list;
+}
+/*---------------------------------------------------------------------------*/
+struct memb *
+memb_stats_next(struct memb *m)
+{
+  return m->next;
+}
+/*---------------------------------------------------------------------------*/
+void
+memb_reset_peak(struct memb *m)
+{
+  m->peak = m->used;
+}
+#endif /* MEMB_STATS */
+/*---------------------------------------------------------------------------*/
 /** @} */
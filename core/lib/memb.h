@@ -63,8 +63,25 @@
 #ifndef MEMB_H_
 #define MEMB_H_
 
+#include "contiki-conf.h"
 #include "sys/cc.h"
 
+/* With MEMB_CONF_STATS, every memory block keeps its name, the number
+   of blocks in use, the most that were in use at once and the number
+   of failed allocations, and memory blocks are put on a list when
+   they are first initialized or allocated from. */
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else
+#define MEMB_STATS 0
+#endif
+
+#if MEMB_STATS
+#define MEMB_STATS_INIT(name) , #name
+#else
+#define MEMB_STATS_INIT(name)
+#endif
+
 /**
  * Declare a memory block.
  *
@@ -91,13 +108,68 @@ MEMB(connections, struct connection, 16);
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem), \
+                                          NULL MEMB_STATS_INIT(name)}
+
+/**
+ * Declare a memory block with a free list.
+ *
+ * This macro works like MEMB(), but the memory block also keeps a
+ * list of its free blocks, threaded through the free blocks
+ * themselves. memb_alloc(), memb_free() and memb_numfree() then take
+ * constant time instead of scanning the block, which matters for
+ * large blocks such as big routing tables. The structure must be at
+ * least as large as a pointer.
+ *
+ * \param name The name of the memory block
+ *
+ * \param structure The name of the struct that the memory block holds
+ *
+ * \param num The total number of memory chunks in the block.
+ *
+ */
+#define MEMB_FREELIST(name, structure, num) \
+        typedef char CC_CONCAT(name,_memb_size_check) \
+          [sizeof(structure) >= sizeof(void *) ? 1 : -1]; \
+        static char CC_CONCAT(name,_memb_count)[num]; \
+        static structure CC_CONCAT(name,_memb_mem)[num]; \
+        static struct memb_free_list CC_CONCAT(name,_memb_free_list); \
+        static struct memb name = {sizeof(structure), num, \
+                                          CC_CONCAT(name,_memb_count), \
+                                          (void *)CC_CONCAT(name,_memb_mem), \
+                                          &CC_CONCAT(name,_memb_free_list) \
+                                          MEMB_STATS_INIT(name)}
+
+/* The free list of a memory block declared with MEMB_FREELIST() */
+struct memb_free_list {
+  /** The first free block that has been used before */
+  void *head;
+  /** Blocks from this index on are free and have never been used */
+  unsigned short unused;
+  /** The number of blocks in use */
+  unsigned short used;
+};
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+  struct memb_free_list *free_list;
+#if MEMB_STATS
+  /** The name given to MEMB() */
+  const char *name;
+  /** The next memory block on the list of memory blocks */
+  struct memb *next;
+  /** The number of blocks in use */
+  unsigned short used;
+  /** The highest number of blocks in use at once */
+  unsigned short peak;
+  /** Allocations that failed */
+  unsigned short failed;
+  /** Non-zero once the memory block is on the list */
+  char listed;
+#endif /* MEMB_STATS */
 };
 
 /**
@@ -132,6 +204,26 @@ int memb_inmemb(struct memb *m, void *ptr);
 
 int  memb_numfree(struct memb *m);
 
+#if MEMB_STATS
+/**
+ * Get the first memory block on the list of memory blocks.
+ *
+ * Memory blocks are listed when they are first initialized or
+ * allocated from. Only available with MEMB_CONF_STATS.
+ */
+struct memb *memb_stats_head(void);
+
+/**
+ * Get the memory block after m on the list of memory blocks.
+ */
+struct memb *memb_stats_next(struct memb *m);
+
+/**
+ * Restart the high-water mark of a memory block from its current use.
+ */
+void memb_reset_peak(struct memb *m);
+#endif /* MEMB_STATS */
+
 /** @} */
 /** @} */
 
@@ -55,10 +55,48 @@
 #define MMEM_SIZE 4096
 #endif
 
+#if MMEM_LAZY_COMPACTION
+/* Blocks are aligned so that a freed block can hold a struct mmem
+   describing the hole. The hole takes the place of the block in the
+   list, and is told apart from an allocation by pointing to itself. */
+#define MMEM_ALIGN sizeof(void *)
+#define BLOCK_SIZE(size) ((((size) < sizeof(struct mmem) ?              \
+                            sizeof(struct mmem) : (size)) +           \
+                           MMEM_ALIGN - 1) & ~(MMEM_ALIGN - 1))
+#define IS_HOLE(m) ((m)->ptr == (void *)(m))
+
+/* Blocks and holes in address order */
+static struct mmem *head, *tail;
+/* Bytes taken by blocks and holes from the start of memory */
+static unsigned int top;
+static unsigned int hole_count, hole_bytes;
+static void *memory_words[(MMEM_SIZE + MMEM_ALIGN - 1) / MMEM_ALIGN];
+#define memory ((char *)memory_words)
+#else /* MMEM_LAZY_COMPACTION */
 LIST(mmemlist);
-unsigned int avail_memory;
 static char memory[MMEM_SIZE];
+#endif /* MMEM_LAZY_COMPACTION */
+unsigned int avail_memory;
+static unsigned int compactions;
+static unsigned int peak, failed;
 
+#if MMEM_LAZY_COMPACTION
+/*---------------------------------------------------------------------------*/
+static void
+unlink_block(struct mmem *m)
+{
+  if(m->prev != NULL) {
+    m->prev->next = m->next;
+  } else {
+    head = m->next;
+  }
+  if(m->next != NULL) {
+    m->next->prev = m->prev;
+  } else {
+    tail = m->prev;
+  }
+}
+#endif /* MMEM_LAZY_COMPACTION */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Allocate a managed memory block
@@ -82,8 +120,40 @@ static char memory[MMEM_SIZE];
 int
 mmem_alloc(struct mmem *m, unsigned int size)
 {
+#if MMEM_LAZY_COMPACTION
+  unsigned int block_size = BLOCK_SIZE(size);
+
+  if(avail_memory < block_size) {
+    failed++;
+    return 0;
+  }
+
+  /* Close the holes only when the block does not fit above the others */
+  if(MMEM_SIZE - top < block_size) {
+    mmem_compact();
+  }
+
+  m->ptr = &memory[top];
+  m->size = size;
+  m->next = NULL;
+  m->prev = tail;
+  if(tail != NULL) {
+    tail->next = m;
+  } else {
+    head = m;
+  }
+  tail = m;
+
+  top += block_size;
+  avail_memory -= block_size;
+  if(MMEM_SIZE - avail_memory > peak) {
+    peak = MMEM_SIZE - avail_memory;
+  }
+  return 1;
+#else /* MMEM_LAZY_COMPACTION */
   /* Check if we have enough memory left for this allocation. */
   if(avail_memory < size) {
+    failed++;
     return 0;
   }
 
@@ -100,10 +170,14 @@ mmem_alloc(struct mmem *m, unsigned int size)
 
   /* Decrease the amount of available memory. */
   avail_memory -= size;
+  if(MMEM_SIZE - avail_memory > peak) {
+    peak = MMEM_SIZE - avail_memory;
+  }
 
   /* Return non-zero to indicate that we were able to allocate
      memory. */
   return 1;
+#endif /* MMEM_LAZY_COMPACTION */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -118,6 +192,58 @@ mmem_alloc(struct mmem *m, unsigned int size)
 void
 mmem_free(struct mmem *m)
 {
+#if MMEM_LAZY_COMPACTION
+  unsigned int block_size = BLOCK_SIZE(m->size);
+  struct mmem *hole;
+  struct mmem *n;
+
+  avail_memory += block_size;
+
+  if(m->next == NULL) {
+    /* The last block goes back to the free space above the others,
+       with the hole before it if there is one. */
+    unlink_block(m);
+    top -= block_size;
+    if(tail != NULL && IS_HOLE(tail)) {
+      hole = tail;
+      unlink_block(hole);
+      top -= hole->size;
+      hole_count--;
+      hole_bytes -= hole->size;
+    }
+    return;
+  }
+
+  hole_bytes += block_size;
+  if(m->prev != NULL && IS_HOLE(m->prev)) {
+    /* Grow the hole before the block */
+    hole = m->prev;
+    hole->size += block_size;
+    unlink_block(m);
+  } else {
+    /* Put a hole in place of the block */
+    hole = (struct mmem *)m->ptr;
+    hole->ptr = hole;
+    hole->size = block_size;
+    hole->prev = m->prev;
+    hole->next = m->next;
+    if(hole->prev != NULL) {
+      hole->prev->next = hole;
+    } else {
+      head = hole;
+    }
+    hole->next->prev = hole;
+    hole_count++;
+  }
+
+  /* The last entry is never a hole, so there is a block after this one */
+  if(IS_HOLE(hole->next)) {
+    n = hole->next;
+    unlink_block(n);
+    hole->size += n->size;
+    hole_count--;
+  }
+#else /* MMEM_LAZY_COMPACTION */
   struct mmem *n;
 
   if(m->next != NULL) {
@@ -137,6 +263,91 @@ mmem_free(struct mmem *m)
 
   /* Remove the memory block from the list. */
   list_remove(mmemlist, m);
+#endif /* MMEM_LAZY_COMPACTION */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Compact the managed memory
+ *
+ *             With MMEM_CONF_LAZY_COMPACTION, this function moves all
+ *             blocks down over the holes left by mmem_free(), so
+ *             that all free memory is in one piece. It is called by
+ *             mmem_alloc() when needed, and may be called when the
+ *             system is idle to keep allocations fast. Without lazy
+ *             compaction, the memory is always compact and this
+ *             function does nothing.
+ *
+ *             Pointers obtained with MMEM_PTR() before the call are
+ *             no longer valid after it.
+ *
+ */
+void
+mmem_compact(void)
+{
+#if MMEM_LAZY_COMPACTION
+  struct mmem *n;
+  struct mmem *next;
+  char *free_ptr;
+
+  if(hole_count == 0) {
+    return;
+  }
+
+  /* Blocks only move down, so a block never overwrites a hole that
+     has not been unlinked yet. */
+  free_ptr = memory;
+  for(n = head; n != NULL; n = next) {
+    next = n->next;
+    if(IS_HOLE(n)) {
+      unlink_block(n);
+    } else {
+      if(n->ptr != free_ptr) {
+        memmove(free_ptr, n->ptr, n->size);
+        n->ptr = free_ptr;
+      }
+      free_ptr += BLOCK_SIZE(n->size);
+    }
+  }
+
+  top = free_ptr - memory;
+  hole_count = 0;
+  hole_bytes = 0;
+  compactions++;
+#endif /* MMEM_LAZY_COMPACTION */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Get fragmentation statistics of the managed memory
+ * \param stats Filled in with the statistics
+ *
+ */
+void
+mmem_get_stats(struct mmem_stats *stats)
+{
+  stats->avail = avail_memory;
+  stats->compactions = compactions;
+  stats->size = MMEM_SIZE;
+  stats->peak = peak;
+  stats->failed = failed;
+#if MMEM_LAZY_COMPACTION
+  stats->contiguous = MMEM_SIZE - top;
+  stats->holes = hole_count;
+  stats->hole_bytes = hole_bytes;
+#else /* MMEM_LAZY_COMPACTION */
+  stats->contiguous = avail_memory;
+  stats->holes = 0;
+  stats->hole_bytes = 0;
+#endif /* MMEM_LAZY_COMPACTION */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Restart the high-water mark from the memory in use now
+ *
+ */
+void
+mmem_reset_peak(void)
+{
+  peak = MMEM_SIZE - avail_memory;
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -155,7 +366,12 @@ mmem_init(void)
   if(inited) {
     return;
   }
+#if MMEM_LAZY_COMPACTION
+  head = tail = NULL;
+  top = 0;
+#else /* MMEM_LAZY_COMPACTION */
   list_init(mmemlist);
+#endif /* MMEM_LAZY_COMPACTION */
   avail_memory = MMEM_SIZE;
   inited = 1;
 }
@@ -59,6 +59,21 @@
 #ifndef MMEM_H_
 #define MMEM_H_
 
+#include "contiki-conf.h"
+
+/* With MMEM_CONF_LAZY_COMPACTION, mmem_free() leaves a hole where the
+   block was instead of moving all later blocks down. Holes are merged
+   with their neighbours, and the memory is compacted only when an
+   allocation does not fit above the last block, or when mmem_compact()
+   is called, for instance when the system is idle. Freeing is then
+   O(1), at the cost of rounding blocks up to a multiple of a pointer
+   and to at least the size of a struct mmem. */
+#ifdef MMEM_CONF_LAZY_COMPACTION
+#define MMEM_LAZY_COMPACTION MMEM_CONF_LAZY_COMPACTION
+#else
+#define MMEM_LAZY_COMPACTION 0
+#endif
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Get a pointer to the managed memory
@@ -78,6 +93,29 @@ struct mmem {
   struct mmem *next;
   unsigned int size;
   void *ptr;
+#if MMEM_LAZY_COMPACTION
+  struct mmem *prev;
+#endif /* MMEM_LAZY_COMPACTION */
+};
+
+/** Fragmentation statistics of the managed memory */
+struct mmem_stats {
+  /** Free bytes in total */
+  unsigned int avail;
+  /** Free bytes above the last block, allocatable without compaction */
+  unsigned int contiguous;
+  /** Holes left by freed blocks */
+  unsigned int holes;
+  /** Bytes in holes */
+  unsigned int hole_bytes;
+  /** Compactions done so far */
+  unsigned int compactions;
+  /** Size of the managed memory */
+  unsigned int size;
+  /** The most bytes allocated at once */
+  unsigned int peak;
+  /** Allocations that failed */
+  unsigned int failed;
 };
 
 /* XXX: tagga minne med "interrupt usage", vilke gr att man r
@@ -86,6 +124,9 @@ struct mmem {
 int  mmem_alloc(struct mmem *m, unsigned int size);
 void mmem_free(struct mmem *);
 void mmem_init(void);
+void mmem_compact(void);
+void mmem_get_stats(struct mmem_stats *stats);
+void mmem_reset_peak(void);
 
 #endif /* MMEM_H_ */
 
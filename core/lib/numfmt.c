@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Number formatting without snprintf()
+ */
+
+#include "lib/numfmt.h"
+/*---------------------------------------------------------------------------*/
+static size_t
+put_unsigned(char *buf, size_t len, uint32_t value, int min_digits)
+{
+  char digits[10];
+  int n;
+  size_t i;
+
+  n = 0;
+  do {
+    digits[n++] = '0' + (value % 10);
+    value /= 10;
+  } while(value > 0);
+
+  while(n < min_digits && n < (int)sizeof(digits)) {
+    digits[n++] = '0';
+  }
+
+  if((size_t)n > len) {
+    return 0;
+  }
+
+  for(i = 0; n > 0; i++) {
+    buf[i] = digits[--n];
+  }
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+/* Write a sign for negative values and return the magnitude. */
+static uint32_t
+put_sign(char **buf, size_t *len, int32_t value, size_t *sign_len)
+{
+  *sign_len = 0;
+  if(value >= 0) {
+    return (uint32_t)value;
+  }
+  if(*len > 0) {
+    **buf = '-';
+    (*buf)++;
+    (*len)--;
+    *sign_len = 1;
+  }
+  /* Negate in unsigned arithmetic so that INT32_MIN works too. */
+  return 0U - (uint32_t)value;
+}
+/*---------------------------------------------------------------------------*/
+size_t
+numfmt_utoa(char *buf, size_t len, uint32_t value)
+{
+  return put_unsigned(buf, len, value, 1);
+}
+/*---------------------------------------------------------------------------*/
+size_t
+numfmt_itoa(char *buf, size_t len, int32_t value)
+{
+  uint32_t magnitude;
+  size_t sign_len;
+  size_t n;
+
+  magnitude = put_sign(&buf, &len, value, &sign_len);
+  if(value < 0 && sign_len == 0) {
+    return 0;
+  }
+  n = put_unsigned(buf, len, magnitude, 1);
+  return n == 0 ? 0 : n + sign_len;
+}
+/*---------------------------------------------------------------------------*/
+size_t
+numfmt_hex(char *buf, size_t len, uint32_t value, int digits)
+{
+  static const char hex[] = "0123456789abcdef";
+  int n;
+  size_t i;
+
+  /* Count the significant digits. */
+  n = 1;
+  while(n < 8 && (value >> (n * 4)) != 0) {
+    n++;
+  }
+  if(digits > 8) {
+    digits = 8;
+  }
+  if(n < digits) {
+    n = digits;
+  }
+  if((size_t)n > len) {
+    return 0;
+  }
+
+  for(i = 0; i < (size_t)n; i++) {
+    buf[i] = hex[(value >> ((n - 1 - i) * 4)) & 0xf];
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static size_t
+put_fraction(char *buf, size_t len, uint32_t integer_part,
+             uint32_t fraction, int decimals, size_t sign_len)
+{
+  size_t n;
+  size_t m;
+
+  n = put_unsigned(buf, len, integer_part, 1);
+  if(n == 0) {
+    return 0;
+  }
+  if(decimals <= 0) {
+    return n + sign_len;
+  }
+  if(n >= len) {
+    return 0;
+  }
+  buf[n++] = '.';
+  m = put_unsigned(buf + n, len - n, fraction, decimals);
+  if(m == 0) {
+    return 0;
+  }
+  return n + m + sign_len;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+power_of_ten(int exponent)
+{
+  uint32_t p;
+
+  for(p = 1; exponent > 0; exponent--) {
+    p *= 10;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+size_t
+numfmt_decimal(char *buf, size_t len, int32_t value, int decimals)
+{
+  uint32_t magnitude;
+  uint32_t scale;
+  size_t sign_len;
+
+  if(decimals > 9) {
+    decimals = 9;
+  }
+  magnitude = put_sign(&buf, &len, value, &sign_len);
+  if(value < 0 && sign_len == 0) {
+    return 0;
+  }
+  scale = power_of_ten(decimals);
+  return put_fraction(buf, len, magnitude / scale, magnitude % scale,
+                      decimals, sign_len);
+}
+/*---------------------------------------------------------------------------*/
+size_t
+numfmt_fixpoint(char *buf, size_t len, int32_t value, int bits,
+                int decimals)
+{
+  uint32_t magnitude;
+  uint32_t mask;
+  uint32_t rest;
+  uint32_t fraction;
+  size_t sign_len;
+  int i;
+
+  if(decimals > 9) {
+    decimals = 9;
+  }
+  magnitude = put_sign(&buf, &len, value, &sign_len);
+  if(value < 0 && sign_len == 0) {
+    return 0;
+  }
+
+  /* Produce one fraction digit at a time, which keeps the arithmetic
+     within 32 bits as long as bits is at most 28. */
+  mask = (1UL << bits) - 1;
+  rest = magnitude & mask;
+  fraction = 0;
+  for(i = 0; i < decimals; i++) {
+    rest *= 10;
+    fraction = fraction * 10 + (rest >> bits);
+    rest &= mask;
+  }
+  return put_fraction(buf, len, magnitude >> bits, fraction, decimals,
+                      sign_len);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup lib
+ * @{
+ */
+
+/**
+ * \defgroup numfmt Number formatting
+ *
+ * Small replacements for the snprintf() conversions that serializers
+ * use for numbers: signed and unsigned decimal integers, hexadecimal,
+ * and fixed-point values as decimal fractions. They avoid pulling the
+ * formatted output code of the C library into the firmware and use
+ * little stack.
+ *
+ * Every function writes at most len bytes to buf, does not write a
+ * terminating null character, and returns the number of characters
+ * written. If the result does not fit, nothing useful is written and
+ * 0 is returned.
+ * @{
+ */
+
+#ifndef NUMFMT_H_
+#define NUMFMT_H_
+
+#include "contiki-conf.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** The longest output of any function, which is a negative value
+    with a sign, ten digits, a point and nine fraction digits. */
+#define NUMFMT_MAX_LEN 21
+
+/**
+ * \brief      Format an unsigned integer in decimal
+ * \param buf  The output buffer
+ * \param len  The size of the output buffer
+ * \param value The value
+ * \return     The number of characters written, or 0 if buf is too small
+ */
+size_t numfmt_utoa(char *buf, size_t len, uint32_t value);
+
+/**
+ * \brief      Format a signed integer in decimal
+ * \param buf  The output buffer
+ * \param len  The size of the output buffer
+ * \param value The value
+ * \return     The number of characters written, or 0 if buf is too small
+ */
+size_t numfmt_itoa(char *buf, size_t len, int32_t value);
+
+/**
+ * \brief      Format an unsigned integer in lower case hexadecimal
+ * \param buf  The output buffer
+ * \param len  The size of the output buffer
+ * \param value The value
+ * \param digits The minimum number of digits, padded with zeros
+ * \return     The number of characters written, or 0 if buf is too small
+ */
+size_t numfmt_hex(char *buf, size_t len, uint32_t value, int digits);
+
+/**
+ * \brief      Format a decimal fixed-point value
+ * \param buf  The output buffer
+ * \param len  The size of the output buffer
+ * \param value The value multiplied by 10 to the power of decimals
+ * \param decimals The number of fraction digits, at most 9
+ * \return     The number of characters written, or 0 if buf is too small
+ *
+ *             For example, a value of -1234 with 2 decimals is
+ *             formatted as "-12.34".
+ */
+size_t numfmt_decimal(char *buf, size_t len, int32_t value, int decimals);
+
+/**
+ * \brief      Format a binary fixed-point value as a decimal fraction
+ * \param buf  The output buffer
+ * \param len  The size of the output buffer
+ * \param value The value multiplied by 2 to the power of bits
+ * \param bits The number of fraction bits, at most 28
+ * \param decimals The number of fraction digits, at most 9
+ * \return     The number of characters written, or 0 if buf is too small
+ *
+ *             The fraction is truncated, not rounded.
+ */
+size_t numfmt_fixpoint(char *buf, size_t len, int32_t value, int bits,
+                       int decimals);
+
+#endif /* NUMFMT_H_ */
+
+/** @} */
+/** @} */
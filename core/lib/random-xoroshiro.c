@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         xoroshiro64* pseudo-random generator behind random_rand(), for
+ *         RANDOM_CONF_XOROSHIRO. It costs a few shifts and one 32-bit
+ *         multiplication per number. Unlike rand() seeded with a 16-bit
+ *         node-specific value, neighboring nodes do not get correlated
+ *         sequences.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+
+static uint32_t s[2] = { 1, 0 };
+
+#define ROTL(x, k) (((x) << (k)) | ((x) >> (32 - (k))))
+/*---------------------------------------------------------------------------*/
+/* splitmix32, which spreads seeds that differ in few bits */
+static uint32_t
+mix32(uint32_t z)
+{
+  z = (z ^ (z >> 16)) * 0x85ebca6bUL;
+  z = (z ^ (z >> 13)) * 0xc2b2ae35UL;
+  return z ^ (z >> 16);
+}
+/*---------------------------------------------------------------------------*/
+void
+random_xoroshiro_seed(uint32_t seed)
+{
+  s[0] = mix32(seed + 0x9e3779b9UL);
+  s[1] = mix32(seed + 2 * 0x9e3779b9UL);
+  if(s[0] == 0 && s[1] == 0) {
+    s[0] = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+random_xoroshiro_mix(uint32_t entropy)
+{
+  s[0] ^= mix32(entropy);
+  if(s[0] == 0 && s[1] == 0) {
+    s[0] = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+random_xoroshiro_rand(void)
+{
+  uint32_t s0 = s[0];
+  uint32_t s1 = s[1];
+  uint32_t result = s0 * 0x9e3779bbUL;
+
+  s1 ^= s0;
+  s[0] = ROTL(s0, 26) ^ s1 ^ (s1 << 9);
+  s[1] = ROTL(s1, 13);
+
+  /* The high bits are the well-distributed ones */
+  return (unsigned short)(result >> 16);
+}
+/*---------------------------------------------------------------------------*/
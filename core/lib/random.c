@@ -40,15 +40,23 @@
 void
 random_init(unsigned short seed)
 {
+#if RANDOM_XOROSHIRO
+  random_xoroshiro_seed(seed);
+#else /* RANDOM_XOROSHIRO */
   srand(seed);
+#endif /* RANDOM_XOROSHIRO */
 }
 /*---------------------------------------------------------------------------*/
 unsigned short
 random_rand(void)
 {
+#if RANDOM_XOROSHIRO
+  return random_xoroshiro_rand();
+#else /* RANDOM_XOROSHIRO */
 /* In gcc int rand() uses RAND_MAX and long random() uses RANDOM_MAX=0x7FFFFFFF */
 /* RAND_MAX varies depending on the architecture */
 
   return (unsigned short)rand();
+#endif /* RANDOM_XOROSHIRO */
 }
 /*---------------------------------------------------------------------------*/
@@ -32,6 +32,27 @@
 #ifndef RANDOM_H_
 #define RANDOM_H_
 
+#include "contiki-conf.h"
+
+/*
+ * With 1, random_rand() uses the xoroshiro64* generator of
+ * random-xoroshiro.c instead of rand(), or instead of reading the
+ * hardware RNG on every call on platforms that have one. Those
+ * platforms seed it from their RNG and mix fresh hardware entropy in
+ * every RANDOM_RESEED_INTERVAL numbers.
+ */
+#ifdef RANDOM_CONF_XOROSHIRO
+#define RANDOM_XOROSHIRO RANDOM_CONF_XOROSHIRO
+#else /* RANDOM_CONF_XOROSHIRO */
+#define RANDOM_XOROSHIRO 0
+#endif /* RANDOM_CONF_XOROSHIRO */
+
+#ifdef RANDOM_CONF_RESEED_INTERVAL
+#define RANDOM_RESEED_INTERVAL RANDOM_CONF_RESEED_INTERVAL
+#else /* RANDOM_CONF_RESEED_INTERVAL */
+#define RANDOM_RESEED_INTERVAL 256
+#endif /* RANDOM_CONF_RESEED_INTERVAL */
+
 /*
  * Initialize the pseudo-random generator.
  *
@@ -45,6 +66,14 @@ void random_init(unsigned short seed);
  */
 unsigned short random_rand(void);
 
+/*
+ * The xoroshiro64* generator, for the implementations of random_init()
+ * and random_rand().
+ */
+void random_xoroshiro_seed(uint32_t seed);
+void random_xoroshiro_mix(uint32_t entropy);
+unsigned short random_xoroshiro_rand(void);
+
 /* In gcc int rand() uses RAND_MAX and long random() uses RANDOM_MAX */
 /* Since random_rand casts to unsigned short, we'll use this maxmimum */
 #define RANDOM_RAND_MAX 65535U
@@ -39,6 +39,22 @@
 
 #include "lib/ringbuf.h"
 #include <sys/cc.h>
+#include <string.h>
+
+/*
+ * The block functions copy the data with memcpy() and then move the
+ * pointer. The barrier keeps the compiler from moving the copy past
+ * the pointer update. Platforms where the other side may run on
+ * another core or bus master can set RINGBUF_CONF_MEMORY_BARRIER to a
+ * hardware barrier, e.g. __DMB() on Cortex-M.
+ */
+#ifdef RINGBUF_CONF_MEMORY_BARRIER
+#define MEMORY_BARRIER() RINGBUF_CONF_MEMORY_BARRIER
+#elif defined(__GNUC__)
+#define MEMORY_BARRIER() __asm__ __volatile__("" : : : "memory")
+#else
+#define MEMORY_BARRIER()
+#endif
 /*---------------------------------------------------------------------------*/
 void
 ringbuf_init(struct ringbuf *r, uint8_t *dataptr, uint8_t size)
@@ -110,6 +126,72 @@ ringbuf_get(struct ringbuf *r)
 }
 /*---------------------------------------------------------------------------*/
 int
+ringbuf_put_n(struct ringbuf *r, const uint8_t *data, int len)
+{
+  uint8_t put_ptr;
+  int n, first;
+
+  /* Only the writer changes ->put_ptr, so it can be kept locally. */
+  put_ptr = r->put_ptr;
+  n = r->mask - ((put_ptr - CC_ACCESS_NOW(uint8_t, r->get_ptr)) & r->mask);
+  MEMORY_BARRIER();
+  if(len < n) {
+    n = len;
+  }
+  if(n <= 0) {
+    return 0;
+  }
+
+  first = MIN(n, r->mask + 1 - put_ptr);
+  memcpy(&r->data[put_ptr], data, first);
+  memcpy(r->data, data + first, n - first);
+
+  MEMORY_BARRIER();
+  CC_ACCESS_NOW(uint8_t, r->put_ptr) = (put_ptr + n) & r->mask;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbuf_peek(struct ringbuf *r, uint8_t **data)
+{
+  uint8_t get_ptr;
+  int n;
+
+  get_ptr = r->get_ptr;
+  n = (CC_ACCESS_NOW(uint8_t, r->put_ptr) - get_ptr) & r->mask;
+  MEMORY_BARRIER();
+
+  *data = &r->data[get_ptr];
+  return MIN(n, r->mask + 1 - get_ptr);
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbuf_consume(struct ringbuf *r, int len)
+{
+  MEMORY_BARRIER();
+  CC_ACCESS_NOW(uint8_t, r->get_ptr) = (r->get_ptr + len) & r->mask;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbuf_get_n(struct ringbuf *r, uint8_t *data, int len)
+{
+  uint8_t *p;
+  int n, done;
+
+  /* The buffered bytes may wrap around, in which case it takes two
+     contiguous copies. */
+  for(done = 0; done < len; done += n) {
+    n = MIN(ringbuf_peek(r, &p), len - done);
+    if(n == 0) {
+      break;
+    }
+    memcpy(data + done, p, n);
+    ringbuf_consume(r, n);
+  }
+  return done;
+}
+/*---------------------------------------------------------------------------*/
+int
 ringbuf_size(struct ringbuf *r)
 {
   return r->mask + 1;
@@ -115,6 +115,54 @@ int     ringbuf_put(struct ringbuf *r, uint8_t c);
  */
 int     ringbuf_get(struct ringbuf *r);
 
+/**
+ * \brief      Insert a block of bytes into the ring buffer
+ * \param r    A pointer to a struct ringbuf to hold the state of the ring buffer
+ * \param data A pointer to the bytes to be written to the buffer
+ * \param len  The number of bytes to be written
+ * \return     The number of bytes that were written, less than len if the buffer became full.
+ *
+ *             This function inserts as many bytes as there is room
+ *             for, and makes them visible to the reader all at
+ *             once. It is safe to call this function from an
+ *             interrupt handler, as long as there is only one writer.
+ */
+int     ringbuf_put_n(struct ringbuf *r, const uint8_t *data, int len);
+
+/**
+ * \brief      Get a block of bytes from the ring buffer
+ * \param r    A pointer to a struct ringbuf to hold the state of the ring buffer
+ * \param data A pointer to where the bytes should be stored
+ * \param len  The maximum number of bytes to get
+ * \return     The number of bytes that were removed from the buffer
+ *
+ *             It is safe to call this function from an interrupt
+ *             handler, as long as there is only one reader.
+ */
+int     ringbuf_get_n(struct ringbuf *r, uint8_t *data, int len);
+
+/**
+ * \brief      Look at the bytes in the ring buffer without removing them
+ * \param r    A pointer to a struct ringbuf to hold the state of the ring buffer
+ * \param data Set to point to the first byte in the buffer
+ * \return     The number of bytes that can be read from *data
+ *
+ *             This function gives the reader direct access to the
+ *             buffered bytes. Only the bytes up to the end of the
+ *             underlying array are returned; the remaining ones are
+ *             returned by the next call after ringbuf_consume(). The
+ *             bytes stay in the buffer until ringbuf_consume() is
+ *             called.
+ */
+int     ringbuf_peek(struct ringbuf *r, uint8_t **data);
+
+/**
+ * \brief      Remove bytes that have been read with ringbuf_peek()
+ * \param r    A pointer to a struct ringbuf to hold the state of the ring buffer
+ * \param len  The number of bytes to remove, at most the number returned by ringbuf_peek()
+ */
+void    ringbuf_consume(struct ringbuf *r, int len);
+
 /**
  * \brief      Get the size of a ring buffer
  * \param r    A pointer to a struct ringbuf to hold the state of the ring buffer
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Batched sensor sampling
+ */
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "lib/sensor-sampler.h"
+
+#include <string.h>
+
+LIST(samplers);
+
+PROCESS(sensor_sampler_process, "Sensor sampler");
+
+/*---------------------------------------------------------------------------*/
+static int16_t *
+block_at(const struct sensor_sampler *s, int index)
+{
+  return &s->buffer[(uint32_t)index * s->block_sets * s->channel_count];
+}
+/*---------------------------------------------------------------------------*/
+int16_t *
+sensor_sampler_current(struct sensor_sampler *s)
+{
+  int index;
+
+  index = ringbufindex_peek_put(&s->blocks);
+  if(index < 0) {
+    return NULL;
+  }
+  return block_at(s, index);
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_sampler_commit(struct sensor_sampler *s)
+{
+  if(ringbufindex_put(&s->blocks)) {
+    process_poll(&sensor_sampler_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_sampler_setup(struct sensor_sampler *s,
+                     const struct sensor_sampler_channel *channels,
+                     uint8_t channel_count, int16_t *buffer,
+                     uint16_t block_sets, uint8_t block_count,
+                     sensor_sampler_callback_t callback)
+{
+  memset(s, 0, sizeof(*s));
+  s->channels = channels;
+  s->channel_count = channel_count;
+  s->buffer = buffer;
+  s->block_sets = block_sets;
+  s->block_count = block_count;
+  s->callback = callback;
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_sampler_start(struct sensor_sampler *s, uint16_t rate)
+{
+  if(rate == 0 || s->channel_count == 0 || s->block_sets == 0 ||
+     s->block_count == 0 || s->block_count > 128 ||
+     (s->block_count & (s->block_count - 1)) != 0) {
+    return 0;
+  }
+
+  sensor_sampler_stop(s);
+
+  ringbufindex_init(&s->blocks, s->block_count);
+  s->rate = rate;
+  s->fill = 0;
+  s->overruns = 0;
+
+  if(!process_is_running(&sensor_sampler_process)) {
+    process_start(&sensor_sampler_process, NULL);
+  }
+  list_add(samplers, s);
+
+  if(!SENSOR_SAMPLER_DRIVER.start(s)) {
+    list_remove(samplers, s);
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_sampler_stop(struct sensor_sampler *s)
+{
+  struct sensor_sampler *n;
+
+  for(n = list_head(samplers); n != NULL; n = list_item_next(n)) {
+    if(n == s) {
+      SENSOR_SAMPLER_DRIVER.stop(s);
+      list_remove(samplers, s);
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sensor_sampler_process, ev, data)
+{
+  struct sensor_sampler *s;
+  int index;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    for(s = list_head(samplers); s != NULL; s = list_item_next(s)) {
+      while((index = ringbufindex_peek_get(&s->blocks)) >= 0) {
+        if(s->callback != NULL) {
+          s->callback(s, block_at(s, index), s->block_sets);
+        }
+        ringbufindex_get(&s->blocks);
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * The default driver reads all channels through the sensor API from a
+ * callback timer. The rate is limited by the clock resolution.
+ */
+static void
+timer_sample(void *ptr)
+{
+  struct sensor_sampler *s = ptr;
+  const struct sensor_sampler_channel *c;
+  int16_t *block;
+  int16_t *set;
+  uint8_t i;
+
+  ctimer_reset(&s->timer);
+
+  block = sensor_sampler_current(s);
+  if(block == NULL) {
+    s->overruns++;
+    return;
+  }
+
+  set = &block[(uint32_t)s->fill * s->channel_count];
+  for(i = 0; i < s->channel_count; i++) {
+    c = &s->channels[i];
+    set[i] = (int16_t)c->sensor->value(c->type);
+  }
+
+  if(++s->fill == s->block_sets) {
+    s->fill = 0;
+    sensor_sampler_commit(s);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+timer_start(struct sensor_sampler *s)
+{
+  clock_time_t interval;
+
+  interval = CLOCK_SECOND / s->rate;
+  if(interval == 0) {
+    interval = 1;
+  }
+  ctimer_set(&s->timer, interval, timer_sample, s);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+timer_stop(struct sensor_sampler *s)
+{
+  ctimer_stop(&s->timer);
+}
+/*---------------------------------------------------------------------------*/
+const struct sensor_sampler_driver sensor_sampler_timer_driver = {
+  "timer",
+  timer_start,
+  timer_stop
+};
+/*---------------------------------------------------------------------------*/
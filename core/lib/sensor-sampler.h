@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup lib
+ * @{
+ */
+
+/**
+ * \defgroup sensor-sampler Batched sensor sampling
+ *
+ * The sensor sampler reads a set of sensor channels at a fixed rate
+ * and stores the samples in a ring of blocks. A consumer is called
+ * from process context once per completed block instead of once per
+ * sample, which makes it suitable for feeding ifft() or for storing
+ * time series.
+ *
+ * Samples are stored as int16_t, interleaved per channel: a block
+ * holds block_sets sets of channel_count samples each.
+ *
+ * The actual sampling is done by a driver. The default driver reads
+ * the channels through the value() function of each sensor from a
+ * callback timer. Platforms with ADC sequencing and DMA can provide a
+ * driver that fills whole blocks in hardware, by setting
+ * SENSOR_SAMPLER_CONF_DRIVER. Such a driver gets the block to fill
+ * with sensor_sampler_current() and hands it over with
+ * sensor_sampler_commit(), which may be called from an interrupt.
+ *
+ * The sensors must be activated by the application before sampling
+ * is started.
+ * @{
+ */
+
+#ifndef SENSOR_SAMPLER_H_
+#define SENSOR_SAMPLER_H_
+
+#include "contiki.h"
+#include "lib/sensors.h"
+#include "lib/ringbufindex.h"
+
+#ifdef SENSOR_SAMPLER_CONF_DRIVER
+#define SENSOR_SAMPLER_DRIVER SENSOR_SAMPLER_CONF_DRIVER
+#else /* SENSOR_SAMPLER_CONF_DRIVER */
+#define SENSOR_SAMPLER_DRIVER sensor_sampler_timer_driver
+#endif /* SENSOR_SAMPLER_CONF_DRIVER */
+
+/** Declare a sample buffer for the given number of channels, sets per
+    block and blocks */
+#define SENSOR_SAMPLER_BUFFER(name, channels, sets, blocks)  \
+  static int16_t name[(channels) * (sets) * (blocks)]
+
+struct sensor_sampler;
+
+struct sensor_sampler_channel {
+  const struct sensors_sensor *sensor;
+  int type;
+};
+
+typedef void (* sensor_sampler_callback_t)(struct sensor_sampler *s,
+                                           const int16_t *samples,
+                                           uint16_t sets);
+
+struct sensor_sampler_driver {
+  char *name;
+  /** Start sampling at s->rate sets per second, returns 1 on success */
+  int (* start)(struct sensor_sampler *s);
+  void (* stop)(struct sensor_sampler *s);
+};
+
+struct sensor_sampler {
+  struct sensor_sampler *next;
+  const struct sensor_sampler_channel *channels;
+  int16_t *buffer;
+  sensor_sampler_callback_t callback;
+  /* Used by drivers that sample from a timer */
+  struct ctimer timer;
+  struct ringbufindex blocks;
+  uint16_t block_sets;
+  uint16_t rate;
+  /* Number of sets in the block being filled */
+  uint16_t fill;
+  /* Number of sets dropped because all blocks were in use */
+  uint16_t overruns;
+  uint8_t channel_count;
+  uint8_t block_count;
+};
+
+extern const struct sensor_sampler_driver SENSOR_SAMPLER_DRIVER;
+
+/**
+ * \brief      Set up a sampler
+ * \param s    The sampler
+ * \param channels The channels to sample
+ * \param channel_count The number of channels
+ * \param buffer The sample buffer, see SENSOR_SAMPLER_BUFFER()
+ * \param block_sets The number of sets in each block
+ * \param block_count The number of blocks, a power of two up to 128
+ * \param callback Called with each completed block
+ */
+void sensor_sampler_setup(struct sensor_sampler *s,
+                          const struct sensor_sampler_channel *channels,
+                          uint8_t channel_count, int16_t *buffer,
+                          uint16_t block_sets, uint8_t block_count,
+                          sensor_sampler_callback_t callback);
+
+/**
+ * \brief      Start sampling
+ * \param s    The sampler
+ * \param rate The number of sets to sample per second
+ * \return     1 if sampling was started, 0 otherwise
+ */
+int sensor_sampler_start(struct sensor_sampler *s, uint16_t rate);
+
+/**
+ * \brief      Stop sampling
+ * \param s    The sampler
+ *
+ *             Blocks that are completed but not yet delivered are
+ *             discarded.
+ */
+void sensor_sampler_stop(struct sensor_sampler *s);
+
+/**
+ * \brief      Get the block that the driver should fill next
+ * \param s    The sampler
+ * \return     The block, or NULL if all blocks are in use
+ */
+int16_t *sensor_sampler_current(struct sensor_sampler *s);
+
+/**
+ * \brief      Hand over the current block to the consumer
+ * \param s    The sampler
+ */
+void sensor_sampler_commit(struct sensor_sampler *s);
+
+#endif /* SENSOR_SAMPLER_H_ */
+
+/** @} */
+/** @} */
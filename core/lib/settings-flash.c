@@ -0,0 +1,862 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Log-structured flash backend for the settings manager
+ *
+ *         The settings are appended as records to a log that spans
+ *         SETTINGS_FLASH_SECTORS erase sectors, used in a ring. One
+ *         sector is always kept erased. When the log moves into it,
+ *         the live records of the oldest sector are copied to the new
+ *         head and the oldest sector is erased. A record is never
+ *         rewritten in place: it is only marked as obsolete by
+ *         clearing bits in its state byte.
+ *
+ *         The RAM index maps (key, index) to the offset of the live
+ *         record. It is built by scanning the log on first use,
+ *         oldest sector first, so that the newest copy of a record
+ *         wins if a write was interrupted.
+ */
+
+#ifdef SETTINGS_CONF_SKIP_CONVENIENCE_FUNCS
+#undef SETTINGS_CONF_SKIP_CONVENIENCE_FUNCS
+#endif
+
+#define SETTINGS_CONF_SKIP_CONVENIENCE_FUNCS 1
+
+#include "contiki.h"
+#include "settings.h"
+#include "dev/xmem.h"
+#include <stddef.h>
+
+#if CONTIKI_CONF_SETTINGS_MANAGER && SETTINGS_CONF_FLASH
+
+#ifndef SETTINGS_FLASH_CONF_OFFSET
+#error SETTINGS_CONF_FLASH has been set, but SETTINGS_FLASH_CONF_OFFSET hasnt!
+#endif
+#define SETTINGS_FLASH_OFFSET     ((uint32_t)SETTINGS_FLASH_CONF_OFFSET)
+
+#ifdef SETTINGS_FLASH_CONF_SECTOR_SIZE
+#define SETTINGS_FLASH_SECTOR_SIZE ((uint32_t)SETTINGS_FLASH_CONF_SECTOR_SIZE)
+#else
+#define SETTINGS_FLASH_SECTOR_SIZE ((uint32_t)XMEM_ERASE_UNIT_SIZE)
+#endif
+
+/** The number of sectors in the log, at least two. */
+#ifdef SETTINGS_FLASH_CONF_SECTORS
+#define SETTINGS_FLASH_SECTORS    SETTINGS_FLASH_CONF_SECTORS
+#else
+#define SETTINGS_FLASH_SECTORS    2
+#endif
+
+#if SETTINGS_FLASH_SECTORS < 2
+#error SETTINGS_FLASH_CONF_SECTORS must be at least 2
+#endif
+
+/** The maximum number of stored items, plus one. A power of two. */
+#ifdef SETTINGS_FLASH_CONF_INDEX_SIZE
+#define SETTINGS_FLASH_INDEX_SIZE SETTINGS_FLASH_CONF_INDEX_SIZE
+#else
+#define SETTINGS_FLASH_INDEX_SIZE 32
+#endif
+
+#if SETTINGS_FLASH_INDEX_SIZE & (SETTINGS_FLASH_INDEX_SIZE - 1)
+#error SETTINGS_FLASH_CONF_INDEX_SIZE must be a power of two
+#endif
+
+/** The value of an erased flash byte. */
+#ifdef SETTINGS_FLASH_CONF_ERASED
+#define SETTINGS_FLASH_ERASED     SETTINGS_FLASH_CONF_ERASED
+#else
+#define SETTINGS_FLASH_ERASED     0xFF
+#endif
+
+#define ERASED16                  ((uint16_t)(SETTINGS_FLASH_ERASED * 0x0101))
+
+/* Written after a sector has been erased, and when it is put to use. */
+#define SECTOR_ERASED_MAGIC       0x5345
+#define SECTOR_ACTIVE_MAGIC       0x5341
+
+/* Record states. Each state only flips bits of the erased value. */
+#define STATE_WRITING             SETTINGS_FLASH_ERASED
+#define STATE_VALID               (SETTINGS_FLASH_ERASED ^ 0x01)
+#define STATE_OBSOLETE            (SETTINGS_FLASH_ERASED ^ 0x03)
+
+typedef struct {
+  uint16_t erased;
+  uint16_t seqno;
+  uint16_t active;
+} sector_header_t;
+
+typedef struct {
+  uint8_t state;
+  uint8_t index;
+  settings_key_t key;
+  settings_length_t length;
+} record_header_t;
+
+typedef struct {
+  uint32_t offset;              /* 0 if the entry is unused */
+  settings_key_t key;
+  settings_length_t length;
+  uint8_t index;
+} index_entry_t;
+
+#define SECTOR_ADDR(s)  (SETTINGS_FLASH_OFFSET + \
+                         (uint32_t)(s) * SETTINGS_FLASH_SECTOR_SIZE)
+#define SECTOR_OF(o)    (((o) - SETTINGS_FLASH_OFFSET) / \
+                         SETTINGS_FLASH_SECTOR_SIZE)
+#define NEXT_SECTOR(s)  ((s) + 1 == SETTINGS_FLASH_SECTORS ? 0 : (s) + 1)
+#define FIRST_RECORD(s) (SECTOR_ADDR(s) + sizeof(sector_header_t))
+#define RECORD_SIZE(l)  (sizeof(record_header_t) + (uint32_t)(l))
+
+/* A record may fill at most half of a sector. */
+#define MAX_RECORD      MIN(RECORD_SIZE(SETTINGS_MAX_VALUE_SIZE), \
+                            (SETTINGS_FLASH_SECTOR_SIZE - \
+                             sizeof(sector_header_t)) / 2)
+
+/* The space available for live records. One sector is kept erased, and
+   each of the others may have up to a record's worth of unused space at
+   its end. */
+#define CAPACITY        ((SETTINGS_FLASH_SECTORS - 1) * \
+                         (SETTINGS_FLASH_SECTOR_SIZE - \
+                          sizeof(sector_header_t) - MAX_RECORD))
+
+static index_entry_t index_table[SETTINGS_FLASH_INDEX_SIZE];
+static uint16_t index_count;
+static uint32_t live_bytes;
+
+static uint8_t initialized;
+static uint8_t head;
+static uint16_t head_seqno;
+static uint32_t write_offset;
+
+/*****************************************************************************/
+// MARK: - Index
+/*****************************************************************************/
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+index_hash(settings_key_t key, uint8_t index)
+{
+  return (key ^ (key >> 7) ^ (index * 5)) & (SETTINGS_FLASH_INDEX_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static index_entry_t *
+index_find(settings_key_t key, uint8_t index)
+{
+  uint16_t i;
+
+  for(i = index_hash(key, index); index_table[i].offset != 0;
+      i = (i + 1) & (SETTINGS_FLASH_INDEX_SIZE - 1)) {
+    if(index_table[i].key == key && index_table[i].index == index) {
+      return &index_table[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static index_entry_t *
+index_add(settings_key_t key, uint8_t index)
+{
+  uint16_t i;
+
+  /* Keep one entry free so that probing always terminates. */
+  if(index_count >= SETTINGS_FLASH_INDEX_SIZE - 1) {
+    return NULL;
+  }
+  for(i = index_hash(key, index); index_table[i].offset != 0;
+      i = (i + 1) & (SETTINGS_FLASH_INDEX_SIZE - 1));
+  index_table[i].key = key;
+  index_table[i].index = index;
+  index_count++;
+  return &index_table[i];
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(index_entry_t *e)
+{
+  uint16_t i, j, k;
+
+  live_bytes -= RECORD_SIZE(e->length);
+  index_count--;
+
+  /* Move back the entries that probed past the removed one. */
+  i = j = e - index_table;
+  for(;;) {
+    j = (j + 1) & (SETTINGS_FLASH_INDEX_SIZE - 1);
+    if(index_table[j].offset == 0) {
+      break;
+    }
+    k = index_hash(index_table[j].key, index_table[j].index);
+    if(i <= j ? (i < k && k <= j) : (i < k || k <= j)) {
+      continue;
+    }
+    index_table[i] = index_table[j];
+    i = j;
+  }
+  index_table[i].offset = 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+index_count_key(settings_key_t key)
+{
+  uint8_t n;
+
+  for(n = 0; n < SETTINGS_LAST_INDEX && index_find(key, n) != NULL; n++);
+  return n;
+}
+
+/*****************************************************************************/
+// MARK: - Log
+/*****************************************************************************/
+
+/*---------------------------------------------------------------------------*/
+static void
+read_header(uint32_t offset, record_header_t *h)
+{
+  xmem_pread(h, sizeof(*h), offset);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+record_is_live(uint32_t offset, const record_header_t *h)
+{
+  index_entry_t *e;
+
+  if(h->state != STATE_VALID) {
+    return 0;
+  }
+  e = index_find(h->key, h->index);
+  return e != NULL && e->offset == offset;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+record_is_free(const record_header_t *h)
+{
+  return h->state == SETTINGS_FLASH_ERASED &&
+    h->index == SETTINGS_FLASH_ERASED &&
+    h->key == ERASED16 && h->length == ERASED16;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Returns the offset after the record at the given offset, or 0 at the
+ * end of the sector's log.
+ */
+static uint32_t
+record_next(uint8_t sector, uint32_t offset, const record_header_t *h)
+{
+  if(record_is_free(h)) {
+    return 0;
+  }
+  if(h->length > SECTOR_ADDR(sector) + SETTINGS_FLASH_SECTOR_SIZE -
+     offset - sizeof(*h)) {
+    /* A broken header; the rest of the sector is unusable. */
+    return 0;
+  }
+  return offset + RECORD_SIZE(h->length);
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_state(uint32_t offset, uint8_t state)
+{
+  xmem_pwrite(&state, 1, offset + offsetof(record_header_t, state));
+}
+/*---------------------------------------------------------------------------*/
+static void
+erase_sector(uint8_t sector)
+{
+  uint16_t magic = SECTOR_ERASED_MAGIC;
+
+  xmem_erase(SETTINGS_FLASH_SECTOR_SIZE, SECTOR_ADDR(sector));
+  xmem_pwrite(&magic, sizeof(magic),
+              SECTOR_ADDR(sector) + offsetof(sector_header_t, erased));
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+sector_is_active(uint8_t sector)
+{
+  sector_header_t h;
+
+  xmem_pread(&h, sizeof(h), SECTOR_ADDR(sector));
+  return h.active == SECTOR_ACTIVE_MAGIC;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Writes a record at the write offset, which must have room for it.
+ * The value is either taken from RAM, or copied from a record in flash.
+ */
+static uint32_t
+write_record(settings_key_t key, uint8_t index, const uint8_t *value,
+             uint32_t from, settings_length_t length)
+{
+  record_header_t h;
+  uint8_t buf[16];
+  uint32_t offset;
+  settings_length_t done, n;
+
+  offset = write_offset;
+  h.state = STATE_WRITING;
+  h.index = index;
+  h.key = key;
+  h.length = length;
+  xmem_pwrite(&h, sizeof(h), offset);
+
+  if(value != NULL) {
+    xmem_pwrite(value, length, offset + sizeof(h));
+  } else {
+    for(done = 0; done < length; done += n) {
+      n = MIN(sizeof(buf), length - done);
+      xmem_pread(buf, n, from + done);
+      xmem_pwrite(buf, n, offset + sizeof(h) + done);
+    }
+  }
+
+  /* The record only counts once it has been completely written. */
+  set_state(offset, STATE_VALID);
+  write_offset += RECORD_SIZE(length);
+  return offset;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Copies the live records of a sector to the head sector, and erases it.
+ */
+static void
+compact_sector(uint8_t sector)
+{
+  record_header_t h;
+  index_entry_t *e;
+  uint32_t offset, next;
+
+  for(offset = FIRST_RECORD(sector);
+      offset + sizeof(h) <= SECTOR_ADDR(sector) + SETTINGS_FLASH_SECTOR_SIZE;
+      offset = next) {
+    read_header(offset, &h);
+    next = record_next(sector, offset, &h);
+    if(next == 0) {
+      break;
+    }
+    if(record_is_live(offset, &h)) {
+      e = index_find(h.key, h.index);
+      e->offset = write_record(h.key, h.index, NULL,
+                               offset + sizeof(h), h.length);
+    }
+  }
+  erase_sector(sector);
+}
+/*---------------------------------------------------------------------------*/
+static void
+activate_sector(uint8_t sector)
+{
+  sector_header_t h;
+
+  xmem_pread(&h, sizeof(h), SECTOR_ADDR(sector));
+  if(h.erased != SECTOR_ERASED_MAGIC || h.seqno != ERASED16 ||
+     h.active != ERASED16) {
+    erase_sector(sector);
+  }
+
+  head = sector;
+  h.seqno = ++head_seqno;
+  h.active = SECTOR_ACTIVE_MAGIC;
+  xmem_pwrite(&h.seqno, sizeof(h.seqno),
+              SECTOR_ADDR(sector) + offsetof(sector_header_t, seqno));
+  xmem_pwrite(&h.active, sizeof(h.active),
+              SECTOR_ADDR(sector) + offsetof(sector_header_t, active));
+  write_offset = FIRST_RECORD(sector);
+}
+/*---------------------------------------------------------------------------*/
+static void
+advance_head(void)
+{
+  activate_sector(NEXT_SECTOR(head));
+
+  /* Keep the sector after the head erased. It is the oldest one, and
+     its live records fit in the new head. */
+  if(sector_is_active(NEXT_SECTOR(head))) {
+    compact_sector(NEXT_SECTOR(head));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+scan_sector(uint8_t sector)
+{
+  record_header_t h;
+  index_entry_t *e;
+  uint32_t offset, next;
+
+  for(offset = FIRST_RECORD(sector);
+      offset + sizeof(h) <= SECTOR_ADDR(sector) + SETTINGS_FLASH_SECTOR_SIZE;
+      offset = next) {
+    read_header(offset, &h);
+    next = record_next(sector, offset, &h);
+    if(next == 0) {
+      if(!record_is_free(&h)) {
+        /* Do not append after a broken record. */
+        offset = SECTOR_ADDR(sector) + SETTINGS_FLASH_SECTOR_SIZE;
+      }
+      break;
+    }
+    if(h.state != STATE_VALID) {
+      continue;
+    }
+    /* A later record replaces one that was not marked obsolete before
+       a reset. Mark it now, so that it cannot come back if the later
+       one is deleted. */
+    e = index_find(h.key, h.index);
+    if(e != NULL) {
+      set_state(e->offset, STATE_OBSOLETE);
+      live_bytes -= RECORD_SIZE(e->length);
+    } else {
+      e = index_add(h.key, h.index);
+      if(e == NULL) {
+        continue;
+      }
+    }
+    e->offset = offset;
+    e->length = h.length;
+    live_bytes += RECORD_SIZE(h.length);
+  }
+  write_offset = offset;
+}
+/*---------------------------------------------------------------------------*/
+static void
+format(void)
+{
+  uint8_t s;
+
+  memset(index_table, 0, sizeof(index_table));
+  index_count = 0;
+  live_bytes = 0;
+  for(s = 0; s < SETTINGS_FLASH_SECTORS; s++) {
+    erase_sector(s);
+  }
+  head_seqno = 0;
+  activate_sector(0);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+find_head(void)
+{
+  sector_header_t h;
+  uint8_t s, found;
+
+  found = 0;
+  for(s = 0; s < SETTINGS_FLASH_SECTORS; s++) {
+    xmem_pread(&h, sizeof(h), SECTOR_ADDR(s));
+    if(h.active == SECTOR_ACTIVE_MAGIC) {
+      if(!found || (int16_t)(h.seqno - head_seqno) > 0) {
+        head = s;
+        head_seqno = h.seqno;
+      }
+      found = 1;
+    }
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_init(void)
+{
+  uint8_t s;
+
+  if(initialized) {
+    return;
+  }
+  initialized = 1;
+
+  if(find_head() && sector_is_active(NEXT_SECTOR(head))) {
+    /* A compaction into the head was interrupted. The head only holds
+       copies, so drop it and compact again on the next write. */
+    erase_sector(head);
+    find_head();
+  }
+  if(!sector_is_active(head)) {
+    format();
+    return;
+  }
+
+  /* Scan from the oldest sector to the head. */
+  s = head;
+  do {
+    s = NEXT_SECTOR(s);
+    if(sector_is_active(s)) {
+      scan_sector(s);
+    }
+  } while(s != head);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Makes room in the head sector for a record, moving to a new sector
+ * if needed. The replaced record, if any, is still counted as live.
+ */
+static settings_status_t
+make_room(settings_length_t length, uint32_t replaced)
+{
+  uint8_t tries;
+
+  if(RECORD_SIZE(length) > MAX_RECORD) {
+    return SETTINGS_STATUS_VALUE_TOO_BIG;
+  }
+  if(live_bytes - replaced + RECORD_SIZE(length) > CAPACITY) {
+    return SETTINGS_STATUS_OUT_OF_SPACE;
+  }
+
+  for(tries = 0; write_offset + RECORD_SIZE(length) >
+      SECTOR_ADDR(head) + SETTINGS_FLASH_SECTOR_SIZE; tries++) {
+    if(tries == SETTINGS_FLASH_SECTORS) {
+      /* Too fragmented. */
+      return SETTINGS_STATUS_OUT_OF_SPACE;
+    }
+    advance_head();
+  }
+  return SETTINGS_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Points the index at a new record, and obsoletes the one it replaces.
+ */
+static void
+index_update(settings_key_t key, uint8_t index, uint32_t offset,
+             settings_length_t length)
+{
+  index_entry_t *e;
+
+  e = index_find(key, index);
+  if(e != NULL) {
+    set_state(e->offset, STATE_OBSOLETE);
+    live_bytes -= RECORD_SIZE(e->length);
+  } else {
+    e = index_add(key, index);
+  }
+  e->offset = offset;
+  e->length = length;
+  live_bytes += RECORD_SIZE(length);
+}
+/*---------------------------------------------------------------------------*/
+static settings_status_t
+store(settings_key_t key, uint8_t index, const uint8_t *value,
+      settings_length_t length)
+{
+  settings_status_t ret;
+  index_entry_t *e;
+  uint32_t offset;
+
+  if(key == SETTINGS_INVALID_KEY || index == SETTINGS_LAST_INDEX) {
+    return SETTINGS_STATUS_INVALID_ARGUMENT;
+  }
+
+  e = index_find(key, index);
+  if(e == NULL && index_count >= SETTINGS_FLASH_INDEX_SIZE - 1) {
+    return SETTINGS_STATUS_OUT_OF_SPACE;
+  }
+
+  ret = make_room(length, e != NULL ? RECORD_SIZE(e->length) : 0);
+  if(ret != SETTINGS_STATUS_OK) {
+    return ret;
+  }
+
+  offset = write_record(key, index, value, 0, length);
+  index_update(key, index, offset, length);
+  return SETTINGS_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+static settings_status_t
+delete_item(settings_key_t key, uint8_t index)
+{
+  index_entry_t *e;
+  uint32_t offset;
+  settings_length_t length;
+
+  e = index_find(key, index);
+  if(e == NULL) {
+    return SETTINGS_STATUS_NOT_FOUND;
+  }
+  set_state(e->offset, STATE_OBSOLETE);
+  index_remove(e);
+
+  /* Renumber the later items with the same key. */
+  for(index++; (e = index_find(key, index)) != NULL; index++) {
+    if(make_room(e->length, RECORD_SIZE(e->length)) != SETTINGS_STATUS_OK) {
+      return SETTINGS_STATUS_FAILURE;
+    }
+    /* Making room may have moved the record. */
+    e = index_find(key, index);
+    length = e->length;
+    offset = write_record(key, index - 1, NULL,
+                          e->offset + sizeof(record_header_t), length);
+    set_state(e->offset, STATE_OBSOLETE);
+    index_remove(e);
+    index_update(key, index - 1, offset, length);
+  }
+  return SETTINGS_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Returns the first live record at or after the given offset, searching
+ * up to the head sector.
+ */
+static settings_iter_t
+find_live(uint8_t sector, uint32_t offset)
+{
+  record_header_t h;
+  uint32_t next;
+
+  for(;;) {
+    for(; offset + sizeof(h) <= SECTOR_ADDR(sector) + SETTINGS_FLASH_SECTOR_SIZE;
+        offset = next) {
+      read_header(offset, &h);
+      next = record_next(sector, offset, &h);
+      if(next == 0) {
+        break;
+      }
+      if(record_is_live(offset, &h)) {
+        return offset;
+      }
+    }
+    if(sector == head) {
+      return SETTINGS_INVALID_ITER;
+    }
+    do {
+      sector = NEXT_SECTOR(sector);
+    } while(sector != head && !sector_is_active(sector));
+    offset = FIRST_RECORD(sector);
+  }
+}
+
+/*****************************************************************************/
+// MARK: - Public Travesal Functions
+/*****************************************************************************/
+
+/*---------------------------------------------------------------------------*/
+settings_iter_t
+settings_iter_begin()
+{
+  uint8_t s;
+
+  check_init();
+
+  /* Start at the oldest sector. */
+  s = head;
+  do {
+    s = NEXT_SECTOR(s);
+  } while(s != head && !sector_is_active(s));
+  return find_live(s, FIRST_RECORD(s));
+}
+/*---------------------------------------------------------------------------*/
+settings_iter_t
+settings_iter_next(settings_iter_t iter)
+{
+  record_header_t h;
+
+  if(!settings_iter_is_valid(iter)) {
+    return SETTINGS_INVALID_ITER;
+  }
+  read_header(iter, &h);
+  return find_live(SECTOR_OF(iter), iter + RECORD_SIZE(h.length));
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+settings_iter_is_valid(settings_iter_t iter)
+{
+  record_header_t h;
+
+  check_init();
+
+  if(iter < SETTINGS_FLASH_OFFSET + sizeof(sector_header_t) ||
+     iter >= SECTOR_ADDR(SETTINGS_FLASH_SECTORS)) {
+    return 0;
+  }
+  read_header(iter, &h);
+  return record_is_live(iter, &h);
+}
+/*---------------------------------------------------------------------------*/
+settings_key_t
+settings_iter_get_key(settings_iter_t iter)
+{
+  record_header_t h;
+
+  if(!settings_iter_is_valid(iter)) {
+    return SETTINGS_INVALID_KEY;
+  }
+  read_header(iter, &h);
+  return h.key;
+}
+/*---------------------------------------------------------------------------*/
+settings_length_t
+settings_iter_get_value_length(settings_iter_t iter)
+{
+  record_header_t h;
+
+  if(!settings_iter_is_valid(iter)) {
+    return 0;
+  }
+  read_header(iter, &h);
+  return h.length;
+}
+/*---------------------------------------------------------------------------*/
+settings_addr_t
+settings_iter_get_value_addr(settings_iter_t iter)
+{
+  return iter + sizeof(record_header_t);
+}
+/*---------------------------------------------------------------------------*/
+settings_length_t
+settings_iter_get_value_bytes(settings_iter_t iter, void *bytes,
+                              settings_length_t max_length)
+{
+  max_length = MIN(max_length, settings_iter_get_value_length(iter));
+
+  xmem_pread(bytes, max_length, settings_iter_get_value_addr(iter));
+
+  return max_length;
+}
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_iter_delete(settings_iter_t iter)
+{
+  record_header_t h;
+
+  if(!settings_iter_is_valid(iter)) {
+    return SETTINGS_STATUS_NOT_FOUND;
+  }
+  read_header(iter, &h);
+  return delete_item(h.key, h.index);
+}
+
+/*****************************************************************************/
+// MARK: - Public Functions
+/*****************************************************************************/
+
+/*---------------------------------------------------------------------------*/
+uint8_t
+settings_check(settings_key_t key, uint8_t index)
+{
+  check_init();
+
+  return index_find(key, index) != NULL;
+}
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_get(settings_key_t key, uint8_t index, uint8_t *value,
+             settings_length_t *value_size)
+{
+  index_entry_t *e;
+
+  check_init();
+
+  e = index_find(key, index);
+  if(e == NULL) {
+    return SETTINGS_STATUS_NOT_FOUND;
+  }
+
+  *value_size = MIN(*value_size, e->length);
+  xmem_pread(value, *value_size, e->offset + sizeof(record_header_t));
+  return SETTINGS_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_add(settings_key_t key, const uint8_t *value,
+             settings_length_t value_size)
+{
+  check_init();
+
+  return store(key, index_count_key(key), value, value_size);
+}
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_set(settings_key_t key, const uint8_t *value,
+             settings_length_t value_size)
+{
+  check_init();
+
+  /* Unlike the EEPROM backend, the size of the value may change. */
+  return store(key, 0, value, value_size);
+}
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_delete(settings_key_t key, uint8_t index)
+{
+  check_init();
+
+  return delete_item(key, index);
+}
+/*---------------------------------------------------------------------------*/
+void
+settings_wipe(void)
+{
+  initialized = 1;
+  format();
+}
+
+/*****************************************************************************/
+// MARK: - Other Functions
+/*****************************************************************************/
+
+#if DEBUG
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+void
+settings_debug_dump(void)
+{
+  settings_iter_t iter;
+
+  printf("{\n");
+  for(iter = settings_iter_begin(); iter; iter = settings_iter_next(iter)) {
+    settings_length_t len = settings_iter_get_value_length(iter);
+    settings_addr_t addr = settings_iter_get_value_addr(iter);
+    uint8_t byte;
+
+    union {
+      settings_key_t key;
+      char bytes[0];
+    } u;
+
+    u.key = settings_iter_get_key(iter);
+
+    printf("\t\"%c%c\" = <", u.bytes[0], u.bytes[1]);
+
+    for(; len; len--, addr++) {
+      xmem_pread(&byte, 1, addr);
+      printf("%02X", byte);
+      if(len != 1) {
+        printf(" ");
+      }
+    }
+
+    printf(">;\n");
+  }
+  printf("}\n");
+}
+#endif /* DEBUG */
+
+#endif /* CONTIKI_CONF_SETTINGS_MANAGER && SETTINGS_CONF_FLASH */
@@ -40,7 +40,7 @@
 #include "settings.h"
 #include "dev/eeprom.h"
 
-#if CONTIKI_CONF_SETTINGS_MANAGER
+#if CONTIKI_CONF_SETTINGS_MANAGER && !SETTINGS_CONF_FLASH
 
 #if !EEPROM_CONF_SIZE
 #error CONTIKI_CONF_SETTINGS_MANAGER has been set, but EEPROM_CONF_SIZE hasnt!
@@ -167,7 +167,7 @@ settings_iter_get_value_length(settings_iter_t iter)
 }
 
 /*---------------------------------------------------------------------------*/
-eeprom_addr_t
+settings_addr_t
 settings_iter_get_value_addr(settings_iter_t iter)
 {
   settings_length_t len = settings_iter_get_value_length(iter);
@@ -472,4 +472,4 @@ settings_debug_dump(void)
 }
 #endif /* DEBUG */
 
-#endif /* CONTIKI_CONF_SETTINGS_MANAGER */
+#endif /* CONTIKI_CONF_SETTINGS_MANAGER && !SETTINGS_CONF_FLASH */
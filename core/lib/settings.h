@@ -83,6 +83,18 @@
  *     of the size byte (or size_low byte).
  *   * The key has a value of 0x0000.
  *
+ *  ## Flash Backend ##
+ *
+ *  Setting SETTINGS_CONF_FLASH stores the settings in external NOR flash
+ *  (dev/xmem.h) instead. The store is then a log spread over
+ *  SETTINGS_FLASH_CONF_SECTORS erase sectors starting at
+ *  SETTINGS_FLASH_CONF_OFFSET. New and changed values are always
+ *  appended, and the oldest sector is compacted and erased once the log
+ *  wraps around, so writes are spread over all sectors. A RAM index of
+ *  SETTINGS_FLASH_CONF_INDEX_SIZE entries, built from the log on first
+ *  use, makes settings_get(), settings_check() and settings_set()
+ *  independent of the number of stored items.
+ *
  * @{ */
 
 #include <stdint.h>
@@ -90,6 +102,10 @@
 #include "dev/eeprom.h"
 #include "sys/cc.h"
 
+#ifndef SETTINGS_CONF_FLASH
+#define SETTINGS_CONF_FLASH  0
+#endif
+
 /*****************************************************************************/
 // MARK: - Types
 
@@ -139,7 +155,11 @@ typedef uint16_t settings_length_t;
 /** Returned when key is invalid. */
 #define SETTINGS_INVALID_KEY       0xFFFF
 /** Returned if no (further) element was found. */
+#if SETTINGS_CONF_FLASH
+#define SETTINGS_INVALID_ITER      0
+#else
 #define SETTINGS_INVALID_ITER      EEPROM_NULL
+#endif
 
 #ifndef SETTINGS_CONF_SUPPORT_LARGE_VALUES
 #define SETTINGS_CONF_SUPPORT_LARGE_VALUES  0
@@ -183,7 +203,14 @@ extern settings_status_t settings_delete(settings_key_t key, uint8_t index);
 /*****************************************************************************/
 // MARK: - Settings traversal functions
 
-typedef eeprom_addr_t settings_iter_t;
+#if SETTINGS_CONF_FLASH
+/** Flash offsets, for the flash backend. */
+typedef uint32_t settings_addr_t;
+#else
+typedef eeprom_addr_t settings_addr_t;
+#endif
+
+typedef settings_addr_t settings_iter_t;
 
 /** Will return \ref SETTINGS_INVALID_ITER if the settings store is empty. */
 extern settings_iter_t settings_iter_begin(void);
@@ -197,7 +224,7 @@ extern settings_key_t settings_iter_get_key(settings_iter_t iter);
 
 extern settings_length_t settings_iter_get_value_length(settings_iter_t iter);
 
-extern eeprom_addr_t settings_iter_get_value_addr(settings_iter_t iter);
+extern settings_addr_t settings_iter_get_value_addr(settings_iter_t iter);
 
 extern settings_length_t settings_iter_get_value_bytes(settings_iter_t item,
                                                        void *bytes,
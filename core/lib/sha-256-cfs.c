@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Hashing of CFS files, e.g. to verify a received image without
+ *         loading it into RAM.
+ */
+
+#include "lib/sha-256.h"
+#include "cfs/cfs.h"
+
+static uint8_t buf[SHA_256_FILE_BUF_SIZE];
+/*---------------------------------------------------------------------------*/
+uint32_t
+sha_256_update_from_file(struct sha_256_context *ctx, int fd, uint32_t len)
+{
+  uint32_t done;
+  int n;
+
+  for(done = 0; done < len; done += n) {
+    n = len - done < sizeof(buf) ? len - done : sizeof(buf);
+    n = cfs_read(fd, buf, n);
+    if(n <= 0) {
+      break;
+    }
+    SHA_256.update(ctx, buf, n);
+  }
+  return done;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+sha_256_hmac_update_from_file(struct sha_256_hmac_context *hmac,
+                              int fd, uint32_t len)
+{
+  return sha_256_update_from_file(&hmac->ctx, fd, len);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         SHA-256 (FIPS 180-4) in software, and HMAC-SHA-256 on top of
+ *         the SHA_256 driver.
+ */
+
+#include "lib/sha-256.h"
+#include "lib/assert.h"
+#include <string.h>
+
+struct sw_state {
+  uint32_t state[8];
+  uint32_t bit_count[2];
+  uint8_t buf[SHA_256_BLOCK_SIZE];
+  uint8_t buf_len;
+};
+
+CTASSERT(sizeof(struct sw_state) <= SHA_256_CONTEXT_SIZE);
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint32_t k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+/*---------------------------------------------------------------------------*/
+static void
+compress(struct sw_state *ctx, const uint8_t *block)
+{
+  uint32_t w[16];
+  uint32_t a, b, c, d, e, f, g, h, t1, t2;
+  int i;
+
+  for(i = 0; i < 16; i++) {
+    w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 |
+      (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+  }
+
+  a = ctx->state[0];
+  b = ctx->state[1];
+  c = ctx->state[2];
+  d = ctx->state[3];
+  e = ctx->state[4];
+  f = ctx->state[5];
+  g = ctx->state[6];
+  h = ctx->state[7];
+
+  for(i = 0; i < 64; i++) {
+    /* The message schedule is kept in a 16-word ring */
+    if(i >= 16) {
+      uint32_t w15 = w[(i - 15) & 15];
+      uint32_t w2 = w[(i - 2) & 15];
+      w[i & 15] += (ROTR(w15, 7) ^ ROTR(w15, 18) ^ (w15 >> 3)) +
+        w[(i - 7) & 15] + (ROTR(w2, 17) ^ ROTR(w2, 19) ^ (w2 >> 10));
+    }
+    t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) +
+      k[i] + w[i & 15];
+    t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  ctx->state[0] += a;
+  ctx->state[1] += b;
+  ctx->state[2] += c;
+  ctx->state[3] += d;
+  ctx->state[4] += e;
+  ctx->state[5] += f;
+  ctx->state[6] += g;
+  ctx->state[7] += h;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(struct sha_256_context *context)
+{
+  struct sw_state *ctx = (struct sw_state *)&context->state;
+
+  ctx->state[0] = 0x6a09e667;
+  ctx->state[1] = 0xbb67ae85;
+  ctx->state[2] = 0x3c6ef372;
+  ctx->state[3] = 0xa54ff53a;
+  ctx->state[4] = 0x510e527f;
+  ctx->state[5] = 0x9b05688c;
+  ctx->state[6] = 0x1f83d9ab;
+  ctx->state[7] = 0x5be0cd19;
+  ctx->bit_count[0] = ctx->bit_count[1] = 0;
+  ctx->buf_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update(struct sha_256_context *context, const uint8_t *data, uint16_t len)
+{
+  struct sw_state *ctx = (struct sw_state *)&context->state;
+  uint32_t bits = (uint32_t)len << 3;
+  uint16_t n;
+
+  ctx->bit_count[0] += bits;
+  if(ctx->bit_count[0] < bits) {
+    ctx->bit_count[1]++;
+  }
+
+  while(len > 0) {
+    if(ctx->buf_len == 0 && len >= SHA_256_BLOCK_SIZE) {
+      compress(ctx, data);
+      n = SHA_256_BLOCK_SIZE;
+    } else {
+      n = SHA_256_BLOCK_SIZE - ctx->buf_len;
+      if(n > len) {
+        n = len;
+      }
+      memcpy(ctx->buf + ctx->buf_len, data, n);
+      ctx->buf_len += n;
+      if(ctx->buf_len == SHA_256_BLOCK_SIZE) {
+        compress(ctx, ctx->buf);
+        ctx->buf_len = 0;
+      }
+    }
+    data += n;
+    len -= n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+finalize(struct sha_256_context *context,
+         uint8_t digest[SHA_256_DIGEST_LENGTH])
+{
+  struct sw_state *ctx = (struct sw_state *)&context->state;
+  int i;
+
+  ctx->buf[ctx->buf_len++] = 0x80;
+  if(ctx->buf_len > SHA_256_BLOCK_SIZE - 8) {
+    memset(ctx->buf + ctx->buf_len, 0, SHA_256_BLOCK_SIZE - ctx->buf_len);
+    compress(ctx, ctx->buf);
+    ctx->buf_len = 0;
+  }
+  memset(ctx->buf + ctx->buf_len, 0, SHA_256_BLOCK_SIZE - 8 - ctx->buf_len);
+  for(i = 0; i < 4; i++) {
+    ctx->buf[56 + i] = ctx->bit_count[1] >> (24 - 8 * i);
+    ctx->buf[60 + i] = ctx->bit_count[0] >> (24 - 8 * i);
+  }
+  compress(ctx, ctx->buf);
+
+  for(i = 0; i < SHA_256_DIGEST_LENGTH; i++) {
+    digest[i] = ctx->state[i / 4] >> (24 - 8 * (i % 4));
+  }
+}
+/*---------------------------------------------------------------------------*/
+const struct sha_256_driver sha_256_driver = {
+  init,
+  update,
+  finalize
+};
+/*---------------------------------------------------------------------------*/
+void
+sha_256_hash(const uint8_t *data, uint16_t len,
+             uint8_t digest[SHA_256_DIGEST_LENGTH])
+{
+  struct sha_256_context ctx;
+
+  SHA_256.init(&ctx);
+  SHA_256.update(&ctx, data, len);
+  SHA_256.finalize(&ctx, digest);
+}
+/*---------------------------------------------------------------------------*/
+static void
+xor_key(struct sha_256_hmac_context *hmac, uint8_t pad)
+{
+  int i;
+
+  for(i = 0; i < SHA_256_BLOCK_SIZE; i++) {
+    hmac->key[i] ^= pad;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sha_256_hmac_init(struct sha_256_hmac_context *hmac,
+                  const uint8_t *key, uint16_t key_len)
+{
+  memset(hmac->key, 0, sizeof(hmac->key));
+  if(key_len > SHA_256_BLOCK_SIZE) {
+    sha_256_hash(key, key_len, hmac->key);
+  } else {
+    memcpy(hmac->key, key, key_len);
+  }
+
+  xor_key(hmac, 0x36);
+  SHA_256.init(&hmac->ctx);
+  SHA_256.update(&hmac->ctx, hmac->key, SHA_256_BLOCK_SIZE);
+  /* Keep the outer padded key for sha_256_hmac_finalize() */
+  xor_key(hmac, 0x36 ^ 0x5c);
+}
+/*---------------------------------------------------------------------------*/
+void
+sha_256_hmac_update(struct sha_256_hmac_context *hmac,
+                    const uint8_t *data, uint16_t len)
+{
+  SHA_256.update(&hmac->ctx, data, len);
+}
+/*---------------------------------------------------------------------------*/
+void
+sha_256_hmac_finalize(struct sha_256_hmac_context *hmac,
+                      uint8_t mac[SHA_256_DIGEST_LENGTH])
+{
+  uint8_t inner[SHA_256_DIGEST_LENGTH];
+
+  SHA_256.finalize(&hmac->ctx, inner);
+  SHA_256.init(&hmac->ctx);
+  SHA_256.update(&hmac->ctx, hmac->key, SHA_256_BLOCK_SIZE);
+  SHA_256.update(&hmac->ctx, inner, SHA_256_DIGEST_LENGTH);
+  SHA_256.finalize(&hmac->ctx, mac);
+  memset(hmac->key, 0, sizeof(hmac->key));
+}
+/*---------------------------------------------------------------------------*/
+void
+sha_256_hmac(const uint8_t *key, uint16_t key_len,
+             const uint8_t *data, uint16_t len,
+             uint8_t mac[SHA_256_DIGEST_LENGTH])
+{
+  struct sha_256_hmac_context hmac;
+
+  sha_256_hmac_init(&hmac, key, key_len);
+  sha_256_hmac_update(&hmac, data, len);
+  sha_256_hmac_finalize(&hmac, mac);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         SHA-256 (FIPS 180-4) and HMAC-SHA-256 (RFC 2104).
+ */
+#ifndef SHA_256_H_
+#define SHA_256_H_
+
+#include "contiki.h"
+
+#ifdef SHA_256_CONF
+#define SHA_256 SHA_256_CONF
+#else /* SHA_256_CONF */
+#define SHA_256 sha_256_driver
+#endif /* SHA_256_CONF */
+
+/* Room for the state of the SHA_256 driver, in bytes */
+#ifdef SHA_256_CONF_CONTEXT_SIZE
+#define SHA_256_CONTEXT_SIZE SHA_256_CONF_CONTEXT_SIZE
+#else /* SHA_256_CONF_CONTEXT_SIZE */
+#define SHA_256_CONTEXT_SIZE 108
+#endif /* SHA_256_CONF_CONTEXT_SIZE */
+
+/* Size of the buffer used to read files in sha_256_update_from_file() */
+#ifdef SHA_256_CONF_FILE_BUF_SIZE
+#define SHA_256_FILE_BUF_SIZE SHA_256_CONF_FILE_BUF_SIZE
+#else /* SHA_256_CONF_FILE_BUF_SIZE */
+#define SHA_256_FILE_BUF_SIZE 128
+#endif /* SHA_256_CONF_FILE_BUF_SIZE */
+
+#define SHA_256_DIGEST_LENGTH 32
+#define SHA_256_BLOCK_SIZE    64
+
+/**
+ * State of a hash, only accessed by the SHA_256 driver.
+ */
+struct sha_256_context {
+  union {
+    uint64_t align;
+    uint8_t u8[SHA_256_CONTEXT_SIZE];
+  } state;
+};
+
+/**
+ * Structure of SHA-256 drivers.
+ */
+struct sha_256_driver {
+
+  /**
+   * \brief  Starts a new hash.
+   */
+  void (* init)(struct sha_256_context *ctx);
+
+  /**
+   * \brief  Adds data to the hash.
+   */
+  void (* update)(struct sha_256_context *ctx,
+                  const uint8_t *data, uint16_t len);
+
+  /**
+   * \brief  Ends the hash and writes the digest.
+   */
+  void (* finalize)(struct sha_256_context *ctx,
+                    uint8_t digest[SHA_256_DIGEST_LENGTH]);
+};
+
+/**
+ * State of an HMAC.
+ */
+struct sha_256_hmac_context {
+  struct sha_256_context ctx;
+  uint8_t key[SHA_256_BLOCK_SIZE];
+};
+
+/**
+ * \brief  Hashes data in one call.
+ */
+void sha_256_hash(const uint8_t *data, uint16_t len,
+                  uint8_t digest[SHA_256_DIGEST_LENGTH]);
+
+/**
+ * \brief  Starts a new HMAC. Keys longer than SHA_256_BLOCK_SIZE bytes
+ *         are hashed first.
+ */
+void sha_256_hmac_init(struct sha_256_hmac_context *hmac,
+                       const uint8_t *key, uint16_t key_len);
+
+/**
+ * \brief  Adds data to the HMAC.
+ */
+void sha_256_hmac_update(struct sha_256_hmac_context *hmac,
+                         const uint8_t *data, uint16_t len);
+
+/**
+ * \brief  Ends the HMAC and writes it to mac.
+ */
+void sha_256_hmac_finalize(struct sha_256_hmac_context *hmac,
+                           uint8_t mac[SHA_256_DIGEST_LENGTH]);
+
+/**
+ * \brief  Computes the HMAC of data in one call.
+ */
+void sha_256_hmac(const uint8_t *key, uint16_t key_len,
+                  const uint8_t *data, uint16_t len,
+                  uint8_t mac[SHA_256_DIGEST_LENGTH]);
+
+/**
+ * \brief     Adds len bytes read from the CFS file fd to the hash, from
+ *            the current position of the file.
+ * \return    The number of bytes added, which is less than len if the
+ *            end of the file or an error came first
+ */
+uint32_t sha_256_update_from_file(struct sha_256_context *ctx,
+                                  int fd, uint32_t len);
+
+/**
+ * \brief  Same as sha_256_update_from_file(), for an HMAC.
+ */
+uint32_t sha_256_hmac_update_from_file(struct sha_256_hmac_context *hmac,
+                                       int fd, uint32_t len);
+
+extern const struct sha_256_driver sha_256_driver;
+extern const struct sha_256_driver SHA_256;
+
+#endif /* SHA_256_H_ */
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup slab
+ * @{
+ */
+
+/**
+ * \file
+ *         Shared size-class allocator over memb
+ */
+
+#include "contiki.h"
+#include "lib/memb.h"
+#include "lib/slab.h"
+
+#include <stdint.h>
+
+#ifdef SLAB_CONF_CLASS0_SIZE
+#define SLAB_CLASS0_SIZE SLAB_CONF_CLASS0_SIZE
+#else
+#define SLAB_CLASS0_SIZE 32
+#endif
+#ifdef SLAB_CONF_CLASS0_NUM
+#define SLAB_CLASS0_NUM SLAB_CONF_CLASS0_NUM
+#else
+#define SLAB_CLASS0_NUM 16
+#endif
+
+#ifdef SLAB_CONF_CLASS1_SIZE
+#define SLAB_CLASS1_SIZE SLAB_CONF_CLASS1_SIZE
+#else
+#define SLAB_CLASS1_SIZE 64
+#endif
+#ifdef SLAB_CONF_CLASS1_NUM
+#define SLAB_CLASS1_NUM SLAB_CONF_CLASS1_NUM
+#else
+#define SLAB_CLASS1_NUM 16
+#endif
+
+#ifdef SLAB_CONF_CLASS2_SIZE
+#define SLAB_CLASS2_SIZE SLAB_CONF_CLASS2_SIZE
+#else
+#define SLAB_CLASS2_SIZE 128
+#endif
+#ifdef SLAB_CONF_CLASS2_NUM
+#define SLAB_CLASS2_NUM SLAB_CONF_CLASS2_NUM
+#else
+#define SLAB_CLASS2_NUM 8
+#endif
+
+#ifdef SLAB_CONF_CLASS3_SIZE
+#define SLAB_CLASS3_SIZE SLAB_CONF_CLASS3_SIZE
+#else
+#define SLAB_CLASS3_SIZE 256
+#endif
+#ifdef SLAB_CONF_CLASS3_NUM
+#define SLAB_CLASS3_NUM SLAB_CONF_CLASS3_NUM
+#else
+#define SLAB_CLASS3_NUM 8
+#endif
+
+#if SLAB_CLASS0_NUM + SLAB_CLASS1_NUM + SLAB_CLASS2_NUM + SLAB_CLASS3_NUM == 0
+#error "The slab allocator needs at least one size class"
+#endif
+
+/* The blocks of a class, aligned for any of the structures that the
+   network stack keeps in memb */
+#define SLAB_CLASS(n, size, num)                                        \
+  typedef union {                                                       \
+    uint8_t data[size];                                                 \
+    uint32_t align_u32;                                                 \
+    void *align_ptr;                                                    \
+  } slab_block##n##_t;                                                  \
+  MEMB_FREELIST(slab_class##n##_memb, slab_block##n##_t, num)
+
+#if SLAB_CLASS0_NUM > 0
+SLAB_CLASS(0, SLAB_CLASS0_SIZE, SLAB_CLASS0_NUM);
+#endif
+#if SLAB_CLASS1_NUM > 0
+SLAB_CLASS(1, SLAB_CLASS1_SIZE, SLAB_CLASS1_NUM);
+#endif
+#if SLAB_CLASS2_NUM > 0
+SLAB_CLASS(2, SLAB_CLASS2_SIZE, SLAB_CLASS2_NUM);
+#endif
+#if SLAB_CLASS3_NUM > 0
+SLAB_CLASS(3, SLAB_CLASS3_SIZE, SLAB_CLASS3_NUM);
+#endif
+
+struct slab_class {
+  struct memb *memb;
+  unsigned short used;
+  unsigned short peak;
+};
+
+static struct slab_class classes[] = {
+#if SLAB_CLASS0_NUM > 0
+  { &slab_class0_memb, 0, 0 },
+#endif
+#if SLAB_CLASS1_NUM > 0
+  { &slab_class1_memb, 0, 0 },
+#endif
+#if SLAB_CLASS2_NUM > 0
+  { &slab_class2_memb, 0, 0 },
+#endif
+#if SLAB_CLASS3_NUM > 0
+  { &slab_class3_memb, 0, 0 },
+#endif
+};
+
+#define NUM_CLASSES (sizeof(classes) / sizeof(classes[0]))
+
+/*---------------------------------------------------------------------------*/
+void *
+slab_alloc(struct slab_owner *o)
+{
+  int i;
+  void *ptr;
+
+  if(o->quota > 0 && o->used >= o->quota) {
+    o->failed++;
+    return NULL;
+  }
+
+  /* Fall back on larger classes when the best fitting one is used up */
+  for(i = 0; i < NUM_CLASSES; i++) {
+    if(classes[i].memb->size < o->size) {
+      continue;
+    }
+    ptr = memb_alloc(classes[i].memb);
+    if(ptr != NULL) {
+      if(++classes[i].used > classes[i].peak) {
+        classes[i].peak = classes[i].used;
+      }
+      if(++o->used > o->peak) {
+        o->peak = o->used;
+      }
+      return ptr;
+    }
+  }
+
+  o->failed++;
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+char
+slab_free(struct slab_owner *o, void *ptr)
+{
+  int i;
+
+  for(i = 0; i < NUM_CLASSES; i++) {
+    if(memb_inmemb(classes[i].memb, ptr)) {
+      memb_free(classes[i].memb, ptr);
+      classes[i].used--;
+      o->used--;
+      return 0;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+slab_numfree(const struct slab_owner *o)
+{
+  int i;
+  int num_free = 0;
+
+  for(i = 0; i < NUM_CLASSES; i++) {
+    if(classes[i].memb->size >= o->size) {
+      num_free += classes[i].memb->num - classes[i].used;
+    }
+  }
+
+  if(o->quota > 0 && num_free > o->quota - o->used) {
+    num_free = o->quota - o->used;
+  }
+  return num_free;
+}
+/*---------------------------------------------------------------------------*/
+void
+slab_reset_peak(struct slab_owner *o)
+{
+  o->peak = o->used;
+}
+/*---------------------------------------------------------------------------*/
+int
+slab_num_classes(void)
+{
+  return NUM_CLASSES;
+}
+/*---------------------------------------------------------------------------*/
+int
+slab_get_class_info(int class, struct slab_class_info *info)
+{
+  if(class < 0 || class >= NUM_CLASSES) {
+    return 0;
+  }
+  info->size = classes[class].memb->size;
+  info->num = classes[class].memb->num;
+  info->used = classes[class].used;
+  info->peak = classes[class].peak;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+
+/** @} */
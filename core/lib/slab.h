@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup mem
+ * @{
+ */
+
+/**
+ * \defgroup slab Shared size-class allocator
+ *
+ * The slab allocator lets modules that would each declare their own
+ * MEMB() share one set of memory blocks. The blocks come in a few
+ * size classes, each an ordinary memb. An object is taken from the
+ * smallest class it fits in, or from a larger class when that one is
+ * used up. Each user is declared with SLAB_OWNER(), which works like
+ * MEMB() except that the number of objects is a quota that is not
+ * reserved: RAM left idle by one owner can be used by another.
+ *
+ * The classes are set with SLAB_CONF_CLASSn_SIZE and
+ * SLAB_CONF_CLASSn_NUM, n from 0 to 3, in increasing order of size.
+ * A class with NUM set to 0 is left out. Objects larger than the
+ * largest class can not be allocated.
+ *
+ * @{
+ */
+
+/**
+ * \file
+ *         Header file for the shared size-class allocator
+ */
+
+#ifndef SLAB_H_
+#define SLAB_H_
+
+#include "contiki-conf.h"
+
+/**
+ * \brief A user of the shared blocks
+ */
+struct slab_owner {
+  /** The size of the owner's objects */
+  unsigned short size;
+  /** The most objects the owner may hold, 0 for no limit */
+  unsigned short quota;
+  /** Objects currently held */
+  unsigned short used;
+  /** The highest number of objects held at once */
+  unsigned short peak;
+  /** Allocations that failed */
+  unsigned short failed;
+};
+
+/**
+ * Declare a user of the shared blocks.
+ *
+ * \param name The name of the owner (later used with slab_alloc() and
+ * slab_free())
+ *
+ * \param structure The type of the objects the owner allocates
+ *
+ * \param quota The most objects the owner may hold at once, 0 for no
+ * limit
+ */
+#define SLAB_OWNER(name, structure, quota) \
+        static struct slab_owner name = {sizeof(structure), quota, 0, 0, 0}
+
+/** \brief The state of a size class */
+struct slab_class_info {
+  /** The size of the blocks */
+  unsigned short size;
+  /** The number of blocks */
+  unsigned short num;
+  /** Blocks in use */
+  unsigned short used;
+  /** The highest number of blocks in use at once */
+  unsigned short peak;
+};
+
+/**
+ * Allocate an object.
+ *
+ * \param o An owner declared with SLAB_OWNER().
+ * \return A block for the object, or NULL if the owner has reached its
+ * quota or no block is free.
+ */
+void *slab_alloc(struct slab_owner *o);
+
+/**
+ * Free an object.
+ *
+ * \param o The owner of the object.
+ * \param ptr The object, from slab_alloc().
+ * \return 0 if the object was freed, -1 if ptr is not a block from
+ * the slab allocator.
+ */
+char slab_free(struct slab_owner *o, void *ptr);
+
+/**
+ * The number of objects the owner can allocate right now.
+ */
+int slab_numfree(const struct slab_owner *o);
+
+/**
+ * Restart the high-water mark of an owner from its current use.
+ */
+void slab_reset_peak(struct slab_owner *o);
+
+/**
+ * The number of size classes.
+ */
+int slab_num_classes(void);
+
+/**
+ * Get the state of a size class.
+ *
+ * \param class The class, from 0 to slab_num_classes() - 1, smallest first
+ * \param info Filled in with the state of the class
+ * \return 1 if class is valid, 0 otherwise
+ */
+int slab_get_class_info(int class, struct slab_class_info *info);
+
+#endif /* SLAB_H_ */
+
+/** @} */
+/** @} */
@@ -46,6 +46,7 @@
 #include "sys/ctimer.h"
 #include "sys/cc.h"
 #include "lib/random.h"
+#include "lib/list.h"
 /*---------------------------------------------------------------------------*/
 #define DEBUG 0
 
@@ -73,6 +74,12 @@ static clock_time_t loc_clock; /* A local, general-purpose placeholder */
 
 static void fire(void *ptr);
 static void double_interval(void *ptr);
+
+#if TRICKLE_TIMER_SHARED
+LIST(shared_queue);             /* Running timers, sorted by deadline */
+static struct ctimer shared_ct; /* Wakes us up for the head of the queue */
+static uint8_t shared_running;  /* Set while the queue is being processed */
+#endif
 /*---------------------------------------------------------------------------*/
 /* Local utilities and functions to be used as ctimer callbacks */
 /*---------------------------------------------------------------------------*/
@@ -165,6 +172,129 @@ get_t(clock_time_t i_cur)
   return i_cur + (tt_rand() % i_cur);
 }
 /*---------------------------------------------------------------------------*/
+#if TRICKLE_TIMER_SHARED
+/* Non-zero if absolute time a is before absolute time b */
+static int
+is_before(clock_time_t a, clock_time_t b)
+{
+  return (clock_time_t)(a - b) > (TRICKLE_TIMER_CLOCK_MAX >> 1);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Non-zero if tt may be handled on a wake-up at now: either its deadline has
+ * been reached, or it falls within the coalescing window and handling it now
+ * keeps a transmission within [I/2, I)
+ */
+static int
+is_due(struct trickle_timer *tt, clock_time_t now)
+{
+  if(!is_before(now, tt->deadline)) {
+    return 1;
+  }
+  if((clock_time_t)(tt->deadline - now) > TRICKLE_TIMER_SHARED_WINDOW) {
+    return 0;
+  }
+  return tt->handler != fire ||
+    !is_before(now, tt->i_start + (tt->i_cur >> 1));
+}
+/*---------------------------------------------------------------------------*/
+static void shared_run(void *ptr);
+
+static void
+shared_reschedule(void)
+{
+  struct trickle_timer *head = list_head(shared_queue);
+  clock_time_t now = clock_time();
+
+  if(head == NULL) {
+    ctimer_stop(&shared_ct);
+  } else if(is_before(head->deadline, now)) {
+    ctimer_set(&shared_ct, 0, shared_run, NULL);
+  } else {
+    ctimer_set(&shared_ct, head->deadline - now, shared_run, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* ctimer callback of the shared queue. Runs every timer that is due now */
+static void
+shared_run(void *ptr)
+{
+  struct trickle_timer *tt;
+  clock_time_t now = clock_time();
+
+  shared_running = 1;
+  for(;;) {
+    /* The queue is sorted, so stop looking past the coalescing window */
+    for(tt = list_head(shared_queue); tt != NULL; tt = list_item_next(tt)) {
+      if(is_due(tt, now)) {
+        break;
+      }
+      if((clock_time_t)(tt->deadline - now) > TRICKLE_TIMER_SHARED_WINDOW) {
+        tt = NULL;
+        break;
+      }
+    }
+    if(tt == NULL) {
+      break;
+    }
+    PRINTF("trickle_timer shared: at %lu, running timer due %lu\n",
+           (unsigned long)now, (unsigned long)tt->deadline);
+    /* The handler may put tt back on the queue */
+    list_remove(shared_queue, tt);
+    tt->handler(tt);
+  }
+  shared_running = 0;
+
+  shared_reschedule();
+}
+/*---------------------------------------------------------------------------*/
+void
+trickle_timer_shared_remove(struct trickle_timer *tt)
+{
+  list_remove(shared_queue, tt);
+  if(!shared_running) {
+    shared_reschedule();
+  }
+}
+#endif /* TRICKLE_TIMER_SHARED */
+/*---------------------------------------------------------------------------*/
+/*
+ * Schedule handler to be called for tt in delay ticks. Returns the absolute
+ * time the delay is counted from
+ */
+static clock_time_t
+schedule(struct trickle_timer *tt, clock_time_t delay,
+         void (*handler)(void *))
+{
+#if TRICKLE_TIMER_SHARED
+  struct trickle_timer *prev, *next;
+  clock_time_t now = clock_time();
+
+  list_remove(shared_queue, tt);
+  tt->deadline = now + delay;
+  tt->handler = handler;
+
+  /* Insert after all timers that are due no later than tt */
+  prev = NULL;
+  for(next = list_head(shared_queue); next != NULL;
+      next = list_item_next(next)) {
+    if(is_before(tt->deadline, next->deadline)) {
+      break;
+    }
+    prev = next;
+  }
+  list_insert(shared_queue, prev, tt);
+
+  if(prev == NULL && !shared_running) {
+    shared_reschedule();
+  }
+  return now;
+#else
+  ctimer_set(&tt->ct, delay, handler, tt);
+  return tt->ct.etimer.timer.start;
+#endif
+}
+/*---------------------------------------------------------------------------*/
 static void
 schedule_for_end(struct trickle_timer *tt)
 {
@@ -183,7 +313,7 @@ schedule_for_end(struct trickle_timer *tt)
     PRINTF("trickle_timer doubling: Was in the past. Compensating\n");
   }
 
-  ctimer_set(&tt->ct, loc_clock, double_interval, tt);
+  schedule(tt, loc_clock, double_interval);
 }
 /*---------------------------------------------------------------------------*/
 /* This is used as a ctimer callback, thus its argument must be void *. ptr is
@@ -233,7 +363,7 @@ double_interval(void *ptr)
     loc_clock = 0;
     PRINTF("trickle_timer doubling: Was in the past. Compensating\n");
   }
-  ctimer_set(&loctt->ct, loc_clock, fire, loctt);
+  schedule(loctt, loc_clock, fire);
 
   /* Store the actual interval start (absolute time), we need it later.
    * We pretend that it started at the same time when the last one ended */
@@ -241,16 +371,14 @@ double_interval(void *ptr)
 #else
   /* Assumed that the previous interval's end is 'now' and schedule in t ticks
    * after 'now', ignoring potential offsets */
-  ctimer_set(&loctt->ct, loc_clock, fire, loctt);
   /* Store the actual interval start (absolute time), we need it later */
-  loctt->i_start = loctt->ct.etimer.timer.start;
+  loctt->i_start = schedule(loctt, loc_clock, fire);
 #endif
 
   PRINTF("trickle_timer doubling: Last end %lu, new end %lu, for %lu, I=%lu\n",
          (unsigned long)last_end,
          (unsigned long)TRICKLE_TIMER_INTERVAL_END(loctt),
-         (unsigned long)(loctt->ct.etimer.timer.start +
-                         loctt->ct.etimer.timer.interval),
+         (unsigned long)TRICKLE_TIMER_NEXT_EVENT(loctt),
          (unsigned long)(loctt->i_cur));
 }
 /*---------------------------------------------------------------------------*/
@@ -264,8 +392,7 @@ fire(void *ptr)
 
   PRINTF("trickle_timer fire: at %lu (was for %lu)\n",
          (unsigned long)clock_time(),
-         (unsigned long)(loctt->ct.etimer.timer.start +
-                         loctt->ct.etimer.timer.interval));
+         (unsigned long)TRICKLE_TIMER_NEXT_EVENT(loctt));
 
   if(loctt->cb) {
     /*
@@ -292,10 +419,8 @@ new_interval(struct trickle_timer *tt)
   /* Random t in [I/2, I) */
   loc_clock = get_t(tt->i_cur);
 
-  ctimer_set(&tt->ct, loc_clock, fire, tt);
-
   /* Store the actual interval start (absolute time), we need it later */
-  tt->i_start = tt->ct.etimer.timer.start;
+  tt->i_start = schedule(tt, loc_clock, fire);
   PRINTF("trickle_timer new interval: at %lu, ends %lu, ",
          (unsigned long)clock_time(),
          (unsigned long)TRICKLE_TIMER_INTERVAL_END(tt));
@@ -401,7 +526,7 @@ trickle_timer_set(struct trickle_timer *tt, trickle_timer_cb_t proto_cb,
   PRINTF("trickle_timer set: at %lu, ends %lu, t=%lu in [%lu , %lu)\n",
          (unsigned long)tt->i_start,
          (unsigned long)TRICKLE_TIMER_INTERVAL_END(tt),
-         (unsigned long)tt->ct.etimer.timer.interval,
+         (unsigned long)(TRICKLE_TIMER_NEXT_EVENT(tt) - tt->i_start),
          (unsigned long)tt->i_cur >> 1, (unsigned long)tt->i_cur);
 
   return TRICKLE_TIMER_SUCCESS;
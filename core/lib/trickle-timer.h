@@ -204,6 +204,35 @@
 #define TRICKLE_TIMER_ERROR_CHECKING 1
 #endif
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief Run all trickle timers off a single, shared deadline queue
+ *
+ * 0: Disabled (default). Each trickle timer uses its own \ref ctimer
+ * 1: Enabled. All trickle timers are kept on one queue, sorted by deadline,
+ *    and driven by a single ctimer. This keeps the ctimer list short and lets
+ *    timers whose deadlines are close together run on the same wake-up (see
+ *    ::TRICKLE_TIMER_SHARED_WINDOW)
+ */
+#ifdef TRICKLE_TIMER_CONF_SHARED
+#define TRICKLE_TIMER_SHARED TRICKLE_TIMER_CONF_SHARED
+#else
+#define TRICKLE_TIMER_SHARED 0
+#endif
+
+/**
+ * \brief Coalescing window of the shared deadline queue, in clock ticks
+ *
+ * When the shared queue wakes up, it also handles any timer due within this
+ * many ticks, as long as this does not move a transmission to before I/2 in
+ * the timer's current interval, so t stays in [I/2, I). 0 turns coalescing
+ * off. Only used when ::TRICKLE_TIMER_SHARED is enabled
+ */
+#ifdef TRICKLE_TIMER_CONF_SHARED_WINDOW
+#define TRICKLE_TIMER_SHARED_WINDOW TRICKLE_TIMER_CONF_SHARED_WINDOW
+#else
+#define TRICKLE_TIMER_SHARED_WINDOW (CLOCK_SECOND / 16)
+#endif
+/*---------------------------------------------------------------------------*/
 /* Trickle Timer Library Macros */
 /*---------------------------------------------------------------------------*/
 /**
@@ -280,6 +309,20 @@
  */
 #define TRICKLE_TIMER_INTERVAL_END(tt) ((tt)->i_start + (tt)->i_cur)
 
+/**
+ * \brief Absolute time of the timer's next scheduled event
+ * \param tt A pointer to a ::trickle_timer structure
+ *
+ * This is time t in the current interval up until the transmission, and the
+ * interval's end thereafter
+ */
+#if TRICKLE_TIMER_SHARED
+#define TRICKLE_TIMER_NEXT_EVENT(tt) ((tt)->deadline)
+#else
+#define TRICKLE_TIMER_NEXT_EVENT(tt) ((tt)->ct.etimer.timer.start + \
+                                      (tt)->ct.etimer.timer.interval)
+#endif
+
 /**
  * \brief Checks whether an Imin value is suitable considering the various
  * restrictions imposed by our platform's clock as well as by the library itself
@@ -361,6 +404,9 @@ typedef void (* trickle_timer_cb_t)(void *ptr, uint8_t suppress);
  * boundaries of clock_time_t
  */
 struct trickle_timer {
+#if TRICKLE_TIMER_SHARED
+  struct trickle_timer *next; /**< Next timer on the shared deadline queue */
+#endif
   clock_time_t i_min;     /**< Imin: Clock ticks */
   clock_time_t i_cur;     /**< I: Current interval in clock_ticks */
   clock_time_t i_start;   /**< Start of this interval (absolute clock_time) */
@@ -369,7 +415,12 @@ struct trickle_timer {
                                Imin << Imax used internally, so that we can
                                have direct access to the maximum interval size
                                without having to calculate it all the time */
+#if TRICKLE_TIMER_SHARED
+  clock_time_t deadline;  /**< Absolute time of the next scheduled event */
+  void (*handler)(void *); /**< Event to run at the deadline */
+#else
   struct ctimer ct;       /**< A \ref ctimer used internally */
+#endif
   trickle_timer_cb_t cb;  /**< Protocol's own callback, invoked at time t
                                within the current interval */
   void *cb_arg;           /**< Opaque pointer to be used as the argument of the
@@ -447,10 +498,26 @@ uint8_t trickle_timer_set(struct trickle_timer *tt,
  * to reset a timer manually. Instead, in response to events or inconsistencies,
  * the corresponding functions must be used
  */
+#if TRICKLE_TIMER_SHARED
+#define trickle_timer_stop(tt) do { \
+  trickle_timer_shared_remove(tt); \
+  (tt)->i_cur = TRICKLE_TIMER_IS_STOPPED; \
+} while(0)
+#else
 #define trickle_timer_stop(tt) do { \
   ctimer_stop(&((tt)->ct)); \
   (tt)->i_cur = TRICKLE_TIMER_IS_STOPPED; \
 } while(0)
+#endif
+
+/**
+ * \brief      Remove a trickle timer from the shared deadline queue
+ * \param tt   A pointer to a ::trickle_timer structure
+ *
+ * Used internally by trickle_timer_stop() when ::TRICKLE_TIMER_SHARED is
+ * enabled. Protocol implementations must call trickle_timer_stop() instead.
+ */
+void trickle_timer_shared_remove(struct trickle_timer *tt);
 
 /**
  * \brief      To be called by the protocol when it hears a consistent
@@ -172,6 +172,164 @@ seek_write(int fd, unsigned int offset, char *buf, int len)
 }
 */
 /*---------------------------------------------------------------------------*/
+#if ELFLOADER_CACHE_SIZE > 0
+/* The tables of the module being loaded that were found room for in
+   the arena. A NULL table is read from the file. */
+static struct {
+  const char *symtab;
+  const char *strtab;
+  unsigned short strtabsize;
+  uint16_t *buckets;  /* First symbol number + 1 for each hash value */
+  uint16_t *chain;    /* Next symbol number + 1 with the same hash */
+  uint16_t nbuckets;
+} cache;
+
+static uint32_t arena[(ELFLOADER_CACHE_SIZE + 3) / 4];
+#endif /* ELFLOADER_CACHE_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
+static void
+read_symbol(int fd, unsigned int symtab, unsigned int a, struct elf32_sym *s)
+{
+#if ELFLOADER_CACHE_SIZE > 0
+  if(cache.symtab != NULL) {
+    memcpy(s, cache.symtab + (a - symtab), sizeof(*s));
+    return;
+  }
+#endif /* ELFLOADER_CACHE_SIZE > 0 */
+  seek_read(fd, a, (char *)s, sizeof(*s));
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the name at offset off in the string table, either from the
+   arena or read into buf, which holds len bytes. */
+static const char *
+read_name(int fd, unsigned int strtab, elf32_word off, char *buf, int len)
+{
+#if ELFLOADER_CACHE_SIZE > 0
+  if(cache.strtab != NULL && off < cache.strtabsize) {
+    return cache.strtab + off;
+  }
+#endif /* ELFLOADER_CACHE_SIZE > 0 */
+  seek_read(fd, strtab + off, buf, len);
+  return buf;
+}
+/*---------------------------------------------------------------------------*/
+#if ELFLOADER_CACHE_SIZE > 0
+static unsigned int
+name_hash(const char *name)
+{
+  unsigned int h;
+
+  for(h = 0; *name != 0; name++) {
+    h = (h << 5) + h + (unsigned char)*name;
+  }
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+/* Reserves len bytes of the arena, rounded up to keep the arena
+   aligned, or returns NULL if they do not fit. */
+static void *
+arena_alloc(unsigned int *used, unsigned int len)
+{
+  void *p;
+
+  len = (len + 3) & ~3;
+  if(len > sizeof(arena) - *used) {
+    return NULL;
+  }
+  p = (char *)arena + *used;
+  *used += len;
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_tables(int fd, unsigned int symtab, unsigned short symtabsize,
+             unsigned int strtab, unsigned short strtabsize)
+{
+  unsigned int used, i, nsyms, h;
+  struct elf32_sym s;
+  char *p;
+
+  memset(&cache, 0, sizeof(cache));
+  used = 0;
+
+  /* The symbol table is read for every relocation, so it goes first. */
+  p = arena_alloc(&used, symtabsize);
+  if(p == NULL) {
+    PRINTF("elfloader: symtab (%d bytes) does not fit the arena\n",
+           symtabsize);
+    return;
+  }
+  seek_read(fd, symtab, p, symtabsize);
+  cache.symtab = p;
+
+  /* Only a terminated string table can be used in place. */
+  p = arena_alloc(&used, strtabsize);
+  if(p == NULL || strtabsize == 0) {
+    return;
+  }
+  seek_read(fd, strtab, p, strtabsize);
+  if(p[strtabsize - 1] != 0) {
+    return;
+  }
+  cache.strtab = p;
+  cache.strtabsize = strtabsize;
+
+  /* Use what is left for the hash: one chain entry per symbol and
+     up to one bucket per symbol. */
+  nsyms = symtabsize / sizeof(struct elf32_sym);
+  cache.chain = arena_alloc(&used, nsyms * sizeof(uint16_t));
+  if(cache.chain == NULL) {
+    return;
+  }
+  cache.nbuckets = MIN(nsyms, (sizeof(arena) - used) / sizeof(uint16_t));
+  if(cache.nbuckets == 0) {
+    cache.chain = NULL;
+    return;
+  }
+  cache.buckets = arena_alloc(&used, cache.nbuckets * sizeof(uint16_t));
+  memset(cache.buckets, 0, cache.nbuckets * sizeof(uint16_t));
+
+  /* Insert from the end, so that each chain lists the symbols in
+     table order like the linear search finds them. */
+  for(i = nsyms; i > 0; i--) {
+    memcpy(&s, cache.symtab + (i - 1) * sizeof(s), sizeof(s));
+    cache.chain[i - 1] = 0;
+    if(s.st_name != 0 && s.st_name < cache.strtabsize) {
+      h = name_hash(cache.strtab + s.st_name) % cache.nbuckets;
+      cache.chain[i - 1] = cache.buckets[h];
+      cache.buckets[h] = i;
+    }
+  }
+}
+#endif /* ELFLOADER_CACHE_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
+static struct relevant_section *
+find_section(elf32_half shndx)
+{
+  if(shndx == bss.number) {
+    return &bss;
+  } else if(shndx == data.number) {
+    return &data;
+  } else if(shndx == rodata.number) {
+    return &rodata;
+  } else if(shndx == text.number) {
+    return &text;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+symbol_address(struct elf32_sym *s)
+{
+  struct relevant_section *sect;
+
+  sect = find_section(s->st_shndx);
+  if(sect == NULL) {
+    return NULL;
+  }
+  return &(sect->address[s->st_value]);
+}
+/*---------------------------------------------------------------------------*/
 static void *
 find_local_symbol(int fd, const char *symbol,
 		  unsigned int symtab, unsigned short symtabsize,
@@ -179,27 +337,30 @@ find_local_symbol(int fd, const char *symbol,
 {
   struct elf32_sym s;
   unsigned int a;
-  char name[30];
-  struct relevant_section *sect;
-  
+  char buf[30];
+  const char *name;
+
+#if ELFLOADER_CACHE_SIZE > 0
+  if(cache.buckets != NULL) {
+    /* The chain holds every symbol whose name has the same hash */
+    a = cache.buckets[name_hash(symbol) % cache.nbuckets];
+    for(; a != 0; a = cache.chain[a - 1]) {
+      memcpy(&s, cache.symtab + (a - 1) * sizeof(s), sizeof(s));
+      if(strcmp(cache.strtab + s.st_name, symbol) == 0) {
+        return symbol_address(&s);
+      }
+    }
+    return NULL;
+  }
+#endif /* ELFLOADER_CACHE_SIZE > 0 */
+
   for(a = symtab; a < symtab + symtabsize; a += sizeof(s)) {
-    seek_read(fd, a, (char *)&s, sizeof(s));
+    read_symbol(fd, symtab, a, &s);
 
     if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      name = read_name(fd, strtab, s.st_name, buf, sizeof(buf));
       if(strcmp(name, symbol) == 0) {
-	if(s.st_shndx == bss.number) {
-	  sect = &bss;
-	} else if(s.st_shndx == data.number) {
-	  sect = &data;
-  } else if(s.st_shndx == rodata.number) {
-    sect = &rodata;
-	} else if(s.st_shndx == text.number) {
-	  sect = &text;
-	} else {
-	  return NULL;
-	}
-	return &(sect->address[s.st_value]);
+	return symbol_address(&s);
       }
     }
   }
@@ -221,9 +382,14 @@ relocate_section(int fd,
   int rel_size = 0;
   struct elf32_sym s;
   unsigned int a;
-  char name[30];
+  char buf[30];
+  const char *name;
   char *addr;
   struct relevant_section *sect;
+#if ELFLOADER_CACHE_SIZE > 0
+  char batch[ELFLOADER_RELOC_BATCH * sizeof(struct elf32_rela)];
+  unsigned int batchstart = 0, batchlen = 0;
+#endif /* ELFLOADER_CACHE_SIZE > 0 */
 
   /* determine correct relocation entry sizes */
   if(using_relas) {
@@ -233,12 +399,23 @@ relocate_section(int fd,
   }
   
   for(a = section; a < section + size; a += rel_size) {
+#if ELFLOADER_CACHE_SIZE > 0
+    if(a >= batchstart + batchlen) {
+      /* Read as many whole entries as fit in the batch buffer */
+      batchstart = a;
+      batchlen = MIN(sizeof(batch) / rel_size * rel_size,
+                     section + size - a);
+      seek_read(fd, batchstart, batch, batchlen);
+    }
+    memcpy(&rela, &batch[a - batchstart], rel_size);
+#else /* ELFLOADER_CACHE_SIZE > 0 */
     seek_read(fd, a, (char *)&rela, rel_size);
-    seek_read(fd,
-	      symtab + sizeof(struct elf32_sym) * ELF32_R_SYM(rela.r_info),
-	      (char *)&s, sizeof(s));
+#endif /* ELFLOADER_CACHE_SIZE > 0 */
+    read_symbol(fd, symtab,
+                symtab + sizeof(struct elf32_sym) * ELF32_R_SYM(rela.r_info),
+                &s);
     if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      name = read_name(fd, strtab, s.st_name, buf, sizeof(buf));
       PRINTF("name: %s\n", name);
       addr = (char *)symtab_lookup(name);
       /* ADDED */
@@ -248,32 +425,18 @@ relocate_section(int fd,
 	PRINTF("found address %p\n", addr);
       }
       if(addr == NULL) {
-	if(s.st_shndx == bss.number) {
-	  sect = &bss;
-	} else if(s.st_shndx == data.number) {
-	  sect = &data;
-	} else if(s.st_shndx == rodata.number) {
-	  sect = &rodata;
-	} else if(s.st_shndx == text.number) {
-	  sect = &text;
-	} else {
+	sect = find_section(s.st_shndx);
+	if(sect == NULL) {
 	  PRINTF("elfloader unknown name: '%30s'\n", name);
-	  memcpy(elfloader_unknown, name, sizeof(elfloader_unknown));
+	  strncpy(elfloader_unknown, name, sizeof(elfloader_unknown));
 	  elfloader_unknown[sizeof(elfloader_unknown) - 1] = 0;
 	  return ELFLOADER_SYMBOL_NOT_FOUND;
 	}
 	addr = sect->address;
       }
     } else {
-      if(s.st_shndx == bss.number) {
-	sect = &bss;
-      } else if(s.st_shndx == data.number) {
-	sect = &data;
-      } else if(s.st_shndx == rodata.number) {
-	sect = &rodata;
-      } else if(s.st_shndx == text.number) {
-	sect = &text;
-      } else {
+      sect = find_section(s.st_shndx);
+      if(sect == NULL) {
 	return ELFLOADER_SEGMENT_NOT_FOUND;
       }
       
@@ -297,13 +460,14 @@ find_program_processes(int fd,
 {
   struct elf32_sym s;
   unsigned int a;
-  char name[30];
+  char buf[30];
+  const char *name;
   
   for(a = symtab; a < symtab + size; a += sizeof(s)) {
-    seek_read(fd, a, (char *)&s, sizeof(s));
+    read_symbol(fd, symtab, a, &s);
 
     if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      name = read_name(fd, strtab, s.st_name, buf, sizeof(buf));
       if(strcmp(name, "autostart_processes") == 0) {
 	return &data.address[s.st_value];
       }
@@ -438,7 +602,10 @@ elfloader_load(int fd)
       PRINTF("symtab\n");
       symtaboff = shdr.sh_offset;
       symtabsize = shdr.sh_size;
-    } else if(shdr.sh_type == SHT_STRTAB/*strncmp(name, ".strtab", 7) == 0*/) {
+    } else if(shdr.sh_type == SHT_STRTAB && i != ehdr.e_shstrndx
+              /*strncmp(name, ".strtab", 7) == 0*/) {
+      /* The section name table is a string table too, but the symbol
+         names are in the other one. */
       PRINTF("strtab\n");
       strtaboff = shdr.sh_offset;
       strtabsize = shdr.sh_size;
@@ -504,6 +671,10 @@ elfloader_load(int fd)
     return ELFLOADER_NO_TEXT;
   }
 
+#if ELFLOADER_CACHE_SIZE > 0
+  cache_tables(fd, symtaboff, symtabsize, strtaboff, strtabsize);
+#endif /* ELFLOADER_CACHE_SIZE > 0 */
+
   PRINTF("before allocate ram\n");
   bss.address = (char *)elfloader_arch_allocate_ram(bsssize + datasize);
   data.address = (char *)bss.address + bsssize;
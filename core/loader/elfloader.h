@@ -175,6 +175,29 @@ extern char elfloader_unknown[30];
 #endif
 #endif /* ELFLOADER_TEXTMEMORY_SIZE */
 
+/**
+ * Size of the RAM arena in which elfloader_load() keeps the symbol
+ * table, the string table and a symbol name hash of the module being
+ * loaded, so that relocation does not have to read them from the file
+ * over and over. Tables that do not fit are read from the file as
+ * before. With 0, no arena is used.
+ */
+#ifdef ELFLOADER_CONF_CACHE_SIZE
+#define ELFLOADER_CACHE_SIZE ELFLOADER_CONF_CACHE_SIZE
+#else
+#define ELFLOADER_CACHE_SIZE 0
+#endif
+
+/**
+ * Number of relocation entries read from the file at a time when the
+ * arena is used.
+ */
+#ifdef ELFLOADER_CONF_RELOC_BATCH
+#define ELFLOADER_RELOC_BATCH ELFLOADER_CONF_RELOC_BATCH
+#else
+#define ELFLOADER_RELOC_BATCH 8
+#endif
+
 typedef unsigned long  elf32_word;
 typedef   signed long  elf32_sword;
 typedef unsigned short elf32_half;
@@ -36,11 +36,21 @@
 #include <stdio.h>
 
 #define MAX_PATHLEN 80
-#define MAX_HOSTLEN 40
+#define MAX_HOSTLEN HTTP_SOCKET_HOSTLEN
 PROCESS(http_socket_process, "HTTP socket process");
 LIST(socketlist);
 
+/* States of the chunked transfer coding decoder */
+enum {
+  CHUNK_SIZE,
+  CHUNK_EXTENSION,
+  CHUNK_DATA,
+  CHUNK_DATA_END,
+  CHUNK_TRAILER,
+};
+
 static void removesocket(struct http_socket *s);
+static void start_timeout_timer(struct http_socket *s, clock_time_t timeout);
 /*---------------------------------------------------------------------------*/
 static void
 call_callback(struct http_socket *s, http_socket_event_t e,
@@ -124,7 +134,23 @@ parse_header_byte(struct http_socket *s, char c)
           s->header_chars++;
           PT_YIELD(&s->headerpt);
         }
-        if(!strcmp(s->header_field, "Content-Length")) {
+        if(!strcmp(s->header_field, "Transfer-Encoding") ||
+           !strcmp(s->header_field, "Connection")) {
+          s->header_chars = 0;
+          while(c != '\r' && c != ' ' && c != '\t' && c != ',' &&
+                s->header_chars < sizeof(s->header_value) - 1) {
+            s->header_value[s->header_chars++] = c;
+            PT_YIELD(&s->headerpt);
+          }
+          s->header_value[s->header_chars] = '\0';
+          if(!strcmp(s->header_value, "chunked")) {
+            s->response_chunked = 1;
+          } else if(!strcmp(s->header_value, "close")) {
+            s->response_close = 1;
+          }
+          /* Account for the line so far, it is not an empty one */
+          s->header_chars = 1;
+        } else if(!strcmp(s->header_field, "Content-Length")) {
           s->header.content_length = 0;
           while(isdigit((int)c)) {
             s->header.content_length = s->header.content_length * 10 + c - '0';
@@ -214,6 +240,7 @@ parse_header_byte(struct http_socket *s, char c)
 
     call_callback(s, HTTP_SOCKET_ERR, (void *)&s->header, sizeof(s->header));
     tcp_socket_close(&s->s);
+    s->connected = 0;
     removesocket(s);
     PT_EXIT(&s->headerpt);
   }
@@ -222,6 +249,78 @@ parse_header_byte(struct http_socket *s, char c)
   PT_END(&s->headerpt);
 }
 /*---------------------------------------------------------------------------*/
+/* Pass the body data of a chunked response to the application. Returns
+   1 once the last chunk and the trailer have been received. */
+static int
+chunked_input(struct http_socket *s, const uint8_t *data, int len)
+{
+  char c;
+  int n;
+
+  while(len > 0) {
+    if(s->chunk_state == CHUNK_DATA) {
+      n = MIN(len, s->chunk_left);
+      call_callback(s, HTTP_SOCKET_DATA, data, n);
+      s->bodylen += n;
+      s->chunk_left -= n;
+      data += n;
+      len -= n;
+      if(s->chunk_left == 0) {
+        s->chunk_state = CHUNK_DATA_END;
+      }
+      continue;
+    }
+
+    c = *data++;
+    len--;
+    switch(s->chunk_state) {
+    case CHUNK_SIZE:
+    case CHUNK_EXTENSION:
+      if(c == '\n') {
+        s->header_chars = 0;
+        s->chunk_state = s->chunk_left > 0 ? CHUNK_DATA : CHUNK_TRAILER;
+      } else if(s->chunk_state == CHUNK_SIZE && isxdigit((int)c)) {
+        s->chunk_left = s->chunk_left * 16 +
+          (isdigit((int)c) ? c - '0' : (tolower((int)c) - 'a' + 10));
+      } else if(c != '\r') {
+        /* Chunk extensions are ignored */
+        s->chunk_state = CHUNK_EXTENSION;
+      }
+      break;
+    case CHUNK_DATA_END:
+      if(c == '\n') {
+        s->chunk_left = 0;
+        s->chunk_state = CHUNK_SIZE;
+      }
+      break;
+    case CHUNK_TRAILER:
+      if(c == '\n') {
+        if(s->header_chars == 0) {
+          return 1;
+        }
+        s->header_chars = 0;
+      } else if(c != '\r') {
+        s->header_chars++;
+      }
+      break;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_done(struct http_socket *s)
+{
+  if(s->keepalive && !s->response_close) {
+    s->busy = 0;
+    start_timeout_timer(s, HTTP_SOCKET_KEEPALIVE_TIMEOUT);
+    call_callback(s, HTTP_SOCKET_DONE, NULL, 0);
+  } else {
+    tcp_socket_close(&s->s);
+    s->connected = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
 static int
 input_pt(struct http_socket *s,
          const uint8_t *inputptr, int inputdatalen)
@@ -249,16 +348,27 @@ input_pt(struct http_socket *s,
   } while(s->header_received == 0);
 
   s->bodylen = 0;
+  s->chunk_state = CHUNK_SIZE;
+  s->chunk_left = 0;
   do {
-    /* Receive the data */
-    call_callback(s, HTTP_SOCKET_DATA, inputptr, inputdatalen);
-
-    /* Close the connection if the expected content length has been received */
-    if(s->header.content_length >= 0 && s->bodylen < s->header.content_length) {
-      s->bodylen += inputdatalen;
-      if(s->bodylen >= s->header.content_length) {
-        tcp_socket_close(&s->s);
+    if(s->response_chunked) {
+      if(chunked_input(s, inputptr, inputdatalen)) {
+        response_done(s);
+        PT_EXIT(&s->pt);
+      }
+    } else {
+      /* Receive the data */
+      call_callback(s, HTTP_SOCKET_DATA, inputptr, inputdatalen);
+
+      /* The response is complete once the expected content length has
+         been received */
+      if(s->header.content_length >= 0 &&
+         s->bodylen + inputdatalen >= s->header.content_length) {
+        s->bodylen += inputdatalen;
+        response_done(s);
+        PT_EXIT(&s->pt);
       }
+      s->bodylen += inputdatalen;
     }
 
     PT_YIELD(&s->pt);
@@ -268,10 +378,10 @@ input_pt(struct http_socket *s,
 }
 /*---------------------------------------------------------------------------*/
 static void
-start_timeout_timer(struct http_socket *s)
+start_timeout_timer(struct http_socket *s, clock_time_t timeout)
 {
   PROCESS_CONTEXT_BEGIN(&http_socket_process);
-  etimer_set(&s->timeout_timer, HTTP_SOCKET_TIMEOUT);
+  etimer_set(&s->timeout_timer, timeout);
   PROCESS_CONTEXT_END(&http_socket_process);
   s->timeout_timer_started = 1;
 }
@@ -282,8 +392,15 @@ input(struct tcp_socket *tcps, void *ptr,
 {
   struct http_socket *s = ptr;
 
+  if(!s->busy) {
+    /* Nothing was asked for on this idle connection */
+    return 0;
+  }
+
   input_pt(s, inputptr, inputdatalen);
-  start_timeout_timer(s);
+  if(s->busy) {
+    start_timeout_timer(s, HTTP_SOCKET_TIMEOUT);
+  }
 
   return 0; /* all data consumed */
 }
@@ -394,72 +511,101 @@ removesocket(struct http_socket *s)
 }
 /*---------------------------------------------------------------------------*/
 static void
-event(struct tcp_socket *tcps, void *ptr,
-      tcp_socket_event_t e)
+send_request(struct http_socket *s)
 {
-  struct http_socket *s = ptr;
+  struct tcp_socket *tcps = &s->s;
   char host[MAX_HOSTLEN];
   char path[MAX_PATHLEN];
   uint16_t port;
   char str[42];
   int len;
 
-  if(e == TCP_SOCKET_CONNECTED) {
-    printf("Connected\n");
-    if(parse_url(s->url, host, &port, path)) {
-      tcp_socket_send_str(tcps, s->postdata != NULL ? "POST " : "GET ");
-      if(s->proxy_port != 0) {
-        /* If we are configured to route through a proxy, we should
-           provide the full URL as the path. */
-        tcp_socket_send_str(tcps, s->url);
-      } else {
-        tcp_socket_send_str(tcps, path);
-      }
-      tcp_socket_send_str(tcps, " HTTP/1.1\r\n");
+  if(parse_url(s->url, host, &port, path)) {
+    tcp_socket_send_str(tcps, s->postdata != NULL || s->request_chunked ?
+                        "POST " : "GET ");
+    if(s->proxy_port != 0) {
+      /* If we are configured to route through a proxy, we should
+         provide the full URL as the path. */
+      tcp_socket_send_str(tcps, s->url);
+    } else {
+      tcp_socket_send_str(tcps, path);
+    }
+    tcp_socket_send_str(tcps, " HTTP/1.1\r\n");
+    if(!s->keepalive) {
       tcp_socket_send_str(tcps, "Connection: close\r\n");
-      tcp_socket_send_str(tcps, "Host: ");
-      /* If we have IPv6 host, add the '[' and the ']' characters
-         to the host. As in rfc2732. */
-      if(memchr(host, ':', MAX_HOSTLEN)) {
-        tcp_socket_send_str(tcps, "[");
-      }
-      tcp_socket_send_str(tcps, host);
-      if(memchr(host, ':', MAX_HOSTLEN)) {
-        tcp_socket_send_str(tcps, "]");
+    }
+    tcp_socket_send_str(tcps, "Host: ");
+    /* If we have IPv6 host, add the '[' and the ']' characters
+       to the host. As in rfc2732. */
+    if(memchr(host, ':', MAX_HOSTLEN)) {
+      tcp_socket_send_str(tcps, "[");
+    }
+    tcp_socket_send_str(tcps, host);
+    if(memchr(host, ':', MAX_HOSTLEN)) {
+      tcp_socket_send_str(tcps, "]");
+    }
+    tcp_socket_send_str(tcps, "\r\n");
+    if(s->postdata != NULL || s->request_chunked) {
+      if(s->content_type) {
+        tcp_socket_send_str(tcps, "Content-Type: ");
+        tcp_socket_send_str(tcps, s->content_type);
+        tcp_socket_send_str(tcps, "\r\n");
       }
-      tcp_socket_send_str(tcps, "\r\n");
-      if(s->postdata != NULL) {
-        if(s->content_type) {
-          tcp_socket_send_str(tcps, "Content-Type: ");
-          tcp_socket_send_str(tcps, s->content_type);
-          tcp_socket_send_str(tcps, "\r\n");
-        }
+      if(s->request_chunked) {
+        tcp_socket_send_str(tcps, "Transfer-Encoding: chunked\r\n");
+      } else {
         tcp_socket_send_str(tcps, "Content-Length: ");
         sprintf(str, "%u", s->postdatalen);
         tcp_socket_send_str(tcps, str);
         tcp_socket_send_str(tcps, "\r\n");
-      } else if(s->length || s->pos > 0) {
-        tcp_socket_send_str(tcps, "Range: bytes=");
-        if(s->length) {
-          if(s->pos >= 0) {
-            sprintf(str, "%llu-%llu", s->pos, s->pos + s->length - 1);
-          } else {
-            sprintf(str, "-%llu", s->length);
-          }
+      }
+    } else if(s->length || s->pos > 0) {
+      tcp_socket_send_str(tcps, "Range: bytes=");
+      if(s->length) {
+        if(s->pos >= 0) {
+          sprintf(str, "%llu-%llu", s->pos, s->pos + s->length - 1);
         } else {
-          sprintf(str, "%llu-", s->pos);
+          sprintf(str, "-%llu", s->length);
         }
-        tcp_socket_send_str(tcps, str);
-        tcp_socket_send_str(tcps, "\r\n");
+      } else {
+        sprintf(str, "%llu-", s->pos);
       }
+      tcp_socket_send_str(tcps, str);
       tcp_socket_send_str(tcps, "\r\n");
-      if(s->postdata != NULL && s->postdatalen) {
-        len = tcp_socket_send(tcps, s->postdata, s->postdatalen);
-        s->postdata += len;
-        s->postdatalen -= len;
-      }
     }
-    parse_header_init(s);
+    tcp_socket_send_str(tcps, "\r\n");
+    if(s->postdata != NULL && s->postdatalen) {
+      len = tcp_socket_send(tcps, s->postdata, s->postdatalen);
+      s->postdata += len;
+      s->postdatalen -= len;
+    }
+  }
+  parse_header_init(s);
+  if(s->request_chunked) {
+    call_callback(s, HTTP_SOCKET_SEND_READY, NULL, 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+event(struct tcp_socket *tcps, void *ptr,
+      tcp_socket_event_t e)
+{
+  struct http_socket *s = ptr;
+  int len;
+
+  if(e != TCP_SOCKET_CONNECTED && e != TCP_SOCKET_DATA_SENT) {
+    s->connected = 0;
+    if(!s->busy) {
+      /* A kept-alive connection went away while idle */
+      removesocket(s);
+      return;
+    }
+  }
+
+  if(e == TCP_SOCKET_CONNECTED) {
+    printf("Connected\n");
+    s->connected = 1;
+    send_request(s);
   } else if(e == TCP_SOCKET_CLOSED) {
     call_callback(s, HTTP_SOCKET_CLOSED, NULL, 0);
     removesocket(s);
@@ -477,12 +623,23 @@ event(struct tcp_socket *tcps, void *ptr,
       len = tcp_socket_send(tcps, s->postdata, s->postdatalen);
       s->postdata += len;
       s->postdatalen -= len;
-    } else {
-      start_timeout_timer(s);
+    } else if(s->request_chunked && !s->request_chunk_done) {
+      call_callback(s, HTTP_SOCKET_SEND_READY, NULL, 0);
+    } else if(s->busy) {
+      start_timeout_timer(s, HTTP_SOCKET_TIMEOUT);
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+register_socket(struct http_socket *s)
+{
+  tcp_socket_register(&s->s, s,
+                      s->inputbuf, sizeof(s->inputbuf),
+                      s->outputbuf, sizeof(s->outputbuf),
+                      input, event);
+}
+/*---------------------------------------------------------------------------*/
 static int
 start_request(struct http_socket *s)
 {
@@ -499,6 +656,28 @@ start_request(struct http_socket *s)
     printf("url %s host %s port %d path %s\n",
            s->url, host, port, path);
 
+    if(s->proxy_port != 0) {
+      /* All requests go to the proxy */
+      host[0] = '\0';
+      port = s->proxy_port;
+    }
+
+    if(s->connected) {
+      if(strcmp(host, s->conn_host) == 0 && port == s->conn_port) {
+        /* Reuse the kept-alive connection */
+        s->did_tcp_connect = 1;
+        send_request(s);
+        start_timeout_timer(s, HTTP_SOCKET_TIMEOUT);
+        return HTTP_SOCKET_OK;
+      }
+      /* Connected to another server: connecting below drops that
+         connection */
+      s->connected = 0;
+    }
+    strcpy(s->conn_host, host);
+    s->conn_port = port;
+    register_socket(s);
+
     /* Check if we are to route the request through a proxy. */
     if(s->proxy_port != 0) {
       /* The proxy address should be an IPv6 address. */
@@ -580,6 +759,11 @@ PROCESS_THREAD(http_socket_process, ev, data)
           s = list_item_next(s)) {
         if(timeout_timer == &s->timeout_timer && s->timeout_timer_started) {
           tcp_socket_close(&s->s);
+          if(!s->busy) {
+            /* Idle kept-alive connection */
+            s->connected = 0;
+            removesocket(s);
+          }
           break;
         }
       }
@@ -606,21 +790,35 @@ http_socket_init(struct http_socket *s)
   init();
   uip_create_unspecified(&s->proxy_addr);
   s->proxy_port = 0;
+  s->keepalive = 0;
+  s->connected = 0;
+  s->busy = 0;
+  s->timeout_timer_started = 0;
 }
 /*---------------------------------------------------------------------------*/
 static void
 initialize_socket(struct http_socket *s)
 {
+  if(s->connected && s->busy) {
+    /* The previous request was not finished: do not reuse */
+    tcp_socket_close(&s->s);
+    s->connected = 0;
+  }
+  if(s->timeout_timer_started) {
+    etimer_stop(&s->timeout_timer);
+  }
   s->pos = 0;
   s->length = 0;
   s->postdata = NULL;
   s->postdatalen = 0;
+  s->content_type = NULL;
   s->timeout_timer_started = 0;
+  s->busy = 1;
+  s->response_close = 0;
+  s->response_chunked = 0;
+  s->request_chunked = 0;
+  s->request_chunk_done = 0;
   PT_INIT(&s->pt);
-  tcp_socket_register(&s->s, s,
-                      s->inputbuf, sizeof(s->inputbuf),
-                      s->outputbuf, sizeof(s->outputbuf),
-                      input, event);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -671,6 +869,61 @@ http_socket_post(struct http_socket *s,
 }
 /*---------------------------------------------------------------------------*/
 int
+http_socket_post_chunked(struct http_socket *s,
+                         const char *url,
+                         const char *content_type,
+                         http_socket_callback_t callback,
+                         void *callbackptr)
+{
+  initialize_socket(s);
+  strncpy(s->url, url, sizeof(s->url));
+  s->request_chunked = 1;
+  s->content_type = content_type;
+
+  s->callback = callback;
+  s->callbackptr = callbackptr;
+
+  s->did_tcp_connect = 0;
+
+  list_add(socketlist, s);
+
+  return start_request(s);
+}
+/*---------------------------------------------------------------------------*/
+int
+http_socket_send_chunk(struct http_socket *s,
+                       const void *data, uint16_t datalen)
+{
+  char str[8];
+  int room;
+
+  if(!s->request_chunked || s->request_chunk_done || !s->connected) {
+    return -1;
+  }
+
+  /* Chunk size line and CRLF after the data, or the last chunk */
+  room = tcp_socket_max_sendlen(&s->s) - (int)sizeof(str);
+  if(datalen == 0) {
+    if(room < 0) {
+      return 0;
+    }
+    tcp_socket_send_str(&s->s, "0\r\n\r\n");
+    s->request_chunk_done = 1;
+    return 0;
+  }
+  if(room <= 0) {
+    return 0;
+  }
+
+  datalen = MIN(datalen, room);
+  sprintf(str, "%x\r\n", datalen);
+  tcp_socket_send_str(&s->s, str);
+  tcp_socket_send(&s->s, data, datalen);
+  tcp_socket_send_str(&s->s, "\r\n");
+  return datalen;
+}
+/*---------------------------------------------------------------------------*/
+int
 http_socket_close(struct http_socket *socket)
 {
   struct http_socket *s;
@@ -679,6 +932,8 @@ http_socket_close(struct http_socket *socket)
       s = list_item_next(s)) {
     if(s == socket) {
       tcp_socket_close(&s->s);
+      s->connected = 0;
+      s->busy = 0;
       removesocket(s);
       return 1;
     }
@@ -687,6 +942,12 @@ http_socket_close(struct http_socket *socket)
 }
 /*---------------------------------------------------------------------------*/
 void
+http_socket_set_keepalive(struct http_socket *s, int keepalive)
+{
+  s->keepalive = keepalive;
+}
+/*---------------------------------------------------------------------------*/
+void
 http_socket_set_proxy(struct http_socket *s,
                       const uip_ipaddr_t *addr, uint16_t port)
 {
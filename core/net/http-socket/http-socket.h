@@ -44,6 +44,12 @@ typedef enum {
   HTTP_SOCKET_TIMEDOUT,
   HTTP_SOCKET_ABORTED,
   HTTP_SOCKET_HOSTNAME_NOT_FOUND,
+  /* The response has been received and the connection is kept open for
+     the next request (see http_socket_set_keepalive()) */
+  HTTP_SOCKET_DONE,
+  /* More of a chunked request body can be sent with
+     http_socket_send_chunk() */
+  HTTP_SOCKET_SEND_READY,
 } http_socket_event_t;
 
 struct http_socket_header {
@@ -68,9 +74,17 @@ typedef void (* http_socket_callback_t)(struct http_socket *s,
 #define HTTP_SOCKET_OUTPUTBUFSIZE MAX(UIP_TCP_MSS, 128)
 
 #define HTTP_SOCKET_URLLEN        128
+#define HTTP_SOCKET_HOSTLEN       40
 
 #define HTTP_SOCKET_TIMEOUT       ((2 * 60 + 30) * CLOCK_SECOND)
 
+/* How long a kept-alive connection may stay idle before we close it */
+#ifdef HTTP_SOCKET_CONF_KEEPALIVE_TIMEOUT
+#define HTTP_SOCKET_KEEPALIVE_TIMEOUT HTTP_SOCKET_CONF_KEEPALIVE_TIMEOUT
+#else
+#define HTTP_SOCKET_KEEPALIVE_TIMEOUT (30 * CLOCK_SECOND)
+#endif
+
 struct http_socket {
   struct http_socket *next;
   struct tcp_socket s;
@@ -91,11 +105,27 @@ struct http_socket {
   uint8_t timeout_timer_started;
   struct pt pt, headerpt;
   int header_chars;
-  char header_field[15];
+  char header_field[18];
+  char header_value[8];
   struct http_socket_header header;
   uint8_t header_received;
   uint64_t bodylen;
   const char *content_type;
+
+  /* Persistent connections */
+  uint8_t keepalive;      /* Keep the connection open between requests */
+  uint8_t connected;      /* The TCP connection is up */
+  uint8_t busy;           /* A request is in progress */
+  uint8_t response_close; /* The server asked to close after the response */
+  char conn_host[HTTP_SOCKET_HOSTLEN];
+  uint16_t conn_port;
+
+  /* Chunked transfer coding */
+  uint8_t response_chunked;
+  uint8_t chunk_state;
+  uint32_t chunk_left;
+  uint8_t request_chunked;
+  uint8_t request_chunk_done;
 };
 
 void http_socket_init(struct http_socket *s);
@@ -112,8 +142,28 @@ int http_socket_post(struct http_socket *s, const char *url,
                      http_socket_callback_t callback,
                      void *callbackptr);
 
+/* Start a POST whose body is streamed with http_socket_send_chunk(),
+   using the chunked transfer coding */
+int http_socket_post_chunked(struct http_socket *s, const char *url,
+                             const char *content_type,
+                             http_socket_callback_t callback,
+                             void *callbackptr);
+
+/* Send up to datalen bytes of a chunked body. Returns the number of
+   bytes sent, which may be fewer when the output buffer is full; the
+   rest can be sent on HTTP_SOCKET_SEND_READY. A zero datalen ends the
+   body. Returns -1 if no chunked POST is in progress. */
+int http_socket_send_chunk(struct http_socket *s,
+                           const void *data, uint16_t datalen);
+
 int http_socket_close(struct http_socket *socket);
 
+/* Keep the connection open after each response, so that the next
+   request to the same host and port on this socket needs no new TCP
+   connection or DNS lookup. The end of each response is then signalled
+   with HTTP_SOCKET_DONE instead of HTTP_SOCKET_CLOSED. */
+void http_socket_set_keepalive(struct http_socket *s, int keepalive);
+
 void http_socket_set_proxy(struct http_socket *s,
                            const uip_ipaddr_t *addr, uint16_t port);
 
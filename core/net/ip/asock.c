@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Await-style sockets on top of tcp-socket and udp-socket
+ */
+
+#include "contiki.h"
+#include "sys/cc.h"
+#include "net/ip/asock.h"
+
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+static void
+run(struct asock *a, void *ptr)
+{
+  if((a->flags & ASOCK_FLAGS_RUNNING) &&
+     PT_SCHEDULE(a->thread(a, ptr)) == 0) {
+    /* The thread has ended; it is not run again until restarted */
+    a->flags &= ~ASOCK_FLAGS_RUNNING;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+start(struct asock *a)
+{
+  if(a->thread != NULL) {
+    a->flags |= ASOCK_FLAGS_RUNNING;
+    PT_INIT(&a->pt);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+tcp_input(struct tcp_socket *s, void *ptr,
+          const uint8_t *input_data_ptr, int input_data_len)
+{
+  struct asock *a = (struct asock *)s;
+  uint16_t len;
+
+  a->in = input_data_ptr;
+  a->inlen = input_data_len;
+  run(a, ptr);
+
+  /* Keep what the thread did not read for its next read */
+  len = MIN(a->inlen, a->keep_size - a->keep_len);
+  if(len > 0) {
+    memcpy(a->keep + a->keep_len, a->in, len);
+    a->keep_len += len;
+  }
+  a->dropped += a->inlen - len;
+  a->in = NULL;
+  a->inlen = 0;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
+{
+  struct asock *a = (struct asock *)s;
+
+  switch(event) {
+  case TCP_SOCKET_CONNECTED:
+    a->flags = ASOCK_FLAGS_CONNECTED;
+    a->keep_len = 0;
+    a->dropped = 0;
+    start(a);
+    break;
+  case TCP_SOCKET_CLOSED:
+  case TCP_SOCKET_TIMEDOUT:
+  case TCP_SOCKET_ABORTED:
+    a->flags = (a->flags & ~ASOCK_FLAGS_CONNECTED) | ASOCK_FLAGS_CLOSED;
+    break;
+  case TCP_SOCKET_DATA_SENT:
+    break;
+  }
+  run(a, ptr);
+}
+/*---------------------------------------------------------------------------*/
+int
+asock_tcp_register(struct asock *a, void *ptr, asock_thread_t thread,
+                   uint8_t *keep, uint16_t keep_size)
+{
+  if(a == NULL) {
+    return -1;
+  }
+  memset(a, 0, sizeof(struct asock));
+  a->thread = thread;
+  a->keep = keep;
+  a->keep_size = keep != NULL ? keep_size : 0;
+  return tcp_socket_register(asock_tcp(a), ptr, NULL, 0, NULL, 0,
+                             tcp_input, tcp_event);
+}
+/*---------------------------------------------------------------------------*/
+static void
+udp_input(struct udp_socket *c, void *ptr,
+          const uip_ipaddr_t *source_addr, uint16_t source_port,
+          const uip_ipaddr_t *dest_addr, uint16_t dest_port,
+          const uint8_t *data, uint16_t datalen)
+{
+  struct asock *a = (struct asock *)c;
+
+  if(a->in != NULL || !(a->flags & ASOCK_FLAGS_RUNNING)) {
+    /* Not waiting in ASOCK_RECV() */
+    a->dropped++;
+    return;
+  }
+  a->in = data;
+  a->inlen = datalen;
+  a->from = source_addr;
+  a->from_port = source_port;
+  run(a, ptr);
+  if(a->in == data) {
+    /* The thread waits for something else; the datagram is gone */
+    a->in = (const uint8_t *)"";
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+asock_udp_register(struct asock *a, void *ptr, asock_thread_t thread)
+{
+  if(a == NULL) {
+    return -1;
+  }
+  memset(a, 0, sizeof(struct asock));
+  a->flags = ASOCK_FLAGS_UDP | ASOCK_FLAGS_CONNECTED;
+  a->thread = thread;
+  /* Datagrams are only taken while waiting in ASOCK_RECV() */
+  a->in = (const uint8_t *)"";
+  if(udp_socket_register(asock_udp(a), ptr, udp_input) < 0) {
+    return -1;
+  }
+  start(a);
+  run(a, ptr);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+asock_read(struct asock *a, uint8_t *buf, uint16_t size, int until)
+{
+  const uint8_t *src;
+  uint16_t *avail;
+  uint16_t len;
+  const uint8_t *end;
+
+  while(a->done < size) {
+    /* Kept input comes before new input */
+    if(a->keep_len > 0) {
+      src = a->keep;
+      avail = &a->keep_len;
+    } else if(a->inlen > 0) {
+      src = a->in;
+      avail = &a->inlen;
+    } else {
+      break;
+    }
+
+    len = MIN(*avail, size - a->done);
+    if(until >= 0) {
+      end = memchr(src, until, len);
+      if(end != NULL) {
+        len = end - src + 1;
+      }
+    }
+    memcpy(buf + a->done, src, len);
+    a->done += len;
+    *avail -= len;
+    if(src == a->keep) {
+      memmove(a->keep, a->keep + len, a->keep_len);
+    } else {
+      a->in += len;
+    }
+    if(until >= 0 && buf[a->done - 1] == until) {
+      return 1;
+    }
+  }
+
+  return a->done == size || (until == -2 && a->done > 0);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Await-style sockets on top of tcp-socket and udp-socket
+ *
+ *         Each connection is served by a protothread, the socket
+ *         thread, which reads and writes with blocking-looking
+ *         macros:
+ *
+ *         \code
+ *         struct echo_frame { uint8_t line[40]; };
+ *
+ *         static PT_THREAD(echo(struct asock *a, void *ptr))
+ *         {
+ *           struct echo_frame *f = ptr;
+ *
+ *           ASOCK_BEGIN(a);
+ *           while(1) {
+ *             ASOCK_READ_UNTIL(a, f->line, sizeof(f->line), '\n');
+ *             ASOCK_WRITE(a, f->line, asock_datalen(a));
+ *           }
+ *           ASOCK_END(a);
+ *         }
+ *         \endcode
+ *
+ *         As in any protothread, local variables do not survive a
+ *         blocking macro, so everything the thread keeps lives in a
+ *         frame that the application allocates per connection and
+ *         passes to the thread. The socket itself needs no input or
+ *         output buffers: incoming data is copied straight from the
+ *         uIP buffer to the destination in the frame, and outgoing
+ *         data is sent from the frame, which the write macros wait
+ *         for until it has been acknowledged. Only input that arrives
+ *         while the thread is not reading is kept, in an optional
+ *         buffer whose size the application chooses; the rest is
+ *         counted in asock_dropped().
+ *
+ *         If the connection is closed or lost while a TCP socket
+ *         thread waits, the thread exits. It is started again from
+ *         the beginning on the next connection.
+ */
+
+#ifndef ASOCK_H_
+#define ASOCK_H_
+
+#include "net/ip/tcp-socket.h"
+#include "net/ip/udp-socket.h"
+#include "sys/pt.h"
+
+struct asock;
+
+/**
+ * \brief      Socket thread
+ * \param a    The socket
+ * \param ptr  The frame given when the socket was registered
+ *
+ *             The socket thread is a protothread that must start
+ *             with ASOCK_BEGIN() and end with ASOCK_END().
+ */
+typedef PT_THREAD((* asock_thread_t)(struct asock *a, void *ptr));
+
+struct asock {
+  union {
+    struct tcp_socket tcp;
+    struct udp_socket udp;
+  } s;
+  asock_thread_t thread;
+  struct pt pt;
+
+  /* Input handed to the thread, valid while it runs */
+  const uint8_t *in;
+  uint16_t inlen;
+
+  /* Input kept for later reads */
+  uint8_t *keep;
+  uint16_t keep_size;
+  uint16_t keep_len;
+
+  /* Bytes read or written so far by the current macro */
+  uint16_t done;
+  uint16_t dropped;
+
+  /* Sender of the datagram being read */
+  const uip_ipaddr_t *from;
+  uint16_t from_port;
+
+  uint8_t flags;
+};
+
+enum {
+  ASOCK_FLAGS_NONE      = 0x00,
+  ASOCK_FLAGS_UDP       = 0x01,
+  ASOCK_FLAGS_CONNECTED = 0x02,
+  ASOCK_FLAGS_CLOSED    = 0x04,
+  ASOCK_FLAGS_RUNNING   = 0x08,
+};
+
+/**
+ * \brief      Register a TCP socket with a socket thread
+ * \param a    A pointer to the socket
+ * \param ptr  The frame of the connection, passed to the thread
+ * \param thread The socket thread
+ * \param keep A buffer for input that arrives while the thread is not reading, or NULL
+ * \param keep_size The size of the buffer
+ * \retval -1  If an error occurs
+ * \retval 1   If the operation succeeds.
+ *
+ *             The socket is then used with tcp_socket_connect() or
+ *             tcp_socket_listen() on asock_tcp(a). The thread is
+ *             started when a connection has been established.
+ */
+int asock_tcp_register(struct asock *a, void *ptr, asock_thread_t thread,
+                       uint8_t *keep, uint16_t keep_size);
+
+/**
+ * \brief      Register a UDP socket with a socket thread
+ * \param a    A pointer to the socket
+ * \param ptr  The frame passed to the thread
+ * \param thread The socket thread
+ * \retval -1  If an error occurs
+ * \retval 1   If the operation succeeds.
+ *
+ *             The socket is then used with udp_socket_bind() and
+ *             udp_socket_connect() on asock_udp(a). The thread is
+ *             started right away and runs until it ends; each
+ *             ASOCK_RECV() waits for one datagram.
+ */
+int asock_udp_register(struct asock *a, void *ptr, asock_thread_t thread);
+
+/** The underlying TCP socket */
+#define asock_tcp(a) (&(a)->s.tcp)
+
+/** The underlying UDP socket */
+#define asock_udp(a) (&(a)->s.udp)
+
+/** The number of bytes read by the last read macro */
+#define asock_datalen(a) ((a)->done)
+
+/** The number of input bytes lost because the thread was not reading */
+#define asock_dropped(a) ((a)->dropped)
+
+/** The datagram received by the last ASOCK_RECV() and its sender */
+#define asock_recvdata(a) ((a)->in)
+#define asock_recvlen(a) ((a)->inlen)
+#define asock_recvaddr(a) ((a)->from)
+#define asock_recvport(a) ((a)->from_port)
+
+/**
+ * \name Socket thread macros
+ * @{
+ */
+#define ASOCK_BEGIN(a) PT_BEGIN(&(a)->pt)
+
+#define ASOCK_END(a) PT_END(&(a)->pt)
+
+/* Block until c holds, leaving the thread if the connection is
+   closed. c is evaluated once each time the thread runs. */
+#define ASOCK_WAIT_UNTIL(a, c)                                          \
+  do {                                                                  \
+    LC_SET((a)->pt.lc);                                                 \
+    if(!(c)) {                                                          \
+      if((a)->flags & ASOCK_FLAGS_CLOSED) {                             \
+        PT_EXIT(&(a)->pt);                                              \
+      }                                                                 \
+      return PT_WAITING;                                                \
+    }                                                                   \
+  } while(0)
+
+/**
+ * Read exactly len bytes into buf.
+ */
+#define ASOCK_READ(a, buf, len)                                         \
+  do {                                                                  \
+    (a)->done = 0;                                                      \
+    ASOCK_WAIT_UNTIL(a, asock_read(a, buf, len, -1));                   \
+  } while(0)
+
+/**
+ * Read into buf until the byte c has been read or size bytes have
+ * been read, whatever comes first. asock_datalen() gives the number
+ * of bytes read, including c.
+ */
+#define ASOCK_READ_UNTIL(a, buf, size, c)                               \
+  do {                                                                  \
+    (a)->done = 0;                                                      \
+    ASOCK_WAIT_UNTIL(a, asock_read(a, buf, size, (uint8_t)(c)));        \
+  } while(0)
+
+/**
+ * Read at least one and at most size bytes into buf.
+ */
+#define ASOCK_READ_SOME(a, buf, size)                                   \
+  do {                                                                  \
+    (a)->done = 0;                                                      \
+    ASOCK_WAIT_UNTIL(a, asock_read(a, buf, size, -2));                  \
+  } while(0)
+
+/**
+ * Send len bytes from data, which must not change until the macro
+ * returns, as it is sent without being copied. On a UDP socket the
+ * data is sent as one datagram to the connected peer.
+ */
+#define ASOCK_WRITE(a, data, len)                                       \
+  do {                                                                  \
+    if((a)->flags & ASOCK_FLAGS_UDP) {                                  \
+      udp_socket_send(asock_udp(a), data, len);                         \
+    } else {                                                            \
+      tcp_socket_send_nocopy(asock_tcp(a), (const uint8_t *)(data), len); \
+      ASOCK_WAIT_UNTIL(a, tcp_socket_queuelen(asock_tcp(a)) == 0);      \
+    }                                                                   \
+  } while(0)
+
+#define ASOCK_WRITE_STR(a, str) ASOCK_WRITE(a, str, strlen(str))
+
+/**
+ * Wait for a datagram on a UDP socket. It is available with
+ * asock_recvdata() until the thread blocks again.
+ */
+#define ASOCK_RECV(a)                                                   \
+  do {                                                                  \
+    (a)->in = NULL;                                                     \
+    PT_WAIT_UNTIL(&(a)->pt, (a)->in != NULL);                           \
+  } while(0)
+
+/**
+ * Close the connection once everything written has been sent. The
+ * thread exits.
+ */
+#define ASOCK_CLOSE(a)                                                  \
+  do {                                                                  \
+    tcp_socket_close(asock_tcp(a));                                     \
+    PT_EXIT(&(a)->pt);                                                  \
+  } while(0)
+/** @} */
+
+/* Used by the read macros. until is a byte value to read up to, -1 to
+   read exactly size bytes or -2 to read what is available. */
+int asock_read(struct asock *a, uint8_t *buf, uint16_t size, int until);
+
+#endif /* ASOCK_H_ */
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \file
+ *         Internet checksum (RFC 1071) over a byte buffer.
+ */
+
+#include "net/ip/ip-chksum.h"
+#include "net/ip/uip.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Sum 32-bit words rather than byte pairs. This pays off on CPUs with a
+   32-bit int; on 8- and 16-bit CPUs the 32-bit accumulator costs more
+   than the carry branch it saves. */
+#ifdef IP_CHKSUM_CONF_WORD_ACCESS
+#define IP_CHKSUM_WORD_ACCESS IP_CHKSUM_CONF_WORD_ACCESS
+#else /* IP_CHKSUM_CONF_WORD_ACCESS */
+#define IP_CHKSUM_WORD_ACCESS (UINT_MAX > 0xffffU || IP_CHKSUM_ARCH)
+#endif /* IP_CHKSUM_CONF_WORD_ACCESS */
+
+#if IP_CHKSUM_WORD_ACCESS
+/*---------------------------------------------------------------------------*/
+static uint16_t
+fold(uint32_t acc)
+{
+  acc = (acc >> 16) + (acc & 0xffff);
+  acc = (acc >> 16) + (acc & 0xffff);
+  return (uint16_t)acc;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+swap(uint16_t v)
+{
+  return (uint16_t)((v << 8) | (v >> 8));
+}
+/*---------------------------------------------------------------------------*/
+/* Load a 16-bit value with byte a first in memory and byte b second, in
+   native byte order. */
+static uint16_t
+native16(uint8_t a, uint8_t b)
+{
+  uint8_t pair[2];
+  uint16_t v;
+
+  pair[0] = a;
+  pair[1] = b;
+  memcpy(&v, pair, sizeof(v));
+  return v;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ip_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint32_t acc;
+  uint16_t half;
+  uint8_t odd;
+#if !IP_CHKSUM_ARCH
+  uint32_t word;
+#endif /* !IP_CHKSUM_ARCH */
+
+  /*
+   * All loads below are native-endian and aligned. The one's complement
+   * sum commutes with byte swapping (RFC 1071, section 2), so summing
+   * native words and swapping the folded result on little-endian CPUs
+   * gives the network-order sum. A buffer starting at an odd address is
+   * summed from its second byte, which swaps the sum once more.
+   */
+  acc = 0;
+  odd = ((uintptr_t)data & 1) && len > 0;
+  if(odd) {
+    acc += native16(0, *data);
+    data++;
+    len--;
+  }
+
+  if(((uintptr_t)data & 2) && len >= 2) {
+    memcpy(&half, data, sizeof(half));
+    acc += half;
+    data += 2;
+    len -= 2;
+  }
+
+#if IP_CHKSUM_ARCH
+  acc = ip_chksum_arch_words(acc, (const uint32_t *)data, len >> 2);
+  acc = fold(acc);
+  data += len & ~3;
+  len &= 3;
+#else /* IP_CHKSUM_ARCH */
+  /* Adding each word as two 16-bit halves cannot overflow the
+     accumulator for a buffer of up to 64 KiB, so carries are folded
+     once at the end instead of after every addition. */
+  while(len >= 16) {
+    memcpy(&word, data, sizeof(word));
+    acc += (word & 0xffff) + (word >> 16);
+    memcpy(&word, data + 4, sizeof(word));
+    acc += (word & 0xffff) + (word >> 16);
+    memcpy(&word, data + 8, sizeof(word));
+    acc += (word & 0xffff) + (word >> 16);
+    memcpy(&word, data + 12, sizeof(word));
+    acc += (word & 0xffff) + (word >> 16);
+    data += 16;
+    len -= 16;
+  }
+  while(len >= 4) {
+    memcpy(&word, data, sizeof(word));
+    acc += (word & 0xffff) + (word >> 16);
+    data += 4;
+    len -= 4;
+  }
+#endif /* IP_CHKSUM_ARCH */
+
+  if(len >= 2) {
+    memcpy(&half, data, sizeof(half));
+    acc += half;
+    data += 2;
+    len -= 2;
+  }
+  if(len == 1) {
+    acc += native16(*data, 0);
+  }
+
+  half = fold(acc);
+#if UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN
+  half = swap(half);
+#endif /* UIP_BYTE_ORDER == UIP_LITTLE_ENDIAN */
+  if(odd) {
+    half = swap(half);
+  }
+
+  /* Return sum in host byte order. */
+  return fold((uint32_t)half + sum);
+}
+/*---------------------------------------------------------------------------*/
+#else /* IP_CHKSUM_WORD_ACCESS */
+/*---------------------------------------------------------------------------*/
+uint16_t
+ip_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+  const uint8_t *dataptr;
+  const uint8_t *last_byte;
+
+  dataptr = data;
+  last_byte = data + len - 1;
+
+  while(dataptr < last_byte) {   /* At least two more bytes */
+    t = (dataptr[0] << 8) + dataptr[1];
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+    dataptr += 2;
+  }
+
+  if(dataptr == last_byte) {
+    t = (dataptr[0] << 8) + 0;
+    sum += t;
+    if(sum < t) {
+      sum++;      /* carry */
+    }
+  }
+
+  /* Return sum in host byte order. */
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* IP_CHKSUM_WORD_ACCESS */
+/*---------------------------------------------------------------------------*/
+static uint16_t
+add16(uint16_t a, uint16_t b)
+{
+  a += b;
+  if(a < b) {
+    a++;      /* carry */
+  }
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ip_chksum_replace(uint16_t chksum,
+                  const uint8_t *old, uint16_t old_len,
+                  const uint8_t *new, uint16_t new_len)
+{
+  uint16_t sum;
+
+  /* ~HC + ~m + m', kept in host byte order. */
+  sum = add16(~uip_ntohs(chksum), ~ip_chksum(0, old, old_len));
+  sum = ip_chksum(sum, new, new_len);
+
+  return uip_htons(~sum);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ip_chksum_replace16(uint16_t chksum, uint16_t old, uint16_t new)
+{
+  uint16_t sum;
+
+  sum = add16(~uip_ntohs(chksum), ~uip_ntohs(old));
+  sum = add16(sum, uip_ntohs(new));
+
+  return uip_htons(~sum);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup uip
+ * @{
+ */
+
+/**
+ * \file
+ *         Internet checksum (RFC 1071) over a byte buffer, shared by the
+ *         IPv4 and IPv6 stacks.
+ *
+ *         On CPUs with a 32-bit int the buffer is added up one aligned
+ *         32-bit word at a time into a 32-bit accumulator, and the
+ *         carries are folded in once at the end. Smaller CPUs keep the
+ *         classic 16-bit loop. A CPU may provide an assembly routine
+ *         for the aligned bulk of the buffer by setting
+ *         IP_CHKSUM_CONF_ARCH to 1 and implementing
+ *         ip_chksum_arch_words().
+ *
+ *         The module also provides RFC 1624 incremental updates of an
+ *         existing checksum field.
+ */
+
+#ifndef IP_CHKSUM_H_
+#define IP_CHKSUM_H_
+
+#include "contiki-conf.h"
+
+#ifdef IP_CHKSUM_CONF_ARCH
+#define IP_CHKSUM_ARCH IP_CHKSUM_CONF_ARCH
+#else /* IP_CHKSUM_CONF_ARCH */
+#define IP_CHKSUM_ARCH 0
+#endif /* IP_CHKSUM_CONF_ARCH */
+
+/**
+ * \brief      Add a buffer to a running Internet checksum
+ * \param sum  The running 16-bit one's complement sum, in host byte order
+ * \param data The buffer, of any alignment
+ * \param len  The length of the buffer in bytes
+ * \return     The updated 16-bit one's complement sum, in host byte order
+ *
+ *             An odd trailing byte is padded with a zero byte, as the
+ *             checksum of a buffer with an odd length requires. The
+ *             result is not complemented.
+ */
+uint16_t ip_chksum(uint16_t sum, const uint8_t *data, uint16_t len);
+
+/**
+ * \brief         Update a checksum field after part of the data changed
+ * \param chksum  The checksum field as found in the packet, in network
+ *                byte order
+ * \param old     The data that was covered by the checksum
+ * \param old_len The length of \p old in bytes
+ * \param new     The data that replaces it
+ * \param new_len The length of \p new in bytes
+ * \return        The checksum field for the modified packet, in network
+ *                byte order
+ *
+ *                This is the incremental update of RFC 1624, equation 3:
+ *                HC' = ~(~HC + ~m + m'). It lets code that rewrites
+ *                header fields, or translates pseudo-headers, patch the
+ *                checksum instead of summing the whole packet again. An
+ *                incorrect checksum stays incorrect after the update.
+ *
+ *                Both regions must start at an even offset from the start
+ *                of the checksummed data; the lengths need not be equal.
+ *                A UDP checksum that comes out as zero must be sent as
+ *                0xffff by the caller.
+ */
+uint16_t ip_chksum_replace(uint16_t chksum,
+                           const uint8_t *old, uint16_t old_len,
+                           const uint8_t *new, uint16_t new_len);
+
+/**
+ * \brief        Update a checksum field after a 16-bit word changed
+ * \param chksum The checksum field, in network byte order
+ * \param old    The old word, in network byte order
+ * \param new    The new word, in network byte order
+ * \return       The updated checksum field, in network byte order
+ *
+ *               The word must be at an even offset from the start of the
+ *               checksummed data.
+ */
+uint16_t ip_chksum_replace16(uint16_t chksum, uint16_t old, uint16_t new);
+
+#if IP_CHKSUM_ARCH
+/**
+ * \brief       Architecture-specific bulk summing of 32-bit words
+ * \param acc   The running 32-bit accumulator
+ * \param data  The words, 4-byte aligned
+ * \param words The number of 32-bit words to add
+ * \return      \p acc plus the words, with carries out of bit 31 added
+ *              back in (end-around carry)
+ *
+ *              The words are loaded in native byte order; ip_chksum()
+ *              takes care of the byte order of the result.
+ */
+uint32_t ip_chksum_arch_words(uint32_t acc, const uint32_t *data,
+                              uint16_t words);
+#endif /* IP_CHKSUM_ARCH */
+
+#endif /* IP_CHKSUM_H_ */
+/** @} */
@@ -67,6 +67,9 @@
 #include "net/ip/uip-udp-packet.h"
 #include "net/ip/uip-nameserver.h"
 #include "lib/random.h"
+#if RESOLV_CONF_PERSISTENT
+#include "cfs/cfs.h"
+#endif /* RESOLV_CONF_PERSISTENT */
 
 #ifndef DEBUG
 #define DEBUG CONTIKI_TARGET_COOJA
@@ -161,6 +164,50 @@ int strncasecmp(const char *s1, const char *s2, size_t n);
 #define RESOLV_SUPPORTS_RECORD_EXPIRATION 1
 #endif
 
+/* Upper bound, in seconds, on how long an answer is cached, whatever
+ * TTL the server gives it. */
+#ifdef RESOLV_CONF_MAX_TTL
+#define RESOLV_MAX_TTL RESOLV_CONF_MAX_TTL
+#else
+#define RESOLV_MAX_TTL 86400UL
+#endif
+
+/* How long, in seconds, a failed lookup is cached when the server did
+ * not say (no SOA record in the response), or did not answer at all. */
+#ifdef RESOLV_CONF_NEGATIVE_TTL
+#define RESOLV_NEGATIVE_TTL RESOLV_CONF_NEGATIVE_TTL
+#else
+#define RESOLV_NEGATIVE_TTL 30
+#endif
+
+/* Upper bound, in seconds, on how long a not-found answer is cached
+ * (RFC 2308). */
+#ifdef RESOLV_CONF_MAX_NEGATIVE_TTL
+#define RESOLV_MAX_NEGATIVE_TTL RESOLV_CONF_MAX_NEGATIVE_TTL
+#else
+#define RESOLV_MAX_NEGATIVE_TTL 300UL
+#endif
+
+/* If RESOLV_CONF_PERSISTENT is set, unicast DNS answers are saved to
+ * CFS and restored when the resolver starts, so that they survive a
+ * reboot. The time spent powered off is not known to us and is not
+ * subtracted from the remaining lifetime of the restored entries. */
+#ifdef RESOLV_CONF_PERSISTENT
+#define RESOLV_PERSISTENT RESOLV_CONF_PERSISTENT
+#else
+#define RESOLV_PERSISTENT 0
+#endif
+
+#ifdef RESOLV_CONF_PERSISTENT_FILE
+#define RESOLV_PERSISTENT_FILE RESOLV_CONF_PERSISTENT_FILE
+#else
+#define RESOLV_PERSISTENT_FILE "resolv"
+#endif
+
+#if RESOLV_PERSISTENT && !RESOLV_SUPPORTS_RECORD_EXPIRATION
+#error RESOLV_CONF_PERSISTENT cannot be set without RESOLV_CONF_SUPPORTS_RECORD_EXPIRATION
+#endif
+
 #if RESOLV_CONF_SUPPORTS_MDNS && !RESOLV_VERIFY_ANSWER_NAMES
 #error RESOLV_CONF_SUPPORTS_MDNS cannot be set without RESOLV_CONF_VERIFY_ANSWER_NAMES
 #endif
@@ -181,6 +228,7 @@ int strncasecmp(const char *s1, const char *s2, size_t n);
 
 #define DNS_TYPE_A      1
 #define DNS_TYPE_CNAME  5
+#define DNS_TYPE_SOA    6
 #define DNS_TYPE_PTR   12
 #define DNS_TYPE_MX    15
 #define DNS_TYPE_TXT   16
@@ -475,6 +523,149 @@ encode_name(unsigned char *query, const char *nameptr)
   return query;
 }
 /*---------------------------------------------------------------------------*/
+#if RESOLV_SUPPORTS_RECORD_EXPIRATION
+/** \internal
+ * Reads an unaligned 32-bit value in network byte order.
+ */
+static uint32_t
+get32(const unsigned char *ptr)
+{
+  return ((uint32_t)ptr[0] << 24) | ((uint32_t)ptr[1] << 16) |
+         ((uint32_t)ptr[2] << 8) | ptr[3];
+}
+/*---------------------------------------------------------------------------*/
+/** \internal
+ * Returns for how many seconds a not-found answer may be cached: the
+ * smaller of the TTL and the MINIMUM field of the SOA record in the
+ * authority section (RFC 2308), or RESOLV_NEGATIVE_TTL if there is
+ * none. queryptr points to the first of the nanswers answer records.
+ */
+static unsigned long
+negative_ttl(unsigned char *queryptr, uint8_t nanswers, uint8_t nauthrr)
+{
+  const unsigned char *end = (unsigned char *)uip_appdata + uip_datalen();
+  unsigned char *rdata;
+  unsigned char *soa_minimum;
+  uint32_t ttl;
+
+  while(nanswers > 0 || nauthrr > 0) {
+    /* Type, class, TTL and length precede the record data */
+    rdata = skip_name(queryptr) + 10;
+    if(rdata > end) {
+      break;
+    }
+    if(nanswers > 0) {
+      --nanswers;
+    } else {
+      --nauthrr;
+      if(rdata[-10] == 0 && rdata[-9] == DNS_TYPE_SOA) {
+        /* Skip MNAME and RNAME, then serial, refresh, retry and expire */
+        soa_minimum = skip_name(skip_name(rdata)) + 16;
+        if(soa_minimum + 4 > end) {
+          break;
+        }
+        ttl = get32(rdata - 6);
+        if(get32(soa_minimum) < ttl) {
+          ttl = get32(soa_minimum);
+        }
+        return ttl < RESOLV_MAX_NEGATIVE_TTL ? ttl : RESOLV_MAX_NEGATIVE_TTL;
+      }
+    }
+    queryptr = rdata + ((rdata[-2] << 8) | rdata[-1]);
+  }
+  return RESOLV_NEGATIVE_TTL;
+}
+#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+/*---------------------------------------------------------------------------*/
+#if RESOLV_PERSISTENT
+/** \internal The format of a cache entry saved to CFS. */
+struct cache_record {
+  uint32_t lifetime;
+  uint8_t state;
+  uip_ipaddr_t ipaddr;
+  char name[RESOLV_CONF_MAX_DOMAIN_NAME_SIZE + 1];
+};
+/*---------------------------------------------------------------------------*/
+/** \internal
+ * Saves all unexpired unicast DNS answers to CFS.
+ */
+static void
+cache_save(void)
+{
+  static struct cache_record rec;
+  unsigned long now = clock_seconds();
+  struct namemap *namemapptr;
+  uint8_t i;
+  int fd;
+
+  cfs_remove(RESOLV_PERSISTENT_FILE);
+  fd = cfs_open(RESOLV_PERSISTENT_FILE, CFS_WRITE);
+  if(fd < 0) {
+    PRINTF("resolver: Could not save the cache.\n");
+    return;
+  }
+
+  for(i = 0; i < RESOLV_ENTRIES; ++i) {
+    namemapptr = &names[i];
+    if((namemapptr->state != STATE_DONE && namemapptr->state != STATE_ERROR) ||
+       now >= namemapptr->expiration) {
+      continue;
+    }
+#if RESOLV_CONF_SUPPORTS_MDNS
+    if(namemapptr->is_mdns) {
+      continue;
+    }
+#endif /* RESOLV_CONF_SUPPORTS_MDNS */
+    memset(&rec, 0, sizeof(rec));
+    rec.lifetime = namemapptr->expiration - now;
+    rec.state = namemapptr->state;
+    uip_ipaddr_copy(&rec.ipaddr, &namemapptr->ipaddr);
+    strncpy(rec.name, namemapptr->name, sizeof(rec.name) - 1);
+    if(cfs_write(fd, &rec, sizeof(rec)) != sizeof(rec)) {
+      break;
+    }
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+/** \internal
+ * Fills the cache with the answers saved by cache_save().
+ */
+static void
+cache_restore(void)
+{
+  static struct cache_record rec;
+  struct namemap *namemapptr;
+  uint8_t i;
+  int fd;
+
+  fd = cfs_open(RESOLV_PERSISTENT_FILE, CFS_READ);
+  if(fd < 0) {
+    return;
+  }
+
+  i = 0;
+  while(i < RESOLV_ENTRIES &&
+        cfs_read(fd, &rec, sizeof(rec)) == sizeof(rec)) {
+    if(rec.state != STATE_DONE && rec.state != STATE_ERROR) {
+      continue;
+    }
+    namemapptr = &names[i++];
+    namemapptr->state = rec.state;
+    namemapptr->seqno = seqno++;
+    namemapptr->expiration = clock_seconds() + rec.lifetime;
+    uip_ipaddr_copy(&namemapptr->ipaddr, &rec.ipaddr);
+    rec.name[sizeof(rec.name) - 1] = 0;
+    strcpy(namemapptr->name, rec.name);
+    PRINTF("resolver: Restored \"%s\" for %lu seconds.\n",
+           namemapptr->name, (unsigned long)rec.lifetime);
+  }
+  cfs_close(fd);
+}
+#else /* RESOLV_PERSISTENT */
+#define cache_save()
+#endif /* RESOLV_PERSISTENT */
+/*---------------------------------------------------------------------------*/
 #if RESOLV_CONF_SUPPORTS_MDNS
 /** \internal
  */
@@ -786,7 +977,7 @@ check_entries(void)
 static void
 newdata(void)
 {
-  uint8_t nquestions, nanswers;
+  uint8_t nquestions, nanswers, nauthrr;
 
   int8_t i;
 
@@ -805,6 +996,7 @@ newdata(void)
    */
   nquestions = (uint8_t) uip_ntohs(hdr->numquestions);
   nanswers = (uint8_t) uip_ntohs(hdr->numanswers);
+  nauthrr = (uint8_t) uip_ntohs(hdr->numauthrr);
 
   queryptr = (unsigned char *)hdr + sizeof(*hdr);
   i = 0;
@@ -812,7 +1004,7 @@ newdata(void)
   DEBUG_PRINTF
     ("resolver: flags1=0x%02X flags2=0x%02X nquestions=%d, nanswers=%d, nauthrr=%d, nextrarr=%d\n",
      hdr->flags1, hdr->flags2, (uint8_t) nquestions, (uint8_t) nanswers,
-     (uint8_t) uip_ntohs(hdr->numauthrr),
+     nauthrr,
      (uint8_t) uip_ntohs(hdr->numextrarr));
 
   if(is_request && (nquestions == 0)) {
@@ -875,14 +1067,11 @@ newdata(void)
         }
         return;
       } else {
-        uint8_t nauthrr;
         PRINTF("resolver: But we are still probing. Waiting...\n");
         /* We are still probing. We need to do the mDNS
          * probe race condition check here and make sure
          * we don't need to delay probing for a second.
          */
-        nauthrr = (uint8_t)uip_ntohs(hdr->numauthrr);
-
         /* For now, we will always restart the collision check if
          * there are *any* authority records present.
          * In the future we should follow the spec more closely,
@@ -898,14 +1087,14 @@ newdata(void)
 
 /** ANSWER HANDLING SECTION **************************************************/
 
-  if(nanswers == 0) {
-    /* Skip responses with no answers. */
-    return;
-  }
-
 #if RESOLV_CONF_SUPPORTS_MDNS
   if(UIP_UDP_BUF->srcport == UIP_HTONS(MDNS_PORT) &&
      hdr->id == 0) {
+    if(nanswers == 0) {
+      /* Skip MDNS responses with no answers. */
+      return;
+    }
+
     /* OK, this was from MDNS. Things get a little weird here,
      * because we can't use the `id` field. We will look up the
      * appropriate request in a later step. */
@@ -915,6 +1104,11 @@ newdata(void)
   } else
 #endif /* RESOLV_CONF_SUPPORTS_MDNS */
   {
+    if(is_request) {
+      /* Skip requests, we only care about responses here. */
+      return;
+    }
+
     for(i = 0; i < RESOLV_ENTRIES; ++i) {
       namemapptr = &names[i];
       if(namemapptr->state == STATE_ASKING &&
@@ -936,16 +1130,35 @@ newdata(void)
     namemapptr->err = hdr->flags2 & DNS_FLAG2_ERR_MASK;
 
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-    /* If we remain in the error state, keep it cached for 30 seconds. */
-    namemapptr->expiration = clock_seconds() + 30;
+    /* If we remain in the error state, keep it cached for a while. */
+    namemapptr->expiration = clock_seconds() + RESOLV_NEGATIVE_TTL;
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
-    /* Check for error. If so, call callback to inform. */
-    if(namemapptr->err != 0) {
-      namemapptr->state = STATE_ERROR;
+    if(namemapptr->err == DNS_FLAG2_ERR_NAME ||
+       (namemapptr->err == DNS_FLAG2_ERR_NONE && nanswers == 0)) {
+      /* The name does not exist, or has no record of our type. Cache
+       * that for as long as the server allows. */
+#if RESOLV_SUPPORTS_RECORD_EXPIRATION
+      namemapptr->expiration = clock_seconds() +
+        negative_ttl(queryptr, nanswers, nauthrr);
+#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+      PRINTF("resolver: \"%s\" not found.\n", namemapptr->name);
+      cache_save();
       resolv_found(namemapptr->name, NULL);
       return;
     }
+
+    /* Check for other errors. If so, try the next server, or call
+     * callback to inform. */
+    if(namemapptr->err != 0) {
+      if(try_next_server(namemapptr)) {
+        namemapptr->state = STATE_ASKING;
+        process_post(&resolv_process, PROCESS_EVENT_TIMER, NULL);
+      } else {
+        resolv_found(namemapptr->name, NULL);
+      }
+      return;
+    }
   }
 
   i = 0;
@@ -1050,12 +1263,26 @@ newdata(void)
 
     namemapptr->state = STATE_DONE;
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-    namemapptr->expiration = ans->ttl[1] + (ans->ttl[0] << 8);
-    namemapptr->expiration += clock_seconds();
+    {
+      uint32_t ttl = ((uint32_t)uip_ntohs(ans->ttl[0]) << 16) |
+                     uip_ntohs(ans->ttl[1]);
+
+      if(ttl > RESOLV_MAX_TTL) {
+        ttl = RESOLV_MAX_TTL;
+      }
+      namemapptr->expiration = clock_seconds() + ttl;
+    }
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
     uip_ipaddr_copy(&namemapptr->ipaddr, (uip_ipaddr_t *) ans->ipaddr);
 
+#if RESOLV_CONF_SUPPORTS_MDNS
+    if(!namemapptr->is_mdns)
+#endif /* RESOLV_CONF_SUPPORTS_MDNS */
+    {
+      cache_save();
+    }
+
     resolv_found(namemapptr->name, &namemapptr->ipaddr);
     break;
 
@@ -1076,6 +1303,8 @@ newdata(void)
     if(try_next_server(namemapptr)) {
       namemapptr->state = STATE_ASKING;
       process_post(&resolv_process, PROCESS_EVENT_TIMER, NULL);
+    } else {
+      resolv_found(namemapptr->name, NULL);
     }
   }
 
@@ -1163,6 +1392,10 @@ PROCESS_THREAD(resolv_process, ev, data)
 
   memset(names, 0, sizeof(names));
 
+#if RESOLV_PERSISTENT
+  cache_restore();
+#endif /* RESOLV_PERSISTENT */
+
   resolv_event_found = process_alloc_event();
 
   PRINTF("resolver: Process started.\n");
@@ -1292,7 +1525,8 @@ resolv_query(const char *name)
     }
     if((nameptr->state == STATE_UNUSED)
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-      || (nameptr->state == STATE_DONE && clock_seconds() > nameptr->expiration)
+      || ((nameptr->state == STATE_DONE || nameptr->state == STATE_ERROR) &&
+          clock_seconds() > nameptr->expiration)
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
     ) {
       lseqi = i;
@@ -1406,7 +1640,8 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
       }
 
       if(ipaddr) {
-        *ipaddr = &nameptr->ipaddr;
+        /* Only answers carry an address */
+        *ipaddr = nameptr->state == STATE_DONE ? &nameptr->ipaddr : NULL;
       }
 
       /* Break out of for loop. */
@@ -56,15 +56,73 @@ call_event(struct tcp_socket *s, tcp_socket_event_t event)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* While held, output is only sent once it fills a segment. Data
+   already sent is always retransmitted. */
+static int
+held(struct tcp_socket *s)
+{
+  return (s->flags & TCP_SOCKET_FLAGS_HOLD) != 0 && !uip_rexmit() &&
+    s->output_ref_len == 0 && s->output_data_len < s->output_data_max_seg;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP_SEND_WINDOW
+static void
+senddata(struct tcp_socket *s)
+{
+  int len = MIN(s->output_data_max_seg, uip_send_window());
+
+  if(held(s)) {
+    return;
+  }
+  if(s->output_data_len > 0 && len > 0) {
+    len = MIN(s->output_data_len, len);
+    uip_send(s->output_data_ptr, len);
+
+    /* uIP keeps its own copy of the data until it has been
+       acknowledged, so the space in the output buffer can be reused
+       right away. */
+    memmove(&s->output_data_ptr[0], &s->output_data_ptr[len],
+            s->output_data_len - len);
+    s->output_data_len -= len;
+    s->output_senddata_len = s->output_data_len;
+  } else if(s->output_ref_len > 0 && len > 0) {
+    len = MIN(s->output_ref_len, len);
+    uip_send(s->output_ref_ptr, len);
+    s->output_ref_ptr += len;
+    s->output_ref_len -= len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+acked(struct tcp_socket *s)
+{
+  call_event(s, TCP_SOCKET_DATA_SENT);
+}
+#else /* UIP_TCP_SEND_WINDOW */
 static void
 senddata(struct tcp_socket *s)
 {
   int len = MIN(s->output_data_max_seg, uip_mss());
 
+  if(held(s)) {
+    return;
+  }
+  if(s->output_data_send_nxt == 0) {
+    /* Nothing is in flight, so everything queued so far can go out
+       in this segment. */
+    s->output_senddata_len = s->output_data_len;
+  }
   if(s->output_senddata_len > 0) {
     len = MIN(s->output_senddata_len, len);
     s->output_data_send_nxt = len;
     uip_send(s->output_data_ptr, len);
+  } else if(s->output_ref_len > 0) {
+    /* The application-owned buffer is only sent once the output
+       buffer has been drained, so a retransmission always finds the
+       segment at the start of the buffer. */
+    len = MIN(s->output_ref_len, len);
+    s->output_data_send_nxt = len;
+    uip_send(s->output_ref_ptr, len);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -94,9 +152,16 @@ acked(struct tcp_socket *s)
     s->output_senddata_len = s->output_data_len;
     s->output_data_send_nxt = 0;
 
+    call_event(s, TCP_SOCKET_DATA_SENT);
+  } else if(s->output_ref_len > 0) {
+    s->output_ref_ptr += s->output_data_send_nxt;
+    s->output_ref_len -= s->output_data_send_nxt;
+    s->output_data_send_nxt = 0;
+
     call_event(s, TCP_SOCKET_DATA_SENT);
   }
 }
+#endif /* UIP_TCP_SEND_WINDOW */
 /*---------------------------------------------------------------------------*/
 static void
 newdata(struct tcp_socket *s)
@@ -106,6 +171,14 @@ newdata(struct tcp_socket *s)
   len = uip_datalen();
   dataptr = uip_appdata;
 
+  if(s->input_data_ptr == NULL) {
+    /* No input buffer: the data is handed over in the uIP buffer */
+    if(s->input_callback) {
+      s->input_callback(s, s->ptr, dataptr, len);
+    }
+    return;
+  }
+
   /* We have a segment with data coming in. We copy as much data as
      possible into the input buffer and call the input callback
      function. The input callback returns the number of bytes that
@@ -216,7 +289,7 @@ appcall(void *state)
     senddata(s);
   }
 
-  if(s->output_data_len == 0 && s->flags & TCP_SOCKET_FLAGS_CLOSING) {
+  if(tcp_socket_queuelen(s) == 0 && s->flags & TCP_SOCKET_FLAGS_CLOSING) {
     s->flags &= ~TCP_SOCKET_FLAGS_CLOSING;
     uip_close();
     s->c = NULL;
@@ -277,6 +350,7 @@ tcp_socket_register(struct tcp_socket *s, void *ptr,
   s->output_data_len = 0;
   s->output_data_ptr = output_databuf;
   s->output_data_maxlen = output_databuf_len;
+  s->output_ref_len = 0;
   s->input_callback = input_callback;
   s->event_callback = event_callback;
   list_add(socketlist, s);
@@ -348,7 +422,7 @@ tcp_socket_send(struct tcp_socket *s,
     return -1;
   }
 
-  len = MIN(datalen, s->output_data_maxlen - s->output_data_len);
+  len = MIN(datalen, tcp_socket_max_sendlen(s));
 
   memcpy(&s->output_data_ptr[s->output_data_len], data, len);
   s->output_data_len += len;
@@ -363,6 +437,22 @@ tcp_socket_send(struct tcp_socket *s,
 }
 /*---------------------------------------------------------------------------*/
 int
+tcp_socket_send_nocopy(struct tcp_socket *s,
+                       const uint8_t *data, int datalen)
+{
+  if(s == NULL || s->output_ref_len > 0) {
+    return -1;
+  }
+
+  s->output_ref_ptr = data;
+  s->output_ref_len = datalen;
+
+  tcpip_poll_tcp(s->c);
+
+  return datalen;
+}
+/*---------------------------------------------------------------------------*/
+int
 tcp_socket_send_str(struct tcp_socket *s,
              const char *str)
 {
@@ -377,6 +467,32 @@ tcp_socket_close(struct tcp_socket *s)
   }
 
   s->flags |= TCP_SOCKET_FLAGS_CLOSING;
+  s->flags &= ~TCP_SOCKET_FLAGS_HOLD;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tcp_socket_hold(struct tcp_socket *s)
+{
+  if(s == NULL) {
+    return -1;
+  }
+
+  s->flags |= TCP_SOCKET_FLAGS_HOLD;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tcp_socket_flush(struct tcp_socket *s)
+{
+  if(s == NULL) {
+    return -1;
+  }
+
+  s->flags &= ~TCP_SOCKET_FLAGS_HOLD;
+  if(s->c != NULL && tcp_socket_queuelen(s) > 0) {
+    tcpip_poll_tcp(s->c);
+  }
   return 1;
 }
 /*---------------------------------------------------------------------------*/
@@ -398,12 +514,17 @@ tcp_socket_unregister(struct tcp_socket *s)
 int
 tcp_socket_max_sendlen(struct tcp_socket *s)
 {
+  if(s->output_ref_len > 0) {
+    /* Data copied into the output buffer now would be sent out of
+       order. */
+    return 0;
+  }
   return s->output_data_maxlen - s->output_data_len;
 }
 /*---------------------------------------------------------------------------*/
 int
 tcp_socket_queuelen(struct tcp_socket *s)
 {
-  return s->output_data_len;
+  return s->output_data_len + s->output_ref_len;
 }
 /*---------------------------------------------------------------------------*/
@@ -100,6 +100,9 @@ struct tcp_socket {
   uint16_t output_senddata_len;
   uint16_t output_data_max_seg;
 
+  const uint8_t *output_ref_ptr;
+  uint16_t output_ref_len;
+
   uint8_t flags;
   uint16_t listen_port;
   struct uip_conn *c;
@@ -109,6 +112,7 @@ enum {
   TCP_SOCKET_FLAGS_NONE      = 0x00,
   TCP_SOCKET_FLAGS_LISTENING = 0x01,
   TCP_SOCKET_FLAGS_CLOSING   = 0x02,
+  TCP_SOCKET_FLAGS_HOLD      = 0x04,
 };
 
 /**
@@ -146,6 +150,11 @@ enum {
  *             application has read out the data from the input
  *             buffer.
  *
+ *             If input_databuf is NULL, no input data is copied. The
+ *             data callback is instead called with the segment as it
+ *             lies in the uIP buffer, and must consume all of it
+ *             before returning.
+ *
  */
 int tcp_socket_register(struct tcp_socket *s, void *ptr,
                          uint8_t *input_databuf, int input_databuf_len,
@@ -229,6 +238,32 @@ int tcp_socket_send(struct tcp_socket *s,
                     const uint8_t *dataptr,
                     int datalen);
 
+/**
+ * \brief      Send data from an application-owned buffer on a connected TCP socket
+ * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
+ * \param dataptr A pointer to the data to be sent
+ * \param datalen The length of the data to be sent
+ * \retval -1  If an error occurs, or if the socket already has an application-owned buffer queued
+ * \return     The number of bytes that were queued
+ *
+ *             This function sends data over a connected TCP socket
+ *             without copying it into the output buffer. Segments
+ *             are copied straight from the application's buffer into
+ *             the uIP packet buffer, which saves one copy per byte
+ *             for large messages.
+ *
+ *             The data is sent after anything already in the output
+ *             buffer. The buffer belongs to the application, but it
+ *             must stay untouched until all of it has been sent and
+ *             acknowledged. This is the case once
+ *             tcp_socket_queuelen() returns zero in the
+ *             TCP_SOCKET_DATA_SENT event callback. Until then,
+ *             tcp_socket_send() queues no data.
+ */
+int tcp_socket_send_nocopy(struct tcp_socket *s,
+                           const uint8_t *dataptr,
+                           int datalen);
+
 /**
  * \brief      Send a string on a connected TCP socket
  * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
@@ -256,6 +291,28 @@ int tcp_socket_send_str(struct tcp_socket *s,
  */
 int tcp_socket_close(struct tcp_socket *s);
 
+/**
+ * \brief      Hold back small amounts of output on a TCP socket
+ * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
+ * \retval -1  If an error occurs
+ * \retval 1   If the operation succeeds.
+ *
+ *             After this call, data in the output buffer is only
+ *             sent once it fills a full segment, so that several
+ *             small messages can be sent in one segment. Call
+ *             tcp_socket_flush() to send what has been queued.
+ *             Closing the socket also releases the hold.
+ */
+int tcp_socket_hold(struct tcp_socket *s);
+
+/**
+ * \brief      Send output held back by tcp_socket_hold()
+ * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
+ * \retval -1  If an error occurs
+ * \retval 1   If the operation succeeds.
+ */
+int tcp_socket_flush(struct tcp_socket *s);
+
 /**
  * \brief      Unregister a registered socket
  * \param s    A pointer to a TCP socket that must have been previously registered with tcp_socket_register()
@@ -279,7 +336,8 @@ int tcp_socket_unregister(struct tcp_socket *s);
  *             number of bytes available in the output buffer. This
  *             function is used before calling tcp_socket_send() to
  *             ensure that one application level message can be held
- *             in the output buffer.
+ *             in the output buffer. It returns zero while data queued
+ *             with tcp_socket_send_nocopy() is pending.
  *
  */
 int tcp_socket_max_sendlen(struct tcp_socket *s);
@@ -41,6 +41,7 @@
 #include "contiki-net.h"
 #include "net/ip/uip-split.h"
 #include "net/ip/uip-packetqueue.h"
+#include "net/pkttrace.h"
 
 #if NETSTACK_CONF_WITH_IPV6
 #include "net/ipv6/uip-nd6.h"
@@ -73,6 +74,15 @@ void uip_log(char *msg);
 extern struct uip_fallback_interface UIP_FALLBACK_INTERFACE;
 #endif
 
+/* The number of off-link destinations whose next hop neighbor is
+   remembered, so that packets to them skip the route lookup and the
+   default router selection */
+#ifdef TCPIP_CONF_DEST_CACHE_SIZE
+#define TCPIP_DEST_CACHE_SIZE TCPIP_CONF_DEST_CACHE_SIZE
+#else /* TCPIP_CONF_DEST_CACHE_SIZE */
+#define TCPIP_DEST_CACHE_SIZE 0
+#endif /* TCPIP_CONF_DEST_CACHE_SIZE */
+
 #if UIP_CONF_IPV6_RPL
 #include "rpl/rpl.h"
 #endif
@@ -114,6 +124,66 @@ enum {
 /* Called on IP packet output. */
 #if NETSTACK_CONF_WITH_IPV6
 
+#if TCPIP_DEST_CACHE_SIZE
+#if !UIP_DS6_NOTIFICATIONS
+#error TCPIP_CONF_DEST_CACHE_SIZE needs UIP_DS6_NOTIFICATIONS
+#endif /* !UIP_DS6_NOTIFICATIONS */
+struct dest_cache_entry {
+  uip_ipaddr_t destipaddr;
+  uip_ipaddr_t nexthop;
+  uip_ds6_nbr_t *nbr;
+};
+static struct dest_cache_entry dest_cache[TCPIP_DEST_CACHE_SIZE];
+static uint8_t dest_cache_next;
+static struct uip_ds6_notification dest_cache_notification;
+/*---------------------------------------------------------------------------*/
+/* Every change of a route or a default router may change the next hop
+   of any destination */
+static void
+dest_cache_flush(int event, uip_ipaddr_t *route, uip_ipaddr_t *nexthop,
+                 int num_routes)
+{
+  int i;
+
+  for(i = 0; i < TCPIP_DEST_CACHE_SIZE; i++) {
+    dest_cache[i].nbr = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_nbr_t *
+dest_cache_lookup(const uip_ipaddr_t *destipaddr)
+{
+  struct dest_cache_entry *e;
+  uip_ds6_nbr_t *nbr;
+
+  for(e = dest_cache; e < &dest_cache[TCPIP_DEST_CACHE_SIZE]; e++) {
+    if(e->nbr != NULL && uip_ipaddr_cmp(&e->destipaddr, destipaddr)) {
+      /* Make sure that the neighbor was not removed since, as
+         that does not come with a notification */
+      nbr = nbr_table_get_from_lladdr(ds6_neighbors,
+                                      (const linkaddr_t *)uip_ds6_nbr_get_ll(e->nbr));
+      if(nbr != e->nbr || !uip_ipaddr_cmp(&nbr->ipaddr, &e->nexthop)) {
+        e->nbr = NULL;
+        return NULL;
+      }
+      return nbr;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dest_cache_add(const uip_ipaddr_t *destipaddr, uip_ds6_nbr_t *nbr)
+{
+  struct dest_cache_entry *e = &dest_cache[dest_cache_next];
+
+  uip_ipaddr_copy(&e->destipaddr, destipaddr);
+  uip_ipaddr_copy(&e->nexthop, &nbr->ipaddr);
+  e->nbr = nbr;
+  dest_cache_next = (dest_cache_next + 1) % TCPIP_DEST_CACHE_SIZE;
+}
+#endif /* TCPIP_DEST_CACHE_SIZE */
+
 static uint8_t (* outputfunc)(const uip_lladdr_t *a);
 
 uint8_t
@@ -187,15 +257,28 @@ check_for_tcp_syn(void)
 #endif /* UIP_TCP || UIP_CONF_IP_FORWARD */
 }
 /*---------------------------------------------------------------------------*/
+#if PKTTRACE_ENABLED
+/* Set while an incoming packet is processed, so that a packet sent in
+   response or forwarded keeps the trace ID of the incoming one */
+static uint8_t pkttrace_in_input;
+#endif /* PKTTRACE_ENABLED */
+
 static void
 packet_input(void)
 {
   if(uip_len > 0) {
+    PKTTRACE(IP, IN, pkttrace_current_id, uip_len);
+#if PKTTRACE_ENABLED
+    pkttrace_in_input = 1;
+#endif /* PKTTRACE_ENABLED */
 
 #if UIP_CONF_IP_FORWARD
     tcpip_is_forwarding = 1;
     if(uip_fw_forward() != UIP_FW_LOCAL) {
       tcpip_is_forwarding = 0;
+#if PKTTRACE_ENABLED
+      pkttrace_in_input = 0;
+#endif /* PKTTRACE_ENABLED */
       return;
     }
     tcpip_is_forwarding = 0;
@@ -215,6 +298,9 @@ packet_input(void)
 #endif /* NETSTACK_CONF_WITH_IPV6 */
 #endif /* UIP_CONF_TCP_SPLIT */
     }
+#if PKTTRACE_ENABLED
+    pkttrace_in_input = 0;
+#endif /* PKTTRACE_ENABLED */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -531,11 +617,21 @@ tcpip_ipv6_output(void)
 {
   uip_ds6_nbr_t *nbr = NULL;
   uip_ipaddr_t *nexthop = NULL;
+#if TCPIP_DEST_CACHE_SIZE
+  uint8_t cacheable = 0;
+#endif /* TCPIP_DEST_CACHE_SIZE */
 
   if(uip_len == 0) {
     return;
   }
 
+#if PKTTRACE_ENABLED
+  if(!pkttrace_in_input) {
+    pkttrace_current_id = pkttrace_new_id();
+  }
+#endif /* PKTTRACE_ENABLED */
+  PKTTRACE(IP, OUT, pkttrace_current_id, uip_len);
+
   if(uip_len > UIP_LINK_MTU) {
     UIP_LOG("tcpip_ipv6_output: Packet to big");
     uip_clear_buf();
@@ -577,6 +673,20 @@ tcpip_ipv6_output(void)
       nexthop = &UIP_IP_BUF->destipaddr;
     }
 
+#if TCPIP_DEST_CACHE_SIZE
+    if(nexthop == NULL) {
+      /* Off-link destinations that we sent to before. Note that cached
+         routes are not moved to the front of the least recently used
+         list of routes. */
+      nbr = dest_cache_lookup(&UIP_IP_BUF->destipaddr);
+      if(nbr != NULL) {
+        nexthop = &nbr->ipaddr;
+      } else {
+        cacheable = 1;
+      }
+    }
+#endif /* TCPIP_DEST_CACHE_SIZE */
+
     if(nexthop == NULL) {
       uip_ds6_route_t *route;
       /* Check if we have a route to the destination address. */
@@ -585,7 +695,17 @@ tcpip_ipv6_output(void)
       /* No route was found - we send to the default route instead. */
       if(route == NULL) {
         PRINTF("tcpip_ipv6_output: no route found, using default route\n");
-        nexthop = uip_ds6_defrt_choose();
+#if UIP_CONF_IPV6_RPL && RPL_WITH_MULTIPATH
+        /* Upward traffic may be spread over several parents. The parent
+           is chosen per flow, so the destination is not cached. */
+        nexthop = rpl_multipath_get_next_hop();
+#if TCPIP_DEST_CACHE_SIZE
+        cacheable = 0;
+#endif /* TCPIP_DEST_CACHE_SIZE */
+#endif /* UIP_CONF_IPV6_RPL && RPL_WITH_MULTIPATH */
+        if(nexthop == NULL) {
+          nexthop = uip_ds6_defrt_choose();
+        }
         if(nexthop == NULL) {
 #ifdef UIP_FALLBACK_INTERFACE
           PRINTF("FALLBACK: removing ext hdrs & setting proto %d %d\n",
@@ -660,7 +780,9 @@ tcpip_ipv6_output(void)
 
     /* End of next hop determination */
 
-    nbr = uip_ds6_nbr_lookup(nexthop);
+    if(nbr == NULL) {
+      nbr = uip_ds6_nbr_lookup(nexthop);
+    }
     if(nbr == NULL) {
 #if UIP_ND6_SEND_NS
       if((nbr = uip_ds6_nbr_add(nexthop, NULL, 0, NBR_INCOMPLETE, NBR_TABLE_REASON_IPV6_ND, NULL)) == NULL) {
@@ -670,10 +792,8 @@ tcpip_ipv6_output(void)
       } else {
 #if UIP_CONF_IPV6_QUEUE_PKT
         /* Copy outgoing pkt in the queuing buffer for later transmit. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        uip_packetqueue_add(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME,
+                            UIP_IP_BUF, uip_len);
 #endif
         /* RFC4861, 7.2.2:
          * "If the source address of the packet prompting the solicitation is the
@@ -703,10 +823,8 @@ tcpip_ipv6_output(void)
 #if UIP_CONF_IPV6_QUEUE_PKT
         /* Copy outgoing pkt in the queuing buffer for later transmit and set
            the destination nbr to nbr. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        uip_packetqueue_add(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME,
+                            UIP_IP_BUF, uip_len);
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
         uip_clear_buf();
         return;
@@ -721,6 +839,12 @@ tcpip_ipv6_output(void)
       }
 #endif /* UIP_ND6_SEND_NS */
 
+#if TCPIP_DEST_CACHE_SIZE
+      if(cacheable) {
+        dest_cache_add(&UIP_IP_BUF->destipaddr, nbr);
+      }
+#endif /* TCPIP_DEST_CACHE_SIZE */
+
       tcpip_output(uip_ds6_nbr_get_ll(nbr));
 
 #if UIP_CONF_IPV6_QUEUE_PKT
@@ -728,12 +852,12 @@ tcpip_ipv6_output(void)
        * Send the queued packets from here, may not be 100% perfect though.
        * This happens in a few cases, for example when instead of receiving a
        * NA after sendiong a NS, you receive a NS with SLLAO: the entry moves
-       * to STALE, and you must both send a NA and the queued packet.
+       * to STALE, and you must both send a NA and the queued packets.
        */
-      if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
+      while(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
         uip_len = uip_packetqueue_buflen(&nbr->packethandle);
         memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-        uip_packetqueue_free(&nbr->packethandle);
+        uip_packetqueue_pop(&nbr->packethandle);
         tcpip_output(uip_ds6_nbr_get_ll(nbr));
       }
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
@@ -752,7 +876,7 @@ tcpip_ipv6_output(void)
 void
 tcpip_poll_udp(struct uip_udp_conn *conn)
 {
-  process_post(&tcpip_process, UDP_POLL, conn);
+  process_post_coalesce(&tcpip_process, UDP_POLL, conn);
 }
 #endif /* UIP_UDP */
 /*---------------------------------------------------------------------------*/
@@ -760,7 +884,7 @@ tcpip_poll_udp(struct uip_udp_conn *conn)
 void
 tcpip_poll_tcp(struct uip_conn *conn)
 {
-  process_post(&tcpip_process, TCP_POLL, conn);
+  process_post_coalesce(&tcpip_process, TCP_POLL, conn);
 }
 #endif /* UIP_TCP */
 /*---------------------------------------------------------------------------*/
@@ -813,6 +937,9 @@ PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
 
+  /* Packet events should not wait behind application events. */
+  process_set_priority(&tcpip_process, PROCESS_PRIORITY_HIGH);
+
 #if UIP_TCP
   {
     unsigned char i;
@@ -831,6 +958,9 @@ PROCESS_THREAD(tcpip_process, ev, data)
   etimer_set(&periodic, CLOCK_SECOND / 2);
 
   uip_init();
+#if NETSTACK_CONF_WITH_IPV6 && TCPIP_DEST_CACHE_SIZE
+  uip_ds6_notification_add(&dest_cache_notification, dest_cache_flush);
+#endif /* NETSTACK_CONF_WITH_IPV6 && TCPIP_DEST_CACHE_SIZE */
 #ifdef UIP_FALLBACK_INTERFACE
   UIP_FALLBACK_INTERFACE.init();
 #endif
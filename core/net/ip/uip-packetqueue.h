@@ -3,30 +3,66 @@
 
 #include "sys/ctimer.h"
 
+/**
+ * The number of packet buffers shared by all queues. Each buffer
+ * holds one full IP packet.
+ */
+#ifdef UIP_PACKETQUEUE_CONF_NUM
+#define UIP_PACKETQUEUE_NUM UIP_PACKETQUEUE_CONF_NUM
+#else
+#define UIP_PACKETQUEUE_NUM 2
+#endif
+
+/**
+ * The maximum number of packets a single queue (i.e. a single
+ * neighbor waiting for address resolution) may hold. Packets beyond
+ * this limit are dropped, as are packets for which no shared buffer
+ * is free.
+ */
+#ifdef UIP_PACKETQUEUE_CONF_MAX_PER_HANDLE
+#define UIP_PACKETQUEUE_MAX_PER_HANDLE UIP_PACKETQUEUE_CONF_MAX_PER_HANDLE
+#else
+#define UIP_PACKETQUEUE_MAX_PER_HANDLE UIP_PACKETQUEUE_NUM
+#endif
+
 struct uip_packetqueue_handle;
 
 struct uip_packetqueue_packet {
-  struct uip_ds6_queued_packet *next;
+  struct uip_packetqueue_packet *next;
   uint8_t queue_buf[UIP_BUFSIZE - UIP_LLH_LEN];
   uint16_t queue_buf_len;
   struct ctimer lifetimer;
   struct uip_packetqueue_handle *handle;
 };
 
+/*
+ * A FIFO of packets, oldest first. Every packet has its own lifetime
+ * and is dropped when it expires.
+ */
 struct uip_packetqueue_handle {
   struct uip_packetqueue_packet *packet;
+  uint8_t count;
 };
 
 void uip_packetqueue_new(struct uip_packetqueue_handle *handle);
 
-
+/* Append an empty packet to the queue; NULL if the queue is full. */
 struct uip_packetqueue_packet *
 uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime);
 
+/* Append a copy of data to the queue; NULL if it could not be queued. */
+struct uip_packetqueue_packet *
+uip_packetqueue_add(struct uip_packetqueue_handle *handle, clock_time_t lifetime,
+                    const void *data, uint16_t len);
+
+/* Drop the oldest packet. */
+void uip_packetqueue_pop(struct uip_packetqueue_handle *handle);
 
+/* Drop all packets. */
 void
 uip_packetqueue_free(struct uip_packetqueue_handle *handle);
 
+/* Accessors for the oldest packet in the queue. */
 uint8_t *uip_packetqueue_buf(struct uip_packetqueue_handle *h);
 uint16_t uip_packetqueue_buflen(struct uip_packetqueue_handle *h);
 void uip_packetqueue_set_buflen(struct uip_packetqueue_handle *h, uint16_t len);
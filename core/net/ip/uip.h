@@ -621,6 +621,24 @@ struct uip_conn *uip_connect(const uip_ipaddr_t *ripaddr, uint16_t port);
  */
 CCIF void uip_send(const void *data, int len);
 
+#if UIP_TCP_SEND_WINDOW
+/**
+ * The amount of data that can be sent on the current connection.
+ *
+ * This is the number of bytes that the next call to uip_send() can
+ * add to the send window of the connection. It is at most the current
+ * maximum segment size, and zero if the window is full.
+ *
+ * \note This function is available only if the send window has been
+ * configured by defining UIP_CONF_TCP_SEND_WINDOW.
+ *
+ * \hideinitializer
+ */
+#define uip_send_window()     uip_tcp_send_window(uip_conn)
+
+uint16_t uip_tcp_send_window(struct uip_conn *conn);
+#endif /* UIP_TCP_SEND_WINDOW */
+
 /**
  * The length of any incoming data that is currently available (if available)
  * in the uip_appdata buffer.
@@ -695,6 +713,23 @@ CCIF void uip_send(const void *data, int len);
     uip_conn->tcpstateflags &= ~UIP_STOPPED;                    \
   } while(0)
 
+/**
+ * Set the receiver's window of the current connection.
+ *
+ * The window tells the remote host how much data it may send before
+ * it has to wait for an acknowledgment. Applications that consume
+ * incoming data quickly can open the window to let several segments
+ * arrive back to back, and applications with little buffer space can
+ * shrink it. The new window is advertised with the next segment that
+ * is sent on the connection. The initial window is
+ * UIP_RECEIVE_WINDOW.
+ *
+ * \param wnd The size of the window in bytes.
+ *
+ * \hideinitializer
+ */
+#define uip_set_receive_window(wnd) (uip_conn->rcv_wnd = (wnd))
+
 
 /* uIP tests that can be made to determine in what state the current
    connection is, and what the application function should do. */
@@ -1352,6 +1387,23 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
                               segment sent. */
+  uint16_t rcv_wnd;      /**< The advertised receiver's window. */
+#if UIP_TCP_DELAYED_ACK
+  uint16_t rcv_unacked;  /**< The number of received bytes that have
+                              not been acknowledged yet. */
+  uint8_t ackpending;    /**< The number of received segments that have
+                              not been acknowledged yet. */
+  uint8_t acktimer;      /**< The delayed ACK timer. */
+#endif /* UIP_TCP_DELAYED_ACK */
+#if UIP_TCP_SEND_WINDOW
+  uint8_t dupacks;       /**< The number of duplicate ACKs received. */
+  uint16_t snd_wnd;      /**< The window advertised by the remote host. */
+  uint16_t recover;      /**< The number of bytes that were outstanding
+                              when a loss was detected and that are still
+                              unacknowledged. */
+  uint8_t sndbuf[UIP_TCP_SEND_WINDOW]; /**< The unacknowledged data,
+                                            starting at snd_nxt. */
+#endif /* UIP_TCP_SEND_WINDOW */
 
   uip_tcp_appstate_t appstate; /** The application state. */
 };
@@ -1598,6 +1650,7 @@ void uip_process(uint8_t flag);
 #define UIP_TS_MASK     15
 
 #define UIP_STOPPED      16
+#define UIP_CLOSE_PENDING 32
 
 /* The TCP and IP headers. */
 struct uip_tcpip_hdr {
@@ -252,6 +252,22 @@ void uip_log(char *msg);
  */
 #define UIP_REASS_MAXAGE 60 /*60s*/
 
+/**
+ * The number of IPv6 packets that can be reassembled at the same time.
+ *
+ * Every packet takes a reassembly buffer of the size of the uip_buf
+ * buffer. Fragments of further packets are dropped until a buffer is
+ * free, either because its packet is complete or because it has waited
+ * for UIP_REASS_MAXAGE.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_REASS_NUM
+#define UIP_REASS_NUM (UIP_CONF_REASS_NUM)
+#else /* UIP_CONF_REASS_NUM */
+#define UIP_REASS_NUM 1
+#endif /* UIP_CONF_REASS_NUM */
+
 /**
  * Turn on support for IP packet reassembly.
  *
@@ -435,6 +451,26 @@ void uip_log(char *msg);
 #define UIP_LISTENPORTS (UIP_CONF_MAX_LISTENPORTS)
 #endif /* UIP_CONF_MAX_LISTENPORTS */
 
+/**
+ * The number of buckets in the hash tables that map incoming TCP
+ * segments and UDP datagrams to their connections and listening
+ * ports.
+ *
+ * Every bucket remembers the connection that last matched a packet
+ * hashing to it, so that the connection tables only have to be
+ * searched when the remembered one does not match. This is worth
+ * enabling on hosts with many connections. The size must be a power
+ * of two; zero, which is the default, disables the tables. The
+ * tables are used by the IPv6 stack.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CONN_HASH_SIZE
+#define UIP_CONN_HASH_SIZE (UIP_CONF_CONN_HASH_SIZE)
+#else /* UIP_CONF_CONN_HASH_SIZE */
+#define UIP_CONN_HASH_SIZE 0
+#endif /* UIP_CONF_CONN_HASH_SIZE */
+
 /**
  * Determines if support for TCP urgent data notification should be
  * compiled in.
@@ -490,7 +526,9 @@ void uip_log(char *msg);
  *
  * Should be set low (i.e., to the size of the uip_buf buffer) if the
  * application is slow to process incoming data, or high (32768 bytes)
- * if the application processes data quickly.
+ * if the application processes data quickly. This is the initial
+ * window of every connection; applications can change it with
+ * uip_set_receive_window().
  *
  * \hideinitializer
  */
@@ -500,6 +538,61 @@ void uip_log(char *msg);
 #define UIP_RECEIVE_WINDOW (UIP_CONF_RECEIVE_WINDOW)
 #endif
 
+/**
+ * The number of incoming TCP segments that may be acknowledged by a
+ * single ACK.
+ *
+ * When set to zero, which is the default, every incoming segment is
+ * acknowledged right away. Otherwise, uIP holds back the pure ACK for
+ * a segment until this many segments have arrived, until the
+ * receiver's window would not fit another segment of the same size,
+ * or until UIP_TCP_DELAYED_ACK_TIMEOUT has passed, whichever happens
+ * first. Data sent by the application carries the ACK along.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_DELAYED_ACK
+#define UIP_TCP_DELAYED_ACK (UIP_CONF_TCP_DELAYED_ACK)
+#else /* UIP_CONF_TCP_DELAYED_ACK */
+#define UIP_TCP_DELAYED_ACK 0
+#endif /* UIP_CONF_TCP_DELAYED_ACK */
+
+/**
+ * The longest time that an ACK is delayed, in units of the periodic
+ * TCP timer (0.5 seconds).
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_DELAYED_ACK_TIMEOUT
+#define UIP_TCP_DELAYED_ACK_TIMEOUT (UIP_CONF_TCP_DELAYED_ACK_TIMEOUT)
+#else /* UIP_CONF_TCP_DELAYED_ACK_TIMEOUT */
+#define UIP_TCP_DELAYED_ACK_TIMEOUT 1
+#endif /* UIP_CONF_TCP_DELAYED_ACK_TIMEOUT */
+
+/**
+ * The size of the per-connection TCP send window, in bytes.
+ *
+ * When set to zero, which is the default, a connection has at most
+ * one unacknowledged segment in flight and the application has to
+ * retransmit it when uip_rexmit() is signalled. When set to a
+ * non-zero value, every connection keeps a retransmission buffer of
+ * this size and may have several segments in flight. uIP then
+ * retransmits lost segments by itself and never signals
+ * uip_rexmit(). Applications are polled while data is still
+ * unacknowledged, and the data passed to uip_send() is always
+ * appended to the stream.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_SEND_WINDOW
+#if UIP_CONF_TCP_SEND_WINDOW > 0 && UIP_CONF_TCP_SEND_WINDOW < UIP_TCP_MSS
+#error UIP_CONF_TCP_SEND_WINDOW must be zero or at least UIP_TCP_MSS
+#endif
+#define UIP_TCP_SEND_WINDOW (UIP_CONF_TCP_SEND_WINDOW)
+#else /* UIP_CONF_TCP_SEND_WINDOW */
+#define UIP_TCP_SEND_WINDOW 0
+#endif /* UIP_CONF_TCP_SEND_WINDOW */
+
 /**
  * How long a connection should stay in the TIME_WAIT state.
  *
@@ -46,15 +46,74 @@
 #define NUM_ENTRIES 32
 #endif /* IP64_ADDRMAP_CONF_ENTRIES */
 
+#ifdef IP64_ADDRMAP_CONF_HASH_SIZE
+#define HASH_SIZE IP64_ADDRMAP_CONF_HASH_SIZE
+#else /* IP64_ADDRMAP_CONF_HASH_SIZE */
+#define HASH_SIZE 16
+#endif /* IP64_ADDRMAP_CONF_HASH_SIZE */
+
+#if HASH_SIZE & (HASH_SIZE - 1)
+#error IP64_ADDRMAP_CONF_HASH_SIZE must be a power of two
+#endif
+
 MEMB(entrymemb, struct ip64_addrmap_entry, NUM_ENTRIES);
 LIST(entrylist);
 
+/* Every mapping is also on two hash chains: one keyed on what the IPv6
+   side sees, the other on the mapped port seen from the IPv4 side.
+   Expired mappings are dropped lazily as the chains are walked. */
+static struct ip64_addrmap_entry *hash6[HASH_SIZE];
+static struct ip64_addrmap_entry *hash4[HASH_SIZE];
+
 #define FIRST_MAPPED_PORT 10000
 #define LAST_MAPPED_PORT  20000
 static uint16_t mapped_port = FIRST_MAPPED_PORT;
 
 #define printf(...)
 
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash6_index(const uip_ip6addr_t *ip6addr, uint16_t ip6port,
+            const uip_ip4addr_t *ip4addr, uint16_t ip4port,
+            uint8_t protocol)
+{
+  uint16_t h;
+
+  h = ip6addr->u16[6] ^ ip6addr->u16[7] ^ ip4addr->u16[0] ^ ip4addr->u16[1] ^
+    ip6port ^ (uint16_t)(ip4port << 5 | ip4port >> 11) ^ protocol;
+  return (h ^ (h >> 8)) & (HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash4_index(uint16_t port)
+{
+  return (port ^ (port >> 8)) & (HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+unlink_chain(struct ip64_addrmap_entry **chain,
+             struct ip64_addrmap_entry *m, int v6)
+{
+  struct ip64_addrmap_entry **pp;
+
+  for(pp = chain; *pp != NULL;
+      pp = v6 ? &(*pp)->hnext6 : &(*pp)->hnext4) {
+    if(*pp == m) {
+      *pp = v6 ? m->hnext6 : m->hnext4;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_entry(struct ip64_addrmap_entry *m)
+{
+  unlink_chain(&hash6[hash6_index(&m->ip6addr, m->ip6port, &m->ip4addr,
+                                  m->ip4port, m->protocol)], m, 1);
+  unlink_chain(&hash4[hash4_index(m->mapped_port)], m, 0);
+  list_remove(entrylist, m);
+  memb_free(&entrymemb, m);
+}
 /*---------------------------------------------------------------------------*/
 struct ip64_addrmap_entry *
 ip64_addrmap_list(void)
@@ -67,26 +126,28 @@ ip64_addrmap_init(void)
 {
   memb_init(&entrymemb);
   list_init(entrylist);
+  memset(hash6, 0, sizeof(hash6));
+  memset(hash4, 0, sizeof(hash4));
   mapped_port = FIRST_MAPPED_PORT;
 }
 /*---------------------------------------------------------------------------*/
-static void
+static int
 check_age(void)
 {
-  struct ip64_addrmap_entry *m;
+  struct ip64_addrmap_entry *m, *next;
+  int removed;
 
   /* Walk through the list of address mappings, throw away the ones
      that are too old. */
-  m = list_head(entrylist);
-  while(m != NULL) {
+  removed = 0;
+  for(m = list_head(entrylist); m != NULL; m = next) {
+    next = list_item_next(m);
     if(timer_expired(&m->timer)) {
-      list_remove(entrylist, m);
-      memb_free(&entrymemb, m);
-      m = list_head(entrylist);
-    } else {
-      m = list_item_next(m);
+      remove_entry(m);
+      removed = 1;
     }
   }
+  return removed;
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -117,8 +178,7 @@ recycle(void)
   /* If we found an oldest recyclable entry, remove it and return
      non-zero. */
   if(oldest != NULL) {
-    list_remove(entrylist, oldest);
-    memb_free(&entrymemb, oldest);
+    remove_entry(oldest);
     return 1;
   }
 
@@ -132,18 +192,17 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
 		    uint16_t ip4port,
 		    uint8_t protocol)
 {
-  struct ip64_addrmap_entry *m;
+  struct ip64_addrmap_entry *m, *next;
 
   printf("lookup ip4port %d ip6port %d\n", uip_htons(ip4port),
 	 uip_htons(ip6port));
-  check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
-    printf("protocol %d %d, ip4port %d %d, ip6port %d %d, ip4 %d ip6 %d\n",
-	   m->protocol, protocol,
-	   m->ip4port, ip4port,
-	   m->ip6port, ip6port,
-	   uip_ip4addr_cmp(&m->ip4addr, ip4addr),
-	   uip_ip6addr_cmp(&m->ip6addr, ip6addr));
+  for(m = hash6[hash6_index(ip6addr, ip6port, ip4addr, ip4port, protocol)];
+      m != NULL; m = next) {
+    next = m->hnext6;
+    if(timer_expired(&m->timer)) {
+      remove_entry(m);
+      continue;
+    }
     if(m->protocol == protocol &&
        m->ip4port == ip4port &&
        m->ip6port == ip6port &&
@@ -159,13 +218,14 @@ ip64_addrmap_lookup(const uip_ip6addr_t *ip6addr,
 struct ip64_addrmap_entry *
 ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
 {
-  struct ip64_addrmap_entry *m;
+  struct ip64_addrmap_entry *m, *next;
 
-  check_age();
-  for(m = list_head(entrylist); m != NULL; m = list_item_next(m)) {
-    printf("mapped port %d %d, protocol %d %d\n",
-	   m->mapped_port, mapped_port,
-	   m->protocol, protocol);
+  for(m = hash4[hash4_index(mapped_port)]; m != NULL; m = next) {
+    next = m->hnext4;
+    if(timer_expired(&m->timer)) {
+      remove_entry(m);
+      continue;
+    }
     if(m->mapped_port == mapped_port &&
        m->protocol == protocol) {
       m->ip4to6++;
@@ -175,6 +235,19 @@ ip64_addrmap_lookup_port(uint16_t mapped_port, uint8_t protocol)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static int
+mapped_port_in_use(uint16_t port)
+{
+  struct ip64_addrmap_entry *m;
+
+  for(m = hash4[hash4_index(port)]; m != NULL; m = m->hnext4) {
+    if(m->mapped_port == port) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static void
 increase_mapped_port(void)
 {
@@ -190,13 +263,13 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
 		    uint8_t protocol)
 {
   struct ip64_addrmap_entry *m;
+  unsigned h;
 
-  check_age();
   m = memb_alloc(&entrymemb);
   if(m == NULL) {
-    /* We could not allocate an entry, try to recycle one and try to
-       allocate again. */
-    if(recycle()) {
+    /* We could not allocate an entry: drop the expired ones, or failing
+       that recycle one, and try to allocate again. */
+    if(check_age() || recycle()) {
       m = memb_alloc(&entrymemb);
     }
   }
@@ -214,22 +287,19 @@ ip64_addrmap_create(const uip_ip6addr_t *ip6addr,
     /* Pick a new, unused local port. First make sure that the
        mapped_port number does not belong to any active connection. If
        so, we keep increasing the mapped_port until we're free. */
-    {
-      struct ip64_addrmap_entry *n;
-      n = list_head(entrylist);
-      while(n != NULL) {
-	if(n->mapped_port == mapped_port) {
-	  increase_mapped_port();
-	  n = list_head(entrylist);
-	} else {
-	  n = list_item_next(m);
-	}
-      }
+    while(mapped_port_in_use(mapped_port)) {
+      increase_mapped_port();
     }
     m->mapped_port = mapped_port;
     increase_mapped_port();
 
     list_add(entrylist, m);
+    h = hash6_index(ip6addr, ip6port, ip4addr, ip4port, protocol);
+    m->hnext6 = hash6[h];
+    hash6[h] = m;
+    h = hash4_index(m->mapped_port);
+    m->hnext4 = hash4[h];
+    hash4[h] = m;
     return m;
   }
   return NULL;
@@ -38,6 +38,7 @@
 
 struct ip64_addrmap_entry {
   struct ip64_addrmap_entry *next;
+  struct ip64_addrmap_entry *hnext6, *hnext4;
   struct timer timer;
   uip_ip6addr_t ip6addr;
   uip_ip4addr_t ip4addr;
@@ -45,12 +46,17 @@ struct ip64_addrmap_entry {
   uint16_t mapped_port;
   uint16_t ip6port;
   uint16_t ip4port;
+  /* Translation templates, kept by ip64.c: one's complement sums of
+     the fields that are the same for every packet of the flow. */
+  uint16_t hdrsum6to4;
+  uint16_t chksum6to4, chksum4to6;
   uint8_t protocol;
   uint8_t flags;
 };
 
 #define FLAGS_NONE       0
 #define FLAGS_RECYCLABLE 1
+#define FLAGS_TEMPLATE   2
 
 /**
  * Initialize the ip64_addrmap module.
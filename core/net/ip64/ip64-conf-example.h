@@ -45,4 +45,10 @@
  * optional configuration parameter. The default value is set in ip64.h 
  */
 /* #define IP64_CONF_DHCP                      1 */
+
+/*
+ * Optional: keep this many synthesized AAAA answers on the gateway, to
+ * answer repeated queries locally. Disabled (0) by default.
+ */
+/* #define IP64_DNS64_CONF_CACHE_SIZE          8 */
 #endif /* IP64_CONF_H */
@@ -33,7 +33,10 @@
 #include "ip64-addr.h"
 #include "ip64-dns64.h"
 
+#include "contiki-net.h"
+
 #include <stdio.h>
+#include <string.h>
 
 #define DEBUG 0
 
@@ -89,6 +92,363 @@ struct dns_answer {
 #define DNS_CLASS_IN    1
 #define DNS_CLASS_ANY 255
 
+#define DNS_PORT 53
+
+/* Number of synthesized AAAA answers kept by the gateway. 0 disables
+   the cache, and queries are always forwarded upstream. */
+#ifdef IP64_DNS64_CONF_CACHE_SIZE
+#define CACHE_SIZE IP64_DNS64_CONF_CACHE_SIZE
+#else /* IP64_DNS64_CONF_CACHE_SIZE */
+#define CACHE_SIZE 0
+#endif /* IP64_DNS64_CONF_CACHE_SIZE */
+
+/* Longest cached name, in wire format */
+#ifdef IP64_DNS64_CONF_CACHE_NAME_LEN
+#define CACHE_NAME_LEN IP64_DNS64_CONF_CACHE_NAME_LEN
+#else /* IP64_DNS64_CONF_CACHE_NAME_LEN */
+#define CACHE_NAME_LEN 64
+#endif /* IP64_DNS64_CONF_CACHE_NAME_LEN */
+
+/* Upper bound on the TTL of a cached answer, in seconds */
+#ifdef IP64_DNS64_CONF_CACHE_MAX_TTL
+#define CACHE_MAX_TTL IP64_DNS64_CONF_CACHE_MAX_TTL
+#else /* IP64_DNS64_CONF_CACHE_MAX_TTL */
+#define CACHE_MAX_TTL 3600
+#endif /* IP64_DNS64_CONF_CACHE_MAX_TTL */
+
+/* Queries answered from the cache, or held back while an identical
+   query is in flight */
+#ifdef IP64_DNS64_CONF_CACHE_WAITERS
+#define CACHE_WAITERS IP64_DNS64_CONF_CACHE_WAITERS
+#else /* IP64_DNS64_CONF_CACHE_WAITERS */
+#define CACHE_WAITERS 4
+#endif /* IP64_DNS64_CONF_CACHE_WAITERS */
+
+/* How long an upstream query may stay unanswered, in seconds */
+#define CACHE_PENDING_TIMEOUT 5
+
+#if CACHE_SIZE > 0
+enum {
+  CACHE_FREE,
+  CACHE_PENDING,
+  CACHE_VALID,
+};
+
+struct cache_entry {
+  unsigned long expires;
+  uip_ip4addr_t addr;
+  uint8_t name[CACHE_NAME_LEN];
+  uint8_t namelen;
+  uint8_t state;
+};
+
+struct cache_waiter {
+  uip_ip6addr_t client;
+  uip_ip6addr_t server;
+  uint16_t port;
+  uint8_t id[2];
+  uint8_t flags1;
+  uint8_t entry;
+  uint8_t ready;
+  uint8_t used;
+};
+
+static struct cache_entry cache[CACHE_SIZE];
+static struct cache_waiter waiters[CACHE_WAITERS];
+
+#define UIP_IP_BUF  ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+PROCESS(ip64_dns64_process, "DNS64 cache");
+#endif /* CACHE_SIZE > 0 */
+
+#if CACHE_SIZE > 0
+/*---------------------------------------------------------------------------*/
+/* Copy an uncompressed name, in lowercase. Returns its length including
+   the terminating zero label, or 0 if it is malformed or too long. */
+static int
+name_copy(uint8_t *dst, const uint8_t *src, const uint8_t *end)
+{
+  int len, i;
+  uint8_t n;
+
+  len = 0;
+  do {
+    if(src >= end) {
+      return 0;
+    }
+    n = *src++;
+    if((n & 0xc0) || src + n > end || len + 1 + n > CACHE_NAME_LEN) {
+      return 0;
+    }
+    dst[len++] = n;
+    for(i = 0; i < n; i++) {
+      uint8_t c = *src++;
+      dst[len++] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    }
+  } while(n != 0);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_free(struct cache_entry *e)
+{
+  struct cache_waiter *w;
+
+  e->state = CACHE_FREE;
+  for(w = waiters; w < &waiters[CACHE_WAITERS]; w++) {
+    if(w->used && w->entry == e - cache) {
+      w->used = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct cache_entry *
+cache_lookup(const uint8_t *name, int namelen)
+{
+  struct cache_entry *e;
+  unsigned long now;
+
+  now = clock_seconds();
+  for(e = cache; e < &cache[CACHE_SIZE]; e++) {
+    if(e->state != CACHE_FREE && (long)(e->expires - now) <= 0) {
+      cache_free(e);
+    }
+    if(e->state != CACHE_FREE && e->namelen == namelen &&
+       memcmp(e->name, name, namelen) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* A free entry, or else the valid entry closest to expiry. Entries with
+   a query in flight are never replaced. */
+static struct cache_entry *
+cache_alloc(void)
+{
+  struct cache_entry *e, *oldest;
+
+  oldest = NULL;
+  for(e = cache; e < &cache[CACHE_SIZE]; e++) {
+    if(e->state == CACHE_FREE) {
+      return e;
+    }
+    if(e->state == CACHE_VALID &&
+       (oldest == NULL || (long)(e->expires - oldest->expires) < 0)) {
+      oldest = e;
+    }
+  }
+  if(oldest != NULL) {
+    cache_free(oldest);
+  }
+  return oldest;
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_wakeup(const struct cache_entry *e)
+{
+  struct cache_waiter *w;
+
+  for(w = waiters; w < &waiters[CACHE_WAITERS]; w++) {
+    if(w->used && w->entry == e - cache) {
+      w->ready = 1;
+    }
+  }
+  process_poll(&ip64_dns64_process);
+}
+/*---------------------------------------------------------------------------*/
+/* Record the answer to a query forwarded upstream, and release the
+   identical queries that were held back meanwhile. */
+static void
+cache_answer(const uint8_t *qname, const uint8_t *end,
+             const uint8_t *addr, unsigned long ttl)
+{
+  uint8_t name[CACHE_NAME_LEN];
+  struct cache_entry *e;
+  int namelen;
+
+  namelen = name_copy(name, qname, end);
+  if(namelen == 0) {
+    return;
+  }
+  e = cache_lookup(name, namelen);
+  if(e == NULL || e->state != CACHE_PENDING) {
+    return;
+  }
+  if(addr == NULL) {
+    /* Nothing to synthesize: the held back queries get no answer and
+       will be retried by their clients */
+    cache_free(e);
+    return;
+  }
+  uip_ipaddr(&e->addr, addr[0], addr[1], addr[2], addr[3]);
+  e->expires = clock_seconds() + MIN(ttl, CACHE_MAX_TTL);
+  e->state = CACHE_VALID;
+  cache_wakeup(e);
+}
+/*---------------------------------------------------------------------------*/
+/* Build the answer to a waiting query in uip_buf and pass it to the
+   IPv6 stack, as if it came from the DNS server. */
+static void
+send_answer(const struct cache_waiter *w, const struct cache_entry *e)
+{
+  struct dns_hdr *hdr;
+  uint8_t *dns, *p;
+  uip_ip6addr_t addr;
+  unsigned long ttl;
+  uint16_t len;
+
+  dns = &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN];
+  hdr = (struct dns_hdr *)dns;
+  hdr->id[0] = w->id[0];
+  hdr->id[1] = w->id[1];
+  hdr->flags1 = DNS_FLAG1_RESPONSE | (w->flags1 & DNS_FLAG1_RD);
+  hdr->flags2 = DNS_FLAG2_RA;
+  hdr->numquestions[0] = 0;
+  hdr->numquestions[1] = 1;
+  hdr->numanswers[0] = 0;
+  hdr->numanswers[1] = 1;
+  memset(hdr->numauthrr, 0, 4);
+
+  /* The question, then an answer that points back to its name */
+  p = dns + sizeof(struct dns_hdr);
+  memcpy(p, e->name, e->namelen);
+  p += e->namelen;
+  *p++ = 0;
+  *p++ = DNS_TYPE_AAAA;
+  *p++ = 0;
+  *p++ = DNS_CLASS_IN;
+  *p++ = 0xc0;
+  *p++ = sizeof(struct dns_hdr);
+  *p++ = 0;
+  *p++ = DNS_TYPE_AAAA;
+  *p++ = 0;
+  *p++ = DNS_CLASS_IN;
+  ttl = e->expires - clock_seconds();
+  *p++ = ttl >> 24;
+  *p++ = ttl >> 16;
+  *p++ = ttl >> 8;
+  *p++ = ttl;
+  *p++ = 0;
+  *p++ = 16;
+  ip64_addr_4to6(&e->addr, &addr);
+  memcpy(p, &addr, 16);
+  p += 16;
+
+  len = p - dns + UIP_UDPH_LEN;
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->tcflow = 0;
+  UIP_IP_BUF->flow = 0;
+  UIP_IP_BUF->len[0] = len >> 8;
+  UIP_IP_BUF->len[1] = len & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = uip_ds6_if.cur_hop_limit;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &w->server);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &w->client);
+  UIP_UDP_BUF->srcport = UIP_HTONS(DNS_PORT);
+  UIP_UDP_BUF->destport = w->port;
+  UIP_UDP_BUF->udplen = UIP_HTONS(len);
+  UIP_UDP_BUF->udpchksum = 0;
+  uip_len = len + UIP_IPH_LEN;
+  uip_ext_len = 0;
+  UIP_UDP_BUF->udpchksum = ~(uip_udpchksum());
+  if(UIP_UDP_BUF->udpchksum == 0) {
+    UIP_UDP_BUF->udpchksum = 0xffff;
+  }
+  PRINTF("ip64_dns64: answering from the cache\n");
+  tcpip_input();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ip64_dns64_process, ev, data)
+{
+  struct cache_waiter *w;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    for(w = waiters; w < &waiters[CACHE_WAITERS]; w++) {
+      if(w->used && w->ready) {
+        w->used = 0;
+        send_answer(w, &cache[w->entry]);
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* CACHE_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
+int
+ip64_dns64_cache_query(const uip_ip6addr_t *client, const uip_ip6addr_t *server,
+                       uint16_t port, const uint8_t *data, int datalen)
+{
+#if CACHE_SIZE > 0
+  const struct dns_hdr *hdr;
+  uint8_t name[CACHE_NAME_LEN];
+  const uint8_t *q;
+  struct cache_entry *e;
+  struct cache_waiter *w;
+  int namelen;
+
+  /* Only standard queries with a single AAAA question are cached */
+  hdr = (const struct dns_hdr *)data;
+  if(datalen < (int)sizeof(struct dns_hdr) ||
+     (hdr->flags1 & ~DNS_FLAG1_RD) != 0 ||
+     hdr->numquestions[0] != 0 || hdr->numquestions[1] != 1) {
+    return 0;
+  }
+  namelen = name_copy(name, data + sizeof(struct dns_hdr), data + datalen);
+  q = data + sizeof(struct dns_hdr) + namelen;
+  if(namelen == 0 || q + DNS_QUESTION_SIZE > data + datalen ||
+     q[DNS_QUESTION_CLASS0] != 0 || q[DNS_QUESTION_CLASS1] != DNS_CLASS_IN ||
+     q[DNS_QUESTION_TYPE0] != 0 || q[DNS_QUESTION_TYPE1] != DNS_TYPE_AAAA) {
+    return 0;
+  }
+
+  e = cache_lookup(name, namelen);
+  if(e == NULL) {
+    /* Forward this query, and hold back identical ones meanwhile */
+    e = cache_alloc();
+    if(e != NULL) {
+      memcpy(e->name, name, namelen);
+      e->namelen = namelen;
+      e->expires = clock_seconds() + CACHE_PENDING_TIMEOUT;
+      e->state = CACHE_PENDING;
+    }
+    return 0;
+  }
+
+  for(w = waiters; w < &waiters[CACHE_WAITERS]; w++) {
+    if(!w->used) {
+      break;
+    }
+  }
+  if(w == &waiters[CACHE_WAITERS]) {
+    /* Too many queries waiting, let this one through */
+    return 0;
+  }
+  uip_ipaddr_copy(&w->client, client);
+  uip_ipaddr_copy(&w->server, server);
+  w->port = port;
+  w->id[0] = hdr->id[0];
+  w->id[1] = hdr->id[1];
+  w->flags1 = hdr->flags1;
+  w->entry = e - cache;
+  w->ready = 0;
+  w->used = 1;
+  if(!process_is_running(&ip64_dns64_process)) {
+    process_start(&ip64_dns64_process, NULL);
+  }
+  if(e->state == CACHE_VALID) {
+    cache_wakeup(e);
+  }
+  return 1;
+#else /* CACHE_SIZE > 0 */
+  return 0;
+#endif /* CACHE_SIZE > 0 */
+}
 /*---------------------------------------------------------------------------*/
 void
 ip64_dns64_6to4(const uint8_t *ipv6data, int ipv6datalen,
@@ -145,6 +505,10 @@ ip64_dns64_4to6(const uint8_t *ipv4data, int ipv4datalen,
   uint8_t *qcopy, *acopy, *lenptr;
   uint8_t *q;
   struct dns_hdr *hdr;
+#if CACHE_SIZE > 0
+  const uint8_t *addr4 = NULL;
+  unsigned long ttl = 0;
+#endif /* CACHE_SIZE > 0 */
 
   hdr = (struct dns_hdr *)ipv4data;
   PRINTF("ip64_dns64_4to6 id: %02x%02x\n", hdr->id[0], hdr->id[1]);
@@ -226,6 +590,14 @@ ip64_dns64_4to6(const uint8_t *ipv4data, int ipv4datalen,
 
       if(len == 4) {
         uip_ip4addr_t addr;
+#if CACHE_SIZE > 0
+        if(addr4 == NULL) {
+          /* The TTL was copied right before the address */
+          addr4 = adata;
+          ttl = ((unsigned long)adata[-6] << 24) | ((unsigned long)adata[-5] << 16) |
+            (adata[-4] << 8) | adata[-3];
+        }
+#endif /* CACHE_SIZE > 0 */
         uip_ipaddr(&addr, adata[0], adata[1], adata[2], adata[3]);
         ip64_addr_4to6(&addr, (uip_ip6addr_t *)acopy);
 
@@ -254,6 +626,14 @@ ip64_dns64_4to6(const uint8_t *ipv4data, int ipv4datalen,
       adata += len;
     }
   }
+#if CACHE_SIZE > 0
+  if((hdr->flags1 & DNS_FLAG1_RESPONSE) &&
+     hdr->numquestions[0] == 0 && hdr->numquestions[1] == 1) {
+    cache_answer(ipv4data + sizeof(struct dns_hdr), ipv4data + ipv4datalen,
+                 (hdr->flags2 & DNS_FLAG2_ERR_MASK) == DNS_FLAG2_ERR_NONE ?
+                 addr4 : NULL, ttl);
+  }
+#endif /* CACHE_SIZE > 0 */
   return ipv6datalen;
 }
 /*---------------------------------------------------------------------------*/
@@ -32,9 +32,18 @@
 #ifndef IP64_DNS64_H_
 #define IP64_DNS64_H_
 
+#include "net/ip/uip.h"
+
 void ip64_dns64_6to4(const uint8_t *ipv6data, int ipv6datalen,
                      uint8_t *ipv4data, int ipv4datalen);
 int ip64_dns64_4to6(const uint8_t *ipv4data, int ipv4datalen,
                     uint8_t *ipv6data, int ipv6datalen);
 
+/* With IP64_DNS64_CONF_CACHE_SIZE, answer a DNS query from the IPv6
+   network out of the cache, or hold it back while an identical query
+   is in flight. Returns non-zero if the query must not be forwarded. */
+int ip64_dns64_cache_query(const uip_ip6addr_t *client,
+                           const uip_ip6addr_t *server, uint16_t port,
+                           const uint8_t *data, int datalen);
+
 #endif /* IP64_DNS64_H_ */
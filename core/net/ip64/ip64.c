@@ -63,6 +63,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "ip64-ipv4-dhcp.h"
 #include "contiki-net.h"
+#include "net/ip/ip-chksum.h"
 
 #include "net/ip/uip-debug.h"
 
@@ -209,8 +210,15 @@ ip64_init(void)
 void
 ip64_set_hostaddr(const uip_ip4addr_t *hostaddr)
 {
+  struct ip64_addrmap_entry *m;
+
   ip64_hostaddr_configured = 1;
   ip64_addr_copy4(&ip64_hostaddr, hostaddr);
+
+  /* The translation templates include our address. */
+  for(m = ip64_addrmap_list(); m != NULL; m = m->next) {
+    m->flags &= ~FLAGS_TEMPLATE;
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -358,6 +366,86 @@ ipv6_transport_checksum(const uint8_t *packet, uint16_t len, uint8_t proto)
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
 /*---------------------------------------------------------------------------*/
+/* Carry a TCP or UDP checksum over from one pseudo-header to the other:
+   the addresses are replaced, while the length and protocol terms are
+   the same in IPv4 and IPv6. The port that the translation rewrote is
+   patched in as well. This saves summing the whole payload again. */
+static uint16_t
+translate_transport_checksum(uint16_t chksum,
+                             const uint8_t *old_addrs, uint16_t old_len,
+                             const uint8_t *new_addrs, uint16_t new_len,
+                             uint16_t old_port, uint16_t new_port)
+{
+  chksum = ip_chksum_replace(chksum, old_addrs, old_len, new_addrs, new_len);
+  return ip_chksum_replace16(chksum, old_port, new_port);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+add16(uint16_t a, uint16_t b)
+{
+  a += b;
+  return a < b ? a + 1 : a;
+}
+/*---------------------------------------------------------------------------*/
+/* Fill in the translation templates of an address mapping: the parts of
+   the IPv4 header checksum and of the transport checksum adjustments
+   that are the same for every packet of the flow. Everything is kept
+   as a host byte order one's complement sum. */
+static void
+mapping_template(struct ip64_addrmap_entry *m)
+{
+  uint16_t sum;
+
+  if(m->flags & FLAGS_TEMPLATE) {
+    return;
+  }
+
+  /* IPv4 header: version, header length, protocol, and addresses.
+     The length, id, and ttl are added per packet. */
+  sum = add16(0x4500, m->protocol);
+  sum = chksum(sum, (const uint8_t *)&ip64_hostaddr, sizeof(uip_ip4addr_t));
+  m->hdrsum6to4 = chksum(sum, (const uint8_t *)&m->ip4addr,
+                         sizeof(uip_ip4addr_t));
+
+  /* 6to4: our IPv6 source becomes our IPv4 address, the destination
+     becomes the mapped IPv4 address, and the source port becomes the
+     mapped port. The IPv6 destination is taken out per packet. */
+  sum = ~chksum(0, (const uint8_t *)&m->ip6addr, sizeof(uip_ip6addr_t));
+  sum = chksum(sum, (const uint8_t *)&ip64_hostaddr, sizeof(uip_ip4addr_t));
+  sum = chksum(sum, (const uint8_t *)&m->ip4addr, sizeof(uip_ip4addr_t));
+  sum = add16(sum, ~m->ip6port);
+  m->chksum6to4 = add16(sum, m->mapped_port);
+
+  /* 4to6: our IPv4 address becomes the IPv6 host's address, and the
+     mapped port its port. The source address is swapped per packet,
+     as any IPv4 host may answer on the mapped port. */
+  sum = ~chksum(0, (const uint8_t *)&ip64_hostaddr, sizeof(uip_ip4addr_t));
+  sum = chksum(sum, (const uint8_t *)&m->ip6addr, sizeof(uip_ip6addr_t));
+  sum = add16(sum, ~m->mapped_port);
+  m->chksum4to6 = add16(sum, m->ip6port);
+
+  m->flags |= FLAGS_TEMPLATE;
+}
+/*---------------------------------------------------------------------------*/
+/* Apply a template adjustment, plus the per-packet address swap, to a
+   transport checksum field. */
+static uint16_t
+template_transport_checksum(uint16_t field, uint16_t adjust,
+                            const uint8_t *old_addr, uint16_t old_len,
+                            const uint8_t *new_addr, uint16_t new_len)
+{
+  uint16_t sum;
+
+  sum = add16(~uip_ntohs(field), adjust);
+  if(old_len > 0) {
+    sum = add16(sum, ~chksum(0, old_addr, old_len));
+  }
+  if(new_len > 0) {
+    sum = chksum(sum, new_addr, new_len);
+  }
+  return uip_htons(~sum);
+}
+/*---------------------------------------------------------------------------*/
 int
 ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
 	  uint8_t *resultpacket)
@@ -368,8 +456,10 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   struct tcp_hdr *tcphdr;
   struct icmpv4_hdr *icmpv4hdr;
   struct icmpv6_hdr *icmpv6hdr;
+  const struct udp_hdr *v6udphdr;
   uint16_t ipv6len, ipv4len;
   struct ip64_addrmap_entry *m;
+  uint8_t incremental;
 
   v6hdr = (struct ipv6_hdr *)ipv6packet;
   v4hdr = (struct ipv4_hdr *)resultpacket;
@@ -391,6 +481,14 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
   tcphdr = (struct tcp_hdr *)&resultpacket[IPV4_HDRLEN];
   icmpv4hdr = (struct icmpv4_hdr *)&resultpacket[IPV4_HDRLEN];
   icmpv6hdr = (struct icmpv6_hdr *)&ipv6packet[IPV6_HDRLEN];
+  v6udphdr = (const struct udp_hdr *)&ipv6packet[IPV6_HDRLEN];
+
+  /* TCP and UDP checksums are updated incrementally from the IPv6
+     ones unless the payload itself gets rewritten below. */
+  incremental = 0;
+  /* Set when the packet belongs to a mapped flow, whose templates then
+     replace most of the checksum work. */
+  m = NULL;
 
   /* Translate the IPv6 header into an IPv4 header. */
 
@@ -425,14 +523,9 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
     PRINTF("ip64_6to4: TCP header\n");
     v4hdr->proto = IP_PROTO_TCP;
 
-    /* Compute and check the TCP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_TCP) != 0xffff) {
-      PRINTF("Bad TCP checksum, dropping packet\n");
-    }
-
+    /* The TCP checksum is carried over incrementally, so a bad
+       checksum stays bad and the IPv4 host will drop the segment. */
+    incremental = 1;
     break;
 
   case IP_PROTO_UDP:
@@ -442,17 +535,28 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
     /* Check if this is a DNS request. If so, we should rewrite it
        with the DNS64 module. */
     if(udphdr->destport == UIP_HTONS(DNS_PORT)) {
+      if(ip64_dns64_cache_query(&v6hdr->srcipaddr, &v6hdr->destipaddr,
+                                v6udphdr->srcport,
+                                ipv6packet + IPV6_HDRLEN + sizeof(struct udp_hdr),
+                                ipv6len - IPV6_HDRLEN - sizeof(struct udp_hdr))) {
+        /* Answered locally, or merged with a query in flight */
+        return 0;
+      }
       ip64_dns64_6to4((uint8_t *)v6hdr + IPV6_HDRLEN + sizeof(struct udp_hdr),
                       ipv6len - IPV6_HDRLEN - sizeof(struct udp_hdr),
                       (uint8_t *)udphdr + sizeof(struct udp_hdr),
                       BUFSIZE - IPV4_HDRLEN - sizeof(struct udp_hdr));
-    }
-    /* Compute and check the UDP checksum - since we're going to
-       recompute it ourselves, we must ensure that it was correct in
-       the first place. */
-    if(ipv6_transport_checksum(ipv6packet, ipv6len,
-                               IP_PROTO_UDP) != 0xffff) {
-      PRINTF("Bad UDP checksum, dropping packet\n");
+      /* Compute and check the UDP checksum - since we're going to
+         recompute it ourselves, we must ensure that it was correct in
+         the first place. */
+      if(ipv6_transport_checksum(ipv6packet, ipv6len,
+                                 IP_PROTO_UDP) != 0xffff) {
+        PRINTF("Bad UDP checksum, dropping packet\n");
+      }
+    } else {
+      /* A zero UDP checksum is not allowed in IPv6; leave it to the
+         full recomputation. */
+      incremental = v6udphdr->udpchksum != 0;
     }
     break;
 
@@ -604,13 +708,23 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
       /* Set the source port of the packet to be the mapped port
          number. */
       udphdr->srcport = uip_htons(m->mapped_port);
+      mapping_template(m);
     }
   }
 
   /* The IPv4 header is now complete, so we can compute the IPv4
-     header checksum. */
+     header checksum. A mapped flow only adds the fields that change
+     from packet to packet to its template. */
   v4hdr->ipchksum = 0;
-  v4hdr->ipchksum = ~(ipv4_checksum(v4hdr));
+  if(m != NULL) {
+    uint16_t sum;
+    sum = add16(m->hdrsum6to4, ipv4len);
+    sum = add16(sum, ipid);
+    sum = add16(sum, v4hdr->ttl << 8);
+    v4hdr->ipchksum = ~((sum == 0) ? 0xffff : uip_htons(sum));
+  } else {
+    v4hdr->ipchksum = ~(ipv4_checksum(v4hdr));
+  }
 
 
 
@@ -619,14 +733,45 @@ ip64_6to4(const uint8_t *ipv6packet, const uint16_t ipv6packet_len,
      field. */
   switch(v4hdr->proto) {
   case IP_PROTO_TCP:
+    if(incremental && m != NULL) {
+      tcphdr->tcpchksum =
+        template_transport_checksum(tcphdr->tcpchksum, m->chksum6to4,
+                                    (const uint8_t *)&v6hdr->destipaddr,
+                                    sizeof(uip_ip6addr_t), NULL, 0);
+      break;
+    } else if(incremental) {
+      tcphdr->tcpchksum =
+        translate_transport_checksum(tcphdr->tcpchksum,
+                                     (const uint8_t *)&v6hdr->srcipaddr,
+                                     2 * sizeof(uip_ip6addr_t),
+                                     (const uint8_t *)&v4hdr->srcipaddr,
+                                     2 * sizeof(uip_ip4addr_t),
+                                     v6udphdr->srcport, tcphdr->srcport);
+      break;
+    }
     tcphdr->tcpchksum = 0;
     tcphdr->tcpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
 						  IP_PROTO_TCP));
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
-						  IP_PROTO_UDP));
+    if(incremental && m != NULL) {
+      udphdr->udpchksum =
+        template_transport_checksum(udphdr->udpchksum, m->chksum6to4,
+                                    (const uint8_t *)&v6hdr->destipaddr,
+                                    sizeof(uip_ip6addr_t), NULL, 0);
+    } else if(incremental) {
+      udphdr->udpchksum =
+        translate_transport_checksum(udphdr->udpchksum,
+                                     (const uint8_t *)&v6hdr->srcipaddr,
+                                     2 * sizeof(uip_ip6addr_t),
+                                     (const uint8_t *)&v4hdr->srcipaddr,
+                                     2 * sizeof(uip_ip4addr_t),
+                                     v6udphdr->srcport, udphdr->srcport);
+    } else {
+      udphdr->udpchksum = 0;
+      udphdr->udpchksum = ~(ipv4_transport_checksum(resultpacket, ipv4len,
+                                                    IP_PROTO_UDP));
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
@@ -657,8 +802,10 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   struct tcp_hdr *tcphdr;
   struct icmpv4_hdr *icmpv4hdr;
   struct icmpv6_hdr *icmpv6hdr;
+  const struct udp_hdr *v4udphdr;
   uint16_t ipv4len, ipv6len, ipv6_packet_len;
   struct ip64_addrmap_entry *m;
+  uint8_t incremental;
 
   v6hdr = (struct ipv6_hdr *)resultpacket;
   v4hdr = (struct ipv4_hdr *)ipv4packet;
@@ -689,6 +836,12 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
   tcphdr = (struct tcp_hdr *)&resultpacket[IPV6_HDRLEN];
   icmpv4hdr = (struct icmpv4_hdr *)&ipv4packet[IPV4_HDRLEN];
   icmpv6hdr = (struct icmpv6_hdr *)&resultpacket[IPV6_HDRLEN];
+  v4udphdr = (const struct udp_hdr *)&ipv4packet[IPV4_HDRLEN];
+
+  /* TCP and UDP checksums are updated incrementally from the IPv4
+     ones unless the payload itself gets rewritten below. */
+  incremental = 0;
+  m = NULL;
 
   ipv6len = ipv4len - IPV4_HDRLEN + IPV6_HDRLEN;
   ipv6_packet_len = ipv6len - IPV6_HDRLEN;
@@ -742,11 +895,16 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
       v6hdr->len[1] = ipv6_packet_len & 0xff;
       ipv6len = ipv6_packet_len + IPV6_HDRLEN;
 
+    } else {
+      /* An IPv4 UDP packet without a checksum needs a full one for
+         IPv6. */
+      incremental = v4udphdr->udpchksum != 0;
     }
     break;
 
   case IP_PROTO_TCP:
     v6hdr->nxthdr = IP_PROTO_TCP;
+    incremental = 1;
     break;
 
   case IP_PROTO_ICMPV4:
@@ -845,6 +1003,7 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
 	}
 	ip64_addr_copy6(&v6hdr->destipaddr, &m->ip6addr);
 	udphdr->destport = uip_htons(m->ip6port);
+	mapping_template(m);
       }
     }
   }
@@ -854,16 +1013,51 @@ ip64_4to6(const uint8_t *ipv4packet, const uint16_t ipv4packet_len,
      field. */
   switch(v6hdr->nxthdr) {
   case IP_PROTO_TCP:
+    if(incremental && m != NULL) {
+      tcphdr->tcpchksum =
+        template_transport_checksum(tcphdr->tcpchksum, m->chksum4to6,
+                                    (const uint8_t *)&v4hdr->srcipaddr,
+                                    sizeof(uip_ip4addr_t),
+                                    (const uint8_t *)&v6hdr->srcipaddr,
+                                    sizeof(uip_ip6addr_t));
+      break;
+    } else if(incremental) {
+      tcphdr->tcpchksum =
+        translate_transport_checksum(tcphdr->tcpchksum,
+                                     (const uint8_t *)&v4hdr->srcipaddr,
+                                     2 * sizeof(uip_ip4addr_t),
+                                     (const uint8_t *)&v6hdr->srcipaddr,
+                                     2 * sizeof(uip_ip6addr_t),
+                                     v4udphdr->destport, tcphdr->destport);
+      break;
+    }
     tcphdr->tcpchksum = 0;
     tcphdr->tcpchksum = ~(ipv6_transport_checksum(resultpacket,
 						  ipv6len,
 						  IP_PROTO_TCP));
     break;
   case IP_PROTO_UDP:
-    udphdr->udpchksum = 0;
-    udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
-						  ipv6len,
-						  IP_PROTO_UDP));
+    if(incremental && m != NULL) {
+      udphdr->udpchksum =
+        template_transport_checksum(udphdr->udpchksum, m->chksum4to6,
+                                    (const uint8_t *)&v4hdr->srcipaddr,
+                                    sizeof(uip_ip4addr_t),
+                                    (const uint8_t *)&v6hdr->srcipaddr,
+                                    sizeof(uip_ip6addr_t));
+    } else if(incremental) {
+      udphdr->udpchksum =
+        translate_transport_checksum(udphdr->udpchksum,
+                                     (const uint8_t *)&v4hdr->srcipaddr,
+                                     2 * sizeof(uip_ip4addr_t),
+                                     (const uint8_t *)&v6hdr->srcipaddr,
+                                     2 * sizeof(uip_ip6addr_t),
+                                     v4udphdr->destport, udphdr->destport);
+    } else {
+      udphdr->udpchksum = 0;
+      udphdr->udpchksum = ~(ipv6_transport_checksum(resultpacket,
+                                                    ipv6len,
+                                                    IP_PROTO_UDP));
+    }
     if(udphdr->udpchksum == 0) {
       udphdr->udpchksum = 0xffff;
     }
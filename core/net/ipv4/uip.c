@@ -74,6 +74,7 @@
 #include "net/ip/uipopt.h"
 #include "net/ipv4/uip_arp.h"
 #include "net/ip/uip_arch.h"
+#include "net/ip/ip-chksum.h"
 
 #include "net/ipv4/uip-neighbor.h"
 
@@ -173,6 +174,13 @@ static uint16_t lastport;       /* Keeps track of the last port used for
 uint8_t uip_acc32[4];
 static uint8_t c, opt;
 static uint16_t tmp16;
+#if UIP_TCP_SEND_WINDOW
+/* The offset of the sequence number of an outgoing segment from the
+   first unacknowledged byte. */
+static uint16_t snd_offset;
+static uint8_t partial_ack;
+static int acked;
+#endif /* UIP_TCP_SEND_WINDOW */
 
 /* Structures and definitions. */
 #define TCP_FIN 0x01
@@ -212,6 +220,24 @@ static uint16_t tmp16;
 #define ICMPBUF ((struct uip_icmpip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UDPBUF ((struct uip_udpip_hdr *)&uip_buf[UIP_LLH_LEN])
 
+#if UIP_TCP_SEND_WINDOW
+/* The number of duplicate ACKs that triggers a fast retransmit. */
+#define UIP_TCP_DUPACK_THRESHOLD 3
+#define UIP_TCP_CAN_SEND(conn)   (uip_tcp_send_window(conn) > 0)
+#define UIP_TCP_SEND_EVENTS      UIP_POLL
+#else /* UIP_TCP_SEND_WINDOW */
+#define UIP_TCP_CAN_SEND(conn)   (!uip_outstanding(conn))
+#define UIP_TCP_SEND_EVENTS      0
+#endif /* UIP_TCP_SEND_WINDOW */
+
+#if UIP_TCP_DELAYED_ACK
+#define UIP_TCP_ACK_NOW(conn)    uip_tcp_ack_now(conn)
+#define UIP_TCP_ACK_DUE(conn)    ((conn)->ackpending > 0 && \
+                                  (conn)->acktimer == 0)
+#else /* UIP_TCP_DELAYED_ACK */
+#define UIP_TCP_ACK_NOW(conn)    (uip_flags & UIP_NEWDATA)
+#endif /* UIP_TCP_DELAYED_ACK */
+
 
 #if UIP_STATISTICS == 1
 struct uip_stats uip_stat;
@@ -260,41 +286,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {	/* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;		/* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(ip_chksum(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -303,7 +298,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = ip_chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   DEBUG_PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -326,11 +321,11 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = ip_chksum(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN],
-	       upper_layer_len);
+  sum = ip_chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN],
+		  upper_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -445,6 +440,16 @@ uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
 
   conn->len = 1;   /* TCP length of the SYN is one. */
   conn->nrtx = 0;
+  conn->rcv_wnd = UIP_RECEIVE_WINDOW;
+#if UIP_TCP_DELAYED_ACK
+  conn->ackpending = 0;
+  conn->rcv_unacked = 0;
+#endif /* UIP_TCP_DELAYED_ACK */
+#if UIP_TCP_SEND_WINDOW
+  conn->dupacks = 0;
+  conn->recover = 0;
+  conn->snd_wnd = UIP_TCP_MSS;
+#endif /* UIP_TCP_SEND_WINDOW */
   conn->timer = 1; /* Send the SYN next time around. */
   conn->rto = UIP_RTO;
   conn->sa = 0;
@@ -667,11 +672,111 @@ uip_add_rcv_nxt(uint16_t n)
   uip_conn->rcv_nxt[3] = uip_acc32[3];
 }
 /*---------------------------------------------------------------------------*/
+static void
+uip_update_rtt(struct uip_conn *conn)
+{
+  signed char m;
+
+  m = conn->rto - conn->timer;
+  /* This is taken directly from VJs original code in his paper */
+  m = m - (conn->sa >> 3);
+  conn->sa += m;
+  if(m < 0) {
+    m = -m;
+  }
+  m = m - (conn->sv >> 2);
+  conn->sv += m;
+  conn->rto = (conn->sa >> 3) + conn->sv;
+}
+#if UIP_TCP_DELAYED_ACK
+/*---------------------------------------------------------------------------*/
+/*
+ * Decides whether a pure ACK has to be sent now. Incoming data is
+ * acknowledged once UIP_TCP_DELAYED_ACK segments have arrived, or
+ * when the window would not fit another segment of the same size.
+ * Forced ACKs without data, such as window updates after
+ * uip_restart(), are never delayed.
+ */
+static int
+uip_tcp_ack_now(struct uip_conn *conn)
+{
+  if(uip_flags & UIP_NEWDATA) {
+    if(uip_len == 0 || (conn->tcpstateflags & UIP_STOPPED)) {
+      return 1;
+    }
+    if(conn->ackpending == 0) {
+      conn->acktimer = UIP_TCP_DELAYED_ACK_TIMEOUT;
+    }
+    ++conn->ackpending;
+    conn->rcv_unacked += uip_len;
+    return conn->ackpending >= UIP_TCP_DELAYED_ACK ||
+      conn->rcv_unacked + uip_len > conn->rcv_wnd;
+  }
+  return UIP_TCP_ACK_DUE(conn);
+}
+#endif /* UIP_TCP_DELAYED_ACK */
+#if UIP_TCP_SEND_WINDOW
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_tcp_send_window(struct uip_conn *conn)
+{
+  uint16_t wnd;
+
+  if((conn->tcpstateflags & (UIP_TS_MASK | UIP_CLOSE_PENDING)) !=
+     UIP_ESTABLISHED) {
+    return 0;
+  }
+
+  /* A zero window is probed with a full segment, like when there is
+     no send window. */
+  wnd = conn->snd_wnd;
+  if(wnd == 0 && conn->len == 0) {
+    wnd = conn->initialmss;
+  }
+  if(wnd > UIP_TCP_SEND_WINDOW) {
+    wnd = UIP_TCP_SEND_WINDOW;
+  }
+  if(conn->len >= wnd) {
+    return 0;
+  }
+  wnd -= conn->len;
+
+  return wnd < conn->mss ? wnd : conn->mss;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Returns the number of bytes in the send window that an incoming
+ * segment acknowledges, or -1 if the acknowledgment number lies
+ * outside the send window.
+ */
+static int
+uip_acked_len(struct uip_conn *conn)
+{
+  uint32_t n;
+
+  n = (((uint32_t)BUF->ackno[0] << 24) |
+       ((uint32_t)BUF->ackno[1] << 16) |
+       ((uint32_t)BUF->ackno[2] << 8) |
+       BUF->ackno[3]) -
+      (((uint32_t)conn->snd_nxt[0] << 24) |
+       ((uint32_t)conn->snd_nxt[1] << 16) |
+       ((uint32_t)conn->snd_nxt[2] << 8) |
+       conn->snd_nxt[3]);
+
+  return n <= conn->len ? (int)n : -1;
+}
+#endif /* UIP_TCP_SEND_WINDOW */
+/*---------------------------------------------------------------------------*/
 void
 uip_process(uint8_t flag)
 {
   register struct uip_conn *uip_connr = uip_conn;
 
+#if UIP_TCP_SEND_WINDOW
+  snd_offset = 0;
+  partial_ack = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
+
 #if UIP_UDP
   if(flag == UIP_UDP_SEND_CONN) {
     goto udp_send;
@@ -684,7 +789,7 @@ uip_process(uint8_t flag)
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
-       !uip_outstanding(uip_connr)) {
+       UIP_TCP_CAN_SEND(uip_connr)) {
 	uip_flags = UIP_POLL;
 	UIP_APPCALL();
 	goto appsend;
@@ -729,6 +834,11 @@ uip_process(uint8_t flag)
 	uip_connr->tcpstateflags = UIP_CLOSED;
       }
     } else if(uip_connr->tcpstateflags != UIP_CLOSED) {
+#if UIP_TCP_DELAYED_ACK
+      if(uip_connr->acktimer > 0) {
+	--uip_connr->acktimer;
+      }
+#endif /* UIP_TCP_DELAYED_ACK */
       /* If the connection has outstanding data, we increase the
 	 connection's timer and see if it has reached the RTO value
 	 in which case we retransmit. */
@@ -779,6 +889,12 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
 
 	  case UIP_ESTABLISHED:
+#if UIP_TCP_SEND_WINDOW
+	    /* With a send window, we retransmit the oldest
+	       unacknowledged segment from the retransmission buffer. */
+	    uip_connr->recover = uip_connr->len;
+	    goto tcp_send_rexmit;
+#else /* UIP_TCP_SEND_WINDOW */
 	    /* In the ESTABLISHED state, we call upon the application
                to do the actual retransmit after which we jump into
                the code for sending out the packet (the apprexmit
@@ -786,6 +902,7 @@ uip_process(uint8_t flag)
 	    uip_flags = UIP_REXMIT;
 	    UIP_APPCALL();
 	    goto apprexmit;
+#endif /* UIP_TCP_SEND_WINDOW */
 
 	  case UIP_FIN_WAIT_1:
 	  case UIP_CLOSING:
@@ -795,6 +912,24 @@ uip_process(uint8_t flag)
 
 	  }
 	}
+#if UIP_TCP_SEND_WINDOW
+	/* Let the application fill the rest of the send window. */
+	if(uip_tcp_send_window(uip_connr) > 0) {
+	  uip_flags = UIP_POLL;
+	  UIP_APPCALL();
+	  goto appsend;
+	}
+#endif /* UIP_TCP_SEND_WINDOW */
+#if UIP_TCP_DELAYED_ACK
+	/* Send a delayed ACK whose timer has expired. */
+	if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+	   UIP_TCP_ACK_DUE(uip_connr)) {
+#if UIP_TCP_SEND_WINDOW
+	  snd_offset = uip_connr->len;
+#endif /* UIP_TCP_SEND_WINDOW */
+	  goto tcp_send_ack;
+	}
+#endif /* UIP_TCP_DELAYED_ACK */
       } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
 	/* If there was no need for a retransmission, we poll the
            application for new data. */
@@ -1360,6 +1495,16 @@ uip_process(uint8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
+  uip_connr->rcv_wnd = UIP_RECEIVE_WINDOW;
+#if UIP_TCP_DELAYED_ACK
+  uip_connr->ackpending = 0;
+  uip_connr->rcv_unacked = 0;
+#endif /* UIP_TCP_DELAYED_ACK */
+#if UIP_TCP_SEND_WINDOW
+  uip_connr->dupacks = 0;
+  uip_connr->recover = 0;
+  uip_connr->snd_wnd = UIP_TCP_MSS;
+#endif /* UIP_TCP_SEND_WINDOW */
   uip_connr->lport = BUF->destport;
   uip_connr->rport = BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &BUF->srcipaddr);
@@ -1470,6 +1615,11 @@ uip_process(uint8_t flag)
 	BUF->seqno[1] != uip_connr->rcv_nxt[1] ||
 	BUF->seqno[2] != uip_connr->rcv_nxt[2] ||
 	BUF->seqno[3] != uip_connr->rcv_nxt[3])) {
+#if UIP_TCP_SEND_WINDOW
+      if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+	snd_offset = uip_connr->len;
+      }
+#endif /* UIP_TCP_SEND_WINDOW */
       goto tcp_send_ack;
     }
   }
@@ -1479,6 +1629,41 @@ uip_process(uint8_t flag)
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
   if((BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
+#if UIP_TCP_SEND_WINDOW
+    acked = uip_acked_len(uip_connr);
+    if(acked > 0 && acked < uip_connr->len) {
+      /* A cumulative ACK for the first part of the send window. We
+	 discard the acknowledged data from the retransmission buffer. */
+      uip_add32(uip_connr->snd_nxt, acked);
+      uip_connr->snd_nxt[0] = uip_acc32[0];
+      uip_connr->snd_nxt[1] = uip_acc32[1];
+      uip_connr->snd_nxt[2] = uip_acc32[2];
+      uip_connr->snd_nxt[3] = uip_acc32[3];
+      uip_connr->len -= acked;
+      memmove(uip_connr->sndbuf, &uip_connr->sndbuf[acked], uip_connr->len);
+
+      if(uip_connr->nrtx == 0) {
+	uip_update_rtt(uip_connr);
+      } else if(uip_connr->recover > acked) {
+	/* We are recovering from a loss; restart the backoff. */
+	uip_connr->recover -= acked;
+	uip_connr->nrtx = 1;
+      } else {
+	/* All data that was outstanding at the time of the loss has
+	   now been acknowledged. */
+	uip_connr->recover = 0;
+	uip_connr->nrtx = 0;
+      }
+      uip_connr->timer = uip_connr->rto;
+      uip_connr->dupacks = 0;
+      partial_ack = 1;
+    } else if(acked == 0 && uip_len == 0 &&
+	      (BUF->flags & (TCP_SYN | TCP_FIN)) == 0 &&
+	      uip_connr->snd_wnd == (((uint16_t)BUF->wnd[0] << 8) |
+				     BUF->wnd[1])) {
+      ++uip_connr->dupacks;
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
     if(BUF->ackno[0] == uip_acc32[0] &&
@@ -1493,18 +1678,7 @@ uip_process(uint8_t flag)
 
       /* Do RTT estimation, unless we have done retransmissions. */
       if(uip_connr->nrtx == 0) {
-	signed char m;
-	m = uip_connr->rto - uip_connr->timer;
-	/* This is taken directly from VJs original code in his paper */
-	m = m - (uip_connr->sa >> 3);
-	uip_connr->sa += m;
-	if(m < 0) {
-	  m = -m;
-	}
-	m = m - (uip_connr->sv >> 2);
-	uip_connr->sv += m;
-	uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
-
+	uip_update_rtt(uip_connr);
       }
       /* Set the acknowledged flag. */
       uip_flags = UIP_ACKDATA;
@@ -1513,6 +1687,10 @@ uip_process(uint8_t flag)
 
       /* Reset length of outstanding data. */
       uip_connr->len = 0;
+#if UIP_TCP_SEND_WINDOW
+      uip_connr->dupacks = 0;
+      uip_connr->recover = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
     }
 
   }
@@ -1532,6 +1710,9 @@ uip_process(uint8_t flag)
       uip_connr->tcpstateflags = UIP_ESTABLISHED;
       uip_flags = UIP_CONNECTED;
       uip_connr->len = 0;
+#if UIP_TCP_SEND_WINDOW
+      uip_connr->snd_wnd = ((uint16_t)BUF->wnd[0] << 8) + BUF->wnd[1];
+#endif /* UIP_TCP_SEND_WINDOW */
       if(uip_len > 0) {
         uip_flags |= UIP_NEWDATA;
         uip_add_rcv_nxt(uip_len);
@@ -1594,6 +1775,9 @@ uip_process(uint8_t flag)
       uip_add_rcv_nxt(1);
       uip_flags = UIP_CONNECTED | UIP_NEWDATA;
       uip_connr->len = 0;
+#if UIP_TCP_SEND_WINDOW
+      uip_connr->snd_wnd = ((uint16_t)BUF->wnd[0] << 8) + BUF->wnd[1];
+#endif /* UIP_TCP_SEND_WINDOW */
       uip_clear_buf();
       uip_slen = 0;
       UIP_APPCALL();
@@ -1681,12 +1865,38 @@ uip_process(uint8_t flag)
        "persistent timer" and uses the retransmission mechanim.
     */
     tmp16 = ((uint16_t)BUF->wnd[0] << 8) + (uint16_t)BUF->wnd[1];
+#if UIP_TCP_SEND_WINDOW
+    uip_connr->snd_wnd = tmp16;
+#endif /* UIP_TCP_SEND_WINDOW */
     if(tmp16 > uip_connr->initialmss ||
        tmp16 == 0) {
       tmp16 = uip_connr->initialmss;
     }
     uip_connr->mss = tmp16;
 
+#if UIP_TCP_SEND_WINDOW
+    /* Retransmit the oldest segment without waiting for the timer if
+       the peer has signalled a loss through duplicate ACKs, or if
+       an ACK during loss recovery reveals that the next segment is
+       missing as well. */
+    if(!(uip_flags & UIP_NEWDATA) &&
+       ((uip_connr->dupacks == UIP_TCP_DUPACK_THRESHOLD &&
+	 uip_connr->recover == 0) ||
+	(partial_ack && uip_connr->recover > 0))) {
+      if(uip_connr->nrtx == 0) {
+	uip_connr->nrtx = 1;
+      }
+      UIP_STAT(++uip_stat.tcp.rexmit);
+      goto tcp_send_rexmit;
+    }
+
+    /* The application may fill the part of the send window that was
+       acknowledged. */
+    if(partial_ack) {
+      uip_flags |= UIP_POLL;
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
+
     /* If this packet constitutes an ACK for outstanding data (flagged
        by the UIP_ACKDATA flag, we should call the application since it
        might want to send more data. If the incoming packet had data
@@ -1703,7 +1913,7 @@ uip_process(uint8_t flag)
        put into the uip_appdata and the length of the data should be
        put into uip_len. If the application don't have any data to
        send, uip_len must be set to 0. */
-    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
+    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA | UIP_TCP_SEND_EVENTS)) {
       uip_slen = 0;
       UIP_APPCALL();
 
@@ -1716,6 +1926,20 @@ uip_process(uint8_t flag)
 	goto tcp_send_nodata;
       }
 
+#if UIP_TCP_SEND_WINDOW
+      if((uip_flags & UIP_CLOSE) ||
+	 (uip_connr->tcpstateflags & UIP_CLOSE_PENDING)) {
+	uip_slen = 0;
+	/* The FIN follows the queued data once all the data has been
+	   acknowledged. */
+	if(uip_outstanding(uip_connr)) {
+	  uip_connr->tcpstateflags |= UIP_CLOSE_PENDING;
+	  uip_flags &= ~UIP_CLOSE;
+	} else {
+	  uip_flags |= UIP_CLOSE;
+	}
+      }
+#endif /* UIP_TCP_SEND_WINDOW */
       if(uip_flags & UIP_CLOSE) {
 	uip_slen = 0;
 	uip_connr->len = 1;
@@ -1725,6 +1949,58 @@ uip_process(uint8_t flag)
 	goto tcp_send_nodata;
       }
 
+#if UIP_TCP_SEND_WINDOW
+      /* If uip_slen > 0, the application has data to be sent. The
+	 data is appended to the send window, as far as the window and
+	 the MSS allows, and remains in the retransmission buffer until
+	 it has been acknowledged. */
+      if(uip_slen > 0) {
+	tmp16 = uip_tcp_send_window(uip_connr);
+	if(uip_slen > tmp16) {
+	  uip_slen = tmp16;
+	}
+	if(uip_slen > 0) {
+	  if(!uip_outstanding(uip_connr)) {
+	    uip_connr->nrtx = 0;
+	    uip_connr->timer = uip_connr->rto;
+	  }
+	  memcpy(&uip_connr->sndbuf[uip_connr->len], uip_sappdata, uip_slen);
+	  snd_offset = uip_connr->len;
+	  uip_connr->len += uip_slen;
+	}
+      } else if(!uip_outstanding(uip_connr)) {
+	uip_connr->nrtx = 0;
+      }
+      uip_appdata = uip_sappdata;
+
+      if(uip_slen > 0) {
+	uip_len = uip_slen + UIP_TCPIP_HLEN;
+	BUF->flags = TCP_ACK | TCP_PSH;
+	goto tcp_send_noopts;
+      }
+      if(UIP_TCP_ACK_NOW(uip_connr)) {
+	snd_offset = uip_connr->len;
+	uip_len = UIP_TCPIP_HLEN;
+	BUF->flags = TCP_ACK;
+	goto tcp_send_noopts;
+      }
+    }
+    goto drop;
+
+  tcp_send_rexmit:
+    /* Resend the oldest unacknowledged segment in the send window. */
+    uip_connr->dupacks = 0;
+    if(uip_connr->recover == 0) {
+      uip_connr->recover = uip_connr->len;
+    }
+    uip_slen = uip_connr->len < uip_connr->mss ?
+      uip_connr->len : uip_connr->mss;
+    memcpy(uip_sappdata, uip_connr->sndbuf, uip_slen);
+    snd_offset = 0;
+    uip_len = uip_slen + UIP_TCPIP_HLEN;
+    BUF->flags = TCP_ACK | TCP_PSH;
+    goto tcp_send_noopts;
+#else /* UIP_TCP_SEND_WINDOW */
       /* If uip_slen > 0, the application has data to be sent. */
       if(uip_slen > 0) {
 
@@ -1773,13 +2049,14 @@ uip_process(uint8_t flag)
       }
       /* If there is no data to send, just send out a pure ACK if
 	 there is newdata. */
-      if(uip_flags & UIP_NEWDATA) {
+      if(UIP_TCP_ACK_NOW(uip_connr)) {
 	uip_len = UIP_TCPIP_HLEN;
 	BUF->flags = TCP_ACK;
 	goto tcp_send_noopts;
       }
     }
     goto drop;
+#endif /* UIP_TCP_SEND_WINDOW */
   case UIP_LAST_ACK:
     /* We can close this connection if the peer has acknowledged our
        FIN. This is indicated by the UIP_ACKDATA flag. */
@@ -1863,15 +2140,29 @@ uip_process(uint8_t flag)
      headers before calculating the checksum and finally send the
      packet. */
  tcp_send:
+#if UIP_TCP_DELAYED_ACK
+  /* Every segment acknowledges all data received so far. */
+  uip_connr->ackpending = 0;
+  uip_connr->rcv_unacked = 0;
+#endif /* UIP_TCP_DELAYED_ACK */
+
   BUF->ackno[0] = uip_connr->rcv_nxt[0];
   BUF->ackno[1] = uip_connr->rcv_nxt[1];
   BUF->ackno[2] = uip_connr->rcv_nxt[2];
   BUF->ackno[3] = uip_connr->rcv_nxt[3];
 
+#if UIP_TCP_SEND_WINDOW
+  uip_add32(uip_connr->snd_nxt, snd_offset);
+  BUF->seqno[0] = uip_acc32[0];
+  BUF->seqno[1] = uip_acc32[1];
+  BUF->seqno[2] = uip_acc32[2];
+  BUF->seqno[3] = uip_acc32[3];
+#else /* UIP_TCP_SEND_WINDOW */
   BUF->seqno[0] = uip_connr->snd_nxt[0];
   BUF->seqno[1] = uip_connr->snd_nxt[1];
   BUF->seqno[2] = uip_connr->snd_nxt[2];
   BUF->seqno[3] = uip_connr->snd_nxt[3];
+#endif /* UIP_TCP_SEND_WINDOW */
 
   BUF->srcport  = uip_connr->lport;
   BUF->destport = uip_connr->rport;
@@ -1884,8 +2175,8 @@ uip_process(uint8_t flag)
        window so that the remote host will stop sending data. */
     BUF->wnd[0] = BUF->wnd[1] = 0;
   } else {
-    BUF->wnd[0] = ((UIP_RECEIVE_WINDOW) >> 8);
-    BUF->wnd[1] = ((UIP_RECEIVE_WINDOW) & 0xff);
+    BUF->wnd[0] = uip_connr->rcv_wnd >> 8;
+    BUF->wnd[1] = uip_connr->rcv_wnd & 0xff;
   }
 
  tcp_send_noconn:
@@ -45,6 +45,7 @@
 #include "contiki-net.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
+#include "net/ipv6/multicast/uip-mcast6-dup.h"
 #include "net/ipv6/multicast/roll-tm.h"
 #include "dev/watchdog.h"
 #include <string.h>
@@ -966,11 +967,19 @@ accept(uint8_t in)
 #endif
   m = HBH_GET_M(lochbhmptr);
 
-  locswptr = window_lookup(seed_ptr, m);
-
   seq_val = lochbhmptr->seq_id_lsb;
   seq_val |= HBH_GET_SV_MSB(lochbhmptr) << 8;
 
+  /* Most copies we hear are retransmissions of messages we already have */
+  if(uip_mcast6_dup_lookup(seed_ptr, sizeof(seed_id_t),
+                           seq_val | (m << 15))) {
+    PRINTF("ROLL TM: Seen before\n");
+    UIP_MCAST6_STATS_ADD(mcast_dropped);
+    return UIP_MCAST6_DROP;
+  }
+
+  locswptr = window_lookup(seed_ptr, m);
+
   if(locswptr) {
     if(SEQ_VAL_IS_LT(seq_val, locswptr->lower_bound)) {
       /* Too old, drop */
@@ -1063,6 +1072,7 @@ accept(uint8_t in)
   locmpptr->buff_len = uip_len;
   locmpptr->seq_val = seq_val;
   MCAST_PACKET_USED_SET(locmpptr);
+  uip_mcast6_dup_add(seed_ptr, sizeof(seed_id_t), seq_val | (m << 15));
 
   PRINTF("ROLL TM: Window for seed ");
   PRINT_SEED(&locswptr->seed_id);
@@ -1419,6 +1429,7 @@ init()
 
   ROLL_TM_STATS_INIT();
   UIP_MCAST6_STATS_INIT(&stats);
+  uip_mcast6_dup_init();
 
   /* Register the ICMPv6 input handler */
   uip_icmp6_register_input_handler(&roll_tm_icmp_handler);
@@ -45,6 +45,7 @@
 #include "contiki-net.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "net/ipv6/multicast/uip-mcast6-route.h"
+#include "net/ipv6/multicast/uip-mcast6-dup.h"
 #include "net/ipv6/multicast/uip-mcast6-stats.h"
 #include "net/ipv6/multicast/smrf.h"
 #include "net/rpl/rpl.h"
@@ -57,8 +58,13 @@
 /*---------------------------------------------------------------------------*/
 /* Macros */
 /*---------------------------------------------------------------------------*/
-/* CCI */
+/* CCI, or the time between the multicast cells of a TSCH schedule */
+#ifdef SMRF_CONF_FWD_DELAY
+clock_time_t SMRF_CONF_FWD_DELAY(void);
+#define SMRF_FWD_DELAY()  SMRF_CONF_FWD_DELAY()
+#else /* SMRF_CONF_FWD_DELAY */
 #define SMRF_FWD_DELAY()  NETSTACK_RDC.channel_check_interval()
+#endif /* SMRF_CONF_FWD_DELAY */
 /* Number of slots in the next 500ms */
 #define SMRF_INTERVAL_COUNT  ((CLOCK_SECOND >> 2) / fwd_delay)
 /*---------------------------------------------------------------------------*/
@@ -90,6 +96,7 @@ in()
   rpl_dag_t *d;                 /* Our DODAG */
   uip_ipaddr_t *parent_ipaddr;  /* Our pref. parent's IPv6 address */
   const uip_lladdr_t *parent_lladdr;  /* Our pref. parent's LL address */
+  uint16_t digest;              /* Identifies the datagram for dup checks */
 
   /*
    * Fetch a pointer to the LL address of our preferred parent
@@ -131,6 +138,17 @@ in()
   }
 
   UIP_MCAST6_STATS_ADD(mcast_in_all);
+
+  /* Copies of a datagram we already handled: don't forward them again */
+  digest = uip_mcast6_dup_digest();
+  if(uip_mcast6_dup_lookup(&UIP_IP_BUF->srcipaddr, sizeof(uip_ipaddr_t),
+                           digest)) {
+    PRINTF("SMRF: Seen before\n");
+    UIP_MCAST6_STATS_ADD(mcast_dropped);
+    return UIP_MCAST6_DROP;
+  }
+  uip_mcast6_dup_add(&UIP_IP_BUF->srcipaddr, sizeof(uip_ipaddr_t), digest);
+
   UIP_MCAST6_STATS_ADD(mcast_in_unique);
 
   /* If we have an entry in the mcast routing table, something with
@@ -191,6 +209,7 @@ static void
 init()
 {
   UIP_MCAST6_STATS_INIT(NULL);
+  uip_mcast6_dup_init();
 
   uip_mcast6_route_init();
 }
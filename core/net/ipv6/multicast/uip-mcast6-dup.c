@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \addtogroup uip6-multicast
+ * @{
+ */
+/**
+ * \file
+ *    Multicast duplicate suppression cache
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/ip-chksum.h"
+#include "net/ipv6/multicast/uip-mcast6-dup.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if UIP_MCAST6_DUP_NUM
+/*---------------------------------------------------------------------------*/
+/* Number of hash buckets that entries are indexed by. Must be a power of 2 */
+#ifdef UIP_MCAST6_DUP_CONF_HASH_SIZE
+#define UIP_MCAST6_DUP_HASH_SIZE UIP_MCAST6_DUP_CONF_HASH_SIZE
+#else
+#define UIP_MCAST6_DUP_HASH_SIZE 8
+#endif
+
+#if UIP_MCAST6_DUP_HASH_SIZE & (UIP_MCAST6_DUP_HASH_SIZE - 1)
+#error "UIP_MCAST6_DUP_CONF_HASH_SIZE must be a power of 2"
+#endif
+
+#if UIP_MCAST6_DUP_NUM >= 0xff
+#error "UIP_MCAST6_DUP_CONF_NUM must be below 255"
+#endif
+
+#define NONE 0xff
+/*---------------------------------------------------------------------------*/
+struct dup_entry {
+  uip_ip6addr_t seed;
+  clock_time_t seen;
+  uint16_t seq;
+  uint8_t next;       /* Next entry in the same bucket, or NONE */
+  uint8_t bucket;     /* The bucket this entry is in, or NONE if unused */
+};
+
+static struct dup_entry entries[UIP_MCAST6_DUP_NUM];
+static uint8_t buckets[UIP_MCAST6_DUP_HASH_SIZE];
+/* Entries are recycled in the order they were added, oldest first */
+static uint8_t oldest;
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+/*---------------------------------------------------------------------------*/
+static void
+make_seed(uip_ip6addr_t *s, const void *seed, uint8_t seed_len)
+{
+  if(seed_len > sizeof(uip_ip6addr_t)) {
+    seed_len = sizeof(uip_ip6addr_t);
+  }
+  memset(s, 0, sizeof(uip_ip6addr_t));
+  memcpy(s, seed, seed_len);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+hash_index(const uip_ip6addr_t *s, uint16_t seq)
+{
+  return (s->u8[15] ^ s->u8[14] ^ s->u8[1] ^ s->u8[0] ^ seq ^ (seq >> 8)) &
+    (UIP_MCAST6_DUP_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+uip_mcast6_dup_lookup(const void *seed, uint8_t seed_len, uint16_t seq)
+{
+  uip_ip6addr_t s;
+  struct dup_entry *e;
+  uint8_t i;
+
+  make_seed(&s, seed, seed_len);
+
+  for(i = buckets[hash_index(&s, seq)]; i != NONE; i = e->next) {
+    e = &entries[i];
+    if(e->seq == seq && uip_ip6addr_cmp(&e->seed, &s)) {
+      return clock_time() - e->seen < UIP_MCAST6_DUP_LIFETIME;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_mcast6_dup_add(const void *seed, uint8_t seed_len, uint16_t seq)
+{
+  struct dup_entry *e;
+  uint8_t *p;
+  uint8_t h;
+
+  e = &entries[oldest];
+
+  /* Unlink the entry we are about to recycle */
+  if(e->bucket != NONE) {
+    for(p = &buckets[e->bucket]; *p != NONE; p = &entries[*p].next) {
+      if(*p == oldest) {
+        *p = e->next;
+        break;
+      }
+    }
+  }
+
+  make_seed(&e->seed, seed, seed_len);
+  e->seq = seq;
+  e->seen = clock_time();
+  h = hash_index(&e->seed, seq);
+  e->bucket = h;
+  e->next = buckets[h];
+  buckets[h] = oldest;
+
+  oldest = (oldest + 1) % UIP_MCAST6_DUP_NUM;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_mcast6_dup_digest(void)
+{
+  uint8_t *data;
+  uint16_t len;
+  uint16_t sum;
+
+  data = &uip_buf[UIP_LLH_LEN + UIP_IPH_LEN];
+  len = uip_len - UIP_IPH_LEN;
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO && len >= 2) {
+    uint16_t ext_len = (data[1] + 1) << 3;
+    data += ext_len;
+    len = len > ext_len ? len - ext_len : 0;
+  }
+
+  sum = ip_chksum(0, (uint8_t *)&UIP_IP_BUF->destipaddr,
+                  sizeof(uip_ipaddr_t));
+  return ip_chksum(sum, data, len);
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_mcast6_dup_init(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < UIP_MCAST6_DUP_NUM; i++) {
+    entries[i].bucket = NONE;
+  }
+  memset(buckets, NONE, sizeof(buckets));
+  oldest = 0;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_MCAST6_DUP_NUM */
+/** @} */
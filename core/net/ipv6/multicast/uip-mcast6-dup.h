@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \addtogroup uip6-multicast
+ * @{
+ */
+/**
+ * \file
+ *    Header file for the multicast duplicate suppression cache
+ *
+ *    The cache remembers recently seen (seed, sequence) pairs for all
+ *    multicast engines. Engines with sequence numbers of their own, such
+ *    as ROLL TM, use them directly. Engines without, such as SMRF and
+ *    ESMRF, use the source address and a digest of the datagram.
+ */
+#ifndef UIP_MCAST6_DUP_H_
+#define UIP_MCAST6_DUP_H_
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/* Number of cache entries. 0 disables the cache */
+#ifdef UIP_MCAST6_DUP_CONF_NUM
+#define UIP_MCAST6_DUP_NUM UIP_MCAST6_DUP_CONF_NUM
+#else
+#define UIP_MCAST6_DUP_NUM 8
+#endif
+
+/* How long an entry suppresses duplicates, in clock ticks */
+#ifdef UIP_MCAST6_DUP_CONF_LIFETIME
+#define UIP_MCAST6_DUP_LIFETIME UIP_MCAST6_DUP_CONF_LIFETIME
+#else
+#define UIP_MCAST6_DUP_LIFETIME (4 * CLOCK_SECOND)
+#endif
+/*---------------------------------------------------------------------------*/
+/** \name Multicast Duplicate Suppression */
+/** @{ */
+#if UIP_MCAST6_DUP_NUM
+/**
+ * \brief Check whether a datagram was seen recently
+ * \param seed A pointer to the seed ID (the originator of the datagram)
+ * \param seed_len The length of the seed ID, at most 16 bytes
+ * \param seq The datagram's sequence value
+ * \return 1 if (seed, seq) is in the cache, 0 otherwise
+ */
+uint8_t uip_mcast6_dup_lookup(const void *seed, uint8_t seed_len,
+                              uint16_t seq);
+
+/**
+ * \brief Record a datagram as seen
+ * \param seed A pointer to the seed ID (the originator of the datagram)
+ * \param seed_len The length of the seed ID, at most 16 bytes
+ * \param seq The datagram's sequence value
+ *
+ *        The oldest entry is replaced when the cache is full.
+ */
+void uip_mcast6_dup_add(const void *seed, uint8_t seed_len, uint16_t seq);
+
+/**
+ * \brief Compute a sequence value for the datagram in uip_buf
+ * \return A digest of the destination and the upper layer part of the
+ *         datagram
+ *
+ *        For engines without sequence numbers of their own. The hop limit
+ *        and a leading hop-by-hop options header are left out, as they
+ *        change along the path.
+ */
+uint16_t uip_mcast6_dup_digest(void);
+
+/**
+ * \brief Multicast duplicate cache init routine
+ */
+void uip_mcast6_dup_init(void);
+#else /* UIP_MCAST6_DUP_NUM */
+#define uip_mcast6_dup_lookup(seed, seed_len, seq) 0
+#define uip_mcast6_dup_add(seed, seed_len, seq) ((void)(seq))
+#define uip_mcast6_dup_digest() 0
+#define uip_mcast6_dup_init()
+#endif /* UIP_MCAST6_DUP_NUM */
+/** @} */
+
+#endif /* UIP_MCAST6_DUP_H_ */
+/** @} */
@@ -56,19 +56,42 @@
 #else
 #define UIP_MCAST6_ROUTE_ROUTES 1
 #endif /* UIP_CONF_DS6_MCAST_ROUTES */
+
+/* Number of hash buckets that routes are indexed by. Must be a power of 2 */
+#ifdef UIP_MCAST6_ROUTE_CONF_HASH_SIZE
+#define UIP_MCAST6_ROUTE_HASH_SIZE UIP_MCAST6_ROUTE_CONF_HASH_SIZE
+#else
+#define UIP_MCAST6_ROUTE_HASH_SIZE 8
+#endif
+
+#if UIP_MCAST6_ROUTE_HASH_SIZE & (UIP_MCAST6_ROUTE_HASH_SIZE - 1)
+#error "UIP_MCAST6_ROUTE_CONF_HASH_SIZE must be a power of 2"
+#endif
 /*---------------------------------------------------------------------------*/
 LIST(mcast_route_list);
 MEMB(mcast_route_memb, uip_mcast6_route_t, UIP_MCAST6_ROUTE_ROUTES);
 
+static uip_mcast6_route_t *mcast_route_hash[UIP_MCAST6_ROUTE_HASH_SIZE];
+
 static uip_mcast6_route_t *locmcastrt;
 /*---------------------------------------------------------------------------*/
+/*
+ * Groups differ mostly in their low-order bytes (the group ID), while the
+ * high-order ones carry flags, scope, and often a common prefix.
+ */
+static uint8_t
+hash_index(const uip_ipaddr_t *group)
+{
+  return (group->u8[15] ^ group->u8[14] ^ group->u8[13] ^ group->u8[1]) &
+    (UIP_MCAST6_ROUTE_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
 uip_mcast6_route_t *
 uip_mcast6_route_lookup(uip_ipaddr_t *group)
 {
-  locmcastrt = NULL;
-  for(locmcastrt = list_head(mcast_route_list);
+  for(locmcastrt = mcast_route_hash[hash_index(group)];
       locmcastrt != NULL;
-      locmcastrt = list_item_next(locmcastrt)) {
+      locmcastrt = locmcastrt->hnext) {
     if(uip_ipaddr_cmp(&locmcastrt->group, group)) {
       return locmcastrt;
     }
@@ -80,6 +103,8 @@ uip_mcast6_route_lookup(uip_ipaddr_t *group)
 uip_mcast6_route_t *
 uip_mcast6_route_add(uip_ipaddr_t *group)
 {
+  uint8_t h;
+
   /* _lookup must return NULL, i.e. the prefix does not exist in our table */
   locmcastrt = uip_mcast6_route_lookup(group);
   if(locmcastrt == NULL) {
@@ -89,23 +114,29 @@ uip_mcast6_route_add(uip_ipaddr_t *group)
       return NULL;
     }
     list_add(mcast_route_list, locmcastrt);
+
+    uip_ipaddr_copy(&(locmcastrt->group), group);
+    h = hash_index(group);
+    locmcastrt->hnext = mcast_route_hash[h];
+    mcast_route_hash[h] = locmcastrt;
   }
 
   /* Reaching here means we either found the prefix or allocated a new one */
 
-  uip_ipaddr_copy(&(locmcastrt->group), group);
-
   return locmcastrt;
 }
 /*---------------------------------------------------------------------------*/
 void
 uip_mcast6_route_rm(uip_mcast6_route_t *route)
 {
-  /* Make sure it's actually in the list */
-  for(locmcastrt = list_head(mcast_route_list);
-      locmcastrt != NULL;
-      locmcastrt = list_item_next(locmcastrt)) {
-    if(locmcastrt == route) {
+  uip_mcast6_route_t **p;
+
+  /* Make sure it's actually in the table */
+  for(p = &mcast_route_hash[hash_index(&route->group)];
+      *p != NULL;
+      p = &(*p)->hnext) {
+    if(*p == route) {
+      *p = route->hnext;
       list_remove(mcast_route_list, route);
       memb_free(&mcast_route_memb, route);
       return;
@@ -130,6 +161,7 @@ uip_mcast6_route_init()
 {
   memb_init(&mcast_route_memb);
   list_init(mcast_route_list);
+  memset(mcast_route_hash, 0, sizeof(mcast_route_hash));
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -69,6 +69,13 @@
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/pkttrace.h"
+
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl.h"
+#include "net/rpl/rpl-private.h"
+#endif /* UIP_CONF_IPV6_RPL */
 
 #include <stdio.h>
 
@@ -101,6 +108,26 @@ void uip_log(char *msg);
 #endif /* SICSLOWPAN_CONF_COMPRESSION */
 #endif /* SICSLOWPAN_COMPRESSION */
 
+/* With SICSLOWPAN_CONF_6LORH, the RPL option and the RPL source routing
+   header are compressed as RFC 8138 6LoRH headers, in dispatch page 1 */
+#ifdef SICSLOWPAN_CONF_6LORH
+#define SICSLOWPAN_6LORH SICSLOWPAN_CONF_6LORH
+#else
+#define SICSLOWPAN_6LORH 0
+#endif /* SICSLOWPAN_CONF_6LORH */
+
+#if SICSLOWPAN_6LORH && SICSLOWPAN_COMPRESSION != SICSLOWPAN_COMPRESSION_HC06
+#error SICSLOWPAN_CONF_6LORH requires SICSLOWPAN_COMPRESSION_HC06
+#endif
+
+/* 6LoRH headers longer than this many bytes are not used for source
+   routing headers, which are then sent inline */
+#ifdef SICSLOWPAN_CONF_6LORH_RH3_MAX_LEN
+#define SICSLOWPAN_6LORH_RH3_MAX_LEN SICSLOWPAN_CONF_6LORH_RH3_MAX_LEN
+#else
+#define SICSLOWPAN_6LORH_RH3_MAX_LEN 48
+#endif /* SICSLOWPAN_CONF_6LORH_RH3_MAX_LEN */
+
 #define GET16(ptr,index) (((uint16_t)((ptr)[index] << 8)) | ((ptr)[(index) + 1]))
 #define SET16(ptr,index,value) do {     \
   (ptr)[index] = ((value) >> 8) & 0xff; \
@@ -155,6 +182,35 @@ void uip_log(char *msg);
 #define MAC_MAX_PAYLOAD (127 - 2)
 #endif /* SICSLOWPAN_CONF_MAC_MAX_PAYLOAD */
 
+#if MAC_MAX_PAYLOAD > PACKETBUF_SIZE
+#error SICSLOWPAN_CONF_MAC_MAX_PAYLOAD does not fit the packetbuf (PACKETBUF_CONF_SIZE)
+#endif
+
+/** \brief The same for a 127 byte frame of 802.15.4-2006 */
+#define MAC_LEGACY_MAX_PAYLOAD (127 - 2)
+
+/* With SICSLOWPAN_NBR_MTU, frames longer than 127 bytes are only sent to
+ * neighbors that are known to handle them: they have sent us such a frame,
+ * or sicslowpan_set_nbr_max_payload() was called for them. Other
+ * destinations, and broadcast, get SICSLOWPAN_NBR_DEFAULT_MAX_PAYLOAD.
+ * This lets nodes with large frames share a network with nodes limited to
+ * 127 bytes. Only meaningful when MAC_MAX_PAYLOAD is above that.
+ **/
+#ifdef SICSLOWPAN_CONF_NBR_MTU
+#define SICSLOWPAN_NBR_MTU SICSLOWPAN_CONF_NBR_MTU
+#else
+#define SICSLOWPAN_NBR_MTU 0
+#endif
+
+#ifdef SICSLOWPAN_CONF_NBR_DEFAULT_MAX_PAYLOAD
+#define SICSLOWPAN_NBR_DEFAULT_MAX_PAYLOAD SICSLOWPAN_CONF_NBR_DEFAULT_MAX_PAYLOAD
+#else
+#define SICSLOWPAN_NBR_DEFAULT_MAX_PAYLOAD MAC_LEGACY_MAX_PAYLOAD
+#endif
+
+/* The shortest 802.15.4 header: frame control and sequence number */
+#define MAC_MIN_HDRLEN 3
+
 
 /** \brief Some MAC layers need a minimum payload, which is configurable
     through the SICSLOWPAN_CONF_COMPRESSION_THRESHOLD option. */
@@ -244,6 +300,8 @@ static uint16_t my_tag;
 /* The size of each fragment (IP payload) for the 6lowpan fragmentation */
 #ifdef SICSLOWPAN_CONF_FRAGMENT_SIZE
 #define SICSLOWPAN_FRAGMENT_SIZE SICSLOWPAN_CONF_FRAGMENT_SIZE
+#elif MAC_MAX_PAYLOAD > MAC_LEGACY_MAX_PAYLOAD
+#define SICSLOWPAN_FRAGMENT_SIZE (MAC_MAX_PAYLOAD - MAC_MIN_HDRLEN - SICSLOWPAN_FRAGN_HDR_LEN)
 #else
 #define SICSLOWPAN_FRAGMENT_SIZE 110
 #endif
@@ -251,6 +309,68 @@ static uint16_t my_tag;
 /* Assuming that the worst growth for uncompression is 38 bytes */
 #define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
 
+/* With SICSLOWPAN_REASS_BUFFER, each reassembly context holds a buffer
+ * for a whole datagram and every fragment is written straight to its
+ * final offset in it. A completed datagram is then moved to uip_buf
+ * with a single memcpy, instead of being gathered from the fragment
+ * buffers. This costs a full IP buffer per context but no fragment
+ * buffers, and fragments can no longer be dropped for lack of a free
+ * fragment buffer.
+ **/
+#ifdef SICSLOWPAN_CONF_REASS_BUFFER
+#define SICSLOWPAN_REASS_BUFFER SICSLOWPAN_CONF_REASS_BUFFER
+#else
+#define SICSLOWPAN_REASS_BUFFER 0
+#endif
+
+/* SICSLOWPAN_REASS_BUDGET, when non-zero, is a byte budget shared by
+ * all reassembly contexts. Each datagram gets a buffer of its own size
+ * from the budget when its first fragment arrives, so a router can run
+ * many reassemblies of small datagrams, or a few large ones, with
+ * SICSLOWPAN_REASS_CONTEXTS only bounding the number of concurrent
+ * datagrams. Implies SICSLOWPAN_REASS_BUFFER.
+ **/
+#ifdef SICSLOWPAN_CONF_REASS_BUDGET
+#define SICSLOWPAN_REASS_BUDGET SICSLOWPAN_CONF_REASS_BUDGET
+#else
+#define SICSLOWPAN_REASS_BUDGET 0
+#endif
+
+#if SICSLOWPAN_REASS_BUDGET
+#undef SICSLOWPAN_REASS_BUFFER
+#define SICSLOWPAN_REASS_BUFFER 1
+#endif /* SICSLOWPAN_REASS_BUDGET */
+
+#define SICSLOWPAN_REASS_BUFFER_SIZE (UIP_BUFSIZE - UIP_LLH_LEN)
+
+/* With SICSLOWPAN_FRAG_FORWARDING, a router does not reassemble
+ * datagrams that it only forwards. The first fragment is decompressed
+ * to find the next hop, compressed again for the next link and sent
+ * on under a new tag. The following fragments are then looked up in a
+ * table of SICSLOWPAN_VRB_ENTRIES "virtual reassembly buffers" and sent
+ * on as soon as they arrive, with only their tag rewritten. Datagrams
+ * that need more than their IPv6 header to be routed are reassembled
+ * as before.
+ **/
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING SICSLOWPAN_CONF_FRAG_FORWARDING
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+#ifdef SICSLOWPAN_CONF_VRB_ENTRIES
+#define SICSLOWPAN_VRB_ENTRIES SICSLOWPAN_CONF_VRB_ENTRIES
+#else
+#define SICSLOWPAN_VRB_ENTRIES 4
+#endif
+
+#if SICSLOWPAN_REASS_STATS
+static struct sicslowpan_reass_stats reass_stats;
+#define REASS_STAT(s) s
+#else /* SICSLOWPAN_REASS_STATS */
+#define REASS_STAT(s)
+#endif /* SICSLOWPAN_REASS_STATS */
+
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
   /** When reassembling, the source address of the fragments being merged */
@@ -268,20 +388,114 @@ struct sicslowpan_frag_info {
 
   /** Fragment size of first fragment */
   uint16_t first_frag_len;
+#if SICSLOWPAN_REASS_BUDGET
+  /** The datagram being reassembled, in a buffer taken from reass_pool */
+  uint8_t *first_frag;
+  /** Size of the buffer */
+  uint16_t buf_len;
+#elif SICSLOWPAN_REASS_BUFFER
+  /** The datagram being reassembled, with each fragment at its offset.
+   The first fragment is decompressed directly into the start of it. */
+  uint8_t first_frag[SICSLOWPAN_REASS_BUFFER_SIZE];
+#else /* SICSLOWPAN_REASS_BUDGET */
   /** First fragment - needs a larger buffer since the size is uncompressed size
    and we need to know total size to know when we have received last fragment. */
   uint8_t first_frag[SICSLOWPAN_FIRST_FRAGMENT_SIZE];
+#endif /* SICSLOWPAN_REASS_BUDGET */
 };
 
 static struct sicslowpan_frag_info frag_info[SICSLOWPAN_REASS_CONTEXTS];
 
+#if SICSLOWPAN_REASS_BUDGET
+/* Word-aligned, as the IPv6 header is decompressed in place */
+static uint32_t reass_pool[(SICSLOWPAN_REASS_BUDGET + 3) / 4];
+
+#define REASS_BUF_LEN(i) (frag_info[i].buf_len)
+/*---------------------------------------------------------------------------*/
+/* Take a buffer for context index from the budget, first fit. Contexts
+   are few, so the gaps are found by checking the start of the pool and
+   the end of each buffer in use. */
+static int
+reass_alloc(uint8_t index, uint16_t size)
+{
+  uint8_t *pool = (uint8_t *)reass_pool;
+  uint8_t *start;
+  int c, i;
+
+  size = (size + 3) & ~3;
+  for(c = -1; c < SICSLOWPAN_REASS_CONTEXTS; c++) {
+    if(c < 0) {
+      start = pool;
+    } else if(frag_info[c].len > 0 && c != index) {
+      start = frag_info[c].first_frag + frag_info[c].buf_len;
+    } else {
+      continue;
+    }
+    if((uint32_t)(start - pool) + size > sizeof(reass_pool)) {
+      continue;
+    }
+    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+      if(frag_info[i].len > 0 && i != index &&
+         start < frag_info[i].first_frag + frag_info[i].buf_len &&
+         frag_info[i].first_frag < start + size) {
+        break;
+      }
+    }
+    if(i == SICSLOWPAN_REASS_CONTEXTS) {
+      frag_info[index].first_frag = start;
+      frag_info[index].buf_len = size;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#else /* SICSLOWPAN_REASS_BUDGET */
+#define REASS_BUF_LEN(i) SICSLOWPAN_REASS_BUFFER_SIZE
+#endif /* SICSLOWPAN_REASS_BUDGET */
+
+#if SICSLOWPAN_REASS_BUFFER
+/*---------------------------------------------------------------------------*/
+static int
+clear_fragments(uint8_t frag_info_index)
+{
+  frag_info[frag_info_index].len = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+timeout_fragments(int not_context)
+{
+  /* Fragments never wait for a buffer held by another context */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+store_fragment(uint8_t index, uint8_t offset)
+{
+  uint16_t len;
+
+  len = packetbuf_datalen() - packetbuf_hdr_len;
+  if((uint16_t)(offset << 3) + len > REASS_BUF_LEN(index)) {
+    PRINTF("Fragment beyond reassembly buffer: %u+%u\n",
+           (uint16_t)(offset << 3), len);
+    return -1;
+  }
+  memcpy(frag_info[index].first_frag + (uint16_t)(offset << 3),
+         packetbuf_ptr + packetbuf_hdr_len, len);
+
+  PRINTF("Fragsize: %d\n", len);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+#else /* SICSLOWPAN_REASS_BUFFER */
 struct sicslowpan_frag_buf {
   /* the index of the frag_info */
   uint8_t index;
   /* Fragment offset */
   uint8_t offset;
   /* Length of this fragment (if zero this buffer is not allocated) */
-  uint8_t len;
+  uint16_t len;
   uint8_t data[SICSLOWPAN_FRAGMENT_SIZE];
 };
 
@@ -314,6 +528,7 @@ timeout_fragments(int not_context)
        timer_expired(&frag_info[i].reass_timer)) {
       /* This context can be freed */
       count += clear_fragments(i);
+      REASS_STAT(++reass_stats.timed_out);
     }
   }
   return count;
@@ -323,6 +538,12 @@ static int
 store_fragment(uint8_t index, uint8_t offset)
 {
   int i;
+
+  if(packetbuf_datalen() - packetbuf_hdr_len > SICSLOWPAN_FRAGMENT_SIZE) {
+    PRINTF("*** Fragment too large for a fragment buffer\n");
+    return -1;
+  }
+
   for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
     if(frag_buf[i].len == 0) {
       /* copy over the data from packetbuf into the fragment buffer and store offset and len */
@@ -341,6 +562,57 @@ store_fragment(uint8_t index, uint8_t offset)
   return -1;
 }
 /*---------------------------------------------------------------------------*/
+#endif /* SICSLOWPAN_REASS_BUFFER */
+#if SICSLOWPAN_REASS_STATS
+/*---------------------------------------------------------------------------*/
+/* Buffer bytes held by a reassembly context */
+static uint16_t
+context_buf_len(uint8_t index)
+{
+#if SICSLOWPAN_REASS_BUFFER
+  return frag_info[index].len > 0 ? REASS_BUF_LEN(index) : 0;
+#else /* SICSLOWPAN_REASS_BUFFER */
+  uint16_t len;
+  int i;
+
+  if(frag_info[index].len == 0) {
+    return 0;
+  }
+  len = SICSLOWPAN_FIRST_FRAGMENT_SIZE;
+  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
+    if(frag_buf[i].len > 0 && frag_buf[i].index == index) {
+      len += SICSLOWPAN_FRAGMENT_SIZE;
+    }
+  }
+  return len;
+#endif /* SICSLOWPAN_REASS_BUFFER */
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+bytes_in_use(void)
+{
+  uint16_t bytes;
+  int i;
+
+  bytes = 0;
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    bytes += context_buf_len(i);
+  }
+  return bytes;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_peak(void)
+{
+  uint16_t bytes;
+
+  bytes = bytes_in_use();
+  if(bytes > reass_stats.bytes_peak) {
+    reass_stats.bytes_peak = bytes;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* SICSLOWPAN_REASS_STATS */
 /* add a new fragment to the buffer */
 static int8_t
 add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
@@ -355,6 +627,7 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
       /* clear all fragment info with expired timer to free all fragment buffers */
       if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
 	clear_fragments(i);
+        REASS_STAT(++reass_stats.timed_out);
       }
 
       /* We use len as indication on used or not used */
@@ -367,8 +640,28 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
 
     if(found < 0) {
       PRINTF("*** Failed to store new fragment session - tag: %d\n", tag);
+      REASS_STAT(++reass_stats.no_context);
+      return -1;
+    }
+
+#if SICSLOWPAN_REASS_BUFFER
+    if(frag_size > SICSLOWPAN_REASS_BUFFER_SIZE) {
+      PRINTF("*** Datagram too large for reassembly buffer - size: %d\n",
+             frag_size);
+      return -1;
+    }
+#endif /* SICSLOWPAN_REASS_BUFFER */
+
+#if SICSLOWPAN_REASS_BUDGET
+    /* The buffer must also hold the decompressed first fragment before
+       its length has been checked against the datagram size. */
+    if(!reass_alloc(found, MAX(frag_size, SICSLOWPAN_FIRST_FRAGMENT_SIZE))) {
+      PRINTF("*** Reassembly budget exhausted - tag: %d size: %d\n",
+             tag, frag_size);
+      REASS_STAT(++reass_stats.no_memory);
       return -1;
     }
+#endif /* SICSLOWPAN_REASS_BUDGET */
 
     /* Found a free fragment info to store data in */
     frag_info[found].len = frag_size;
@@ -376,6 +669,8 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
     linkaddr_copy(&frag_info[found].sender,
                   packetbuf_addr(PACKETBUF_ADDR_SENDER));
     timer_set(&frag_info[found].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+    REASS_STAT(++reass_stats.started);
+    REASS_STAT(update_peak());
     /* first fragment can not be stored immediately but is moved into
        the buffer while uncompressing */
     return found;
@@ -394,6 +689,7 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
   if(found < 0) {
     /* no entry found for storing the new fragment */
     PRINTF("*** Failed to store N-fragment - could not find session - tag: %d offset: %d\n", tag, offset);
+    REASS_STAT(++reass_stats.orphans);
     return -1;
   }
 
@@ -404,8 +700,10 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
   }
   if(len > 0) {
     frag_info[i].reassembled_len += len;
+    REASS_STAT(update_peak());
     return i;
   } else {
+    REASS_STAT(++reass_stats.no_memory);
     /* should we also clear all fragments since we failed to store
        this fragment? */
     PRINTF("*** Failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[i].tag);
@@ -418,6 +716,11 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
 static void
 copy_frags2uip(int context)
 {
+#if SICSLOWPAN_REASS_BUFFER
+  /* The fragments are already in place */
+  memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)frag_info[context].first_frag,
+         frag_info[context].len);
+#else /* SICSLOWPAN_REASS_BUFFER */
   int i;
 
   /* Copy from the fragment context info buffer first */
@@ -430,9 +733,42 @@ copy_frags2uip(int context)
 	     (uint8_t *)frag_buf[i].data, frag_buf[i].len);
     }
   }
+#endif /* SICSLOWPAN_REASS_BUFFER */
   /* deallocate all the fragments for this context */
   clear_fragments(context);
+  REASS_STAT(++reass_stats.completed);
+}
+#if SICSLOWPAN_REASS_STATS
+/*---------------------------------------------------------------------------*/
+const struct sicslowpan_reass_stats *
+sicslowpan_reass_get_stats(void)
+{
+  reass_stats.bytes_in_use = bytes_in_use();
+  return &reass_stats;
 }
+/*---------------------------------------------------------------------------*/
+int
+sicslowpan_reass_num_contexts(void)
+{
+  return SICSLOWPAN_REASS_CONTEXTS;
+}
+/*---------------------------------------------------------------------------*/
+int
+sicslowpan_reass_get_info(int context, struct sicslowpan_reass_info *info)
+{
+  if(context < 0 || context >= SICSLOWPAN_REASS_CONTEXTS ||
+     frag_info[context].len == 0) {
+    return 0;
+  }
+  linkaddr_copy(&info->sender, &frag_info[context].sender);
+  info->tag = frag_info[context].tag;
+  info->len = frag_info[context].len;
+  info->reassembled_len = frag_info[context].reassembled_len;
+  info->buf_len = context_buf_len(context);
+  info->age = clock_time() - frag_info[context].reass_timer.start;
+  return 1;
+}
+#endif /* SICSLOWPAN_REASS_STATS */
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 /* -------------------------------------------------------------------------- */
@@ -503,6 +839,34 @@ static struct sicslowpan_addr_context *context;
 /** pointer to the byte where to write next inline field. */
 static uint8_t *hc06_ptr;
 
+/** Number of (source, destination, link destination) address triples
+ * whose IPHC address encoding is cached, to skip the context lookups and
+ * IID checks of flows already seen. 0 disables the cache. */
+#ifdef SICSLOWPAN_CONF_IPHC_CACHE_ENTRIES
+#define SICSLOWPAN_IPHC_CACHE_ENTRIES SICSLOWPAN_CONF_IPHC_CACHE_ENTRIES
+#else
+#define SICSLOWPAN_IPHC_CACHE_ENTRIES 0
+#endif /* SICSLOWPAN_CONF_IPHC_CACHE_ENTRIES */
+
+#if SICSLOWPAN_IPHC_CACHE_ENTRIES > 0
+/** A cached IPHC address encoding. Address contexts are set once at
+ * initialization, so entries never need to be invalidated. */
+struct iphc_cache_entry {
+  uip_ipaddr_t srcipaddr;
+  uip_ipaddr_t destipaddr;
+  linkaddr_t link_destaddr;
+  /** CID, SAC, SAM, M, DAC and DAM bits of the second IPHC byte */
+  uint8_t iphc1;
+  /** The [ SCI | DCI ] byte */
+  uint8_t cid;
+  uint8_t used;
+};
+static struct iphc_cache_entry iphc_cache[SICSLOWPAN_IPHC_CACHE_ENTRIES];
+/** The entry to hit first, and the entry to replace next */
+static uint8_t iphc_cache_last;
+static uint8_t iphc_cache_next;
+#endif /* SICSLOWPAN_IPHC_CACHE_ENTRIES > 0 */
+
 /* Uncompression of linklocal */
 /*   0 -> 16 bytes from packet  */
 /*   1 -> 2 bytes from prefix - bunch of zeroes and 8 from packet */
@@ -577,16 +941,207 @@ compress_addr_64(uint8_t bitpos, uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr)
     return 3 << bitpos; /* 0-bits */
   } else if(sicslowpan_is_iid_16_bit_compressable(ipaddr)) {
     /* compress IID to 16 bits xxxx::0000:00ff:fe00:XXXX */
-    memcpy(hc06_ptr, &ipaddr->u16[7], 2);
-    hc06_ptr += 2;
     return 2 << bitpos; /* 16-bits */
   } else {
     /* do not compress IID => xxxx::IID */
-    memcpy(hc06_ptr, &ipaddr->u16[4], 8);
-    hc06_ptr += 8;
     return 1 << bitpos; /* 64-bits */
   }
 }
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Find the IPHC encoding of the addresses of the packet in uip_buf
+ * \param link_destaddr L2 destination address, needed to compress IP dest
+ * \param cid Where to store the [ SCI | DCI ] byte
+ * \return The address bits of the second IPHC byte (CID, SAC, SAM, M,
+ * DAC, DAM)
+ *
+ * Only the encoding is computed here, the inline address bytes are written
+ * by compress_addr_inline().
+ */
+static uint8_t
+compress_addr_encoding(linkaddr_t *link_destaddr, uint8_t *cid)
+{
+  struct sicslowpan_addr_context *src_context;
+  struct sicslowpan_addr_context *dest_context;
+  uint8_t iphc1 = 0;
+
+  *cid = 0;
+  src_context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr);
+  dest_context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr);
+
+  /* check if dest or src context exists (for allocating third byte) */
+  if(dest_context != NULL || src_context != NULL) {
+    PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
+    iphc1 |= SICSLOWPAN_IPHC_CID;
+  }
+
+  /* source address - cannot be multicast */
+  if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
+    PRINTF("IPHC: compressing unspecified - setting SAC\n");
+    iphc1 |= SICSLOWPAN_IPHC_SAC;
+    iphc1 |= SICSLOWPAN_IPHC_SAM_00;
+  } else if(src_context != NULL) {
+    /* elide the prefix - indicate by CID and set context + SAC */
+    PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
+           src_context->number);
+    iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC;
+    *cid |= src_context->number << 4;
+    /* compession compare with this nodes address (source) */
+
+    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
+                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
+    /* No context found for this address */
+  } else if(uip_is_addr_linklocal(&UIP_IP_BUF->srcipaddr) &&
+            UIP_IP_BUF->destipaddr.u16[1] == 0 &&
+            UIP_IP_BUF->destipaddr.u16[2] == 0 &&
+            UIP_IP_BUF->destipaddr.u16[3] == 0) {
+    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
+                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
+  } else {
+    /* send the full address => SAC = 0, SAM = 00 */
+    iphc1 |= SICSLOWPAN_IPHC_SAM_00; /* 128-bits */
+  }
+
+  /* dest address*/
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+    /* Address is multicast, try to compress */
+    iphc1 |= SICSLOWPAN_IPHC_M;
+    if(sicslowpan_is_mcast_addr_compressable8(&UIP_IP_BUF->destipaddr)) {
+      iphc1 |= SICSLOWPAN_IPHC_DAM_11;
+    } else if(sicslowpan_is_mcast_addr_compressable32(&UIP_IP_BUF->destipaddr)) {
+      iphc1 |= SICSLOWPAN_IPHC_DAM_10;
+    } else if(sicslowpan_is_mcast_addr_compressable48(&UIP_IP_BUF->destipaddr)) {
+      iphc1 |= SICSLOWPAN_IPHC_DAM_01;
+    } else {
+      iphc1 |= SICSLOWPAN_IPHC_DAM_00;
+    }
+  } else {
+    /* Address is unicast, try to compress */
+    if(dest_context != NULL) {
+      /* elide the prefix */
+      iphc1 |= SICSLOWPAN_IPHC_DAC;
+      *cid |= dest_context->number;
+      /* compession compare with link adress (destination) */
+
+      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
+                                &UIP_IP_BUF->destipaddr,
+                                (uip_lladdr_t *)link_destaddr);
+      /* No context found for this address */
+    } else if(uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr) &&
+              UIP_IP_BUF->destipaddr.u16[1] == 0 &&
+              UIP_IP_BUF->destipaddr.u16[2] == 0 &&
+              UIP_IP_BUF->destipaddr.u16[3] == 0) {
+      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
+               &UIP_IP_BUF->destipaddr, (uip_lladdr_t *)link_destaddr);
+    } else {
+      /* send the full address */
+      iphc1 |= SICSLOWPAN_IPHC_DAM_00; /* 128-bits */
+    }
+  }
+  return iphc1;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Write the inline address bytes for a given IPHC address encoding
+ * \param iphc1 The second IPHC byte, as from compress_addr_encoding()
+ */
+static void
+compress_addr_inline(uint8_t iphc1)
+{
+  uint8_t mode;
+
+  /* source address */
+  mode = (iphc1 & SICSLOWPAN_IPHC_SAM_11) >> SICSLOWPAN_IPHC_SAM_BIT;
+  if(mode == 0 && (iphc1 & SICSLOWPAN_IPHC_SAC) == 0) {
+    /* full address */
+    memcpy(hc06_ptr, &UIP_IP_BUF->srcipaddr.u16[0], 16);
+    hc06_ptr += 16;
+  } else if(mode == 1) {
+    /* IID => xxxx::IID */
+    memcpy(hc06_ptr, &UIP_IP_BUF->srcipaddr.u16[4], 8);
+    hc06_ptr += 8;
+  } else if(mode == 2) {
+    /* 16-bit IID xxxx::0000:00ff:fe00:XXXX */
+    memcpy(hc06_ptr, &UIP_IP_BUF->srcipaddr.u16[7], 2);
+    hc06_ptr += 2;
+  }
+
+  /* dest address */
+  mode = (iphc1 & SICSLOWPAN_IPHC_DAM_11) >> SICSLOWPAN_IPHC_DAM_BIT;
+  if(iphc1 & SICSLOWPAN_IPHC_M) {
+    if(mode == 3) {
+      /* use last byte */
+      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[15];
+      hc06_ptr += 1;
+    } else if(mode == 2) {
+      /* second byte + the last three */
+      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
+      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[13], 3);
+      hc06_ptr += 4;
+    } else if(mode == 1) {
+      /* second byte + the last five */
+      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
+      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[11], 5);
+      hc06_ptr += 6;
+    } else {
+      /* full address */
+      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u8[0], 16);
+      hc06_ptr += 16;
+    }
+  } else if(mode == 0) {
+    /* full address */
+    memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u16[0], 16);
+    hc06_ptr += 16;
+  } else if(mode == 1) {
+    memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u16[4], 8);
+    hc06_ptr += 8;
+  } else if(mode == 2) {
+    memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u16[7], 2);
+    hc06_ptr += 2;
+  }
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Find the IPHC encoding of the addresses of the packet in uip_buf,
+ * from the cache when possible
+ */
+static uint8_t
+compress_addr_encoding_cached(linkaddr_t *link_destaddr, uint8_t *cid)
+{
+#if SICSLOWPAN_IPHC_CACHE_ENTRIES > 0
+  struct iphc_cache_entry *e;
+  uint8_t i;
+  uint8_t index;
+
+  for(i = 0; i < SICSLOWPAN_IPHC_CACHE_ENTRIES; i++) {
+    /* Start with the last hit, most packets belong to the same flow */
+    index = (iphc_cache_last + i) % SICSLOWPAN_IPHC_CACHE_ENTRIES;
+    e = &iphc_cache[index];
+    if(e->used
+       && uip_ipaddr_cmp(&e->destipaddr, &UIP_IP_BUF->destipaddr)
+       && uip_ipaddr_cmp(&e->srcipaddr, &UIP_IP_BUF->srcipaddr)
+       && linkaddr_cmp(&e->link_destaddr, link_destaddr)) {
+      iphc_cache_last = index;
+      *cid = e->cid;
+      return e->iphc1;
+    }
+  }
+
+  /* Miss: compute the encoding and replace the oldest entry */
+  e = &iphc_cache[iphc_cache_next];
+  e->iphc1 = compress_addr_encoding(link_destaddr, &e->cid);
+  uip_ipaddr_copy(&e->srcipaddr, &UIP_IP_BUF->srcipaddr);
+  uip_ipaddr_copy(&e->destipaddr, &UIP_IP_BUF->destipaddr);
+  linkaddr_copy(&e->link_destaddr, link_destaddr);
+  e->used = 1;
+  iphc_cache_last = iphc_cache_next;
+  iphc_cache_next = (iphc_cache_next + 1) % SICSLOWPAN_IPHC_CACHE_ENTRIES;
+  *cid = e->cid;
+  return e->iphc1;
+#else /* SICSLOWPAN_IPHC_CACHE_ENTRIES > 0 */
+  return compress_addr_encoding(link_destaddr, cid);
+#endif /* SICSLOWPAN_IPHC_CACHE_ENTRIES > 0 */
+}
 
 /*-------------------------------------------------------------------- */
 /* Uncompress addresses based on a prefix and a postfix with zeroes in
@@ -630,6 +1185,424 @@ uncompress_addr(uip_ipaddr_t *ipaddr, uint8_t const prefix[],
   PRINTF("\n");
 }
 
+#if SICSLOWPAN_6LORH
+/*--------------------------------------------------------------------*/
+/** \name RFC 8138 6LoRH compression of RPL headers
+ * @{                                                                 */
+/*--------------------------------------------------------------------*/
+/*
+ * The RPL option (RFC 6553), in a hop-by-hop options header of its own,
+ * and the RPL source routing header (RFC 6554) that directly follow the
+ * IPv6 header are not sent inline after the IPHC header, but as 6LoRH
+ * headers in dispatch page 1 (RFC 8025) before it:
+ * \verbatim
+ * | Page 1 | RH3-6LoRH ... | RPI-6LoRH | IPHC | ...
+ * \endverbatim
+ * The IPHC next header is then the header following the elided ones.
+ * The receiver rebuilds these headers before passing the packet up, so
+ * RPL inserts, checks and updates them as usual.
+ *
+ * RH3-6LoRH headers carry the addresses not visited yet, each compressed
+ * against the previous one, starting from the IPv6 destination address.
+ * As visited addresses are dropped, output() first rewrites the source
+ * routing header in the form the receiver rebuilds (srh_normalize()), so
+ * that the uncompressed length, and thus fragment offsets, agree on both
+ * ends.
+ */
+
+/** Length of a hop-by-hop options header holding only a RPL option */
+#define LORH_HBH_LEN 8
+/** Length of the fixed part of a RPL source routing header */
+#define LORH_SRH_HDR_LEN 8
+/** IPv6 routing header type of the RPL source routing header */
+#define LORH_RH_TYPE_SRH 3
+/** RPL option flags that RPI-6LoRH carries (O, R and F) */
+#define LORH_RPL_FLAGS_MASK 0xe0
+
+/** The RPI-6LoRH of the packet being decompressed, NULL if none */
+static const uint8_t *lorh_rpi;
+/** The first RH3-6LoRH of the packet being decompressed, NULL if none */
+static const uint8_t *lorh_rh3;
+/** The number of addresses in the RH3-6LoRH headers */
+static uint8_t lorh_rh3_count;
+
+/*--------------------------------------------------------------------*/
+static uint8_t
+lorh_matching_bytes(const uip_ipaddr_t *a, const uip_ipaddr_t *b)
+{
+  uint8_t i;
+  for(i = 0; i < 16 && a->u8[i] == b->u8[i]; i++);
+  return i;
+}
+/*--------------------------------------------------------------------*/
+/** \brief The hop-by-hop options header after the IPv6 header in uip_buf
+ * if it holds only a RPL option that RPI-6LoRH can carry, NULL otherwise */
+static uint8_t *
+lorh_hbh(void)
+{
+  uint8_t *hbh = uip_buf + UIP_LLIPH_LEN;
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO && uip_len >= UIP_IPH_LEN + LORH_HBH_LEN
+     && hbh[1] == 0 && hbh[2] == UIP_EXT_HDR_OPT_RPL && hbh[3] == 4
+     && (hbh[4] & ~LORH_RPL_FLAGS_MASK) == 0) {
+    return hbh;
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/** \brief The RPL source routing header in uip_buf right after the IPv6
+ * header, or after the hop-by-hop options header hbh, NULL if none */
+static uint8_t *
+lorh_srh(uint8_t *hbh)
+{
+  uint8_t *srh = hbh != NULL ? hbh + LORH_HBH_LEN : uip_buf + UIP_LLIPH_LEN;
+  uint8_t proto = hbh != NULL ? hbh[0] : UIP_IP_BUF->proto;
+
+  if(proto == UIP_PROTO_ROUTING
+     && srh + LORH_SRH_HDR_LEN <= (uint8_t *)UIP_IP_BUF + uip_len
+     && srh[2] == LORH_RH_TYPE_SRH
+     && srh + ((srh[1] + 1) << 3) <= (uint8_t *)UIP_IP_BUF + uip_len) {
+    return srh;
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Bring the RPL source routing header srh of the packet in uip_buf
+ * to the form 6LoRH decompression rebuilds: only the addresses not visited
+ * yet, all sharing the same ComprI and ComprE with the destination.
+ * \param rewrite Whether to rewrite the header in place if needed
+ * \return 1 if the header is (now) in that form, 0 otherwise
+ */
+static int
+srh_normalize(uint8_t *srh, int rewrite)
+{
+  uint16_t len, new_len;
+  uint8_t cmpri, cmpre, pad, new_pad;
+  uint8_t path_len, segments_left, first, cmpr, i;
+  uip_ipaddr_t addr;
+
+  if(srh == NULL) {
+    return 0;
+  }
+  len = (srh[1] + 1) << 3;
+  segments_left = srh[3];
+  cmpri = srh[4] >> 4;
+  cmpre = srh[4] & 0x0f;
+  pad = srh[5] >> 4;
+  if(len < LORH_SRH_HDR_LEN + pad + (16 - cmpre)
+     || (len - LORH_SRH_HDR_LEN - pad - (16 - cmpre)) % (16 - cmpri) != 0) {
+    return 0;
+  }
+  path_len = (len - LORH_SRH_HDR_LEN - pad - (16 - cmpre)) / (16 - cmpri) + 1;
+  if(segments_left == 0 || segments_left > path_len) {
+    return 0;
+  }
+  first = path_len - segments_left;
+
+  /* Bytes all addresses not visited yet share with the destination */
+  cmpr = 15;
+  for(i = first; i < path_len; i++) {
+    uint8_t c = i == path_len - 1 ? cmpre : cmpri;
+    uip_ipaddr_copy(&addr, &UIP_IP_BUF->destipaddr);
+    memcpy(&addr.u8[c], srh + LORH_SRH_HDR_LEN + i * (16 - cmpri), 16 - c);
+    cmpr = MIN(cmpr, lorh_matching_bytes(&addr, &UIP_IP_BUF->destipaddr));
+  }
+
+  new_len = LORH_SRH_HDR_LEN + segments_left * (16 - cmpr);
+  new_pad = new_len % 8 == 0 ? 0 : 8 - (new_len % 8);
+  new_len += new_pad;
+  if(first == 0 && cmpri == cmpr && cmpre == cmpr && pad == new_pad) {
+    return 1;
+  }
+  if(!rewrite) {
+    return 0;
+  }
+
+  /* Move the addresses to the front. With two addresses or more left,
+     cmpr >= cmpri, so no address is overwritten before it is read. */
+  for(i = first; i < path_len; i++) {
+    uint8_t c = i == path_len - 1 ? cmpre : cmpri;
+    uip_ipaddr_copy(&addr, &UIP_IP_BUF->destipaddr);
+    memcpy(&addr.u8[c], srh + LORH_SRH_HDR_LEN + i * (16 - cmpri), 16 - c);
+    memcpy(srh + LORH_SRH_HDR_LEN + (i - first) * (16 - cmpr), &addr.u8[cmpr], 16 - cmpr);
+  }
+  memset(srh + new_len - new_pad, 0, new_pad);
+  srh[1] = (new_len - 8) / 8;
+  srh[4] = (cmpr << 4) | cmpr;
+  srh[5] = new_pad << 4;
+
+  /* Close the gap left before the next header */
+  if(new_len < len) {
+    uint16_t ip_payload_len;
+    memmove(srh + new_len, srh + len, uip_len - (srh + len - (uint8_t *)UIP_IP_BUF));
+    uip_len -= len - new_len;
+    ip_payload_len = ((UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]) - (len - new_len);
+    UIP_IP_BUF->len[0] = ip_payload_len >> 8;
+    UIP_IP_BUF->len[1] = ip_payload_len & 0xff;
+  }
+  PRINTFO("6LoRH: SRH normalized, %u addresses, Cmpr %u, len %u -> %u\n",
+          segments_left, cmpr, len, new_len);
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Write the RH3-6LoRH headers for the source routing header srh at
+ * ptr, which must be in the normalized form
+ * \return The length of the RH3-6LoRH headers, 0 if they would be longer
+ * than SICSLOWPAN_6LORH_RH3_MAX_LEN
+ */
+static uint8_t
+compress_6lorh_rh3(uint8_t *ptr, const uint8_t *srh)
+{
+  uint8_t cmpr = srh[4] & 0x0f;
+  uint8_t count = srh[3];
+  uint8_t *lorh = NULL;
+  uint8_t len = 0;
+  uip_ipaddr_t ref, addr;
+  uint8_t i;
+
+  uip_ipaddr_copy(&ref, &UIP_IP_BUF->destipaddr);
+  for(i = 0; i < count; i++) {
+    uint8_t type = 0;
+    uip_ipaddr_copy(&addr, &UIP_IP_BUF->destipaddr);
+    memcpy(&addr.u8[cmpr], srh + LORH_SRH_HDR_LEN + i * (16 - cmpr), 16 - cmpr);
+    /* Smallest size that, over the previous address, gives this one */
+    while(lorh_matching_bytes(&addr, &ref) < 16 - (1 << type)) {
+      type++;
+    }
+    /* Start a new RH3-6LoRH when the size changes or the current one is full */
+    if(lorh == NULL || lorh[1] != type || (lorh[0] & 0x1f) == 0x1f) {
+      if(len + 2 > SICSLOWPAN_6LORH_RH3_MAX_LEN) {
+        return 0;
+      }
+      lorh = ptr + len;
+      lorh[0] = SICSLOWPAN_6LORH_CRITICAL;
+      lorh[1] = type;
+      len += 2;
+    } else {
+      lorh[0]++;
+    }
+    if(len + (1 << type) > SICSLOWPAN_6LORH_RH3_MAX_LEN) {
+      return 0;
+    }
+    memcpy(ptr + len, &addr.u8[16 - (1 << type)], 1 << type);
+    len += 1 << type;
+    uip_ipaddr_copy(&ref, &addr);
+  }
+  return len;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Compress the RPL headers of the packet in uip_buf as 6LoRH
+ * headers, written at PACKETBUF_HC1_PTR
+ * \param proto Set to the next header that follows the elided headers
+ * \return The length of the elided uncompressed headers, 0 if none
+ */
+static uint16_t
+compress_6lorh(uint8_t *proto)
+{
+  uint8_t *hbh = lorh_hbh();
+  uint8_t *srh = lorh_srh(hbh);
+  uint8_t *ptr = PACKETBUF_HC1_PTR;
+  uint16_t elided_len = 0;
+  uint8_t rh3_len = 0;
+
+  if(srh != NULL && srh_normalize(srh, 0)) {
+    rh3_len = compress_6lorh_rh3(ptr + 1, srh);
+  }
+  if(rh3_len == 0 && hbh == NULL) {
+    return 0;
+  }
+
+  *ptr++ = SICSLOWPAN_DISPATCH_PAGE_1;
+  if(rh3_len > 0) {
+    ptr += rh3_len;
+    elided_len = (srh[1] + 1) << 3;
+    *proto = srh[0];
+  }
+  if(hbh != NULL) {
+    /* RPI-6LoRH */
+    ptr[0] = SICSLOWPAN_6LORH_CRITICAL | (hbh[4] >> 3);
+    ptr[1] = SICSLOWPAN_6LORH_TYPE_RPI;
+    ptr += 2;
+    if(hbh[5] == 0) {
+      /* Global RPLInstanceID 0 is elided */
+      ptr[-2] |= SICSLOWPAN_6LORH_RPI_I;
+    } else {
+      *ptr++ = hbh[5];
+    }
+    memcpy(ptr, &hbh[6], 2);
+    ptr += 2;
+    elided_len += LORH_HBH_LEN;
+    if(rh3_len == 0) {
+      *proto = hbh[0];
+    }
+  }
+  PRINTFO("6LoRH: elided %u bytes of RPL headers\n", elided_len);
+  packetbuf_hdr_len = ptr - packetbuf_ptr;
+  return elided_len;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Parse the 6LoRH headers that follow a page 1 dispatch at
+ * PACKETBUF_HC1_PTR, and skip them
+ * \return 0 if the packet is to be dropped
+ */
+static int
+uncompress_6lorh_parse(void)
+{
+  const uint8_t *ptr = PACKETBUF_HC1_PTR + 1;
+  const uint8_t *end = packetbuf_ptr + packetbuf_datalen();
+  const uint8_t *rh3_end = NULL;
+
+  while(ptr + 2 <= end && (ptr[0] & SICSLOWPAN_6LORH_MASK) == SICSLOWPAN_6LORH_ID) {
+    if((ptr[0] & 0xe0) == SICSLOWPAN_6LORH_ELECTIVE) {
+      /* Elective 6LoRH we do not know about: skip it */
+      ptr += 2 + (ptr[0] & 0x1f);
+    } else if(ptr[1] <= SICSLOWPAN_6LORH_TYPE_RH3_16) {
+      /* All RH3-6LoRH headers must follow each other */
+      if(lorh_rh3 == NULL) {
+        lorh_rh3 = ptr;
+      } else if(ptr != rh3_end) {
+        return 0;
+      }
+      if(lorh_rh3_count + (ptr[0] & 0x1f) + 1 > 0xff) {
+        return 0;
+      }
+      lorh_rh3_count += (ptr[0] & 0x1f) + 1;
+      ptr += 2 + ((ptr[0] & 0x1f) + 1) * (1 << ptr[1]);
+      rh3_end = ptr;
+    } else if(ptr[1] == SICSLOWPAN_6LORH_TYPE_RPI) {
+      /* Single-byte SenderRank is not supported */
+      if(lorh_rpi != NULL || (ptr[0] & SICSLOWPAN_6LORH_RPI_K)) {
+        return 0;
+      }
+      lorh_rpi = ptr;
+      ptr += (ptr[0] & SICSLOWPAN_6LORH_RPI_I) ? 4 : 5;
+    } else {
+      /* Critical 6LoRH we do not know about */
+      PRINTFI("6LoRH: unsupported critical type %u\n", ptr[1]);
+      return 0;
+    }
+  }
+  if(ptr > end) {
+    return 0;
+  }
+  packetbuf_hdr_len = ptr - packetbuf_ptr;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Decode the addresses of the RH3-6LoRH headers
+ * \param dest The IPv6 destination address, reference for the first one
+ * \param cmpr With addr_ptr != NULL, the number of leading bytes to elide
+ * from each address
+ * \param addr_ptr Where to write the addresses, NULL to only compute the
+ * number of leading bytes they all share with dest
+ * \return The number of leading bytes shared with dest, at most cmpr
+ */
+static uint8_t
+uncompress_6lorh_rh3(const uip_ipaddr_t *dest, uint8_t cmpr, uint8_t *addr_ptr)
+{
+  const uint8_t *ptr = lorh_rh3;
+  uint8_t count = lorh_rh3_count;
+  uip_ipaddr_t addr;
+
+  uip_ipaddr_copy(&addr, dest);
+  while(count > 0) {
+    uint8_t n = (ptr[0] & 0x1f) + 1;
+    uint8_t size = 1 << ptr[1];
+    ptr += 2;
+    count -= n;
+    while(n-- > 0) {
+      memcpy(&addr.u8[16 - size], ptr, size);
+      ptr += size;
+      if(addr_ptr == NULL) {
+        cmpr = MIN(cmpr, lorh_matching_bytes(&addr, dest));
+      } else {
+        memcpy(addr_ptr, &addr.u8[cmpr], 16 - cmpr);
+        addr_ptr += 16 - cmpr;
+      }
+    }
+  }
+  return cmpr;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Rebuild the headers compressed as 6LoRH, after the IPv6 header
+ * (and possibly UDP header) decompressed in buf
+ * \param ip_len Length of the datagram, if fragmented
+ * \return 0 if the packet is to be dropped
+ */
+static int
+uncompress_6lorh(uint8_t *buf, uint16_t ip_len)
+{
+  uint16_t ext_len = 0;
+  uint16_t srh_len = 0;
+  uint8_t cmpr = 15;
+  uint8_t proto;
+  uint8_t *ext = buf + UIP_IPH_LEN;
+
+  if(lorh_rpi == NULL && lorh_rh3 == NULL) {
+    return 1;
+  }
+
+  if(lorh_rpi != NULL) {
+    ext_len += LORH_HBH_LEN;
+  }
+  if(lorh_rh3 != NULL) {
+    cmpr = uncompress_6lorh_rh3(&SICSLOWPAN_IP_BUF(buf)->destipaddr, cmpr, NULL);
+    srh_len = LORH_SRH_HDR_LEN + lorh_rh3_count * (16 - cmpr);
+    srh_len += srh_len % 8 == 0 ? 0 : 8 - (srh_len % 8);
+    ext_len += srh_len;
+  }
+  if(ip_len != 0 ? uncomp_hdr_len + ext_len > ip_len
+     : UIP_LLH_LEN + uncomp_hdr_len + ext_len > UIP_BUFSIZE) {
+    PRINTFI("6LoRH: no room for the uncompressed headers\n");
+    return 0;
+  }
+
+  /* Make room after the IPv6 header */
+  memmove(ext + ext_len, ext, uncomp_hdr_len - UIP_IPH_LEN);
+  proto = SICSLOWPAN_IP_BUF(buf)->proto;
+
+  if(lorh_rh3 != NULL) {
+    uint8_t *srh = ext + (lorh_rpi != NULL ? LORH_HBH_LEN : 0);
+    memset(srh, 0, srh_len);
+    srh[0] = proto;
+    srh[1] = (srh_len - 8) / 8;
+    srh[2] = LORH_RH_TYPE_SRH;
+    srh[3] = lorh_rh3_count;
+    srh[4] = (cmpr << 4) | cmpr;
+    srh[5] = (srh_len - LORH_SRH_HDR_LEN - lorh_rh3_count * (16 - cmpr)) << 4;
+    uncompress_6lorh_rh3(&SICSLOWPAN_IP_BUF(buf)->destipaddr, cmpr,
+                         srh + LORH_SRH_HDR_LEN);
+    proto = UIP_PROTO_ROUTING;
+  }
+
+  if(lorh_rpi != NULL) {
+    const uint8_t *ptr = lorh_rpi + 2;
+    ext[0] = proto;
+    ext[1] = 0;
+    ext[2] = UIP_EXT_HDR_OPT_RPL;
+    ext[3] = 4;
+    ext[4] = (lorh_rpi[0] << 3) & LORH_RPL_FLAGS_MASK;
+    ext[5] = (lorh_rpi[0] & SICSLOWPAN_6LORH_RPI_I) ? 0 : *ptr++;
+    memcpy(&ext[6], ptr, 2);
+    proto = UIP_PROTO_HBHO;
+  }
+
+  /* The IPHC decompression did not count the rebuilt headers */
+  if(ip_len == 0) {
+    uint16_t len = ((SICSLOWPAN_IP_BUF(buf)->len[0] << 8) | SICSLOWPAN_IP_BUF(buf)->len[1]) + ext_len;
+    SICSLOWPAN_IP_BUF(buf)->len[0] = len >> 8;
+    SICSLOWPAN_IP_BUF(buf)->len[1] = len & 0xff;
+  } else if(SICSLOWPAN_IP_BUF(buf)->proto == UIP_PROTO_UDP) {
+    struct uip_udp_hdr *udp = (struct uip_udp_hdr *)(ext + ext_len);
+    udp->udplen = UIP_HTONS(UIP_HTONS(udp->udplen) - ext_len);
+  }
+  SICSLOWPAN_IP_BUF(buf)->proto = proto;
+  uncomp_hdr_len += ext_len;
+  return 1;
+}
+/** @} */
+#endif /* SICSLOWPAN_6LORH */
+
 /*--------------------------------------------------------------------*/
 /**
  * \brief Compress IP/UDP header
@@ -669,6 +1642,10 @@ static void
 compress_hdr_iphc(linkaddr_t *link_destaddr)
 {
   uint8_t tmp, iphc0, iphc1;
+  /* Next header, and UDP header, after the headers elided by 6LoRH */
+  uint8_t proto = UIP_IP_BUF->proto;
+  struct uip_udp_hdr *udp_buf = UIP_UDP_BUF;
+  uint16_t elided_len = 0;
 #if DEBUG
   { uint16_t ndx;
     PRINTF("before compression (%d): ", UIP_IP_BUF->len[1]);
@@ -680,7 +1657,12 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
   }
 #endif
 
-  hc06_ptr = packetbuf_ptr + 2;
+#if SICSLOWPAN_6LORH
+  elided_len = compress_6lorh(&proto);
+  udp_buf = (struct uip_udp_hdr *)((uint8_t *)UIP_UDP_BUF + elided_len);
+#endif /* SICSLOWPAN_6LORH */
+
+  hc06_ptr = PACKETBUF_IPHC_BUF + 2;
   /*
    * As we copy some bit-length fields, in the IPHC encoding bytes,
    * we sometimes use |=
@@ -689,24 +1671,15 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
    */
 
   iphc0 = SICSLOWPAN_DISPATCH_IPHC;
-  iphc1 = 0;
-  PACKETBUF_IPHC_BUF[2] = 0; /* might not be used - but needs to be cleared */
 
   /*
    * Address handling needs to be made first since it might
    * cause an extra byte with [ SCI | DCI ]
    *
    */
-
-
-  /* check if dest context exists (for allocating third byte) */
-  /* TODO: fix this so that it remembers the looked up values for
-     avoiding two lookups - or set the lookup values immediately */
-  if(addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr) != NULL ||
-     addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr) != NULL) {
-    /* set context flag and increase hc06_ptr */
-    PRINTF("IPHC: compressing dest or src ipaddr - setting CID\n");
-    iphc1 |= SICSLOWPAN_IPHC_CID;
+  iphc1 = compress_addr_encoding_cached(link_destaddr, &PACKETBUF_IPHC_BUF[2]);
+  if(iphc1 & SICSLOWPAN_IPHC_CID) {
+    /* context byte is used, increase hc06_ptr */
     hc06_ptr++;
   }
 
@@ -725,202 +1698,122 @@ compress_hdr_iphc(linkaddr_t *link_destaddr)
   if(((UIP_IP_BUF->tcflow & 0x0F) == 0) &&
      (UIP_IP_BUF->flow == 0)) {
     /* flow label can be compressed */
-    iphc0 |= SICSLOWPAN_IPHC_FL_C;
-    if(((UIP_IP_BUF->vtc & 0x0F) == 0) &&
-       ((UIP_IP_BUF->tcflow & 0xF0) == 0)) {
-      /* compress (elide) all */
-      iphc0 |= SICSLOWPAN_IPHC_TC_C;
-    } else {
-      /* compress only the flow label */
-     *hc06_ptr = tmp;
-      hc06_ptr += 1;
-    }
-  } else {
-    /* Flow label cannot be compressed */
-    if(((UIP_IP_BUF->vtc & 0x0F) == 0) &&
-       ((UIP_IP_BUF->tcflow & 0xF0) == 0)) {
-      /* compress only traffic class */
-      iphc0 |= SICSLOWPAN_IPHC_TC_C;
-      *hc06_ptr = (tmp & 0xc0) |
-        (UIP_IP_BUF->tcflow & 0x0F);
-      memcpy(hc06_ptr + 1, &UIP_IP_BUF->flow, 2);
-      hc06_ptr += 3;
-    } else {
-      /* compress nothing */
-      memcpy(hc06_ptr, &UIP_IP_BUF->vtc, 4);
-      /* but replace the top byte with the new ECN | DSCP format*/
-      *hc06_ptr = tmp;
-      hc06_ptr += 4;
-   }
-  }
-
-  /* Note that the payload length is always compressed */
-
-  /* Next header. We compress it if UDP */
-#if UIP_CONF_UDP || UIP_CONF_ROUTER
-  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
-    iphc0 |= SICSLOWPAN_IPHC_NH_C;
-  }
-#endif /*UIP_CONF_UDP*/
-
-  if ((iphc0 & SICSLOWPAN_IPHC_NH_C) == 0) {
-    *hc06_ptr = UIP_IP_BUF->proto;
-    hc06_ptr += 1;
-  }
-
-  /*
-   * Hop limit
-   * if 1: compress, encoding is 01
-   * if 64: compress, encoding is 10
-   * if 255: compress, encoding is 11
-   * else do not compress
-   */
-  switch(UIP_IP_BUF->ttl) {
-    case 1:
-      iphc0 |= SICSLOWPAN_IPHC_TTL_1;
-      break;
-    case 64:
-      iphc0 |= SICSLOWPAN_IPHC_TTL_64;
-      break;
-    case 255:
-      iphc0 |= SICSLOWPAN_IPHC_TTL_255;
-      break;
-    default:
-      *hc06_ptr = UIP_IP_BUF->ttl;
-      hc06_ptr += 1;
-      break;
-  }
-
-  /* source address - cannot be multicast */
-  if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
-    PRINTF("IPHC: compressing unspecified - setting SAC\n");
-    iphc1 |= SICSLOWPAN_IPHC_SAC;
-    iphc1 |= SICSLOWPAN_IPHC_SAM_00;
-  } else if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr))
-     != NULL) {
-    /* elide the prefix - indicate by CID and set context + SAC */
-    PRINTF("IPHC: compressing src with context - setting CID & SAC ctx: %d\n",
-           context->number);
-    iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC;
-    PACKETBUF_IPHC_BUF[2] |= context->number << 4;
-    /* compession compare with this nodes address (source) */
-
-    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
-    /* No context found for this address */
-  } else if(uip_is_addr_linklocal(&UIP_IP_BUF->srcipaddr) &&
-            UIP_IP_BUF->destipaddr.u16[1] == 0 &&
-            UIP_IP_BUF->destipaddr.u16[2] == 0 &&
-            UIP_IP_BUF->destipaddr.u16[3] == 0) {
-    iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
-                              &UIP_IP_BUF->srcipaddr, &uip_lladdr);
-  } else {
-    /* send the full address => SAC = 0, SAM = 00 */
-    iphc1 |= SICSLOWPAN_IPHC_SAM_00; /* 128-bits */
-    memcpy(hc06_ptr, &UIP_IP_BUF->srcipaddr.u16[0], 16);
-    hc06_ptr += 16;
-  }
-
-  /* dest address*/
-  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
-    /* Address is multicast, try to compress */
-    iphc1 |= SICSLOWPAN_IPHC_M;
-    if(sicslowpan_is_mcast_addr_compressable8(&UIP_IP_BUF->destipaddr)) {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_11;
-      /* use last byte */
-      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[15];
-      hc06_ptr += 1;
-    } else if(sicslowpan_is_mcast_addr_compressable32(&UIP_IP_BUF->destipaddr)) {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_10;
-      /* second byte + the last three */
-      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
-      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[13], 3);
-      hc06_ptr += 4;
-    } else if(sicslowpan_is_mcast_addr_compressable48(&UIP_IP_BUF->destipaddr)) {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_01;
-      /* second byte + the last five */
-      *hc06_ptr = UIP_IP_BUF->destipaddr.u8[1];
-      memcpy(hc06_ptr + 1, &UIP_IP_BUF->destipaddr.u8[11], 5);
-      hc06_ptr += 6;
-    } else {
-      iphc1 |= SICSLOWPAN_IPHC_DAM_00;
-      /* full address */
-      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u8[0], 16);
-      hc06_ptr += 16;
-    }
-  } else {
-    /* Address is unicast, try to compress */
-    if((context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr)) != NULL) {
-      /* elide the prefix */
-      iphc1 |= SICSLOWPAN_IPHC_DAC;
-      PACKETBUF_IPHC_BUF[2] |= context->number;
-      /* compession compare with link adress (destination) */
-
-      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-                                &UIP_IP_BUF->destipaddr,
-                                (uip_lladdr_t *)link_destaddr);
-      /* No context found for this address */
-    } else if(uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr) &&
-              UIP_IP_BUF->destipaddr.u16[1] == 0 &&
-              UIP_IP_BUF->destipaddr.u16[2] == 0 &&
-              UIP_IP_BUF->destipaddr.u16[3] == 0) {
-      iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
-               &UIP_IP_BUF->destipaddr, (uip_lladdr_t *)link_destaddr);
+    iphc0 |= SICSLOWPAN_IPHC_FL_C;
+    if(((UIP_IP_BUF->vtc & 0x0F) == 0) &&
+       ((UIP_IP_BUF->tcflow & 0xF0) == 0)) {
+      /* compress (elide) all */
+      iphc0 |= SICSLOWPAN_IPHC_TC_C;
     } else {
-      /* send the full address */
-      iphc1 |= SICSLOWPAN_IPHC_DAM_00; /* 128-bits */
-      memcpy(hc06_ptr, &UIP_IP_BUF->destipaddr.u16[0], 16);
-      hc06_ptr += 16;
+      /* compress only the flow label */
+     *hc06_ptr = tmp;
+      hc06_ptr += 1;
     }
+  } else {
+    /* Flow label cannot be compressed */
+    if(((UIP_IP_BUF->vtc & 0x0F) == 0) &&
+       ((UIP_IP_BUF->tcflow & 0xF0) == 0)) {
+      /* compress only traffic class */
+      iphc0 |= SICSLOWPAN_IPHC_TC_C;
+      *hc06_ptr = (tmp & 0xc0) |
+        (UIP_IP_BUF->tcflow & 0x0F);
+      memcpy(hc06_ptr + 1, &UIP_IP_BUF->flow, 2);
+      hc06_ptr += 3;
+    } else {
+      /* compress nothing */
+      memcpy(hc06_ptr, &UIP_IP_BUF->vtc, 4);
+      /* but replace the top byte with the new ECN | DSCP format*/
+      *hc06_ptr = tmp;
+      hc06_ptr += 4;
+   }
+  }
+
+  /* Note that the payload length is always compressed */
+
+  /* Next header. We compress it if UDP */
+#if UIP_CONF_UDP || UIP_CONF_ROUTER
+  if(proto == UIP_PROTO_UDP) {
+    iphc0 |= SICSLOWPAN_IPHC_NH_C;
+  }
+#endif /*UIP_CONF_UDP*/
+
+  if ((iphc0 & SICSLOWPAN_IPHC_NH_C) == 0) {
+    *hc06_ptr = proto;
+    hc06_ptr += 1;
+  }
+
+  /*
+   * Hop limit
+   * if 1: compress, encoding is 01
+   * if 64: compress, encoding is 10
+   * if 255: compress, encoding is 11
+   * else do not compress
+   */
+  switch(UIP_IP_BUF->ttl) {
+    case 1:
+      iphc0 |= SICSLOWPAN_IPHC_TTL_1;
+      break;
+    case 64:
+      iphc0 |= SICSLOWPAN_IPHC_TTL_64;
+      break;
+    case 255:
+      iphc0 |= SICSLOWPAN_IPHC_TTL_255;
+      break;
+    default:
+      *hc06_ptr = UIP_IP_BUF->ttl;
+      hc06_ptr += 1;
+      break;
   }
 
-  uncomp_hdr_len = UIP_IPH_LEN;
+  /* Inline address bytes */
+  compress_addr_inline(iphc1);
+
+  uncomp_hdr_len = UIP_IPH_LEN + elided_len;
 
 #if UIP_CONF_UDP || UIP_CONF_ROUTER
   /* UDP header compression */
-  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+  if(proto == UIP_PROTO_UDP) {
     PRINTF("IPHC: Uncompressed UDP ports on send side: %x, %x\n",
-           UIP_HTONS(UIP_UDP_BUF->srcport), UIP_HTONS(UIP_UDP_BUF->destport));
+           UIP_HTONS(udp_buf->srcport), UIP_HTONS(udp_buf->destport));
     /* Mask out the last 4 bits can be used as a mask */
-    if(((UIP_HTONS(UIP_UDP_BUF->srcport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) &&
-       ((UIP_HTONS(UIP_UDP_BUF->destport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN)) {
+    if(((UIP_HTONS(udp_buf->srcport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) &&
+       ((UIP_HTONS(udp_buf->destport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN)) {
       /* we can compress 12 bits of both source and dest */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_11;
       PRINTF("IPHC: remove 12 b of both source & dest with prefix 0xFOB\n");
       *(hc06_ptr + 1) =
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->srcport) -
+        (uint8_t)((UIP_HTONS(udp_buf->srcport) -
                    SICSLOWPAN_UDP_4_BIT_PORT_MIN) << 4) +
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->destport) -
+        (uint8_t)((UIP_HTONS(udp_buf->destport) -
                    SICSLOWPAN_UDP_4_BIT_PORT_MIN));
       hc06_ptr += 2;
-    } else if((UIP_HTONS(UIP_UDP_BUF->destport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
+    } else if((UIP_HTONS(udp_buf->destport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
       /* we can compress 8 bits of dest, leave source. */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_01;
       PRINTF("IPHC: leave source, remove 8 bits of dest with prefix 0xF0\n");
-      memcpy(hc06_ptr + 1, &UIP_UDP_BUF->srcport, 2);
+      memcpy(hc06_ptr + 1, &udp_buf->srcport, 2);
       *(hc06_ptr + 3) =
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->destport) -
+        (uint8_t)((UIP_HTONS(udp_buf->destport) -
                    SICSLOWPAN_UDP_8_BIT_PORT_MIN));
       hc06_ptr += 4;
-    } else if((UIP_HTONS(UIP_UDP_BUF->srcport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
+    } else if((UIP_HTONS(udp_buf->srcport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
       /* we can compress 8 bits of src, leave dest. Copy compressed port */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_10;
       PRINTF("IPHC: remove 8 bits of source with prefix 0xF0, leave dest. hch: %i\n", *hc06_ptr);
       *(hc06_ptr + 1) =
-        (uint8_t)((UIP_HTONS(UIP_UDP_BUF->srcport) -
+        (uint8_t)((UIP_HTONS(udp_buf->srcport) -
                    SICSLOWPAN_UDP_8_BIT_PORT_MIN));
-      memcpy(hc06_ptr + 2, &UIP_UDP_BUF->destport, 2);
+      memcpy(hc06_ptr + 2, &udp_buf->destport, 2);
       hc06_ptr += 4;
     } else {
       /* we cannot compress. Copy uncompressed ports, full checksum  */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_00;
       PRINTF("IPHC: cannot compress headers\n");
-      memcpy(hc06_ptr + 1, &UIP_UDP_BUF->srcport, 4);
+      memcpy(hc06_ptr + 1, &udp_buf->srcport, 4);
       hc06_ptr += 5;
     }
     /* always inline the checksum  */
     if(1) {
-      memcpy(hc06_ptr, &UIP_UDP_BUF->udpchksum, 2);
+      memcpy(hc06_ptr, &udp_buf->udpchksum, 2);
       hc06_ptr += 2;
     }
     uncomp_hdr_len += UIP_UDPH_LEN;
@@ -1262,6 +2155,109 @@ send_packet(linkaddr_t *dest)
   watchdog_periodic();
 }
 /*--------------------------------------------------------------------*/
+/**
+ * \brief Compress the IP header in uip_buf into packetbuf
+ * \param dest the link layer destination address of the packet
+ */
+static void
+compress_hdr(linkaddr_t *dest)
+{
+  if(uip_len >= COMPRESSION_THRESHOLD) {
+    /* Try to compress the headers */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
+    compress_hdr_ipv6(dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+    compress_hdr_iphc(dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+  } else {
+    compress_hdr_ipv6(dest);
+  }
+}
+/*--------------------------------------------------------------------*/
+#if SICSLOWPAN_NBR_MTU
+/* The largest frame payload each neighbor is known to handle */
+NBR_TABLE(uint16_t, nbr_max_payload);
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_set_nbr_max_payload(const linkaddr_t *addr, uint16_t max_payload)
+{
+  uint16_t *mp;
+
+  mp = nbr_table_get_from_lladdr(nbr_max_payload, addr);
+  if(mp == NULL) {
+    mp = nbr_table_add_lladdr(nbr_max_payload, addr,
+                              NBR_TABLE_REASON_SICSLOWPAN, NULL);
+    if(mp == NULL) {
+      return;
+    }
+  }
+  *mp = MIN(max_payload, MAC_MAX_PAYLOAD);
+}
+/*--------------------------------------------------------------------*/
+uint16_t
+sicslowpan_get_nbr_max_payload(const linkaddr_t *addr)
+{
+  uint16_t *mp;
+
+  if(addr != NULL && !linkaddr_cmp(addr, &linkaddr_null)) {
+    mp = nbr_table_get_from_lladdr(nbr_max_payload, addr);
+    if(mp != NULL) {
+      return *mp;
+    }
+  }
+  return MIN(SICSLOWPAN_NBR_DEFAULT_MAX_PAYLOAD, MAC_MAX_PAYLOAD);
+}
+/*--------------------------------------------------------------------*/
+/* Learn that the sender of the frame in packetbuf handles long frames */
+static void
+nbr_max_payload_input(void)
+{
+  const linkaddr_t *sender;
+
+  if(packetbuf_datalen() + MAC_MIN_HDRLEN <= MAC_LEGACY_MAX_PAYLOAD) {
+    return;
+  }
+  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  if(sicslowpan_get_nbr_max_payload(sender) < MAC_MAX_PAYLOAD) {
+    PRINTF("sicslowpan: long frames to ");
+    PRINTLLADDR((const uip_lladdr_t *)sender);
+    PRINTF("\n");
+    sicslowpan_set_nbr_max_payload(sender, MAC_MAX_PAYLOAD);
+  }
+}
+#endif /* SICSLOWPAN_NBR_MTU */
+/*--------------------------------------------------------------------*/
+/**
+ * \brief The room left for 6lowpan headers and payload in a frame
+ * \param dest the link layer destination address of the frame
+ */
+static int
+frame_max_payload(linkaddr_t *dest)
+{
+  int framer_hdrlen;
+
+  /* Calculate NETSTACK_FRAMER's header length, that will be added in the NETSTACK_RDC.
+   * We calculate it here only to make a better decision of whether the outgoing packet
+   * needs to be fragmented or not. */
+#ifndef SICSLOWPAN_USE_FIXED_HDRLEN
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, dest);
+  framer_hdrlen = NETSTACK_FRAMER.length();
+  if(framer_hdrlen < 0) {
+    /* Framing failed, we assume the maximum header length */
+    framer_hdrlen = SICSLOWPAN_FIXED_HDRLEN;
+  }
+#else /* USE_FRAMER_HDRLEN */
+  framer_hdrlen = SICSLOWPAN_FIXED_HDRLEN;
+#endif /* USE_FRAMER_HDRLEN */
+
+#if SICSLOWPAN_NBR_MTU
+  return sicslowpan_get_nbr_max_payload(dest) - framer_hdrlen;
+#else /* SICSLOWPAN_NBR_MTU */
+  return MAC_MAX_PAYLOAD - framer_hdrlen;
+#endif /* SICSLOWPAN_NBR_MTU */
+}
+/*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
  *  network using 6lowpan.
  *  \param localdest The MAC address of the destination
@@ -1274,7 +2270,6 @@ send_packet(linkaddr_t *dest)
 static uint8_t
 output(const uip_lladdr_t *localdest)
 {
-  int framer_hdrlen;
   int max_payload;
 
   /* The MAC address of the destination of the packet */
@@ -1311,6 +2306,21 @@ output(const uip_lladdr_t *localdest)
   }
 #endif
 
+#if ENERGEST_CONF_CLASSES
+  if(UIP_IP_BUF->proto != UIP_PROTO_ICMP6) {
+    packetbuf_set_attr(PACKETBUF_ATTR_ENERGEST_CLASS, ENERGEST_CLASS_DATA);
+  } else if(UIP_ICMP_BUF->type == ICMP6_RPL) {
+    packetbuf_set_attr(PACKETBUF_ATTR_ENERGEST_CLASS, ENERGEST_CLASS_ROUTING);
+  } else {
+    packetbuf_set_attr(PACKETBUF_ATTR_ENERGEST_CLASS, ENERGEST_CLASS_ICMP);
+  }
+#endif /* ENERGEST_CONF_CLASSES */
+
+#if PKTTRACE_ENABLED
+  packetbuf_set_attr(PACKETBUF_ATTR_PKTTRACE_ID, pkttrace_current_id);
+#endif /* PKTTRACE_ENABLED */
+  PKTTRACE(SICSLOWPAN, OUT, pkttrace_current_id, uip_len);
+
   /*
    * The destination address will be tagged to each outbound
    * packet. If the argument localdest is NULL, we are sending a
@@ -1324,34 +2334,16 @@ output(const uip_lladdr_t *localdest)
 
   PRINTFO("sicslowpan output: sending packet len %d\n", uip_len);
 
-  if(uip_len >= COMPRESSION_THRESHOLD) {
-    /* Try to compress the headers */
-#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
-    compress_hdr_ipv6(&dest);
-#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
-#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
-    compress_hdr_iphc(&dest);
-#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
-  } else {
-    compress_hdr_ipv6(&dest);
-  }
-  PRINTFO("sicslowpan output: header of len %d\n", packetbuf_hdr_len);
+#if SICSLOWPAN_6LORH
+  /* Drop visited addresses from the source routing header before
+     compression, which would drop them anyway */
+  srh_normalize(lorh_srh(lorh_hbh()), 1);
+#endif /* SICSLOWPAN_6LORH */
 
-  /* Calculate NETSTACK_FRAMER's header length, that will be added in the NETSTACK_RDC.
-   * We calculate it here only to make a better decision of whether the outgoing packet
-   * needs to be fragmented or not. */
-#ifndef SICSLOWPAN_USE_FIXED_HDRLEN
-  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
-  framer_hdrlen = NETSTACK_FRAMER.length();
-  if(framer_hdrlen < 0) {
-    /* Framing failed, we assume the maximum header length */
-    framer_hdrlen = SICSLOWPAN_FIXED_HDRLEN;
-  }
-#else /* USE_FRAMER_HDRLEN */
-  framer_hdrlen = SICSLOWPAN_FIXED_HDRLEN;
-#endif /* USE_FRAMER_HDRLEN */
+  compress_hdr(&dest);
+  PRINTFO("sicslowpan output: header of len %d\n", packetbuf_hdr_len);
 
-  max_payload = MAC_MAX_PAYLOAD - framer_hdrlen;
+  max_payload = frame_max_payload(&dest);
   if((int)uip_len - (int)uncomp_hdr_len > max_payload - (int)packetbuf_hdr_len) {
 #if SICSLOWPAN_CONF_FRAG
     /* Number of bytes processed. */
@@ -1410,9 +2402,10 @@ output(const uip_lladdr_t *localdest)
       return 0;
     }
     send_packet(&dest);
-    queuebuf_to_packetbuf(q);
-    queuebuf_free(q);
+    queuebuf_move_to_packetbuf(q);
     q = NULL;
+    /* The packetbuf memory may have been exchanged by the queuebuf module */
+    packetbuf_ptr = packetbuf_dataptr();
 
     /* Check tx result. */
     if((last_tx_status == MAC_TX_COLLISION) ||
@@ -1456,9 +2449,9 @@ output(const uip_lladdr_t *localdest)
         return 0;
       }
       send_packet(&dest);
-      queuebuf_to_packetbuf(q);
-      queuebuf_free(q);
+      queuebuf_move_to_packetbuf(q);
       q = NULL;
+      packetbuf_ptr = packetbuf_dataptr();
       processed_ip_out_len += packetbuf_payload_len;
 
       /* Check tx result. */
@@ -1487,6 +2480,246 @@ output(const uip_lladdr_t *localdest)
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/** \name Fragment forwarding
+ * @{                                                                 */
+/*--------------------------------------------------------------------*/
+/* A virtual reassembly buffer: what is left of a datagram that is
+   forwarded fragment by fragment */
+struct sicslowpan_vrb {
+  /** The previous hop of the fragments */
+  linkaddr_t sender;
+  /** The next hop of the fragments */
+  linkaddr_t next_hop;
+  /** The tag of the fragments from the previous hop */
+  uint16_t tag;
+  /** The tag of the fragments sent to the next hop */
+  uint16_t out_tag;
+  /** Total length of the datagram, 0 if the entry is free */
+  uint16_t len;
+  /** Bytes of the datagram forwarded so far */
+  uint16_t forwarded_len;
+  /** Expires if the remaining fragments stop arriving */
+  struct timer timer;
+};
+
+static struct sicslowpan_vrb vrb_table[SICSLOWPAN_VRB_ENTRIES];
+/*--------------------------------------------------------------------*/
+static struct sicslowpan_vrb *
+vrb_lookup(const linkaddr_t *sender, uint16_t tag, uint16_t len)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb_table[i].len > 0 && timer_expired(&vrb_table[i].timer)) {
+      vrb_table[i].len = 0;
+    }
+    if(vrb_table[i].len > 0 && vrb_table[i].len == len &&
+       vrb_table[i].tag == tag && linkaddr_cmp(&vrb_table[i].sender, sender)) {
+      return &vrb_table[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+static struct sicslowpan_vrb *
+vrb_alloc(void)
+{
+  int i;
+
+  for(i = 0; i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb_table[i].len == 0 || timer_expired(&vrb_table[i].timer)) {
+      return &vrb_table[i];
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/* The link-layer address of the next hop of the datagram in uip_buf,
+   chosen as in tcpip_ipv6_output(). NULL if there is none yet, or if
+   the neighbor must first be resolved; uIP then takes care of the
+   datagram once it is reassembled. */
+static const uip_lladdr_t *
+vrb_next_hop(void)
+{
+  uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+  uip_ds6_nbr_t *nbr;
+
+  if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)) {
+    nexthop = &UIP_IP_BUF->destipaddr;
+  } else if((route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr)) != NULL) {
+    nexthop = uip_ds6_route_nexthop(route);
+  } else {
+    nexthop = uip_ds6_defrt_choose();
+  }
+  if(nexthop == NULL) {
+    return NULL;
+  }
+
+  nbr = uip_ds6_nbr_lookup(nexthop);
+  if(nbr == NULL || nbr->state == NBR_INCOMPLETE) {
+    return NULL;
+  }
+  return uip_ds6_nbr_get_ll(nbr);
+}
+/*--------------------------------------------------------------------*/
+/* Forward the first fragment of a datagram for another node, which has
+   just been decompressed into the reassembly context. The fragments
+   that follow carry offsets into the uncompressed datagram, so the
+   first fragment is sent with exactly the bytes it arrived with, only
+   compressed again for the next link. Returns 0 if the datagram is to
+   be reassembled as usual, 1 if the fragment was forwarded or dropped
+   and the context freed. */
+static int
+vrb_forward_first(uint8_t context)
+{
+  struct sicslowpan_vrb *vrb;
+  const uip_lladdr_t *lladdr;
+  linkaddr_t dest;
+  uint16_t first_len;
+  uint16_t payload_len;
+
+  first_len = frag_info[context].first_frag_len;
+  memcpy((uint8_t *)UIP_IP_BUF, frag_info[context].first_frag, first_len);
+
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->srcipaddr) ||
+     UIP_IP_BUF->ttl <= 1) {
+    return 0;
+  }
+
+  /* Extension headers that change on the way are left to uIP, apart
+     from the RPL hop-by-hop option which is updated in place */
+  if(UIP_IP_BUF->proto == UIP_PROTO_ROUTING) {
+    return 0;
+  }
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO) {
+#if UIP_CONF_IPV6_RPL
+    if(first_len < UIP_IPH_LEN + RPL_HOP_BY_HOP_LEN ||
+       ((uint8_t *)UIP_IP_BUF)[UIP_IPH_LEN + 2] != UIP_EXT_HDR_OPT_RPL ||
+       default_instance == NULL || default_instance->current_dag == NULL ||
+       default_instance->current_dag->rank == ROOT_RANK(default_instance)) {
+      return 0;
+    }
+#else /* UIP_CONF_IPV6_RPL */
+    return 0;
+#endif /* UIP_CONF_IPV6_RPL */
+  }
+
+  vrb = vrb_lookup(&frag_info[context].sender, frag_info[context].tag,
+                   frag_info[context].len);
+  if(vrb == NULL) {
+    vrb = vrb_alloc();
+    if(vrb == NULL) {
+      PRINTF("sicslowpan: no free VRB, reassembling datagram\n");
+      return 0;
+    }
+    vrb->out_tag = my_tag++;
+  }
+
+  lladdr = vrb_next_hop();
+  if(lladdr == NULL) {
+    return 0;
+  }
+  linkaddr_copy(&dest, (const linkaddr_t *)lladdr);
+
+#if UIP_CONF_IPV6_RPL
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO) {
+    uip_ext_len = 0;
+    if(!rpl_verify_hbh_header(2) || !rpl_update_header()) {
+      PRINTF("sicslowpan: RPL option rejected, dropping datagram\n");
+      clear_fragments(context);
+      return 1;
+    }
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+  UIP_IP_BUF->ttl--;
+
+  /* Build the first fragment as output() would */
+  uip_len = frag_info[context].len;
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  compress_hdr(&dest);
+
+  payload_len = first_len - uncomp_hdr_len;
+  if(packetbuf_hdr_len + SICSLOWPAN_FRAG1_HDR_LEN + payload_len >
+     frame_max_payload(&dest)) {
+    PRINTF("sicslowpan: first fragment does not fit the next link\n");
+    uip_clear_buf();
+    return 0;
+  }
+
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | frag_info[context].len));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, vrb->out_tag);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  memcpy(packetbuf_ptr + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, payload_len);
+  packetbuf_set_datalen(packetbuf_hdr_len + payload_len);
+
+  linkaddr_copy(&vrb->sender, &frag_info[context].sender);
+  linkaddr_copy(&vrb->next_hop, &dest);
+  vrb->tag = frag_info[context].tag;
+  vrb->len = frag_info[context].len;
+  vrb->forwarded_len = first_len;
+  if(vrb->forwarded_len >= vrb->len) {
+    vrb->len = 0;
+  }
+  timer_set(&vrb->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+
+  PRINTF("sicslowpan: forwarding datagram tag %u as tag %u\n",
+         vrb->tag, vrb->out_tag);
+  send_packet(&dest);
+
+  clear_fragments(context);
+  REASS_STAT(++reass_stats.forwarded);
+  UIP_STAT(++uip_stat.ip.forwarded);
+  uip_clear_buf();
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/* Forward a subsequent fragment, in packetbuf, if its datagram is
+   being forwarded. Returns 1 if it was. */
+static int
+vrb_forward_next(uint16_t tag, uint16_t len)
+{
+  struct sicslowpan_vrb *vrb;
+  uint8_t *frame;
+  uint16_t frame_len;
+
+  vrb = vrb_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER), tag, len);
+  if(vrb == NULL) {
+    return 0;
+  }
+
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, vrb->out_tag);
+  vrb->forwarded_len += packetbuf_datalen() - packetbuf_hdr_len;
+  if(vrb->forwarded_len >= vrb->len) {
+    /* Last fragment */
+    vrb->len = 0;
+  } else {
+    timer_restart(&vrb->timer);
+  }
+
+  /* Send the frame as is, without the attributes of its reception */
+  frame = packetbuf_dataptr();
+  frame_len = packetbuf_datalen();
+  packetbuf_clear();
+  memmove(packetbuf_dataptr(), frame, frame_len);
+  packetbuf_set_datalen(frame_len);
+  send_packet(&vrb->next_hop);
+  return 1;
+}
+/** @} */
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING */
+
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *
@@ -1520,6 +2753,15 @@ input(void)
   /* Update link statistics */
   link_stats_input_callback(packetbuf_addr(PACKETBUF_ADDR_SENDER));
 
+#if SICSLOWPAN_NBR_MTU
+  nbr_max_payload_input();
+#endif /* SICSLOWPAN_NBR_MTU */
+
+#if PKTTRACE_ENABLED
+  pkttrace_current_id = packetbuf_attr(PACKETBUF_ATTR_PKTTRACE_ID);
+#endif /* PKTTRACE_ENABLED */
+  PKTTRACE(SICSLOWPAN, IN, pkttrace_current_id, packetbuf_datalen());
+
   /* init */
   uncomp_hdr_len = 0;
   packetbuf_hdr_len = 0;
@@ -1578,6 +2820,12 @@ input(void)
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
 
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(vrb_forward_next(frag_tag, frag_size)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       /* If this is the last fragment, we may shave off any extrenous
          bytes at the end. We must be liberal in what we accept. */
       PRINTFI("last_fragment?: packetbuf_payload_len %d frag_size %d\n",
@@ -1611,10 +2859,28 @@ input(void)
 #endif /* SICSLOWPAN_CONF_FRAG */
 
   /* Process next dispatch and headers */
+#if SICSLOWPAN_6LORH
+  lorh_rpi = NULL;
+  lorh_rh3 = NULL;
+  lorh_rh3_count = 0;
+  if(PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH] == SICSLOWPAN_DISPATCH_PAGE_1) {
+    PRINTFI("sicslowpan input: 6LoRH\n");
+    if(!uncompress_6lorh_parse() ||
+       (PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH] & 0xe0) != SICSLOWPAN_DISPATCH_IPHC) {
+      PRINTFI("sicslowpan input: unsupported 6LoRH, dropping packet\n");
+      return;
+    }
+  }
+#endif /* SICSLOWPAN_6LORH */
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
   if((PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH] & 0xe0) == SICSLOWPAN_DISPATCH_IPHC) {
     PRINTFI("sicslowpan input: IPHC\n");
     uncompress_hdr_iphc(buffer, frag_size);
+#if SICSLOWPAN_6LORH
+    if(!uncompress_6lorh(buffer, frag_size)) {
+      return;
+    }
+#endif /* SICSLOWPAN_6LORH */
   } else
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
     switch(PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH]) {
@@ -1666,6 +2932,15 @@ input(void)
     }
   }
 
+#if SICSLOWPAN_REASS_BUFFER
+  if(first_fragment &&
+     uncomp_hdr_len + packetbuf_payload_len > REASS_BUF_LEN(frag_context)) {
+    PRINTF("SICSLOWPAN: first fragment larger than reassembly buffer\n");
+    clear_fragments(frag_context);
+    return;
+  }
+#endif /* SICSLOWPAN_REASS_BUFFER */
+
   /* copy the payload if buffer is non-null - which is only the case with first fragment
      or packets that are non fragmented */
   if(buffer != NULL) {
@@ -1680,6 +2955,11 @@ input(void)
     if(first_fragment != 0) {
       frag_info[frag_context].reassembled_len = uncomp_hdr_len + packetbuf_payload_len;
       frag_info[frag_context].first_frag_len = uncomp_hdr_len + packetbuf_payload_len;
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(vrb_forward_first(frag_context)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
     }
     /* For the last fragment, we are OK if there is extrenous bytes at
        the end of the packet. */
@@ -1745,6 +3025,10 @@ sicslowpan_init(void)
 
   tcpip_set_outputfunc(output);
 
+#if SICSLOWPAN_NBR_MTU
+  nbr_table_register(nbr_max_payload, NULL);
+#endif /* SICSLOWPAN_NBR_MTU */
+
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
 /* Preinitialize any address contexts for better header compression
  * (Saves up to 13 bytes per 6lowpan packet)
@@ -82,6 +82,7 @@
 #define SICSLOWPAN_DISPATCH_IPHC                    0x60 /* 011xxxxx = ... */
 #define SICSLOWPAN_DISPATCH_FRAG1                   0xc0 /* 11000xxx */
 #define SICSLOWPAN_DISPATCH_FRAGN                   0xe0 /* 11100xxx */
+#define SICSLOWPAN_DISPATCH_PAGE_1                  0xf1 /* 11110001 */
 /** @} */
 
 /** \name HC1 encoding
@@ -141,6 +142,25 @@
 #define SICSLOWPAN_IPHC_MCAST_RANGE                 0xA0
 /** @} */
 
+/**
+ * \name 6LoRH encoding (RFC 8138), in dispatch page 1
+ * @{
+ */
+#define SICSLOWPAN_6LORH_MASK                       0xc0
+#define SICSLOWPAN_6LORH_ID                         0x80 /* 10xxxxxx */
+#define SICSLOWPAN_6LORH_CRITICAL                   0x80 /* 100xxxxx */
+#define SICSLOWPAN_6LORH_ELECTIVE                   0xa0 /* 101xxxxx */
+/* Types 0 to 4: RH3-6LoRH with (1 << type)-byte addresses */
+#define SICSLOWPAN_6LORH_TYPE_RH3_16                4
+#define SICSLOWPAN_6LORH_TYPE_RPI                   5
+/* Flags of the RPI-6LoRH first byte */
+#define SICSLOWPAN_6LORH_RPI_O                      0x10
+#define SICSLOWPAN_6LORH_RPI_R                      0x08
+#define SICSLOWPAN_6LORH_RPI_F                      0x04
+#define SICSLOWPAN_6LORH_RPI_I                      0x02
+#define SICSLOWPAN_6LORH_RPI_K                      0x01
+/** @} */
+
 /* NHC_EXT_HDR */
 #define SICSLOWPAN_NHC_MASK                         0xF0
 #define SICSLOWPAN_NHC_EXT_HDR                      0xE0
@@ -321,6 +341,73 @@ struct sicslowpan_nh_compressor {
 
 int sicslowpan_get_last_rssi(void);
 
+/**
+ * \brief Set the largest frame payload (frame headers and 6LoWPAN
+ * payload, without FCS) a neighbor handles. Only available with
+ * SICSLOWPAN_CONF_NBR_MTU; it is capped to SICSLOWPAN_CONF_MAC_MAX_PAYLOAD.
+ */
+void sicslowpan_set_nbr_max_payload(const linkaddr_t *addr, uint16_t max_payload);
+/** \brief Get the largest frame payload used towards a neighbor */
+uint16_t sicslowpan_get_nbr_max_payload(const linkaddr_t *addr);
+
+/* Collect fragment reassembly statistics, to size
+   SICSLOWPAN_CONF_REASS_CONTEXTS and SICSLOWPAN_CONF_REASS_BUDGET */
+#ifdef SICSLOWPAN_CONF_REASS_STATS
+#define SICSLOWPAN_REASS_STATS SICSLOWPAN_CONF_REASS_STATS
+#else
+#define SICSLOWPAN_REASS_STATS 0
+#endif
+
+#if SICSLOWPAN_REASS_STATS
+/** Fragment reassembly counters, since boot */
+struct sicslowpan_reass_stats {
+  /** First fragments that started a reassembly */
+  uint16_t started;
+  /** Datagrams reassembled and passed to uIP */
+  uint16_t completed;
+  /** Reassemblies abandoned when their timer expired */
+  uint16_t timed_out;
+  /** First fragments dropped because all contexts were in use */
+  uint16_t no_context;
+  /** Fragments dropped for lack of buffer space */
+  uint16_t no_memory;
+  /** Subsequent fragments dropped because no reassembly matched them */
+  uint16_t orphans;
+  /** Reassemblies ended by forwarding the datagram fragment by fragment */
+  uint16_t forwarded;
+  /** Reassembly buffer bytes currently held */
+  uint16_t bytes_in_use;
+  /** Highest value of bytes_in_use so far */
+  uint16_t bytes_peak;
+};
+
+/** The state of one ongoing reassembly */
+struct sicslowpan_reass_info {
+  linkaddr_t sender;
+  uint16_t tag;
+  /** Size of the datagram */
+  uint16_t len;
+  /** Bytes of the datagram received so far */
+  uint16_t reassembled_len;
+  /** Buffer bytes held by the reassembly */
+  uint16_t buf_len;
+  /** Time since the first fragment was received */
+  clock_time_t age;
+};
+
+/** \brief Get the reassembly counters */
+const struct sicslowpan_reass_stats *sicslowpan_reass_get_stats(void);
+/** \brief The number of reassembly contexts */
+int sicslowpan_reass_num_contexts(void);
+/**
+ * \brief Get the state of a reassembly context
+ * \param context The context, from 0 to sicslowpan_reass_num_contexts() - 1
+ * \param info Filled in if the context is in use
+ * \return 1 if the context is in use, 0 otherwise
+ */
+int sicslowpan_reass_get_info(int context, struct sicslowpan_reass_info *info);
+#endif /* SICSLOWPAN_REASS_STATS */
+
 extern const struct network_driver sicslowpan_driver;
 
 #endif /* SICSLOWPAN_H_ */
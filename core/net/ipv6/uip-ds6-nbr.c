@@ -215,7 +215,7 @@ uip_ds6_link_neighbor_callback(int status, int numtx)
   /* Call upper-layer callback (e.g. RPL) */
   LINK_NEIGHBOR_CALLBACK(dest, status, numtx);
 
-#if UIP_DS6_LL_NUD
+#if UIP_DS6_LL_NUD && UIP_ND6_SEND_NS
   /* From RFC4861, page 72, last paragraph of section 7.3.3:
    *
    *         "In some cases, link-specific information may indicate that a path to
@@ -232,17 +232,12 @@ uip_ds6_link_neighbor_callback(int status, int numtx)
    * not re-testing the state of a neighbour periodically if it
    * acknowledges link packets. */
   if(status == MAC_TX_OK) {
-    uip_ds6_nbr_t *nbr;
-    nbr = uip_ds6_nbr_ll_lookup((uip_lladdr_t *)dest);
-    if(nbr != NULL && nbr->state != NBR_INCOMPLETE) {
-      nbr->state = NBR_REACHABLE;
-      stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
-      PRINTF("uip-ds6-neighbor : received a link layer ACK : ");
-      PRINTLLADDR((uip_lladdr_t *)dest);
-      PRINTF(" is reachable.\n");
-    }
+    PRINTF("uip-ds6-neighbor : received a link layer ACK : ");
+    PRINTLLADDR((uip_lladdr_t *)dest);
+    PRINTF(" is reachable.\n");
+    uip_ds6_nbr_confirm_reachable(uip_ds6_nbr_ll_lookup((uip_lladdr_t *)dest));
   }
-#endif /* UIP_DS6_LL_NUD */
+#endif /* UIP_DS6_LL_NUD && UIP_ND6_SEND_NS */
 
 }
 #if UIP_ND6_SEND_NS
@@ -253,10 +248,27 @@ uip_ds6_neighbor_periodic(void)
 {
   uip_ds6_nbr_t *nbr = nbr_table_head(ds6_neighbors);
   while(nbr != NULL) {
+#if UIP_ND6_ARO
+    if(nbr->registered) {
+      /* The registration keeps the entry alive, no NUD needed */
+      if(stimer_expired(&nbr->reglifetime)) {
+        uip_ds6_nbr_t *next = nbr_table_next(ds6_neighbors, nbr);
+        PRINTF("Registration expired (");
+        PRINT6ADDR(&nbr->ipaddr);
+        PRINTF(")\n");
+        uip_ds6_nbr_unregister(nbr);
+        uip_ds6_nbr_rm(nbr);
+        nbr = next;
+      } else {
+        nbr = nbr_table_next(ds6_neighbors, nbr);
+      }
+      continue;
+    }
+#endif /* UIP_ND6_ARO */
     switch(nbr->state) {
     case NBR_REACHABLE:
       if(stimer_expired(&nbr->reachable)) {
-#if UIP_CONF_IPV6_RPL
+#if UIP_CONF_IPV6_RPL && !UIP_ND6_ARO
         /* when a neighbor leave its REACHABLE state and is a default router,
            instead of going to STALE state it enters DELAY state in order to
            force a NUD on it. Otherwise, if there is no upward traffic, the
@@ -276,12 +288,14 @@ uip_ds6_neighbor_periodic(void)
           PRINTF(")\n");
           nbr->state = NBR_STALE;
         }
-#else /* UIP_CONF_IPV6_RPL */
+#else /* UIP_CONF_IPV6_RPL && !UIP_ND6_ARO */
+        /* With address registration, re-registering with the default
+           router confirms that it is still reachable. */
         PRINTF("REACHABLE: moving to STALE (");
         PRINT6ADDR(&nbr->ipaddr);
         PRINTF(")\n");
         nbr->state = NBR_STALE;
-#endif /* UIP_CONF_IPV6_RPL */
+#endif /* UIP_CONF_IPV6_RPL && !UIP_ND6_ARO */
       }
       break;
     case NBR_INCOMPLETE:
@@ -338,6 +352,45 @@ uip_ds6_nbr_refresh_reachable_state(const uip_ipaddr_t *ipaddr)
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+uip_ds6_nbr_confirm_reachable(uip_ds6_nbr_t *nbr)
+{
+  if(nbr == NULL || nbr->state == NBR_INCOMPLETE) {
+    return;
+  }
+  if(nbr->state != NBR_REACHABLE) {
+    PRINTF("Reachability of ");
+    PRINT6ADDR(&nbr->ipaddr);
+    PRINTF(" confirmed in state %u\n", nbr->state);
+  }
+  nbr->state = NBR_REACHABLE;
+  nbr->nscount = 0;
+  stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_ND6_ARO
+void
+uip_ds6_nbr_register(uip_ds6_nbr_t *nbr, const uint8_t *eui64,
+                     unsigned long lifetime)
+{
+  nbr->registered = 1;
+  memcpy(nbr->eui64, eui64, sizeof(nbr->eui64));
+  stimer_set(&nbr->reglifetime, lifetime);
+  nbr->state = NBR_REACHABLE;
+  nbr->nscount = 0;
+  stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+  nbr_table_lock(ds6_neighbors, nbr);
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_nbr_unregister(uip_ds6_nbr_t *nbr)
+{
+  nbr->registered = 0;
+  nbr->state = NBR_STALE;
+  nbr_table_unlock(ds6_neighbors, nbr);
+}
+#endif /* UIP_ND6_ARO */
+/*---------------------------------------------------------------------------*/
 uip_ds6_nbr_t *
 uip_ds6_get_least_lifetime_neighbor(void)
 {
@@ -74,6 +74,12 @@ typedef struct uip_ds6_nbr {
   struct stimer sendns;
   uint8_t nscount;
 #endif /* UIP_ND6_SEND_NS || UIP_ND6_SEND_RA */
+#if UIP_ND6_ARO
+  /** Set while the neighbor holds an address registration with us */
+  uint8_t registered;
+  struct stimer reglifetime;
+  uint8_t eui64[8];
+#endif /* UIP_ND6_ARO */
 #if UIP_CONF_IPV6_QUEUE_PKT
   struct uip_packetqueue_handle packethandle;
 #define UIP_DS6_NBR_PACKET_LIFETIME CLOCK_SECOND * 4
@@ -107,6 +113,29 @@ int uip_ds6_nbr_num(void);
  * should be refreshed.
  */
 void uip_ds6_nbr_refresh_reachable_state(const uip_ipaddr_t *ipaddr);
+
+/**
+ * \brief Confirm that a neighbor is reachable, from a hint outside of
+ * IPv6 ND: a link-layer ACK (UIP_DS6_LL_NUD) or a control message of the
+ * routing protocol (UIP_DS6_UL_NUD). The neighbor goes back to REACHABLE
+ * and any pending NUD probe is cancelled. Neighbors whose link-layer
+ * address is not known yet are left alone.
+ * \param nbr the neighbor, may be NULL
+ */
+void uip_ds6_nbr_confirm_reachable(uip_ds6_nbr_t *nbr);
+
+#if UIP_ND6_ARO
+/**
+ * \brief Mark a neighbor as registered for \a lifetime seconds
+ *
+ * A registered neighbor stays REACHABLE without NUD and is locked in the
+ * neighbor table until the registration expires or is withdrawn with
+ * uip_ds6_nbr_unregister().
+ */
+void uip_ds6_nbr_register(uip_ds6_nbr_t *nbr, const uint8_t *eui64,
+                          unsigned long lifetime);
+void uip_ds6_nbr_unregister(uip_ds6_nbr_t *nbr);
+#endif /* UIP_ND6_ARO */
 #endif /* UIP_ND6_SEND_NS */
 
 /**
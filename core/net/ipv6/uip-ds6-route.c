@@ -45,6 +45,17 @@
 #include "lib/memb.h"
 #include "net/nbr-table.h"
 
+#if UIP_DS6_ROUTE_WITH_SLAB
+#include "lib/slab.h"
+#define ROUTE_MEMB SLAB_OWNER
+#define route_memb_alloc slab_alloc
+#define route_memb_free slab_free
+#else /* UIP_DS6_ROUTE_WITH_SLAB */
+#define ROUTE_MEMB MEMB_FREELIST
+#define route_memb_alloc memb_alloc
+#define route_memb_free memb_free
+#endif /* UIP_DS6_ROUTE_WITH_SLAB */
+
 #include <string.h>
 
 /* A configurable function called after adding a new neighbor as next hop */
@@ -64,17 +75,43 @@ void NETSTACK_CONF_ROUTING_NEIGHBOR_REMOVED_CALLBACK(const linkaddr_t *addr);
    so that it will be maintained along with the rest of the neighbor
    tables in the system. */
 NBR_TABLE_GLOBAL(struct uip_ds6_route_neighbor_routes, nbr_routes);
-MEMB(neighborroutememb, struct uip_ds6_route_neighbor_route, UIP_DS6_ROUTE_NB);
+ROUTE_MEMB(neighborroutememb, struct uip_ds6_route_neighbor_route, UIP_DS6_ROUTE_NB);
 
 /* Each route is repressented by a uip_ds6_route_t structure and
    memory for each route is allocated from the routememb memory
    block. These routes are maintained on the routelist. */
 LIST(routelist);
-MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
+ROUTE_MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_COMPACT
+/* The leading bytes of route destinations, shared by the routes that
+   refer to them */
+#define ROUTE_PREFIX_LEN (sizeof(uip_ipaddr_t) - UIP_DS6_ROUTE_SUFFIX_LEN)
+static struct {
+  uint8_t prefix[ROUTE_PREFIX_LEN];
+  uint16_t refcount;
+} route_prefixes[UIP_DS6_ROUTE_PREFIX_NB];
+#endif /* UIP_DS6_ROUTE_COMPACT */
+
+#if UIP_DS6_ROUTE_TRIE
+/* A node in the route trie. Each node covers the first len bits of
+   prefix. Nodes that hold a route end at the route prefix length;
+   nodes that do not hold a route are pure branch nodes and always
+   have two children. A trie over N routes therefore never needs more
+   than 2N - 1 nodes. */
+struct route_trie_node {
+  struct route_trie_node *child[2];
+  uip_ds6_route_t *route;
+  uip_ipaddr_t prefix;
+  uint8_t len;
+};
+MEMB_FREELIST(routetriememb, struct route_trie_node, 2 * UIP_DS6_ROUTE_NB);
+static struct route_trie_node *route_trie_root;
+#endif /* UIP_DS6_ROUTE_TRIE */
+
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -155,13 +192,264 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
   list_remove(notificationlist, n);
 }
 #endif
+#if (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_COMPACT
+/*---------------------------------------------------------------------------*/
+/* Returns the index of the prefix of addr in the prefix table, or -1 */
+static int
+prefix_find(const uip_ipaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < UIP_DS6_ROUTE_PREFIX_NB; i++) {
+    if(route_prefixes[i].refcount > 0 &&
+       memcmp(route_prefixes[i].prefix, addr, ROUTE_PREFIX_LEN) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Takes a reference to the prefix of addr, adding it to the table if
+   needed. Returns its index, or -1 if the table is full. */
+static int
+prefix_acquire(const uip_ipaddr_t *addr)
+{
+  int i;
+
+  i = prefix_find(addr);
+  if(i < 0) {
+    for(i = 0; i < UIP_DS6_ROUTE_PREFIX_NB; i++) {
+      if(route_prefixes[i].refcount == 0) {
+        memcpy(route_prefixes[i].prefix, addr, ROUTE_PREFIX_LEN);
+        break;
+      }
+    }
+    if(i == UIP_DS6_ROUTE_PREFIX_NB) {
+      return -1;
+    }
+  }
+  route_prefixes[i].refcount++;
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+/* Does the route match addr? prefix is the index of the prefix of
+   addr, as returned by prefix_find(). As uip_ipaddr_prefixcmp(), this
+   compares whole bytes only. */
+static int
+route_matches(const uip_ds6_route_t *r, const uip_ipaddr_t *addr, int prefix)
+{
+  uint8_t len = r->length >> 3;
+
+  if(len <= ROUTE_PREFIX_LEN) {
+    return memcmp(route_prefixes[r->prefix].prefix, addr, len) == 0;
+  }
+  if(len > sizeof(uip_ipaddr_t)) {
+    len = sizeof(uip_ipaddr_t);
+  }
+  return r->prefix == prefix &&
+    memcmp(r->suffix, &addr->u8[ROUTE_PREFIX_LEN], len - ROUTE_PREFIX_LEN) == 0;
+}
+#endif /* (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_COMPACT */
+#if (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_TRIE
+/*---------------------------------------------------------------------------*/
+static int
+trie_bit(const uip_ipaddr_t *addr, uint8_t pos)
+{
+  return (addr->u8[pos >> 3] >> (7 - (pos & 7))) & 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the number of leading bits that a and b have in common,
+   looking no further than max bits. The first from bits are known to
+   be equal already and are skipped. */
+static uint8_t
+trie_common_bits(const uip_ipaddr_t *a, const uip_ipaddr_t *b,
+                 uint8_t from, uint8_t max)
+{
+  uint8_t i;
+  uint8_t diff;
+
+  for(i = from >> 3; i < (max + 7) >> 3; i++) {
+    diff = a->u8[i] ^ b->u8[i];
+    if(diff != 0) {
+      uint8_t bits = i << 3;
+      while((diff & 0x80) == 0) {
+        diff <<= 1;
+        bits++;
+      }
+      return bits < max ? bits : max;
+    }
+  }
+  return max;
+}
+/*---------------------------------------------------------------------------*/
+static struct route_trie_node *
+trie_node_alloc(const uip_ipaddr_t *prefix, uint8_t len,
+                uip_ds6_route_t *route)
+{
+  struct route_trie_node *n;
+
+  n = memb_alloc(&routetriememb);
+  if(n != NULL) {
+    n->child[0] = n->child[1] = NULL;
+    n->route = route;
+    uip_ipaddr_copy(&n->prefix, prefix);
+    n->len = len;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static int
+trie_insert(uip_ds6_route_t *route)
+{
+  struct route_trie_node **link;
+  struct route_trie_node *n;
+  struct route_trie_node *leaf;
+  struct route_trie_node *branch;
+  const uip_ipaddr_t *prefix;
+  uint8_t len;
+  uint8_t common;
+
+  prefix = &route->ipaddr;
+  len = route->length > 128 ? 128 : route->length;
+  common = 0;
+
+  for(link = &route_trie_root; *link != NULL;) {
+    n = *link;
+    common = trie_common_bits(prefix, &n->prefix, common,
+                              len < n->len ? len : n->len);
+    if(common < n->len) {
+      /* The new prefix diverges from this node, or ends above it. */
+      leaf = trie_node_alloc(prefix, len, route);
+      if(leaf == NULL) {
+        return 0;
+      }
+      if(common == len) {
+        leaf->child[trie_bit(&n->prefix, len)] = n;
+        *link = leaf;
+        return 1;
+      }
+      branch = trie_node_alloc(prefix, common, NULL);
+      if(branch == NULL) {
+        memb_free(&routetriememb, leaf);
+        return 0;
+      }
+      branch->child[trie_bit(prefix, common)] = leaf;
+      branch->child[trie_bit(&n->prefix, common)] = n;
+      *link = branch;
+      return 1;
+    }
+    if(n->len == len) {
+      /* A duplicate prefix keeps the route that was indexed first, in
+         the same way as the list lookup prefers the older route. */
+      if(n->route == NULL) {
+        n->route = route;
+      }
+      return 1;
+    }
+    link = &n->child[trie_bit(prefix, n->len)];
+  }
+
+  *link = trie_node_alloc(prefix, len, route);
+  return *link != NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+trie_remove(uip_ds6_route_t *route)
+{
+  struct route_trie_node **link;
+  struct route_trie_node **parent_link;
+  struct route_trie_node *n;
+  struct route_trie_node *p;
+  uip_ds6_route_t *r;
+  uint8_t len;
+
+  len = route->length > 128 ? 128 : route->length;
+  parent_link = NULL;
+  for(link = &route_trie_root;
+      *link != NULL && (*link)->len < len;
+      link = &(*link)->child[trie_bit(&route->ipaddr, (*link)->len)]) {
+    parent_link = link;
+  }
+
+  n = *link;
+  if(n == NULL || n->route != route) {
+    /* The route was a duplicate that never got indexed. */
+    return;
+  }
+
+  /* Let the oldest duplicate of the removed route take over the node.
+     New routes are pushed to the front of the list, so this is the
+     last match on the list. */
+  n->route = NULL;
+  for(r = list_head(routelist); r != NULL; r = list_item_next(r)) {
+    if(r != route && r->length == route->length &&
+       trie_common_bits(&r->ipaddr, &n->prefix, 0, len) == len) {
+      n->route = r;
+    }
+  }
+  if(n->route != NULL) {
+    return;
+  }
+
+  if(n->child[0] != NULL && n->child[1] != NULL) {
+    /* The node is still needed as a branch node. */
+    return;
+  }
+
+  *link = n->child[0] != NULL ? n->child[0] : n->child[1];
+  memb_free(&routetriememb, n);
+
+  if(*link == NULL && parent_link != NULL) {
+    /* The parent may have become a branch node with a single child,
+       which is then spliced out. */
+    p = *parent_link;
+    if(p->route == NULL) {
+      *parent_link = p->child[0] != NULL ? p->child[0] : p->child[1];
+      memb_free(&routetriememb, p);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+trie_lookup(const uip_ipaddr_t *addr)
+{
+  struct route_trie_node *n;
+  uip_ds6_route_t *found_route;
+  uint8_t common;
+
+  found_route = NULL;
+  common = 0;
+  for(n = route_trie_root; n != NULL; n = n->child[trie_bit(addr, n->len)]) {
+    common = trie_common_bits(addr, &n->prefix, common, n->len);
+    if(common < n->len) {
+      break;
+    }
+    if(n->route != NULL) {
+      found_route = n->route;
+    }
+    if(n->len == 128) {
+      break;
+    }
+  }
+  return found_route;
+}
+#endif /* (UIP_CONF_MAX_ROUTES != 0) && UIP_DS6_ROUTE_TRIE */
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
+#if !UIP_DS6_ROUTE_WITH_SLAB
   memb_init(&routememb);
+#endif /* !UIP_DS6_ROUTE_WITH_SLAB */
   list_init(routelist);
+#if UIP_DS6_ROUTE_COMPACT
+  memset(route_prefixes, 0, sizeof(route_prefixes));
+#endif /* UIP_DS6_ROUTE_COMPACT */
+#if UIP_DS6_ROUTE_TRIE
+  memb_init(&routetriememb);
+  route_trie_root = NULL;
+#endif /* UIP_DS6_ROUTE_TRIE */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
@@ -187,6 +475,20 @@ uip_ds6_route_nexthop_lladdr(uip_ds6_route_t *route)
 }
 #endif /* (UIP_CONF_MAX_ROUTES != 0) */
 /*---------------------------------------------------------------------------*/
+void
+uip_ds6_route_copy_ipaddr(uip_ipaddr_t *ipaddr, const uip_ds6_route_t *route)
+{
+#if (UIP_CONF_MAX_ROUTES != 0)
+#if UIP_DS6_ROUTE_COMPACT
+  memcpy(ipaddr, route_prefixes[route->prefix].prefix, ROUTE_PREFIX_LEN);
+  memcpy(&ipaddr->u8[ROUTE_PREFIX_LEN], route->suffix,
+         UIP_DS6_ROUTE_SUFFIX_LEN);
+#else /* UIP_DS6_ROUTE_COMPACT */
+  uip_ipaddr_copy(ipaddr, &route->ipaddr);
+#endif /* UIP_DS6_ROUTE_COMPACT */
+#endif /* (UIP_CONF_MAX_ROUTES != 0) */
+}
+/*---------------------------------------------------------------------------*/
 uip_ipaddr_t *
 uip_ds6_route_nexthop(uip_ds6_route_t *route)
 {
@@ -254,22 +556,34 @@ uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_TRIE
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_TRIE */
+#if UIP_DS6_ROUTE_COMPACT
+  int prefix = prefix_find(addr);
+#endif /* UIP_DS6_ROUTE_COMPACT */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
 
+#if UIP_DS6_ROUTE_TRIE
+  found_route = trie_lookup(addr);
+#else /* UIP_DS6_ROUTE_TRIE */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
       r != NULL;
       r = uip_ds6_route_next(r)) {
+#if UIP_DS6_ROUTE_COMPACT
+    if(r->length >= longestmatch && route_matches(r, addr, prefix)) {
+#else /* UIP_DS6_ROUTE_COMPACT */
     if(r->length >= longestmatch &&
        uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+#endif /* UIP_DS6_ROUTE_COMPACT */
       longestmatch = r->length;
       found_route = r;
       /* check if total match - e.g. all 128 bits do match */
@@ -278,6 +592,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_TRIE */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -293,7 +608,9 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
        the least recently used route will be at the end of the
-       list - for fast lookups (assuming multiple packets to the same node). */
+       list - for fast lookups (assuming multiple packets to the same node).
+       The order is kept with the trie too, as it decides which route
+       is evicted first. */
 
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
@@ -312,6 +629,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 #if (UIP_CONF_MAX_ROUTES != 0)
   uip_ds6_route_t *r;
   struct uip_ds6_route_neighbor_route *nbrr;
+#if UIP_DS6_ROUTE_COMPACT
+  int prefix;
+#endif /* UIP_DS6_ROUTE_COMPACT */
 
 #if DEBUG != DEBUG_NONE
   assert_nbr_routes_list_sane();
@@ -360,12 +680,20 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
       if(oldest == NULL) {
         return NULL;
       }
-      PRINTF("uip_ds6_route_add: dropping route to ");
-      PRINT6ADDR(&oldest->ipaddr);
-      PRINTF("\n");
+      PRINTF("uip_ds6_route_add: dropping oldest route\n");
       uip_ds6_route_rm(oldest);
     }
 
+#if UIP_DS6_ROUTE_COMPACT
+    prefix = prefix_acquire(ipaddr);
+    if(prefix < 0) {
+      PRINTF("uip_ds6_route_add: no room for the prefix of ");
+      PRINT6ADDR(ipaddr);
+      PRINTF("\n");
+      return NULL;
+    }
+#endif /* UIP_DS6_ROUTE_COMPACT */
+
 
     /* Every neighbor on our neighbor table holds a struct
        uip_ds6_route_neighbor_routes which holds a list of routes that
@@ -391,6 +719,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
         /* This should not happen, as we explicitly deallocated one
            route table entry above. */
         PRINTF("uip_ds6_route_add: could not allocate neighbor table entry\n");
+#if UIP_DS6_ROUTE_COMPACT
+        route_prefixes[prefix].refcount--;
+#endif /* UIP_DS6_ROUTE_COMPACT */
         return NULL;
       }
       LIST_STRUCT_INIT(routes, route_list);
@@ -400,12 +731,15 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
     }
 
     /* Allocate a routing entry and populate it. */
-    r = memb_alloc(&routememb);
+    r = route_memb_alloc(&routememb);
 
     if(r == NULL) {
       /* This should not happen, as we explicitly deallocated one
          route table entry above. */
       PRINTF("uip_ds6_route_add: could not allocate route\n");
+#if UIP_DS6_ROUTE_COMPACT
+      route_prefixes[prefix].refcount--;
+#endif /* UIP_DS6_ROUTE_COMPACT */
       return NULL;
     }
 
@@ -413,12 +747,16 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
        and that there is a packet coming soon. */
     list_push(routelist, r);
 
-    nbrr = memb_alloc(&neighborroutememb);
+    nbrr = route_memb_alloc(&neighborroutememb);
     if(nbrr == NULL) {
       /* This should not happen, as we explicitly deallocated one
          route table entry above. */
       PRINTF("uip_ds6_route_add: could not allocate neighbor route list entry\n");
-      memb_free(&routememb, r);
+      list_remove(routelist, r);
+      route_memb_free(&routememb, r);
+#if UIP_DS6_ROUTE_COMPACT
+      route_prefixes[prefix].refcount--;
+#endif /* UIP_DS6_ROUTE_COMPACT */
       return NULL;
     }
 
@@ -434,9 +772,24 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
     nbr_table_lock(nbr_routes, routes);
   }
 
+#if UIP_DS6_ROUTE_COMPACT
+  r->prefix = prefix;
+  memcpy(r->suffix, &ipaddr->u8[ROUTE_PREFIX_LEN], UIP_DS6_ROUTE_SUFFIX_LEN);
+#else /* UIP_DS6_ROUTE_COMPACT */
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
+#endif /* UIP_DS6_ROUTE_COMPACT */
   r->length = length;
 
+#if UIP_DS6_ROUTE_TRIE
+  if(!trie_insert(r)) {
+    /* This should not happen, as the trie has room for two nodes per
+       route entry. */
+    PRINTF("uip_ds6_route_add: could not index route\n");
+    uip_ds6_route_rm(r);
+    return NULL;
+  }
+#endif /* UIP_DS6_ROUTE_TRIE */
+
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
 #endif
@@ -468,17 +821,22 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 {
 #if (UIP_CONF_MAX_ROUTES != 0)
   struct uip_ds6_route_neighbor_route *neighbor_route;
+  uip_ipaddr_t ipaddr;
 #if DEBUG != DEBUG_NONE
   assert_nbr_routes_list_sane();
 #endif /* DEBUG != DEBUG_NONE */
   if(route != NULL && route->neighbor_routes != NULL) {
 
+    uip_ds6_route_copy_ipaddr(&ipaddr, route);
     PRINTF("uip_ds6_route_rm: removing route: ");
-    PRINT6ADDR(&route->ipaddr);
+    PRINT6ADDR(&ipaddr);
     PRINTF("\n");
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_TRIE
+    trie_remove(route);
+#endif /* UIP_DS6_ROUTE_TRIE */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -487,7 +845,7 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     if(neighbor_route == NULL) {
       PRINTF("uip_ds6_route_rm: neighbor_route was NULL for ");
-      uip_debug_ipaddr_print(&route->ipaddr);
+      uip_debug_ipaddr_print(&ipaddr);
       PRINTF("\n");
     }
     list_remove(route->neighbor_routes->route_list, neighbor_route);
@@ -507,17 +865,21 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
           (const linkaddr_t *)nbr_table_get_lladdr(nbr_routes, route->neighbor_routes->route_list));
 #endif
     }
-    memb_free(&routememb, route);
-    memb_free(&neighborroutememb, neighbor_route);
-
     num_routes--;
 
     PRINTF("uip_ds6_route_rm num %d\n", num_routes);
 
 #if UIP_DS6_NOTIFICATIONS
     call_route_callback(UIP_DS6_NOTIFICATION_ROUTE_RM,
-        &route->ipaddr, uip_ds6_route_nexthop(route));
+        &ipaddr, uip_ds6_route_nexthop(route));
 #endif
+
+    /* Freed last, as the notification above still reads the route */
+#if UIP_DS6_ROUTE_COMPACT
+    route_prefixes[route->prefix].refcount--;
+#endif /* UIP_DS6_ROUTE_COMPACT */
+    route_memb_free(&routememb, route);
+    route_memb_free(&neighborroutememb, neighbor_route);
   }
 
 #if DEBUG != DEBUG_NONE
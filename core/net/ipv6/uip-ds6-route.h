@@ -88,6 +88,61 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB 4
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* Optional longest-prefix-match index over the routing table. When
+   enabled, uip_ds6_route_lookup() walks a path-compressed binary trie
+   instead of the route list, so that the lookup cost depends on the
+   address length rather than on the number of routes. The trie costs
+   two nodes of RAM per route and is meant for storing-mode roots and
+   border routers that keep large routing tables. The route list is
+   still kept in least-recently-used order for eviction. */
+#ifdef UIP_DS6_ROUTE_CONF_TRIE
+#define UIP_DS6_ROUTE_TRIE UIP_DS6_ROUTE_CONF_TRIE
+#else /* UIP_DS6_ROUTE_CONF_TRIE */
+#define UIP_DS6_ROUTE_TRIE 0
+#endif /* UIP_DS6_ROUTE_CONF_TRIE */
+
+/* Take routes from the shared slab allocator (lib/slab.h) instead of
+   a reserved memb, with UIP_DS6_ROUTE_NB as a quota. Memory that the
+   routing table does not use is then left to the other owners of the
+   shared blocks. */
+#ifdef UIP_DS6_ROUTE_CONF_WITH_SLAB
+#define UIP_DS6_ROUTE_WITH_SLAB UIP_DS6_ROUTE_CONF_WITH_SLAB
+#else /* UIP_DS6_ROUTE_CONF_WITH_SLAB */
+#define UIP_DS6_ROUTE_WITH_SLAB 0
+#endif /* UIP_DS6_ROUTE_CONF_WITH_SLAB */
+
+/* Store route destinations in compact form: the last
+   UIP_DS6_ROUTE_SUFFIX_LEN bytes are kept in the route, the leading
+   bytes in a table of UIP_DS6_ROUTE_PREFIX_NB prefixes shared by all
+   routes. In RPL storing mode almost all routes share the DAG prefix,
+   so that a route then takes 7 bytes less with the default suffix of
+   an 8-byte IID, and 13 bytes less with a suffix of 2 bytes when the
+   IIDs are derived from 16-bit link-layer addresses. A route whose
+   prefix finds no room in the prefix table is not added. Use
+   uip_ds6_route_copy_ipaddr() rather than the ipaddr field to read
+   the destination of a route in code that must work in both modes. */
+#ifdef UIP_DS6_ROUTE_CONF_COMPACT
+#define UIP_DS6_ROUTE_COMPACT UIP_DS6_ROUTE_CONF_COMPACT
+#else /* UIP_DS6_ROUTE_CONF_COMPACT */
+#define UIP_DS6_ROUTE_COMPACT 0
+#endif /* UIP_DS6_ROUTE_CONF_COMPACT */
+
+#ifdef UIP_DS6_ROUTE_CONF_SUFFIX_LEN
+#define UIP_DS6_ROUTE_SUFFIX_LEN UIP_DS6_ROUTE_CONF_SUFFIX_LEN
+#else /* UIP_DS6_ROUTE_CONF_SUFFIX_LEN */
+#define UIP_DS6_ROUTE_SUFFIX_LEN 8
+#endif /* UIP_DS6_ROUTE_CONF_SUFFIX_LEN */
+
+#ifdef UIP_DS6_ROUTE_CONF_PREFIX_NB
+#define UIP_DS6_ROUTE_PREFIX_NB UIP_DS6_ROUTE_CONF_PREFIX_NB
+#else /* UIP_DS6_ROUTE_CONF_PREFIX_NB */
+#define UIP_DS6_ROUTE_PREFIX_NB 2
+#endif /* UIP_DS6_ROUTE_CONF_PREFIX_NB */
+
+#if UIP_DS6_ROUTE_COMPACT && UIP_DS6_ROUTE_TRIE
+#error UIP_DS6_ROUTE_CONF_COMPACT cannot be used with UIP_DS6_ROUTE_CONF_TRIE
+#endif
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -153,7 +208,14 @@ typedef struct uip_ds6_route {
      belong to the neighbor table entry that this routing table entry
      uses. */
   struct uip_ds6_route_neighbor_routes *neighbor_routes;
+#if UIP_DS6_ROUTE_COMPACT
+  /* The destination is the prefix at this index of the prefix table,
+     followed by the suffix */
+  uint8_t prefix;
+  uint8_t suffix[UIP_DS6_ROUTE_SUFFIX_LEN];
+#else /* UIP_DS6_ROUTE_COMPACT */
   uip_ipaddr_t ipaddr;
+#endif /* UIP_DS6_ROUTE_COMPACT */
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
 #endif
@@ -197,6 +259,8 @@ void uip_ds6_route_rm(uip_ds6_route_t *route);
 void uip_ds6_route_rm_by_nexthop(uip_ipaddr_t *nexthop);
 
 uip_ipaddr_t *uip_ds6_route_nexthop(uip_ds6_route_t *);
+void uip_ds6_route_copy_ipaddr(uip_ipaddr_t *ipaddr,
+                               const uip_ds6_route_t *route);
 int uip_ds6_route_num_routes(void);
 uip_ds6_route_t *uip_ds6_route_head(void);
 uip_ds6_route_t *uip_ds6_route_next(uip_ds6_route_t *);
@@ -191,6 +191,10 @@ uip_ds6_periodic(void)
   uip_ds6_neighbor_periodic();
 #endif /* UIP_ND6_SEND_NS */
 
+#if UIP_ND6_ARO
+  uip_nd6_aro_periodic();
+#endif /* UIP_ND6_ARO */
+
 #if UIP_CONF_ROUTER && UIP_ND6_SEND_RA
   /* Periodic RA sending */
   if(stimer_expired(&uip_ds6_timer_ra) && (uip_len == 0)) {
@@ -150,6 +150,12 @@
 #else
 #define UIP_DS6_LL_NUD UIP_CONF_DS6_LL_NUD
 #endif
+/* Should upper-layer hints (RPL control messages) confirm reachability? */
+#ifndef UIP_CONF_DS6_UL_NUD
+#define UIP_DS6_UL_NUD UIP_CONF_IPV6_RPL
+#else
+#define UIP_DS6_UL_NUD UIP_CONF_DS6_UL_NUD
+#endif
 
 /** \brief Possible states for the an address  (RFC 4862) */
 #define ADDR_TENTATIVE 0
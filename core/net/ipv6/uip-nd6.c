@@ -135,6 +135,15 @@ static uip_ipaddr_t ipaddr;
 static uip_ds6_prefix_t *prefix; /**  Pointer to a prefix list entry */
 #endif
 
+#if UIP_ND6_ARO
+/** Registration of our link-local address with the default router */
+static struct {
+  uip_ipaddr_t router;
+  struct stimer timer;          /**< When to send the next registration NS */
+  uint8_t count;                /**< NS sent without getting an answer */
+} registration;
+#endif /* UIP_ND6_ARO */
+
 #if UIP_ND6_SEND_NA || UIP_ND6_SEND_RA || !UIP_CONF_ROUTER
 /*------------------------------------------------------------------*/
 /* Copy link-layer address from LLAO option to a word-aligned uip_lladdr_t */
@@ -159,6 +168,75 @@ create_llao(uint8_t *llao, uint8_t type) {
          UIP_ND6_OPT_LLAO_LEN - 2 - UIP_LLADDR_LEN);
 }
 
+#if UIP_ND6_ARO
+/*------------------------------------------------------------------*/
+/* create an aro */
+static void
+create_aro(uint8_t *buf, uint8_t status, uint16_t lifetime,
+           const uint8_t *eui64)
+{
+  uip_nd6_opt_aro *aro = (uip_nd6_opt_aro *)buf;
+
+  memset(aro, 0, UIP_ND6_OPT_ARO_LEN);
+  aro->type = UIP_ND6_OPT_ARO;
+  aro->len = UIP_ND6_OPT_ARO_LEN >> 3;
+  aro->status = status;
+  aro->lifetime = uip_htons(lifetime);
+  memcpy(aro->eui64, eui64, sizeof(aro->eui64));
+}
+#endif /* UIP_ND6_ARO */
+
+#if UIP_ND6_ARO && UIP_CONF_ROUTER && UIP_ND6_SEND_NA
+/*------------------------------------------------------------------*/
+/*
+ * Process the registration of the NS source address, as requested by the
+ * ARO, and return the status to put in the answer.
+ */
+static uint8_t
+aro_register(const uip_nd6_opt_aro *aro, const uip_lladdr_t *lladdr)
+{
+  const uip_lladdr_t *nbr_lladdr;
+  uint16_t lifetime;
+
+  lifetime = uip_ntohs(aro->lifetime);
+  nbr = uip_ds6_nbr_lookup(&UIP_IP_BUF->srcipaddr);
+  if(nbr != NULL && nbr->registered &&
+     memcmp(nbr->eui64, aro->eui64, sizeof(nbr->eui64)) != 0) {
+    PRINTF("ARO: address already registered by another node\n");
+    return UIP_ND6_ARO_STATUS_DUPLICATE;
+  }
+
+  if(lifetime == 0) {
+    if(nbr != NULL && nbr->registered) {
+      PRINTF("ARO: deregistration\n");
+      uip_ds6_nbr_unregister(nbr);
+    }
+    return UIP_ND6_ARO_STATUS_SUCCESS;
+  }
+
+  if(nbr == NULL) {
+    nbr = uip_ds6_nbr_add(&UIP_IP_BUF->srcipaddr, lladdr, 0, NBR_REACHABLE,
+                          NBR_TABLE_REASON_IPV6_ND, NULL);
+    if(nbr == NULL) {
+      PRINTF("ARO: neighbor cache full\n");
+      return UIP_ND6_ARO_STATUS_CACHE_FULL;
+    }
+  } else {
+    nbr_lladdr = uip_ds6_nbr_get_ll(nbr);
+    if(nbr_lladdr == NULL ||
+       (memcmp(nbr_lladdr, lladdr, UIP_LLADDR_LEN) != 0 &&
+        nbr_table_update_lladdr((const linkaddr_t *)nbr_lladdr,
+                                (const linkaddr_t *)lladdr, 1) == 0)) {
+      return UIP_ND6_ARO_STATUS_CACHE_FULL;
+    }
+  }
+
+  uip_ds6_nbr_register(nbr, aro->eui64, (unsigned long)lifetime * 60);
+  PRINTF("ARO: registered for %u minutes\n", lifetime);
+  return UIP_ND6_ARO_STATUS_SUCCESS;
+}
+#endif /* UIP_ND6_ARO && UIP_CONF_ROUTER && UIP_ND6_SEND_NA */
+
 /*------------------------------------------------------------------*/
  /**
  * Neighbor Solicitation Processing
@@ -180,12 +258,20 @@ create_llao(uint8_t *llao, uint8_t type) {
  * function: set src, dst, tgt address in the three cases, then for all cases
  * set the rest, including  SLLAO
  *
+ * A router built with UIP_ND6_ARO also accepts address registrations: a
+ * unicast NUD NS with SLLAO and ARO options registers its source address
+ * and is answered with a NA carrying the registration status in an ARO.
  */
 #if UIP_ND6_SEND_NA
 static void
 ns_input(void)
 {
   uint8_t flags;
+#if UIP_ND6_ARO && UIP_CONF_ROUTER
+  uint8_t *nd6_opt_aro = NULL;
+  uip_nd6_opt_aro aro;
+  uip_lladdr_t aro_lladdr;
+#endif /* UIP_ND6_ARO && UIP_CONF_ROUTER */
   PRINTF("Received NS from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF(" to ");
@@ -230,6 +316,10 @@ ns_input(void)
         if(nbr == NULL) {
           uip_ds6_nbr_add(&UIP_IP_BUF->srcipaddr, &lladdr_aligned,
 			  0, NBR_STALE, NBR_TABLE_REASON_IPV6_ND, NULL);
+#if UIP_ND6_ARO
+        } else if(nbr->registered) {
+          /* Only a registration may change a registered entry */
+#endif /* UIP_ND6_ARO */
         } else {
           const uip_lladdr_t *lladdr = uip_ds6_nbr_get_ll(nbr);
           if(lladdr == NULL) {
@@ -252,6 +342,11 @@ ns_input(void)
       }
 #endif /*UIP_CONF_IPV6_CHECKS */
       break;
+#if UIP_ND6_ARO && UIP_CONF_ROUTER
+    case UIP_ND6_OPT_ARO:
+      nd6_opt_aro = &uip_buf[uip_l2_l3_icmp_hdr_len + nd6_opt_offset];
+      break;
+#endif /* UIP_ND6_ARO && UIP_CONF_ROUTER */
     default:
       PRINTF("ND option not supported in NS");
       break;
@@ -260,6 +355,40 @@ ns_input(void)
   }
 
   addr = uip_ds6_addr_lookup(&UIP_ND6_NS_BUF->tgtipaddr);
+#if UIP_ND6_ARO && UIP_CONF_ROUTER
+  if(nd6_opt_aro != NULL) {
+    /* Address registration, see RFC 6775 section 6.5 */
+    if(addr == NULL || nd6_opt_llao == NULL ||
+       nd6_opt_aro[UIP_ND6_OPT_LEN_OFFSET] != UIP_ND6_OPT_ARO_LEN >> 3 ||
+       uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr) ||
+       uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+      PRINTF("NS received is bad\n");
+      goto discard;
+    }
+    /* The answer is built over the options, keep a copy */
+    memcpy(&aro, nd6_opt_aro, UIP_ND6_OPT_ARO_LEN);
+    extract_lladdr_from_llao_aligned(&aro_lladdr);
+    aro.status = aro_register(&aro, &aro_lladdr);
+
+    if(aro.status == UIP_ND6_ARO_STATUS_DUPLICATE) {
+      /* Answer the link-local address derived from the EUI-64 rather than
+         the duplicate address */
+      uip_create_linklocal_prefix(&UIP_IP_BUF->destipaddr);
+      memcpy(&UIP_IP_BUF->destipaddr.u8[8], aro.eui64, sizeof(aro.eui64));
+      UIP_IP_BUF->destipaddr.u8[8] ^= 0x02;
+      if(uip_ds6_nbr_lookup(&UIP_IP_BUF->destipaddr) == NULL &&
+         uip_ds6_nbr_add(&UIP_IP_BUF->destipaddr, &aro_lladdr, 0, NBR_STALE,
+                         NBR_TABLE_REASON_IPV6_ND, NULL) == NULL) {
+        goto discard;
+      }
+    } else {
+      uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &UIP_IP_BUF->srcipaddr);
+    }
+    uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &addr->ipaddr);
+    flags = UIP_ND6_NA_FLAG_SOLICITED | UIP_ND6_NA_FLAG_OVERRIDE;
+    goto create_na;
+  }
+#endif /* UIP_ND6_ARO && UIP_CONF_ROUTER */
   if(addr != NULL) {
     if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
       /* DAD CASE */
@@ -345,12 +474,22 @@ create_na:
   create_llao(&uip_buf[uip_l2_l3_icmp_hdr_len + UIP_ND6_NA_LEN],
               UIP_ND6_OPT_TLLAO);
 
-  UIP_ICMP_BUF->icmpchksum = 0;
-  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
-
   uip_len =
     UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN;
 
+#if UIP_ND6_ARO && UIP_CONF_ROUTER
+  if(nd6_opt_aro != NULL) {
+    create_aro(&uip_buf[uip_l2_l3_icmp_hdr_len + UIP_ND6_NA_LEN +
+                        UIP_ND6_OPT_LLAO_LEN],
+               aro.status, uip_ntohs(aro.lifetime), aro.eui64);
+    UIP_IP_BUF->len[1] += UIP_ND6_OPT_ARO_LEN;
+    uip_len += UIP_ND6_OPT_ARO_LEN;
+  }
+#endif /* UIP_ND6_ARO && UIP_CONF_ROUTER */
+
+  UIP_ICMP_BUF->icmpchksum = 0;
+  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
+
   UIP_STAT(++uip_stat.nd6.sent);
   PRINTF("Sending NA to ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
@@ -434,6 +573,114 @@ uip_nd6_ns_output(uip_ipaddr_t * src, uip_ipaddr_t * dest, uip_ipaddr_t * tgt)
 }
 #endif /* UIP_ND6_SEND_NS */
 
+#if UIP_ND6_ARO
+/*------------------------------------------------------------------*/
+/*
+ * Send a registration NS for our link-local address to the router: a NUD
+ * NS with SLLAO and ARO options (RFC 6775 section 5.5).
+ */
+static void
+aro_ns_output(const uip_ipaddr_t *src, const uip_ipaddr_t *router)
+{
+  uip_ipaddr_t iid;
+
+  uip_ext_len = 0;
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->tcflow = 0;
+  UIP_IP_BUF->flow = 0;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = UIP_ND6_HOP_LIMIT;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, src);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, router);
+
+  UIP_ICMP_BUF->type = ICMP6_NS;
+  UIP_ICMP_BUF->icode = 0;
+  UIP_ND6_NS_BUF->reserved = 0;
+  uip_ipaddr_copy((uip_ipaddr_t *) &UIP_ND6_NS_BUF->tgtipaddr, router);
+
+  create_llao(&uip_buf[uip_l2_l3_icmp_hdr_len + UIP_ND6_NS_LEN],
+              UIP_ND6_OPT_SLLAO);
+  /* The EUI-64 is the interface identifier with the U/L bit inverted */
+  uip_ds6_set_addr_iid(&iid, &uip_lladdr);
+  iid.u8[8] ^= 0x02;
+  create_aro(&uip_buf[uip_l2_l3_icmp_hdr_len + UIP_ND6_NS_LEN +
+                      UIP_ND6_OPT_LLAO_LEN],
+             UIP_ND6_ARO_STATUS_SUCCESS, UIP_ND6_ARO_LIFETIME, &iid.u8[8]);
+
+  UIP_IP_BUF->len[0] = 0;       /* length will not be more than 255 */
+  UIP_IP_BUF->len[1] = UIP_ICMPH_LEN + UIP_ND6_NS_LEN +
+    UIP_ND6_OPT_LLAO_LEN + UIP_ND6_OPT_ARO_LEN;
+  uip_len = UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NS_LEN +
+    UIP_ND6_OPT_LLAO_LEN + UIP_ND6_OPT_ARO_LEN;
+
+  UIP_ICMP_BUF->icmpchksum = 0;
+  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
+
+  UIP_STAT(++uip_stat.nd6.sent);
+  PRINTF("Sending registration NS to ");
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF("\n");
+}
+/*------------------------------------------------------------------*/
+void
+uip_nd6_aro_periodic(void)
+{
+  uip_ipaddr_t *router;
+  uip_ds6_addr_t *lladdr;
+
+  router = uip_ds6_defrt_choose();
+  if(router == NULL || uip_len != 0) {
+    return;
+  }
+  if(!uip_ipaddr_cmp(router, &registration.router)) {
+    /* New default router, register with it right away */
+    uip_ipaddr_copy(&registration.router, router);
+    registration.count = 0;
+    stimer_set(&registration.timer, 0);
+  }
+  if(!stimer_expired(&registration.timer)) {
+    return;
+  }
+  lladdr = uip_ds6_get_link_local(ADDR_PREFERRED);
+  if(lladdr == NULL) {
+    return;
+  }
+  if(registration.count >= UIP_ND6_MAX_UNICAST_SOLICIT) {
+    PRINTF("ARO: no answer from router\n");
+    registration.count = 0;
+    stimer_set(&registration.timer, UIP_ND6_ARO_RETRY_TIME);
+    return;
+  }
+  registration.count++;
+  stimer_set(&registration.timer, uip_ds6_if.retrans_timer / 1000);
+  aro_ns_output(&lladdr->ipaddr, router);
+}
+/*------------------------------------------------------------------*/
+/* Process the ARO of a NA answering our registration NS */
+static void
+aro_input(const uip_nd6_opt_aro *aro)
+{
+  uint16_t lifetime;
+
+  if(aro->len != UIP_ND6_OPT_ARO_LEN >> 3 ||
+     !uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &registration.router)) {
+    return;
+  }
+  registration.count = 0;
+  lifetime = uip_ntohs(aro->lifetime);
+  if(aro->status == UIP_ND6_ARO_STATUS_SUCCESS && lifetime > 0) {
+    /* Refresh the registration when three quarters of it have elapsed */
+    PRINTF("ARO: registered for %u minutes\n", lifetime);
+    stimer_set(&registration.timer, (unsigned long)lifetime * 45);
+  } else {
+    /* Duplicates cannot be resolved for a link-local address derived from
+       the link-layer address, simply retry later */
+    PRINTF("ARO: registration refused, status %u\n", aro->status);
+    stimer_set(&registration.timer, UIP_ND6_ARO_RETRY_TIME);
+  }
+}
+#endif /* UIP_ND6_ARO */
+
 #if UIP_ND6_SEND_NS
 /*------------------------------------------------------------------*/
 /**
@@ -506,6 +753,11 @@ na_input(void)
     case UIP_ND6_OPT_TLLAO:
       nd6_opt_llao = (uint8_t *)UIP_ND6_OPT_HDR_BUF;
       break;
+#if UIP_ND6_ARO
+    case UIP_ND6_OPT_ARO:
+      aro_input((uip_nd6_opt_aro *)UIP_ND6_OPT_HDR_BUF);
+      break;
+#endif /* UIP_ND6_ARO */
     default:
       PRINTF("ND option not supported in NA\n");
       break;
@@ -599,7 +851,8 @@ na_input(void)
   if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
     uip_len = uip_packetqueue_buflen(&nbr->packethandle);
     memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
+    /* Any further queued packets follow it out of tcpip_ipv6_output(). */
+    uip_packetqueue_pop(&nbr->packethandle);
     return;
   }
 
@@ -1087,7 +1340,8 @@ ra_input(void)
   if(nbr != NULL && uip_packetqueue_buflen(&nbr->packethandle) != 0) {
     uip_len = uip_packetqueue_buflen(&nbr->packethandle);
     memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
+    /* Any further queued packets follow it out of tcpip_ipv6_output(). */
+    uip_packetqueue_pop(&nbr->packethandle);
     return;
   }
 
@@ -125,7 +125,41 @@
 #define UIP_ND6_MAX_RA_DELAY_TIME_MS        500 /*milli seconds*/
 /** @} */
 
-#ifndef UIP_CONF_ND6_DEF_MAXDADNS
+/** \name RFC 6775 address registration */
+/** @{ */
+/**
+ * \brief Register addresses with routers with the Address Registration
+ * Option instead of doing multicast DAD and periodic NUD. Nodes register
+ * their link-local address with their default router; routers keep the
+ * neighbor cache entries of registered nodes until the registration
+ * expires.
+ */
+#ifdef UIP_CONF_ND6_ARO
+#define UIP_ND6_ARO                    UIP_CONF_ND6_ARO
+#else
+#define UIP_ND6_ARO                    0
+#endif
+/** \brief Registration lifetime requested by a node, in units of 60 s */
+#ifdef UIP_CONF_ND6_ARO_LIFETIME
+#define UIP_ND6_ARO_LIFETIME           UIP_CONF_ND6_ARO_LIFETIME
+#else
+#define UIP_ND6_ARO_LIFETIME           30
+#endif
+/** \brief Seconds to wait before retrying a refused registration */
+#ifdef UIP_CONF_ND6_ARO_RETRY_TIME
+#define UIP_ND6_ARO_RETRY_TIME         UIP_CONF_ND6_ARO_RETRY_TIME
+#else
+#define UIP_ND6_ARO_RETRY_TIME         60
+#endif
+#if UIP_ND6_ARO && !UIP_ND6_SEND_NS
+#error UIP_CONF_ND6_ARO needs UIP_CONF_ND6_SEND_NS
+#endif
+/** @} */
+
+#if UIP_ND6_ARO
+/** \brief No multicast DAD, routers detect duplicates on registration */
+#define UIP_ND6_DEF_MAXDADNS 0
+#elif !defined(UIP_CONF_ND6_DEF_MAXDADNS)
 /** \brief Do not try DAD when using EUI-64 as allowed by draft-ietf-6lowpan-nd-15 section 8.2 */
 #if UIP_CONF_LL_802154
 #define UIP_ND6_DEF_MAXDADNS 0
@@ -189,6 +223,7 @@
 #define UIP_ND6_OPT_MTU                 5
 #define UIP_ND6_OPT_RDNSS               25
 #define UIP_ND6_OPT_DNSSL               31
+#define UIP_ND6_OPT_ARO                 33
 /** @} */
 
 /** \name ND6 option types */
@@ -213,6 +248,7 @@
 #define UIP_ND6_OPT_MTU_LEN            8
 #define UIP_ND6_OPT_RDNSS_LEN          1
 #define UIP_ND6_OPT_DNSSL_LEN          1
+#define UIP_ND6_OPT_ARO_LEN            16
 
 
 /* Length of TLLAO and SLLAO options, it is L2 dependant */
@@ -244,6 +280,13 @@
 #define UIP_ND6_RA_FLAG_AUTONOMOUS      0x40
 /** @} */
 
+/** \name Address Registration Option status values */
+/** @{ */
+#define UIP_ND6_ARO_STATUS_SUCCESS      0
+#define UIP_ND6_ARO_STATUS_DUPLICATE    1
+#define UIP_ND6_ARO_STATUS_CACHE_FULL   2
+/** @} */
+
 /**
  * \name ND message structures
  * @{
@@ -344,6 +387,17 @@ typedef struct uip_nd6_opt_dns {
   uip_ipaddr_t ip;
 } uip_nd6_opt_dns;
 
+/** \brief ND option ARO */
+typedef struct uip_nd6_opt_aro {
+  uint8_t type;
+  uint8_t len;
+  uint8_t status;
+  uint8_t reserved1;
+  uint16_t reserved2;
+  uint16_t lifetime;
+  uint8_t eui64[8];
+} uip_nd6_opt_aro;
+
 /** \struct Redirected header option */
 typedef struct uip_nd6_opt_redirected_hdr {
   uint8_t type;
@@ -379,6 +433,19 @@ typedef struct uip_nd6_opt_redirected_hdr {
 void
 uip_nd6_ns_output(uip_ipaddr_t *src, uip_ipaddr_t *dest, uip_ipaddr_t *tgt);
 
+#if UIP_ND6_ARO
+/**
+ * \brief Register our link-local address with the default router
+ *
+ * Called periodically by uip-ds6. Sends a unicast NS carrying SLLAO and
+ * ARO options to the default router when the registration is due, i.e.
+ * when there is no registration yet, the default router changed, or the
+ * current registration is about to expire. Only one NS is prepared per
+ * call, in uip_buf.
+ */
+void uip_nd6_aro_periodic(void);
+#endif /* UIP_ND6_ARO */
+
 #if UIP_CONF_ROUTER
 #if UIP_ND6_SEND_RA
 /**
@@ -74,6 +74,7 @@
 #include "sys/cc.h"
 #include "net/ip/uip.h"
 #include "net/ip/uip_arch.h"
+#include "net/ip/ip-chksum.h"
 #include "net/ip/uipopt.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/uip-nd6.h"
@@ -151,6 +152,24 @@ uint8_t uip_ext_len = 0;
 uint8_t uip_ext_opt_offset = 0;
 /** @} */
 
+#if UIP_TCP_SEND_WINDOW
+/* The number of duplicate ACKs that triggers a fast retransmit. */
+#define UIP_TCP_DUPACK_THRESHOLD 3
+#define UIP_TCP_CAN_SEND(conn)   (uip_tcp_send_window(conn) > 0)
+#define UIP_TCP_SEND_EVENTS      UIP_POLL
+#else /* UIP_TCP_SEND_WINDOW */
+#define UIP_TCP_CAN_SEND(conn)   (!uip_outstanding(conn))
+#define UIP_TCP_SEND_EVENTS      0
+#endif /* UIP_TCP_SEND_WINDOW */
+
+#if UIP_TCP_DELAYED_ACK
+#define UIP_TCP_ACK_NOW(conn)    uip_tcp_ack_now(conn)
+#define UIP_TCP_ACK_DUE(conn)    ((conn)->ackpending > 0 && \
+                                  (conn)->acktimer == 0)
+#else /* UIP_TCP_DELAYED_ACK */
+#define UIP_TCP_ACK_NOW(conn)    (uip_flags & UIP_NEWDATA)
+#endif /* UIP_TCP_DELAYED_ACK */
+
 /*---------------------------------------------------------------------------*/
 /* Buffers                                                                   */
 /*---------------------------------------------------------------------------*/
@@ -158,7 +177,6 @@ uint8_t uip_ext_opt_offset = 0;
  * \name Buffer defines
  * @{
  */
-#define FBUF                             ((struct uip_tcpip_hdr *)&uip_reassbuf[0])
 #define UIP_IP_BUF                          ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UIP_ICMP_BUF                      ((struct uip_icmp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
 #define UIP_UDP_BUF                        ((struct uip_udp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
@@ -270,6 +288,52 @@ uint8_t uip_acc32[4];
 struct uip_udp_conn *uip_udp_conn;
 struct uip_udp_conn uip_udp_conns[UIP_UDP_CONNS];
 #endif /* UIP_UDP */
+
+/* If the local UDP port is non-zero, the connection is considered to
+   be used. If so, the local port number is checked against the
+   destination port number in the received packet. If the two port
+   numbers match, the remote port number is checked if the connection
+   is bound to a remote port. Finally, if the connection is bound to a
+   remote IP address, the source IP address of the packet is
+   checked. */
+#define UIP_UDP_CONN_MATCH(conn)                                        \
+  ((conn)->lport != 0 &&                                                \
+   UIP_UDP_BUF->destport == (conn)->lport &&                            \
+   ((conn)->rport == 0 || UIP_UDP_BUF->srcport == (conn)->rport) &&     \
+   (uip_is_addr_unspecified(&(conn)->ripaddr) ||                        \
+    uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &(conn)->ripaddr)))
+
+#define UIP_TCP_CONN_MATCH(conn)                                        \
+  ((conn)->tcpstateflags != UIP_CLOSED &&                               \
+   UIP_TCP_BUF->destport == (conn)->lport &&                            \
+   UIP_TCP_BUF->srcport == (conn)->rport &&                             \
+   uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &(conn)->ripaddr))
+
+#if UIP_CONN_HASH_SIZE
+#if (UIP_CONN_HASH_SIZE & (UIP_CONN_HASH_SIZE - 1)) != 0
+#error UIP_CONF_CONN_HASH_SIZE must be a power of two
+#endif
+#if UIP_CONNS > 256 || UIP_UDP_CONNS > 256 || UIP_LISTENPORTS > 256
+#error UIP_CONF_CONN_HASH_SIZE supports at most 256 entries per table
+#endif
+
+/* The hash tables hold the index of the connection or listening port
+   that last matched a packet in each bucket. An entry is only a hint
+   that is checked before use, so it never has to be removed. */
+#define UIP_PORT_HASH(port)     ((((port) >> 8) ^ (port)) & \
+                                 (UIP_CONN_HASH_SIZE - 1))
+/* TCP connections also hash the last 16 bits of the remote address. */
+#define UIP_TCP_HASH(lport, rport, addr) \
+  UIP_PORT_HASH((lport) ^ (rport) ^ \
+                (addr)->u16[sizeof(uip_ipaddr_t) / 2 - 1])
+#if UIP_TCP
+static uint8_t uip_conn_hash[UIP_CONN_HASH_SIZE];
+static uint8_t uip_listen_hash[UIP_CONN_HASH_SIZE];
+#endif /* UIP_TCP */
+#if UIP_UDP
+static uint8_t uip_udp_conn_hash[UIP_CONN_HASH_SIZE];
+#endif /* UIP_UDP */
+#endif /* UIP_CONN_HASH_SIZE */
 /** @} */
 
 /*---------------------------------------------------------------------------*/
@@ -322,41 +386,10 @@ uip_add32(uint8_t *op32, uint16_t op16)
 
 #if ! UIP_ARCH_CHKSUM
 /*---------------------------------------------------------------------------*/
-static uint16_t
-chksum(uint16_t sum, const uint8_t *data, uint16_t len)
-{
-  uint16_t t;
-  const uint8_t *dataptr;
-  const uint8_t *last_byte;
-
-  dataptr = data;
-  last_byte = data + len - 1;
-
-  while(dataptr < last_byte) {   /* At least two more bytes */
-    t = (dataptr[0] << 8) + dataptr[1];
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-    dataptr += 2;
-  }
-
-  if(dataptr == last_byte) {
-    t = (dataptr[0] << 8) + 0;
-    sum += t;
-    if(sum < t) {
-      sum++;      /* carry */
-    }
-  }
-
-  /* Return sum in host byte order. */
-  return sum;
-}
-/*---------------------------------------------------------------------------*/
 uint16_t
 uip_chksum(uint16_t *data, uint16_t len)
 {
-  return uip_htons(chksum(0, (uint8_t *)data, len));
+  return uip_htons(ip_chksum(0, (uint8_t *)data, len));
 }
 /*---------------------------------------------------------------------------*/
 #ifndef UIP_ARCH_IPCHKSUM
@@ -365,7 +398,7 @@ uip_ipchksum(void)
 {
   uint16_t sum;
 
-  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  sum = ip_chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
   PRINTF("uip_ipchksum: sum 0x%04x\n", sum);
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -395,11 +428,12 @@ upper_layer_chksum(uint8_t proto)
   /* IP protocol and length fields. This addition cannot carry. */
   sum = upper_layer_len + proto;
   /* Sum IP source and destination addresses. */
-  sum = chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+  sum = ip_chksum(sum, (uint8_t *)&UIP_IP_BUF->srcipaddr,
+                  2 * sizeof(uip_ipaddr_t));
 
   /* Sum TCP header and data. */
-  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
-               upper_layer_len);
+  sum = ip_chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+                  upper_layer_len);
 
   return (sum == 0) ? 0xffff : uip_htons(sum);
 }
@@ -521,6 +555,16 @@ uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
 
   conn->len = 1;   /* TCP length of the SYN is one. */
   conn->nrtx = 0;
+  conn->rcv_wnd = UIP_RECEIVE_WINDOW;
+#if UIP_TCP_DELAYED_ACK
+  conn->ackpending = 0;
+  conn->rcv_unacked = 0;
+#endif /* UIP_TCP_DELAYED_ACK */
+#if UIP_TCP_SEND_WINDOW
+  conn->dupacks = 0;
+  conn->recover = 0;
+  conn->snd_wnd = UIP_TCP_MSS;
+#endif /* UIP_TCP_SEND_WINDOW */
   conn->timer = 1; /* Send the SYN next time around. */
   conn->rto = UIP_RTO;
   conn->sa = 0;
@@ -528,6 +572,9 @@ uip_connect(const uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+#if UIP_CONN_HASH_SIZE
+  uip_conn_hash[UIP_TCP_HASH(conn->lport, rport, ripaddr)] = conn - uip_conns;
+#endif /* UIP_CONN_HASH_SIZE */
 
   return conn;
 }
@@ -592,6 +639,9 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
 
   conn->lport = UIP_HTONS(lastport);
   conn->rport = rport;
+#if UIP_CONN_HASH_SIZE
+  uip_udp_conn_hash[UIP_PORT_HASH(conn->lport)] = c;
+#endif /* UIP_CONN_HASH_SIZE */
   if(ripaddr == NULL) {
     memset(&conn->ripaddr, 0, sizeof(uip_ipaddr_t));
   } else {
@@ -623,6 +673,9 @@ uip_listen(uint16_t port)
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(uip_listenports[c] == 0) {
       uip_listenports[c] = port;
+#if UIP_CONN_HASH_SIZE
+      uip_listen_hash[UIP_PORT_HASH(port)] = c;
+#endif /* UIP_CONN_HASH_SIZE */
       return;
     }
   }
@@ -633,20 +686,35 @@ uip_listen(uint16_t port)
 #if UIP_CONF_IPV6_REASSEMBLY
 #define UIP_REASS_BUFSIZE (UIP_BUFSIZE - UIP_LLH_LEN)
 
-static uint8_t uip_reassbuf[UIP_REASS_BUFSIZE];
+/*
+ * A datagram being reassembled. Fragments are matched to it by source
+ * address, destination address and identification, so that
+ * UIP_REASS_NUM datagrams can be reassembled at the same time.
+ */
+struct uip_reass_buf {
+  uint8_t buf[UIP_REASS_BUFSIZE];
+  /*the first byte of an IP fragment is aligned on an 8-byte boundary */
+  uint8_t bitmap[UIP_REASS_BUFSIZE / (8 * 8) + 1];
+  clock_time_t start; /* when the first fragment arrived */
+  uint32_t id;
+  uint16_t len;
+  uint8_t flags;
+};
 
-static uint8_t uip_reassbitmap[UIP_REASS_BUFSIZE / (8 * 8)];
-/*the first byte of an IP fragment is aligned on an 8-byte boundary */
+static struct uip_reass_buf uip_reassbufs[UIP_REASS_NUM];
+
+#define FBUF(r)                  ((struct uip_tcpip_hdr *)&(r)->buf[0])
 
 static const uint8_t bitmap_bits[8] = {0xff, 0x7f, 0x3f, 0x1f,
                                     0x0f, 0x07, 0x03, 0x01};
-static uint16_t uip_reasslen;
-static uint8_t uip_reassflags;
+/* Set when uip_reass() returns an error message instead of a packet */
+static uint8_t uip_reass_error;
 
 #define UIP_REASS_FLAG_LASTFRAG 0x01
 #define UIP_REASS_FLAG_FIRSTFRAG 0x02
-#define UIP_REASS_FLAG_ERROR_MSG 0x04
+#define UIP_REASS_FLAG_USED 0x04
 
+#define UIP_REASS_TIMEOUT ((clock_time_t)UIP_REASS_MAXAGE * CLOCK_SECOND)
 
 /*
  * See RFC 2460 for a description of fragmentation in IPv6
@@ -658,156 +726,208 @@ static uint8_t uip_reassflags;
  */
 
 
-struct etimer uip_reass_timer; /**< Timer for reassembly */
-uint8_t uip_reass_on; /* equal to 1 if we are currently reassembling a packet */
+struct etimer uip_reass_timer; /**< Timer for reassembly, set to the first timeout */
+uint8_t uip_reass_on; /* the number of packets being reassembled */
 
-static uint32_t uip_id; /* For every packet that is to be fragmented, the source
-                        node generates an Identification value that is present
-                        in all the fragments */
 #define IP_MF   0x0001
 
+/*---------------------------------------------------------------------------*/
+/* Sets the reassembly timer to the earliest timeout of all buffers */
+static void
+uip_reass_set_timer(void)
+{
+  struct uip_reass_buf *r;
+  clock_time_t age;
+  clock_time_t left;
+  clock_time_t next = 0;
+  int found = 0;
+
+  for(r = uip_reassbufs; r < &uip_reassbufs[UIP_REASS_NUM]; r++) {
+    if(r->flags & UIP_REASS_FLAG_USED) {
+      age = clock_time() - r->start;
+      left = age < UIP_REASS_TIMEOUT ? UIP_REASS_TIMEOUT - age : 0;
+      if(!found || left < next) {
+        next = left;
+        found = 1;
+      }
+    }
+  }
+  if(found) {
+    etimer_set(&uip_reass_timer, next);
+  } else {
+    etimer_stop(&uip_reass_timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+uip_reass_free(struct uip_reass_buf *r)
+{
+  r->flags = 0;
+  uip_reass_on--;
+  uip_reass_set_timer();
+}
+/*---------------------------------------------------------------------------*/
+/* Finds the buffer of the datagram of the fragment in uip_buf, or a free
+   one for a new datagram */
+static struct uip_reass_buf *
+uip_reass_lookup(void)
+{
+  struct uip_reass_buf *r;
+  struct uip_reass_buf *free = NULL;
+
+  for(r = uip_reassbufs; r < &uip_reassbufs[UIP_REASS_NUM]; r++) {
+    if(!(r->flags & UIP_REASS_FLAG_USED)) {
+      if(free == NULL) {
+        free = r;
+      }
+    } else if(r->id == UIP_FRAG_BUF->id &&
+              uip_ipaddr_cmp(&FBUF(r)->srcipaddr, &UIP_IP_BUF->srcipaddr) &&
+              uip_ipaddr_cmp(&FBUF(r)->destipaddr, &UIP_IP_BUF->destipaddr)) {
+      return r;
+    }
+  }
+  if(free != NULL) {
+    /* We first write the unfragmentable part of IP header into the
+       reassembly buffer. The reset the other reassembly variables. */
+    PRINTF("Starting reassembly\n");
+    memcpy(FBUF(free), UIP_IP_BUF, uip_ext_len + UIP_IPH_LEN);
+    free->flags = UIP_REASS_FLAG_USED;
+    free->id = UIP_FRAG_BUF->id;
+    /* temporary in case we do not receive the fragment with offset 0 first */
+    free->start = clock_time();
+    /* Clear the bitmap. */
+    memset(free->bitmap, 0, sizeof(free->bitmap));
+    uip_reass_on++;
+    uip_reass_set_timer();
+  }
+  return free;
+}
+/*---------------------------------------------------------------------------*/
 static uint16_t
 uip_reass(void)
 {
+  struct uip_reass_buf *r;
   uint16_t offset=0;
   uint16_t len;
   uint16_t i;
 
-  /* If ip_reasstmr is zero, no packet is present in the buffer */
-  /* We first write the unfragmentable part of IP header into the reassembly
-     buffer. The reset the other reassembly variables. */
-  if(uip_reass_on == 0) {
-    PRINTF("Starting reassembly\n");
-    memcpy(FBUF, UIP_IP_BUF, uip_ext_len + UIP_IPH_LEN);
-    /* temporary in case we do not receive the fragment with offset 0 first */
-    etimer_set(&uip_reass_timer, UIP_REASS_MAXAGE*CLOCK_SECOND);
-    uip_reass_on = 1;
-    uip_reassflags = 0;
-    uip_id = UIP_FRAG_BUF->id;
-    /* Clear the bitmap. */
-    memset(uip_reassbitmap, 0, sizeof(uip_reassbitmap));
-  }
+  uip_reass_error = 0;
+
   /*
-   * Check if the incoming fragment matches the one currently present
-   * in the reasembly buffer. If so, we proceed with copying the fragment
-   * into the buffer.
+   * Look for the datagram that the incoming fragment is part of. If there
+   * is none, we start reassembling a new one, if a buffer is free.
    */
-  if(uip_ipaddr_cmp(&FBUF->srcipaddr, &UIP_IP_BUF->srcipaddr) &&
-     uip_ipaddr_cmp(&FBUF->destipaddr, &UIP_IP_BUF->destipaddr) &&
-     UIP_FRAG_BUF->id == uip_id) {
-    len = uip_len - uip_ext_len - UIP_IPH_LEN - UIP_FRAGH_LEN;
-    offset = (uip_ntohs(UIP_FRAG_BUF->offsetresmore) & 0xfff8);
-    /* in byte, originaly in multiple of 8 bytes*/
-    PRINTF("len %d\n", len);
-    PRINTF("offset %d\n", offset);
-    if(offset == 0){
-      uip_reassflags |= UIP_REASS_FLAG_FIRSTFRAG;
-      /*
-       * The Next Header field of the last header of the Unfragmentable
-       * Part is obtained from the Next Header field of the first
-       * fragment's Fragment header.
-       */
-      *uip_next_hdr = UIP_FRAG_BUF->next;
-      memcpy(FBUF, UIP_IP_BUF, uip_ext_len + UIP_IPH_LEN);
-      PRINTF("src ");
-      PRINT6ADDR(&FBUF->srcipaddr);
-      PRINTF("dest ");
-      PRINT6ADDR(&FBUF->destipaddr);
-      PRINTF("next %d\n", UIP_IP_BUF->proto);
+  r = uip_reass_lookup();
+  if(r == NULL) {
+    PRINTF("Already reassembling %u paquets\n", UIP_REASS_NUM);
+    return 0;
+  }
 
-    }
+  len = uip_len - uip_ext_len - UIP_IPH_LEN - UIP_FRAGH_LEN;
+  offset = (uip_ntohs(UIP_FRAG_BUF->offsetresmore) & 0xfff8);
+  /* in byte, originaly in multiple of 8 bytes*/
+  PRINTF("len %d\n", len);
+  PRINTF("offset %d\n", offset);
+  if(offset == 0){
+    r->flags |= UIP_REASS_FLAG_FIRSTFRAG;
+    /*
+     * The Next Header field of the last header of the Unfragmentable
+     * Part is obtained from the Next Header field of the first
+     * fragment's Fragment header.
+     */
+    *uip_next_hdr = UIP_FRAG_BUF->next;
+    memcpy(FBUF(r), UIP_IP_BUF, uip_ext_len + UIP_IPH_LEN);
+    PRINTF("src ");
+    PRINT6ADDR(&FBUF(r)->srcipaddr);
+    PRINTF("dest ");
+    PRINT6ADDR(&FBUF(r)->destipaddr);
+    PRINTF("next %d\n", UIP_IP_BUF->proto);
 
-    /* If the offset or the offset + fragment length overflows the
-       reassembly buffer, we discard the entire packet. */
-    if(offset > UIP_REASS_BUFSIZE ||
-       offset + len > UIP_REASS_BUFSIZE) {
-      uip_reass_on = 0;
-      etimer_stop(&uip_reass_timer);
-      return 0;
-    }
+  }
 
-    /* If this fragment has the More Fragments flag set to zero, it is the
-       last fragment*/
-    if((uip_ntohs(UIP_FRAG_BUF->offsetresmore) & IP_MF) == 0) {
-      uip_reassflags |= UIP_REASS_FLAG_LASTFRAG;
-      /*calculate the size of the entire packet*/
-      uip_reasslen = offset + len;
-      PRINTF("LAST FRAGMENT reasslen %d\n", uip_reasslen);
-    } else {
-      /* If len is not a multiple of 8 octets and the M flag of that fragment
-         is 1, then that fragment must be discarded and an ICMP Parameter
-         Problem, Code 0, message should be sent to the source of the fragment,
-         pointing to the Payload Length field of the fragment packet. */
-      if(len % 8 != 0){
-        uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, 4);
-        uip_reassflags |= UIP_REASS_FLAG_ERROR_MSG;
-        /* not clear if we should interrupt reassembly, but it seems so from
-           the conformance tests */
-        uip_reass_on = 0;
-        etimer_stop(&uip_reass_timer);
-        return uip_len;
-      }
+  /* If the offset or the offset + fragment length overflows the
+     reassembly buffer, we discard the entire packet. */
+  if(offset > UIP_REASS_BUFSIZE - UIP_IPH_LEN - uip_ext_len ||
+     offset + len > UIP_REASS_BUFSIZE - UIP_IPH_LEN - uip_ext_len) {
+    uip_reass_free(r);
+    return 0;
+  }
+
+  /* If this fragment has the More Fragments flag set to zero, it is the
+     last fragment*/
+  if((uip_ntohs(UIP_FRAG_BUF->offsetresmore) & IP_MF) == 0) {
+    r->flags |= UIP_REASS_FLAG_LASTFRAG;
+    /*calculate the size of the entire packet*/
+    r->len = offset + len;
+    PRINTF("LAST FRAGMENT reasslen %d\n", r->len);
+  } else {
+    /* If len is not a multiple of 8 octets and the M flag of that fragment
+       is 1, then that fragment must be discarded and an ICMP Parameter
+       Problem, Code 0, message should be sent to the source of the fragment,
+       pointing to the Payload Length field of the fragment packet. */
+    if(len % 8 != 0){
+      uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, 4);
+      uip_reass_error = 1;
+      /* not clear if we should interrupt reassembly, but it seems so from
+         the conformance tests */
+      uip_reass_free(r);
+      return uip_len;
     }
+  }
 
-    /* Copy the fragment into the reassembly buffer, at the right
-       offset. */
-    memcpy((uint8_t *)FBUF + UIP_IPH_LEN + uip_ext_len + offset,
-           (uint8_t *)UIP_FRAG_BUF + UIP_FRAGH_LEN, len);
+  /* Copy the fragment into the reassembly buffer, at the right
+     offset. */
+  memcpy((uint8_t *)FBUF(r) + UIP_IPH_LEN + uip_ext_len + offset,
+         (uint8_t *)UIP_FRAG_BUF + UIP_FRAGH_LEN, len);
 
-    /* Update the bitmap. */
-    if(offset >> 6 == (offset + len) >> 6) {
-      uip_reassbitmap[offset >> 6] |=
-        bitmap_bits[(offset >> 3) & 7] &
-        ~bitmap_bits[((offset + len) >> 3)  & 7];
-    } else {
-      /* If the two endpoints are in different bytes, we update the
-         bytes in the endpoints and fill the stuff inbetween with
-         0xff. */
-      uip_reassbitmap[offset >> 6] |= bitmap_bits[(offset >> 3) & 7];
+  /* Update the bitmap. */
+  if(offset >> 6 == (offset + len) >> 6) {
+    r->bitmap[offset >> 6] |=
+      bitmap_bits[(offset >> 3) & 7] &
+      ~bitmap_bits[((offset + len) >> 3)  & 7];
+  } else {
+    /* If the two endpoints are in different bytes, we update the
+       bytes in the endpoints and fill the stuff inbetween with
+       0xff. */
+    r->bitmap[offset >> 6] |= bitmap_bits[(offset >> 3) & 7];
 
-      for(i = (1 + (offset >> 6)); i < ((offset + len) >> 6); ++i) {
-        uip_reassbitmap[i] = 0xff;
-      }
-      uip_reassbitmap[(offset + len) >> 6] |=
-        ~bitmap_bits[((offset + len) >> 3) & 7];
+    for(i = (1 + (offset >> 6)); i < ((offset + len) >> 6); ++i) {
+      r->bitmap[i] = 0xff;
     }
+    r->bitmap[(offset + len) >> 6] |=
+      ~bitmap_bits[((offset + len) >> 3) & 7];
+  }
 
-    /* Finally, we check if we have a full packet in the buffer. We do
-       this by checking if we have the last fragment and if all bits
-       in the bitmap are set. */
+  /* Finally, we check if we have a full packet in the buffer. We do
+     this by checking if we have the last fragment and if all bits
+     in the bitmap are set. */
 
-    if(uip_reassflags & UIP_REASS_FLAG_LASTFRAG) {
-      /* Check all bytes up to and including all but the last byte in
-         the bitmap. */
-      for(i = 0; i < (uip_reasslen >> 6); ++i) {
-        if(uip_reassbitmap[i] != 0xff) {
-          return 0;
-        }
-      }
-      /* Check the last byte in the bitmap. It should contain just the
-         right amount of bits. */
-      if(uip_reassbitmap[uip_reasslen >> 6] !=
-         (uint8_t)~bitmap_bits[(uip_reasslen >> 3) & 7]) {
+  if(r->flags & UIP_REASS_FLAG_LASTFRAG) {
+    /* Check all bytes up to and including all but the last byte in
+       the bitmap. */
+    for(i = 0; i < (r->len >> 6); ++i) {
+      if(r->bitmap[i] != 0xff) {
         return 0;
       }
-
-      /* If we have come this far, we have a full packet in the
-         buffer, so we copy it to uip_buf. We also reset the timer. */
-      uip_reass_on = 0;
-      etimer_stop(&uip_reass_timer);
-
-      uip_reasslen += UIP_IPH_LEN + uip_ext_len;
-      memcpy(UIP_IP_BUF, FBUF, uip_reasslen);
-      UIP_IP_BUF->len[0] = ((uip_reasslen - UIP_IPH_LEN) >> 8);
-      UIP_IP_BUF->len[1] = ((uip_reasslen - UIP_IPH_LEN) & 0xff);
-      PRINTF("REASSEMBLED PAQUET %d (%d)\n", uip_reasslen,
-             (UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]);
-
-      return uip_reasslen;
-
     }
-  } else {
-    PRINTF("Already reassembling another paquet\n");
+    /* Check the last byte in the bitmap. It should contain just the
+       right amount of bits. */
+    if(r->bitmap[r->len >> 6] !=
+       (uint8_t)~bitmap_bits[(r->len >> 3) & 7]) {
+      return 0;
+    }
+
+    /* If we have come this far, we have a full packet in the
+       buffer, so we copy it to uip_buf. We also free the buffer. */
+    len = r->len + UIP_IPH_LEN + uip_ext_len;
+    memcpy(UIP_IP_BUF, FBUF(r), len);
+    UIP_IP_BUF->len[0] = ((len - UIP_IPH_LEN) >> 8);
+    UIP_IP_BUF->len[1] = ((len - UIP_IPH_LEN) & 0xff);
+    PRINTF("REASSEMBLED PAQUET %d (%d)\n", len,
+           (UIP_IP_BUF->len[0] << 8) | UIP_IP_BUF->len[1]);
+    uip_reass_free(r);
+
+    return len;
   }
   return 0;
 }
@@ -815,12 +935,27 @@ uip_reass(void)
 void
 uip_reass_over(void)
 {
-  /* to late, we abandon the reassembly of the packet */
+  struct uip_reass_buf *r;
+  uint8_t flags;
 
-  uip_reass_on = 0;
-  etimer_stop(&uip_reass_timer);
+  /* to late, we abandon the reassembly of the packets that timed out */
+  for(r = uip_reassbufs; r < &uip_reassbufs[UIP_REASS_NUM]; r++) {
+    if((r->flags & UIP_REASS_FLAG_USED) &&
+       clock_time() - r->start >= UIP_REASS_TIMEOUT) {
+      break;
+    }
+  }
+  if(r == &uip_reassbufs[UIP_REASS_NUM]) {
+    uip_reass_set_timer();
+    return;
+  }
+
+  /* Only one error message fits in uip_buf. uip_reass_free() sets the
+     timer to expire at once if other packets have also timed out. */
+  flags = r->flags;
+  uip_reass_free(r);
 
-  if(uip_reassflags & UIP_REASS_FLAG_FIRSTFRAG){
+  if(flags & UIP_REASS_FLAG_FIRSTFRAG){
     PRINTF("FRAG INTERRUPTED TOO LATE\n");
     /* If the first fragment has been received, an ICMP Time Exceeded
        -- Fragment Reassembly Time Exceeded message should be sent to the
@@ -832,8 +967,8 @@ uip_reass_over(void)
      * the packet.
      */
     uip_clear_buf();
-    memcpy(UIP_IP_BUF, FBUF, UIP_IPH_LEN); /* copy the header for src
-                                              and dest address*/
+    memcpy(UIP_IP_BUF, FBUF(r), UIP_IPH_LEN); /* copy the header for src
+                                                 and dest address*/
     uip_icmp6_error_output(ICMP6_TIME_EXCEEDED, ICMP6_TIME_EXCEED_REASSEMBLY, 0);
 
     UIP_STAT(++uip_stat.ip.sent);
@@ -854,6 +989,101 @@ uip_add_rcv_nxt(uint16_t n)
   uip_conn->rcv_nxt[2] = uip_acc32[2];
   uip_conn->rcv_nxt[3] = uip_acc32[3];
 }
+/*---------------------------------------------------------------------------*/
+static void
+uip_update_rtt(struct uip_conn *conn)
+{
+  signed char m;
+
+  m = conn->rto - conn->timer;
+  /* This is taken directly from VJs original code in his paper */
+  m = m - (conn->sa >> 3);
+  conn->sa += m;
+  if(m < 0) {
+    m = -m;
+  }
+  m = m - (conn->sv >> 2);
+  conn->sv += m;
+  conn->rto = (conn->sa >> 3) + conn->sv;
+}
+#if UIP_TCP_DELAYED_ACK
+/*---------------------------------------------------------------------------*/
+/*
+ * Decides whether a pure ACK has to be sent now. Incoming data is
+ * acknowledged once UIP_TCP_DELAYED_ACK segments have arrived, or
+ * when the window would not fit another segment of the same size.
+ * Forced ACKs without data, such as window updates after
+ * uip_restart(), are never delayed.
+ */
+static int
+uip_tcp_ack_now(struct uip_conn *conn)
+{
+  if(uip_flags & UIP_NEWDATA) {
+    if(uip_len == 0 || (conn->tcpstateflags & UIP_STOPPED)) {
+      return 1;
+    }
+    if(conn->ackpending == 0) {
+      conn->acktimer = UIP_TCP_DELAYED_ACK_TIMEOUT;
+    }
+    ++conn->ackpending;
+    conn->rcv_unacked += uip_len;
+    return conn->ackpending >= UIP_TCP_DELAYED_ACK ||
+      conn->rcv_unacked + uip_len > conn->rcv_wnd;
+  }
+  return UIP_TCP_ACK_DUE(conn);
+}
+#endif /* UIP_TCP_DELAYED_ACK */
+#if UIP_TCP_SEND_WINDOW
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_tcp_send_window(struct uip_conn *conn)
+{
+  uint16_t wnd;
+
+  if((conn->tcpstateflags & (UIP_TS_MASK | UIP_CLOSE_PENDING)) !=
+     UIP_ESTABLISHED) {
+    return 0;
+  }
+
+  /* A zero window is probed with a full segment, like when there is
+     no send window. */
+  wnd = conn->snd_wnd;
+  if(wnd == 0 && conn->len == 0) {
+    wnd = conn->initialmss;
+  }
+  if(wnd > UIP_TCP_SEND_WINDOW) {
+    wnd = UIP_TCP_SEND_WINDOW;
+  }
+  if(conn->len >= wnd) {
+    return 0;
+  }
+  wnd -= conn->len;
+
+  return wnd < conn->mss ? wnd : conn->mss;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Returns the number of bytes in the send window that an incoming
+ * segment acknowledges, or -1 if the acknowledgment number lies
+ * outside the send window.
+ */
+static int
+uip_acked_len(struct uip_conn *conn)
+{
+  uint32_t acked;
+
+  acked = (((uint32_t)UIP_TCP_BUF->ackno[0] << 24) |
+           ((uint32_t)UIP_TCP_BUF->ackno[1] << 16) |
+           ((uint32_t)UIP_TCP_BUF->ackno[2] << 8) |
+           UIP_TCP_BUF->ackno[3]) -
+          (((uint32_t)conn->snd_nxt[0] << 24) |
+           ((uint32_t)conn->snd_nxt[1] << 16) |
+           ((uint32_t)conn->snd_nxt[2] << 8) |
+           conn->snd_nxt[3]);
+
+  return acked <= conn->len ? (int)acked : -1;
+}
+#endif /* UIP_TCP_SEND_WINDOW */
 #endif
 /*---------------------------------------------------------------------------*/
 
@@ -949,6 +1179,16 @@ uip_process(uint8_t flag)
   uint16_t tmp16;
   uint8_t opt;
   register struct uip_conn *uip_connr = uip_conn;
+#if UIP_TCP_SEND_WINDOW
+  int acked;
+  uint16_t snd_offset;
+  uint8_t partial_ack;
+
+  /* The offset of the sequence number of an outgoing segment from
+     the first unacknowledged byte. */
+  snd_offset = 0;
+  partial_ack = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
 #endif /* UIP_TCP */
 #if UIP_UDP
   if(flag == UIP_UDP_SEND_CONN) {
@@ -962,7 +1202,7 @@ uip_process(uint8_t flag)
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
-       !uip_outstanding(uip_connr)) {
+       UIP_TCP_CAN_SEND(uip_connr)) {
       uip_flags = UIP_POLL;
       UIP_APPCALL();
       goto appsend;
@@ -1004,6 +1244,11 @@ uip_process(uint8_t flag)
         uip_connr->tcpstateflags = UIP_CLOSED;
       }
     } else if(uip_connr->tcpstateflags != UIP_CLOSED) {
+#if UIP_TCP_DELAYED_ACK
+      if(uip_connr->acktimer > 0) {
+        --uip_connr->acktimer;
+      }
+#endif /* UIP_TCP_DELAYED_ACK */
       /*
        * If the connection has outstanding data, we increase the
        * connection's timer and see if it has reached the RTO value
@@ -1058,6 +1303,12 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
 
           case UIP_ESTABLISHED:
+#if UIP_TCP_SEND_WINDOW
+            /* With a send window, we retransmit the oldest
+               unacknowledged segment from the retransmission buffer. */
+            uip_connr->recover = uip_connr->len;
+            goto tcp_send_rexmit;
+#else /* UIP_TCP_SEND_WINDOW */
             /*
              * In the ESTABLISHED state, we call upon the application
              * to do the actual retransmit after which we jump into
@@ -1067,6 +1318,7 @@ uip_process(uint8_t flag)
             uip_flags = UIP_REXMIT;
             UIP_APPCALL();
             goto apprexmit;
+#endif /* UIP_TCP_SEND_WINDOW */
 
           case UIP_FIN_WAIT_1:
           case UIP_CLOSING:
@@ -1075,6 +1327,24 @@ uip_process(uint8_t flag)
             goto tcp_send_finack;
           }
         }
+#if UIP_TCP_SEND_WINDOW
+        /* Let the application fill the rest of the send window. */
+        if(uip_tcp_send_window(uip_connr) > 0) {
+          uip_flags = UIP_POLL;
+          UIP_APPCALL();
+          goto appsend;
+        }
+#endif /* UIP_TCP_SEND_WINDOW */
+#if UIP_TCP_DELAYED_ACK
+        /* Send a delayed ACK whose timer has expired. */
+        if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+           UIP_TCP_ACK_DUE(uip_connr)) {
+#if UIP_TCP_SEND_WINDOW
+          snd_offset = uip_connr->len;
+#endif /* UIP_TCP_SEND_WINDOW */
+          goto tcp_send_ack;
+        }
+#endif /* UIP_TCP_DELAYED_ACK */
       } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
         /*
          * If there was no need for a retransmission, we poll the
@@ -1394,7 +1664,7 @@ uip_process(uint8_t flag)
           if(uip_len == 0) {
             goto drop;
           }
-          if(uip_reassflags & UIP_REASS_FLAG_ERROR_MSG){
+          if(uip_reass_error){
             /* we are not done with reassembly, this is an error message */
             goto send;
           }
@@ -1514,22 +1784,20 @@ uip_process(uint8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+#if UIP_CONN_HASH_SIZE
+  c = UIP_PORT_HASH(UIP_UDP_BUF->destport);
+  uip_udp_conn = &uip_udp_conns[uip_udp_conn_hash[c]];
+  if(UIP_UDP_CONN_MATCH(uip_udp_conn)) {
+    goto udp_found;
+  }
+#endif /* UIP_CONN_HASH_SIZE */
   for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
-    /* If the local UDP port is non-zero, the connection is considered
-       to be used. If so, the local port number is checked against the
-       destination port number in the received packet. If the two port
-       numbers match, the remote port number is checked if the
-       connection is bound to a remote port. Finally, if the
-       connection is bound to a remote IP address, the source IP
-       address of the packet is checked. */
-    if(uip_udp_conn->lport != 0 &&
-       UIP_UDP_BUF->destport == uip_udp_conn->lport &&
-       (uip_udp_conn->rport == 0 ||
-        UIP_UDP_BUF->srcport == uip_udp_conn->rport) &&
-       (uip_is_addr_unspecified(&uip_udp_conn->ripaddr) ||
-        uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &uip_udp_conn->ripaddr))) {
+    if(UIP_UDP_CONN_MATCH(uip_udp_conn)) {
+#if UIP_CONN_HASH_SIZE
+      uip_udp_conn_hash[c] = uip_udp_conn - uip_udp_conns;
+#endif /* UIP_CONN_HASH_SIZE */
       goto udp_found;
     }
   }
@@ -1618,12 +1886,20 @@ uip_process(uint8_t flag)
 
   /* Demultiplex this segment. */
   /* First check any active connections. */
+#if UIP_CONN_HASH_SIZE
+  c = UIP_TCP_HASH(UIP_TCP_BUF->destport, UIP_TCP_BUF->srcport,
+                   &UIP_IP_BUF->srcipaddr);
+  uip_connr = &uip_conns[uip_conn_hash[c]];
+  if(UIP_TCP_CONN_MATCH(uip_connr)) {
+    goto found;
+  }
+#endif /* UIP_CONN_HASH_SIZE */
   for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
       ++uip_connr) {
-    if(uip_connr->tcpstateflags != UIP_CLOSED &&
-       UIP_TCP_BUF->destport == uip_connr->lport &&
-       UIP_TCP_BUF->srcport == uip_connr->rport &&
-       uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &uip_connr->ripaddr)) {
+    if(UIP_TCP_CONN_MATCH(uip_connr)) {
+#if UIP_CONN_HASH_SIZE
+      uip_conn_hash[c] = uip_connr - uip_conns;
+#endif /* UIP_CONN_HASH_SIZE */
       goto found;
     }
   }
@@ -1638,8 +1914,16 @@ uip_process(uint8_t flag)
 
   tmp16 = UIP_TCP_BUF->destport;
   /* Next, check listening connections. */
+#if UIP_CONN_HASH_SIZE
+  if(uip_listenports[uip_listen_hash[UIP_PORT_HASH(tmp16)]] == tmp16) {
+    goto found_listen;
+  }
+#endif /* UIP_CONN_HASH_SIZE */
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(tmp16 == uip_listenports[c]) {
+#if UIP_CONN_HASH_SIZE
+      uip_listen_hash[UIP_PORT_HASH(tmp16)] = c;
+#endif /* UIP_CONN_HASH_SIZE */
       goto found_listen;
     }
   }
@@ -1739,9 +2023,23 @@ uip_process(uint8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
+  uip_connr->rcv_wnd = UIP_RECEIVE_WINDOW;
+#if UIP_TCP_DELAYED_ACK
+  uip_connr->ackpending = 0;
+  uip_connr->rcv_unacked = 0;
+#endif /* UIP_TCP_DELAYED_ACK */
+#if UIP_TCP_SEND_WINDOW
+  uip_connr->dupacks = 0;
+  uip_connr->recover = 0;
+  uip_connr->snd_wnd = UIP_TCP_MSS;
+#endif /* UIP_TCP_SEND_WINDOW */
   uip_connr->lport = UIP_TCP_BUF->destport;
   uip_connr->rport = UIP_TCP_BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
+#if UIP_CONN_HASH_SIZE
+  uip_conn_hash[UIP_TCP_HASH(uip_connr->lport, uip_connr->rport,
+                             &uip_connr->ripaddr)] = uip_connr - uip_conns;
+#endif /* UIP_CONN_HASH_SIZE */
   uip_connr->tcpstateflags = UIP_SYN_RCVD;
 
   uip_connr->snd_nxt[0] = iss[0];
@@ -1860,6 +2158,11 @@ uip_process(uint8_t flag)
 #endif
         }
       }
+#if UIP_TCP_SEND_WINDOW
+      if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+        snd_offset = uip_connr->len;
+      }
+#endif /* UIP_TCP_SEND_WINDOW */
       goto tcp_send_ack;
     }
   }
@@ -1869,6 +2172,41 @@ uip_process(uint8_t flag)
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
+#if UIP_TCP_SEND_WINDOW
+    acked = uip_acked_len(uip_connr);
+    if(acked > 0 && acked < uip_connr->len) {
+      /* A cumulative ACK for the first part of the send window. We
+         discard the acknowledged data from the retransmission buffer. */
+      uip_add32(uip_connr->snd_nxt, acked);
+      uip_connr->snd_nxt[0] = uip_acc32[0];
+      uip_connr->snd_nxt[1] = uip_acc32[1];
+      uip_connr->snd_nxt[2] = uip_acc32[2];
+      uip_connr->snd_nxt[3] = uip_acc32[3];
+      uip_connr->len -= acked;
+      memmove(uip_connr->sndbuf, &uip_connr->sndbuf[acked], uip_connr->len);
+
+      if(uip_connr->nrtx == 0) {
+        uip_update_rtt(uip_connr);
+      } else if(uip_connr->recover > acked) {
+        /* We are recovering from a loss; restart the backoff. */
+        uip_connr->recover -= acked;
+        uip_connr->nrtx = 1;
+      } else {
+        /* All data that was outstanding at the time of the loss has
+           now been acknowledged. */
+        uip_connr->recover = 0;
+        uip_connr->nrtx = 0;
+      }
+      uip_connr->timer = uip_connr->rto;
+      uip_connr->dupacks = 0;
+      partial_ack = 1;
+    } else if(acked == 0 && uip_len == 0 &&
+              (UIP_TCP_BUF->flags & (TCP_SYN | TCP_FIN)) == 0 &&
+              uip_connr->snd_wnd == (((uint16_t)UIP_TCP_BUF->wnd[0] << 8) |
+                                     UIP_TCP_BUF->wnd[1])) {
+      ++uip_connr->dupacks;
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
     if(UIP_TCP_BUF->ackno[0] == uip_acc32[0] &&
@@ -1883,18 +2221,7 @@ uip_process(uint8_t flag)
 
       /* Do RTT estimation, unless we have done retransmissions. */
       if(uip_connr->nrtx == 0) {
-        signed char m;
-        m = uip_connr->rto - uip_connr->timer;
-        /* This is taken directly from VJs original code in his paper */
-        m = m - (uip_connr->sa >> 3);
-        uip_connr->sa += m;
-        if(m < 0) {
-          m = -m;
-        }
-        m = m - (uip_connr->sv >> 2);
-        uip_connr->sv += m;
-        uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
-
+        uip_update_rtt(uip_connr);
       }
       /* Set the acknowledged flag. */
       uip_flags = UIP_ACKDATA;
@@ -1903,6 +2230,10 @@ uip_process(uint8_t flag)
 
       /* Reset length of outstanding data. */
       uip_connr->len = 0;
+#if UIP_TCP_SEND_WINDOW
+      uip_connr->dupacks = 0;
+      uip_connr->recover = 0;
+#endif /* UIP_TCP_SEND_WINDOW */
     }
 
   }
@@ -1922,6 +2253,10 @@ uip_process(uint8_t flag)
       uip_connr->tcpstateflags = UIP_ESTABLISHED;
       uip_flags = UIP_CONNECTED;
       uip_connr->len = 0;
+#if UIP_TCP_SEND_WINDOW
+      uip_connr->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+        UIP_TCP_BUF->wnd[1];
+#endif /* UIP_TCP_SEND_WINDOW */
       if(uip_len > 0) {
         uip_flags |= UIP_NEWDATA;
         uip_add_rcv_nxt(uip_len);
@@ -1984,6 +2319,10 @@ uip_process(uint8_t flag)
       uip_add_rcv_nxt(1);
       uip_flags = UIP_CONNECTED | UIP_NEWDATA;
       uip_connr->len = 0;
+#if UIP_TCP_SEND_WINDOW
+      uip_connr->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+        UIP_TCP_BUF->wnd[1];
+#endif /* UIP_TCP_SEND_WINDOW */
       uip_clear_buf();
       uip_slen = 0;
       UIP_APPCALL();
@@ -2071,12 +2410,38 @@ uip_process(uint8_t flag)
          "persistent timer" and uses the retransmission mechanim.
      */
     tmp16 = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + (uint16_t)UIP_TCP_BUF->wnd[1];
+#if UIP_TCP_SEND_WINDOW
+    uip_connr->snd_wnd = tmp16;
+#endif /* UIP_TCP_SEND_WINDOW */
     if(tmp16 > uip_connr->initialmss ||
         tmp16 == 0) {
       tmp16 = uip_connr->initialmss;
     }
     uip_connr->mss = tmp16;
 
+#if UIP_TCP_SEND_WINDOW
+    /* Retransmit the oldest segment without waiting for the timer if
+       the peer has signalled a loss through duplicate ACKs, or if
+       an ACK during loss recovery reveals that the next segment is
+       missing as well. */
+    if(!(uip_flags & UIP_NEWDATA) &&
+       ((uip_connr->dupacks == UIP_TCP_DUPACK_THRESHOLD &&
+         uip_connr->recover == 0) ||
+        (partial_ack && uip_connr->recover > 0))) {
+      if(uip_connr->nrtx == 0) {
+        uip_connr->nrtx = 1;
+      }
+      UIP_STAT(++uip_stat.tcp.rexmit);
+      goto tcp_send_rexmit;
+    }
+
+    /* The application may fill the part of the send window that was
+       acknowledged. */
+    if(partial_ack) {
+      uip_flags |= UIP_POLL;
+    }
+#endif /* UIP_TCP_SEND_WINDOW */
+
     /* If this packet constitutes an ACK for outstanding data (flagged
          by the UIP_ACKDATA flag, we should call the application since it
          might want to send more data. If the incoming packet had data
@@ -2093,7 +2458,7 @@ uip_process(uint8_t flag)
          put into the uip_appdata and the length of the data should be
          put into uip_len. If the application don't have any data to
          send, uip_len must be set to 0. */
-    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
+    if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA | UIP_TCP_SEND_EVENTS)) {
       uip_slen = 0;
       UIP_APPCALL();
 
@@ -2106,6 +2471,20 @@ uip_process(uint8_t flag)
         goto tcp_send_nodata;
       }
 
+#if UIP_TCP_SEND_WINDOW
+      if((uip_flags & UIP_CLOSE) ||
+         (uip_connr->tcpstateflags & UIP_CLOSE_PENDING)) {
+        uip_slen = 0;
+        /* The FIN follows the queued data once all the data has been
+           acknowledged. */
+        if(uip_outstanding(uip_connr)) {
+          uip_connr->tcpstateflags |= UIP_CLOSE_PENDING;
+          uip_flags &= ~UIP_CLOSE;
+        } else {
+          uip_flags |= UIP_CLOSE;
+        }
+      }
+#endif /* UIP_TCP_SEND_WINDOW */
       if(uip_flags & UIP_CLOSE) {
         uip_slen = 0;
         uip_connr->len = 1;
@@ -2115,6 +2494,58 @@ uip_process(uint8_t flag)
         goto tcp_send_nodata;
       }
 
+#if UIP_TCP_SEND_WINDOW
+      /* If uip_slen > 0, the application has data to be sent. The
+         data is appended to the send window, as far as the window and
+         the MSS allows, and remains in the retransmission buffer until
+         it has been acknowledged. */
+      if(uip_slen > 0) {
+        tmp16 = uip_tcp_send_window(uip_connr);
+        if(uip_slen > tmp16) {
+          uip_slen = tmp16;
+        }
+        if(uip_slen > 0) {
+          if(!uip_outstanding(uip_connr)) {
+            uip_connr->nrtx = 0;
+            uip_connr->timer = uip_connr->rto;
+          }
+          memcpy(&uip_connr->sndbuf[uip_connr->len], uip_sappdata, uip_slen);
+          snd_offset = uip_connr->len;
+          uip_connr->len += uip_slen;
+        }
+      } else if(!uip_outstanding(uip_connr)) {
+        uip_connr->nrtx = 0;
+      }
+      uip_appdata = uip_sappdata;
+
+      if(uip_slen > 0) {
+        uip_len = uip_slen + UIP_TCPIP_HLEN;
+        UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+        goto tcp_send_noopts;
+      }
+      if(UIP_TCP_ACK_NOW(uip_connr)) {
+        snd_offset = uip_connr->len;
+        uip_len = UIP_TCPIP_HLEN;
+        UIP_TCP_BUF->flags = TCP_ACK;
+        goto tcp_send_noopts;
+      }
+    }
+    goto drop;
+
+    tcp_send_rexmit:
+    /* Resend the oldest unacknowledged segment in the send window. */
+    uip_connr->dupacks = 0;
+    if(uip_connr->recover == 0) {
+      uip_connr->recover = uip_connr->len;
+    }
+    uip_slen = uip_connr->len < uip_connr->mss ?
+      uip_connr->len : uip_connr->mss;
+    memcpy(uip_sappdata, uip_connr->sndbuf, uip_slen);
+    snd_offset = 0;
+    uip_len = uip_slen + UIP_TCPIP_HLEN;
+    UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+    goto tcp_send_noopts;
+#else /* UIP_TCP_SEND_WINDOW */
       /* If uip_slen > 0, the application has data to be sent. */
       if(uip_slen > 0) {
 
@@ -2163,13 +2594,14 @@ uip_process(uint8_t flag)
       }
       /* If there is no data to send, just send out a pure ACK if
            there is newdata. */
-      if(uip_flags & UIP_NEWDATA) {
+      if(UIP_TCP_ACK_NOW(uip_connr)) {
         uip_len = UIP_TCPIP_HLEN;
         UIP_TCP_BUF->flags = TCP_ACK;
         goto tcp_send_noopts;
       }
     }
     goto drop;
+#endif /* UIP_TCP_SEND_WINDOW */
   case UIP_LAST_ACK:
     /* We can close this connection if the peer has acknowledged our
          FIN. This is indicated by the UIP_ACKDATA flag. */
@@ -2255,15 +2687,29 @@ uip_process(uint8_t flag)
   tcp_send:
   PRINTF("In tcp_send\n");
 
+#if UIP_TCP_DELAYED_ACK
+  /* Every segment acknowledges all data received so far. */
+  uip_connr->ackpending = 0;
+  uip_connr->rcv_unacked = 0;
+#endif /* UIP_TCP_DELAYED_ACK */
+
   UIP_TCP_BUF->ackno[0] = uip_connr->rcv_nxt[0];
   UIP_TCP_BUF->ackno[1] = uip_connr->rcv_nxt[1];
   UIP_TCP_BUF->ackno[2] = uip_connr->rcv_nxt[2];
   UIP_TCP_BUF->ackno[3] = uip_connr->rcv_nxt[3];
 
+#if UIP_TCP_SEND_WINDOW
+  uip_add32(uip_connr->snd_nxt, snd_offset);
+  UIP_TCP_BUF->seqno[0] = uip_acc32[0];
+  UIP_TCP_BUF->seqno[1] = uip_acc32[1];
+  UIP_TCP_BUF->seqno[2] = uip_acc32[2];
+  UIP_TCP_BUF->seqno[3] = uip_acc32[3];
+#else /* UIP_TCP_SEND_WINDOW */
   UIP_TCP_BUF->seqno[0] = uip_connr->snd_nxt[0];
   UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#endif /* UIP_TCP_SEND_WINDOW */
 
   UIP_TCP_BUF->srcport  = uip_connr->lport;
   UIP_TCP_BUF->destport = uip_connr->rport;
@@ -2281,8 +2727,8 @@ uip_process(uint8_t flag)
        window so that the remote host will stop sending data. */
     UIP_TCP_BUF->wnd[0] = UIP_TCP_BUF->wnd[1] = 0;
   } else {
-    UIP_TCP_BUF->wnd[0] = ((UIP_RECEIVE_WINDOW) >> 8);
-    UIP_TCP_BUF->wnd[1] = ((UIP_RECEIVE_WINDOW) & 0xff);
+    UIP_TCP_BUF->wnd[0] = uip_connr->rcv_wnd >> 8;
+    UIP_TCP_BUF->wnd[1] = uip_connr->rcv_wnd & 0xff;
   }
 
   tcp_send_noconn:
@@ -270,7 +270,11 @@ websocket_http_client_get(struct websocket_http_client_state *s)
   s->state = STATE_WAITING_FOR_HEADER;
 
   if(tcp_socket_register(&s->s, s,
+#if WEBSOCKET_HTTP_CLIENT_INPUTBUFSIZE > 0
                          s->inputbuf, sizeof(s->inputbuf),
+#else
+                         NULL, 0,
+#endif
                          s->outputbuf, sizeof(s->outputbuf),
                          input, event) < 0) {
     return -1;
@@ -315,6 +319,18 @@ websocket_http_client_sendbuflen(struct websocket_http_client_state *s)
 }
 /*---------------------------------------------------------------------------*/
 void
+websocket_http_client_hold(struct websocket_http_client_state *s)
+{
+  tcp_socket_hold(&s->s);
+}
+/*---------------------------------------------------------------------------*/
+void
+websocket_http_client_flush(struct websocket_http_client_state *s)
+{
+  tcp_socket_flush(&s->s);
+}
+/*---------------------------------------------------------------------------*/
+void
 websocket_http_client_close(struct websocket_http_client_state *s)
 {
   tcp_socket_close(&s->s);
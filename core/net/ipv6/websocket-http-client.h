@@ -34,6 +34,8 @@
 #include "contiki.h"
 #include "tcp-socket.h"
 
+/* With an input buffer size of 0, incoming data is parsed straight
+   out of the uIP buffer instead of being copied first. */
 #ifdef WEBSOCKET_HTTP_CLIENT_CONF_INPUTBUFSIZE
 #define WEBSOCKET_HTTP_CLIENT_INPUTBUFSIZE WEBSOCKET_HTTP_CLIENT_CONF_INPUTBUFSIZE
 #else /* WEBSOCKET_HTTP_CLIENT_CONF_INPUTBUFSIZE */
@@ -72,7 +74,9 @@
 
 struct websocket_http_client_state {
   struct tcp_socket s;
+#if WEBSOCKET_HTTP_CLIENT_INPUTBUFSIZE > 0
   uint8_t inputbuf[WEBSOCKET_HTTP_CLIENT_INPUTBUFSIZE];
+#endif
   uint8_t outputbuf[WEBSOCKET_HTTP_CLIENT_OUTPUTBUFSIZE];
   char host[WEBSOCKET_HTTP_CLIENT_MAX_HOSTLEN];
   char file[WEBSOCKET_HTTP_CLIENT_MAX_FILELEN];
@@ -104,6 +108,8 @@ int websocket_http_client_send(struct websocket_http_client_state *s,
                                const uint8_t *data,
                                uint16_t datalen);
 int websocket_http_client_sendbuflen(struct websocket_http_client_state *s);
+void websocket_http_client_hold(struct websocket_http_client_state *s);
+void websocket_http_client_flush(struct websocket_http_client_state *s);
 
 void websocket_http_client_close(struct websocket_http_client_state *s);
 
@@ -430,6 +430,7 @@ websocket_http_client_datahandler(struct websocket_http_client_state *client_sta
         if(s->left > 0) {
           websocket_http_client_send(&s->s, (const uint8_t*)data, s->left);
         }
+        websocket_flush(s);
         PRINTF("Got ping\n");
         call(s, WEBSOCKET_PINGED, NULL, 0);
         s->state = WEBSOCKET_STATE_WAITING_FOR_HEADER;
@@ -592,8 +593,28 @@ websocket_open(struct websocket *s, const char *url,
 }
 /*---------------------------------------------------------------------------*/
 void
+websocket_flush(struct websocket *s)
+{
+#if WEBSOCKET_COALESCE_TIME > 0
+  ctimer_stop(&s->coalesce_timer);
+#endif /* WEBSOCKET_COALESCE_TIME > 0 */
+  websocket_http_client_flush(&s->s);
+}
+/*---------------------------------------------------------------------------*/
+#if WEBSOCKET_COALESCE_TIME > 0
+static void
+coalesce_timeout(void *ptr)
+{
+  websocket_flush(ptr);
+}
+#endif /* WEBSOCKET_COALESCE_TIME > 0 */
+/*---------------------------------------------------------------------------*/
+void
 websocket_close(struct websocket *s)
 {
+#if WEBSOCKET_COALESCE_TIME > 0
+  ctimer_stop(&s->coalesce_timer);
+#endif /* WEBSOCKET_COALESCE_TIME > 0 */
   websocket_http_client_close(&s->s);
   s->state = WEBSOCKET_STATE_CLOSED;
 }
@@ -602,12 +623,11 @@ static int
 send_data(struct websocket *s, const void *data,
           uint16_t datalen, uint8_t data_type_opcode)
 {
-  uint8_t buf[WEBSOCKET_MAX_MSGLEN + 4 + 4]; /* The extra + 4 + 4 here
-                                                comes from the size of
-                                                the websocket framing
-                                                header. */
+  uint8_t buf[sizeof(struct websocket_frame_hdr) +
+              sizeof(struct websocket_frame_mask)];
   struct websocket_frame_hdr *hdr;
   struct websocket_frame_mask *mask;
+  int hdrlen, ret;
 
   PRINTF("websocket send data len %d %.*s\n", datalen, datalen, (char *)data);
   if(s->state == WEBSOCKET_STATE_CLOSED ||
@@ -627,9 +647,9 @@ send_data(struct websocket *s, const void *data,
     return -1;
   }
 
-  if(datalen > sizeof(buf) - 4 - 4) {
+  if(datalen > WEBSOCKET_MAX_MSGLEN) {
     PRINTF("websocket: trying to send too large data chunk %d > %d\n",
-           datalen, sizeof(buf) - 4 - 4);
+           datalen, WEBSOCKET_MAX_MSGLEN);
     return -1;
   }
 
@@ -647,28 +667,39 @@ send_data(struct websocket *s, const void *data,
     hdr->len = 126 | WEBSOCKET_MASK_BIT;
     hdr->extlen[0] = datalen >> 8;
     hdr->extlen[1] = datalen & 0xff;
-
-    mask = (struct websocket_frame_mask *)&buf[4];
-    mask->mask[0] =
-      mask->mask[1] =
-      mask->mask[2] =
-      mask->mask[3] = 0;
-    memcpy(&buf[8], data, datalen);
-    return websocket_http_client_send(&s->s, buf, 8 + datalen);
+    hdrlen = 4;
   } else {
     /* Data from client must always have the mask bit set, and a data
        mask sent right after the header. */
     hdr->len = datalen | WEBSOCKET_MASK_BIT;
-
-    mask = (struct websocket_frame_mask *)&buf[2];
-    mask->mask[0] =
-      mask->mask[1] =
-      mask->mask[2] =
-      mask->mask[3] = 0;
-    memcpy(&buf[6], data, datalen);
-    return websocket_http_client_send(&s->s, buf, 6 + datalen);
+    hdrlen = 2;
   }
-  return -1;
+  mask = (struct websocket_frame_mask *)&buf[hdrlen];
+  mask->mask[0] =
+    mask->mask[1] =
+    mask->mask[2] =
+    mask->mask[3] = 0;
+  hdrlen += sizeof(struct websocket_frame_mask);
+
+#if WEBSOCKET_COALESCE_TIME > 0
+  /* The first frame queued starts the coalescing period; frames
+     queued after it go out together when it ends. */
+  if(ctimer_expired(&s->coalesce_timer)) {
+    websocket_http_client_hold(&s->s);
+    ctimer_set(&s->coalesce_timer, WEBSOCKET_COALESCE_TIME,
+               coalesce_timeout, s);
+  }
+#endif /* WEBSOCKET_COALESCE_TIME > 0 */
+
+  /* The header and the data are queued right after each other in the
+     output buffer, which has room for both, so the data need not be
+     copied into a frame buffer first. With the zero mask, the data
+     goes out unchanged. */
+  ret = websocket_http_client_send(&s->s, buf, hdrlen);
+  if(ret < 0 || datalen == 0) {
+    return ret;
+  }
+  return ret + websocket_http_client_send(&s->s, data, datalen);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -713,6 +744,7 @@ websocket_ping(struct websocket *s)
     mask->mask[2] =
     mask->mask[3] = 0;
   websocket_http_client_send(&s->s, buf, 2 + 4);
+  websocket_flush(s);
   return 1;
 }
 /*---------------------------------------------------------------------------*/
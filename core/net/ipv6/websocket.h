@@ -60,6 +60,16 @@ typedef void (* websocket_callback)(struct websocket *s,
 #define WEBSOCKET_MAX_MSGLEN 200
 #endif /* WEBSOCKET_CONF_MAX_MSGLEN */
 
+/* Frames sent within this many clock ticks of the first queued one
+   are coalesced into as few TCP segments as possible, unless
+   websocket_flush() is called earlier. With 0, each frame is sent
+   right away. */
+#ifdef WEBSOCKET_CONF_COALESCE_TIME
+#define WEBSOCKET_COALESCE_TIME WEBSOCKET_CONF_COALESCE_TIME
+#else /* WEBSOCKET_CONF_COALESCE_TIME */
+#define WEBSOCKET_COALESCE_TIME 0
+#endif /* WEBSOCKET_CONF_COALESCE_TIME */
+
 struct websocket {
   struct websocket *next;     /* Must be first. */
   struct websocket_http_client_state s;
@@ -74,6 +84,9 @@ struct websocket {
   uint8_t headercacheptr;
   uint8_t headercache[10]; /* The maximum websocket header + mask is 6
                               + 4 bytes long */
+#if WEBSOCKET_COALESCE_TIME > 0
+  struct ctimer coalesce_timer;
+#endif /* WEBSOCKET_COALESCE_TIME > 0 */
 };
 
 enum {
@@ -104,6 +117,8 @@ int websocket_send(struct websocket *s,
 int websocket_send_str(struct websocket *s,
                        const char *strptr);
 
+void websocket_flush(struct websocket *s);
+
 void websocket_close(struct websocket *s);
 
 int websocket_ping(struct websocket *s);
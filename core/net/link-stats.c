@@ -53,10 +53,11 @@
 /* Statistics with no update in FRESHNESS_EXPIRATION_TIMEOUT is not fresh */
 #define FRESHNESS_EXPIRATION_TIME       (10 * 60 * (clock_time_t)CLOCK_SECOND)
 
-/* EWMA (exponential moving average) used to maintain statistics over time */
-#define EWMA_SCALE            100
-#define EWMA_ALPHA             15
-#define EWMA_BOOTSTRAP_ALPHA   30
+/* EWMA (exponential moving average) used to maintain statistics over time.
+ * The scale is a power of two so that scaling back down is a shift. */
+#define EWMA_SCALE            128
+#define EWMA_ALPHA             19
+#define EWMA_BOOTSTRAP_ALPHA   38
 
 /* ETX fixed point divisor. 128 is the value used by RPL (RFC 6551 and RFC 6719) */
 #define ETX_DIVISOR     LINK_STATS_ETX_DIVISOR
@@ -68,6 +69,11 @@
 /* Per-neighbor link statistics table */
 NBR_TABLE(struct link_stats, link_stats);
 
+#if LINK_STATS_WITH_CHANNELS
+/* Per-channel statistics */
+static struct link_stats_channel channel_stats[LINK_STATS_NUM_CHANNELS];
+#endif /* LINK_STATS_WITH_CHANNELS */
+
 /* Called every FRESHNESS_HALF_LIFE minutes */
 struct ctimer periodic_timer;
 
@@ -81,6 +87,12 @@ struct ctimer periodic_timer;
 #define LINK_STATS_INIT_ETX(stats) (ETX_INIT * ETX_DIVISOR)
 #endif /* LINK_STATS_INIT_ETX */
 
+#if LINK_STATS_COMPACT
+#define TX_TIMESTAMP()        ((uint16_t)clock_seconds())
+#else /* LINK_STATS_COMPACT */
+#define TX_TIMESTAMP()        clock_time()
+#endif /* LINK_STATS_COMPACT */
+
 /*---------------------------------------------------------------------------*/
 /* Returns the neighbor's link stats */
 const struct link_stats *
@@ -94,10 +106,24 @@ int
 link_stats_is_fresh(const struct link_stats *stats)
 {
   return (stats != NULL)
-      && clock_time() - stats->last_tx_time < FRESHNESS_EXPIRATION_TIME
+      && link_stats_tx_age(stats) < FRESHNESS_EXPIRATION_TIME
       && stats->freshness >= FRESHNESS_TARGET;
 }
 /*---------------------------------------------------------------------------*/
+/* Time elapsed since the last Tx to the neighbor */
+clock_time_t
+link_stats_tx_age(const struct link_stats *stats)
+{
+#if LINK_STATS_COMPACT
+  /* 16-bit seconds wrap after 18 hours, by which time periodic() has
+   * long aged the freshness counter to zero */
+  return (uint16_t)(TX_TIMESTAMP() - stats->last_tx_time)
+      * (clock_time_t)CLOCK_SECOND;
+#else /* LINK_STATS_COMPACT */
+  return clock_time() - stats->last_tx_time;
+#endif /* LINK_STATS_COMPACT */
+}
+/*---------------------------------------------------------------------------*/
 uint16_t
 guess_etx_from_rssi(const struct link_stats *stats)
 {
@@ -152,8 +178,15 @@ link_stats_packet_sent(const linkaddr_t *lladdr, int status, int numtx)
   }
 
   /* Update last timestamp and freshness */
-  stats->last_tx_time = clock_time();
+  stats->last_tx_time = TX_TIMESTAMP();
   stats->freshness = MIN(stats->freshness + numtx, FRESHNESS_MAX);
+  if(status == MAC_TX_NOACK) {
+    if(stats->failures < 0xff) {
+      stats->failures++;
+    }
+  } else {
+    stats->failures = 0;
+  }
 
   /* ETX used for this update */
   packet_etx = ((status == MAC_TX_NOACK) ? ETX_NOACK_PENALTY : numtx) * ETX_DIVISOR;
@@ -189,6 +222,80 @@ link_stats_input_callback(const linkaddr_t *lladdr)
       (int32_t)packet_rssi * EWMA_ALPHA) / EWMA_SCALE;
 }
 /*---------------------------------------------------------------------------*/
+void
+link_stats_restore(const linkaddr_t *lladdr, uint16_t etx, int16_t rssi)
+{
+  struct link_stats *stats;
+
+  if(nbr_table_get_from_lladdr(link_stats, lladdr) != NULL) {
+    return;
+  }
+  stats = nbr_table_add_lladdr(link_stats, lladdr, NBR_TABLE_REASON_LINK_STATS, NULL);
+  if(stats != NULL) {
+    stats->rssi = rssi;
+    stats->etx = etx;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if LINK_STATS_WITH_CHANNELS
+static struct link_stats_channel *
+get_channel_stats(uint8_t channel)
+{
+  if(channel < LINK_STATS_FIRST_CHANNEL
+     || channel >= LINK_STATS_FIRST_CHANNEL + LINK_STATS_NUM_CHANNELS) {
+    return NULL;
+  }
+  return &channel_stats[channel - LINK_STATS_FIRST_CHANNEL];
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the statistics of a channel */
+const struct link_stats_channel *
+link_stats_from_channel(uint8_t channel)
+{
+  return get_channel_stats(channel);
+}
+/*---------------------------------------------------------------------------*/
+/* Are the channel statistics fresh? */
+int
+link_stats_channel_is_fresh(const struct link_stats_channel *stats)
+{
+  return stats != NULL && stats->freshness >= FRESHNESS_TARGET;
+}
+/*---------------------------------------------------------------------------*/
+/* Updates the statistics of a channel for a number of transmission attempts */
+void
+link_stats_channel_packet_sent(uint8_t channel, int num_tx, int num_acked)
+{
+  struct link_stats_channel *stats = get_channel_stats(channel);
+  uint16_t packet_prr;
+  uint8_t ewma_alpha;
+  int i;
+
+  if(stats == NULL) {
+    return;
+  }
+  /* One EWMA update per attempt, acknowledged ones first */
+  for(i = 0; i < num_tx; i++) {
+    packet_prr = i < num_acked ? LINK_STATS_PRR_DIVISOR : 0;
+    ewma_alpha = link_stats_channel_is_fresh(stats) ? EWMA_ALPHA : EWMA_BOOTSTRAP_ALPHA;
+    stats->prr = ((uint32_t)stats->prr * (EWMA_SCALE - ewma_alpha) +
+        (uint32_t)packet_prr * ewma_alpha) / EWMA_SCALE;
+    stats->freshness = MIN(stats->freshness + 1, FRESHNESS_MAX);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Forgets everything about a channel */
+void
+link_stats_channel_reset(uint8_t channel)
+{
+  struct link_stats_channel *stats = get_channel_stats(channel);
+  if(stats != NULL) {
+    stats->prr = LINK_STATS_PRR_DIVISOR;
+    stats->freshness = 0;
+  }
+}
+#endif /* LINK_STATS_WITH_CHANNELS */
+/*---------------------------------------------------------------------------*/
 /* Periodic timer called every FRESHNESS_HALF_LIFE minutes */
 static void
 periodic(void *ptr)
@@ -199,6 +306,14 @@ periodic(void *ptr)
   for(stats = nbr_table_head(link_stats); stats != NULL; stats = nbr_table_next(link_stats, stats)) {
     stats->freshness >>= 1;
   }
+#if LINK_STATS_WITH_CHANNELS
+  {
+    int i;
+    for(i = 0; i < LINK_STATS_NUM_CHANNELS; i++) {
+      channel_stats[i].freshness >>= 1;
+    }
+  }
+#endif /* LINK_STATS_WITH_CHANNELS */
 }
 /*---------------------------------------------------------------------------*/
 /* Initializes link-stats module */
@@ -206,6 +321,14 @@ void
 link_stats_init(void)
 {
   nbr_table_register(link_stats, NULL);
+#if LINK_STATS_WITH_CHANNELS
+  {
+    int i;
+    for(i = 0; i < LINK_STATS_NUM_CHANNELS; i++) {
+      link_stats_channel_reset(LINK_STATS_FIRST_CHANNEL + i);
+    }
+  }
+#endif /* LINK_STATS_WITH_CHANNELS */
   ctimer_set(&periodic_timer, 60 * (clock_time_t)CLOCK_SECOND * FRESHNESS_HALF_LIFE,
       periodic, NULL);
 }
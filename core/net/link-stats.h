@@ -42,18 +42,69 @@
 #define LINK_STATS_ETX_DIVISOR              128
 #endif /* LINK_STATS_CONF_ETX_DIVISOR */
 
+/* Store the statistics in a compact layout, for nodes that keep many
+ * neighbors. The last Tx timestamp is then kept in seconds. */
+#ifdef LINK_STATS_CONF_COMPACT
+#define LINK_STATS_COMPACT                  LINK_STATS_CONF_COMPACT
+#else /* LINK_STATS_CONF_COMPACT */
+#define LINK_STATS_COMPACT                  0
+#endif /* LINK_STATS_CONF_COMPACT */
+
+/* Also keep statistics per radio channel, aggregated over all neighbors,
+ * e.g. to detect channels with consistent interference */
+#ifdef LINK_STATS_CONF_WITH_CHANNELS
+#define LINK_STATS_WITH_CHANNELS            LINK_STATS_CONF_WITH_CHANNELS
+#else /* LINK_STATS_CONF_WITH_CHANNELS */
+#define LINK_STATS_WITH_CHANNELS            0
+#endif /* LINK_STATS_CONF_WITH_CHANNELS */
+
+/* The range of channels with statistics. Default: IEEE 802.15.4 2.4 GHz */
+#ifdef LINK_STATS_CONF_FIRST_CHANNEL
+#define LINK_STATS_FIRST_CHANNEL            LINK_STATS_CONF_FIRST_CHANNEL
+#else /* LINK_STATS_CONF_FIRST_CHANNEL */
+#define LINK_STATS_FIRST_CHANNEL            11
+#endif /* LINK_STATS_CONF_FIRST_CHANNEL */
+
+#ifdef LINK_STATS_CONF_NUM_CHANNELS
+#define LINK_STATS_NUM_CHANNELS             LINK_STATS_CONF_NUM_CHANNELS
+#else /* LINK_STATS_CONF_NUM_CHANNELS */
+#define LINK_STATS_NUM_CHANNELS             16
+#endif /* LINK_STATS_CONF_NUM_CHANNELS */
+
+/* PRR fixed point divisor */
+#define LINK_STATS_PRR_DIVISOR              1024
+
 /* All statistics of a given link */
+#if LINK_STATS_COMPACT
+struct link_stats {
+  uint16_t etx;               /* ETX using ETX_DIVISOR as fixed point divisor */
+  uint16_t last_tx_time;      /* Last Tx timestamp, in seconds */
+  int8_t rssi;                /* RSSI (received signal strength) */
+  uint8_t freshness;          /* Freshness of the statistics */
+  uint8_t failures;           /* Packets lost in a row */
+};
+#else /* LINK_STATS_COMPACT */
 struct link_stats {
   uint16_t etx;               /* ETX using ETX_DIVISOR as fixed point divisor */
   int16_t rssi;               /* RSSI (received signal strength) */
   uint8_t freshness;          /* Freshness of the statistics */
+  uint8_t failures;           /* Packets lost in a row */
   clock_time_t last_tx_time;  /* Last Tx timestamp */
 };
+#endif /* LINK_STATS_COMPACT */
+
+/* Statistics of a given channel */
+struct link_stats_channel {
+  uint16_t prr;               /* Ratio of acknowledged transmissions, using PRR_DIVISOR */
+  uint8_t freshness;          /* Freshness of the statistics */
+};
 
 /* Returns the neighbor's link statistics */
 const struct link_stats *link_stats_from_lladdr(const linkaddr_t *lladdr);
 /* Are the statistics fresh? */
 int link_stats_is_fresh(const struct link_stats *stats);
+/* Time elapsed since the last Tx to the neighbor */
+clock_time_t link_stats_tx_age(const struct link_stats *stats);
 
 /* Initializes link-stats module */
 void link_stats_init(void);
@@ -61,5 +112,20 @@ void link_stats_init(void);
 void link_stats_packet_sent(const linkaddr_t *lladdr, int status, int numtx);
 /* Packet input callback. Updates statistics for receptions on a given link */
 void link_stats_input_callback(const linkaddr_t *lladdr);
+/* Sets the ETX and RSSI of a neighbor we have no statistics for, e.g.
+ * from before a reboot. The statistics are not fresh. */
+void link_stats_restore(const linkaddr_t *lladdr, uint16_t etx, int16_t rssi);
+
+#if LINK_STATS_WITH_CHANNELS
+/* Returns the statistics of a channel, NULL if out of range */
+const struct link_stats_channel *link_stats_from_channel(uint8_t channel);
+/* Are the channel statistics fresh? */
+int link_stats_channel_is_fresh(const struct link_stats_channel *stats);
+/* Updates the statistics of a channel for num_tx transmission attempts,
+ * num_acked of which were acknowledged */
+void link_stats_channel_packet_sent(uint8_t channel, int num_tx, int num_acked);
+/* Forgets everything about a channel */
+void link_stats_channel_reset(uint8_t channel);
+#endif /* LINK_STATS_WITH_CHANNELS */
 
 #endif /* LINK_STATS_H_ */
@@ -82,8 +82,44 @@ anti_replay_init_info(struct anti_replay_info *info)
   info->last_broadcast_counter
       = info->last_unicast_counter
       = anti_replay_get_counter();
+#if ANTI_REPLAY_WINDOW
+  info->broadcast_window = info->unicast_window = 1;
+#endif /* ANTI_REPLAY_WINDOW */
 }
 /*---------------------------------------------------------------------------*/
+#if ANTI_REPLAY_WINDOW
+static int
+was_replayed(uint32_t *last, uint32_t *window, uint32_t received_counter)
+{
+  uint32_t diff;
+
+  if(received_counter > *last) {
+    diff = received_counter - *last;
+    *window = diff >= ANTI_REPLAY_WINDOW ? 0 : *window << diff;
+    *window |= 1;
+    *last = received_counter;
+    return 0;
+  }
+
+  diff = *last - received_counter;
+  if(diff >= ANTI_REPLAY_WINDOW || (*window & ((uint32_t)1 << diff))) {
+    return 1;
+  }
+  *window |= (uint32_t)1 << diff;
+  return 0;
+}
+#else /* ANTI_REPLAY_WINDOW */
+static int
+was_replayed(uint32_t *last, uint32_t received_counter)
+{
+  if(received_counter <= *last) {
+    return 1;
+  }
+  *last = received_counter;
+  return 0;
+}
+#endif /* ANTI_REPLAY_WINDOW */
+/*---------------------------------------------------------------------------*/
 int
 anti_replay_was_replayed(struct anti_replay_info *info)
 {
@@ -93,20 +129,20 @@ anti_replay_was_replayed(struct anti_replay_info *info)
   
   if(packetbuf_holds_broadcast()) {
     /* broadcast */
-    if(received_counter <= info->last_broadcast_counter) {
-      return 1;
-    } else {
-      info->last_broadcast_counter = received_counter;
-      return 0;
-    }
+#if ANTI_REPLAY_WINDOW
+    return was_replayed(&info->last_broadcast_counter,
+        &info->broadcast_window, received_counter);
+#else /* ANTI_REPLAY_WINDOW */
+    return was_replayed(&info->last_broadcast_counter, received_counter);
+#endif /* ANTI_REPLAY_WINDOW */
   } else {
     /* unicast */
-    if(received_counter <= info->last_unicast_counter) {
-      return 1;
-    } else {
-      info->last_unicast_counter = received_counter;
-      return 0;
-    }
+#if ANTI_REPLAY_WINDOW
+    return was_replayed(&info->last_unicast_counter,
+        &info->unicast_window, received_counter);
+#else /* ANTI_REPLAY_WINDOW */
+    return was_replayed(&info->last_unicast_counter, received_counter);
+#endif /* ANTI_REPLAY_WINDOW */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -47,9 +47,30 @@
 
 #include "contiki.h"
 
+/*
+ * Size of the anti-replay window in frame counters. With a window of N,
+ * frames whose counter is up to N - 1 below the highest counter seen are
+ * still accepted, once, so that reordered frames are not dropped. 0 only
+ * accepts strictly increasing counters.
+ */
+#ifdef ANTI_REPLAY_CONF_WINDOW
+#define ANTI_REPLAY_WINDOW ANTI_REPLAY_CONF_WINDOW
+#else /* ANTI_REPLAY_CONF_WINDOW */
+#define ANTI_REPLAY_WINDOW 0
+#endif /* ANTI_REPLAY_CONF_WINDOW */
+
+#if ANTI_REPLAY_WINDOW > 32
+#error "ANTI_REPLAY_WINDOW must not exceed 32"
+#endif
+
 struct anti_replay_info {
   uint32_t last_broadcast_counter;
   uint32_t last_unicast_counter;
+#if ANTI_REPLAY_WINDOW
+  /* bit i is set if last_*_counter - i was received */
+  uint32_t broadcast_window;
+  uint32_t unicast_window;
+#endif /* ANTI_REPLAY_WINDOW */
 };
 
 /**
@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Establishment of pairwise link-layer keys with ECDH on P-256.
+ *
+ *         The shared key with a neighbor is the first
+ *         PAIRWISE_KEYS_KEY_LEN bytes of the SHA-256 hash of the
+ *         x-coordinate of the shared point, big-endian. Point
+ *         multiplications are done one at a time by the ECDH_P256
+ *         driver, in the pairwise keys process.
+ */
+
+/**
+ * \addtogroup llsec802154
+ * @{
+ */
+
+#include "net/llsec/pairwise-keys.h"
+#include "net/nbr-table.h"
+#include "lib/ecdh-p256.h"
+#include "lib/sha-256.h"
+#include "lib/memb.h"
+#include "lib/list.h"
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+struct pairwise_key {
+  uint8_t key[PAIRWISE_KEYS_KEY_LEN];
+};
+
+struct request {
+  struct request *next;
+  linkaddr_t neighbor;
+  uint32_t x[ECDH_P256_WORDS];
+  uint32_t y[ECDH_P256_WORDS];
+  pairwise_keys_callback_t callback;
+};
+
+NBR_TABLE(struct pairwise_key, pairwise_keys);
+MEMB(requests_memb, struct request, PAIRWISE_KEYS_QUEUE_SIZE);
+LIST(requests);
+
+static struct ecdh_p256_state state;
+static uint32_t private_key[ECDH_P256_WORDS];
+static uint32_t public_x[ECDH_P256_WORDS];
+static uint32_t public_y[ECDH_P256_WORDS];
+static uint8_t ready;
+static uint8_t failed;
+
+PROCESS(pairwise_keys_process, "Pairwise keys");
+/*---------------------------------------------------------------------------*/
+static void
+words_to_bytes(uint8_t *bytes, const uint32_t *words)
+{
+  int i;
+
+  for(i = 0; i < ECDH_P256_WORDS; i++) {
+    uint32_t w = words[ECDH_P256_WORDS - 1 - i];
+    bytes[4 * i] = w >> 24;
+    bytes[4 * i + 1] = w >> 16;
+    bytes[4 * i + 2] = w >> 8;
+    bytes[4 * i + 3] = w;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+bytes_to_words(uint32_t *words, const uint8_t *bytes)
+{
+  int i;
+
+  for(i = 0; i < ECDH_P256_WORDS; i++) {
+    words[ECDH_P256_WORDS - 1 - i] = ((uint32_t)bytes[4 * i] << 24)
+      | ((uint32_t)bytes[4 * i + 1] << 16)
+      | ((uint32_t)bytes[4 * i + 2] << 8)
+      | bytes[4 * i + 3];
+  }
+}
+/*---------------------------------------------------------------------------*/
+#ifdef PAIRWISE_KEYS_RANDOM_BYTES
+int PAIRWISE_KEYS_RANDOM_BYTES(uint8_t *buf, unsigned len);
+#endif /* PAIRWISE_KEYS_RANDOM_BYTES */
+
+static int
+generate_private_key(void)
+{
+#ifdef PAIRWISE_KEYS_RANDOM_BYTES
+  uint8_t buf[ECDH_P256_WORDS * 4];
+
+  do {
+    if(!PAIRWISE_KEYS_RANDOM_BYTES(buf, sizeof(buf))) {
+      memset(buf, 0, sizeof(buf));
+      return 0;
+    }
+    bytes_to_words(private_key, buf);
+  } while(!ecdh_p256_is_valid_scalar(private_key));
+  memset(buf, 0, sizeof(buf));
+  return 1;
+#else /* PAIRWISE_KEYS_RANDOM_BYTES */
+  /* random_rand() is predictable, so it must not be used for keys */
+  return 0;
+#endif /* PAIRWISE_KEYS_RANDOM_BYTES */
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_key(const linkaddr_t *neighbor, const uint32_t *x)
+{
+  uint8_t buf[SHA_256_DIGEST_LENGTH];
+  struct pairwise_key *k;
+
+  k = nbr_table_get_from_lladdr(pairwise_keys, neighbor);
+  if(k == NULL) {
+    k = nbr_table_add_lladdr(pairwise_keys, neighbor,
+                             NBR_TABLE_REASON_LLSEC, NULL);
+  }
+  if(k != NULL) {
+    words_to_bytes(buf, x);
+    sha_256_hash(buf, ECDH_P256_WORDS * 4, buf);
+    memcpy(k->key, buf, PAIRWISE_KEYS_KEY_LEN);
+  }
+  memset(buf, 0, sizeof(buf));
+}
+/*---------------------------------------------------------------------------*/
+static void
+fail_requests(void)
+{
+  struct request *r;
+  linkaddr_t neighbor;
+  pairwise_keys_callback_t callback;
+
+  failed = 1;
+  memset(private_key, 0, sizeof(private_key));
+  while((r = list_pop(requests)) != NULL) {
+    linkaddr_copy(&neighbor, &r->neighbor);
+    callback = r->callback;
+    memb_free(&requests_memb, r);
+    if(callback != NULL) {
+      callback(&neighbor, 0);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(pairwise_keys_process, ev, data)
+{
+  static struct request *r;
+  linkaddr_t neighbor;
+  pairwise_keys_callback_t callback;
+  int success;
+
+  PROCESS_BEGIN();
+
+  if(!generate_private_key()) {
+    PRINTF("pairwise-keys: no secure random source, no key pair\n");
+    fail_requests();
+    PROCESS_EXIT();
+  }
+  state.process = &pairwise_keys_process;
+  memcpy(state.scalar, private_key, sizeof(state.scalar));
+  memcpy(state.x, ecdh_p256_gx, sizeof(state.x));
+  memcpy(state.y, ecdh_p256_gy, sizeof(state.y));
+  PROCESS_PT_SPAWN(&state.pt, ECDH_P256.multiply(&state));
+  if(state.result != ECDH_P256_OK) {
+    PRINTF("pairwise-keys: could not generate the public key\n");
+    fail_requests();
+    PROCESS_EXIT();
+  }
+  memcpy(public_x, state.x, sizeof(public_x));
+  memcpy(public_y, state.y, sizeof(public_y));
+  ready = 1;
+  PRINTF("pairwise-keys: public key ready\n");
+
+  while(1) {
+    PROCESS_WAIT_UNTIL(list_head(requests) != NULL);
+    r = list_head(requests);
+
+    memcpy(state.scalar, private_key, sizeof(state.scalar));
+    memcpy(state.x, r->x, sizeof(state.x));
+    memcpy(state.y, r->y, sizeof(state.y));
+    PROCESS_PT_SPAWN(&state.pt, ECDH_P256.multiply(&state));
+
+    success = state.result == ECDH_P256_OK;
+    if(success) {
+      store_key(&r->neighbor, state.x);
+    }
+    memset(state.x, 0, sizeof(state.x));
+    memset(state.y, 0, sizeof(state.y));
+    PRINTF("pairwise-keys: key with %u %s\n",
+           r->neighbor.u8[LINKADDR_SIZE - 1], success ? "established" : "failed");
+
+    /* Free the slot first so that the callback can queue another request */
+    linkaddr_copy(&neighbor, &r->neighbor);
+    callback = r->callback;
+    list_remove(requests, r);
+    memb_free(&requests_memb, r);
+    if(callback != NULL) {
+      callback(&neighbor, success && pairwise_keys_get(&neighbor) != NULL);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+pairwise_keys_init(void)
+{
+  nbr_table_register(pairwise_keys, NULL);
+  memb_init(&requests_memb);
+  list_init(requests);
+  ready = 0;
+  failed = 0;
+  process_start(&pairwise_keys_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+int
+pairwise_keys_get_public_key(uint8_t *public_key)
+{
+  if(!ready) {
+    return 0;
+  }
+  words_to_bytes(public_key, public_x);
+  words_to_bytes(public_key + ECDH_P256_WORDS * 4, public_y);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+pairwise_keys_establish(const linkaddr_t *neighbor,
+                        const uint8_t *public_key,
+                        pairwise_keys_callback_t callback)
+{
+  struct request *r;
+
+  if(failed) {
+    return 0;
+  }
+  r = memb_alloc(&requests_memb);
+  if(r == NULL) {
+    return 0;
+  }
+  bytes_to_words(r->x, public_key);
+  bytes_to_words(r->y, public_key + ECDH_P256_WORDS * 4);
+  if(!ecdh_p256_is_on_curve(r->x, r->y)) {
+    memb_free(&requests_memb, r);
+    return 0;
+  }
+  linkaddr_copy(&r->neighbor, neighbor);
+  r->callback = callback;
+  list_add(requests, r);
+  process_poll(&pairwise_keys_process);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+const uint8_t *
+pairwise_keys_get(const linkaddr_t *neighbor)
+{
+  struct pairwise_key *k;
+
+  k = nbr_table_get_from_lladdr(pairwise_keys, neighbor);
+  return k != NULL ? k->key : NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+pairwise_keys_remove(const linkaddr_t *neighbor)
+{
+  struct pairwise_key *k;
+
+  k = nbr_table_get_from_lladdr(pairwise_keys, neighbor);
+  if(k != NULL) {
+    memset(k->key, 0, sizeof(k->key));
+    nbr_table_remove(pairwise_keys, k);
+  }
+}
+/*---------------------------------------------------------------------------*/
+
+/** @} */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Establishment of pairwise link-layer keys with ECDH on P-256.
+ */
+
+/**
+ * \addtogroup llsec802154
+ * @{
+ */
+
+#ifndef PAIRWISE_KEYS_H_
+#define PAIRWISE_KEYS_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+/* Number of key establishments that can wait for the ECC engine */
+#ifdef PAIRWISE_KEYS_CONF_QUEUE_SIZE
+#define PAIRWISE_KEYS_QUEUE_SIZE PAIRWISE_KEYS_CONF_QUEUE_SIZE
+#else /* PAIRWISE_KEYS_CONF_QUEUE_SIZE */
+#define PAIRWISE_KEYS_QUEUE_SIZE 2
+#endif /* PAIRWISE_KEYS_CONF_QUEUE_SIZE */
+
+/*
+ * int f(uint8_t *buf, unsigned len) that fills buf from a CSPRNG or a
+ * hardware TRNG and returns nonzero on success. Without one, no key pair
+ * is generated and key establishment fails.
+ */
+#ifdef PAIRWISE_KEYS_CONF_RANDOM_BYTES
+#define PAIRWISE_KEYS_RANDOM_BYTES PAIRWISE_KEYS_CONF_RANDOM_BYTES
+#endif /* PAIRWISE_KEYS_CONF_RANDOM_BYTES */
+
+/* Public keys are x || y, both big-endian */
+#define PAIRWISE_KEYS_PUBLIC_KEY_LEN 64
+#define PAIRWISE_KEYS_KEY_LEN        16
+
+typedef void (* pairwise_keys_callback_t)(const linkaddr_t *neighbor,
+                                          int success);
+
+/**
+ * \brief Starts generating the key pair of this node
+ */
+void pairwise_keys_init(void);
+
+/**
+ * \brief      Copies the public key of this node to public_key.
+ * \retval 0   The key pair is not generated yet
+ * \retval 1   Done
+ */
+int pairwise_keys_get_public_key(uint8_t *public_key);
+
+/**
+ * \brief      Derives the key shared with a neighbor from its public key.
+ *             callback is called once the key is available through
+ *             pairwise_keys_get(), or when it could not be established.
+ * \retval 0   The request could not be queued
+ * \retval 1   The request was queued
+ */
+int pairwise_keys_establish(const linkaddr_t *neighbor,
+                            const uint8_t *public_key,
+                            pairwise_keys_callback_t callback);
+
+/**
+ * \brief  Returns the PAIRWISE_KEYS_KEY_LEN bytes of the key shared with
+ *         neighbor, or NULL if there is none.
+ */
+const uint8_t *pairwise_keys_get(const linkaddr_t *neighbor);
+
+/**
+ * \brief  Forgets the key shared with neighbor.
+ */
+void pairwise_keys_remove(const linkaddr_t *neighbor);
+
+#endif /* PAIRWISE_KEYS_H_ */
+
+/** @} */
@@ -49,6 +49,7 @@
 #include "net/netstack.h"
 #include "net/rime/rime.h"
 #include "sys/compower.h"
+#include "sys/energest.h"
 #include "sys/pt.h"
 #include "sys/rtimer.h"
 
@@ -836,7 +837,11 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 static void
 qsend_packet(mac_callback_t sent, void *ptr)
 {
-  int ret = send_packet(sent, ptr, NULL, 0);
+  int ret;
+
+  ENERGEST_SET_CLASS(packetbuf_attr(PACKETBUF_ATTR_ENERGEST_CLASS));
+  ret = send_packet(sent, ptr, NULL, 0);
+  ENERGEST_SET_CLASS(ENERGEST_CLASS_OTHER);
   if(ret != MAC_TX_DEFERRED) {
     mac_call_sent_callback(sent, ptr, ret, 1);
   }
@@ -863,6 +868,18 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     return;
   }
 
+#if WITH_PHASE_OPTIMIZATION
+  /* If the receiver wakes up later, wait for it before creating the
+     frames: packets queued for it in the meantime then join the burst
+     and get sent in the same wake-up. */
+  queuebuf_to_packetbuf(buf_list->buf);
+  if(!packetbuf_holds_broadcast() &&
+     phase_defer(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                 CYCLE_TIME, GUARD_TIME, sent, ptr, buf_list) == PHASE_DEFERRED) {
+    return;
+  }
+#endif /* WITH_PHASE_OPTIMIZATION */
+
   /* Create and secure frames in advance */
   curr = buf_list;
   do {
@@ -902,7 +919,9 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     pending = packetbuf_attr(PACKETBUF_ATTR_PENDING);
 
     /* Send the current packet */
+    ENERGEST_SET_CLASS(packetbuf_attr(PACKETBUF_ATTR_ENERGEST_CLASS));
     ret = send_packet(sent, ptr, curr, is_receiver_awake);
+    ENERGEST_SET_CLASS(ENERGEST_CLASS_OTHER);
     if(ret != MAC_TX_DEFERRED) {
       mac_call_sent_callback(sent, ptr, ret, 1);
     }
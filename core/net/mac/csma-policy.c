@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Per-link retransmission policy for CSMA, from link-stats
+ */
+
+#include "contiki.h"
+#include "net/mac/csma-policy.h"
+#include "net/link-stats.h"
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl.h"
+#endif /* UIP_CONF_IPV6_RPL */
+
+#ifndef CSMA_POLICY_IS_CRITICAL
+#if UIP_CONF_IPV6_RPL
+#define CSMA_POLICY_IS_CRITICAL(addr) is_only_parent(addr)
+/*---------------------------------------------------------------------------*/
+/* Is addr our preferred parent, with no other parent to switch to? */
+static int
+is_only_parent(const linkaddr_t *addr)
+{
+  rpl_dag_t *dag;
+  rpl_parent_t *p;
+  const linkaddr_t *lladdr;
+
+  dag = rpl_get_any_dag();
+  if(dag == NULL || dag->preferred_parent == NULL) {
+    return 0;
+  }
+  lladdr = rpl_get_parent_lladdr(dag->preferred_parent);
+  if(lladdr == NULL || !linkaddr_cmp(lladdr, addr)) {
+    return 0;
+  }
+  for(p = nbr_table_head(rpl_parents); p != NULL;
+      p = nbr_table_next(rpl_parents, p)) {
+    if(p != dag->preferred_parent && p->dag == dag &&
+       rpl_parent_is_reachable(p)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+#else /* UIP_CONF_IPV6_RPL */
+#define CSMA_POLICY_IS_CRITICAL(addr) 0
+#endif /* UIP_CONF_IPV6_RPL */
+#endif /* CSMA_POLICY_IS_CRITICAL */
+/*---------------------------------------------------------------------------*/
+int
+csma_policy_max_transmissions(const linkaddr_t *addr, int transmissions)
+{
+  const struct link_stats *stats;
+  int etx_transmissions;
+
+  if(CSMA_POLICY_IS_CRITICAL(addr)) {
+    /* There is no other way to go, keep trying */
+    return MAX(transmissions, CSMA_POLICY_CRITICAL_TRANSMISSIONS);
+  }
+
+  stats = link_stats_from_lladdr(addr);
+  if(stats == NULL) {
+    /* A new link, nothing is known about it yet */
+    return transmissions;
+  }
+
+  if(stats->failures >= CSMA_POLICY_BAD_FAILURES ||
+     (link_stats_is_fresh(stats) && stats->etx >= CSMA_POLICY_BAD_ETX)) {
+    /* Give up early, so that the loss shows in the link statistics
+       and the routing layer picks another link */
+    return MIN(transmissions, CSMA_POLICY_MIN_TRANSMISSIONS);
+  }
+
+  if(!link_stats_is_fresh(stats)) {
+    return transmissions;
+  }
+
+  /* Allow three times the expected number of transmissions, enough
+     for a good link to get through a short burst of interference */
+  etx_transmissions = 3 * ((stats->etx + LINK_STATS_ETX_DIVISOR - 1)
+                           / LINK_STATS_ETX_DIVISOR);
+  return MAX(MIN(transmissions, etx_transmissions),
+             MIN(transmissions, CSMA_POLICY_MIN_TRANSMISSIONS));
+}
+/*---------------------------------------------------------------------------*/
+int
+csma_policy_backoff_exponent(const linkaddr_t *addr, int transmissions,
+                             int backoff_exponent)
+{
+  const struct link_stats *stats;
+
+  if(transmissions == 0) {
+    return backoff_exponent;
+  }
+
+  stats = link_stats_from_lladdr(addr);
+  if(stats != NULL && link_stats_is_fresh(stats)
+     && stats->etx >= CSMA_POLICY_LOSSY_ETX) {
+    /* Frames are lost in bursts on this link. Wait longer after each
+       failed transmission, rather than retrying into the same burst. */
+    return MAX(backoff_exponent, transmissions);
+  }
+  return backoff_exponent;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Per-link retransmission policy for CSMA. It chooses how many
+ *         times a unicast frame is transmitted and how far apart the
+ *         retransmissions are, from the link statistics of the receiver.
+ */
+
+#ifndef CSMA_POLICY_H_
+#define CSMA_POLICY_H_
+
+#include "contiki-conf.h"
+#include "net/linkaddr.h"
+#include "net/link-stats.h"
+
+/* Transmissions of a frame on a link that is known to be bad, so that
+   the routing layer learns about the loss quickly */
+#ifdef CSMA_POLICY_CONF_MIN_TRANSMISSIONS
+#define CSMA_POLICY_MIN_TRANSMISSIONS CSMA_POLICY_CONF_MIN_TRANSMISSIONS
+#else /* CSMA_POLICY_CONF_MIN_TRANSMISSIONS */
+#define CSMA_POLICY_MIN_TRANSMISSIONS 2
+#endif /* CSMA_POLICY_CONF_MIN_TRANSMISSIONS */
+
+/* Transmissions of a frame on a link that the node cannot route
+   around, i.e. to its only parent */
+#ifdef CSMA_POLICY_CONF_CRITICAL_TRANSMISSIONS
+#define CSMA_POLICY_CRITICAL_TRANSMISSIONS CSMA_POLICY_CONF_CRITICAL_TRANSMISSIONS
+#else /* CSMA_POLICY_CONF_CRITICAL_TRANSMISSIONS */
+#define CSMA_POLICY_CRITICAL_TRANSMISSIONS 12
+#endif /* CSMA_POLICY_CONF_CRITICAL_TRANSMISSIONS */
+
+/* A link is bad when its ETX is this or more, using
+   LINK_STATS_ETX_DIVISOR as fixed point divisor... */
+#ifdef CSMA_POLICY_CONF_BAD_ETX
+#define CSMA_POLICY_BAD_ETX CSMA_POLICY_CONF_BAD_ETX
+#else /* CSMA_POLICY_CONF_BAD_ETX */
+#define CSMA_POLICY_BAD_ETX (4 * LINK_STATS_ETX_DIVISOR)
+#endif /* CSMA_POLICY_CONF_BAD_ETX */
+
+/* ...or when this many packets in a row were lost on it */
+#ifdef CSMA_POLICY_CONF_BAD_FAILURES
+#define CSMA_POLICY_BAD_FAILURES CSMA_POLICY_CONF_BAD_FAILURES
+#else /* CSMA_POLICY_CONF_BAD_FAILURES */
+#define CSMA_POLICY_BAD_FAILURES 2
+#endif /* CSMA_POLICY_CONF_BAD_FAILURES */
+
+/* Links with this ETX or more have their retransmissions spread out
+   with an exponential backoff, as losses on them tend to come in bursts */
+#ifdef CSMA_POLICY_CONF_LOSSY_ETX
+#define CSMA_POLICY_LOSSY_ETX CSMA_POLICY_CONF_LOSSY_ETX
+#else /* CSMA_POLICY_CONF_LOSSY_ETX */
+#define CSMA_POLICY_LOSSY_ETX (2 * LINK_STATS_ETX_DIVISOR)
+#endif /* CSMA_POLICY_CONF_LOSSY_ETX */
+
+/* Tells whether the link to a neighbor is one the node depends on.
+   Defaults to the preferred RPL parent when it is the only reachable
+   parent, and to no link without RPL. */
+#ifdef CSMA_POLICY_CONF_IS_CRITICAL
+#define CSMA_POLICY_IS_CRITICAL(addr) CSMA_POLICY_CONF_IS_CRITICAL(addr)
+int CSMA_POLICY_CONF_IS_CRITICAL(const linkaddr_t *addr);
+#endif /* CSMA_POLICY_CONF_IS_CRITICAL */
+
+/* Returns the number of times to transmit a frame to addr, given the
+   number the MAC layer is configured with */
+int csma_policy_max_transmissions(const linkaddr_t *addr, int transmissions);
+
+/* Returns the backoff exponent to use before retransmission number
+   transmissions of a frame to addr, given the one from the collision
+   count */
+int csma_policy_backoff_exponent(const linkaddr_t *addr, int transmissions,
+                                 int backoff_exponent);
+
+#endif /* CSMA_POLICY_H_ */
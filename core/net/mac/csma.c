@@ -38,8 +38,10 @@
  */
 
 #include "net/mac/csma.h"
+#include "net/mac/csma-policy.h"
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
+#include "net/pkttrace.h"
 
 #include "sys/ctimer.h"
 #include "sys/clock.h"
@@ -47,6 +49,7 @@
 #include "lib/random.h"
 
 #include "net/netstack.h"
+#include "net/nbr-table.h"
 
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -93,6 +96,14 @@
 #define CSMA_MAX_MAX_FRAME_RETRIES 7
 #endif
 
+/* Adapt the number of transmissions and the backoff of unicast frames
+   to the link statistics of the receiver, see csma-policy.h */
+#ifdef CSMA_CONF_WITH_POLICY
+#define CSMA_WITH_POLICY CSMA_CONF_WITH_POLICY
+#else /* CSMA_CONF_WITH_POLICY */
+#define CSMA_WITH_POLICY 0
+#endif /* CSMA_CONF_WITH_POLICY */
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
@@ -100,17 +111,20 @@ struct qbuf_metadata {
   uint8_t max_transmissions;
 };
 
-/* Every neighbor has its own packet queue */
+/* Every neighbor has its own packet queue. The queues are kept in a
+   neighbor table, and in a small pool for neighbors that the neighbor
+   table has no room for. Broadcasts have a queue of their own. */
 struct neighbor_queue {
   struct neighbor_queue *next;
   linkaddr_t addr;
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions;
+  uint8_t in_table;
   LIST_STRUCT(queued_packet_list);
 };
 
-/* The maximum number of co-existing neighbor queues */
+/* The number of neighbor queues kept outside the neighbor table */
 #ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
 #define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
 #else
@@ -125,10 +139,14 @@ struct neighbor_queue {
 #endif /* CSMA_CONF_MAX_PACKET_PER_NEIGHBOR */
 
 #define MAX_QUEUED_PACKETS QUEUEBUF_NUM
+NBR_TABLE(struct neighbor_queue, neighbor_queues);
 MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
+static struct neighbor_queue broadcast_queue;
+/* The number of queues that hold packets */
+static uint8_t active_queues;
 
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
@@ -136,16 +154,94 @@ static void transmit_packet_list(void *ptr);
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
-  struct neighbor_queue *n = list_head(neighbor_list);
-  while(n != NULL) {
+  struct neighbor_queue *n;
+
+  if(linkaddr_cmp(addr, &linkaddr_null)) {
+    return &broadcast_queue;
+  }
+  n = nbr_table_get_from_lladdr(neighbor_queues, addr);
+  if(n != NULL) {
+    return n;
+  }
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
     if(linkaddr_cmp(&n->addr, addr)) {
       return n;
     }
-    n = list_item_next(n);
   }
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+neighbor_queue_add(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n;
+
+  n = nbr_table_add_lladdr(neighbor_queues, addr, NBR_TABLE_REASON_MAC, NULL);
+  if(n != NULL) {
+    /* Keep the entry while it holds packets */
+    nbr_table_lock(neighbor_queues, n);
+    n->in_table = 1;
+  } else {
+    n = memb_alloc(&neighbor_memb);
+    if(n == NULL) {
+      return NULL;
+    }
+    n->in_table = 0;
+    list_add(neighbor_list, n);
+  }
+  linkaddr_copy(&n->addr, addr);
+  LIST_STRUCT_INIT(n, queued_packet_list);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_queue_remove(struct neighbor_queue *n)
+{
+  ctimer_stop(&n->transmit_timer);
+  if(n == &broadcast_queue) {
+    return;
+  }
+  if(n->in_table) {
+    nbr_table_remove(neighbor_queues, n);
+  } else {
+    list_remove(neighbor_list, n);
+    memb_free(&neighbor_memb, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Finds the queue that holds the most packets, if it holds more than
+   min. Called when all packets are queued, so that a neighbor with a
+   long queue can be made to give up a packet to one with a short one. */
+static struct neighbor_queue *
+longest_queue(int min)
+{
+  struct neighbor_queue *n;
+  struct neighbor_queue *longest = NULL;
+  int len;
+
+  len = list_length(broadcast_queue.queued_packet_list);
+  if(len > min) {
+    longest = &broadcast_queue;
+    min = len;
+  }
+  for(n = nbr_table_head(neighbor_queues); n != NULL;
+      n = nbr_table_next(neighbor_queues, n)) {
+    len = list_length(n->queued_packet_list);
+    if(len > min) {
+      longest = n;
+      min = len;
+    }
+  }
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    len = list_length(n->queued_packet_list);
+    if(len > min) {
+      longest = n;
+      min = len;
+    }
+  }
+  return longest;
+}
+/*---------------------------------------------------------------------------*/
 static clock_time_t
 backoff_period(void)
 {
@@ -179,12 +275,20 @@ transmit_packet_list(void *ptr)
 }
 /*---------------------------------------------------------------------------*/
 static void
-schedule_transmission(struct neighbor_queue *n)
+schedule_transmission(struct neighbor_queue *n, int yield)
 {
   clock_time_t delay;
   int backoff_exponent; /* BE in IEEE 802.15.4 */
 
-  backoff_exponent = MIN(n->collisions, CSMA_MAX_BE);
+  backoff_exponent = n->collisions;
+#if CSMA_WITH_POLICY
+  if(n != &broadcast_queue) {
+    backoff_exponent = csma_policy_backoff_exponent(&n->addr,
+                                                    n->transmissions,
+                                                    backoff_exponent);
+  }
+#endif /* CSMA_WITH_POLICY */
+  backoff_exponent = MIN(backoff_exponent, CSMA_MAX_BE);
 
   /* Compute max delay as per IEEE 802.15.4: 2^BE-1 backoff periods  */
   delay = ((1 << backoff_exponent) - 1) * backoff_period();
@@ -192,6 +296,10 @@ schedule_transmission(struct neighbor_queue *n)
     /* Pick a time for next transmission */
     delay = random_rand() % delay;
   }
+  if(yield) {
+    /* Let the other neighbors that are waiting send first */
+    delay += backoff_period();
+  }
 
   PRINTF("csma: scheduling transmission in %u ticks, NB=%u, BE=%u\n",
       (unsigned)delay, n->collisions, backoff_exponent);
@@ -214,13 +322,13 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p, int status)
       /* There is a next packet. We reset current tx information */
       n->transmissions = 0;
       n->collisions = CSMA_MIN_BE;
-      /* Schedule next transmissions */
-      schedule_transmission(n);
+      /* Schedule next transmissions, taking turns with the other
+         neighbors that have packets queued */
+      schedule_transmission(n, active_queues > 1);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      active_queues--;
+      neighbor_queue_remove(n);
     }
   }
 }
@@ -252,6 +360,8 @@ tx_done(int status, struct rdc_buf_list *q, struct neighbor_queue *n)
     break;
   }
 
+  PKTTRACE(MAC, SENT, queuebuf_attr(q->buf, PACKETBUF_ATTR_PKTTRACE_ID),
+           status);
   free_packet(n, q, status);
   mac_call_sent_callback(sent, cptr, status, ntx);
 }
@@ -259,7 +369,7 @@ tx_done(int status, struct rdc_buf_list *q, struct neighbor_queue *n)
 static void
 rexmit(struct rdc_buf_list *q, struct neighbor_queue *n)
 {
-  schedule_transmission(n);
+  schedule_transmission(n, 0);
   /* This is needed to correctly attribute energy that we spent
      transmitting this packet. */
   queuebuf_update_attr_from_packetbuf(q->buf);
@@ -367,6 +477,9 @@ send_packet(mac_callback_t sent, void *ptr)
 {
   struct rdc_buf_list *q;
   struct neighbor_queue *n;
+  struct neighbor_queue *longest;
+  mac_callback_t dropped_sent = NULL;
+  void *dropped_ptr = NULL;
   static uint8_t initialized = 0;
   static uint16_t seqno;
   const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
@@ -388,33 +501,54 @@ send_packet(mac_callback_t sent, void *ptr)
   n = neighbor_queue_from_addr(addr);
   if(n == NULL) {
     /* Allocate a new neighbor entry */
-    n = memb_alloc(&neighbor_memb);
-    if(n != NULL) {
+    n = neighbor_queue_add(addr);
+  }
+
+  if(n != NULL) {
+    if(list_head(n->queued_packet_list) == NULL) {
       /* Init neighbor entry */
-      linkaddr_copy(&n->addr, addr);
       n->transmissions = 0;
       n->collisions = CSMA_MIN_BE;
-      /* Init packet list for this neighbor */
-      LIST_STRUCT_INIT(n, queued_packet_list);
-      /* Add neighbor to the list */
-      list_add(neighbor_list, n);
     }
-  }
-
-  if(n != NULL) {
     /* Add packet to the neighbor's queue */
     if(list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
       q = memb_alloc(&packet_memb);
+      if(q == NULL) {
+        /* All packets are queued. Share them fairly: the last packet
+           of the longest queue makes way, if that queue is at least
+           two packets longer than this one. */
+        longest = longest_queue(list_length(n->queued_packet_list) + 1);
+        if(longest != NULL) {
+          q = list_tail(longest->queued_packet_list);
+          dropped_sent = ((struct qbuf_metadata *)q->ptr)->sent;
+          dropped_ptr = ((struct qbuf_metadata *)q->ptr)->cptr;
+          PKTTRACE(MAC, DROP, queuebuf_attr(q->buf, PACKETBUF_ATTR_PKTTRACE_ID),
+                   MAC_TX_ERR);
+          PRINTF("csma: dropping a packet of a longer queue\n");
+          list_remove(longest->queued_packet_list, q);
+          queuebuf_free(q->buf);
+          memb_free(&metadata_memb, q->ptr);
+          memb_free(&packet_memb, q);
+          q = memb_alloc(&packet_memb);
+        }
+      }
       if(q != NULL) {
         q->ptr = memb_alloc(&metadata_memb);
         if(q->ptr != NULL) {
-          q->buf = queuebuf_new_from_packetbuf();
+          q->buf = queuebuf_take_from_packetbuf();
           if(q->buf != NULL) {
             struct qbuf_metadata *metadata = (struct qbuf_metadata *)q->ptr;
             /* Neighbor and packet successfully allocated */
             if(packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS) == 0) {
               /* Use default configuration for max transmissions */
               metadata->max_transmissions = CSMA_MAX_MAX_FRAME_RETRIES + 1;
+#if CSMA_WITH_POLICY
+              if(n != &broadcast_queue) {
+                metadata->max_transmissions =
+                  csma_policy_max_transmissions(addr,
+                                                metadata->max_transmissions);
+              }
+#endif /* CSMA_WITH_POLICY */
             } else {
               metadata->max_transmissions =
                 packetbuf_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS);
@@ -431,12 +565,19 @@ send_packet(mac_callback_t sent, void *ptr)
               list_add(n->queued_packet_list, q);
             }
 
+            PKTTRACE(MAC, QUEUE,
+                     queuebuf_attr(q->buf, PACKETBUF_ATTR_PKTTRACE_ID),
+                     queuebuf_datalen(q->buf));
             PRINTF("csma: send_packet, queue length %d, free packets %d\n",
                    list_length(n->queued_packet_list), memb_numfree(&packet_memb));
             /* If q is the first packet in the neighbor's queue, send asap */
             if(list_head(n->queued_packet_list) == q) {
-              schedule_transmission(n);
+              if(list_item_next(q) == NULL) {
+                active_queues++;
+              }
+              schedule_transmission(n, 0);
             }
+            mac_call_sent_callback(dropped_sent, dropped_ptr, MAC_TX_ERR, 1);
             return;
           }
           memb_free(&metadata_memb, q->ptr);
@@ -447,8 +588,7 @@ send_packet(mac_callback_t sent, void *ptr)
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
       if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+        neighbor_queue_remove(n);
       }
     } else {
       PRINTF("csma: Neighbor queue full\n");
@@ -457,12 +597,28 @@ send_packet(mac_callback_t sent, void *ptr)
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
   }
+  PKTTRACE(MAC, DROP, packetbuf_attr(PACKETBUF_ATTR_PKTTRACE_ID), MAC_TX_ERR);
+  mac_call_sent_callback(dropped_sent, dropped_ptr, MAC_TX_ERR, 1);
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
 /*---------------------------------------------------------------------------*/
+int
+csma_queue_length(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n;
+
+  n = neighbor_queue_from_addr(addr);
+  return n != NULL ? list_length(n->queued_packet_list) : 0;
+}
+/*---------------------------------------------------------------------------*/
 static void
 input_packet(void)
 {
+#if PKTTRACE_ENABLED
+  packetbuf_set_attr(PACKETBUF_ATTR_PKTTRACE_ID, pkttrace_new_id());
+#endif /* PKTTRACE_ENABLED */
+  PKTTRACE(MAC, IN, packetbuf_attr(PACKETBUF_ATTR_PKTTRACE_ID),
+           packetbuf_datalen());
   NETSTACK_LLSEC.input();
 }
 /*---------------------------------------------------------------------------*/
@@ -493,6 +649,8 @@ init(void)
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+  nbr_table_register(neighbor_queues, NULL);
+  LIST_STRUCT_INIT(&broadcast_queue, queued_packet_list);
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
@@ -42,10 +42,14 @@
 #define CSMA_H_
 
 #include "net/mac/mac.h"
+#include "net/linkaddr.h"
 #include "dev/radio.h"
 
 extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
 
+/* Returns the number of packets queued for a neighbor */
+int csma_queue_length(const linkaddr_t *addr);
+
 #endif /* CSMA_H_ */
@@ -88,6 +88,25 @@ typedef struct {
   uint8_t aux_sec_len;     /**<  Length (in bytes) of aux security header field */
 } field_length_t;
 
+/* The lengths of the fields between the FCF and the aux security header
+ * depend only on a few FCF bits. The most recent combinations are cached,
+ * so that creating and parsing frames does not evaluate the PAN ID rules
+ * every time. */
+#ifdef FRAME802154_CONF_LAYOUT_CACHE_SIZE
+#define LAYOUT_CACHE_SIZE FRAME802154_CONF_LAYOUT_CACHE_SIZE
+#else /* FRAME802154_CONF_LAYOUT_CACHE_SIZE */
+#define LAYOUT_CACHE_SIZE 4
+#endif /* FRAME802154_CONF_LAYOUT_CACHE_SIZE */
+
+#if LAYOUT_CACHE_SIZE > 0
+#define LAYOUT_VALID 0x8000
+static struct {
+  uint16_t key;
+  field_length_t flen;
+} layouts[LAYOUT_CACHE_SIZE];
+static uint8_t layouts_next;
+#endif /* LAYOUT_CACHE_SIZE > 0 */
+
 /*----------------------------------------------------------------------------*/
 CC_INLINE static uint8_t
 addr_len(uint8_t mode)
@@ -285,20 +304,64 @@ frame802154_extract_linkaddr(frame802154_t *frame,
   return 1;
 }
 /*----------------------------------------------------------------------------*/
+/* Sets the lengths of the sequence number, PAN ID and address fields of
+ * a frame with the given FCF, and zeroes the aux security header length */
 static void
-field_len(frame802154_t *p, field_length_t *flen)
+layout(frame802154_fcf_t *fcf, field_length_t *flen)
 {
   int has_src_panid;
   int has_dest_panid;
+#if LAYOUT_CACHE_SIZE > 0
+  uint16_t key;
+  int i;
+
+  key = LAYOUT_VALID |
+    (fcf->frame_type == FRAME802154_ACKFRAME) << 8 |
+    (fcf->src_addr_mode & 3) << 6 |
+    (fcf->frame_version & 3) << 4 |
+    (fcf->dest_addr_mode & 3) << 2 |
+    (fcf->sequence_number_suppression & 1) << 1 |
+    (fcf->panid_compression & 1);
+  for(i = 0; i < LAYOUT_CACHE_SIZE; i++) {
+    if(layouts[i].key == key) {
+      memcpy(flen, &layouts[i].flen, sizeof(field_length_t));
+      return;
+    }
+  }
+#endif /* LAYOUT_CACHE_SIZE > 0 */
 
   /* init flen to zeros */
   memset(flen, 0, sizeof(field_length_t));
 
-  /* Determine lengths of each field based on fcf and other args */
-  if((p->fcf.sequence_number_suppression & 1) == 0) {
+  /* Determine lengths of each field based on fcf */
+  if((fcf->sequence_number_suppression & 1) == 0) {
     flen->seqno_len = 1;
   }
 
+  frame802154_has_panid(fcf, &has_src_panid, &has_dest_panid);
+
+  if(has_src_panid) {
+    flen->src_pid_len = 2;
+  }
+
+  if(has_dest_panid) {
+    flen->dest_pid_len = 2;
+  }
+
+  /* determine address lengths */
+  flen->dest_addr_len = addr_len(fcf->dest_addr_mode & 3);
+  flen->src_addr_len = addr_len(fcf->src_addr_mode & 3);
+
+#if LAYOUT_CACHE_SIZE > 0
+  layouts[layouts_next].key = key;
+  memcpy(&layouts[layouts_next].flen, flen, sizeof(field_length_t));
+  layouts_next = (layouts_next + 1) % LAYOUT_CACHE_SIZE;
+#endif /* LAYOUT_CACHE_SIZE > 0 */
+}
+/*----------------------------------------------------------------------------*/
+static void
+field_len(frame802154_t *p, field_length_t *flen)
+{
   /* IEEE802.15.4e changes the meaning of PAN ID Compression (see Table 2a).
    * In this case, we leave the decision whether to compress PAN ID or not
    * up to the caller. */
@@ -312,19 +375,7 @@ field_len(frame802154_t *p, field_length_t *flen)
     }
   }
 
-  frame802154_has_panid(&p->fcf, &has_src_panid, &has_dest_panid);
-
-  if(has_src_panid) {
-    flen->src_pid_len = 2;
-  }
-
-  if(has_dest_panid) {
-    flen->dest_pid_len = 2;
-  }
-
-  /* determine address lengths */
-  flen->dest_addr_len = addr_len(p->fcf.dest_addr_mode & 3);
-  flen->src_addr_len = addr_len(p->fcf.src_addr_mode & 3);
+  layout(&p->fcf, flen);
 
 #if LLSEC802154_USES_AUX_HEADER
   /* Aux security header */
@@ -501,9 +552,8 @@ frame802154_parse(uint8_t *data, int len, frame802154_t *pf)
 {
   uint8_t *p;
   frame802154_fcf_t fcf;
+  field_length_t flen;
   int c;
-  int has_src_panid;
-  int has_dest_panid;
 #if LLSEC802154_USES_EXPLICIT_KEYS
   uint8_t key_id_mode;
 #endif /* LLSEC802154_USES_EXPLICIT_KEYS */
@@ -524,11 +574,11 @@ frame802154_parse(uint8_t *data, int len, frame802154_t *pf)
     p++;
   }
 
-  frame802154_has_panid(&fcf, &has_src_panid, &has_dest_panid);
+  layout(&fcf, &flen);
 
   /* Destination address, if any */
   if(fcf.dest_addr_mode) {
-    if(has_dest_panid) {
+    if(flen.dest_pid_len) {
       /* Destination PAN */
       pf->dest_pid = p[0] + (p[1] << 8);
       p += 2;
@@ -561,10 +611,10 @@ frame802154_parse(uint8_t *data, int len, frame802154_t *pf)
   /* Source address, if any */
   if(fcf.src_addr_mode) {
     /* Source PAN */
-    if(has_src_panid) {
+    if(flen.src_pid_len) {
       pf->src_pid = p[0] + (p[1] << 8);
       p += 2;
-      if(!has_dest_panid) {
+      if(!flen.dest_pid_len) {
         pf->dest_pid = pf->src_pid;
       }
     } else {
@@ -60,6 +60,7 @@ enum ieee802154e_header_ie_id {
 enum ieee802154e_payload_ie_id {
   PAYLOAD_IE_ESDU = 0,
   PAYLOAD_IE_MLME,
+  PAYLOAD_IE_IETF = 0x5,
   PAYLOAD_IE_LIST_TERMINATION = 0xf,
 };
 
@@ -72,6 +73,8 @@ enum ieee802154e_mlme_short_subie_id {
   MLME_SHORT_IE_TSCH_EB_FILTER,
   MLME_SHORT_IE_TSCH_MAC_METRICS_1,
   MLME_SHORT_IE_TSCH_MAC_METRICS_2,
+  /* Not part of IEEE 802.15.4e, from the reserved range */
+  MLME_SHORT_IE_TSCH_CHANNEL_BLACKLIST = 0x40,
 };
 
 /* c.f. IEEE 802.15.4e Table 4e */
@@ -86,6 +89,14 @@ enum ieee802154e_mlme_long_subie_id {
 #define READ16(buf, var) \
   (var) = ((uint8_t *)(buf))[0] | ((uint8_t *)(buf))[1] << 8
 
+#define WRITE32(buf, val) \
+  do { WRITE16(buf, (val) & 0xffff); \
+       WRITE16((uint8_t *)(buf) + 2, ((val) >> 16) & 0xffff); } while(0);
+
+#define READ32(buf, var) \
+  (var) = (uint32_t)((uint8_t *)(buf))[0] | (uint32_t)((uint8_t *)(buf))[1] << 8 \
+        | (uint32_t)((uint8_t *)(buf))[2] << 16 | (uint32_t)((uint8_t *)(buf))[3] << 24
+
 /* Create a header IE 2-byte descriptor */
 static void
 create_header_ie_descriptor(uint8_t *buf, uint8_t element_id, int ie_len)
@@ -207,6 +218,21 @@ frame80215e_create_ie_mlme(uint8_t *buf, int len,
   }
 }
 
+/* Payload IE. IETF. Used to carry IETF sub-IEs, e.g. 6P messages */
+int
+frame80215e_create_ie_ietf(uint8_t *buf, int len,
+    struct ieee802154_ies *ies)
+{
+  int ie_len = 0;
+  if(len >= 2 + ie_len && ies != NULL) {
+    /* The length of the outer IETF IE is the total length of its content */
+    create_payload_ie_descriptor(buf, PAYLOAD_IE_IETF, ies->ie_ietf_len);
+    return 2 + ie_len;
+  } else {
+    return -1;
+  }
+}
+
 /* MLME sub-IE. TSCH synchronization. Used in EBs: ASN and join priority */
 int
 frame80215e_create_ie_tsch_synchronization(uint8_t *buf, int len,
@@ -227,6 +253,25 @@ frame80215e_create_ie_tsch_synchronization(uint8_t *buf, int len,
   }
 }
 
+/* MLME sub-IE. TSCH channel blacklist, not part of IEEE 802.15.4e. Used in
+ * EBs: channels to skip, now and from a given ASN on */
+int
+frame80215e_create_ie_tsch_channel_blacklist(uint8_t *buf, int len,
+    struct ieee802154_ies *ies)
+{
+  int ie_len = 13;
+  if(len >= 2 + ie_len && ies != NULL) {
+    WRITE32(buf + 2, ies->ie_channel_blacklist);
+    WRITE32(buf + 6, ies->ie_channel_blacklist_next);
+    WRITE32(buf + 10, ies->ie_channel_blacklist_switch_asn.ls4b);
+    buf[14] = ies->ie_channel_blacklist_switch_asn.ms1b;
+    create_mlme_short_ie_descriptor(buf, MLME_SHORT_IE_TSCH_CHANNEL_BLACKLIST, ie_len);
+    return 2 + ie_len;
+  } else {
+    return -1;
+  }
+}
+
 /* MLME sub-IE. TSCH slotframe and link. Used in EBs: initial schedule */
 int
 frame80215e_create_ie_tsch_slotframe_and_link(uint8_t *buf, int len,
@@ -397,6 +442,18 @@ frame802154e_parse_mlme_short_ie(const uint8_t *buf, int len,
         return len;
       }
       break;
+    case MLME_SHORT_IE_TSCH_CHANNEL_BLACKLIST:
+      if(len == 13) {
+        if(ies != NULL) {
+          ies->ie_channel_blacklist_id = 1;
+          READ32(buf, ies->ie_channel_blacklist);
+          READ32(buf + 4, ies->ie_channel_blacklist_next);
+          READ32(buf + 8, ies->ie_channel_blacklist_switch_asn.ls4b);
+          ies->ie_channel_blacklist_switch_asn.ms1b = buf[12];
+        }
+        return len;
+      }
+      break;
     case MLME_SHORT_IE_TSCH_TIMESLOT:
       if(len == 1 || len == 25) {
         if(ies != NULL) {
@@ -460,6 +517,13 @@ frame802154e_parse_information_elements(const uint8_t *buf, uint8_t buf_size,
   /* Always look for a header IE first (at least "list termination 1") */
   parsing_state = PARSING_HEADER_IE;
   ies->ie_payload_ie_offset = 0;
+  ies->ie_ietf_offset = 0;
+  ies->ie_ietf_len = 0;
+  ies->ie_tsch_synchronization_offset = 0;
+  ies->ie_tsch_slotframe_and_link_offset = 0;
+  ies->ie_tsch_timeslot_offset = 0;
+  ies->ie_channel_hopping_sequence_offset = 0;
+  ies->ie_channel_blacklist_offset = 0;
 
   /* Loop over all IEs */
   while(buf_size > 0) {
@@ -529,6 +593,15 @@ frame802154e_parse_information_elements(const uint8_t *buf, uint8_t buf_size,
             len = 0; /* Reset len as we want to read subIEs and not jump over them */
             PRINTF("frame802154e: entering MLME ie with len %u\n", nested_mlme_len);
             break;
+          case PAYLOAD_IE_IETF:
+            /* Not parsed here, save the location of the content for upper layers */
+            if(len > buf_size) {
+              return -1;
+            }
+            ies->ie_ietf_offset = buf - start;
+            ies->ie_ietf_len = len;
+            PRINTF("frame802154e: IETF ie with len %u\n", len);
+            break;
           case PAYLOAD_IE_LIST_TERMINATION:
             PRINTF("frame802154e: payload ie list termination %u\n", len);
             return (len == 0) ? buf + len - start : -1;
@@ -549,6 +622,20 @@ frame802154e_parse_information_elements(const uint8_t *buf, uint8_t buf_size,
             PRINTF("frame802154e: failed to parse ie\n");
             return -1;
           }
+          switch(id) {
+            case MLME_SHORT_IE_TSCH_SYNCHRONIZATION:
+              ies->ie_tsch_synchronization_offset = buf - start;
+              break;
+            case MLME_SHORT_IE_TSCH_SLOFTRAME_AND_LINK:
+              ies->ie_tsch_slotframe_and_link_offset = buf - start;
+              break;
+            case MLME_SHORT_IE_TSCH_TIMESLOT:
+              ies->ie_tsch_timeslot_offset = buf - start;
+              break;
+            case MLME_SHORT_IE_TSCH_CHANNEL_BLACKLIST:
+              ies->ie_channel_blacklist_offset = buf - start;
+              break;
+          }
         } else {
           /* Long sub-IE, c.f. fig 48s in IEEE 802.15.4e */
           len = ie_desc & 0x7ff; /* b0-b10 */
@@ -558,6 +645,9 @@ frame802154e_parse_information_elements(const uint8_t *buf, uint8_t buf_size,
             PRINTF("frame802154e: failed to parse ie\n");
             return -1;
           }
+          if(id == MLME_LONG_IE_TSCH_CHANNEL_HOPPING_SEQUENCE) {
+            ies->ie_channel_hopping_sequence_offset = buf - start;
+          }
         }
         /* Update remaining nested MLME len */
         nested_mlme_len -= 2 + len;
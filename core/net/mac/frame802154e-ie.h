@@ -68,18 +68,33 @@ struct ieee802154_ies {
   /* Payload MLME */
   uint8_t ie_payload_ie_offset;
   uint16_t ie_mlme_len;
-  /* Payload Short MLME IEs */
+  /* Location of the content of each MLME sub-IE found, from the start of
+   * the IE list, or 0 if absent. Recorded while walking the list once, so
+   * that callers can get back to an IE without parsing the list again. */
   uint8_t ie_tsch_synchronization_offset;
+  uint8_t ie_tsch_slotframe_and_link_offset;
+  uint8_t ie_tsch_timeslot_offset;
+  uint8_t ie_channel_hopping_sequence_offset;
+  uint8_t ie_channel_blacklist_offset;
+  /* Payload Short MLME IEs */
   struct tsch_asn_t ie_asn;
   uint8_t ie_join_priority;
   uint8_t ie_tsch_timeslot_id;
   uint16_t ie_tsch_timeslot[tsch_ts_elements_count];
   struct tsch_slotframe_and_links ie_tsch_slotframe_and_link;
+  /* Payload IETF IE: location and length of its content (e.g. a 6P message) */
+  uint8_t ie_ietf_offset;
+  uint16_t ie_ietf_len;
   /* Payload Long MLME IEs */
   uint8_t ie_channel_hopping_sequence_id;
   /* We include and parse only the sequence len and list and omit unused fields */
   uint16_t ie_hopping_sequence_len;
   uint8_t ie_hopping_sequence_list[TSCH_HOPPING_SEQUENCE_MAX_LEN];
+  /* Payload Short MLME IE, not part of IEEE 802.15.4e: channel blacklist */
+  uint8_t ie_channel_blacklist_id;
+  uint32_t ie_channel_blacklist;
+  uint32_t ie_channel_blacklist_next;
+  struct tsch_asn_t ie_channel_blacklist_switch_asn;
 };
 
 /** Insert various Information Elements **/
@@ -100,6 +115,9 @@ int frame80215e_create_ie_payload_list_termination(uint8_t *buf, int len,
 /* Payload IE. MLME. Used to nest sub-IEs */
 int frame80215e_create_ie_mlme(uint8_t *buf, int len,
     struct ieee802154_ies *ies);
+/* Payload IE. IETF. Used to carry IETF sub-IEs, e.g. 6P messages */
+int frame80215e_create_ie_ietf(uint8_t *buf, int len,
+    struct ieee802154_ies *ies);
 /* MLME sub-IE. TSCH synchronization. Used in EBs: ASN and join priority */
 int frame80215e_create_ie_tsch_synchronization(uint8_t *buf, int len,
     struct ieee802154_ies *ies);
@@ -112,6 +130,10 @@ int frame80215e_create_ie_tsch_timeslot(uint8_t *buf, int len,
 /* MLME sub-IE. TSCH channel hopping sequence. Used in EBs: hopping sequence */
 int frame80215e_create_ie_tsch_channel_hopping_sequence(uint8_t *buf, int len,
     struct ieee802154_ies *ies);
+/* MLME sub-IE. TSCH channel blacklist, not part of IEEE 802.15.4e. Used in
+ * EBs: channels to skip, now and from a given ASN on */
+int frame80215e_create_ie_tsch_channel_blacklist(uint8_t *buf, int len,
+    struct ieee802154_ies *ies);
 
 /* Parse all Information Elements of a frame */
 int frame802154e_parse_information_elements(const uint8_t *buf, uint8_t buf_size,
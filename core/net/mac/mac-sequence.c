@@ -46,6 +46,7 @@
 
 #include "contiki-net.h"
 #include "net/mac/mac-sequence.h"
+#include "net/nbr-table.h"
 #include "net/packetbuf.h"
 #include "net/rime/rime.h"
 
@@ -66,14 +67,88 @@ struct seqno {
 #else /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
 #define MAX_SEQNOS 16
 #endif /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
+
+/* Number of sequence numbers remembered per neighbor in the neighbor
+   table. Senders that cannot get a neighbor table entry fall back to
+   the global history of MAX_SEQNOS (sender, seqno) pairs. */
+#ifdef NETSTACK_CONF_MAC_SEQNO_NBR_HISTORY
+#define NBR_SEQNOS NETSTACK_CONF_MAC_SEQNO_NBR_HISTORY
+#else /* NETSTACK_CONF_MAC_SEQNO_NBR_HISTORY */
+#define NBR_SEQNOS 4
+#endif /* NETSTACK_CONF_MAC_SEQNO_NBR_HISTORY */
+
 static struct seqno received_seqnos[MAX_SEQNOS];
 
+#if NBR_SEQNOS > 0
+struct nbr_seqnos {
+  clock_time_t timestamp[NBR_SEQNOS];
+  uint8_t seqno[NBR_SEQNOS];
+  /* Number of valid entries, and the slot the next one goes to */
+  uint8_t count;
+  uint8_t next;
+};
+
+NBR_TABLE(struct nbr_seqnos, nbr_seqnos);
+
+/* 0: not registered yet, 1: registered, -1: no table slot left */
+static int8_t nbr_seqnos_registered;
+#endif /* NBR_SEQNOS > 0 */
+
+/*---------------------------------------------------------------------------*/
+static int
+is_recent(clock_time_t timestamp, clock_time_t now)
+{
+#if SEQNO_MAX_AGE > 0
+  return now - timestamp <= SEQNO_MAX_AGE;
+#else /* SEQNO_MAX_AGE > 0 */
+  return 1;
+#endif /* SEQNO_MAX_AGE > 0 */
+}
+/*---------------------------------------------------------------------------*/
+#if NBR_SEQNOS > 0
+static struct nbr_seqnos *
+nbr_seqnos_get(int create)
+{
+  const linkaddr_t *sender;
+  struct nbr_seqnos *n;
+
+  if(nbr_seqnos_registered == 0) {
+    nbr_seqnos_registered = nbr_table_register(nbr_seqnos, NULL) ? 1 : -1;
+  }
+  if(nbr_seqnos_registered < 0) {
+    return NULL;
+  }
+
+  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  n = nbr_table_get_from_lladdr(nbr_seqnos, sender);
+  if(n == NULL && create) {
+    /* Returns a zeroed entry, or NULL if no neighbor could be freed */
+    n = nbr_table_add_lladdr(nbr_seqnos, sender, NBR_TABLE_REASON_MAC, NULL);
+  }
+  return n;
+}
+#endif /* NBR_SEQNOS > 0 */
 /*---------------------------------------------------------------------------*/
 int
 mac_sequence_is_duplicate(void)
 {
   int i;
   clock_time_t now = clock_time();
+  uint8_t seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+#if NBR_SEQNOS > 0
+  struct nbr_seqnos *n;
+
+  n = nbr_seqnos_get(0);
+  if(n != NULL) {
+    for(i = 0; i < n->count; ++i) {
+      if(n->seqno[i] == seqno && is_recent(n->timestamp[i], now)) {
+        /* Duplicate packet. */
+        return 1;
+      }
+    }
+    return 0;
+  }
+#endif /* NBR_SEQNOS > 0 */
 
   /*
    * Check for duplicate packet by comparing the sequence number of the incoming
@@ -82,15 +157,10 @@ mac_sequence_is_duplicate(void)
   for(i = 0; i < MAX_SEQNOS; ++i) {
     if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER),
                     &received_seqnos[i].sender)) {
-      if(packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO) == received_seqnos[i].seqno) {
-#if SEQNO_MAX_AGE > 0
-        if(now - received_seqnos[i].timestamp <= SEQNO_MAX_AGE) {
-          /* Duplicate packet. */
-          return 1;
-        }
-#else /* SEQNO_MAX_AGE > 0 */
+      if(seqno == received_seqnos[i].seqno &&
+         is_recent(received_seqnos[i].timestamp, now)) {
+        /* Duplicate packet. */
         return 1;
-#endif /* SEQNO_MAX_AGE > 0 */
       }
       break;
     }
@@ -102,6 +172,20 @@ void
 mac_sequence_register_seqno(void)
 {
   int i, j;
+#if NBR_SEQNOS > 0
+  struct nbr_seqnos *n;
+
+  n = nbr_seqnos_get(1);
+  if(n != NULL) {
+    n->seqno[n->next] = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+    n->timestamp[n->next] = clock_time();
+    n->next = (n->next + 1) % NBR_SEQNOS;
+    if(n->count < NBR_SEQNOS) {
+      n->count++;
+    }
+    return;
+  }
+#endif /* NBR_SEQNOS > 0 */
 
   /* Locate possible previous sequence number for this address. */
   for(i = 0; i < MAX_SEQNOS; ++i) {
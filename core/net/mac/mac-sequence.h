@@ -51,7 +51,9 @@
  *
  *             This function is used to check for duplicate packet by comparing
  *             the sequence number of the incoming packet with the last few ones
- *             we saw, filtering with the Rime address.
+ *             we saw, filtering with the Rime address. The history is kept
+ *             per sender in the neighbor table, so that the lookup does not
+ *             depend on the number of neighbors.
  */
 int mac_sequence_is_duplicate(void);
 
@@ -44,6 +44,7 @@
 #include "net/queuebuf.h"
 #include "net/netstack.h"
 #include "net/rime/rimestats.h"
+#include "sys/energest.h"
 #include <string.h>
 
 #if CONTIKI_TARGET_COOJA || CONTIKI_TARGET_COOJA_IP64
@@ -107,21 +108,136 @@
 #include "net/mac/frame802154.h"
 #endif /* NULLRDC_SEND_802154_ACK */
 
+/* With NULLRDC_CONF_TX_PRELOAD, send_list() loads the next frame into
+   the radio while the acknowledgement of the current one is awaited,
+   if the radio supports it (RADIO_CONST_TX_PRELOAD). The next frame
+   is created in a packetbuf context of its own, so that the packetbuf
+   of the current frame is left intact for its callback. */
+#if NULLRDC_802154_AUTOACK && defined NULLRDC_CONF_TX_PRELOAD
+#define NULLRDC_TX_PRELOAD NULLRDC_CONF_TX_PRELOAD
+#else
+#define NULLRDC_TX_PRELOAD 0
+#endif
+
+/* With NULLRDC_CONF_ASYNC_ACK, send_list() does not busy-wait for the
+   acknowledgement of a unicast frame. An rtimer ends the wait, or the
+   acknowledgement itself when the radio driver delivers it to
+   packet_input(), and a process then calls the callback. Other
+   processes and interrupts run in the meantime. Only the first frame
+   of the list is sent: the MAC layer sends the next one when it gets
+   the callback, as CSMA does, since the list may change while the
+   acknowledgement is awaited. Frames sent with send_packet() are
+   still waited for, as their packetbuf cannot be kept. */
+#if NULLRDC_802154_AUTOACK && defined NULLRDC_CONF_ASYNC_ACK
+#define NULLRDC_ASYNC_ACK NULLRDC_CONF_ASYNC_ACK
+#else
+#define NULLRDC_ASYNC_ACK 0
+#endif
+
+#if NULLRDC_ASYNC_ACK && NULLRDC_TX_PRELOAD
+#error "NULLRDC_CONF_ASYNC_ACK cannot be used with NULLRDC_CONF_TX_PRELOAD"
+#endif
+
 #define ACK_LEN 3
 
+#if NULLRDC_TX_PRELOAD
+static struct packetbuf_ctx preload_ctx;
+/* The context in which the next frame is created */
+static struct packetbuf_ctx *next_ctx;
+/* The next frame of the list being sent, or NULL */
+static struct rdc_buf_list *next_buf;
+static uint8_t preload_supported;
+/* Set if the frame in the packetbuf context has been created and
+   loaded into the radio already */
+static uint8_t preloaded, next_preloaded;
+#endif /* NULLRDC_TX_PRELOAD */
+
+#if NULLRDC_ASYNC_ACK
+PROCESS(nullrdc_ack_process, "nullrdc ack");
+
+enum {
+  TX_IDLE,
+  TX_WAIT_ACK,
+  TX_WAIT_ACK_DETECTED,
+  TX_DONE,
+};
+static volatile uint8_t tx_state = TX_IDLE;
+static volatile uint8_t tx_acked;
+static uint8_t tx_dsn;
+static struct rtimer ack_timer;
+/* The frame waiting for an acknowledgement */
+static struct rdc_buf_list *tx_buf;
+static mac_callback_t tx_sent;
+static void *tx_ptr;
+#endif /* NULLRDC_ASYNC_ACK */
+
 /*---------------------------------------------------------------------------*/
 static int
-send_one_packet(mac_callback_t sent, void *ptr)
+create_frame(void)
 {
-  int ret;
-  int last_sent_ok = 0;
-
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
 #if NULLRDC_802154_AUTOACK || NULLRDC_802154_AUTOACK_HW
   packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
 #endif /* NULLRDC_802154_AUTOACK || NULLRDC_802154_AUTOACK_HW */
 
-  if(NETSTACK_FRAMER.create() < 0) {
+  return NETSTACK_FRAMER.create();
+}
+#if NULLRDC_TX_PRELOAD
+/*---------------------------------------------------------------------------*/
+static void
+preload_next(void)
+{
+  struct packetbuf_ctx *ctx;
+
+  if(next_buf != NULL && preload_supported) {
+    ctx = packetbuf_ctx_select(next_ctx);
+    queuebuf_to_packetbuf(next_buf->buf);
+    if(create_frame() >= 0) {
+      NETSTACK_RADIO.prepare(packetbuf_hdrptr(), packetbuf_totlen());
+      next_preloaded = 1;
+    }
+    packetbuf_ctx_select(ctx);
+  }
+}
+#endif /* NULLRDC_TX_PRELOAD */
+#if NULLRDC_ASYNC_ACK
+/*---------------------------------------------------------------------------*/
+static void
+ack_timeout(struct rtimer *t, void *ptr)
+{
+  if(tx_state == TX_WAIT_ACK && AFTER_ACK_DETECTED_WAIT_TIME > 0 &&
+     (NETSTACK_RADIO.receiving_packet() ||
+      NETSTACK_RADIO.pending_packet() ||
+      NETSTACK_RADIO.channel_clear() == 0)) {
+    /* Something is on the air: give the acknowledgement time to arrive */
+    tx_state = TX_WAIT_ACK_DETECTED;
+    rtimer_set(&ack_timer, RTIMER_NOW() + AFTER_ACK_DETECTED_WAIT_TIME, 1,
+               ack_timeout, NULL);
+    return;
+  }
+  if(tx_state == TX_WAIT_ACK || tx_state == TX_WAIT_ACK_DETECTED) {
+    tx_state = TX_DONE;
+    process_poll(&nullrdc_ack_process);
+  }
+}
+#endif /* NULLRDC_ASYNC_ACK */
+/*---------------------------------------------------------------------------*/
+/* Returns 1 if the frame was sent and acknowledged, 0 if not, and -1
+   if async is set and the acknowledgement is awaited by
+   nullrdc_ack_process, which then calls the callback. */
+static int
+send_one_packet(mac_callback_t sent, void *ptr, int async)
+{
+  int ret;
+  int last_sent_ok = 0;
+
+  ENERGEST_SET_CLASS(packetbuf_attr(PACKETBUF_ATTR_ENERGEST_CLASS));
+  if(
+#if NULLRDC_TX_PRELOAD
+     /* A preloaded frame has been created already */
+     !preloaded &&
+#endif /* NULLRDC_TX_PRELOAD */
+     create_frame() < 0) {
     /* Failed to allocate space for headers */
     PRINTF("nullrdc: send failed, too large header\n");
     ret = MAC_TX_ERR_FATAL;
@@ -131,6 +247,9 @@ send_one_packet(mac_callback_t sent, void *ptr)
     uint8_t dsn;
     dsn = ((uint8_t *)packetbuf_hdrptr())[2] & 0xff;
 
+#if NULLRDC_TX_PRELOAD
+    if(!preloaded)
+#endif /* NULLRDC_TX_PRELOAD */
     NETSTACK_RADIO.prepare(packetbuf_hdrptr(), packetbuf_totlen());
 
     is_broadcast = packetbuf_holds_broadcast();
@@ -151,12 +270,25 @@ send_one_packet(mac_callback_t sent, void *ptr)
       case RADIO_TX_OK:
         if(is_broadcast) {
           ret = MAC_TX_OK;
+#if NULLRDC_ASYNC_ACK
+        } else if(async) {
+          tx_dsn = dsn;
+          tx_acked = 0;
+          tx_state = TX_WAIT_ACK;
+          rtimer_set(&ack_timer, RTIMER_NOW() + ACK_WAIT_TIME, 1,
+                     ack_timeout, NULL);
+          ENERGEST_SET_CLASS(ENERGEST_CLASS_OTHER);
+          return -1;
+#endif /* NULLRDC_ASYNC_ACK */
         } else {
           rtimer_clock_t wt;
 
           /* Check for ack */
           wt = RTIMER_NOW();
           watchdog_periodic();
+#if NULLRDC_TX_PRELOAD
+          preload_next();
+#endif /* NULLRDC_TX_PRELOAD */
           while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt + ACK_WAIT_TIME)) {
 #if CONTIKI_TARGET_COOJA || CONTIKI_TARGET_COOJA_IP64
             simProcessRunValue = 1;
@@ -227,6 +359,7 @@ send_one_packet(mac_callback_t sent, void *ptr)
 
 #endif /* ! NULLRDC_802154_AUTOACK */
   }
+  ENERGEST_SET_CLASS(ENERGEST_CLASS_OTHER);
   if(ret == MAC_TX_OK) {
     last_sent_ok = 1;
   }
@@ -237,29 +370,122 @@ send_one_packet(mac_callback_t sent, void *ptr)
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
-  send_one_packet(sent, ptr);
+#if NULLRDC_ASYNC_ACK
+  if(tx_state != TX_IDLE) {
+    /* The radio is waiting for the acknowledgement of another frame */
+    mac_call_sent_callback(sent, ptr, MAC_TX_COLLISION, 1);
+    return;
+  }
+#endif /* NULLRDC_ASYNC_ACK */
+  send_one_packet(sent, ptr, 0);
+}
+#if NULLRDC_ASYNC_ACK
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nullrdc_ack_process, ev, data)
+{
+  int ret;
+  int len;
+  uint8_t ackbuf[ACK_LEN];
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    if(tx_state != TX_DONE) {
+      continue;
+    }
+
+    ret = MAC_TX_NOACK;
+    if(tx_acked) {
+      ret = MAC_TX_OK;
+    } else if(NETSTACK_RADIO.pending_packet()) {
+      /* The radio driver has not read the frame yet */
+      len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
+      if(len == ACK_LEN && ackbuf[2] == tx_dsn) {
+        ret = MAC_TX_OK;
+      } else {
+        /* Not an ack or ack not for us: collision */
+        ret = MAC_TX_COLLISION;
+      }
+    } else {
+      PRINTF("nullrdc tx noack\n");
+    }
+    if(ret == MAC_TX_OK) {
+      RIMESTATS_ADD(ackrx);
+    }
+    tx_state = TX_IDLE;
+
+    /* Other processes may have used the packetbuf in the meantime */
+    queuebuf_to_packetbuf(tx_buf->buf);
+    mac_call_sent_callback(tx_sent, tx_ptr, ret, 1);
+  }
+
+  PROCESS_END();
 }
+#endif /* NULLRDC_ASYNC_ACK */
 /*---------------------------------------------------------------------------*/
 static void
 send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
 {
+#if NULLRDC_ASYNC_ACK
+  if(tx_state != TX_IDLE) {
+    if(ptr != tx_ptr) {
+      /* The radio is waiting for the acknowledgement of another
+         neighbor's frame: try again after a backoff */
+      queuebuf_to_packetbuf(buf_list->buf);
+      mac_call_sent_callback(sent, ptr, MAC_TX_COLLISION, 1);
+    }
+    /* Else the callback of the frame being sent continues the list */
+    return;
+  }
+  tx_sent = sent;
+  tx_ptr = ptr;
+  tx_buf = buf_list;
+  queuebuf_to_packetbuf(buf_list->buf);
+  send_one_packet(sent, ptr, 1);
+  return;
+#endif /* NULLRDC_ASYNC_ACK */
+#if NULLRDC_TX_PRELOAD
+  next_ctx = &preload_ctx;
+  preloaded = 0;
+#endif /* NULLRDC_TX_PRELOAD */
   while(buf_list != NULL) {
     /* We backup the next pointer, as it may be nullified by
      * mac_call_sent_callback() */
     struct rdc_buf_list *next = buf_list->next;
     int last_sent_ok;
 
+#if NULLRDC_TX_PRELOAD
+    next_buf = next;
+    next_preloaded = 0;
+    if(!preloaded)
+#endif /* NULLRDC_TX_PRELOAD */
     queuebuf_to_packetbuf(buf_list->buf);
-    last_sent_ok = send_one_packet(sent, ptr);
+    last_sent_ok = send_one_packet(sent, ptr, 0);
 
     /* If packet transmission was not successful, we should back off and let
      * upper layers retransmit, rather than potentially sending out-of-order
      * packet fragments. */
     if(!last_sent_ok) {
-      return;
+      break;
     }
+#if NULLRDC_TX_PRELOAD
+    preloaded = next_preloaded;
+    if(preloaded) {
+      /* Continue in the context of the preloaded frame */
+      next_ctx = packetbuf_ctx_select(next_ctx);
+    }
+#endif /* NULLRDC_TX_PRELOAD */
     buf_list = next;
   }
+#if NULLRDC_TX_PRELOAD
+  if(next_ctx != &preload_ctx) {
+    /* Go back to the context of the caller */
+    packetbuf_ctx_select(next_ctx);
+  }
+  next_buf = NULL;
+  preloaded = 0;
+#endif /* NULLRDC_TX_PRELOAD */
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -275,6 +501,15 @@ packet_input(void)
 
 #if NULLRDC_802154_AUTOACK
   if(packetbuf_datalen() == ACK_LEN) {
+#if NULLRDC_ASYNC_ACK
+    if((tx_state == TX_WAIT_ACK || tx_state == TX_WAIT_ACK_DETECTED) &&
+       ((uint8_t *)packetbuf_dataptr())[2] == tx_dsn) {
+      /* The acknowledgement of the frame being sent */
+      tx_acked = 1;
+      tx_state = TX_DONE;
+      process_poll(&nullrdc_ack_process);
+    } else
+#endif /* NULLRDC_ASYNC_ACK */
     /* Ignore ack packets */
     PRINTF("nullrdc: ignored ack\n"); 
   } else
@@ -352,6 +587,19 @@ channel_check_interval(void)
 static void
 init(void)
 {
+#if NULLRDC_TX_PRELOAD
+  radio_value_t value;
+
+  packetbuf_ctx_init(&preload_ctx);
+  if(NETSTACK_RADIO.get_value != NULL &&
+     NETSTACK_RADIO.get_value(RADIO_CONST_TX_PRELOAD, &value) ==
+     RADIO_RESULT_OK && value != 0) {
+    preload_supported = 1;
+  }
+#endif /* NULLRDC_TX_PRELOAD */
+#if NULLRDC_ASYNC_ACK
+  process_start(&nullrdc_ack_process, NULL);
+#endif /* NULLRDC_ASYNC_ACK */
   on();
 }
 /*---------------------------------------------------------------------------*/
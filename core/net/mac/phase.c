@@ -44,16 +44,41 @@
 #include "net/queuebuf.h"
 #include "net/nbr-table.h"
 
-#if PHASE_CONF_DRIFT_CORRECT
+#ifdef PHASE_CONF_DRIFT_CORRECT
 #define PHASE_DRIFT_CORRECT PHASE_CONF_DRIFT_CORRECT
 #else
-#define PHASE_DRIFT_CORRECT 0
+#define PHASE_DRIFT_CORRECT 1
 #endif
 
+#if PHASE_DRIFT_CORRECT
+/* Phase measurements closer in time than this are too noisy to tell
+   the clock drift apart from the strobe timing. */
+#ifdef PHASE_CONF_DRIFT_MIN_INTERVAL
+#define PHASE_DRIFT_MIN_INTERVAL PHASE_CONF_DRIFT_MIN_INTERVAL
+#else
+#define PHASE_DRIFT_MIN_INTERVAL (16 * CLOCK_SECOND)
+#endif
+
+/* Measurements further apart than this may have drifted by more than
+   half a cycle, which cannot be told from drift the other way. */
+#ifdef PHASE_CONF_DRIFT_MAX_INTERVAL
+#define PHASE_DRIFT_MAX_INTERVAL PHASE_CONF_DRIFT_MAX_INTERVAL
+#else
+#define PHASE_DRIFT_MAX_INTERVAL (300 * CLOCK_SECOND)
+#endif
+
+/* The drift is kept in 1/PHASE_DRIFT_SCALE rtimer ticks per cycle. */
+#define PHASE_DRIFT_SCALE 256
+#endif /* PHASE_DRIFT_CORRECT */
+
 struct phase {
   rtimer_clock_t time;
 #if PHASE_DRIFT_CORRECT
-  rtimer_clock_t drift;
+  clock_time_t updated;         /* When time was measured */
+  rtimer_clock_t sample_time;   /* Start of the current drift sample */
+  clock_time_t sample_start;
+  int32_t drift;                /* Estimated drift per cycle */
+  uint8_t drift_valid;
 #endif
   uint8_t noacks;
   struct timer noacks_timer;
@@ -87,6 +112,74 @@ NBR_TABLE(struct phase, nbr_phase);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+#if PHASE_DRIFT_CORRECT
+/* The cycle time of the MAC protocol, as passed to phase_wait(). The
+   phase_update() calls that carry measurements follow a phase_wait()
+   for the same neighbor. */
+static rtimer_clock_t drift_cycle_time;
+/*---------------------------------------------------------------------------*/
+/* Number of cycles in an interval of clock ticks */
+static uint32_t
+cycles(clock_time_t interval, rtimer_clock_t cycle_time)
+{
+  return (uint32_t)interval * (RTIMER_ARCH_SECOND / CLOCK_SECOND) / cycle_time;
+}
+/*---------------------------------------------------------------------------*/
+/* The offset of a time difference from a whole number of cycles, in
+   (-cycle_time / 2, cycle_time / 2]. */
+static int32_t
+cycle_offset(rtimer_clock_t diff, rtimer_clock_t cycle_time)
+{
+  int32_t offset;
+
+  offset = diff % cycle_time;
+  if(offset > cycle_time / 2) {
+    offset -= cycle_time;
+  }
+  return offset;
+}
+/*---------------------------------------------------------------------------*/
+/* Refine the neighbor's drift estimate with a new phase measurement.
+   As in adaptive time synchronization for TSCH, the estimate is an
+   average over samples taken over long enough intervals for the
+   measurement noise to average out. */
+static void
+update_drift(struct phase *e, rtimer_clock_t time)
+{
+  clock_time_t now;
+  clock_time_t interval;
+  uint32_t n;
+  int32_t sample;
+
+  now = clock_time();
+  interval = now - e->sample_start;
+
+  if(drift_cycle_time == 0 ||
+     /* The offset is only exact if the rtimer wraps at whole cycles */
+     (sizeof(rtimer_clock_t) < 4 && (drift_cycle_time & (drift_cycle_time - 1)))) {
+    return;
+  }
+
+  if(interval >= PHASE_DRIFT_MIN_INTERVAL) {
+    n = cycles(interval, drift_cycle_time);
+    if(interval <= PHASE_DRIFT_MAX_INTERVAL && n > 0) {
+      sample = cycle_offset(time - e->sample_time, drift_cycle_time) *
+        PHASE_DRIFT_SCALE / (int32_t)n;
+      if(e->drift_valid) {
+        e->drift = (3 * e->drift + sample) / 4;
+      } else {
+        e->drift = sample;
+        e->drift_valid = 1;
+      }
+      PRINTF("phase drift sample %ld estimate %ld\n",
+             (long)sample, (long)e->drift);
+    }
+    e->sample_time = time;
+    e->sample_start = now;
+  }
+}
+#endif /* PHASE_DRIFT_CORRECT */
+/*---------------------------------------------------------------------------*/
 void
 phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
              int mac_status)
@@ -98,7 +191,8 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
 #if PHASE_DRIFT_CORRECT
-      e->drift = time-e->time;
+      update_drift(e, time);
+      e->updated = clock_time();
 #endif
       e->time = time;
     }
@@ -126,9 +220,13 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
       if(e) {
         e->time = time;
 #if PHASE_DRIFT_CORRECT
-      e->drift = 0;
+        e->updated = clock_time();
+        e->sample_time = time;
+        e->sample_start = e->updated;
+        e->drift = 0;
+        e->drift_valid = 0;
 #endif
-      e->noacks = 0;
+        e->noacks = 0;
       }
     }
   }
@@ -150,11 +248,11 @@ send_packet(void *ptr)
   memb_free(&queued_packets_memb, p);
 }
 /*---------------------------------------------------------------------------*/
-phase_status_t
-phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
+static phase_status_t
+wait_phase(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
            rtimer_clock_t guard_time,
            mac_callback_t mac_callback, void *mac_callback_ptr,
-           struct rdc_buf_list *buf_list)
+           struct rdc_buf_list *buf_list, int busy_wait)
 {
   struct phase *e;
   //  const linkaddr_t *neighbor = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
@@ -186,13 +284,14 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
     sync = (e == NULL) ? now : e->time;
 
 #if PHASE_DRIFT_CORRECT
-    {
-      int32_t s;
-      if(e->drift > cycle_time) {
-        s = e->drift % cycle_time / (e->drift / cycle_time);  /* drift per cycle */
-        s = s * (now - sync) / cycle_time;                    /* estimated drift to now */
-        sync += s;                                            /* add it in */
+    drift_cycle_time = cycle_time;
+    if(e->drift_valid) {
+      /* Move the phase by the drift expected since it was measured */
+      clock_time_t age = clock_time() - e->updated;
+      if(age > PHASE_DRIFT_MAX_INTERVAL) {
+        age = PHASE_DRIFT_MAX_INTERVAL;
       }
+      sync += (int32_t)cycles(age, cycle_time) * e->drift / PHASE_DRIFT_SCALE;
     }
 #endif
 
@@ -234,7 +333,7 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
     }
 
     expected = now + wait - guard_time;
-    if(!RTIMER_CLOCK_LT(expected, now)) {
+    if(busy_wait && !RTIMER_CLOCK_LT(expected, now)) {
       /* Wait until the receiver is expected to be awake */
       while(RTIMER_CLOCK_LT(RTIMER_NOW(), expected));
     }
@@ -243,6 +342,26 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
   return PHASE_UNKNOWN;
 }
 /*---------------------------------------------------------------------------*/
+phase_status_t
+phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
+           rtimer_clock_t guard_time,
+           mac_callback_t mac_callback, void *mac_callback_ptr,
+           struct rdc_buf_list *buf_list)
+{
+  return wait_phase(neighbor, cycle_time, guard_time,
+                    mac_callback, mac_callback_ptr, buf_list, 1);
+}
+/*---------------------------------------------------------------------------*/
+phase_status_t
+phase_defer(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
+            rtimer_clock_t guard_time,
+            mac_callback_t mac_callback, void *mac_callback_ptr,
+            struct rdc_buf_list *buf_list)
+{
+  return wait_phase(neighbor, cycle_time, guard_time,
+                    mac_callback, mac_callback_ptr, buf_list, 0);
+}
+/*---------------------------------------------------------------------------*/
 void
 phase_init(void)
 {
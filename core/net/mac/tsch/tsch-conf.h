@@ -80,6 +80,48 @@
 #define TSCH_HOPPING_SEQUENCE_MAX_LEN 16
 #endif
 
+/* Skip channels with a consistently low ratio of acknowledged transmissions.
+ * The coordinator maintains a channel blacklist from its per-channel link
+ * statistics (requires LINK_STATS_CONF_WITH_CHANNELS) and announces it in
+ * EBs, together with the ASN from which a new blacklist applies. Nodes
+ * then skip blacklisted channels by moving on along the hopping sequence.
+ * Only channels 0 to 31 can be blacklisted. */
+#ifdef TSCH_CONF_WITH_CHANNEL_BLACKLIST
+#define TSCH_WITH_CHANNEL_BLACKLIST TSCH_CONF_WITH_CHANNEL_BLACKLIST
+#else
+#define TSCH_WITH_CHANNEL_BLACKLIST 0
+#endif
+
+/* Interval at which the coordinator updates the blacklist */
+#ifdef TSCH_CONF_CHANNEL_BLACKLIST_PERIOD
+#define TSCH_CHANNEL_BLACKLIST_PERIOD TSCH_CONF_CHANNEL_BLACKLIST_PERIOD
+#else
+#define TSCH_CHANNEL_BLACKLIST_PERIOD (5 * 60 * CLOCK_SECOND)
+#endif
+
+/* Channels below this ratio of acknowledged transmissions are blacklisted,
+ * in LINK_STATS_PRR_DIVISOR units */
+#ifdef TSCH_CONF_CHANNEL_BLACKLIST_PRR_THRESHOLD
+#define TSCH_CHANNEL_BLACKLIST_PRR_THRESHOLD TSCH_CONF_CHANNEL_BLACKLIST_PRR_THRESHOLD
+#else
+#define TSCH_CHANNEL_BLACKLIST_PRR_THRESHOLD (LINK_STATS_PRR_DIVISOR / 2)
+#endif
+
+/* Minimum number of channels never blacklisted */
+#ifdef TSCH_CONF_CHANNEL_BLACKLIST_MIN_CHANNELS
+#define TSCH_CHANNEL_BLACKLIST_MIN_CHANNELS TSCH_CONF_CHANNEL_BLACKLIST_MIN_CHANNELS
+#else
+#define TSCH_CHANNEL_BLACKLIST_MIN_CHANNELS 4
+#endif
+
+/* Number of timeslots between the announcement of a new blacklist and its
+ * use, for the announcement to reach the whole network through EBs */
+#ifdef TSCH_CONF_CHANNEL_BLACKLIST_SWITCH_DELAY
+#define TSCH_CHANNEL_BLACKLIST_SWITCH_DELAY TSCH_CONF_CHANNEL_BLACKLIST_SWITCH_DELAY
+#else
+#define TSCH_CHANNEL_BLACKLIST_SWITCH_DELAY 12000
+#endif
+
 /* Timeslot timing */
 
 #ifndef TSCH_CONF_DEFAULT_TIMESLOT_LENGTH
@@ -198,4 +240,30 @@
 #define TSCH_CHANNEL_SCAN_DURATION CLOCK_SECOND
 #endif
 
+/* Number of EBs kept while scanning, to join the best network heard rather
+ * than the first one. 0 joins on the first valid EB. */
+#ifdef TSCH_CONF_JOIN_EB_CACHE_SIZE
+#define TSCH_JOIN_EB_CACHE_SIZE TSCH_CONF_JOIN_EB_CACHE_SIZE
+#else
+#define TSCH_JOIN_EB_CACHE_SIZE 0
+#endif
+
+/* How long to collect EBs after the first valid one, before joining the best
+ * by join priority and RSSI. The EB timestamps must still be comparable with
+ * RTIMER_NOW() at the end, so this must stay below half the rtimer
+ * wrap-around period (one second with a 16-bit 32768 Hz rtimer). */
+#ifdef TSCH_CONF_JOIN_EB_COLLECT_DURATION
+#define TSCH_JOIN_EB_COLLECT_DURATION TSCH_CONF_JOIN_EB_COLLECT_DURATION
+#else
+#define TSCH_JOIN_EB_COLLECT_DURATION (CLOCK_SECOND / 2)
+#endif
+
+/* Record per-phase slot operation durations and missed deadlines (see
+ * tsch-slot-operation.h), to help tuning the timeslot template of a platform */
+#ifdef TSCH_CONF_SLOT_PROFILE
+#define TSCH_SLOT_PROFILE TSCH_CONF_SLOT_PROFILE
+#else
+#define TSCH_SLOT_PROFILE 0
+#endif
+
 #endif /* __TSCH_CONF_H__ */
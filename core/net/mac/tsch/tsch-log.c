@@ -157,3 +157,37 @@ tsch_log_init(void)
 }
 
 #endif /* TSCH_LOG_LEVEL */
+
+#if TSCH_SLOT_PROFILE
+/*---------------------------------------------------------------------------*/
+/* Print out the slot operation profile. Histogram bin i counts durations
+ * shorter than 2^i rtimer ticks */
+void
+tsch_log_slot_profile(void)
+{
+  int i;
+  int last_bin;
+  int phase;
+
+  printf("TSCH: profile dl-miss %lu rtimer-fail %lu\n",
+         (unsigned long)tsch_slot_profile.deadline_misses,
+         (unsigned long)tsch_slot_profile.rtimer_failures);
+  for(phase = 0; phase < TSCH_SLOT_PROFILE_PHASES; phase++) {
+    const struct tsch_slot_profile_hist *h = &tsch_slot_profile.phase[phase];
+    if(h->count == 0) {
+      continue;
+    }
+    printf("TSCH: profile %s n %lu avg %lu max %lu us, hist",
+           tsch_slot_profile_phase_name(phase),
+           (unsigned long)h->count,
+           (unsigned long)RTIMERTICKS_TO_US(h->total / h->count),
+           (unsigned long)RTIMERTICKS_TO_US(h->max));
+    /* Skip empty bins at the end of the histogram */
+    for(last_bin = TSCH_SLOT_PROFILE_BINS - 1; last_bin > 0 && h->bins[last_bin] == 0; last_bin--);
+    for(i = 0; i <= last_bin; i++) {
+      printf(" %u", h->bins[i]);
+    }
+    printf("\n");
+  }
+}
+#endif /* TSCH_SLOT_PROFILE */
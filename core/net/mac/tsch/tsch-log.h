@@ -135,4 +135,10 @@ void tsch_log_process_pending(void);
 
 #endif /* TSCH_LOG_LEVEL */
 
+#if TSCH_SLOT_PROFILE
+/* Print out the slot operation profile: deadline misses and, for each
+ * phase, sample count, average and max duration (usec), and histogram */
+void tsch_log_slot_profile(void);
+#endif /* TSCH_SLOT_PROFILE */
+
 #endif /* __TSCH_LOG_H__ */
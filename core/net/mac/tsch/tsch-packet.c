@@ -259,6 +259,14 @@ tsch_packet_create_eb(uint8_t *buf, int buf_size,
   }
 #endif /* TSCH_PACKET_EB_WITH_HOPPING_SEQUENCE */
 
+  /* Add channel blacklist IE */
+#if TSCH_WITH_CHANNEL_BLACKLIST
+  ies.ie_channel_blacklist_id = 1;
+  ies.ie_channel_blacklist = tsch_channel_blacklist;
+  ies.ie_channel_blacklist_next = tsch_channel_blacklist_next;
+  ies.ie_channel_blacklist_switch_asn = tsch_channel_blacklist_switch_asn;
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
+
   /* Add Slotframe and Link IE */
 #if TSCH_PACKET_EB_WITH_SLOTFRAME_AND_LINK
   {
@@ -317,6 +325,13 @@ tsch_packet_create_eb(uint8_t *buf, int buf_size,
   }
   curr_len += ret;
 
+  if(ies.ie_channel_blacklist_id != 0) {
+    if((ret = frame80215e_create_ie_tsch_channel_blacklist(buf + curr_len, buf_size - curr_len, &ies)) == -1) {
+      return -1;
+    }
+    curr_len += ret;
+  }
+
   ies.ie_mlme_len = curr_len - mlme_ie_offset - 2;
   if((ret = frame80215e_create_ie_mlme(buf + mlme_ie_offset, buf_size - mlme_ie_offset, &ies)) == -1) {
     return -1;
@@ -86,6 +86,13 @@ extern struct tsch_link *current_link;
 /* TSCH channel hopping sequence */
 extern uint8_t tsch_hopping_sequence[TSCH_HOPPING_SEQUENCE_MAX_LEN];
 extern struct tsch_asn_divisor_t tsch_hopping_sequence_length;
+#if TSCH_WITH_CHANNEL_BLACKLIST
+/* Channels skipped when hopping, bit n for channel n */
+extern uint32_t tsch_channel_blacklist;
+/* The blacklist replacing tsch_channel_blacklist from switch_asn on */
+extern uint32_t tsch_channel_blacklist_next;
+extern struct tsch_asn_t tsch_channel_blacklist_switch_asn;
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
 /* TSCH timeslot timing (in rtimer ticks) */
 extern rtimer_clock_t tsch_timing[tsch_ts_elements_count];
 
@@ -108,6 +115,10 @@ void tsch_disassociate(void);
  * One byte = 32us. Add two bytes for CRC and one for len field */
 #define TSCH_PACKET_DURATION(len) US_TO_RTIMERTICKS(32 * ((len) + 3))
 
+/* Is a channel in a blacklist? Only channels 0 to 31 can be */
+#define TSCH_CHANNEL_IS_BLACKLISTED(blacklist, channel) \
+  ((channel) < 32 && ((blacklist) & ((uint32_t)1 << (channel))))
+
 /* Convert rtimer ticks to clock and vice versa */
 #define TSCH_CLOCK_TO_TICKS(c) (((c) * RTIMER_SECOND) / CLOCK_SECOND)
 #define TSCH_CLOCK_TO_SLOTS(c, timeslot_length) (TSCH_CLOCK_TO_TICKS(c) / timeslot_length)
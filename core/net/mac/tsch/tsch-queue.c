@@ -55,6 +55,9 @@
 #include "net/mac/tsch/tsch-slot-operation.h"
 #include "net/mac/tsch/tsch-log.h"
 #include <string.h>
+#if NETSTACK_CONF_WITH_IPV6 && TSCH_QUEUE_NUM_PRIORITIES > 1
+#include "net/ip/uip.h"
+#endif
 
 #if TSCH_LOG_LEVEL >= 1
 #define DEBUG DEBUG_PRINT
@@ -68,6 +71,10 @@
 #error TSCH_QUEUE_NUM_PER_NEIGHBOR must be power of two
 #endif
 
+#if TSCH_QUEUE_NUM_PRIORITIES < 1 || TSCH_QUEUE_NUM_PRIORITIES > 255
+#error TSCH_QUEUE_NUM_PRIORITIES must be in [1;255]
+#endif
+
 /* We have as many packets are there are queuebuf in the system */
 MEMB(packet_memb, struct tsch_packet, QUEUEBUF_NUM);
 MEMB(neighbor_memb, struct tsch_neighbor, TSCH_QUEUE_MAX_NEIGHBOR_QUEUES);
@@ -77,6 +84,145 @@ LIST(neighbor_list);
 struct tsch_neighbor *n_broadcast;
 struct tsch_neighbor *n_eb;
 
+/*---------------------------------------------------------------------------*/
+/* Are all priority classes of a neighbor queue empty? */
+static int
+nbr_queue_is_empty(const struct tsch_neighbor *n)
+{
+  int i;
+  for(i = 0; i < TSCH_QUEUE_NUM_PRIORITIES; i++) {
+    if(!ringbufindex_empty(&n->tx_ringbuf[i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the priority class of the packet in packetbuf */
+static uint8_t
+packet_priority(void)
+{
+#if TSCH_QUEUE_NUM_PRIORITIES > 1
+#ifdef TSCH_CALLBACK_PACKET_PRIORITY
+  int priority = TSCH_CALLBACK_PACKET_PRIORITY();
+  return MIN(MAX(priority, 0), TSCH_QUEUE_NUM_PRIORITIES - 1);
+#else /* TSCH_CALLBACK_PACKET_PRIORITY */
+  /* EBs, keepalives (empty frames), IE-only frames (e.g. 6P) and ICMPv6
+   * are control traffic */
+  if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) != FRAME802154_DATAFRAME
+     || packetbuf_datalen() == 0
+     || packetbuf_attr(PACKETBUF_ATTR_MAC_METADATA)
+#if NETSTACK_CONF_WITH_IPV6
+     || packetbuf_attr(PACKETBUF_ATTR_NETWORK_ID) == UIP_PROTO_ICMP6
+#endif /* NETSTACK_CONF_WITH_IPV6 */
+     ) {
+    return 0;
+  }
+  return TSCH_QUEUE_NUM_PRIORITIES - 1;
+#endif /* TSCH_CALLBACK_PACKET_PRIORITY */
+#else /* TSCH_QUEUE_NUM_PRIORITIES > 1 */
+  return 0;
+#endif /* TSCH_QUEUE_NUM_PRIORITIES > 1 */
+}
+/*---------------------------------------------------------------------------*/
+/* Select the priority class to serve next and store it in n->tx_priority.
+ * Returns the class, or -1 if all classes are empty */
+static int
+select_priority(struct tsch_neighbor *n)
+{
+#if TSCH_QUEUE_NUM_PRIORITIES > 1
+  int i;
+#ifdef TSCH_QUEUE_PRIORITY_WEIGHTS
+  int first = -1;
+  for(i = 0; i < TSCH_QUEUE_NUM_PRIORITIES; i++) {
+    if(!ringbufindex_empty(&n->tx_ringbuf[i])) {
+      if(n->tx_credits[i] > 0) {
+        n->tx_priority = i;
+        return i;
+      }
+      if(first == -1) {
+        first = i;
+      }
+    }
+  }
+  if(first != -1) {
+    /* All non-empty classes have used up their credits: start a new round */
+    for(i = 0; i < TSCH_QUEUE_NUM_PRIORITIES; i++) {
+      n->tx_credits[i] = TSCH_QUEUE_PRIORITY_WEIGHTS[i];
+    }
+    n->tx_priority = first;
+  }
+  return first;
+#else /* TSCH_QUEUE_PRIORITY_WEIGHTS */
+  for(i = 0; i < TSCH_QUEUE_NUM_PRIORITIES; i++) {
+    if(!ringbufindex_empty(&n->tx_ringbuf[i])) {
+      n->tx_priority = i;
+      return i;
+    }
+  }
+  return -1;
+#endif /* TSCH_QUEUE_PRIORITY_WEIGHTS */
+#else /* TSCH_QUEUE_NUM_PRIORITIES > 1 */
+  return ringbufindex_empty(&n->tx_ringbuf[0]) ? -1 : 0;
+#endif /* TSCH_QUEUE_NUM_PRIORITIES > 1 */
+}
+/*---------------------------------------------------------------------------*/
+#if TSCH_QUEUE_WITH_READY_SET
+/* The ready set is made of two bitmaps indexed by neighbor position in
+ * neighbor_memb. pending_map has a bit set for every neighbor that may
+ * have packets queued, backoff_map for every neighbor in backoff. Both
+ * are only modified from the slot operation or with TSCH locked.
+ * Bits in pending_map are cleared lazily, when the slot operation finds
+ * the queue empty. */
+#define READY_MAP_SIZE ((TSCH_QUEUE_MAX_NEIGHBOR_QUEUES + 7) / 8)
+static uint8_t pending_map[READY_MAP_SIZE];
+static uint8_t backoff_map[READY_MAP_SIZE];
+/* Neighbors that got a new packet are passed from tsch_queue_add_packet
+ * to the slot operation through a lock-free ring of neighbor indices. If
+ * the ring is full, ready_ring_overflow requests a full rescan. */
+#define READY_RING_SIZE 8
+static struct ringbufindex ready_ring;
+static uint8_t ready_ring_array[READY_RING_SIZE];
+static volatile uint8_t ready_ring_overflow;
+
+#define NBR_INDEX(n) ((n) - (struct tsch_neighbor *)neighbor_memb.mem)
+#define MAP_SET(map, i) ((map)[(i) >> 3] |= 1 << ((i) & 7))
+#define MAP_CLEAR(map, i) ((map)[(i) >> 3] &= ~(1 << ((i) & 7)))
+/*---------------------------------------------------------------------------*/
+/* Tell the slot operation that a neighbor has a new packet */
+static void
+ready_set_notify(const struct tsch_neighbor *n)
+{
+  int16_t put_index = ringbufindex_peek_put(&ready_ring);
+  if(put_index != -1) {
+    ready_ring_array[put_index] = NBR_INDEX(n);
+    ringbufindex_put(&ready_ring);
+  } else {
+    ready_ring_overflow = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Move the neighbors from the ready ring to pending_map */
+static void
+ready_set_sync(void)
+{
+  int16_t get_index;
+  if(ready_ring_overflow) {
+    struct tsch_neighbor *n;
+    ready_ring_overflow = 0;
+    for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+      if(!nbr_queue_is_empty(n)) {
+        MAP_SET(pending_map, NBR_INDEX(n));
+      }
+    }
+  }
+  while((get_index = ringbufindex_peek_get(&ready_ring)) != -1) {
+    MAP_SET(pending_map, ready_ring_array[get_index]);
+    ringbufindex_get(&ready_ring);
+  }
+}
+#endif /* TSCH_QUEUE_WITH_READY_SET */
+
 /*---------------------------------------------------------------------------*/
 /* Add a TSCH neighbor */
 struct tsch_neighbor *
@@ -90,9 +236,12 @@ tsch_queue_add_nbr(const linkaddr_t *addr)
       /* Allocate a neighbor */
       n = memb_alloc(&neighbor_memb);
       if(n != NULL) {
+        int i;
         /* Initialize neighbor entry */
         memset(n, 0, sizeof(struct tsch_neighbor));
-        ringbufindex_init(&n->tx_ringbuf, TSCH_QUEUE_NUM_PER_NEIGHBOR);
+        for(i = 0; i < TSCH_QUEUE_NUM_PRIORITIES; i++) {
+          ringbufindex_init(&n->tx_ringbuf[i], TSCH_QUEUE_NUM_PER_NEIGHBOR);
+        }
         linkaddr_copy(&n->addr, addr);
         n->is_broadcast = linkaddr_cmp(addr, &tsch_eb_address)
           || linkaddr_cmp(addr, &tsch_broadcast_address);
@@ -176,6 +325,9 @@ tsch_queue_update_time_source(const linkaddr_t *new_addr)
           old_time_src->is_time_source = 0;
         }
 
+        /* Advertise the new topology quickly */
+        tsch_reset_eb_period();
+
 #ifdef TSCH_CALLBACK_NEW_TIME_SOURCE
         TSCH_CALLBACK_NEW_TIME_SOURCE(old_time_src, new_time_src);
 #endif
@@ -216,6 +368,13 @@ tsch_queue_remove_nbr(struct tsch_neighbor *n)
       /* Remove neighbor from list */
       list_remove(neighbor_list, n);
 
+#if TSCH_QUEUE_WITH_READY_SET
+      /* Make sure the slot operation no longer sees the neighbor */
+      ready_set_sync();
+      MAP_CLEAR(pending_map, NBR_INDEX(n));
+      MAP_CLEAR(backoff_map, NBR_INDEX(n));
+#endif /* TSCH_QUEUE_WITH_READY_SET */
+
       tsch_release_lock();
 
       /* Flush queue */
@@ -233,11 +392,12 @@ tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr)
 {
   struct tsch_neighbor *n = NULL;
   int16_t put_index = -1;
+  uint8_t priority = packet_priority();
   struct tsch_packet *p = NULL;
   if(!tsch_is_locked()) {
     n = tsch_queue_add_nbr(addr);
     if(n != NULL) {
-      put_index = ringbufindex_peek_put(&n->tx_ringbuf);
+      put_index = ringbufindex_peek_put(&n->tx_ringbuf[priority]);
       if(put_index != -1) {
         p = memb_alloc(&packet_memb);
         if(p != NULL) {
@@ -245,17 +405,20 @@ tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr)
 #ifdef TSCH_CALLBACK_PACKET_READY
           TSCH_CALLBACK_PACKET_READY();
 #endif
-          p->qb = queuebuf_new_from_packetbuf();
+          p->qb = queuebuf_take_from_packetbuf();
           if(p->qb != NULL) {
             p->sent = sent;
             p->ptr = ptr;
             p->ret = MAC_TX_DEFERRED;
             p->transmissions = 0;
             /* Add to ringbuf (actual add committed through atomic operation) */
-            n->tx_array[put_index] = p;
-            ringbufindex_put(&n->tx_ringbuf);
-            PRINTF("TSCH-queue: packet is added put_index=%u, packet=%p\n",
-                   put_index, p);
+            n->tx_array[priority][put_index] = p;
+            ringbufindex_put(&n->tx_ringbuf[priority]);
+#if TSCH_QUEUE_WITH_READY_SET
+            ready_set_notify(n);
+#endif /* TSCH_QUEUE_WITH_READY_SET */
+            PRINTF("TSCH-queue: packet is added put_index=%u, priority=%u, packet=%p\n",
+                   put_index, priority, p);
             return p;
           } else {
             memb_free(&packet_memb, p);
@@ -276,7 +439,12 @@ tsch_queue_packet_count(const linkaddr_t *addr)
   if(!tsch_is_locked()) {
     n = tsch_queue_add_nbr(addr);
     if(n != NULL) {
-      return ringbufindex_elements(&n->tx_ringbuf);
+      int i;
+      int count = 0;
+      for(i = 0; i < TSCH_QUEUE_NUM_PRIORITIES; i++) {
+        count += ringbufindex_elements(&n->tx_ringbuf[i]);
+      }
+      return count;
     }
   }
   return -1;
@@ -288,11 +456,22 @@ tsch_queue_remove_packet_from_queue(struct tsch_neighbor *n)
 {
   if(!tsch_is_locked()) {
     if(n != NULL) {
+      int16_t get_index;
+      /* Remove from the class of the packet last returned by tsch_queue_get_packet_for_nbr.
+       * If it is empty (e.g. when flushing), from the next class to be served */
+      if(ringbufindex_empty(&n->tx_ringbuf[n->tx_priority])) {
+        select_priority(n);
+      }
       /* Get and remove packet from ringbuf (remove committed through an atomic operation */
-      int16_t get_index = ringbufindex_get(&n->tx_ringbuf);
+      get_index = ringbufindex_get(&n->tx_ringbuf[n->tx_priority]);
       if(get_index != -1) {
-        PRINTF("TSCH-queue: packet is removed, get_index=%u\n", get_index);
-        return n->tx_array[get_index];
+        PRINTF("TSCH-queue: packet is removed, get_index=%u, priority=%u\n", get_index, n->tx_priority);
+#ifdef TSCH_QUEUE_PRIORITY_WEIGHTS
+        if(n->tx_credits[n->tx_priority] > 0) {
+          n->tx_credits[n->tx_priority]--;
+        }
+#endif /* TSCH_QUEUE_PRIORITY_WEIGHTS */
+        return n->tx_array[n->tx_priority][get_index];
       } else {
         return NULL;
       }
@@ -353,23 +532,25 @@ tsch_queue_free_unused_neighbors(void)
 int
 tsch_queue_is_empty(const struct tsch_neighbor *n)
 {
-  return !tsch_is_locked() && n != NULL && ringbufindex_empty(&n->tx_ringbuf);
+  return !tsch_is_locked() && n != NULL && nbr_queue_is_empty(n);
 }
 /*---------------------------------------------------------------------------*/
-/* Returns the first packet from a neighbor queue */
+/* Returns the first packet from a neighbor queue, from the priority class
+ * to be served next */
 struct tsch_packet *
-tsch_queue_get_packet_for_nbr(const struct tsch_neighbor *n, struct tsch_link *link)
+tsch_queue_get_packet_for_nbr(struct tsch_neighbor *n, struct tsch_link *link)
 {
   if(!tsch_is_locked()) {
     int is_shared_link = link != NULL && link->link_options & LINK_OPTION_SHARED;
     if(n != NULL) {
-      int16_t get_index = ringbufindex_peek_get(&n->tx_ringbuf);
+      int priority = select_priority(n);
+      int16_t get_index = priority == -1 ? -1 : ringbufindex_peek_get(&n->tx_ringbuf[priority]);
       if(get_index != -1 &&
           !(is_shared_link && !tsch_queue_backoff_expired(n))) {    /* If this is a shared link,
                                                                     make sure the backoff has expired */
 #if TSCH_WITH_LINK_SELECTOR
-        int packet_attr_slotframe = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_SLOTFRAME);
-        int packet_attr_timeslot = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_TIMESLOT);
+        int packet_attr_slotframe = queuebuf_attr(n->tx_array[priority][get_index]->qb, PACKETBUF_ATTR_TSCH_SLOTFRAME);
+        int packet_attr_timeslot = queuebuf_attr(n->tx_array[priority][get_index]->qb, PACKETBUF_ATTR_TSCH_TIMESLOT);
         if(packet_attr_slotframe != 0xffff && packet_attr_slotframe != link->slotframe_handle) {
           return NULL;
         }
@@ -377,7 +558,7 @@ tsch_queue_get_packet_for_nbr(const struct tsch_neighbor *n, struct tsch_link *l
           return NULL;
         }
 #endif
-        return n->tx_array[get_index];
+        return n->tx_array[priority][get_index];
       }
     }
   }
@@ -400,6 +581,39 @@ struct tsch_packet *
 tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link)
 {
   if(!tsch_is_locked()) {
+#if TSCH_QUEUE_WITH_READY_SET
+    int is_shared_link = link != NULL && link->link_options & LINK_OPTION_SHARED;
+    struct tsch_neighbor *curr_nbr;
+    struct tsch_packet *p;
+    uint8_t bits;
+    int i, j;
+
+    ready_set_sync();
+    for(i = 0; i < READY_MAP_SIZE; i++) {
+      bits = pending_map[i];
+      if(is_shared_link) {
+        /* Neighbors in backoff may not use shared links */
+        bits &= ~backoff_map[i];
+      }
+      for(j = 0; bits != 0; j++, bits >>= 1) {
+        if(bits & 1) {
+          curr_nbr = (struct tsch_neighbor *)neighbor_memb.mem + i * 8 + j;
+          if(curr_nbr->is_broadcast || nbr_queue_is_empty(curr_nbr)) {
+            MAP_CLEAR(pending_map, i * 8 + j);
+          } else if(curr_nbr->tx_links_count == 0) {
+            /* Only look up for non-broadcast neighbors we do not have a tx link to */
+            p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
+            if(p != NULL) {
+              if(n != NULL) {
+                *n = curr_nbr;
+              }
+              return p;
+            }
+          }
+        }
+      }
+    }
+#else /* TSCH_QUEUE_WITH_READY_SET */
     struct tsch_neighbor *curr_nbr = list_head(neighbor_list);
     struct tsch_packet *p = NULL;
     while(curr_nbr != NULL) {
@@ -415,6 +629,7 @@ tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link
       }
       curr_nbr = list_item_next(curr_nbr);
     }
+#endif /* TSCH_QUEUE_WITH_READY_SET */
   }
   return NULL;
 }
@@ -432,6 +647,9 @@ tsch_queue_backoff_reset(struct tsch_neighbor *n)
 {
   n->backoff_window = 0;
   n->backoff_exponent = TSCH_MAC_MIN_BE;
+#if TSCH_QUEUE_WITH_READY_SET
+  MAP_CLEAR(backoff_map, NBR_INDEX(n));
+#endif /* TSCH_QUEUE_WITH_READY_SET */
 }
 /*---------------------------------------------------------------------------*/
 /* Increment backoff exponent, pick a new window */
@@ -447,6 +665,9 @@ tsch_queue_backoff_inc(struct tsch_neighbor *n)
   /* Add one to the window as we will decrement it at the end of the current slot
    * through tsch_queue_update_all_backoff_windows */
   n->backoff_window++;
+#if TSCH_QUEUE_WITH_READY_SET
+  MAP_SET(backoff_map, NBR_INDEX(n));
+#endif /* TSCH_QUEUE_WITH_READY_SET */
 }
 /*---------------------------------------------------------------------------*/
 /* Decrement backoff window for all queues directed at dest_addr */
@@ -461,6 +682,12 @@ tsch_queue_update_all_backoff_windows(const linkaddr_t *dest_addr)
          && ((n->tx_links_count == 0 && is_broadcast)
              || (n->tx_links_count > 0 && linkaddr_cmp(dest_addr, &n->addr)))) {
         n->backoff_window--;
+#if TSCH_QUEUE_WITH_READY_SET
+        if(n->backoff_window == 0) {
+          /* Backoff expired, the neighbor may use shared links again */
+          MAP_CLEAR(backoff_map, NBR_INDEX(n));
+        }
+#endif /* TSCH_QUEUE_WITH_READY_SET */
       }
       n = list_item_next(n);
     }
@@ -474,6 +701,12 @@ tsch_queue_init(void)
   list_init(neighbor_list);
   memb_init(&neighbor_memb);
   memb_init(&packet_memb);
+#if TSCH_QUEUE_WITH_READY_SET
+  memset(pending_map, 0, sizeof(pending_map));
+  memset(backoff_map, 0, sizeof(backoff_map));
+  ringbufindex_init(&ready_ring, READY_RING_SIZE);
+  ready_ring_overflow = 0;
+#endif /* TSCH_QUEUE_WITH_READY_SET */
   /* Add virtual EB and the broadcast neighbors */
   n_eb = tsch_queue_add_nbr(&tsch_eb_address);
   n_broadcast = tsch_queue_add_nbr(&tsch_broadcast_address);
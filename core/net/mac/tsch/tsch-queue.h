@@ -77,6 +77,34 @@
 #define TSCH_QUEUE_MAX_NEIGHBOR_QUEUES ((NBR_TABLE_CONF_MAX_NEIGHBORS) + 2)
 #endif
 
+/* Keep a set of the neighbors that have packets queued, so that
+ * tsch_queue_get_unicast_packet_for_any only visits those neighbors
+ * instead of walking the whole neighbor list */
+#ifdef TSCH_QUEUE_CONF_WITH_READY_SET
+#define TSCH_QUEUE_WITH_READY_SET TSCH_QUEUE_CONF_WITH_READY_SET
+#else
+#define TSCH_QUEUE_WITH_READY_SET 0
+#endif
+
+/* The number of priority classes of each neighbor queue. Every class has
+ * its own ringbuf of TSCH_QUEUE_NUM_PER_NEIGHBOR packets. Class 0 has the
+ * highest priority. With more than one class, control traffic (EBs,
+ * keepalives, ICMPv6 incl. RPL and ND) goes to class 0 and everything else
+ * to the last class, unless TSCH_CALLBACK_PACKET_PRIORITY is defined */
+#ifdef TSCH_QUEUE_CONF_NUM_PRIORITIES
+#define TSCH_QUEUE_NUM_PRIORITIES TSCH_QUEUE_CONF_NUM_PRIORITIES
+#else
+#define TSCH_QUEUE_NUM_PRIORITIES 1
+#endif
+
+/* By default, priority classes are served in strict priority order.
+ * Define as an array with one weight per class, e.g. (uint8_t[]){ 4, 1 },
+ * to serve them in weighted round-robin instead: in every round, class i
+ * may send up to weight[i] packets before lower classes are served */
+#ifdef TSCH_QUEUE_CONF_PRIORITY_WEIGHTS
+#define TSCH_QUEUE_PRIORITY_WEIGHTS TSCH_QUEUE_CONF_PRIORITY_WEIGHTS
+#endif
+
 /* TSCH CSMA-CA parameters, see IEEE 802.15.4e-2012 */
 /* Min backoff exponent */
 #ifdef TSCH_CONF_MAC_MIN_BE
@@ -110,6 +138,12 @@ void TSCH_CALLBACK_NEW_TIME_SOURCE(const struct tsch_neighbor *old, const struct
 void TSCH_CALLBACK_PACKET_READY(void);
 #endif
 
+/* Called by TSCH before adding the packet in packetbuf to a neighbor queue.
+ * Returns the priority class of the packet, in [0;TSCH_QUEUE_NUM_PRIORITIES[ */
+#ifdef TSCH_CALLBACK_PACKET_PRIORITY
+int TSCH_CALLBACK_PACKET_PRIORITY(void);
+#endif
+
 /************ Types ***********/
 
 /* TSCH packet information */
@@ -135,11 +169,15 @@ struct tsch_neighbor {
   uint8_t last_backoff_window; /* Last CSMA backoff window */
   uint8_t tx_links_count; /* How many links do we have to this neighbor? */
   uint8_t dedicated_tx_links_count; /* How many dedicated links do we have to this neighbor? */
-  /* Array for the ringbuf. Contains pointers to packets.
-   * Its size must be a power of two to allow for atomic put */
-  struct tsch_packet *tx_array[TSCH_QUEUE_NUM_PER_NEIGHBOR];
-  /* Circular buffer of pointers to packet. */
-  struct ringbufindex tx_ringbuf;
+  uint8_t tx_priority; /* Priority class of the packet last returned by tsch_queue_get_packet_for_nbr */
+#ifdef TSCH_QUEUE_PRIORITY_WEIGHTS
+  uint8_t tx_credits[TSCH_QUEUE_NUM_PRIORITIES]; /* Packets each class may still send in the current round */
+#endif
+  /* Arrays for the ringbufs, one per priority class. Contain pointers to packets.
+   * Their size must be a power of two to allow for atomic put */
+  struct tsch_packet *tx_array[TSCH_QUEUE_NUM_PRIORITIES][TSCH_QUEUE_NUM_PER_NEIGHBOR];
+  /* Circular buffers of pointers to packet, one per priority class. */
+  struct ringbufindex tx_ringbuf[TSCH_QUEUE_NUM_PRIORITIES];
 };
 
 /***** External Variables *****/
@@ -160,9 +198,10 @@ struct tsch_neighbor *tsch_queue_get_time_source(void);
 int tsch_queue_update_time_source(const linkaddr_t *new_addr);
 /* Add packet to neighbor queue. Use same lockfree implementation as ringbuf.c (put is atomic) */
 struct tsch_packet *tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr);
-/* Returns the number of packets currently a given neighbor queue */
+/* Returns the number of packets currently a given neighbor queue (all classes) */
 int tsch_queue_packet_count(const linkaddr_t *addr);
-/* Remove first packet from a neighbor queue. The packet is stored in a separate
+/* Remove first packet from a neighbor queue, in the priority class of the packet
+ * last returned by tsch_queue_get_packet_for_nbr. The packet is stored in a separate
  * dequeued packet list, for later processing. Return the packet. */
 struct tsch_packet *tsch_queue_remove_packet_from_queue(struct tsch_neighbor *n);
 /* Free a packet */
@@ -173,8 +212,9 @@ void tsch_queue_reset(void);
 void tsch_queue_free_unused_neighbors(void);
 /* Is the neighbor queue empty? */
 int tsch_queue_is_empty(const struct tsch_neighbor *n);
-/* Returns the first packet from a neighbor queue */
-struct tsch_packet *tsch_queue_get_packet_for_nbr(const struct tsch_neighbor *n, struct tsch_link *link);
+/* Returns the first packet from a neighbor queue, from the priority class
+ * to be served next */
+struct tsch_packet *tsch_queue_get_packet_for_nbr(struct tsch_neighbor *n, struct tsch_link *link);
 /* Returns the head packet from a neighbor queue (from neighbor address) */
 struct tsch_packet *tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr, struct tsch_link *link);
 /* Returns the head packet of any neighbor queue with zero backoff counter.
@@ -40,6 +40,7 @@
 #include "contiki.h"
 #include "net/rpl/rpl.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-snapshot.h"
 #include "net/mac/tsch/tsch.h"
 #include "net/mac/tsch/tsch-private.h"
 #include "net/mac/tsch/tsch-schedule.h"
@@ -54,10 +55,16 @@
 #include "net/net-debug.h"
 
 /*---------------------------------------------------------------------------*/
-/* To use, set #define TSCH_CALLBACK_JOINING_NETWORK tsch_rpl_callback_joining_network */
+/* Upon joining a TSCH network, rejoin the RPL DAG saved before a reboot,
+ * if RPL_SNAPSHOT_CONF_RESTORE_AT_INIT is 0. The preferred parent then
+ * becomes the time source.
+ * To use, set #define TSCH_CALLBACK_JOINING_NETWORK tsch_rpl_callback_joining_network */
 void
 tsch_rpl_callback_joining_network(void)
 {
+#if RPL_WITH_SNAPSHOT && !RPL_SNAPSHOT_RESTORE_AT_INIT
+  rpl_snapshot_restore();
+#endif /* RPL_WITH_SNAPSHOT && !RPL_SNAPSHOT_RESTORE_AT_INIT */
 }
 /*---------------------------------------------------------------------------*/
 /* Upon leaving a TSCH network, perform a local repair
@@ -86,6 +93,13 @@ tsch_rpl_callback_new_dio_interval(uint8_t dio_interval)
     }
     /* Set EB period */
     tsch_set_eb_period((CLOCK_SECOND * 1UL << dag->instance->dio_intcurrent) / 1000);
+#if TSCH_EB_TRICKLE
+    /* RPL reset its DIO timer (DIS from a joining node, inconsistency):
+     * reset the EB period as well */
+    if(dio_interval == dag->instance->dio_intmin) {
+      tsch_reset_eb_period();
+    }
+#endif /* TSCH_EB_TRICKLE */
     /* Set join priority based on RPL rank */
     tsch_set_join_priority(DAG_RANK(dag->rank, dag->instance) - 1);
   } else {
@@ -69,6 +69,63 @@ MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
 
+#if TSCH_SCHEDULE_WITH_CACHE
+/* The links of all slotframes, grouped by slotframe and sorted by timeslot
+ * within each slotframe */
+static struct tsch_link *schedule_cache[TSCH_SCHEDULE_MAX_LINKS];
+/*---------------------------------------------------------------------------*/
+/* Rebuilds the schedule cache. Must be called with the TSCH lock held,
+ * after any change to the links or slotframes */
+static void
+schedule_cache_rebuild(void)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  uint16_t offset = 0;
+  uint16_t i;
+
+  for(sf = list_head(slotframe_list); sf != NULL; sf = list_item_next(sf)) {
+    sf->cache_offset = offset;
+    sf->cache_len = 0;
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+      /* Insertion sort by timeslot */
+      i = offset + sf->cache_len;
+      while(i > offset && schedule_cache[i - 1]->timeslot > l->timeslot) {
+        schedule_cache[i] = schedule_cache[i - 1];
+        i--;
+      }
+      schedule_cache[i] = l;
+      sf->cache_len++;
+    }
+    offset += sf->cache_len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the first link of a slotframe that occurs after a given timeslot,
+ * wrapping around at the end of the slotframe */
+static struct tsch_link *
+schedule_cache_next_link(struct tsch_slotframe *sf, uint16_t timeslot)
+{
+  uint16_t lo = 0;
+  uint16_t hi = sf->cache_len;
+  uint16_t mid;
+  struct tsch_link **links = &schedule_cache[sf->cache_offset];
+
+  if(sf->cache_len == 0) {
+    return NULL;
+  }
+  while(lo < hi) {
+    mid = (lo + hi) / 2;
+    if(links[mid]->timeslot > timeslot) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo < sf->cache_len ? links[lo] : links[0];
+}
+#endif /* TSCH_SCHEDULE_WITH_CACHE */
+
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
 tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
@@ -91,6 +148,9 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       LIST_STRUCT_INIT(sf, links_list);
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
+#if TSCH_SCHEDULE_WITH_CACHE
+      schedule_cache_rebuild();
+#endif /* TSCH_SCHEDULE_WITH_CACHE */
     }
     PRINTF("TSCH-schedule: add_slotframe %u %u\n",
            handle, size);
@@ -129,6 +189,9 @@ tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe)
       PRINTF("TSCH-schedule: remove slotframe %u %u\n", slotframe->handle, slotframe->size.val);
       memb_free(&slotframe_memb, slotframe);
       list_remove(slotframe_list, slotframe);
+#if TSCH_SCHEDULE_WITH_CACHE
+      schedule_cache_rebuild();
+#endif /* TSCH_SCHEDULE_WITH_CACHE */
       tsch_release_lock();
       return 1;
     }
@@ -209,6 +272,9 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
           address = &linkaddr_null;
         }
         linkaddr_copy(&l->addr, address);
+#if TSCH_SCHEDULE_WITH_CACHE
+        schedule_cache_rebuild();
+#endif /* TSCH_SCHEDULE_WITH_CACHE */
 
         PRINTF("TSCH-schedule: add_link %u %u %u %u %u %u\n",
                slotframe->handle, link_options, link_type, timeslot, channel_offset, TSCH_LOG_ID_FROM_LINKADDR(address));
@@ -257,6 +323,9 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
 
       list_remove(slotframe->links_list, l);
       memb_free(&link_memb, l);
+#if TSCH_SCHEDULE_WITH_CACHE
+      schedule_cache_rebuild();
+#endif /* TSCH_SCHEDULE_WITH_CACHE */
 
       /* Release the lock before we update the neighbor (will take the lock) */
       tsch_release_lock();
@@ -325,7 +394,13 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
       uint16_t timeslot = TSCH_ASN_MOD(*asn, sf->size);
+#if TSCH_SCHEDULE_WITH_CACHE
+      /* Timeslots are unique within a slotframe, so the first link after
+       * the current timeslot is the only candidate of this slotframe */
+      struct tsch_link *l = schedule_cache_next_link(sf, timeslot);
+#else /* TSCH_SCHEDULE_WITH_CACHE */
       struct tsch_link *l = list_head(sf->links_list);
+#endif /* TSCH_SCHEDULE_WITH_CACHE */
       while(l != NULL) {
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
@@ -369,7 +444,11 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
           }
         }
 
+#if TSCH_SCHEDULE_WITH_CACHE
+        l = NULL;
+#else /* TSCH_SCHEDULE_WITH_CACHE */
         l = list_item_next(l);
+#endif /* TSCH_SCHEDULE_WITH_CACHE */
       }
       sf = list_item_next(sf);
     }
@@ -391,6 +470,9 @@ tsch_schedule_init(void)
     memb_init(&link_memb);
     memb_init(&slotframe_memb);
     list_init(slotframe_list);
+#if TSCH_SCHEDULE_WITH_CACHE
+    schedule_cache_rebuild();
+#endif /* TSCH_SCHEDULE_WITH_CACHE */
     tsch_release_lock();
     return 1;
   } else {
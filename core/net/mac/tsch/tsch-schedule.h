@@ -72,6 +72,16 @@
 #define TSCH_SCHEDULE_MAX_LINKS 32
 #endif
 
+/* Keep, for each slotframe, an array of its links sorted by timeslot.
+ * The array is rebuilt whenever the schedule changes, and lets
+ * tsch_schedule_get_next_active_link run a binary search per slotframe
+ * instead of iterating over all links. */
+#ifdef TSCH_SCHEDULE_CONF_WITH_CACHE
+#define TSCH_SCHEDULE_WITH_CACHE TSCH_SCHEDULE_CONF_WITH_CACHE
+#else
+#define TSCH_SCHEDULE_WITH_CACHE 0
+#endif
+
 /********** Constants *********/
 
 /* Link options */
@@ -122,6 +132,11 @@ struct tsch_slotframe {
   struct tsch_asn_divisor_t size;
   /* List of links belonging to this slotframe */
   LIST_STRUCT(links_list);
+#if TSCH_SCHEDULE_WITH_CACHE
+  /* Position and number of this slotframe's links in the schedule cache */
+  uint16_t cache_offset;
+  uint16_t cache_len;
+#endif /* TSCH_SCHEDULE_WITH_CACHE */
 };
 
 /********** Functions *********/
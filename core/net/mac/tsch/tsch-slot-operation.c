@@ -54,6 +54,8 @@
 #include "net/mac/tsch/tsch-packet.h"
 #include "net/mac/tsch/tsch-security.h"
 #include "net/mac/tsch/tsch-adaptive-timesync.h"
+#include "net/link-stats.h"
+#include <string.h>
 #if CONTIKI_TARGET_COOJA || CONTIKI_TARGET_COOJA_IP64
 #include "lib/simEnvChange.h"
 #include "sys/cooja_mt.h"
@@ -138,6 +140,20 @@ struct tsch_packet *dequeued_array[TSCH_DEQUEUED_ARRAY_SIZE];
 struct ringbufindex input_ringbuf;
 struct input_packet input_array[TSCH_MAX_INCOMING_PACKETS];
 
+#if TSCH_SLOT_PROFILE
+struct tsch_slot_profile tsch_slot_profile;
+/* Start a timed phase: save the current time in t0 */
+#define TSCH_SLOT_PROFILE_START(t0) ((t0) = RTIMER_NOW())
+/* Stop a timed phase and add its duration to the phase histogram */
+#define TSCH_SLOT_PROFILE_STOP(phase, t0) \
+  slot_profile_add((phase), RTIMER_CLOCK_DIFF(RTIMER_NOW(), (t0)))
+#define TSCH_SLOT_PROFILE_COUNT(counter) (tsch_slot_profile.counter++)
+#else /* TSCH_SLOT_PROFILE */
+#define TSCH_SLOT_PROFILE_START(t0)
+#define TSCH_SLOT_PROFILE_STOP(phase, t0)
+#define TSCH_SLOT_PROFILE_COUNT(counter)
+#endif /* TSCH_SLOT_PROFILE */
+
 /* Last time we received Sync-IE (ACK or data packet from a time source) */
 static struct tsch_asn_t last_sync_asn;
 
@@ -164,6 +180,14 @@ static volatile int tsch_in_slot_operation = 0;
 /* If we are inside a slot, this tells the current channel */
 static uint8_t current_channel;
 
+#if LINK_STATS_WITH_CHANNELS
+/* Per-channel unicast transmission attempts and ACKs. Only incremented
+ * from interrupt, and consumed from process context by difference with
+ * the last values seen, so no locking is needed */
+static uint8_t channel_tx_count[LINK_STATS_NUM_CHANNELS];
+static uint8_t channel_ack_count[LINK_STATS_NUM_CHANNELS];
+#endif /* LINK_STATS_WITH_CHANNELS */
+
 /* Info about the link, packet and neighbor of
  * the current (or next) slot */
 struct tsch_link *current_link = NULL;
@@ -252,9 +276,84 @@ tsch_calculate_channel(struct tsch_asn_t *asn, uint8_t channel_offset)
 {
   uint16_t index_of_0 = TSCH_ASN_MOD(*asn, tsch_hopping_sequence_length);
   uint16_t index_of_offset = (index_of_0 + channel_offset) % tsch_hopping_sequence_length.val;
+#if TSCH_WITH_CHANNEL_BLACKLIST
+  uint16_t i;
+  /* Skip blacklisted channels, moving on along the hopping sequence */
+  for(i = 0; i < tsch_hopping_sequence_length.val
+      && TSCH_CHANNEL_IS_BLACKLISTED(tsch_channel_blacklist, tsch_hopping_sequence[index_of_offset]);
+      i++) {
+    index_of_offset = (index_of_offset + 1) % tsch_hopping_sequence_length.val;
+  }
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
   return tsch_hopping_sequence[index_of_offset];
 }
+/*---------------------------------------------------------------------------*/
+#if LINK_STATS_WITH_CHANNELS
+/* Report the transmissions since the last call to link-stats */
+void
+tsch_update_channel_stats(void)
+{
+  static uint8_t last_tx_count[LINK_STATS_NUM_CHANNELS];
+  static uint8_t last_ack_count[LINK_STATS_NUM_CHANNELS];
+  uint8_t tx_count;
+  uint8_t ack_count;
+  int i;
+
+  for(i = 0; i < LINK_STATS_NUM_CHANNELS; i++) {
+    /* ACKs first: an attempt is always counted before its ACK */
+    ack_count = channel_ack_count[i];
+    tx_count = channel_tx_count[i];
+    if(tx_count != last_tx_count[i]) {
+      link_stats_channel_packet_sent(LINK_STATS_FIRST_CHANNEL + i,
+                                     (uint8_t)(tx_count - last_tx_count[i]),
+                                     (uint8_t)(ack_count - last_ack_count[i]));
+      last_tx_count[i] = tx_count;
+      last_ack_count[i] = ack_count;
+    }
+  }
+}
+#endif /* LINK_STATS_WITH_CHANNELS */
 
+/*---------------------------------------------------------------------------*/
+#if TSCH_SLOT_PROFILE
+/* Add a sample to the histogram of a slot operation phase.
+ * Called from interrupt: no division, only shifts */
+static void
+slot_profile_add(enum tsch_slot_profile_phase phase, int32_t duration)
+{
+  struct tsch_slot_profile_hist *h = &tsch_slot_profile.phase[phase];
+  uint32_t d = duration > 0 ? (uint32_t)duration : 0;
+  uint8_t bin = 0;
+
+  while(d != 0 && bin < TSCH_SLOT_PROFILE_BINS - 1) {
+    d >>= 1;
+    bin++;
+  }
+  h->count++;
+  h->total += duration > 0 ? duration : 0;
+  if(duration > 0 && (rtimer_clock_t)duration > h->max) {
+    h->max = duration;
+  }
+  if(h->bins[bin] != 0xffff) {
+    h->bins[bin]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_slot_profile_reset(void)
+{
+  memset(&tsch_slot_profile, 0, sizeof(tsch_slot_profile));
+}
+/*---------------------------------------------------------------------------*/
+const char *
+tsch_slot_profile_phase_name(enum tsch_slot_profile_phase phase)
+{
+  static const char *names[TSCH_SLOT_PROFILE_PHASES] = {
+    "prepare", "cca", "tx", "ack-wait", "decrypt"
+  };
+  return phase < TSCH_SLOT_PROFILE_PHASES ? names[phase] : "?";
+}
+#endif /* TSCH_SLOT_PROFILE */
 /*---------------------------------------------------------------------------*/
 /* Timing utility functions */
 
@@ -292,6 +391,7 @@ tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_
   int missed = check_timer_miss(ref_time, offset - RTIMER_GUARD, now);
 
   if(missed) {
+    TSCH_SLOT_PROFILE_COUNT(deadline_misses);
     TSCH_LOG_ADD(tsch_log_message,
                 snprintf(log->message, sizeof(log->message),
                     "!dl-miss %s %d %d",
@@ -303,6 +403,7 @@ tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_
   ref_time += offset;
   r = rtimer_set(tm, ref_time, 1, (void (*)(struct rtimer *, void *))tsch_slot_operation, NULL);
   if(r != RTIMER_OK) {
+    TSCH_SLOT_PROFILE_COUNT(rtimer_failures);
     return 0;
   }
   return 1;
@@ -509,6 +610,12 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 #if CCA_ENABLED
       static uint8_t cca_status;
 #endif
+#if TSCH_SLOT_PROFILE
+      static rtimer_clock_t profile_start;
+#endif
+
+      ENERGEST_SET_CLASS(queuebuf_attr(current_packet->qb,
+                                       PACKETBUF_ATTR_ENERGEST_CLASS));
 
       /* get payload */
       packet = queuebuf_dataptr(current_packet->qb);
@@ -541,15 +648,20 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
       if(packet_ready && NETSTACK_RADIO.prepare(packet, packet_len) == 0) { /* 0 means success */
         static rtimer_clock_t tx_duration;
 
+        /* The prepare phase is accounted from the start of the slot */
+        TSCH_SLOT_PROFILE_STOP(TSCH_SLOT_PROFILE_PREPARE, current_slot_start);
+
 #if CCA_ENABLED
         cca_status = 1;
         /* delay before CCA */
         TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, TS_CCA_OFFSET, "cca");
         TSCH_DEBUG_TX_EVENT();
+        TSCH_SLOT_PROFILE_START(profile_start);
         tsch_radio_on(TSCH_RADIO_CMD_ON_WITHIN_TIMESLOT);
         /* CCA */
         BUSYWAIT_UNTIL_ABS(!(cca_status |= NETSTACK_RADIO.channel_clear()),
                            current_slot_start, TS_CCA_OFFSET + TS_CCA);
+        TSCH_SLOT_PROFILE_STOP(TSCH_SLOT_PROFILE_CCA, profile_start);
         TSCH_DEBUG_TX_EVENT();
         /* there is not enough time to turn radio off */
         /*  NETSTACK_RADIO.off(); */
@@ -562,7 +674,9 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
           TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_tx_offset] - RADIO_DELAY_BEFORE_TX, "TxBeforeTx");
           TSCH_DEBUG_TX_EVENT();
           /* send packet already in radio tx buffer */
+          TSCH_SLOT_PROFILE_START(profile_start);
           mac_tx_status = NETSTACK_RADIO.transmit(packet_len);
+          TSCH_SLOT_PROFILE_STOP(TSCH_SLOT_PROFILE_TX, profile_start);
           /* Save tx timestamp */
           tx_start_time = current_slot_start + tsch_timing[tsch_ts_tx_offset];
           /* calculate TX duration based on sent packet len */
@@ -592,6 +706,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
               TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start,
                   tsch_timing[tsch_ts_tx_offset] + tx_duration + tsch_timing[tsch_ts_rx_ack_delay] - RADIO_DELAY_BEFORE_RX, "TxBeforeAck");
               TSCH_DEBUG_TX_EVENT();
+              TSCH_SLOT_PROFILE_START(profile_start);
               tsch_radio_on(TSCH_RADIO_CMD_ON_WITHIN_TIMESLOT);
               /* Wait for ACK to come */
               BUSYWAIT_UNTIL_ABS(NETSTACK_RADIO.receiving_packet(),
@@ -603,6 +718,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
               /* Wait for ACK to finish */
               BUSYWAIT_UNTIL_ABS(!NETSTACK_RADIO.receiving_packet(),
                                  ack_start_time, tsch_timing[tsch_ts_max_ack]);
+              TSCH_SLOT_PROFILE_STOP(TSCH_SLOT_PROFILE_ACK_WAIT, profile_start);
               TSCH_DEBUG_TX_EVENT();
               tsch_radio_off(TSCH_RADIO_CMD_OFF_WITHIN_TIMESLOT);
 
@@ -626,8 +742,12 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 
 #if LLSEC802154_ENABLED
                 if(ack_len != 0) {
-                  if(!tsch_security_parse_frame(ackbuf, ack_hdrlen, ack_len - ack_hdrlen - tsch_security_mic_len(&frame),
-                      &frame, &current_neighbor->addr, &tsch_current_asn)) {
+                  int ack_valid;
+                  TSCH_SLOT_PROFILE_START(profile_start);
+                  ack_valid = tsch_security_parse_frame(ackbuf, ack_hdrlen, ack_len - ack_hdrlen - tsch_security_mic_len(&frame),
+                      &frame, &current_neighbor->addr, &tsch_current_asn);
+                  TSCH_SLOT_PROFILE_STOP(TSCH_SLOT_PROFILE_DECRYPT, profile_start);
+                  if(!ack_valid) {
                     TSCH_LOG_ADD(tsch_log_message,
                         snprintf(log->message, sizeof(log->message),
                         "!failed to authenticate ACK"));
@@ -679,6 +799,19 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
     }
 
     tsch_radio_off(TSCH_RADIO_CMD_OFF_END_OF_TIMESLOT);
+    ENERGEST_SET_CLASS(ENERGEST_CLASS_OTHER);
+
+#if LINK_STATS_WITH_CHANNELS
+    if(!current_neighbor->is_broadcast
+       && (mac_tx_status == MAC_TX_OK || mac_tx_status == MAC_TX_NOACK)
+       && current_channel >= LINK_STATS_FIRST_CHANNEL
+       && current_channel < LINK_STATS_FIRST_CHANNEL + LINK_STATS_NUM_CHANNELS) {
+      channel_tx_count[current_channel - LINK_STATS_FIRST_CHANNEL]++;
+      if(mac_tx_status == MAC_TX_OK) {
+        channel_ack_count[current_channel - LINK_STATS_FIRST_CHANNEL]++;
+      }
+    }
+#endif /* LINK_STATS_WITH_CHANNELS */
 
     current_packet->transmissions++;
     current_packet->ret = mac_tx_status;
@@ -751,6 +884,9 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
     static rtimer_clock_t expected_rx_time;
     static rtimer_clock_t packet_duration;
     uint8_t packet_seen;
+#if TSCH_SLOT_PROFILE && LLSEC802154_ENABLED
+    rtimer_clock_t profile_start;
+#endif
 
     expected_rx_time = current_slot_start + tsch_timing[tsch_ts_tx_offset];
     /* Default start time: expected Rx time */
@@ -811,15 +947,17 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 #if LLSEC802154_ENABLED
         /* Decrypt and verify incoming frame */
         if(frame_valid) {
-          if(tsch_security_parse_frame(
+          TSCH_SLOT_PROFILE_START(profile_start);
+          frame_valid = tsch_security_parse_frame(
                current_input->payload, header_len, current_input->len - header_len - tsch_security_mic_len(&frame),
-               &frame, &source_address, &tsch_current_asn)) {
+               &frame, &source_address, &tsch_current_asn);
+          TSCH_SLOT_PROFILE_STOP(TSCH_SLOT_PROFILE_DECRYPT, profile_start);
+          if(frame_valid) {
             current_input->len -= tsch_security_mic_len(&frame);
           } else {
             TSCH_LOG_ADD(tsch_log_message,
                 snprintf(log->message, sizeof(log->message),
                 "!failed to authenticate frame %u", current_input->len));
-            frame_valid = 0;
           }
         } else {
           TSCH_LOG_ADD(tsch_log_message,
@@ -971,6 +1109,13 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
       }
       is_active_slot = current_packet != NULL || (current_link->link_options & LINK_OPTION_RX);
       if(is_active_slot) {
+#if TSCH_WITH_CHANNEL_BLACKLIST
+        /* Time to use the last announced blacklist? */
+        if(tsch_channel_blacklist != tsch_channel_blacklist_next
+           && (int32_t)TSCH_ASN_DIFF(tsch_current_asn, tsch_channel_blacklist_switch_asn) >= 0) {
+          tsch_channel_blacklist = tsch_channel_blacklist_next;
+        }
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
         /* Hop channel */
         current_channel = tsch_calculate_channel(&tsch_current_asn, current_link->channel_offset);
         NETSTACK_RADIO.set_value(RADIO_PARAM_CHANNEL, current_channel);
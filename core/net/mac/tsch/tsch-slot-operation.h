@@ -74,6 +74,14 @@
 #define TSCH_MAX_INCOMING_PACKETS 4
 #endif
 
+/* Number of bins of each slot profile histogram. Bin i counts durations
+ * of [2^(i-1);2^i[ rtimer ticks, the last bin also counts anything longer */
+#ifdef TSCH_SLOT_PROFILE_CONF_BINS
+#define TSCH_SLOT_PROFILE_BINS TSCH_SLOT_PROFILE_CONF_BINS
+#else
+#define TSCH_SLOT_PROFILE_BINS 16
+#endif
+
 /*********** Callbacks *********/
 
 /* Called by TSCH form interrupt after receiving a frame, enabled upper-layer to decide
@@ -93,6 +101,31 @@ struct input_packet {
   uint8_t channel; /* Channel we received the packet on */
 };
 
+/* Slot operation phases timed by the slot profiler */
+enum tsch_slot_profile_phase {
+  TSCH_SLOT_PROFILE_PREPARE, /* Tx: from slot start until the frame is in the radio buffer */
+  TSCH_SLOT_PROFILE_CCA, /* Tx: clear channel assessment */
+  TSCH_SLOT_PROFILE_TX, /* Tx: radio transmit call */
+  TSCH_SLOT_PROFILE_ACK_WAIT, /* Tx: from radio on until the end of the ACK (or timeout) */
+  TSCH_SLOT_PROFILE_DECRYPT, /* Tx and Rx: authenticating/decrypting ACKs and frames */
+  TSCH_SLOT_PROFILE_PHASES
+};
+
+/* Duration histogram of a slot operation phase, in rtimer ticks */
+struct tsch_slot_profile_hist {
+  uint32_t count; /* Number of samples */
+  uint32_t total; /* Sum of all samples */
+  rtimer_clock_t max; /* Longest sample */
+  uint16_t bins[TSCH_SLOT_PROFILE_BINS];
+};
+
+/* Slot operation profile */
+struct tsch_slot_profile {
+  struct tsch_slot_profile_hist phase[TSCH_SLOT_PROFILE_PHASES];
+  uint32_t deadline_misses; /* Wakeups that could not be scheduled in time */
+  uint32_t rtimer_failures; /* Wakeups rejected by rtimer_set */
+};
+
 /***** External Variables *****/
 
 /* A ringbuf storing outgoing packets after they were dequeued.
@@ -103,11 +136,17 @@ extern struct tsch_packet *dequeued_array[TSCH_DEQUEUED_ARRAY_SIZE];
  * Will be processed layer by tsch_rx_process_pending */
 extern struct ringbufindex input_ringbuf;
 extern struct input_packet input_array[TSCH_MAX_INCOMING_PACKETS];
+#if TSCH_SLOT_PROFILE
+/* Profile of the slot operation since boot or last reset */
+extern struct tsch_slot_profile tsch_slot_profile;
+#endif /* TSCH_SLOT_PROFILE */
 
 /********** Functions *********/
 
 /* Returns a 802.15.4 channel from an ASN and channel offset */
 uint8_t tsch_calculate_channel(struct tsch_asn_t *asn, uint8_t channel_offset);
+/* Report per-channel transmission outcomes to link-stats. Call from process context */
+void tsch_update_channel_stats(void);
 /* Is TSCH locked? */
 int tsch_is_locked(void);
 /* Lock TSCH (no link operation) */
@@ -120,5 +159,11 @@ void tsch_slot_operation_sync(rtimer_clock_t next_slot_start,
     struct tsch_asn_t *next_slot_asn);
 /* Start actual slot operation */
 void tsch_slot_operation_start(void);
+#if TSCH_SLOT_PROFILE
+/* Clear all slot profile histograms and counters */
+void tsch_slot_profile_reset(void);
+/* Returns the name of a slot profile phase */
+const char *tsch_slot_profile_phase_name(enum tsch_slot_profile_phase phase);
+#endif /* TSCH_SLOT_PROFILE */
 
 #endif /* __TSCH_SLOT_OPERATION_H__ */
@@ -55,12 +55,17 @@
 #include "net/mac/tsch/tsch-packet.h"
 #include "net/mac/tsch/tsch-security.h"
 #include "net/mac/mac-sequence.h"
+#include "net/link-stats.h"
 #include "lib/random.h"
 
 #if FRAME802154_VERSION < FRAME802154_IEEE802154E_2012
 #error TSCH: FRAME802154_VERSION must be at least FRAME802154_IEEE802154E_2012
 #endif
 
+#if TSCH_WITH_CHANNEL_BLACKLIST && !LINK_STATS_WITH_CHANNELS
+#error TSCH_CONF_WITH_CHANNEL_BLACKLIST requires LINK_STATS_CONF_WITH_CHANNELS
+#endif
+
 #if TSCH_LOG_LEVEL >= 1
 #define DEBUG DEBUG_PRINT
 #else /* TSCH_LOG_LEVEL */
@@ -92,6 +97,16 @@ NBR_TABLE(struct eb_stat, eb_stats);
 uint8_t tsch_hopping_sequence[TSCH_HOPPING_SEQUENCE_MAX_LEN];
 struct tsch_asn_divisor_t tsch_hopping_sequence_length;
 
+#if TSCH_WITH_CHANNEL_BLACKLIST
+/* Bitmap of the channels currently skipped by the hopping sequence */
+uint32_t tsch_channel_blacklist;
+/* Blacklist to switch to at tsch_channel_blacklist_switch_asn */
+uint32_t tsch_channel_blacklist_next;
+struct tsch_asn_t tsch_channel_blacklist_switch_asn;
+/* Coordinator only: timer for periodic blacklist recomputation */
+static struct timer channel_blacklist_timer;
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
+
 /* Default TSCH timeslot timing (in micro-second) */
 static const uint16_t tsch_default_timing_us[tsch_ts_elements_count] = {
   TSCH_DEFAULT_TS_CCA_OFFSET,
@@ -139,6 +154,12 @@ uint8_t tsch_join_priority;
 static uint8_t tsch_packet_seqno = 0;
 /* Current period for EB output */
 static clock_time_t tsch_current_eb_period;
+#if TSCH_EB_TRICKLE
+/* Current trickle period for EB output */
+static clock_time_t eb_trickle_period = TSCH_EB_PERIOD;
+/* Number of consistent EBs heard during the current trickle period */
+static uint8_t eb_trickle_heard;
+#endif /* TSCH_EB_TRICKLE */
 /* Current period for keepalive output */
 static clock_time_t tsch_current_ka_timeout;
 
@@ -173,7 +194,10 @@ tsch_set_pan_secured(int enable)
 void
 tsch_set_join_priority(uint8_t jp)
 {
-  tsch_join_priority = jp;
+  if(jp != tsch_join_priority) {
+    tsch_join_priority = jp;
+    tsch_reset_eb_period();
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -188,6 +212,18 @@ tsch_set_eb_period(uint32_t period)
   tsch_current_eb_period = MIN(period, TSCH_MAX_EB_PERIOD);
 }
 /*---------------------------------------------------------------------------*/
+void
+tsch_reset_eb_period(void)
+{
+#if TSCH_EB_TRICKLE
+  /* As in Trickle, nothing to do if already at the shortest period */
+  if(eb_trickle_period > TSCH_EB_PERIOD) {
+    eb_trickle_period = TSCH_EB_PERIOD;
+    process_poll(&tsch_send_eb_process);
+  }
+#endif /* TSCH_EB_TRICKLE */
+}
+/*---------------------------------------------------------------------------*/
 static void
 tsch_reset(void)
 {
@@ -201,7 +237,7 @@ tsch_reset(void)
   tsch_queue_free_unused_neighbors();
   tsch_queue_update_time_source(NULL);
   /* Initialize global variables */
-  tsch_join_priority = 0xff;
+  tsch_set_join_priority(0xff);
   TSCH_ASN_INIT(tsch_current_asn, 0, 0);
   current_link = NULL;
   /* Reset timeslot timing to defaults */
@@ -216,7 +252,104 @@ tsch_reset(void)
   nbr_table_register(eb_stats, NULL);
   tsch_set_eb_period(TSCH_EB_PERIOD);
 #endif
+#if TSCH_WITH_CHANNEL_BLACKLIST
+  tsch_channel_blacklist = 0;
+  tsch_channel_blacklist_next = 0;
+  TSCH_ASN_INIT(tsch_channel_blacklist_switch_asn, 0, 0);
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
+}
+
+#if TSCH_WITH_CHANNEL_BLACKLIST
+/* TSCH channel blacklist functions */
+
+/*---------------------------------------------------------------------------*/
+/* Coordinator only: blacklist the channels of the hopping sequence with a
+ * low ratio of acknowledged transmissions, and announce the new blacklist
+ * for use TSCH_CHANNEL_BLACKLIST_SWITCH_DELAY timeslots later */
+static void
+update_channel_blacklist(void)
+{
+  uint32_t in_sequence = 0;
+  uint32_t blacklist = 0;
+  uint32_t reprobe;
+  int num_channels = 0;
+  int i;
+
+  /* Channels of the hopping sequence that can be blacklisted */
+  for(i = 0; i < tsch_hopping_sequence_length.val; i++) {
+    uint8_t channel = tsch_hopping_sequence[i];
+    if(channel < 32 && !(in_sequence & ((uint32_t)1 << channel))) {
+      in_sequence |= (uint32_t)1 << channel;
+      num_channels++;
+    }
+  }
+
+  /* Remove the worst channel first, as long as enough channels are left */
+  while(num_channels > TSCH_CHANNEL_BLACKLIST_MIN_CHANNELS) {
+    int worst = -1;
+    uint16_t worst_prr = TSCH_CHANNEL_BLACKLIST_PRR_THRESHOLD;
+    for(i = 0; i < 32; i++) {
+      const struct link_stats_channel *stats = link_stats_from_channel(i);
+      if((in_sequence & ~blacklist & ((uint32_t)1 << i))
+         && link_stats_channel_is_fresh(stats) && stats->prr < worst_prr) {
+        worst = i;
+        worst_prr = stats->prr;
+      }
+    }
+    if(worst < 0) {
+      break;
+    }
+    blacklist |= (uint32_t)1 << worst;
+    num_channels--;
+  }
+
+  /* Channels leaving the blacklist start over with fresh statistics */
+  reprobe = tsch_channel_blacklist_next & ~blacklist;
+  for(i = 0; i < 32; i++) {
+    if(reprobe & ((uint32_t)1 << i)) {
+      link_stats_channel_reset(i);
+    }
+  }
+
+  if(blacklist != tsch_channel_blacklist_next && tsch_get_lock()) {
+    PRINTF("TSCH: new channel blacklist %08lx\n", (unsigned long)blacklist);
+    tsch_channel_blacklist_next = blacklist;
+    tsch_channel_blacklist_switch_asn = tsch_current_asn;
+    TSCH_ASN_INC(tsch_channel_blacklist_switch_asn, TSCH_CHANNEL_BLACKLIST_SWITCH_DELAY);
+    tsch_release_lock();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Adopt the channel blacklist announced in an EB. An EB without blacklist
+ * means no channel is blacklisted. An EB queued before its sender switched
+ * blacklists carries the old one, but the slot operation switches again
+ * as soon as the switch ASN is past. */
+static void
+channel_blacklist_from_eb(const struct ieee802154_ies *ies)
+{
+  uint32_t blacklist = 0;
+  uint32_t next = 0;
+  struct tsch_asn_t switch_asn;
+
+  TSCH_ASN_INIT(switch_asn, 0, 0);
+  if(ies->ie_channel_blacklist_id != 0) {
+    blacklist = ies->ie_channel_blacklist;
+    next = ies->ie_channel_blacklist_next;
+    switch_asn = ies->ie_channel_blacklist_switch_asn;
+  }
+  if(blacklist != tsch_channel_blacklist
+     || next != tsch_channel_blacklist_next
+     || switch_asn.ls4b != tsch_channel_blacklist_switch_asn.ls4b
+     || switch_asn.ms1b != tsch_channel_blacklist_switch_asn.ms1b) {
+    if(tsch_get_lock()) {
+      tsch_channel_blacklist = blacklist;
+      tsch_channel_blacklist_next = next;
+      tsch_channel_blacklist_switch_asn = switch_asn;
+      tsch_release_lock();
+    }
+  }
 }
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
 
 /* TSCH keep-alive functions */
 
@@ -242,6 +375,9 @@ keepalive_send()
     /* Simply send an empty packet */
     packetbuf_clear();
     packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &n->addr);
+#if ENERGEST_CONF_CLASSES
+    packetbuf_set_attr(PACKETBUF_ATTR_ENERGEST_CLASS, ENERGEST_CLASS_MAC);
+#endif /* ENERGEST_CONF_CLASSES */
     NETSTACK_LLSEC.send(keepalive_packet_sent, NULL);
     PRINTF("TSCH: sending KA to %u\n",
            TSCH_LOG_ID_FROM_LINKADDR(&n->addr));
@@ -301,11 +437,19 @@ eb_input(struct input_packet *current_input)
       /* Update time source */
       if(best_stat != NULL) {
         tsch_queue_update_time_source(nbr_table_get_lladdr(eb_stats, best_stat));
-        tsch_join_priority = best_stat->jp + 1;
+        tsch_set_join_priority(best_stat->jp + 1);
       }
     }
 #endif
 
+#if TSCH_EB_TRICKLE
+    /* An EB from a node at least as close to the coordinator is consistent */
+    if(tsch_is_associated && eb_ies.ie_join_priority <= tsch_join_priority
+       && eb_trickle_heard < 0xff) {
+      eb_trickle_heard++;
+    }
+#endif /* TSCH_EB_TRICKLE */
+
     struct tsch_neighbor *n = tsch_queue_get_time_source();
     /* Did the EB come from our time source? */
     if(n != NULL && linkaddr_cmp((linkaddr_t *)&frame.src_addr, &n->addr)) {
@@ -328,10 +472,16 @@ eb_input(struct input_packet *current_input)
         if(tsch_join_priority != eb_ies.ie_join_priority + 1) {
           PRINTF("TSCH: update JP from EB %u -> %u\n",
                  tsch_join_priority, eb_ies.ie_join_priority + 1);
-          tsch_join_priority = eb_ies.ie_join_priority + 1;
+          tsch_set_join_priority(eb_ies.ie_join_priority + 1);
         }
 #endif /* TSCH_AUTOSELECT_TIME_SOURCE */
       }
+
+#if TSCH_WITH_CHANNEL_BLACKLIST
+      if(tsch_is_associated) {
+        channel_blacklist_from_eb(&eb_ies);
+      }
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
     }
   }
 }
@@ -408,6 +558,9 @@ tsch_start_coordinator(void)
 
   tsch_is_associated = 1;
   tsch_join_priority = 0;
+#if TSCH_WITH_CHANNEL_BLACKLIST
+  timer_set(&channel_blacklist_timer, TSCH_CHANNEL_BLACKLIST_PERIOD);
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
 
   PRINTF("TSCH: starting as coordinator, PAN ID %x, asn-%x.%lx\n",
       frame802154_get_pan_id(), tsch_current_asn.ms1b, tsch_current_asn.ls4b);
@@ -427,42 +580,36 @@ tsch_disassociate(void)
   }
 }
 /*---------------------------------------------------------------------------*/
-/* Attempt to associate to a network form an incoming EB */
+/* Parse and authenticate an incoming EB, and check that it is one we may
+ * join. Authentication may modify the packet in place. */
 static int
-tsch_associate(const struct input_packet *input_eb, rtimer_clock_t timestamp)
+eb_is_joinable(struct input_packet *input_eb, frame802154_t *frame,
+               struct ieee802154_ies *ies, uint8_t *hdrlen)
 {
-  frame802154_t frame;
-  struct ieee802154_ies ies;
-  uint8_t hdrlen;
-  int i;
-
   if(input_eb == NULL || tsch_packet_parse_eb(input_eb->payload, input_eb->len,
-                                              &frame, &ies, &hdrlen, 0) == 0) {
+                                              frame, ies, hdrlen, 0) == 0) {
     PRINTF("TSCH:! failed to parse EB (len %u)\n", input_eb->len);
     return 0;
   }
 
-  tsch_current_asn = ies.ie_asn;
-  tsch_join_priority = ies.ie_join_priority + 1;
-
 #if TSCH_JOIN_SECURED_ONLY
-  if(frame.fcf.security_enabled == 0) {
+  if(frame->fcf.security_enabled == 0) {
     PRINTF("TSCH:! parse_eb: EB is not secured\n");
     return 0;
   }
 #endif /* TSCH_JOIN_SECURED_ONLY */
   
 #if LLSEC802154_ENABLED
-  if(!tsch_security_parse_frame(input_eb->payload, hdrlen,
-      input_eb->len - hdrlen - tsch_security_mic_len(&frame),
-      &frame, (linkaddr_t*)&frame.src_addr, &tsch_current_asn)) {
+  if(!tsch_security_parse_frame(input_eb->payload, *hdrlen,
+      input_eb->len - *hdrlen - tsch_security_mic_len(frame),
+      frame, (linkaddr_t*)&frame->src_addr, &ies->ie_asn)) {
     PRINTF("TSCH:! parse_eb: failed to authenticate\n");
     return 0;
   }
 #endif /* LLSEC802154_ENABLED */
 
 #if !LLSEC802154_ENABLED
-  if(frame.fcf.security_enabled == 1) {
+  if(frame->fcf.security_enabled == 1) {
     PRINTF("TSCH:! parse_eb: we do not support security, but EB is secured\n");
     return 0;
   }
@@ -470,18 +617,37 @@ tsch_associate(const struct input_packet *input_eb, rtimer_clock_t timestamp)
 
 #if TSCH_JOIN_MY_PANID_ONLY
   /* Check if the EB comes from the PAN ID we expect */
-  if(frame.src_pid != IEEE802154_PANID) {
-    PRINTF("TSCH:! parse_eb: PAN ID %x != %x\n", frame.src_pid, IEEE802154_PANID);
+  if(frame->src_pid != IEEE802154_PANID) {
+    PRINTF("TSCH:! parse_eb: PAN ID %x != %x\n", frame->src_pid, IEEE802154_PANID);
     return 0;
   }
 #endif /* TSCH_JOIN_MY_PANID_ONLY */
 
   /* There was no join priority (or 0xff) in the EB, do not join */
-  if(ies.ie_join_priority == 0xff) {
+  if(ies->ie_join_priority == 0xff) {
     PRINTF("TSCH:! parse_eb: no join priority\n");
     return 0;
   }
 
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Attempt to associate to a network form an incoming EB */
+static int
+tsch_associate(struct input_packet *input_eb, rtimer_clock_t timestamp)
+{
+  frame802154_t frame;
+  struct ieee802154_ies ies;
+  uint8_t hdrlen;
+  int i;
+
+  if(!eb_is_joinable(input_eb, &frame, &ies, &hdrlen)) {
+    return 0;
+  }
+
+  tsch_current_asn = ies.ie_asn;
+  tsch_join_priority = ies.ie_join_priority + 1;
+
   /* TSCH timeslot timing */
   for(i = 0; i < tsch_ts_elements_count; i++) {
     if(ies.ie_tsch_timeslot_id == 0) {
@@ -505,6 +671,11 @@ tsch_associate(const struct input_packet *input_eb, rtimer_clock_t timestamp)
     }
   }
 
+#if TSCH_WITH_CHANNEL_BLACKLIST
+  /* TSCH channel blacklist */
+  channel_blacklist_from_eb(&ies);
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
+
 #if TSCH_CHECK_TIME_AT_ASSOCIATION > 0
   /* Divide by 4k and multiply again to avoid integer overflow */
   uint32_t expected_asn = 4096 * TSCH_CLOCK_TO_SLOTS(clock_time() / 4096, tsch_timing_timeslot_length); /* Expected ASN based on our current time*/
@@ -593,6 +764,115 @@ tsch_associate(const struct input_packet *input_eb, rtimer_clock_t timestamp)
   return 0;
 }
 
+#if TSCH_JOIN_EB_CACHE_SIZE > 0
+/* EBs heard while scanning, of which the best one is joined at the end
+ * of the collection period */
+struct eb_candidate {
+  struct input_packet eb;
+  rtimer_clock_t timestamp;
+  linkaddr_t src;
+  uint8_t join_priority;
+  uint8_t in_use;
+};
+static struct eb_candidate eb_candidates[TSCH_JOIN_EB_CACHE_SIZE];
+/*---------------------------------------------------------------------------*/
+/* Tells whether joining through a neighbor with the given join priority and
+ * RSSI is better than joining through candidate c */
+static int
+eb_candidate_is_better(uint8_t join_priority, int16_t rssi,
+                       const struct eb_candidate *c)
+{
+  return join_priority < c->join_priority ||
+    (join_priority == c->join_priority && rssi > c->eb.rssi);
+}
+/*---------------------------------------------------------------------------*/
+/* Keep a joinable EB as candidate, replacing an older EB from the same
+ * neighbor, or the worst candidate if the cache is full.
+ * Returns 1 if the EB was kept. */
+static int
+eb_cache_add(const struct input_packet *input_eb, rtimer_clock_t timestamp)
+{
+  /* Authentication may modify the packet, so check a copy and keep the
+   * original, to be checked again when joining */
+  static struct input_packet scratch;
+  frame802154_t frame;
+  struct ieee802154_ies ies;
+  uint8_t hdrlen;
+  struct eb_candidate *c = NULL;
+  int i;
+
+  memcpy(&scratch, input_eb, sizeof(struct input_packet));
+  if(!eb_is_joinable(&scratch, &frame, &ies, &hdrlen)) {
+    return 0;
+  }
+
+  /* Replace the EB of the same neighbor, else use a free entry */
+  for(i = 0; i < TSCH_JOIN_EB_CACHE_SIZE && c == NULL; i++) {
+    if(eb_candidates[i].in_use &&
+       linkaddr_cmp(&eb_candidates[i].src, (linkaddr_t *)&frame.src_addr)) {
+      c = &eb_candidates[i];
+    }
+  }
+  for(i = 0; i < TSCH_JOIN_EB_CACHE_SIZE && c == NULL; i++) {
+    if(!eb_candidates[i].in_use) {
+      c = &eb_candidates[i];
+    }
+  }
+  if(c == NULL) {
+    /* Full: replace the worst candidate, if this one is better */
+    c = &eb_candidates[0];
+    for(i = 1; i < TSCH_JOIN_EB_CACHE_SIZE; i++) {
+      if(eb_candidate_is_better(c->join_priority, c->eb.rssi, &eb_candidates[i])) {
+        c = &eb_candidates[i];
+      }
+    }
+    if(!eb_candidate_is_better(ies.ie_join_priority, input_eb->rssi, c)) {
+      return 0;
+    }
+  }
+
+  memcpy(&c->eb, input_eb, sizeof(struct input_packet));
+  c->timestamp = timestamp;
+  linkaddr_copy(&c->src, (linkaddr_t *)&frame.src_addr);
+  c->join_priority = ies.ie_join_priority;
+  c->in_use = 1;
+  PRINTF("TSCH: association: EB candidate jp %u rssi %d channel %u\n",
+         c->join_priority, c->eb.rssi, c->eb.channel);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Associate through the best candidate, falling back to the next best ones
+ * if that fails. Empties the cache. */
+static int
+eb_cache_join(void)
+{
+  struct eb_candidate *best;
+  int i;
+
+  while(!tsch_is_associated) {
+    best = NULL;
+    for(i = 0; i < TSCH_JOIN_EB_CACHE_SIZE; i++) {
+      if(eb_candidates[i].in_use &&
+         (best == NULL ||
+          eb_candidate_is_better(eb_candidates[i].join_priority,
+                                 eb_candidates[i].eb.rssi, best))) {
+        best = &eb_candidates[i];
+      }
+    }
+    if(best == NULL) {
+      break;
+    }
+    best->in_use = 0;
+    tsch_associate(&best->eb, best->timestamp);
+  }
+
+  for(i = 0; i < TSCH_JOIN_EB_CACHE_SIZE; i++) {
+    eb_candidates[i].in_use = 0;
+  }
+  return tsch_is_associated;
+}
+#endif /* TSCH_JOIN_EB_CACHE_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
 /* Processes and protothreads used by TSCH */
 
 /*---------------------------------------------------------------------------*/
@@ -608,6 +888,12 @@ PT_THREAD(tsch_scan(struct pt *pt))
   static struct etimer scan_timer;
   /* Time when we started scanning on current_channel */
   static clock_time_t current_channel_since;
+#if TSCH_JOIN_EB_CACHE_SIZE > 0
+  /* Time when the first EB candidate was kept, if collecting */
+  static clock_time_t collecting_since;
+  static uint8_t collecting;
+  radio_value_t radio_last_rssi;
+#endif /* TSCH_JOIN_EB_CACHE_SIZE > 0 */
 
   TSCH_ASN_INIT(tsch_current_asn, 0, 0);
 
@@ -656,8 +942,25 @@ PT_THREAD(tsch_scan(struct pt *pt))
       /* Parse EB and attempt to associate */
       PRINTF("TSCH: association: received packet (%u bytes) on channel %u\n", input_eb.len, current_channel);
 
+#if TSCH_JOIN_EB_CACHE_SIZE > 0
+      NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_RSSI, &radio_last_rssi);
+      input_eb.rssi = (signed)radio_last_rssi;
+      input_eb.channel = current_channel;
+      if(eb_cache_add(&input_eb, t0) && !collecting) {
+        collecting = 1;
+        collecting_since = clock_time();
+      }
+#else /* TSCH_JOIN_EB_CACHE_SIZE > 0 */
       tsch_associate(&input_eb, t0);
+#endif /* TSCH_JOIN_EB_CACHE_SIZE > 0 */
+    }
+
+#if TSCH_JOIN_EB_CACHE_SIZE > 0
+    if(collecting && clock_time() - collecting_since >= TSCH_JOIN_EB_COLLECT_DURATION) {
+      collecting = 0;
+      eb_cache_join();
     }
+#endif /* TSCH_JOIN_EB_CACHE_SIZE > 0 */
 
     if(tsch_is_associated) {
       /* End of association, turn the radio off */
@@ -706,11 +1009,54 @@ PROCESS_THREAD(tsch_process, ev, data)
   PROCESS_END();
 }
 
+/*---------------------------------------------------------------------------*/
+/* Prepare an EB and enqueue it, unless there is already one in queue */
+static void
+eb_enqueue(void)
+{
+  if(tsch_queue_packet_count(&tsch_eb_address) == 0) {
+    int eb_len;
+    uint8_t hdr_len = 0;
+    uint8_t tsch_sync_ie_offset;
+    /* Prepare the EB packet and schedule it to be sent */
+    packetbuf_clear();
+    packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_BEACONFRAME);
+#if ENERGEST_CONF_CLASSES
+    packetbuf_set_attr(PACKETBUF_ATTR_ENERGEST_CLASS, ENERGEST_CLASS_BEACON);
+#endif /* ENERGEST_CONF_CLASSES */
+#if LLSEC802154_ENABLED
+    if(tsch_is_pan_secured) {
+      /* Set security level, key id and index */
+      packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, TSCH_SECURITY_KEY_SEC_LEVEL_EB);
+      packetbuf_set_attr(PACKETBUF_ATTR_KEY_ID_MODE, FRAME802154_1_BYTE_KEY_ID_MODE); /* Use 1-byte key index */
+      packetbuf_set_attr(PACKETBUF_ATTR_KEY_INDEX, TSCH_SECURITY_KEY_INDEX_EB);
+    }
+#endif /* LLSEC802154_ENABLED */
+    eb_len = tsch_packet_create_eb(packetbuf_dataptr(), PACKETBUF_SIZE,
+        &hdr_len, &tsch_sync_ie_offset);
+    if(eb_len > 0) {
+      struct tsch_packet *p;
+      packetbuf_set_datalen(eb_len);
+      /* Enqueue EB packet */
+      if(!(p = tsch_queue_add_packet(&tsch_eb_address, NULL, NULL))) {
+        PRINTF("TSCH:! could not enqueue EB packet\n");
+      } else {
+        PRINTF("TSCH: enqueue EB packet %u %u\n", eb_len, hdr_len);
+        p->tsch_sync_ie_offset = tsch_sync_ie_offset;
+        p->header_len = hdr_len;
+      }
+    }
+  }
+}
 /*---------------------------------------------------------------------------*/
 /* A periodic process to send TSCH Enhanced Beacons (EB) */
 PROCESS_THREAD(tsch_send_eb_process, ev, data)
 {
   static struct etimer eb_timer;
+#if TSCH_EB_TRICKLE
+  static clock_time_t period;
+  static clock_time_t t;
+#endif /* TSCH_EB_TRICKLE */
 
   PROCESS_BEGIN();
 
@@ -721,6 +1067,36 @@ PROCESS_THREAD(tsch_send_eb_process, ev, data)
     etimer_reset(&eb_timer);
   }
 
+#if TSCH_EB_TRICKLE
+  while(1) {
+    if(tsch_current_eb_period > 0) {
+      /* Send the EB at a random time in the second half of the period,
+       * unless enough neighbors already advertised the network */
+      period = eb_trickle_period;
+      t = period / 2 + random_rand() % (period / 2);
+      eb_trickle_heard = 0;
+      etimer_set(&eb_timer, t);
+      PROCESS_WAIT_UNTIL(etimer_expired(&eb_timer) || ev == PROCESS_EVENT_POLL);
+      if(ev == PROCESS_EVENT_POLL) {
+        /* Reset: start over with the shortest period */
+        continue;
+      }
+      if(tsch_is_associated
+         && (TSCH_EB_TRICKLE_K == 0 || eb_trickle_heard < TSCH_EB_TRICKLE_K)) {
+        eb_enqueue();
+      }
+      etimer_set(&eb_timer, period - t);
+      PROCESS_WAIT_UNTIL(etimer_expired(&eb_timer) || ev == PROCESS_EVENT_POLL);
+      if(ev == PROCESS_EVENT_POLL) {
+        continue;
+      }
+      eb_trickle_period = MIN(2 * period, TSCH_MAX_EB_PERIOD);
+    } else {
+      etimer_set(&eb_timer, TSCH_EB_PERIOD);
+      PROCESS_WAIT_UNTIL(etimer_expired(&eb_timer));
+    }
+  }
+#else /* TSCH_EB_TRICKLE */
   /* Set an initial delay except for coordinator, which should send an EB asap */
   if(!tsch_is_coordinator) {
     etimer_set(&eb_timer, random_rand() % TSCH_EB_PERIOD);
@@ -731,37 +1107,7 @@ PROCESS_THREAD(tsch_send_eb_process, ev, data)
     unsigned long delay;
 
     if(tsch_is_associated && tsch_current_eb_period > 0) {
-      /* Enqueue EB only if there isn't already one in queue */
-      if(tsch_queue_packet_count(&tsch_eb_address) == 0) {
-        int eb_len;
-        uint8_t hdr_len = 0;
-        uint8_t tsch_sync_ie_offset;
-        /* Prepare the EB packet and schedule it to be sent */
-        packetbuf_clear();
-        packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_BEACONFRAME);
-#if LLSEC802154_ENABLED
-        if(tsch_is_pan_secured) {
-          /* Set security level, key id and index */
-          packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, TSCH_SECURITY_KEY_SEC_LEVEL_EB);
-          packetbuf_set_attr(PACKETBUF_ATTR_KEY_ID_MODE, FRAME802154_1_BYTE_KEY_ID_MODE); /* Use 1-byte key index */
-          packetbuf_set_attr(PACKETBUF_ATTR_KEY_INDEX, TSCH_SECURITY_KEY_INDEX_EB);
-        }
-#endif /* LLSEC802154_ENABLED */
-        eb_len = tsch_packet_create_eb(packetbuf_dataptr(), PACKETBUF_SIZE,
-            &hdr_len, &tsch_sync_ie_offset);
-        if(eb_len > 0) {
-          struct tsch_packet *p;
-          packetbuf_set_datalen(eb_len);
-          /* Enqueue EB packet */
-          if(!(p = tsch_queue_add_packet(&tsch_eb_address, NULL, NULL))) {
-            PRINTF("TSCH:! could not enqueue EB packet\n");
-          } else {
-            PRINTF("TSCH: enqueue EB packet %u %u\n", eb_len, hdr_len);
-            p->tsch_sync_ie_offset = tsch_sync_ie_offset;
-            p->header_len = hdr_len;
-          }
-        }
-      }
+      eb_enqueue();
     }
     if(tsch_current_eb_period > 0) {
       /* Next EB transmission with a random delay
@@ -774,6 +1120,7 @@ PROCESS_THREAD(tsch_send_eb_process, ev, data)
     etimer_set(&eb_timer, delay);
     PROCESS_WAIT_UNTIL(etimer_expired(&eb_timer));
   }
+#endif /* TSCH_EB_TRICKLE */
   PROCESS_END();
 }
 
@@ -788,6 +1135,16 @@ PROCESS_THREAD(tsch_pending_events_process, ev, data)
     tsch_rx_process_pending();
     tsch_tx_process_pending();
     tsch_log_process_pending();
+#if LINK_STATS_WITH_CHANNELS
+    tsch_update_channel_stats();
+#endif /* LINK_STATS_WITH_CHANNELS */
+#if TSCH_WITH_CHANNEL_BLACKLIST
+    if(tsch_is_coordinator && tsch_is_associated
+       && timer_expired(&channel_blacklist_timer)) {
+      update_channel_blacklist();
+      timer_restart(&channel_blacklist_timer);
+    }
+#endif /* TSCH_WITH_CHANNEL_BLACKLIST */
   }
   PROCESS_END();
 }
@@ -978,7 +1335,14 @@ packet_input(void)
       PRINTF("TSCH: received from %u with seqno %u\n",
              TSCH_LOG_ID_FROM_LINKADDR(packetbuf_addr(PACKETBUF_ADDR_SENDER)),
              packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
-      NETSTACK_LLSEC.input();
+      if(packetbuf_attr(PACKETBUF_ATTR_MAC_METADATA)) {
+        /* Payload IEs, not for the upper layers */
+#ifdef TSCH_CALLBACK_PAYLOAD_IE_INPUT
+        TSCH_CALLBACK_PAYLOAD_IE_INPUT();
+#endif
+      } else {
+        NETSTACK_LLSEC.input();
+      }
     }
   }
 }
@@ -78,6 +78,24 @@
 #define TSCH_MAX_EB_PERIOD (50 * CLOCK_SECOND)
 #endif
 
+/* Trickle-like EB period: start at TSCH_EB_PERIOD, double after every
+ * period up to TSCH_MAX_EB_PERIOD, and go back to TSCH_EB_PERIOD upon
+ * topology changes (new time source or join priority, leaving the network)
+ * or when tsch_reset_eb_period() is called */
+#ifdef TSCH_CONF_EB_TRICKLE
+#define TSCH_EB_TRICKLE TSCH_CONF_EB_TRICKLE
+#else
+#define TSCH_EB_TRICKLE 0
+#endif
+
+/* With TSCH_EB_TRICKLE: skip our EB when we heard this many EBs with a join
+ * priority not worse than ours during the current period. 0: never skip */
+#ifdef TSCH_CONF_EB_TRICKLE_K
+#define TSCH_EB_TRICKLE_K TSCH_CONF_EB_TRICKLE_K
+#else
+#define TSCH_EB_TRICKLE_K 0
+#endif
+
 /* Max acceptable join priority */
 #ifdef TSCH_CONF_MAX_JOIN_PRIORITY
 #define TSCH_MAX_JOIN_PRIORITY TSCH_CONF_MAX_JOIN_PRIORITY
@@ -157,6 +175,13 @@ void TSCH_CALLBACK_JOINING_NETWORK();
 void TSCH_CALLBACK_LEAVING_NETWORK();
 #endif
 
+/* Called by TSCH, from process context, when receiving a data frame with
+ * payload IEs (PACKETBUF_ATTR_MAC_METADATA set), e.g. a 6P message.
+ * Such frames are not passed to the upper layers */
+#ifdef TSCH_CALLBACK_PAYLOAD_IE_INPUT
+void TSCH_CALLBACK_PAYLOAD_IE_INPUT(void);
+#endif
+
 /***** External Variables *****/
 
 /* Are we coordinator of the TSCH network? */
@@ -172,8 +197,11 @@ extern const struct mac_driver tschmac_driver;
 
 /* The the TSCH join priority */
 void tsch_set_join_priority(uint8_t jp);
-/* The period at which EBs are sent */
+/* The period at which EBs are sent. With TSCH_EB_TRICKLE, 0 stops
+ * EBs and any other value lets the trickle period run */
 void tsch_set_eb_period(uint32_t period);
+/* Go back to the shortest EB period (with TSCH_EB_TRICKLE only) */
+void tsch_reset_eb_period(void);
 /* The keep-alive timeout */
 void tsch_set_ka_timeout(uint32_t timeout);
 /* Set the node as PAN coordinator */
@@ -83,6 +83,31 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_WITH_HASH
+/* The hash index is an open-addressing table with linear probing that
+ * maps link-layer addresses to neighbor indices. Slots hold the index
+ * plus one, so that zero marks an empty slot. The table is kept at most
+ * half full, so that probe sequences stay short. */
+#if NBR_TABLE_MAX_NEIGHBORS > 254
+#error "NBR_TABLE_CONF_WITH_HASH supports at most 254 neighbors"
+#endif
+#if NBR_TABLE_MAX_NEIGHBORS <= 8
+#define NBR_TABLE_HASH_SIZE 16
+#elif NBR_TABLE_MAX_NEIGHBORS <= 16
+#define NBR_TABLE_HASH_SIZE 32
+#elif NBR_TABLE_MAX_NEIGHBORS <= 32
+#define NBR_TABLE_HASH_SIZE 64
+#elif NBR_TABLE_MAX_NEIGHBORS <= 64
+#define NBR_TABLE_HASH_SIZE 128
+#elif NBR_TABLE_MAX_NEIGHBORS <= 128
+#define NBR_TABLE_HASH_SIZE 256
+#else
+#define NBR_TABLE_HASH_SIZE 512
+#endif
+#define NBR_TABLE_HASH_EMPTY 0
+static uint8_t hash_index[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_WITH_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -125,6 +150,45 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
 {
   return key_from_index(index_from_item(table, item));
 }
+#if NBR_TABLE_WITH_HASH
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash_lladdr(const linkaddr_t *lladdr)
+{
+  unsigned h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 31 + lladdr->u8[i];
+  }
+  return (h ^ (h >> 7)) & (NBR_TABLE_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_insert(nbr_table_key_t *key)
+{
+  unsigned h;
+
+  for(h = hash_lladdr(&key->lladdr);
+      hash_index[h] != NBR_TABLE_HASH_EMPTY;
+      h = (h + 1) & (NBR_TABLE_HASH_SIZE - 1));
+  hash_index[h] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Rebuild the hash index from the list of keys. Called whenever a key is
+ * removed or changes address, which is rare compared to lookups. */
+static void
+hash_rebuild(void)
+{
+  nbr_table_key_t *key;
+
+  memset(hash_index, NBR_TABLE_HASH_EMPTY, sizeof(hash_index));
+  for(key = list_head(nbr_table_keys); key != NULL; key = list_item_next(key)) {
+    hash_insert(key);
+  }
+}
+#endif /* NBR_TABLE_WITH_HASH */
 /*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
@@ -136,6 +200,20 @@ index_from_lladdr(const linkaddr_t *lladdr)
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_WITH_HASH
+  {
+    unsigned h;
+    for(h = hash_lladdr(lladdr);
+        hash_index[h] != NBR_TABLE_HASH_EMPTY;
+        h = (h + 1) & (NBR_TABLE_HASH_SIZE - 1)) {
+      key = key_from_index(hash_index[h] - 1);
+      if(linkaddr_cmp(lladdr, &key->lladdr)) {
+        return hash_index[h] - 1;
+      }
+    }
+    return -1;
+  }
+#endif /* NBR_TABLE_WITH_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -195,6 +273,9 @@ remove_key(nbr_table_key_t *least_used_key)
   used_map[index_from_key(least_used_key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_WITH_HASH
+  hash_rebuild();
+#endif /* NBR_TABLE_WITH_HASH */
 }
 /*---------------------------------------------------------------------------*/
 static nbr_table_key_t *
@@ -359,6 +440,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_WITH_HASH
+    hash_insert(key);
+#endif /* NBR_TABLE_WITH_HASH */
   }
 
   /* Get item in the current table */
@@ -451,6 +535,9 @@ nbr_table_update_lladdr(const linkaddr_t *old_addr, const linkaddr_t *new_addr,
    * conflicting entry.
    */
   memcpy(&key->lladdr, new_addr, sizeof(linkaddr_t));
+#if NBR_TABLE_WITH_HASH
+  hash_rebuild();
+#endif /* NBR_TABLE_WITH_HASH */
   return 1;
 }
 /*---------------------------------------------------------------------------*/
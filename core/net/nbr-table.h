@@ -46,6 +46,15 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Index the neighbor keys with a hash table, so that lookups by
+ * link-layer address do not scan all neighbors. Useful for large
+ * neighbor tables, at the cost of one byte of RAM per hash slot. */
+#ifdef NBR_TABLE_CONF_WITH_HASH
+#define NBR_TABLE_WITH_HASH NBR_TABLE_CONF_WITH_HASH
+#else /* NBR_TABLE_CONF_WITH_HASH */
+#define NBR_TABLE_WITH_HASH 0
+#endif /* NBR_TABLE_CONF_WITH_HASH */
+
 /* An item in a neighbor table */
 typedef void nbr_table_item_t;
 
@@ -85,6 +94,7 @@ typedef enum {
 	NBR_TABLE_REASON_MAC,
 	NBR_TABLE_REASON_LLSEC,
 	NBR_TABLE_REASON_LINK_STATS,
+	NBR_TABLE_REASON_SICSLOWPAN,
 } nbr_table_reason_t;
 
 /** \name Neighbor tables: register and loop through table elements */
@@ -49,19 +49,24 @@
 #include "net/rime/rime.h"
 #include "sys/cc.h"
 
-struct packetbuf_attr packetbuf_attrs[PACKETBUF_NUM_ATTRS];
-struct packetbuf_addr packetbuf_addrs[PACKETBUF_NUM_ADDRS];
+/* The storage of the packet buffer in struct packetbuf_ctx ensures
+   that the packet buffer is aligned on an even 32-bit boundary. On
+   some platforms (most notably the msp430 or OpenRISC), having a
+   potentially misaligned packet buffer may lead to problems when
+   accessing words. */
+static struct packetbuf_ctx default_ctx;
+/* The selected context. Its lengths and memory pointer are kept in
+   the variables below while it is selected, so that selecting another
+   context does not slow down the packetbuf functions. */
+static struct packetbuf_ctx *current_ctx = &default_ctx;
 
+struct packetbuf_attr *packetbuf_attrs = default_ctx.attrs;
+struct packetbuf_addr *packetbuf_addrs = default_ctx.addrs;
 
 static uint16_t buflen, bufptr;
 static uint8_t hdrlen;
 
-/* The declarations below ensure that the packet buffer is aligned on
-   an even 32-bit boundary. On some platforms (most notably the
-   msp430 or OpenRISC), having a potentially misaligned packet buffer may lead to
-   problems when accessing words. */
-static uint32_t packetbuf_aligned[(PACKETBUF_SIZE + 3) / 4];
-static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
+static uint8_t *packetbuf = (uint8_t *)default_ctx.storage;
 
 #define DEBUG 0
 #if DEBUG
@@ -118,6 +123,18 @@ packetbuf_copyto(void *to)
   return hdrlen + buflen;
 }
 /*---------------------------------------------------------------------------*/
+uint8_t *
+packetbuf_swap_storage(uint8_t *storage)
+{
+  uint8_t *old;
+
+  old = packetbuf;
+  packetbuf = storage;
+  buflen = bufptr = 0;
+  hdrlen = 0;
+  return old;
+}
+/*---------------------------------------------------------------------------*/
 int
 packetbuf_hdralloc(int size)
 {
@@ -194,7 +211,7 @@ void
 packetbuf_attr_clear(void)
 {
   int i;
-  memset(packetbuf_attrs, 0, sizeof(packetbuf_attrs));
+  memset(packetbuf_attrs, 0, sizeof(default_ctx.attrs));
   for(i = 0; i < PACKETBUF_NUM_ADDRS; ++i) {
     linkaddr_copy(&packetbuf_addrs[i].addr, &linkaddr_null);
   }
@@ -204,16 +221,16 @@ void
 packetbuf_attr_copyto(struct packetbuf_attr *attrs,
                       struct packetbuf_addr *addrs)
 {
-  memcpy(attrs, packetbuf_attrs, sizeof(packetbuf_attrs));
-  memcpy(addrs, packetbuf_addrs, sizeof(packetbuf_addrs));
+  memcpy(attrs, packetbuf_attrs, sizeof(default_ctx.attrs));
+  memcpy(addrs, packetbuf_addrs, sizeof(default_ctx.addrs));
 }
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_attr_copyfrom(struct packetbuf_attr *attrs,
                         struct packetbuf_addr *addrs)
 {
-  memcpy(packetbuf_attrs, attrs, sizeof(packetbuf_attrs));
-  memcpy(packetbuf_addrs, addrs, sizeof(packetbuf_addrs));
+  memcpy(packetbuf_attrs, attrs, sizeof(default_ctx.attrs));
+  memcpy(packetbuf_addrs, addrs, sizeof(default_ctx.addrs));
 }
 /*---------------------------------------------------------------------------*/
 #if !PACKETBUF_CONF_ATTRS_INLINE
@@ -250,5 +267,45 @@ packetbuf_holds_broadcast(void)
   return linkaddr_cmp(&packetbuf_addrs[PACKETBUF_ADDR_RECEIVER - PACKETBUF_ADDR_FIRST].addr, &linkaddr_null);
 }
 /*---------------------------------------------------------------------------*/
+void
+packetbuf_ctx_init(struct packetbuf_ctx *ctx)
+{
+  int i;
+
+  ctx->buf = (uint8_t *)ctx->storage;
+  ctx->buflen = ctx->bufptr = 0;
+  ctx->hdrlen = 0;
+  memset(ctx->attrs, 0, sizeof(ctx->attrs));
+  for(i = 0; i < PACKETBUF_NUM_ADDRS; ++i) {
+    linkaddr_copy(&ctx->addrs[i].addr, &linkaddr_null);
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct packetbuf_ctx *
+packetbuf_ctx_select(struct packetbuf_ctx *ctx)
+{
+  struct packetbuf_ctx *prev;
+
+  if(ctx == NULL) {
+    ctx = &default_ctx;
+  }
+  prev = current_ctx;
+  if(ctx != prev) {
+    prev->buf = packetbuf;
+    prev->buflen = buflen;
+    prev->bufptr = bufptr;
+    prev->hdrlen = hdrlen;
+
+    packetbuf = ctx->buf;
+    buflen = ctx->buflen;
+    bufptr = ctx->bufptr;
+    hdrlen = ctx->hdrlen;
+    packetbuf_attrs = ctx->attrs;
+    packetbuf_addrs = ctx->addrs;
+    current_ctx = ctx;
+  }
+  return prev;
+}
+/*---------------------------------------------------------------------------*/
 
 /** @} */
@@ -62,6 +62,9 @@
  */
 #ifdef PACKETBUF_CONF_SIZE
 #define PACKETBUF_SIZE PACKETBUF_CONF_SIZE
+#elif defined(SICSLOWPAN_CONF_MAC_MAX_PAYLOAD) && SICSLOWPAN_CONF_MAC_MAX_PAYLOAD > 128
+/* Large (802.15.4g) frames: hold a whole frame without its FCS */
+#define PACKETBUF_SIZE SICSLOWPAN_CONF_MAC_MAX_PAYLOAD
 #else
 #define PACKETBUF_SIZE 128
 #endif
@@ -183,6 +186,21 @@ int packetbuf_copyfrom(const void *from, uint16_t len);
  */
 int packetbuf_copyto(void *to);
 
+/**
+ * \brief      Exchange the memory that holds the packetbuf
+ * \param storage The new memory, PACKETBUF_SIZE bytes and 32-bit aligned
+ * \return     The memory that held the packetbuf until now
+ *
+ *             This function lets the queuebuf module move a packet
+ *             in or out of the packetbuf by exchanging pointers
+ *             instead of copying it. The header and data lengths are
+ *             reset to zero and the attributes are not changed.
+ *             Pointers returned by packetbuf_dataptr() and
+ *             packetbuf_hdrptr() before the call no longer point into
+ *             the packetbuf.
+ */
+uint8_t *packetbuf_swap_storage(uint8_t *storage);
+
 /**
  * \brief      Extend the header of the packetbuf, for outbound packets
  * \param size The number of bytes the header should be extended
@@ -244,10 +262,17 @@ enum {
   PACKETBUF_ATTR_MAC_SEQNO,
   PACKETBUF_ATTR_MAC_ACK,
   PACKETBUF_ATTR_IS_CREATED_AND_SECURED,
+  PACKETBUF_ATTR_MAC_METADATA,
 #if TSCH_WITH_LINK_SELECTOR
   PACKETBUF_ATTR_TSCH_SLOTFRAME,
   PACKETBUF_ATTR_TSCH_TIMESLOT,
 #endif /* TSCH_WITH_LINK_SELECTOR */
+#if ENERGEST_CONF_CLASSES
+  PACKETBUF_ATTR_ENERGEST_CLASS,
+#endif /* ENERGEST_CONF_CLASSES */
+#if PKTTRACE_CONF_ENABLED
+  PACKETBUF_ATTR_PKTTRACE_ID,
+#endif /* PKTTRACE_CONF_ENABLED */
 
   /* Scope 1 attributes: used between two neighbors only. */
 #if PACKETBUF_WITH_PACKET_TYPE
@@ -307,8 +332,8 @@ enum {
 
 #if PACKETBUF_CONF_ATTRS_INLINE
 
-extern struct packetbuf_attr packetbuf_attrs[];
-extern struct packetbuf_addr packetbuf_addrs[];
+extern struct packetbuf_attr *packetbuf_attrs;
+extern struct packetbuf_addr *packetbuf_addrs;
 
 static inline int
 packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val)
@@ -354,6 +379,46 @@ void              packetbuf_attr_copyto(struct packetbuf_attr *attrs,
 void              packetbuf_attr_copyfrom(struct packetbuf_attr *attrs,
                                           struct packetbuf_addr *addrs);
 
+/**
+ * A packetbuf context: the memory, lengths and attributes of a
+ * packetbuf. The packetbuf functions operate on the selected context,
+ * which initially is a default context of the packetbuf module.
+ * Other contexts let a module, e.g. a MAC decoding a received frame
+ * while the upper layers prepare the next one to send, keep a packet
+ * in a packetbuf of its own without copying it.
+ */
+struct packetbuf_ctx {
+  uint8_t *buf;
+  uint16_t buflen, bufptr;
+  uint8_t hdrlen;
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  /* Aligned on a 32-bit boundary, like the default packetbuf */
+  uint32_t storage[(PACKETBUF_SIZE + 3) / 4];
+};
+
+/**
+ * \brief      Initialize a packetbuf context
+ * \param ctx  The context, which must not be selected
+ *
+ *             The context is initialized with no data and cleared
+ *             attributes.
+ */
+void packetbuf_ctx_init(struct packetbuf_ctx *ctx);
+
+/**
+ * \brief      Select the packetbuf context to operate on
+ * \param ctx  The context, or NULL for the default context
+ * \return     The context selected until now
+ *
+ *             Selecting a context costs no copying. Pointers into
+ *             the packetbuf stay valid while another context is
+ *             selected. The previous context should be selected again
+ *             with the return value before returning to code that
+ *             does not know about contexts.
+ */
+struct packetbuf_ctx *packetbuf_ctx_select(struct packetbuf_ctx *ctx);
+
 #define PACKETBUF_ATTRIBUTES(...) { __VA_ARGS__ PACKETBUF_ATTR_LAST }
 #define PACKETBUF_ATTR_LAST { PACKETBUF_ATTR_NONE, 0 }
 
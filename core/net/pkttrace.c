@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Packet trace: fixed-size binary events recorded by the network
+ *         stack in a RAM ring and drained in the background.
+ *
+ *         Events are written as SLIP frames: 'T', version, the last two
+ *         bytes of the link-layer address, RTIMER_SECOND (4 bytes), the
+ *         number of events dropped since the previous frame (2 bytes),
+ *         the number of events N, N events of 10 bytes each (time, ID,
+ *         arg, layer, event) and a CRC16 of everything before it. All
+ *         values are little endian. tools/pkttrace/decode-pkttrace
+ *         decodes the stream.
+ */
+
+#include "contiki.h"
+#include "net/pkttrace.h"
+#include "net/linkaddr.h"
+#include "lib/ringbufindex.h"
+#include "lib/crc16.h"
+
+#include <stdio.h>
+
+#if PKTTRACE_ENABLED
+
+#if (PKTTRACE_QUEUE_LEN & (PKTTRACE_QUEUE_LEN - 1)) != 0
+#error PKTTRACE_QUEUE_LEN must be power of two
+#endif
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+#define EVENT_LEN  10
+#define HEADER_LEN 11
+
+uint16_t pkttrace_current_id;
+
+static struct ringbufindex ring;
+static struct pkttrace_event events[PKTTRACE_QUEUE_LEN];
+static uint16_t dropped;
+static uint16_t last_id;
+
+PROCESS(pkttrace_process, "Packet trace");
+/*---------------------------------------------------------------------------*/
+uint16_t
+pkttrace_new_id(void)
+{
+  if(++last_id == 0) {
+    last_id = 1;
+  }
+  return last_id;
+}
+/*---------------------------------------------------------------------------*/
+void
+pkttrace_add(uint8_t layer, uint8_t event, uint16_t id, uint16_t arg)
+{
+  int i;
+  struct pkttrace_event *e;
+
+  i = ringbufindex_peek_put(&ring);
+  if(i < 0) {
+    dropped++;
+    return;
+  }
+  e = &events[i];
+  e->time = RTIMER_NOW();
+  e->id = id;
+  e->arg = arg;
+  e->layer = layer;
+  e->event = event;
+  ringbufindex_put(&ring);
+  process_poll(&pkttrace_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_u16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_u32(uint8_t *p, uint32_t v)
+{
+  put_u16(p, v & 0xffff);
+  put_u16(p + 2, v >> 16);
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_frame(void)
+{
+  static uint8_t frame[HEADER_LEN + PKTTRACE_FRAME_EVENTS * EVENT_LEN + 2];
+  uint8_t *p;
+  unsigned short crc;
+  int i, n;
+
+  frame[0] = 'T';
+  frame[1] = PKTTRACE_VERSION;
+  frame[2] = linkaddr_node_addr.u8[LINKADDR_SIZE - 2];
+  frame[3] = linkaddr_node_addr.u8[LINKADDR_SIZE - 1];
+  put_u32(&frame[4], RTIMER_SECOND);
+  put_u16(&frame[8], dropped);
+  dropped = 0;
+
+  p = &frame[HEADER_LEN];
+  for(n = 0; n < PKTTRACE_FRAME_EVENTS; n++) {
+    struct pkttrace_event *e;
+
+    i = ringbufindex_peek_get(&ring);
+    if(i < 0) {
+      break;
+    }
+    e = &events[i];
+    put_u32(p, e->time);
+    put_u16(p + 4, e->id);
+    put_u16(p + 6, e->arg);
+    p[8] = e->layer;
+    p[9] = e->event;
+    p += EVENT_LEN;
+    ringbufindex_get(&ring);
+  }
+  frame[10] = n;
+
+  crc = crc16_data(frame, p - frame, 0);
+  put_u16(p, crc);
+  p += 2;
+
+  PKTTRACE_PUTCHAR(SLIP_END);
+  for(i = 0; i < p - frame; i++) {
+    if(frame[i] == SLIP_END) {
+      PKTTRACE_PUTCHAR(SLIP_ESC);
+      PKTTRACE_PUTCHAR(SLIP_ESC_END);
+    } else if(frame[i] == SLIP_ESC) {
+      PKTTRACE_PUTCHAR(SLIP_ESC);
+      PKTTRACE_PUTCHAR(SLIP_ESC_ESC);
+    } else {
+      PKTTRACE_PUTCHAR(frame[i]);
+    }
+  }
+  PKTTRACE_PUTCHAR(SLIP_END);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(pkttrace_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    /* One frame at a time, so that tracing does not hold up the stack */
+    while(ringbufindex_elements(&ring) > 0 || dropped > 0) {
+      write_frame();
+      PROCESS_PAUSE();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+pkttrace_init(void)
+{
+  ringbufindex_init(&ring, PKTTRACE_QUEUE_LEN);
+  dropped = 0;
+  process_start(&pkttrace_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* PKTTRACE_ENABLED */
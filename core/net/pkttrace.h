@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Packet trace: fixed-size binary events recorded by the network
+ *         stack in a RAM ring and drained in the background
+ */
+
+#ifndef PKTTRACE_H_
+#define PKTTRACE_H_
+
+#include "contiki-conf.h"
+
+/* Enable packet tracing. Without it, PKTTRACE() compiles to nothing */
+#ifdef PKTTRACE_CONF_ENABLED
+#define PKTTRACE_ENABLED PKTTRACE_CONF_ENABLED
+#else /* PKTTRACE_CONF_ENABLED */
+#define PKTTRACE_ENABLED 0
+#endif /* PKTTRACE_CONF_ENABLED */
+
+/* The number of events the ring holds, a power of two of at most 128 */
+#ifdef PKTTRACE_CONF_QUEUE_LEN
+#define PKTTRACE_QUEUE_LEN PKTTRACE_CONF_QUEUE_LEN
+#else /* PKTTRACE_CONF_QUEUE_LEN */
+#define PKTTRACE_QUEUE_LEN 32
+#endif /* PKTTRACE_CONF_QUEUE_LEN */
+
+/* The maximum number of events sent in one frame */
+#ifdef PKTTRACE_CONF_FRAME_EVENTS
+#define PKTTRACE_FRAME_EVENTS PKTTRACE_CONF_FRAME_EVENTS
+#else /* PKTTRACE_CONF_FRAME_EVENTS */
+#define PKTTRACE_FRAME_EVENTS 8
+#endif /* PKTTRACE_CONF_FRAME_EVENTS */
+
+/* The function that writes one byte of the trace stream */
+#ifdef PKTTRACE_CONF_PUTCHAR
+#define PKTTRACE_PUTCHAR(c) PKTTRACE_CONF_PUTCHAR(c)
+#else /* PKTTRACE_CONF_PUTCHAR */
+#define PKTTRACE_PUTCHAR(c) putchar(c)
+#endif /* PKTTRACE_CONF_PUTCHAR */
+
+#define PKTTRACE_VERSION 1
+
+/* Layers */
+#define PKTTRACE_LAYER_IP          1
+#define PKTTRACE_LAYER_SICSLOWPAN  2
+#define PKTTRACE_LAYER_MAC         3
+
+/* Events */
+#define PKTTRACE_EVENT_IN          1 /* Received from the layer below */
+#define PKTTRACE_EVENT_OUT         2 /* Sent to the layer below */
+#define PKTTRACE_EVENT_QUEUE       3 /* Queued for transmission */
+#define PKTTRACE_EVENT_SENT        4 /* Transmission done, arg is the status */
+#define PKTTRACE_EVENT_DROP        5 /* Dropped */
+
+struct pkttrace_event {
+  uint32_t time;    /* RTIMER_NOW() */
+  uint16_t id;      /* Packet ID, 0 if unknown */
+  uint16_t arg;     /* Length or status, depending on the event */
+  uint8_t layer;
+  uint8_t event;
+};
+
+#if PKTTRACE_ENABLED
+
+/*
+ * The ID of the packet that is being processed. Layers that pass a
+ * packet on synchronously set it, PACKETBUF_ATTR_PKTTRACE_ID carries
+ * it along queued packets.
+ */
+extern uint16_t pkttrace_current_id;
+
+/**
+ * \brief Initialize packet tracing and start the draining process
+ */
+void pkttrace_init(void);
+
+/**
+ * \brief Allocate an ID for a new packet
+ * \return A non-zero packet ID
+ */
+uint16_t pkttrace_new_id(void);
+
+/**
+ * \brief Record an event
+ *
+ * The ring is a single-producer, single-consumer queue without locks:
+ * events must be added from one context only, normally the main loop.
+ * An event that does not fit is counted as dropped and reported in the
+ * next frame.
+ */
+void pkttrace_add(uint8_t layer, uint8_t event, uint16_t id, uint16_t arg);
+
+#define PKTTRACE(layer, event, id, arg) \
+  pkttrace_add(PKTTRACE_LAYER_##layer, PKTTRACE_EVENT_##event, (id), (arg))
+
+#else /* PKTTRACE_ENABLED */
+
+#define pkttrace_init()
+#define PKTTRACE(layer, event, id, arg)
+
+#endif /* PKTTRACE_ENABLED */
+
+#endif /* PKTTRACE_H_ */
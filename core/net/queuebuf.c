@@ -48,6 +48,17 @@
 #include "cfs/cfs.h"
 #endif
 
+#if QUEUEBUF_WITH_SLAB
+#include "lib/slab.h"
+#define BUFRAM_MEMB SLAB_OWNER
+#define buframmem_alloc slab_alloc
+#define buframmem_free slab_free
+#else /* QUEUEBUF_WITH_SLAB */
+#define BUFRAM_MEMB MEMB_FREELIST
+#define buframmem_alloc memb_alloc
+#define buframmem_free memb_free
+#endif /* QUEUEBUF_WITH_SLAB */
+
 #include <string.h> /* for memcpy() */
 
 /* Structure pointing to a buffer either stored
@@ -70,16 +81,47 @@ struct queuebuf {
 #endif
 };
 
+#if QUEUEBUF_SPARSE_ATTRS
+/* The attributes and addresses that are set, marked in bitmaps and
+   stored in type order */
+struct queuebuf_attrs {
+  uint8_t attr_map[(PACKETBUF_NUM_ATTRS + 7) / 8];
+  uint8_t addr_map;
+  packetbuf_attr_t attr_vals[QUEUEBUF_ATTR_SLOTS];
+  linkaddr_t addr_vals[QUEUEBUF_ADDR_SLOTS];
+};
+#endif /* QUEUEBUF_SPARSE_ATTRS */
+
 /* The actual queuebuf data */
 struct queuebuf_data {
+#if QUEUEBUF_IN_PLACE
+  uint8_t *data;
+#else /* QUEUEBUF_IN_PLACE */
   uint8_t data[PACKETBUF_SIZE];
+#endif /* QUEUEBUF_IN_PLACE */
   uint16_t len;
+#if QUEUEBUF_SPARSE_ATTRS
+  struct queuebuf_attrs attrs;
+#else /* QUEUEBUF_SPARSE_ATTRS */
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+#endif /* QUEUEBUF_SPARSE_ATTRS */
 };
 
-MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
-MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
+MEMB_FREELIST(bufmem, struct queuebuf, QUEUEBUF_NUM);
+BUFRAM_MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
+
+#if QUEUEBUF_IN_PLACE
+/* The packet buffers. A queuebuf in RAM owns one of them, and so does
+   the packetbuf; the ones not in use are kept on a stack. Buffers are
+   exchanged with the packetbuf, so the packetbuf's own memory may end
+   up on the stack as well. */
+static uint32_t databufs[QUEUEBUFRAM_NUM][(PACKETBUF_SIZE + 3) / 4];
+static uint8_t *free_databufs[QUEUEBUFRAM_NUM];
+static uint8_t num_free_databufs;
+/* Set while queuebuf_take_from_packetbuf() allocates a queuebuf */
+static uint8_t take_packetbuf;
+#endif /* QUEUEBUF_IN_PLACE */
 
 #if WITH_SWAP
 
@@ -87,27 +129,68 @@ MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
    queuebufs in CFS. The swap is made of several large CFS files.
    Every buffer stored in CFS has a swap id, referring to a specific
    offset in one of these files. */
+#ifdef QUEUEBUF_CONF_SWAP_FILES
+#define NQBUF_FILES QUEUEBUF_CONF_SWAP_FILES
+#else /* QUEUEBUF_CONF_SWAP_FILES */
 #define NQBUF_FILES 4
+#endif /* QUEUEBUF_CONF_SWAP_FILES */
+#ifdef QUEUEBUF_CONF_SWAP_PER_FILE
+#define NQBUF_PER_FILE QUEUEBUF_CONF_SWAP_PER_FILE
+#else /* QUEUEBUF_CONF_SWAP_PER_FILE */
 #define NQBUF_PER_FILE 256
+#endif /* QUEUEBUF_CONF_SWAP_PER_FILE */
 #define QBUF_FILE_SIZE (NQBUF_PER_FILE*sizeof(struct queuebuf_data))
 #define NQBUF_ID (NQBUF_PER_FILE * NQBUF_FILES)
 
+/* Swapped queuebufs are accessed through a small cache in RAM. New and
+   updated queuebufs are written back from the cache in the background,
+   all at once and in swap id order, and the queuebuf swapped right
+   after the last one loaded is read ahead while the caller is busy
+   with the first. */
+#ifdef QUEUEBUF_CONF_SWAP_CACHE
+#define NQBUF_CACHE QUEUEBUF_CONF_SWAP_CACHE
+#else /* QUEUEBUF_CONF_SWAP_CACHE */
+#define NQBUF_CACHE 2
+#endif /* QUEUEBUF_CONF_SWAP_CACHE */
+
+/* The delay before dirty cache entries are written back. A swapped
+   queuebuf that is freed before its write-back never reaches CFS. */
+#ifdef QUEUEBUF_CONF_SWAP_FLUSH_DELAY
+#define QBUF_FLUSH_DELAY QUEUEBUF_CONF_SWAP_FLUSH_DELAY
+#else /* QUEUEBUF_CONF_SWAP_FLUSH_DELAY */
+#define QBUF_FLUSH_DELAY 0
+#endif /* QUEUEBUF_CONF_SWAP_FLUSH_DELAY */
+
 struct qbuf_file {
   int fd;
   int usage;
   int renewable;
+  /* The position of fd, or -1 if unknown */
+  cfs_offset_t pos;
+};
+
+struct qbuf_cache {
+  /* The swapped qbuf whose data is cached, or NULL */
+  struct queuebuf *qbuf;
+  /* Set if data has not been written to CFS yet */
+  uint8_t dirty;
+  struct queuebuf_data data;
 };
 
-/* A statically allocated queuebuf used as a cache for swapped qbufs */
-static struct queuebuf_data tmpdata;
-/* A pointer to the qbuf associated to the data in tmpdata */
-static struct queuebuf *tmpdata_qbuf = NULL;
+/* The cache for swapped qbufs */
+static struct qbuf_cache cache[NQBUF_CACHE];
+/* The entry returned last, its data may still be in use by the caller */
+static struct qbuf_cache *cache_mru;
 /* The swap id counter */
 static int next_swap_id = 0;
+/* The swap id to read ahead */
+static int readahead_id;
 /* The swap files */
 static struct qbuf_file qbuf_files[NQBUF_FILES];
 /* The timer used to renew files during inactivity periods */
 static struct ctimer renew_timer;
+/* The timers used for the write-back and read-ahead */
+static struct ctimer flush_timer, readahead_timer;
 
 #endif
 
@@ -145,6 +228,9 @@ qbuf_renew_file(int file)
   name[1] = '\0';
   if(qbuf_files[file].renewable == 1) {
     PRINTF("qbuf_renew_file: removing file %d\n", file);
+    if(qbuf_files[file].fd != -1) {
+      cfs_close(qbuf_files[file].fd);
+    }
     cfs_remove(name);
   }
   ret = cfs_open(name, CFS_READ | CFS_WRITE);
@@ -154,6 +240,7 @@ qbuf_renew_file(int file)
   qbuf_files[file].fd = ret;
   qbuf_files[file].usage = 0;
   qbuf_files[file].renewable = 0;
+  qbuf_files[file].pos = -1;
 }
 /*---------------------------------------------------------------------------*/
 /* Renews every file with renewable flag set */
@@ -183,10 +270,6 @@ queuebuf_remove_from_file(int swap_id)
       /* This file is renewable, set a timer to renew files */
       ctimer_set(&renew_timer, 0, qbuf_renew_all, NULL);
     }
-
-    if(tmpdata_qbuf->swap_id == swap_id) {
-      tmpdata_qbuf->swap_id = -1;
-    }
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -209,62 +292,167 @@ get_new_swap_id(void)
   return swap_id;
 }
 /*---------------------------------------------------------------------------*/
-/* Flush tmpdata to CFS */
+/* Reads or writes the data of a swap id, seeking only if the file
+   position does not match already */
 static int
-queuebuf_flush_tmpdata(void)
+swap_io(int swap_id, struct queuebuf_data *data, int write)
 {
-  int fileid, fd, ret;
+  struct qbuf_file *file;
   cfs_offset_t offset;
-  if(tmpdata_qbuf) {
-    queuebuf_remove_from_file(tmpdata_qbuf->swap_id);
-    tmpdata_qbuf->swap_id = get_new_swap_id();
-    if(tmpdata_qbuf->swap_id == -1) {
+  int ret;
+
+  file = &qbuf_files[swap_id / NQBUF_PER_FILE];
+  offset = (swap_id % NQBUF_PER_FILE) * sizeof(struct queuebuf_data);
+  if(file->pos != offset) {
+    if(cfs_seek(file->fd, offset, CFS_SEEK_SET) == -1) {
+      PRINTF("queuebuf swap_io: cfs seek error\n");
+      file->pos = -1;
       return -1;
     }
-    fileid = tmpdata_qbuf->swap_id / NQBUF_PER_FILE;
-    offset = (tmpdata_qbuf->swap_id % NQBUF_PER_FILE) * sizeof(struct queuebuf_data);
-    fd = qbuf_files[fileid].fd;
-    ret = cfs_seek(fd, offset, CFS_SEEK_SET);
-    if(ret == -1) {
-      PRINTF("queuebuf_flush_tmpdata: cfs seek error\n");
-      return -1;
+  }
+  if(write) {
+    ret = cfs_write(file->fd, data, sizeof(struct queuebuf_data));
+  } else {
+    ret = cfs_read(file->fd, data, sizeof(struct queuebuf_data));
+  }
+  if(ret != sizeof(struct queuebuf_data)) {
+    PRINTF("queuebuf swap_io: cfs %s error\n", write ? "write" : "read");
+    file->pos = -1;
+    return -1;
+  }
+  file->pos = offset + sizeof(struct queuebuf_data);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct qbuf_cache *
+cache_lookup(struct queuebuf *b)
+{
+  int i;
+  for(i = 0; i < NQBUF_CACHE; i++) {
+    if(cache[i].qbuf == b) {
+      return &cache[i];
     }
-    ret = cfs_write(fd, &tmpdata, sizeof(struct queuebuf_data));
-    if(ret == -1) {
-      PRINTF("queuebuf_flush_tmpdata: cfs write error\n");
-      return -1;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Writes back all dirty cache entries, in swap id order so that
+   consecutive ids need no seek */
+static void
+qbuf_flush_all(void *unused)
+{
+  struct qbuf_cache *c;
+  int i;
+
+  do {
+    c = NULL;
+    for(i = 0; i < NQBUF_CACHE; i++) {
+      if(cache[i].dirty &&
+         (c == NULL || cache[i].qbuf->swap_id < c->qbuf->swap_id)) {
+        c = &cache[i];
+      }
+    }
+    if(c != NULL) {
+      swap_io(c->qbuf->swap_id, &c->data, 1);
+      c->dirty = 0;
+    }
+  } while(c != NULL);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns an unused cache entry, evicting a clean one if needed */
+static struct qbuf_cache *
+cache_get_entry(void)
+{
+  struct qbuf_cache *c;
+  int i;
+
+  c = NULL;
+  for(i = 0; i < NQBUF_CACHE; i++) {
+    if(cache[i].qbuf == NULL) {
+      return &cache[i];
+    }
+    if(!cache[i].dirty && &cache[i] != cache_mru) {
+      c = &cache[i];
     }
   }
-  return 0;
+  if(c == NULL) {
+    /* Every entry is dirty or in use: write back now */
+    qbuf_flush_all(NULL);
+    c = &cache[0];
+    if(c == cache_mru && NQBUF_CACHE > 1) {
+      c = &cache[1];
+    }
+  }
+  c->qbuf = NULL;
+  return c;
 }
 /*---------------------------------------------------------------------------*/
-/* If the queuebuf is in CFS, load it to tmpdata */
+/* Records a change of the cached data of a swapped qbuf */
+static void
+cache_set_dirty(struct queuebuf *b)
+{
+  struct qbuf_cache *c;
+  int swap_id;
+
+  c = cache_lookup(b);
+  if(c != NULL && !c->dirty) {
+    /* Write the new version to a new swap id, if there is one */
+    swap_id = get_new_swap_id();
+    if(swap_id != -1) {
+      queuebuf_remove_from_file(b->swap_id);
+      b->swap_id = swap_id;
+    }
+    c->dirty = 1;
+  }
+  if(ctimer_expired(&flush_timer)) {
+    ctimer_set(&flush_timer, QBUF_FLUSH_DELAY, qbuf_flush_all, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Loads the qbuf swapped with readahead_id, unless it is cached */
+static void
+qbuf_readahead(void *unused)
+{
+  struct queuebuf *q;
+  struct qbuf_cache *c;
+  int i;
+
+  q = (struct queuebuf *)bufmem.mem;
+  for(i = 0; i < QUEUEBUF_NUM; i++, q++) {
+    if(bufmem.count[i] != 0 && q->location == IN_CFS &&
+       q->swap_id == readahead_id) {
+      if(cache_lookup(q) == NULL) {
+        c = cache_get_entry();
+        if(c != cache_mru && swap_io(q->swap_id, &c->data, 0) == 0) {
+          c->qbuf = q;
+        }
+      }
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* If the queuebuf is in CFS, load it to the cache */
 static struct queuebuf_data *
 queuebuf_load_to_ram(struct queuebuf *b)
 {
-  int fileid, fd, ret;
-  cfs_offset_t offset;
+  struct qbuf_cache *c;
   if(b->location == IN_RAM) { /* the qbuf is loacted in RAM */
     return b->ram_ptr;
   } else { /* the qbuf is located in CFS */
-    if(tmpdata_qbuf && tmpdata_qbuf->swap_id == b->swap_id) { /* the qbuf is already in tmpdata */
-      return &tmpdata;
-    } else { /* the qbuf needs to be loaded from CFS */
-      tmpdata_qbuf = b;
-      /* read the qbuf from CFS */
-      fileid = b->swap_id / NQBUF_PER_FILE;
-      offset = (b->swap_id % NQBUF_PER_FILE) * sizeof(struct queuebuf_data);
-      fd = qbuf_files[fileid].fd;
-      ret = cfs_seek(fd, offset, CFS_SEEK_SET);
-      if(ret == -1) {
-        PRINTF("queuebuf_load_to_ram: cfs seek error\n");
-      }
-      ret = cfs_read(fd, &tmpdata, sizeof(struct queuebuf_data));
-      if(ret == -1) {
-        PRINTF("queuebuf_load_to_ram: cfs read error\n");
-      }
-      return &tmpdata;
+    c = cache_lookup(b);
+    if(c == NULL) { /* the qbuf needs to be loaded from CFS */
+      c = cache_get_entry();
+      c->qbuf = b;
+      c->dirty = 0;
+      swap_io(b->swap_id, &c->data, 0);
     }
+    cache_mru = c;
+    if(NQBUF_CACHE > 1) {
+      readahead_id = (b->swap_id + 1) % NQBUF_ID;
+      ctimer_set(&readahead_timer, 0, qbuf_readahead, NULL);
+    }
+    return &c->data;
   }
 }
 #else /* WITH_SWAP */
@@ -276,18 +464,124 @@ queuebuf_load_to_ram(struct queuebuf *b)
 }
 #endif /* WITH_SWAP */
 /*---------------------------------------------------------------------------*/
+#if QUEUEBUF_SPARSE_ATTRS
+#define MAP_ISSET(map, i) ((map)[(i) >> 3] & (1 << ((i) & 7)))
+#define MAP_SET(map, i)   ((map)[(i) >> 3] |= (1 << ((i) & 7)))
+
+/* Encodes the packetbuf attributes, returns 0 if they do not fit */
+static int
+attrs_pack(struct queuebuf_attrs *a)
+{
+  const linkaddr_t *addr;
+  packetbuf_attr_t val;
+  int i, n;
+
+  memset(a->attr_map, 0, sizeof(a->attr_map));
+  for(i = 0, n = 0; i < PACKETBUF_NUM_ATTRS; i++) {
+    val = packetbuf_attr(i);
+    if(val != 0) {
+      if(n == QUEUEBUF_ATTR_SLOTS) {
+        return 0;
+      }
+      MAP_SET(a->attr_map, i);
+      a->attr_vals[n++] = val;
+    }
+  }
+
+  a->addr_map = 0;
+  for(i = 0, n = 0; i < PACKETBUF_NUM_ADDRS; i++) {
+    addr = packetbuf_addr(PACKETBUF_ADDR_FIRST + i);
+    if(!linkaddr_cmp(addr, &linkaddr_null)) {
+      if(n == QUEUEBUF_ADDR_SLOTS) {
+        return 0;
+      }
+      a->addr_map |= 1 << i;
+      linkaddr_copy(&a->addr_vals[n++], addr);
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+attrs_unpack(const struct queuebuf_attrs *a)
+{
+  int i, n;
+
+  packetbuf_attr_clear();
+  for(i = 0, n = 0; i < PACKETBUF_NUM_ATTRS; i++) {
+    if(MAP_ISSET(a->attr_map, i)) {
+      packetbuf_set_attr(i, a->attr_vals[n++]);
+    }
+  }
+  for(i = 0, n = 0; i < PACKETBUF_NUM_ADDRS; i++) {
+    if(a->addr_map & (1 << i)) {
+      packetbuf_set_addr(PACKETBUF_ADDR_FIRST + i, &a->addr_vals[n++]);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The number of set entries before index i in a bitmap */
+static int
+map_rank(const uint8_t *map, int i)
+{
+  int j, n;
+
+  for(j = 0, n = 0; j < i; j++) {
+    if(MAP_ISSET(map, j)) {
+      n++;
+    }
+  }
+  return n;
+}
+#endif /* QUEUEBUF_SPARSE_ATTRS */
+/*---------------------------------------------------------------------------*/
+static void
+attrs_to_packetbuf(struct queuebuf_data *d)
+{
+#if QUEUEBUF_SPARSE_ATTRS
+  attrs_unpack(&d->attrs);
+#else /* QUEUEBUF_SPARSE_ATTRS */
+  packetbuf_attr_copyfrom(d->attrs, d->addrs);
+#endif /* QUEUEBUF_SPARSE_ATTRS */
+}
+/*---------------------------------------------------------------------------*/
+static void
+attrs_from_packetbuf(struct queuebuf_data *d)
+{
+#if QUEUEBUF_SPARSE_ATTRS
+  struct queuebuf_attrs a;
+
+  if(attrs_pack(&a)) {
+    d->attrs = a;
+  } else {
+    PRINTF("queuebuf: too many attributes, not updated\n");
+  }
+#else /* QUEUEBUF_SPARSE_ATTRS */
+  packetbuf_attr_copyto(d->attrs, d->addrs);
+#endif /* QUEUEBUF_SPARSE_ATTRS */
+}
+/*---------------------------------------------------------------------------*/
 void
 queuebuf_init(void)
 {
 #if WITH_SWAP
   int i;
   for(i=0; i<NQBUF_FILES; i++) {
+    qbuf_files[i].fd = -1;
     qbuf_files[i].renewable = 1;
     qbuf_renew_file(i);
   }
 #endif
+#if !QUEUEBUF_WITH_SLAB
   memb_init(&buframmem);
+#endif /* !QUEUEBUF_WITH_SLAB */
   memb_init(&bufmem);
+#if QUEUEBUF_IN_PLACE
+  for(num_free_databufs = 0; num_free_databufs < QUEUEBUFRAM_NUM;
+      num_free_databufs++) {
+    free_databufs[num_free_databufs] = (uint8_t *)databufs[num_free_databufs];
+  }
+#endif /* QUEUEBUF_IN_PLACE */
 #if QUEUEBUF_STATS
   queuebuf_max_len = 0;
 #endif /* QUEUEBUF_STATS */
@@ -296,7 +590,14 @@ queuebuf_init(void)
 int
 queuebuf_numfree(void)
 {
+#if QUEUEBUF_WITH_SLAB && !WITH_SWAP
+  /* The shared blocks may run out before the handles do */
+  int num_free = memb_numfree(&bufmem);
+  int data_free = slab_numfree(&buframmem);
+  return data_free < num_free ? data_free : num_free;
+#else /* QUEUEBUF_WITH_SLAB && !WITH_SWAP */
   return memb_numfree(&bufmem);
+#endif /* QUEUEBUF_WITH_SLAB && !WITH_SWAP */
 }
 /*---------------------------------------------------------------------------*/
 #if QUEUEBUF_DEBUG
@@ -310,6 +611,14 @@ queuebuf_new_from_packetbuf(void)
   struct queuebuf *buf;
 
   struct queuebuf_data *buframptr;
+#if QUEUEBUF_SPARSE_ATTRS
+  struct queuebuf_attrs attrs;
+
+  if(!attrs_pack(&attrs)) {
+    PRINTF("queuebuf_new_from_packetbuf: too many attributes\n");
+    return NULL;
+  }
+#endif /* QUEUEBUF_SPARSE_ATTRS */
   buf = memb_alloc(&bufmem);
   if(buf != NULL) {
 #if QUEUEBUF_DEBUG
@@ -318,7 +627,17 @@ queuebuf_new_from_packetbuf(void)
     buf->line = line;
     buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
-    buf->ram_ptr = memb_alloc(&buframmem);
+    buf->ram_ptr = buframmem_alloc(&buframmem);
+#if QUEUEBUF_IN_PLACE
+    if(buf->ram_ptr != NULL) {
+      if(num_free_databufs == 0) {
+        buframmem_free(&buframmem, buf->ram_ptr);
+        buf->ram_ptr = NULL;
+      } else {
+        buf->ram_ptr->data = free_databufs[--num_free_databufs];
+      }
+    }
+#endif /* QUEUEBUF_IN_PLACE */
 #if WITH_SWAP
     /* If the allocation failed, store the qbuf in swap files */
     if(buf->ram_ptr != NULL) {
@@ -326,29 +645,52 @@ queuebuf_new_from_packetbuf(void)
       buframptr = buf->ram_ptr;
     } else {
       buf->location = IN_CFS;
-      buf->swap_id = -1;
-      tmpdata_qbuf = buf;
-      buframptr = &tmpdata;
+      buf->swap_id = get_new_swap_id();
+      if(buf->swap_id == -1) {
+        /* There is no room left in the swap */
+#if QUEUEBUF_DEBUG
+        list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
+        memb_free(&bufmem, buf);
+        return NULL;
+      }
+      cache_mru = cache_get_entry();
+      cache_mru->qbuf = buf;
+      cache_mru->dirty = 1;
+      buframptr = &cache_mru->data;
     }
 #else
     if(buf->ram_ptr == NULL) {
       PRINTF("queuebuf_new_from_packetbuf: could not queuebuf data\n");
+#if QUEUEBUF_DEBUG
+      list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
       memb_free(&bufmem, buf);
       return NULL;
     }
     buframptr = buf->ram_ptr;
 #endif
 
+#if QUEUEBUF_IN_PLACE
+    if(take_packetbuf) {
+      /* Lay the packet out the way packetbuf_copyto() does, then
+         exchange buffers with the packetbuf */
+      packetbuf_compact();
+      buframptr->len = packetbuf_totlen();
+      buframptr->data = packetbuf_swap_storage(buframptr->data);
+    } else
+#endif /* QUEUEBUF_IN_PLACE */
     buframptr->len = packetbuf_copyto(buframptr->data);
+#if QUEUEBUF_SPARSE_ATTRS
+    buframptr->attrs = attrs;
+#else /* QUEUEBUF_SPARSE_ATTRS */
     packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+#endif /* QUEUEBUF_SPARSE_ATTRS */
 
 #if WITH_SWAP
     if(buf->location == IN_CFS) {
-      if(queuebuf_flush_tmpdata() == -1) {
-        /* We were unable to write the data in the swap */
-        memb_free(&bufmem, buf);
-        return NULL;
-      }
+      /* The data is written to the swap in the background */
+      cache_set_dirty(buf);
     }
 #endif
 
@@ -370,10 +712,10 @@ void
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
-  packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+  attrs_from_packetbuf(buframptr);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
-    queuebuf_flush_tmpdata();
+    cache_set_dirty(buf);
   }
 #endif
 }
@@ -382,11 +724,11 @@ void
 queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
-  packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+  attrs_from_packetbuf(buframptr);
   buframptr->len = packetbuf_copyto(buframptr->data);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
-    queuebuf_flush_tmpdata();
+    cache_set_dirty(buf);
   }
 #endif
 }
@@ -397,21 +739,30 @@ queuebuf_free(struct queuebuf *buf)
   if(memb_inmemb(&bufmem, buf)) {
 #if WITH_SWAP
     if(buf->location == IN_RAM) {
-      memb_free(&buframmem, buf->ram_ptr);
+      buframmem_free(&buframmem, buf->ram_ptr);
     } else {
+      struct qbuf_cache *c = cache_lookup(buf);
+      if(c != NULL) {
+        /* Drop the cached data, even if it was not written back */
+        c->qbuf = NULL;
+        c->dirty = 0;
+      }
       queuebuf_remove_from_file(buf->swap_id);
     }
 #else
-    memb_free(&buframmem, buf->ram_ptr);
+#if QUEUEBUF_IN_PLACE
+    free_databufs[num_free_databufs++] = buf->ram_ptr->data;
+#endif /* QUEUEBUF_IN_PLACE */
+    buframmem_free(&buframmem, buf->ram_ptr);
 #endif
+#if QUEUEBUF_DEBUG
+    list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
     memb_free(&bufmem, buf);
 #if QUEUEBUF_STATS
     --queuebuf_len;
     PRINTF("#A q=%d\n", queuebuf_len);
 #endif /* QUEUEBUF_STATS */
-#if QUEUEBUF_DEBUG
-    list_remove(queuebuf_list, buf);
-#endif /* QUEUEBUF_DEBUG */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -421,10 +772,45 @@ queuebuf_to_packetbuf(struct queuebuf *b)
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
     packetbuf_copyfrom(buframptr->data, buframptr->len);
-    packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+    attrs_to_packetbuf(buframptr);
   }
 }
 /*---------------------------------------------------------------------------*/
+struct queuebuf *
+queuebuf_take_from_packetbuf(void)
+{
+  struct queuebuf *buf;
+#if QUEUEBUF_IN_PLACE
+  take_packetbuf = 1;
+  buf = queuebuf_new_from_packetbuf();
+  take_packetbuf = 0;
+#else /* QUEUEBUF_IN_PLACE */
+  buf = queuebuf_new_from_packetbuf();
+#endif /* QUEUEBUF_IN_PLACE */
+  return buf;
+}
+/*---------------------------------------------------------------------------*/
+void
+queuebuf_move_to_packetbuf(struct queuebuf *b)
+{
+#if QUEUEBUF_IN_PLACE
+  struct queuebuf_data *buframptr;
+
+  if(memb_inmemb(&bufmem, b)) {
+    buframptr = b->ram_ptr;
+    packetbuf_clear();
+    /* The queuebuf gets the old packetbuf memory, which is put back on
+       the free stack by queuebuf_free() */
+    buframptr->data = packetbuf_swap_storage(buframptr->data);
+    packetbuf_set_datalen(buframptr->len);
+    attrs_to_packetbuf(buframptr);
+  }
+#else /* QUEUEBUF_IN_PLACE */
+  queuebuf_to_packetbuf(b);
+#endif /* QUEUEBUF_IN_PLACE */
+  queuebuf_free(b);
+}
+/*---------------------------------------------------------------------------*/
 void *
 queuebuf_dataptr(struct queuebuf *b)
 {
@@ -446,14 +832,36 @@ linkaddr_t *
 queuebuf_addr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if QUEUEBUF_SPARSE_ATTRS
+  int i = type - PACKETBUF_ADDR_FIRST;
+  int j, n;
+
+  if((buframptr->attrs.addr_map & (1 << i)) == 0) {
+    return (linkaddr_t *)&linkaddr_null;
+  }
+  for(j = 0, n = 0; j < i; j++) {
+    if(buframptr->attrs.addr_map & (1 << j)) {
+      n++;
+    }
+  }
+  return &buframptr->attrs.addr_vals[n];
+#else /* QUEUEBUF_SPARSE_ATTRS */
   return &buframptr->addrs[type - PACKETBUF_ADDR_FIRST].addr;
+#endif /* QUEUEBUF_SPARSE_ATTRS */
 }
 /*---------------------------------------------------------------------------*/
 packetbuf_attr_t
 queuebuf_attr(struct queuebuf *b, uint8_t type)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if QUEUEBUF_SPARSE_ATTRS
+  if(!MAP_ISSET(buframptr->attrs.attr_map, type)) {
+    return 0;
+  }
+  return buframptr->attrs.attr_vals[map_rank(buframptr->attrs.attr_map, type)];
+#else /* QUEUEBUF_SPARSE_ATTRS */
   return buframptr->attrs[type].val;
+#endif /* QUEUEBUF_SPARSE_ATTRS */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -66,7 +66,12 @@
    If QUEUEBUFRAM_CONF_NUM is set lower than QUEUEBUF_NUM,
    swapping is enabled and queuebufs are stored either in RAM of CFS.
    If QUEUEBUFRAM_CONF_NUM is unset or >= to QUEUEBUF_NUM, all
-   queuebufs are in RAM and swapping is disabled. */
+   queuebufs are in RAM and swapping is disabled.
+   The swap is made of QUEUEBUF_CONF_SWAP_FILES files of
+   QUEUEBUF_CONF_SWAP_PER_FILE queuebufs each. Swapped queuebufs are
+   accessed through a cache of QUEUEBUF_CONF_SWAP_CACHE entries in RAM,
+   which is written back QUEUEBUF_CONF_SWAP_FLUSH_DELAY clock ticks
+   after a change. */
 #ifdef QUEUEBUFRAM_CONF_NUM
   #if QUEUEBUFRAM_CONF_NUM>QUEUEBUF_NUM
     #error "QUEUEBUFRAM_CONF_NUM cannot be greater than QUEUEBUF_NUM"
@@ -79,6 +84,56 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* With QUEUEBUF_CONF_WITH_SLAB, the data of the queuebufs in RAM is
+   taken from the shared slab allocator (lib/slab.h) instead of a
+   reserved memb, with QUEUEBUFRAM_NUM as a quota. The queuebuf
+   handles themselves stay in a memb of QUEUEBUF_NUM entries. */
+#ifdef QUEUEBUF_CONF_WITH_SLAB
+#define QUEUEBUF_WITH_SLAB QUEUEBUF_CONF_WITH_SLAB
+#else /* QUEUEBUF_CONF_WITH_SLAB */
+#define QUEUEBUF_WITH_SLAB 0
+#endif /* QUEUEBUF_CONF_WITH_SLAB */
+
+/* With QUEUEBUF_CONF_IN_PLACE, the packet data of the queuebufs in
+   RAM is kept in buffers of the same kind as the packetbuf memory, and
+   queuebuf_take_from_packetbuf() and queuebuf_move_to_packetbuf()
+   exchange buffers with the packetbuf instead of copying the packet.
+   Pointers into the packetbuf are then invalidated by these calls,
+   and thus by enqueueing a packet in the MAC layer. Swapping to CFS
+   is not supported in this mode. */
+#ifdef QUEUEBUF_CONF_IN_PLACE
+#define QUEUEBUF_IN_PLACE QUEUEBUF_CONF_IN_PLACE
+#else /* QUEUEBUF_CONF_IN_PLACE */
+#define QUEUEBUF_IN_PLACE 0
+#endif /* QUEUEBUF_CONF_IN_PLACE */
+
+#if QUEUEBUF_IN_PLACE && WITH_SWAP
+#error "QUEUEBUF_CONF_IN_PLACE can not be used with QUEUEBUFRAM_CONF_NUM < QUEUEBUF_CONF_NUM"
+#endif /* QUEUEBUF_IN_PLACE && WITH_SWAP */
+
+/* With QUEUEBUF_CONF_SPARSE_ATTRS, a queuebuf stores only the packet
+   attributes and addresses that are set, instead of copies of the
+   whole packetbuf attribute and address arrays. It has room for
+   QUEUEBUF_CONF_ATTR_SLOTS attributes and QUEUEBUF_CONF_ADDR_SLOTS
+   addresses; packets with more cannot be queued. */
+#ifdef QUEUEBUF_CONF_SPARSE_ATTRS
+#define QUEUEBUF_SPARSE_ATTRS QUEUEBUF_CONF_SPARSE_ATTRS
+#else /* QUEUEBUF_CONF_SPARSE_ATTRS */
+#define QUEUEBUF_SPARSE_ATTRS 0
+#endif /* QUEUEBUF_CONF_SPARSE_ATTRS */
+
+#ifdef QUEUEBUF_CONF_ATTR_SLOTS
+#define QUEUEBUF_ATTR_SLOTS QUEUEBUF_CONF_ATTR_SLOTS
+#else /* QUEUEBUF_CONF_ATTR_SLOTS */
+#define QUEUEBUF_ATTR_SLOTS 8
+#endif /* QUEUEBUF_CONF_ATTR_SLOTS */
+
+#ifdef QUEUEBUF_CONF_ADDR_SLOTS
+#define QUEUEBUF_ADDR_SLOTS QUEUEBUF_CONF_ADDR_SLOTS
+#else /* QUEUEBUF_CONF_ADDR_SLOTS */
+#define QUEUEBUF_ADDR_SLOTS 2
+#endif /* QUEUEBUF_CONF_ADDR_SLOTS */
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
@@ -101,6 +156,15 @@ void queuebuf_update_from_packetbuf(struct queuebuf *b);
 void queuebuf_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
 
+/* Like queuebuf_new_from_packetbuf(), for a caller that does not need
+   the packetbuf data afterwards. With QUEUEBUF_IN_PLACE the packet is
+   moved without copying and the packetbuf is left with no data; its
+   attributes are kept. */
+struct queuebuf *queuebuf_take_from_packetbuf(void);
+/* Like queuebuf_to_packetbuf() followed by queuebuf_free(). With
+   QUEUEBUF_IN_PLACE the packet is moved without copying. */
+void queuebuf_move_to_packetbuf(struct queuebuf *b);
+
 void *queuebuf_dataptr(struct queuebuf *b);
 int queuebuf_datalen(struct queuebuf *b);
 
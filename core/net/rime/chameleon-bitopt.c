@@ -294,7 +294,17 @@ pack_header(struct channel *c)
     /*    len = (a->len & 0xf8) + ((a->len & 7) ? 8: 0);*/
     len = a->len;
     byteptr = bitptr / 8;
-    if(PACKETBUF_IS_ADDR(a->type)) {
+    if(((bitptr | len) & 7) == 0 && len <= (PACKETBUF_IS_ADDR(a->type) ?
+                                            LINKADDR_SIZE * 8 : 16)) {
+      /* Byte-aligned attribute: copy it without shifting bits */
+      if(PACKETBUF_IS_ADDR(a->type)) {
+        memcpy(&hdrptr[byteptr], packetbuf_addr(a->type), len / 8);
+      } else {
+        uint8_t buffer[2];
+        le16_write(buffer, packetbuf_attr(a->type));
+        memcpy(&hdrptr[byteptr], buffer, len / 8);
+      }
+    } else if(PACKETBUF_IS_ADDR(a->type)) {
       set_bits(&hdrptr[byteptr], bitptr & 7,
 	       (uint8_t *)packetbuf_addr(a->type), len);
       PRINTF("address %d.%d\n",
@@ -364,7 +374,19 @@ unpack_header(void)
     /*    len = (a->len & 0xf8) + ((a->len & 7) ? 8: 0);*/
     len = a->len;
     byteptr = bitptr / 8;
-    if(PACKETBUF_IS_ADDR(a->type)) {
+    if(((bitptr | len) & 7) == 0 && len <= (PACKETBUF_IS_ADDR(a->type) ?
+                                            LINKADDR_SIZE * 8 : 16)) {
+      /* Byte-aligned attribute: copy it without shifting bits */
+      if(PACKETBUF_IS_ADDR(a->type)) {
+        linkaddr_t addr;
+        memcpy(&addr, &hdrptr[byteptr], len / 8);
+        packetbuf_set_addr(a->type, &addr);
+      } else {
+        uint8_t buffer[2] = {0};
+        memcpy(buffer, &hdrptr[byteptr], len / 8);
+        packetbuf_set_attr(a->type, le16_read(buffer));
+      }
+    } else if(PACKETBUF_IS_ADDR(a->type)) {
       linkaddr_t addr;
       get_bits((uint8_t *)&addr, &hdrptr[byteptr], bitptr & 7, len);
       PRINTF("%d.%d: unpack_header type %d, addr %d.%d\n",
@@ -41,13 +41,36 @@
 #include "net/rime/rime.h"
 #include "lib/list.h"
 
+#include <string.h>
+
+/* Channels that packets were last received on, indexed by the channel
+   number modulo the table size, to avoid a scan of the channel list
+   for every packet. A power of two, 0 disables the table. */
+#ifdef CHANNEL_CONF_DISPATCH_SIZE
+#define CHANNEL_DISPATCH_SIZE CHANNEL_CONF_DISPATCH_SIZE
+#else /* CHANNEL_CONF_DISPATCH_SIZE */
+#define CHANNEL_DISPATCH_SIZE 0
+#endif /* CHANNEL_CONF_DISPATCH_SIZE */
+
+#if CHANNEL_DISPATCH_SIZE & (CHANNEL_DISPATCH_SIZE - 1)
+#error "CHANNEL_CONF_DISPATCH_SIZE must be a power of two"
+#endif
+
 LIST(channel_list);
 
+#if CHANNEL_DISPATCH_SIZE
+static struct channel *dispatch[CHANNEL_DISPATCH_SIZE];
+#define DISPATCH_INDEX(channelno) ((channelno) & (CHANNEL_DISPATCH_SIZE - 1))
+#endif /* CHANNEL_DISPATCH_SIZE */
+
 /*---------------------------------------------------------------------------*/
 void
 channel_init(void)
 {
   list_init(channel_list);
+#if CHANNEL_DISPATCH_SIZE
+  memset(dispatch, 0, sizeof(dispatch));
+#endif /* CHANNEL_DISPATCH_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -72,6 +95,11 @@ channel_open(struct channel *c, uint16_t channelno)
 void
 channel_close(struct channel *c)
 {
+#if CHANNEL_DISPATCH_SIZE
+  if(dispatch[DISPATCH_INDEX(c->channelno)] == c) {
+    dispatch[DISPATCH_INDEX(c->channelno)] = NULL;
+  }
+#endif /* CHANNEL_DISPATCH_SIZE */
   list_remove(channel_list, c);
 }
 /*---------------------------------------------------------------------------*/
@@ -79,8 +107,19 @@ struct channel *
 channel_lookup(uint16_t channelno)
 {
   struct channel *c;
+
+#if CHANNEL_DISPATCH_SIZE
+  c = dispatch[DISPATCH_INDEX(channelno)];
+  if(c != NULL && c->channelno == channelno) {
+    return c;
+  }
+#endif /* CHANNEL_DISPATCH_SIZE */
+
   for(c = list_head(channel_list); c != NULL; c = list_item_next(c)) {
     if(c->channelno == channelno) {
+#if CHANNEL_DISPATCH_SIZE
+      dispatch[DISPATCH_INDEX(channelno)] = c;
+#endif /* CHANNEL_DISPATCH_SIZE */
       return c;
     }
   }
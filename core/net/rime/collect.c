@@ -49,6 +49,7 @@
 #include "net/rime/collect-neighbor.h"
 #include "net/rime/collect-link-estimate.h"
 #include "net/rime/packetqueue.h"
+#include "net/rime/dupcache.h"
 
 #include "dev/radio-sensor.h"
 
@@ -65,20 +66,24 @@ static const struct packetbuf_attrlist attributes[] =
   };
 
 
-/* The recent_packets list holds the sequence number, the originator,
+/* The recent_packets cache holds the sequence number, the originator,
    and the connection for packets that have been recently
-   forwarded. This list is maintained to avoid forwarding duplicate
-   packets. */
+   forwarded. This cache is maintained to avoid forwarding duplicate
+   packets. With a lifetime, entries stop matching after that many
+   clock ticks. */
+#ifdef COLLECT_CONF_NUM_RECENT_PACKETS
+#define NUM_RECENT_PACKETS COLLECT_CONF_NUM_RECENT_PACKETS
+#else /* COLLECT_CONF_NUM_RECENT_PACKETS */
 #define NUM_RECENT_PACKETS 16
+#endif /* COLLECT_CONF_NUM_RECENT_PACKETS */
 
-struct recent_packet {
-  struct collect_conn *conn;
-  linkaddr_t originator;
-  uint8_t eseqno;
-};
+#ifdef COLLECT_CONF_RECENT_PACKET_LIFETIME
+#define RECENT_PACKET_LIFETIME COLLECT_CONF_RECENT_PACKET_LIFETIME
+#else /* COLLECT_CONF_RECENT_PACKET_LIFETIME */
+#define RECENT_PACKET_LIFETIME 0
+#endif /* COLLECT_CONF_RECENT_PACKET_LIFETIME */
 
-static struct recent_packet recent_packets[NUM_RECENT_PACKETS];
-static uint8_t recent_packet_ptr;
+DUPCACHE(recent_packets, NUM_RECENT_PACKETS, RECENT_PACKET_LIFETIME);
 
 
 /* This is the header of data packets. The header comtains the routing
@@ -90,6 +95,31 @@ struct data_msg_hdr {
   uint16_t rtmetric;
 };
 
+#define DATA_FLAGS_AGGREGATE            0x01
+
+#if COLLECT_AGGREGATION
+/* An aggregated frame has DATA_FLAGS_AGGREGATE set in its header,
+   which is followed by a record header and the payload for each of
+   the merged packets. The record header holds the packet attributes
+   that cannot be shared by the frame. */
+struct data_rec_hdr {
+  linkaddr_t esender;
+  uint8_t eseqno, hops, ttl, max_rexmit;
+  uint8_t len, dummy;
+};
+
+/* COLLECT_CONF_AGGREGATION_MAXLEN is the largest aggregated frame, not
+   counting lower layer headers. The default leaves room for the MAC
+   and rime headers in an IEEE 802.15.4 frame. */
+#ifdef COLLECT_CONF_AGGREGATION_MAXLEN
+#define AGGREGATION_MAXLEN COLLECT_CONF_AGGREGATION_MAXLEN
+#else /* COLLECT_CONF_AGGREGATION_MAXLEN */
+#define AGGREGATION_MAXLEN 80
+#endif /* COLLECT_CONF_AGGREGATION_MAXLEN */
+
+static uint8_t aggregate_buf[PACKETBUF_SIZE];
+#endif /* COLLECT_AGGREGATION */
+
 
 /* This is the header of ACK packets. It contains a flags field that
    indicates if the node is congested (ACK_FLAGS_CONGESTED), if the
@@ -558,6 +588,75 @@ proactive_probing_callback(void *ptr)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if COLLECT_AGGREGATION
+/**
+ * This function merges the packets at the head of the send queue into
+ * one frame. It is called with the first packet on the queue in the
+ * packetbuf, and returns the number of packets in the frame. If only
+ * the first packet fits, the packetbuf is left untouched.
+ *
+ */
+static uint8_t
+aggregate_queued_packets(struct collect_conn *c)
+{
+  struct packetqueue_item *i;
+  struct queuebuf *q;
+  struct data_rec_hdr rec;
+  uint16_t pos;
+  int len;
+  uint8_t num;
+
+  /* Find out how many packets fit in the frame. Packets without
+     payload are link estimate probes, which are never merged. */
+  num = 0;
+  pos = sizeof(struct data_msg_hdr);
+  for(i = packetqueue_first(&c->send_queue); i != NULL;
+      i = list_item_next(i)) {
+    q = packetqueue_queuebuf(i);
+    len = q == NULL ? 0 :
+      queuebuf_datalen(q) - (int)sizeof(struct data_msg_hdr);
+    if(len <= 0 || pos + sizeof(rec) + len > AGGREGATION_MAXLEN) {
+      break;
+    }
+    pos += sizeof(rec) + len;
+    num++;
+  }
+  c->aggregated = 1;
+  if(num < 2) {
+    return c->aggregated;
+  }
+
+  /* The frame keeps the attributes of the first packet. */
+  pos = sizeof(struct data_msg_hdr);
+  for(i = packetqueue_first(&c->send_queue); c->aggregated <= num;
+      i = list_item_next(i), c->aggregated++) {
+    q = packetqueue_queuebuf(i);
+    linkaddr_copy(&rec.esender, queuebuf_addr(q, PACKETBUF_ADDR_ESENDER));
+    rec.eseqno = queuebuf_attr(q, PACKETBUF_ATTR_EPACKET_ID);
+    rec.hops = queuebuf_attr(q, PACKETBUF_ATTR_HOPS);
+    rec.ttl = queuebuf_attr(q, PACKETBUF_ATTR_TTL);
+    rec.max_rexmit = queuebuf_attr(q, PACKETBUF_ATTR_MAX_REXMIT);
+    rec.len = queuebuf_datalen(q) - sizeof(struct data_msg_hdr);
+    rec.dummy = 0;
+    memcpy(&aggregate_buf[pos], &rec, sizeof(rec));
+    pos += sizeof(rec);
+    memcpy(&aggregate_buf[pos],
+           (uint8_t *)queuebuf_dataptr(q) + sizeof(struct data_msg_hdr),
+           rec.len);
+    pos += rec.len;
+  }
+  c->aggregated = num;
+  memcpy((uint8_t *)packetbuf_dataptr() + sizeof(struct data_msg_hdr),
+         &aggregate_buf[sizeof(struct data_msg_hdr)],
+         pos - sizeof(struct data_msg_hdr));
+  packetbuf_set_datalen(pos);
+
+  PRINTF("%d.%d: aggregated %d packets into %d bytes\n",
+         linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1], num, pos);
+  return num;
+}
+#endif /* COLLECT_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 /**
  * This function is called when a queued packet should be sent
  * out. The function takes the first packet on the output queue, adds
@@ -645,6 +744,11 @@ send_queued_packet(struct collect_conn *c)
          packet. */
       memset(&hdr, 0, sizeof(hdr));
       hdr.rtmetric = c->rtmetric;
+#if COLLECT_AGGREGATION
+      if(aggregate_queued_packets(c) > 1) {
+        hdr.flags |= DATA_FLAGS_AGGREGATE;
+      }
+#endif /* COLLECT_AGGREGATION */
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
       /* Send the packet. */
@@ -746,6 +850,11 @@ retransmit_current_packet(struct collect_conn *c)
          packet. */
       memset(&hdr, 0, sizeof(hdr));
       hdr.rtmetric = c->rtmetric;
+#if COLLECT_AGGREGATION
+      if(aggregate_queued_packets(c) > 1) {
+        hdr.flags |= DATA_FLAGS_AGGREGATE;
+      }
+#endif /* COLLECT_AGGREGATION */
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
       /* Send the packet. */
@@ -760,6 +869,12 @@ send_next_packet(struct collect_conn *tc)
 {
   /* Remove the first packet on the queue, the packet that was just sent. */
   packetqueue_dequeue(&tc->send_queue);
+#if COLLECT_AGGREGATION
+  /* Also remove the packets that were merged with it. */
+  for(; tc->aggregated > 1; tc->aggregated--) {
+    packetqueue_dequeue(&tc->send_queue);
+  }
+#endif /* COLLECT_AGGREGATION */
   tc->seqno = (tc->seqno + 1) % (1 << COLLECT_PACKET_ID_BITS);
 
   /* Cancel retransmission timer. */
@@ -911,21 +1026,124 @@ add_packet_to_recent_packets(struct collect_conn *tc)
      zero are keepalive or proactive link estimate probes, so we do
      not record them in our history. */
   if(packetbuf_datalen() > sizeof(struct data_msg_hdr)) {
-    recent_packets[recent_packet_ptr].eseqno =
-      packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID);
-    linkaddr_copy(&recent_packets[recent_packet_ptr].originator,
-                  packetbuf_addr(PACKETBUF_ADDR_ESENDER));
-    recent_packets[recent_packet_ptr].conn = tc;
-    recent_packet_ptr = (recent_packet_ptr + 1) % NUM_RECENT_PACKETS;
+    dupcache_add(&recent_packets, tc, packetbuf_addr(PACKETBUF_ADDR_ESENDER),
+                 packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID));
   }
 }
 /*---------------------------------------------------------------------------*/
+#if COLLECT_AGGREGATION
+/**
+ * This function is called when an aggregated frame is received. The
+ * frame is acknowledged as a whole. The packets in it are then
+ * delivered if we are the sink, or else put on the send queue one by
+ * one, to be merged again on their way to the parent.
+ *
+ */
+static void
+split_aggregate(struct collect_conn *tc, const struct data_msg_hdr *hdr,
+                const linkaddr_t *ack_to, uint8_t ackflags)
+{
+  struct data_rec_hdr rec;
+  uint16_t pos, len;
+  uint8_t num, *buf;
+  int is_sink;
+
+  is_sink = tc->rtmetric == RTMETRIC_SINK;
+  if(!is_sink && tc->rtmetric == RTMETRIC_MAX) {
+    /* We have no route, like for a single packet. */
+    return;
+  }
+
+  /* Sending the ACK overwrites the packetbuf. */
+  len = packetbuf_datalen();
+  memcpy(aggregate_buf, packetbuf_dataptr(), len);
+
+  num = 0;
+  for(pos = sizeof(struct data_msg_hdr); pos + sizeof(rec) <= len;
+      pos += sizeof(rec) + rec.len) {
+    memcpy(&rec, &aggregate_buf[pos], sizeof(rec));
+    num++;
+  }
+  if(pos != len) {
+    PRINTF("%d.%d: malformed aggregate\n",
+           linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1]);
+    return;
+  }
+
+  if(is_sink) {
+    ackflags = 0;
+  } else {
+    if(hdr->rtmetric <= tc->rtmetric) {
+      ackflags |= ACK_FLAGS_RTMETRIC_NEEDS_UPDATE;
+    }
+    /* All packets of the frame must fit on the send queue. */
+    if(packetqueue_len(&tc->send_queue) + num >
+       MAX_SENDING_QUEUE - MIN_AVAILABLE_QUEUE_ENTRIES + 1) {
+      send_ack(tc, ack_to, ackflags | ACK_FLAGS_DROPPED | ACK_FLAGS_CONGESTED);
+      PRINTF("%d.%d: aggregate dropped: no queue buffer available\n",
+             linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1]);
+      stats.qdrop++;
+      return;
+    }
+  }
+  send_ack(tc, ack_to, ackflags);
+
+  for(pos = sizeof(struct data_msg_hdr); pos < len;
+      pos += sizeof(rec) + rec.len) {
+    memcpy(&rec, &aggregate_buf[pos], sizeof(rec));
+
+    /* Rebuild the packet as it was on the sender's queue. */
+    packetbuf_clear();
+    buf = packetbuf_dataptr();
+    memset(buf, 0, sizeof(struct data_msg_hdr));
+    memcpy(buf + sizeof(struct data_msg_hdr),
+           &aggregate_buf[pos + sizeof(rec)], rec.len);
+    packetbuf_set_datalen(sizeof(struct data_msg_hdr) + rec.len);
+    packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
+                       PACKETBUF_ATTR_PACKET_TYPE_DATA);
+    packetbuf_set_addr(PACKETBUF_ADDR_ESENDER, &rec.esender);
+    packetbuf_set_attr(PACKETBUF_ATTR_EPACKET_ID, rec.eseqno);
+    packetbuf_set_attr(PACKETBUF_ATTR_HOPS, rec.hops);
+    packetbuf_set_attr(PACKETBUF_ATTR_TTL, rec.ttl);
+    packetbuf_set_attr(PACKETBUF_ATTR_MAX_REXMIT, rec.max_rexmit);
+
+    if(dupcache_lookup(&recent_packets, tc, &rec.esender, rec.eseqno)) {
+      stats.duprecv++;
+    } else if(is_sink) {
+      add_packet_to_recent_packets(tc);
+      packetbuf_hdrreduce(sizeof(struct data_msg_hdr));
+      if(tc->cb->recv != NULL) {
+        tc->cb->recv(packetbuf_addr(PACKETBUF_ADDR_ESENDER),
+                     packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
+                     packetbuf_attr(PACKETBUF_ATTR_HOPS));
+      }
+    } else if(rec.ttl <= 1) {
+      stats.ttldrop++;
+    } else {
+      packetbuf_set_attr(PACKETBUF_ATTR_HOPS, rec.hops + 1);
+      packetbuf_set_attr(PACKETBUF_ATTR_TTL, rec.ttl - 1);
+      if(packetqueue_enqueue_packetbuf(&tc->send_queue,
+                                       FORWARD_PACKET_LIFETIME_BASE *
+                                       rec.max_rexmit,
+                                       tc)) {
+        add_packet_to_recent_packets(tc);
+      } else {
+        stats.qdrop++;
+      }
+    }
+  }
+
+  if(!is_sink) {
+    send_queued_packet(tc);
+  }
+}
+#endif /* COLLECT_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 static void
 node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
 {
   struct collect_conn *tc = (struct collect_conn *)
     ((char *)c - offsetof(struct collect_conn, unicast_conn));
-  int i;
   struct data_msg_hdr hdr;
   uint8_t ackflags = 0;
   struct collect_neighbor *n;
@@ -972,23 +1190,30 @@ node_packet_received(struct unicast_conn *c, const linkaddr_t *from)
       ackflags |= ACK_FLAGS_CONGESTED;
     }
 
-    for(i = 0; i < NUM_RECENT_PACKETS; i++) {
-      if(recent_packets[i].conn == tc &&
-         recent_packets[i].eseqno == packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID) &&
-         linkaddr_cmp(&recent_packets[i].originator,
-                      packetbuf_addr(PACKETBUF_ADDR_ESENDER))) {
-        /* This is a duplicate of a packet we recently received, so we
-           just send an ACK. */
-        PRINTF("%d.%d: found duplicate packet from %d.%d with seqno %d, via %d.%d\n",
-               linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
-               recent_packets[i].originator.u8[0], recent_packets[i].originator.u8[1],
-               packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
-               packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[0],
-               packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[1]);
-        send_ack(tc, &ack_to, ackflags);
-        stats.duprecv++;
-        return;
-      }
+#if COLLECT_AGGREGATION
+    /* The packets in an aggregate are checked for duplicates one by
+       one, since a retransmitted frame may hold more packets. */
+    if(hdr.flags & DATA_FLAGS_AGGREGATE) {
+      split_aggregate(tc, &hdr, &ack_to, ackflags);
+      return;
+    }
+#endif /* COLLECT_AGGREGATION */
+
+    if(dupcache_lookup(&recent_packets, tc,
+                       packetbuf_addr(PACKETBUF_ADDR_ESENDER),
+                       packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID))) {
+      /* This is a duplicate of a packet we recently received, so we
+         just send an ACK. */
+      PRINTF("%d.%d: found duplicate packet from %d.%d with seqno %d, via %d.%d\n",
+             linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+             packetbuf_addr(PACKETBUF_ADDR_ESENDER)->u8[0],
+             packetbuf_addr(PACKETBUF_ADDR_ESENDER)->u8[1],
+             packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID),
+             packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[0],
+             packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[1]);
+      send_ack(tc, &ack_to, ackflags);
+      stats.duprecv++;
+      return;
     }
 
     /* If we are the sink, the packet has reached its final
@@ -114,6 +114,16 @@ struct collect_callbacks {
 #define COLLECT_ANNOUNCEMENTS COLLECT_CONF_ANNOUNCEMENTS
 #endif /* COLLECT_CONF_ANNOUNCEMENTS */
 
+/* COLLECT_CONF_AGGREGATION defines if packets that are waiting in the
+   send queue should be merged into one frame to the parent. The
+   parent splits the frame into the original packets again. All nodes
+   must use the same setting. */
+#ifdef COLLECT_CONF_AGGREGATION
+#define COLLECT_AGGREGATION COLLECT_CONF_AGGREGATION
+#else /* COLLECT_CONF_AGGREGATION */
+#define COLLECT_AGGREGATION 0
+#endif /* COLLECT_CONF_AGGREGATION */
+
 struct collect_conn {
   struct unicast_conn unicast_conn;
 #if ! COLLECT_ANNOUNCEMENTS
@@ -139,6 +149,9 @@ struct collect_conn {
   uint8_t sending, transmissions, max_rexmits;
   uint8_t eseqno;
   uint8_t is_router;
+#if COLLECT_AGGREGATION
+  uint8_t aggregated;
+#endif /* COLLECT_AGGREGATION */
 
   clock_time_t send_time;
 };
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A hashed cache of recently seen packets
+ */
+
+/**
+ * \addtogroup dupcache
+ * @{
+ */
+
+#include "net/rime/dupcache.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+static uint8_t
+hash(struct dupcache *d, const void *owner, const linkaddr_t *originator,
+     uint16_t seqno)
+{
+  uint8_t h;
+  int i;
+
+  h = seqno ^ (seqno >> 8) ^ ((uintptr_t)owner >> 2);
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h ^= originator->u8[i];
+  }
+  return h & d->mask;
+}
+/*---------------------------------------------------------------------------*/
+static struct dupcache_entry *
+find(struct dupcache *d, const void *owner, const linkaddr_t *originator,
+     uint16_t seqno)
+{
+  struct dupcache_entry *e;
+  uint8_t i;
+
+  for(i = d->buckets[hash(d, owner, originator, seqno)]; i != 0;
+      i = e->next) {
+    e = &d->entries[i - 1];
+    if(e->seqno == seqno && e->owner == owner &&
+       linkaddr_cmp(&e->originator, originator)) {
+      return e;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+dupcache_init(struct dupcache *d)
+{
+  memset(d->entries, 0, d->size * sizeof(struct dupcache_entry));
+  memset(d->buckets, 0, d->mask + 1);
+  d->oldest = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+dupcache_lookup(struct dupcache *d, const void *owner,
+                const linkaddr_t *originator, uint16_t seqno)
+{
+  struct dupcache_entry *e;
+
+  e = find(d, owner, originator, seqno);
+  if(e == NULL) {
+    return 0;
+  }
+  return d->lifetime == 0 || clock_time() - e->time < d->lifetime;
+}
+/*---------------------------------------------------------------------------*/
+void
+dupcache_add(struct dupcache *d, const void *owner,
+             const linkaddr_t *originator, uint16_t seqno)
+{
+  struct dupcache_entry *e;
+  uint8_t *p;
+  uint8_t h;
+
+  e = find(d, owner, originator, seqno);
+  if(e != NULL) {
+    e->time = clock_time();
+    return;
+  }
+
+  /* Unlink the entry that is recycled. */
+  e = &d->entries[d->oldest];
+  if(e->bucket != 0) {
+    for(p = &d->buckets[e->bucket - 1]; *p != 0;
+        p = &d->entries[*p - 1].next) {
+      if(*p == d->oldest + 1) {
+        *p = e->next;
+        break;
+      }
+    }
+  }
+
+  e->owner = owner;
+  linkaddr_copy(&e->originator, originator);
+  e->seqno = seqno;
+  e->time = clock_time();
+  h = hash(d, owner, originator, seqno);
+  e->bucket = h + 1;
+  e->next = d->buckets[h];
+  d->buckets[h] = d->oldest + 1;
+
+  d->oldest = (d->oldest + 1) % d->size;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the duplicate packet cache
+ */
+
+/**
+ * \addtogroup rime
+ * @{
+ */
+
+/**
+ * \defgroup dupcache Duplicate packet cache
+ * @{
+ *
+ * The dupcache module remembers the originator and sequence number
+ * of recently seen packets, so that protocols can drop duplicates.
+ * Entries are hashed, so a lookup only compares the few entries in
+ * one bucket even when the cache is large. The oldest entry is
+ * replaced when the cache is full, and entries can also be given a
+ * lifetime after which they no longer match, so that wrapped
+ * sequence numbers are not mistaken for duplicates.
+ *
+ */
+
+#ifndef DUPCACHE_H_
+#define DUPCACHE_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+/**
+ * \brief      Representation of an entry in a duplicate packet cache.
+ *
+ *             This is an opaque structure with no user-visible
+ *             elements. Indices are stored plus one, so that a
+ *             zeroed cache is empty.
+ */
+struct dupcache_entry {
+  const void *owner;
+  clock_time_t time;
+  linkaddr_t originator;
+  uint16_t seqno;
+  uint8_t next;
+  uint8_t bucket;
+};
+
+/**
+ * \brief      Representation of a duplicate packet cache.
+ *
+ *             This is an opaque structure with no user-visible
+ *             elements.
+ */
+struct dupcache {
+  struct dupcache_entry *entries;
+  uint8_t *buckets;
+  clock_time_t lifetime;
+  uint8_t size;
+  uint8_t mask;
+  uint8_t oldest;
+};
+
+/* The number of hash buckets for a cache size: the largest power of
+   two that is at most half of the size. */
+#define DUPCACHE_BUCKETS(size) ((size) >= 256 ? 128 : (size) >= 128 ? 64 : \
+                                (size) >= 64 ? 32 : (size) >= 32 ? 16 : \
+                                (size) >= 16 ? 8 : (size) >= 8 ? 4 : \
+                                (size) >= 4 ? 2 : 1)
+
+/**
+ * \brief      Define a duplicate packet cache.
+ * \param name The variable name of the cache
+ * \param size The number of entries, at most 254
+ * \param lifetime The time after which an entry no longer matches,
+ *             in clock ticks, or 0 for entries that match until
+ *             they are replaced
+ *
+ *             This statement defines a duplicate packet cache. The
+ *             cache is empty and needs no initialization.
+ */
+#define DUPCACHE(name, size, lifetime)                                  \
+  static struct dupcache_entry name##_entries[size];                    \
+  static uint8_t name##_buckets[DUPCACHE_BUCKETS(size)];                \
+  static struct dupcache name = { name##_entries, name##_buckets,       \
+                                  (lifetime), (size),                   \
+                                  DUPCACHE_BUCKETS(size) - 1, 0 }
+
+/**
+ * \brief      Remove all entries from a duplicate packet cache.
+ * \param d    A cache defined with DUPCACHE()
+ */
+void dupcache_init(struct dupcache *d);
+
+/**
+ * \brief      Check whether a packet has been seen recently.
+ * \param d    A cache defined with DUPCACHE()
+ * \param owner The connection that the packet belongs to, or NULL
+ * \param originator The originator of the packet
+ * \param seqno The originator's sequence number of the packet
+ * \return     Non-zero if the packet is in the cache, zero otherwise
+ */
+int dupcache_lookup(struct dupcache *d, const void *owner,
+                    const linkaddr_t *originator, uint16_t seqno);
+
+/**
+ * \brief      Record a packet as seen.
+ * \param d    A cache defined with DUPCACHE()
+ * \param owner The connection that the packet belongs to, or NULL
+ * \param originator The originator of the packet
+ * \param seqno The originator's sequence number of the packet
+ *
+ *             If the packet already is in the cache, its lifetime is
+ *             restarted. Otherwise the oldest entry is replaced.
+ */
+void dupcache_add(struct dupcache *d, const void *owner,
+                  const linkaddr_t *originator, uint16_t seqno);
+
+#endif /* DUPCACHE_H_ */
+/** @} */
+/** @} */
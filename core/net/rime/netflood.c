@@ -43,11 +43,37 @@
  */
 
 #include "net/rime/netflood.h"
+#include "net/rime/dupcache.h"
 
 #include <string.h>
 
 #define HOPS_MAX 16
 
+/* By default only the last forwarded packet is remembered, so
+   interleaved floods from different originators may be forwarded
+   more than once. With NETFLOOD_CONF_NUM_RECENT_PACKETS, recently
+   forwarded packets are also kept in a cache. */
+#ifdef NETFLOOD_CONF_NUM_RECENT_PACKETS
+#define NUM_RECENT_PACKETS NETFLOOD_CONF_NUM_RECENT_PACKETS
+#else /* NETFLOOD_CONF_NUM_RECENT_PACKETS */
+#define NUM_RECENT_PACKETS 0
+#endif /* NETFLOOD_CONF_NUM_RECENT_PACKETS */
+
+#ifdef NETFLOOD_CONF_RECENT_PACKET_LIFETIME
+#define RECENT_PACKET_LIFETIME NETFLOOD_CONF_RECENT_PACKET_LIFETIME
+#else /* NETFLOOD_CONF_RECENT_PACKET_LIFETIME */
+#define RECENT_PACKET_LIFETIME (16 * CLOCK_SECOND)
+#endif /* NETFLOOD_CONF_RECENT_PACKET_LIFETIME */
+
+#if NUM_RECENT_PACKETS
+DUPCACHE(recent_packets, NUM_RECENT_PACKETS, RECENT_PACKET_LIFETIME);
+#define IS_RECENT(c, o, s) dupcache_lookup(&recent_packets, (c), (o), (s))
+#define ADD_RECENT(c, o, s) dupcache_add(&recent_packets, (c), (o), (s))
+#else /* NUM_RECENT_PACKETS */
+#define IS_RECENT(c, o, s) 0
+#define ADD_RECENT(c, o, s)
+#endif /* NUM_RECENT_PACKETS */
+
 struct netflood_hdr {
   uint16_t originator_seqno;
   linkaddr_t originator;
@@ -88,7 +114,8 @@ recv_from_ipolite(struct ipolite_conn *ipolite, const linkaddr_t *from)
   packetbuf_hdrreduce(sizeof(struct netflood_hdr));
   if(c->u->recv != NULL) {
     if(!(linkaddr_cmp(&hdr.originator, &c->last_originator) &&
-	 hdr.originator_seqno <= c->last_originator_seqno)) {
+	 hdr.originator_seqno <= c->last_originator_seqno) &&
+       !IS_RECENT(c, &hdr.originator, hdr.originator_seqno)) {
 
       if(c->u->recv(c, from, &hdr.originator, hdr.originator_seqno,
 		    hops)) {
@@ -113,6 +140,7 @@ recv_from_ipolite(struct ipolite_conn *ipolite, const linkaddr_t *from)
 	    send(c);
 	    linkaddr_copy(&c->last_originator, &hdr.originator);
 	    c->last_originator_seqno = hdr.originator_seqno;
+	    ADD_RECENT(c, &hdr.originator, hdr.originator_seqno);
 	  }
 	}
       }
@@ -166,6 +194,7 @@ netflood_send(struct netflood_conn *c, uint8_t seqno)
     linkaddr_copy(&hdr->originator, &linkaddr_node_addr);
     linkaddr_copy(&c->last_originator, &hdr->originator);
     c->last_originator_seqno = hdr->originator_seqno = seqno;
+    ADD_RECENT(c, &hdr->originator, seqno);
     hdr->hops = 0;
     PRINTF("%d.%d: netflood sending '%s'\n",
 	   linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
@@ -50,6 +50,7 @@
 
 #include <stdio.h>
 #include <stddef.h> /* for offsetof */
+#include <string.h>
 
 #include "net/rime/rime.h"
 #include "net/rime/polite.h"
@@ -68,7 +69,13 @@ struct rudolph2_hdr {
   uint16_t chunk;
 };
 
+#if RUDOLPH2_PIPELINE
+/* Include hops_from_base, so that a node that forwards a page is not
+   silenced by the node that it still receives later pages from. */
+#define POLITE_HEADER 2
+#else /* RUDOLPH2_PIPELINE */
 #define POLITE_HEADER 1
+#endif /* RUDOLPH2_PIPELINE */
 
 #define HOPS_MAX 64
 
@@ -91,6 +98,8 @@ enum {
 
 #define LT(a, b) ((signed short)((a) - (b)) < 0)
 
+#define LAST_CHUNK_UNKNOWN 0xffff
+
 /*---------------------------------------------------------------------------*/
 static int
 read_data(struct rudolph2_conn *c, uint8_t *dataptr, int chunk)
@@ -122,6 +131,7 @@ format_data(struct rudolph2_conn *c, int chunk)
   return len;
 }
 /*---------------------------------------------------------------------------*/
+#if !RUDOLPH2_PIPELINE
 static void
 write_data(struct rudolph2_conn *c, int chunk, uint8_t *data, int datalen)
 {
@@ -150,6 +160,7 @@ write_data(struct rudolph2_conn *c, int chunk, uint8_t *data, int datalen)
 		       RUDOLPH2_FLAG_NONE, data, datalen);
   }
 }
+#endif /* !RUDOLPH2_PIPELINE */
 /*---------------------------------------------------------------------------*/
 static int
 send_data(struct rudolph2_conn *c, clock_time_t interval)
@@ -169,7 +180,17 @@ static void
 send_nack(struct rudolph2_conn *c)
 {
   struct rudolph2_hdr *hdr;
+#if RUDOLPH2_PIPELINE
+  uint16_t missing;
+#endif /* RUDOLPH2_PIPELINE */
+
   packetbuf_clear();
+#if RUDOLPH2_PIPELINE
+  /* rcv_nxt is the first chunk of the page, followed by a bitmap of
+     the chunks that are missing in it. */
+  missing = ~c->rcv_bitmap;
+  packetbuf_copyfrom(&missing, sizeof(missing));
+#endif /* RUDOLPH2_PIPELINE */
   packetbuf_hdralloc(sizeof(struct rudolph2_hdr));
   hdr = packetbuf_hdrptr();
 
@@ -244,6 +265,153 @@ dropped(struct polite_conn *polite)
     }*/
 }
 /*---------------------------------------------------------------------------*/
+#if RUDOLPH2_PIPELINE
+static void
+timed_send(void *ptr)
+{
+  struct rudolph2_conn *c = (struct rudolph2_conn *)ptr;
+  clock_time_t interval;
+  uint16_t chunk;
+  int len;
+
+  if(c->flags & FLAG_IS_STOPPED) {
+    return;
+  }
+
+  interval = SEND_INTERVAL;
+  if(c->repair_bitmap != 0) {
+    /* Requested chunks go before new ones, as they hold up the
+       receivers' current pages. */
+    for(chunk = 0; (c->repair_bitmap & (1U << chunk)) == 0; chunk++);
+    c->repair_bitmap &= ~(1U << chunk);
+    chunk += c->repair_page * RUDOLPH2_PAGE_CHUNKS;
+    if(chunk < c->rcv_nxt) {
+      format_data(c, chunk);
+      polite_send(&c->c, interval, POLITE_HEADER);
+    }
+  } else if(c->snd_nxt < c->rcv_nxt) {
+    if(c->flags & FLAG_LAST_SENT) {
+      interval = STEADY_INTERVAL;
+    }
+    len = send_data(c, interval);
+    if(len < RUDOLPH2_DATASIZE) {
+      c->flags |= FLAG_LAST_SENT;
+    } else {
+      c->flags &= ~FLAG_LAST_SENT;
+      c->snd_nxt++;
+    }
+  }
+  /* Otherwise all complete pages have been sent, and the next one
+     is still being received. */
+  c->nacks = 0;
+  ctimer_set(&c->t, interval, timed_send, c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_repair_request(struct rudolph2_conn *c, struct rudolph2_hdr *hdr)
+{
+  uint16_t missing, page;
+
+  if(packetbuf_datalen() < sizeof(struct rudolph2_hdr) + sizeof(missing) ||
+     hdr->chunk % RUDOLPH2_PAGE_CHUNKS != 0 || hdr->chunk >= c->rcv_nxt) {
+    return;
+  }
+  memcpy(&missing, (uint8_t *)hdr + sizeof(struct rudolph2_hdr),
+         sizeof(missing));
+  page = hdr->chunk / RUDOLPH2_PAGE_CHUNKS;
+
+  /* Requests for the same page are combined. The lowest page wins,
+     since receivers that are behind send a new NACK later. */
+  if(c->repair_bitmap == 0 || page < c->repair_page) {
+    c->repair_page = page;
+    c->repair_bitmap = missing;
+  } else if(page == c->repair_page) {
+    c->repair_bitmap |= missing;
+  }
+
+  if(c->flags & FLAG_LAST_SENT) {
+    /* Leave the steady state. */
+    c->flags &= ~FLAG_LAST_SENT;
+    ctimer_set(&c->t, SEND_INTERVAL, timed_send, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_chunk(struct rudolph2_conn *c, int chunk, int flag,
+            uint8_t *data, int datalen)
+{
+  if((c->flags & FLAG_IS_STOPPED) == 0) {
+    c->cb->write_chunk(c, chunk * RUDOLPH2_DATASIZE, flag, data, datalen);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_page_data(struct rudolph2_conn *c, struct rudolph2_hdr *hdr)
+{
+  uint16_t chunk, bit, complete;
+  int len, last_page;
+
+  chunk = hdr->chunk;
+  if((c->flags & FLAG_LAST_RECEIVED) || chunk < c->rcv_nxt) {
+    return;
+  }
+  bit = 0;
+  if(chunk - c->rcv_nxt < RUDOLPH2_PAGE_CHUNKS) {
+    bit = 1U << (chunk - c->rcv_nxt);
+  }
+  if(bit == 0 || (c->rcv_bitmap & bit)) {
+    /* The sender has moved past our page, or it repeats the last
+       chunk because it is done, so we are missing something. Other
+       duplicates are repairs for other nodes. */
+    if(bit == 0 || chunk == c->last_chunk) {
+      send_nack(c);
+    }
+    return;
+  }
+
+  packetbuf_hdrreduce(sizeof(struct rudolph2_hdr));
+  len = packetbuf_datalen();
+  if(len < RUDOLPH2_DATASIZE) {
+    c->last_chunk = chunk;
+  }
+  c->rcv_bitmap |= bit;
+
+  complete = 0xffff;
+  last_page = c->last_chunk - c->rcv_nxt < RUDOLPH2_PAGE_CHUNKS;
+  if(last_page) {
+    complete = (2UL << (c->last_chunk - c->rcv_nxt)) - 1;
+  }
+
+  if((c->rcv_bitmap & complete) != complete) {
+    store_chunk(c, chunk, RUDOLPH2_FLAG_NONE, packetbuf_dataptr(), len);
+    if(chunk == c->last_chunk ||
+       chunk - c->rcv_nxt == RUDOLPH2_PAGE_CHUNKS - 1) {
+      /* The end of the page has been reached with holes in it. */
+      send_nack(c);
+    }
+    return;
+  }
+
+  PRINTF("%d.%d: page %d complete\n",
+	 linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+	 c->rcv_nxt / RUDOLPH2_PAGE_CHUNKS);
+  if(last_page) {
+    store_chunk(c, chunk, RUDOLPH2_FLAG_LASTCHUNK, packetbuf_dataptr(), len);
+    c->rcv_nxt = c->last_chunk + 1;
+    c->flags |= FLAG_LAST_RECEIVED;
+  } else {
+    store_chunk(c, chunk, RUDOLPH2_FLAG_NONE, packetbuf_dataptr(), len);
+    c->rcv_nxt += RUDOLPH2_PAGE_CHUNKS;
+  }
+  c->rcv_bitmap = 0;
+
+  /* Start forwarding with the first complete page. */
+  if(ctimer_expired(&c->t)) {
+    ctimer_set(&c->t, SEND_INTERVAL, timed_send, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#else /* RUDOLPH2_PIPELINE */
 static void
 timed_send(void *ptr)
 {
@@ -284,6 +452,7 @@ timed_send(void *ptr)
     ctimer_set(&c->t, interval, timed_send, c);
   }
 }
+#endif /* RUDOLPH2_PIPELINE */
 /*---------------------------------------------------------------------------*/
 static void
 recv(struct polite_conn *polite)
@@ -301,12 +470,19 @@ recv(struct polite_conn *polite)
 	   hdr->version, hdr->chunk,
 	   c->version, c->rcv_nxt);
     if(hdr->version == c->version) {
+#if RUDOLPH2_PIPELINE
+      recv_repair_request(c, hdr);
+#else /* RUDOLPH2_PIPELINE */
       if(hdr->chunk < c->rcv_nxt) {
 	c->snd_nxt = hdr->chunk;
 	send_data(c, SEND_INTERVAL);
       }
+#endif /* RUDOLPH2_PIPELINE */
     } else if(LT(hdr->version, c->version)) {
       c->snd_nxt = 0;
+#if RUDOLPH2_PIPELINE
+      c->repair_bitmap = 0;
+#endif /* RUDOLPH2_PIPELINE */
       send_data(c, SEND_INTERVAL);
     }
   } else if(hdr->type == TYPE_DATA) {
@@ -322,25 +498,35 @@ recv(struct polite_conn *polite)
 	c->snd_nxt = c->rcv_nxt = 0;
 	c->flags &= ~FLAG_LAST_RECEIVED;
 	c->flags &= ~FLAG_LAST_SENT;
+#if RUDOLPH2_PIPELINE
+	c->rcv_bitmap = 0;
+	c->repair_bitmap = 0;
+	c->last_chunk = LAST_CHUNK_UNKNOWN;
+	store_chunk(c, 0, RUDOLPH2_FLAG_NEWFILE, NULL, 0);
+	recv_page_data(c, hdr);
+#else /* RUDOLPH2_PIPELINE */
 	if(hdr->chunk != 0) {
 	  send_nack(c);
 	} else {
 	  packetbuf_hdrreduce(sizeof(struct rudolph2_hdr));
-	  write_data(c, 0, packetbuf_dataptr(), packetbuf_totlen());
+	  write_data(c, 0, packetbuf_dataptr(), packetbuf_datalen());
 	}
+#endif /* RUDOLPH2_PIPELINE */
       } else if(hdr->version == c->version) {
 	PRINTF("%d.%d: got chunk %d snd_nxt %d rcv_nxt %d\n",
 	       linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
 	       hdr->chunk, c->snd_nxt, c->rcv_nxt);
-	
+#if RUDOLPH2_PIPELINE
+	recv_page_data(c, hdr);
+#else /* RUDOLPH2_PIPELINE */
 	if(hdr->chunk == c->rcv_nxt) {
 	  int len;
 	  packetbuf_hdrreduce(sizeof(struct rudolph2_hdr));
 	  PRINTF("%d.%d: received chunk %d len %d\n",
 		 linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
-		 hdr->chunk, packetbuf_totlen());
-	  len = packetbuf_totlen();
-	  write_data(c, hdr->chunk, packetbuf_dataptr(), packetbuf_totlen());
+		 hdr->chunk, packetbuf_datalen());
+	  len = packetbuf_datalen();
+	  write_data(c, hdr->chunk, packetbuf_dataptr(), packetbuf_datalen());
 	  c->rcv_nxt++;
 	  if(len < RUDOLPH2_DATASIZE) {
 	    c->flags |= FLAG_LAST_RECEIVED;
@@ -355,6 +541,7 @@ recv(struct polite_conn *polite)
 	} else if(hdr->chunk < c->rcv_nxt) {
 	  /* Ignore packets with a lower chunk number */
 	}
+#endif /* RUDOLPH2_PIPELINE */
       }
     }
   }
@@ -370,6 +557,12 @@ rudolph2_open(struct rudolph2_conn *c, uint16_t channel,
   c->cb = cb;
   c->version = 0;
   c->hops_from_base = HOPS_MAX;
+#if RUDOLPH2_PIPELINE
+  c->snd_nxt = c->rcv_nxt = 0;
+  c->rcv_bitmap = 0;
+  c->repair_bitmap = 0;
+  c->last_chunk = LAST_CHUNK_UNKNOWN;
+#endif /* RUDOLPH2_PIPELINE */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -392,6 +585,11 @@ rudolph2_send(struct rudolph2_conn *c, clock_time_t send_interval)
     len = read_data(c, packetbuf_dataptr(), c->rcv_nxt);
   }
   c->flags = FLAG_LAST_RECEIVED;
+#if RUDOLPH2_PIPELINE
+  c->last_chunk = c->rcv_nxt - 1;
+  c->rcv_bitmap = 0;
+  c->repair_bitmap = 0;
+#endif /* RUDOLPH2_PIPELINE */
   /*  printf("Highest chunk %d\n", c->rcv_nxt);*/
   send_data(c, SEND_INTERVAL);
   ctimer_set(&c->t, SEND_INTERVAL, timed_send, c);
@@ -54,6 +54,25 @@
  * The rudolph2 module uses 2 channels; one for data packets and one
  * for NACK and repair packets.
  *
+ * \section rudolph2-pipeline Pipelining
+ *
+ * By default, a node forwards a file only after it has received all
+ * of it, so a file needs the number of hops times the file transfer
+ * time to cross the network. With RUDOLPH2_CONF_PIPELINE, the file is
+ * divided into pages of RUDOLPH2_PAGE_CHUNKS chunks. The chunks of a
+ * page may arrive in any order, and a node starts forwarding each page
+ * as soon as it is complete, while it receives the following ones. A
+ * NACK carries a bitmap of the chunks that the node is missing in its
+ * current page. The bitmaps from all NACKs for a page are combined by
+ * the sender, which sends the requested chunks before it continues
+ * with new ones. All nodes must be built with the same setting.
+ *
+ * In pipelined mode, chunks are written to the application in the
+ * order they arrive. RUDOLPH2_FLAG_NEWFILE is given in a separate call
+ * with no data before the first chunk, and RUDOLPH2_FLAG_LASTCHUNK is
+ * given with the chunk that completes the file, which need not be the
+ * last chunk of the file.
+ *
  */
 
 #ifndef RUDOLPH2_H_
@@ -79,11 +98,28 @@ struct rudolph2_callbacks {
 
 #define RUDOLPH2_DATASIZE 64
 
+#ifdef RUDOLPH2_CONF_PIPELINE
+#define RUDOLPH2_PIPELINE RUDOLPH2_CONF_PIPELINE
+#else /* RUDOLPH2_CONF_PIPELINE */
+#define RUDOLPH2_PIPELINE 0
+#endif /* RUDOLPH2_CONF_PIPELINE */
+
+/* The number of chunks in a page; the page bitmaps are 16 bits wide. */
+#define RUDOLPH2_PAGE_CHUNKS 16
+
 struct rudolph2_conn {
   struct polite_conn c;
   const struct rudolph2_callbacks *cb;
   struct ctimer t;
   uint16_t snd_nxt, rcv_nxt;
+#if RUDOLPH2_PIPELINE
+  /* rcv_nxt is the first chunk of the page that is being received,
+     and rcv_bitmap tells which of its chunks have been received. */
+  uint16_t rcv_bitmap;
+  uint16_t last_chunk;
+  uint16_t repair_page;
+  uint16_t repair_bitmap;
+#endif /* RUDOLPH2_PIPELINE */
   uint16_t version;
   uint8_t hops_from_base;
   uint8_t nacks;
@@ -245,6 +245,30 @@
 #define RPL_WITH_DAO_ACK 0
 #endif /* RPL_CONF_WITH_DAO_ACK */
 
+/*
+ * DAO aggregation for storing mode. When enabled, targets of DAOs that do
+ * not request an ACK are queued for up to RPL_DAO_AGGREGATION_DELAY and
+ * sent to the preferred parent together, up to RPL_DAO_AGGREGATION_MAX
+ * per DAO, and DAOs carrying several targets are processed as a whole.
+ */
+#ifdef RPL_CONF_DAO_AGGREGATION
+#define RPL_DAO_AGGREGATION RPL_CONF_DAO_AGGREGATION
+#else
+#define RPL_DAO_AGGREGATION 0
+#endif /* RPL_CONF_DAO_AGGREGATION */
+
+#ifdef RPL_CONF_DAO_AGGREGATION_DELAY
+#define RPL_DAO_AGGREGATION_DELAY RPL_CONF_DAO_AGGREGATION_DELAY
+#else
+#define RPL_DAO_AGGREGATION_DELAY (CLOCK_SECOND / 4)
+#endif /* RPL_CONF_DAO_AGGREGATION_DELAY */
+
+#ifdef RPL_CONF_DAO_AGGREGATION_MAX
+#define RPL_DAO_AGGREGATION_MAX RPL_CONF_DAO_AGGREGATION_MAX
+#else
+#define RPL_DAO_AGGREGATION_MAX 8
+#endif /* RPL_CONF_DAO_AGGREGATION_MAX */
+
 /*
  * RPL REPAIR ON DAO NACK. When enabled, DAO NACK will trigger a local
  * repair in order to quickly find a new parent to send DAO's to.
@@ -320,6 +344,109 @@
 #define RPL_PROBING_DELAY_FUNC get_probing_delay
 #endif
 
+/*
+ * Parent cache. When enabled, the rank via each parent is cached along
+ * with the parent rank and link ETX it was computed from, and parent
+ * selection skips the full OF comparison when no parent changed since
+ * the previous selection.
+ */
+#ifdef RPL_CONF_PARENT_CACHE
+#define RPL_PARENT_CACHE RPL_CONF_PARENT_CACHE
+#else
+#define RPL_PARENT_CACHE 0
+#endif
+
+/*
+ * Maximum number of consecutive parent selections the parent cache may
+ * skip before a full selection is done anyway.
+ */
+#ifdef RPL_CONF_PARENT_CACHE_MAX_SKIP
+#define RPL_PARENT_CACHE_MAX_SKIP RPL_CONF_PARENT_CACHE_MAX_SKIP
+#else
+#define RPL_PARENT_CACHE_MAX_SKIP 8
+#endif
+
+/*
+ * Number of destinations for which a non-storing root keeps the source
+ * routing header it built, so that later packets to the same destination
+ * copy it instead of walking the node tree. 0 disables the cache.
+ */
+#ifdef RPL_CONF_SRH_CACHE_SIZE
+#define RPL_SRH_CACHE_SIZE RPL_CONF_SRH_CACHE_SIZE
+#else
+#define RPL_SRH_CACHE_SIZE 0
+#endif
+
+/*
+ * Longest source routing header, in bytes, the SRH cache stores.
+ */
+#ifdef RPL_CONF_SRH_CACHE_MAX_LEN
+#define RPL_SRH_CACHE_MAX_LEN RPL_CONF_SRH_CACHE_MAX_LEN
+#else
+#define RPL_SRH_CACHE_MAX_LEN 64
+#endif
+
+/*
+ * Save the DAG, the parents and their link statistics to CFS, and use
+ * them after a reboot to rejoin without waiting for DIOs. See
+ * rpl-snapshot.h.
+ */
+#ifdef RPL_CONF_WITH_SNAPSHOT
+#define RPL_WITH_SNAPSHOT RPL_CONF_WITH_SNAPSHOT
+#else
+#define RPL_WITH_SNAPSHOT 0
+#endif
+
+/*
+ * Multipath forwarding. When enabled, packets going up the DAG are
+ * spread over the parents whose rank via them is within
+ * RPL_MULTIPATH_RANK_TOLERANCE of the rank via the preferred parent,
+ * in proportion to the inverse of their link metric. All packets of a
+ * flow take the same parent while the flow is active, so that they are
+ * not reordered.
+ */
+#ifdef RPL_CONF_WITH_MULTIPATH
+#define RPL_WITH_MULTIPATH RPL_CONF_WITH_MULTIPATH
+#else
+#define RPL_WITH_MULTIPATH 0
+#endif
+
+/*
+ * Rank tolerance for multipath forwarding. Defaults to half of
+ * the MinHopRankIncrease of the instance.
+ */
+#ifdef RPL_CONF_MULTIPATH_RANK_TOLERANCE
+#define RPL_MULTIPATH_RANK_TOLERANCE(instance) RPL_CONF_MULTIPATH_RANK_TOLERANCE
+#else
+#define RPL_MULTIPATH_RANK_TOLERANCE(instance) ((instance)->min_hoprankinc / 2)
+#endif
+
+/*
+ * Number of flows whose parent multipath forwarding remembers, and the
+ * time after which an idle flow may move to another parent.
+ */
+#ifdef RPL_CONF_MULTIPATH_FLOWS
+#define RPL_MULTIPATH_FLOWS RPL_CONF_MULTIPATH_FLOWS
+#else
+#define RPL_MULTIPATH_FLOWS 8
+#endif
+
+#ifdef RPL_CONF_MULTIPATH_FLOW_TIMEOUT
+#define RPL_MULTIPATH_FLOW_TIMEOUT RPL_CONF_MULTIPATH_FLOW_TIMEOUT
+#else
+#define RPL_MULTIPATH_FLOW_TIMEOUT (10 * CLOCK_SECOND)
+#endif
+
+/*
+ * Function that returns the number of packets queued by the MAC layer
+ * for a link-layer address, e.g. csma_queue_length or
+ * tsch_queue_packet_count. A parent with a longer queue then takes a
+ * smaller share of the new flows. Not used by default.
+ */
+#ifdef RPL_CONF_MULTIPATH_QUEUE_LENGTH
+#define RPL_MULTIPATH_QUEUE_LENGTH RPL_CONF_MULTIPATH_QUEUE_LENGTH
+#endif
+
 /*
  * Interval of DIS transmission
  */
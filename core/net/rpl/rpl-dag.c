@@ -87,6 +87,21 @@ NBR_TABLE_GLOBAL(rpl_parent_t, rpl_parents);
 rpl_instance_t instance_table[RPL_MAX_INSTANCES];
 rpl_instance_t *default_instance;
 
+#if RPL_PARENT_CACHE
+/* Bumped whenever instance parameters used by the OFs change, which
+ * invalidates the rank cached in every parent */
+static uint8_t parent_cache_epoch;
+/* DAG and preferred parent chosen by the last full parent selection */
+static rpl_dag_t *selected_dag;
+static rpl_parent_t *selected_parent;
+static uint8_t selection_skips;
+#define PARENT_CACHE_INVALIDATE(p) ((p)->flags &= ~RPL_PARENT_FLAG_CACHE_VALID)
+#define PARENT_CACHE_NEW_EPOCH() (parent_cache_epoch++)
+#else /* RPL_PARENT_CACHE */
+#define PARENT_CACHE_INVALIDATE(p)
+#define PARENT_CACHE_NEW_EPOCH()
+#endif /* RPL_PARENT_CACHE */
+
 /*---------------------------------------------------------------------------*/
 void
 rpl_print_neighbor_list(void)
@@ -96,7 +111,6 @@ rpl_print_neighbor_list(void)
     int curr_dio_interval = default_instance->dio_intcurrent;
     int curr_rank = default_instance->current_dag->rank;
     rpl_parent_t *p = nbr_table_head(rpl_parents);
-    clock_time_t clock_now = clock_time();
 
     printf("RPL: MOP %u OCP %u rank %u dioint %u, nbr count %u\n",
         default_instance->mop, default_instance->of->ocp, curr_rank, curr_dio_interval, uip_ds6_nbr_num());
@@ -110,7 +124,7 @@ rpl_print_neighbor_list(void)
           stats != NULL ? stats->freshness : 0,
           link_stats_is_fresh(stats) ? 'f' : ' ',
           p == default_instance->current_dag->preferred_parent ? 'p' : ' ',
-          (unsigned)((clock_now - stats->last_tx_time) / (60 * CLOCK_SECOND))
+          stats != NULL ? (unsigned)(link_stats_tx_age(stats) / (60 * CLOCK_SECOND)) : 0
       );
       p = nbr_table_next(rpl_parents, p);
     }
@@ -171,13 +185,46 @@ rpl_get_parent_link_metric(rpl_parent_t *p)
   return 0xffff;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_PARENT_CACHE
+/* Recomputes the rank cached in the parent if any of its inputs changed.
+ * Returns 1 if it had to be recomputed. */
+static int
+parent_cache_refresh(rpl_parent_t *p)
+{
+  const struct link_stats *stats;
+  uint16_t etx;
+
+  stats = rpl_get_parent_link_stats(p);
+  etx = stats != NULL ? stats->etx : 0xffff;
+
+  if((p->flags & RPL_PARENT_FLAG_CACHE_VALID)
+     && p->cache_rank == p->rank
+     && p->cache_etx == etx
+     && p->cache_epoch == parent_cache_epoch) {
+    return 0;
+  }
+
+  p->cache_rank_via = p->dag->instance->of->rank_via_parent(p);
+  p->cache_rank = p->rank;
+  p->cache_etx = etx;
+  p->cache_epoch = parent_cache_epoch;
+  p->flags |= RPL_PARENT_FLAG_CACHE_VALID;
+  return 1;
+}
+#endif /* RPL_PARENT_CACHE */
+/*---------------------------------------------------------------------------*/
 rpl_rank_t
 rpl_rank_via_parent(rpl_parent_t *p)
 {
   if(p != NULL && p->dag != NULL) {
     rpl_instance_t *instance = p->dag->instance;
     if(instance != NULL && instance->of != NULL && instance->of->rank_via_parent != NULL) {
+#if RPL_PARENT_CACHE
+      parent_cache_refresh(p);
+      return p->cache_rank_via;
+#else /* RPL_PARENT_CACHE */
       return instance->of->rank_via_parent(p);
+#endif /* RPL_PARENT_CACHE */
     }
   }
   return INFINITE_RANK;
@@ -411,6 +458,7 @@ rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id)
   instance->dio_redundancy = RPL_DIO_REDUNDANCY;
   instance->max_rankinc = RPL_MAX_RANKINC;
   instance->min_hoprankinc = RPL_MIN_HOPRANKINC;
+  PARENT_CACHE_NEW_EPOCH();
   instance->default_lifetime = RPL_DEFAULT_LIFETIME;
   instance->lifetime_unit = RPL_DEFAULT_LIFETIME_UNIT;
 
@@ -699,6 +747,7 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
       p->dtsn = dio->dtsn;
 #if RPL_WITH_MC
       memcpy(&p->mc, &dio->mc, sizeof(p->mc));
+      PARENT_CACHE_INVALIDATE(p);
 #endif /* RPL_WITH_MC */
     }
   }
@@ -894,11 +943,60 @@ best_parent(rpl_dag_t *dag, int fresh_only)
   return best;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_PARENT_CACHE
+/* Checks whether the previous selection for the DAG still holds, that is
+ * whether no parent of the DAG changed and the preferred parent is still
+ * the one that selection picked */
+static int
+selection_is_current(rpl_dag_t *dag)
+{
+  rpl_parent_t *p;
+  int changed;
+
+  changed = 0;
+  for(p = nbr_table_head(rpl_parents); p != NULL; p = nbr_table_next(rpl_parents, p)) {
+    if(p->dag == dag) {
+      changed |= parent_cache_refresh(p);
+    }
+  }
+
+  if(changed || dag != selected_dag || dag->preferred_parent == NULL
+     || dag->preferred_parent != selected_parent
+     || selection_skips >= RPL_PARENT_CACHE_MAX_SKIP) {
+    return 0;
+  }
+#if UIP_ND6_SEND_NS
+  /* Reachability changes are not tracked by the cache */
+  return 0;
+#endif /* UIP_ND6_SEND_NS */
+#if RPL_WITH_PROBING
+  /* A preferred parent that is not fresh calls for probing, see below */
+  if(!rpl_parent_is_fresh(dag->preferred_parent)) {
+    return 0;
+  }
+#endif /* RPL_WITH_PROBING */
+  return 1;
+}
+#endif /* RPL_PARENT_CACHE */
+/*---------------------------------------------------------------------------*/
 rpl_parent_t *
 rpl_select_parent(rpl_dag_t *dag)
 {
+  rpl_parent_t *best;
+
+#if RPL_PARENT_CACHE
+  if(dag != NULL && dag->instance != NULL && dag->instance->of != NULL) {
+    if(selection_is_current(dag)) {
+      selection_skips++;
+      dag->rank = rpl_rank_via_parent(dag->preferred_parent);
+      return dag->preferred_parent;
+    }
+    selection_skips = 0;
+  }
+#endif /* RPL_PARENT_CACHE */
+
   /* Look for best parent (regardless of freshness) */
-  rpl_parent_t *best = best_parent(dag, 0);
+  best = best_parent(dag, 0);
 
   if(best != NULL) {
 #if RPL_WITH_PROBING
@@ -926,6 +1024,11 @@ rpl_select_parent(rpl_dag_t *dag)
     rpl_set_preferred_parent(dag, NULL);
   }
 
+#if RPL_PARENT_CACHE
+  selected_dag = dag;
+  selected_parent = dag->preferred_parent;
+#endif /* RPL_PARENT_CACHE */
+
   dag->rank = rpl_rank_via_parent(dag->preferred_parent);
   return dag->preferred_parent;
 }
@@ -939,6 +1042,12 @@ rpl_remove_parent(rpl_parent_t *parent)
 
   rpl_nullify_parent(parent);
 
+#if RPL_PARENT_CACHE
+  if(parent == selected_parent) {
+    selected_parent = NULL;
+  }
+#endif /* RPL_PARENT_CACHE */
+
   nbr_table_remove(rpl_parents, parent);
 }
 /*---------------------------------------------------------------------------*/
@@ -999,6 +1108,7 @@ rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent)
   PRINTF("\n");
 
   parent->dag = dag_dst;
+  PARENT_CACHE_INVALIDATE(parent);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -1140,6 +1250,7 @@ rpl_join_instance(uip_ipaddr_t *from, rpl_dio_t *dio)
 
   instance->max_rankinc = dio->dag_max_rankinc;
   instance->min_hoprankinc = dio->dag_min_hoprankinc;
+  PARENT_CACHE_NEW_EPOCH();
   instance->dio_intdoubl = dio->dag_intdoubl;
   instance->dio_intmin = dio->dag_intmin;
   instance->dio_intcurrent = instance->dio_intmin + instance->dio_intdoubl;
@@ -1607,6 +1718,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
 
 #if RPL_WITH_MC
   memcpy(&p->mc, &dio->mc, sizeof(p->mc));
+  PARENT_CACHE_INVALIDATE(p);
 #endif /* RPL_WITH_MC */
   if(rpl_process_parent_event(instance, p) == 0) {
     PRINTF("RPL: The candidate parent is rejected\n");
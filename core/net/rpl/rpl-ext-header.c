@@ -322,6 +322,86 @@ count_matching_bytes(const void *p1, const void *p2, size_t n)
   return n;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_SRH_CACHE_SIZE
+/* A source routing header built for a destination, valid as long as the
+ * rpl-ns generation has not changed. ext_len 0 means no SRH is needed. */
+struct srh_cache_entry {
+  uip_ipaddr_t dest;
+  uip_ipaddr_t next_hop;
+  rpl_dag_t *dag;
+  uint32_t generation;
+  uint8_t ext_len;
+  uint8_t hdr[RPL_SRH_CACHE_MAX_LEN];
+};
+static struct srh_cache_entry srh_cache[RPL_SRH_CACHE_SIZE];
+static uint8_t srh_cache_next;
+/*---------------------------------------------------------------------------*/
+static struct srh_cache_entry *
+srh_cache_lookup(rpl_dag_t *dag, const uip_ipaddr_t *dest)
+{
+  uint32_t generation;
+  int i;
+
+  generation = rpl_ns_get_generation();
+  for(i = 0; i < RPL_SRH_CACHE_SIZE; i++) {
+    if(srh_cache[i].dag == dag && srh_cache[i].generation == generation
+       && uip_ipaddr_cmp(&srh_cache[i].dest, dest)) {
+      return &srh_cache[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Stores the header found at UIP_RH_BUF, built for dest */
+static void
+srh_cache_add(rpl_dag_t *dag, const uip_ipaddr_t *dest, uint8_t ext_len)
+{
+  struct srh_cache_entry *e;
+
+  if(ext_len > RPL_SRH_CACHE_MAX_LEN) {
+    return;
+  }
+
+  e = &srh_cache[srh_cache_next];
+  srh_cache_next = (srh_cache_next + 1) % RPL_SRH_CACHE_SIZE;
+
+  uip_ipaddr_copy(&e->dest, dest);
+  uip_ipaddr_copy(&e->next_hop, &UIP_IP_BUF->destipaddr);
+  e->dag = dag;
+  e->generation = rpl_ns_get_generation();
+  e->ext_len = ext_len;
+  memcpy(e->hdr, UIP_RH_BUF, ext_len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+srh_cache_insert(const struct srh_cache_entry *e)
+{
+  uint8_t temp_len;
+
+  if(uip_len + e->ext_len > UIP_BUFSIZE) {
+    PRINTF("RPL: Packet too long: impossible to add source routing header (%u bytes)\n", e->ext_len);
+    return;
+  }
+
+  memmove(uip_buf + uip_l2_l3_hdr_len + e->ext_len,
+      uip_buf + uip_l2_l3_hdr_len, uip_len - UIP_IPH_LEN);
+  memcpy(uip_buf + uip_l2_l3_hdr_len, e->hdr, e->ext_len);
+
+  UIP_RH_BUF->next = UIP_IP_BUF->proto;
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &e->next_hop);
+
+  temp_len = UIP_IP_BUF->len[1];
+  UIP_IP_BUF->len[1] += e->ext_len;
+  if(UIP_IP_BUF->len[1] < temp_len) {
+    UIP_IP_BUF->len[0]++;
+  }
+
+  uip_ext_len += e->ext_len;
+  uip_len += e->ext_len;
+}
+#endif /* RPL_SRH_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
 static int
 insert_srh_header(void)
 {
@@ -337,6 +417,10 @@ insert_srh_header(void)
   rpl_ns_node_t *node;
   rpl_dag_t *dag;
   uip_ipaddr_t node_addr;
+#if RPL_SRH_CACHE_SIZE
+  struct srh_cache_entry *cached;
+  uip_ipaddr_t dest_addr;
+#endif /* RPL_SRH_CACHE_SIZE */
 
   PRINTF("RPL: SRH creating source routing header with destination ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
@@ -352,6 +436,17 @@ insert_srh_header(void)
     return 0;
   }
 
+#if RPL_SRH_CACHE_SIZE
+  cached = srh_cache_lookup(dag, &UIP_IP_BUF->destipaddr);
+  if(cached != NULL) {
+    if(cached->ext_len > 0) {
+      srh_cache_insert(cached);
+    }
+    return 1;
+  }
+  uip_ipaddr_copy(&dest_addr, &UIP_IP_BUF->destipaddr);
+#endif /* RPL_SRH_CACHE_SIZE */
+
   dest_node = rpl_ns_get_node(dag, &UIP_IP_BUF->destipaddr);
   if(dest_node == NULL) {
     /* The destination is not found, skip SRH insertion */
@@ -378,6 +473,9 @@ insert_srh_header(void)
 
   if(node == root_node) {
     PRINTF("RPL: SRH no need to insert SRH\n");
+#if RPL_SRH_CACHE_SIZE
+    srh_cache_add(dag, &dest_addr, 0);
+#endif /* RPL_SRH_CACHE_SIZE */
     return 1;
   }
 
@@ -459,6 +557,10 @@ insert_srh_header(void)
   uip_ext_len += ext_len;
   uip_len += ext_len;
 
+#if RPL_SRH_CACHE_SIZE
+  srh_cache_add(dag, &dest_addr, ext_len);
+#endif /* RPL_SRH_CACHE_SIZE */
+
   return 1;
 }
 #else /* RPL_WITH_NON_STORING */
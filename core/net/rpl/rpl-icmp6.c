@@ -52,6 +52,7 @@
 #include "net/ipv6/uip-icmp6.h"
 #include "net/rpl/rpl-private.h"
 #include "net/rpl/rpl-ns.h"
+#include "net/rpl/rpl-snapshot.h"
 #include "net/packetbuf.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "random.h"
@@ -95,6 +96,23 @@ static uint8_t dao_sequence = RPL_LOLLIPOP_INIT;
 #if RPL_WITH_MULTICAST
 static uip_mcast6_route_t *mcast_group;
 #endif
+
+#if RPL_WITH_STORING && RPL_DAO_AGGREGATION
+/* A DAO target and the lifetime of its transit information */
+struct dao_target {
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  uint8_t lifetime;
+};
+/* Targets waiting to be sent to the preferred parent of dao_agg_dag */
+static struct dao_target dao_agg_targets[RPL_DAO_AGGREGATION_MAX];
+static uint8_t dao_agg_count;
+static rpl_dag_t *dao_agg_dag;
+static struct ctimer dao_agg_timer;
+
+static void dao_agg_add(rpl_dag_t *dag, const uip_ipaddr_t *prefix,
+                        uint8_t prefixlen, uint8_t lifetime);
+#endif /* RPL_WITH_STORING && RPL_DAO_AGGREGATION */
 /*---------------------------------------------------------------------------*/
 /* Initialise RPL ICMPv6 message handlers */
 UIP_ICMP6_HANDLER(dis_handler, ICMP6_RPL, RPL_CODE_DIS, dis_input);
@@ -199,6 +217,13 @@ rpl_icmp6_update_nbr_table(uip_ipaddr_t *from, nbr_table_reason_t reason, void *
       PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
       PRINTF("\n");
     }
+#if UIP_DS6_UL_NUD && UIP_ND6_SEND_NS
+  } else if(linkaddr_cmp((linkaddr_t *)uip_ds6_nbr_get_ll(nbr),
+                         packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+    /* Hearing a RPL control message from the neighbor makes NUD probes
+       towards it redundant */
+    uip_ds6_nbr_confirm_reachable(nbr);
+#endif /* UIP_DS6_UL_NUD && UIP_ND6_SEND_NS */
   }
 
   return nbr;
@@ -459,6 +484,10 @@ dio_input(void)
   RPL_DEBUG_DIO_INPUT(&from, &dio);
 #endif
 
+#if RPL_WITH_SNAPSHOT
+  rpl_snapshot_dio_input(&dio);
+#endif /* RPL_WITH_SNAPSHOT */
+
   rpl_process_dio(&from, &dio);
 
 discard:
@@ -621,6 +650,133 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_STORING && RPL_DAO_AGGREGATION
+/* Processes a DAO that does not request an ACK and may carry several
+ * targets. Targets to forward are queued for aggregation. */
+static void
+dao_input_storing_aggregated(rpl_instance_t *instance, rpl_dag_t *dag,
+                             const uip_ipaddr_t *dao_sender_addr,
+                             int learned_from, uint16_t sequence,
+                             const unsigned char *buffer, int pos,
+                             int buffer_length)
+{
+  struct dao_target targets[RPL_DAO_AGGREGATION_MAX];
+  struct dao_target *t;
+  uip_ds6_route_t *rep;
+  uip_ds6_nbr_t *nbr;
+  uint8_t subopt_type;
+  int num_targets;
+  int first_unassigned;
+  int forward;
+  int len;
+  int i;
+
+  /* Parse all options first, as processing targets reuses uip_buf */
+  num_targets = 0;
+  first_unassigned = 0;
+  for(i = pos; i < buffer_length; i += len) {
+    subopt_type = buffer[i];
+    if(subopt_type == RPL_OPTION_PAD1) {
+      len = 1;
+    } else {
+      /* The option consists of a two-byte header and a payload. */
+      len = 2 + buffer[i + 1];
+    }
+
+    switch(subopt_type) {
+      case RPL_OPTION_TARGET:
+        if(num_targets == RPL_DAO_AGGREGATION_MAX) {
+          PRINTF("RPL: Too many targets in DAO, ignoring some\n");
+          break;
+        }
+        t = &targets[num_targets++];
+        t->prefixlen = buffer[i + 3];
+        t->lifetime = instance->default_lifetime;
+        memset(&t->prefix, 0, sizeof(t->prefix));
+        memcpy(&t->prefix, buffer + i + 4, (t->prefixlen + 7) / CHAR_BIT);
+        break;
+      case RPL_OPTION_TRANSIT:
+        /* A transit option applies to the targets preceding it */
+        for(; first_unassigned < num_targets; first_unassigned++) {
+          targets[first_unassigned].lifetime = buffer[i + 5];
+        }
+        break;
+    }
+  }
+
+  forward = learned_from == RPL_ROUTE_FROM_UNICAST_DAO
+      && dag->preferred_parent != NULL
+      && rpl_get_parent_ipaddr(dag->preferred_parent) != NULL;
+  nbr = NULL;
+
+  for(t = targets; t < targets + num_targets; t++) {
+    PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
+           (unsigned)t->lifetime, (unsigned)t->prefixlen);
+    PRINT6ADDR(&t->prefix);
+    PRINTF("\n");
+
+#if RPL_WITH_MULTICAST
+    if(uip_is_addr_mcast_global(&t->prefix)) {
+      mcast_group = uip_mcast6_route_add(&t->prefix);
+      if(mcast_group) {
+        mcast_group->dag = dag;
+        mcast_group->lifetime = RPL_LIFETIME(instance, t->lifetime);
+      }
+      if(forward) {
+        dao_agg_add(dag, &t->prefix, t->prefixlen, t->lifetime);
+      }
+      continue;
+    }
+#endif
+
+    rep = uip_ds6_route_lookup(&t->prefix);
+
+    if(t->lifetime == RPL_ZERO_LIFETIME) {
+      PRINTF("RPL: No-Path DAO received\n");
+      if(rep != NULL &&
+         !RPL_ROUTE_IS_NOPATH_RECEIVED(rep) &&
+         rep->length == t->prefixlen &&
+         uip_ds6_route_nexthop(rep) != NULL &&
+         uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), dao_sender_addr)) {
+        RPL_ROUTE_SET_NOPATH_RECEIVED(rep);
+        rep->state.lifetime = RPL_NOPATH_REMOVAL_DELAY;
+        if(forward) {
+          dao_agg_add(dag, &t->prefix, t->prefixlen, RPL_ZERO_LIFETIME);
+        }
+      }
+      continue;
+    }
+
+    /* Update and add neighbor - if no room - fail. */
+    if(nbr == NULL) {
+      nbr = rpl_icmp6_update_nbr_table((uip_ipaddr_t *)dao_sender_addr,
+                                       NBR_TABLE_REASON_RPL_DAO, instance);
+      if(nbr == NULL) {
+        PRINTF("RPL: Out of Memory, dropping DAO\n");
+        return;
+      }
+    }
+
+    rep = rpl_add_route(dag, &t->prefix, t->prefixlen,
+                        (uip_ipaddr_t *)dao_sender_addr);
+    if(rep == NULL) {
+      RPL_STAT(rpl_stats.mem_overflows++);
+      PRINTF("RPL: Could not add a route after receiving a DAO\n");
+      continue;
+    }
+
+    /* set lifetime and clear NOPATH bit */
+    rep->state.lifetime = RPL_LIFETIME(instance, t->lifetime);
+    rep->state.dao_seqno_in = sequence;
+    RPL_ROUTE_CLEAR_NOPATH_RECEIVED(rep);
+
+    if(forward) {
+      dao_agg_add(dag, &t->prefix, t->prefixlen, t->lifetime);
+    }
+  }
+}
+#endif /* RPL_WITH_STORING && RPL_DAO_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 static void
 dao_input_storing(void)
 {
@@ -715,6 +871,15 @@ dao_input_storing(void)
     }
   }
 
+#if RPL_DAO_AGGREGATION
+  if(!(flags & RPL_DAO_K_FLAG)) {
+    dao_input_storing_aggregated(instance, dag, &dao_sender_addr,
+                                 learned_from, sequence,
+                                 buffer, pos, buffer_length);
+    return;
+  }
+#endif /* RPL_DAO_AGGREGATION */
+
   /* Check if there are any RPL options present. */
   for(i = pos; i < buffer_length; i += len) {
     subopt_type = buffer[i];
@@ -1086,6 +1251,112 @@ handle_dao_retransmission(void *ptr)
 }
 #endif /* RPL_WITH_DAO_ACK */
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_STORING && RPL_DAO_AGGREGATION
+/* Sends the queued targets to the preferred parent in a single DAO */
+static void
+dao_agg_flush(void *ptr)
+{
+  rpl_dag_t *dag;
+  uip_ipaddr_t *parent_ipaddr;
+  unsigned char *buffer;
+  uint8_t count;
+  uint8_t i;
+  int pos;
+
+  ctimer_stop(&dao_agg_timer);
+  count = dao_agg_count;
+  dao_agg_count = 0;
+  dag = dao_agg_dag;
+
+  if(count == 0 || dag == NULL || dag->instance == NULL
+     || dag->preferred_parent == NULL || rpl_get_mode() == RPL_MODE_FEATHER) {
+    return;
+  }
+  parent_ipaddr = rpl_get_parent_ipaddr(dag->preferred_parent);
+  if(parent_ipaddr == NULL) {
+    return;
+  }
+
+  buffer = UIP_ICMP_PAYLOAD;
+  pos = 0;
+
+  buffer[pos++] = dag->instance->instance_id;
+  buffer[pos] = 0;
+#if RPL_DAO_SPECIFY_DAG
+  buffer[pos] |= RPL_DAO_D_FLAG;
+#endif /* RPL_DAO_SPECIFY_DAG */
+  ++pos;
+  buffer[pos++] = 0; /* reserved */
+  RPL_LOLLIPOP_INCREMENT(dao_sequence);
+  buffer[pos++] = dao_sequence;
+#if RPL_DAO_SPECIFY_DAG
+  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
+  pos += sizeof(dag->dag_id);
+#endif /* RPL_DAO_SPECIFY_DAG */
+
+  for(i = 0; i < count; i++) {
+    struct dao_target *t = &dao_agg_targets[i];
+
+    buffer[pos++] = RPL_OPTION_TARGET;
+    buffer[pos++] = 2 + ((t->prefixlen + 7) / CHAR_BIT);
+    buffer[pos++] = 0; /* reserved */
+    buffer[pos++] = t->prefixlen;
+    memcpy(buffer + pos, &t->prefix, (t->prefixlen + 7) / CHAR_BIT);
+    pos += ((t->prefixlen + 7) / CHAR_BIT);
+
+    /* One transit option covers consecutive targets of equal lifetime */
+    if(i == count - 1 || dao_agg_targets[i + 1].lifetime != t->lifetime) {
+      buffer[pos++] = RPL_OPTION_TRANSIT;
+      buffer[pos++] = 4;
+      buffer[pos++] = 0; /* flags - ignored */
+      buffer[pos++] = 0; /* path control - ignored */
+      buffer[pos++] = 0; /* path seq - ignored */
+      buffer[pos++] = t->lifetime;
+    }
+  }
+
+  PRINTF("RPL: Sending an aggregated DAO with %u targets, sequence number %u to ",
+         count, dao_sequence);
+  PRINT6ADDR(parent_ipaddr);
+  PRINTF("\n");
+
+  uip_icmp6_send(parent_ipaddr, ICMP6_RPL, RPL_CODE_DAO, pos);
+}
+/*---------------------------------------------------------------------------*/
+/* Queues a target for the next aggregated DAO to the preferred parent */
+static void
+dao_agg_add(rpl_dag_t *dag, const uip_ipaddr_t *prefix, uint8_t prefixlen,
+            uint8_t lifetime)
+{
+  uint8_t i;
+
+  if(dao_agg_count > 0 && dao_agg_dag != dag) {
+    dao_agg_flush(NULL);
+  }
+
+  /* A newer advertisement of a queued target replaces it */
+  for(i = 0; i < dao_agg_count; i++) {
+    if(dao_agg_targets[i].prefixlen == prefixlen
+       && uip_ipaddr_cmp(&dao_agg_targets[i].prefix, prefix)) {
+      dao_agg_targets[i].lifetime = lifetime;
+      return;
+    }
+  }
+
+  if(dao_agg_count == RPL_DAO_AGGREGATION_MAX) {
+    dao_agg_flush(NULL);
+  }
+
+  uip_ipaddr_copy(&dao_agg_targets[dao_agg_count].prefix, prefix);
+  dao_agg_targets[dao_agg_count].prefixlen = prefixlen;
+  dao_agg_targets[dao_agg_count].lifetime = lifetime;
+  dao_agg_dag = dag;
+  if(dao_agg_count++ == 0) {
+    ctimer_set(&dao_agg_timer, RPL_DAO_AGGREGATION_DELAY, dao_agg_flush, NULL);
+  }
+}
+#endif /* RPL_WITH_STORING && RPL_DAO_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 void
 dao_output(rpl_parent_t *parent, uint8_t lifetime)
 {
@@ -1121,6 +1392,17 @@ dao_output(rpl_parent_t *parent, uint8_t lifetime)
   parent->dag->instance->has_downward_route = lifetime != RPL_ZERO_LIFETIME;
 #endif /* RPL_WITH_DAO_ACK */
 
+#if RPL_WITH_STORING && RPL_DAO_AGGREGATION
+  /* DAOs that request an ACK are sent on their own, and No-Path DAOs to a
+   * former parent must not be redirected to the preferred one */
+  if(RPL_IS_STORING(parent->dag->instance)
+     && parent == parent->dag->preferred_parent
+     && (!RPL_WITH_DAO_ACK || lifetime == RPL_ZERO_LIFETIME)) {
+    dao_agg_add(parent->dag, &prefix, sizeof(prefix) * CHAR_BIT, lifetime);
+    return;
+  }
+#endif /* RPL_WITH_STORING && RPL_DAO_AGGREGATION */
+
   /* Sending a DAO with own prefix as target */
   dao_output_target(parent, &prefix, lifetime);
 }
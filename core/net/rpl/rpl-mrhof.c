@@ -35,8 +35,9 @@
  *         The Minimum Rank with Hysteresis Objective Function (MRHOF), RFC6719
  *
  *         This implementation uses the estimated number of
- *         transmissions (ETX) as the additive routing metric,
- *         and also provides stubs for the energy metric.
+ *         transmissions (ETX) as the additive routing metric. With the
+ *         node energy metric (RPL_DAG_MC_ENERGY), relaying through a
+ *         node that is low on energy also adds to the path cost.
  *
  * \author Joakim Eriksson <joakime@sics.se>, Nicolas Tsiftes <nvt@sics.se>
  */
@@ -50,6 +51,8 @@
 #include "net/rpl/rpl-private.h"
 #include "net/nbr-table.h"
 #include "net/link-stats.h"
+#include "sys/energest.h"
+#include "sys/rtimer.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -88,6 +91,47 @@ to the threshold of 96 in the non-squared case) */
 /* Reject parents that have a higher path cost than the following. */
 #define MAX_PATH_COST      32768   /* Eq path ETX of 256 */
 
+/* With the node energy metric, the cost of relaying through a battery
+ * powered node that has no energy left. It decreases linearly with the
+ * energy the node advertises, down to 0 for a full battery or mains
+ * power. Default: eq ETX of 2. */
+#ifdef RPL_MRHOF_CONF_ENERGY_WEIGHT
+#define RPL_MRHOF_ENERGY_WEIGHT RPL_MRHOF_CONF_ENERGY_WEIGHT
+#else /* RPL_MRHOF_CONF_ENERGY_WEIGHT */
+#define RPL_MRHOF_ENERGY_WEIGHT (2 * LINK_STATS_ETX_DIVISOR)
+#endif /* RPL_MRHOF_CONF_ENERGY_WEIGHT */
+
+/* Set if the node is mains powered. The root always is. */
+#ifdef RPL_MRHOF_CONF_ENERGY_MAINS
+#define RPL_MRHOF_ENERGY_MAINS RPL_MRHOF_CONF_ENERGY_MAINS
+#else /* RPL_MRHOF_CONF_ENERGY_MAINS */
+#define RPL_MRHOF_ENERGY_MAINS 0
+#endif /* RPL_MRHOF_CONF_ENERGY_MAINS */
+
+/* The energy a node advertises is estimated from its radio duty cycle,
+ * measured with energest: 255 when the radio is off, 0 at this duty
+ * cycle (in percent) and above. A function that returns the remaining
+ * battery energy, from 0 to 255, can be set with
+ * RPL_MRHOF_CONF_ENERGY_LEVEL. The lower of both estimates is used. */
+#ifdef RPL_MRHOF_CONF_ENERGY_MAX_DUTY_CYCLE
+#define RPL_MRHOF_ENERGY_MAX_DUTY_CYCLE RPL_MRHOF_CONF_ENERGY_MAX_DUTY_CYCLE
+#else /* RPL_MRHOF_CONF_ENERGY_MAX_DUTY_CYCLE */
+#define RPL_MRHOF_ENERGY_MAX_DUTY_CYCLE 10
+#endif /* RPL_MRHOF_CONF_ENERGY_MAX_DUTY_CYCLE */
+
+#ifdef RPL_MRHOF_CONF_ENERGY_LEVEL
+#define RPL_MRHOF_ENERGY_LEVEL RPL_MRHOF_CONF_ENERGY_LEVEL
+uint8_t RPL_MRHOF_ENERGY_LEVEL(void);
+#endif /* RPL_MRHOF_CONF_ENERGY_LEVEL */
+
+/* The advertised energy changes only when the estimate moved more
+ * than this, so that children do not switch parents back and forth */
+#ifdef RPL_MRHOF_CONF_ENERGY_HYSTERESIS
+#define RPL_MRHOF_ENERGY_HYSTERESIS RPL_MRHOF_CONF_ENERGY_HYSTERESIS
+#else /* RPL_MRHOF_CONF_ENERGY_HYSTERESIS */
+#define RPL_MRHOF_ENERGY_HYSTERESIS 16
+#endif /* RPL_MRHOF_CONF_ENERGY_HYSTERESIS */
+
 /*---------------------------------------------------------------------------*/
 static void
 reset(rpl_dag_t *dag)
@@ -129,6 +173,22 @@ parent_link_metric(rpl_parent_t *p)
   return 0xffff;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_MC
+/* The cost of relaying through a parent, from the energy it advertises */
+static uint16_t
+energy_cost(rpl_parent_t *p)
+{
+  uint8_t type;
+
+  type = (p->mc.obj.energy.flags >> RPL_DAG_MC_ENERGY_TYPE) & 3;
+  if(type == RPL_DAG_MC_ENERGY_TYPE_MAINS) {
+    return 0;
+  }
+  return (uint32_t)(255 - p->mc.obj.energy.energy_est) *
+    RPL_MRHOF_ENERGY_WEIGHT / 255;
+}
+#endif /* RPL_WITH_MC */
+/*---------------------------------------------------------------------------*/
 static uint16_t
 parent_path_cost(rpl_parent_t *p)
 {
@@ -145,7 +205,7 @@ parent_path_cost(rpl_parent_t *p)
       base = p->mc.obj.etx;
       break;
     case RPL_DAG_MC_ENERGY:
-      base = p->mc.obj.energy.energy_est << 8;
+      base = MIN((uint32_t)p->rank + energy_cost(p), 0xffff);
       break;
     default:
       base = p->rank;
@@ -248,10 +308,47 @@ update_metric_container(rpl_instance_t *instance)
   instance->mc.type = RPL_DAG_MC_NONE;
 }
 #else /* RPL_WITH_MC */
+/* Estimates the energy left, from 0 to 255 */
+static uint8_t
+estimate_energy(void)
+{
+  uint8_t energy = 255;
+#if ENERGEST_CONF_ON
+  static unsigned long last_radio;
+  static unsigned long last_total;
+  static uint8_t duty_cycle_energy = 255;
+  unsigned long radio;
+  unsigned long total;
+  uint32_t permil;
+  uint8_t sample;
+
+  energest_flush();
+  radio = energest_type_time(ENERGEST_TYPE_TRANSMIT) +
+    energest_type_time(ENERGEST_TYPE_LISTEN);
+  total = energest_type_time(ENERGEST_TYPE_CPU) +
+    energest_type_time(ENERGEST_TYPE_LPM);
+  /* Skip updates too close to each other to say anything */
+  if(total - last_total >= MAX(RTIMER_SECOND, 1000)) {
+    permil = (radio - last_radio) / ((total - last_total) / 1000);
+    sample = 255 - MIN(permil * 255 / (RPL_MRHOF_ENERGY_MAX_DUTY_CYCLE * 10), 255);
+    duty_cycle_energy = ((uint16_t)duty_cycle_energy * 3 + sample) / 4;
+    last_radio = radio;
+    last_total = total;
+  }
+  energy = duty_cycle_energy;
+#endif /* ENERGEST_CONF_ON */
+#ifdef RPL_MRHOF_ENERGY_LEVEL
+  energy = MIN(energy, RPL_MRHOF_ENERGY_LEVEL());
+#endif /* RPL_MRHOF_ENERGY_LEVEL */
+  return energy;
+}
+/*---------------------------------------------------------------------------*/
 static void
 update_metric_container(rpl_instance_t *instance)
 {
+  static uint8_t advertised_energy = 255;
   rpl_dag_t *dag;
+  uint8_t energy;
   uint16_t path_cost;
   uint8_t type;
 
@@ -282,14 +379,22 @@ update_metric_container(rpl_instance_t *instance)
       break;
     case RPL_DAG_MC_ENERGY:
       instance->mc.length = sizeof(instance->mc.obj.energy);
-      if(dag->rank == ROOT_RANK(instance)) {
+      if(dag->rank == ROOT_RANK(instance) || RPL_MRHOF_ENERGY_MAINS) {
         type = RPL_DAG_MC_ENERGY_TYPE_MAINS;
+        energy = 255;
       } else {
         type = RPL_DAG_MC_ENERGY_TYPE_BATTERY;
+        energy = estimate_energy();
+        if(energy > advertised_energy + RPL_MRHOF_ENERGY_HYSTERESIS ||
+           energy + RPL_MRHOF_ENERGY_HYSTERESIS < advertised_energy) {
+          advertised_energy = energy;
+        }
+        energy = advertised_energy;
       }
-      instance->mc.obj.energy.flags = type << RPL_DAG_MC_ENERGY_TYPE;
-      /* Energy_est is only one byte, use the least significant byte of the path metric. */
-      instance->mc.obj.energy.energy_est = path_cost >> 8;
+      /* The node energy object (RFC6551, 3.2): the energy left, estimated */
+      instance->mc.obj.energy.flags = (type << RPL_DAG_MC_ENERGY_TYPE) |
+        (1 << RPL_DAG_MC_ENERGY_ESTIMATION);
+      instance->mc.obj.energy.energy_est = energy;
       break;
     default:
       PRINTF("RPL: MRHOF, non-supported MC %u\n", instance->mc.type);
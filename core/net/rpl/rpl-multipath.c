@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+/**
+ * \file
+ *         Multipath upward forwarding: spreads the flows sent up the
+ *         DAG over the parents whose rank is close to the one of the
+ *         preferred parent.
+ */
+
+#include "net/rpl/rpl-private.h"
+#include "net/ip/uip.h"
+#include "net/nbr-table.h"
+#include "lib/crc16.h"
+#include "lib/random.h"
+#include "sys/clock.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if RPL_WITH_MULTIPATH
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#ifdef RPL_MULTIPATH_QUEUE_LENGTH
+int RPL_MULTIPATH_QUEUE_LENGTH(const linkaddr_t *addr);
+#endif
+
+struct flow {
+  linkaddr_t parent;
+  clock_time_t last;
+  uint16_t hash;
+  uint8_t used;
+};
+
+static struct flow flows[RPL_MULTIPATH_FLOWS];
+/*---------------------------------------------------------------------------*/
+static uint16_t
+flow_hash(void)
+{
+  uint16_t hash;
+  uint16_t offset;
+  uint8_t proto;
+
+  hash = crc16_data(UIP_IP_BUF->srcipaddr.u8, sizeof(uip_ipaddr_t), 0);
+  hash = crc16_data(UIP_IP_BUF->destipaddr.u8, sizeof(uip_ipaddr_t), hash);
+
+  /* Skip the hop-by-hop options of RPL, if any, to find the ports */
+  proto = UIP_IP_BUF->proto;
+  offset = UIP_LLH_LEN + UIP_IPH_LEN;
+  if(proto == UIP_PROTO_HBHO && offset + 2 <= UIP_LLH_LEN + uip_len) {
+    proto = uip_buf[offset];
+    offset += (uip_buf[offset + 1] + 1) * 8;
+  }
+  hash = crc16_add(proto, hash);
+  if((proto == UIP_PROTO_UDP || proto == UIP_PROTO_TCP) &&
+     offset + 4 <= UIP_LLH_LEN + uip_len) {
+    hash = crc16_data(&uip_buf[offset], 4, hash);
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static int
+acceptable(rpl_parent_t *p, rpl_dag_t *dag, rpl_rank_t max_rank)
+{
+  return p != NULL && p->dag == dag && p->rank < dag->rank &&
+    rpl_parent_is_reachable(p) && rpl_rank_via_parent(p) <= max_rank &&
+    rpl_get_parent_ipaddr(p) != NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+weight(rpl_parent_t *p)
+{
+  uint32_t cost;
+
+  cost = rpl_get_parent_link_metric(p);
+  if(cost == 0) {
+    cost = 1;
+  }
+#ifdef RPL_MULTIPATH_QUEUE_LENGTH
+  cost *= 1 + RPL_MULTIPATH_QUEUE_LENGTH(rpl_get_parent_lladdr(p));
+#endif
+  return 0x1000000UL / cost;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_parent_t *
+choose_parent(rpl_dag_t *dag, rpl_rank_t max_rank)
+{
+  rpl_parent_t *p;
+  rpl_parent_t *chosen;
+  uint32_t total;
+  uint32_t r;
+
+  total = 0;
+  for(p = nbr_table_head(rpl_parents); p != NULL;
+      p = nbr_table_next(rpl_parents, p)) {
+    if(acceptable(p, dag, max_rank)) {
+      total += weight(p);
+    }
+  }
+  if(total == 0) {
+    return NULL;
+  }
+
+  r = (((uint32_t)random_rand() << 16) | random_rand()) % total;
+  chosen = NULL;
+  for(p = nbr_table_head(rpl_parents); p != NULL;
+      p = nbr_table_next(rpl_parents, p)) {
+    if(acceptable(p, dag, max_rank)) {
+      chosen = p;
+      if(r < weight(p)) {
+        break;
+      }
+      r -= weight(p);
+    }
+  }
+  return chosen;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Returns the address of the parent to send the packet in uip_buf to,
+ * or NULL to use the default route. Only packets going up the DAG
+ * should be passed here.
+ */
+uip_ipaddr_t *
+rpl_multipath_get_next_hop(void)
+{
+  rpl_dag_t *dag;
+  rpl_parent_t *p;
+  rpl_rank_t max_rank;
+  struct flow *f;
+  struct flow *oldest;
+  clock_time_t now;
+  uint16_t hash;
+  int i;
+
+  dag = rpl_get_any_dag();
+  if(dag == NULL || dag->preferred_parent == NULL ||
+     dag->instance == NULL) {
+    return NULL;
+  }
+  max_rank = rpl_rank_via_parent(dag->preferred_parent);
+  if(max_rank >= INFINITE_RANK - RPL_MULTIPATH_RANK_TOLERANCE(dag->instance)) {
+    return NULL;
+  }
+  max_rank += RPL_MULTIPATH_RANK_TOLERANCE(dag->instance);
+
+  now = clock_time();
+  hash = flow_hash();
+  oldest = &flows[0];
+  for(i = 0; i < RPL_MULTIPATH_FLOWS; i++) {
+    f = &flows[i];
+    if(f->used && now - f->last > RPL_MULTIPATH_FLOW_TIMEOUT) {
+      f->used = 0;
+    }
+    if(f->used && f->hash == hash) {
+      p = nbr_table_get_from_lladdr(rpl_parents, &f->parent);
+      if(acceptable(p, dag, max_rank)) {
+        f->last = now;
+        return rpl_get_parent_ipaddr(p);
+      }
+      /* The parent of the flow is no longer usable */
+      f->used = 0;
+    }
+    if(oldest->used && (!f->used || f->last < oldest->last)) {
+      oldest = f;
+    }
+  }
+
+  p = choose_parent(dag, max_rank);
+  if(p == NULL) {
+    return NULL;
+  }
+  PRINTF("RPL: multipath flow %04x via ", hash);
+  PRINT6ADDR(rpl_get_parent_ipaddr(p));
+  PRINTF("\n");
+
+  linkaddr_copy(&oldest->parent, rpl_get_parent_lladdr(p));
+  oldest->hash = hash;
+  oldest->last = now;
+  oldest->used = 1;
+  return rpl_get_parent_ipaddr(p);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_WITH_MULTIPATH */
+
+/** @} */
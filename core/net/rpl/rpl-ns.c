@@ -59,10 +59,18 @@
 /* Total number of nodes */
 static int num_nodes;
 
+/* Incremented on every change of the node tree */
+static uint32_t generation;
+
 /* Every known node in the network */
 LIST(nodelist);
 MEMB(nodememb, rpl_ns_node_t, RPL_NS_LINK_NUM);
 
+#if RPL_NS_HASH_SIZE
+/* Nodes chained by hash of their link identifier */
+static rpl_ns_node_t *hash_buckets[RPL_NS_HASH_SIZE];
+#endif /* RPL_NS_HASH_SIZE */
+
 /*---------------------------------------------------------------------------*/
 int
 rpl_ns_num_nodes(void)
@@ -70,6 +78,12 @@ rpl_ns_num_nodes(void)
   return num_nodes;
 }
 /*---------------------------------------------------------------------------*/
+uint32_t
+rpl_ns_get_generation(void)
+{
+  return generation;
+}
+/*---------------------------------------------------------------------------*/
 static int
 node_matches_address(const rpl_dag_t *dag, const rpl_ns_node_t *node, const uip_ipaddr_t *addr)
 {
@@ -81,11 +95,46 @@ node_matches_address(const rpl_dag_t *dag, const rpl_ns_node_t *node, const uip_
       && !memcmp(((const unsigned char *)addr) + 8, node->link_identifier, 8);
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_NS_HASH_SIZE
+static rpl_ns_node_t **
+hash_bucket(const unsigned char *link_identifier)
+{
+  unsigned h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < 8; i++) {
+    h = h * 31 + link_identifier[i];
+  }
+  return &hash_buckets[(h ^ (h >> 7)) & (RPL_NS_HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(rpl_ns_node_t *node)
+{
+  rpl_ns_node_t **l;
+
+  for(l = hash_bucket(node->link_identifier); *l != NULL; l = &(*l)->hash_next) {
+    if(*l == node) {
+      *l = node->hash_next;
+      return;
+    }
+  }
+}
+#endif /* RPL_NS_HASH_SIZE */
+/*---------------------------------------------------------------------------*/
 rpl_ns_node_t *
 rpl_ns_get_node(const rpl_dag_t *dag, const uip_ipaddr_t *addr)
 {
   rpl_ns_node_t *l;
+#if RPL_NS_HASH_SIZE
+  if(addr == NULL) {
+    return NULL;
+  }
+  for(l = *hash_bucket(((const unsigned char *)addr) + 8); l != NULL; l = l->hash_next) {
+#else /* RPL_NS_HASH_SIZE */
   for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+#endif /* RPL_NS_HASH_SIZE */
     /* Compare prefix and node identifier */
     if(node_matches_address(dag, l, addr)) {
       return l;
@@ -123,6 +172,7 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
   rpl_ns_node_t *child_node = rpl_ns_get_node(dag, child);
   rpl_ns_node_t *parent_node = rpl_ns_get_node(dag, parent);
   rpl_ns_node_t *old_parent_node;
+  rpl_ns_node_t *prev_parent_node;
 
   if(parent != NULL) {
     /* No node for the parent, add one with infinite lifetime */
@@ -142,14 +192,27 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
       return NULL;
     }
     child_node->parent = NULL;
+    memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
     list_add(nodelist, child_node);
+#if RPL_NS_HASH_SIZE
+    {
+      rpl_ns_node_t **bucket = hash_bucket(child_node->link_identifier);
+      child_node->hash_next = *bucket;
+      *bucket = child_node;
+    }
+#endif /* RPL_NS_HASH_SIZE */
     num_nodes++;
+    generation++;
   }
 
   /* Initialize node */
+  if(child_node->dag != dag) {
+    generation++;
+  }
   child_node->dag = dag;
   child_node->lifetime = lifetime;
-  memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
+
+  prev_parent_node = child_node->parent;
 
   /* Is the node reachable before the update? */
   if(rpl_ns_is_node_reachable(dag, child)) {
@@ -167,6 +230,10 @@ rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t
     child_node->parent = parent_node;
   }
 
+  if(child_node->parent != prev_parent_node) {
+    generation++;
+  }
+
   return child_node;
 }
 /*---------------------------------------------------------------------------*/
@@ -174,8 +241,12 @@ void
 rpl_ns_init(void)
 {
   num_nodes = 0;
+  generation++;
   memb_init(&nodememb);
   list_init(nodelist);
+#if RPL_NS_HASH_SIZE
+  memset(hash_buckets, 0, sizeof(hash_buckets));
+#endif /* RPL_NS_HASH_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 rpl_ns_node_t *
@@ -220,9 +291,13 @@ rpl_ns_periodic(void)
         }
       }
       /* No child found, deallocate node */
+#if RPL_NS_HASH_SIZE
+      hash_remove(l);
+#endif /* RPL_NS_HASH_SIZE */
       list_remove(nodelist, l);
       memb_free(&nodememb, l);
       num_nodes--;
+      generation++;
     }
   }
 }
@@ -49,6 +49,18 @@
 #define RPL_NS_LINK_NUM 32
 #endif /* RPL_NS_CONF_LINK_NUM */
 
+/* Number of buckets of the hash index on node link identifiers, a power
+ * of two. 0 disables the index, nodes are then looked up linearly. */
+#ifdef RPL_NS_CONF_HASH_SIZE
+#define RPL_NS_HASH_SIZE RPL_NS_CONF_HASH_SIZE
+#else /* RPL_NS_CONF_HASH_SIZE */
+#define RPL_NS_HASH_SIZE 0
+#endif /* RPL_NS_CONF_HASH_SIZE */
+
+#if RPL_NS_HASH_SIZE & (RPL_NS_HASH_SIZE - 1)
+#error "RPL_NS_CONF_HASH_SIZE must be a power of two"
+#endif
+
 typedef struct rpl_ns_node {
   struct rpl_ns_node *next;
   uint32_t lifetime;
@@ -56,9 +68,15 @@ typedef struct rpl_ns_node {
   /* Store only IPv6 link identifiers as all nodes in the DAG share the same prefix */
   unsigned char link_identifier[8];
   struct rpl_ns_node *parent;
+#if RPL_NS_HASH_SIZE
+  /* Next node in the same hash bucket */
+  struct rpl_ns_node *hash_next;
+#endif /* RPL_NS_HASH_SIZE */
 } rpl_ns_node_t;
 
 int rpl_ns_num_nodes(void);
+/* Returns a counter that changes whenever the node tree changes */
+uint32_t rpl_ns_get_generation(void);
 void rpl_ns_expire_parent(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t *parent);
 rpl_ns_node_t *rpl_ns_update_node(rpl_dag_t *dag, const uip_ipaddr_t *child, const uip_ipaddr_t *parent, uint32_t lifetime);
 void rpl_ns_init(void);
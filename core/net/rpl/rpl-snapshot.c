@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+/**
+ * \file
+ *         Snapshots of the RPL state, to rejoin quickly after a reboot.
+ */
+
+#include "net/rpl/rpl-snapshot.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/link-stats.h"
+#include "net/nbr-table.h"
+#include "cfs/cfs.h"
+#include "lib/crc16.h"
+#include "sys/ctimer.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if RPL_WITH_SNAPSHOT
+
+/* Change whenever the layout of struct snapshot changes */
+#define SNAPSHOT_VERSION 1
+
+struct snapshot_parent {
+  uip_ipaddr_t ipaddr;
+  linkaddr_t lladdr;
+  rpl_rank_t rank;
+  uint8_t dtsn;
+#if RPL_WITH_MC
+  rpl_metric_container_t mc;
+#endif /* RPL_WITH_MC */
+};
+
+struct snapshot_link {
+  uint16_t etx;
+  int16_t rssi;
+};
+
+struct snapshot {
+  uint16_t version;
+  uint16_t size;
+  linkaddr_t node_addr;
+  /* The DAG, as advertised in its DIOs */
+  uip_ipaddr_t dag_id;
+  rpl_prefix_t prefix_info;
+  rpl_rank_t max_rankinc;
+  rpl_rank_t min_hoprankinc;
+  uint16_t lifetime_unit;
+  rpl_ocp_t ocp;
+  uint8_t instance_id;
+  uint8_t dag_version;
+  uint8_t grounded;
+  uint8_t preference;
+  uint8_t mop;
+  uint8_t dio_intdoubl;
+  uint8_t dio_intmin;
+  uint8_t dio_redundancy;
+  uint8_t default_lifetime;
+  uint8_t num_parents;
+  struct snapshot_parent parents[RPL_SNAPSHOT_PARENTS];
+  /* Not taken into account when checking for changes */
+  struct snapshot_link links[RPL_SNAPSHOT_PARENTS];
+  uint16_t crc;
+};
+
+static struct snapshot snapshot;
+/* Checksum of the part of the last saved snapshot that matters for
+ * changes, 0 if unknown */
+static uint16_t saved_crc;
+static struct ctimer periodic_timer;
+
+/* The DAG restored, until it is confirmed or dropped */
+static struct ctimer validation_timer;
+static uip_ipaddr_t restored_dag_id;
+static uint8_t restored_instance_id;
+static uint8_t validating;
+static uint8_t confirmed;
+/*---------------------------------------------------------------------------*/
+static uint16_t
+structure_crc(void)
+{
+  return crc16_data((const unsigned char *)&snapshot,
+                    offsetof(struct snapshot, links), 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_parent(rpl_parent_t *p)
+{
+  struct snapshot_parent *sp;
+  const struct link_stats *stats;
+  const uip_ipaddr_t *ipaddr;
+  const linkaddr_t *lladdr;
+
+  ipaddr = rpl_get_parent_ipaddr(p);
+  lladdr = rpl_get_parent_lladdr(p);
+  if(ipaddr == NULL || lladdr == NULL ||
+     snapshot.num_parents >= RPL_SNAPSHOT_PARENTS) {
+    return;
+  }
+
+  sp = &snapshot.parents[snapshot.num_parents];
+  uip_ipaddr_copy(&sp->ipaddr, ipaddr);
+  linkaddr_copy(&sp->lladdr, lladdr);
+  sp->rank = p->rank;
+  sp->dtsn = p->dtsn;
+#if RPL_WITH_MC
+  memcpy(&sp->mc, &p->mc, sizeof(sp->mc));
+#endif /* RPL_WITH_MC */
+
+  stats = link_stats_from_lladdr(lladdr);
+  if(stats != NULL) {
+    snapshot.links[snapshot.num_parents].etx = stats->etx;
+    snapshot.links[snapshot.num_parents].rssi = stats->rssi;
+  }
+  snapshot.num_parents++;
+}
+/*---------------------------------------------------------------------------*/
+/* Fills in the snapshot from the current state. Returns 0 if there is
+ * nothing worth saving. */
+static int
+take(void)
+{
+  rpl_dag_t *dag;
+  rpl_instance_t *instance;
+  rpl_parent_t *p;
+
+  dag = rpl_get_any_dag();
+  if(dag == NULL || !dag->joined || dag->preferred_parent == NULL) {
+    return 0;
+  }
+  instance = dag->instance;
+  if(dag->rank == ROOT_RANK(instance) || instance->of == NULL) {
+    return 0;
+  }
+
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshot.version = SNAPSHOT_VERSION;
+  snapshot.size = sizeof(snapshot);
+  linkaddr_copy(&snapshot.node_addr, &linkaddr_node_addr);
+  uip_ipaddr_copy(&snapshot.dag_id, &dag->dag_id);
+  memcpy(&snapshot.prefix_info, &dag->prefix_info, sizeof(rpl_prefix_t));
+  snapshot.max_rankinc = instance->max_rankinc;
+  snapshot.min_hoprankinc = instance->min_hoprankinc;
+  snapshot.lifetime_unit = instance->lifetime_unit;
+  snapshot.ocp = instance->of->ocp;
+  snapshot.instance_id = instance->instance_id;
+  snapshot.dag_version = dag->version;
+  snapshot.grounded = dag->grounded;
+  snapshot.preference = dag->preference;
+  snapshot.mop = instance->mop;
+  snapshot.dio_intdoubl = instance->dio_intdoubl;
+  snapshot.dio_intmin = instance->dio_intmin;
+  snapshot.dio_redundancy = instance->dio_redundancy;
+  snapshot.default_lifetime = instance->default_lifetime;
+
+  add_parent(dag->preferred_parent);
+  for(p = nbr_table_head(rpl_parents); p != NULL;
+      p = nbr_table_next(rpl_parents, p)) {
+    if(p != dag->preferred_parent && p->dag == dag &&
+       p->rank < dag->rank && rpl_parent_is_reachable(p)) {
+      add_parent(p);
+    }
+  }
+  return snapshot.num_parents > 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_snapshot_save(void)
+{
+  uint16_t crc;
+  int fd;
+
+  if(validating || !take()) {
+    return;
+  }
+  crc = structure_crc();
+  if(crc == saved_crc) {
+    return;
+  }
+  snapshot.crc = crc16_data((const unsigned char *)&snapshot,
+                            offsetof(struct snapshot, crc), 0);
+
+  cfs_remove(RPL_SNAPSHOT_FILE);
+  fd = cfs_open(RPL_SNAPSHOT_FILE, CFS_WRITE);
+  if(fd < 0) {
+    return;
+  }
+  if(cfs_write(fd, &snapshot, sizeof(snapshot)) == sizeof(snapshot)) {
+    saved_crc = crc;
+    PRINTF("RPL: snapshot saved, %u parents\n", snapshot.num_parents);
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_snapshot_remove(void)
+{
+  cfs_remove(RPL_SNAPSHOT_FILE);
+  saved_crc = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+load(void)
+{
+  int fd;
+  int len;
+
+  fd = cfs_open(RPL_SNAPSHOT_FILE, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  len = cfs_read(fd, &snapshot, sizeof(snapshot));
+  cfs_close(fd);
+
+  return len == sizeof(snapshot) &&
+    snapshot.version == SNAPSHOT_VERSION &&
+    snapshot.size == sizeof(snapshot) &&
+    snapshot.crc == crc16_data((const unsigned char *)&snapshot,
+                               offsetof(struct snapshot, crc), 0) &&
+    linkaddr_cmp(&snapshot.node_addr, &linkaddr_node_addr) &&
+    snapshot.num_parents > 0 &&
+    snapshot.num_parents <= RPL_SNAPSHOT_PARENTS;
+}
+/*---------------------------------------------------------------------------*/
+static void
+validate(void *ptr)
+{
+  rpl_instance_t *instance;
+  rpl_dag_t *dag;
+  const struct link_stats *stats;
+
+  validating = 0;
+  instance = rpl_get_instance(restored_instance_id);
+  if(instance == NULL) {
+    return;
+  }
+
+  dag = instance->current_dag;
+  if(!confirmed && dag != NULL && dag->preferred_parent != NULL) {
+    /* A transmission to the preferred parent was acknowledged last */
+    stats = link_stats_from_lladdr(rpl_get_parent_lladdr(dag->preferred_parent));
+    confirmed = stats != NULL && stats->freshness > 0 && stats->failures == 0;
+  }
+
+  if(confirmed) {
+    PRINTF("RPL: restored DAG confirmed\n");
+    return;
+  }
+  PRINTF("RPL: restored DAG not confirmed, joining from scratch\n");
+  rpl_free_instance(instance);
+  rpl_snapshot_remove();
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_snapshot_restore(void)
+{
+  static rpl_dio_t dio;
+  struct snapshot_parent *sp;
+  int i;
+
+  if(rpl_get_any_dag() != NULL || validating) {
+    return 0;
+  }
+  if(!load()) {
+    PRINTF("RPL: no valid snapshot\n");
+    return 0;
+  }
+  saved_crc = structure_crc();
+
+  memset(&dio, 0, sizeof(dio));
+  uip_ipaddr_copy(&dio.dag_id, &snapshot.dag_id);
+  memcpy(&dio.prefix_info, &snapshot.prefix_info, sizeof(rpl_prefix_t));
+  dio.dag_max_rankinc = snapshot.max_rankinc;
+  dio.dag_min_hoprankinc = snapshot.min_hoprankinc;
+  dio.lifetime_unit = snapshot.lifetime_unit;
+  dio.ocp = snapshot.ocp;
+  dio.instance_id = snapshot.instance_id;
+  dio.version = snapshot.dag_version;
+  dio.grounded = snapshot.grounded;
+  dio.preference = snapshot.preference;
+  dio.mop = snapshot.mop;
+  dio.dag_intdoubl = snapshot.dio_intdoubl;
+  dio.dag_intmin = snapshot.dio_intmin;
+  dio.dag_redund = snapshot.dio_redundancy;
+  dio.default_lifetime = snapshot.default_lifetime;
+
+  /* Replay a DIO from each parent, the preferred one first */
+  for(i = 0; i < snapshot.num_parents; i++) {
+    sp = &snapshot.parents[i];
+    dio.rank = sp->rank;
+    dio.dtsn = sp->dtsn;
+#if RPL_WITH_MC
+    memcpy(&dio.mc, &sp->mc, sizeof(dio.mc));
+#endif /* RPL_WITH_MC */
+
+    if(uip_ds6_nbr_lookup(&sp->ipaddr) == NULL &&
+       uip_ds6_nbr_add(&sp->ipaddr, (uip_lladdr_t *)&sp->lladdr, 0,
+                       NBR_REACHABLE, NBR_TABLE_REASON_RPL_DIO, &dio) == NULL) {
+      continue;
+    }
+    link_stats_restore(&sp->lladdr, snapshot.links[i].etx,
+                       snapshot.links[i].rssi);
+    rpl_process_dio(&sp->ipaddr, &dio);
+  }
+
+  if(rpl_get_instance(snapshot.instance_id) == NULL) {
+    PRINTF("RPL: could not rejoin the saved DAG\n");
+    return 0;
+  }
+
+  PRINTF("RPL: rejoined the saved DAG ");
+  PRINT6ADDR(&snapshot.dag_id);
+  PRINTF(" through %u parents\n", snapshot.num_parents);
+  uip_ipaddr_copy(&restored_dag_id, &snapshot.dag_id);
+  restored_instance_id = snapshot.instance_id;
+  confirmed = 0;
+  validating = 1;
+  ctimer_set(&validation_timer, RPL_SNAPSHOT_VALIDATION_TIME, validate, NULL);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_snapshot_dio_input(const rpl_dio_t *dio)
+{
+  if(validating && dio->instance_id == restored_instance_id &&
+     uip_ipaddr_cmp(&dio->dag_id, &restored_dag_id)) {
+    confirmed = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+periodic(void *ptr)
+{
+  rpl_snapshot_save();
+  ctimer_reset(&periodic_timer);
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_snapshot_init(void)
+{
+  saved_crc = 0;
+  validating = 0;
+  ctimer_set(&periodic_timer, RPL_SNAPSHOT_INTERVAL, periodic, NULL);
+#if RPL_SNAPSHOT_RESTORE_AT_INIT
+  rpl_snapshot_restore();
+#endif /* RPL_SNAPSHOT_RESTORE_AT_INIT */
+}
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_WITH_SNAPSHOT */
+
+/** @} */
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Snapshots of the RPL state, to rejoin quickly after a reboot.
+ *
+ *         The DAG the node is part of, its parents and their link
+ *         statistics are saved to a CFS file when they change. After a
+ *         reboot, the node rejoins through the saved parents as if it
+ *         had just received their DIOs. If nothing confirms that the DAG
+ *         is still there within RPL_SNAPSHOT_VALIDATION_TIME, neither a
+ *         DIO of the DAG nor an acknowledged transmission to the
+ *         preferred parent, the restored state is dropped and the node
+ *         joins normally.
+ */
+
+#ifndef RPL_SNAPSHOT_H
+#define RPL_SNAPSHOT_H
+
+#include "net/rpl/rpl-private.h"
+
+/* The CFS file the snapshot is saved to */
+#ifdef RPL_SNAPSHOT_CONF_FILE
+#define RPL_SNAPSHOT_FILE RPL_SNAPSHOT_CONF_FILE
+#else /* RPL_SNAPSHOT_CONF_FILE */
+#define RPL_SNAPSHOT_FILE "rpl"
+#endif /* RPL_SNAPSHOT_CONF_FILE */
+
+/* Number of parents saved, the preferred parent first */
+#ifdef RPL_SNAPSHOT_CONF_PARENTS
+#define RPL_SNAPSHOT_PARENTS RPL_SNAPSHOT_CONF_PARENTS
+#else /* RPL_SNAPSHOT_CONF_PARENTS */
+#define RPL_SNAPSHOT_PARENTS 3
+#endif /* RPL_SNAPSHOT_CONF_PARENTS */
+
+/* How often the state is checked for changes worth saving. Link
+ * statistics alone do not cause a new snapshot, to save flash wear. */
+#ifdef RPL_SNAPSHOT_CONF_INTERVAL
+#define RPL_SNAPSHOT_INTERVAL RPL_SNAPSHOT_CONF_INTERVAL
+#else /* RPL_SNAPSHOT_CONF_INTERVAL */
+#define RPL_SNAPSHOT_INTERVAL (60 * CLOCK_SECOND)
+#endif /* RPL_SNAPSHOT_CONF_INTERVAL */
+
+/* Time after a restore within which the DAG must be confirmed */
+#ifdef RPL_SNAPSHOT_CONF_VALIDATION_TIME
+#define RPL_SNAPSHOT_VALIDATION_TIME RPL_SNAPSHOT_CONF_VALIDATION_TIME
+#else /* RPL_SNAPSHOT_CONF_VALIDATION_TIME */
+#define RPL_SNAPSHOT_VALIDATION_TIME (60 * CLOCK_SECOND)
+#endif /* RPL_SNAPSHOT_CONF_VALIDATION_TIME */
+
+/* Restore the snapshot when RPL starts. MACs that must associate before
+ * anything can be sent, like TSCH, should set this to 0 and call
+ * rpl_snapshot_restore() once associated: tsch_rpl_callback_joining_network
+ * does so. */
+#ifdef RPL_SNAPSHOT_CONF_RESTORE_AT_INIT
+#define RPL_SNAPSHOT_RESTORE_AT_INIT RPL_SNAPSHOT_CONF_RESTORE_AT_INIT
+#else /* RPL_SNAPSHOT_CONF_RESTORE_AT_INIT */
+#define RPL_SNAPSHOT_RESTORE_AT_INIT 1
+#endif /* RPL_SNAPSHOT_CONF_RESTORE_AT_INIT */
+
+/* Starts saving snapshots, and restores the last one if configured to */
+void rpl_snapshot_init(void);
+/* Rejoins the saved DAG, if any. Returns 1 on success. Does nothing if
+ * the node is already part of a DAG. */
+int rpl_snapshot_restore(void);
+/* Saves the current state now, if it changed */
+void rpl_snapshot_save(void);
+/* Called on every DIO received, to confirm a restored DAG */
+void rpl_snapshot_dio_input(const rpl_dio_t *dio);
+/* Forgets the saved state */
+void rpl_snapshot_remove(void);
+
+#endif /* RPL_SNAPSHOT_H */
@@ -404,7 +404,6 @@ get_probing_target(rpl_dag_t *dag)
   rpl_parent_t *probing_target = NULL;
   rpl_rank_t probing_target_rank = INFINITE_RANK;
   clock_time_t probing_target_age = 0;
-  clock_time_t clock_now = clock_time();
 
   if(dag == NULL ||
       dag->instance == NULL) {
@@ -445,9 +444,9 @@ get_probing_target(rpl_dag_t *dag)
       const struct link_stats *stats =rpl_get_parent_link_stats(p);
       if(p->dag == dag && stats != NULL) {
         if(probing_target == NULL
-            || clock_now - stats->last_tx_time > probing_target_age) {
+            || link_stats_tx_age(stats) > probing_target_age) {
           probing_target = p;
-          probing_target_age = clock_now - stats->last_tx_time;
+          probing_target_age = link_stats_tx_age(stats);
         }
       }
       p = nbr_table_next(rpl_parents, p);
@@ -472,7 +471,7 @@ handle_probing_timer(void *ptr)
         rpl_get_parent_lladdr(probing_target)->u8[7],
         instance->urgent_probing_target != NULL ? "(urgent)" : "",
         probing_target != NULL ?
-        (unsigned)((clock_time() - stats->last_tx_time) / (60 * CLOCK_SECOND)) : 0
+        (unsigned)(link_stats_tx_age(stats) / (60 * CLOCK_SECOND)) : 0
         );
     /* Send probe, e.g. unicast DIO or DIS */
     RPL_PROBING_SEND_FUNC(instance, target_ipaddr);
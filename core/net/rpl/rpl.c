@@ -48,6 +48,7 @@
 #include "net/ipv6/uip-icmp6.h"
 #include "net/rpl/rpl-private.h"
 #include "net/rpl/rpl-ns.h"
+#include "net/rpl/rpl-snapshot.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 
 #define DEBUG DEBUG_NONE
@@ -115,7 +116,7 @@ rpl_purge_routes(void)
   uip_ipaddr_t prefix;
   rpl_dag_t *dag;
 #if RPL_WITH_MULTICAST
-  uip_mcast6_route_t *mcast_route;
+  uip_mcast6_route_t *mcast_route, *next_mcast_route;
 #endif
 
   /* First pass, decrement lifetime */
@@ -140,7 +141,7 @@ rpl_purge_routes(void)
     if(r->state.lifetime < 1) {
       /* Routes with lifetime == 1 have only just been decremented from 2 to 1,
        * thus we want to keep them. Hence < and not <= */
-      uip_ipaddr_copy(&prefix, &r->ipaddr);
+      uip_ds6_route_copy_ipaddr(&prefix, r);
       uip_ds6_route_rm(r);
       r = uip_ds6_route_head();
       PRINTF("RPL: No more routes to ");
@@ -163,13 +164,13 @@ rpl_purge_routes(void)
   mcast_route = uip_mcast6_route_list_head();
 
   while(mcast_route != NULL) {
+    next_mcast_route = list_item_next(mcast_route);
     if(mcast_route->lifetime <= 1) {
       uip_mcast6_route_rm(mcast_route);
-      mcast_route = uip_mcast6_route_list_head();
     } else {
       mcast_route->lifetime--;
-      mcast_route = list_item_next(mcast_route);
     }
+    mcast_route = next_mcast_route;
   }
 #endif
 }
@@ -179,7 +180,7 @@ rpl_remove_routes(rpl_dag_t *dag)
 {
   uip_ds6_route_t *r;
 #if RPL_WITH_MULTICAST
-  uip_mcast6_route_t *mcast_route;
+  uip_mcast6_route_t *mcast_route, *next_mcast_route;
 #endif
 
   r = uip_ds6_route_head();
@@ -197,12 +198,11 @@ rpl_remove_routes(rpl_dag_t *dag)
   mcast_route = uip_mcast6_route_list_head();
 
   while(mcast_route != NULL) {
+    next_mcast_route = list_item_next(mcast_route);
     if(mcast_route->dag == dag) {
       uip_mcast6_route_rm(mcast_route);
-      mcast_route = uip_mcast6_route_list_head();
-    } else {
-      mcast_route = list_item_next(mcast_route);
     }
+    mcast_route = next_mcast_route;
   }
 #endif
 }
@@ -349,6 +349,10 @@ rpl_init(void)
 #if RPL_WITH_NON_STORING
   rpl_ns_init();
 #endif /* RPL_WITH_NON_STORING */
+
+#if RPL_WITH_SNAPSHOT
+  rpl_snapshot_init();
+#endif /* RPL_WITH_SNAPSHOT */
 }
 /*---------------------------------------------------------------------------*/
 
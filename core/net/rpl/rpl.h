@@ -110,6 +110,7 @@ struct rpl_dag;
 /*---------------------------------------------------------------------------*/
 #define RPL_PARENT_FLAG_UPDATED           0x1
 #define RPL_PARENT_FLAG_LINK_METRIC_VALID 0x2
+#define RPL_PARENT_FLAG_CACHE_VALID       0x4
 
 struct rpl_parent {
   struct rpl_dag *dag;
@@ -117,6 +118,13 @@ struct rpl_parent {
   rpl_metric_container_t mc;
 #endif /* RPL_WITH_MC */
   rpl_rank_t rank;
+#if RPL_PARENT_CACHE
+  /* Rank via this parent, and the inputs it was computed from */
+  rpl_rank_t cache_rank_via;
+  rpl_rank_t cache_rank;
+  uint16_t cache_etx;
+  uint8_t cache_epoch;
+#endif /* RPL_PARENT_CACHE */
   uint8_t dtsn;
   uint8_t flags;
 };
@@ -293,6 +301,7 @@ uip_ds6_nbr_t *rpl_get_nbr(rpl_parent_t *parent);
 void rpl_print_neighbor_list(void);
 int rpl_process_srh_header(void);
 int rpl_srh_get_next_hop(uip_ipaddr_t *ipaddr);
+uip_ipaddr_t *rpl_multipath_get_next_hop(void);
 
 /* Per-parent RPL information */
 NBR_TABLE_DECLARE(rpl_parents);
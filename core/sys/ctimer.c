@@ -46,8 +46,26 @@
 #include "contiki.h"
 #include "lib/list.h"
 
+#include <stddef.h>
+
 LIST(ctimer_list);
 
+#if ETIMER_WHEEL
+/* With the timer wheel, the list only holds the timers that are set
+   before the ctimer process has started. Expiry events are matched
+   to their ctimer through the embedded etimer instead of a list
+   search. */
+#define TRACK(c) do {                           \
+    if(initialized) {                           \
+      (c)->active = 1;                          \
+    } else {                                    \
+      list_add(ctimer_list, c);                 \
+    }                                           \
+  } while(0)
+#else /* ETIMER_WHEEL */
+#define TRACK(c) list_add(ctimer_list, c)
+#endif /* ETIMER_WHEEL */
+
 static char initialized;
 
 #define DEBUG 0
@@ -67,11 +85,30 @@ PROCESS_THREAD(ctimer_process, ev, data)
 
   for(c = list_head(ctimer_list); c != NULL; c = c->next) {
     etimer_set(&c->etimer, c->etimer.timer.interval);
+#if ETIMER_WHEEL
+    c->active = 1;
+#endif /* ETIMER_WHEEL */
   }
+#if ETIMER_WHEEL
+  list_init(ctimer_list);
+#endif /* ETIMER_WHEEL */
   initialized = 1;
 
   while(1) {
     PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
+#if ETIMER_WHEEL
+    c = (struct ctimer *)((char *)data - offsetof(struct ctimer, etimer));
+    /* Ignore the event if the ctimer has been stopped or set again
+       since it expired. */
+    if(c->active && etimer_expired(&c->etimer)) {
+      c->active = 0;
+      PROCESS_CONTEXT_BEGIN(c->p);
+      if(c->f != NULL) {
+        c->f(c->ptr);
+      }
+      PROCESS_CONTEXT_END(c->p);
+    }
+#else /* ETIMER_WHEEL */
     for(c = list_head(ctimer_list); c != NULL; c = c->next) {
       if(&c->etimer == data) {
 	list_remove(ctimer_list, c);
@@ -83,6 +120,7 @@ PROCESS_THREAD(ctimer_process, ev, data)
 	break;
       }
     }
+#endif /* ETIMER_WHEEL */
   }
   PROCESS_END();
 }
@@ -118,7 +156,7 @@ ctimer_set_with_process(struct ctimer *c, clock_time_t t,
     c->etimer.timer.interval = t;
   }
 
-  list_add(ctimer_list, c);
+  TRACK(c);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -130,7 +168,7 @@ ctimer_reset(struct ctimer *c)
     PROCESS_CONTEXT_END(&ctimer_process);
   }
 
-  list_add(ctimer_list, c);
+  TRACK(c);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -142,7 +180,7 @@ ctimer_restart(struct ctimer *c)
     PROCESS_CONTEXT_END(&ctimer_process);
   }
 
-  list_add(ctimer_list, c);
+  TRACK(c);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -150,6 +188,9 @@ ctimer_stop(struct ctimer *c)
 {
   if(initialized) {
     etimer_stop(&c->etimer);
+#if ETIMER_WHEEL
+    c->active = 0;
+#endif /* ETIMER_WHEEL */
   } else {
     c->etimer.next = NULL;
     c->etimer.p = PROCESS_NONE;
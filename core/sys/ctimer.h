@@ -62,6 +62,9 @@ struct ctimer {
   struct process *p;
   void (*f)(void *);
   void *ptr;
+#if ETIMER_WHEEL
+  unsigned char active;
+#endif /* ETIMER_WHEEL */
 };
 
 /**
@@ -39,6 +39,7 @@
 
 #include "sys/energest.h"
 #include "contiki-conf.h"
+#include <string.h>
 
 #if ENERGEST_CONF_ON
 
@@ -50,6 +51,14 @@ energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVICE_LEVE
 #endif
 unsigned char energest_current_mode[ENERGEST_TYPE_MAX];
 
+#if ENERGEST_CONF_CLASSES
+/* Radio time per class, transmit and listen */
+static unsigned long class_time[ENERGEST_CLASS_MAX][2];
+/* Radio totals when the current class was last accounted for */
+static unsigned long class_mark[2];
+static unsigned char current_class;
+#endif /* ENERGEST_CONF_CLASSES */
+
 /*---------------------------------------------------------------------------*/
 void
 energest_init(void)
@@ -64,6 +73,11 @@ energest_init(void)
     energest_leveldevice_current_leveltime[i].current = 0;
   }
 #endif
+#if ENERGEST_CONF_CLASSES
+  memset(class_time, 0, sizeof(class_time));
+  class_mark[0] = class_mark[1] = 0;
+  current_class = ENERGEST_CLASS_OTHER;
+#endif /* ENERGEST_CONF_CLASSES */
 }
 /*---------------------------------------------------------------------------*/
 unsigned long
@@ -113,6 +127,41 @@ energest_flush(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if ENERGEST_CONF_CLASSES
+static void
+class_account(void)
+{
+  unsigned long tx, listen;
+
+  tx = energest_type_time(ENERGEST_TYPE_TRANSMIT);
+  listen = energest_type_time(ENERGEST_TYPE_LISTEN);
+  class_time[current_class][0] += tx - class_mark[0];
+  class_time[current_class][1] += listen - class_mark[1];
+  class_mark[0] = tx;
+  class_mark[1] = listen;
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_class_set(int cls)
+{
+  if(cls == current_class || cls < 0 || cls >= ENERGEST_CLASS_MAX) {
+    return;
+  }
+  class_account();
+  current_class = cls;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_class_time(int cls, int type)
+{
+  if(cls < 0 || cls >= ENERGEST_CLASS_MAX) {
+    return 0;
+  }
+  class_account();
+  return class_time[cls][type == ENERGEST_TYPE_TRANSMIT ? 0 : 1];
+}
+/*---------------------------------------------------------------------------*/
+#endif /* ENERGEST_CONF_CLASSES */
 #else /* ENERGEST_CONF_ON */
 void energest_type_set(int type, unsigned long val) {}
 void energest_init(void) {}
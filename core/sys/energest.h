@@ -67,6 +67,30 @@ enum energest_type {
   ENERGEST_TYPE_MAX
 };
 
+/*
+ * With ENERGEST_CONF_CLASSES, the radio transmit and listen time is
+ * also split by the kind of traffic that caused it. The MAC layer
+ * sets the class of each frame it sends, taken from the
+ * PACKETBUF_ATTR_ENERGEST_CLASS attribute, with ENERGEST_SET_CLASS()
+ * and sets it back to ENERGEST_CLASS_OTHER afterwards. Radio time
+ * outside of a transmission, such as idle listening, is counted to
+ * ENERGEST_CLASS_OTHER.
+ */
+#ifndef ENERGEST_CONF_CLASSES
+#define ENERGEST_CONF_CLASSES 0
+#endif /* ENERGEST_CONF_CLASSES */
+
+enum energest_class {
+  ENERGEST_CLASS_OTHER,
+  ENERGEST_CLASS_DATA,
+  ENERGEST_CLASS_ROUTING,
+  ENERGEST_CLASS_ICMP,
+  ENERGEST_CLASS_BEACON,
+  ENERGEST_CLASS_MAC,
+
+  ENERGEST_CLASS_MAX
+};
+
 void energest_init(void);
 unsigned long energest_type_time(int type);
 #ifdef ENERGEST_CONF_LEVELDEVICE_LEVELS
@@ -75,6 +99,23 @@ unsigned long energest_leveldevice_leveltime(int powerlevel);
 void energest_type_set(int type, unsigned long value);
 void energest_flush(void);
 
+#if ENERGEST_CONF_ON && ENERGEST_CONF_CLASSES
+/**
+ * Make cls the class that radio time is counted to from now on.
+ */
+void energest_class_set(int cls);
+
+/**
+ * The time, in rtimer ticks, that the radio has spent in type,
+ * ENERGEST_TYPE_TRANSMIT or ENERGEST_TYPE_LISTEN, for class cls.
+ */
+unsigned long energest_class_time(int cls, int type);
+
+#define ENERGEST_SET_CLASS(cls) energest_class_set(cls)
+#else /* ENERGEST_CONF_ON && ENERGEST_CONF_CLASSES */
+#define ENERGEST_SET_CLASS(cls) do { } while(0)
+#endif /* ENERGEST_CONF_ON && ENERGEST_CONF_CLASSES */
+
 #if ENERGEST_CONF_ON
 /*extern int energest_total_count;*/
 extern energest_t energest_total_time[ENERGEST_TYPE_MAX];
@@ -49,10 +49,319 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
-static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
+
+#if ETIMER_WHEEL
+/*
+ * The timer wheel. wheel[level * SLOTS + n] holds the timers whose
+ * expiration time has n in bits [level * BITS, (level + 1) * BITS).
+ * A timer is put on the lowest level whose range covers its
+ * distance from wheel_time, the next tick that has not yet been
+ * processed, and is moved down a level ("cascaded") when wheel_time
+ * reaches the start of its slot. All timers in a level 0 slot thus
+ * expire at the same tick.
+ */
+#define SLOTS         (1 << ETIMER_WHEEL_BITS)
+#define SLOT_MASK     (SLOTS - 1)
+#define OVERFLOW_LIST (ETIMER_WHEEL_LEVELS * SLOTS)
+#define DUE_LIST      (OVERFLOW_LIST + 1)
+#define NUM_LISTS     (DUE_LIST + 1)
+
+/* True if time a is before time b, taking wrap-around into account. */
+#define TIME_BEFORE(a, b) \
+  ((clock_time_t)((a) - (b)) > (((clock_time_t)-1) >> 1))
+
+static struct etimer *wheel[NUM_LISTS];
+static clock_time_t wheel_time;
+static unsigned short num_timers;
+static unsigned short num_level0;
+/*---------------------------------------------------------------------------*/
+static void
+wheel_insert(struct etimer *t)
+{
+  clock_time_t expires;
+  clock_time_t delta;
+  unsigned char level;
+
+  expires = t->timer.start + t->timer.interval;
+  if(TIME_BEFORE(expires, wheel_time)) {
+    /* Already expired: fire on the next run of the wheel. */
+    t->slot = DUE_LIST;
+  } else {
+    delta = expires - wheel_time;
+    for(level = 0; level < ETIMER_WHEEL_LEVELS - 1 && delta >= SLOTS;
+        level++) {
+      delta >>= ETIMER_WHEEL_BITS;
+    }
+    if(delta >= SLOTS) {
+      t->slot = OVERFLOW_LIST;
+    } else {
+      t->slot = level * SLOTS +
+        ((expires >> (level * ETIMER_WHEEL_BITS)) & SLOT_MASK);
+    }
+  }
+
+  if(t->slot < SLOTS) {
+    num_level0++;
+  }
+  num_timers++;
+  t->next = wheel[t->slot];
+  wheel[t->slot] = t;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Remove a timer from the wheel. Only the list that the timer claims
+ * to be on is searched, which also makes this safe to call for a
+ * timer that has never been set.
+ */
+static int
+wheel_remove(struct etimer *t)
+{
+  struct etimer **tp;
+
+  if(t->p == PROCESS_NONE || t->slot >= NUM_LISTS) {
+    return 0;
+  }
+  for(tp = &wheel[t->slot]; *tp != NULL; tp = &(*tp)->next) {
+    if(*tp == t) {
+      *tp = t->next;
+      t->next = NULL;
+      if(t->slot < SLOTS) {
+        num_level0--;
+      }
+      num_timers--;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Detach a list and return its timers to the wheel. */
+static void
+cascade(unsigned short list)
+{
+  struct etimer *t, *next;
+
+  t = wheel[list];
+  wheel[list] = NULL;
+  for(; t != NULL; t = next) {
+    next = t->next;
+    if(list < SLOTS) {
+      num_level0--;
+    }
+    num_timers--;
+    wheel_insert(t);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+expire(struct etimer *t)
+{
+  num_timers--;
+  if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+    /* Reset the process ID of the event timer, to signal that the
+       etimer has expired. This is later checked in the
+       etimer_expired() function. */
+    t->p = PROCESS_NONE;
+    t->next = NULL;
+  } else {
+    /* The event queue is full: keep the timer on the due list and
+       try again on the next poll. */
+    num_timers++;
+    t->slot = DUE_LIST;
+    t->next = wheel[DUE_LIST];
+    wheel[DUE_LIST] = t;
+    etimer_request_poll();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Process every tick up to and including the current time. */
+static void
+wheel_run(void)
+{
+  clock_time_t now;
+  clock_time_t boundary;
+  struct etimer *t, *next;
+  unsigned char level;
+  unsigned short index;
+
+  t = wheel[DUE_LIST];
+  wheel[DUE_LIST] = NULL;
+  for(; t != NULL; t = next) {
+    next = t->next;
+    expire(t);
+  }
+
+  now = clock_time();
+  if(num_timers == 0) {
+    wheel_time = now + 1;
+    return;
+  }
+
+  while(!TIME_BEFORE(now, wheel_time)) {
+    index = wheel_time & SLOT_MASK;
+    if(index == 0) {
+      /* Level 0 has wrapped: move the timers of the slot that starts
+         now down from the higher levels. */
+      for(level = 1; level < ETIMER_WHEEL_LEVELS; level++) {
+        index = (wheel_time >> (level * ETIMER_WHEEL_BITS)) & SLOT_MASK;
+        cascade(level * SLOTS + index);
+        if(index != 0) {
+          break;
+        }
+      }
+      if(level == ETIMER_WHEEL_LEVELS) {
+        cascade(OVERFLOW_LIST);
+      }
+      index = 0;
+    }
+
+    if(num_level0 == 0) {
+      /* Nothing can expire before the next cascade: skip ahead. */
+      boundary = (wheel_time | SLOT_MASK) + 1;
+      if(TIME_BEFORE(now, boundary)) {
+        wheel_time = now + 1;
+        break;
+      }
+      wheel_time = boundary;
+      continue;
+    }
+
+    t = wheel[index];
+    wheel[index] = NULL;
+    for(; t != NULL; t = next) {
+      next = t->next;
+      num_level0--;
+      expire(t);
+    }
+    wheel_time++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  clock_time_t expires;
+  unsigned char level, found, start;
+  unsigned short i, list;
+  struct etimer *t;
+
+  if(num_timers == 0) {
+    next_expiration = 0;
+    return;
+  }
+  if(wheel[DUE_LIST] != NULL) {
+    next_expiration = clock_time();
+    return;
+  }
+
+  found = 0;
+  /* All timers in a level 0 slot expire at the same tick, so the
+     first non-empty slot gives the earliest level 0 timer. */
+  for(i = 0; i < SLOTS && num_level0 > 0; i++) {
+    if(wheel[(wheel_time + i) & SLOT_MASK] != NULL) {
+      next_expiration = wheel_time + i;
+      found = 1;
+      break;
+    }
+  }
+  /* On the higher levels the first non-empty slot holds the earliest
+     timers of that level. The scan starts at the current slot if
+     wheel_time is at its start, since that slot has then not yet
+     been cascaded. */
+  for(level = 1; level < ETIMER_WHEEL_LEVELS; level++) {
+    start = (wheel_time &
+             (((clock_time_t)1 << (level * ETIMER_WHEEL_BITS)) - 1)) != 0;
+    for(i = start; i < start + SLOTS; i++) {
+      list = level * SLOTS +
+        (((wheel_time >> (level * ETIMER_WHEEL_BITS)) + i) & SLOT_MASK);
+      if(wheel[list] != NULL) {
+        break;
+      }
+    }
+    if(i < start + SLOTS) {
+      for(t = wheel[list]; t != NULL; t = t->next) {
+        expires = t->timer.start + t->timer.interval;
+        if(!found || TIME_BEFORE(expires, next_expiration)) {
+          next_expiration = expires;
+          found = 1;
+        }
+      }
+    }
+  }
+  for(t = wheel[OVERFLOW_LIST]; t != NULL; t = t->next) {
+    expires = t->timer.start + t->timer.interval;
+    if(!found || TIME_BEFORE(expires, next_expiration)) {
+      next_expiration = expires;
+      found = 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  struct etimer *t, *next;
+  unsigned short i;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_EXITED) {
+      for(i = 0; i < NUM_LISTS; i++) {
+        for(t = wheel[i]; t != NULL; t = next) {
+          next = t->next;
+          if(t->p == data) {
+            wheel_remove(t);
+          }
+        }
+      }
+      continue;
+    } else if(ev != PROCESS_EVENT_POLL) {
+      continue;
+    }
+
+    wheel_run();
+    update_time();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_request_poll(void)
+{
+  process_poll(&etimer_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_timer(struct etimer *timer)
+{
+  clock_time_t expires;
+
+  etimer_request_poll();
+
+  wheel_remove(timer);
+  /* Bring the wheel up to date, so that the distance to the new
+     timer is measured from the current time. */
+  wheel_run();
+
+  timer->p = PROCESS_CURRENT();
+  wheel_insert(timer);
+
+  /* Setting a timer can only make the next expiration earlier. A
+     stopped timer leaves next_expiration early, which is corrected
+     the next time the wheel runs. */
+  expires = timer->timer.start + timer->timer.interval;
+  if(num_timers == 1 || TIME_BEFORE(expires, next_expiration)) {
+    next_expiration = expires;
+  }
+}
+#else /* ETIMER_WHEEL */
+static struct etimer *timerlist;
 /*---------------------------------------------------------------------------*/
 static void
 update_time(void)
@@ -172,6 +481,7 @@ add_timer(struct etimer *timer)
 
   update_time();
 }
+#endif /* ETIMER_WHEEL */
 /*---------------------------------------------------------------------------*/
 void
 etimer_set(struct etimer *et, clock_time_t interval)
@@ -205,7 +515,16 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
+#if ETIMER_WHEEL
+  if(wheel_remove(et)) {
+    et->timer.start += timediff;
+    wheel_insert(et);
+  } else {
+    et->timer.start += timediff;
+  }
+#else /* ETIMER_WHEEL */
   et->timer.start += timediff;
+#endif /* ETIMER_WHEEL */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -230,7 +549,11 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
+#if ETIMER_WHEEL
+  return num_timers != 0;
+#else /* ETIMER_WHEEL */
   return timerlist != NULL;
+#endif /* ETIMER_WHEEL */
 }
 /*---------------------------------------------------------------------------*/
 clock_time_t
@@ -242,6 +565,9 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
+#if ETIMER_WHEEL
+  wheel_remove(et);
+#else /* ETIMER_WHEEL */
   struct etimer *t;
 
   /* First check if et is the first event timer on the list. */
@@ -262,6 +588,7 @@ etimer_stop(struct etimer *et)
       update_time();
     }
   }
+#endif /* ETIMER_WHEEL */
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
@@ -65,6 +65,33 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/*
+ * With ETIMER_CONF_WHEEL, pending event timers are kept in a
+ * hierarchical timer wheel instead of a single unsorted list, so
+ * that setting and expiring a timer does not walk every other
+ * pending timer. The wheel has ETIMER_CONF_WHEEL_LEVELS levels of
+ * 2^ETIMER_CONF_WHEEL_BITS slots each. Timers further away than
+ * 2^(LEVELS * BITS) ticks are parked on an overflow list. LEVELS *
+ * BITS must not exceed the width of clock_time_t.
+ */
+#ifdef ETIMER_CONF_WHEEL
+#define ETIMER_WHEEL ETIMER_CONF_WHEEL
+#else /* ETIMER_CONF_WHEEL */
+#define ETIMER_WHEEL 0
+#endif /* ETIMER_CONF_WHEEL */
+
+#ifdef ETIMER_CONF_WHEEL_BITS
+#define ETIMER_WHEEL_BITS ETIMER_CONF_WHEEL_BITS
+#else /* ETIMER_CONF_WHEEL_BITS */
+#define ETIMER_WHEEL_BITS 5
+#endif /* ETIMER_CONF_WHEEL_BITS */
+
+#ifdef ETIMER_CONF_WHEEL_LEVELS
+#define ETIMER_WHEEL_LEVELS ETIMER_CONF_WHEEL_LEVELS
+#else /* ETIMER_CONF_WHEEL_LEVELS */
+#define ETIMER_WHEEL_LEVELS 3
+#endif /* ETIMER_CONF_WHEEL_LEVELS */
+
 /**
  * A timer.
  *
@@ -77,6 +104,9 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_WHEEL
+  unsigned short slot;
+#endif /* ETIMER_WHEEL */
 };
 
 /**
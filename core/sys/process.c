@@ -47,6 +47,9 @@
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#if PROCESS_CONF_PROFILE
+#include "sys/rtimer.h"
+#endif /* PROCESS_CONF_PROFILE */
 
 /*
  * Pointer to the currently running process structure.
@@ -65,20 +68,54 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
+/*
+ * A ring buffer of events. The rings are indexed with wrap-around
+ * comparisons instead of a modulo, since the size is not a
+ * compile-time constant in the helper functions below.
+ */
+struct event_queue {
+  process_num_events_t nevents, fevent;
+  const process_num_events_t size;
+  struct event_data *events;
+};
+
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
+static struct event_queue normal_queue =
+  { 0, 0, PROCESS_CONF_NUMEVENTS, events };
+
+#if PROCESS_CONF_PRIORITIES
+static struct event_data high_events[PROCESS_CONF_NUMEVENTS_HIGH];
+static struct event_queue high_queue =
+  { 0, 0, PROCESS_CONF_NUMEVENTS_HIGH, high_events };
+#define QUEUED_EVENTS() (normal_queue.nevents + high_queue.nevents)
+#else /* PROCESS_CONF_PRIORITIES */
+#define QUEUED_EVENTS() (normal_queue.nevents)
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#if PROCESS_CONF_SUBSCRIPTIONS
+static struct process_subscription *subscriptions;
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+unsigned short process_droppedevents;
 #endif
 
 static volatile unsigned char poll_requested;
 
+#if PROCESS_CONF_PROFILE
+/* Time spent in processes called from within the current one */
+static uint32_t profile_nested;
+#endif /* PROCESS_CONF_PROFILE */
+
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
 #define PROCESS_STATE_CALLED      2
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
+#if PROCESS_CONF_SUBSCRIPTIONS
+static void unsubscribe_process(struct process *p);
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 
 #define DEBUG 0
 #if DEBUG
@@ -157,6 +194,10 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+#if PROCESS_CONF_SUBSCRIPTIONS
+  unsubscribe_process(p);
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
   if(p == process_list) {
     process_list = process_list->next;
   } else {
@@ -175,6 +216,10 @@ static void
 call_process(struct process *p, process_event_t ev, process_data_t data)
 {
   int ret;
+#if PROCESS_CONF_PROFILE
+  rtimer_clock_t start;
+  uint32_t run, self, outer_nested;
+#endif /* PROCESS_CONF_PROFILE */
 
 #if DEBUG
   if(p->state == PROCESS_STATE_CALLED) {
@@ -187,7 +232,22 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_CONF_PROFILE
+    outer_nested = profile_nested;
+    profile_nested = 0;
+    start = RTIMER_NOW();
+#endif /* PROCESS_CONF_PROFILE */
     ret = p->thread(&p->pt, ev, data);
+#if PROCESS_CONF_PROFILE
+    run = (rtimer_clock_t)(RTIMER_NOW() - start);
+    self = run > profile_nested ? run - profile_nested : 0;
+    p->runtime += self;
+    p->calls++;
+    if(self > p->maxrun) {
+      p->maxrun = self;
+    }
+    profile_nested = outer_nested + run;
+#endif /* PROCESS_CONF_PROFILE */
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -209,9 +269,16 @@ process_init(void)
 {
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  normal_queue.nevents = normal_queue.fevent = 0;
+#if PROCESS_CONF_PRIORITIES
+  high_queue.nevents = high_queue.fevent = 0;
+#endif /* PROCESS_CONF_PRIORITIES */
+#if PROCESS_CONF_SUBSCRIPTIONS
+  subscriptions = NULL;
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
+  process_droppedevents = 0;
 #endif /* PROCESS_CONF_STATS */
 
   process_current = process_list = NULL;
@@ -237,6 +304,80 @@ do_poll(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_SUBSCRIPTIONS
+static void
+unsubscribe_process(struct process *p)
+{
+  struct process_subscription **sp;
+
+  for(sp = &subscriptions; *sp != NULL;) {
+    if((*sp)->p == p) {
+      *sp = (*sp)->next;
+    } else {
+      sp = &(*sp)->next;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+process_unsubscribe(struct process_subscription *s)
+{
+  struct process_subscription **sp;
+
+  for(sp = &subscriptions; *sp != NULL; sp = &(*sp)->next) {
+    if(*sp == s) {
+      *sp = s->next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+process_subscribe(struct process_subscription *s,
+                  struct process *p, process_event_t ev)
+{
+  process_unsubscribe(s);
+  s->p = p;
+  s->ev = ev;
+  s->next = subscriptions;
+  subscriptions = s;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Deliver a broadcast event to its subscribers. Returns zero if the
+ * event has no subscribers, in which case it should be delivered to
+ * all processes.
+ */
+static int
+deliver_to_subscribers(process_event_t ev, process_data_t data)
+{
+  struct process_subscription *s;
+  int delivered;
+
+  delivered = 0;
+  /* A subscription removed by the called process keeps its next
+     pointer, so the walk can continue past it. */
+  for(s = subscriptions; s != NULL; s = s->next) {
+    if(s->ev == ev) {
+      if(poll_requested) {
+        do_poll();
+      }
+      call_process(s->p, ev, data);
+      delivered = 1;
+    }
+  }
+  return delivered;
+}
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+/*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PRIORITIES
+void
+process_set_priority(struct process *p, unsigned char priority)
+{
+  p->priority = priority;
+}
+#endif /* PROCESS_CONF_PRIORITIES */
+/*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
  * listening processes.
@@ -249,31 +390,57 @@ do_event(void)
   process_data_t data;
   struct process *receiver;
   struct process *p;
-  
+  struct event_queue *q;
+
   /*
    * If there are any events in the queue, take the first one and walk
    * through the list of processes to see if the event should be
    * delivered to any of them. If so, we call the event handler
    * function for the process. We only process one event at a time and
-   * call the poll handlers inbetween.
+   * call the poll handlers inbetween. High priority events are always
+   * taken before normal priority events.
    */
 
-  if(nevents > 0) {
+#if PROCESS_CONF_PRIORITIES
+  q = high_queue.nevents > 0 ? &high_queue : &normal_queue;
+#else /* PROCESS_CONF_PRIORITIES */
+  q = &normal_queue;
+#endif /* PROCESS_CONF_PRIORITIES */
+
+  if(q->nevents > 0) {
     
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    ev = q->events[q->fevent].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
-    --nevents;
+    if(++q->fevent == q->size) {
+      q->fevent = 0;
+    }
+    --q->nevents;
+
+#if PROCESS_CONF_PRIORITIES
+    if(receiver != PROCESS_BROADCAST && q == &normal_queue) {
+      --receiver->normal_queued;
+    }
+#endif /* PROCESS_CONF_PRIORITIES */
+#if PROCESS_CONF_PER_PROCESS_STATS
+    if(receiver != PROCESS_BROADCAST) {
+      --receiver->queued;
+    }
+#endif /* PROCESS_CONF_PER_PROCESS_STATS */
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
     if(receiver == PROCESS_BROADCAST) {
+#if PROCESS_CONF_SUBSCRIPTIONS
+      if(deliver_to_subscribers(ev, data)) {
+        return;
+      }
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
       for(p = process_list; p != NULL; p = p->next) {
 
 	/* If we have been requested to poll a process, we do this in
@@ -301,6 +468,10 @@ do_event(void)
 int
 process_run(void)
 {
+#if PROCESS_CONF_EVENT_BATCH > 1
+  int i;
+#endif /* PROCESS_CONF_EVENT_BATCH > 1 */
+
   /* Process poll events. */
   if(poll_requested) {
     do_poll();
@@ -309,30 +480,66 @@ process_run(void)
   /* Process one event from the queue */
   do_event();
 
-  return nevents + poll_requested;
+#if PROCESS_CONF_EVENT_BATCH > 1
+  /* Deliver more of the queued events, still letting the poll
+     handlers run before each one. */
+  for(i = 1; i < PROCESS_CONF_EVENT_BATCH && QUEUED_EVENTS() > 0; i++) {
+    if(poll_requested) {
+      do_poll();
+    }
+    do_event();
+  }
+#endif /* PROCESS_CONF_EVENT_BATCH > 1 */
+
+  return QUEUED_EVENTS() + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
 int
 process_nevents(void)
 {
-  return nevents + poll_requested;
+  return QUEUED_EVENTS() + poll_requested;
+}
+/*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_PROFILE
+void
+process_profile_reset(void)
+{
+  struct process *p;
+
+  for(p = process_list; p != NULL; p = p->next) {
+    p->runtime = p->maxrun = p->calls = 0;
+  }
 }
 /*---------------------------------------------------------------------------*/
+#endif /* PROCESS_CONF_PROFILE */
 int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
-  process_num_events_t snum;
+  unsigned int snum;
+  struct event_queue *q;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
-	   ev,PROCESS_NAME_STRING(p), nevents);
+	   ev,PROCESS_NAME_STRING(p), QUEUED_EVENTS());
   } else {
     PRINTF("process_post: Process '%s' posts event %d to process '%s', nevents %d\n",
 	   PROCESS_NAME_STRING(PROCESS_CURRENT()), ev,
-	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
+	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), QUEUED_EVENTS());
   }
+
+  q = &normal_queue;
+#if PROCESS_CONF_PRIORITIES
+  /* Events to high priority processes go to the high priority
+     queue, and overflow into the normal queue when it is full. They
+     keep going to the normal queue until the process has no events
+     left there, so that its events are delivered in FIFO order. */
+  if(p != PROCESS_BROADCAST && p->priority == PROCESS_PRIORITY_HIGH &&
+     p->normal_queued == 0 && high_queue.nevents < high_queue.size) {
+    q = &high_queue;
+  }
+#endif /* PROCESS_CONF_PRIORITIES */
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  if(q->nevents == q->size) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -340,24 +547,85 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
       printf("soft panic: event queue is full when event %d was posted to %s from %s\n", ev, PROCESS_NAME_STRING(p), PROCESS_NAME_STRING(process_current));
     }
 #endif /* DEBUG */
+#if PROCESS_CONF_STATS
+    ++process_droppedevents;
+#endif /* PROCESS_CONF_STATS */
+#if PROCESS_CONF_PER_PROCESS_STATS
+    if(p != PROCESS_BROADCAST) {
+      ++p->dropped;
+    }
+#endif /* PROCESS_CONF_PER_PROCESS_STATS */
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
-  ++nevents;
-
+  snum = q->fevent + q->nevents;
+  if(snum >= q->size) {
+    snum -= q->size;
+  }
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
+
+#if PROCESS_CONF_PRIORITIES
+  if(p != PROCESS_BROADCAST && q == &normal_queue) {
+    ++p->normal_queued;
+  }
+#endif /* PROCESS_CONF_PRIORITIES */
 #if PROCESS_CONF_STATS
-  if(nevents > process_maxevents) {
-    process_maxevents = nevents;
+  if(QUEUED_EVENTS() > process_maxevents) {
+    process_maxevents = QUEUED_EVENTS();
   }
 #endif /* PROCESS_CONF_STATS */
+#if PROCESS_CONF_PER_PROCESS_STATS
+  if(p != PROCESS_BROADCAST) {
+    ++p->posted;
+    if(++p->queued > p->maxqueued) {
+      p->maxqueued = p->queued;
+    }
+  }
+#endif /* PROCESS_CONF_PER_PROCESS_STATS */
   
   return PROCESS_ERR_OK;
 }
 /*---------------------------------------------------------------------------*/
+static int
+is_queued(struct event_queue *q, struct process *p,
+          process_event_t ev, process_data_t data)
+{
+  process_num_events_t i, n;
+
+  for(i = q->fevent, n = q->nevents; n > 0; n--) {
+    if(q->events[i].p == p && q->events[i].ev == ev &&
+       q->events[i].data == data) {
+      return 1;
+    }
+    if(++i == q->size) {
+      i = 0;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+process_post_coalesce(struct process *p, process_event_t ev,
+                      process_data_t data)
+{
+  if(is_queued(&normal_queue, p, ev, data)
+#if PROCESS_CONF_PRIORITIES
+     || is_queued(&high_queue, p, ev, data)
+#endif /* PROCESS_CONF_PRIORITIES */
+     ) {
+#if PROCESS_CONF_PER_PROCESS_STATS
+    if(p != PROCESS_BROADCAST) {
+      ++p->coalesced;
+    }
+#endif /* PROCESS_CONF_PER_PROCESS_STATS */
+    return PROCESS_ERR_OK;
+  }
+  return process_post(p, ev, data);
+}
+/*---------------------------------------------------------------------------*/
 void
 process_post_synch(struct process *p, process_event_t ev, process_data_t data)
 {
@@ -88,6 +88,69 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/*
+ * With PROCESS_CONF_PRIORITIES, events posted to a process that has
+ * been given PROCESS_PRIORITY_HIGH with process_set_priority() are
+ * kept in a separate, smaller queue that is always drained before
+ * the normal event queue. Broadcast events are always of normal
+ * priority. While a process still has events in the normal queue,
+ * because the high priority queue was full or because it was given
+ * high priority later, new events go to the normal queue too so that
+ * they are delivered in the order they were posted.
+ */
+#ifndef PROCESS_CONF_PRIORITIES
+#define PROCESS_CONF_PRIORITIES 0
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 8
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+/*
+ * The maximum number of queued events that process_run() delivers
+ * before it returns. Poll handlers are still called in between
+ * events. The default, 1, is the classic one-event-per-call
+ * behaviour.
+ */
+#ifndef PROCESS_CONF_EVENT_BATCH
+#define PROCESS_CONF_EVENT_BATCH 1
+#endif /* PROCESS_CONF_EVENT_BATCH */
+
+/*
+ * With PROCESS_CONF_SUBSCRIPTIONS, a process can subscribe to a
+ * broadcast event with process_subscribe(). A broadcast event that
+ * has at least one subscriber is only delivered to its subscribers,
+ * instead of to every process in the system.
+ */
+#ifndef PROCESS_CONF_SUBSCRIPTIONS
+#define PROCESS_CONF_SUBSCRIPTIONS 0
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
+/*
+ * With PROCESS_CONF_PER_PROCESS_STATS, every process keeps counters
+ * of the events posted to it, the events dropped because the queue
+ * was full, the events merged by process_post_coalesce() and the
+ * largest number of its events that were queued at the same time.
+ */
+#ifndef PROCESS_CONF_PER_PROCESS_STATS
+#define PROCESS_CONF_PER_PROCESS_STATS 0
+#endif /* PROCESS_CONF_PER_PROCESS_STATS */
+
+/*
+ * With PROCESS_CONF_PROFILE, every process accumulates the time its
+ * thread has run, measured with the rtimer clock, the number of
+ * times it has been called and its longest single run.
+ * Interrupts that occur while a process runs are counted to it, and
+ * time spent in a process that it calls synchronously, e.g. with
+ * process_post_synch(), is counted to the called process only.
+ */
+#ifndef PROCESS_CONF_PROFILE
+#define PROCESS_CONF_PROFILE 0
+#endif /* PROCESS_CONF_PROFILE */
+
+#define PROCESS_PRIORITY_NORMAL 0
+#define PROCESS_PRIORITY_HIGH   1
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,7 +386,41 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_CONF_PRIORITIES
+  unsigned char priority;
+  /* Events for this process in the normal queue */
+  process_num_events_t normal_queued;
+#endif /* PROCESS_CONF_PRIORITIES */
+#if PROCESS_CONF_PER_PROCESS_STATS
+  unsigned short posted, dropped, coalesced;
+  process_num_events_t queued, maxqueued;
+#endif /* PROCESS_CONF_PER_PROCESS_STATS */
+#if PROCESS_CONF_PROFILE
+  /* Run times in rtimer ticks */
+  uint32_t runtime, maxrun;
+  uint32_t calls;
+#endif /* PROCESS_CONF_PROFILE */
+};
+
+#if PROCESS_CONF_STATS
+/** The largest number of events that have been queued at once. */
+extern process_num_events_t process_maxevents;
+/** The number of events that process_post() could not queue. */
+extern unsigned short process_droppedevents;
+#endif /* PROCESS_CONF_STATS */
+
+#if PROCESS_CONF_SUBSCRIPTIONS
+/**
+ * A subscription of a process to a broadcast event. The structure
+ * is owned by the caller and must stay valid until it has been
+ * removed with process_unsubscribe() or the process has exited.
+ */
+struct process_subscription {
+  struct process_subscription *next;
+  struct process *p;
+  process_event_t ev;
 };
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 
 /**
  * \name Functions called from application programs
@@ -364,6 +461,24 @@ CCIF void process_start(struct process *p, process_data_t data);
  */
 CCIF int process_post(struct process *p, process_event_t ev, process_data_t data);
 
+/**
+ * Post an asynchronous event unless it is already queued.
+ *
+ * This function works like process_post(), but if an event with the
+ * same receiver, event number and data is already waiting in the
+ * event queue, no new event is queued. It is meant for events that
+ * act as notifications, where delivering the same event twice in a
+ * row has no additional effect.
+ *
+ * \retval PROCESS_ERR_OK The event was posted or merged with a
+ * queued event.
+ *
+ * \retval PROCESS_ERR_FULL The event queue was full and the event could
+ * not be posted.
+ */
+CCIF int process_post_coalesce(struct process *p, process_event_t ev,
+                               process_data_t data);
+
 /**
  * Post a synchronous event to a process.
  *
@@ -389,6 +504,42 @@ CCIF void process_post_synch(struct process *p,
  */
 CCIF void process_exit(struct process *p);
 
+#if PROCESS_CONF_PRIORITIES
+/**
+ * \brief      Set the priority of the events posted to a process
+ * \param p    The process
+ * \param priority PROCESS_PRIORITY_NORMAL or PROCESS_PRIORITY_HIGH
+ *
+ *             Events posted to a high priority process with
+ *             process_post() are delivered before any pending normal
+ *             priority events.
+ */
+CCIF void process_set_priority(struct process *p, unsigned char priority);
+#else /* PROCESS_CONF_PRIORITIES */
+#define process_set_priority(p, priority)
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#if PROCESS_CONF_SUBSCRIPTIONS
+/**
+ * \brief      Subscribe a process to a broadcast event
+ * \param s    A caller-owned subscription structure
+ * \param p    The process that should receive the event
+ * \param ev   The broadcast event
+ *
+ *             Once an event has a subscriber, broadcasting it
+ *             only calls the subscribed processes. Subscriptions are
+ *             removed automatically when their process exits.
+ */
+CCIF void process_subscribe(struct process_subscription *s,
+                            struct process *p, process_event_t ev);
+
+/**
+ * \brief      Remove a subscription added with process_subscribe()
+ * \param s    The subscription
+ */
+CCIF void process_unsubscribe(struct process_subscription *s);
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
 
 /**
  * Get a pointer to the currently running process.
@@ -489,7 +640,8 @@ void process_init(void);
  *
  * This function should be called repeatedly from the main() program
  * to actually run the Contiki system. It calls the necessary poll
- * handlers, and processes one event. The function returns the number
+ * handlers, and processes one event (or up to
+ * PROCESS_CONF_EVENT_BATCH events). The function returns the number
  * of events that are waiting in the event queue so that the caller
  * may choose to put the CPU to sleep when there are no pending
  * events.
@@ -519,6 +671,13 @@ CCIF int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+#if PROCESS_CONF_PROFILE
+/**
+ * Clear the run time, call count and longest run of all processes.
+ */
+void process_profile_reset(void);
+#endif /* PROCESS_CONF_PROFILE */
+
 /** @} */
 
 CCIF extern struct process *process_list;
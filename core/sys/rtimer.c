@@ -46,6 +46,8 @@
 #include "sys/rtimer.h"
 #include "contiki.h"
 
+#include <string.h>
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -54,8 +56,32 @@
 #define PRINTF(...)
 #endif
 
+/* The pending task, or with RTIMER_QUEUE the earliest pending task. */
 static struct rtimer *next_rtimer;
 
+#if RTIMER_STATS
+static struct rtimer_stats stats;
+#define STATS_SET(time) do {                                    \
+    if(RTIMER_CLOCK_LT((time), RTIMER_NOW())) {                 \
+      stats.late_sets++;                                        \
+    }                                                           \
+  } while(0)
+#define STATS_RUN(t) do {                                       \
+    rtimer_clock_t jitter = RTIMER_NOW() - (t)->time;           \
+    if(RTIMER_CLOCK_DIFF(RTIMER_NOW(), (t)->time) < 0) {        \
+      jitter = 0;                                               \
+    }                                                           \
+    stats.runs++;                                               \
+    stats.total_jitter += jitter;                               \
+    if(jitter > stats.max_jitter) {                             \
+      stats.max_jitter = jitter;                                \
+    }                                                           \
+  } while(0)
+#else /* RTIMER_STATS */
+#define STATS_SET(time)
+#define STATS_RUN(t)
+#endif /* RTIMER_STATS */
+
 /*---------------------------------------------------------------------------*/
 void
 rtimer_init(void)
@@ -63,6 +89,92 @@ rtimer_init(void)
   rtimer_arch_init();
 }
 /*---------------------------------------------------------------------------*/
+#if RTIMER_QUEUE
+/* Remove a task from the queue, if it is on it. */
+static void
+dequeue(struct rtimer *rtimer)
+{
+  struct rtimer **tp;
+
+  for(tp = &next_rtimer; *tp != NULL; tp = &(*tp)->next) {
+    if(*tp == rtimer) {
+      *tp = rtimer->next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
+	   rtimer_clock_t duration,
+	   rtimer_callback_t func, void *ptr)
+{
+  struct rtimer **tp;
+
+  PRINTF("rtimer_set time %d\n", time);
+
+  STATS_SET(time);
+
+  RTIMER_QUEUE_LOCK();
+
+  /* Setting a pending task again moves it to its new deadline. */
+  dequeue(rtimer);
+
+  rtimer->func = func;
+  rtimer->ptr = ptr;
+  rtimer->time = time;
+
+  /* Tasks with the same deadline run in the order they were set. */
+  for(tp = &next_rtimer;
+      *tp != NULL && !RTIMER_CLOCK_LT(time, (*tp)->time);
+      tp = &(*tp)->next);
+  rtimer->next = *tp;
+  *tp = rtimer;
+
+  if(next_rtimer == rtimer) {
+    rtimer_arch_schedule(time);
+  }
+
+  RTIMER_QUEUE_UNLOCK();
+
+  return RTIMER_OK;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_run_next(void)
+{
+  struct rtimer *t;
+
+  /* The interrupt is for the task at the head of the queue. Tasks
+     that become due within RTIMER_GUARD_TIME of it are too close to
+     program the hardware for, so we busy-wait for their deadline and
+     run them here, never early. A task that set itself again is left
+     for the next interrupt. */
+  do {
+    RTIMER_QUEUE_LOCK();
+    t = next_rtimer;
+    if(t != NULL) {
+      next_rtimer = t->next;
+      t->next = NULL;
+    }
+    RTIMER_QUEUE_UNLOCK();
+    if(t == NULL) {
+      return;
+    }
+    while(RTIMER_CLOCK_LT(RTIMER_NOW(), t->time));
+    STATS_RUN(t);
+    t->func(t, t->ptr);
+  } while(next_rtimer != NULL && next_rtimer != t &&
+          RTIMER_CLOCK_DIFF(next_rtimer->time, RTIMER_NOW()) <=
+          RTIMER_GUARD_TIME);
+
+  RTIMER_QUEUE_LOCK();
+  if(next_rtimer != NULL) {
+    rtimer_arch_schedule(next_rtimer->time);
+  }
+  RTIMER_QUEUE_UNLOCK();
+}
+#else /* RTIMER_QUEUE */
 int
 rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
@@ -72,6 +184,8 @@ rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 
   PRINTF("rtimer_set time %d\n", time);
 
+  STATS_SET(time);
+
   if(next_rtimer == NULL) {
     first = 1;
   }
@@ -97,12 +211,41 @@ rtimer_run_next(void)
   }
   t = next_rtimer;
   next_rtimer = NULL;
+  STATS_RUN(t);
   t->func(t, t->ptr);
   if(next_rtimer != NULL) {
     rtimer_arch_schedule(next_rtimer->time);
   }
   return;
 }
+#endif /* RTIMER_QUEUE */
+/*---------------------------------------------------------------------------*/
+int
+rtimer_next_expiration_time(rtimer_clock_t *time)
+{
+  struct rtimer *t;
+
+  t = next_rtimer;
+  if(t == NULL) {
+    return 0;
+  }
+  *time = t->time;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#if RTIMER_STATS
+void
+rtimer_get_stats(struct rtimer_stats *s)
+{
+  *s = stats;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_reset_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
 /*---------------------------------------------------------------------------*/
+#endif /* RTIMER_STATS */
 
 /** @}*/
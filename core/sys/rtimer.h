@@ -64,6 +64,39 @@ typedef unsigned short rtimer_clock_t;
 
 #include "rtimer-arch.h"
 
+/*
+ * With RTIMER_CONF_QUEUE, any number of real-time tasks can be
+ * scheduled at the same time. They are kept in a list sorted by
+ * deadline and the hardware is always programmed for the earliest
+ * one. Without it, only one task can be pending and a new
+ * rtimer_set() replaces it.
+ *
+ * When rtimer_set() can be called both from an rtimer callback and
+ * from the main loop, the platform must define
+ * RTIMER_CONF_QUEUE_LOCK() and RTIMER_CONF_QUEUE_UNLOCK() to keep
+ * the rtimer interrupt out while the queue is updated.
+ */
+#ifdef RTIMER_CONF_QUEUE
+#define RTIMER_QUEUE RTIMER_CONF_QUEUE
+#else /* RTIMER_CONF_QUEUE */
+#define RTIMER_QUEUE 0
+#endif /* RTIMER_CONF_QUEUE */
+
+#ifdef RTIMER_CONF_QUEUE_LOCK
+#define RTIMER_QUEUE_LOCK() RTIMER_CONF_QUEUE_LOCK()
+#define RTIMER_QUEUE_UNLOCK() RTIMER_CONF_QUEUE_UNLOCK()
+#else /* RTIMER_CONF_QUEUE_LOCK */
+#define RTIMER_QUEUE_LOCK()
+#define RTIMER_QUEUE_UNLOCK()
+#endif /* RTIMER_CONF_QUEUE_LOCK */
+
+/* With RTIMER_CONF_STATS, the module measures how late the tasks run. */
+#ifdef RTIMER_CONF_STATS
+#define RTIMER_STATS RTIMER_CONF_STATS
+#else /* RTIMER_CONF_STATS */
+#define RTIMER_STATS 0
+#endif /* RTIMER_CONF_STATS */
+
 /**
  * \brief      Initialize the real-time scheduler.
  *
@@ -87,6 +120,26 @@ struct rtimer {
   rtimer_clock_t time;
   rtimer_callback_t func;
   void *ptr;
+#if RTIMER_QUEUE
+  struct rtimer *next;
+#endif /* RTIMER_QUEUE */
+};
+
+/**
+ * \brief      Lateness statistics of the real-time tasks
+ *
+ *             The jitter of a task is the time from its deadline to
+ *             when its callback was started, in rtimer ticks.
+ */
+struct rtimer_stats {
+  /** The number of tasks run */
+  unsigned long runs;
+  /** The sum of the jitter of all tasks */
+  unsigned long total_jitter;
+  /** The largest jitter seen */
+  rtimer_clock_t max_jitter;
+  /** Tasks that were set with a deadline that had already passed */
+  unsigned long late_sets;
 };
 
 enum {
@@ -122,6 +175,26 @@ int rtimer_set(struct rtimer *task, rtimer_clock_t time,
  */
 void rtimer_run_next(void);
 
+/**
+ * \brief      Get the time of the next scheduled real-time task
+ * \param time Set to the time of the task, if there is one
+ * \return     Non-zero if a real-time task is scheduled, zero otherwise
+ */
+int rtimer_next_expiration_time(rtimer_clock_t *time);
+
+#if RTIMER_STATS
+/**
+ * \brief      Get the lateness statistics of the real-time tasks
+ * \param stats Filled in with the statistics
+ */
+void rtimer_get_stats(struct rtimer_stats *stats);
+
+/**
+ * \brief      Reset the lateness statistics of the real-time tasks
+ */
+void rtimer_reset_stats(void);
+#endif /* RTIMER_STATS */
+
 /**
  * \brief      Get the current clock time
  * \return     The current time
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup stack-check
+ * @{
+ */
+
+/**
+ * \file
+ *         Stack usage measurement by painting
+ */
+
+#include "contiki.h"
+#include "sys/stack-check.h"
+#include "lib/list.h"
+
+/* Bytes below the current stack pointer that are left alone when the
+   stack in use is painted, for the frames of the functions that do
+   the painting */
+#define MARGIN 64
+
+LIST(stacks);
+/*---------------------------------------------------------------------------*/
+void
+stack_check_paint(void *bottom, unsigned int size)
+{
+  volatile char here;
+  char *p = bottom;
+  char *end = p + size;
+
+  if(&here >= p && &here < end) {
+    end = (char *)&here - MARGIN;
+  }
+  for(; p < end; p++) {
+    *p = STACK_CHECK_PATTERN;
+  }
+}
+/*---------------------------------------------------------------------------*/
+unsigned int
+stack_check_usage(const void *bottom, unsigned int size)
+{
+  const unsigned char *p = bottom;
+  unsigned int i;
+
+  for(i = 0; i < size && p[i] == STACK_CHECK_PATTERN; i++);
+  return size - i;
+}
+/*---------------------------------------------------------------------------*/
+void
+stack_check_add(struct stack_check *s, const char *name,
+                void *bottom, unsigned int size)
+{
+  s->name = name;
+  s->bottom = bottom;
+  s->size = size;
+  stack_check_paint(bottom, size);
+  list_add(stacks, s);
+}
+/*---------------------------------------------------------------------------*/
+void
+stack_check_remove(struct stack_check *s)
+{
+  list_remove(stacks, s);
+}
+/*---------------------------------------------------------------------------*/
+struct stack_check *
+stack_check_head(void)
+{
+  return list_head(stacks);
+}
+/*---------------------------------------------------------------------------*/
+struct stack_check *
+stack_check_next(struct stack_check *s)
+{
+  return list_item_next(s);
+}
+/*---------------------------------------------------------------------------*/
+
+/** @} */
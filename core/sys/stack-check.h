@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup sys
+ * @{
+ */
+
+/**
+ * \defgroup stack-check Stack usage measurement
+ *
+ * The stack check module measures how deep a stack has grown. A stack
+ * is painted with a known pattern, and the usage is later found by
+ * looking for the lowest byte that no longer holds the pattern. Stacks
+ * are assumed to grow downwards, as they do on all Contiki platforms.
+ *
+ * Stacks can be measured directly with stack_check_paint() and
+ * stack_check_usage(), or put on a list with stack_check_add(), from
+ * which they are shown by the "memstats" shell command. With
+ * STACK_CHECK_CONF_MAIN, platforms that support it paint and list
+ * their main stack at startup.
+ *
+ * The result is a high-water mark: it tells the most stack used since
+ * the stack was painted, provided that nothing wrote the pattern
+ * itself at the deepest point.
+ *
+ * @{
+ */
+
+/**
+ * \file
+ *         Header file for the stack usage measurement
+ */
+
+#ifndef STACK_CHECK_H_
+#define STACK_CHECK_H_
+
+#include "contiki-conf.h"
+
+#ifdef STACK_CHECK_CONF_MAIN
+#define STACK_CHECK_MAIN STACK_CHECK_CONF_MAIN
+#else
+#define STACK_CHECK_MAIN 0
+#endif
+
+/** The byte that stacks are painted with */
+#define STACK_CHECK_PATTERN 0xa5
+
+/**
+ * \brief A stack on the list of stacks
+ */
+struct stack_check {
+  struct stack_check *next;
+  /** The name shown for the stack */
+  const char *name;
+  /** The lowest address of the stack */
+  void *bottom;
+  /** The size of the stack in bytes */
+  unsigned int size;
+};
+
+/**
+ * \brief      Paint a stack
+ * \param bottom The lowest address of the stack
+ * \param size The size of the stack in bytes
+ *
+ *             If the stack is the one currently in use, only the part
+ *             well below the current stack pointer is painted.
+ */
+void stack_check_paint(void *bottom, unsigned int size);
+
+/**
+ * \brief      Get the most stack used since the stack was painted
+ * \param bottom The lowest address of the stack
+ * \param size The size of the stack in bytes
+ * \return     The number of bytes from the top of the stack down to
+ *             the deepest point the stack has grown to
+ */
+unsigned int stack_check_usage(const void *bottom, unsigned int size);
+
+/**
+ * \brief      Paint a stack and put it on the list of stacks
+ * \param s    The list entry, kept by the caller
+ * \param name The name shown for the stack
+ * \param bottom The lowest address of the stack
+ * \param size The size of the stack in bytes
+ */
+void stack_check_add(struct stack_check *s, const char *name,
+                     void *bottom, unsigned int size);
+
+/**
+ * \brief      Take a stack off the list of stacks
+ */
+void stack_check_remove(struct stack_check *s);
+
+/**
+ * \brief      Get the first stack on the list of stacks
+ */
+struct stack_check *stack_check_head(void);
+
+/**
+ * \brief      Get the stack after s on the list of stacks
+ */
+struct stack_check *stack_check_next(struct stack_check *s);
+
+#endif /* STACK_CHECK_H_ */
+
+/** @} */
+/** @} */
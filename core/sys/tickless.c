@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup tickless
+ * @{
+ */
+
+/**
+ * \file
+ *         Tickless idle: merged timer deadlines and sleep accounting
+ */
+
+#include "contiki.h"
+#include "sys/tickless.h"
+#include "sys/energest.h"
+
+static struct tickless_stats stats;
+static rtimer_clock_t sleep_start;
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+tickless_idle_time(rtimer_clock_t max)
+{
+  clock_time_t now;
+  clock_time_t ticks;
+  rtimer_clock_t next;
+  rtimer_clock_t idle;
+
+  if(process_nevents() > 0) {
+    return 0;
+  }
+
+  idle = max;
+
+  /* The callback timers are event timers of the ctimer process, so
+     the event timer deadline covers both. */
+  if(etimer_pending()) {
+    now = clock_time();
+    ticks = etimer_next_expiration_time() - now;
+    if(ticks == 0 || ticks > ((clock_time_t)-1 >> 1)) {
+      /* Due now or overdue: etimer_process has to run. */
+      return 0;
+    }
+    /* 64 bits: max * CLOCK_SECOND and ticks * RTIMER_SECOND can
+       both overflow 32 bits with fast rtimers. */
+    if(ticks < (uint64_t)max * CLOCK_SECOND / RTIMER_SECOND) {
+      idle = (uint64_t)ticks * RTIMER_SECOND / CLOCK_SECOND;
+    }
+  }
+
+  if(rtimer_next_expiration_time(&next)) {
+    if(RTIMER_CLOCK_DIFF(next, RTIMER_NOW()) <= 0) {
+      return 0;
+    }
+    if((rtimer_clock_t)(next - RTIMER_NOW()) < idle) {
+      idle = next - RTIMER_NOW();
+    }
+  }
+
+  return idle;
+}
+/*---------------------------------------------------------------------------*/
+void
+tickless_sleep_begin(rtimer_clock_t planned)
+{
+  stats.sleeps++;
+  stats.planned += planned;
+  sleep_start = RTIMER_NOW();
+  ENERGEST_SWITCH(ENERGEST_TYPE_CPU, ENERGEST_TYPE_LPM);
+}
+/*---------------------------------------------------------------------------*/
+void
+tickless_sleep_end(void)
+{
+  ENERGEST_SWITCH(ENERGEST_TYPE_LPM, ENERGEST_TYPE_CPU);
+  stats.slept += (rtimer_clock_t)(RTIMER_NOW() - sleep_start);
+}
+/*---------------------------------------------------------------------------*/
+void
+tickless_get_stats(struct tickless_stats *s)
+{
+  *s = stats;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
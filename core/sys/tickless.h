@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup sys
+ * @{
+ */
+
+/**
+ * \defgroup tickless Tickless idle
+ *
+ * The tickless idle module tells a platform main loop how long the
+ * CPU may sleep. It merges the deadlines of the event timers, and
+ * thus of the callback timers, with the next real-time task, so that
+ * the platform can program a single wakeup instead of waking up on
+ * every clock tick. The sleep itself is accounted as ENERGEST_TYPE_LPM
+ * time, and the module keeps counters of the idle periods.
+ *
+ * A main loop typically looks like:
+ \code
+ while(1) {
+   if(process_run() == 0) {
+     rtimer_clock_t idle = tickless_idle_time(RTIMER_SECOND);
+     if(idle > 0) {
+       tickless_sleep_begin(idle);
+       ... sleep for at most idle rtimer ticks ...
+       tickless_sleep_end();
+     }
+   }
+ }
+ \endcode
+ *
+ * @{
+ */
+
+/**
+ * \file
+ *         Header file for the tickless idle module
+ */
+
+#ifndef TICKLESS_H_
+#define TICKLESS_H_
+
+#include "contiki-conf.h"
+#include "sys/rtimer.h"
+
+/**
+ * \brief Statistics of the idle periods
+ */
+struct tickless_stats {
+  /** The number of idle periods */
+  unsigned long sleeps;
+  /** The rtimer ticks the idle periods were planned to last */
+  unsigned long planned;
+  /** The rtimer ticks actually spent idle */
+  unsigned long slept;
+};
+
+/**
+ * \brief      Get how long the CPU may sleep
+ * \param max  The longest sleep, in rtimer ticks, that the caller wants
+ * \return     The number of rtimer ticks until the next event timer,
+ *             callback timer or real-time task deadline, at most max.
+ *             Zero if there are pending events or a timer is already
+ *             due, in which case the CPU should not sleep.
+ *
+ *             max is converted to clock ticks, so max * CLOCK_SECOND
+ *             must fit in an unsigned long.
+ */
+rtimer_clock_t tickless_idle_time(rtimer_clock_t max);
+
+/**
+ * \brief      Mark the start of an idle period
+ * \param planned The planned length of the idle period, in rtimer ticks
+ */
+void tickless_sleep_begin(rtimer_clock_t planned);
+
+/**
+ * \brief      Mark the end of an idle period started with
+ *             tickless_sleep_begin()
+ */
+void tickless_sleep_end(void);
+
+/**
+ * \brief      Get the idle statistics
+ * \param stats Filled in with the statistics since boot
+ */
+void tickless_get_stats(struct tickless_stats *stats);
+
+#endif /* TICKLESS_H_ */
+
+/** @} */
+/** @} */
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Cortex-M3/M4 bulk word summing for the Internet checksum in
+ *         core/net/ip/ip-chksum.c. Enabled by IP_CHKSUM_CONF_ARCH.
+ */
+
+#include "net/ip/ip-chksum.h"
+
+#if IP_CHKSUM_ARCH
+/*---------------------------------------------------------------------------*/
+uint32_t
+ip_chksum_arch_words(uint32_t acc, const uint32_t *data, uint16_t words)
+{
+  uint32_t w;
+
+  /* Four words per iteration: one LDM and a chain of add-with-carry, the
+     carry out of the last addition going back into the accumulator. */
+  while(words >= 4) {
+    __asm__("ldmia %[data]!, {r2, r3, r4, r5}\n\t"
+            "adds %[acc], %[acc], r2\n\t"
+            "adcs %[acc], %[acc], r3\n\t"
+            "adcs %[acc], %[acc], r4\n\t"
+            "adcs %[acc], %[acc], r5\n\t"
+            "adc %[acc], %[acc], #0\n\t"
+            : [acc] "+r" (acc), [data] "+r" (data)
+            :
+            : "r2", "r3", "r4", "r5", "cc", "memory");
+    words -= 4;
+  }
+
+  while(words > 0) {
+    w = *data++;
+    acc += w;
+    if(acc < w) {
+      acc++;      /* carry */
+    }
+    words--;
+  }
+
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* IP_CHKSUM_ARCH */
@@ -35,8 +35,11 @@
  * \file
  * Implmentation of the ARM Cortex-M support for Contiki multi-threading.
  */
-#include CMSIS_DEV_HDR
 #include "sys/mt.h"
+#include "sys/stack-check.h"
+#if !MTARCH_DIRECT_SWITCH
+#include CMSIS_DEV_HDR
+#endif
 
 #include <stdint.h>
 
@@ -177,6 +180,92 @@ pendsv_handler(void)
 #endif
 }
 /*----------------------------------------------------------------------------*/
+#if MTARCH_DIRECT_SWITCH
+/* PSP field of the running thread. It comes first in struct mtarch_thread. */
+static uint32_t *running_psp __attribute__ ((__used__));
+/*----------------------------------------------------------------------------*/
+/*
+ * A new thread starts here, with the function to call in R5 and its argument
+ * in R4, and returns to mt_exit().
+ */
+__attribute__ ((__naked__))
+static void
+thread_entry(void)
+{
+  __asm__ ("mov r0, r4\n\t"
+           "ldr lr, =mt_exit\n\t"
+           "bx r5");
+}
+/*----------------------------------------------------------------------------*/
+void
+mtarch_init(void)
+{
+}
+/*----------------------------------------------------------------------------*/
+void
+mtarch_start(struct mtarch_thread *thread,
+             void (*function)(void *data), void *data)
+{
+  /* Frame popped by mtarch_exec(): R3-R11 and the return address. */
+  uint32_t *frame = &thread->stack[MTARCH_STACKSIZE - 10];
+
+  stack_check_paint(thread->stack, sizeof(thread->stack));
+  frame[1] = (uint32_t)data;
+  frame[2] = (uint32_t)function;
+  frame[9] = (uint32_t)thread_entry;
+  thread->psp = (uint32_t)frame;
+}
+/*----------------------------------------------------------------------------*/
+/*
+ * Save the main thread context to the main stack, make the thread stack the
+ * current one by selecting the PSP, and restore the thread context from it.
+ * Ten registers are saved so that the stacks stay 8-byte aligned.
+ */
+__attribute__ ((__naked__))
+void
+mtarch_exec(struct mtarch_thread *thread)
+{
+  __asm__ ("push {r3-r11, lr}\n\t"
+           "ldr r1, =running_psp\n\t"
+           "str r0, [r1]\n\t"
+           "ldr r0, [r0]\n\t"
+           "msr psp, r0\n\t"
+           "movs r0, #2\n\t"
+           "msr control, r0\n\t"
+           "isb\n\t"
+           "pop {r3-r11, pc}");
+}
+/*----------------------------------------------------------------------------*/
+/*
+ * Save the thread context to the thread stack, select the main stack again
+ * and return from the mtarch_exec() that started the thread.
+ */
+__attribute__ ((__naked__))
+void
+mtarch_yield(void)
+{
+  __asm__ ("push {r3-r11, lr}\n\t"
+           "ldr r1, =running_psp\n\t"
+           "ldr r1, [r1]\n\t"
+           "mov r0, sp\n\t"
+           "str r0, [r1]\n\t"
+           "movs r0, #0\n\t"
+           "msr control, r0\n\t"
+           "isb\n\t"
+           "pop {r3-r11, pc}");
+}
+/*----------------------------------------------------------------------------*/
+void
+mtarch_stop(struct mtarch_thread *thread)
+{
+}
+/*----------------------------------------------------------------------------*/
+void
+mtarch_pstart(void)
+{
+}
+#else /* MTARCH_DIRECT_SWITCH */
+/*----------------------------------------------------------------------------*/
 void
 mtarch_init(void)
 {
@@ -226,6 +315,8 @@ mtarch_start(struct mtarch_thread *thread,
 {
   struct mtarch_thread_context *context = &thread->start_stack.context;
 
+  stack_check_paint(thread->stack, sizeof(thread->stack));
+
   /*
    * Initialize the thread context with the appropriate values to call
    * function() with data and to make function() return to mt_exit() without
@@ -270,6 +361,7 @@ mtarch_pstart(void)
   /* Trigger PendSV. */
   SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
 }
+#endif /* MTARCH_DIRECT_SWITCH */
 /*----------------------------------------------------------------------------*/
 void
 mtarch_pstop(void)
@@ -281,5 +373,11 @@ mtarch_remove(void)
 {
 }
 /*----------------------------------------------------------------------------*/
+int
+mtarch_stack_usage(struct mt_thread *t)
+{
+  return stack_check_usage(t->thread.stack, sizeof(t->thread.stack));
+}
+/*----------------------------------------------------------------------------*/
 
 /** @} */
@@ -43,6 +43,11 @@
  * nothing happens. The corresponding task switch takes place when leaving
  * Handler mode. The main Contiki thread then resumes after the call to
  * mt_exec() that yielded to the preempted mt thread.
+ *
+ * With MTARCH_CONF_DIRECT_SWITCH, mt_exec() and mt_yield() switch
+ * stacks directly in Thread mode, which saves the exception entry and
+ * return of each switch, and the preemption described above is not
+ * available.
  * @{
  *
  * \file
@@ -56,6 +61,22 @@
 
 #include <stdint.h>
 
+#ifdef MTARCH_CONF_DIRECT_SWITCH
+/**
+ * Switch threads with plain function calls instead of SVCall. This is
+ * considerably faster, but mtarch_pstart() then has no effect, so
+ * threads can only be left by yielding. Requires ARMv7-M; SVCall and
+ * PendSV are then not used.
+ */
+#define MTARCH_DIRECT_SWITCH MTARCH_CONF_DIRECT_SWITCH
+#else
+#define MTARCH_DIRECT_SWITCH 0
+#endif
+
+#if MTARCH_DIRECT_SWITCH && __ARM_ARCH != 7
+#error MTARCH_CONF_DIRECT_SWITCH requires ARMv7-M
+#endif
+
 #ifndef MTARCH_CONF_STACKSIZE
 /** Thread stack size configuration, expressed as a number of 32-bit words. */
 #define MTARCH_CONF_STACKSIZE   256
@@ -111,6 +132,14 @@ struct mtarch_thread {
   } CC_ALIGN(8);
 };
 
+struct mt_thread;
+
+/**
+ * Get the most stack, in bytes, that a thread has used since it was
+ * started.
+ */
+int mtarch_stack_usage(struct mt_thread *t);
+
 #endif /* MTARCH_H_ */
 
 /**
@@ -134,7 +134,22 @@ cfs_coffee_arch_read(void *buf, unsigned int size, cfs_offset_t offset)
   uint8_t *dst;
 
   watchdog_periodic();
-  for(src = (const void *)(COFFEE_START + offset), dst = buf; size; size--) {
+  src = (const void *)(COFFEE_START + offset);
+  dst = buf;
+
+  /* Copy whole words if the source and destination can be aligned. */
+  if((((uintptr_t)src ^ (uintptr_t)dst) & (FLASH_WORD_SIZE - 1)) == 0) {
+    for(; size && ((uintptr_t)src & (FLASH_WORD_SIZE - 1)); size--) {
+      *dst++ = ~*src++;
+    }
+    for(; size >= FLASH_WORD_SIZE; size -= FLASH_WORD_SIZE) {
+      *(uint32_t *)dst = ~*(const uint32_t *)src;
+      src += FLASH_WORD_SIZE;
+      dst += FLASH_WORD_SIZE;
+    }
+  }
+
+  for(; size; size--) {
     *dst++ = ~*src++;
   }
 }
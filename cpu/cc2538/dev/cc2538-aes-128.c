@@ -41,9 +41,12 @@
 #include "dev/ecb.h"
 #include "dev/cc2538-aes-128.h"
 #include "dev/sys-ctrl.h"
+#include "lpm.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 /*---------------------------------------------------------------------------*/
 #define MODULE_NAME     "cc2538-aes-128"
 
@@ -54,6 +57,32 @@
 #define PRINTF(...)
 #endif
 /*---------------------------------------------------------------------------*/
+/* Copies of the keys loaded in the cached key areas */
+static uint8_t keys[CC2538_AES_128_KEY_CACHE][AES_128_KEY_LENGTH];
+static uint8_t loaded;
+static uint8_t current;
+static uint8_t next;
+/*---------------------------------------------------------------------------*/
+static bool
+permit_pm1(void)
+{
+  /* The key store does not survive PM2/3 */
+  loaded = 0;
+  return true;
+}
+/*---------------------------------------------------------------------------*/
+void
+cc2538_aes_128_flush_keys(void)
+{
+  loaded = 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+cc2538_aes_128_key_area(void)
+{
+  return CC2538_AES_128_KEY_AREA + current;
+}
+/*---------------------------------------------------------------------------*/
 static uint8_t
 enable_crypto(void)
 {
@@ -75,18 +104,37 @@ restore_crypto(uint8_t enabled)
 static void
 set_key(const uint8_t *key)
 {
+  static bool registered;
   uint8_t crypto_enabled, ret;
+  uint8_t i;
+
+  for(i = 0; i < CC2538_AES_128_KEY_CACHE; i++) {
+    if((loaded & (1 << i)) && !memcmp(keys[i], key, AES_128_KEY_LENGTH)) {
+      current = i;
+      return;
+    }
+  }
+
+  if(!registered) {
+    lpm_register_peripheral(permit_pm1);
+    registered = true;
+  }
 
   crypto_enabled = enable_crypto();
 
   ret = aes_load_keys(key, AES_KEY_STORE_SIZE_KEY_SIZE_128, 1,
-                      CC2538_AES_128_KEY_AREA);
+                      CC2538_AES_128_KEY_AREA + next);
   if(ret != CRYPTO_SUCCESS) {
     PRINTF("%s: aes_load_keys() error %u\n", MODULE_NAME, ret);
     sys_ctrl_reset();
   }
 
   restore_crypto(crypto_enabled);
+
+  memcpy(keys[next], key, AES_128_KEY_LENGTH);
+  loaded |= 1 << next;
+  current = next;
+  next = (next + 1) % CC2538_AES_128_KEY_CACHE;
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -97,7 +145,7 @@ encrypt(uint8_t *plaintext_and_result)
 
   crypto_enabled = enable_crypto();
 
-  ret = ecb_crypt_start(true, CC2538_AES_128_KEY_AREA, plaintext_and_result,
+  ret = ecb_crypt_start(true, CC2538_AES_128_KEY_AREA + current, plaintext_and_result,
                         plaintext_and_result, AES_128_BLOCK_SIZE, NULL);
   if(ret != CRYPTO_SUCCESS) {
     PRINTF("%s: ecb_crypt_start() error %u\n", MODULE_NAME, ret);
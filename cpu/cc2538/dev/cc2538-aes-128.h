@@ -52,9 +52,37 @@
 #else
 #define CC2538_AES_128_KEY_AREA         0
 #endif
+
+/*
+ * Number of consecutive key areas, starting at CC2538_AES_128_KEY_AREA, that
+ * keep recently used keys loaded. Setting a key that is still loaded in one
+ * of them skips reloading the key store.
+ */
+#ifdef CC2538_AES_128_CONF_KEY_CACHE
+#define CC2538_AES_128_KEY_CACHE        CC2538_AES_128_CONF_KEY_CACHE
+#else
+#define CC2538_AES_128_KEY_CACHE        1
+#endif
+
+#if CC2538_AES_128_KEY_AREA + CC2538_AES_128_KEY_CACHE > 8
+#error "CC2538_AES_128_KEY_CACHE key areas do not fit into the key store"
+#endif
 /*---------------------------------------------------------------------------*/
 extern const struct aes_128_driver cc2538_aes_128_driver;
 
+/**
+ * \brief Returns the key area holding the current key
+ */
+uint8_t cc2538_aes_128_key_area(void);
+
+/**
+ * \brief Forgets which keys are loaded in the key store
+ *
+ * Must be called by code that loads the key store without going through
+ * cc2538_aes_128_driver, e.g. with keys of another size.
+ */
+void cc2538_aes_128_flush_keys(void);
+
 #endif /* CC2538_AES_128_H_ */
 
 /**
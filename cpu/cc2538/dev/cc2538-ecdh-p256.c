@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \addtogroup cc2538-ecdh-p256
+ * @{
+ *
+ * \file
+ * Implementation of the ECDH P-256 driver for the CC2538 SoC
+ */
+#include "contiki.h"
+#include "dev/ecc-algorithm.h"
+#include "dev/ecc-curve.h"
+#include "dev/pka.h"
+#include "dev/cc2538-ecdh-p256.h"
+
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+/* The engine does one operation at a time, so one state is enough */
+static ecc_multiply_state_t mul_state;
+static uint8_t initialized;
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(multiply(struct ecdh_p256_state *s))
+{
+  PT_BEGIN(&s->pt);
+
+  if(!ecdh_p256_is_valid_scalar(s->scalar) ||
+     !ecdh_p256_is_on_curve(s->x, s->y)) {
+    s->result = ECDH_P256_ERROR;
+    PT_EXIT(&s->pt);
+  }
+
+  if(!initialized) {
+    initialized = 1;
+    pka_init();
+  } else {
+    pka_enable();
+  }
+
+  mul_state.process = s->process;
+  mul_state.curve_info = &nist_p_256;
+  memcpy(mul_state.secret, s->scalar, sizeof(s->scalar));
+  memcpy(mul_state.point_in.x, s->x, sizeof(s->x));
+  memcpy(mul_state.point_in.y, s->y, sizeof(s->y));
+
+  /* The PKA interrupt polls the process when the result is ready */
+  PT_SPAWN(&s->pt, &mul_state.pt, ecc_multiply(&mul_state));
+
+  pka_disable();
+
+  if(mul_state.result != PKA_STATUS_SUCCESS) {
+    s->result = ECDH_P256_ERROR;
+    PT_EXIT(&s->pt);
+  }
+  memcpy(s->x, mul_state.point_out.x, sizeof(s->x));
+  memcpy(s->y, mul_state.point_out.y, sizeof(s->y));
+  s->result = ECDH_P256_OK;
+
+  PT_END(&s->pt);
+}
+/*---------------------------------------------------------------------------*/
+const struct ecdh_p256_driver cc2538_ecdh_p256_driver = {
+  multiply
+};
+
+/** @} */
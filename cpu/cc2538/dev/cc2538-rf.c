@@ -68,6 +68,19 @@
  * if its size is above this threshold
  */
 #define UDMA_RX_SIZE_THRESHOLD 3
+
+/*
+ * With CC2538_RF_CONF_RX_DMA_ASYNC, the driver process does not busy-wait
+ * for the uDMA transfer of a received frame: it yields until the uDMA
+ * completion interrupt polls it. The frame is received in a packetbuf
+ * context of the driver, so that the packetbuf can be used by others
+ * meanwhile. read() returns 0 while such a transfer is in progress.
+ */
+#if defined CC2538_RF_CONF_RX_DMA_ASYNC && CC2538_RF_CONF_RX_USE_DMA
+#define CC2538_RF_RX_DMA_ASYNC CC2538_RF_CONF_RX_DMA_ASYNC
+#else
+#define CC2538_RF_RX_DMA_ASYNC 0
+#endif
 /*---------------------------------------------------------------------------*/
 #include <stdio.h>
 #define DEBUG 0
@@ -80,6 +93,7 @@
 /* Local RF Flags */
 #define RX_ACTIVE     0x80
 #define RF_MUST_RESET 0x40
+#define RX_DMA_ACTIVE 0x20
 #define RF_ON         0x01
 
 /* Bit Masks for the last byte in the RX FIFO */
@@ -116,6 +130,14 @@ static uint8_t crc_corr;
 static uint8_t rf_flags;
 static uint8_t rf_channel = CC2538_RF_CHANNEL;
 
+/* Enabled entries of the source address table, as in SRC{SHORT,EXT}EN */
+static uint32_t src_match_short;
+static uint32_t src_match_ext;
+
+#if CC2538_RF_RX_DMA_ASYNC
+static struct packetbuf_ctx rx_ctx;
+#endif
+
 static int on(void);
 static int off(void);
 /*---------------------------------------------------------------------------*/
@@ -150,6 +172,15 @@ static const output_config_t output_power[] = {
 /*---------------------------------------------------------------------------*/
 PROCESS(cc2538_rf_process, "cc2538 RF driver");
 /*---------------------------------------------------------------------------*/
+#if CC2538_RF_RX_DMA_ASYNC
+/* Called from the uDMA ISR when a transfer on the RX channel completes */
+static void
+rx_dma_done(void)
+{
+  process_poll(&cc2538_rf_process);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* CC2538_RF_RX_DMA_ASYNC */
 /**
  * \brief Get the current operating channel
  * \return Returns a value in [11,26] representing the current channel
@@ -368,10 +399,189 @@ set_auto_ack(uint8_t enable)
   }
 }
 /*---------------------------------------------------------------------------*/
-static uint32_t
+static void
+set_auto_pend(uint8_t enable)
+{
+  if(enable) {
+    REG(RFCORE_XREG_SRCMATCH) = RFCORE_XREG_SRCMATCH_SRC_MATCH_EN
+      | RFCORE_XREG_SRCMATCH_AUTOPEND;
+  } else {
+    REG(RFCORE_XREG_SRCMATCH) = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Writes a 24-bit mask to three consecutive 8-bit registers */
+static void
+write_mask24(uint32_t reg, uint32_t mask)
+{
+  REG(reg) = mask & 0xFF;
+  REG(reg + 4) = (mask >> 8) & 0xFF;
+  REG(reg + 8) = (mask >> 16) & 0xFF;
+}
+/*---------------------------------------------------------------------------*/
+static void
+src_match_commit(void)
+{
+  /* All sources in the table get the frame pending bit */
+  write_mask24(RFCORE_XREG_SRCSHORTEN0, src_match_short);
+  write_mask24(RFCORE_FFSM_SRCSHORTPENDEN0, src_match_short);
+  write_mask24(RFCORE_XREG_SRCEXTEN0, src_match_ext);
+  write_mask24(RFCORE_FFSM_SRCEXTPENDEN0, src_match_ext);
+}
+/*---------------------------------------------------------------------------*/
+/* Compares table bytes from offset with the address, given LSB first */
+static int
+src_match_cmp(int offset, const uint8_t *addr, int len)
+{
+  int i;
+
+  for(i = 0; i < len; i++) {
+    if((REG(RFCORE_FFSM_SRC_ADDR_TABLE + 4 * (offset + i)) & 0xFF) != addr[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Looks for a source, given as an entry of the table. Returns the entry
+ * number, or -1
+ */
+static int
+src_match_find(const uint8_t *entry, int len)
+{
+  int n;
+
+  if(len == 4) {
+    for(n = 0; n < RFCORE_FFSM_SRC_ADDR_SHORT_ENTRIES; n++) {
+      if((src_match_short & (1UL << n)) && src_match_cmp(4 * n, entry, 4)) {
+        return n;
+      }
+    }
+  } else {
+    for(n = 0; n < RFCORE_FFSM_SRC_ADDR_EXT_ENTRIES; n++) {
+      if((src_match_ext & (1UL << (2 * n))) && src_match_cmp(8 * n, entry, 8)) {
+        return n;
+      }
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Converts an address in linkaddr_t byte order into a table entry */
+static int
+src_match_entry(uint8_t *entry, const uint8_t *addr, size_t size)
+{
+  uint16_t pan;
+  int i;
+
+  if(size == 2) {
+    pan = get_pan_id();
+    entry[0] = pan & 0xFF;
+    entry[1] = pan >> 8;
+    entry[2] = addr[1];
+    entry[3] = addr[0];
+    return 4;
+  }
+  if(size == 8) {
+    for(i = 0; i < 8; i++) {
+      entry[i] = addr[7 - i];
+    }
+    return 8;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+src_match_add(const uint8_t *addr, size_t size)
+{
+  uint8_t entry[8];
+  uint32_t used;
+  int len;
+  int n;
+  int i;
+
+  len = src_match_entry(entry, addr, size);
+  if(len == 0) {
+    return RADIO_RESULT_INVALID_VALUE;
+  }
+  if(src_match_find(entry, len) >= 0) {
+    return RADIO_RESULT_OK;
+  }
+
+  /* Each bit of used covers four bytes of the table */
+  used = src_match_short | src_match_ext | (src_match_ext << 1);
+
+  for(n = 0; n < RFCORE_FFSM_SRC_ADDR_SHORT_ENTRIES * 4 / len; n++) {
+    if(len == 4 && !(used & (1UL << n))) {
+      src_match_short |= 1UL << n;
+      break;
+    }
+    if(len == 8 && !(used & (3UL << (2 * n)))) {
+      src_match_ext |= 1UL << (2 * n);
+      break;
+    }
+  }
+  if(n == RFCORE_FFSM_SRC_ADDR_SHORT_ENTRIES * 4 / len) {
+    return RADIO_RESULT_ERROR;
+  }
+
+  for(i = 0; i < len; i++) {
+    REG(RFCORE_FFSM_SRC_ADDR_TABLE + 4 * (len * n + i)) = entry[i];
+  }
+  src_match_commit();
+
+  return RADIO_RESULT_OK;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+src_match_remove(const uint8_t *addr, size_t size)
+{
+  uint8_t entry[8];
+  int len;
+  int n;
+
+  if(addr == NULL) {
+    if(size != 0) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    src_match_short = 0;
+    src_match_ext = 0;
+    src_match_commit();
+    return RADIO_RESULT_OK;
+  }
+
+  len = src_match_entry(entry, addr, size);
+  if(len == 0) {
+    return RADIO_RESULT_INVALID_VALUE;
+  }
+
+  n = src_match_find(entry, len);
+  if(n >= 0) {
+    if(len == 4) {
+      src_match_short &= ~(1UL << n);
+    } else {
+      src_match_ext &= ~(1UL << (2 * n));
+    }
+    src_match_commit();
+  }
+
+  return RADIO_RESULT_OK;
+}
+/*---------------------------------------------------------------------------*/
+static rtimer_clock_t
 get_sfd_timestamp(void)
 {
   uint64_t sfd, timer_val, buffer;
+  rtimer_clock_t now, edge;
+
+  /*
+   * Latch the MAC timer right after an rtimer tick, so that the two
+   * timers are read at the same instant. Otherwise the result carries
+   * a random phase error of up to one rtimer tick.
+   */
+  now = RTIMER_NOW();
+  while((edge = RTIMER_NOW()) == now);
 
   REG(RFCORE_SFR_MTMSEL) = (REG(RFCORE_SFR_MTMSEL) & ~RFCORE_SFR_MTMSEL_MTMSEL) | 0x00000000;
   REG(RFCORE_SFR_MTCTRL) |= RFCORE_SFR_MTCTRL_LATCH_MODE;
@@ -393,7 +603,8 @@ get_sfd_timestamp(void)
   buffer = REG(RFCORE_SFR_MTMOVF2) & RFCORE_SFR_MTMOVF2_MTMOVF2;
   sfd |= (buffer << 32);
 
-  return RTIMER_NOW() - RADIO_TO_RTIMER(timer_val - sfd);
+  /* Round to the nearest rtimer tick */
+  return edge - RADIO_TO_RTIMER(timer_val - sfd + SYS_CTRL_32MHZ / RTIMER_ARCH_SECOND / 2);
 }
 /*---------------------------------------------------------------------------*/
 /* Netstack API radio driver functions */
@@ -538,6 +749,11 @@ init(void)
      * each transfer
      */
     udma_set_channel_src(CC2538_RF_CONF_RX_DMA_CHAN, RFCORE_SFR_RFDATA);
+
+#if CC2538_RF_RX_DMA_ASYNC
+    packetbuf_ctx_init(&rx_ctx);
+    udma_set_channel_callback(CC2538_RF_CONF_RX_DMA_CHAN, rx_dma_done);
+#endif
   }
 
   set_poll_mode(poll_mode);
@@ -680,14 +896,13 @@ send(const void *payload, unsigned short payload_len)
   return transmit(payload_len);
 }
 /*---------------------------------------------------------------------------*/
+/* Reads the length of the frame in the RX FIFO. Returns the length of
+   the frame without the checksum, or 0 if the FIFO was flushed. */
 static int
-read(void *buf, unsigned short bufsize)
+read_length(unsigned short bufsize)
 {
-  uint8_t i;
   uint8_t len;
 
-  PRINTF("RF: Read\n");
-
   if((REG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_FIFOP) == 0) {
     return 0;
   }
@@ -723,36 +938,45 @@ read(void *buf, unsigned short bufsize)
 
   /* If we reach here, chances are the FIFO is holding a valid frame */
   PRINTF("RF: read (0x%02x bytes) = ", len);
-  len -= CHECKSUM_LEN;
-
-  /* Don't bother with uDMA for short frames (e.g. ACKs) */
-  if(CC2538_RF_CONF_RX_USE_DMA && len > UDMA_RX_SIZE_THRESHOLD) {
-    PRINTF("<uDMA payload>");
-
-    /* Set the transfer destination's end address */
-    udma_set_channel_dst(CC2538_RF_CONF_RX_DMA_CHAN,
-                         (uint32_t)(buf) + len - 1);
+  return len - CHECKSUM_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_payload(void *buf, uint8_t len)
+{
+  uint8_t i;
 
-    /* Configure the control word */
-    udma_set_channel_control_word(CC2538_RF_CONF_RX_DMA_CHAN,
-                                  UDMA_RX_FLAGS | udma_xfer_size(len));
+  for(i = 0; i < len; ++i) {
+    ((unsigned char *)(buf))[i] = REG(RFCORE_SFR_RFDATA);
+    PRINTF("%02x", ((unsigned char *)(buf))[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+rx_dma_start(void *buf, uint8_t len)
+{
+  PRINTF("<uDMA payload>");
 
-    /* Enabled the RF RX uDMA channel */
-    udma_channel_enable(CC2538_RF_CONF_RX_DMA_CHAN);
+  /* Set the transfer destination's end address */
+  udma_set_channel_dst(CC2538_RF_CONF_RX_DMA_CHAN,
+                       (uint32_t)(buf) + len - 1);
 
-    /* Trigger the uDMA transfer */
-    udma_channel_sw_request(CC2538_RF_CONF_RX_DMA_CHAN);
+  /* Configure the control word */
+  udma_set_channel_control_word(CC2538_RF_CONF_RX_DMA_CHAN,
+                                UDMA_RX_FLAGS | udma_xfer_size(len));
 
-    /* Wait for the transfer to complete. */
-    while(udma_channel_get_mode(CC2538_RF_CONF_RX_DMA_CHAN));
-  } else {
-    for(i = 0; i < len; ++i) {
-      ((unsigned char *)(buf))[i] = REG(RFCORE_SFR_RFDATA);
-      PRINTF("%02x", ((unsigned char *)(buf))[i]);
-    }
-  }
+  /* Enabled the RF RX uDMA channel */
+  udma_channel_enable(CC2538_RF_CONF_RX_DMA_CHAN);
 
-  /* Read the RSSI and CRC/Corr bytes */
+  /* Trigger the uDMA transfer */
+  udma_channel_sw_request(CC2538_RF_CONF_RX_DMA_CHAN);
+}
+/*---------------------------------------------------------------------------*/
+/* Reads the RSSI and CRC/Corr bytes that follow the payload. Returns 1
+   if the CRC is OK. */
+static int
+read_footer(void)
+{
   rssi = ((int8_t)REG(RFCORE_SFR_RFDATA)) - RSSI_OFFSET;
   crc_corr = REG(RFCORE_SFR_RFDATA);
 
@@ -781,6 +1005,40 @@ read(void *buf, unsigned short bufsize)
     }
   }
 
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+read(void *buf, unsigned short bufsize)
+{
+  uint8_t len;
+
+  PRINTF("RF: Read\n");
+
+  if(rf_flags & RX_DMA_ACTIVE) {
+    /* The driver process is reading a frame out of the FIFO */
+    return 0;
+  }
+
+  len = read_length(bufsize);
+  if(len == 0) {
+    return 0;
+  }
+
+  /* Don't bother with uDMA for short frames (e.g. ACKs) */
+  if(CC2538_RF_CONF_RX_USE_DMA && len > UDMA_RX_SIZE_THRESHOLD) {
+    rx_dma_start(buf, len);
+
+    /* Wait for the transfer to complete. */
+    while(udma_channel_get_mode(CC2538_RF_CONF_RX_DMA_CHAN));
+  } else {
+    read_payload(buf, len);
+  }
+
+  if(!read_footer()) {
+    return 0;
+  }
+
   return len;
 }
 /*---------------------------------------------------------------------------*/
@@ -840,6 +1098,9 @@ get_value(radio_param_t param, radio_value_t *value)
     if(poll_mode) {
       *value |= RADIO_RX_MODE_POLL_MODE;
     }
+    if(REG(RFCORE_XREG_SRCMATCH) & RFCORE_XREG_SRCMATCH_AUTOPEND) {
+      *value |= RADIO_RX_MODE_AUTOPEND;
+    }
     return RADIO_RESULT_OK;
   case RADIO_PARAM_TX_MODE:
     *value = 0;
@@ -874,6 +1135,10 @@ get_value(radio_param_t param, radio_value_t *value)
   case RADIO_CONST_TXPOWER_MAX:
     *value = OUTPUT_POWER_MAX;
     return RADIO_RESULT_OK;
+  case RADIO_CONST_TX_PRELOAD:
+    /* The TX and RX FIFOs are separate */
+    *value = 1;
+    return RADIO_RESULT_OK;
   default:
     return RADIO_RESULT_NOT_SUPPORTED;
   }
@@ -911,13 +1176,15 @@ set_value(radio_param_t param, radio_value_t value)
   case RADIO_PARAM_RX_MODE:
     if(value & ~(RADIO_RX_MODE_ADDRESS_FILTER |
                  RADIO_RX_MODE_AUTOACK |
-                 RADIO_RX_MODE_POLL_MODE)) {
+                 RADIO_RX_MODE_POLL_MODE |
+                 RADIO_RX_MODE_AUTOPEND)) {
       return RADIO_RESULT_INVALID_VALUE;
     }
 
     set_frame_filtering((value & RADIO_RX_MODE_ADDRESS_FILTER) != 0);
     set_auto_ack((value & RADIO_RX_MODE_AUTOACK) != 0);
     set_poll_mode((value & RADIO_RX_MODE_POLL_MODE) != 0);
+    set_auto_pend((value & RADIO_RX_MODE_AUTOPEND) != 0);
 
     return RADIO_RESULT_OK;
   case RADIO_PARAM_TX_MODE:
@@ -987,6 +1254,18 @@ set_object(radio_param_t param, const void *src, size_t size)
 
     return RADIO_RESULT_OK;
   }
+
+  if(param == RADIO_PARAM_SRC_MATCH_ADD) {
+    if(!src) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    return src_match_add(src, size);
+  }
+
+  if(param == RADIO_PARAM_SRC_MATCH_REMOVE) {
+    return src_match_remove(src, size);
+  }
+
   return RADIO_RESULT_NOT_SUPPORTED;
 }
 /*---------------------------------------------------------------------------*/
@@ -1019,7 +1298,13 @@ const struct radio_driver cc2538_rf_driver = {
  */
 PROCESS_THREAD(cc2538_rf_process, ev, data)
 {
+#if CC2538_RF_RX_DMA_ASYNC
+  static int len;
+  static uint8_t *buf;
+  struct packetbuf_ctx *prev;
+#else /* CC2538_RF_RX_DMA_ASYNC */
   int len;
+#endif /* CC2538_RF_RX_DMA_ASYNC */
   PROCESS_BEGIN();
 
   while(1) {
@@ -1027,6 +1312,32 @@ PROCESS_THREAD(cc2538_rf_process, ev, data)
     PROCESS_YIELD_UNTIL((!poll_mode || (poll_mode && (rf_flags & RF_MUST_RESET))) && (ev == PROCESS_EVENT_POLL));
 
     if(!poll_mode) {
+#if CC2538_RF_RX_DMA_ASYNC
+      prev = packetbuf_ctx_select(&rx_ctx);
+      packetbuf_clear();
+      buf = packetbuf_dataptr();
+      len = read_length(PACKETBUF_SIZE);
+      if(len > UDMA_RX_SIZE_THRESHOLD) {
+        packetbuf_ctx_select(prev);
+        rf_flags |= RX_DMA_ACTIVE;
+        rx_dma_start(buf, len);
+
+        /* Let other processes run until the transfer is complete */
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL &&
+                                 !udma_channel_get_mode(CC2538_RF_CONF_RX_DMA_CHAN));
+        rf_flags &= ~RX_DMA_ACTIVE;
+        prev = packetbuf_ctx_select(&rx_ctx);
+      } else if(len > 0) {
+        read_payload(buf, len);
+      }
+
+      if(len > 0 && read_footer()) {
+        packetbuf_set_datalen(len);
+
+        NETSTACK_RDC.input();
+      }
+      packetbuf_ctx_select(prev);
+#else /* CC2538_RF_RX_DMA_ASYNC */
       packetbuf_clear();
       len = read(packetbuf_dataptr(), PACKETBUF_SIZE);
 
@@ -1035,6 +1346,7 @@ PROCESS_THREAD(cc2538_rf_process, ev, data)
 
         NETSTACK_RDC.input();
       }
+#endif /* CC2538_RF_RX_DMA_ASYNC */
     }
 
     /* If we were polled due to an RF error, reset the transceiver */
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \addtogroup cc2538-sha-256
+ * @{
+ *
+ * \file
+ *         Implementation of the SHA-256 driver for the CC2538 SoC
+ */
+#include "contiki.h"
+#include "dev/sha256.h"
+#include "dev/cc2538-sha-256.h"
+#include "dev/sys-ctrl.h"
+#include "lib/assert.h"
+
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+#define MODULE_NAME     "cc2538-sha-256"
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+/*---------------------------------------------------------------------------*/
+/* Set SHA_256_CONF_CONTEXT_SIZE to at least sizeof(sha256_state_t) */
+CTASSERT(sizeof(sha256_state_t) <= SHA_256_CONTEXT_SIZE);
+
+#define STATE(ctx) ((sha256_state_t *)&(ctx)->state)
+/*---------------------------------------------------------------------------*/
+static uint8_t
+enable_crypto(void)
+{
+  uint8_t enabled = CRYPTO_IS_ENABLED();
+  if(!enabled) {
+    crypto_enable();
+  }
+  return enabled;
+}
+/*---------------------------------------------------------------------------*/
+static void
+restore_crypto(uint8_t enabled)
+{
+  if(!enabled) {
+    crypto_disable();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(struct sha_256_context *ctx)
+{
+  sha256_init(STATE(ctx));
+}
+/*---------------------------------------------------------------------------*/
+static void
+update(struct sha_256_context *ctx, const uint8_t *data, uint16_t len)
+{
+  uint8_t crypto_enabled, ret;
+
+  crypto_enabled = enable_crypto();
+  ret = sha256_process(STATE(ctx), data, len);
+  restore_crypto(crypto_enabled);
+
+  if(ret != CRYPTO_SUCCESS) {
+    PRINTF("%s: sha256_process() error %u\n", MODULE_NAME, ret);
+    sys_ctrl_reset();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+finalize(struct sha_256_context *ctx, uint8_t digest[SHA_256_DIGEST_LENGTH])
+{
+  uint8_t crypto_enabled, ret;
+
+  crypto_enabled = enable_crypto();
+  ret = sha256_done(STATE(ctx), digest);
+  restore_crypto(crypto_enabled);
+
+  if(ret != CRYPTO_SUCCESS) {
+    PRINTF("%s: sha256_done() error %u\n", MODULE_NAME, ret);
+    sys_ctrl_reset();
+  }
+}
+/*---------------------------------------------------------------------------*/
+const struct sha_256_driver cc2538_sha_256_driver = {
+  init,
+  update,
+  finalize
+};
+
+/** @} */
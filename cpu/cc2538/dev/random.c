@@ -48,8 +48,27 @@
 #include "dev/cc2538-rf.h"
 #include "dev/soc-adc.h"
 #include "dev/sys-ctrl.h"
+#include "lib/random.h"
 #include "reg.h"
 /*---------------------------------------------------------------------------*/
+#if RANDOM_XOROSHIRO
+static uint16_t until_reseed;
+#endif /* RANDOM_XOROSHIRO */
+/*---------------------------------------------------------------------------*/
+/* Reads 16 bits of noise from IF_ADC, which are only random in RX */
+static unsigned short
+rf_noise(void)
+{
+  int i;
+  unsigned short s = 0;
+
+  for(i = 0; i < 16; i++) {
+    s |= (REG(RFCORE_XREG_RFRND) & RFCORE_XREG_RFRND_IRND);
+    s <<= 1;
+  }
+  return s;
+}
+/*---------------------------------------------------------------------------*/
 /**
  * \brief      Generates a new random number using the cc2538 RNG.
  * \return     The random number.
@@ -59,6 +78,18 @@ random_rand(void)
 {
   uint32_t rv;
 
+#if RANDOM_XOROSHIRO
+  /*
+   * Mixing in noise while the radio is not in RX adds nothing, but does
+   * no harm either
+   */
+  if(until_reseed-- == 0) {
+    until_reseed = RANDOM_RESEED_INTERVAL - 1;
+    random_xoroshiro_mix(rf_noise());
+  }
+  return random_xoroshiro_rand();
+#endif /* RANDOM_XOROSHIRO */
+
   /* Clock the RNG LSFR once */
   REG(SOC_ADC_ADCCON1) |= SOC_ADC_ADCCON1_RCTRL0;
 
@@ -83,7 +114,6 @@ random_rand(void)
 void
 random_init(unsigned short seed)
 {
-  int i;
   unsigned short s = 0;
 
   /* Make sure the RNG is on */
@@ -116,12 +146,15 @@ random_init(unsigned short seed)
    * Invalid seeds are 0x0000 and 0x8003 and should not be used.
    */
   while(s == 0x0000 || s == 0x8003) {
-    for(i = 0; i < 16; i++) {
-      s |= (REG(RFCORE_XREG_RFRND) & RFCORE_XREG_RFRND_IRND);
-      s <<= 1;
-    }
+    s = rf_noise();
   }
 
+#if RANDOM_XOROSHIRO
+  random_xoroshiro_seed(((uint32_t)rf_noise() << 16) | rf_noise());
+  random_xoroshiro_mix(s);
+  until_reseed = RANDOM_RESEED_INTERVAL - 1;
+#endif /* RANDOM_XOROSHIRO */
+
   /* High byte first */
   REG(SOC_ADC_RNDL) = (s >> 8) & 0x00FF;
   REG(SOC_ADC_RNDL) = s & 0xFF;
@@ -130,6 +163,56 @@ random_init(unsigned short seed)
   CC2538_RF_CSP_ISRFOFF();
 }
 
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Fills buf with true random bytes from the RF receive path.
+ * \param buf  Where to store the bytes
+ * \param len  The number of bytes to generate
+ * \return     1 on success, 0 if the radio could not be put in RX
+ *
+ *             Unlike random_rand(), this is meant for key material. The
+ *             IF_ADC bits are von Neumann-debiased, and the radio is
+ *             briefly put in RX if it is off.
+ */
+int
+cc2538_random_bytes(uint8_t *buf, unsigned len)
+{
+  int was_off;
+  unsigned i;
+  unsigned n;
+  uint8_t a;
+  uint8_t b;
+  uint8_t byte;
+
+  was_off = (REG(RFCORE_XREG_FSMSTAT0)
+             & RFCORE_XREG_FSMSTAT0_FSM_FFCTRL_STATE) == 0;
+  if(was_off) {
+    if(REG(SYS_CTRL_RCGCRFC) != 1) {
+      return 0;
+    }
+    CC2538_RF_CSP_ISRXON();
+  }
+  while(!(REG(RFCORE_XREG_RSSISTAT) & RFCORE_XREG_RSSISTAT_RSSI_VALID));
+
+  for(i = 0; i < len; i++) {
+    byte = 0;
+    for(n = 0; n < 8;) {
+      a = REG(RFCORE_XREG_RFRND) & RFCORE_XREG_RFRND_IRND;
+      b = REG(RFCORE_XREG_RFRND) & RFCORE_XREG_RFRND_IRND;
+      if(a != b) {
+        byte = (byte << 1) | a;
+        n++;
+      }
+    }
+    buf[i] = byte;
+  }
+
+  if(was_off) {
+    CC2538_RF_CSP_ISRFOFF();
+  }
+  return 1;
+}
+
 /**
  * @}
  * @}
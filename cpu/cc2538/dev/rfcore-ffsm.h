@@ -65,6 +65,18 @@
 #define RFCORE_FFSM_SHORT_ADDR1     0x400885D4 /**< Local address information */
 /** @} */
 /*---------------------------------------------------------------------------*/
+/** \name RF Core source address table
+ *
+ * 96 bytes, one per 32-bit word. Holds 24 short entries (PAN ID and short
+ * address, 4 bytes each) or 12 extended entries (8 bytes each); extended
+ * entry n occupies the same bytes as short entries 2n and 2n + 1
+ * @{
+ */
+#define RFCORE_FFSM_SRC_ADDR_TABLE  0x40088400 /**< Source address table */
+#define RFCORE_FFSM_SRC_ADDR_SHORT_ENTRIES 24  /**< Short entries */
+#define RFCORE_FFSM_SRC_ADDR_EXT_ENTRIES   12  /**< Extended entries */
+/** @} */
+/*---------------------------------------------------------------------------*/
 /** \name RFCORE_FFSM_SRCRESMASK[0:2] register bit masks
  * @{
  */
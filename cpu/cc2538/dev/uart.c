@@ -41,6 +41,7 @@
 #include "dev/ioc.h"
 #include "dev/gpio.h"
 #include "dev/uart.h"
+#include "dev/udma.h"
 #include "lpm.h"
 #include "reg.h"
 
@@ -131,6 +132,15 @@
     UART1_RTS_PORT < 0  && UART1_RTS_PIN >= 0
 #error Both UART1_RTS_PORT and UART1_RTS_PIN must be valid or invalid
 #endif
+
+#if UART0_DMA && UART0_TX_DMA_CHAN > UDMA_CONF_MAX_CHANNEL || \
+    UART1_DMA && UART1_TX_DMA_CHAN > UDMA_CONF_MAX_CHANNEL
+#error UDMA_CONF_MAX_CHANNEL does not cover the UART uDMA channels
+#endif
+
+#if UART_DMA_RX_BUFSIZE > 1024
+#error UART_DMA_RX_BUFSIZE cannot exceed the uDMA transfer size of 1024
+#endif
 /*---------------------------------------------------------------------------*/
 /*
  * Baud rate defines used in uart_init() to set the values of UART_IBRD and
@@ -165,6 +175,11 @@ typedef struct {
   uart_pad_t cts;
   uart_pad_t rts;
   uint8_t nvic_int;
+  uint8_t dma;
+  uint8_t rx_dma_chan;
+  uint8_t tx_dma_chan;
+  uint8_t rx_dma_enc;
+  uint8_t tx_dma_enc;
 } uart_regs_t;
 /*---------------------------------------------------------------------------*/
 static const uart_regs_t uart_regs[UART_INSTANCE_COUNT] = {
@@ -181,7 +196,12 @@ static const uart_regs_t uart_regs[UART_INSTANCE_COUNT] = {
     .tx = {UART0_TX_PORT, UART0_TX_PIN},
     .cts = {-1, -1},
     .rts = {-1, -1},
-    .nvic_int = UART0_IRQn
+    .nvic_int = UART0_IRQn,
+    .dma = UART0_DMA,
+    .rx_dma_chan = UART0_RX_DMA_CHAN,
+    .tx_dma_chan = UART0_TX_DMA_CHAN,
+    .rx_dma_enc = UDMA_CH8_UART0RX,
+    .tx_dma_enc = UDMA_CH9_UART0TX
   }, {
     .sys_ctrl_rcgcuart_uart = SYS_CTRL_RCGCUART_UART1,
     .sys_ctrl_scgcuart_uart = SYS_CTRL_SCGCUART_UART1,
@@ -195,10 +215,105 @@ static const uart_regs_t uart_regs[UART_INSTANCE_COUNT] = {
     .tx = {UART1_TX_PORT, UART1_TX_PIN},
     .cts = {UART1_CTS_PORT, UART1_CTS_PIN},
     .rts = {UART1_RTS_PORT, UART1_RTS_PIN},
-    .nvic_int = UART1_IRQn
+    .nvic_int = UART1_IRQn,
+    .dma = UART1_DMA,
+    .rx_dma_chan = UART1_RX_DMA_CHAN,
+    .tx_dma_chan = UART1_TX_DMA_CHAN,
+    .rx_dma_enc = UDMA_CH22_UART1RX,
+    .tx_dma_enc = UDMA_CH23_UART1TX
   }
 };
 static int (* input_handler[UART_INSTANCE_COUNT])(unsigned char c);
+static int (* input_bytes_handler[UART_INSTANCE_COUNT])(const unsigned char *,
+                                                        int);
+/*---------------------------------------------------------------------------*/
+#if UART0_DMA || UART1_DMA
+/*
+ * RX buffers, only for the UARTs that use the uDMA. UART1 takes the second
+ * one if UART0 also has one.
+ */
+static struct {
+  uint8_t buf[UART_DMA_RX_BUFSIZE];
+  uint16_t read;
+} dma_rx[UART0_DMA + UART1_DMA];
+
+#define DMA_RX(u) (&dma_rx[(u) & UART0_DMA])
+#endif
+/*---------------------------------------------------------------------------*/
+static void
+deliver(uint8_t uart, const uint8_t *data, int len)
+{
+  if(input_bytes_handler[uart] != NULL) {
+    input_bytes_handler[uart](data, len);
+  } else if(input_handler[uart] != NULL) {
+    while(len-- > 0) {
+      input_handler[uart](*data++);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if UART0_DMA || UART1_DMA
+static void
+rx_dma_arm(uint8_t uart)
+{
+  const uart_regs_t *regs = &uart_regs[uart];
+
+  udma_set_channel_dst(regs->rx_dma_chan,
+                       (uint32_t)&DMA_RX(uart)->buf[UART_DMA_RX_BUFSIZE - 1]);
+  udma_set_channel_control_word(regs->rx_dma_chan,
+                                UDMA_CHCTL_DSTINC_8 | UDMA_CHCTL_DSTSIZE_8 |
+                                UDMA_CHCTL_SRCINC_NONE | UDMA_CHCTL_SRCSIZE_8 |
+                                UDMA_CHCTL_ARBSIZE_4 |
+                                udma_xfer_size(UART_DMA_RX_BUFSIZE) |
+                                UDMA_CHCTL_XFERMODE_BASIC);
+  DMA_RX(uart)->read = 0;
+  udma_channel_enable(regs->rx_dma_chan);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+rx_dma_collect(uint8_t uart)
+{
+  uint16_t written;
+
+  written = UART_DMA_RX_BUFSIZE -
+    udma_channel_get_remaining(uart_regs[uart].rx_dma_chan);
+
+  if(written > DMA_RX(uart)->read) {
+    deliver(uart, &DMA_RX(uart)->buf[DMA_RX(uart)->read],
+            written - DMA_RX(uart)->read);
+    DMA_RX(uart)->read = written;
+  }
+
+  if(written == UART_DMA_RX_BUFSIZE) {
+    rx_dma_arm(uart);
+  }
+
+  return written;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * The RX channel only serves burst requests, which the UART raises when its
+ * FIFO is half full. Moving 4 bytes per burst always leaves some in the FIFO,
+ * so the receive time-out fires once the line goes idle. We then let the
+ * channel serve single requests until the FIFO is empty, so the tail of the
+ * frame also lands in the buffer in order, and hand everything over.
+ */
+static void
+rx_dma_isr(uint8_t uart)
+{
+  const uart_regs_t *regs = &uart_regs[uart];
+
+  udma_channel_use_single(regs->rx_dma_chan);
+  while(!(REG(regs->base + UART_FR) & UART_FR_RXFE)) {
+    if(udma_channel_get_mode(regs->rx_dma_chan) == UDMA_CHCTL_XFERMODE_STOP) {
+      rx_dma_collect(uart);
+    }
+  }
+  udma_channel_use_burst(regs->rx_dma_chan);
+
+  rx_dma_collect(uart);
+}
+#endif /* UART0_DMA || UART1_DMA */
 /*---------------------------------------------------------------------------*/
 static void
 reset(uint32_t uart_base)
@@ -233,6 +348,10 @@ permit_pm1(void)
     if((REG(regs->base + UART_FR) & UART_FR_BUSY) != 0) {
       return false;
     }
+    if(regs->dma && udma_channel_get_mode(regs->tx_dma_chan) !=
+       UDMA_CHCTL_XFERMODE_STOP) {
+      return false;
+    }
   }
 
   return true;
@@ -289,12 +408,24 @@ uart_init(uint8_t uart)
    * UART Interrupt Masks:
    * Acknowledge RX and RX Timeout
    * Acknowledge Framing, Overrun and Break Errors
+   *
+   * With the uDMA, RX FIFO levels are handled by the RX channel and only the
+   * time-out is of interest
    */
-  REG(regs->base + UART_IM) = UART_IM_RXIM | UART_IM_RTIM;
+  if(regs->dma) {
+    REG(regs->base + UART_IM) = UART_IM_RTIM;
+  } else {
+    REG(regs->base + UART_IM) = UART_IM_RXIM | UART_IM_RTIM;
+  }
   REG(regs->base + UART_IM) |= UART_IM_OEIM | UART_IM_BEIM | UART_IM_FEIM;
 
-  REG(regs->base + UART_IFLS) =
-    UART_IFLS_RXIFLSEL_1_8 | UART_IFLS_TXIFLSEL_1_2;
+  if(regs->dma) {
+    REG(regs->base + UART_IFLS) =
+      UART_IFLS_RXIFLSEL_1_2 | UART_IFLS_TXIFLSEL_1_2;
+  } else {
+    REG(regs->base + UART_IFLS) =
+      UART_IFLS_RXIFLSEL_1_8 | UART_IFLS_TXIFLSEL_1_2;
+  }
 
   /* Make sure the UART is disabled before trying to configure it */
   REG(regs->base + UART_CTL) = UART_CTL_VALUE;
@@ -324,6 +455,20 @@ uart_init(uint8_t uart)
     REG(UART_1_BASE + UART_CTL) |= UART_CTL_RTSEN;
   }
 
+#if UART0_DMA || UART1_DMA
+  if(regs->dma) {
+    udma_set_channel_assignment(regs->rx_dma_chan, regs->rx_dma_enc);
+    udma_set_channel_assignment(regs->tx_dma_chan, regs->tx_dma_enc);
+    udma_channel_mask_clr(regs->rx_dma_chan);
+    udma_channel_mask_clr(regs->tx_dma_chan);
+    udma_set_channel_src(regs->rx_dma_chan, regs->base + UART_DR);
+    udma_set_channel_dst(regs->tx_dma_chan, regs->base + UART_DR);
+    udma_channel_use_burst(regs->rx_dma_chan);
+    rx_dma_arm(uart);
+    REG(regs->base + UART_DMACTL) = UART_DMACTL_RXDMAE | UART_DMACTL_TXDMAE;
+  }
+#endif
+
   /* UART Enable */
   REG(regs->base + UART_CTL) |= UART_CTL_UARTEN;
 
@@ -342,6 +487,65 @@ uart_set_input(uint8_t uart, int (* input)(unsigned char c))
 }
 /*---------------------------------------------------------------------------*/
 void
+uart_set_input_bytes(uint8_t uart,
+                     int (* input)(const unsigned char *data, int len))
+{
+  if(uart >= UART_INSTANCE_COUNT) {
+    return;
+  }
+
+  input_bytes_handler[uart] = input;
+}
+/*---------------------------------------------------------------------------*/
+bool
+uart_write_busy(uint8_t uart)
+{
+  if(uart >= UART_INSTANCE_COUNT || !uart_regs[uart].dma) {
+    return false;
+  }
+
+  return udma_channel_get_mode(uart_regs[uart].tx_dma_chan) !=
+         UDMA_CHCTL_XFERMODE_STOP;
+}
+/*---------------------------------------------------------------------------*/
+void
+uart_write_bytes(uint8_t uart, const uint8_t *data, uint16_t len)
+{
+  const uart_regs_t *regs;
+  uint16_t n;
+
+  if(uart >= UART_INSTANCE_COUNT) {
+    return;
+  }
+  regs = &uart_regs[uart];
+
+  if(!regs->dma) {
+    while(len-- > 0) {
+      uart_write_byte(uart, *data++);
+    }
+    return;
+  }
+
+  while(len > 0) {
+    n = len > 1024 ? 1024 : len;
+
+    while(uart_write_busy(uart));
+
+    udma_set_channel_src(regs->tx_dma_chan, (uint32_t)&data[n - 1]);
+    udma_set_channel_control_word(regs->tx_dma_chan,
+                                  UDMA_CHCTL_DSTINC_NONE |
+                                  UDMA_CHCTL_DSTSIZE_8 | UDMA_CHCTL_SRCINC_8 |
+                                  UDMA_CHCTL_SRCSIZE_8 | UDMA_CHCTL_ARBSIZE_4 |
+                                  udma_xfer_size(n) |
+                                  UDMA_CHCTL_XFERMODE_BASIC);
+    udma_channel_enable(regs->tx_dma_chan);
+
+    data += n;
+    len -= n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
 uart_write_byte(uint8_t uart, uint8_t b)
 {
   uint32_t uart_base;
@@ -351,6 +555,9 @@ uart_write_byte(uint8_t uart, uint8_t b)
   }
   uart_base = uart_regs[uart].base;
 
+  /* Keep the order with a block that the uDMA is still sending */
+  while(uart_write_busy(uart));
+
   /* Block if the TX FIFO is full */
   while(REG(uart_base + UART_FR) & UART_FR_TXFF);
 
@@ -362,6 +569,8 @@ uart_isr(uint8_t uart)
 {
   uint32_t uart_base;
   uint16_t mis;
+  uint8_t fifo[16];
+  uint8_t n;
 
   ENERGEST_ON(ENERGEST_TYPE_IRQ);
 
@@ -373,15 +582,29 @@ uart_isr(uint8_t uart)
 
   REG(uart_base + UART_ICR) = 0x0000FFBF;
 
+#if UART0_DMA || UART1_DMA
+  if(uart_regs[uart].dma) {
+    /* Completed channels raise this interrupt too */
+    REG(UDMA_CHIS) = (1UL << uart_regs[uart].rx_dma_chan) |
+      (1UL << uart_regs[uart].tx_dma_chan);
+
+    if((mis & UART_MIS_RTMIS) || udma_channel_get_mode(
+         uart_regs[uart].rx_dma_chan) == UDMA_CHCTL_XFERMODE_STOP) {
+      rx_dma_isr(uart);
+      mis &= ~UART_MIS_RTMIS;
+    }
+  }
+#endif
+
   if(mis & (UART_MIS_RXMIS | UART_MIS_RTMIS)) {
     while(!(REG(uart_base + UART_FR) & UART_FR_RXFE)) {
-      if(input_handler[uart] != NULL) {
-        input_handler[uart]((unsigned char)(REG(uart_base + UART_DR) & 0xFF));
-      } else {
-        /* To prevent an Overrun Error, we need to flush the FIFO even if we
-         * don't have an input_handler. Use mis as a data trash can */
-        mis = REG(uart_base + UART_DR);
+      /* To prevent an Overrun Error, we need to flush the FIFO even if we
+       * don't have an input handler */
+      for(n = 0; n < sizeof(fifo) &&
+            !(REG(uart_base + UART_FR) & UART_FR_RXFE); n++) {
+        fifo[n] = REG(uart_base + UART_DR) & 0xFF;
       }
+      deliver(uart, fifo, n);
     }
   } else if(mis & (UART_MIS_OEMIS | UART_MIS_BEMIS | UART_MIS_FEMIS)) {
     /* ISR triggered due to some error condition */
@@ -45,6 +45,7 @@
 
 #include "contiki.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 /*---------------------------------------------------------------------------*/
 /** \name UART instance count
@@ -53,6 +54,45 @@
 #define UART_INSTANCE_COUNT   2
 /** @} */
 /*---------------------------------------------------------------------------*/
+/** \name UART uDMA configuration
+ *
+ * Setting UART0_CONF_DMA or UART1_CONF_DMA to 1 makes the driver move that
+ * UART's data with the uDMA instead of taking an interrupt per byte. Received
+ * bytes are collected in a buffer of UART_CONF_DMA_RX_BUFSIZE bytes and
+ * handed over in blocks when the line has been idle for 32 bit periods, or
+ * when the buffer is full. uart_write_bytes() transmits in the background.
+ *
+ * UART0 uses uDMA channels 8 and 9, UART1 channels 22 and 23, so
+ * UDMA_CONF_MAX_CHANNEL must cover them.
+ * @{
+ */
+#ifdef UART0_CONF_DMA
+#define UART0_DMA             UART0_CONF_DMA
+#else
+#define UART0_DMA             0
+#endif
+
+#ifdef UART1_CONF_DMA
+#define UART1_DMA             UART1_CONF_DMA
+#else
+#define UART1_DMA             0
+#endif
+
+/** \brief Non-zero if UART \e u uses the uDMA. Usable in \#if */
+#define UART_DMA(u)           ((u) == 0 ? UART0_DMA : UART1_DMA)
+
+#ifdef UART_CONF_DMA_RX_BUFSIZE
+#define UART_DMA_RX_BUFSIZE   UART_CONF_DMA_RX_BUFSIZE
+#else
+#define UART_DMA_RX_BUFSIZE   128
+#endif
+
+#define UART0_RX_DMA_CHAN     8
+#define UART0_TX_DMA_CHAN     9
+#define UART1_RX_DMA_CHAN     22
+#define UART1_TX_DMA_CHAN     23
+/** @} */
+/*---------------------------------------------------------------------------*/
 /** \name UART base addresses
  * @{
  */
@@ -350,6 +390,35 @@ void uart_write_byte(uint8_t uart, uint8_t b);
  */
 void uart_set_input(uint8_t uart, int (* input)(unsigned char c));
 
+/** \brief Assigns a callback to be called with blocks of received bytes
+ * \param uart The UART instance to use (0 to \c UART_INSTANCE_COUNT - 1)
+ * \param input A pointer to the function, or NULL
+ *
+ * When set, this takes precedence over the handler set with
+ * uart_set_input(). It is called from the UART interrupt with everything
+ * that has arrived since the previous call, which saves a function call
+ * per byte at high baud rates.
+ */
+void uart_set_input_bytes(uint8_t uart,
+                          int (* input)(const unsigned char *data, int len));
+
+/** \brief Sends a block of data down the UART
+ * \param uart The UART instance to use (0 to \c UART_INSTANCE_COUNT - 1)
+ * \param data The data to transmit
+ * \param len The number of bytes
+ *
+ * On a UART that uses the uDMA this returns as soon as the transfer has been
+ * started, and \e data must not be modified until uart_write_busy() returns
+ * false. Otherwise it blocks like uart_write_byte().
+ */
+void uart_write_bytes(uint8_t uart, const uint8_t *data, uint16_t len);
+
+/** \brief Checks for a uart_write_bytes() transfer still in progress
+ * \param uart The UART instance to use (0 to \c UART_INSTANCE_COUNT - 1)
+ * \return true if the uDMA is still feeding the TX FIFO
+ */
+bool uart_write_busy(uint8_t uart);
+
 /** @} */
 
 #endif /* UART_H_ */
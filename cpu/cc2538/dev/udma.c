@@ -52,6 +52,8 @@ struct channel_ctrl {
 
 static volatile struct channel_ctrl channel_config[UDMA_CONF_MAX_CHANNEL + 1]
   __attribute__ ((section(".udma_channel_control_table")));
+
+static void (*channel_callback[UDMA_CONF_MAX_CHANNEL + 1])(void);
 /*---------------------------------------------------------------------------*/
 void
 udma_init()
@@ -110,7 +112,7 @@ udma_set_channel_assignment(uint8_t channel, uint8_t enc)
   base_chmap += (channel >> 3) * 4;
 
   /* Calculate the shift value for the correct CHMAP register bits */
-  shift = (channel & 0x07);
+  shift = (channel & 0x07) << 2;
 
   /* Read CHMAPx value, zero out channel's bits and write the new value */
   REG(base_chmap) = (REG(base_chmap) & ~(0x0F << shift)) | (enc << shift);
@@ -241,11 +243,48 @@ udma_channel_get_mode(uint8_t channel)
   return (channel_config[channel].ctrl_word & 0x07);
 }
 /*---------------------------------------------------------------------------*/
+uint16_t
+udma_channel_get_remaining(uint8_t channel)
+{
+  uint32_t ctrl;
+
+  if(channel > UDMA_CONF_MAX_CHANNEL) {
+    return 0;
+  }
+
+  ctrl = channel_config[channel].ctrl_word;
+  if((ctrl & 0x07) == UDMA_CHCTL_XFERMODE_STOP) {
+    return 0;
+  }
+
+  return ((ctrl & UDMA_CHCTL_XFERSIZE) >> 4) + 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+udma_set_channel_callback(uint8_t channel, void (*callback)(void))
+{
+  if(channel > UDMA_CONF_MAX_CHANNEL) {
+    return;
+  }
+
+  channel_callback[channel] = callback;
+}
+/*---------------------------------------------------------------------------*/
 void
 udma_isr()
 {
-  /* Simply clear Channel interrupt status for now */
-  REG(UDMA_CHIS) = UDMA_CHIS_CHIS;
+  uint32_t status;
+  uint8_t i;
+
+  /* Clear the Channel interrupt status and notify the channels' owners */
+  status = REG(UDMA_CHIS);
+  REG(UDMA_CHIS) = status;
+
+  for(i = 0; i <= UDMA_CONF_MAX_CHANNEL; i++) {
+    if((status & (1UL << i)) && channel_callback[i] != NULL) {
+      channel_callback[i]();
+    }
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
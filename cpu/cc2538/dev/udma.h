@@ -539,6 +539,8 @@
 #define UDMA_CHCTL_ARBSIZE_512  0x00024000  /**< Arbitration size 512 Transfers */
 #define UDMA_CHCTL_ARBSIZE_1024 0x00028000  /**< Arbitration size 1024 Transfers */
 
+#define UDMA_CHCTL_XFERSIZE     0x00003FF0  /**< Transfer size (items - 1) */
+
 #define UDMA_CHCTL_XFERMODE_STOP     0x00000000  /**< Stop */
 #define UDMA_CHCTL_XFERMODE_BASIC    0x00000001  /**< Basic */
 #define UDMA_CHCTL_XFERMODE_AUTO     0x00000002  /**< Auto-Request */
@@ -685,6 +687,26 @@ void udma_channel_sw_request(uint8_t channel);
  */
 uint8_t udma_channel_get_mode(uint8_t channel);
 
+/**
+ * \brief Retrieve the number of items a channel has yet to transfer
+ * \param channel The channel as a value in [0 , UDMA_CONF_MAX_CHANNEL]
+ * \return The number of outstanding items, 0 if the channel has stopped
+ *
+ * The uDMA decrements the xfersize field as it goes, so this can be used to
+ * find out how far a peripheral-triggered transfer has progressed.
+ */
+uint16_t udma_channel_get_remaining(uint8_t channel);
+
+/**
+ * \brief Register a function to be called when a transfer completes
+ * \param channel The channel as a value in [0 , UDMA_CONF_MAX_CHANNEL]
+ * \param callback The function, or NULL to unregister
+ *
+ * The callback is called from the uDMA interrupt, which is raised on the
+ * completion of software-triggered transfers.
+ */
+void udma_set_channel_callback(uint8_t channel, void (*callback)(void));
+
 /**
  * \brief Calculate the value of the xfersize field in the control structure
  * \param len The number of items to be transferred
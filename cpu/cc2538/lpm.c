@@ -38,6 +38,7 @@
 #include "contiki-conf.h"
 #include "sys/energest.h"
 #include "sys/process.h"
+#include "sys/tickless.h"
 #include "dev/sys-ctrl.h"
 #include "dev/rfcore-xreg.h"
 #include "rtimer-arch.h"
@@ -262,10 +263,12 @@ lpm_enter()
    * Registered peripherals were off. Radio was off: Some Duty Cycling in place.
    * rtimers run on the Sleep Timer. Thus, if we have a scheduled rtimer
    * task, a Sleep Timer interrupt will fire and will wake us up.
-   * Choose the most suitable PM based on anticipated deep sleep duration
+   * Choose the most suitable PM based on anticipated deep sleep duration.
+   * Only the Sleep Timer can wake us from PM1/2, so the duration is also
+   * capped by the next etimer deadline, which would otherwise be missed.
    */
   lpm_exit_time = rtimer_arch_next_trigger();
-  duration = lpm_exit_time - RTIMER_NOW();
+  duration = tickless_idle_time(lpm_exit_time - RTIMER_NOW());
 
   if(duration < DEEP_SLEEP_PM1_THRESHOLD || lpm_exit_time == 0) {
     /* Anticipated duration too short or no scheduled rtimer task. Use PM0 */
@@ -284,7 +287,7 @@ lpm_enter()
    * Switching the System Clock from the 32MHz XOSC to the 16MHz RC OSC may
    * have taken a while. Re-estimate sleep duration.
    */
-  duration = lpm_exit_time - RTIMER_NOW();
+  duration = tickless_idle_time(lpm_exit_time - RTIMER_NOW());
 
   if(duration < DEEP_SLEEP_PM1_THRESHOLD) {
     /*
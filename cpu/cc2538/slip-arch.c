@@ -37,6 +37,10 @@
  *
  * SLIP can be configured to operate over UART or over USB-Serial, depending
  * on the value of SLIP_ARCH_CONF_USB
+ *
+ * If the SLIP UART uses the uDMA (UARTn_CONF_DMA), outgoing frames are
+ * collected in two buffers of SLIP_ARCH_CONF_DMA_TX_BUFSIZE bytes, so that
+ * one can be filled while the uDMA sends the other
  */
 #include "contiki-conf.h"
 #include "dev/slip.h"
@@ -49,16 +53,52 @@
 
 #if SLIP_ARCH_CONF_USB
 #define write_byte(b) usb_serial_writeb(b)
-#define set_input(f)  usb_serial_set_input(f)
+#define set_input()   usb_serial_set_input(slip_input_byte)
 #define flush()       usb_serial_flush()
+#elif UART_DMA(SLIP_ARCH_CONF_UART)
+#define write_byte(b) tx_write_byte(b)
+#define set_input()   uart_set_input_bytes(SLIP_ARCH_CONF_UART, slip_input_bytes)
+#define flush()       tx_flush()
 #else
 #define write_byte(b) uart_write_byte(SLIP_ARCH_CONF_UART, b)
-#define set_input(f)  uart_set_input(SLIP_ARCH_CONF_UART, f)
+#define set_input()   uart_set_input_bytes(SLIP_ARCH_CONF_UART, slip_input_bytes)
 #define flush()
 #endif
 
 #define SLIP_END     0300
 /*---------------------------------------------------------------------------*/
+#if !SLIP_ARCH_CONF_USB && UART_DMA(SLIP_ARCH_CONF_UART)
+#ifdef SLIP_ARCH_CONF_DMA_TX_BUFSIZE
+#define DMA_TX_BUFSIZE SLIP_ARCH_CONF_DMA_TX_BUFSIZE
+#else
+#define DMA_TX_BUFSIZE 64
+#endif
+
+static uint8_t txbuf[2][DMA_TX_BUFSIZE];
+static uint16_t txlen;
+static uint8_t txcur;
+/*---------------------------------------------------------------------------*/
+static void
+tx_flush(void)
+{
+  if(txlen > 0) {
+    /* This waits for the other buffer to be sent before starting this one */
+    uart_write_bytes(SLIP_ARCH_CONF_UART, txbuf[txcur], txlen);
+    txcur ^= 1;
+    txlen = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tx_write_byte(uint8_t b)
+{
+  txbuf[txcur][txlen++] = b;
+  if(txlen == DMA_TX_BUFSIZE) {
+    tx_flush();
+  }
+}
+#endif
+/*---------------------------------------------------------------------------*/
 /**
  * \brief Write a byte over SLIP
  * \param c the byte
@@ -79,7 +119,7 @@ slip_arch_writeb(unsigned char c)
 void
 slip_arch_init(unsigned long ubr)
 {
-  set_input(slip_input_byte);
+  set_input();
 }
 /*---------------------------------------------------------------------------*/
 
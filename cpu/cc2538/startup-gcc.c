@@ -41,6 +41,7 @@
 #include "flash.h"
 #include "sys-ctrl.h"
 #include "rom-util.h"
+#include "sys/stack-check.h"
 
 #include <stdint.h>
 /*---------------------------------------------------------------------------*/
@@ -106,6 +107,9 @@ void uart1_isr(void);
 /*---------------------------------------------------------------------------*/
 /* Allocate stack space */
 static uint64_t stack[256] __attribute__ ((section(".stack")));
+#if STACK_CHECK_MAIN
+static struct stack_check main_stack;
+#endif
 /*---------------------------------------------------------------------------*/
 __attribute__((__section__(".vectors")))
 void(*const vectors[])(void) =
@@ -319,6 +323,11 @@ reset_handler(void)
   /* Zero-fill the bss segment. */
   rom_util_memset(&_bss, 0, &_ebss - &_bss);
 
+#if STACK_CHECK_MAIN
+  /* Paint the stack below the reset handler's own frame */
+  stack_check_add(&main_stack, "main", stack, sizeof(stack));
+#endif
+
   /* call the application's entry point. */
   main();
 
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup cc26xx-aes-128
+ * @{
+ *
+ * \file
+ * Implementation of the AES-128 driver for the CC13xx/CC26xx
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "lpm.h"
+#include "ti-lib.h"
+#include "dev/cc26xx-aes-128.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+/* The crypto engine needs word-aligned buffers */
+static uint32_t key_copy[AES_128_KEY_LENGTH / sizeof(uint32_t)];
+static uint32_t block[AES_128_BLOCK_SIZE / sizeof(uint32_t)];
+/* Set if key_copy is loaded into the key store */
+static bool key_loaded;
+static bool registered;
+/*---------------------------------------------------------------------------*/
+static void
+wakeup(void)
+{
+  /* The key store loses its contents when the PERIPH PD is turned off */
+  key_loaded = false;
+}
+/*---------------------------------------------------------------------------*/
+LPM_MODULE(aes_module, NULL, NULL, wakeup, LPM_DOMAIN_NONE);
+/*---------------------------------------------------------------------------*/
+static void
+power_up(void)
+{
+  ti_lib_rom_prcm_power_domain_on(PRCM_DOMAIN_PERIPH);
+  while((ti_lib_rom_prcm_power_domain_status(PRCM_DOMAIN_PERIPH)
+         != PRCM_DOMAIN_POWER_ON));
+
+  ti_lib_rom_prcm_peripheral_run_enable(PRCM_PERIPH_CRYPTO);
+  ti_lib_prcm_load_set();
+  while(!ti_lib_prcm_load_get());
+}
+/*---------------------------------------------------------------------------*/
+static void
+load_key(void)
+{
+  power_up();
+  if(ti_lib_crypto_aes_load_key(key_copy, CC26XX_AES_128_KEY_AREA)
+     == AES_SUCCESS) {
+    key_loaded = true;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_key(const uint8_t *key)
+{
+  if(!registered) {
+    lpm_register_module(&aes_module);
+    registered = true;
+  }
+  memcpy(key_copy, key, AES_128_KEY_LENGTH);
+  load_key();
+}
+/*---------------------------------------------------------------------------*/
+static void
+encrypt(uint8_t *plaintext_and_result)
+{
+  if(!key_loaded) {
+    load_key();
+  }
+
+  memcpy(block, plaintext_and_result, AES_128_BLOCK_SIZE);
+  if(ti_lib_crypto_aes_ecb(block, block, CC26XX_AES_128_KEY_AREA,
+                           true, false) != AES_SUCCESS) {
+    return;
+  }
+  while(ti_lib_crypto_aes_ecb_status() == AES_DMA_BSY);
+  ti_lib_crypto_aes_ecb_finish();
+  memcpy(plaintext_and_result, block, AES_128_BLOCK_SIZE);
+}
+/*---------------------------------------------------------------------------*/
+const struct aes_128_driver cc26xx_aes_128_driver = {
+  set_key,
+  encrypt
+};
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -63,6 +63,9 @@
 #define cc26xx_uart_isr UART0IntHandler
 /*---------------------------------------------------------------------------*/
 static int (*input_handler)(unsigned char c);
+static int (*input_bytes_handler)(const unsigned char *data, int len);
+
+#define rx_wanted() (input_handler != NULL || input_bytes_handler != NULL)
 /*---------------------------------------------------------------------------*/
 static bool
 usable_rx(void)
@@ -146,7 +149,7 @@ enable_interrupts(void)
   ti_lib_uart_int_clear(UART0_BASE, CC26XX_UART_INTERRUPT_ALL);
 
   /* Enable RX-related interrupts only if we have an input handler */
-  if(input_handler) {
+  if(rx_wanted()) {
     /* Configure which interrupts to generate: FIFO level or after RX timeout */
     ti_lib_uart_int_enable(UART0_BASE, CC26XX_UART_RX_INTERRUPT_TRIGGERS);
 
@@ -188,7 +191,7 @@ configure(void)
   /* Enable FIFOs */
   HWREG(UART0_BASE + UART_O_LCRH) |= UART_LCRH_FEN;
 
-  if(input_handler) {
+  if(rx_wanted()) {
     ctl_val += UART_CTL_RXE;
   }
 
@@ -217,7 +220,7 @@ lpm_drop_handler(uint8_t mode)
    * capability. Thus, if this is not a shutdown notification and we have an
    * input handler, we do nothing
    */
-  if((mode != LPM_MODE_SHUTDOWN) && (input_handler != NULL)) {
+  if((mode != LPM_MODE_SHUTDOWN) && rx_wanted()) {
     return;
   }
 
@@ -293,6 +296,7 @@ cc26xx_uart_init()
 
   /* Only TX and EN to start with. RX will be enabled only if needed */
   input_handler = NULL;
+  input_bytes_handler = NULL;
 
   /*
    * init() won't actually fire up the UART. We turn it on only when (and if)
@@ -320,17 +324,15 @@ cc26xx_uart_write_byte(uint8_t c)
   ti_lib_uart_char_put(UART0_BASE, c);
 }
 /*---------------------------------------------------------------------------*/
-void
-cc26xx_uart_set_input(int (*input)(unsigned char c))
+static void
+set_rx(void)
 {
-  input_handler = input;
-
   /* Return early if disabled by user conf or if ports are misconfigured */
   if(usable_rx() == false) {
     return;
   }
 
-  if(input == NULL) {
+  if(!rx_wanted()) {
     /* Let the SERIAL PD power down */
     uart_module.domain_lock = LPM_DOMAIN_NONE;
 
@@ -354,6 +356,20 @@ cc26xx_uart_set_input(int (*input)(unsigned char c))
   return;
 }
 /*---------------------------------------------------------------------------*/
+void
+cc26xx_uart_set_input(int (*input)(unsigned char c))
+{
+  input_handler = input;
+  set_rx();
+}
+/*---------------------------------------------------------------------------*/
+void
+cc26xx_uart_set_input_bytes(int (*input)(const unsigned char *data, int len))
+{
+  input_bytes_handler = input;
+  set_rx();
+}
+/*---------------------------------------------------------------------------*/
 uint8_t
 cc26xx_uart_busy(void)
 {
@@ -373,8 +389,9 @@ cc26xx_uart_busy(void)
 void
 cc26xx_uart_isr(void)
 {
-  char the_char;
+  unsigned char fifo[32];
   uint32_t flags;
+  int n, i;
 
   ENERGEST_ON(ENERGEST_TYPE_IRQ);
 
@@ -392,10 +409,17 @@ cc26xx_uart_isr(void)
      * RX FIFO.
      */
     while(ti_lib_uart_chars_avail(UART0_BASE)) {
-      the_char = ti_lib_uart_char_get_non_blocking(UART0_BASE);
+      for(n = 0; n < sizeof(fifo) && ti_lib_uart_chars_avail(UART0_BASE);
+          n++) {
+        fifo[n] = ti_lib_uart_char_get_non_blocking(UART0_BASE);
+      }
 
-      if(input_handler != NULL) {
-        input_handler((unsigned char)the_char);
+      if(input_bytes_handler != NULL) {
+        input_bytes_handler(fifo, n);
+      } else if(input_handler != NULL) {
+        for(i = 0; i < n; i++) {
+          input_handler(fifo[i]);
+        }
       }
     }
   }
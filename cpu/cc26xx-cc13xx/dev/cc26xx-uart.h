@@ -78,6 +78,18 @@ void cc26xx_uart_write_byte(uint8_t b);
  */
 void cc26xx_uart_set_input(int (*input)(unsigned char c));
 
+/**
+ * \brief Assigns a callback to be called with blocks of received bytes
+ * \param input A pointer to the function
+ *
+ * This behaves like cc26xx_uart_set_input(), but the callback is called once
+ * per RX interrupt with everything read out of the RX FIFO, instead of once
+ * per byte. If both callbacks are set, this one is used. RX stays enabled
+ * as long as either of them is set.
+ */
+void cc26xx_uart_set_input_bytes(int (*input)(const unsigned char *data,
+                                              int len));
+
 /**
  * \brief Returns the UART busy status
  * \return UART_IDLE or UART_BUSY
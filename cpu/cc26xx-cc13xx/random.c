@@ -39,6 +39,11 @@
 /*---------------------------------------------------------------------------*/
 #include "contiki.h"
 #include "dev/soc-trng.h"
+#include "lib/random.h"
+/*---------------------------------------------------------------------------*/
+#if RANDOM_XOROSHIRO
+static uint16_t until_reseed;
+#endif /* RANDOM_XOROSHIRO */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Generates a new random number using the hardware TRNG.
@@ -47,7 +52,15 @@
 unsigned short
 random_rand(void)
 {
+#if RANDOM_XOROSHIRO
+  if(until_reseed-- == 0) {
+    until_reseed = RANDOM_RESEED_INTERVAL - 1;
+    random_xoroshiro_mix((uint32_t)soc_trng_rand_synchronous());
+  }
+  return random_xoroshiro_rand();
+#else /* RANDOM_XOROSHIRO */
   return (unsigned short)soc_trng_rand_synchronous() & 0xFFFF;
+#endif /* RANDOM_XOROSHIRO */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -58,6 +71,16 @@ void
 random_init(unsigned short seed)
 {
   soc_trng_init();
+
+#if RANDOM_XOROSHIRO
+  {
+    uint64_t r = soc_trng_rand_synchronous();
+
+    random_xoroshiro_seed((uint32_t)r);
+    random_xoroshiro_mix((uint32_t)(r >> 32));
+    until_reseed = RANDOM_RESEED_INTERVAL - 1;
+  }
+#endif /* RANDOM_XOROSHIRO */
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -103,6 +103,34 @@
 #else
 #define IEEE_MODE_RSSI_THRESHOLD 0xA6
 #endif /* IEEE_MODE_CONF_RSSI_THRESHOLD */
+
+/*
+ * Configuration to let the RF core wait for the ACK of frames that request
+ * one, by chaining a CMD_IEEE_RX_ACK after the CMD_IEEE_TX. transmit() then
+ * returns RADIO_TX_NOACK if none arrives within IEEE_MODE_ACK_WAIT_USEC
+ */
+#ifdef IEEE_MODE_CONF_HW_ACK_WAIT
+#define IEEE_MODE_HW_ACK_WAIT IEEE_MODE_CONF_HW_ACK_WAIT
+#else
+#define IEEE_MODE_HW_ACK_WAIT 0
+#endif /* IEEE_MODE_CONF_HW_ACK_WAIT */
+
+#ifdef IEEE_MODE_CONF_ACK_WAIT_USEC
+#define IEEE_MODE_ACK_WAIT_USEC IEEE_MODE_CONF_ACK_WAIT_USEC
+#else
+#define IEEE_MODE_ACK_WAIT_USEC 864 /* macAckWaitDuration, 54 symbols */
+#endif /* IEEE_MODE_CONF_ACK_WAIT_USEC */
+
+/*
+ * The number of RX data entries. Each holds one frame. The RF core keeps
+ * receiving into free entries while the netstack processes earlier frames,
+ * so routers that see bursts of traffic may want more than the default
+ */
+#ifdef IEEE_MODE_CONF_RX_BUF_COUNT
+#define IEEE_MODE_RX_BUF_COUNT IEEE_MODE_CONF_RX_BUF_COUNT
+#else
+#define IEEE_MODE_RX_BUF_COUNT 4
+#endif /* IEEE_MODE_CONF_RX_BUF_COUNT */
 /*---------------------------------------------------------------------------*/
 #define STATUS_CRC_FAIL     0x80 /* bit 7 */
 #define STATUS_REJECT_FRAME 0x40 /* bit 6 */
@@ -255,11 +283,8 @@ static uint8_t cmd_ieee_rx_buf[RF_CMD_BUFFER_SIZE] CC_ALIGN(4);
 #define DATA_ENTRY_LENSZ_WORD 2 /* 2 bytes */
 
 #define RX_BUF_SIZE 144
-/* Four receive buffers entries with room for 1 IEEE802.15.4 frame in each */
-static uint8_t rx_buf_0[RX_BUF_SIZE] CC_ALIGN(4);
-static uint8_t rx_buf_1[RX_BUF_SIZE] CC_ALIGN(4);
-static uint8_t rx_buf_2[RX_BUF_SIZE] CC_ALIGN(4);
-static uint8_t rx_buf_3[RX_BUF_SIZE] CC_ALIGN(4);
+/* Receive buffer entries with room for 1 IEEE802.15.4 frame in each */
+static uint8_t rx_bufs[IEEE_MODE_RX_BUF_COUNT][RX_BUF_SIZE] CC_ALIGN(4);
 
 /* The RX Data Queue */
 static dataQueue_t rx_data_queue = { 0 };
@@ -272,6 +297,21 @@ volatile static uint8_t *rx_read_entry;
 #define TX_BUF_HDR_LEN       2
 
 static uint8_t tx_buf[TX_BUF_HDR_LEN + TX_BUF_PAYLOAD_LEN] CC_ALIGN(4);
+
+/* Frame control field: acknowledgement request bit, in the first octet */
+#define TX_FCF_ACK_REQ 0x20
+/*---------------------------------------------------------------------------*/
+/*
+ * The TX chain: an optional CMD_IEEE_CSMA doing a single CCA, the
+ * CMD_IEEE_TX and an optional CMD_IEEE_RX_ACK, queued as one request
+ */
+static rfc_CMD_IEEE_CSMA_t csma_cmd CC_ALIGN(4);
+static rfc_CMD_IEEE_TX_t tx_cmd CC_ALIGN(4);
+static rfc_CMD_IEEE_RX_ACK_t rx_ack_cmd CC_ALIGN(4);
+static rf_core_cmd_req_t tx_req;
+
+/* Are we doing CCA before TX? */
+static uint8_t send_on_cca = 0;
 /*---------------------------------------------------------------------------*/
 #ifdef IEEE_MODE_CONF_BOARD_OVERRIDES
 #define IEEE_MODE_BOARD_OVERRIDES IEEE_MODE_CONF_BOARD_OVERRIDES
@@ -559,26 +599,15 @@ static void
 init_rx_buffers(void)
 {
   rfc_dataEntry_t *entry;
+  int i;
 
-  entry = (rfc_dataEntry_t *)rx_buf_0;
-  entry->pNextEntry = rx_buf_1;
-  entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
-  entry->length = sizeof(rx_buf_0) - 8;
-
-  entry = (rfc_dataEntry_t *)rx_buf_1;
-  entry->pNextEntry = rx_buf_2;
-  entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
-  entry->length = sizeof(rx_buf_0) - 8;
-
-  entry = (rfc_dataEntry_t *)rx_buf_2;
-  entry->pNextEntry = rx_buf_3;
-  entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
-  entry->length = sizeof(rx_buf_0) - 8;
-
-  entry = (rfc_dataEntry_t *)rx_buf_3;
-  entry->pNextEntry = rx_buf_0;
-  entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
-  entry->length = sizeof(rx_buf_0) - 8;
+  /* Link the entries into a ring */
+  for(i = 0; i < IEEE_MODE_RX_BUF_COUNT; i++) {
+    entry = (rfc_dataEntry_t *)rx_bufs[i];
+    entry->pNextEntry = rx_bufs[(i + 1) % IEEE_MODE_RX_BUF_COUNT];
+    entry->config.lenSz = DATA_ENTRY_LENSZ_BYTE;
+    entry->length = RX_BUF_SIZE - 8;
+  }
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -848,18 +877,15 @@ init(void)
   rf_core_set_modesel();
 
   /* Initialise RX buffers */
-  memset(rx_buf_0, 0, RX_BUF_SIZE);
-  memset(rx_buf_1, 0, RX_BUF_SIZE);
-  memset(rx_buf_2, 0, RX_BUF_SIZE);
-  memset(rx_buf_3, 0, RX_BUF_SIZE);
+  memset(rx_bufs, 0, sizeof(rx_bufs));
 
   /* Set of RF Core data queue. Circular buffer, no last entry */
-  rx_data_queue.pCurrEntry = rx_buf_0;
+  rx_data_queue.pCurrEntry = rx_bufs[0];
 
   rx_data_queue.pLastEntry = NULL;
 
   /* Initialize current read pointer to first element (used in ISR) */
-  rx_read_entry = rx_buf_0;
+  rx_read_entry = rx_bufs[0];
 
   /* Populate the RF parameters data structure with default values */
   init_rf_params();
@@ -895,11 +921,10 @@ transmit(unsigned short transmit_len)
 {
   int ret;
   uint8_t was_off = 0;
-  uint32_t cmd_status;
   uint16_t stat;
   uint8_t tx_active = 0;
+  uint8_t wait_ack;
   rtimer_clock_t t0;
-  volatile rfc_CMD_IEEE_TX_t cmd;
 
   if(!rf_is_on()) {
     was_off = 1;
@@ -931,54 +956,100 @@ transmit(unsigned short transmit_len)
     return RADIO_TX_COLLISION;
   }
 
-  /* Send the CMD_IEEE_TX command */
-  rf_core_init_radio_op((rfc_radioOp_t *)&cmd, sizeof(cmd), CMD_IEEE_TX);
+  /* Build the chain: [CMD_IEEE_CSMA ->] CMD_IEEE_TX [-> CMD_IEEE_RX_ACK] */
+  rf_core_init_radio_op((rfc_radioOp_t *)&tx_cmd, sizeof(tx_cmd), CMD_IEEE_TX);
+
+  tx_cmd.payloadLen = transmit_len;
+  tx_cmd.pPayload = &tx_buf[TX_BUF_HDR_LEN];
 
-  cmd.payloadLen = transmit_len;
-  cmd.pPayload = &tx_buf[TX_BUF_HDR_LEN];
+  tx_cmd.startTime = 0;
+  tx_cmd.startTrigger.triggerType = TRIG_NOW;
+
+  tx_req.op = (rfc_radioOp_t *)&tx_cmd;
+  tx_req.callback = NULL;
+
+  wait_ack = IEEE_MODE_HW_ACK_WAIT && transmit_len >= 3 &&
+    (tx_buf[TX_BUF_HDR_LEN] & TX_FCF_ACK_REQ);
+
+  if(wait_ack) {
+    rf_core_init_radio_op((rfc_radioOp_t *)&rx_ack_cmd, sizeof(rx_ack_cmd),
+                          CMD_IEEE_RX_ACK);
+
+    rx_ack_cmd.seqNo = tx_buf[TX_BUF_HDR_LEN + 2];
+    rx_ack_cmd.startTrigger.triggerType = TRIG_NOW;
+    rx_ack_cmd.endTrigger.triggerType = TRIG_REL_START;
+    rx_ack_cmd.endTime = USEC_TO_RADIO(IEEE_MODE_ACK_WAIT_USEC);
+
+    tx_cmd.pNextOp = (rfc_radioOp_t *)&rx_ack_cmd;
+    tx_cmd.condition.rule = COND_STOP_ON_FALSE;
+  }
 
-  cmd.startTime = 0;
-  cmd.startTrigger.triggerType = TRIG_NOW;
+  if(send_on_cca) {
+    /* CSMA-CA without backoffs: one CCA, then TX only if clear */
+    rf_core_init_radio_op((rfc_radioOp_t *)&csma_cmd, sizeof(csma_cmd),
+                          CMD_IEEE_CSMA);
 
-  /* Enable the LAST_FG_COMMAND_DONE interrupt, which will wake us up */
-  rf_core_cmd_done_en(true, poll_mode);
+    csma_cmd.randomState = 0;
+    csma_cmd.macMaxBE = 0;
+    csma_cmd.macMaxCSMABackoffs = 0;
+    csma_cmd.csmaConfig.initCW = 1;
+    csma_cmd.csmaConfig.bSlotted = 0;
+    csma_cmd.csmaConfig.rxOffMode = 0;
+    csma_cmd.NB = 0;
+    csma_cmd.BE = 0;
+    csma_cmd.startTrigger.triggerType = TRIG_NOW;
+    csma_cmd.endTrigger.triggerType = TRIG_NEVER;
 
-  ret = rf_core_send_cmd((uint32_t)&cmd, &cmd_status);
+    csma_cmd.pNextOp = (rfc_radioOp_t *)&tx_cmd;
+    csma_cmd.condition.rule = COND_STOP_ON_FALSE;
+
+    tx_req.op = (rfc_radioOp_t *)&csma_cmd;
+  }
+
+  /*
+   * The queue enables the LAST_FG_COMMAND_DONE interrupt, which will wake us
+   * up once the whole chain has run
+   */
+  ret = rf_core_cmd_queue(&tx_req);
 
   if(ret) {
-    /* If we enter here, TX actually started */
+    /* If we enter here, the chain was queued */
     ENERGEST_OFF(ENERGEST_TYPE_LISTEN);
     ENERGEST_ON(ENERGEST_TYPE_TRANSMIT);
 
-    /* Idle away while the command is running */
-    while((cmd.status & RF_CORE_RADIO_OP_MASKED_STATUS)
-          == RF_CORE_RADIO_OP_MASKED_STATUS_RUNNING) {
-      /* Note: for now sleeping while Tx'ing in polling mode is disabled.
-       * To enable it:
-       *  1) make the `lpm_sleep()` call here unconditional;
-       *  2) change the radio ISR priority to allow radio ISR to interrupt rtimer ISR.
-       */
-      if(!poll_mode) {
-        lpm_sleep();
-      }
-    }
+    /*
+     * Idle away while the chain is running.
+     * Note: for now sleeping while Tx'ing in polling mode is disabled.
+     * To enable it:
+     *  1) pass true to `rf_core_cmd_wait()` here unconditionally;
+     *  2) change the radio ISR priority to allow radio ISR to interrupt rtimer ISR.
+     */
+    rf_core_cmd_wait(&tx_req, !poll_mode);
 
-    stat = cmd.status;
+    stat = tx_cmd.status;
 
-    if(stat == RF_CORE_RADIO_OP_STATUS_IEEE_DONE_OK) {
+    if(send_on_cca &&
+       csma_cmd.status == RF_CORE_RADIO_OP_STATUS_IEEE_DONE_BUSY) {
+      /* The CCA found the channel busy, TX did not take place */
+      ret = RADIO_TX_COLLISION;
+    } else if(stat == RF_CORE_RADIO_OP_STATUS_IEEE_DONE_OK) {
       /* Sent OK */
       RIMESTATS_ADD(lltx);
       ret = RADIO_TX_OK;
+
+      if(wait_ack &&
+         rx_ack_cmd.status != RF_CORE_RADIO_OP_STATUS_IEEE_DONE_ACK &&
+         rx_ack_cmd.status != RF_CORE_RADIO_OP_STATUS_IEEE_DONE_ACKPEND) {
+        ret = RADIO_TX_NOACK;
+      }
     } else {
       /* Operation completed, but frame was not sent */
-      PRINTF("transmit: ret=%d, CMDSTA=0x%08lx, status=0x%04x\n", ret,
-             cmd_status, stat);
+      PRINTF("transmit: ret=%d, status=0x%04x\n", ret, stat);
       ret = RADIO_TX_ERR;
     }
   } else {
-    /* Failure sending the CMD_IEEE_TX command */
-    PRINTF("transmit: ret=%d, CMDSTA=0x%08lx, status=0x%04x\n",
-           ret, cmd_status, cmd.status);
+    /* Failure queueing the chain */
+    PRINTF("transmit: ret=%d, status=0x%04x\n", ret, tx_req.status);
 
     ret = RADIO_TX_ERR;
   }
@@ -990,12 +1061,6 @@ transmit(unsigned short transmit_len)
   ENERGEST_OFF(ENERGEST_TYPE_TRANSMIT);
   ENERGEST_ON(ENERGEST_TYPE_LISTEN);
 
-  /*
-   * Disable LAST_FG_COMMAND_DONE interrupt. We don't really care about it
-   * except when we are transmitting
-   */
-  rf_core_cmd_done_dis(poll_mode);
-
   if(was_off) {
     off();
   }
@@ -1295,6 +1360,8 @@ on(void)
 static int
 off(void)
 {
+  int i;
+
   /*
    * If we are in the middle of a BLE operation, we got called by ContikiMAC
    * from within an interrupt context. Abort, but pretend everything is OK.
@@ -1326,17 +1393,10 @@ off(void)
    * Just in case there was an ongoing RX (which started after we begun the
    * shutdown sequence), we don't want to leave the buffer in state == ongoing
    */
-  if(((rfc_dataEntry_t *)rx_buf_0)->status == DATA_ENTRY_STATUS_BUSY) {
-    ((rfc_dataEntry_t *)rx_buf_0)->status = DATA_ENTRY_STATUS_PENDING;
-  }
-  if(((rfc_dataEntry_t *)rx_buf_1)->status == DATA_ENTRY_STATUS_BUSY) {
-    ((rfc_dataEntry_t *)rx_buf_1)->status = DATA_ENTRY_STATUS_PENDING;
-  }
-  if(((rfc_dataEntry_t *)rx_buf_2)->status == DATA_ENTRY_STATUS_BUSY) {
-    ((rfc_dataEntry_t *)rx_buf_2)->status = DATA_ENTRY_STATUS_PENDING;
-  }
-  if(((rfc_dataEntry_t *)rx_buf_3)->status == DATA_ENTRY_STATUS_BUSY) {
-    ((rfc_dataEntry_t *)rx_buf_3)->status = DATA_ENTRY_STATUS_PENDING;
+  for(i = 0; i < IEEE_MODE_RX_BUF_COUNT; i++) {
+    if(((rfc_dataEntry_t *)rx_bufs[i])->status == DATA_ENTRY_STATUS_BUSY) {
+      ((rfc_dataEntry_t *)rx_bufs[i])->status = DATA_ENTRY_STATUS_PENDING;
+    }
   }
 
   return RF_CORE_CMD_OK;
@@ -1346,10 +1406,7 @@ off(void)
 static radio_result_t
 set_send_on_cca(uint8_t enable)
 {
-  if(enable) {
-    /* this driver does not have support for CCA on Tx */
-    return RADIO_RESULT_NOT_SUPPORTED;
-  }
+  send_on_cca = enable ? 1 : 0;
   return RADIO_RESULT_OK;
 }
 /*---------------------------------------------------------------------------*/
@@ -1391,6 +1448,9 @@ get_value(radio_param_t param, radio_value_t *value)
     return RADIO_RESULT_OK;
   case RADIO_PARAM_TX_MODE:
     *value = 0;
+    if(send_on_cca) {
+      *value |= RADIO_TX_MODE_SEND_ON_CCA;
+    }
     return RADIO_RESULT_OK;
   case RADIO_PARAM_TXPOWER:
     *value = get_tx_power();
@@ -219,6 +219,24 @@ const prop_mode_tx_power_config_t *tx_power_current = &TX_POWER_DRIVER[1];
 #define PROP_MODE_RX_BUF_CNT 4
 #endif
 /*---------------------------------------------------------------------------*/
+/*
+ * The largest frame (without FCS) the RX and TX buffers are sized for. By
+ * default this follows SICSLOWPAN_CONF_MAC_MAX_PAYLOAD when that allows
+ * 802.15.4g frames longer than 127 bytes, so that 6LoWPAN does not have to
+ * fragment an IPv6 packet that the PHY could carry in one frame.
+ */
+#ifdef PROP_MODE_CONF_MAX_PAYLOAD_LEN
+#define PROP_MODE_MAX_PAYLOAD_LEN PROP_MODE_CONF_MAX_PAYLOAD_LEN
+#elif defined(SICSLOWPAN_CONF_MAC_MAX_PAYLOAD) && SICSLOWPAN_CONF_MAC_MAX_PAYLOAD > 127
+#define PROP_MODE_MAX_PAYLOAD_LEN SICSLOWPAN_CONF_MAC_MAX_PAYLOAD
+#else
+#define PROP_MODE_MAX_PAYLOAD_LEN 0
+#endif
+
+#if PROP_MODE_MAX_PAYLOAD_LEN > (DOT_4G_MAX_FRAME_LEN - CRC_LEN)
+#error PROP_MODE_MAX_PAYLOAD_LEN does not fit an 802.15.4g frame
+#endif
+/*---------------------------------------------------------------------------*/
 #define DATA_ENTRY_LENSZ_NONE 0
 #define DATA_ENTRY_LENSZ_BYTE 1
 #define DATA_ENTRY_LENSZ_WORD 2 /* 2 bytes */
@@ -228,7 +246,12 @@ const prop_mode_tx_power_config_t *tx_power_current = &TX_POWER_DRIVER[1];
  * PROP_MODE_RX_BUF_CNT buffers of RX_BUF_SIZE bytes each. The start of each
  * buffer must be 4-byte aligned, therefore RX_BUF_SIZE must divide by 4
  */
+#if PROP_MODE_MAX_PAYLOAD_LEN > 125
+/* Entry header (8), length (2), RSSI and status (2), rounded up */
+#define RX_BUF_SIZE ((PROP_MODE_MAX_PAYLOAD_LEN + 15 + 3) & ~3)
+#else
 #define RX_BUF_SIZE 140
+#endif
 static uint8_t rx_buf[PROP_MODE_RX_BUF_CNT][RX_BUF_SIZE] CC_ALIGN(4);
 
 /* The RX Data Queue */
@@ -238,10 +261,17 @@ static dataQueue_t rx_data_queue = { 0 };
 volatile static uint8_t *rx_read_entry;
 /*---------------------------------------------------------------------------*/
 /* The outgoing frame buffer */
+#if PROP_MODE_MAX_PAYLOAD_LEN > 180
+#define TX_BUF_PAYLOAD_LEN PROP_MODE_MAX_PAYLOAD_LEN
+#else
 #define TX_BUF_PAYLOAD_LEN 180
+#endif
 #define TX_BUF_HDR_LEN       2
 
 static uint8_t tx_buf[TX_BUF_HDR_LEN + TX_BUF_PAYLOAD_LEN] CC_ALIGN(4);
+
+/* The request that queues CMD_PROP_TX_ADV */
+static rf_core_cmd_req_t tx_req;
 /*---------------------------------------------------------------------------*/
 static uint8_t
 rf_is_on(void)
@@ -661,7 +691,6 @@ transmit(unsigned short transmit_len)
 {
   int ret;
   uint8_t was_off = 0;
-  uint32_t cmd_status;
   volatile rfc_CMD_PROP_TX_ADV_t *cmd_tx_adv;
 
   /* Length in .15.4g PHY HDR. Includes the CRC but not the HDR itself */
@@ -701,23 +730,21 @@ transmit(unsigned short transmit_len)
   /* Abort RX */
   rx_off_prop();
 
-  /* Enable the LAST_COMMAND_DONE interrupt to wake us up */
-  rf_core_cmd_done_en(false, false);
+  /* The queue enables the LAST_COMMAND_DONE interrupt to wake us up */
+  tx_req.op = (rfc_radioOp_t *)cmd_tx_adv;
+  tx_req.callback = NULL;
 
-  ret = rf_core_send_cmd((uint32_t)cmd_tx_adv, &cmd_status);
+  ret = rf_core_cmd_queue(&tx_req);
 
   if(ret) {
-    /* If we enter here, TX actually started */
+    /* If we enter here, TX was queued */
     ENERGEST_OFF(ENERGEST_TYPE_LISTEN);
     ENERGEST_ON(ENERGEST_TYPE_TRANSMIT);
 
     watchdog_periodic();
 
     /* Idle away while the command is running */
-    while((cmd_tx_adv->status & RF_CORE_RADIO_OP_MASKED_STATUS)
-          == RF_CORE_RADIO_OP_MASKED_STATUS_RUNNING) {
-      lpm_sleep();
-    }
+    rf_core_cmd_wait(&tx_req, true);
 
     if(cmd_tx_adv->status == RF_CORE_RADIO_OP_STATUS_PROP_DONE_OK) {
       /* Sent OK */
@@ -731,8 +758,8 @@ transmit(unsigned short transmit_len)
     }
   } else {
     /* Failure sending the CMD_PROP_TX command */
-    PRINTF("transmit: PROP_TX_ERR ret=%d, CMDSTA=0x%08lx, status=0x%04x\n",
-           ret, cmd_status, cmd_tx_adv->status);
+    PRINTF("transmit: PROP_TX_ERR ret=%d, status=0x%04x\n",
+           ret, cmd_tx_adv->status);
     ret = RADIO_TX_ERR;
   }
 
@@ -743,12 +770,6 @@ transmit(unsigned short transmit_len)
   ENERGEST_OFF(ENERGEST_TYPE_TRANSMIT);
   ENERGEST_ON(ENERGEST_TYPE_LISTEN);
 
-  /*
-   * Disable LAST_FG_COMMAND_DONE interrupt. We don't really care about it
-   * except when we are transmitting
-   */
-  rf_core_cmd_done_dis(false);
-
   /* Workaround. Set status to IDLE */
   cmd_tx_adv->status = RF_CORE_RADIO_OP_STATUS_IDLE;
 
@@ -786,10 +807,13 @@ read_frame(void *buf, unsigned short buf_len)
     data_ptr += 2;
     len -= 2;
 
+    if(len > buf_len) {
+      /* Does not fit the caller's buffer: drop it rather than pass on junk */
+      len = 0;
+    }
+
     if(len > 0) {
-      if(len <= buf_len) {
-        memcpy(buf, data_ptr, len);
-      }
+      memcpy(buf, data_ptr, len);
 
       packetbuf_set_attr(PACKETBUF_ATTR_RSSI, (int8_t)data_ptr[len]);
       packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, 0x7F);
@@ -41,6 +41,8 @@
 #include "sys/process.h"
 #include "sys/energest.h"
 #include "sys/cc.h"
+#include "lib/list.h"
+#include "lpm.h"
 #include "net/netstack.h"
 #include "net/packetbuf.h"
 #include "net/rime/rimestats.h"
@@ -89,6 +91,9 @@
 
 #define ENABLED_IRQS_POLL_MODE (ENABLED_IRQS & ~(RX_FRAME_IRQ | ERROR_IRQ))
 
+/* Interrupts that move the command queue along */
+#define CMD_QUEUE_IRQS (IRQ_LAST_FG_COMMAND_DONE | IRQ_LAST_COMMAND_DONE)
+
 #define cc26xx_rf_cpe0_isr RFCCPE0IntHandler
 #define cc26xx_rf_cpe1_isr RFCCPE1IntHandler
 /*---------------------------------------------------------------------------*/
@@ -103,6 +108,9 @@ static const rf_core_primary_mode_t *primary_mode = NULL;
 /* Radio timer (RAT) offset as compared to the rtimer counter (RTC) */
 int32_t rat_offset = 0;
 static bool rat_offset_known = false;
+
+/* Requests of the asynchronous command queue, the head one is running */
+LIST(cmd_queue);
 /*---------------------------------------------------------------------------*/
 PROCESS(rf_core_process, "CC13xx / CC26xx RF driver");
 /*---------------------------------------------------------------------------*/
@@ -356,6 +364,9 @@ rf_core_power_down()
     fs_powerdown();
   }
 
+  /* Whatever was still queued or running will not complete now */
+  rf_core_cmd_queue_flush();
+
   rf_core_stop_rat();
 
   /* Shut down the RFCORE clock domain in the MCU VD */
@@ -462,7 +473,8 @@ rf_core_setup_interrupts(bool poll_mode)
   HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEISL) = ERROR_IRQ;
 
   /* Acknowledge configured interrupts */
-  HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIEN) = enabled_irqs;
+  HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIEN) = enabled_irqs |
+    (list_head(cmd_queue) != NULL ? CMD_QUEUE_IRQS : 0);
 
   /* Clear interrupt flags, active low clear(?) */
   HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIFG) = 0x0;
@@ -484,14 +496,18 @@ rf_core_cmd_done_en(bool fg, bool poll_mode)
   const uint32_t enabled_irqs = poll_mode ? ENABLED_IRQS_POLL_MODE : ENABLED_IRQS;
 
   HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIFG) = enabled_irqs;
-  HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIEN) = enabled_irqs | irq;
+  HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIEN) = enabled_irqs | irq |
+    (list_head(cmd_queue) != NULL ? CMD_QUEUE_IRQS : 0);
 }
 /*---------------------------------------------------------------------------*/
 void
 rf_core_cmd_done_dis(bool poll_mode)
 {
   const uint32_t enabled_irqs = poll_mode ? ENABLED_IRQS_POLL_MODE : ENABLED_IRQS;
-  HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIEN) = enabled_irqs;
+
+  /* Keep the queue going if it has work */
+  HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIEN) = enabled_irqs |
+    (list_head(cmd_queue) != NULL ? CMD_QUEUE_IRQS : 0);
 }
 /*---------------------------------------------------------------------------*/
 rfc_radioOp_t *
@@ -537,6 +553,158 @@ rf_core_primary_mode_restore()
   return RF_CORE_CMD_ERROR;
 }
 /*---------------------------------------------------------------------------*/
+/* Called with interrupts disabled: the request leaves the queue */
+static void
+cmd_queue_complete(rf_core_cmd_req_t *req)
+{
+  list_remove(cmd_queue, req);
+  req->state = RF_CORE_CMD_REQ_DONE;
+  if(req->callback != NULL) {
+    req->callback(req);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Called with interrupts disabled: submit the head request, if not running */
+static void
+cmd_queue_start(void)
+{
+  rf_core_cmd_req_t *req;
+  rfc_radioOp_t *op;
+  uint32_t cmd_status;
+  int i;
+
+  while((req = list_head(cmd_queue)) != NULL &&
+        req->state == RF_CORE_CMD_REQ_QUEUED) {
+    op = req->op;
+    for(i = 0; op != NULL && i < RF_CORE_CMD_CHAIN_MAX; i++) {
+      op->status = RF_CORE_RADIO_OP_STATUS_IDLE;
+      op = op->pNextOp;
+    }
+
+    req->state = RF_CORE_CMD_REQ_RUNNING;
+    if(rf_core_send_cmd((uint32_t)req->op, &cmd_status) == RF_CORE_CMD_OK) {
+      return;
+    }
+
+    PRINTF("cmd_queue_start: 0x%04x refused, CMDSTA=0x%08lx\n",
+           req->op->commandNo, cmd_status);
+    req->status = RF_CORE_RADIO_OP_STATUS_IDLE;
+    cmd_queue_complete(req);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Called with interrupts disabled: complete the head request if its chain
+ * has finished. The RF core sets a Radio Op's status to PENDING/ACTIVE as
+ * soon as it accepts the chain, and leaves Radio Ops that the conditions
+ * skipped as IDLE.
+ */
+static void
+cmd_queue_progress(void)
+{
+  rf_core_cmd_req_t *req;
+  rfc_radioOp_t *op;
+  uint16_t status;
+  int i;
+
+  req = list_head(cmd_queue);
+  if(req == NULL || req->state != RF_CORE_CMD_REQ_RUNNING ||
+     req->op->status == RF_CORE_RADIO_OP_STATUS_IDLE) {
+    return;
+  }
+
+  status = RF_CORE_RADIO_OP_STATUS_IDLE;
+  op = req->op;
+  for(i = 0; op != NULL && i < RF_CORE_CMD_CHAIN_MAX; i++) {
+    if(op->status != RF_CORE_RADIO_OP_STATUS_IDLE) {
+      if((op->status & RF_CORE_RADIO_OP_MASKED_STATUS) ==
+         RF_CORE_RADIO_OP_MASKED_STATUS_RUNNING &&
+         op->status != RF_CORE_RADIO_OP_STATUS_SKIPPED) {
+        return;
+      }
+      status = op->status;
+    }
+    op = op->pNextOp;
+  }
+
+  req->status = status;
+  cmd_queue_complete(req);
+  cmd_queue_start();
+
+  if(list_head(cmd_queue) == NULL && rf_core_is_accessible()) {
+    HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIEN) &= ~CMD_QUEUE_IRQS;
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint_fast8_t
+rf_core_cmd_queue(rf_core_cmd_req_t *req)
+{
+  bool interrupts_disabled;
+
+  interrupts_disabled = ti_lib_int_master_disable();
+
+  if(!rf_core_is_accessible()) {
+    if(!interrupts_disabled) {
+      ti_lib_int_master_enable();
+    }
+    return RF_CORE_CMD_ERROR;
+  }
+
+  req->state = RF_CORE_CMD_REQ_QUEUED;
+  req->status = RF_CORE_RADIO_OP_STATUS_IDLE;
+  list_add(cmd_queue, req);
+
+  HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIFG) = ~CMD_QUEUE_IRQS;
+  HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIEN) |= CMD_QUEUE_IRQS;
+
+  cmd_queue_start();
+
+  if(!interrupts_disabled) {
+    ti_lib_int_master_enable();
+  }
+
+  return RF_CORE_CMD_OK;
+}
+/*---------------------------------------------------------------------------*/
+uint_fast8_t
+rf_core_cmd_wait(rf_core_cmd_req_t *req, bool sleep)
+{
+  bool interrupts_disabled;
+
+  while(req->state != RF_CORE_CMD_REQ_DONE) {
+    if(sleep) {
+      lpm_sleep();
+    }
+
+    interrupts_disabled = ti_lib_int_master_disable();
+    cmd_queue_progress();
+    if(!interrupts_disabled) {
+      ti_lib_int_master_enable();
+    }
+  }
+
+  return (req->status & RF_CORE_RADIO_OP_MASKED_STATUS)
+         == RF_CORE_RADIO_OP_MASKED_STATUS_DONE;
+}
+/*---------------------------------------------------------------------------*/
+void
+rf_core_cmd_queue_flush(void)
+{
+  rf_core_cmd_req_t *req;
+  bool interrupts_disabled;
+
+  interrupts_disabled = ti_lib_int_master_disable();
+
+  while((req = list_head(cmd_queue)) != NULL) {
+    req->status = RF_CORE_RADIO_OP_STATUS_DONE_ABORT;
+    cmd_queue_complete(req);
+  }
+
+  if(!interrupts_disabled) {
+    ti_lib_int_master_enable();
+  }
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(rf_core_process, ev, data)
 {
   int len;
@@ -619,6 +787,9 @@ cc26xx_rf_cpe0_isr(void)
      (IRQ_LAST_FG_COMMAND_DONE | IRQ_LAST_COMMAND_DONE)) {
     /* Clear the two TX-related interrupt flags */
     HWREG(RFC_DBELL_NONBUF_BASE + RFC_DBELL_O_RFCPEIFG) = 0xFFFFFFF5;
+
+    /* Complete the running chain and submit the next one */
+    cmd_queue_progress();
   }
 
   ti_lib_int_master_enable();
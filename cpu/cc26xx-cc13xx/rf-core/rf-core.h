@@ -472,6 +472,75 @@ void rf_core_primary_mode_abort(void);
  */
 uint8_t rf_core_primary_mode_restore(void);
 /*---------------------------------------------------------------------------*/
+/**
+ * \name Asynchronous command queue
+ *
+ * A request carries a chain of Radio Ops, linked through their pNextOp and
+ * condition fields, which the RF core runs back to back without CPU
+ * involvement (e.g. CMD_IEEE_CSMA -> CMD_IEEE_TX -> CMD_IEEE_RX_ACK, each
+ * with COND_STOP_ON_FALSE). Requests are submitted in order, one chain at a
+ * time, from the LAST_CMD_DONE / LAST_FG_CMD_DONE interrupts.
+ * @{
+ */
+#define RF_CORE_CMD_REQ_IDLE     0
+#define RF_CORE_CMD_REQ_QUEUED   1
+#define RF_CORE_CMD_REQ_RUNNING  2
+#define RF_CORE_CMD_REQ_DONE     3
+
+/* Longest chain that the queue will walk when checking for completion */
+#ifdef RF_CORE_CONF_CMD_CHAIN_MAX
+#define RF_CORE_CMD_CHAIN_MAX    RF_CORE_CONF_CMD_CHAIN_MAX
+#else
+#define RF_CORE_CMD_CHAIN_MAX    4
+#endif
+
+typedef struct rf_core_cmd_req_s {
+  struct rf_core_cmd_req_s *next;
+  /** The first Radio Op of the chain */
+  rfc_radioOp_t *op;
+  /** Called from interrupt context when the chain is done, may be NULL */
+  void (*callback)(struct rf_core_cmd_req_s *req);
+  void *ptr;
+  /**
+   * Status of the last Radio Op of the chain that ran. IDLE if the RF core
+   * refused the chain, RF_CORE_RADIO_OP_STATUS_DONE_ABORT if the RF core
+   * was powered down meanwhile
+   */
+  volatile uint16_t status;
+  volatile uint8_t state;
+} rf_core_cmd_req_t;
+
+/**
+ * \brief Queue a chain of Radio Ops for execution
+ * \param req The request. Its op field must point to the first Radio Op
+ * \return RF_CORE_CMD_OK or RF_CORE_CMD_ERROR if the RF core is off
+ *
+ * The request and the Radio Ops must stay allocated until the request is
+ * done. The status fields of the Radio Ops are cleared before submission.
+ */
+uint_fast8_t rf_core_cmd_queue(rf_core_cmd_req_t *req);
+
+/**
+ * \brief Wait for a queued request to complete
+ * \param req The request
+ * \param sleep true to sleep the CM3 between RF core interrupts
+ * \return RF_CORE_CMD_OK if the last Radio Op that ran completed with a DONE
+ * status, RF_CORE_CMD_ERROR otherwise
+ *
+ * This also works with interrupts disabled or from an interrupt of higher
+ * priority than the RF core's, e.g. in poll mode, by checking the chain's
+ * progress directly.
+ */
+uint_fast8_t rf_core_cmd_wait(rf_core_cmd_req_t *req, bool sleep);
+
+/**
+ * \brief Complete all queued requests with an abort status
+ *
+ * Called when the RF core is powered down
+ */
+void rf_core_cmd_queue_flush(void);
+/** @} */
+/*---------------------------------------------------------------------------*/
 #endif /* RF_CORE_H_ */
 /*---------------------------------------------------------------------------*/
 /**
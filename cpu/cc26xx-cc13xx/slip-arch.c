@@ -62,7 +62,7 @@ slip_arch_init(unsigned long ubr)
    * Enable an input handler. In doing so, the driver will make sure that UART
    * RX stays operational during deep sleep
    */
-  cc26xx_uart_set_input(slip_input_byte);
+  cc26xx_uart_set_input_bytes(slip_input_bytes);
 }
 /*---------------------------------------------------------------------------*/
 
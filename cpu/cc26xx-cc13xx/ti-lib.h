@@ -186,6 +186,14 @@
 #define ti_lib_cpu_base_pri_set(...) CPUbasepriSet(__VA_ARGS__)
 #define ti_lib_cpu_delay(...)        CPUdelay(__VA_ARGS__)
 /*---------------------------------------------------------------------------*/
+/* crypto.h */
+#include "driverlib/crypto.h"
+
+#define ti_lib_crypto_aes_load_key(...)   CRYPTOAesLoadKey(__VA_ARGS__)
+#define ti_lib_crypto_aes_ecb(...)        CRYPTOAesEcb(__VA_ARGS__)
+#define ti_lib_crypto_aes_ecb_status(...) CRYPTOAesEcbStatus(__VA_ARGS__)
+#define ti_lib_crypto_aes_ecb_finish(...) CRYPTOAesEcbFinish(__VA_ARGS__)
+/*---------------------------------------------------------------------------*/
 /* chipinfo.h */
 #include "driverlib/chipinfo.h"
 
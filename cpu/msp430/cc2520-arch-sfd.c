@@ -69,9 +69,15 @@ cc2520_arch_sfd_init(void)
   TBCCTL1 = CM_3 | CAP | SCS;
   TBCCTL1 |= CCIE;
 
-  /* Start Timer_B in continuous mode. */
-  TBCTL |= MC1;
-
-  TBR = RTIMER_NOW();
+  /* Start Timer_B in continuous mode on an rtimer tick, with TBR set
+     to the next rtimer value, so that both timers count in lockstep and
+     the captured SFD times are rtimer times. */
+  {
+    rtimer_clock_t now = RTIMER_NOW();
+    while(RTIMER_NOW() == now);
+    TBR = (rtimer_clock_t)(now + 2);
+    while(RTIMER_NOW() == (rtimer_clock_t)(now + 1));
+    TBCTL |= MC1;
+  }
 }
 /*---------------------------------------------------------------------------*/
@@ -33,11 +33,26 @@
  */
 
 #include "sys/mt.h"
+#include "sys/stack-check.h"
 
 #ifndef MTARCH_STACKSIZE
 #define MTARCH_STACKSIZE 4096
 #endif /* MTARCH_STACKSIZE */
 
+/* Switch threads with a few instructions of assembly instead of
+   swapcontext(), which also saves the signal mask with a system call
+   on every switch. Only available on x86_64 Linux. */
+#ifdef MTARCH_CONF_ASM
+#define MTARCH_ASM MTARCH_CONF_ASM
+#else
+#define MTARCH_ASM 1
+#endif
+
+#if MTARCH_ASM && !(defined(__linux) && defined(__x86_64__))
+#undef MTARCH_ASM
+#define MTARCH_ASM 0
+#endif
+
 #if defined(_WIN32) || defined(__CYGWIN__)
 
 #define WIN32_LEAN_AND_MEAN
@@ -45,6 +60,61 @@
 
 static void *main_fiber;
 
+#elif MTARCH_ASM
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct mtarch_t {
+  char stack[MTARCH_STACKSIZE];
+  void *sp;
+};
+
+static void *main_sp;
+static struct mtarch_t *running;
+
+/*
+ * mtarch_switch(from, to) pushes the callee-saved registers on the
+ * current stack, stores the stack pointer in *from, switches to the
+ * stack pointer to and pops the registers saved there. The return
+ * then continues wherever that stack last called mtarch_switch().
+ *
+ * A new thread starts in mtarch_entry with function() in r12 and its
+ * argument in r13. Should function() return, the thread exits.
+ */
+void mtarch_switch(void **from, void *to);
+void mtarch_entry(void);
+
+__asm__(".text\n\t"
+        ".globl mtarch_switch\n\t"
+        ".hidden mtarch_switch\n\t"
+        ".type mtarch_switch, @function\n"
+        "mtarch_switch:\n\t"
+        "pushq %rbp\n\t"
+        "pushq %rbx\n\t"
+        "pushq %r12\n\t"
+        "pushq %r13\n\t"
+        "pushq %r14\n\t"
+        "pushq %r15\n\t"
+        "movq %rsp, (%rdi)\n\t"
+        "movq %rsi, %rsp\n\t"
+        "popq %r15\n\t"
+        "popq %r14\n\t"
+        "popq %r13\n\t"
+        "popq %r12\n\t"
+        "popq %rbx\n\t"
+        "popq %rbp\n\t"
+        "ret\n\t"
+        ".size mtarch_switch, .-mtarch_switch\n\t"
+        ".globl mtarch_entry\n\t"
+        ".hidden mtarch_entry\n\t"
+        ".type mtarch_entry, @function\n"
+        "mtarch_entry:\n\t"
+        "movq %r13, %rdi\n\t"
+        "callq *%r12\n\t"
+        "callq mt_exit\n\t"
+        ".size mtarch_entry, .-mtarch_entry");
+
 #elif defined(__linux) || defined(__APPLE__)
 
 #ifdef __APPLE__
@@ -96,9 +166,34 @@ mtarch_start(struct mtarch_thread *thread,
 
   thread->mt_thread = CreateFiber(0, (LPFIBER_START_ROUTINE)function, data);
 
+#elif MTARCH_ASM
+
+  struct mtarch_t *t;
+  void **sp;
+
+  t = malloc(sizeof(struct mtarch_t));
+  thread->mt_thread = t;
+  stack_check_paint(t->stack, sizeof(t->stack));
+
+  /* The initial frame is popped by mtarch_switch(). Its return into
+     mtarch_entry leaves the stack 16-byte aligned, as the call of
+     function() requires. */
+  sp = (void **)(((uintptr_t)t->stack + sizeof(t->stack)) & ~(uintptr_t)15);
+  sp -= 7;
+  sp[0] = NULL;          /* r15 */
+  sp[1] = NULL;          /* r14 */
+  sp[2] = data;          /* r13 */
+  sp[3] = (void *)function; /* r12 */
+  sp[4] = NULL;          /* rbx */
+  sp[5] = NULL;          /* rbp */
+  sp[6] = (void *)mtarch_entry;
+  t->sp = sp;
+
 #elif defined(__linux)
 
   thread->mt_thread = malloc(sizeof(struct mtarch_t));
+  stack_check_paint(((struct mtarch_t *)thread->mt_thread)->stack,
+                    sizeof(((struct mtarch_t *)thread->mt_thread)->stack));
 
   getcontext(&((struct mtarch_t *)thread->mt_thread)->context);
 
@@ -136,6 +231,10 @@ mtarch_yield(void)
 
   SwitchToFiber(main_fiber);
 
+#elif MTARCH_ASM
+
+  mtarch_switch(&running->sp, main_sp);
+
 #elif defined(__linux)
 
   swapcontext(running_context, &main_context);
@@ -150,6 +249,12 @@ mtarch_exec(struct mtarch_thread *thread)
 
   SwitchToFiber(thread->mt_thread);
 
+#elif MTARCH_ASM
+
+  running = thread->mt_thread;
+  mtarch_switch(&main_sp, running->sp);
+  running = NULL;
+
 #elif defined(__linux)
 
   running_context = &((struct mtarch_t *)thread->mt_thread)->context;
@@ -183,3 +288,24 @@ mtarch_pstop(void)
 {
 }
 /*--------------------------------------------------------------------------*/
+int
+mtarch_stack_usage(struct mt_thread *t)
+{
+#if defined(_WIN32) || defined(__CYGWIN__)
+
+  /* Fiber stacks are allocated by Windows and cannot be measured */
+  return 0;
+
+#elif defined(linux) || defined(__linux)
+
+  struct mtarch_t *m = t->thread.mt_thread;
+
+  return stack_check_usage(m->stack, sizeof(m->stack));
+
+#else
+
+  return 0;
+
+#endif /* _WIN32 || __CYGWIN__ || __linux */
+}
+/*--------------------------------------------------------------------------*/
@@ -39,4 +39,8 @@ struct mtarch_thread {
   void *mt_thread;
 };
 
+struct mt_thread;
+
+int mtarch_stack_usage(struct mt_thread *t);
+
 #endif /* MTARCH_H_ */
@@ -46,6 +46,14 @@
 #include "sys/rtimer.h"
 #include "sys/clock.h"
 
+#if NATIVE_RTIMER_HIGHRES
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#endif /* NATIVE_RTIMER_HIGHRES */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -54,6 +62,16 @@
 #define PRINTF(...)
 #endif
 
+#if NATIVE_RTIMER_HIGHRES
+/*
+ * The timer expires on a timerfd that is watched by the select() loop
+ * of the platform, so rtimer tasks run from the main loop and not
+ * from a signal handler. If the timerfd cannot be used, SIGALRM is
+ * used instead.
+ */
+static int timer_fd = -1;
+#endif /* NATIVE_RTIMER_HIGHRES */
+
 /*---------------------------------------------------------------------------*/
 static void
 interrupt(int sig)
@@ -62,9 +80,52 @@ interrupt(int sig)
   rtimer_run_next();
 }
 /*---------------------------------------------------------------------------*/
+#if NATIVE_RTIMER_HIGHRES
+rtimer_clock_t
+rtimer_arch_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (rtimer_clock_t)((uint64_t)ts.tv_sec * RTIMER_ARCH_SECOND +
+                          ts.tv_nsec / 1000);
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(timer_fd, rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  uint64_t expirations;
+
+  if(FD_ISSET(timer_fd, rset) &&
+     read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+    rtimer_run_next();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback timer_fd_callback = { set_fd, handle_fd };
+#endif /* NATIVE_RTIMER_HIGHRES */
+/*---------------------------------------------------------------------------*/
 void
 rtimer_arch_init(void)
 {
+#if NATIVE_RTIMER_HIGHRES
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if(timer_fd >= 0 && select_set_callback(timer_fd, &timer_fd_callback)) {
+    return;
+  }
+  perror("rtimer timerfd");
+  if(timer_fd >= 0) {
+    close(timer_fd);
+    timer_fd = -1;
+  }
+#endif /* NATIVE_RTIMER_HIGHRES */
 #ifndef _WIN32
   signal(SIGALRM, interrupt);
 #endif /* !_WIN32 */
@@ -73,7 +134,32 @@ rtimer_arch_init(void)
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
-#ifndef _WIN32
+#if NATIVE_RTIMER_HIGHRES
+  struct itimerspec its;
+  struct itimerval val;
+  int32_t c;
+
+  c = RTIMER_CLOCK_DIFF(t, rtimer_arch_now());
+  if(c <= 0) {
+    /* A zero value would disarm the timer */
+    c = 1;
+  }
+
+  PRINTF("rtimer_arch_schedule time %lu in %ld us\n",
+         (unsigned long)t, (long)c);
+
+  if(timer_fd >= 0) {
+    its.it_value.tv_sec = c / RTIMER_ARCH_SECOND;
+    its.it_value.tv_nsec = (c % RTIMER_ARCH_SECOND) * 1000;
+    its.it_interval.tv_sec = its.it_interval.tv_nsec = 0;
+    timerfd_settime(timer_fd, 0, &its, NULL);
+  } else {
+    val.it_value.tv_sec = c / RTIMER_ARCH_SECOND;
+    val.it_value.tv_usec = c % RTIMER_ARCH_SECOND;
+    val.it_interval.tv_sec = val.it_interval.tv_usec = 0;
+    setitimer(ITIMER_REAL, &val, NULL);
+  }
+#elif !defined(_WIN32)
   struct itimerval val;
   rtimer_clock_t c;
 
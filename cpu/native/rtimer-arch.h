@@ -41,9 +41,20 @@
 #define RTIMER_ARCH_H_
 
 #include "contiki-conf.h"
+#include "sys/clock.h"
 
+#ifndef NATIVE_RTIMER_HIGHRES
+#define NATIVE_RTIMER_HIGHRES 0
+#endif /* NATIVE_RTIMER_HIGHRES */
+
+#if NATIVE_RTIMER_HIGHRES
+#define RTIMER_ARCH_SECOND 1000000UL
+
+rtimer_clock_t rtimer_arch_now(void);
+#else /* NATIVE_RTIMER_HIGHRES */
 #define RTIMER_ARCH_SECOND CLOCK_CONF_SECOND
 
 #define rtimer_arch_now() clock_time()
+#endif /* NATIVE_RTIMER_HIGHRES */
 
 #endif /* RTIMER_ARCH_H_ */
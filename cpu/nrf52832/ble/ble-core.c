@@ -69,6 +69,29 @@
 #define APP_ADV_TIMEOUT                 0                                  /**< Time for which the device must be advertising in non-connectable mode (in seconds). 0 disables timeout. */
 #define APP_ADV_ADV_INTERVAL            MSEC_TO_UNITS(333, UNIT_0_625_MS)  /**< The advertising interval. This value can vary between 100ms to 10.24s). */
 
+/*
+ * Connection interval (in ms) to ask the master for once connected. A short
+ * interval gives more connection events per second, and so more IPSP
+ * throughput, at the cost of power. 0 keeps the master's choice.
+ */
+#ifdef BLE_CONF_CONN_INTERVAL_MIN
+#define BLE_CONN_INTERVAL_MIN           BLE_CONF_CONN_INTERVAL_MIN
+#else
+#define BLE_CONN_INTERVAL_MIN           0
+#endif
+
+#ifdef BLE_CONF_CONN_INTERVAL_MAX
+#define BLE_CONN_INTERVAL_MAX           BLE_CONF_CONN_INTERVAL_MAX
+#else
+#define BLE_CONN_INTERVAL_MAX           BLE_CONN_INTERVAL_MIN
+#endif
+
+#ifdef BLE_CONF_CONN_SUP_TIMEOUT
+#define BLE_CONN_SUP_TIMEOUT            BLE_CONF_CONN_SUP_TIMEOUT
+#else
+#define BLE_CONN_SUP_TIMEOUT            4000  /**< Supervision timeout (in ms) requested along with the interval */
+#endif
+
 static ble_gap_adv_params_t m_adv_params; /**< Parameters to be passed to the stack when starting advertising. */
 
 static void
@@ -194,6 +217,30 @@ ble_gap_addr_print(const ble_gap_addr_t *addr)
   }PRINTF(" (%d)", addr->addr_type);
 }
 /*---------------------------------------------------------------------------*/
+#if BLE_CONN_INTERVAL_MIN
+/**
+ * \brief Ask the master for the configured connection parameters.
+ * \param conn_handle the connection
+ */
+static void
+conn_params_request(uint16_t conn_handle)
+{
+  ble_gap_conn_params_t conn_params;
+  uint32_t err_code;
+
+  memset(&conn_params, 0, sizeof(conn_params));
+  conn_params.min_conn_interval = MSEC_TO_UNITS(BLE_CONN_INTERVAL_MIN, UNIT_1_25_MS);
+  conn_params.max_conn_interval = MSEC_TO_UNITS(BLE_CONN_INTERVAL_MAX, UNIT_1_25_MS);
+  conn_params.slave_latency = 0;
+  conn_params.conn_sup_timeout = MSEC_TO_UNITS(BLE_CONN_SUP_TIMEOUT, UNIT_10_MS);
+
+  err_code = sd_ble_gap_conn_param_update(conn_handle, &conn_params);
+  if(err_code != NRF_SUCCESS) {
+    PRINTF("ble-core: connection parameter request failed (%u)\n", (unsigned)err_code);
+  }
+}
+#endif /* BLE_CONN_INTERVAL_MIN */
+/*---------------------------------------------------------------------------*/
 /**
  * \brief Function for handling the Application's BLE Stack events.
  * \param[in]   p_ble_evt   Bluetooth stack event.
@@ -209,6 +256,14 @@ on_ble_evt(ble_evt_t *p_ble_evt)
       sd_ble_gap_rssi_start(p_ble_evt->evt.gap_evt.conn_handle,
                             BLE_GAP_RSSI_THRESHOLD_INVALID,
                             0);
+#if BLE_CONN_INTERVAL_MIN
+      conn_params_request(p_ble_evt->evt.gap_evt.conn_handle);
+#endif /* BLE_CONN_INTERVAL_MIN */
+      break;
+
+    case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+      PRINTF("ble-core: connection interval %u units\n",
+             p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval);
       break;
 
     case BLE_GAP_EVT_DISCONNECTED:
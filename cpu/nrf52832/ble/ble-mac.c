@@ -66,6 +66,24 @@
 #define BLE_MAC_MAX_INTERFACE_NUM 1 /**< Maximum number of interfaces, i.e., connection to master devices */
 #endif
 
+/*
+ * Number of packets that can be queued for transmission. With 0, every
+ * packet is sent on its own and send_packet() waits for it to complete.
+ * Otherwise packets are handed to IPSP as long as L2CAP accepts them, so
+ * that several go out in one connection event, and the MAC callback is
+ * called when IPSP reports them transmitted. Each queued packet costs a
+ * buffer of PACKETBUF_SIZE bytes.
+ */
+#ifdef BLE_MAC_CONF_TX_QUEUE_LEN
+#define BLE_MAC_TX_QUEUE_LEN BLE_MAC_CONF_TX_QUEUE_LEN
+#else
+#define BLE_MAC_TX_QUEUE_LEN 0
+#endif
+
+#if BLE_MAC_TX_QUEUE_LEN && BLE_MAC_MAX_INTERFACE_NUM > 8
+#error The BLE MAC TX queue supports up to 8 interfaces
+#endif
+
 /*---------------------------------------------------------------------------*/
 process_event_t ble_event_interface_added; /**< This event is broadcast when BLE connection is established */
 process_event_t ble_event_interface_deleted; /**< This event is broadcast when BLE connection is destroyed */
@@ -97,6 +115,41 @@ struct {
 static mac_callback_t mac_sent_cb;
 static void *mac_sent_ptr;
 
+#if BLE_MAC_TX_QUEUE_LEN
+/**
+ * \brief A packet queued for transmission.
+ *
+ * The packet is kept in the memory that held the packetbuf when it was
+ * queued; the packetbuf is given a free buffer instead. Bit i of the
+ * masks stands for interfaces[i].
+ */
+typedef struct {
+  uint8_t *buf;        /**< Memory holding the packet */
+  uint8_t *data;       /**< Start of the packet in buf */
+  uint16_t len;
+  uint8_t pending;     /**< Interfaces the packet is still to be handed to */
+  uint8_t in_flight;   /**< Interfaces IPSP is transmitting the packet on */
+  uint8_t sent;        /**< Interfaces the packet was transmitted on */
+  mac_callback_t cb;
+  void *ptr;
+} ble_mac_tx_packet_t;
+
+/* Queued packets, in order, from tx_head on */
+static ble_mac_tx_packet_t tx_queue[BLE_MAC_TX_QUEUE_LEN];
+static uint8_t tx_head, tx_count;
+
+/* Free buffers, the packetbuf keeps one more */
+static uint32_t tx_bufs[BLE_MAC_TX_QUEUE_LEN][(PACKETBUF_SIZE + 3) / 4];
+static uint8_t *tx_free_bufs[BLE_MAC_TX_QUEUE_LEN];
+static uint8_t tx_num_free_bufs;
+
+/* Set from the SoftDevice interrupt, handled by ble_ipsp_process */
+static volatile uint8_t tx_completed[BLE_MAC_MAX_INTERFACE_NUM];
+static volatile uint8_t tx_disconnected;
+
+static void tx_queue_process(void);
+#endif /* BLE_MAC_TX_QUEUE_LEN */
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief Lookup interface by IPSP connection.
@@ -151,6 +204,10 @@ ble_mac_interface_add(eui64_t *peer, ble_ipsp_handle_t *handle)
 static void
 ble_mac_interface_delete(ble_mac_interface_t *interface)
 {
+#if BLE_MAC_TX_QUEUE_LEN
+  tx_disconnected |= 1 << (interface - interfaces);
+  process_poll(&ble_ipsp_process);
+#endif /* BLE_MAC_TX_QUEUE_LEN */
   memset(interface, 0, sizeof(ble_mac_interface_t));
   process_post(PROCESS_BROADCAST, ble_event_interface_deleted, NULL);
 }
@@ -237,6 +294,12 @@ ble_mac_ipsp_evt_handler_irq(ble_ipsp_handle_t *p_handle, ble_ipsp_evt_t *p_evt)
 
     case BLE_IPSP_EVT_CHANNEL_DATA_TX_COMPLETE: {
       PRINTF("ble-mac: data transmitted\n");
+#if BLE_MAC_TX_QUEUE_LEN
+      if(p_instance != NULL) {
+        tx_completed[p_instance - interfaces]++;
+        process_poll(&ble_ipsp_process);
+      }
+#endif /* BLE_MAC_TX_QUEUE_LEN */
       busy_tx = 0;
       break;
     }
@@ -252,6 +315,12 @@ PROCESS_THREAD(ble_ipsp_process, ev, data)
   while(1) {
     PROCESS_WAIT_EVENT();
     if(ev == PROCESS_EVENT_POLL) {
+#if BLE_MAC_TX_QUEUE_LEN
+      tx_queue_process();
+      if(!busy_rx) {
+        continue;
+      }
+#endif /* BLE_MAC_TX_QUEUE_LEN */
       packetbuf_copyfrom(input_packet.payload, input_packet.len);
       packetbuf_set_attr(PACKETBUF_ATTR_RSSI, input_packet.rssi);
       packetbuf_set_addr(PACKETBUF_ADDR_SENDER, (const linkaddr_t *)input_packet.src.identifier);
@@ -297,6 +366,136 @@ send_to_peer(ble_ipsp_handle_t *handle)
   return (ble_ipsp_send(handle, packetbuf_dataptr(), packetbuf_datalen()) == NRF_SUCCESS);
 }
 /*---------------------------------------------------------------------------*/
+#if BLE_MAC_TX_QUEUE_LEN
+/**
+ * \brief Hand queued packets to IPSP, in order, until L2CAP refuses one.
+ *
+ * L2CAP refuses packets when the peer has no credits left or the
+ * SoftDevice has no buffers; the packet is then retried once an earlier
+ * one has been transmitted. A packet refused with nothing in flight on
+ * that interface will not be accepted later either, and is dropped.
+ */
+static void
+tx_queue_submit(void)
+{
+  int i, n;
+  uint8_t bit, busy;
+  ble_mac_tx_packet_t *p;
+
+  for(i = 0; i < BLE_MAC_MAX_INTERFACE_NUM; i++) {
+    bit = 1 << i;
+    busy = 0;
+    for(n = 0; n < tx_count; n++) {
+      p = &tx_queue[(tx_head + n) % BLE_MAC_TX_QUEUE_LEN];
+      busy |= p->in_flight & bit;
+      if(!(p->pending & bit)) {
+        continue;
+      }
+      if(ble_ipsp_send(&interfaces[i].handle, p->data, p->len) == NRF_SUCCESS) {
+        p->pending &= ~bit;
+        p->in_flight |= bit;
+        busy = bit;
+      } else if(busy) {
+        /* Out of credits or buffers: keep the order, try again later */
+        break;
+      } else {
+        PRINTF("ble-mac: IPSP refused a packet, dropping it\n");
+        p->pending &= ~bit;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Account for transmitted packets and lost connections, report
+ * finished packets to the upper layer and submit more.
+ */
+static void
+tx_queue_process(void)
+{
+  int i, n;
+  uint8_t bit, lost;
+  ble_mac_tx_packet_t *p;
+
+  lost = tx_disconnected;
+  tx_disconnected &= ~lost;
+
+  for(i = 0; i < BLE_MAC_MAX_INTERFACE_NUM; i++) {
+    bit = 1 << i;
+    /* IPSP reports transmissions on a channel in order */
+    for(n = 0; n < tx_count && tx_completed[i] > 0; n++) {
+      p = &tx_queue[(tx_head + n) % BLE_MAC_TX_QUEUE_LEN];
+      if(p->in_flight & bit) {
+        p->in_flight &= ~bit;
+        p->sent |= bit;
+        tx_completed[i]--;
+      }
+    }
+    if(lost & bit) {
+      tx_completed[i] = 0;
+      for(n = 0; n < tx_count; n++) {
+        p = &tx_queue[(tx_head + n) % BLE_MAC_TX_QUEUE_LEN];
+        p->pending &= ~bit;
+        p->in_flight &= ~bit;
+      }
+    }
+  }
+
+  /* Report finished packets in the order they were sent */
+  while(tx_count > 0) {
+    p = &tx_queue[tx_head];
+    if(p->pending || p->in_flight) {
+      break;
+    }
+    tx_free_bufs[tx_num_free_bufs++] = p->buf;
+    tx_head = (tx_head + 1) % BLE_MAC_TX_QUEUE_LEN;
+    tx_count--;
+    mac_call_sent_callback(p->cb, p->ptr, p->sent ? MAC_TX_OK : MAC_TX_ERR, 1);
+  }
+
+  tx_queue_submit();
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Queue the packet in packetbuf for the given interfaces.
+ *
+ * The packet is not copied: the packetbuf memory is exchanged for a free
+ * buffer.
+ */
+static void
+tx_queue_add(uint8_t interfaces_mask, mac_callback_t sent, void *ptr)
+{
+  ble_mac_tx_packet_t *p;
+
+  if(interfaces_mask == 0) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+    return;
+  }
+
+  /* The upper layer expects to be able to send; wait for room */
+  while(tx_count == BLE_MAC_TX_QUEUE_LEN) {
+    tx_queue_process();
+    if(tx_count == BLE_MAC_TX_QUEUE_LEN) {
+      watchdog_periodic();
+      sd_app_evt_wait();
+    }
+  }
+
+  p = &tx_queue[(tx_head + tx_count) % BLE_MAC_TX_QUEUE_LEN];
+  p->data = packetbuf_dataptr();
+  p->len = packetbuf_datalen();
+  p->buf = packetbuf_swap_storage(tx_free_bufs[--tx_num_free_bufs]);
+  p->pending = interfaces_mask;
+  p->in_flight = 0;
+  p->sent = 0;
+  p->cb = sent;
+  p->ptr = ptr;
+  tx_count++;
+
+  tx_queue_submit();
+}
+#endif /* BLE_MAC_TX_QUEUE_LEN */
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
@@ -310,6 +509,25 @@ send_packet(mac_callback_t sent, void *ptr)
 
   dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
 
+#if BLE_MAC_TX_QUEUE_LEN
+  {
+    uint8_t mask = 0;
+
+    for(i = 0; i < BLE_MAC_MAX_INTERFACE_NUM; i++) {
+      if(interfaces[i].handle.cid != 0 && interfaces[i].handle.conn_handle != 0 &&
+         (linkaddr_cmp(dest, &linkaddr_null) ||
+          linkaddr_cmp((const linkaddr_t *)&interfaces[i].peer_addr, dest))) {
+        mask |= 1 << i;
+      }
+    }
+    if(mask == 0) {
+      PRINTF("ble-mac: no connection found for peer");
+    }
+    tx_queue_add(mask, sent, ptr);
+    return;
+  }
+#endif /* BLE_MAC_TX_QUEUE_LEN */
+
   if(linkaddr_cmp(dest, &linkaddr_null)) {
     for(i = 0; i < BLE_MAC_MAX_INTERFACE_NUM; i++) {
       if(interfaces[i].handle.cid != 0 && interfaces[i].handle.conn_handle != 0) {
@@ -365,6 +583,16 @@ init(void)
   err_code = ble_ipsp_init(&ipsp_init_params);
   APP_ERROR_CHECK(err_code);
 
+#if BLE_MAC_TX_QUEUE_LEN
+  {
+    int i;
+    for(i = 0; i < BLE_MAC_TX_QUEUE_LEN; i++) {
+      tx_free_bufs[i] = (uint8_t *)tx_bufs[i];
+    }
+    tx_num_free_bufs = BLE_MAC_TX_QUEUE_LEN;
+  }
+#endif /* BLE_MAC_TX_QUEUE_LEN */
+
   ble_event_interface_added = process_alloc_event();
   ble_event_interface_deleted = process_alloc_event();
 
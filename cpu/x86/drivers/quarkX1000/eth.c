@@ -44,12 +44,26 @@ typedef pci_driver_t quarkX1000_eth_driver_t;
 /* Refer to Intel Quark SoC X1000 Datasheet, Chapter 15 for more details on
  * Ethernet device operation.
  *
- * This driver puts the Ethernet device into a very simple and space-efficient
- * mode of operation.  It only allocates a single packet descriptor for each of
- * the transmit and receive directions, computes checksums on the CPU, and
+ * This driver puts the Ethernet device into a simple mode of operation.  It
+ * allocates a ring of packet descriptors for each of the transmit and receive
+ * directions, each with its own buffer, computes checksums on the CPU, and
  * enables store-and-forward mode for both transmit and receive directions.
+ * The rings let the device receive frames while the CPU is busy and let
+ * quarkX1000_eth_send return before the previous frames have been sent.
  */
 
+#ifdef QUARKX1000_ETH_CONF_TX_DESCS
+#define TX_DESCS QUARKX1000_ETH_CONF_TX_DESCS
+#else
+#define TX_DESCS 4
+#endif
+
+#ifdef QUARKX1000_ETH_CONF_RX_DESCS
+#define RX_DESCS QUARKX1000_ETH_CONF_RX_DESCS
+#else
+#define RX_DESCS 8
+#endif
+
 /* Transmit descriptor */
 typedef struct quarkX1000_eth_tx_desc {
   /* First word of transmit descriptor */
@@ -100,9 +114,7 @@ typedef struct quarkX1000_eth_tx_desc {
   };
   /* Pointer to frame data buffer */
   uint8_t *buf1_ptr;
-  /* Unused, since this driver initializes only a single descriptor for each
-   * direction.
-   */
+  /* Unused, since each descriptor in the ring has a single buffer. */
   uint8_t *buf2_ptr;
 } quarkX1000_eth_tx_desc_t;
 
@@ -148,22 +160,29 @@ typedef struct quarkX1000_eth_rx_desc {
   };
   /* Pointer to frame data buffer */
   uint8_t *buf1_ptr;
-  /* Unused, since this driver initializes only a single descriptor for each
-   * direction.
-   */
+  /* Unused, since each descriptor in the ring has a single buffer. */
   uint8_t *buf2_ptr;
 } quarkX1000_eth_rx_desc_t;
 
+#define META_FIELDS_SZ \
+  (TX_DESCS * (sizeof(quarkX1000_eth_tx_desc_t) + ALIGN(UIP_BUFSIZE, 4)) + \
+   RX_DESCS * (sizeof(quarkX1000_eth_rx_desc_t) + ALIGN(UIP_BUFSIZE, 4)) + \
+   2 * sizeof(uint32_t))
+
 /* Driver metadata associated with each Ethernet device */
 typedef struct quarkX1000_eth_meta {
-  /* Transmit descriptor */
-  volatile quarkX1000_eth_tx_desc_t tx_desc;
-  /* Transmit DMA packet buffer */
-  volatile uint8_t tx_buf[ALIGN(UIP_BUFSIZE, 4)];
-  /* Receive descriptor */
-  volatile quarkX1000_eth_rx_desc_t rx_desc;
-  /* Receive DMA packet buffer */
-  volatile uint8_t rx_buf[ALIGN(UIP_BUFSIZE, 4)];
+  /* Transmit descriptor ring */
+  volatile quarkX1000_eth_tx_desc_t tx_desc[TX_DESCS];
+  /* Transmit DMA packet buffers */
+  volatile uint8_t tx_buf[TX_DESCS][ALIGN(UIP_BUFSIZE, 4)];
+  /* Receive descriptor ring */
+  volatile quarkX1000_eth_rx_desc_t rx_desc[RX_DESCS];
+  /* Receive DMA packet buffers */
+  volatile uint8_t rx_buf[RX_DESCS][ALIGN(UIP_BUFSIZE, 4)];
+  /* Index of the next descriptor to fill with an outgoing frame */
+  uint32_t tx_next;
+  /* Index of the next descriptor to check for an incoming frame */
+  uint32_t rx_next;
 
 #if X86_CONF_PROT_DOMAINS == X86_CONF_PROT_DOMAINS__PAGING
   /* Domain-defined metadata must fill an even number of pages, since that is
@@ -171,15 +190,9 @@ typedef struct quarkX1000_eth_meta {
    * using the "aligned(4096)" attribute causes the alignment of the kernel
    * data section to increase, which causes problems when generating UEFI
    * binaries, as is described in the linker script.  Thus, it is necessary
-   * to manually pad the structure to fill a page.  This only works if the
-   * sizes of the actual fields of the structure are collectively less than a
-   * page.
+   * to manually pad the structure to a whole number of pages.
    */
-  uint8_t pad[MIN_PAGE_SIZE -
-              (sizeof(quarkX1000_eth_tx_desc_t) +
-               ALIGN(UIP_BUFSIZE, 4) +
-               sizeof(quarkX1000_eth_rx_desc_t) +
-               ALIGN(UIP_BUFSIZE, 4))];
+  uint8_t pad[ALIGN(META_FIELDS_SZ, MIN_PAGE_SIZE) - META_FIELDS_SZ];
 #endif
 } __attribute__((packed)) quarkX1000_eth_meta_t;
 
@@ -216,6 +229,7 @@ SYSCALLS_DEFINE_SINGLETON(quarkX1000_eth_setup, drv, uintptr_t meta_phys_base)
 {
   uip_eth_addr mac_addr;
   uint32_t mac_tmp1, mac_tmp2;
+  uint32_t i;
   quarkX1000_eth_rx_desc_t rx_desc;
   quarkX1000_eth_tx_desc_t tx_desc;
   quarkX1000_eth_meta_t ATTR_META_ADDR_SPACE *loc_meta =
@@ -250,48 +264,53 @@ SYSCALLS_DEFINE_SINGLETON(quarkX1000_eth_setup, drv, uintptr_t meta_phys_base)
 
   uip_setethaddr(mac_addr);
 
-  /* Initialize transmit descriptor. */
-  tx_desc.tdes0 = 0;
-  tx_desc.tdes1 = 0;
-
-  tx_desc.tx_end_of_ring = 1;
-  tx_desc.first_seg_in_frm = 1;
-  tx_desc.last_seg_in_frm = 1;
-  tx_desc.tx_end_of_ring = 1;
-
-  META_WRITEL(loc_meta->tx_desc.tdes0, tx_desc.tdes0);
-  META_WRITEL(loc_meta->tx_desc.tdes1, tx_desc.tdes1);
-  META_WRITEL(loc_meta->tx_desc.buf1_ptr,
-              (uint8_t *)PROT_DOMAINS_META_OFF_TO_PHYS(
-                (uintptr_t)&loc_meta->tx_buf, meta_phys_base));
-  META_WRITEL(loc_meta->tx_desc.buf2_ptr, 0);
-
-  /* Initialize receive descriptor. */
-  rx_desc.rdes0 = 0;
-  rx_desc.rdes1 = 0;
-
-  rx_desc.own = 1;
-  rx_desc.first_desc = 1;
-  rx_desc.last_desc = 1;
-  rx_desc.rx_buf1_sz = UIP_BUFSIZE;
-  rx_desc.rx_end_of_ring = 1;
-
-  META_WRITEL(loc_meta->rx_desc.rdes0, rx_desc.rdes0);
-  META_WRITEL(loc_meta->rx_desc.rdes1, rx_desc.rdes1);
-  META_WRITEL(loc_meta->rx_desc.buf1_ptr,
-              (uint8_t *)PROT_DOMAINS_META_OFF_TO_PHYS(
-                (uintptr_t)&loc_meta->rx_buf, meta_phys_base));
-  META_WRITEL(loc_meta->rx_desc.buf2_ptr, 0);
+  /* Initialize transmit descriptors. */
+  for(i = 0; i < TX_DESCS; i++) {
+    tx_desc.tdes0 = 0;
+    tx_desc.tdes1 = 0;
+
+    tx_desc.first_seg_in_frm = 1;
+    tx_desc.last_seg_in_frm = 1;
+    tx_desc.tx_end_of_ring = i == TX_DESCS - 1;
+
+    META_WRITEL(loc_meta->tx_desc[i].tdes0, tx_desc.tdes0);
+    META_WRITEL(loc_meta->tx_desc[i].tdes1, tx_desc.tdes1);
+    META_WRITEL(loc_meta->tx_desc[i].buf1_ptr,
+                (uint8_t *)PROT_DOMAINS_META_OFF_TO_PHYS(
+                  (uintptr_t)&loc_meta->tx_buf[i], meta_phys_base));
+    META_WRITEL(loc_meta->tx_desc[i].buf2_ptr, 0);
+  }
+  META_WRITEL(loc_meta->tx_next, 0);
+
+  /* Initialize receive descriptors. */
+  for(i = 0; i < RX_DESCS; i++) {
+    rx_desc.rdes0 = 0;
+    rx_desc.rdes1 = 0;
+
+    rx_desc.own = 1;
+    rx_desc.first_desc = 1;
+    rx_desc.last_desc = 1;
+    rx_desc.rx_buf1_sz = UIP_BUFSIZE;
+    rx_desc.rx_end_of_ring = i == RX_DESCS - 1;
+
+    META_WRITEL(loc_meta->rx_desc[i].rdes0, rx_desc.rdes0);
+    META_WRITEL(loc_meta->rx_desc[i].rdes1, rx_desc.rdes1);
+    META_WRITEL(loc_meta->rx_desc[i].buf1_ptr,
+                (uint8_t *)PROT_DOMAINS_META_OFF_TO_PHYS(
+                  (uintptr_t)&loc_meta->rx_buf[i], meta_phys_base));
+    META_WRITEL(loc_meta->rx_desc[i].buf2_ptr, 0);
+  }
+  META_WRITEL(loc_meta->rx_next, 0);
 
   prot_domains_enable_mmio();
 
   /* Install transmit and receive descriptors. */
   PCI_MMIO_WRITEL(drv, REG_ADDR_RX_DESC_LIST,
                   PROT_DOMAINS_META_OFF_TO_PHYS(
-                    (uintptr_t)&loc_meta->rx_desc, meta_phys_base));
+                    (uintptr_t)&loc_meta->rx_desc[0], meta_phys_base));
   PCI_MMIO_WRITEL(drv, REG_ADDR_TX_DESC_LIST,
                   PROT_DOMAINS_META_OFF_TO_PHYS(
-                    (uintptr_t)&loc_meta->tx_desc, meta_phys_base));
+                    (uintptr_t)&loc_meta->tx_desc[0], meta_phys_base));
 
   PCI_MMIO_WRITEL(drv, REG_ADDR_MAC_CONF,
                   /* Set the RMII speed to 100Mbps */
@@ -332,19 +351,23 @@ SYSCALLS_DEFINE_SINGLETON(quarkX1000_eth_poll, drv, uint16_t * frame_len)
 {
   uint16_t *loc_frame_len;
   uint16_t frm_len = 0;
+  uint32_t idx;
   quarkX1000_eth_rx_desc_t tmp_desc;
   quarkX1000_eth_meta_t ATTR_META_ADDR_SPACE *loc_meta =
     (quarkX1000_eth_meta_t ATTR_META_ADDR_SPACE *)PROT_DOMAINS_META(drv);
 
   PROT_DOMAINS_VALIDATE_PTR(loc_frame_len, frame_len, sizeof(*frame_len));
 
-  META_READL(tmp_desc.rdes0, loc_meta->rx_desc.rdes0);
+  META_READL(idx, loc_meta->rx_next);
+  META_READL(tmp_desc.rdes0, loc_meta->rx_desc[idx].rdes0);
 
-  /* Check whether the RX descriptor is still owned by the device.  If not,
-   * process the received frame or an error that may have occurred.
+  /* Check whether the next RX descriptor is still owned by the device.  If
+   * not, process the received frame or an error that may have occurred.
+   * Frames are received in ring order, so a descriptor owned by the device
+   * means that there is no frame waiting.
    */
   if(tmp_desc.own == 0) {
-    META_READL(tmp_desc.rdes1, loc_meta->rx_desc.rdes1);
+    META_READL(tmp_desc.rdes1, loc_meta->rx_desc[idx].rdes1);
     if(tmp_desc.err_summary) {
       fprintf(stderr,
               LOG_PFX "Error receiving frame: RDES0 = %08x, RDES1 = %08x.\n",
@@ -354,12 +377,13 @@ SYSCALLS_DEFINE_SINGLETON(quarkX1000_eth_poll, drv, uint16_t * frame_len)
 
     frm_len = tmp_desc.frm_len;
     assert(frm_len <= UIP_BUFSIZE);
-    MEMCPY_FROM_META(uip_buf, loc_meta->rx_buf, frm_len);
+    MEMCPY_FROM_META(uip_buf, loc_meta->rx_buf[idx], frm_len);
 
     /* Return ownership of the RX descriptor to the device. */
     tmp_desc.own = 1;
 
-    META_WRITEL(loc_meta->rx_desc.rdes0, tmp_desc.rdes0);
+    META_WRITEL(loc_meta->rx_desc[idx].rdes0, tmp_desc.rdes0);
+    META_WRITEL(loc_meta->rx_next, (idx + 1) % RX_DESCS);
 
     prot_domains_enable_mmio();
 
@@ -377,26 +401,32 @@ SYSCALLS_DEFINE_SINGLETON(quarkX1000_eth_poll, drv, uint16_t * frame_len)
 /**
  * \brief Transmit the current Ethernet frame.
  *
- *        This procedure will block indefinitely until the Ethernet device is
- *        ready to accept a new outgoing frame.  It then copies the current
- *        Ethernet frame from the global uip_buf buffer to the device DMA
- *        buffer and signals to the device that a new frame is available to be
- *        transmitted.
+ *        This procedure will block indefinitely until the next TX descriptor
+ *        in the ring is no longer owned by the Ethernet device, which only
+ *        happens when all TX_DESCS descriptors hold frames not yet sent.  It
+ *        then copies the current Ethernet frame from the global uip_buf
+ *        buffer to the DMA buffer of that descriptor and signals to the
+ *        device that a new frame is available to be transmitted.
  */
 SYSCALLS_DEFINE_SINGLETON(quarkX1000_eth_send, drv)
 {
+  uint32_t idx;
   quarkX1000_eth_tx_desc_t tmp_desc;
   quarkX1000_eth_meta_t ATTR_META_ADDR_SPACE *loc_meta =
     (quarkX1000_eth_meta_t ATTR_META_ADDR_SPACE *)PROT_DOMAINS_META(drv);
 
+  META_READL(idx, loc_meta->tx_next);
+
   /* Wait until the TX descriptor is no longer owned by the device. */
   do {
-    META_READL(tmp_desc.tdes0, loc_meta->tx_desc.tdes0);
+    META_READL(tmp_desc.tdes0, loc_meta->tx_desc[idx].tdes0);
   } while(tmp_desc.own == 1);
 
-  META_READL(tmp_desc.tdes1, loc_meta->tx_desc.tdes1);
+  META_READL(tmp_desc.tdes1, loc_meta->tx_desc[idx].tdes1);
 
-  /* Check whether an error occurred transmitting the previous frame. */
+  /* Check whether an error occurred transmitting the frame that was last
+   * sent from this descriptor.
+   */
   if(tmp_desc.err_summary) {
     fprintf(stderr,
             LOG_PFX "Error transmitting frame: TDES0 = %08x, TDES1 = %08x.\n",
@@ -406,15 +436,16 @@ SYSCALLS_DEFINE_SINGLETON(quarkX1000_eth_send, drv)
 
   /* Transmit the next frame. */
   assert(uip_len <= UIP_BUFSIZE);
-  MEMCPY_TO_META(loc_meta->tx_buf, uip_buf, uip_len);
+  MEMCPY_TO_META(loc_meta->tx_buf[idx], uip_buf, uip_len);
 
   tmp_desc.tx_buf1_sz = uip_len;
 
-  META_WRITEL(loc_meta->tx_desc.tdes1, tmp_desc.tdes1);
+  META_WRITEL(loc_meta->tx_desc[idx].tdes1, tmp_desc.tdes1);
 
   tmp_desc.own = 1;
 
-  META_WRITEL(loc_meta->tx_desc.tdes0, tmp_desc.tdes0);
+  META_WRITEL(loc_meta->tx_desc[idx].tdes0, tmp_desc.tdes0);
+  META_WRITEL(loc_meta->tx_next, (idx + 1) % TX_DESCS);
 
   prot_domains_enable_mmio();
 
@@ -64,11 +64,20 @@
  * This will lead to an increased RX/RX turnaround time.
  * - If CC1200_USE_GPIO2 is set, we can use an arbitrary payload length
  * (only limited by the payload length defined in the phy header).
+ * The RX / TX FIFOs are then drained / refilled whenever they cross the
+ * FIFO threshold, so frames larger than the 128 byte FIFOs are streamed.
+ *
+ * In 802.15.4g mode, the default follows SICSLOWPAN_CONF_MAC_MAX_PAYLOAD
+ * if that is above 127.
  *
  * See below for 802.15.4g support.
  */
 #ifdef CC1200_CONF_MAX_PAYLOAD_LEN
 #define CC1200_MAX_PAYLOAD_LEN           CC1200_CONF_MAX_PAYLOAD_LEN
+#elif CC1200_CONF_802154G && defined(SICSLOWPAN_CONF_MAC_MAX_PAYLOAD) && \
+  SICSLOWPAN_CONF_MAC_MAX_PAYLOAD > 127
+/* Large 802.15.4g frames as configured for 6LoWPAN */
+#define CC1200_MAX_PAYLOAD_LEN           SICSLOWPAN_CONF_MAC_MAX_PAYLOAD
 #else
 #define CC1200_MAX_PAYLOAD_LEN           127
 #endif
@@ -210,5 +219,16 @@
 #define CC1200_RX_LEDS                  CC1200_CONF_RX_LEDS
 #endif
 /*---------------------------------------------------------------------------*/
+/*
+ * The number of entries in the source address match table. The driver
+ * sets the frame pending bit in the ACKs it sends to these sources when
+ * RADIO_RX_MODE_AUTOPEND is enabled.
+ */
+#ifdef CC1200_CONF_SRC_MATCH_ENTRIES
+#define CC1200_SRC_MATCH_ENTRIES        CC1200_CONF_SRC_MATCH_ENTRIES
+#else
+#define CC1200_SRC_MATCH_ENTRIES        4
+#endif
+/*---------------------------------------------------------------------------*/
 
 #endif /* CC1200_H_ */
@@ -258,6 +258,8 @@ extern const cc1200_rf_cfg_t CC1200_RF_CFG;
 /*---------------------------------------------------------------------------*/
 /* Length of 802.15.4 ACK. We discard packets with a smaller size */
 #define ACK_LEN                         3
+/* The frame pending bit in the first byte of the frame control field */
+#define ACK_FRAME_PENDING               0x10
 /*---------------------------------------------------------------------------*/
 /* This is the way we handle the LEDs */
 /*---------------------------------------------------------------------------*/
@@ -416,6 +418,11 @@ static unsigned long cal_timer;
 /* Timer used for RX watchdog */
 static struct etimer et;
 #endif /* #if CC1200_USE_RX_WATCHDOG */
+/* Source address match table. An entry with len == 0 is free */
+static struct {
+  uint8_t len;
+  uint8_t addr[8];
+} src_match[CC1200_SRC_MATCH_ENTRIES];
 /*---------------------------------------------------------------------------*/
 /* Prototypes for Netstack API radio driver functions */
 /*---------------------------------------------------------------------------*/
@@ -1290,6 +1297,23 @@ get_object(radio_param_t param, void *dest, size_t size)
 
   return RADIO_RESULT_NOT_SUPPORTED;
 
+}
+/*---------------------------------------------------------------------------*/
+/* Look up a source in the source address match table. */
+static int
+src_match_find(const uint8_t *addr, size_t size)
+{
+
+  int i;
+
+  for(i = 0; i < CC1200_SRC_MATCH_ENTRIES; i++) {
+    if(src_match[i].len == size && memcmp(src_match[i].addr, addr, size) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+
 }
 /*---------------------------------------------------------------------------*/
 /* Set a radio parameter object. */
@@ -1297,7 +1321,51 @@ static radio_result_t
 set_object(radio_param_t param, const void *src, size_t size)
 {
 
-  return RADIO_RESULT_NOT_SUPPORTED;
+  int i;
+
+  switch(param) {
+  case RADIO_PARAM_SRC_MATCH_ADD:
+
+    if(src == NULL || (size != 2 && size != 8)) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+
+    if(src_match_find(src, size) >= 0) {
+      return RADIO_RESULT_OK;
+    }
+
+    for(i = 0; i < CC1200_SRC_MATCH_ENTRIES; i++) {
+      if(src_match[i].len == 0) {
+        memcpy(src_match[i].addr, src, size);
+        src_match[i].len = size;
+        return RADIO_RESULT_OK;
+      }
+    }
+
+    return RADIO_RESULT_ERROR;
+
+  case RADIO_PARAM_SRC_MATCH_REMOVE:
+
+    if(src == NULL) {
+      if(size != 0) {
+        return RADIO_RESULT_INVALID_VALUE;
+      }
+      memset(src_match, 0, sizeof(src_match));
+      return RADIO_RESULT_OK;
+    }
+
+    i = src_match_find(src, size);
+    if(i >= 0) {
+      src_match[i].len = 0;
+    }
+
+    return RADIO_RESULT_OK;
+
+  default:
+
+    return RADIO_RESULT_NOT_SUPPORTED;
+
+  }
 
 }
 /*---------------------------------------------------------------------------*/
@@ -2127,10 +2195,11 @@ addr_check_auto_ack(uint8_t *frame, uint16_t frame_len)
 
     if(!(rx_mode_value & RADIO_RX_MODE_ADDRESS_FILTER) ||
        info154.fcf.frame_type == FRAME802154_ACKFRAME ||
-       is_broadcast_addr(info154.fcf.dest_addr_mode,
-                         (uint8_t *)&info154.dest_addr) ||
-       linkaddr_cmp((linkaddr_t *)&info154.dest_addr,
-                    &linkaddr_node_addr)) {
+       (frame802154_check_dest_panid(&info154) &&
+        (is_broadcast_addr(info154.fcf.dest_addr_mode,
+                           (uint8_t *)&info154.dest_addr) ||
+         linkaddr_cmp((linkaddr_t *)&info154.dest_addr,
+                      &linkaddr_node_addr)))) {
 
       /* 
        * Address check succeeded or address filter disabled. 
@@ -2154,6 +2223,14 @@ addr_check_auto_ack(uint8_t *frame, uint16_t frame_len)
 
         uint8_t ack[ACK_LEN] = { FRAME802154_ACKFRAME, 0, info154.seq };
 
+        if((rx_mode_value & RADIO_RX_MODE_AUTOPEND) &&
+           info154.fcf.src_addr_mode != FRAME802154_NOADDR &&
+           src_match_find(info154.src_addr,
+                          info154.fcf.src_addr_mode ==
+                          FRAME802154_SHORTADDRMODE ? 2 : 8) >= 0) {
+          ack[0] |= ACK_FRAME_PENDING;
+        }
+
 #if (RXOFF_MODE_RX == 1)
         /*
          * This turns off GPIOx interrupts. Make sure they are turned on
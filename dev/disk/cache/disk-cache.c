@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \addtogroup disk-cache
+ * @{
+ *
+ * \file
+ * Implementation of the disk sector cache.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "contiki.h"
+#include "disk-cache.h"
+
+#if DISK_CACHE_SECTORS
+
+#define FLAG_VALID      0x01
+#define FLAG_DIRTY      0x02
+
+static struct entry {
+  uint32_t sector;
+  uint16_t last_use;
+  uint8_t dev;
+  uint8_t flags;
+} entries[DISK_CACHE_SECTORS];
+
+static uint8_t data[DISK_CACHE_SECTORS][DISK_CACHE_SECTOR_SIZE];
+static uint16_t use_count;
+
+/*----------------------------------------------------------------------------*/
+static struct entry *
+lookup(uint8_t dev, uint32_t sector)
+{
+  struct entry *e;
+
+  for(e = entries; e < &entries[DISK_CACHE_SECTORS]; e++) {
+    if((e->flags & FLAG_VALID) && e->dev == dev && e->sector == sector) {
+      e->last_use = ++use_count;
+      return e;
+    }
+  }
+  return NULL;
+}
+/*----------------------------------------------------------------------------*/
+static disk_result_t
+flush(struct entry *e)
+{
+  disk_result_t res;
+
+  if(!(e->flags & FLAG_DIRTY)) {
+    return DISK_RESULT_OK;
+  }
+  res = DISK_CACHE_DRIVER.write(e->dev, data[e - entries], e->sector, 1);
+  if(res == DISK_RESULT_OK) {
+    e->flags &= ~FLAG_DIRTY;
+  }
+  return res;
+}
+/*----------------------------------------------------------------------------*/
+static disk_result_t
+flush_range(uint8_t dev, uint32_t sector, uint32_t count)
+{
+  struct entry *e;
+  disk_result_t res;
+
+  for(e = entries; e < &entries[DISK_CACHE_SECTORS]; e++) {
+    if((e->flags & FLAG_VALID) && e->dev == dev &&
+       e->sector - sector < count) {
+      res = flush(e);
+      if(res != DISK_RESULT_OK) {
+        return res;
+      }
+    }
+  }
+  return DISK_RESULT_OK;
+}
+/*----------------------------------------------------------------------------*/
+static void
+drop_range(uint8_t dev, uint32_t sector, uint32_t count)
+{
+  struct entry *e;
+
+  for(e = entries; e < &entries[DISK_CACHE_SECTORS]; e++) {
+    if(e->dev == dev && e->sector - sector < count) {
+      e->flags = 0;
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+/* Frees the least recently used entry for a new sector */
+static struct entry *
+allocate(uint8_t dev, uint32_t sector)
+{
+  struct entry *e, *victim;
+
+  victim = entries;
+  for(e = entries; e < &entries[DISK_CACHE_SECTORS]; e++) {
+    if(!(e->flags & FLAG_VALID)) {
+      victim = e;
+      break;
+    }
+    if((uint16_t)(use_count - e->last_use) >
+       (uint16_t)(use_count - victim->last_use)) {
+      victim = e;
+    }
+  }
+  if(flush(victim) != DISK_RESULT_OK) {
+    return NULL;
+  }
+  victim->dev = dev;
+  victim->sector = sector;
+  victim->flags = 0;
+  victim->last_use = ++use_count;
+  return victim;
+}
+/*----------------------------------------------------------------------------*/
+static disk_status_t
+cache_status(uint8_t dev)
+{
+  return DISK_CACHE_DRIVER.status(dev);
+}
+/*----------------------------------------------------------------------------*/
+static disk_status_t
+cache_initialize(uint8_t dev)
+{
+  /* The medium may have been replaced. */
+  drop_range(dev, 0, UINT32_MAX);
+  return DISK_CACHE_DRIVER.initialize(dev);
+}
+/*----------------------------------------------------------------------------*/
+static disk_result_t
+cache_read(uint8_t dev, void *buff, uint32_t sector, uint32_t count)
+{
+  struct entry *e;
+  disk_result_t res;
+
+  if(count != 1) {
+    res = flush_range(dev, sector, count);
+    if(res != DISK_RESULT_OK) {
+      return res;
+    }
+    return DISK_CACHE_DRIVER.read(dev, buff, sector, count);
+  }
+
+  e = lookup(dev, sector);
+  if(e == NULL) {
+    e = allocate(dev, sector);
+    if(e == NULL) {
+      return DISK_RESULT_IO_ERROR;
+    }
+    res = DISK_CACHE_DRIVER.read(dev, data[e - entries], sector, 1);
+    if(res != DISK_RESULT_OK) {
+      return res;
+    }
+    e->flags = FLAG_VALID;
+  }
+  memcpy(buff, data[e - entries], DISK_CACHE_SECTOR_SIZE);
+  return DISK_RESULT_OK;
+}
+/*----------------------------------------------------------------------------*/
+static disk_result_t
+cache_write(uint8_t dev, const void *buff, uint32_t sector, uint32_t count)
+{
+  struct entry *e;
+#if !DISK_CACHE_WRITE_BACK
+  disk_result_t res;
+#endif
+
+  if(count != 1) {
+    /* Cached copies are outdated by the write, dirty or not. */
+    drop_range(dev, sector, count);
+    return DISK_CACHE_DRIVER.write(dev, buff, sector, count);
+  }
+
+  if(!(cache_status(dev) & DISK_STATUS_WRITABLE)) {
+    return DISK_RESULT_WR_PROTECTED;
+  }
+
+  e = lookup(dev, sector);
+  if(e == NULL) {
+    e = allocate(dev, sector);
+    if(e == NULL) {
+      return DISK_RESULT_IO_ERROR;
+    }
+  }
+  memcpy(data[e - entries], buff, DISK_CACHE_SECTOR_SIZE);
+  e->flags = FLAG_VALID | FLAG_DIRTY;
+#if DISK_CACHE_WRITE_BACK
+  return DISK_RESULT_OK;
+#else
+  res = flush(e);
+  if(res != DISK_RESULT_OK) {
+    e->flags = 0;
+  }
+  return res;
+#endif
+}
+/*----------------------------------------------------------------------------*/
+static disk_result_t
+cache_ioctl(uint8_t dev, uint8_t cmd, void *buff)
+{
+  disk_result_t res;
+
+  switch(cmd) {
+  case DISK_IOCTL_CTRL_SYNC:
+    res = flush_range(dev, 0, UINT32_MAX);
+    if(res != DISK_RESULT_OK) {
+      return res;
+    }
+    break;
+  case DISK_IOCTL_CTRL_TRIM:
+    drop_range(dev, ((uint32_t *)buff)[0],
+               ((uint32_t *)buff)[1] - ((uint32_t *)buff)[0] + 1);
+    break;
+  }
+  return DISK_CACHE_DRIVER.ioctl(dev, cmd, buff);
+}
+/*----------------------------------------------------------------------------*/
+const struct disk_driver disk_cache_driver = {
+  .status     = cache_status,
+  .initialize = cache_initialize,
+  .read       = cache_read,
+  .write      = cache_write,
+  .ioctl      = cache_ioctl
+};
+/*----------------------------------------------------------------------------*/
+#endif /* DISK_CACHE_SECTORS */
+
+/** @} */
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \addtogroup disk
+ * @{
+ *
+ * \defgroup disk-cache Disk sector cache
+ *
+ * N-way sector cache in front of a disk device driver. Single-sector
+ * accesses, as done by file systems for their allocation tables and
+ * directories, are served from RAM when possible. Multiple-sector
+ * accesses go straight to the driver, which can use its multiple-block
+ * commands for them.
+ * @{
+ *
+ * \file
+ * Header file for the disk sector cache.
+ */
+#ifndef DISK_CACHE_H_
+#define DISK_CACHE_H_
+
+#include "contiki-conf.h"
+#include "../disk.h"
+
+#ifdef DISK_CACHE_CONF_SECTORS
+/** Number of cached sectors, all devices included. 0 disables the cache. */
+#define DISK_CACHE_SECTORS      DISK_CACHE_CONF_SECTORS
+#else
+#define DISK_CACHE_SECTORS      0
+#endif
+
+#ifdef DISK_CACHE_CONF_SECTOR_SIZE
+/** Sector size of the cached device. */
+#define DISK_CACHE_SECTOR_SIZE  DISK_CACHE_CONF_SECTOR_SIZE
+#else
+#define DISK_CACHE_SECTOR_SIZE  512
+#endif
+
+#ifdef DISK_CACHE_CONF_WRITE_BACK
+/**
+ * Whether writes stay in the cache until they are evicted or
+ * DISK_IOCTL_CTRL_SYNC is issued, instead of being written through.
+ */
+#define DISK_CACHE_WRITE_BACK   DISK_CACHE_CONF_WRITE_BACK
+#else
+#define DISK_CACHE_WRITE_BACK   0
+#endif
+
+#ifdef DISK_CACHE_CONF_DRIVER
+/** Driver of the cached device. */
+#define DISK_CACHE_DRIVER       DISK_CACHE_CONF_DRIVER
+#else
+#define DISK_CACHE_DRIVER       mmc_driver
+#endif
+
+extern const struct disk_driver DISK_CACHE_DRIVER;
+extern const struct disk_driver disk_cache_driver;
+
+#endif /* DISK_CACHE_H_ */
+
+/**
+ * @}
+ * @}
+ */
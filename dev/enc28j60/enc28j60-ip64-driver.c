@@ -83,15 +83,35 @@ PROCESS_THREAD(enc28j60_ip64_driver_process, ev, data)
 {
   static int len;
   static struct etimer e;
+  int frames;
   PROCESS_BEGIN();
 
+  enc28j60_set_input_process(PROCESS_CURRENT());
+
   while(1) {
-    etimer_set(&e, 1);
-    PROCESS_WAIT_EVENT();
-    len = enc28j60_read(ip64_packet_buffer, ip64_packet_buffer_maxlen);
-    if(len > 0) {
+    /* Several frames may be waiting in the RX ring. Take a burst of
+       them now and come back for the rest after the other processes
+       have run. Frames that were already waiting when INT was set up
+       are taken on the first pass. */
+    for(frames = 0; frames < ENC28J60_RX_BURST; frames++) {
+      len = enc28j60_read(ip64_packet_buffer, ip64_packet_buffer_maxlen);
+      if(len <= 0) {
+        break;
+      }
       IP64_INPUT(ip64_packet_buffer, len);
     }
+    if(frames == ENC28J60_RX_BURST) {
+      process_poll(PROCESS_CURRENT());
+    }
+
+#if ENC28J60_INTERRUPT
+    /* The timer only covers an edge on INT that was missed, e.g.
+       while the chip was being reset by its watchdog */
+    etimer_set(&e, CLOCK_SECOND);
+#else
+    etimer_set(&e, 1);
+#endif
+    PROCESS_WAIT_EVENT();
   }
 
   PROCESS_END();
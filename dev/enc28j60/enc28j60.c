@@ -58,6 +58,9 @@
 
 #define EIR_TXIF      0x08
 
+#define EIE_INTIE     0x80
+#define EIE_PKTIE     0x40
+
 #define ERXTX_BANK 0x00
 
 #define ERDPTL 0x00
@@ -131,6 +134,7 @@ static uint8_t bank = ERXTX_BANK;
 static uint8_t enc_mac_addr[6];
 static int received_packets = 0;
 static int sent_packets = 0;
+static struct process *input_process;
 
 /*---------------------------------------------------------------------------*/
 static uint8_t
@@ -209,13 +213,19 @@ setregbank(uint8_t new_bank)
 static void
 writedata(const uint8_t *data, int datalen)
 {
+#if !ENC28J60_ARCH_SPI_BLOCK
   int i;
+#endif
   enc28j60_arch_spi_select();
   /* The Write Buffer Memory (WBM) command is 0 1 1 1 1 0 1 0  */
   enc28j60_arch_spi_write(0x7a);
+#if ENC28J60_ARCH_SPI_BLOCK
+  enc28j60_arch_spi_write_block(data, datalen);
+#else
   for(i = 0; i < datalen; i++) {
     enc28j60_arch_spi_write(data[i]);
   }
+#endif
   enc28j60_arch_spi_deselect();
 }
 /*---------------------------------------------------------------------------*/
@@ -232,21 +242,18 @@ readdata(uint8_t *buf, int len)
   enc28j60_arch_spi_select();
   /* THe Read Buffer Memory (RBM) command is 0 0 1 1 1 0 1 0 */
   enc28j60_arch_spi_write(0x3a);
+#if ENC28J60_ARCH_SPI_BLOCK
+  enc28j60_arch_spi_read_block(buf, len);
+  i = len;
+#else
   for(i = 0; i < len; i++) {
     buf[i] = enc28j60_arch_spi_read();
   }
+#endif
   enc28j60_arch_spi_deselect();
   return i;
 }
 /*---------------------------------------------------------------------------*/
-static uint8_t
-readdatabyte(void)
-{
-  uint8_t r;
-  readdata(&r, 1);
-  return r;
-}
-/*---------------------------------------------------------------------------*/
 static void
 softreset(void)
 {
@@ -472,6 +479,11 @@ reset(void)
   /* Turn on autoincrement for buffer access */
   setregbitfield(ECON2, ECON2_AUTOINC);
 
+#if ENC28J60_INTERRUPT
+  /* Assert INT while EPKTCNT is non-zero */
+  writereg(EIE, EIE_INTIE | EIE_PKTIE);
+#endif
+
   /* Turn on reception */
   writereg(ECON1, ECON1_RXEN);
 }
@@ -493,6 +505,28 @@ enc28j60_init(const uint8_t *mac_addr)
   PRINTF("ENC28J60 rev. B%d\n", readrev());
 
   initialized = 1;
+
+#if ENC28J60_INTERRUPT
+  enc28j60_arch_irq_init();
+#endif
+}
+/*---------------------------------------------------------------------------*/
+void
+enc28j60_set_input_process(struct process *p)
+{
+  input_process = p;
+}
+/*---------------------------------------------------------------------------*/
+void
+enc28j60_interrupt(void)
+{
+  /* Only wake the reader here, so that the SPI bus is never used from
+     interrupt context. INT goes high again when the reader has taken
+     the last frame out of the RX ring, so a frame that arrives later
+     raises a new edge. */
+  if(input_process != NULL) {
+    process_poll(input_process);
+  }
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -580,18 +614,15 @@ enc28j60_send(const uint8_t *data, uint16_t datalen)
   return datalen;
 }
 /*---------------------------------------------------------------------------*/
-int
-enc28j60_read(uint8_t *buffer, uint16_t bufsize)
+static int
+read_frame(uint8_t *buffer, uint16_t bufsize)
 {
   int n, len, next, err;
 
-  uint8_t nxtpkt[2];
-  uint8_t status[2];
-  uint8_t length[2];
-
-  if(!initialized) {
-    return -1;
-  }
+  uint8_t header[6];
+  uint8_t *nxtpkt;
+  uint8_t *status;
+  uint8_t *length;
 
   err = 0;
 
@@ -605,20 +636,15 @@ enc28j60_read(uint8_t *buffer, uint16_t bufsize)
   PRINTF("enc28j60: EPKTCNT 0x%02x\n", n);
 
   setregbank(ERXTX_BANK);
-  /* Read the next packet pointer */
-  nxtpkt[0] = readdatabyte();
-  nxtpkt[1] = readdatabyte();
+  /* Read the next packet pointer, the length and the status vector */
+  readdata(header, sizeof(header));
+  nxtpkt = &header[0];
+  length = &header[2];
+  status = &header[4];
 
   PRINTF("enc28j60: nxtpkt 0x%02x%02x\n", nxtpkt[1], nxtpkt[0]);
-
-  length[0] = readdatabyte();
-  length[1] = readdatabyte();
-
   PRINTF("enc28j60: length 0x%02x%02x\n", length[1], length[0]);
 
-  status[0] = readdatabyte();
-  status[1] = readdatabyte();
-
   /* This statement is just to avoid a compiler warning: */
   status[0] = status[0];
   PRINTF("enc28j60: status 0x%02x%02x\n", status[1], status[0]);
@@ -627,20 +653,13 @@ enc28j60_read(uint8_t *buffer, uint16_t bufsize)
   if(bufsize >= len) {
     readdata(buffer, len);
   } else {
-    uint16_t i;
-
     err = 1;
-
-    /* flush rx fifo */
-    for(i = 0; i < len; i++) {
-      readdatabyte();
-    }
   }
 
-  /* Read an additional byte at odd lengths, to avoid FIFO corruption */
-  if((len % 2) != 0) {
-    readdatabyte();
-  }
+  /* Move the read pointer to the next packet, which also skips the
+     padding after odd lengths and frames that did not fit */
+  writereg(ERDPTL, nxtpkt[0]);
+  writereg(ERDPTH, nxtpkt[1]);
 
   /* Errata #14 */
   next = (nxtpkt[1] << 8) + nxtpkt[0];
@@ -656,7 +675,7 @@ enc28j60_read(uint8_t *buffer, uint16_t bufsize)
 
   if(err) {
     PRINTF("enc28j60: rx err: flushed %d\n", len);
-    return 0;
+    return -1;
   }
   PRINTF("enc28j60: rx: %d: %02x:%02x:%02x:%02x:%02x:%02x\n", len,
          0xff & buffer[0], 0xff & buffer[1], 0xff & buffer[2],
@@ -667,6 +686,24 @@ enc28j60_read(uint8_t *buffer, uint16_t bufsize)
   return len;
 }
 /*---------------------------------------------------------------------------*/
+int
+enc28j60_read(uint8_t *buffer, uint16_t bufsize)
+{
+  int len;
+
+  if(!initialized) {
+    return -1;
+  }
+
+  /* Skip the frames that do not fit, so that 0 means that the RX ring
+     is empty */
+  do {
+    len = read_frame(buffer, bufsize);
+  } while(len < 0);
+
+  return len;
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(enc_watchdog_process, ev, data)
 {
   static struct etimer et;
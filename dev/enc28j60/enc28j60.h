@@ -32,12 +32,50 @@
 #ifndef ENC28J60_H
 #define ENC28J60_H
 
+#include "contiki.h"
+
+/* With ENC28J60_CONF_INTERRUPT, the chip asserts its INT pin while
+   received frames are waiting in its RX ring. The platform must then
+   implement enc28j60_arch_irq_init() and call enc28j60_interrupt()
+   from the handler of the falling edge on that pin. */
+#ifdef ENC28J60_CONF_INTERRUPT
+#define ENC28J60_INTERRUPT ENC28J60_CONF_INTERRUPT
+#else
+#define ENC28J60_INTERRUPT 0
+#endif
+
+/* With ENC28J60_CONF_ARCH_SPI_BLOCK, the platform moves frame data
+   with enc28j60_arch_spi_read_block() and
+   enc28j60_arch_spi_write_block(), using DMA if it has it, instead of
+   one enc28j60_arch_spi_read() or enc28j60_arch_spi_write() call per
+   byte. */
+#ifdef ENC28J60_CONF_ARCH_SPI_BLOCK
+#define ENC28J60_ARCH_SPI_BLOCK ENC28J60_CONF_ARCH_SPI_BLOCK
+#else
+#define ENC28J60_ARCH_SPI_BLOCK 0
+#endif
+
+/* The number of frames that the ENC28J60 IP64 driver takes from the
+   RX ring before it yields to other processes. */
+#ifdef ENC28J60_CONF_RX_BURST
+#define ENC28J60_RX_BURST ENC28J60_CONF_RX_BURST
+#else
+#define ENC28J60_RX_BURST 4
+#endif
+
 void enc28j60_init(const uint8_t *mac_addr);
 
 int enc28j60_send(const uint8_t *data, uint16_t datalen);
 
 int enc28j60_read(uint8_t *buffer, uint16_t bufsize);
 
+/* Set the process that is polled when the INT pin signals received
+   frames. */
+void enc28j60_set_input_process(struct process *p);
+
+/* Called by the platform from the INT pin interrupt handler. */
+void enc28j60_interrupt(void);
+
 /* ENC28J60 architecture-specific SPI functions that are called by the
    enc28j60 driver and must be implemented by the platform code */
 
@@ -47,5 +85,12 @@ uint8_t enc28j60_arch_spi_read(void);
 void enc28j60_arch_spi_select(void);
 void enc28j60_arch_spi_deselect(void);
 
+/* Only needed with ENC28J60_CONF_ARCH_SPI_BLOCK */
+void enc28j60_arch_spi_read_block(uint8_t *buf, uint16_t len);
+void enc28j60_arch_spi_write_block(const uint8_t *buf, uint16_t len);
+
+/* Only needed with ENC28J60_CONF_INTERRUPT */
+void enc28j60_arch_irq_init(void);
+
 
 #endif /* ENC28J60_H */
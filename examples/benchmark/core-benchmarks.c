@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	Benchmarks of core data structures and kernels, to measure the
+ *	effect of performance changes in a repeatable way.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "benchmark.h"
+
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "lib/mmem.h"
+#include "lib/crc16.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include "net/nbr-table.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-route.h"
+
+PROCESS(benchmark_process, "Core benchmarks");
+AUTOSTART_PROCESSES(&benchmark_process);
+
+/* Iteration counts keep every loop well below the two seconds a
+   16-bit 32 kHz rtimer takes to wrap on the Tmote Sky. */
+BENCHMARK_REGISTER(list, "list_add() and list_remove() on 8 items", 1000);
+BENCHMARK_REGISTER(memb, "memb_alloc() and memb_free()", 1000);
+BENCHMARK_REGISTER(mmem, "mmem_free() and mmem_alloc() of 4 blocks", 500);
+BENCHMARK_REGISTER(nbr_table, "nbr_table_get_from_lladdr() on 4 entries", 1000);
+BENCHMARK_REGISTER(route_lookup, "uip_ds6_route_lookup() on 8 routes", 500);
+BENCHMARK_REGISTER(aes_128, "AES-128 encryption of one block", 100);
+BENCHMARK_REGISTER(ccm_star, "CCM* of 32 bytes, 8 bytes adata, 8 byte MIC", 20);
+BENCHMARK_REGISTER(crc16, "crc16_data() over 64 bytes", 200);
+BENCHMARK_REGISTER(chksum, "uip_chksum() over 64 bytes", 200);
+
+#define LIST_ITEMS 8
+#define MMEM_BLOCKS 4
+#define NBR_ENTRIES 4
+#define ROUTES 8
+
+struct item {
+  struct item *next;
+  int value;
+};
+
+struct bench_nbr {
+  uint8_t value;
+};
+
+static struct item items[LIST_ITEMS];
+LIST(bench_list);
+MEMB(bench_memb, struct item, LIST_ITEMS);
+NBR_TABLE(struct bench_nbr, bench_nbrs);
+
+static uint8_t input[64];
+static const uint8_t key[16] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+/* Defeats the optimizer, which could otherwise drop loops whose
+   results are not used. */
+static volatile uint16_t sink;
+/*---------------------------------------------------------------------------*/
+BENCHMARK(list)
+{
+  uint32_t i;
+  int j;
+
+  list_init(bench_list);
+  for(j = 0; j < LIST_ITEMS - 1; j++) {
+    list_add(bench_list, &items[j]);
+  }
+
+  BENCHMARK_START();
+  for(i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    list_add(bench_list, &items[LIST_ITEMS - 1]);
+    list_remove(bench_list, &items[LIST_ITEMS - 1]);
+  }
+  BENCHMARK_STOP();
+
+  sink = list_length(bench_list);
+}
+/*---------------------------------------------------------------------------*/
+BENCHMARK(memb)
+{
+  uint32_t i;
+  struct item *item;
+
+  memb_init(&bench_memb);
+
+  BENCHMARK_START();
+  for(i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    item = memb_alloc(&bench_memb);
+    memb_free(&bench_memb, item);
+  }
+  BENCHMARK_STOP();
+
+  sink = (item != NULL);
+}
+/*---------------------------------------------------------------------------*/
+BENCHMARK(mmem)
+{
+  static struct mmem blocks[MMEM_BLOCKS];
+  uint32_t i;
+  int j;
+
+  mmem_init();
+  for(j = 0; j < MMEM_BLOCKS; j++) {
+    mmem_alloc(&blocks[j], 32);
+  }
+
+  /* Freeing the oldest block moves all later ones down */
+  BENCHMARK_START();
+  for(i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    j = i % MMEM_BLOCKS;
+    mmem_free(&blocks[j]);
+    mmem_alloc(&blocks[j], 32);
+  }
+  BENCHMARK_STOP();
+
+  for(j = 0; j < MMEM_BLOCKS; j++) {
+    mmem_free(&blocks[j]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+BENCHMARK(nbr_table)
+{
+  linkaddr_t addr[NBR_ENTRIES];
+  struct bench_nbr *nbr;
+  uint32_t i;
+  int j;
+
+  nbr_table_register(bench_nbrs, NULL);
+  memset(addr, 0, sizeof(addr));
+  for(j = 0; j < NBR_ENTRIES; j++) {
+    addr[j].u8[LINKADDR_SIZE - 1] = j + 1;
+    nbr_table_add_lladdr(bench_nbrs, &addr[j], NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+
+  BENCHMARK_START();
+  for(i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    nbr = nbr_table_get_from_lladdr(bench_nbrs, &addr[i % NBR_ENTRIES]);
+  }
+  BENCHMARK_STOP();
+
+  sink = (nbr != NULL);
+  for(j = 0; j < NBR_ENTRIES; j++) {
+    nbr_table_remove(bench_nbrs, nbr_table_get_from_lladdr(bench_nbrs, &addr[j]));
+  }
+}
+/*---------------------------------------------------------------------------*/
+BENCHMARK(route_lookup)
+{
+  uip_ipaddr_t nexthop;
+  uip_ipaddr_t addr[ROUTES];
+  uip_lladdr_t lladdr;
+  uip_ds6_route_t *r;
+  uint32_t i;
+  int j;
+
+  uip_ip6addr(&nexthop, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  memset(&lladdr, 0, sizeof(lladdr));
+  lladdr.addr[sizeof(lladdr.addr) - 1] = 1;
+  uip_ds6_nbr_add(&nexthop, &lladdr, 1, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+  for(j = 0; j < ROUTES; j++) {
+    uip_ip6addr(&addr[j], 0xfd00, 0, 0, 0, 0, 0, 0, j + 1);
+    uip_ds6_route_add(&addr[j], 128, &nexthop);
+  }
+
+  BENCHMARK_START();
+  for(i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    r = uip_ds6_route_lookup(&addr[i % ROUTES]);
+  }
+  BENCHMARK_STOP();
+
+  sink = (r != NULL);
+  uip_ds6_route_rm_by_nexthop(&nexthop);
+}
+/*---------------------------------------------------------------------------*/
+BENCHMARK(aes_128)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+  uint32_t i;
+
+  memset(block, 0, sizeof(block));
+  AES_128.set_key(key);
+
+  BENCHMARK_START();
+  for(i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    AES_128.encrypt(block);
+  }
+  BENCHMARK_STOP();
+
+  sink = block[0];
+}
+/*---------------------------------------------------------------------------*/
+BENCHMARK(ccm_star)
+{
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t mic[8];
+  uint32_t i;
+
+  memset(nonce, 0, sizeof(nonce));
+  CCM_STAR.set_key(key);
+
+  BENCHMARK_START();
+  for(i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    CCM_STAR.aead(nonce, input + 8, 32, input, 8, mic, sizeof(mic), 1);
+  }
+  BENCHMARK_STOP();
+
+  sink = mic[0];
+}
+/*---------------------------------------------------------------------------*/
+BENCHMARK(crc16)
+{
+  unsigned short crc;
+  uint32_t i;
+
+  crc = 0;
+
+  BENCHMARK_START();
+  for(i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    crc = crc16_data(input, sizeof(input), crc);
+  }
+  BENCHMARK_STOP();
+
+  sink = crc;
+}
+/*---------------------------------------------------------------------------*/
+BENCHMARK(chksum)
+{
+  static uint16_t words[sizeof(input) / 2];
+  uint16_t sum;
+  uint32_t i;
+
+  memcpy(words, input, sizeof(words));
+  sum = 0;
+
+  BENCHMARK_START();
+  for(i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    sum += uip_chksum(words, sizeof(words));
+  }
+  BENCHMARK_STOP();
+
+  sink = sum;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(benchmark_process, ev, data)
+{
+  static struct etimer et;
+  unsigned i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(input); i++) {
+    input[i] = i;
+  }
+  benchmark_init();
+
+  /* Let the system settle before timing anything */
+  etimer_set(&et, CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  BENCHMARK_RUN(list);
+  BENCHMARK_RUN(memb);
+  BENCHMARK_RUN(mmem);
+  BENCHMARK_RUN(nbr_table);
+  BENCHMARK_RUN(route_lookup);
+  BENCHMARK_RUN(aes_128);
+  BENCHMARK_RUN(ccm_star);
+  BENCHMARK_RUN(crc16);
+  BENCHMARK_RUN(chksum);
+
+  printf("Benchmarks done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
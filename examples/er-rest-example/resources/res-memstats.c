@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Memory and stack high-water marks, for sizing the memory
+ *      blocks and stacks of a node from real traffic
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "rest-engine.h"
+#include "lib/memb.h"
+#include "lib/mmem.h"
+#include "sys/stack-check.h"
+
+/* Also show the managed memory, which is then linked in */
+#ifdef RES_MEMSTATS_CONF_MMEM
+#define RES_MEMSTATS_MMEM RES_MEMSTATS_CONF_MMEM
+#else
+#define RES_MEMSTATS_MMEM 0
+#endif
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+static void res_post_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+
+/*
+ * One line per memory block (with MEMB_CONF_STATS), for the managed memory
+ * and per stack on the list of stacks, in the format of the "memstats" shell
+ * command. The list is longer than a block, so it is sent blockwise. A POST
+ * restarts the high-water marks.
+ */
+RESOURCE(res_memstats,
+         "title=\"Memory statistics\";rt=\"Text\"",
+         res_get_handler,
+         res_post_handler,
+         NULL,
+         NULL);
+
+/* The part of the text in the current block */
+static uint8_t *block;
+static uint16_t block_len;
+static uint16_t block_size;
+static int32_t block_start;
+/* The position in the whole text */
+static int32_t pos;
+
+static void
+add_line(const char *line)
+{
+  for(; *line != '\0'; line++, pos++) {
+    if(pos >= block_start && block_len < block_size) {
+      block[block_len++] = *line;
+    }
+  }
+}
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  char line[64];
+#if MEMB_STATS
+  struct memb *m;
+#endif
+#if RES_MEMSTATS_MMEM
+  struct mmem_stats mstats;
+#endif
+  struct stack_check *s;
+
+  block = buffer;
+  block_len = 0;
+  block_size = preferred_size;
+  block_start = *offset;
+  pos = 0;
+
+#if MEMB_STATS
+  for(m = memb_stats_head(); m != NULL; m = memb_stats_next(m)) {
+    snprintf(line, sizeof(line), "memb %s %u/%u peak %u failed %u\n",
+             m->name, m->used, m->num, m->peak, m->failed);
+    add_line(line);
+  }
+#endif /* MEMB_STATS */
+
+#if RES_MEMSTATS_MMEM
+  mmem_get_stats(&mstats);
+  snprintf(line, sizeof(line), "mmem %u/%u peak %u failed %u\n",
+           mstats.size - mstats.avail, mstats.size,
+           mstats.peak, mstats.failed);
+  add_line(line);
+#endif /* RES_MEMSTATS_MMEM */
+
+  for(s = stack_check_head(); s != NULL; s = stack_check_next(s)) {
+    snprintf(line, sizeof(line), "stack %s %u/%u\n",
+             s->name, stack_check_usage(s->bottom, s->size), s->size);
+    add_line(line);
+  }
+
+  /* The text may have become shorter since the previous block */
+  if(*offset > 0 && *offset >= pos) {
+    REST.set_response_status(response, REST.status.BAD_OPTION);
+    const char *error_msg = "BlockOutOfScope";
+    REST.set_response_payload(response, error_msg, strlen(error_msg));
+    return;
+  }
+
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  REST.set_response_payload(response, buffer, block_len);
+
+  *offset += block_len;
+  if(*offset >= pos) {
+    *offset = -1;
+  }
+}
+static void
+res_post_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+#if MEMB_STATS
+  struct memb *m;
+
+  for(m = memb_stats_head(); m != NULL; m = memb_stats_next(m)) {
+    memb_reset_peak(m);
+  }
+#endif /* MEMB_STATS */
+#if RES_MEMSTATS_MMEM
+  mmem_reset_peak();
+#endif /* RES_MEMSTATS_MMEM */
+  REST.set_response_status(response, REST.status.CHANGED);
+}
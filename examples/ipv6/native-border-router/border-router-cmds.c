@@ -72,6 +72,10 @@ border_router_cmd_handler(const uint8_t *data, int len)
       return 1;
     } else if(data[1] == 'M' && command_context == CMD_CONTEXT_RADIO) {
       /* We need to know that this is from the slip-radio here. */
+      if(slip_current_radio() != 0) {
+        /* Only the first radio defines our link-layer address. */
+        return 1;
+      }
       PRINTF("Setting MAC address\n");
       border_router_set_mac(&data[2]);
       return 1;
@@ -55,6 +55,23 @@
 #define MAX_CALLBACKS 16
 static int callback_pos;
 
+/* Neighbors remembered with the radio they were last heard on, so that
+   unicasts to them go out on that radio only. */
+#ifdef BORDER_ROUTER_RDC_CONF_RADIO_NBRS
+#define RADIO_NBRS BORDER_ROUTER_RDC_CONF_RADIO_NBRS
+#else
+#define RADIO_NBRS 32
+#endif
+
+struct radio_nbr {
+  linkaddr_t addr;
+  uint8_t radio;
+  uint8_t used;
+};
+
+static struct radio_nbr radio_nbrs[RADIO_NBRS];
+static int radio_nbr_pos;
+
 /* a structure for calling back when packet data is coming back
    from radio... */
 struct tx_callback {
@@ -62,18 +79,72 @@ struct tx_callback {
   void *ptr;
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  /* Radios that still have to report, and the best report so far */
+  uint8_t pending;
+  uint8_t status;
+  uint8_t tx;
 };
 
 static struct tx_callback callbacks[MAX_CALLBACKS];
 /*---------------------------------------------------------------------------*/
+static int
+radio_lookup(const linkaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < RADIO_NBRS; i++) {
+    if(radio_nbrs[i].used && linkaddr_cmp(&radio_nbrs[i].addr, addr)) {
+      return radio_nbrs[i].radio;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+radio_learn(const linkaddr_t *addr, int radio)
+{
+  int i;
+
+  if(slip_radio_count() < 2 || linkaddr_cmp(addr, &linkaddr_null)) {
+    return;
+  }
+  for(i = 0; i < RADIO_NBRS; i++) {
+    if(radio_nbrs[i].used && linkaddr_cmp(&radio_nbrs[i].addr, addr)) {
+      radio_nbrs[i].radio = radio;
+      return;
+    }
+  }
+  /* Not known: take the next slot, replacing the oldest entry. */
+  linkaddr_copy(&radio_nbrs[radio_nbr_pos].addr, addr);
+  radio_nbrs[radio_nbr_pos].radio = radio;
+  radio_nbrs[radio_nbr_pos].used = 1;
+  radio_nbr_pos = (radio_nbr_pos + 1) % RADIO_NBRS;
+}
+/*---------------------------------------------------------------------------*/
 void packet_sent(uint8_t sessionid, uint8_t status, uint8_t tx)
 {
   if(sessionid < MAX_CALLBACKS) {
     struct tx_callback *callback;
     callback = &callbacks[sessionid];
+    if(callback->pending == 0) {
+      PRINTF("br-rdc: unexpected report for sid %d\n", sessionid);
+      return;
+    }
+    /* A packet sent on several radios succeeded if any of them got it
+       through. */
+    if(callback->status == MAC_TX_ERR_FATAL || status == MAC_TX_OK) {
+      callback->status = status;
+      callback->tx = tx;
+    }
     packetbuf_clear();
     packetbuf_attr_copyfrom(callback->attrs, callback->addrs);
-    mac_call_sent_callback(callback->cback, callback->ptr, status, tx);
+    if(status == MAC_TX_OK && !packetbuf_holds_broadcast()) {
+      radio_learn(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), slip_current_radio());
+    }
+    if(--callback->pending == 0) {
+      mac_call_sent_callback(callback->cback, callback->ptr,
+                             callback->status, callback->tx);
+    }
   } else {
     PRINTF("*** ERROR: too high session id %d\n", sessionid);
   }
@@ -88,6 +159,9 @@ setup_callback(mac_callback_t sent, void *ptr)
   callback->cback = sent;
   callback->ptr = ptr;
   packetbuf_attr_copyto(callback->attrs, callback->addrs);
+  callback->pending = 0;
+  callback->status = MAC_TX_ERR_FATAL;
+  callback->tx = 0;
 
   callback_pos++;
   if(callback_pos >= MAX_CALLBACKS) {
@@ -104,6 +178,7 @@ send_packet(mac_callback_t sent, void *ptr)
   /* 3 bytes per packet attribute is required for serialization */
   uint8_t buf[PACKETBUF_NUM_ATTRS * 3 + PACKETBUF_SIZE + 3];
   uint8_t sid;
+  int radio;
 
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
 
@@ -134,7 +209,19 @@ send_packet(mac_callback_t sent, void *ptr)
       /* Copy packet data */
       memcpy(&buf[3 + size], packetbuf_hdrptr(), packetbuf_totlen());
 
-      write_to_slip(buf, packetbuf_totlen() + size + 3);
+      /* Unicasts to a neighbor we know go out on its radio; broadcasts
+         and unicasts to unknown neighbors go out on all of them. */
+      radio = -1;
+      if(slip_radio_count() > 1 && !packetbuf_holds_broadcast()) {
+        radio = radio_lookup(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+      }
+      if(radio >= 0) {
+        callbacks[sid].pending = 1;
+        write_to_slip_radio(radio, buf, packetbuf_totlen() + size + 3);
+      } else {
+        callbacks[sid].pending = slip_radio_count();
+        write_to_slip(buf, packetbuf_totlen() + size + 3);
+      }
     }
   }
 }
@@ -154,6 +241,7 @@ packet_input(void)
   if(NETSTACK_FRAMER.parse() < 0) {
     PRINTF("br-rdc: failed to parse %u\n", packetbuf_datalen());
   } else {
+    radio_learn(packetbuf_addr(PACKETBUF_ADDR_SENDER), slip_current_radio());
     NETSTACK_MAC.input();
   }
 }
@@ -180,6 +268,8 @@ static void
 init(void)
 {
   callback_pos = 0;
+  radio_nbr_pos = 0;
+  memset(radio_nbrs, 0, sizeof(radio_nbrs));
 }
 /*---------------------------------------------------------------------------*/
 const struct rdc_driver border_router_rdc_driver = {
@@ -140,6 +140,15 @@ ipaddr_add(const uip_ipaddr_t *addr)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+route_ipaddr_add(const uip_ds6_route_t *r)
+{
+  uip_ipaddr_t ipaddr;
+
+  uip_ds6_route_copy_ipaddr(&ipaddr, r);
+  ipaddr_add(&ipaddr);
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(generate_routes(struct httpd_state *s))
 {
@@ -170,7 +179,7 @@ PT_THREAD(generate_routes(struct httpd_state *s))
   for(r = uip_ds6_route_head();
       r != NULL;
       r = uip_ds6_route_next(r)) {
-    ipaddr_add(&r->ipaddr);
+    route_ipaddr_add(r);
     ADD("/%u (via ", r->length);
     ipaddr_add(uip_ds6_route_nexthop(r));
     if(r->state.lifetime < 600) {
@@ -236,7 +245,7 @@ print_local_addresses(void)
 static void
 request_mac(void)
 {
-  write_to_slip((uint8_t *)"?M", 2);
+  write_to_slip_radio(0, (uint8_t *)"?M", 2);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -41,9 +41,21 @@
 #include "net/ip/uip.h"
 #include <stdio.h>
 
+/* The number of slip-radios that can be attached (one -s option each) */
+#ifdef SLIP_DEV_CONF_MAX
+#define SLIP_DEV_MAX SLIP_DEV_CONF_MAX
+#else
+#define SLIP_DEV_MAX 4
+#endif
+
 int border_router_cmd_handler(const uint8_t *data, int len);
 int slip_config_handle_arguments(int argc, char **argv);
+/* Send to every radio, or to the radio with the given index */
 void write_to_slip(const uint8_t *buf, int len);
+void write_to_slip_radio(int radio, const uint8_t *buf, int len);
+/* Number of radios, and the one the input being handled came from */
+int slip_radio_count(void);
+int slip_current_radio(void);
 
 void border_router_set_prefix_64(const uip_ipaddr_t *prefix_64);
 void border_router_set_mac(const uint8_t *data);
@@ -52,7 +64,7 @@ void border_router_print_stat(void);
 
 void tun_init(void);
 
-int slip_init(void);
+void slip_init(void);
 int slip_set_fd(int maxfd, fd_set *rset, fd_set *wset);
 void slip_handle_fd(fd_set *rset, fd_set *wset);
 
@@ -46,12 +46,14 @@
 #include <sys/ioctl.h>
 #include <err.h>
 #include "contiki.h"
+#include "border-router.h"
 
 int slip_config_verbose = 0;
 const char *slip_config_ipaddr;
 int slip_config_flowcontrol = 0;
 int slip_config_timestamp = 0;
-const char *slip_config_siodev = NULL;
+const char *slip_config_siodevs[SLIP_DEV_MAX];
+int slip_config_siodev_count = 0;
 const char *slip_config_host = NULL;
 const char *slip_config_port = NULL;
 char slip_config_tundev[32] = { "" };
@@ -88,10 +90,13 @@ slip_config_handle_arguments(int argc, char **argv)
       break;
 
     case 's':
+      if(slip_config_siodev_count >= SLIP_DEV_MAX) {
+        err(1, "at most %d serial devices", SLIP_DEV_MAX);
+      }
       if(strncmp("/dev/", optarg, 5) == 0) {
-	slip_config_siodev = optarg + 5;
+	slip_config_siodevs[slip_config_siodev_count++] = optarg + 5;
       } else {
-	slip_config_siodev = optarg;
+	slip_config_siodevs[slip_config_siodev_count++] = optarg;
       }
       break;
 
@@ -128,13 +133,13 @@ fprintf(stderr,"usage:  %s [options] ipaddress\n", prog);
 fprintf(stderr,"example: border-router.native -L -v2 -s ttyUSB1 fd00::1/64\n");
 fprintf(stderr,"Options are:\n");
 #ifdef linux
-fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200,921600 (default 115200)\n");
+fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200,230400,460800,921600 (default 115200)\n");
 #else
 fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200 (default 115200)\n");
 #endif
 fprintf(stderr," -H             Hardware CTS/RTS flow control (default disabled)\n");
 fprintf(stderr," -L             Log output format (adds time stamps)\n");
-fprintf(stderr," -s siodev      Serial device (default /dev/ttyUSB0)\n");
+fprintf(stderr," -s siodev      Serial device (default /dev/ttyUSB0), repeat for more radios\n");
 fprintf(stderr," -a host        Connect via TCP to server at <host>\n");
 fprintf(stderr," -p port        Connect via TCP to server at <host>:<port>\n");
 fprintf(stderr," -t tundev      Name of interface (default tun0)\n");
@@ -180,6 +185,12 @@ exit(1);
     slip_config_b_rate = B115200;
     break;
 #ifdef linux
+  case 230400:
+    slip_config_b_rate = B230400;
+    break;
+  case 460800:
+    slip_config_b_rate = B460800;
+    break;
   case 921600:
     slip_config_b_rate = B921600;
     break;
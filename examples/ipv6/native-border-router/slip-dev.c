@@ -53,12 +53,15 @@
 
 #include "net/netstack.h"
 #include "net/packetbuf.h"
+#include "lib/crc16.h"
 #include "cmd.h"
+#include "border-router.h"
 #include "border-router-cmds.h"
 
 extern int slip_config_verbose;
 extern int slip_config_flowcontrol;
-extern const char *slip_config_siodev;
+extern const char *slip_config_siodevs[];
+extern int slip_config_siodev_count;
 extern const char *slip_config_host;
 extern const char *slip_config_port;
 extern uint16_t slip_config_basedelay;
@@ -70,16 +73,24 @@ extern speed_t slip_config_b_rate;
 #define SEND_DELAY 0
 #endif
 
-int devopen(const char *dev, int flags);
+/*
+ * When non-zero, frames for the radio ("!S" commands) written during one
+ * pass of the main loop are sent as a single "!F" batch frame of at most
+ * this many bytes, protected by a CRC-16. It must not exceed the radio's
+ * SLIP receive buffer, and the radio must understand "!F".
+ */
+#ifdef SLIP_DEV_CONF_BATCH_SIZE
+#define SLIP_DEV_BATCH_SIZE SLIP_DEV_CONF_BATCH_SIZE
+#else
+#define SLIP_DEV_BATCH_SIZE 0
+#endif
 
-static FILE *inslip;
+int devopen(const char *dev, int flags);
 
 /* for statistics */
 long slip_sent = 0;
 long slip_received = 0;
 
-int slipfd = 0;
-
 //#define PROGRESS(s) fprintf(stderr, s)
 #define PROGRESS(s) do { } while(0)
 
@@ -159,6 +170,47 @@ is_sensible_string(const unsigned char *s, int len)
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+#ifdef SLIP_DEV_CONF_READ_SIZE
+#define SLIP_DEV_READ_SIZE SLIP_DEV_CONF_READ_SIZE
+#else
+#define SLIP_DEV_READ_SIZE 1024
+#endif
+
+/* One slip-radio and its input and output state. */
+struct slip_dev {
+  int fd;
+  unsigned char inbuf[2048];
+  int inbufptr;
+  int inbuf_esc;
+  unsigned char outbuf[2048];
+  int end, begin, packet_end, packet_count;
+  struct timer send_delay_timer;
+#if SLIP_DEV_BATCH_SIZE
+  uint8_t batch[SLIP_DEV_BATCH_SIZE];
+  int batch_len;
+#endif
+};
+
+static struct slip_dev slip_devs[SLIP_DEV_MAX];
+static int slip_dev_count;
+/* The radio whose input is being processed, for slip_current_radio(). */
+static int slip_dev_current;
+
+/* delay between slip packets */
+static clock_time_t send_delay = SEND_DELAY;
+/*---------------------------------------------------------------------------*/
+int
+slip_radio_count(void)
+{
+  return slip_dev_count;
+}
+/*---------------------------------------------------------------------------*/
+int
+slip_current_radio(void)
+{
+  return slip_dev_current;
+}
+/*---------------------------------------------------------------------------*/
 void
 slip_packet_input(unsigned char *data, int len)
 {
@@ -169,183 +221,220 @@ slip_packet_input(unsigned char *data, int len)
   NETSTACK_RDC.input();
 }
 /*---------------------------------------------------------------------------*/
+static void
+serial_input_append(struct slip_dev *dev, const unsigned char *data, int len)
+{
+  if(dev->inbufptr + len > sizeof(dev->inbuf)) {
+    fprintf(stderr, "*** dropping large %d byte packet\n", dev->inbufptr + len);
+    dev->inbufptr = 0;
+  }
+  memcpy(dev->inbuf + dev->inbufptr, data, len);
+  dev->inbufptr += len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+serial_input_byte(struct slip_dev *dev, unsigned char c)
+{
+  serial_input_append(dev, &c, 1);
+
+  /* Echo lines as they are received for verbose=2,3,5+ */
+  /* Echo all printable characters for verbose==4 */
+  if(slip_config_verbose == 4) {
+    if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
+      fwrite(&c, 1, 1, stdout);
+    }
+  } else if(slip_config_verbose >= 2) {
+    if(c == '\n' && is_sensible_string(dev->inbuf, dev->inbufptr)) {
+      fwrite(dev->inbuf, dev->inbufptr, 1, stdout);
+      dev->inbufptr = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+serial_input_end(struct slip_dev *dev)
+{
+  unsigned char *inbuf = dev->inbuf;
+  int inbufptr = dev->inbufptr;
+  int i;
+
+  if(inbufptr > 0) {
+    if(inbuf[0] == '!') {
+      command_context = CMD_CONTEXT_RADIO;
+      cmd_input(inbuf, inbufptr);
+    } else if(inbuf[0] == '?') {
+#define DEBUG_LINE_MARKER '\r'
+    } else if(inbuf[0] == DEBUG_LINE_MARKER) {
+      fwrite(inbuf + 1, inbufptr - 1, 1, stdout);
+    } else if(is_sensible_string(inbuf, inbufptr)) {
+      if(slip_config_verbose == 1) {   /* strings already echoed below for verbose>1 */
+        fwrite(inbuf, inbufptr, 1, stdout);
+      }
+    } else {
+      if(slip_config_verbose > 2) {
+        printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
+        if(slip_config_verbose > 4) {
+#if WIRESHARK_IMPORT_FORMAT
+          printf("0000");
+          for(i = 0; i < inbufptr; i++) printf(" %02x", inbuf[i]);
+#else
+          printf("         ");
+          for(i = 0; i < inbufptr; i++) {
+            printf("%02x", inbuf[i]);
+            if((i & 3) == 3) printf(" ");
+            if((i & 15) == 15) printf("\n         ");
+          }
+#endif
+          printf("\n");
+        }
+      }
+      slip_packet_input(inbuf, inbufptr);
+    }
+    dev->inbufptr = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
 /*
- * Read from serial, when we have a packet call slip_packet_input. No output
- * buffering, input buffered by stdio.
+ * Read from serial, when we have a packet call slip_packet_input. Reads
+ * whatever the device has in one read() and decodes it in place; the
+ * decoder state is kept across reads, so frames may span several of them.
  */
-void
-serial_input(FILE *inslip)
+static void
+serial_input(struct slip_dev *dev)
 {
-  static unsigned char inbuf[2048];
-  static int inbufptr = 0;
-  int ret,i;
+  static unsigned char rxbuf[SLIP_DEV_READ_SIZE];
+  const unsigned char *p, *end, *run;
   unsigned char c;
+  int ret;
 
-#ifdef linux
-  ret = fread(&c, 1, 1, inslip);
-  if(ret == -1 || ret == 0) err(1, "serial_input: read");
-  goto after_fread;
-#endif
-
- read_more:
-  if(inbufptr >= sizeof(inbuf)) {
-     fprintf(stderr, "*** dropping large %d byte packet\n", inbufptr);
-     inbufptr = 0;
-  }
-  ret = fread(&c, 1, 1, inslip);
-#ifdef linux
- after_fread:
-#endif
+  ret = read(dev->fd, rxbuf, sizeof(rxbuf));
   if(ret == -1) {
+    if(errno == EAGAIN || errno == EINTR) {
+      return;
+    }
     err(1, "serial_input: read");
   }
   if(ret == 0) {
-    clearerr(inslip);
+#ifdef linux
+    err(1, "serial_input: read");
+#endif
     return;
   }
-  slip_received++;
-  switch(c) {
-  case SLIP_END:
-    if(inbufptr > 0) {
-      if(inbuf[0] == '!') {
-	command_context = CMD_CONTEXT_RADIO;
-	cmd_input(inbuf, inbufptr);
-      } else if(inbuf[0] == '?') {
-#define DEBUG_LINE_MARKER '\r'
-      } else if(inbuf[0] == DEBUG_LINE_MARKER) {
-	fwrite(inbuf + 1, inbufptr - 1, 1, stdout);
-      } else if(is_sensible_string(inbuf, inbufptr)) {
-        if(slip_config_verbose == 1) {   /* strings already echoed below for verbose>1 */
-          fwrite(inbuf, inbufptr, 1, stdout);
-        }
-      } else {
-        if(slip_config_verbose > 2) {
-          printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
-          if(slip_config_verbose > 4) {
-#if WIRESHARK_IMPORT_FORMAT
-            printf("0000");
-	    for(i = 0; i < inbufptr; i++) printf(" %02x", inbuf[i]);
-#else
-            printf("         ");
-            for(i = 0; i < inbufptr; i++) {
-              printf("%02x", inbuf[i]);
-              if((i & 3) == 3) printf(" ");
-              if((i & 15) == 15) printf("\n         ");
-            }
-#endif
-            printf("\n");
-          }
-        }
-	slip_packet_input(inbuf, inbufptr);
+  slip_received += ret;
+  slip_dev_current = dev - slip_devs;
+
+  p = rxbuf;
+  end = rxbuf + ret;
+  while(p < end) {
+    if(dev->inbuf_esc) {
+      dev->inbuf_esc = 0;
+      c = *p++;
+      switch(c) {
+      case SLIP_ESC_END:
+        c = SLIP_END;
+        break;
+      case SLIP_ESC_ESC:
+        c = SLIP_ESC;
+        break;
       }
-      inbufptr = 0;
+      serial_input_byte(dev, c);
+      continue;
     }
-    break;
 
-  case SLIP_ESC:
-    if(fread(&c, 1, 1, inslip) != 1) {
-      clearerr(inslip);
-      /* Put ESC back and give up! */
-      ungetc(SLIP_ESC, inslip);
-      return;
+    if(slip_config_verbose < 2) {
+      /* Nothing is echoed per byte: copy the run up to the next special
+         byte in one go. */
+      run = p;
+      while(p < end && *p != SLIP_END && *p != SLIP_ESC) {
+        p++;
+      }
+      if(p > run) {
+        serial_input_append(dev, run, p - run);
+        continue;
+      }
     }
 
+    c = *p++;
     switch(c) {
-    case SLIP_ESC_END:
-      c = SLIP_END;
+    case SLIP_END:
+      serial_input_end(dev);
       break;
-    case SLIP_ESC_ESC:
-      c = SLIP_ESC;
+    case SLIP_ESC:
+      dev->inbuf_esc = 1;
+      break;
+    default:
+      serial_input_byte(dev, c);
       break;
     }
-    /* FALLTHROUGH */
-  default:
-    inbuf[inbufptr++] = c;
-
-    /* Echo lines as they are received for verbose=2,3,5+ */
-    /* Echo all printable characters for verbose==4 */
-    if(slip_config_verbose == 4) {
-      if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
-	fwrite(&c, 1, 1, stdout);
-      }
-    } else if(slip_config_verbose >= 2) {
-      if(c == '\n' && is_sensible_string(inbuf, inbufptr)) {
-        fwrite(inbuf, inbufptr, 1, stdout);
-        inbufptr = 0;
-      }
-    }
-    break;
   }
-
-  goto read_more;
 }
-
-unsigned char slip_buf[2048];
-int slip_end, slip_begin, slip_packet_end, slip_packet_count;
-static struct timer send_delay_timer;
-/* delay between slip packets */
-static clock_time_t send_delay = SEND_DELAY;
 /*---------------------------------------------------------------------------*/
 static void
-slip_send(int fd, unsigned char c)
+slip_send(struct slip_dev *dev, unsigned char c)
 {
-  if(slip_end >= sizeof(slip_buf)) {
+  if(dev->end >= sizeof(dev->outbuf)) {
     err(1, "slip_send overflow");
   }
-  slip_buf[slip_end] = c;
-  slip_end++;
+  dev->outbuf[dev->end] = c;
+  dev->end++;
   slip_sent++;
   if(c == SLIP_END) {
     /* Full packet received. */
-    slip_packet_count++;
-    if(slip_packet_end == 0) {
-      slip_packet_end = slip_end;
+    dev->packet_count++;
+    if(dev->packet_end == 0) {
+      dev->packet_end = dev->end;
     }
   }
 }
 /*---------------------------------------------------------------------------*/
-int
-slip_empty()
+static int
+slip_empty(struct slip_dev *dev)
 {
-  return slip_packet_end == 0;
+  return dev->packet_end == 0;
 }
 /*---------------------------------------------------------------------------*/
-void
-slip_flushbuf(int fd)
+static void
+slip_flushbuf(struct slip_dev *dev)
 {
+  unsigned char *p, *end;
   int n;
 
-  if(slip_empty()) {
+  if(slip_empty(dev)) {
     return;
   }
 
-  n = write(fd, slip_buf + slip_begin, slip_packet_end - slip_begin);
+  /* Without a delay between packets everything queued goes to the
+     kernel in a single write. */
+  n = write(dev->fd, dev->outbuf + dev->begin,
+            (send_delay == 0 ? dev->end : dev->packet_end) - dev->begin);
 
   if(n == -1 && errno != EAGAIN) {
     err(1, "slip_flushbuf write failed");
   } else if(n == -1) {
     PROGRESS("Q");		/* Outqueue is full! */
   } else {
-    slip_begin += n;
-    if(slip_begin == slip_packet_end) {
-      slip_packet_count--;
-      if(slip_end > slip_packet_end) {
-        memcpy(slip_buf, slip_buf + slip_packet_end,
-               slip_end - slip_packet_end);
+    p = dev->outbuf + dev->begin;
+    end = p + n;
+    while(p < end && (p = memchr(p, SLIP_END, end - p)) != NULL) {
+      dev->packet_count--;
+      p++;
+    }
+    dev->begin += n;
+    if(dev->begin >= dev->packet_end) {
+      dev->end -= dev->begin;
+      if(dev->end > 0) {
+        memmove(dev->outbuf, dev->outbuf + dev->begin, dev->end);
       }
-      slip_end -= slip_packet_end;
-      slip_begin = slip_packet_end = 0;
-      if(slip_end > 0) {
+      dev->begin = dev->packet_end = 0;
+      if(dev->end > 0) {
         /* Find end of next slip packet */
-        for(n = 1; n < slip_end; n++) {
-          if(slip_buf[n] == SLIP_END) {
-            slip_packet_end = n + 1;
-            break;
-          }
+        p = memchr(dev->outbuf, SLIP_END, dev->end);
+        if(p != NULL) {
+          dev->packet_end = p - dev->outbuf + 1;
         }
         /* a delay between slip packets to avoid losing data */
         if(send_delay > 0) {
-          timer_set(&send_delay_timer, send_delay);
+          timer_set(&dev->send_delay_timer, send_delay);
         }
       }
     }
@@ -353,10 +442,11 @@ slip_flushbuf(int fd)
 }
 /*---------------------------------------------------------------------------*/
 static void
-write_to_serial(int outfd, const uint8_t *inbuf, int len)
+write_to_serial(struct slip_dev *dev, const uint8_t *inbuf, int len)
 {
   const uint8_t *p = inbuf;
-  int i;
+  unsigned char *q;
+  int i, run;
 
   if(slip_config_verbose > 2) {
 #ifdef __CYGWIN__
@@ -383,33 +473,105 @@ write_to_serial(int outfd, const uint8_t *inbuf, int len)
   /* It would be ``nice'' to send a SLIP_END here but it's not
    * really necessary.
    */
-  /* slip_send(outfd, SLIP_END); */
-
-  for(i = 0; i < len; i++) {
-    switch(p[i]) {
-    case SLIP_END:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_END);
-      break;
-    case SLIP_ESC:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_ESC);
-      break;
-    default:
-      slip_send(outfd, p[i]);
-      break;
+  /* slip_send(dev, SLIP_END); */
+
+  /* Encode straight into the output buffer, copying the runs between
+     bytes that need escaping in one go. */
+  q = dev->outbuf + dev->end;
+  for(i = 0; i < len;) {
+    run = i;
+    while(i < len && p[i] != SLIP_END && p[i] != SLIP_ESC) {
+      i++;
+    }
+    if(q + (i - run) + 2 > dev->outbuf + sizeof(dev->outbuf)) {
+      err(1, "slip_send overflow");
+    }
+    memcpy(q, p + run, i - run);
+    q += i - run;
+    if(i < len) {
+      *q++ = SLIP_ESC;
+      *q++ = p[i] == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC;
+      i++;
     }
   }
-  slip_send(outfd, SLIP_END);
+  slip_sent += q - (dev->outbuf + dev->end);
+  dev->end = q - dev->outbuf;
+  slip_send(dev, SLIP_END);
   PROGRESS("t");
 }
 /*---------------------------------------------------------------------------*/
-/* writes an 802.15.4 packet to slip-radio */
+#if SLIP_DEV_BATCH_SIZE
+static void
+batch_flush(struct slip_dev *dev)
+{
+  uint16_t crc;
+
+  if(dev->batch_len == 0) {
+    return;
+  }
+  crc = crc16_data(dev->batch, dev->batch_len, 0);
+  dev->batch[dev->batch_len++] = crc >> 8;
+  dev->batch[dev->batch_len++] = crc & 0xff;
+  write_to_serial(dev, dev->batch, dev->batch_len);
+  dev->batch_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+batch_add(struct slip_dev *dev, const uint8_t *buf, int len)
+{
+  /* The "!F" and count header, a length per command, and the CRC */
+  if(3 + 2 + len + 2 > SLIP_DEV_BATCH_SIZE) {
+    return 0;
+  }
+  if(dev->batch_len + 2 + len + 2 > SLIP_DEV_BATCH_SIZE ||
+     (dev->batch_len > 0 && dev->batch[2] == 255)) {
+    batch_flush(dev);
+  }
+  if(dev->batch_len == 0) {
+    dev->batch[0] = '!';
+    dev->batch[1] = 'F';
+    dev->batch[2] = 0;
+    dev->batch_len = 3;
+  }
+  dev->batch[dev->batch_len++] = len >> 8;
+  dev->batch[dev->batch_len++] = len & 0xff;
+  memcpy(dev->batch + dev->batch_len, buf, len);
+  dev->batch_len += len;
+  dev->batch[2]++;
+  return 1;
+}
+#endif /* SLIP_DEV_BATCH_SIZE */
+/*---------------------------------------------------------------------------*/
+static void
+slip_dev_write(struct slip_dev *dev, const uint8_t *buf, int len)
+{
+#if SLIP_DEV_BATCH_SIZE
+  if(len > 1 && buf[0] == '!' && buf[1] == 'S' && batch_add(dev, buf, len)) {
+    return;
+  }
+  /* Anything else keeps its place behind the frames already batched. */
+  batch_flush(dev);
+#endif /* SLIP_DEV_BATCH_SIZE */
+  write_to_serial(dev, buf, len);
+}
+/*---------------------------------------------------------------------------*/
+/* writes an 802.15.4 packet to one slip-radio */
+void
+write_to_slip_radio(int radio, const uint8_t *buf, int len)
+{
+  if(radio >= 0 && radio < slip_dev_count) {
+    slip_dev_write(&slip_devs[radio], buf, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* writes an 802.15.4 packet to every slip-radio */
 void
 write_to_slip(const uint8_t *buf, int len)
 {
-  if(slipfd > 0) {
-    write_to_serial(slipfd, buf, len);
+  int i;
+
+  for(i = 0; i < slip_dev_count; i++) {
+    slip_dev_write(&slip_devs[i], buf, len);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -462,85 +624,122 @@ stty_telos(int fd)
 static int
 set_fd(fd_set *rset, fd_set *wset)
 {
-  /* Anything to flush? */
-  if(!slip_empty() && (send_delay == 0 || timer_expired(&send_delay_timer))) {
-    FD_SET(slipfd, wset);
-  }
+  struct slip_dev *dev;
+
+  for(dev = slip_devs; dev < slip_devs + slip_dev_count; dev++) {
+#if SLIP_DEV_BATCH_SIZE
+    /* Everything batched since the last pass goes out now. */
+    batch_flush(dev);
+#endif /* SLIP_DEV_BATCH_SIZE */
+    /* Anything to flush? */
+    if(!slip_empty(dev) &&
+       (send_delay == 0 || timer_expired(&dev->send_delay_timer))) {
+      FD_SET(dev->fd, wset);
+    }
 
-  FD_SET(slipfd, rset);	/* Read from slip ASAP! */
+    FD_SET(dev->fd, rset);	/* Read from slip ASAP! */
+  }
   return 1;
 }
 /*---------------------------------------------------------------------------*/
 static void
 handle_fd(fd_set *rset, fd_set *wset)
 {
-  if(FD_ISSET(slipfd, rset)) {
-    serial_input(inslip);
-  }
+  struct slip_dev *dev;
+
+  for(dev = slip_devs; dev < slip_devs + slip_dev_count; dev++) {
+    if(FD_ISSET(dev->fd, rset)) {
+      serial_input(dev);
+    }
 
-  if(FD_ISSET(slipfd, wset)) {
-    slip_flushbuf(slipfd);
+    if(FD_ISSET(dev->fd, wset)) {
+      slip_flushbuf(dev);
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
 static const struct select_callback slip_callback = { set_fd, handle_fd };
 /*---------------------------------------------------------------------------*/
+static void
+slip_dev_add(int fd)
+{
+  struct slip_dev *dev = &slip_devs[slip_dev_count++];
+
+  memset(dev, 0, sizeof(*dev));
+  dev->fd = fd;
+  timer_set(&dev->send_delay_timer, 0);
+}
+/*---------------------------------------------------------------------------*/
 void
 slip_init(void)
 {
+  int fd, i, maxfd;
+
   setvbuf(stdout, NULL, _IOLBF, 0); /* Line buffered output. */
 
   if(slip_config_host != NULL) {
     if(slip_config_port == NULL) {
       slip_config_port = "60001";
     }
-    slipfd = connect_to_server(slip_config_host, slip_config_port);
-    if(slipfd == -1) {
+    fd = connect_to_server(slip_config_host, slip_config_port);
+    if(fd == -1) {
       err(1, "can't connect to ``%s:%s''", slip_config_host, slip_config_port);
     }
+    slip_dev_add(fd);
 
-  } else if(slip_config_siodev != NULL) {
-    if(strcmp(slip_config_siodev, "null") == 0) {
+  } else if(slip_config_siodev_count > 0) {
+    if(strcmp(slip_config_siodevs[0], "null") == 0) {
       /* Disable slip */
       return;
     }
-    slipfd = devopen(slip_config_siodev, O_RDWR | O_NONBLOCK);
-    if(slipfd == -1) {
-      err(1, "can't open siodev ``/dev/%s''", slip_config_siodev);
+    for(i = 0; i < slip_config_siodev_count; i++) {
+      fd = devopen(slip_config_siodevs[i], O_RDWR | O_NONBLOCK);
+      if(fd == -1) {
+        err(1, "can't open siodev ``/dev/%s''", slip_config_siodevs[i]);
+      }
+      slip_dev_add(fd);
     }
 
   } else {
     static const char *siodevs[] = {
       "ttyUSB0", "cuaU0", "ucom0" /* linux, fbsd6, fbsd5 */
     };
-    int i;
+    fd = -1;
     for(i = 0; i < 3; i++) {
-      slip_config_siodev = siodevs[i];
-      slipfd = devopen(slip_config_siodev, O_RDWR | O_NONBLOCK);
-      if(slipfd != -1) {
+      fd = devopen(siodevs[i], O_RDWR | O_NONBLOCK);
+      if(fd != -1) {
 	break;
       }
     }
-    if(slipfd == -1) {
+    if(fd == -1) {
       err(1, "can't open siodev");
     }
+    slip_config_siodevs[0] = siodevs[i];
+    slip_config_siodev_count = 1;
+    slip_dev_add(fd);
   }
 
-  select_set_callback(slipfd, &slip_callback);
-
-  if(slip_config_host != NULL) {
-    fprintf(stderr, "********SLIP opened to ``%s:%s''\n", slip_config_host,
-	    slip_config_port);
-  } else {
-    fprintf(stderr, "********SLIP started on ``/dev/%s''\n", slip_config_siodev);
-    stty_telos(slipfd);
+  /* The native main loop asks each callback for the fds it wants and
+     only looks as far as the highest registered slot, so one callback
+     serving all radios is registered at the highest fd. */
+  maxfd = 0;
+  for(i = 0; i < slip_dev_count; i++) {
+    if(slip_devs[i].fd > maxfd) {
+      maxfd = slip_devs[i].fd;
+    }
   }
-
-  timer_set(&send_delay_timer, 0);
-  slip_send(slipfd, SLIP_END);
-  inslip = fdopen(slipfd, "r");
-  if(inslip == NULL) {
-    err(1, "main: fdopen");
+  select_set_callback(maxfd, &slip_callback);
+
+  for(i = 0; i < slip_dev_count; i++) {
+    if(slip_config_host != NULL) {
+      fprintf(stderr, "********SLIP opened to ``%s:%s''\n", slip_config_host,
+              slip_config_port);
+    } else {
+      fprintf(stderr, "********SLIP started on ``/dev/%s''\n",
+              slip_config_siodevs[i]);
+      stty_telos(slip_devs[i].fd);
+    }
+    slip_send(&slip_devs[i], SLIP_END);
   }
 }
 /*---------------------------------------------------------------------------*/
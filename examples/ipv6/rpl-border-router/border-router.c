@@ -143,6 +143,15 @@ ipaddr_add(const uip_ipaddr_t *addr)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+route_ipaddr_add(const uip_ds6_route_t *r)
+{
+  uip_ipaddr_t ipaddr;
+
+  uip_ds6_route_copy_ipaddr(&ipaddr, r);
+  ipaddr_add(&ipaddr);
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(generate_routes(struct httpd_state *s))
 {
@@ -229,24 +238,24 @@ PT_THREAD(generate_routes(struct httpd_state *s))
 #if BUF_USES_STACK
 #if WEBSERVER_CONF_ROUTE_LINKS
     ADD("<a href=http://[");
-    ipaddr_add(&r->ipaddr);
+    route_ipaddr_add(r);
     ADD("]/status.shtml>");
-    ipaddr_add(&r->ipaddr);
+    route_ipaddr_add(r);
     ADD("</a>");
 #else
-    ipaddr_add(&r->ipaddr);
+    route_ipaddr_add(r);
 #endif
 #else
 #if WEBSERVER_CONF_ROUTE_LINKS
     ADD("<a href=http://[");
-    ipaddr_add(&r->ipaddr);
+    route_ipaddr_add(r);
     ADD("]/status.shtml>");
     SEND_STRING(&s->sout, buf); //TODO: why tunslip6 needs an output here, wpcapslip does not
     blen = 0;
-    ipaddr_add(&r->ipaddr);
+    route_ipaddr_add(r);
     ADD("</a>");
 #else
-    ipaddr_add(&r->ipaddr);
+    route_ipaddr_add(r);
 #endif
 #endif
     ADD("/%u (via ", r->length);
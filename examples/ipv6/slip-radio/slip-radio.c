@@ -41,6 +41,7 @@
 #include <string.h>
 #include "net/netstack.h"
 #include "net/packetbuf.h"
+#include "lib/crc16.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -48,6 +49,12 @@
 #include "slip-radio.h"
 #include "packetutils.h"
 
+#ifdef SLIP_RADIO_CONF_BAUDRATE
+#define SLIP_RADIO_BAUDRATE SLIP_RADIO_CONF_BAUDRATE
+#else
+#define SLIP_RADIO_BAUDRATE 115200
+#endif
+
 #ifdef SLIP_RADIO_CONF_SENSORS
 extern const struct slip_radio_sensors SLIP_RADIO_CONF_SENSORS;
 #endif
@@ -132,6 +139,29 @@ slip_radio_cmd_handler(const uint8_t *data, int len)
 	packet_pos = 0;
       }
 
+      return 1;
+    } else if(data[1] == 'F') {
+      /* A batch of commands in one frame: a count, then each command
+         preceded by its two-byte length, then a CRC-16 over it all. */
+      int pos, end, clen, n;
+      if(len < 5 ||
+         crc16_data(data, len - 2, 0) != ((data[len - 2] << 8) | data[len - 1])) {
+        PRINTF("slip-radio: bad batch (%d bytes)\n", len);
+        return 1;
+      }
+      n = data[2];
+      pos = 3;
+      end = len - 2;
+      while(n-- > 0 && pos + 2 <= end) {
+        clen = (data[pos] << 8) | data[pos + 1];
+        pos += 2;
+        if(pos + clen > end) {
+          PRINTF("slip-radio: truncated batch\n");
+          break;
+        }
+        cmd_input(&data[pos], clen);
+        pos += clen;
+      }
       return 1;
     }
   } else if(uip_buf[0] == '?') {
@@ -171,7 +201,7 @@ init(void)
 #ifndef BAUD2UBR
 #define BAUD2UBR(baud) baud
 #endif
-  slip_arch_init(BAUD2UBR(115200));
+  slip_arch_init(BAUD2UBR(SLIP_RADIO_BAUDRATE));
   process_start(&slip_process, NULL);
   slip_set_input_callback(slip_input_callback);
   packet_pos = 0;
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Checks the AES-128 drivers against the FIPS-197 test vector
+ *         and measures how long they take, to choose AES_128_CONF.
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "sys/rtimer.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ROUNDS 1000
+
+static const uint8_t key[AES_128_KEY_LENGTH] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t plaintext[AES_128_BLOCK_SIZE] = {
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+  0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t ciphertext[AES_128_BLOCK_SIZE] = {
+  0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+  0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *name, const struct aes_128_driver *driver)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+  rtimer_clock_t start, key_time, time;
+  uint16_t i;
+
+  start = RTIMER_NOW();
+  driver->set_key(key);
+  key_time = RTIMER_NOW() - start;
+
+  memcpy(block, plaintext, sizeof(block));
+  driver->encrypt(block);
+  if(memcmp(block, ciphertext, sizeof(block))) {
+    printf("%s: wrong ciphertext\n", name);
+    return;
+  }
+
+  start = RTIMER_NOW();
+  for(i = 0; i < ROUNDS; i++) {
+    driver->encrypt(block);
+  }
+  time = RTIMER_NOW() - start;
+
+  printf("%s: set_key %lu ticks, %u blocks in %lu ticks (%lu blocks/s)\n",
+         name, (unsigned long)key_time, ROUNDS, (unsigned long)time,
+         time ? (unsigned long)ROUNDS * RTIMER_SECOND / time : 0);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(aes_128_benchmark_process, "AES-128 benchmark");
+AUTOSTART_PROCESSES(&aes_128_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(aes_128_benchmark_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  run("aes_128_driver", &aes_128_driver);
+  run("aes_128_ttable_driver", &aes_128_ttable_driver);
+  if(&AES_128 != &aes_128_driver && &AES_128 != &aes_128_ttable_driver) {
+    run("AES_128", &AES_128);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
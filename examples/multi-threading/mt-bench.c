@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Measures how fast the multi-threading library switches
+ *         between the main Contiki thread and an mt thread.
+ */
+
+#include "contiki.h"
+#include "sys/mt.h"
+#include "dev/watchdog.h"
+#include <stdio.h>
+
+/* Switches between clock readings */
+#define BATCH 1000
+
+static volatile unsigned long yields;
+
+PROCESS(mt_bench_process, "mt switch benchmark");
+AUTOSTART_PROCESSES(&mt_bench_process);
+
+/*---------------------------------------------------------------------------*/
+static void
+thread_main(void *data)
+{
+  while(1) {
+    yields++;
+    mt_yield();
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mt_bench_process, ev, data)
+{
+  static struct mt_thread thread;
+  static struct etimer timer;
+  unsigned long rounds;
+  clock_time_t start, elapsed;
+  int i;
+
+  PROCESS_BEGIN();
+
+  mt_init();
+  mt_start(&thread, thread_main, NULL);
+
+  etimer_set(&timer, CLOCK_SECOND);
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&timer));
+
+    /* Run exec/yield round trips for about one second */
+    rounds = 0;
+    yields = 0;
+    start = clock_time();
+    do {
+      for(i = 0; i < BATCH; i++) {
+        mt_exec(&thread);
+      }
+      rounds += BATCH;
+      watchdog_periodic();
+      elapsed = clock_time() - start;
+    } while(elapsed < CLOCK_SECOND);
+
+    if(yields != rounds) {
+      printf("mt-bench: %lu yields for %lu rounds\n", yields, rounds);
+    }
+    printf("mt-bench: %lu round trips in %lu ticks, %lu per second\n",
+           rounds, (unsigned long)elapsed,
+           (unsigned long)(rounds * (unsigned long long)CLOCK_SECOND / elapsed));
+
+    etimer_set(&timer, CLOCK_SECOND * 4);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
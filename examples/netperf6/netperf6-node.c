@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      A RPL node for netperf6. Nodes are numbered by the last byte of
+ *      their link-layer address, which is the mote ID in Cooja. Node 1 is
+ *      the RPL root, and node NETPERF6_CLIENT_ID runs each of the tests
+ *      against it once it has joined the DODAG.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/rpl/rpl.h"
+#include "netperf6.h"
+
+#include <stdio.h>
+
+#define NODE_NUMBER linkaddr_node_addr.u8[LINKADDR_SIZE - 1]
+
+/* Time for the network to settle before the first test */
+#define SETTLE_TIME (30 * CLOCK_SECOND)
+
+struct test {
+  enum netperf6_mode mode;
+  uint16_t count;
+  uint16_t size;
+  clock_time_t interval;
+};
+
+static const struct test tests[] = {
+  { NETPERF6_UDP_STREAM, 100, 48, CLOCK_SECOND / 4 },
+  { NETPERF6_UDP_RR, 50, 32, CLOCK_SECOND / 2 },
+  { NETPERF6_COAP_RR, 50, 32, CLOCK_SECOND / 2 },
+  { NETPERF6_TCP_BULK, 64, 64, 0 },
+};
+
+PROCESS(netperf6_node_process, "netperf6 node");
+AUTOSTART_PROCESSES(&netperf6_node_process);
+/*---------------------------------------------------------------------------*/
+static void
+set_root(void)
+{
+  uip_ipaddr_t prefix;
+  uip_ipaddr_t ipaddr;
+
+  uip_ip6addr(&prefix, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 0);
+  uip_ipaddr_copy(&ipaddr, &prefix);
+  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+  uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
+  rpl_set_root(RPL_DEFAULT_INSTANCE, &ipaddr);
+  rpl_set_prefix(rpl_get_any_dag(), &prefix, 64);
+  rpl_repair_root(RPL_DEFAULT_INSTANCE);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(netperf6_node_process, ev, data)
+{
+  static struct etimer et;
+  static rpl_dag_t *dag;
+  static int i;
+
+  PROCESS_BEGIN();
+
+  if(NODE_NUMBER == 1) {
+    set_root();
+  }
+  NETSTACK_MAC.on();
+  netperf6_init();
+
+  if(NODE_NUMBER != NETPERF6_CLIENT_ID) {
+    PROCESS_EXIT();
+  }
+
+  /* Wait until we have joined the DODAG */
+  do {
+    etimer_set(&et, CLOCK_SECOND);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    dag = rpl_get_any_dag();
+  } while(dag == NULL || dag->preferred_parent == NULL);
+
+  etimer_set(&et, SETTLE_TIME);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  for(i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+    if(netperf6_start(tests[i].mode, &dag->dag_id, tests[i].count,
+                      tests[i].size, tests[i].interval) < 0) {
+      printf("netperf6: test %d not supported\n", i);
+      continue;
+    }
+    PROCESS_WAIT_EVENT_UNTIL(ev == netperf6_event_done);
+    netperf6_print_result();
+  }
+
+  printf("netperf6: done\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         The tcp-server example written with asock: the same "GET /<n>"
+ *         server, serving several connections at a time, each with a
+ *         socket thread and a small frame.
+ */
+
+#include "contiki-net.h"
+#include "net/ip/asock.h"
+#include "sys/cc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SERVER_PORT 80
+#define CONNECTIONS 8
+
+/* Everything a connection keeps between blocking calls */
+struct frame {
+  char line[32];
+  int bytes_to_send;
+};
+
+static struct asock sockets[CONNECTIONS];
+static struct frame frames[CONNECTIONS];
+
+static const char header[] =
+  "HTTP/1.0 200 ok\r\nServer: Contiki asock example\r\n\r\n";
+static const uint8_t body[64];
+
+PROCESS(asock_server_process, "asock echo process");
+AUTOSTART_PROCESSES(&asock_server_process);
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(serve(struct asock *a, void *ptr))
+{
+  struct frame *f = ptr;
+
+  ASOCK_BEGIN(a);
+
+  ASOCK_READ_UNTIL(a, (uint8_t *)f->line, sizeof(f->line) - 1, '\n');
+  f->line[asock_datalen(a)] = '\0';
+  if(strncmp(f->line, "GET /", 5) != 0) {
+    ASOCK_CLOSE(a);
+  }
+  f->bytes_to_send = atoi(&f->line[5]);
+
+  ASOCK_WRITE(a, header, sizeof(header) - 1);
+  while(f->bytes_to_send > 0) {
+    ASOCK_WRITE(a, body, MIN(f->bytes_to_send, sizeof(body)));
+    f->bytes_to_send -= MIN(f->bytes_to_send, sizeof(body));
+  }
+  ASOCK_CLOSE(a);
+
+  ASOCK_END(a);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(asock_server_process, ev, data)
+{
+  static int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < CONNECTIONS; i++) {
+    asock_tcp_register(&sockets[i], &frames[i], serve, NULL, 0);
+    tcp_socket_listen(asock_tcp(&sockets[i]), SERVER_PORT);
+  }
+
+  printf("Listening on %d, %d bytes of state per connection "
+         "(socket %d, frame %d)\n", SERVER_PORT,
+         (int)(sizeof(struct asock) + sizeof(struct frame)),
+         (int)sizeof(struct asock), (int)sizeof(struct frame));
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -126,7 +126,13 @@ typedef uint32_t rtimer_clock_t;
 #define USB_ARCH_CONF_TX_DMA_CHAN   1 /**< RAM -> USB DMA channel */
 #define CC2538_RF_CONF_TX_DMA_CHAN  2 /**< RF -> RAM DMA channel */
 #define CC2538_RF_CONF_RX_DMA_CHAN  3 /**< RAM -> RF DMA channel */
+#if UART1_CONF_DMA
+#define UDMA_CONF_MAX_CHANNEL       23 /**< UART1 uses channels 22 and 23 */
+#elif UART0_CONF_DMA
+#define UDMA_CONF_MAX_CHANNEL       9  /**< UART0 uses channels 8 and 9 */
+#else
 #define UDMA_CONF_MAX_CHANNEL       CC2538_RF_CONF_RX_DMA_CHAN
+#endif
 /** @} */
 /*---------------------------------------------------------------------------*/
 /**
@@ -502,6 +508,19 @@ typedef uint32_t rtimer_clock_t;
 #ifndef CCM_STAR_CONF
 #define CCM_STAR_CONF           cc2538_ccm_star_driver /**< AES-CCM* driver */
 #endif
+
+#ifndef ECDH_P256_CONF
+#define ECDH_P256_CONF          cc2538_ecdh_p256_driver /**< ECDH P-256 driver */
+#endif
+
+#ifndef PAIRWISE_KEYS_CONF_RANDOM_BYTES
+#define PAIRWISE_KEYS_CONF_RANDOM_BYTES cc2538_random_bytes /**< TRNG for ECC keys */
+#endif
+
+#ifndef SHA_256_CONF
+#define SHA_256_CONF            cc2538_sha_256_driver /**< SHA-256 driver */
+#define SHA_256_CONF_CONTEXT_SIZE 112 /**< sizeof(sha256_state_t) */
+#endif
 /** @} */
 /*---------------------------------------------------------------------------*/
 
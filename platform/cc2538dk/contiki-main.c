@@ -157,6 +157,9 @@ main(void)
   watchdog_init();
   button_sensor_init();
 
+  /* The UART drivers may claim uDMA channels */
+  udma_init();
+
   /*
    * Character I/O Initialisation.
    * When the UART receives a character it will call serial_line_input_byte to
@@ -199,8 +202,6 @@ main(void)
   /* Initialise the H/W RNG engine. */
   random_init(0);
 
-  udma_init();
-
   process_start(&etimer_process, NULL);
   ctimer_init();
 
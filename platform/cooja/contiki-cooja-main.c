@@ -357,6 +357,55 @@ process_run_thread_loop(void *data)
     }
 }
 /*---------------------------------------------------------------------------*/
+static void
+next_event_at(rtimer_clock_t t)
+{
+  if(!simNextEventPending || RTIMER_CLOCK_DIFF(t, simNextEventTime) < 0) {
+    simNextEventTime = t;
+    simNextEventPending = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Tell Cooja when the mote next needs to run: one millisecond from now
+ * if events are still queued, otherwise at the earliest rtimer or
+ * etimer deadline. Cooja leaves the mote asleep until then, or until
+ * an interface such as the radio wakes it up. Without pending timers
+ * or events the mote is not scheduled at all.
+ */
+static void
+report_next_event(void)
+{
+  rtimer_clock_t now;
+  long ms;
+
+  now = simRtimerCurrentTicks;
+  simNextEventPending = 0;
+
+  if(simProcessRunValue != 0) {
+    next_event_at(now + RTIMER_ARCH_SECOND / CLOCK_SECOND);
+  }
+
+  if(simRtimerPending) {
+    /* A deadline that has already passed runs on the next tick */
+    next_event_at(RTIMER_CLOCK_DIFF(simRtimerNextExpirationTime, now) > 0 ?
+                  simRtimerNextExpirationTime : now);
+  }
+
+  if(simEtimerPending) {
+    /* The mote clock may be offset from the simulation time by a
+       whole number of milliseconds */
+    ms = (long)(simEtimerNextExpirationTime - simCurrentTime);
+    if(ms <= 0) {
+      /* An expired timer is handled in one millisecond; it may be held
+         up by busy waiting such as the one in radio_send() */
+      ms = 1;
+    }
+    next_event_at(now - now % (RTIMER_ARCH_SECOND / CLOCK_SECOND) +
+                  ms * (RTIMER_ARCH_SECOND / CLOCK_SECOND));
+  }
+}
+/*---------------------------------------------------------------------------*/
 /**
  * \brief      Initialize a mote by starting processes etc.
  * \param env  JNI Environment interface pointer
@@ -457,8 +506,10 @@ Java_org_contikios_cooja_corecomm_CLASSNAME_tick(JNIEnv *env, jobject obj)
   /* Let all simulation interfaces act first */
   doActionsBeforeTick();
 
-  /* Poll etimer process */
-  if(etimer_pending()) {
+  /* Poll etimer process, but only if a timer has expired */
+  if(etimer_pending() &&
+     (clock_time_t)(etimer_next_expiration_time() - clock_time() - 1) >=
+     (clock_time_t)-1 / 2) {
     etimer_request_poll();
   }
 
@@ -481,6 +532,7 @@ Java_org_contikios_cooja_corecomm_CLASSNAME_tick(JNIEnv *env, jobject obj)
   /* Save nearest expiration time */
   simEtimerNextExpirationTime = etimer_next_expiration_time();
 
+  report_next_event();
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -41,6 +41,8 @@ char simDontFallAsleep = 0;
 int simProcessRunValue;
 int simEtimerPending;
 clock_time_t simEtimerNextExpirationTime;
+int simNextEventPending;
+rtimer_clock_t simNextEventTime;
 
 void doActionsBeforeTick() {
   // Poll all interfaces to do their thing before the tick
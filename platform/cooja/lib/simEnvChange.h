@@ -44,6 +44,13 @@ extern int simProcessRunValue;
 extern int simEtimerPending;
 extern clock_time_t simEtimerNextExpirationTime;
 extern clock_time_t simCurrentTime;
+extern int simRtimerPending;
+extern rtimer_clock_t simRtimerNextExpirationTime;
+extern rtimer_clock_t simRtimerCurrentTicks;
+
+// Next simulation time (us) at which the mote must run, valid if pending
+extern int simNextEventPending;
+extern rtimer_clock_t simNextEventTime;
 
 // Variable that when set to != 0, stops the mote from falling asleep next tick
 extern char simDontFallAsleep;
@@ -83,7 +83,8 @@ rtimer_arch_pending(void)
 int
 rtimer_arch_check(void)
 {
-  if (simRtimerCurrentTicks == simRtimerNextExpirationTime) {
+  if(simRtimerPending &&
+     RTIMER_CLOCK_DIFF(simRtimerCurrentTicks, simRtimerNextExpirationTime) >= 0) {
     /* Execute rtimer */
     simRtimerPending = 0;
     rtimer_run_next();
@@ -95,10 +95,21 @@
 #define RADIO_TEST_MODE  RADIO_TEST_MODE_DISABLED
 #endif /* RADIO_TEST_MODE */
 
-/* The number of input buffers */
-#ifndef MIRCOMAC_CONF_BUF_NUM
-#define MIRCOMAC_CONF_BUF_NUM 2
-#endif /* MIRCOMAC_CONF_BUF_NUM */
+/* The number of input buffers, a power of two. The radio receives into
+ * one of them while the others hold frames waiting for the driver process,
+ * so this is how many back-to-back frames survive a busy main loop. */
+#ifdef MICROMAC_CONF_BUF_NUM
+#define MICROMAC_BUF_NUM MICROMAC_CONF_BUF_NUM
+#elif defined(MIRCOMAC_CONF_BUF_NUM)
+/* Former, misspelt name of MICROMAC_CONF_BUF_NUM */
+#define MICROMAC_BUF_NUM MIRCOMAC_CONF_BUF_NUM
+#else
+#define MICROMAC_BUF_NUM 4
+#endif /* MICROMAC_CONF_BUF_NUM */
+
+#if MICROMAC_BUF_NUM & (MICROMAC_BUF_NUM - 1)
+#error MICROMAC_CONF_BUF_NUM must be a power of two
+#endif
 
 /* Init radio channel */
 #ifndef MICROMAC_CONF_CHANNEL
@@ -187,7 +198,15 @@ static MICROMAC_FRAME *input_frame_buffer = NULL;
 
 /* Ringbuffer for received packets in interrupt enabled mode */
 static struct ringbufindex input_ringbuf;
-static MICROMAC_FRAME input_array[MIRCOMAC_CONF_BUF_NUM];
+static MICROMAC_FRAME input_array[MICROMAC_BUF_NUM];
+
+/* RSSI and LQI of each frame in input_array. Frames may wait in the
+ * queue while others are received, so these are kept per frame rather
+ * than only for the last one. */
+static struct {
+  signed char rssi;
+  uint8_t correlation;
+} input_info[MICROMAC_BUF_NUM];
 
 /* SFD timestamp in RTIMER ticks */
 static volatile uint32_t last_packet_timestamp = 0;
@@ -206,6 +225,7 @@ static void radio_interrupt_handler(uint32 mac_event);
 static int get_detected_energy(void);
 static int get_rssi(void);
 static void read_last_rssi(void);
+static void save_input_info(void);
 
 /*---------------------------------------------------------------------------*/
 PROCESS(micromac_radio_process, "micromac_radio_driver");
@@ -239,7 +259,7 @@ init_software(void)
 {
   int put_index;
   /* Initialize ring buffer and first input packet pointer */
-  ringbufindex_init(&input_ringbuf, MIRCOMAC_CONF_BUF_NUM);
+  ringbufindex_init(&input_ringbuf, MICROMAC_BUF_NUM);
   /* get pointer to next input slot */
   put_index = ringbufindex_peek_put(&input_ringbuf);
   if(put_index == -1) {
@@ -744,6 +764,17 @@ read_last_rssi(void)
   radio_last_rssi = i16JPT_ConvertEnergyTodBm(radio_last_rx_energy);
 }
 /*---------------------------------------------------------------------------*/
+/* Keep the RSSI and LQI of the frame just received into rx_frame_buffer,
+ * from interrupt context */
+static void
+save_input_info(void)
+{
+  int i = rx_frame_buffer - input_array;
+
+  input_info[i].rssi = radio_last_rssi;
+  input_info[i].correlation = radio_last_correlation;
+}
+/*---------------------------------------------------------------------------*/
 int
 receiving_packet(void)
 {
@@ -795,6 +826,7 @@ radio_interrupt_handler(uint32 mac_event)
 #if MICROMAC_RADIO_MAC
         /* read and cache RSSI and LQI values */
         read_last_rssi();
+        save_input_info();
         /* Put received frame in queue */
         ringbufindex_put(&input_ringbuf);
 
@@ -828,6 +860,7 @@ radio_interrupt_handler(uint32 mac_event)
         } else {
           /* read and cache RSSI and LQI values */
           read_last_rssi();
+          save_input_info();
           /* Put received frame in queue */
           ringbufindex_put(&input_ringbuf);
 
@@ -882,15 +915,26 @@ PROCESS_THREAD(micromac_radio_process, ev, data)
       /* Put packet into packetbuf for input callback */
       packetbuf_clear();
       int len = read(packetbuf_dataptr(), PACKETBUF_SIZE);
+      /* Disable further read attempts, then free the slot for the radio */
+      input_frame_buffer->u8PayloadLength = 0;
+      ringbufindex_get(&input_ringbuf);
+      if(rx_frame_buffer == NULL) {
+        /* The queue was full and the radio off: resume reception now,
+           rather than once the upper layers are done with all frames */
+        rx_frame_buffer = &input_array[ringbufindex_peek_put(&input_ringbuf)];
+        if(MICROMAC_CONF_ALWAYS_ON || missed_radio_on_request) {
+          missed_radio_on_request = 0;
+          on();
+        }
+      }
       /* is packet valid? */
       if(len > 0) {
+        /* Report this frame, not the last one received, to upper layers */
+        packetbuf_set_attr(PACKETBUF_ATTR_RSSI, input_info[read_index].rssi);
+        packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, input_info[read_index].correlation);
         packetbuf_set_datalen(len);
         NETSTACK_RDC.input();
       }
-      /* Remove packet from ringbuf */
-      ringbufindex_get(&input_ringbuf);
-      /* Disable further read attempts */
-      input_frame_buffer->u8PayloadLength = 0;
     }
 
     /* Are we recovering from overflow? */
@@ -53,6 +53,10 @@ int select_set_callback(int fd, const struct select_callback *callback);
 #define EEPROM_CONF_SIZE				1024
 #endif
 
+#ifndef CFS_POSIX_CONF_BUFFERED
+#define CFS_POSIX_CONF_BUFFERED 1
+#endif
+
 #define CCIF
 #define CLIF
 
@@ -91,7 +95,11 @@ typedef unsigned short uip_stats_t;
 #endif /* NETSTACK_CONF_RDC */
 
 #ifndef NETSTACK_CONF_RADIO
+#if NATIVE_CONF_MULTI_NODE
+#define NETSTACK_CONF_RADIO   virtual_radio_driver
+#else /* NATIVE_CONF_MULTI_NODE */
 #define NETSTACK_CONF_RADIO   nullradio_driver
+#endif /* NATIVE_CONF_MULTI_NODE */
 #endif /* NETSTACK_CONF_RADIO */
 
 #ifndef NETSTACK_CONF_FRAMER
@@ -272,4 +280,17 @@ int strcasecmp(const char*, const char*);
 #include PROJECT_CONF_H
 #endif /* PROJECT_CONF_H */
 
+/* Microsecond rtimers from a timerfd instead of SIGALRM (Linux only) */
+#ifdef NATIVE_CONF_RTIMER_HIGHRES
+#define NATIVE_RTIMER_HIGHRES NATIVE_CONF_RTIMER_HIGHRES
+#else /* NATIVE_CONF_RTIMER_HIGHRES */
+#define NATIVE_RTIMER_HIGHRES 0
+#endif /* NATIVE_CONF_RTIMER_HIGHRES */
+
+#if NATIVE_RTIMER_HIGHRES
+/* One second of microseconds does not fit in 16 bits */
+typedef uint32_t rtimer_clock_t;
+#define RTIMER_CLOCK_DIFF(a, b) ((int32_t)((a) - (b)))
+#endif /* NATIVE_RTIMER_HIGHRES */
+
 #endif /* CONTIKI_CONF_H_ */
@@ -43,6 +43,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/select.h>
@@ -54,6 +55,7 @@
 
 #include "contiki.h"
 #include "net/netstack.h"
+#include "sys/tickless.h"
 
 #include "ctk/ctk.h"
 #include "ctk/ctk-curses.h"
@@ -72,6 +74,11 @@
 
 #include "net/rime/rime.h"
 
+#include "multi-node.h"
+#if NATIVE_MULTI_NODE
+#include "dev/virtual-radio.h"
+#endif /* NATIVE_MULTI_NODE */
+
 #ifdef SELECT_CONF_MAX
 #define SELECT_MAX SELECT_CONF_MAX
 #else
@@ -172,34 +179,18 @@ set_rime_addr(void)
 int contiki_argc = 0;
 char **contiki_argv;
 
-int
-main(int argc, char **argv)
+/*---------------------------------------------------------------------------*/
+static void
+init_node(void)
 {
-#if NETSTACK_CONF_WITH_IPV6
-#if UIP_CONF_IPV6_RPL
-  printf(CONTIKI_VERSION_STRING " started with IPV6, RPL\n");
-#else
-  printf(CONTIKI_VERSION_STRING " started with IPV6\n");
-#endif
-#else
-  printf(CONTIKI_VERSION_STRING " started\n");
-#endif
-
-  /* crappy way of remembering and accessing argc/v */
-  contiki_argc = argc;
-  contiki_argv = argv;
-
-  /* native under windows is hardcoded to use the first one or two args */
-  /* for wpcap configuration so this needs to be "removed" from         */
-  /* contiki_args (used by the native-border-router) */
-#ifdef __CYGWIN__
-  contiki_argc--;
-  contiki_argv++;
-#ifdef UIP_FALLBACK_INTERFACE
-  contiki_argc--;
-  contiki_argv++;
-#endif
-#endif
+#if NATIVE_MULTI_NODE
+  /* Give every node its own address */
+  serial_id[6] = (multi_node_id() + 1) >> 8;
+  serial_id[7] = (multi_node_id() + 1) & 0xff;
+#if !NETSTACK_CONF_WITH_IPV6
+  node_id = multi_node_id() + 1;
+#endif /* !NETSTACK_CONF_WITH_IPV6 */
+#endif /* NATIVE_MULTI_NODE */
 
   process_init();
   process_start(&etimer_process, NULL);
@@ -246,47 +237,191 @@ main(int argc, char **argv)
 
   autostart_start(autostart_processes);
 
+#if NATIVE_MULTI_NODE
+  if(multi_node_id() == 0) {
+    select_set_callback(STDIN_FILENO, &stdin_fd);
+  }
+#else /* NATIVE_MULTI_NODE */
+  select_set_callback(STDIN_FILENO, &stdin_fd);
+#endif /* NATIVE_MULTI_NODE */
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fds(fd_set *fdr, fd_set *fdw)
+{
+  int i;
+  int maxfd = 0;
+
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL && select_callback[i]->set_fd(fdr, fdw)) {
+      maxfd = i;
+    }
+  }
+  return maxfd;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fds(fd_set *fdr, fd_set *fdw, int maxfd)
+{
+  int i;
+
+  for(i = 0; i <= maxfd && i <= select_max; i++) {
+    if(select_callback[i] != NULL) {
+      select_callback[i]->handle_fd(fdr, fdw);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if NATIVE_MULTI_NODE
+static int
+node_count(void)
+{
+  const char *env;
+  int count;
+
+  env = getenv("CONTIKI_NODES");
+  count = env != NULL ? atoi(env) : 0;
+  return count > 0 ? count : NATIVE_MULTI_NODE_COUNT;
+}
+#endif /* NATIVE_MULTI_NODE */
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+#if NATIVE_MULTI_NODE
+  int nodes;
+  int n;
+#endif /* NATIVE_MULTI_NODE */
+
+#if NETSTACK_CONF_WITH_IPV6
+#if UIP_CONF_IPV6_RPL
+  printf(CONTIKI_VERSION_STRING " started with IPV6, RPL\n");
+#else
+  printf(CONTIKI_VERSION_STRING " started with IPV6\n");
+#endif
+#else
+  printf(CONTIKI_VERSION_STRING " started\n");
+#endif
+
+  /* crappy way of remembering and accessing argc/v */
+  contiki_argc = argc;
+  contiki_argv = argv;
+
+  /* native under windows is hardcoded to use the first one or two args */
+  /* for wpcap configuration so this needs to be "removed" from         */
+  /* contiki_args (used by the native-border-router) */
+#ifdef __CYGWIN__
+  contiki_argc--;
+  contiki_argv++;
+#ifdef UIP_FALLBACK_INTERFACE
+  contiki_argc--;
+  contiki_argv++;
+#endif
+#endif
+
   /* Make standard output unbuffered. */
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
-  select_set_callback(STDIN_FILENO, &stdin_fd);
+#if NATIVE_MULTI_NODE
+  nodes = node_count();
+  if(!virtual_radio_medium_init(nodes)) {
+    fprintf(stderr, "Failed to create the virtual radio medium\n");
+    return 1;
+  }
+  nodes = multi_node_init(nodes, init_node);
+  if(nodes == 0) {
+    fprintf(stderr, "Failed to create the nodes\n");
+    return 1;
+  }
+#else /* NATIVE_MULTI_NODE */
+  init_node();
+#endif /* NATIVE_MULTI_NODE */
+
   while(1) {
     fd_set fdr;
     fd_set fdw;
     int maxfd;
-    int i;
     int retval;
     struct timeval tv;
-
-    retval = process_run();
-
-    tv.tv_sec = 0;
-    tv.tv_usec = retval ? 1 : 1000;
+    rtimer_clock_t idle;
 
     FD_ZERO(&fdr);
     FD_ZERO(&fdw);
+
+#if NATIVE_MULTI_NODE
+    /* Run every node and sleep until the earliest deadline of any */
+    idle = RTIMER_SECOND;
     maxfd = 0;
-    for(i = 0; i <= select_max; i++) {
-      if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
-        maxfd = i;
+    for(n = 0; n < nodes; n++) {
+      rtimer_clock_t node_idle;
+      int node_maxfd;
+
+      multi_node_switch(n);
+      virtual_radio_check();
+      retval = process_run();
+      node_idle = retval ? 0 : tickless_idle_time(RTIMER_SECOND);
+      if(node_idle < idle) {
+        idle = node_idle;
       }
+      node_maxfd = set_fds(&fdr, &fdw);
+      if(node_maxfd > maxfd) {
+        maxfd = node_maxfd;
+      }
+    }
+    if(virtual_radio_busy()) {
+      idle = 0;
     }
+#else /* NATIVE_MULTI_NODE */
+    retval = process_run();
 
+    /* Sleep in select() until the next timer deadline instead of
+       waking up every millisecond. File descriptors and the rtimer
+       signal still end the sleep early. */
+    idle = retval ? 0 : tickless_idle_time(RTIMER_SECOND);
+    maxfd = set_fds(&fdr, &fdw);
+#endif /* NATIVE_MULTI_NODE */
+
+    tv.tv_sec = idle / RTIMER_SECOND;
+    tv.tv_usec = (unsigned long)(idle % RTIMER_SECOND) * 1000000 / RTIMER_SECOND;
+    if(idle == 0) {
+      tv.tv_usec = 1;
+    }
+
+#if !NATIVE_MULTI_NODE
+    if(idle > 0) {
+      tickless_sleep_begin(idle);
+    }
+#endif /* !NATIVE_MULTI_NODE */
     retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
+#if !NATIVE_MULTI_NODE
+    if(idle > 0) {
+      tickless_sleep_end();
+    }
+#endif /* !NATIVE_MULTI_NODE */
     if(retval < 0) {
       if(errno != EINTR) {
         perror("select");
       }
-    } else if(retval > 0) {
-      /* timeout => retval == 0 */
-      for(i = 0; i <= maxfd; i++) {
-        if(select_callback[i] != NULL) {
-          select_callback[i]->handle_fd(&fdr, &fdw);
-        }
+      FD_ZERO(&fdr);
+      FD_ZERO(&fdw);
+    }
+
+#if NATIVE_MULTI_NODE
+    for(n = 0; n < nodes; n++) {
+      multi_node_switch(n);
+      if(retval > 0) {
+        handle_fds(&fdr, &fdw, maxfd);
       }
+      etimer_request_poll();
+    }
+#else /* NATIVE_MULTI_NODE */
+    if(retval > 0) {
+      /* timeout => retval == 0 */
+      handle_fds(&fdr, &fdw, maxfd);
     }
 
     etimer_request_poll();
+#endif /* NATIVE_MULTI_NODE */
 
 #if WITH_GUI
     if(console_resize()) {
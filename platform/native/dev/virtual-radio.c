@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         In-memory radio medium shared by the nodes of a multi-node
+ *         native process
+ */
+
+#include "contiki.h"
+#include "multi-node.h"
+
+#if NATIVE_MULTI_NODE
+
+#include "dev/virtual-radio.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+struct frame {
+  uint8_t len;
+  uint8_t data[VIRTUAL_RADIO_MAX_FRAME];
+};
+
+struct inbox {
+  struct frame frames[VIRTUAL_RADIO_QUEUE_LEN];
+  uint16_t put;
+  uint16_t get;
+};
+
+/* Shared by all nodes, since it is set before they are created */
+static struct inbox *medium;
+static int medium_size;
+
+/* Per node */
+static uint8_t tx_buf[VIRTUAL_RADIO_MAX_FRAME];
+static uint8_t tx_len;
+static uint8_t radio_on;
+
+PROCESS(virtual_radio_process, "Virtual radio");
+
+/*---------------------------------------------------------------------------*/
+int
+virtual_radio_medium_init(int count)
+{
+  medium = calloc(count, sizeof(struct inbox));
+  if(medium == NULL) {
+    return 0;
+  }
+  medium_size = count;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+in_range(int a, int b)
+{
+  int d = a > b ? a - b : b - a;
+  return VIRTUAL_RADIO_RANGE == 0 || d <= VIRTUAL_RADIO_RANGE;
+}
+/*---------------------------------------------------------------------------*/
+static int
+init(void)
+{
+  process_start(&virtual_radio_process, NULL);
+  radio_on = 1;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare(const void *payload, unsigned short payload_len)
+{
+  if(payload_len > VIRTUAL_RADIO_MAX_FRAME) {
+    return 1;
+  }
+  memcpy(tx_buf, payload, payload_len);
+  tx_len = payload_len;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit(unsigned short transmit_len)
+{
+  struct inbox *in;
+  struct frame *f;
+  int self, i;
+
+  if(medium == NULL) {
+    return RADIO_TX_ERR;
+  }
+
+  self = multi_node_id();
+  for(i = 0; i < medium_size; i++) {
+    if(i == self || !in_range(self, i)) {
+      continue;
+    }
+    in = &medium[i];
+    if((uint16_t)(in->put - in->get) >= VIRTUAL_RADIO_QUEUE_LEN) {
+      PRINTF("virtual-radio: queue of node %d full\n", i);
+      continue;
+    }
+    f = &in->frames[in->put % VIRTUAL_RADIO_QUEUE_LEN];
+    memcpy(f->data, tx_buf, tx_len);
+    f->len = tx_len;
+    in->put++;
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_send(const void *payload, unsigned short payload_len)
+{
+  if(prepare(payload, payload_len)) {
+    return RADIO_TX_ERR;
+  }
+  return transmit(payload_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+pending_packet(void)
+{
+  struct inbox *in;
+
+  if(medium == NULL) {
+    return 0;
+  }
+  in = &medium[multi_node_id()];
+  return in->put != in->get;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  struct inbox *in;
+  struct frame *f;
+  int len;
+
+  if(!pending_packet()) {
+    return 0;
+  }
+  in = &medium[multi_node_id()];
+  f = &in->frames[in->get % VIRTUAL_RADIO_QUEUE_LEN];
+  len = f->len;
+  if(len > buf_len) {
+    len = 0;
+  } else {
+    memcpy(buf, f->data, len);
+  }
+  in->get++;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiving_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  radio_on = 1;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(void)
+{
+  radio_on = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  if(param == RADIO_PARAM_POWER_MODE) {
+    *value = radio_on ? RADIO_POWER_MODE_ON : RADIO_POWER_MODE_OFF;
+    return RADIO_RESULT_OK;
+  }
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+void
+virtual_radio_check(void)
+{
+  if(pending_packet()) {
+    process_poll(&virtual_radio_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+virtual_radio_busy(void)
+{
+  int i;
+
+  for(i = 0; i < medium_size; i++) {
+    if(medium[i].put != medium[i].get) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(virtual_radio_process, ev, data)
+{
+  int len;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while(pending_packet()) {
+      packetbuf_clear();
+      len = radio_read(packetbuf_dataptr(), PACKETBUF_SIZE);
+      if(len > 0 && radio_on) {
+        packetbuf_set_datalen(len);
+        NETSTACK_RDC.input();
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver virtual_radio_driver = {
+  init,
+  prepare,
+  transmit,
+  radio_send,
+  radio_read,
+  channel_clear,
+  receiving_packet,
+  pending_packet,
+  on,
+  off,
+  get_value,
+  set_value,
+  get_object,
+  set_object
+};
+/*---------------------------------------------------------------------------*/
+#endif /* NATIVE_MULTI_NODE */
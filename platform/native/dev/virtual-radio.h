@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         In-memory radio medium shared by the nodes of a multi-node
+ *         native process
+ */
+
+#ifndef VIRTUAL_RADIO_H_
+#define VIRTUAL_RADIO_H_
+
+#include "contiki.h"
+#include "dev/radio.h"
+
+/* A node hears the nodes whose index differs by at most this much.
+   0 means that all nodes hear each other. */
+#ifdef VIRTUAL_RADIO_CONF_RANGE
+#define VIRTUAL_RADIO_RANGE VIRTUAL_RADIO_CONF_RANGE
+#else /* VIRTUAL_RADIO_CONF_RANGE */
+#define VIRTUAL_RADIO_RANGE 0
+#endif /* VIRTUAL_RADIO_CONF_RANGE */
+
+/* Number of frames that can wait for each node */
+#ifdef VIRTUAL_RADIO_CONF_QUEUE_LEN
+#define VIRTUAL_RADIO_QUEUE_LEN VIRTUAL_RADIO_CONF_QUEUE_LEN
+#else /* VIRTUAL_RADIO_CONF_QUEUE_LEN */
+#define VIRTUAL_RADIO_QUEUE_LEN 8
+#endif /* VIRTUAL_RADIO_CONF_QUEUE_LEN */
+
+#define VIRTUAL_RADIO_MAX_FRAME 127
+
+extern const struct radio_driver virtual_radio_driver;
+
+/**
+ * \brief      Create the medium, before the nodes are created
+ * \param count The number of nodes
+ * \return     1 on success, 0 otherwise
+ */
+int virtual_radio_medium_init(int count);
+
+/**
+ * \brief      Schedule reception of frames waiting for the current node
+ */
+void virtual_radio_check(void);
+
+/**
+ * \brief      Check if frames are waiting for any node
+ */
+int virtual_radio_busy(void);
+
+#endif /* VIRTUAL_RADIO_H_ */
@@ -34,16 +34,143 @@
 
 #include "contiki-conf.h"
 #include "dev/xmem.h"
+#include "xmem-stats.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
 
 #define XMEM_SIZE 1024 * 1024
 
+/*
+ * With XMEM_CONF_FLASH_MODEL, the memory behaves like a serial NOR flash:
+ * a write can only set bits that an erase has cleared, every page that a
+ * write touches costs XMEM_CONF_PROGRAM_TIME microseconds and every
+ * sector erase costs XMEM_CONF_ERASE_TIME microseconds. The defaults are
+ * roughly those of the M25P80 on the Sky mote. With XMEM_CONF_STALL, the
+ * calling process is held for that time, so that timers and the rest of
+ * the system see the same stalls as on the device. The statistics are
+ * printed when the program exits.
+ */
+#ifdef XMEM_CONF_FLASH_MODEL
+#define XMEM_FLASH_MODEL XMEM_CONF_FLASH_MODEL
+#else
+#define XMEM_FLASH_MODEL 0
+#endif
+
+#ifdef XMEM_CONF_PAGE_SIZE
+#define XMEM_PAGE_SIZE XMEM_CONF_PAGE_SIZE
+#else
+#define XMEM_PAGE_SIZE 256
+#endif
+
+#ifdef XMEM_CONF_SECTOR_SIZE
+#define XMEM_SECTOR_SIZE XMEM_CONF_SECTOR_SIZE
+#else
+#define XMEM_SECTOR_SIZE 65536UL
+#endif
+
+#ifdef XMEM_CONF_PROGRAM_TIME
+#define XMEM_PROGRAM_TIME XMEM_CONF_PROGRAM_TIME
+#else
+#define XMEM_PROGRAM_TIME 1400
+#endif
+
+#ifdef XMEM_CONF_ERASE_TIME
+#define XMEM_ERASE_TIME XMEM_CONF_ERASE_TIME
+#else
+#define XMEM_ERASE_TIME 600000UL
+#endif
+
+#ifdef XMEM_CONF_STALL
+#define XMEM_STALL XMEM_CONF_STALL
+#else
+#define XMEM_STALL 1
+#endif
+
+#define XMEM_SECTORS (XMEM_SIZE / XMEM_SECTOR_SIZE)
+
 static unsigned char xmem[XMEM_SIZE];
+
+#if XMEM_FLASH_MODEL
+static struct xmem_stats stats;
+static unsigned long erase_counts[XMEM_SECTORS];
+static unsigned char exit_print_registered;
+#endif /* XMEM_FLASH_MODEL */
+/*---------------------------------------------------------------------------*/
+#if XMEM_FLASH_MODEL
+static void
+busy(unsigned long us)
+{
+  if(!exit_print_registered) {
+    atexit(xmem_print_stats);
+    exit_print_registered = 1;
+  }
+
+  stats.busy_time += us;
+  if(us > stats.longest_busy_time) {
+    stats.longest_busy_time = us;
+  }
+#if XMEM_STALL
+  {
+    struct timespec t;
+
+    t.tv_sec = us / 1000000;
+    t.tv_nsec = (us % 1000000) * 1000;
+    while(nanosleep(&t, &t) < 0 && errno == EINTR);
+  }
+#endif
+}
+#endif /* XMEM_FLASH_MODEL */
+/*---------------------------------------------------------------------------*/
+void
+xmem_get_stats(struct xmem_stats *s)
+{
+#if XMEM_FLASH_MODEL
+  int i;
+
+  *s = stats;
+  s->max_erase_count = 0;
+  for(i = 0; i < XMEM_SECTORS; i++) {
+    if(erase_counts[i] > s->max_erase_count) {
+      s->max_erase_count = erase_counts[i];
+    }
+  }
+#else
+  memset(s, 0, sizeof(*s));
+#endif
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+xmem_erase_count(unsigned long offset)
+{
+#if XMEM_FLASH_MODEL
+  if(offset < XMEM_SIZE) {
+    return erase_counts[offset / XMEM_SECTOR_SIZE];
+  }
+#endif
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+xmem_print_stats(void)
+{
+  struct xmem_stats s;
+
+  xmem_get_stats(&s);
+  printf("xmem: %lu reads (%lu bytes), %lu writes (%lu bytes, %lu pages)\n",
+         s.reads, s.read_bytes, s.writes, s.write_bytes, s.pages_programmed);
+  printf("xmem: %lu sector erases, at most %lu per sector, "
+         "%lu bytes written over unerased bits\n",
+         s.erases, s.max_erase_count, s.overwritten_bytes);
+  printf("xmem: busy %llu us, longest %lu us\n",
+         s.busy_time, s.longest_busy_time);
+}
 /*---------------------------------------------------------------------------*/
 int
 xmem_pwrite(const void *buf, int size, unsigned long offset)
@@ -59,6 +186,33 @@ xmem_pwrite(const void *buf, int size, unsigned long offset)
 
   /*  printf("xmem_write(offset 0x%02x, buf %p, size %l);\n", offset, buf, size);*/
 
+#if XMEM_FLASH_MODEL
+  {
+    const unsigned char *p = buf;
+    unsigned long pages;
+    int i;
+
+    if(size <= 0) {
+      return size;
+    }
+
+    /* Programming only sets bits of the erased (all zero) state */
+    for(i = 0; i < size; i++) {
+      if(xmem[offset + i] & ~p[i]) {
+        stats.overwritten_bytes++;
+      }
+      xmem[offset + i] |= p[i];
+    }
+
+    pages = (offset + size - 1) / XMEM_PAGE_SIZE - offset / XMEM_PAGE_SIZE + 1;
+    stats.writes++;
+    stats.write_bytes += size;
+    stats.pages_programmed += pages;
+    busy(pages * XMEM_PROGRAM_TIME);
+    return size;
+  }
+#endif /* XMEM_FLASH_MODEL */
+
   memcpy(&xmem[offset], buf, size);
   return size;
 }
@@ -67,6 +221,10 @@ int
 xmem_pread(void *buf, int size, unsigned long offset)
 {
   /*  printf("xmem_read(addr 0x%02x, buf %p, size %d);\n", addr, buf, size);*/
+#if XMEM_FLASH_MODEL
+  stats.reads++;
+  stats.read_bytes += size;
+#endif
   memcpy(buf, &xmem[offset], size);
   return size;
 }
@@ -75,6 +233,29 @@ int
 xmem_erase(long nbytes, unsigned long offset)
 {
   /*  printf("xmem_read(addr 0x%02x, buf %p, size %d);\n", addr, buf, size);*/
+#if XMEM_FLASH_MODEL
+  {
+    unsigned long sector;
+    unsigned long sectors;
+
+    if(nbytes <= 0) {
+      return nbytes;
+    }
+
+    /* Whole sectors are erased, like on the chip */
+    sectors = 0;
+    for(sector = offset / XMEM_SECTOR_SIZE;
+        sector <= (offset + nbytes - 1) / XMEM_SECTOR_SIZE &&
+        sector < XMEM_SECTORS; sector++) {
+      memset(&xmem[sector * XMEM_SECTOR_SIZE], 0, XMEM_SECTOR_SIZE);
+      erase_counts[sector]++;
+      sectors++;
+    }
+    stats.erases += sectors;
+    busy(sectors * XMEM_ERASE_TIME);
+    return nbytes;
+  }
+#endif /* XMEM_FLASH_MODEL */
   memset(&xmem[offset], 0, nbytes);
   return nbytes;
 }
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Several Contiki nodes in one native process
+ */
+
+#include "contiki.h"
+#include "multi-node.h"
+
+#if NATIVE_MULTI_NODE
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Provided by the C runtime and the linker */
+extern char __data_start[];
+extern char _end[];
+
+struct multi_node_state {
+  char **data;
+  size_t size;
+  int count;
+  int current;
+};
+
+/*
+ * Set before the first copy of the segment is taken, so it has the
+ * same value in every node.
+ */
+static struct multi_node_state *state;
+
+/* Different in every node */
+static int node_index;
+
+/*---------------------------------------------------------------------------*/
+static char *
+segment(void)
+{
+  char *volatile start = __data_start;
+  return start;
+}
+/*---------------------------------------------------------------------------*/
+static void
+load(const char *data, size_t size)
+{
+  memcpy(segment(), data, size);
+  /* Globals may have changed behind the back of the compiler */
+  __asm__ __volatile__("" : : : "memory");
+}
+/*---------------------------------------------------------------------------*/
+int
+multi_node_init(int count, void (* init)(void))
+{
+  struct multi_node_state *s;
+  char *pristine;
+  sigset_t set;
+  int i;
+
+  /* The rtimer signal must not hit a half swapped segment */
+  sigemptyset(&set);
+  sigaddset(&set, SIGALRM);
+  sigprocmask(SIG_BLOCK, &set, NULL);
+
+  s = malloc(sizeof(struct multi_node_state));
+  if(s == NULL || count <= 0) {
+    return 0;
+  }
+  s->size = _end - __data_start;
+  s->count = 0;
+  s->current = 0;
+  s->data = calloc(count, sizeof(char *));
+  pristine = malloc(s->size);
+  if(s->data == NULL || pristine == NULL) {
+    return 0;
+  }
+
+  state = s;
+  memcpy(pristine, segment(), s->size);
+
+  for(i = 0; i < count; i++) {
+    s->data[i] = malloc(s->size);
+    if(s->data[i] == NULL) {
+      break;
+    }
+    load(pristine, s->size);
+    node_index = i;
+    init();
+    memcpy(s->data[i], segment(), s->size);
+    s->count++;
+  }
+  free(pristine);
+
+  if(s->count > 0) {
+    load(s->data[0], s->size);
+  }
+  fprintf(stderr, "Running %d nodes with %lu bytes of state each\n",
+          s->count, (unsigned long)s->size);
+  return s->count;
+}
+/*---------------------------------------------------------------------------*/
+void
+multi_node_switch(int node)
+{
+  struct multi_node_state *s = state;
+
+  if(node == s->current || node < 0 || node >= s->count) {
+    return;
+  }
+  memcpy(s->data[s->current], segment(), s->size);
+  load(s->data[node], s->size);
+  s->current = node;
+}
+/*---------------------------------------------------------------------------*/
+int
+multi_node_id(void)
+{
+  return node_index;
+}
+/*---------------------------------------------------------------------------*/
+int
+multi_node_count(void)
+{
+  return state == NULL ? 1 : state->count;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* NATIVE_MULTI_NODE */
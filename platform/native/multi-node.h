@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup native_platform
+ * @{
+ */
+
+/**
+ * \file
+ *         Several Contiki nodes in one native process
+ *
+ *         All Contiki state lives in global variables. To run several
+ *         nodes in one process, each node gets its own copy of the
+ *         data and bss segments of the executable, and the copies are
+ *         swapped in and out when the main loop switches node. The
+ *         nodes talk to each other through the virtual radio.
+ *
+ *         Enable with NATIVE_CONF_MULTI_NODE. The number of nodes is
+ *         NATIVE_CONF_MULTI_NODE_COUNT and can be changed at run time
+ *         with the CONTIKI_NODES environment variable.
+ *
+ *         Only Linux is supported, and only the first node reads from
+ *         standard input. Rtimers only run with
+ *         NATIVE_CONF_RTIMER_HIGHRES, which needs one file descriptor
+ *         per node below SELECT_CONF_MAX.
+ */
+
+#ifndef MULTI_NODE_H_
+#define MULTI_NODE_H_
+
+#include "contiki.h"
+
+#ifdef NATIVE_CONF_MULTI_NODE
+#define NATIVE_MULTI_NODE NATIVE_CONF_MULTI_NODE
+#else /* NATIVE_CONF_MULTI_NODE */
+#define NATIVE_MULTI_NODE 0
+#endif /* NATIVE_CONF_MULTI_NODE */
+
+#ifdef NATIVE_CONF_MULTI_NODE_COUNT
+#define NATIVE_MULTI_NODE_COUNT NATIVE_CONF_MULTI_NODE_COUNT
+#else /* NATIVE_CONF_MULTI_NODE_COUNT */
+#define NATIVE_MULTI_NODE_COUNT 8
+#endif /* NATIVE_CONF_MULTI_NODE_COUNT */
+
+/**
+ * \brief      Create the nodes
+ * \param count The number of nodes
+ * \param init Called once for each node to initialize it
+ * \return     The number of nodes created
+ *
+ *             State that must be shared between nodes has to be set
+ *             up before this call. When the function returns, the
+ *             first node is the current one.
+ */
+int multi_node_init(int count, void (* init)(void));
+
+/**
+ * \brief      Make a node the current one
+ * \param node The index of the node
+ */
+void multi_node_switch(int node);
+
+/**
+ * \brief      Get the index of the current node
+ */
+int multi_node_id(void);
+
+/**
+ * \brief      Get the number of nodes
+ */
+int multi_node_count(void);
+
+#endif /* MULTI_NODE_H_ */
+
+/** @} */
@@ -175,7 +175,13 @@ typedef uint32_t rtimer_clock_t;
 #define USB_ARCH_CONF_TX_DMA_CHAN   1 /**< RAM -> USB DMA channel */
 #define CC2538_RF_CONF_TX_DMA_CHAN  2 /**< RF -> RAM DMA channel */
 #define CC2538_RF_CONF_RX_DMA_CHAN  3 /**< RAM -> RF DMA channel */
+#if UART1_CONF_DMA
+#define UDMA_CONF_MAX_CHANNEL       23 /**< UART1 uses channels 22 and 23 */
+#elif UART0_CONF_DMA
+#define UDMA_CONF_MAX_CHANNEL       9  /**< UART0 uses channels 8 and 9 */
+#else
 #define UDMA_CONF_MAX_CHANNEL       CC2538_RF_CONF_RX_DMA_CHAN
+#endif
 /** @} */
 /*---------------------------------------------------------------------------*/
 /**
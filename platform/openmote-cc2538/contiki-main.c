@@ -161,6 +161,9 @@ main(void)
   process_init();
   watchdog_init();
 
+  /* The UART drivers may claim uDMA channels */
+  udma_init();
+
 #if UART_CONF_ENABLE
   uart_init(0);
   uart_init(1);
@@ -187,8 +190,6 @@ main(void)
 
   random_init(0);
 
-  udma_init();
-
   process_start(&etimer_process, NULL);
   ctimer_init();
 
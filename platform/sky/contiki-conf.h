@@ -97,6 +97,12 @@
 
 #define PACKETBUF_CONF_ATTRS_INLINE 1
 
+/* Capture the SFD time of each frame in hardware, for accurate
+   TSCH and timesynch timestamps. */
+#ifndef CC2420_CONF_SFD_TIMESTAMPS
+#define CC2420_CONF_SFD_TIMESTAMPS        1
+#endif /* CC2420_CONF_SFD_TIMESTAMPS */
+
 #ifdef RF_CHANNEL
 #define CC2420_CONF_CHANNEL RF_CHANNEL
 #endif
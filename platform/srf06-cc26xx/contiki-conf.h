@@ -194,6 +194,16 @@
 #endif
 /** @} */
 /*---------------------------------------------------------------------------*/
+/**
+ * \name Security
+ *
+ * @{
+ */
+#ifndef AES_128_CONF
+#define AES_128_CONF    cc26xx_aes_128_driver /**< AES-128 driver */
+#endif
+/** @} */
+/*---------------------------------------------------------------------------*/
 /** @} */
 /**
  * \name IPv6, RIME and network buffer configuration
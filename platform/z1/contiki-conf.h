@@ -134,6 +134,12 @@
 #define CC2420_CONF_CCA_THRESH            -45
 #endif /* CC2420_CONF_CCA_THRESH */
 
+/* Capture the SFD time of each frame in hardware, for accurate
+   TSCH and timesynch timestamps. */
+#ifndef CC2420_CONF_SFD_TIMESTAMPS
+#define CC2420_CONF_SFD_TIMESTAMPS        1
+#endif /* CC2420_CONF_SFD_TIMESTAMPS */
+
 #ifndef IEEE802154_CONF_PANID
 #define IEEE802154_CONF_PANID             0xABCD
 #endif
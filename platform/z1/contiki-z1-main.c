@@ -34,6 +34,7 @@
 
 #include "contiki.h"
 #include "cc2420.h"
+#include "cc2420-arch-sfd.h"
 #include "dev/leds.h"
 #include "dev/serial-line.h"
 #include "dev/slip.h"
@@ -448,6 +449,9 @@ main(int argc, char **argv)
       if(timer_expired(&mgt_timer)) {
         timer_reset(&mgt_timer);
         msp430_sync_dco();
+#if CC2420_CONF_SFD_TIMESTAMPS
+        cc2420_arch_sfd_init();
+#endif /* CC2420_CONF_SFD_TIMESTAMPS */
       }
 #endif
 
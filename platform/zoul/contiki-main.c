@@ -215,6 +215,9 @@ main(void)
   process_init();
   watchdog_init();
 
+  /* The UART drivers may claim uDMA channels */
+  udma_init();
+
   /*
    * Character I/O Initialisation.
    * When the UART receives a character it will call serial_line_input_byte to
@@ -250,8 +253,6 @@ main(void)
   /* Initialise the H/W RNG engine. */
   random_init(0);
 
-  udma_init();
-
   process_start(&etimer_process, NULL);
   ctimer_init();
 
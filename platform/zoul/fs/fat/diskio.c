@@ -37,37 +37,44 @@
  */
 #include "diskio.h"
 #include "mmc.h"
+#include "disk-cache.h"
 #include "rtcc.h"
 
+#if DISK_CACHE_SECTORS
+#define DISK    disk_cache_driver
+#else
+#define DISK    mmc_driver
+#endif
+
 /*----------------------------------------------------------------------------*/
 DSTATUS __attribute__((__weak__))
 disk_status(BYTE pdrv)
 {
-  return ~mmc_driver.status(pdrv);
+  return ~DISK.status(pdrv);
 }
 /*----------------------------------------------------------------------------*/
 DSTATUS __attribute__((__weak__))
 disk_initialize(BYTE pdrv)
 {
-  return ~mmc_driver.initialize(pdrv);
+  return ~DISK.initialize(pdrv);
 }
 /*----------------------------------------------------------------------------*/
 DRESULT __attribute__((__weak__))
 disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
 {
-  return mmc_driver.read(pdrv, buff, sector, count);
+  return DISK.read(pdrv, buff, sector, count);
 }
 /*----------------------------------------------------------------------------*/
 DRESULT __attribute__((__weak__))
 disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
 {
-  return mmc_driver.write(pdrv, buff, sector, count);
+  return DISK.write(pdrv, buff, sector, count);
 }
 /*----------------------------------------------------------------------------*/
 DRESULT __attribute__((__weak__))
 disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
 {
-  return mmc_driver.ioctl(pdrv, cmd, buff);
+  return DISK.ioctl(pdrv, cmd, buff);
 }
 /*----------------------------------------------------------------------------*/
 DWORD __attribute__((__weak__))
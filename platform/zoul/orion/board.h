@@ -283,6 +283,7 @@
 #define ETH_SPI_CSN_PIN            7
 #define ETH_INT_PORT               GPIO_D_NUM
 #define ETH_INT_PIN                0
+#define ETH_INT_VECTOR             GPIO_D_IRQn
 #define ETH_RESET_PORT             GPIO_D_NUM
 #define ETH_RESET_PIN              1
 /** @} */
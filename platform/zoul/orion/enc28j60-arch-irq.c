@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup zolertia-orion-ethernet-router
+ * @{
+ *
+ * \defgroup zolertia-eth-arch-irq Zolertia ENC28J60 INT pin
+ *
+ * Falling-edge interrupt on the ENC28J60 INT pin, used with
+ * ENC28J60_CONF_INTERRUPT
+ * @{
+ *
+ * \file
+ * ENC28J60 INT pin interrupt for the Orion Ethernet Router
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "dev/gpio.h"
+#include "dev/ioc.h"
+#include "enc28j60.h"
+/*---------------------------------------------------------------------------*/
+#define INT_PORT_BASE GPIO_PORT_TO_BASE(ETH_INT_PORT)
+#define INT_PIN_MASK  GPIO_PIN_MASK(ETH_INT_PIN)
+/*---------------------------------------------------------------------------*/
+static void
+int_callback(uint8_t port, uint8_t pin)
+{
+  enc28j60_interrupt();
+}
+/*---------------------------------------------------------------------------*/
+void
+enc28j60_arch_irq_init(void)
+{
+  GPIO_SOFTWARE_CONTROL(INT_PORT_BASE, INT_PIN_MASK);
+  GPIO_SET_INPUT(INT_PORT_BASE, INT_PIN_MASK);
+  ioc_set_over(ETH_INT_PORT, ETH_INT_PIN, IOC_OVERRIDE_PUE);
+
+  /* INT is active low */
+  GPIO_DETECT_EDGE(INT_PORT_BASE, INT_PIN_MASK);
+  GPIO_TRIGGER_SINGLE_EDGE(INT_PORT_BASE, INT_PIN_MASK);
+  GPIO_DETECT_FALLING(INT_PORT_BASE, INT_PIN_MASK);
+
+  gpio_register_callback(int_callback, ETH_INT_PORT, ETH_INT_PIN);
+  GPIO_ENABLE_INTERRUPT(INT_PORT_BASE, INT_PIN_MASK);
+  NVIC_EnableIRQ(ETH_INT_VECTOR);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * @}
+ * @}
+ */
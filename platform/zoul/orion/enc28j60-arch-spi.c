@@ -43,13 +43,121 @@
  * eth-gw SPI arch specifics
  */
 /*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
 #include "spi-arch.h"
 #include "spi.h"
+#include "reg.h"
 #include "dev/gpio.h"
+#include "dev/ssi.h"
+#include "dev/udma.h"
+#include "enc28j60.h"
 /*---------------------------------------------------------------------------*/
 #define RESET_PORT  GPIO_PORT_TO_BASE(ETH_RESET_PORT)
 #define RESET_BIT   GPIO_PIN_MASK(ETH_RESET_PIN)
 /*---------------------------------------------------------------------------*/
+#define SSI_FIFO_DEPTH 8
+/*---------------------------------------------------------------------------*/
+/*
+ * With ENC28J60_ARCH_CONF_DMA, block transfers longer than
+ * ENC28J60_ARCH_DMA_THRESHOLD bytes are moved by the uDMA. The SSI
+ * requests both channels, so the RX channel follows the TX channel one
+ * byte at a time and the CPU only waits for the end of the transfer.
+ */
+#ifdef ENC28J60_ARCH_CONF_DMA
+#define ENC28J60_ARCH_DMA ENC28J60_ARCH_CONF_DMA
+#else
+#define ENC28J60_ARCH_DMA 0
+#endif
+
+#ifdef ENC28J60_ARCH_CONF_DMA_THRESHOLD
+#define ENC28J60_ARCH_DMA_THRESHOLD ENC28J60_ARCH_CONF_DMA_THRESHOLD
+#else
+#define ENC28J60_ARCH_DMA_THRESHOLD 16
+#endif
+
+#if ENC28J60_ARCH_DMA
+#if ETH_SPI_INSTANCE == 0
+#define RX_DMA_CHAN 10
+#define TX_DMA_CHAN 11
+#define RX_DMA_ENC  UDMA_CH10_SSI0RX
+#define TX_DMA_ENC  UDMA_CH11_SSI0TX
+#else
+#define RX_DMA_CHAN 24
+#define TX_DMA_CHAN 25
+#define RX_DMA_ENC  UDMA_CH24_SSI1RX
+#define TX_DMA_ENC  UDMA_CH25_SSI1TX
+#endif
+
+#if TX_DMA_CHAN > UDMA_CONF_MAX_CHANNEL
+#error UDMA_CONF_MAX_CHANNEL does not cover the ENC28J60 SPI uDMA channels
+#endif
+
+#define DMA_FLAGS (UDMA_CHCTL_SRCSIZE_8 | UDMA_CHCTL_DSTSIZE_8 \
+    | UDMA_CHCTL_ARBSIZE_1 | UDMA_CHCTL_XFERMODE_BASIC)
+/*---------------------------------------------------------------------------*/
+static void
+dma_init(void)
+{
+  udma_set_channel_assignment(RX_DMA_CHAN, RX_DMA_ENC);
+  udma_set_channel_assignment(TX_DMA_CHAN, TX_DMA_ENC);
+  udma_channel_mask_clr(RX_DMA_CHAN);
+  udma_channel_mask_clr(TX_DMA_CHAN);
+  udma_channel_use_single(RX_DMA_CHAN);
+  udma_channel_use_single(TX_DMA_CHAN);
+  /* The RX FIFO must never overflow while the TX channel runs ahead */
+  udma_channel_prio_set_high(RX_DMA_CHAN);
+  udma_set_channel_src(RX_DMA_CHAN, SSI_BASE(ETH_SPI_INSTANCE) + SSI_DR);
+  udma_set_channel_dst(TX_DMA_CHAN, SSI_BASE(ETH_SPI_INSTANCE) + SSI_DR);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Clock len bytes. Bytes are sent from tx, or zeros if it is NULL, and
+ * received into rx, or discarded if it is NULL.
+ */
+static void
+dma_transfer(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+  static const uint8_t zero;
+  static uint8_t discard;
+
+  if(tx != NULL) {
+    udma_set_channel_src(TX_DMA_CHAN, (uint32_t)&tx[len - 1]);
+    udma_set_channel_control_word(TX_DMA_CHAN, DMA_FLAGS |
+                                  UDMA_CHCTL_SRCINC_8 |
+                                  UDMA_CHCTL_DSTINC_NONE |
+                                  udma_xfer_size(len));
+  } else {
+    udma_set_channel_src(TX_DMA_CHAN, (uint32_t)&zero);
+    udma_set_channel_control_word(TX_DMA_CHAN, DMA_FLAGS |
+                                  UDMA_CHCTL_SRCINC_NONE |
+                                  UDMA_CHCTL_DSTINC_NONE |
+                                  udma_xfer_size(len));
+  }
+  if(rx != NULL) {
+    udma_set_channel_dst(RX_DMA_CHAN, (uint32_t)&rx[len - 1]);
+    udma_set_channel_control_word(RX_DMA_CHAN, DMA_FLAGS |
+                                  UDMA_CHCTL_SRCINC_NONE |
+                                  UDMA_CHCTL_DSTINC_8 |
+                                  udma_xfer_size(len));
+  } else {
+    udma_set_channel_dst(RX_DMA_CHAN, (uint32_t)&discard);
+    udma_set_channel_control_word(RX_DMA_CHAN, DMA_FLAGS |
+                                  UDMA_CHCTL_SRCINC_NONE |
+                                  UDMA_CHCTL_DSTINC_NONE |
+                                  udma_xfer_size(len));
+  }
+
+  udma_channel_enable(RX_DMA_CHAN);
+  udma_channel_enable(TX_DMA_CHAN);
+  REG(SSI_BASE(ETH_SPI_INSTANCE) + SSI_DMACTL) = SSI_DMACTL_RXDMAE |
+    SSI_DMACTL_TXDMAE;
+
+  while(udma_channel_get_mode(RX_DMA_CHAN) != UDMA_CHCTL_XFERMODE_STOP);
+
+  REG(SSI_BASE(ETH_SPI_INSTANCE) + SSI_DMACTL) = 0;
+}
+#endif /* ENC28J60_ARCH_DMA */
+/*---------------------------------------------------------------------------*/
 void
 enc28j60_arch_spi_init(void)
 {
@@ -59,6 +167,9 @@ enc28j60_arch_spi_init(void)
   GPIO_SOFTWARE_CONTROL(RESET_PORT, RESET_BIT);
   GPIO_SET_OUTPUT(RESET_PORT, RESET_BIT);
   GPIO_SET_INPUT(RESET_PORT, RESET_BIT);
+#if ENC28J60_ARCH_DMA
+  dma_init();
+#endif
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -73,15 +184,14 @@ enc28j60_arch_spi_deselect(void)
   SPIX_CS_SET(ETH_SPI_CSN_PORT, ETH_SPI_CSN_PIN);
 }
 /*---------------------------------------------------------------------------*/
-void
+uint8_t
 enc28j60_arch_spi_write(uint8_t output)
 {
   SPIX_WAITFORTxREADY(ETH_SPI_INSTANCE);
   SPIX_BUF(ETH_SPI_INSTANCE) = output;
   SPIX_WAITFOREOTx(ETH_SPI_INSTANCE);
   SPIX_WAITFOREORx(ETH_SPI_INSTANCE);
-  uint32_t dummy = SPIX_BUF(ETH_SPI_INSTANCE);
-  (void) dummy;
+  return SPIX_BUF(ETH_SPI_INSTANCE);
 }
 /*---------------------------------------------------------------------------*/
 uint8_t
@@ -94,6 +204,59 @@ enc28j60_arch_spi_read(void)
   return SPIX_BUF(ETH_SPI_INSTANCE);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Without the uDMA, keep up to a FIFO's worth of bytes in flight instead
+ * of waiting for each byte to come back before sending the next one.
+ */
+static void
+fifo_transfer(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+  uint16_t sent;
+  uint16_t received;
+  uint8_t c;
+
+  sent = 0;
+  received = 0;
+  while(received < len) {
+    if(sent < len && sent - received < SSI_FIFO_DEPTH &&
+       (REG(SSI_BASE(ETH_SPI_INSTANCE) + SSI_SR) & SSI_SR_TNF)) {
+      SPIX_BUF(ETH_SPI_INSTANCE) = tx != NULL ? tx[sent] : 0;
+      sent++;
+    }
+    if(REG(SSI_BASE(ETH_SPI_INSTANCE) + SSI_SR) & SSI_SR_RNE) {
+      c = SPIX_BUF(ETH_SPI_INSTANCE);
+      if(rx != NULL) {
+        rx[received] = c;
+      }
+      received++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+enc28j60_arch_spi_read_block(uint8_t *buf, uint16_t len)
+{
+#if ENC28J60_ARCH_DMA
+  if(len > ENC28J60_ARCH_DMA_THRESHOLD) {
+    dma_transfer(NULL, buf, len);
+    return;
+  }
+#endif
+  fifo_transfer(NULL, buf, len);
+}
+/*---------------------------------------------------------------------------*/
+void
+enc28j60_arch_spi_write_block(const uint8_t *buf, uint16_t len)
+{
+#if ENC28J60_ARCH_DMA
+  if(len > ENC28J60_ARCH_DMA_THRESHOLD) {
+    dma_transfer(buf, NULL, len);
+    return;
+  }
+#endif
+  fifo_transfer(buf, NULL, len);
+}
+/*---------------------------------------------------------------------------*/
 /**
  * @}
  * @}
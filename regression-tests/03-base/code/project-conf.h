@@ -34,4 +34,15 @@
 
 #define UNIT_TEST_PRINT_FUNCTION test_print_report
 
+/* Index the routing table with a trie for test-ds6-route-trie */
+#undef UIP_DS6_ROUTE_CONF_TRIE
+#define UIP_DS6_ROUTE_CONF_TRIE 1
+#undef UIP_CONF_MAX_ROUTES
+#define UIP_CONF_MAX_ROUTES     32
+
+/* Look up the next hops of test-ds6-route-trie through the neighbor
+   table hash index */
+#undef NBR_TABLE_CONF_WITH_HASH
+#define NBR_TABLE_CONF_WITH_HASH 1
+
 #endif /* !_PROJECT_CONF_H_ */
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "unit-test.h"
+
+#include "net/ipv6/uip-ds6.h"
+#include "lib/random.h"
+
+PROCESS(test_process, "uip-ds6-route trie test");
+AUTOSTART_PROCESSES(&test_process);
+
+#define NUM_NEXTHOPS 2
+
+static uip_ipaddr_t nexthops[NUM_NEXTHOPS];
+
+static void
+test_print_report(const unit_test_t *utp)
+{
+  printf("=check-me= ");
+  if(utp->result == unit_test_failure) {
+    printf("FAILED   - %s: exit at L%u\n", utp->descr, utp->exit_line);
+  } else {
+    printf("SUCCEEDED - %s\n", utp->descr);
+  }
+}
+
+static void
+set_addr(uip_ipaddr_t *addr, uint16_t net, uint16_t iid)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, net, 0, 0, 0, iid);
+}
+
+static void
+remove_all_routes(void)
+{
+  while(uip_ds6_route_head() != NULL) {
+    uip_ds6_route_rm(uip_ds6_route_head());
+  }
+}
+
+/* The reference longest-prefix match over the route list. Routes are
+   not reordered on lookup when the trie is used, so the last match of
+   a given length is the oldest route, which is what the trie keeps. */
+static uip_ds6_route_t *
+list_lookup(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  uip_ds6_route_t *found;
+
+  found = NULL;
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length) &&
+       (found == NULL || r->length >= found->length)) {
+      found = r;
+    }
+  }
+  return found;
+}
+
+UNIT_TEST_REGISTER(test_trie_longest_match, "Longest match");
+UNIT_TEST(test_trie_longest_match)
+{
+  uip_ipaddr_t addr;
+  uip_ds6_route_t *host1;
+  uip_ds6_route_t *host2;
+  uip_ds6_route_t *net0;
+  uip_ds6_route_t *net1;
+
+  UNIT_TEST_BEGIN();
+
+  remove_all_routes();
+
+  set_addr(&addr, 0, 1);
+  host1 = uip_ds6_route_add(&addr, 128, &nexthops[1]);
+  set_addr(&addr, 0, 2);
+  host2 = uip_ds6_route_add(&addr, 128, &nexthops[0]);
+  set_addr(&addr, 0, 0);
+  net0 = uip_ds6_route_add(&addr, 64, &nexthops[0]);
+  set_addr(&addr, 1, 0);
+  net1 = uip_ds6_route_add(&addr, 64, &nexthops[1]);
+  UNIT_TEST_ASSERT(host1 != NULL && host2 != NULL &&
+                   net0 != NULL && net1 != NULL);
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 4);
+
+  set_addr(&addr, 0, 1);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == host1);
+  set_addr(&addr, 0, 2);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == host2);
+  set_addr(&addr, 0, 3);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == net0);
+  set_addr(&addr, 1, 5);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == net1);
+  set_addr(&addr, 2, 1);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == NULL);
+
+  /* Removing a host route uncovers the network route */
+  uip_ds6_route_rm(host1);
+  set_addr(&addr, 0, 1);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == net0);
+
+  /* Removing the network route leaves the other host route in place */
+  uip_ds6_route_rm(net0);
+  set_addr(&addr, 0, 1);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == NULL);
+  set_addr(&addr, 0, 2);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == host2);
+
+  /* Removing a next hop removes all routes through it */
+  uip_ds6_route_rm_by_nexthop(&nexthops[1]);
+  set_addr(&addr, 1, 5);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == NULL);
+  set_addr(&addr, 0, 2);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == host2);
+
+  remove_all_routes();
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 0);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == NULL);
+
+  UNIT_TEST_END();
+}
+
+UNIT_TEST_REGISTER(test_trie_random, "Random routes");
+UNIT_TEST(test_trie_random)
+{
+  uip_ipaddr_t addr;
+  uip_ds6_route_t *r;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  remove_all_routes();
+
+  for(i = 0; i < 200; i++) {
+    set_addr(&addr, random_rand() % 4, random_rand() % 64);
+    if(random_rand() % 4 == 0) {
+      uip_ds6_route_add(&addr, 64, &nexthops[random_rand() % NUM_NEXTHOPS]);
+    } else if(random_rand() % 3 == 0) {
+      r = uip_ds6_route_lookup(&addr);
+      if(r != NULL) {
+        uip_ds6_route_rm(r);
+      }
+    } else {
+      uip_ds6_route_add(&addr, 128, &nexthops[random_rand() % NUM_NEXTHOPS]);
+    }
+
+    set_addr(&addr, random_rand() % 4, random_rand() % 64);
+    UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == list_lookup(&addr));
+  }
+
+  remove_all_routes();
+
+  UNIT_TEST_END();
+}
+
+PROCESS_THREAD(test_process, ev, data)
+{
+  uip_lladdr_t lladdr;
+  int i;
+
+  PROCESS_BEGIN();
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  memset(&lladdr, 0, sizeof(lladdr));
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    lladdr.addr[sizeof(lladdr.addr) - 1] = i + 1;
+    uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE,
+                    NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+
+  UNIT_TEST_RUN(test_trie_longest_match);
+  UNIT_TEST_RUN(test_trie_random);
+
+  printf("=check-me= DONE\n");
+  PROCESS_END();
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "unit-test.h"
+
+#include "net/ip/ip-chksum.h"
+#include "net/ip/uip.h"
+#include "lib/random.h"
+
+PROCESS(test_process, "ip-chksum test");
+AUTOSTART_PROCESSES(&test_process);
+
+#define BUF_SIZE 1300
+
+static uint32_t buf_aligned[BUF_SIZE / 4 + 1];
+static uint8_t *buf = (uint8_t *)buf_aligned;
+
+static void
+test_print_report(const unit_test_t *utp)
+{
+  printf("=check-me= ");
+  if(utp->result == unit_test_failure) {
+    printf("FAILED   - %s: exit at L%u\n", utp->descr, utp->exit_line);
+  } else {
+    printf("SUCCEEDED - %s\n", utp->descr);
+  }
+}
+
+/* The classic byte-pair sum, to compare against. */
+static uint16_t
+ref_chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t t;
+
+  for(; len > 1; len -= 2, data += 2) {
+    t = (data[0] << 8) + data[1];
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+  if(len == 1) {
+    t = data[0] << 8;
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+  return sum;
+}
+
+static void
+fill_random(uint8_t *data, uint16_t len)
+{
+  uint16_t i;
+  uint8_t pattern;
+
+  pattern = random_rand() % 3;
+  for(i = 0; i < len; i++) {
+    data[i] = pattern == 0 ? 0xff : pattern == 1 ? 0 : random_rand();
+  }
+}
+
+/* The checksum field for a buffer, as it would be stored in a packet. */
+static uint16_t
+field(const uint8_t *data, uint16_t len)
+{
+  return uip_htons(~ip_chksum(0, data, len));
+}
+
+UNIT_TEST_REGISTER(test_chksum, "Checksum");
+UNIT_TEST(test_chksum)
+{
+  int i;
+  uint16_t offset;
+  uint16_t len;
+  uint16_t sum;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(ip_chksum(0, buf, 0) == 0);
+
+  for(i = 0; i < 500; i++) {
+    offset = random_rand() % 8;
+    len = random_rand() % (BUF_SIZE - 8);
+    sum = random_rand() % 2 ? 0 : random_rand();
+    fill_random(buf + offset, len);
+    UNIT_TEST_ASSERT(ip_chksum(sum, buf + offset, len) ==
+                     ref_chksum(sum, buf + offset, len));
+  }
+
+  UNIT_TEST_END();
+}
+
+UNIT_TEST_REGISTER(test_replace, "Incremental update");
+UNIT_TEST(test_replace)
+{
+  int i;
+  uint16_t len;
+  uint16_t offset;
+  uint16_t n;
+  uint16_t chksum;
+  uint16_t old;
+  uint16_t new;
+  uint8_t saved[32];
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < 500; i++) {
+    /* The first word is never rewritten and keeps the data non-zero,
+       like the protocol number in a pseudo-header: an all-zero buffer
+       would sum to +0, which an update cannot tell from -0. */
+    len = 4 + random_rand() % (BUF_SIZE - 4);
+    fill_random(buf, len);
+    buf[0] = 0x11;
+    chksum = field(buf, len);
+
+    /* Rewrite a region at an even offset */
+    offset = 2 + ((random_rand() % (len - 2)) & ~1);
+    n = random_rand() % sizeof(saved);
+    if(n > len - offset) {
+      n = len - offset;
+    }
+    memcpy(saved, buf + offset, n);
+    fill_random(buf + offset, n);
+    chksum = ip_chksum_replace(chksum, saved, n, buf + offset, n);
+    UNIT_TEST_ASSERT(chksum == field(buf, len));
+
+    /* Rewrite a single word */
+    memcpy(&old, buf + offset, 2);
+    buf[offset] = random_rand();
+    memcpy(&new, buf + offset, 2);
+    chksum = ip_chksum_replace16(chksum, old, new);
+    UNIT_TEST_ASSERT(chksum == field(buf, len));
+  }
+
+  /* Swap a 32-byte prefix for an 8-byte one, as in an IPv6 to IPv4
+     pseudo-header translation */
+  for(i = 0; i < 100; i++) {
+    len = 40 + random_rand() % (BUF_SIZE - 40);
+    fill_random(buf, len);
+    buf[len - 1] = 0x11;
+    chksum = field(buf, len);
+    memcpy(saved, buf, 32);
+    fill_random(buf + 24, 8);
+    chksum = ip_chksum_replace(chksum, saved, 32, buf + 24, 8);
+    UNIT_TEST_ASSERT(chksum == field(buf + 24, len - 24));
+  }
+
+  UNIT_TEST_END();
+}
+
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_chksum);
+  UNIT_TEST_RUN(test_replace);
+
+  printf("=check-me= DONE\n");
+  PROCESS_END();
+}
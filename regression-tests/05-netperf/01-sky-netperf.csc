@@ -118,6 +118,26 @@ started = 0;
 while(true) {
   YIELD(); /* wait for another mote output */
   log.log(time + " " + id + " " + msg + "\n");
+  if(msg.endsWith("# for automatic processing")) {
+    /* type remote sent received timedout time txlat rxlat cpu lpm rx tx */
+    s = msg.split(" ");
+    tag = "netperf" + s[0] + (s[1] == "0" ? "-local" : "-remote");
+    sent = parseInt(s[2]);
+    received = parseInt(s[3]);
+    total = parseInt(s[8]) + parseInt(s[9]);
+    if(sent &gt; 0) {
+      log.log("METRIC " + tag + "-pdr " + (100 * received / sent).toFixed(1) + " higher\n");
+    }
+    if(s[1] == "0" &amp;&amp; received &gt; 0) {
+      /* Sky rtimer ticks, 32768 per second */
+      log.log("METRIC " + tag + "-rtt-ms " +
+              (1000 * (parseInt(s[6]) + parseInt(s[7])) / received / 32768).toFixed(1) + " lower\n");
+    }
+    if(total &gt; 0) {
+      log.log("METRIC " + tag + "-duty-cycle " +
+              (100 * (parseInt(s[10]) + parseInt(s[11])) / total).toFixed(2) + " lower\n");
+    }
+  }
   if(msg.startsWith("Done")) {
     log.testOK();
   }
@@ -289,9 +289,23 @@ make receiver-node.cooja TARGET=cooja</commands>
 &#xD;
 lostMsgs = 0;&#xD;
 &#xD;
-TIMEOUT(1000000, if(lastMsg != -1 &amp;&amp; lostMsgs == 0) { log.testOK(); } );&#xD;
+/* Logged for "make metrics": time from the start to the first packet&#xD;
+   reaching the sink, delivery ratio and average hop count */&#xD;
+function logMetrics() {&#xD;
+    if(firstMsg != -1) {&#xD;
+        log.log("METRIC convergence-ms " + firstTime / 1000 + " lower\n");&#xD;
+        log.log("METRIC pdr " + (100 * receivedMsgs / (lastMsg - firstMsg + 1)).toFixed(1) + " higher\n");&#xD;
+        log.log("METRIC hops " + (totalHops / receivedMsgs).toFixed(2) + " lower\n");&#xD;
+    }&#xD;
+}&#xD;
+&#xD;
+TIMEOUT(1000000, logMetrics(); if(lastMsg != -1 &amp;&amp; lostMsgs == 0) { log.testOK(); } );&#xD;
 &#xD;
 lastMsg = -1;&#xD;
+firstMsg = -1;&#xD;
+firstTime = 0;&#xD;
+receivedMsgs = 0;&#xD;
+totalHops = 0;&#xD;
 packets = "_________";&#xD;
 hops = 0;&#xD;
 &#xD;
@@ -317,6 +331,12 @@ while(true) {&#xD;
     } else if(msg.startsWith("Data")) {&#xD;
         data = msg.split(" ");&#xD;
         num = parseInt(data[14]);&#xD;
+        if(firstMsg == -1) {&#xD;
+            firstMsg = num;&#xD;
+            firstTime = time;&#xD;
+        }&#xD;
+        receivedMsgs++;&#xD;
+        totalHops += hops;&#xD;
         if(lastMsg != -1) {&#xD;
           if(num != lastMsg + 1) {&#xD;
             numMissed = num - lastMsg - 1;&#xD;
@@ -75,4 +75,6 @@ while(Object.keys(completed).length < NR_FEATHERS) {
     YIELD();
 }
 
+/* Time until every node has fetched its page over the RPL network */
+log.log("METRIC completion-ms " + time / 1000 + " lower\n");
 log.testOK();
@@ -0,0 +1,22 @@
+TIMEOUT(1800000); /* 30 minutes */
+
+while(true) {
+  YIELD();
+  if(msg.startsWith("netperf6:")) {
+    log.log(time + " " + id + " " + msg + "\n");
+  }
+  if(msg.startsWith("netperf6: ") && msg.indexOf(" sent ") > 0) {
+    /* netperf6: <mode> sent N delivered N pdr N bytes N time N ms tput N bps
+       lat p50 p90 p99 ms energy N uJ N nJ/bit */
+    s = msg.split(" ");
+    tag = s[1];
+    log.log("METRIC " + tag + "-pdr " + s[7] + " higher\n");
+    log.log("METRIC " + tag + "-tput-bps " + s[14] + " higher\n");
+    log.log("METRIC " + tag + "-lat50-ms " + s[17] + " lower\n");
+    log.log("METRIC " + tag + "-lat99-ms " + s[19] + " lower\n");
+    log.log("METRIC " + tag + "-energy-nj-bit " + s[24] + " lower\n");
+  }
+  if(msg.startsWith("netperf6: done")) {
+    log.testOK();
+  }
+}
@@ -0,0 +1,52 @@
+#!/bin/bash
+# Compare the performance metrics of a regression test run with a stored
+# baseline. Both files hold "<test>:<metric> <value> higher|lower" lines,
+# as written by "make metrics"; the last field tells which direction is
+# better.
+#
+# Usage: perf-compare.sh <baseline> <current> [threshold in percent]
+#
+# Prints every metric that got worse by more than the threshold and
+# returns 1 if there was one. Metrics that are new or missing from the
+# current run are listed but do not fail the comparison.
+
+BASELINE=$1
+CURRENT=$2
+THRESHOLD=${3:-10}
+
+if [ ! -f "$BASELINE" ] || [ ! -f "$CURRENT" ]; then
+	echo "Usage: $0 <baseline> <current> [threshold in percent]"
+	exit 2
+fi
+
+awk -v threshold="$THRESHOLD" '
+FNR == NR {
+	base[$1] = $2
+	next
+}
+{
+	seen[$1] = 1
+	if(!($1 in base)) {
+		printf "NEW        %s %s\n", $1, $2
+		next
+	}
+	old = base[$1]
+	delta = $3 == "higher" ? old - $2 : $2 - old
+	limit = (old < 0 ? -old : old) * threshold / 100
+	change = old != 0 ? sprintf("%+.1f%%", 100 * ($2 - old) / (old < 0 ? -old : old)) : "n/a"
+	if(delta > limit) {
+		printf "REGRESSION %s %s -> %s (%s)\n", $1, old, $2, change
+		regressions++
+	} else if(-delta > limit) {
+		printf "IMPROVED   %s %s -> %s (%s)\n", $1, old, $2, change
+	}
+}
+END {
+	for(m in base) {
+		if(!(m in seen)) {
+			printf "MISSING    %s\n", m
+		}
+	}
+	printf "%d regressions beyond %s%%\n", regressions, threshold
+	exit regressions > 0
+}' "$BASELINE" "$CURRENT"
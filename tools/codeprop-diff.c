@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/*
+ * Produce a binary patch that turns one file into another, for
+ * apps/delta-patch. See apps/delta-patch/delta-patch.h for the
+ * format.
+ *
+ * Matches are found greedily through a hash of every 4-byte sequence
+ * in the old file. Code modules that are rebuilt after a small change
+ * mostly differ in a few relocated addresses, so most of the new file
+ * is described by COPY operations.
+ *
+ * Usage: codeprop-diff oldfile newfile patchfile
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#define VERSION    1
+
+#define OP_COPY    0x01
+#define OP_ADD     0x02
+
+#define MAX_OPLEN  0xffff
+
+/* A COPY takes 7 bytes, so shorter matches are better sent as data. */
+#define MIN_MATCH  8
+#define SEED       4
+#define MAX_CHAIN  256
+
+#define HASH_BITS  16
+#define HASH(p) ((((uint32_t)(p)[0] << 24 | (p)[1] << 16 | (p)[2] << 8 | \
+                   (p)[3]) * 2654435761u) >> (32 - HASH_BITS))
+
+static FILE *out;
+static unsigned long ncopy, nadd, addbytes;
+/*---------------------------------------------------------------------------*/
+/* Same as crc16_add() in core/lib/crc16.c. */
+static uint16_t
+crc16(const uint8_t *data, long len)
+{
+  uint16_t acc = 0;
+  int i;
+
+  while(len-- > 0) {
+    acc ^= *data++;
+    for(i = 0; i < 8; i++) {
+      acc = (acc & 1) ? (acc >> 1) ^ 0x8408 : acc >> 1;
+    }
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+load(const char *name, long *len)
+{
+  FILE *f;
+  uint8_t *buf;
+
+  if((f = fopen(name, "rb")) == NULL) {
+    perror(name);
+    exit(1);
+  }
+  fseek(f, 0, SEEK_END);
+  *len = ftell(f);
+  rewind(f);
+  buf = malloc(*len + 1);
+  if(buf == NULL || fread(buf, 1, *len, f) != (size_t)*len) {
+    fprintf(stderr, "%s: read failed\n", name);
+    exit(1);
+  }
+  fclose(f);
+  return buf;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put(uint32_t v, int bytes)
+{
+  while(bytes-- > 0) {
+    putc((v >> (8 * bytes)) & 0xff, out);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+emit_add(const uint8_t *data, long len)
+{
+  long n;
+
+  for(; len > 0; len -= n, data += n) {
+    n = len > MAX_OPLEN ? MAX_OPLEN : len;
+    putc(OP_ADD, out);
+    put(n, 2);
+    fwrite(data, 1, n, out);
+    nadd++;
+    addbytes += n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+emit_copy(long offset, long len)
+{
+  long n;
+
+  for(; len > 0; len -= n, offset += n) {
+    n = len > MAX_OPLEN ? MAX_OPLEN : len;
+    putc(OP_COPY, out);
+    put(offset, 4);
+    put(n, 2);
+    ncopy++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  uint8_t *old, *new;
+  long oldlen, newlen;
+  long *head, *next;
+  long i, j, lit, pos, len, best, bestpos;
+  int chain;
+
+  if(argc != 4) {
+    fprintf(stderr, "usage: %s oldfile newfile patchfile\n", argv[0]);
+    exit(1);
+  }
+  old = load(argv[1], &oldlen);
+  new = load(argv[2], &newlen);
+  if(oldlen > 0xffffffffL || newlen > 0xffffffffL) {
+    fprintf(stderr, "%s: file too large\n", argv[0]);
+    exit(1);
+  }
+
+  if((out = fopen(argv[3], "wb")) == NULL) {
+    perror(argv[3]);
+    exit(1);
+  }
+  putc('D', out);
+  putc('P', out);
+  putc(VERSION, out);
+  putc(0, out);
+  put(oldlen, 4);
+  put(crc16(old, oldlen), 2);
+  put(newlen, 4);
+  put(crc16(new, newlen), 2);
+
+  /* Chain every position of the old file by the hash of its seed, with
+     the lowest offset first so that searches prefer earlier matches. */
+  head = malloc(sizeof(long) << HASH_BITS);
+  next = malloc(sizeof(long) * (oldlen + 1));
+  if(head == NULL || next == NULL) {
+    fprintf(stderr, "%s: out of memory\n", argv[0]);
+    exit(1);
+  }
+  for(i = 0; i < (1L << HASH_BITS); i++) {
+    head[i] = -1;
+  }
+  for(i = oldlen - SEED; i >= 0; i--) {
+    next[i] = head[HASH(&old[i])];
+    head[HASH(&old[i])] = i;
+  }
+
+  lit = 0;
+  for(i = 0; i < newlen; ) {
+    best = 0;
+    bestpos = 0;
+    if(i + SEED <= newlen) {
+      chain = 0;
+      for(pos = head[HASH(&new[i])]; pos >= 0 && chain < MAX_CHAIN;
+          pos = next[pos], chain++) {
+        for(len = 0; pos + len < oldlen && i + len < newlen &&
+              old[pos + len] == new[i + len]; len++);
+        if(len > best) {
+          best = len;
+          bestpos = pos;
+        }
+      }
+    }
+    if(best >= MIN_MATCH) {
+      /* Let the match also swallow equal bytes before it. */
+      for(j = 0; j < i - lit && bestpos - j > 0 &&
+            old[bestpos - j - 1] == new[i - j - 1]; j++);
+      emit_add(&new[lit], i - j - lit);
+      emit_copy(bestpos - j, best + j);
+      i += best;
+      lit = i;
+    } else {
+      i++;
+    }
+  }
+  emit_add(&new[lit], newlen - lit);
+
+  printf("%ld -> %ld bytes: %lu copies, %lu adds with %lu bytes, "
+         "patch %ld bytes\n", oldlen, newlen, ncopy, nadd, addbytes,
+         ftell(out));
+  fclose(out);
+  return 0;
+}
@@ -51,15 +51,27 @@
    isn't set up for that. */
 #define HDR_SIZE 4
 
+/* Values of the pad field of the header, see apps/codeprop/codeprop-tmp.c */
+#define HDR_IMAGE 0
+#define HDR_PATCH 1
+
 int
 main(int argc, char **argv) {
   struct sockaddr_in sa;
   int s, port, fd;
   char *ip_addr;
   int total = 0;
+  int type = HDR_IMAGE;
 
+  /* With -p the file is a patch made with codeprop-diff against the
+     module that the node loaded last. */
+  if(argc == 4 && strcmp(argv[1], "-p") == 0) {
+    type = HDR_PATCH;
+    argc--;
+    argv++;
+  }
   if(argc != 3) {
-    printf("usage: %s ipaddress filename\n", argv[0]);
+    printf("usage: %s [-p] ipaddress filename\n", argv[0]);
     exit(1);
   }
   ip_addr = argv[1];
@@ -124,6 +136,8 @@ main(int argc, char **argv) {
     total += len;
     buf[0] = len >> 8;
     buf[1] = len & 0xff;
+    buf[2] = 0;
+    buf[3] = type;
     if(write(s, buf, len + HDR_SIZE) == -1) {
       perror("network send failed");
       exit(1);
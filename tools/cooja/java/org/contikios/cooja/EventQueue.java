@@ -150,6 +150,22 @@ public class EventQueue {
     return tmp;
   }
 
+  /**
+   * Should only be called from simulation thread!
+   *
+   * @return First scheduled event, which is left in the queue
+   */
+  public TimeEvent peekFirstScheduled() {
+    while (first != null && !first.isScheduled) {
+      TimeEvent tmp = first;
+      first = tmp.nextEvent;
+      tmp.nextEvent = null;
+      tmp.queue = null;
+      eventCount--;
+    }
+    return first;
+  }
+
   public TimeEvent peekFirst() {
     return first;
   }
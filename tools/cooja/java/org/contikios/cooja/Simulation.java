@@ -31,10 +31,16 @@ package org.contikios.cooja;
 import java.util.ArrayDeque;
 import java.util.ArrayList;
 import java.util.Collection;
+import java.util.HashSet;
 import java.util.Observable;
 import java.util.Observer;
 import java.util.Random;
 import java.util.Vector;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.ThreadFactory;
 
 import javax.swing.JOptionPane;
 
@@ -42,6 +48,7 @@ import org.apache.log4j.Logger;
 import org.jdom.Element;
 
 import org.contikios.cooja.dialogs.CreateSimDialog;
+import org.contikios.cooja.motes.ParallelTickMote;
 
 /**
  * A simulation consists of a number of motes and mote types.
@@ -94,6 +101,10 @@ public class Simulation extends Observable implements Runnable {
 
   private long maxMoteStartupDelay = 1000*MILLISECOND;
 
+  /* Threads ticking motes concurrently, 0 to tick all motes in turn */
+  private int parallelThreads = 0;
+  private ExecutorService parallelExecutor = null;
+
   private SafeRandom randomGenerator;
 
   private boolean hasMillisecondObservers = false;
@@ -259,6 +270,16 @@ public class Simulation extends Observable implements Runnable {
     this.setChanged();
     this.notifyObservers(this);
 
+    if (parallelThreads > 1) {
+      parallelExecutor = Executors.newFixedThreadPool(parallelThreads - 1, new ThreadFactory() {
+        public Thread newThread(Runnable r) {
+          Thread t = new Thread(r, "mote ticks");
+          t.setDaemon(true);
+          return t;
+        }
+      });
+    }
+
     TimeEvent nextEvent = null;
     try {
       while (isRunning) {
@@ -278,7 +299,11 @@ public class Simulation extends Observable implements Runnable {
         }
         currentSimulationTime = nextEvent.time;
         /*logger.info("Executing event #" + EVENT_COUNTER++ + " @ " + currentSimulationTime + ": " + nextEvent);*/
-        nextEvent.execute(currentSimulationTime);
+        if (parallelExecutor != null && getParallelTickMote(nextEvent) != null) {
+          executeParallelTicks(getParallelTickMote(nextEvent));
+        } else {
+          nextEvent.execute(currentSimulationTime);
+        }
 
         if (stopSimulation) {
           isRunning = false;
@@ -303,6 +328,10 @@ public class Simulation extends Observable implements Runnable {
     		}
     	}
     }
+    if (parallelExecutor != null) {
+      parallelExecutor.shutdown();
+      parallelExecutor = null;
+    }
     isRunning = false;
     simulationThread = null;
     stopSimulation = false;
@@ -318,6 +347,87 @@ public class Simulation extends Observable implements Runnable {
                  (double)(System.currentTimeMillis() - lastStartTime)));
   }
 
+  private ParallelTickMote getParallelTickMote(TimeEvent e) {
+    if (!(e instanceof MoteTimeEvent)) {
+      return null;
+    }
+    Mote mote = ((MoteTimeEvent)e).getMote();
+    if (!(mote instanceof ParallelTickMote) ||
+        !((ParallelTickMote)mote).isExecuteEvent(e)) {
+      return null;
+    }
+    return (ParallelTickMote)mote;
+  }
+
+  /**
+   * Execute the given mote together with the motes that follow it in the
+   * event queue at the same simulation time, as long as they are in
+   * different tick groups. The motes are prepared and finished in queue
+   * order on the simulation thread, and only their ticks run concurrently.
+   *
+   * Motes only affect each other through their interfaces, which are
+   * handled before and after the ticks, so the result is the same as
+   * for some serial order of these simultaneous events. Any event that
+   * is not a mote tick ends the batch, as does a second mote of a group.
+   *
+   * @param first Mote whose execute event was just popped
+   */
+  private void executeParallelTicks(ParallelTickMote first) {
+    ArrayList<ParallelTickMote> batch = new ArrayList<ParallelTickMote>();
+    HashSet<Object> groups = new HashSet<Object>();
+    batch.add(first);
+    groups.add(first.getTickGroup());
+
+    while (true) {
+      TimeEvent e = eventQueue.peekFirstScheduled();
+      if (e == null || e.time != currentSimulationTime) {
+        break;
+      }
+      ParallelTickMote mote = getParallelTickMote(e);
+      if (mote == null || !groups.add(mote.getTickGroup())) {
+        break;
+      }
+      eventQueue.popFirst();
+      batch.add(mote);
+    }
+
+    ArrayList<ParallelTickMote> ticking = new ArrayList<ParallelTickMote>();
+    for (ParallelTickMote mote: batch) {
+      if (mote.beforeTick(currentSimulationTime)) {
+        ticking.add(mote);
+      }
+    }
+
+    ArrayList<Future<?>> ticks = new ArrayList<Future<?>>();
+    for (int i = 1; i < ticking.size(); i++) {
+      final ParallelTickMote mote = ticking.get(i);
+      ticks.add(parallelExecutor.submit(new Runnable() {
+        public void run() {
+          mote.tick();
+        }
+      }));
+    }
+    if (!ticking.isEmpty()) {
+      ticking.get(0).tick();
+    }
+    for (Future<?> tick: ticks) {
+      try {
+        tick.get();
+      } catch (ExecutionException e) {
+        if (e.getCause() instanceof RuntimeException) {
+          throw (RuntimeException) e.getCause();
+        }
+        throw new RuntimeException(e.getCause());
+      } catch (InterruptedException e) {
+        throw new RuntimeException(e);
+      }
+    }
+
+    for (ParallelTickMote mote: ticking) {
+      mote.afterTick();
+    }
+  }
+
   /**
    * Creates a new simulation
    */
@@ -496,6 +606,13 @@ public class Simulation extends Observable implements Runnable {
     element.setText(Long.toString(maxMoteStartupDelay));
     config.add(element);
 
+    /* Concurrent mote ticks */
+    if (parallelThreads > 0) {
+      element = new Element("parallelthreads");
+      element.setText(Integer.toString(parallelThreads));
+      config.add(element);
+    }
+
     // Radio Medium
     element = new Element("radiomedium");
     element.setText(currentRadioMedium.getClass().getName());
@@ -611,6 +728,11 @@ public class Simulation extends Observable implements Runnable {
         maxMoteStartupDelay = Integer.parseInt(element.getText());
       }
 
+      /* Concurrent mote ticks */
+      if (element.getName().equals("parallelthreads")) {
+        setParallelThreads(Integer.parseInt(element.getText()));
+      }
+
       // Radio medium
       if (element.getName().equals("radiomedium")) {
         String radioMediumClassName = element.getText().trim();
@@ -1046,6 +1168,25 @@ public class Simulation extends Observable implements Runnable {
     }
   }
 
+  /**
+   * Let up to the given number of threads tick motes concurrently.
+   * Only motes that implement ParallelTickMote, such as Contiki motes of
+   * different mote types, and that execute at the same simulation time
+   * are ticked together. Takes effect when the simulation is started.
+   *
+   * @param threads Number of threads, 0 or 1 to tick all motes in turn
+   */
+  public void setParallelThreads(int threads) {
+    parallelThreads = threads;
+  }
+
+  /**
+   * @return Number of threads ticking motes concurrently
+   */
+  public int getParallelThreads() {
+    return parallelThreads;
+  }
+
   /**
    * @return Max simulation speed ratio. Returns null if no limit.
    */
@@ -43,6 +43,7 @@ import org.contikios.cooja.mote.memory.SectionMoteMemory;
 import org.contikios.cooja.Simulation;
 import org.contikios.cooja.mote.memory.MemoryInterface;
 import org.contikios.cooja.motes.AbstractWakeupMote;
+import org.contikios.cooja.motes.ParallelTickMote;
 
 /**
  * A Contiki mote executes an actual Contiki system via
@@ -59,7 +60,7 @@ import org.contikios.cooja.motes.AbstractWakeupMote;
  *
  * @author      Fredrik Osterlind
  */
-public class ContikiMote extends AbstractWakeupMote implements Mote {
+public class ContikiMote extends AbstractWakeupMote implements Mote, ParallelTickMote {
   private static Logger logger = Logger.getLogger(ContikiMote.class);
 
   private ContikiMoteType myType = null;
@@ -127,6 +128,23 @@ public class ContikiMote extends AbstractWakeupMote implements Mote {
    */
   @Override
   public void execute(long simTime) {
+    if (beforeTick(simTime)) {
+      tick();
+      afterTick();
+    }
+  }
+
+  /**
+   * Motes of one type share the loaded library and its memory, so only
+   * motes of different types can tick concurrently.
+   */
+  @Override
+  public Object getTickGroup() {
+    return myType;
+  }
+
+  @Override
+  public boolean beforeTick(long simTime) {
 
     /* Poll mote interfaces */
     myInterfaceHandler.doActiveActionsBeforeTick();
@@ -135,9 +153,13 @@ public class ContikiMote extends AbstractWakeupMote implements Mote {
     /* Check if pre-boot time */
     if (myInterfaceHandler.getClock().getTime() < 0) {
       scheduleNextWakeup(simTime + -myInterfaceHandler.getClock().getTime());
-      return;
+      return false;
     }
+    return true;
+  }
 
+  @Override
+  public void tick() {
     /* Copy mote memory to Contiki */
     myType.setCoreMemory(myMemory);
 
@@ -146,7 +168,10 @@ public class ContikiMote extends AbstractWakeupMote implements Mote {
 
     /* Copy mote memory from Contiki */
     myType.getCoreMemory(myMemory);
+  }
 
+  @Override
+  public void afterTick() {
     /* Poll mote interfaces */
     myMemory.pollForMemoryChanges();
     myInterfaceHandler.doActiveActionsAfterTick();
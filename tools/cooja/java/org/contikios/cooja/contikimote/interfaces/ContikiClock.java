@@ -58,6 +58,8 @@ import org.contikios.cooja.mote.memory.VarMemory;
  * <li>int simEtimerProcessRunValue
  * <li>int simRtimerProcessRunValue
  * <li>int simEtimerPending
+ * <li>int simNextEventPending
+ * <li>rtimer_clock_t simNextEventTime
  * </ul>
  *
  * Core interface:
@@ -134,41 +136,13 @@ public class ContikiClock extends Clock implements ContikiMoteInterface, PolledB
   }
 
   public void doActionsAfterTick() {
-    long currentSimulationTime = mote.getSimulation().getSimulationTime();
-
-    /* Always schedule for Rtimer if anything pending */
-    if (moteMem.getIntValueOf("simRtimerPending") != 0) {
-      mote.scheduleNextWakeup(moteMem.getInt64ValueOf("simRtimerNextExpirationTime"));
-    }
-
-    /* Request next tick for remaining events / timers */
-    int processRunValue = moteMem.getIntValueOf("simProcessRunValue");
-    if (processRunValue != 0) {
-      /* Handle next Contiki event in one millisecond */
-      mote.scheduleNextWakeup(currentSimulationTime + Simulation.MILLISECOND);
-      return;
-    }
-
-    int etimersPending = moteMem.getIntValueOf("simEtimerPending");
-    if (etimersPending == 0) {
-      /* No timers */
+    /* The mote reports the next time it must run: at pending events,
+     * rtimers or etimers. Until then it is left asleep, unless woken
+     * up by another interface such as the radio. */
+    if (moteMem.getIntValueOf("simNextEventPending") == 0) {
       return;
     }
-
-    /* Request tick next wakeup time for Etimer */
-    long etimerNextExpirationTime = (long)moteMem.getInt32ValueOf("simEtimerNextExpirationTime") * Simulation.MILLISECOND;
-    long etimerTimeToNextExpiration = etimerNextExpirationTime - moteTime;
-    if (etimerTimeToNextExpiration <= 0) {
-      /* logger.warn(mote.getID() + ": Event timer already expired, but has been delayed: " + etimerTimeToNextExpiration); */
-      /* Wake up in one millisecond to handle a missed Etimer task
-       * which may be blocked by busy waiting such as one in
-       * radio_send(). Scheduling it in a shorter time than one
-       * millisecond, e.g., one microsecond, seems to be worthless and
-       * it would cause unnecessary CPU usage. */
-      mote.scheduleNextWakeup(currentSimulationTime + Simulation.MILLISECOND);
-    } else {
-      mote.scheduleNextWakeup(currentSimulationTime + etimerTimeToNextExpiration);
-    }
+    mote.scheduleNextWakeup(moteMem.getInt64ValueOf("simNextEventTime"));
   }
 
 
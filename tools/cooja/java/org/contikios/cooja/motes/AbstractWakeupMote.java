@@ -60,6 +60,14 @@ public abstract class AbstractWakeupMote implements Mote {
       this.simulation = simulation;
   }
   
+  /**
+   * @param e Time event
+   * @return True iff e is the event that executes this mote
+   */
+  public boolean isExecuteEvent(TimeEvent e) {
+    return e == executeMoteEvent;
+  }
+
   /**
    * Execute mote software.
    * This method is only called from the simulation thread.
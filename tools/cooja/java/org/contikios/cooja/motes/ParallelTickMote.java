@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2017, Swedish Institute of Computer Science. All rights
+ * reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 2. Redistributions in
+ * binary form must reproduce the above copyright notice, this list of
+ * conditions and the following disclaimer in the documentation and/or other
+ * materials provided with the distribution. 3. Neither the name of the
+ * Institute nor the names of its contributors may be used to endorse or promote
+ * products derived from this software without specific prior written
+ * permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+package org.contikios.cooja.motes;
+
+import org.contikios.cooja.Mote;
+import org.contikios.cooja.TimeEvent;
+
+/**
+ * A mote whose execution can be split so that the mote software of
+ * several motes runs concurrently. Only the tick itself is run outside
+ * the simulation thread; everything that touches mote interfaces, the
+ * radio medium or other motes happens in beforeTick() and afterTick().
+ *
+ * Motes in the same tick group share state, such as a loaded native
+ * library, and are never ticked concurrently.
+ *
+ * @see org.contikios.cooja.Simulation#setParallelThreads(int)
+ */
+public interface ParallelTickMote extends Mote {
+
+  /**
+   * @param e Time event
+   * @return True iff e is the event that executes this mote
+   */
+  public boolean isExecuteEvent(TimeEvent e);
+
+  /**
+   * @return Object shared by all motes that cannot tick concurrently
+   */
+  public Object getTickGroup();
+
+  /**
+   * Prepare a tick. Called from the simulation thread.
+   *
+   * @param time Simulation time
+   * @return True iff tick() and afterTick() should follow
+   */
+  public boolean beforeTick(long time);
+
+  /**
+   * Run the mote software. May be called from any thread.
+   */
+  public void tick();
+
+  /**
+   * Finish a tick. Called from the simulation thread.
+   */
+  public void afterTick();
+}